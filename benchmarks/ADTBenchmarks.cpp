@@ -0,0 +1,605 @@
+//===- ADTBenchmarks.cpp - Microbenchmarks for ADT and Support ------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program times the core containers and allocators in ADT and Support on
+// workloads shaped like the ones the compiler gives them: pointer keys taken
+// from an allocator, identifier-like string keys, and vectors that grow and
+// shrink. The inputs are generated from fixed seeds so that runs on the same
+// host are comparable, and the results can be written as JSON.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FoldingSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/SwissMap.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Regex.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+    Filter("filter", cl::desc("Only run benchmarks whose name matches "
+                              "this regular expression"),
+           cl::init(""));
+
+static cl::opt<unsigned>
+    Repetitions("repetitions", cl::desc("Number of timed runs per benchmark"),
+                cl::init(5));
+
+static cl::opt<unsigned>
+    MinTimeMS("min-time-ms",
+              cl::desc("Minimum duration of a timed run in milliseconds"),
+              cl::init(50));
+
+static cl::opt<bool> ListOnly("list", cl::desc("List the benchmarks and exit"),
+                              cl::init(false));
+
+enum OutputFormatTy { text, json };
+static cl::opt<OutputFormatTy>
+    OutputFormat("format", cl::desc("Output format"), cl::init(text),
+                 cl::values(clEnumVal(text, "Human readable table"),
+                            clEnumVal(json, "Machine readable JSON"),
+                            clEnumValEnd));
+
+static cl::opt<std::string> OutputFilename("o", cl::desc("Output filename"),
+                                           cl::value_desc("filename"),
+                                           cl::init("-"));
+
+namespace {
+
+/// What a benchmark body is given: the size of its workload and the number
+/// of times to repeat it. Setup that should not be measured is followed by a
+/// call to resetTimer().
+class BenchState {
+  std::chrono::steady_clock::time_point Start;
+
+public:
+  const unsigned Size;
+  const unsigned Iterations;
+
+  BenchState(unsigned Size, unsigned Iterations)
+      : Start(std::chrono::steady_clock::now()), Size(Size),
+        Iterations(Iterations) {}
+
+  void resetTimer() { Start = std::chrono::steady_clock::now(); }
+
+  /// Return the nanoseconds since construction or the last resetTimer().
+  double getElapsedNS() const {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now() - Start)
+        .count();
+  }
+};
+
+typedef void (*BenchFn)(BenchState &);
+
+struct Benchmark {
+  std::string Name;
+  BenchFn Fn;
+  unsigned Size;
+};
+
+struct BenchResult {
+  unsigned Iterations;
+  double MinNS, MedianNS, MeanNS;
+};
+
+/// Results are accumulated here so that the compiler can't drop the work.
+volatile uint64_t Sink;
+
+/// An object the size of a small IR value, so that pointer keys have the
+/// spacing they have in practice.
+struct FakeValue {
+  void *Slots[6];
+};
+
+/// Return \p Size pointers to objects from one allocator, in a shuffled
+/// order.
+const std::vector<void *> &getPointerKeys(unsigned Size) {
+  static BumpPtrAllocator Alloc;
+  static std::map<unsigned, std::vector<void *>> Cache;
+  std::vector<void *> &Keys = Cache[Size];
+  if (Keys.empty()) {
+    for (unsigned I = 0; I != Size; ++I)
+      Keys.push_back(Alloc.Allocate<FakeValue>());
+    std::mt19937 RNG(Size);
+    std::shuffle(Keys.begin(), Keys.end(), RNG);
+  }
+  return Keys;
+}
+
+/// Return \p Size pointers that are distinct from getPointerKeys(Size).
+const std::vector<void *> &getMissingPointerKeys(unsigned Size) {
+  static std::map<unsigned, std::vector<void *>> Cache;
+  std::vector<void *> &Keys = Cache[Size];
+  if (Keys.empty()) {
+    const std::vector<void *> &Present = getPointerKeys(Size);
+    for (void *P : Present)
+      Keys.push_back(static_cast<char *>(P) + 1);
+  }
+  return Keys;
+}
+
+/// Return \p Size distinct names that look like the ones in a module.
+const std::vector<std::string> &getStringKeys(unsigned Size) {
+  static std::map<unsigned, std::vector<std::string>> Cache;
+  static const char *const Prefixes[] = {
+      "",    "tmp", "call", "arrayidx", "struct.anon.", "llvm.memcpy.p0i8.",
+      "_ZN4llvm", "add", "cmp", "if.then", "for.body", "__cxx_global_var_init."};
+  std::vector<std::string> &Keys = Cache[Size];
+  if (Keys.empty()) {
+    std::mt19937 RNG(Size);
+    for (unsigned I = 0; I != Size; ++I)
+      Keys.push_back(std::string(Prefixes[RNG() % array_lengthof(Prefixes)]) +
+                     std::to_string(I));
+  }
+  return Keys;
+}
+
+//===----------------------------------------------------------------------===//
+// SmallVector
+//===----------------------------------------------------------------------===//
+
+void benchSmallVectorPushBack(BenchState &S) {
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    SmallVector<unsigned, 16> V;
+    for (unsigned I = 0; I != S.Size; ++I)
+      V.push_back(I);
+    Sink += V.size();
+  }
+}
+
+void benchSmallVectorGrowShrink(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  S.resetTimer();
+  SmallVector<void *, 8> V;
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    V.append(Keys.begin(), Keys.end());
+    V.resize(V.size() / 2);
+    for (unsigned I = 0, E = S.Size / 2; I != E; ++I)
+      V.push_back(Keys[I]);
+    while (!V.empty())
+      Sink += reinterpret_cast<uintptr_t>(V.pop_back_val());
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// DenseMap and SwissMap
+//===----------------------------------------------------------------------===//
+
+template <typename MapT> void benchMapInsert(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    MapT Map;
+    for (unsigned I = 0; I != S.Size; ++I)
+      Map[Keys[I]] = I;
+    Sink += Map.size();
+  }
+}
+
+template <typename MapT> void benchMapLookupHit(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  MapT Map;
+  for (unsigned I = 0; I != S.Size; ++I)
+    Map[Keys[I]] = I;
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    for (void *K : Keys)
+      Sink += Map.find(K)->second;
+}
+
+template <typename MapT> void benchMapLookupMiss(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  const std::vector<void *> &Missing = getMissingPointerKeys(S.Size);
+  MapT Map;
+  for (unsigned I = 0; I != S.Size; ++I)
+    Map[Keys[I]] = I;
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    for (void *K : Missing)
+      Sink += Map.count(K);
+}
+
+/// Erase and reinsert every key, the pattern of maps that track values as
+/// they are replaced.
+template <typename MapT> void benchMapEraseInsert(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  MapT Map;
+  for (unsigned I = 0; I != S.Size; ++I)
+    Map[Keys[I]] = I;
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    for (unsigned I = 0; I != S.Size; ++I) {
+      Map.erase(Keys[I]);
+      Map[Keys[I]] = It;
+    }
+  Sink += Map.size();
+}
+
+//===----------------------------------------------------------------------===//
+// StringMap
+//===----------------------------------------------------------------------===//
+
+void benchStringMapInsert(BenchState &S) {
+  const std::vector<std::string> &Keys = getStringKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    StringMap<unsigned> Map;
+    for (unsigned I = 0; I != S.Size; ++I)
+      Map[Keys[I]] = I;
+    Sink += Map.size();
+  }
+}
+
+void benchStringMapLookup(BenchState &S) {
+  const std::vector<std::string> &Keys = getStringKeys(S.Size);
+  StringMap<unsigned> Map;
+  for (unsigned I = 0; I != S.Size; ++I)
+    Map[Keys[I]] = I;
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    for (const std::string &K : Keys)
+      Sink += Map.find(K)->second;
+}
+
+//===----------------------------------------------------------------------===//
+// FoldingSet
+//===----------------------------------------------------------------------===//
+
+struct PairNode : public FoldingSetNode {
+  void *A;
+  unsigned B;
+  PairNode(void *A, unsigned B) : A(A), B(B) {}
+  void Profile(FoldingSetNodeID &ID) const {
+    ID.AddPointer(A);
+    ID.AddInteger(B);
+  }
+};
+
+/// Unique nodes where every key is requested twice, as when the same
+/// expression is built from two places.
+void benchFoldingSetGetOrInsert(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    BumpPtrAllocator Alloc;
+    FoldingSet<PairNode> Set;
+    for (unsigned Round = 0; Round != 2; ++Round)
+      for (unsigned I = 0; I != S.Size; ++I) {
+        FoldingSetNodeID ID;
+        ID.AddPointer(Keys[I]);
+        ID.AddInteger(I);
+        void *InsertPos;
+        if (Set.FindNodeOrInsertPos(ID, InsertPos))
+          continue;
+        Set.InsertNode(new (Alloc.Allocate<PairNode>()) PairNode(Keys[I], I),
+                       InsertPos);
+      }
+    Sink += Set.size();
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// SmallPtrSet
+//===----------------------------------------------------------------------===//
+
+/// Build many sets that stay in small mode, like visited sets in a walk over
+/// a few operands.
+void benchSmallPtrSetSmall(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    for (unsigned I = 0; I + 8 <= S.Size; I += 8) {
+      SmallPtrSet<void *, 16> Set;
+      for (unsigned J = I; J != I + 8; ++J)
+        Set.insert(Keys[J]);
+      for (unsigned J = I; J != I + 8; ++J)
+        Sink += Set.count(Keys[J]);
+    }
+}
+
+void benchSmallPtrSetLarge(BenchState &S) {
+  const std::vector<void *> &Keys = getPointerKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    SmallPtrSet<void *, 16> Set;
+    for (void *K : Keys)
+      Set.insert(K);
+    for (void *K : Keys)
+      Sink += Set.count(K);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// BumpPtrAllocator
+//===----------------------------------------------------------------------===//
+
+void benchBumpPtrAllocate(BenchState &S) {
+  static const size_t Sizes[] = {16, 24, 48, 8, 72, 32, 128, 40};
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    BumpPtrAllocator Alloc;
+    for (unsigned I = 0; I != S.Size; ++I)
+      Sink += reinterpret_cast<uintptr_t>(
+          Alloc.Allocate(Sizes[I % array_lengthof(Sizes)], 8));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// raw_ostream
+//===----------------------------------------------------------------------===//
+
+void benchRawSVectorOstream(BenchState &S) {
+  const std::vector<std::string> &Keys = getStringKeys(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    SmallString<256> Buffer;
+    raw_svector_ostream OS(Buffer);
+    for (unsigned I = 0; I != S.Size; ++I)
+      OS << '%' << Keys[I] << " = add i32 " << I << ", " << (I * 7) << '\n';
+    Sink += Buffer.size();
+  }
+}
+
+/// Write Size records of 64 bytes to a temporary file.
+template <bool Async> void benchRawFdOstream(BenchState &S) {
+  std::string Record(63, 'x');
+  Record += '\n';
+  SmallString<64> Path;
+  int FD;
+  if (sys::fs::createTemporaryFile("adt-bench", "out", FD, Path))
+    report_fatal_error("cannot create a temporary file");
+  sys::Process::SafelyCloseFileDescriptor(FD);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+    if (Async)
+      OS.enable_async_writes();
+    for (unsigned I = 0; I != S.Size; ++I)
+      OS << Record;
+    OS.close();
+    Sink += OS.has_error();
+  }
+  sys::fs::remove(Path);
+}
+
+void benchRawStringOstreamFormat(BenchState &S) {
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    std::string Buffer;
+    raw_string_ostream OS(Buffer);
+    for (unsigned I = 0; I != S.Size; ++I)
+      OS << format("  .quad 0x%016x\n", uint64_t(I) * 0x9E3779B97F4A7C15ULL);
+    Sink += OS.str().size();
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Hashing
+//===----------------------------------------------------------------------===//
+
+/// Return \p Size bytes of data to hash.
+const std::vector<uint8_t> &getHashData(unsigned Size) {
+  static std::map<unsigned, std::vector<uint8_t>> Cache;
+  std::vector<uint8_t> &Data = Cache[Size];
+  if (Data.empty()) {
+    std::mt19937 RNG(Size);
+    for (unsigned I = 0; I != Size; ++I)
+      Data.push_back(RNG());
+  }
+  return Data;
+}
+
+void benchMD5(BenchState &S) {
+  ArrayRef<uint8_t> Data = getHashData(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    MD5 Hash;
+    Hash.update(Data);
+    MD5::MD5Result Result;
+    Hash.final(Result);
+    Sink += Result[0];
+  }
+}
+
+void benchSHA1(BenchState &S) {
+  ArrayRef<uint8_t> Data = getHashData(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It) {
+    SHA1 Hash;
+    Hash.update(Data);
+    Sink += Hash.final()[0];
+  }
+}
+
+void benchxxHash64(BenchState &S) {
+  ArrayRef<uint8_t> Data = getHashData(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    Sink += xxHash64(Data);
+}
+
+void benchxxHash128(BenchState &S) {
+  ArrayRef<uint8_t> Data = getHashData(S.Size);
+  S.resetTimer();
+  for (unsigned It = 0; It != S.Iterations; ++It)
+    Sink += xxHash128::hash(Data).High;
+}
+
+std::vector<Benchmark> getBenchmarks() {
+  std::vector<Benchmark> Benchmarks;
+  auto Add = [&](StringRef Name, BenchFn Fn, ArrayRef<unsigned> Sizes) {
+    for (unsigned Size : Sizes)
+      Benchmarks.push_back({(Name + "/" + Twine(Size)).str(), Fn, Size});
+  };
+  const unsigned Sizes[] = {16, 1024, 65536};
+  const unsigned LargeSizes[] = {16, 1024, 65536, 1048576};
+
+  Add("SmallVector/push_back", benchSmallVectorPushBack, Sizes);
+  Add("SmallVector/grow_shrink", benchSmallVectorGrowShrink, Sizes);
+
+  typedef DenseMap<void *, unsigned> PtrDenseMap;
+  Add("DenseMap/insert", benchMapInsert<PtrDenseMap>, LargeSizes);
+  Add("DenseMap/lookup_hit", benchMapLookupHit<PtrDenseMap>, LargeSizes);
+  Add("DenseMap/lookup_miss", benchMapLookupMiss<PtrDenseMap>, LargeSizes);
+  Add("DenseMap/erase_insert", benchMapEraseInsert<PtrDenseMap>, Sizes);
+  typedef SwissMap<void *, unsigned> PtrSwissMap;
+  Add("SwissMap/insert", benchMapInsert<PtrSwissMap>, LargeSizes);
+  Add("SwissMap/lookup_hit", benchMapLookupHit<PtrSwissMap>, LargeSizes);
+  Add("SwissMap/lookup_miss", benchMapLookupMiss<PtrSwissMap>, LargeSizes);
+  Add("SwissMap/erase_insert", benchMapEraseInsert<PtrSwissMap>, Sizes);
+
+  Add("StringMap/insert", benchStringMapInsert, Sizes);
+  Add("StringMap/lookup", benchStringMapLookup, Sizes);
+  Add("FoldingSet/get_or_insert", benchFoldingSetGetOrInsert, Sizes);
+  Add("SmallPtrSet/small", benchSmallPtrSetSmall, {1024});
+  Add("SmallPtrSet/large", benchSmallPtrSetLarge, Sizes);
+  Add("BumpPtrAllocator/allocate", benchBumpPtrAllocate, Sizes);
+  Add("raw_ostream/svector", benchRawSVectorOstream, Sizes);
+  Add("raw_ostream/format", benchRawStringOstreamFormat, Sizes);
+  const unsigned FileSizes[] = {1048576};
+  Add("raw_fd_ostream/write", benchRawFdOstream<false>, FileSizes);
+  Add("raw_fd_ostream/write_async", benchRawFdOstream<true>, FileSizes);
+  Add("MD5", benchMD5, Sizes);
+  Add("SHA1", benchSHA1, Sizes);
+  Add("xxHash64", benchxxHash64, Sizes);
+  Add("xxHash128", benchxxHash128, Sizes);
+  return Benchmarks;
+}
+
+double runOnce(const Benchmark &B, unsigned Iterations) {
+  BenchState S(B.Size, Iterations);
+  B.Fn(S);
+  return S.getElapsedNS();
+}
+
+/// Pick an iteration count that makes a run last at least -min-time-ms, then
+/// time -repetitions runs of it. Times are reported per item of the workload.
+BenchResult runBenchmark(const Benchmark &B) {
+  double MinNS = MinTimeMS * 1e6;
+  unsigned Iterations = 1;
+  for (double NS = runOnce(B, Iterations); NS < MinNS;
+       NS = runOnce(B, Iterations)) {
+    double Scale = NS > 0 ? MinNS * 1.2 / NS : 10;
+    Iterations = unsigned(std::min<double>(
+        std::max<double>(Iterations * 2, Iterations * Scale), 1u << 30));
+  }
+
+  std::vector<double> Samples;
+  for (unsigned R = 0; R != std::max(1u, unsigned(Repetitions)); ++R)
+    Samples.push_back(runOnce(B, Iterations) / (double(Iterations) * B.Size));
+  std::sort(Samples.begin(), Samples.end());
+
+  BenchResult Result;
+  Result.Iterations = Iterations;
+  Result.MinNS = Samples.front();
+  Result.MedianNS = Samples[Samples.size() / 2];
+  Result.MeanNS = 0;
+  for (double Sample : Samples)
+    Result.MeanNS += Sample;
+  Result.MeanNS /= Samples.size();
+  return Result;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "ADT and Support microbenchmarks\n");
+
+  Regex FilterRE(Filter);
+  std::string Error;
+  if (!FilterRE.isValid(Error)) {
+    errs() << argv[0] << ": invalid -filter: " << Error << '\n';
+    return 1;
+  }
+
+  std::vector<Benchmark> Benchmarks;
+  for (Benchmark &B : getBenchmarks())
+    if (Filter.empty() || FilterRE.match(B.Name))
+      Benchmarks.push_back(B);
+
+  if (ListOnly) {
+    for (const Benchmark &B : Benchmarks)
+      outs() << B.Name << '\n';
+    return 0;
+  }
+
+  std::error_code EC;
+  raw_fd_ostream OS(OutputFilename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << argv[0] << ": " << OutputFilename << ": " << EC.message()
+           << '\n';
+    return 1;
+  }
+
+  if (OutputFormat == json) {
+    OS << "{\n  \"context\": {\n";
+#ifndef NDEBUG
+    OS << "    \"assertions\": true,\n";
+#else
+    OS << "    \"assertions\": false,\n";
+#endif
+    OS << "    \"repetitions\": " << Repetitions << ",\n";
+    OS << "    \"min_time_ms\": " << MinTimeMS << "\n  },\n";
+    OS << "  \"benchmarks\": [";
+  } else {
+    OS << left_justify("Name", 36) << ' ' << right_justify("Min ns/item", 12)
+       << ' ' << right_justify("Median", 12) << ' '
+       << right_justify("Mean", 12) << ' ' << right_justify("Iterations", 12)
+       << '\n';
+  }
+
+  bool First = true;
+  for (const Benchmark &B : Benchmarks) {
+    BenchResult R = runBenchmark(B);
+    if (OutputFormat == json) {
+      OS << (First ? "\n" : ",\n");
+      OS << "    { \"name\": \"" << B.Name << "\", \"size\": " << B.Size
+         << ", \"iterations\": " << R.Iterations
+         << format(", \"min_ns\": %.4f, \"median_ns\": %.4f, "
+                   "\"mean_ns\": %.4f }",
+                   R.MinNS, R.MedianNS, R.MeanNS);
+    } else {
+      OS << format("%-36s %12.3f %12.3f %12.3f %12u\n", B.Name.c_str(),
+                   R.MinNS, R.MedianNS, R.MeanNS, R.Iterations);
+    }
+    OS.flush();
+    First = false;
+  }
+
+  if (OutputFormat == json)
+    OS << "\n  ]\n}\n";
+  return 0;
+}
@@ -0,0 +1,153 @@
+//===- AsmParserBenchmark.cpp - Measure the speed of parsing textual IR ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program times how long the assembly parser takes to turn .ll files into
+// modules. The files given on the command line are read into memory once and
+// then parsed -repetitions times each. Without files, a module of the size
+// given by -functions is generated, with the constructs that dominate large
+// files: numbered and named values, forward references through phis and
+// calls, integer constants and debug locations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFilenames(cl::Positional,
+                                            cl::desc("[<input .ll files>]"),
+                                            cl::ZeroOrMore);
+
+static cl::opt<unsigned>
+    Repetitions("repetitions", cl::desc("Number of timed parses per input"),
+                cl::init(5));
+
+static cl::opt<unsigned> NumFunctions(
+    "functions", cl::desc("Number of functions in the generated module, "
+                          "when no input files are given"),
+    cl::init(20000));
+
+namespace {
+
+/// Generate a module that exercises the parser the way big .ll files do.
+std::string generateModule(unsigned Functions) {
+  std::string Text;
+  raw_string_ostream OS(Text);
+  OS << "@counter = global i64 0\n\n";
+  for (unsigned F = 0; F != Functions; ++F) {
+    // Call the next function before it is declared, so that every module
+    // level reference starts out as a forward reference.
+    OS << "define i64 @function_" << F << "(i64 %n, i64* %p) {\n"
+       << "entry:\n"
+       << "  br label %loop\n\n"
+       << "loop:\n"
+       << "  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]\n"
+       << "  %sum = phi i64 [ " << F << ", %entry ], [ %sum.next, %loop ]\n"
+       << "  %0 = mul nsw i64 %i, 1103515245\n"
+       << "  %1 = add i64 %0, 12345\n"
+       << "  %2 = getelementptr inbounds i64, i64* %p, i64 %i\n"
+       << "  %3 = load i64, i64* %2, align 8, !dbg !" << (F % 64 + 4) << "\n"
+       << "  %4 = xor i64 %1, %3\n"
+       << "  %sum.next = add i64 %sum, %4\n"
+       << "  store i64 %sum.next, i64* @counter, align 8\n"
+       << "  %i.next = add nuw i64 %i, 1\n"
+       << "  %done = icmp uge i64 %i.next, %n\n"
+       << "  br i1 %done, label %exit, label %loop\n\n"
+       << "exit:\n";
+    if (F + 1 != Functions)
+      OS << "  %r = call i64 @function_" << F + 1
+         << "(i64 %sum.next, i64* %p)\n"
+         << "  ret i64 %r\n";
+    else
+      OS << "  ret i64 %sum.next\n";
+    OS << "}\n\n";
+  }
+  OS << "!llvm.dbg.cu = !{!0}\n"
+     << "!llvm.module.flags = !{!2}\n"
+     << "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+        "emissionKind: FullDebug)\n"
+     << "!1 = !DIFile(filename: \"generated.c\", directory: \"/\")\n"
+     << "!2 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+     << "!3 = distinct !DISubprogram(name: \"f\", scope: !1, file: !1, "
+        "unit: !0)\n";
+  for (unsigned L = 0; L != 64; ++L)
+    OS << "!" << L + 4 << " = !DILocation(line: " << L + 1 << ", scope: !3)\n";
+  return OS.str();
+}
+
+/// Parse \p Buffer -repetitions times and return the parse times in
+/// milliseconds, or an empty vector if it does not parse.
+std::vector<double> timeParses(MemoryBufferRef Buffer) {
+  std::vector<double> Times;
+  for (unsigned R = 0; R != std::max(1u, unsigned(Repetitions)); ++R) {
+    LLVMContext Context;
+    SMDiagnostic Err;
+    auto Start = std::chrono::steady_clock::now();
+    std::unique_ptr<Module> M = parseAssembly(Buffer, Err, Context);
+    Times.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - Start)
+                        .count());
+    if (!M) {
+      Err.print("asm-parse-bench", errs());
+      return std::vector<double>();
+    }
+  }
+  std::sort(Times.begin(), Times.end());
+  return Times;
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "textual IR parsing benchmark\n");
+
+  std::vector<std::unique_ptr<MemoryBuffer>> Inputs;
+  for (const std::string &Filename : InputFilenames) {
+    auto BufferOrErr = MemoryBuffer::getFile(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << argv[0] << ": " << Filename << ": " << EC.message() << '\n';
+      return 1;
+    }
+    Inputs.push_back(std::move(*BufferOrErr));
+  }
+  if (Inputs.empty())
+    Inputs.push_back(MemoryBuffer::getMemBufferCopy(
+        generateModule(NumFunctions), "generated.ll"));
+
+  outs() << left_justify("Input", 40) << ' ' << right_justify("MB", 10) << ' '
+         << right_justify("Min ms", 10) << ' ' << right_justify("Median ms", 10)
+         << ' ' << right_justify("MB/s", 10) << '\n';
+  for (const auto &Input : Inputs) {
+    std::vector<double> Times = timeParses(Input->getMemBufferRef());
+    if (Times.empty())
+      return 1;
+    double MB = Input->getBufferSize() / (1024.0 * 1024.0);
+    double Median = Times[Times.size() / 2];
+    outs() << left_justify(Input->getBufferIdentifier(), 40)
+           << format(" %10.2f %10.1f %10.1f %10.1f\n", MB, Times.front(),
+                     Median, MB / (Median / 1000));
+  }
+  return 0;
+}
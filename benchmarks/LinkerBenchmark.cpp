@@ -0,0 +1,132 @@
+//===- LinkerBenchmark.cpp - Measure the speed of linking many modules ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program times how long the IR linker takes to link many small modules
+// into one, the way llvm-link does for a whole program. Every generated module
+// has a static constructor, an entry in llvm.used, a private constant array,
+// a linkonce_odr function in a comdat that all of them share, and debug info,
+// so that the pieces whose cost grows with the size of the composite module
+// show up. Each -modules count is linked one module at a time and as a batch.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<unsigned>
+    NumModules("modules", cl::desc("Number of modules to link (repeatable)"),
+               cl::ZeroOrMore);
+
+namespace {
+
+/// Generate the source of the \p N'th module.
+std::string generateModule(unsigned N) {
+  std::string Text;
+  raw_string_ostream OS(Text);
+  OS << "$shared = comdat any\n"
+     << "@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] "
+        "[{ i32, void ()*, i8* } { i32 65535, void ()* @init_"
+     << N << ", i8* null }]\n"
+     << "@llvm.used = appending global [1 x i8*] [i8* bitcast (void ()* @init_"
+     << N << " to i8*)], section \"llvm.metadata\"\n"
+     << "@table = private constant [4 x i32] [i32 " << N << ", i32 1, i32 2, "
+     << "i32 3]\n"
+     << "@state_" << N << " = global i32 0\n\n"
+     << "define linkonce_odr i32 @shared(i32 %x) comdat {\n"
+     << "  %y = mul i32 %x, 3\n"
+     << "  ret i32 %y\n"
+     << "}\n\n"
+     << "define void @init_" << N << "() !dbg !3 {\n"
+     << "  %p = getelementptr [4 x i32], [4 x i32]* @table, i32 0, i32 1\n"
+     << "  %v = load i32, i32* %p, !dbg !4\n"
+     << "  %r = call i32 @shared(i32 %v), !dbg !4\n"
+     << "  store i32 %r, i32* @state_" << N << ", !dbg !4\n"
+     << "  ret void, !dbg !4\n"
+     << "}\n\n"
+     << "!llvm.dbg.cu = !{!0}\n"
+     << "!llvm.module.flags = !{!2}\n"
+     << "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, "
+        "emissionKind: FullDebug)\n"
+     << "!1 = !DIFile(filename: \"module_" << N << ".c\", directory: \"/\")\n"
+     << "!2 = !{i32 2, !\"Debug Info Version\", i32 3}\n"
+     << "!3 = distinct !DISubprogram(name: \"init\", scope: !1, file: !1, "
+        "isDefinition: true, unit: !0)\n"
+     << "!4 = !DILocation(line: 1, scope: !3)\n";
+  return OS.str();
+}
+
+/// Link \p Sources into one module and return the time it took in
+/// milliseconds, not counting parsing, or a negative number on failure.
+double timeLink(const std::vector<std::string> &Sources, bool Batch) {
+  LLVMContext Context;
+  std::vector<std::unique_ptr<Module>> Modules;
+  for (const std::string &Source : Sources) {
+    SMDiagnostic Err;
+    Modules.push_back(parseAssemblyString(Source, Err, Context));
+    if (!Modules.back()) {
+      Err.print("link-bench", errs());
+      return -1;
+    }
+  }
+
+  Module Composite("composite", Context);
+  Linker L(Composite);
+  auto Start = std::chrono::steady_clock::now();
+  if (Batch)
+    L.startBatch();
+  for (auto &M : Modules)
+    if (L.linkInModule(std::move(M)))
+      return -1;
+  if (Batch)
+    L.finishBatch();
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - Start)
+      .count();
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+  cl::ParseCommandLineOptions(argc, argv, "IR linking benchmark\n");
+
+  std::vector<unsigned> Counts(NumModules.begin(), NumModules.end());
+  if (Counts.empty())
+    Counts = {250, 500, 1000, 2000};
+
+  outs() << right_justify("Modules", 10) << ' '
+         << right_justify("One by one ms", 15) << ' '
+         << right_justify("Batch ms", 15) << '\n';
+  for (unsigned Count : Counts) {
+    std::vector<std::string> Sources;
+    for (unsigned N = 0; N != Count; ++N)
+      Sources.push_back(generateModule(N));
+    double OneByOne = timeLink(Sources, /*Batch=*/false);
+    double Batch = timeLink(Sources, /*Batch=*/true);
+    if (OneByOne < 0 || Batch < 0)
+      return 1;
+    outs() << format("%10u %15.1f %15.1f\n", Count, OneByOne, Batch);
+  }
+  return 0;
+}
@@ -801,6 +801,16 @@ macro(add_llvm_example name)
   set_target_properties(${name} PROPERTIES FOLDER "Examples")
 endmacro(add_llvm_example name)
 
+# Benchmarks are never installed, and are only part of the default build
+# target when LLVM_BUILD_BENCHMARKS is set.
+macro(add_llvm_benchmark name)
+  if( NOT LLVM_BUILD_BENCHMARKS )
+    set(EXCLUDE_FROM_ALL ON)
+  endif()
+  add_llvm_executable(${name} ${ARGN})
+  set_target_properties(${name} PROPERTIES FOLDER "Benchmarks")
+endmacro(add_llvm_benchmark name)
+
 
 macro(add_llvm_utility name)
   add_llvm_executable(${name} DISABLE_LLVM_LINK_LLVM_DYLIB ${ARGN})
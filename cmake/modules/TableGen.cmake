@@ -23,9 +23,23 @@ function(tablegen project ofn)
     set(LLVM_TARGET_DEFINITIONS_ABSOLUTE
       ${CMAKE_CURRENT_SOURCE_DIR}/${LLVM_TARGET_DEFINITIONS})
   endif()
+  # Order the DAG instruction selector's matcher table by a profile collected
+  # with 'llc -isel-matcher-profile', if there is one for this target.
+  set(tblgen_profile_args)
+  set(tblgen_profile_deps)
+  if(LLVM_DAG_ISEL_PROFILE_DIR AND "${ARGN}" MATCHES "-gen-dag-isel")
+    get_filename_component(td_name ${LLVM_TARGET_DEFINITIONS} NAME_WE)
+    set(profile ${LLVM_DAG_ISEL_PROFILE_DIR}/${td_name}.iselprof)
+    if(EXISTS ${profile})
+      set(tblgen_profile_args -dag-isel-profile=${profile})
+      set(tblgen_profile_deps ${profile})
+    endif()
+  endif()
+
   add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${ofn}.tmp
     # Generate tablegen output in a temporary file.
-    COMMAND ${${project}_TABLEGEN_EXE} ${ARGN} -I ${CMAKE_CURRENT_SOURCE_DIR}
+    COMMAND ${${project}_TABLEGEN_EXE} ${ARGN} ${tblgen_profile_args}
+    -I ${CMAKE_CURRENT_SOURCE_DIR}
     -I ${LLVM_MAIN_SRC_DIR}/lib/Target -I ${LLVM_MAIN_INCLUDE_DIR}
     ${LLVM_TARGET_DEFINITIONS_ABSOLUTE}
     -o ${CMAKE_CURRENT_BINARY_DIR}/${ofn}.tmp
@@ -33,7 +47,7 @@ function(tablegen project ofn)
     # directory and local_tds may not contain it, so we must
     # explicitly list it here:
     DEPENDS ${${project}_TABLEGEN_TARGET} ${local_tds} ${global_tds}
-    ${LLVM_TARGET_DEFINITIONS_ABSOLUTE}
+    ${LLVM_TARGET_DEFINITIONS_ABSOLUTE} ${tblgen_profile_deps}
     COMMENT "Building ${ofn}..."
     )
   add_custom_command(OUTPUT ${CMAKE_CURRENT_BINARY_DIR}/${ofn}
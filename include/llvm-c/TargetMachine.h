@@ -27,6 +27,7 @@ extern "C" {
 #endif
 typedef struct LLVMOpaqueTargetMachine *LLVMTargetMachineRef;
 typedef struct LLVMTarget *LLVMTargetRef;
+typedef struct LLVMOpaqueCodeGenQueue *LLVMCodeGenQueueRef;
 
 typedef enum {
     LLVMCodeGenLevelNone,
@@ -132,6 +133,55 @@ LLVMBool LLVMTargetMachineEmitToFile(LLVMTargetMachineRef T, LLVMModuleRef M,
 LLVMBool LLVMTargetMachineEmitToMemoryBuffer(LLVMTargetMachineRef T, LLVMModuleRef M,
   LLVMCodeGenFileType codegen, char** ErrorMessage, LLVMMemoryBufferRef *OutMemBuf);
 
+/*===-- Parallel code generation ------------------------------------------===*/
+/*
+ * A code generation queue compiles modules on a pool of threads.
+ *
+ * Every module added to a queue must be the only module of its LLVMContext
+ * that is in use: from the time it is added until its completion callback
+ * returns, the job owns the module and its context, and no other thread may
+ * touch either of them. Modules of different contexts are compiled in
+ * parallel. The target machine a module is added with is only read while
+ * the module is added: the job compiles with a copy of it, so the target
+ * machine may be changed, reused or disposed of right away.
+ *
+ * The functions taking a queue must not be called from several threads at
+ * once, nor from the callbacks of the queue's jobs.
+ */
+
+/** Called on a thread of the queue before \p M is compiled, for instance to
+  run optimization passes over it with a pass manager of its own. */
+typedef void (*LLVMCodeGenModuleCallback)(void *Context, LLVMModuleRef M);
+
+/** Called on a thread of the queue once \p M has been compiled. On success,
+  \p Output holds the emitted file, which the callback owns and has to dispose
+  of with LLVMDisposeMemoryBuffer, and \p ErrorMessage is null. On failure,
+  \p Output is null and \p ErrorMessage is only valid during the call. */
+typedef void (*LLVMCodeGenCompletionCallback)(void *Context, LLVMModuleRef M,
+                                              LLVMMemoryBufferRef Output,
+                                              const char *ErrorMessage);
+
+/** Creates a queue compiling up to \p NumThreads modules at once, or as many
+  as the host has hardware threads if \p NumThreads is 0. */
+LLVMCodeGenQueueRef LLVMCreateCodeGenQueue(unsigned NumThreads);
+
+/** Adds \p M to \p Q, to be compiled with a copy of \p T into a file of type
+  \p codegen. \p Prepare, which may be null, and then \p Completion are called
+  with \p Context on a thread of the queue. */
+void LLVMCodeGenQueueAddModule(LLVMCodeGenQueueRef Q, LLVMTargetMachineRef T,
+                               LLVMModuleRef M, LLVMCodeGenFileType codegen,
+                               LLVMCodeGenModuleCallback Prepare,
+                               LLVMCodeGenCompletionCallback Completion,
+                               void *Context);
+
+/** Waits until every module added to \p Q has been compiled and its
+  completion callback has returned. */
+void LLVMCodeGenQueueWait(LLVMCodeGenQueueRef Q);
+
+/** Waits for the modules added to \p Q, like LLVMCodeGenQueueWait, and
+  disposes of it. */
+void LLVMDisposeCodeGenQueue(LLVMCodeGenQueueRef Q);
+
 /*===-- Triple ------------------------------------------------------------===*/
 /** Get a triple for the host machine as a string. The result needs to be
   disposed with LLVMDisposeMessage. */
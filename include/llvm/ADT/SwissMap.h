@@ -0,0 +1,493 @@
+//===- llvm/ADT/SwissMap.h - Group probed hash table ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the SwissMap class, an open addressing hash table that
+// keeps one byte of metadata per bucket and probes that metadata a group of
+// buckets at a time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_SWISSMAP_H
+#define LLVM_ADT_SWISSMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace llvm {
+
+namespace detail {
+namespace swissmap {
+/// Every bucket has a control byte. A full bucket stores the top seven bits
+/// of the hash of its key; empty and deleted buckets have the sign bit set.
+enum : int8_t { Empty = -128, Deleted = -2 };
+
+/// The number of control bytes that are matched at once.
+const unsigned GroupWidth = 16;
+
+/// Return a mask with bit I set if control byte I of \p Group is \p Byte.
+inline uint32_t matchByte(const int8_t *Group, int8_t Byte) {
+#if defined(__SSE2__)
+  __m128i Ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Group));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(Byte), Ctrl));
+#else
+  uint32_t Mask = 0;
+  for (unsigned I = 0; I != GroupWidth; ++I)
+    Mask |= uint32_t(Group[I] == Byte) << I;
+  return Mask;
+#endif
+}
+
+/// Return a mask with bit I set if bucket I of \p Group is empty or deleted.
+inline uint32_t matchEmptyOrDeleted(const int8_t *Group) {
+#if defined(__SSE2__)
+  return _mm_movemask_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(Group)));
+#else
+  uint32_t Mask = 0;
+  for (unsigned I = 0; I != GroupWidth; ++I)
+    Mask |= uint32_t(Group[I] < 0) << I;
+  return Mask;
+#endif
+}
+} // end namespace swissmap
+} // end namespace detail
+
+/// A hash map with the interface of DenseMap that is laid out for large
+/// tables. A lookup compares one byte of metadata for each of a group of
+/// sixteen buckets at once and only touches the buckets whose metadata
+/// matches, so most misses never load a key. Keys don't need empty or
+/// tombstone values, but KeyInfoT is the same traits class DenseMap uses.
+///
+/// Iteration order is unspecified and differs from DenseMap.
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+class SwissMap {
+  typedef detail::DenseMapPair<KeyT, ValueT> BucketT;
+
+public:
+  typedef unsigned size_type;
+  typedef KeyT key_type;
+  typedef ValueT mapped_type;
+  typedef BucketT value_type;
+
+  template <bool IsConst> class IteratorImpl {
+    friend class SwissMap;
+    template <bool> friend class IteratorImpl;
+
+    typedef typename std::conditional<IsConst, const BucketT, BucketT>::type
+        BucketTy;
+
+    BucketTy *Ptr = nullptr;
+    const int8_t *CtrlPtr = nullptr;
+    const int8_t *CtrlEnd = nullptr;
+
+    IteratorImpl(BucketTy *Ptr, const int8_t *CtrlPtr, const int8_t *CtrlEnd,
+                 bool NoAdvance = false)
+        : Ptr(Ptr), CtrlPtr(CtrlPtr), CtrlEnd(CtrlEnd) {
+      if (!NoAdvance)
+        AdvancePastEmptyBuckets();
+    }
+
+    void AdvancePastEmptyBuckets() {
+      while (CtrlPtr != CtrlEnd && *CtrlPtr < 0) {
+        ++CtrlPtr;
+        ++Ptr;
+      }
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef std::ptrdiff_t difference_type;
+    typedef BucketTy value_type;
+    typedef value_type *pointer;
+    typedef value_type &reference;
+
+    IteratorImpl() = default;
+
+    // Allow conversion from iterator to const_iterator.
+    template <bool WasConst, typename = typename std::enable_if<
+                                 IsConst && !WasConst>::type>
+    IteratorImpl(const IteratorImpl<WasConst> &I)
+        : Ptr(I.Ptr), CtrlPtr(I.CtrlPtr), CtrlEnd(I.CtrlEnd) {}
+
+    reference operator*() const { return *Ptr; }
+    pointer operator->() const { return Ptr; }
+
+    bool operator==(const IteratorImpl &RHS) const { return Ptr == RHS.Ptr; }
+    bool operator!=(const IteratorImpl &RHS) const { return Ptr != RHS.Ptr; }
+
+    IteratorImpl &operator++() {
+      ++CtrlPtr;
+      ++Ptr;
+      AdvancePastEmptyBuckets();
+      return *this;
+    }
+    IteratorImpl operator++(int) {
+      IteratorImpl Tmp = *this;
+      ++*this;
+      return Tmp;
+    }
+  };
+
+  typedef IteratorImpl<false> iterator;
+  typedef IteratorImpl<true> const_iterator;
+
+  explicit SwissMap(unsigned InitialReserve = 0) { reserve(InitialReserve); }
+
+  SwissMap(const SwissMap &Other) {
+    if (!Other.NumEntries)
+      return;
+    allocateBuckets(Other.NumBuckets);
+    std::memcpy(Ctrl, Other.Ctrl, NumBuckets);
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      ::new (&Buckets[I].getFirst()) KeyT(Other.Buckets[I].getFirst());
+      ::new (&Buckets[I].getSecond()) ValueT(Other.Buckets[I].getSecond());
+    }
+    NumEntries = Other.NumEntries;
+    NumDeleted = Other.NumDeleted;
+  }
+
+  SwissMap(SwissMap &&Other) { swap(Other); }
+
+  ~SwissMap() {
+    destroyAll();
+    deallocateBuckets();
+  }
+
+  SwissMap &operator=(const SwissMap &Other) {
+    if (&Other != this) {
+      SwissMap Tmp(Other);
+      swap(Tmp);
+    }
+    return *this;
+  }
+
+  SwissMap &operator=(SwissMap &&Other) {
+    destroyAll();
+    deallocateBuckets();
+    swap(Other);
+    return *this;
+  }
+
+  void swap(SwissMap &RHS) {
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumDeleted, RHS.NumDeleted);
+  }
+
+  iterator begin() {
+    return empty() ? end() : iterator(Buckets, Ctrl, Ctrl + NumBuckets);
+  }
+  iterator end() {
+    return iterator(Buckets + NumBuckets, Ctrl + NumBuckets, Ctrl + NumBuckets,
+                    true);
+  }
+  const_iterator begin() const {
+    return empty() ? end() : const_iterator(Buckets, Ctrl, Ctrl + NumBuckets);
+  }
+  const_iterator end() const {
+    return const_iterator(Buckets + NumBuckets, Ctrl + NumBuckets,
+                          Ctrl + NumBuckets, true);
+  }
+
+  bool LLVM_ATTRIBUTE_UNUSED_RESULT empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can hold \p NumEntries entries without growing
+  /// again.
+  void reserve(size_type NumEntries) {
+    unsigned NewNumBuckets = getMinBucketsToReserve(NumEntries);
+    if (NewNumBuckets > NumBuckets)
+      rehash(NewNumBuckets);
+  }
+
+  void clear() {
+    if (!NumEntries && !NumDeleted)
+      return;
+    destroyAll();
+    std::memset(Ctrl, detail::swissmap::Empty, NumBuckets);
+    NumEntries = 0;
+    NumDeleted = 0;
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const KeyT &Key) const {
+    return findIndex(Key, hashKey(Key)) != NumBuckets;
+  }
+
+  iterator find(const KeyT &Key) {
+    return makeIterator(findIndex(Key, hashKey(Key)));
+  }
+  const_iterator find(const KeyT &Key) const {
+    return makeConstIterator(findIndex(Key, hashKey(Key)));
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const KeyT &Key) const {
+    unsigned I = findIndex(Key, hashKey(Key));
+    if (I != NumBuckets)
+      return Buckets[I].getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    uint64_t Hash = hashKey(Key);
+    unsigned I = findIndex(Key, Hash);
+    if (I != NumBuckets)
+      return std::make_pair(makeIterator(I), false);
+    I = prepareInsert(Hash);
+    ::new (&Buckets[I].getFirst()) KeyT(std::move(Key));
+    ::new (&Buckets[I].getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(I), true);
+  }
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    uint64_t Hash = hashKey(Key);
+    unsigned I = findIndex(Key, Hash);
+    if (I != NumBuckets)
+      return std::make_pair(makeIterator(I), false);
+    I = prepareInsert(Hash);
+    ::new (&Buckets[I].getFirst()) KeyT(Key);
+    ::new (&Buckets[I].getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(I), true);
+  }
+
+  /// Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Key) {
+    unsigned I = findIndex(Key, hashKey(Key));
+    if (I == NumBuckets)
+      return false;
+    eraseIndex(I);
+    return true;
+  }
+  void erase(iterator I) { eraseIndex(I.Ptr - Buckets); }
+
+  ValueT &operator[](const KeyT &Key) {
+    return try_emplace(Key).first->getSecond();
+  }
+  ValueT &operator[](KeyT &&Key) {
+    return try_emplace(std::move(Key)).first->getSecond();
+  }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by the map, it does not include
+  /// memory owned by the keys or values.
+  size_t getMemorySize() const { return NumBuckets * (sizeof(BucketT) + 1); }
+
+private:
+  BucketT *Buckets = nullptr;
+  int8_t *Ctrl = nullptr;
+  unsigned NumBuckets = 0;
+  unsigned NumEntries = 0;
+  unsigned NumDeleted = 0;
+
+  /// Spread the bits of the key's hash over 64 bits. Pointer hashes in
+  /// particular have little entropy in their high bits, which are the ones
+  /// stored in the control bytes.
+  static uint64_t hashKey(const KeyT &Key) {
+    return uint64_t(KeyInfoT::getHashValue(Key)) * 0x9E3779B97F4A7C15ULL;
+  }
+  static int8_t getControlByte(uint64_t Hash) { return int8_t(Hash >> 57); }
+
+  /// Return the first group of the probe sequence for \p Hash.
+  unsigned getFirstGroup(uint64_t Hash) const {
+    return unsigned(Hash ^ (Hash >> 32)) & (getNumGroups() - 1);
+  }
+  unsigned getNumGroups() const {
+    return NumBuckets / detail::swissmap::GroupWidth;
+  }
+
+  /// Return the minimum number of buckets that can hold \p NumEntries
+  /// entries, keeping the table at most 7/8 full.
+  static unsigned getMinBucketsToReserve(unsigned NumEntries) {
+    if (NumEntries == 0)
+      return 0;
+    return std::max<unsigned>(detail::swissmap::GroupWidth,
+                              NextPowerOf2((NumEntries * 8 + 6) / 7 - 1));
+  }
+
+  iterator makeIterator(unsigned I) {
+    return iterator(Buckets + I, Ctrl + I, Ctrl + NumBuckets, true);
+  }
+  const_iterator makeConstIterator(unsigned I) const {
+    return const_iterator(Buckets + I, Ctrl + I, Ctrl + NumBuckets, true);
+  }
+
+  /// Return the bucket holding \p Key, or NumBuckets if it is not in the map.
+  /// The groups are visited in triangular order, which reaches all of them
+  /// as the number of groups is a power of two.
+  unsigned findIndex(const KeyT &Key, uint64_t Hash) const {
+    using namespace detail::swissmap;
+    if (NumBuckets == 0)
+      return 0;
+    int8_t Byte = getControlByte(Hash);
+    unsigned GroupMask = getNumGroups() - 1;
+    unsigned Group = getFirstGroup(Hash);
+    for (unsigned Probe = 1;; ++Probe) {
+      const int8_t *GroupCtrl = Ctrl + Group * GroupWidth;
+      for (uint32_t Mask = matchByte(GroupCtrl, Byte); Mask;
+           Mask &= Mask - 1) {
+        unsigned I = Group * GroupWidth + countTrailingZeros(Mask);
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Buckets[I].getFirst(), Key)))
+          return I;
+      }
+      // A key is never placed past a group that had an empty bucket.
+      if (LLVM_LIKELY(matchByte(GroupCtrl, Empty)))
+        return NumBuckets;
+      Group = (Group + Probe) & GroupMask;
+      assert(Probe <= GroupMask && "Probed every group without a match!");
+    }
+  }
+
+  /// Return the first empty or deleted bucket in the probe sequence of
+  /// \p Hash.
+  unsigned findInsertIndex(uint64_t Hash) const {
+    using namespace detail::swissmap;
+    unsigned GroupMask = getNumGroups() - 1;
+    unsigned Group = getFirstGroup(Hash);
+    for (unsigned Probe = 1;; ++Probe) {
+      if (uint32_t Mask = matchEmptyOrDeleted(Ctrl + Group * GroupWidth))
+        return Group * GroupWidth + countTrailingZeros(Mask);
+      Group = (Group + Probe) & GroupMask;
+      assert(Probe <= GroupMask && "Table is full!");
+    }
+  }
+
+  /// Claim a bucket for a new key with \p Hash, growing the table first if
+  /// it would become more than 7/8 full.
+  unsigned prepareInsert(uint64_t Hash) {
+    if (LLVM_UNLIKELY((NumEntries + NumDeleted + 1) * 8 > NumBuckets * 7)) {
+      // If most of the used buckets are deleted, rehashing at the same size
+      // is enough to make room.
+      if (NumBuckets && (NumEntries + 1) * 16 <= NumBuckets * 7)
+        rehash(NumBuckets);
+      else
+        rehash(NumBuckets ? NumBuckets * 2 : detail::swissmap::GroupWidth);
+    }
+    unsigned I = findInsertIndex(Hash);
+    if (Ctrl[I] == detail::swissmap::Deleted)
+      --NumDeleted;
+    Ctrl[I] = getControlByte(Hash);
+    ++NumEntries;
+    return I;
+  }
+
+  void eraseIndex(unsigned I) {
+    using namespace detail::swissmap;
+    Buckets[I].getSecond().~ValueT();
+    Buckets[I].getFirst().~KeyT();
+    --NumEntries;
+    // If the group already has an empty bucket no lookup probes past it, so
+    // this bucket can become empty too rather than a tombstone.
+    if (matchByte(Ctrl + (I & ~(GroupWidth - 1)), Empty)) {
+      Ctrl[I] = Empty;
+    } else {
+      Ctrl[I] = Deleted;
+      ++NumDeleted;
+    }
+  }
+
+  void rehash(unsigned NewNumBuckets) {
+    BucketT *OldBuckets = Buckets;
+    int8_t *OldCtrl = Ctrl;
+    unsigned OldNumBuckets = NumBuckets;
+
+    allocateBuckets(NewNumBuckets);
+    std::memset(Ctrl, detail::swissmap::Empty, NumBuckets);
+    NumEntries = 0;
+    NumDeleted = 0;
+
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      BucketT &B = OldBuckets[I];
+      uint64_t Hash = hashKey(B.getFirst());
+      unsigned J = findInsertIndex(Hash);
+      Ctrl[J] = getControlByte(Hash);
+      ::new (&Buckets[J].getFirst()) KeyT(std::move(B.getFirst()));
+      ::new (&Buckets[J].getSecond()) ValueT(std::move(B.getSecond()));
+      ++NumEntries;
+      B.getSecond().~ValueT();
+      B.getFirst().~KeyT();
+    }
+
+    operator delete(OldBuckets);
+    delete[] OldCtrl;
+  }
+
+  void destroyAll() {
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void allocateBuckets(unsigned Num) {
+    assert(isPowerOf2_32(Num) && Num >= detail::swissmap::GroupWidth &&
+           "Invalid number of buckets!");
+    NumBuckets = Num;
+    Buckets = static_cast<BucketT *>(operator new(sizeof(BucketT) * Num));
+    Ctrl = new int8_t[Num];
+  }
+
+  void deallocateBuckets() {
+    operator delete(Buckets);
+    delete[] Ctrl;
+    Buckets = nullptr;
+    Ctrl = nullptr;
+    NumBuckets = 0;
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT>
+inline size_t capacity_in_bytes(const SwissMap<KeyT, ValueT, KeyInfoT> &X) {
+  return X.getMemorySize();
+}
+
+} // end namespace llvm
+
+#endif
@@ -24,7 +24,9 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/ErrorHandling.h"
+#include <forward_list>
 
 namespace llvm {
 class AssumptionCache;
@@ -36,6 +38,11 @@ class LoopInfo;
 /// manner. As one consequence, it is never invalidated. While it does retain
 /// some storage, that is used as an optimization and not to preserve
 /// information from query to query.
+///
+/// The exception is the opt-in query cache (-basicaa-cache-queries), which
+/// keeps alias results and decomposed GEPs from one query to the next. It is
+/// dropped whenever the pass manager reports that the function changed, or a
+/// value it refers to is deleted or replaced.
 class BasicAAResult : public AAResultBase<BasicAAResult> {
   friend AAResultBase<BasicAAResult>;
 
@@ -51,6 +58,7 @@ public:
                 LoopInfo *LI = nullptr)
       : AAResultBase(), DL(DL), TLI(TLI), AC(AC), DT(DT), LI(LI) {}
 
+  // The query cache refers back to this object, so copies start without it.
   BasicAAResult(const BasicAAResult &Arg)
       : AAResultBase(Arg), DL(Arg.DL), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
         LI(Arg.LI) {}
@@ -60,8 +68,13 @@ public:
 
   /// Handle invalidation events from the new pass manager.
   ///
-  /// By definition, this result is stateless and so remains valid.
-  bool invalidate(Function &, const PreservedAnalyses &) { return false; }
+  /// By definition, this result is stateless and so remains valid; only the
+  /// query cache has to go if the function may have changed.
+  bool invalidate(Function &, const PreservedAnalyses &PA) {
+    if (!PA.areAllPreserved())
+      clearQueryCache();
+    return false;
+  }
 
   AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB);
 
@@ -147,6 +160,37 @@ private:
   /// Tracks instructions visited by pointsToConstantMemory.
   SmallPtrSet<const Value *, 16> Visited;
 
+  /// Drops the query cache when a value it refers to is deleted or replaced.
+  class QueryCacheVH final : public CallbackVH {
+    BasicAAResult *AAR;
+
+    void deleted() override;
+    void allUsesReplacedWith(Value *) override;
+
+  public:
+    QueryCacheVH(const Value *V, BasicAAResult *AAR)
+        : CallbackVH(const_cast<Value *>(V)), AAR(AAR) {}
+  };
+
+  /// The query cache: results of top-level queries and decomposed GEPs, kept
+  /// across queries when -basicaa-cache-queries is enabled.
+  struct CachedDecomposition {
+    DecomposedGEP Decomposed;
+    bool MaxLookupReached;
+  };
+  DenseMap<LocPair, AliasResult> QueryCache;
+  DenseMap<const Value *, CachedDecomposition> DecomposedGEPCache;
+  SmallPtrSet<const Value *, 16> QueryCacheValues;
+  std::forward_list<QueryCacheVH> QueryCacheHandles;
+  /// Set by the value handles; the cache is dropped before the next query.
+  bool QueryCacheStale = false;
+
+  void clearQueryCache();
+  void addToQueryCache(const Value *V);
+
+  /// DecomposeGEPExpression, going through the query cache if enabled.
+  bool decomposeGEP(const Value *V, DecomposedGEP &Decomposed);
+
   static const Value *
   GetLinearExpression(const Value *V, APInt &Scale, APInt &Offset,
                       unsigned &ZExtBits, unsigned &SExtBits,
@@ -14,6 +14,9 @@
 #ifndef LLVM_ANALYSIS_INLINECOST_H
 #define LLVM_ANALYSIS_INLINECOST_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/CallGraphSCCPass.h"
 #include <cassert>
 #include <climits>
@@ -98,6 +101,52 @@ public:
   int getCostDelta() const { return Threshold - getCost(); }
 };
 
+/// \brief A cache of the part of the inline cost of a callee that does not
+/// depend on the call site.
+///
+/// Call sites that pass no constant arguments only differ in how their pointer
+/// arguments relate to each other and to allocas in the caller. The walk over
+/// the callee body is the same for all call sites that agree on that, and its
+/// result is kept here. The threshold, the bonuses and the checks that depend
+/// on the caller are still computed for every call site.
+///
+/// The client must forget every function whose body it changes or deletes.
+class InlineCostCache {
+public:
+  /// The result of walking the body of a callee.
+  struct BodyCost {
+    /// Describes the arguments of the call sites this applies to.
+    SmallVector<int64_t, 8> ArgKey;
+    /// The cost of the body, and the highest cost reached at a point where
+    /// the walk could have stopped, before and after the first block with
+    /// several successors.
+    int Cost, MaxSingleBBCost, MaxMultiBBCost;
+    uint64_t AllocatedSize;
+    unsigned NumInstructions, NumVectorInstructions;
+    bool SingleBB;
+    bool ContainsNoDuplicateCall;
+    /// The walk found a construct that can't be inlined. This is left to the
+    /// uncached analysis to report.
+    bool Aborted;
+    // Statistics printed when debugging.
+    unsigned NumConstantPtrCmps, NumConstantPtrDiffs;
+    unsigned NumInstructionsSimplified, SROACostSavings, SROACostSavingsLost;
+  };
+
+  /// Look up the body cost of \p Callee for call sites described by
+  /// \p ArgKey. Returns null if there is none.
+  const BodyCost *lookup(const Function *Callee, ArrayRef<int64_t> ArgKey) const;
+  const BodyCost &insert(const Function *Callee, BodyCost Cost);
+
+  /// Forget the body costs of \p F.
+  void forgetFunction(const Function *F) { Costs.erase(F); }
+
+  void clear() { Costs.clear(); }
+
+private:
+  DenseMap<const Function *, SmallVector<BodyCost, 1>> Costs;
+};
+
 /// \brief Get an InlineCost object representing the cost of inlining this
 /// callsite.
 ///
@@ -108,10 +157,12 @@ public:
 /// sufficiently low to warrant inlining.
 ///
 /// Also note that calling this function *dynamically* computes the cost of
-/// inlining the callsite. It is an expensive, heavyweight call.
+/// inlining the callsite. It is an expensive, heavyweight call, unless a
+/// \p Cache already holds the cost of the callee body for its arguments.
 InlineCost getInlineCost(CallSite CS, int DefaultThreshold,
                          TargetTransformInfo &CalleeTTI,
-                         AssumptionCacheTracker *ACT);
+                         AssumptionCacheTracker *ACT,
+                         InlineCostCache *Cache = nullptr);
 
 /// \brief Get an InlineCost with the callee explicitly specified.
 /// This allows you to calculate the cost of inlining a function via a
@@ -120,7 +171,8 @@ InlineCost getInlineCost(CallSite CS, int DefaultThreshold,
 //
 InlineCost getInlineCost(CallSite CS, Function *Callee, int DefaultThreshold,
                          TargetTransformInfo &CalleeTTI,
-                         AssumptionCacheTracker *ACT);
+                         AssumptionCacheTracker *ACT,
+                         InlineCostCache *Cache = nullptr);
 
 int computeThresholdFromOptLevels(unsigned OptLevel, unsigned SizeOptLevel);
 
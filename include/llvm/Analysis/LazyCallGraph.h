@@ -697,6 +697,21 @@ public:
     return make_range(postorder_ref_scc_begin(), postorder_ref_scc_end());
   }
 
+  /// Partition the RefSCCs of the graph into levels of independent RefSCCs.
+  ///
+  /// This completes the formation of the RefSCC DAG, and then assigns each
+  /// RefSCC to the level one above the highest of its children, leaves being
+  /// at level zero. No RefSCC references another one of the same level, so
+  /// the RefSCCs of a level can be visited in any order once all the lower
+  /// levels are done, and visiting the levels in increasing order is a valid
+  /// post-order walk of the DAG.
+  ///
+  /// The levels are the units of work of a concurrent bottom-up walk over the
+  /// call graph. Note that the graph and the IR provide no synchronization
+  /// themselves: mutating the functions of two RefSCCs at the same time still
+  /// races on the uniqued constants and metadata of their shared LLVMContext.
+  SmallVector<SmallVector<RefSCC *, 4>, 4> getIndependentRefSCCLevels();
+
   /// Lookup a function in the graph which has already been scanned and added.
   Node *lookup(const Function &F) const { return NodeMap.lookup(&F); }
 
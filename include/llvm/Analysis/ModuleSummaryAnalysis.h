@@ -14,6 +14,7 @@
 #ifndef LLVM_ANALYSIS_MODULESUMMARYANALYSIS_H
 #define LLVM_ANALYSIS_MODULESUMMARYANALYSIS_H
 
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/Pass.h"
@@ -29,6 +30,12 @@ class ModuleSummaryIndexBuilder {
   std::unique_ptr<ModuleSummaryIndex> Index;
   /// The module for which we are building an index
   const Module *M;
+  /// The profile counts at or above which a call edge is hot, and at or below
+  /// which it is cold, from the profile summary of the module if it has one.
+  Optional<uint64_t> HotCountThreshold, ColdCountThreshold;
+  /// The types that each virtual table of the module has address points for,
+  /// from the llvm.bitsets metadata.
+  DenseMap<const GlobalVariable *, std::vector<TypeIdOffset>> VTableTypes;
 
 public:
   /// Default constructor
@@ -47,6 +54,15 @@ public:
   std::unique_ptr<ModuleSummaryIndex> takeIndex() { return std::move(Index); }
 
 private:
+  /// Compute the hot and cold count thresholds from the profile summary.
+  void computeCountThresholds();
+
+  /// Classify a call edge with profile count \p Count.
+  CalleeInfo::HotnessType getHotness(uint64_t Count) const;
+
+  /// Collect the types that the virtual tables of the module are members of.
+  void computeVTableTypes();
+
   /// Compute summary for given function with optional frequency information
   void computeFunctionSummary(const Function &F,
                               BlockFrequencyInfo *BFI = nullptr);
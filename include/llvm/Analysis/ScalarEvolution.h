@@ -521,6 +521,23 @@ namespace llvm {
     /// predicate by splitting it into a set of independent predicates.
     bool ProvingSplitPredicate;
 
+    /// The number of expressions created by createSCEV for this function.
+    unsigned NumCreatedSCEVs;
+
+    /// Set once this function exceeded the expression or memory budget. From
+    /// then on, createSCEV treats every value as unknown.
+    bool BudgetExhausted;
+
+    /// The number of getSCEV, getSCEVAtScope and backedge-taken count
+    /// computations in progress. Memoized results are only evicted when this
+    /// is zero, as the computations rely on their placeholder entries.
+    unsigned ComputationDepth;
+
+    /// When each loop's backedge-taken count was last asked for, used to evict
+    /// the least recently used ones when over the memory budget.
+    DenseMap<const Loop *, uint64_t> BackedgeTakenLastUse;
+    uint64_t BackedgeTakenClock;
+
     /// Information about the number of loop iterations for which a loop exit's
     /// branch condition evaluates to the not-taken path.  This is a temporary
     /// pair of exact and max expressions that are eventually summarized in
@@ -1423,6 +1440,10 @@ namespace llvm {
     /// recompute is simpler.
     void forgetLoopDispositions(const Loop *L) { LoopDispositions.clear(); }
 
+    /// Return an estimate of the number of bytes used by the expressions and
+    /// memoized results for this function.
+    size_t getMemoryUsage() const;
+
     /// Determine the minimum number of zero bits that S is guaranteed to end in
     /// (at every loop iteration).  It is, at the same time, the minimum number
     /// of times S is divisible by 2.  For example, given {4,+,8} it returns 2.
@@ -1651,6 +1672,15 @@ namespace llvm {
     bool doesIVOverflowOnGT(const SCEV *RHS, const SCEV *Stride,
                             bool IsSigned, bool NoWrap);
 
+    /// If the memory budget is exceeded, evict memoized results that can be
+    /// recomputed, keeping the backedge-taken count of \p Keep. If that is
+    /// not enough, stop analyzing new values.
+    void enforceMemoryBudget(const Loop *Keep);
+
+    /// Report that this function exceeded a budget, and stop analyzing new
+    /// values.
+    void exhaustBudget(const Twine &Reason);
+
   private:
     FoldingSet<SCEV> UniqueSCEVs;
     FoldingSet<SCEVPredicate> UniquePreds;
@@ -1697,6 +1727,7 @@ namespace llvm {
 
     bool runOnFunction(Function &F) override;
     void releaseMemory() override;
+    size_t getMemoryUsage() const override;
     void getAnalysisUsage(AnalysisUsage &AU) const override;
     void print(raw_ostream &OS, const Module * = nullptr) const override;
     void verifyAnalysis() const override;
@@ -15,6 +15,9 @@
 #ifndef LLVM_ANALYSIS_VALUETRACKING_H
 #define LLVM_ANALYSIS_VALUETRACKING_H
 
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/ConstantRange.h"
 #include "llvm/IR/Instruction.h"
@@ -23,7 +26,6 @@
 
 namespace llvm {
 template <typename T> class ArrayRef;
-  class APInt;
   class AddOperator;
   class AssumptionCache;
   class DataLayout;
@@ -41,6 +43,61 @@ template <typename T> class ArrayRef;
   enum ID : unsigned;
   }
 
+  /// A cache for the results of computeKnownBits and ComputeNumSignBits on the
+  /// instructions of a function, for clients that ask about the same values
+  /// many times.
+  ///
+  /// The results are only valid as long as the instructions they were
+  /// computed for, and the ones these depend on, are not changed. The client
+  /// must call forgetValue on every instruction it modifies in place or is
+  /// about to delete. A result is reused for a query with the same context
+  /// instruction and the same or a greater depth, so the answers can be more
+  /// precise than the uncached ones.
+  class KnownBitsCache {
+  public:
+    /// Look up the known bits of \p V in the context \p CxtI for a query at
+    /// \p Depth. Returns false if there is no usable result.
+    bool lookupKnownBits(const Value *V, const Instruction *CxtI,
+                         unsigned Depth, APInt &KnownZero,
+                         APInt &KnownOne) const;
+    void insertKnownBits(const Value *V, const Instruction *CxtI,
+                         unsigned Depth, const APInt &KnownZero,
+                         const APInt &KnownOne);
+
+    /// Look up the number of sign bits of \p V in the context \p CxtI for a
+    /// query at \p Depth. Returns 0 if there is no usable result.
+    unsigned lookupNumSignBits(const Value *V, const Instruction *CxtI,
+                               unsigned Depth) const;
+    void insertNumSignBits(const Value *V, const Instruction *CxtI,
+                           unsigned Depth, unsigned NumSignBits);
+
+    /// Forget the results for \p V, for the queries in the context of \p V
+    /// and for the values that the results for \p V may have been used for.
+    void forgetValue(const Value *V);
+
+    void clear();
+
+  private:
+    struct KnownBitsEntry {
+      const Instruction *CxtI;
+      unsigned Depth;
+      APInt KnownZero, KnownOne;
+    };
+    struct NumSignBitsEntry {
+      const Instruction *CxtI;
+      unsigned Depth;
+      unsigned NumSignBits;
+    };
+
+    void noteContext(const Value *V, const Instruction *CxtI);
+    void forgetResults(const Value *V);
+
+    DenseMap<const Value *, SmallVector<KnownBitsEntry, 1>> KnownBits;
+    DenseMap<const Value *, SmallVector<NumSignBitsEntry, 1>> NumSignBits;
+    /// The values that have results in the context of each instruction.
+    DenseMap<const Instruction *, SmallVector<const Value *, 2>> Contexts;
+  };
+
   /// Determine which bits of V are known to be either zero or one and return
   /// them in the KnownZero/KnownOne bit sets.
   ///
@@ -49,11 +106,15 @@ template <typename T> class ArrayRef;
   /// where V is a vector, the known zero and known one values are the
   /// same width as the vector element, and the bit is set only if it is true
   /// for all of the elements in the vector.
+  ///
+  /// If \p KBC is given, the results for instructions are looked up in and
+  /// added to it.
   void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
                         const DataLayout &DL, unsigned Depth = 0,
                         AssumptionCache *AC = nullptr,
                         const Instruction *CxtI = nullptr,
-                        const DominatorTree *DT = nullptr);
+                        const DominatorTree *DT = nullptr,
+                        KnownBitsCache *KBC = nullptr);
   /// Compute known bits from the range metadata.
   /// \p KnownZero the set of bits that are known to be zero
   /// \p KnownOne the set of bits that are known to be one
@@ -71,7 +132,8 @@ template <typename T> class ArrayRef;
                       const DataLayout &DL, unsigned Depth = 0,
                       AssumptionCache *AC = nullptr,
                       const Instruction *CxtI = nullptr,
-                      const DominatorTree *DT = nullptr);
+                      const DominatorTree *DT = nullptr,
+                      KnownBitsCache *KBC = nullptr);
 
   /// isKnownToBeAPowerOfTwo - Return true if the given value is known to have
   /// exactly one bit set when defined. For vectors return true if every
@@ -132,7 +194,8 @@ template <typename T> class ArrayRef;
   bool MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
                          unsigned Depth = 0, AssumptionCache *AC = nullptr,
                          const Instruction *CxtI = nullptr,
-                         const DominatorTree *DT = nullptr);
+                         const DominatorTree *DT = nullptr,
+                         KnownBitsCache *KBC = nullptr);
 
   /// ComputeNumSignBits - Return the number of times the sign bit of the
   /// register is replicated into the other bits.  We know that at least 1 bit
@@ -145,7 +208,8 @@ template <typename T> class ArrayRef;
   unsigned ComputeNumSignBits(Value *Op, const DataLayout &DL,
                               unsigned Depth = 0, AssumptionCache *AC = nullptr,
                               const Instruction *CxtI = nullptr,
-                              const DominatorTree *DT = nullptr);
+                              const DominatorTree *DT = nullptr,
+                              KnownBitsCache *KBC = nullptr);
 
   /// ComputeMultiple - This function computes the integer multiple of Base that
   /// equals V.  If successful, it returns true and returns the multiple in
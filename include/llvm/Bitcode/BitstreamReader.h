@@ -127,6 +127,23 @@ public:
     assert(!hasBlockInfoRecords());
     BlockInfoRecords = std::move(Other.BlockInfoRecords);
   }
+
+  /// Copies the block info of the other bitstream reader. The abbreviations
+  /// are reference counted without synchronization, so they are copied too,
+  /// which lets cursors of the two readers be used on different threads.
+  void copyBlockInfo(const BitstreamReader &Other) {
+    assert(!hasBlockInfoRecords());
+    BlockInfoRecords.resize(Other.BlockInfoRecords.size());
+    for (unsigned I = 0, E = BlockInfoRecords.size(); I != E; ++I) {
+      const BlockInfo &From = Other.BlockInfoRecords[I];
+      BlockInfo &To = BlockInfoRecords[I];
+      To.BlockID = From.BlockID;
+      for (const auto &Abbv : From.Abbrevs)
+        To.Abbrevs.push_back(new BitCodeAbbrev(*Abbv));
+      To.Name = From.Name;
+      To.RecordNames = From.RecordNames;
+    }
+  }
 };
 
 /// This represents a position within a bitstream. There may be multiple
@@ -405,6 +422,33 @@ struct BitstreamEntry {
   }
 };
 
+/// The entries of a block that were read ahead of time by
+/// BitstreamCursor::recordBlock, possibly on another thread. A cursor that
+/// replays them returns the same entries and records as reading the block
+/// would, without decoding any bits.
+class BitstreamRecording {
+  friend class BitstreamCursor;
+
+  struct Entry {
+    decltype(BitstreamEntry::Kind) Kind;
+    /// The block ID of a SubBlock, or the code of a Record.
+    unsigned ID;
+    /// The size of a SubBlock in words.
+    unsigned NumWords;
+    /// For a Record, its operands are [Begin, End) in Ops. For a SubBlock, End
+    /// is the index of the entry following its EndBlock.
+    size_t Begin;
+    size_t End;
+    bool HasBlob;
+    StringRef Blob;
+  };
+
+  unsigned NumWords = 0;
+  uint64_t EndBit = 0;
+  std::vector<Entry> Entries;
+  std::vector<uint64_t> Ops;
+};
+
 /// This represents a position within a bitcode file, implemented on top of a
 /// SimpleBitstreamCursor.
 ///
@@ -427,6 +471,14 @@ class BitstreamCursor : SimpleBitstreamCursor {
   /// This tracks the codesize of parent blocks.
   SmallVector<Block, 8> BlockScope;
 
+  /// The recording being replayed, if any, the next entry to return from it,
+  /// and the number of its blocks that have been entered.
+  const BitstreamRecording *Replay = nullptr;
+  size_t ReplayPos = 0;
+  unsigned ReplayDepth = 0;
+
+  BitstreamEntry advanceReplay();
+  unsigned readReplayedRecord(SmallVectorImpl<uint64_t> &Vals, StringRef *Blob);
 
 public:
   static const size_t MaxChunkSize = sizeof(word_t) * 8;
@@ -471,6 +523,10 @@ public:
 
   /// Advance the current bitstream, returning the next entry in the stream.
   BitstreamEntry advance(unsigned Flags = 0) {
+    if (Replay) {
+      assert(!Flags && "Cannot replay a recording with flags");
+      return advanceReplay();
+    }
     while (1) {
       unsigned Code = ReadCode();
       if (Code == bitc::END_BLOCK) {
@@ -526,6 +582,11 @@ public:
   /// Having read the ENTER_SUBBLOCK abbrevid and a BlockID, skip over the body
   /// of this block. If the block record is malformed, return true.
   bool SkipBlock() {
+    if (Replay) {
+      ReplayPos = Replay->Entries[ReplayPos - 1].End;
+      return false;
+    }
+
     // Read and ignore the codelen value.  Since we are skipping this block, we
     // don't care what code widths are used inside of it.
     ReadVBR(bitc::CodeLenWidth);
@@ -585,6 +646,29 @@ public:
   unsigned readRecord(unsigned AbbrevID, SmallVectorImpl<uint64_t> &Vals,
                       StringRef *Blob = nullptr);
 
+  //===--------------------------------------------------------------------===//
+  // Recording and Replaying Blocks
+  //===--------------------------------------------------------------------===//
+
+  /// Read the block with the specified ID, which is about to be entered with
+  /// EnterSubBlock, and everything nested in it into \p R. The cursor is left
+  /// after the block. Return true if the block is malformed, in which case
+  /// replaying \p R also reports an error.
+  bool recordBlock(unsigned BlockID, BitstreamRecording &R);
+
+  /// Return the entries of \p R, which must stay alive until its block has
+  /// been read, instead of reading the stream. The cursor must be where the
+  /// recorded block starts; it moves past the block once its end is read.
+  void replay(const BitstreamRecording &R) {
+    assert(!Replay && "Already replaying a recording");
+    Replay = &R;
+    ReplayPos = 0;
+    ReplayDepth = 0;
+  }
+
+  /// Stop replaying a recording whose block has not been read to its end.
+  void stopReplaying() { Replay = nullptr; }
+
   //===--------------------------------------------------------------------===//
   // Abbrev Processing
   //===--------------------------------------------------------------------===//
@@ -85,6 +85,25 @@ public:
   explicit BitstreamWriter(SmallVectorImpl<char> &O)
     : Out(O), CurBit(0), CurValue(0), CurCodeSize(2) {}
 
+  /// Create a stream writing to \p O that continues the block \p Parent is
+  /// currently in: it uses the same abbrev ID width and has its own copy of
+  /// the BLOCKINFO abbreviations. Subblocks written to it can later be spliced
+  /// into \p Parent with appendAlignedWords, which lets independent blocks be
+  /// encoded on separate threads.
+  BitstreamWriter(SmallVectorImpl<char> &O, const BitstreamWriter &Parent)
+      : Out(O), CurBit(0), CurValue(0), CurCodeSize(Parent.CurCodeSize),
+        BlockInfoCurBID(0) {
+    // The abbreviations are reference counted without synchronization, so
+    // they cannot be shared with a stream used on another thread.
+    BlockInfoRecords.resize(Parent.BlockInfoRecords.size());
+    for (unsigned I = 0, E = BlockInfoRecords.size(); I != E; ++I) {
+      const BlockInfo &From = Parent.BlockInfoRecords[I];
+      BlockInfoRecords[I].BlockID = From.BlockID;
+      for (const auto &Abbv : From.Abbrevs)
+        BlockInfoRecords[I].Abbrevs.push_back(new BitCodeAbbrev(*Abbv));
+    }
+  }
+
   ~BitstreamWriter() {
     assert(CurBit == 0 && "Unflushed data remaining");
     assert(BlockScope.empty() && CurAbbrevs.empty() && "Block imbalance");
@@ -100,6 +119,14 @@ public:
   // Basic Primitives for emitting bits to the stream.
   //===--------------------------------------------------------------------===//
 
+  /// Append the output of a stream created from this one. Both this stream
+  /// and \p Words must end at a 32-bit boundary.
+  void appendAlignedWords(ArrayRef<char> Words) {
+    assert(CurBit == 0 && "Stream is not 32-bit aligned");
+    assert((Words.size() & 3) == 0 && "Appended data is not 32-bit aligned");
+    Out.append(Words.begin(), Words.end());
+  }
+
   /// Backpatch a 32-bit word in the output at the given bit offset
   /// with the specified value.
   void BackpatchWord(uint64_t BitNo, unsigned NewWord) {
@@ -52,7 +52,9 @@ enum BlockIDs {
 
   OPERAND_BUNDLE_TAGS_BLOCK_ID,
 
-  METADATA_KIND_BLOCK_ID
+  METADATA_KIND_BLOCK_ID,
+
+  SYMTAB_BLOCK_ID
 };
 
 /// Identification block contains a string that describes the producer details,
@@ -198,7 +200,7 @@ enum GlobalValueSummarySymtabCodes {
   FS_PERMODULE = 1,
   // PERMODULE_PROFILE: [valueid, flags, instcount, numrefs,
   //                     numrefs x valueid,
-  //                     n x (valueid, callsitecount, profilecount)]
+  //                     n x (valueid, callsitecount, profilecount, hotness)]
   FS_PERMODULE_PROFILE = 2,
   // PERMODULE_GLOBALVAR_INIT_REFS: [valueid, flags, n x valueid]
   FS_PERMODULE_GLOBALVAR_INIT_REFS = 3,
@@ -207,7 +209,7 @@ enum GlobalValueSummarySymtabCodes {
   FS_COMBINED = 4,
   // COMBINED_PROFILE: [valueid, modid, flags, instcount, numrefs,
   //                    numrefs x valueid,
-  //                    n x (valueid, callsitecount, profilecount)]
+  //                    n x (valueid, callsitecount, profilecount, hotness)]
   FS_COMBINED_PROFILE = 5,
   // COMBINED_GLOBALVAR_INIT_REFS: [valueid, modid, flags, n x valueid]
   FS_COMBINED_GLOBALVAR_INIT_REFS = 6,
@@ -219,6 +221,15 @@ enum GlobalValueSummarySymtabCodes {
   FS_COMBINED_ORIGINAL_NAME = 9,
   // VERSION of the summary, bumped when adding flags for instance.
   FS_VERSION = 10,
+  // The following records follow the summary record that they describe.
+  // VCALLS: [n x (typeid, offset)]
+  FS_VCALLS = 11,
+  // VTABLE_TYPES: [n x (typeid, offset)]
+  FS_VTABLE_TYPES = 12,
+  // VTABLE_FUNC: [offset, namechar x N]
+  FS_VTABLE_FUNC = 13,
+  // DEVIRT_SINGLE_IMPL: [typeid, offset, namechar x N]
+  FS_DEVIRT_SINGLE_IMPL = 14,
 };
 
 enum MetadataCodes {
@@ -257,6 +268,8 @@ enum MetadataCodes {
   METADATA_MACRO = 33,           // [distinct, macinfo, line, name, value]
   METADATA_MACRO_FILE = 34,      // [distinct, macinfo, line, file, ...]
   METADATA_STRINGS = 35,         // [count, offset] blob([lengths][chars])
+  METADATA_INDEX_OFFSET = 36,    // [offset]
+  METADATA_INDEX = 37,           // [bitpos]
 };
 
 // The constants block (CONSTANTS_BLOCK_ID) describes emission for each
@@ -531,6 +544,28 @@ enum ComdatSelectionKindCodes {
   COMDAT_SELECTION_KIND_SAME_SIZE = 5,
 };
 
+/// The symbol table block (SYMTAB_BLOCK_ID) is an optional top-level block
+/// emitted before the module block. It describes the global values of the
+/// module so that tools can enumerate its symbols without parsing the IR.
+enum SymtabCodes {
+  SYMTAB_CODE_VERSION = 1, // VERSION: [version#, hasmoduleasm]
+  SYMTAB_CODE_COMDAT = 2,  // COMDAT: [selection_kind, strchr x N]
+  SYMTAB_CODE_ENTRY = 3,   // ENTRY: [kind, linkage, visibility, flags,
+                           //         comdat, strchr x N]
+};
+
+enum SymtabEntryKinds {
+  SYMTAB_ENTRY_FUNCTION = 0,
+  SYMTAB_ENTRY_VARIABLE = 1,
+  SYMTAB_ENTRY_ALIAS = 2
+};
+
+enum SymtabEntryFlags {
+  SYMTAB_FLAG_UNDEFINED = 1 << 0,       // A declaration for the linker.
+  SYMTAB_FLAG_CONSTANT = 1 << 1,        // A constant global variable.
+  SYMTAB_FLAG_FORMAT_SPECIFIC = 1 << 2, // Private, or reserved for LLVM.
+};
+
 } // End bitc namespace
 } // End llvm namespace
 
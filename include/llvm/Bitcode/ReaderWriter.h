@@ -14,13 +14,16 @@
 #ifndef LLVM_BITCODE_READERWRITER_H
 #define LLVM_BITCODE_READERWRITER_H
 
+#include "llvm/IR/Comdat.h"
 #include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace llvm {
   class BitstreamWriter;
@@ -79,6 +82,42 @@ namespace llvm {
   getModuleSummaryIndex(MemoryBufferRef Buffer,
                         DiagnosticHandlerFunction DiagnosticHandler);
 
+  /// A global value described by the symbol table block of a bitcode file.
+  struct BitcodeSymbol {
+    enum SymbolKind { Function, Variable, Alias };
+
+    /// The symbol name as it will appear in the object file, i.e. after
+    /// mangling.
+    std::string Name;
+    SymbolKind Kind;
+    GlobalValue::LinkageTypes Linkage;
+    GlobalValue::VisibilityTypes Visibility;
+    /// Index into BitcodeSymbolTable::Comdats, or -1 if there is no comdat.
+    int ComdatIndex;
+    /// True if the symbol is a declaration for the linker.
+    bool IsUndefined;
+    bool IsConstant;
+    /// True if the symbol is private or otherwise not meant to be seen by the
+    /// linker (e.g. "llvm." globals).
+    bool IsFormatSpecific;
+  };
+
+  /// The contents of the symbol table block of a bitcode file.
+  struct BitcodeSymbolTable {
+    /// True if the module has module-level inline asm. Any symbols defined or
+    /// referenced by the asm are not listed in the table.
+    bool HasModuleAsm = false;
+    std::vector<std::pair<std::string, Comdat::SelectionKind>> Comdats;
+    std::vector<BitcodeSymbol> Symbols;
+  };
+
+  /// Read the symbol table block of the specified bitcode buffer without
+  /// parsing the module. Returns nullptr if the buffer has no symbol table
+  /// block (or one with a version this reader does not understand), in which
+  /// case the caller needs to fall back to reading the module.
+  ErrorOr<std::unique_ptr<BitcodeSymbolTable>>
+  readBitcodeSymbolTable(MemoryBufferRef Buffer);
+
   /// \brief Write the specified module to the specified raw output stream.
   ///
   /// For streams where it matters, the given stream should be in "binary"
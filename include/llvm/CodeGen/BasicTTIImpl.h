@@ -858,6 +858,26 @@ public:
     return ShuffleCost + ArithCost + getScalarizationOverhead(Ty, false, true);
   }
 
+  unsigned getMinMaxReductionCost(Type *Ty, Type *CondTy, bool IsPairwise) {
+    assert(Ty->isVectorTy() && "Expect a vector type");
+    unsigned NumVecElts = Ty->getVectorNumElements();
+    unsigned NumReduxLevels = Log2_32(NumVecElts);
+    unsigned CmpOpcode =
+        Ty->isFPOrFPVectorTy() ? Instruction::FCmp : Instruction::ICmp;
+    unsigned MinMaxCost =
+        NumReduxLevels *
+        (static_cast<T *>(this)->getCmpSelInstrCost(CmpOpcode, Ty, CondTy) +
+         static_cast<T *>(this)->getCmpSelInstrCost(Instruction::Select, Ty,
+                                                    CondTy));
+    // Assume the pairwise shuffles add a cost.
+    unsigned ShuffleCost =
+        NumReduxLevels * (IsPairwise + 1) *
+        static_cast<T *>(this)
+            ->getShuffleCost(TTI::SK_ExtractSubvector, Ty, NumVecElts / 2, Ty);
+    return ShuffleCost + MinMaxCost +
+           getScalarizationOverhead(Ty, false, true);
+  }
+
   /// @}
 };
 
@@ -71,18 +71,20 @@ typedef int64_t                 DFAStateInput;
 
 class DFAPacketizer {
 private:
-  typedef std::pair<unsigned, DFAInput> UnsignPair;
-
   const InstrItineraryData *InstrItins;
   int CurrentState;
   const DFAStateInput (*DFAStateInputTable)[2];
   const unsigned *DFAStateEntryTable;
 
-  // CachedTable is a map from <FromState, Input> to ToState.
-  DenseMap<UnsignPair, unsigned> CachedTable;
+  // The last transition looked up, so that reserving the resources an
+  // instruction was just checked for does not search the table again.
+  int LastState;
+  DFAInput LastInput;
+  int LastNextState;
 
-  // Read the DFA transition table and update CachedTable.
-  void ReadTable(unsigned state);
+  // Return the state the transition from State on Input leads to, or -1 if
+  // there is no such transition.
+  int getNextState(int State, DFAInput Input);
 
 public:
   DFAPacketizer(const InstrItineraryData *I, const DFAStateInput (*SIT)[2],
@@ -139,7 +141,12 @@ protected:
   // DFA resource tracker.
   DFAPacketizer *ResourceTracker;
   // Map: MI -> SU.
-  std::map<MachineInstr*, SUnit*> MIToSUnit;
+  DenseMap<MachineInstr*, SUnit*> MIToSUnit;
+
+  // Build the dependence graph for [BeginItr, EndItr) and packetize it.
+  void packetizeRegion(MachineBasicBlock *MBB,
+                       MachineBasicBlock::iterator BeginItr,
+                       MachineBasicBlock::iterator EndItr);
 
 public:
   // The AliasAnalysis parameter can be nullptr.
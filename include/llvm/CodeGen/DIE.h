@@ -504,71 +504,88 @@ public:
 
 /// A list of DIE values.
 ///
-/// This is a singly-linked list, but instead of reversing the order of
-/// insertion, we keep a pointer to the back of the list so we can push in
-/// order.
+/// The values are stored in arrays in the allocator. An array is grown in
+/// place as long as nothing else was allocated after it, so the values that
+/// are added in a row, which are most of them, are contiguous and take no
+/// more memory than the values themselves. Otherwise a new array is started.
+/// The arrays are linked in a circular list through the last one, so the list
+/// takes a single pointer in a \a DIE and values are pushed in order.
 ///
-/// There are two main reasons to choose a linked list over a customized
-/// vector-like data structure.
-///
-///  1. For teardown efficiency, we want DIEs to be BumpPtrAllocated.  Using a
-///     linked list here makes this way easier to accomplish.
-///  2. Carrying an extra pointer per \a DIEValue isn't expensive.  45% of DIEs
-///     have 2 or fewer values, and 90% have 5 or fewer.  A vector would be
-///     over-allocated by 50% on average anyway, the same cost as the
-///     linked-list node.
+/// For teardown efficiency, DIEs and their values are BumpPtrAllocated, so the
+/// arrays are never reallocated, and iterators to the values stay valid.
 class DIEValueList {
-  struct Node : IntrusiveBackListNode {
-    DIEValue V;
-    explicit Node(DIEValue V) : V(V) {}
+  struct Chunk {
+    Chunk *Next;
+    unsigned Size;
+    bool IsLast;
+
+    DIEValue *values() { return reinterpret_cast<DIEValue *>(this + 1); }
+    const DIEValue *values() const {
+      return reinterpret_cast<const DIEValue *>(this + 1);
+    }
   };
+  static_assert(sizeof(Chunk) % AlignOf<DIEValue>::Alignment == 0,
+                "Values would be misaligned");
 
-  typedef IntrusiveBackList<Node> ListTy;
-  ListTy List;
+  Chunk *Last = nullptr;
 
 public:
   class const_value_iterator;
   class value_iterator
-      : public iterator_adaptor_base<value_iterator, ListTy::iterator,
-                                     std::forward_iterator_tag, DIEValue> {
+      : public iterator_facade_base<value_iterator, std::forward_iterator_tag,
+                                    DIEValue> {
     friend class const_value_iterator;
-    typedef iterator_adaptor_base<value_iterator, ListTy::iterator,
-                                  std::forward_iterator_tag,
-                                  DIEValue> iterator_adaptor;
+    Chunk *C = nullptr;
+    unsigned I = 0;
 
   public:
     value_iterator() = default;
-    explicit value_iterator(ListTy::iterator X) : iterator_adaptor(X) {}
+    value_iterator(Chunk *C, unsigned I) : C(C), I(I) {}
 
-    explicit operator bool() const { return bool(wrapped()); }
-    DIEValue &operator*() const { return wrapped()->V; }
+    explicit operator bool() const { return C; }
+    DIEValue &operator*() const { return C->values()[I]; }
+    bool operator==(const value_iterator &RHS) const {
+      return C == RHS.C && I == RHS.I;
+    }
+    value_iterator &operator++() {
+      if (++I == C->Size) {
+        C = C->IsLast ? nullptr : C->Next;
+        I = 0;
+      }
+      return *this;
+    }
   };
 
-  class const_value_iterator : public iterator_adaptor_base<
-                                   const_value_iterator, ListTy::const_iterator,
-                                   std::forward_iterator_tag, const DIEValue> {
-    typedef iterator_adaptor_base<const_value_iterator, ListTy::const_iterator,
-                                  std::forward_iterator_tag,
-                                  const DIEValue> iterator_adaptor;
+  class const_value_iterator
+      : public iterator_facade_base<const_value_iterator,
+                                    std::forward_iterator_tag,
+                                    const DIEValue> {
+    const Chunk *C = nullptr;
+    unsigned I = 0;
 
   public:
     const_value_iterator() = default;
-    const_value_iterator(DIEValueList::value_iterator X)
-        : iterator_adaptor(X.wrapped()) {}
-    explicit const_value_iterator(ListTy::const_iterator X)
-        : iterator_adaptor(X) {}
+    const_value_iterator(DIEValueList::value_iterator X) : C(X.C), I(X.I) {}
+    const_value_iterator(const Chunk *C, unsigned I) : C(C), I(I) {}
 
-    explicit operator bool() const { return bool(wrapped()); }
-    const DIEValue &operator*() const { return wrapped()->V; }
+    explicit operator bool() const { return C; }
+    const DIEValue &operator*() const { return C->values()[I]; }
+    bool operator==(const const_value_iterator &RHS) const {
+      return C == RHS.C && I == RHS.I;
+    }
+    const_value_iterator &operator++() {
+      if (++I == C->Size) {
+        C = C->IsLast ? nullptr : C->Next;
+        I = 0;
+      }
+      return *this;
+    }
   };
 
   typedef iterator_range<value_iterator> value_range;
   typedef iterator_range<const_value_iterator> const_value_range;
 
-  value_iterator addValue(BumpPtrAllocator &Alloc, DIEValue V) {
-    List.push_back(*new (Alloc) Node(V));
-    return value_iterator(ListTy::toIterator(List.back()));
-  }
+  value_iterator addValue(BumpPtrAllocator &Alloc, DIEValue V);
   template <class T>
   value_iterator addValue(BumpPtrAllocator &Alloc, dwarf::Attribute Attribute,
                     dwarf::Form Form, T &&Value) {
@@ -576,12 +593,14 @@ public:
   }
 
   value_range values() {
-    return llvm::make_range(value_iterator(List.begin()),
-                            value_iterator(List.end()));
+    return llvm::make_range(
+        Last ? value_iterator(Last->Next, 0) : value_iterator(),
+        value_iterator());
   }
   const_value_range values() const {
-    return llvm::make_range(const_value_iterator(List.begin()),
-                            const_value_iterator(List.end()));
+    return llvm::make_range(
+        Last ? const_value_iterator(Last->Next, 0) : const_value_iterator(),
+        const_value_iterator());
   }
 };
 
@@ -534,6 +534,9 @@ protected:
   bool selectPatchpoint(const CallInst *I);
   bool selectCall(const User *Call);
   bool selectIntrinsicCall(const IntrinsicInst *II);
+  /// Select an intrinsic that maps onto a single ISD node, like llvm.bswap,
+  /// with the target's generated fastEmit_* patterns.
+  bool selectIntrinsicAsNode(const IntrinsicInst *II);
   bool selectBitCast(const User *I);
   bool selectCast(const User *I, unsigned Opcode);
   bool selectExtractValue(const User *I);
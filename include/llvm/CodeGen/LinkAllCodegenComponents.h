@@ -34,6 +34,8 @@ namespace {
       (void) llvm::createFastRegisterAllocator();
       (void) llvm::createBasicRegisterAllocator();
       (void) llvm::createGreedyRegisterAllocator();
+      (void) llvm::createBoundedGreedyRegisterAllocator();
+      (void) llvm::createLinearScanRegisterAllocator();
       (void) llvm::createDefaultPBQPRegisterAllocator();
 
       llvm::linkCoreCLRGC();
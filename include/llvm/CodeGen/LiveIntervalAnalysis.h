@@ -31,6 +31,8 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include <cmath>
+#include <memory>
+#include <vector>
 
 namespace llvm {
 
@@ -63,6 +65,11 @@ extern cl::opt<bool> UseSegmentSetForPhysRegs;
     ///
     VNInfo::Allocator VNInfoAllocator;
 
+    /// Allocators owned by the worker threads of computeVirtRegsInParallel().
+    /// They hold value numbers referenced by the intervals and are released
+    /// together with VNInfoAllocator.
+    std::vector<std::unique_ptr<VNInfo::Allocator>> ThreadVNInfoAllocators;
+
     /// Live interval pointers for all the virtual registers.
     IndexedMap<LiveInterval*, VirtReg2IndexFunctor> VirtRegIntervals;
 
@@ -245,8 +252,7 @@ extern cl::opt<bool> UseSegmentSetForPhysRegs;
 
     void InsertMachineInstrRangeInMaps(MachineBasicBlock::iterator B,
                                        MachineBasicBlock::iterator E) {
-      for (MachineBasicBlock::iterator I = B; I != E; ++I)
-        Indexes->insertMachineInstrInMaps(*I);
+      Indexes->insertMachineInstrRangeInMaps(B, E);
     }
 
     void RemoveMachineInstrFromMaps(MachineInstr &MI) {
@@ -261,6 +267,7 @@ extern cl::opt<bool> UseSegmentSetForPhysRegs;
 
     void getAnalysisUsage(AnalysisUsage &AU) const override;
     void releaseMemory() override;
+    size_t getMemoryUsage() const override;
 
     /// runOnMachineFunction - pass entry point
     bool runOnMachineFunction(MachineFunction&) override;
@@ -419,6 +426,12 @@ extern cl::opt<bool> UseSegmentSetForPhysRegs;
     /// Compute live intervals for all virtual registers.
     void computeVirtRegs();
 
+    /// Compute live intervals for all virtual registers on \p NumThreads
+    /// threads. Each thread uses its own LiveRangeCalc and VNInfo allocator;
+    /// dead values are computed serially afterwards because that may add
+    /// operands to instructions.
+    void computeVirtRegsInParallel(unsigned NumThreads);
+
     /// Compute RegMaskSlots and RegMaskBits.
     void computeRegMasks();
 
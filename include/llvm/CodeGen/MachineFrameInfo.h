@@ -14,6 +14,7 @@
 #ifndef LLVM_CODEGEN_MACHINEFRAMEINFO_H
 #define LLVM_CODEGEN_MACHINEFRAMEINFO_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/DataTypes.h"
 #include <cassert>
@@ -275,8 +276,10 @@ class MachineFrameInfo {
 
   /// Not null, if shrink-wrapping found a better place for the prologue.
   MachineBasicBlock *Save = nullptr;
-  /// Not null, if shrink-wrapping found a better place for the epilogue.
-  MachineBasicBlock *Restore = nullptr;
+  /// Not empty, if shrink-wrapping found a better place for the epilogue.
+  /// There is more than one restore point when the region following the save
+  /// point leaves the function through several return blocks.
+  SmallVector<MachineBasicBlock *, 1> Restores;
 
 public:
   explicit MachineFrameInfo(unsigned StackAlignment, bool StackRealignable,
@@ -643,8 +646,20 @@ public:
 
   MachineBasicBlock *getSavePoint() const { return Save; }
   void setSavePoint(MachineBasicBlock *NewSave) { Save = NewSave; }
-  MachineBasicBlock *getRestorePoint() const { return Restore; }
-  void setRestorePoint(MachineBasicBlock *NewRestore) { Restore = NewRestore; }
+  /// Return the restore point, or the first of them if there are several.
+  MachineBasicBlock *getRestorePoint() const {
+    return Restores.empty() ? nullptr : Restores.front();
+  }
+  void setRestorePoint(MachineBasicBlock *NewRestore) {
+    Restores.clear();
+    if (NewRestore)
+      Restores.push_back(NewRestore);
+  }
+  ArrayRef<MachineBasicBlock *> getRestorePoints() const { return Restores; }
+  void setRestorePoints(ArrayRef<MachineBasicBlock *> NewRestores) {
+    Restores.clear();
+    Restores.append(NewRestores.begin(), NewRestores.end());
+  }
 
   /// Return a set of physical registers that are pristine.
   ///
@@ -257,6 +257,10 @@ public:
   ///
   unsigned getFunctionNumber() const { return FunctionNumber; }
 
+  /// getAllocatedMemory - Return the number of bytes allocated for the
+  /// blocks, instructions and operands of this function.
+  size_t getAllocatedMemory() const { return Allocator.getTotalMemory(); }
+
   /// getTarget - Return the target machine this machine code is compiled with
   ///
   const TargetMachine &getTarget() const { return Target; }
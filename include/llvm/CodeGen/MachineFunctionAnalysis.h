@@ -47,6 +47,7 @@ private:
   bool doInitialization(Module &M) override;
   bool runOnFunction(Function &F) override;
   void releaseMemory() override;
+  size_t getMemoryUsage() const override;
   void getAnalysisUsage(AnalysisUsage &AU) const override;
 };
 
@@ -1179,6 +1179,16 @@ public:
   /// preferred.
   void addOperand(const MachineOperand &Op);
 
+  /// Make room for at least NumOps operands, so that adding them one at a
+  /// time doesn't reallocate the operand array and move the use-def chains of
+  /// the existing operands. The MCInstrDesc already sizes the array for
+  /// fixed-arity instructions; this is for variadic ones like PHIs whose final
+  /// operand count is known when they are created.
+  ///
+  /// MF must be the machine function that was used to allocate this
+  /// instruction.
+  void reserveOperands(MachineFunction &MF, unsigned NumOps);
+
   /// Replace the instruction descriptor (thus opcode) of
   /// the current instruction with a new one.
   void setDesc(const MCInstrDesc &tid) { MCID = &tid; }
@@ -45,6 +45,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Dwarf.h"
+#include <memory>
 
 namespace llvm {
 
@@ -60,6 +61,7 @@ class MachineFunction;
 class Module;
 class PointerType;
 class StructType;
+class TargetMachine;
 
 struct SEHHandler {
   // Filter or finally function. Null indicates a catch-all.
@@ -186,6 +188,23 @@ class MachineModuleInfo : public ImmutablePass {
 
   EHPersonality PersonalityTypeCache;
 
+  /// RetainMachineFunctions - True if the machine functions outlive the pass
+  /// manager run over their IR function.  Module-level machine passes, like
+  /// the machine outliner, need every machine function of the module at once.
+  bool RetainMachineFunctions;
+
+  /// MachineFunctions - The machine functions kept alive while
+  /// RetainMachineFunctions is set, keyed by their IR function.
+  DenseMap<const Function *, std::unique_ptr<MachineFunction>> MachineFunctions;
+
+  /// NextFnNum - The number given to the next retained machine function.
+  unsigned NextFnNum;
+
+  /// FunctionState - The per-function information above, set aside while
+  /// other functions are being compiled.
+  struct FunctionState;
+  DenseMap<const Function *, std::unique_ptr<FunctionState>> SavedStates;
+
 public:
   static char ID; // Pass identification, replacement for typeid
 
@@ -216,6 +235,33 @@ public:
   ///
   void EndFunction();
 
+  /// setRetainMachineFunctions - Keep the machine functions alive until the
+  /// end of the module, instead of freeing each one once the function passes
+  /// are done with it.  Must be set before code generation starts.
+  void setRetainMachineFunctions(bool Retain) {
+    RetainMachineFunctions = Retain;
+  }
+  bool retainsMachineFunctions() const { return RetainMachineFunctions; }
+
+  /// getMachineFunction - Return the retained machine function for \p F, or
+  /// null if there is none.
+  MachineFunction *getMachineFunction(const Function &F) const;
+
+  /// createMachineFunction - Create a machine function for \p F and retain it
+  /// until the end of the module.
+  MachineFunction &createMachineFunction(const Function &F,
+                                         const TargetMachine &TM);
+
+  /// saveFunctionState - Set the frame and exception information of the
+  /// current function aside, so that the next function starts afresh.  Used
+  /// when the pass manager leaves a retained machine function that it will
+  /// come back to later.
+  void saveFunctionState(const Function &F);
+
+  /// restoreFunctionState - Make the information saved for \p F current
+  /// again.
+  void restoreFunctionState(const Function &F);
+
   const MCContext &getContext() const { return Context; }
   MCContext &getContext() { return Context; }
 
@@ -662,6 +662,10 @@ public:
   /// \pre Size > 0.
   unsigned createGenericVirtualRegister(unsigned Size);
 
+  /// Remove the size of all generic virtual registers. This is done once
+  /// instruction selection has given all of them a register class.
+  void clearVirtRegSizes();
+
   /// getNumVirtRegs - Return the number of virtual registers created.
   ///
   unsigned getNumVirtRegs() const { return VRegInfo.size(); }
@@ -907,9 +907,9 @@ public:
 protected:
   void checkAcyclicLatency();
 
-  void initCandidate(SchedCandidate &Cand, SUnit *SU, bool AtTop,
-                     const RegPressureTracker &RPTracker,
-                     RegPressureTracker &TempTracker);
+  virtual void initCandidate(SchedCandidate &Cand, SUnit *SU, bool AtTop,
+                             const RegPressureTracker &RPTracker,
+                             RegPressureTracker &TempTracker);
 
   void tryCandidate(SchedCandidate &Cand,
                     SchedCandidate &TryCand,
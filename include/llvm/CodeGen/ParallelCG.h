@@ -14,6 +14,7 @@
 #ifndef LLVM_CODEGEN_PARALLELCG_H
 #define LLVM_CODEGEN_PARALLELCG_H
 
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Target/TargetMachine.h"
 
@@ -30,18 +31,27 @@ class raw_pwrite_stream;
 /// factory function for the TargetMachine TMFactory. Writes OSs.size() output
 /// files to the output streams in OSs. The resulting output files if linked
 /// together are intended to be equivalent to the single output file that would
-/// have been code generated from M.
+/// have been code generated from M. The partitions are balanced by estimated
+/// code generation cost, so that the threads get a similar amount of work.
 ///
 /// Writes bitcode for individual partitions into output streams in BCOSs, if
 /// BCOSs is not empty.
 ///
+/// If CacheDir is not empty, the output of each partition is cached in that
+/// directory, keyed by a hash of the bitcode of the partition and of the
+/// configuration of the target machine, and code generation is skipped for
+/// the partitions that are in the cache already. The definitions are then
+/// assigned to the partitions by a hash of their name instead of being
+/// balanced by cost, so that changing a function only invalidates its own
+/// partition. Command line options are not part of the key.
+///
 /// \returns M if OSs.size() == 1, otherwise returns std::unique_ptr<Module>().
 std::unique_ptr<Module>
 splitCodeGen(std::unique_ptr<Module> M, ArrayRef<raw_pwrite_stream *> OSs,
              ArrayRef<llvm::raw_pwrite_stream *> BCOSs,
              const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
              TargetMachine::CodeGenFileType FT = TargetMachine::CGFT_ObjectFile,
-             bool PreserveLocals = false);
+             bool PreserveLocals = false, StringRef CacheDir = StringRef());
 
 } // namespace llvm
 
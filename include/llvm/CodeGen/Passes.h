@@ -144,6 +144,19 @@ namespace llvm {
   ///
   FunctionPass *createGreedyRegisterAllocator();
 
+  /// Greedy register allocation with per-function budgets on evictions and
+  /// global split candidates, for functions where the greedy allocator
+  /// takes too long. Selected with -regalloc=greedy-bounded.
+  ///
+  FunctionPass *createBoundedGreedyRegisterAllocator();
+
+  /// LinearScanRegisterAllocation Pass - This pass assigns live ranges in the
+  /// order of their start points and evicts or spills instead of splitting.
+  /// It is cheaper than the greedy allocator while producing better code than
+  /// the fast allocator. Selected with -regalloc=linearscan.
+  ///
+  FunctionPass *createLinearScanRegisterAllocator();
+
   /// PBQPRegisterAllocation Pass - This pass implements the Partitioned Boolean
   /// Quadratic Prograaming (PBQP) based register allocator.
   ///
@@ -323,6 +336,10 @@ namespace llvm {
   /// LiveDebugValues pass
   extern char &LiveDebugValuesID;
 
+  /// FixupStatepointCallerSaved - This pass spills the statepoint arguments
+  /// which were allocated to registers the call clobbers.
+  extern char &FixupStatepointCallerSavedID;
+
   /// createJumpInstrTables - This pass creates jump-instruction tables.
   ModulePass *createJumpInstrTablesPass();
 
@@ -356,6 +373,12 @@ namespace llvm {
   /// This pass splits the stack into a safe stack and an unsafe stack to
   /// protect against stack-based overflow vulnerabilities.
   FunctionPass *createSafeStackPass(const TargetMachine *TM = nullptr);
+
+  /// MachineOutliner - This pass finds sequences of machine instructions that
+  /// repeat across the module and replaces them with calls to a single
+  /// outlined copy.  It needs the machine functions of the whole module, see
+  /// MachineModuleInfo::setRetainMachineFunctions.
+  ModulePass *createMachineOutlinerPass();
 } // End llvm namespace
 
 /// Target machine pass initializer for passes with dependencies. Use with
@@ -359,6 +359,10 @@ namespace llvm {
     /// and MBB id.
     SmallVector<IdxMBBPair, 8> idx2MBBMap;
 
+    /// Number of entries renumbered locally since the last global
+    /// renumbering. See renumberIndexes(IndexList::iterator).
+    unsigned LocalRenumberWork;
+
     IndexListEntry* createEntry(MachineInstr *mi, unsigned index) {
       IndexListEntry *entry =
         static_cast<IndexListEntry*>(
@@ -376,7 +380,7 @@ namespace llvm {
   public:
     static char ID;
 
-    SlotIndexes() : MachineFunctionPass(ID) {
+    SlotIndexes() : MachineFunctionPass(ID), LocalRenumberWork(0) {
       initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
     }
 
@@ -387,6 +391,7 @@ namespace llvm {
 
     void getAnalysisUsage(AnalysisUsage &au) const override;
     void releaseMemory() override;
+    size_t getMemoryUsage() const override;
 
     bool runOnMachineFunction(MachineFunction &fn) override;
 
@@ -617,6 +622,14 @@ namespace llvm {
       return newIndex;
     }
 
+    /// Insert the machine instructions in [Begin, End), which must belong to
+    /// the same block and not have indexes yet, into the mapping. DBG_VALUE
+    /// instructions are skipped. The gap after the preceding instruction is
+    /// split evenly between them, so the whole batch causes at most one
+    /// renumbering instead of one every few instructions.
+    void insertMachineInstrRangeInMaps(MachineBasicBlock::iterator Begin,
+                                       MachineBasicBlock::iterator End);
+
     /// Remove the given machine instruction from the mapping.
     void removeMachineInstrFromMaps(MachineInstr &MI) {
       // remove index -> MachineInstr and
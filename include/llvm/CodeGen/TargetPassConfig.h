@@ -99,6 +99,7 @@ private:
   bool Started;
   bool Stopped;
   bool AddingMachinePasses;
+  bool RetainMachineFunctions;
 
 protected:
   TargetMachine *TM;
@@ -192,6 +193,10 @@ public:
   /// has not be overriden on the command line with '-regalloc=...'
   bool usingDefaultRegAlloc() const;
 
+  /// Return true if a module-level machine pass was added, so the machine
+  /// functions must outlive the function passes run over them.
+  bool retainsMachineFunctions() const { return RetainMachineFunctions; }
+
   /// Add common target configurable passes that perform LLVM IR to IR
   /// transforms following machine independent optimization.
   virtual void addIRPasses();
@@ -226,6 +231,16 @@ public:
   /// class or register banks.
   virtual bool addRegBankSelect() { return true; }
 
+  /// This method may be implemented by targets that want to run passes
+  /// immediately before the (global) instruction selection.
+  virtual void addPreGlobalInstructionSelect() {}
+
+  /// This method should install a (global) instruction selector pass, which
+  /// converts possibly generic instructions to fully target-specific
+  /// instructions, thereby constraining all generic virtual registers to
+  /// register classes.
+  virtual bool addGlobalInstructionSelect() { return true; }
+
   /// Add the complete, standard set of LLVM CodeGen passes.
   /// Fully developed targets will not generally override this.
   virtual void addMachinePasses();
@@ -90,6 +90,9 @@
 /* Define to 1 if you have the `futimens' function */
 #cmakedefine HAVE_FUTIMENS ${HAVE_FUTIMENS}
 
+/* Define to 1 if you have the `fstatat' function. */
+#cmakedefine HAVE_FSTATAT ${HAVE_FSTATAT}
+
 /* Define to 1 if you have the `getcwd' function. */
 #cmakedefine HAVE_GETCWD ${HAVE_GETCWD}
 
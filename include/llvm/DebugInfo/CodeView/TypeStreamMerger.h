@@ -20,6 +20,12 @@ namespace codeview {
 /// Merges one type stream into another. Returns true on success.
 bool mergeTypeStreams(TypeTableBuilder &DestStream, const CVTypeArray &Types);
 
+/// Merges several type streams into one, in order. The records of the streams
+/// are hashed and deduplicated in parallel, and the result is the same as
+/// merging the streams one at a time. Returns true on success.
+bool mergeTypeStreams(TypeTableBuilder &DestStream,
+                      ArrayRef<CVTypeArray> Streams);
+
 } // end namespace codeview
 } // end namespace llvm
 
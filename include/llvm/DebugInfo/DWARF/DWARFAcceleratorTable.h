@@ -47,6 +47,10 @@ public:
 
   bool extract();
   void dump(raw_ostream &OS) const;
+
+  /// Append to \p Offsets the offsets of the DIEs that the table lists for
+  /// \p Name. The table must have been successfully extracted.
+  void findDIEOffsets(StringRef Name, SmallVectorImpl<uint32_t> &Offsets) const;
 };
 
 }
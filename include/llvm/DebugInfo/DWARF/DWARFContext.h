@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/DebugInfo/DIContext.h"
 #include "llvm/DebugInfo/DWARF/DWARFCompileUnit.h"
 #include "llvm/DebugInfo/DWARF/DWARFDebugAranges.h"
@@ -50,6 +51,11 @@ class DWARFContext : public DIContext {
   std::unique_ptr<DWARFDebugFrame> EHFrame;
   std::unique_ptr<DWARFDebugMacro> Macro;
 
+  /// The names of the DIEs of the compile units, as pairs of compile unit
+  /// index and DIE index. Only built if there are no accelerator tables.
+  typedef StringMap<std::vector<std::pair<uint32_t, uint32_t>>> NameIndexMap;
+  std::unique_ptr<NameIndexMap> NameIndex;
+
   DWARFUnitSection<DWARFCompileUnit> DWOCUs;
   std::deque<DWARFUnitSection<DWARFTypeUnit>> DWOTUs;
   std::unique_ptr<DWARFDebugAbbrev> AbbrevDWO;
@@ -74,6 +80,9 @@ class DWARFContext : public DIContext {
   /// and store them in DWOTUs.
   void parseDWOTypeUnits();
 
+  /// Build NameIndex (if necessary) on \p NumThreads threads.
+  void buildNameIndex(unsigned NumThreads);
+
 public:
   DWARFContext() : DIContext(CK_DWARF) {}
 
@@ -148,6 +157,24 @@ public:
     return DWOCUs[index].get();
   }
 
+  /// Extract the DIEs of all the compile and type units, on \p NumThreads
+  /// threads (0 means one per hardware thread). DIEs are otherwise extracted
+  /// lazily, one unit at a time; this is meant for clients that are going to
+  /// walk all of the debug info.
+  void extractAllDIEs(unsigned NumThreads = 0);
+
+  /// A DIE and the compile unit it belongs to.
+  typedef std::pair<DWARFCompileUnit *, const DWARFDebugInfoEntryMinimal *>
+      UnitDIEPair;
+
+  /// Find the DIEs of the compile units that have the name (or linkage name)
+  /// \p Name. The .apple_names and .apple_types accelerator tables are used
+  /// if present. Otherwise, an index of the names of all the DIEs is built on
+  /// the first lookup, on \p NumThreads threads (0 means one per hardware
+  /// thread), and kept for the next ones.
+  std::vector<UnitDIEPair> findDIEsByName(StringRef Name,
+                                          unsigned NumThreads = 0);
+
   const DWARFUnitIndex &getCUIndex();
   const DWARFUnitIndex &getTUIndex();
 
@@ -39,8 +39,12 @@ private:
 
   uint32_t StreamLength;
   std::vector<uint32_t> BlockList;
+  /// The number of blocks, starting at each block of the stream, that are
+  /// contiguous in the file.
+  std::vector<uint32_t> ContiguousBlocks;
   mutable llvm::BumpPtrAllocator Pool;
-  mutable DenseMap<uint32_t, uint8_t *> CacheMap;
+  /// The copies of the reads that cross discontiguous blocks, by offset.
+  mutable DenseMap<uint32_t, ArrayRef<uint8_t>> CacheMap;
   const PDBFile &Pdb;
 };
 
@@ -21,6 +21,7 @@ enum class raw_error_code {
   feature_unsupported,
   corrupt_file,
   insufficient_buffer,
+  index_out_of_bounds,
 };
 
 /// Base class for errors originating when parsing raw PDB files
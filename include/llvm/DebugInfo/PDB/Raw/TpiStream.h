@@ -12,6 +12,7 @@
 
 #include "llvm/DebugInfo/CodeView/StreamArray.h"
 #include "llvm/DebugInfo/CodeView/StreamRef.h"
+#include "llvm/DebugInfo/CodeView/TypeIndex.h"
 #include "llvm/DebugInfo/CodeView/TypeRecord.h"
 #include "llvm/DebugInfo/PDB/PDBTypes.h"
 #include "llvm/DebugInfo/PDB/Raw/MappedBlockStream.h"
@@ -43,12 +44,19 @@ public:
 
   iterator_range<codeview::CVTypeArray::Iterator> types(bool *HadError) const;
 
+  /// Return the record of the type index \p TI in constant time. The first
+  /// lookup builds an index of the offsets of the records.
+  Expected<codeview::CVType> getTypeRecord(codeview::TypeIndex TI) const;
+
 private:
   PDBFile &Pdb;
   MappedBlockStream Stream;
   HashFunctionType HashFunction;
 
+  codeview::StreamRef TypeRecordsBuffer;
   codeview::CVTypeArray TypeRecords;
+  /// The offsets in TypeRecordsBuffer of the records, by type index.
+  mutable std::vector<uint32_t> TypeRecordOffsets;
   codeview::StreamRef TypeIndexOffsetBuffer;
   codeview::StreamRef HashValuesBuffer;
   codeview::StreamRef HashAdjBuffer;
@@ -16,8 +16,10 @@
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorOr.h"
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -36,14 +38,25 @@ public:
     bool RelativeAddresses : 1;
     std::string DefaultArch;
     std::vector<std::string> DsymHints;
+    /// Directory in which to cache address indexes of the modules, keyed by
+    /// their build ID. Symbolizing from an index requires no debug info
+    /// parsing. Caching is disabled if empty.
+    std::string IndexCacheDir;
+    /// Maximum number of modules to keep loaded. When more are needed, the
+    /// least recently used module is released along with the binaries it was
+    /// created from. Zero means no limit.
+    unsigned MaxCachedModules;
     Options(FunctionNameKind PrintFunctions = FunctionNameKind::LinkageName,
             bool UseSymbolTable = true, bool Demangle = true,
             bool RelativeAddresses = false, std::string DefaultArch = "")
         : PrintFunctions(PrintFunctions), UseSymbolTable(UseSymbolTable),
           Demangle(Demangle), RelativeAddresses(RelativeAddresses),
-          DefaultArch(std::move(DefaultArch)) {}
+          DefaultArch(std::move(DefaultArch)), MaxCachedModules(0) {}
   };
 
+  // The symbolize* methods may be called concurrently from several threads.
+  // Queries on the same module are serialized.
+
   LLVMSymbolizer(const Options &Opts = Options()) : Opts(Opts) {}
   ~LLVMSymbolizer() {
     flush();
@@ -64,38 +77,69 @@ private:
   // corresponding debug info. These objects can be the same.
   typedef std::pair<ObjectFile*, ObjectFile*> ObjectPair;
 
-  ErrorOr<SymbolizableModule *>
-  getOrCreateModuleInfo(const std::string &ModuleName);
-  ObjectFile *lookUpDsymFile(const std::string &Path,
+  /// \brief The binaries and object files that a module was created from.
+  struct ObjectCache {
+    /// \brief Contains cached results of getOrCreateObjectPair().
+    std::map<std::pair<std::string, std::string>, ErrorOr<ObjectPair>>
+        ObjectPairForPathArch;
+
+    /// \brief Contains parsed binary for each path, or parsing error.
+    std::map<std::string, ErrorOr<OwningBinary<Binary>>> BinaryForPath;
+
+    /// \brief Parsed object file for path/architecture pair, where "path"
+    /// refers to Mach-O universal binary.
+    std::map<std::pair<std::string, std::string>,
+             ErrorOr<std::unique_ptr<ObjectFile>>>
+        ObjectForUBPathAndArch;
+  };
+
+  /// \brief A module cache entry. The entry owns the objects the module was
+  /// created from, so that they are freed when the module is evicted.
+  struct CachedModule {
+    /// Serializes the creation of the module and the queries on it.
+    std::mutex Mutex;
+    bool Created = false;
+    ObjectCache Objects;
+    std::error_code EC;
+    std::unique_ptr<SymbolizableModule> Module;
+    /// Position of the entry in the LRU list.
+    std::list<std::string>::iterator LRUPos;
+  };
+
+  /// \brief Returns the cache entry for \p ModuleName, creating the module if
+  /// needed. The entry is returned with its mutex held by \p EntryLock.
+  std::shared_ptr<CachedModule>
+  getOrCreateModuleInfo(const std::string &ModuleName,
+                        std::unique_lock<std::mutex> &EntryLock);
+  void createModuleInfo(const std::string &ModuleName, CachedModule &Entry);
+  ObjectFile *lookUpDsymFile(ObjectCache &Cache, const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
-  ObjectFile *lookUpDebuglinkObject(const std::string &Path,
+  ObjectFile *lookUpDebuglinkObject(ObjectCache &Cache, const std::string &Path,
                                     const ObjectFile *Obj,
                                     const std::string &ArchName);
 
   /// \brief Returns pair of pointers to object and debug object.
-  ErrorOr<ObjectPair> getOrCreateObjectPair(const std::string &Path,
+  ErrorOr<ObjectPair> getOrCreateObjectPair(ObjectCache &Cache,
+                                            const std::string &Path,
                                             const std::string &ArchName);
 
   /// \brief Return a pointer to object file at specified path, for a specified
   /// architecture (e.g. if path refers to a Mach-O universal binary, only one
   /// object file from it will be returned).
-  ErrorOr<ObjectFile *> getOrCreateObject(const std::string &Path,
+  ErrorOr<ObjectFile *> getOrCreateObject(ObjectCache &Cache,
+                                          const std::string &Path,
                                           const std::string &ArchName);
 
-  std::map<std::string, ErrorOr<std::unique_ptr<SymbolizableModule>>> Modules;
-
-  /// \brief Contains cached results of getOrCreateObjectPair().
-  std::map<std::pair<std::string, std::string>, ErrorOr<ObjectPair>>
-      ObjectPairForPathArch;
-
-  /// \brief Contains parsed binary for each path, or parsing error.
-  std::map<std::string, ErrorOr<OwningBinary<Binary>>> BinaryForPath;
+  /// \brief Returns the path of the index cache file for \p Obj, or an empty
+  /// string if there can't be one.
+  std::string getIndexCachePath(const ObjectFile *Obj) const;
 
-  /// \brief Parsed object file for path/architecture pair, where "path" refers
-  /// to Mach-O universal binary.
-  std::map<std::pair<std::string, std::string>, ErrorOr<std::unique_ptr<ObjectFile>>>
-      ObjectForUBPathAndArch;
+  /// Guards Modules and ModuleLRU.
+  std::mutex CacheMutex;
+  std::map<std::string, std::shared_ptr<CachedModule>> Modules;
+  /// Names of the cached modules, most recently used first.
+  std::list<std::string> ModuleLRU;
 
   Options Opts;
 };
@@ -0,0 +1,72 @@
+//===- FileObjectCache.h - On-disk object cache for JITs --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares an ObjectCache that keeps the objects in a directory,
+// keyed by the contents of the module and the target configuration.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/CachePruning.h"
+#include <mutex>
+#include <string>
+
+namespace llvm {
+
+class TargetMachine;
+
+/// An ObjectCache that stores objects in a directory that can be shared by
+/// several processes.
+///
+/// An entry is keyed by a hash of the module's bitcode and of the target
+/// triple, CPU, feature string and optimization level of the TargetMachine
+/// the cache was created for. Entries are written to a temporary file that is
+/// renamed into place, so readers never need a lock and never see a partial
+/// object, and they are memory-mapped when they are read. After an object has
+/// been stored, the directory is pruned with the policy set on
+/// getPruningPolicy().
+///
+/// The cache can be used with ExecutionEngine::setObjectCache for MCJIT and
+/// with orc::IRCompileLayer::setObjectCache.
+class FileObjectCache : public ObjectCache {
+public:
+  FileObjectCache(StringRef CacheDir, const TargetMachine &TM);
+  ~FileObjectCache() override;
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Return the pruning policy applied after an object has been stored. By
+  /// default the directory is scanned at most every 20 minutes, and is capped
+  /// to 75% of the available disk space.
+  CachePruning &getPruningPolicy() { return Pruning; }
+
+  /// Return the path of the entry for \p M.
+  std::string getEntryPath(const Module &M);
+
+private:
+  std::string computeKey(const Module &M);
+
+  std::string CacheDir;
+  std::string TargetKey;
+  CachePruning Pruning;
+
+  // Keys computed by getObject, so that notifyObjectCompiled does not have to
+  // hash the module again.
+  std::mutex KeysMutex;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_FILEOBJECTCACHE_H
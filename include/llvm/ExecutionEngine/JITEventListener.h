@@ -81,6 +81,11 @@ public:
   // Get a pointe to the GDB debugger registration listener.
   static JITEventListener *createGDBRegistrationListener();
 
+  // Construct a listener that describes the emitted functions to Linux's
+  // perf, through /tmp/perf-<pid>.map and a jitdump file with line
+  // information. Returns null on other systems.
+  static JITEventListener *createPerfJITEventListener();
+
 #if defined(LLVM_USE_INTEL_JITEVENTS) && LLVM_USE_INTEL_JITEVENTS
   // Construct an IntelJITEventListener
   static JITEventListener *createIntelJITEventListener();
@@ -19,10 +19,16 @@
 #include "LambdaResolver.h"
 #include "LogicalDylib.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <condition_variable>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <utility>
 
@@ -36,6 +42,14 @@ namespace orc {
 /// added to the layer below. When a stub is called it triggers the extraction
 /// of the function body from the original module. The extracted body is then
 /// compiled and executed.
+///
+///   Stubs may be hit from several threads. Each function is compiled at most
+/// once: a thread that calls a function whose partition is being compiled on
+/// another thread waits for that compile to finish. With
+/// enableSpeculativeCompilation, the functions directly called by a freshly
+/// compiled partition are compiled ahead of time on a ThreadPool, and their
+/// stubs are retargeted as soon as they are ready. Compiles are still run one
+/// at a time, since all partitions of a module share its LLVMContext.
 template <typename BaseLayerT,
           typename CompileCallbackMgrT = JITCompileCallbackManager,
           typename IndirectStubsMgrT = IndirectStubsManager>
@@ -178,6 +192,19 @@ public:
         CreateIndirectStubsManager(std::move(CreateIndirectStubsManager)),
         CloneStubsIntoPartitions(CloneStubsIntoPartitions) {}
 
+  ~CompileOnDemandLayer() { waitForSpeculativeCompiles(); }
+
+  /// @brief Compile the callees of each compiled partition ahead of time.
+  ///
+  ///   After a partition has been compiled, the functions it calls directly
+  /// that have not been compiled yet are queued on \p Pool. Their callees are
+  /// queued in turn, up to \p Depth calls away from the function that was
+  /// called through its stub. The pool must outlive this layer.
+  void enableSpeculativeCompilation(ThreadPool &Pool, unsigned Depth = 1) {
+    SpeculationPool = &Pool;
+    SpeculationDepth = Depth;
+  }
+
   /// @brief Add a module to the compile-on-demand layer.
   template <typename ModuleSetT, typename MemoryManagerPtrT,
             typename SymbolResolverPtrT>
@@ -214,6 +241,8 @@ public:
   ///   This will remove all modules in the layers below that were derived from
   /// the module represented by H.
   void removeModuleSet(ModuleSetHandleT H) {
+    waitForSpeculativeCompiles();
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
     LogicalDylibs.erase(H);
   }
 
@@ -222,6 +251,7 @@ public:
   /// @param ExportedSymbolsOnly If true, search only for exported symbols.
   /// @return A handle for the given named symbol, if it exists.
   JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
     for (auto LDI = LogicalDylibs.begin(), LDE = LogicalDylibs.end();
          LDI != LDE; ++LDI)
       if (auto Symbol = findSymbolIn(LDI, Name, ExportedSymbolsOnly))
@@ -233,6 +263,7 @@ public:
   ///        below this one.
   JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
                          bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
     return H->findSymbol(Name, ExportedSymbolsOnly);
   }
 
@@ -386,18 +417,54 @@ private:
 
   TargetAddress extractAndCompile(CODLogicalDylib &LD,
                                   LogicalModuleHandle LMH,
-                                  Function &F) {
+                                  Function &F, unsigned Depth = 0) {
+    // If another thread is compiling (or has compiled) F, use its result.
+    std::promise<TargetAddress> FResult;
+    {
+      std::unique_lock<std::mutex> Lock(CompiledMutex);
+      auto I = CompiledFunctions.find(&F);
+      if (I != CompiledFunctions.end()) {
+        std::shared_future<TargetAddress> Result = I->second;
+        Lock.unlock();
+        return Result.get();
+      }
+      CompiledFunctions[&F] = FResult.get_future().share();
+    }
+
+    std::lock_guard<std::recursive_mutex> Lock(CompileMutex);
     auto &LMResources = LD.getLogicalModuleResources(LMH);
     Module &SrcM = LMResources.SourceModule->getResource();
 
-    // If F is a declaration we must already have compiled it.
-    if (F.isDeclaration())
-      return 0;
+    // Claim the rest of F's partition. Functions that another thread already
+    // claimed are left to it.
+    std::map<Function *, std::promise<TargetAddress>> Results;
+    Results[&F] = std::move(FResult);
+    {
+      std::lock_guard<std::mutex> Lock(CompiledMutex);
+      for (auto *SubF : Partition(F))
+        if (SubF != &F && !CompiledFunctions.count(SubF))
+          CompiledFunctions[SubF] = Results[SubF].get_future().share();
+    }
 
-    // Grab the name of the function being called here.
-    std::string CalledFnName = mangle(F.getName(), SrcM.getDataLayout());
+    std::set<Function *> Part;
+    for (auto &KV : Results)
+      Part.insert(KV.first);
+
+    // Pick the speculation candidates before the bodies are moved out of the
+    // source module.
+    std::set<Function *> Callees;
+    if (SpeculationPool && Depth < SpeculationDepth)
+      for (auto *SubF : Part)
+        for (auto &I : instructions(*SubF)) {
+          CallSite CS(&I);
+          if (!CS)
+            continue;
+          auto *Callee = CS.getCalledFunction();
+          if (Callee && !Callee->isDeclaration() && !Part.count(Callee) &&
+              Callee->getParent() == &SrcM)
+            Callees.insert(Callee);
+        }
 
-    auto Part = Partition(F);
     auto PartH = emitPartition(LD, LMH, Part);
 
     TargetAddress CalledAddr = 0;
@@ -408,19 +475,53 @@ private:
 
       TargetAddress FnBodyAddr = FnBodySym.getAddress();
 
+      // Update the function body pointer for the stub. Once this is done no
+      // new call goes through the compile callback any more.
+      if (auto EC = LMResources.StubsMgr->updatePointer(FnName, FnBodyAddr)) {
+        consumeError(std::move(EC));
+        FnBodyAddr = 0;
+      }
+
       // If this is the function we're calling record the address so we can
       // return it from this function.
       if (SubF == &F)
         CalledAddr = FnBodyAddr;
 
-      // Update the function body pointer for the stub.
-      if (auto EC = LMResources.StubsMgr->updatePointer(FnName, FnBodyAddr))
-        return 0;
+      Results[SubF].set_value(FnBodyAddr);
     }
 
+    for (auto *Callee : Callees)
+      speculate(LD, LMH, *Callee, Depth + 1);
+
     return CalledAddr;
   }
 
+  void speculate(CODLogicalDylib &LD, LogicalModuleHandle LMH, Function &F,
+                 unsigned Depth) {
+    {
+      std::lock_guard<std::mutex> Lock(CompiledMutex);
+      if (CompiledFunctions.count(&F))
+        return;
+      ++PendingSpeculations;
+    }
+    SpeculationPool->async([this, &LD, LMH, &F, Depth]() {
+      this->extractAndCompile(LD, LMH, F, Depth);
+      std::lock_guard<std::mutex> Lock(CompiledMutex);
+      if (--PendingSpeculations == 0)
+        SpeculationsDone.notify_all();
+    });
+  }
+
+  void waitForSpeculativeCompiles() {
+#if !LLVM_ENABLE_THREADS
+    // Without threads the queued compiles only run when the pool is waited on.
+    if (SpeculationPool)
+      SpeculationPool->wait();
+#endif
+    std::unique_lock<std::mutex> Lock(CompiledMutex);
+    SpeculationsDone.wait(Lock, [this]() { return PendingSpeculations == 0; });
+  }
+
   template <typename PartitionT>
   BaseLayerModuleSetHandleT emitPartition(CODLogicalDylib &LD,
                                           LogicalModuleHandle LMH,
@@ -509,6 +610,22 @@ private:
 
   LogicalDylibList LogicalDylibs;
   bool CloneStubsIntoPartitions;
+
+  // Held while extracting and compiling partitions and while looking up
+  // symbols. It is recursive because symbol resolution during a compile may
+  // call back into findSymbol.
+  std::recursive_mutex CompileMutex;
+
+  // The address of every function that has been compiled or is being
+  // compiled, and the number of queued speculative compiles.
+  std::mutex CompiledMutex;
+  std::map<const Function *, std::shared_future<TargetAddress>>
+    CompiledFunctions;
+  unsigned PendingSpeculations = 0;
+  std::condition_variable SpeculationsDone;
+
+  ThreadPool *SpeculationPool = nullptr;
+  unsigned SpeculationDepth = 0;
 };
 
 } // End namespace orc.
@@ -22,11 +22,18 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
+#include <future>
+#include <mutex>
 
 namespace llvm {
 namespace orc {
 
 /// @brief Target-independent base class for compile callback management.
+///
+///   Callbacks may be executed from several threads at once. If a thread hits
+/// a trampoline whose compile action is already running on another thread, it
+/// waits for that action to finish and returns its result rather than running
+/// the action a second time.
 class JITCompileCallbackManager {
 public:
   typedef std::function<TargetAddress()> CompileFtor;
@@ -60,25 +67,43 @@ public:
   /// @brief Execute the callback for the given trampoline id. Called by the JIT
   ///        to compile functions on demand.
   TargetAddress executeCompileCallback(TargetAddress TrampolineAddr) {
+    std::unique_lock<std::mutex> Lock(CallbacksMutex);
     auto I = ActiveTrampolines.find(TrampolineAddr);
-    // FIXME: Also raise an error in the Orc error-handler when we finally have
-    //        one.
-    if (I == ActiveTrampolines.end())
+    if (I == ActiveTrampolines.end()) {
+      // Another thread may be running the compile action for this trampoline.
+      // Wait for its result instead of compiling twice.
+      auto R = RunningTrampolines.find(TrampolineAddr);
+      // FIXME: Also raise an error in the Orc error-handler when we finally
+      //        have one.
+      if (R == RunningTrampolines.end())
+        return ErrorHandlerAddress;
+      std::shared_future<TargetAddress> Result = R->second;
+      Lock.unlock();
+      if (auto Addr = Result.get())
+        return Addr;
       return ErrorHandlerAddress;
+    }
 
-    // Found a callback handler. Yank this trampoline out of the active list and
-    // put it back in the available trampolines list, then try to run the
-    // handler's compile and update actions.
-    // Moving the trampoline ID back to the available list first means there's
-    // at
-    // least one available trampoline if the compile action triggers a request
-    // for
-    // a new one.
+    // Found a callback handler. Yank this trampoline out of the active list,
+    // publish a result that concurrent callers can wait on, then run the
+    // handler's compile action without holding the lock so that it can
+    // request new callbacks.
     auto Compile = std::move(I->second);
     ActiveTrampolines.erase(I);
+    std::promise<TargetAddress> Result;
+    RunningTrampolines[TrampolineAddr] = Result.get_future().share();
+    Lock.unlock();
+
+    TargetAddress Addr = Compile();
+    Result.set_value(Addr);
+
+    // Only recycle the trampoline once no other thread can be waiting on it.
+    Lock.lock();
+    RunningTrampolines.erase(TrampolineAddr);
     AvailableTrampolines.push_back(TrampolineAddr);
+    Lock.unlock();
 
-    if (auto Addr = Compile())
+    if (Addr)
       return Addr;
 
     return ErrorHandlerAddress;
@@ -86,6 +111,7 @@ public:
 
   /// @brief Reserve a compile callback.
   CompileCallbackInfo getCompileCallback() {
+    std::lock_guard<std::mutex> Lock(CallbacksMutex);
     TargetAddress TrampolineAddr = getAvailableTrampolineAddr();
     auto &Compile = this->ActiveTrampolines[TrampolineAddr];
     return CompileCallbackInfo(TrampolineAddr, Compile);
@@ -93,6 +119,7 @@ public:
 
   /// @brief Get a CompileCallbackInfo for an existing callback.
   CompileCallbackInfo getCompileCallbackInfo(TargetAddress TrampolineAddr) {
+    std::lock_guard<std::mutex> Lock(CallbacksMutex);
     auto I = ActiveTrampolines.find(TrampolineAddr);
     assert(I != ActiveTrampolines.end() && "Not an active trampoline.");
     return CompileCallbackInfo(I->first, I->second);
@@ -104,6 +131,7 @@ public:
   /// only be called to manually release a callback that is not going to
   /// execute.
   void releaseCompileCallback(TargetAddress TrampolineAddr) {
+    std::lock_guard<std::mutex> Lock(CallbacksMutex);
     auto I = ActiveTrampolines.find(TrampolineAddr);
     assert(I != ActiveTrampolines.end() && "Not an active trampoline.");
     ActiveTrampolines.erase(I);
@@ -118,6 +146,14 @@ protected:
   std::vector<TargetAddress> AvailableTrampolines;
 
 private:
+  // Guards the trampoline lists. grow() is called with it held.
+  std::mutex CallbacksMutex;
+
+  // Results of the compile actions that are currently running, for callers
+  // that hit the same trampoline while the action is in progress.
+  std::map<TargetAddress, std::shared_future<TargetAddress>>
+    RunningTrampolines;
+
   TargetAddress getAvailableTrampolineAddr() {
     if (this->AvailableTrampolines.empty())
       grow();
@@ -0,0 +1,362 @@
+//===- LazyBitcodeLayer.h - Materialize bitcode on first lookup -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// JIT layer that takes bitcode buffers and only parses and emits each global
+// value when its symbol is first looked up.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_LAZYBITCODELAYER_H
+#define LLVM_EXECUTIONENGINE_ORC_LAZYBITCODELAYER_H
+
+#include "IndirectionUtils.h"
+#include "JITSymbol.h"
+#include "LambdaResolver.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace llvm {
+namespace orc {
+
+/// @brief Lazy bitcode layer.
+///
+///   Bitcode buffers added to this layer are not parsed up front. The symbols
+/// a buffer defines are read from its symbol table block or, failing that,
+/// from its module summary, so that the module is only read (with
+/// getLazyBitcodeModule) once one of its symbols is looked up. Buffers with
+/// neither are read lazily when they are added.
+///
+///   When a symbol is looked up, the body of the function (or the initializer
+/// of the variable) it names is parsed and moved into a module of its own,
+/// which is added to the base layer. The base layer typically compiles it
+/// right away. References to other global values of the same buffer are
+/// resolved through this layer, so they are emitted when the referring code
+/// is linked. Functions that are never reached are never parsed.
+///
+///   Aliases resolve to their aliasee, and aliases with an offset are not
+/// supported. Static constructors and destructors are not run.
+template <typename BaseLayerT> class LazyBitcodeLayer {
+private:
+  typedef typename BaseLayerT::ModuleSetHandleT BaseLayerHandleT;
+
+  typedef std::function<BaseLayerHandleT(
+      BaseLayerT &, std::unique_ptr<Module>,
+      std::unique_ptr<RuntimeDyld::SymbolResolver>)>
+      ModuleAdderFtor;
+
+  struct BitcodeSet {
+    // The buffer until the module has been read, after which the module owns
+    // it.
+    std::unique_ptr<MemoryBuffer> Buffer;
+
+    // The definitions of the buffer, as mangled names from its symbol table
+    // block or as GUIDs of unmangled names from its summary.
+    bool HasSymtab = false;
+    StringSet<> SymtabDefs;
+    bool HasSummary = false;
+    DenseSet<GlobalValue::GUID> SummaryDefs;
+
+    // The lazily read module and its definitions by mangled name.
+    std::unique_ptr<Module> M;
+    StringMap<GlobalValue *> Defs;
+
+    // The base layer module each emitted definition was added in.
+    StringMap<BaseLayerHandleT> Emitted;
+    std::vector<BaseLayerHandleT> BaseHandles;
+
+    std::unique_ptr<RuntimeDyld::SymbolResolver> Resolver;
+    ModuleAdderFtor ModuleAdder;
+  };
+
+  typedef std::list<BitcodeSet> BitcodeSetList;
+
+  // Creates declarations in the emitted module for the global values that
+  // the moved body refers to.
+  class DeclMaterializer final : public ValueMaterializer {
+  public:
+    DeclMaterializer(Module &M) : M(M) {}
+
+    Value *materialize(Value *V) final {
+      // Declarations of linkonce and weak definitions must be external.
+      if (auto *GV = dyn_cast<GlobalVariable>(V)) {
+        GlobalVariable *Decl = cloneGlobalVariableDecl(M, *GV);
+        Decl->setLinkage(GlobalValue::ExternalLinkage);
+        return Decl;
+      }
+
+      if (auto *F = dyn_cast<Function>(V)) {
+        Function *Decl = cloneFunctionDecl(M, *F);
+        Decl->setLinkage(GlobalValue::ExternalLinkage);
+        return Decl;
+      }
+
+      if (auto *A = dyn_cast<GlobalAlias>(V)) {
+        auto *Ty = A->getValueType();
+        if (Ty->isFunctionTy())
+          return Function::Create(cast<FunctionType>(Ty),
+                                  GlobalValue::ExternalLinkage, A->getName(),
+                                  &M);
+
+        return new GlobalVariable(M, Ty, false, GlobalValue::ExternalLinkage,
+                                  nullptr, A->getName(), nullptr,
+                                  GlobalValue::NotThreadLocal,
+                                  A->getType()->getAddressSpace());
+      }
+
+      return nullptr;
+    }
+
+  private:
+    Module &M;
+  };
+
+public:
+  /// @brief Handle to a bitcode buffer added to this layer.
+  typedef typename BitcodeSetList::iterator BitcodeSetHandleT;
+
+  /// @brief Construct a lazy bitcode layer. Modules are read into
+  ///        \p Context.
+  LazyBitcodeLayer(BaseLayerT &BaseLayer, LLVMContext &Context)
+      : BaseLayer(BaseLayer), Context(Context) {}
+
+  /// @brief Add a bitcode buffer to this layer.
+  ///
+  ///   Nothing is emitted to the base layer until a symbol of the buffer is
+  /// looked up. If the module has to be read after this call and turns out to
+  /// be malformed, the error is fatal.
+  ///
+  /// @return A handle for the buffer, or the error that occurred while
+  ///         reading the module.
+  template <typename MemoryManagerPtrT, typename SymbolResolverPtrT>
+  ErrorOr<BitcodeSetHandleT> addBitcode(std::unique_ptr<MemoryBuffer> Buffer,
+                                        MemoryManagerPtrT MemMgr,
+                                        SymbolResolverPtrT Resolver) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    BitcodeSets.emplace_back();
+    auto H = std::prev(BitcodeSets.end());
+    BitcodeSet &S = *H;
+
+    // The memory manager is shared by every module emitted for this buffer.
+    auto MemMgrOwner = std::make_shared<MemoryManagerPtrT>(std::move(MemMgr));
+    S.ModuleAdder =
+      [MemMgrOwner](BaseLayerT &B, std::unique_ptr<Module> M,
+                    std::unique_ptr<RuntimeDyld::SymbolResolver> R) {
+        std::vector<std::unique_ptr<Module>> Ms;
+        Ms.push_back(std::move(M));
+        return B.addModuleSet(std::move(Ms), &**MemMgrOwner, std::move(R));
+      };
+    S.Resolver = std::move(Resolver);
+
+    MemoryBufferRef BufferRef = Buffer->getMemBufferRef();
+    S.Buffer = std::move(Buffer);
+
+    auto SymtabOrErr = readBitcodeSymbolTable(BufferRef);
+    if (SymtabOrErr && *SymtabOrErr && !(*SymtabOrErr)->HasModuleAsm) {
+      S.HasSymtab = true;
+      for (const auto &Sym : (*SymtabOrErr)->Symbols)
+        if (!Sym.IsUndefined && !Sym.IsFormatSpecific)
+          S.SymtabDefs.insert(Sym.Name);
+      return H;
+    }
+
+    auto IgnoreDiagnostics = [](const DiagnosticInfo &) {};
+    if (hasGlobalValueSummary(BufferRef, IgnoreDiagnostics)) {
+      auto IndexOrErr = getModuleSummaryIndex(BufferRef, IgnoreDiagnostics);
+      if (IndexOrErr) {
+        S.HasSummary = true;
+        for (const auto &KV : **IndexOrErr)
+          S.SummaryDefs.insert(KV.first);
+        return H;
+      }
+    }
+
+    if (std::error_code EC = readModule(S)) {
+      BitcodeSets.erase(H);
+      return EC;
+    }
+    return H;
+  }
+
+  /// @brief Remove the buffer represented by the given handle, and the
+  ///        modules that were emitted for it from the base layer.
+  void removeBitcode(BitcodeSetHandleT H) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    for (auto &BaseH : H->BaseHandles)
+      BaseLayer.removeModuleSet(BaseH);
+    BitcodeSets.erase(H);
+  }
+
+  /// @brief Search for the given named symbol, emitting its definition if a
+  ///        buffer of this layer has one.
+  /// @param Name The name of the symbol to search for.
+  /// @param ExportedSymbolsOnly If true, search only for exported symbols.
+  /// @return A handle for the given named symbol, if it exists.
+  JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    for (auto H = BitcodeSets.begin(), E = BitcodeSets.end(); H != E; ++H)
+      if (auto Sym = findSymbolIn(H, Name, ExportedSymbolsOnly))
+        return Sym;
+    return BaseLayer.findSymbol(Name, ExportedSymbolsOnly);
+  }
+
+  /// @brief Get the address of a symbol defined by the buffer represented by
+  ///        the given handle, emitting its definition if needed.
+  JITSymbol findSymbolIn(BitcodeSetHandleT H, StringRef Name,
+                         bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    BitcodeSet &S = *H;
+
+    auto I = S.Emitted.find(Name);
+    if (I != S.Emitted.end())
+      return BaseLayer.findSymbolIn(I->second, Name, ExportedSymbolsOnly);
+
+    if (!S.M) {
+      if (!mayDefine(S, Name))
+        return nullptr;
+      if (std::error_code EC = readModule(S))
+        report_fatal_error("Could not read bitcode lazily: " + EC.message());
+    }
+
+    auto DI = S.Defs.find(Name);
+    if (DI == S.Defs.end())
+      return nullptr;
+    GlobalValue &GV = *DI->second;
+    if (ExportedSymbolsOnly &&
+        (GV.hasLocalLinkage() || GV.hasHiddenVisibility()))
+      return nullptr;
+
+    // An alias is emitted as its aliasee.
+    if (auto *A = dyn_cast<GlobalAlias>(&GV)) {
+      GlobalObject *Base = A->getBaseObject();
+      if (!Base || A->getAliasee()->stripPointerCasts() != Base)
+        return nullptr;
+      return findSymbolIn(H, mangle(Base->getName(), S.M->getDataLayout()),
+                          false);
+    }
+
+    BaseLayerHandleT BaseH = emit(H, GV);
+    S.Emitted[Name] = BaseH;
+    return BaseLayer.findSymbolIn(BaseH, Name, ExportedSymbolsOnly);
+  }
+
+private:
+  static std::string mangle(StringRef Name, const DataLayout &DL) {
+    std::string MangledName;
+    {
+      raw_string_ostream MangledNameStream(MangledName);
+      Mangler::getNameWithPrefix(MangledNameStream, Name, DL);
+    }
+    return MangledName;
+  }
+
+  // Check whether S may define Name before its module has been read.
+  static bool mayDefine(const BitcodeSet &S, StringRef Name) {
+    if (S.HasSymtab)
+      return S.SymtabDefs.count(Name);
+    if (S.HasSummary) {
+      // The summary does not know about mangling, and the data layout is only
+      // known once the module has been read. Try Name both with and without
+      // a global prefix.
+      if (S.SummaryDefs.count(GlobalValue::getGUID(Name)))
+        return true;
+      return !Name.empty() &&
+             S.SummaryDefs.count(GlobalValue::getGUID(Name.drop_front()));
+    }
+    return false;
+  }
+
+  std::error_code readModule(BitcodeSet &S) {
+    auto MOrErr = getLazyBitcodeModule(std::move(S.Buffer), Context);
+    if (!MOrErr)
+      return MOrErr.getError();
+    S.M = std::move(*MOrErr);
+
+    // The definitions are split up into modules of their own, so local ones
+    // have to be visible to the others.
+    makeAllSymbolsExternallyAccessible(*S.M);
+
+    const DataLayout &DL = S.M->getDataLayout();
+    auto AddDef = [&](GlobalValue &GV) {
+      if (!GV.isDeclaration() && !GV.getName().startswith("llvm."))
+        S.Defs[mangle(GV.getName(), DL)] = &GV;
+    };
+    for (auto &F : *S.M)
+      AddDef(F);
+    for (auto &GV : S.M->globals())
+      AddDef(GV);
+    for (auto &A : S.M->aliases())
+      S.Defs[mangle(A.getName(), DL)] = &A;
+
+    // Only the module knows about definitions now.
+    S.SymtabDefs.clear();
+    S.SummaryDefs.clear();
+    return std::error_code();
+  }
+
+  BaseLayerHandleT emit(BitcodeSetHandleT H, GlobalValue &GV) {
+    BitcodeSet &S = *H;
+    Module &SrcM = *S.M;
+
+    auto M = llvm::make_unique<Module>(
+        (SrcM.getName() + "." + GV.getName()).str(), SrcM.getContext());
+    M->setDataLayout(SrcM.getDataLayout());
+
+    ValueToValueMapTy VMap;
+    DeclMaterializer Materializer(*M);
+    if (auto *F = dyn_cast<Function>(&GV)) {
+      if (std::error_code EC = F->materialize())
+        report_fatal_error("Could not read the body of '" + F->getName() +
+                           "': " + EC.message());
+      cloneFunctionDecl(*M, *F, &VMap);
+      moveFunctionBody(*F, VMap, &Materializer);
+    } else {
+      auto &Var = cast<GlobalVariable>(GV);
+      cloneGlobalVariableDecl(*M, Var, &VMap);
+      moveGlobalVariableInitializer(Var, VMap, &Materializer);
+    }
+
+    // References to the rest of the buffer are emitted on demand.
+    auto Resolver = createLambdaResolver(
+        [this, H](const std::string &Name) {
+          if (auto Sym = this->findSymbolIn(H, Name, false))
+            return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+          return H->Resolver->findSymbolInLogicalDylib(Name);
+        },
+        [H](const std::string &Name) {
+          return H->Resolver->findSymbol(Name);
+        });
+
+    BaseLayerHandleT BaseH =
+        S.ModuleAdder(BaseLayer, std::move(M), std::move(Resolver));
+    S.BaseHandles.push_back(BaseH);
+    return BaseH;
+  }
+
+  BaseLayerT &BaseLayer;
+  LLVMContext &Context;
+  std::recursive_mutex LayerMutex;
+  BitcodeSetList BitcodeSets;
+};
+
+} // End namespace orc.
+} // End namespace llvm.
+
+#endif // LLVM_EXECUTIONENGINE_ORC_LAZYBITCODELAYER_H
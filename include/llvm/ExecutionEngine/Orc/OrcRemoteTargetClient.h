@@ -118,50 +118,55 @@ public:
                                 uintptr_t RWDataSize,
                                 uint32_t RWDataAlign) override {
       Unmapped.push_back(ObjectAllocs());
-
-      DEBUG(dbgs() << "Allocator " << Id << " reserved:\n");
-
-      if (CodeSize != 0) {
-        if (auto AddrOrErr = Client.reserveMem(Id, CodeSize, CodeAlign))
-          Unmapped.back().RemoteCodeAddr = *AddrOrErr;
-        else {
+      ObjectAllocs &ObjAllocs = Unmapped.back();
+
+      // Reserve all three segments in a single round-trip.
+      TargetAddress *Addrs[] = {&ObjAllocs.RemoteCodeAddr,
+                                &ObjAllocs.RemoteRODataAddr,
+                                &ObjAllocs.RemoteRWDataAddr};
+      uint64_t Sizes[] = {CodeSize, RODataSize, RWDataSize};
+      uint32_t Aligns[] = {CodeAlign, RODataAlign, RWDataAlign};
+      AsyncCallResult<ReserveMem> Results[3];
+      for (unsigned I = 0; I != 3; ++I) {
+        if (Sizes[I] == 0)
+          continue;
+        auto ResultOrErr =
+            Client.template appendBatchedCall<ReserveMem>(Id, Sizes[I],
+                                                          Aligns[I]);
+        if (!ResultOrErr) {
           // FIXME; Add error to poll.
-          assert(!AddrOrErr.takeError() && "Failed reserving remote memory.");
+          consumeError(ResultOrErr.takeError());
+          llvm_unreachable("Failed reserving remote memory.");
         }
-
-        DEBUG(dbgs() << "  code: "
-                     << format("0x%016x", Unmapped.back().RemoteCodeAddr)
-                     << " (" << CodeSize << " bytes, alignment " << CodeAlign
-                     << ")\n");
+        Results[I] = std::move(*ResultOrErr);
       }
 
-      if (RODataSize != 0) {
-        if (auto AddrOrErr = Client.reserveMem(Id, RODataSize, RODataAlign))
-          Unmapped.back().RemoteRODataAddr = *AddrOrErr;
-        else {
-          // FIXME; Add error to poll.
-          assert(!AddrOrErr.takeError() && "Failed reserving remote memory.");
-        }
-
-        DEBUG(dbgs() << "  ro-data: "
-                     << format("0x%016x", Unmapped.back().RemoteRODataAddr)
-                     << " (" << RODataSize << " bytes, alignment "
-                     << RODataAlign << ")\n");
+      if (auto Err = Client.flushBatch()) {
+        // FIXME; Add error to poll.
+        consumeError(std::move(Err));
+        llvm_unreachable("Failed reserving remote memory.");
       }
 
-      if (RWDataSize != 0) {
-        if (auto AddrOrErr = Client.reserveMem(Id, RWDataSize, RWDataAlign))
-          Unmapped.back().RemoteRWDataAddr = *AddrOrErr;
-        else {
-          // FIXME; Add error to poll.
-          assert(!AddrOrErr.takeError() && "Failed reserving remote memory.");
-        }
-
-        DEBUG(dbgs() << "  rw-data: "
-                     << format("0x%016x", Unmapped.back().RemoteRWDataAddr)
-                     << " (" << RWDataSize << " bytes, alignment "
-                     << RWDataAlign << ")\n");
+      for (unsigned I = 0; I != 3; ++I) {
+        if (!Results[I].valid())
+          continue;
+        auto Addr = Results[I].get();
+        assert(Addr && "Failed reserving remote memory.");
+        *Addrs[I] = *Addr;
       }
+
+      DEBUG(dbgs() << "Allocator " << Id << " reserved:\n"
+                   << "  code: " << format("0x%016x", ObjAllocs.RemoteCodeAddr)
+                   << " (" << CodeSize << " bytes, alignment " << CodeAlign
+                   << ")\n"
+                   << "  ro-data: "
+                   << format("0x%016x", ObjAllocs.RemoteRODataAddr) << " ("
+                   << RODataSize << " bytes, alignment " << RODataAlign
+                   << ")\n"
+                   << "  rw-data: "
+                   << format("0x%016x", ObjAllocs.RemoteRWDataAddr) << " ("
+                   << RWDataSize << " bytes, alignment " << RWDataAlign
+                   << ")\n");
     }
 
     bool needsToReserveAllocationSpace() override { return true; }
@@ -230,133 +235,82 @@ public:
     bool finalizeMemory(std::string *ErrMsg = nullptr) override {
       DEBUG(dbgs() << "Allocator " << Id << " finalizing:\n");
 
-      for (auto &ObjAllocs : Unfinalized) {
-
-        for (auto &Alloc : ObjAllocs.CodeAllocs) {
-          DEBUG(dbgs() << "  copying code: "
-                       << static_cast<void *>(Alloc.getLocalAddress()) << " -> "
-                       << format("0x%016x", Alloc.getRemoteAddress()) << " ("
-                       << Alloc.getSize() << " bytes)\n");
-          if (auto Err =
-                  Client.writeMem(Alloc.getRemoteAddress(),
-                                  Alloc.getLocalAddress(), Alloc.getSize())) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return true;
-          }
-        }
+      // Queue the copies, permission changes and EH frame registrations for
+      // all objects, then send them as one batch and wait for the results
+      // together, rather than paying a round-trip for each of them.
+      std::vector<std::future<bool>> Results;
+      auto Append = [&](Expected<std::future<bool>> ResultOrErr) -> Error {
+        if (!ResultOrErr)
+          return ResultOrErr.takeError();
+        Results.push_back(std::move(*ResultOrErr));
+        return Error::success();
+      };
 
-        if (ObjAllocs.RemoteCodeAddr) {
-          DEBUG(dbgs() << "  setting R-X permissions on code block: "
-                       << format("0x%016x", ObjAllocs.RemoteCodeAddr) << "\n");
-          if (auto Err = Client.setProtections(Id, ObjAllocs.RemoteCodeAddr,
-                                               sys::Memory::MF_READ |
-                                                   sys::Memory::MF_EXEC)) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return true;
-          }
+      auto AppendSegment = [&](std::vector<Alloc> &Allocs,
+                               TargetAddress SegAddr, unsigned ProtFlags,
+                               const char *Kind) -> Error {
+        for (auto &Alloc : Allocs) {
+          DEBUG(dbgs() << "  copying " << Kind << ": "
+                       << static_cast<void *>(Alloc.getLocalAddress())
+                       << " -> " << format("0x%016x", Alloc.getRemoteAddress())
+                       << " (" << Alloc.getSize() << " bytes)\n");
+          if (auto Err = Append(Client.writeMemAsync(Alloc.getRemoteAddress(),
+                                                     Alloc.getLocalAddress(),
+                                                     Alloc.getSize())))
+            return Err;
         }
 
-        for (auto &Alloc : ObjAllocs.RODataAllocs) {
-          DEBUG(dbgs() << "  copying ro-data: "
-                       << static_cast<void *>(Alloc.getLocalAddress()) << " -> "
-                       << format("0x%016x", Alloc.getRemoteAddress()) << " ("
-                       << Alloc.getSize() << " bytes)\n");
-          if (auto Err =
-                  Client.writeMem(Alloc.getRemoteAddress(),
-                                  Alloc.getLocalAddress(), Alloc.getSize())) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return true;
-          }
-        }
+        if (!SegAddr)
+          return Error::success();
+        DEBUG(dbgs() << "  setting permissions on " << Kind << " block: "
+                     << format("0x%016x", SegAddr) << "\n");
+        return Append(
+            Client.template appendBatchedCall<SetProtections>(Id, SegAddr,
+                                                              ProtFlags));
+      };
 
-        if (ObjAllocs.RemoteRODataAddr) {
-          DEBUG(dbgs() << "  setting R-- permissions on ro-data block: "
-                       << format("0x%016x", ObjAllocs.RemoteRODataAddr)
-                       << "\n");
-          if (auto Err = Client.setProtections(Id, ObjAllocs.RemoteRODataAddr,
-                                               sys::Memory::MF_READ)) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return false;
-          }
+      auto AppendAll = [&]() -> Error {
+        for (auto &ObjAllocs : Unfinalized) {
+          if (auto Err = AppendSegment(
+                  ObjAllocs.CodeAllocs, ObjAllocs.RemoteCodeAddr,
+                  sys::Memory::MF_READ | sys::Memory::MF_EXEC, "code"))
+            return Err;
+          if (auto Err = AppendSegment(ObjAllocs.RODataAllocs,
+                                       ObjAllocs.RemoteRODataAddr,
+                                       sys::Memory::MF_READ, "ro-data"))
+            return Err;
+          if (auto Err = AppendSegment(
+                  ObjAllocs.RWDataAllocs, ObjAllocs.RemoteRWDataAddr,
+                  sys::Memory::MF_READ | sys::Memory::MF_WRITE, "rw-data"))
+            return Err;
         }
-
-        for (auto &Alloc : ObjAllocs.RWDataAllocs) {
-          DEBUG(dbgs() << "  copying rw-data: "
-                       << static_cast<void *>(Alloc.getLocalAddress()) << " -> "
-                       << format("0x%016x", Alloc.getRemoteAddress()) << " ("
-                       << Alloc.getSize() << " bytes)\n");
+        for (auto &EHFrame : UnfinalizedEHFrames)
           if (auto Err =
-                  Client.writeMem(Alloc.getRemoteAddress(),
-                                  Alloc.getLocalAddress(), Alloc.getSize())) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return false;
-          }
-        }
+                  Append(Client.template appendBatchedCall<RegisterEHFrames>(
+                      EHFrame.first, EHFrame.second)))
+            return Err;
+        return Error::success();
+      };
 
-        if (ObjAllocs.RemoteRWDataAddr) {
-          DEBUG(dbgs() << "  setting RW- permissions on rw-data block: "
-                       << format("0x%016x", ObjAllocs.RemoteRWDataAddr)
-                       << "\n");
-          if (auto Err = Client.setProtections(Id, ObjAllocs.RemoteRWDataAddr,
-                                               sys::Memory::MF_READ |
-                                                   sys::Memory::MF_WRITE)) {
-            // FIXME: Replace this once finalizeMemory can return an Error.
-            handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-              if (ErrMsg) {
-                raw_string_ostream ErrOut(*ErrMsg);
-                EIB.log(ErrOut);
-              }
-            });
-            return false;
+      Error Err = AppendAll();
+      if (!Err)
+        Err = Client.flushBatch();
+      if (!Err)
+        Err = checkResults(Results);
+
+      if (Err) {
+        // FIXME: Replace this once finalizeMemory can return an Error.
+        handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
+          if (ErrMsg) {
+            raw_string_ostream ErrOut(*ErrMsg);
+            EIB.log(ErrOut);
           }
-        }
+        });
+        return true;
       }
-      Unfinalized.clear();
 
-      for (auto &EHFrame : UnfinalizedEHFrames) {
-        if (auto Err = Client.registerEHFrames(EHFrame.first, EHFrame.second)) {
-          // FIXME: Replace this once finalizeMemory can return an Error.
-          handleAllErrors(std::move(Err), [&](ErrorInfoBase &EIB) {
-            if (ErrMsg) {
-              raw_string_ostream ErrOut(*ErrMsg);
-              EIB.log(ErrOut);
-            }
-          });
-          return false;
-        }
-      }
+      Unfinalized.clear();
       UnfinalizedEHFrames.clear();
-
       return false;
     }
 
@@ -462,12 +416,22 @@ public:
       if (auto Err = reserveStubs(StubInits.size()))
         return Err;
 
-      for (auto &Entry : StubInits)
-        if (auto Err = createStubInternal(Entry.first(), Entry.second.first,
-                                          Entry.second.second))
-          return Err;
+      // Initialize all of the stub pointers in a single round-trip.
+      std::vector<std::future<bool>> Results;
+      for (auto &Entry : StubInits) {
+        auto Key = FreeStubs.back();
+        FreeStubs.pop_back();
+        StubIndexes[Entry.first()] = std::make_pair(Key, Entry.second.second);
+        auto ResultOrErr = Remote.template appendBatchedCall<WritePtr>(
+            getPtrAddr(Key), Entry.second.first);
+        if (!ResultOrErr)
+          return ResultOrErr.takeError();
+        Results.push_back(std::move(*ResultOrErr));
+      }
 
-      return Error::success();
+      if (auto Err = Remote.flushBatch())
+        return Err;
+      return checkResults(Results);
     }
 
     JITSymbol findStub(StringRef Name, bool ExportedStubsOnly) override {
@@ -804,6 +768,51 @@ private:
     return callST<WritePtr>(Channel, Addr, PtrVal);
   }
 
+  Expected<std::future<bool>> writeMemAsync(TargetAddress Addr,
+                                            const char *Src, uint64_t Size) {
+    // Check for an 'out-of-band' error, e.g. from an MM destructor.
+    if (ExistingError)
+      return std::move(ExistingError);
+
+    return appendBatchedCall<WriteMem>(DirectBufferWriter(Src, Addr, Size));
+  }
+
+  /// Serialize a call to Func to the channel without sending it. The call is
+  /// sent, together with any others appended since, by the next flushBatch
+  /// (or by the next synchronous call), and its result is available once that
+  /// returns. The server handles calls in order, so a batch behaves like the
+  /// equivalent sequence of synchronous calls, but costs one round-trip.
+  template <typename Func, typename... ArgTs>
+  Expected<AsyncCallResult<Func>> appendBatchedCall(const ArgTs &... Args) {
+    auto ResultAndSeqNoOrErr = appendCallAsyncWithSeq<Func>(Channel, Args...);
+    if (!ResultAndSeqNoOrErr)
+      return ResultAndSeqNoOrErr.takeError();
+    LastBatchSeqNo = ResultAndSeqNoOrErr->second;
+    HasPendingBatch = true;
+    return std::move(ResultAndSeqNoOrErr->first);
+  }
+
+  /// Send the calls appended by appendBatchedCall and wait for the results of
+  /// all of them.
+  Error flushBatch() {
+    if (!HasPendingBatch)
+      return Error::success();
+    HasPendingBatch = false;
+    if (auto Err = Channel.send())
+      return Err;
+    // Responses arrive in order, so once the last call of the batch is
+    // answered all the others are too.
+    return waitForResult(Channel, LastBatchSeqNo, handleNone);
+  }
+
+  /// Check the results of void calls made by a batch that has been flushed.
+  static Error checkResults(std::vector<std::future<bool>> &Results) {
+    for (auto &Result : Results)
+      if (!Result.get())
+        return orcError(OrcErrorCode::UnexpectedRPCResponse);
+    return Error::success();
+  }
+
   static Error doNothing() { return Error::success(); }
 
   ChannelT &Channel;
@@ -815,6 +824,8 @@ private:
   uint32_t RemoteIndirectStubSize = 0;
   ResourceIdMgr AllocatorIds, IndirectStubOwnerIds;
   Optional<RCCompileCallbackManager> CallbackManager;
+  SequenceNumberType LastBatchSeqNo = 0;
+  bool HasPendingBatch = false;
 };
 
 } // end namespace remote
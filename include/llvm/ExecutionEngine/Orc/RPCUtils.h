@@ -133,6 +133,8 @@ protected:
         return Err;
       if (auto Err = serializeSeq(C, ResponseId, SeqNo, *Result))
         return Err;
+      if (auto Err = C.send())
+        return Err;
       return endSendMessage(C);
     }
   };
@@ -180,6 +182,8 @@ protected:
         return Err;
       if (auto Err = serializeSeq(C, ResponseId, SeqNo))
         return Err;
+      if (auto Err = C.send())
+        return Err;
       return endSendMessage(C);
     }
   };
@@ -387,6 +391,9 @@ public:
   using AsyncCallWithSeqResult =
       std::pair<std::future<typename Func::OptionalReturn>, SequenceNumberT>;
 
+  /// The type of the sequence numbers that match responses to calls.
+  typedef SequenceNumberT SequenceNumberType;
+
   /// Serialize Args... to channel C, but do not call C.send().
   ///
   /// Returns an error (on serialization failure) or a pair of:
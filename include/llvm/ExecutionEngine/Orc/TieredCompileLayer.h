@@ -0,0 +1,429 @@
+//===- TieredCompileLayer.h - Recompile hot functions -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// JIT layer that emits modules through a cheap first tier, counts calls to
+// each function, and recompiles the hot ones through a second tier.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+#define LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+
+#include "IndirectionUtils.h"
+#include "LambdaResolver.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace llvm {
+namespace orc {
+
+/// @brief Tiered compilation layer.
+///
+///   When a module is added to this layer, every function definition is given
+/// an indirect stub and a call counter, and the module is added to the first
+/// tier layer. The first tier is typically a LazyEmittingLayer over an
+/// IRCompileLayer whose TargetMachine runs at CodeGenOpt::None, so that it
+/// selects instructions with FastISel. When a function has been called
+/// HotThreshold times, its original body is compiled on its own through the
+/// second tier layer (e.g. an IRTransformLayer running the -O2 pipeline over
+/// an optimizing IRCompileLayer) and its stub is pointed at the new body.
+///
+///   Recompilation runs on the given ThreadPool if there is one, and on the
+/// thread that made the call that crossed the threshold otherwise. The
+/// counters call back into this process, so the layer only supports
+/// in-process JITs. Added modules must be unique_ptrs.
+template <typename Tier0LayerT, typename Tier1LayerT,
+          typename IndirectStubsMgrT = IndirectStubsManager>
+class TieredCompileLayer {
+private:
+  typedef typename Tier0LayerT::ModuleSetHandleT Tier0HandleT;
+  typedef typename Tier1LayerT::ModuleSetHandleT Tier1HandleT;
+
+  struct ModuleSetInfo;
+
+  struct FunctionInfo {
+    TieredCompileLayer *Layer;
+    ModuleSetInfo *Set;
+    // The unoptimized body in the copy of the source module.
+    Function *Src;
+    Tier0HandleT Tier0Handle;
+    std::string Name;
+  };
+
+  struct ModuleSetInfo {
+    std::shared_ptr<void> MemMgrOwner;
+    RuntimeDyld::MemoryManager *MemMgr = nullptr;
+    std::shared_ptr<void> ResolverOwner;
+    RuntimeDyld::SymbolResolver *Resolver = nullptr;
+    std::unique_ptr<IndirectStubsMgrT> StubsMgr;
+    // Copies of the added modules, taken before they were instrumented.
+    std::vector<std::unique_ptr<Module>> Sources;
+    std::vector<Tier0HandleT> Tier0Handles;
+    std::vector<Tier1HandleT> Tier1Handles;
+    std::list<FunctionInfo> Functions;
+    bool Tier0Emitted = false;
+  };
+
+  typedef std::list<ModuleSetInfo> ModuleSetListT;
+
+public:
+  /// @brief Handle to a set of loaded modules.
+  typedef typename ModuleSetListT::iterator ModuleSetHandleT;
+
+  /// @brief Builder for IndirectStubsManagers.
+  typedef std::function<std::unique_ptr<IndirectStubsMgrT>()>
+    IndirectStubsManagerBuilderT;
+
+  /// @brief Construct a tiered compile layer.
+  /// @param HotThreshold Number of calls after which a function is recompiled
+  ///                     by the second tier. Zero disables recompilation.
+  /// @param Pool If non-null, recompile on this pool. It must outlive the
+  ///             layer.
+  TieredCompileLayer(Tier0LayerT &Tier0, Tier1LayerT &Tier1,
+                     IndirectStubsManagerBuilderT CreateIndirectStubsManager,
+                     uint64_t HotThreshold, ThreadPool *Pool = nullptr)
+      : Tier0(Tier0), Tier1(Tier1),
+        CreateIndirectStubsManager(std::move(CreateIndirectStubsManager)),
+        HotThreshold(HotThreshold), Pool(Pool) {}
+
+  ~TieredCompileLayer() { waitForRecompiles(); }
+
+  /// @brief Add a module set to the tiered compile layer.
+  template <typename ModuleSetT, typename MemoryManagerPtrT,
+            typename SymbolResolverPtrT>
+  ModuleSetHandleT addModuleSet(ModuleSetT Ms, MemoryManagerPtrT MemMgr,
+                                SymbolResolverPtrT Resolver) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    ModuleSets.push_back(ModuleSetInfo());
+    ModuleSetInfo &Info = ModuleSets.back();
+
+    auto MemMgrOwner = std::make_shared<MemoryManagerPtrT>(std::move(MemMgr));
+    Info.MemMgr = &**MemMgrOwner;
+    Info.MemMgrOwner = std::move(MemMgrOwner);
+    auto ResolverOwner =
+      std::make_shared<SymbolResolverPtrT>(std::move(Resolver));
+    Info.Resolver = &**ResolverOwner;
+    Info.ResolverOwner = std::move(ResolverOwner);
+
+    typename IndirectStubsMgrT::StubInitsMap StubInits;
+    for (auto &M : Ms)
+      addTier0Module(Info, std::move(M), StubInits);
+
+    // The stubs are pointed at the first tier bodies when the first tier is
+    // emitted, see emitTier0.
+    Info.StubsMgr = CreateIndirectStubsManager();
+    auto EC = Info.StubsMgr->createStubs(StubInits);
+    (void)EC;
+    // FIXME: This should be propagated back to the user.
+    assert(!EC && "Error generating stubs");
+
+    return std::prev(ModuleSets.end());
+  }
+
+  /// @brief Remove the module set represented by the given handle, and the
+  ///        recompiled functions derived from it.
+  void removeModuleSet(ModuleSetHandleT H) {
+    waitForRecompiles();
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    for (auto &H1 : H->Tier1Handles)
+      Tier1.removeModuleSet(H1);
+    for (auto &H0 : H->Tier0Handles)
+      Tier0.removeModuleSet(H0);
+    ModuleSets.erase(H);
+  }
+
+  /// @brief Search for the given named symbol.
+  /// @param Name The name of the symbol to search for.
+  /// @param ExportedSymbolsOnly If true, search only for exported symbols.
+  /// @return A handle for the given named symbol, if it exists.
+  JITSymbol findSymbol(StringRef Name, bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    for (auto I = ModuleSets.begin(), E = ModuleSets.end(); I != E; ++I)
+      if (auto Sym = findSymbolIn(I, Name, ExportedSymbolsOnly))
+        return Sym;
+    return nullptr;
+  }
+
+  /// @brief Get the address of a symbol provided by this layer.
+  ///
+  ///   Functions are always found through their stubs, so that callers pick up
+  /// the recompiled body. Materializing any symbol of the set emits its first
+  /// tier, since data may refer to the stubs too.
+  JITSymbol findSymbolIn(ModuleSetHandleT H, StringRef Name,
+                         bool ExportedSymbolsOnly) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    ModuleSetInfo &Info = *H;
+    if (auto Stub = Info.StubsMgr->findStub(Name, ExportedSymbolsOnly)) {
+      TargetAddress StubAddr = Stub.getAddress();
+      return JITSymbol(
+          [this, &Info, StubAddr]() {
+            emitTier0(Info);
+            return StubAddr;
+          },
+          Stub.getFlags());
+    }
+    for (auto &H0 : Info.Tier0Handles)
+      if (auto Sym = Tier0.findSymbolIn(H0, Name, ExportedSymbolsOnly)) {
+        JITSymbolFlags Flags = Sym.getFlags();
+        return JITSymbol(
+            [this, &Info, Sym]() mutable {
+              emitTier0(Info);
+              return Sym.getAddress();
+            },
+            Flags);
+      }
+    return nullptr;
+  }
+
+  /// @brief Return the number of functions recompiled by the second tier.
+  unsigned getNumRecompiledFunctions() const { return NumRecompiled; }
+
+  /// @brief Wait for the recompilations queued on the pool to finish.
+  void waitForRecompiles() {
+#if !LLVM_ENABLE_THREADS
+    // Without threads the queued compiles only run when the pool is waited on.
+    if (Pool)
+      Pool->wait();
+#endif
+    std::unique_lock<std::mutex> Lock(PendingMutex);
+    RecompilesDone.wait(Lock, [this]() { return PendingRecompiles == 0; });
+  }
+
+private:
+  static std::string mangle(StringRef Name, const DataLayout &DL) {
+    std::string MangledName;
+    {
+      raw_string_ostream MangledNameStream(MangledName);
+      Mangler::getNameWithPrefix(MangledNameStream, Name, DL);
+    }
+    return MangledName;
+  }
+
+  // Rename the definition F to F + Suffix, and make every use of F, including
+  // recursive calls, refer to a declaration of the old name. The declaration
+  // is resolved to F's stub.
+  static void separateBodyFromStub(Function &F, StringRef Suffix) {
+    std::string Name = F.getName();
+    F.setName(Name + Suffix);
+    Function *Decl = Function::Create(F.getFunctionType(),
+                                      GlobalValue::ExternalLinkage, Name,
+                                      F.getParent());
+    Decl->copyAttributesFrom(&F);
+    Decl->setLinkage(GlobalValue::ExternalLinkage);
+    F.replaceAllUsesWith(Decl);
+  }
+
+  // Count the calls to F, and call back into the layer when the count reaches
+  // HotThreshold. Exactly one call does that, even with several threads.
+  void addCallCounter(Function &F, FunctionInfo &FI) {
+    Module &M = *F.getParent();
+    LLVMContext &Ctx = M.getContext();
+    Type *Int64Ty = Type::getInt64Ty(Ctx);
+    Type *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+    Type *IntPtrTy = Type::getIntNTy(Ctx, sizeof(void *) * 8);
+    auto *Counter =
+      new GlobalVariable(M, Int64Ty, false, GlobalValue::InternalLinkage,
+                         ConstantInt::get(Int64Ty, 0), F.getName() + "$count");
+
+    // Keep the static allocas in the entry block.
+    BasicBlock &Entry = F.getEntryBlock();
+    BasicBlock::iterator IP = Entry.begin();
+    while (isa<AllocaInst>(IP))
+      ++IP;
+    BasicBlock *Body = Entry.splitBasicBlock(IP);
+    BasicBlock *TierUp = BasicBlock::Create(Ctx, "tierup", &F, Body);
+    Entry.getTerminator()->eraseFromParent();
+
+    IRBuilder<> B(&Entry);
+    Value *Count = B.CreateAtomicRMW(AtomicRMWInst::Add, Counter,
+                                     ConstantInt::get(Int64Ty, 1),
+                                     AtomicOrdering::Monotonic);
+    Value *IsHot =
+      B.CreateICmpEQ(Count, ConstantInt::get(Int64Ty, HotThreshold - 1));
+    B.CreateCondBr(IsHot, TierUp, Body);
+
+    B.SetInsertPoint(TierUp);
+    FunctionType *CallbackTy =
+      FunctionType::get(Type::getVoidTy(Ctx), Int8PtrTy, false);
+    Constant *Callback = ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, reinterpret_cast<uintptr_t>(&hotCallback)),
+        CallbackTy->getPointerTo());
+    Constant *Arg = ConstantExpr::getIntToPtr(
+        ConstantInt::get(IntPtrTy, reinterpret_cast<uintptr_t>(&FI)),
+        Int8PtrTy);
+    B.CreateCall(Callback, Arg);
+    B.CreateBr(Body);
+  }
+
+  void addTier0Module(ModuleSetInfo &Info, std::unique_ptr<Module> M,
+                      typename IndirectStubsMgrT::StubInitsMap &StubInits) {
+    // The second tier refers to the first tier's globals by name, so they all
+    // need one.
+    makeAllSymbolsExternallyAccessible(*M);
+    ValueToValueMapTy VMap;
+    Info.Sources.push_back(CloneModule(M.get(), VMap));
+
+    const DataLayout &DL = M->getDataLayout();
+    std::vector<Function *> Defs;
+    for (auto &F : *M)
+      if (!F.isDeclaration() && !F.hasAvailableExternallyLinkage())
+        Defs.push_back(&F);
+
+    std::vector<FunctionInfo *> FIs;
+    for (auto *F : Defs) {
+      Info.Functions.push_back(FunctionInfo());
+      FunctionInfo &FI = Info.Functions.back();
+      FI.Layer = this;
+      FI.Set = &Info;
+      FI.Src = cast<Function>(VMap[F]);
+      FI.Name = F->getName();
+      FIs.push_back(&FI);
+
+      StubInits[mangle(FI.Name, DL)] =
+        std::make_pair(0, JITSymbolBase::flagsFromGlobalValue(*F));
+      if (HotThreshold)
+        addCallCounter(*F, FI);
+      separateBodyFromStub(*F, "$tier0");
+    }
+
+    auto Resolver = createLambdaResolver(
+        [this, &Info](const std::string &Name) {
+          if (auto Stub = Info.StubsMgr->findStub(Name, false))
+            return RuntimeDyld::SymbolInfo(Stub.getAddress(), Stub.getFlags());
+          for (auto &H0 : Info.Tier0Handles)
+            if (auto Sym = Tier0.findSymbolIn(H0, Name, false))
+              return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+          return Info.Resolver->findSymbolInLogicalDylib(Name);
+        },
+        [&Info](const std::string &Name) {
+          return Info.Resolver->findSymbol(Name);
+        });
+
+    std::vector<std::unique_ptr<Module>> Tier0Ms;
+    Tier0Ms.push_back(std::move(M));
+    auto H0 =
+      Tier0.addModuleSet(std::move(Tier0Ms), Info.MemMgr, std::move(Resolver));
+    Info.Tier0Handles.push_back(H0);
+    for (auto *FI : FIs)
+      FI->Tier0Handle = H0;
+  }
+
+  // Emit the first tier of a module set and point the stubs at its bodies.
+  void emitTier0(ModuleSetInfo &Info) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    if (Info.Tier0Emitted)
+      return;
+    Info.Tier0Emitted = true;
+    for (auto &FI : Info.Functions) {
+      const DataLayout &DL = FI.Src->getParent()->getDataLayout();
+      auto Body = Tier0.findSymbolIn(FI.Tier0Handle,
+                                     mangle(FI.Name + "$tier0", DL), false);
+      assert(Body && "Couldn't find function body.");
+      if (auto Err = Info.StubsMgr->updatePointer(mangle(FI.Name, DL),
+                                                  Body.getAddress()))
+        consumeError(std::move(Err));
+    }
+  }
+
+  static void hotCallback(void *Ctx) {
+    FunctionInfo &FI = *static_cast<FunctionInfo *>(Ctx);
+    FI.Layer->functionIsHot(FI);
+  }
+
+  void functionIsHot(FunctionInfo &FI) {
+    if (!Pool) {
+      recompile(FI);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> Lock(PendingMutex);
+      ++PendingRecompiles;
+    }
+    Pool->async([this, &FI]() {
+      recompile(FI);
+      std::lock_guard<std::mutex> Lock(PendingMutex);
+      if (--PendingRecompiles == 0)
+        RecompilesDone.notify_all();
+    });
+  }
+
+  // Compile the original body of FI through the second tier and retarget its
+  // stub. Functions already running at the first tier finish there.
+  void recompile(FunctionInfo &FI) {
+    std::lock_guard<std::recursive_mutex> Lock(LayerMutex);
+    ModuleSetInfo &Info = *FI.Set;
+    Module &SrcM = *FI.Src->getParent();
+    const DataLayout &DL = SrcM.getDataLayout();
+
+    ValueToValueMapTy VMap;
+    auto M = CloneModule(&SrcM, VMap, [&FI](const GlobalValue *GV) {
+      return GV == FI.Src;
+    });
+    M->setModuleIdentifier(SrcM.getModuleIdentifier() + "." + FI.Name);
+    separateBodyFromStub(*cast<Function>(VMap[FI.Src]), "$tier1");
+
+    auto Resolver = createLambdaResolver(
+        [this, &Info](const std::string &Name) {
+          if (auto Stub = Info.StubsMgr->findStub(Name, false))
+            return RuntimeDyld::SymbolInfo(Stub.getAddress(), Stub.getFlags());
+          for (auto &H0 : Info.Tier0Handles)
+            if (auto Sym = Tier0.findSymbolIn(H0, Name, false))
+              return RuntimeDyld::SymbolInfo(Sym.getAddress(), Sym.getFlags());
+          return Info.Resolver->findSymbolInLogicalDylib(Name);
+        },
+        [&Info](const std::string &Name) {
+          return Info.Resolver->findSymbol(Name);
+        });
+
+    std::vector<std::unique_ptr<Module>> Ms;
+    Ms.push_back(std::move(M));
+    auto H1 = Tier1.addModuleSet(std::move(Ms), Info.MemMgr,
+                                 std::move(Resolver));
+    Info.Tier1Handles.push_back(H1);
+
+    auto Body = Tier1.findSymbolIn(H1, mangle(FI.Name + "$tier1", DL), false);
+    assert(Body && "Couldn't find function body.");
+    if (auto Err = Info.StubsMgr->updatePointer(mangle(FI.Name, DL),
+                                                Body.getAddress())) {
+      consumeError(std::move(Err));
+      return;
+    }
+    ++NumRecompiled;
+  }
+
+  Tier0LayerT &Tier0;
+  Tier1LayerT &Tier1;
+  IndirectStubsManagerBuilderT CreateIndirectStubsManager;
+  uint64_t HotThreshold;
+  ThreadPool *Pool;
+
+  // Held while adding, emitting, recompiling and looking up modules. It is
+  // recursive because symbol resolution during a compile may call back into
+  // findSymbol.
+  std::recursive_mutex LayerMutex;
+  ModuleSetListT ModuleSets;
+  std::atomic<unsigned> NumRecompiled{0};
+
+  std::mutex PendingMutex;
+  unsigned PendingRecompiles = 0;
+  std::condition_variable RecompilesDone;
+};
+
+} // End namespace orc.
+} // End namespace llvm.
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
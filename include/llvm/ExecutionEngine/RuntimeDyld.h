@@ -26,6 +26,7 @@
 namespace llvm {
 
 class StringRef;
+class ThreadPool;
 
 namespace object {
   class ObjectFile;
@@ -271,6 +272,15 @@ public:
     this->ProcessAllSections = ProcessAllSections;
   }
 
+  /// Apply relocations using the threads of \p Pool, or on the calling thread
+  /// if \p Pool is null (the default). Symbol addresses are still looked up on
+  /// the calling thread, and the relocations that patch the same section are
+  /// applied in order by a single task. This only pays off for objects with
+  /// many relocations, so batches of fewer than \p MinRelocations are applied
+  /// on the calling thread regardless.
+  void setRelocationThreadPool(ThreadPool *Pool,
+                               unsigned MinRelocations = 4096);
+
   /// Perform all actions needed to make the code owned by this RuntimeDyld
   /// instance executable:
   ///
@@ -298,6 +308,8 @@ private:
   SymbolResolver &Resolver;
   bool ProcessAllSections;
   RuntimeDyldCheckerImpl *Checker;
+  ThreadPool *RelocationPool;
+  unsigned MinParallelRelocations;
 };
 
 } // end namespace llvm
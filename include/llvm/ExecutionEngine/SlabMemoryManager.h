@@ -0,0 +1,135 @@
+//===- SlabMemoryManager.h - Slab-based memory manager for RtDyld -*- C++ -*-=//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a memory manager for MCJIT and
+// RuntimeDyld that carves sections out of large reserved slabs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <map>
+#include <vector>
+
+namespace llvm {
+
+/// A memory manager for JITs that load many small objects.
+///
+/// Code, read-only data and read-write data are each carved out of large
+/// slabs that are mapped read-write up front, optionally backed by huge pages.
+/// Sections are packed densely, so a slab only costs a single mmap call. All
+/// memory handed out between two calls to finalizeMemory forms a group, and
+/// the permissions of a group are applied with one mprotect call per
+/// contiguous range. Pages are never writable and executable at the same
+/// time. Each group starts on a fresh page, so finalized code is never written
+/// to again.
+///
+/// A finalized group can be given back with releaseGroup once nothing uses its
+/// code or data any more. Its pages are reused by later allocations.
+class SlabMemoryManager : public RTDyldMemoryManager {
+  SlabMemoryManager(const SlabMemoryManager&) = delete;
+  void operator=(const SlabMemoryManager&) = delete;
+
+public:
+  /// Identifies the memory allocated between two calls to finalizeMemory.
+  typedef unsigned GroupID;
+
+  /// \param SlabSize The size of the regions reserved from the system.
+  ///        Sections that do not fit are given a mapping of their own.
+  /// \param UseHugePages Ask the system to back the slabs with huge pages,
+  ///        where that is supported.
+  explicit SlabMemoryManager(size_t SlabSize = 16 * 1024 * 1024,
+                             bool UseHugePages = false);
+  ~SlabMemoryManager() override;
+
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool IsReadOnly) override;
+
+  /// Make room for a whole object up front, so that its sections of each kind
+  /// end up next to each other.
+  bool needsToReserveAllocationSpace() override { return true; }
+  void reserveAllocationSpace(uintptr_t CodeSize, uint32_t CodeAlign,
+                              uintptr_t RODataSize, uint32_t RODataAlign,
+                              uintptr_t RWDataSize,
+                              uint32_t RWDataAlign) override;
+
+  /// Apply the final permissions to the current group and start a new one.
+  ///
+  /// \returns true if an error occurred, false otherwise.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+  /// Return the group that allocations are currently added to.
+  GroupID getCurrentGroup() const { return CurrentGroup; }
+
+  /// Give the memory of the finalized group \p G back to the slabs.
+  void releaseGroup(GroupID G);
+
+  /// Return the number of regions mapped from the system so far.
+  unsigned getNumMappings() const { return Mappings.size(); }
+
+  /// Return the number of permission changes made so far.
+  unsigned getNumProtections() const { return NumProtections; }
+
+private:
+  struct Pool {
+    Pool(unsigned Permissions) : Permissions(Permissions) {}
+
+    // The permissions the memory gets when it is finalized.
+    unsigned Permissions;
+
+    // The read-write range that allocations are carved from, and the start of
+    // the part of it that belongs to the current group.
+    uintptr_t Cur = 0;
+    uintptr_t End = 0;
+    uintptr_t GroupStart = 0;
+
+    // Page-aligned ranges that are not in use, by start address. They are
+    // coalesced and keep whatever permissions they had.
+    std::map<uintptr_t, uintptr_t> FreeRanges;
+
+    sys::MemoryBlock Near;
+  };
+
+  struct Span {
+    Pool *P;
+    sys::MemoryBlock Block;
+  };
+
+  uint8_t *allocate(Pool &P, uintptr_t Size, unsigned Alignment);
+  bool refill(Pool &P, uintptr_t MinSize);
+  void closeGroupSpan(Pool &P);
+  void addFreeRange(Pool &P, uintptr_t Start, uintptr_t Size);
+
+  size_t SlabSize;
+  bool UseHugePages;
+  size_t PageSize;
+
+  Pool CodeMem;
+  Pool RODataMem;
+  Pool RWDataMem;
+
+  GroupID CurrentGroup = 0;
+  std::map<GroupID, SmallVector<Span, 4>> Groups;
+
+  std::vector<sys::MemoryBlock> Mappings;
+  unsigned NumProtections = 0;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
@@ -0,0 +1,76 @@
+//===- llvm/IR/CompileTimeBudget.h - Per-function budget --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the interface for limiting the time the optimizer
+/// spends on very large functions.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_COMPILETIMEBUDGET_H
+#define LLVM_IR_COMPILETIMEBUDGET_H
+
+#include "llvm/ADT/StringSet.h"
+
+namespace llvm {
+
+class Function;
+class StringRef;
+
+/// This class implements a per-function compile-time budget, controlled by
+/// the -opt-budget-max-size and -opt-budget-max-time-ms command line options.
+/// Expensive passes ask it whether they should run on a function, and skip
+/// the function, or run in a cheaper mode, once it has more instructions than
+/// the size limit or the function pass pipeline has already spent more than
+/// the time limit on it.
+///
+/// By default there is no budget.
+///
+/// Clients should not instantiate this class directly.  All access should go
+/// through LLVMContext.
+class CompileTimeBudget {
+public:
+  /// \brief Default constructor, initializes the budget based on the command
+  /// line options.
+  CompileTimeBudget();
+
+  /// Returns true if either limit is set.
+  bool isEnabled() const { return MaxSize || MaxTime; }
+
+  /// Checks whether the expensive pass \p PassName should run in full on
+  /// \p F.
+  ///
+  /// This function immediately returns true if there is no budget.  Otherwise
+  /// it returns false once \p F is over either limit, and emits a missed
+  /// optimization remark for the "compile-time-budget" pass the first time
+  /// this happens for \p PassName on the current run over \p F.  \p Action
+  /// says what the pass does instead, and is used in the remark.
+  bool shouldRunExpensivePass(StringRef PassName, const Function &F,
+                              StringRef Action = "skipped");
+
+  /// Called by the function pass manager when it starts and finishes running
+  /// its passes on \p F.  The time limit applies to the time in between.
+  void beginFunction(const Function &F);
+  void endFunction(const Function &F);
+
+private:
+  unsigned MaxSize = 0;
+  unsigned MaxTime = 0;
+
+  /// The function the pass manager is running on, and when it started.
+  const Function *CurrentFunction = nullptr;
+  double StartTime = 0;
+
+  /// The passes that were limited on CurrentFunction so far.
+  StringSet<> Reported;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_IR_COMPILETIMEBUDGET_H
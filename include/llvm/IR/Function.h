@@ -200,6 +200,13 @@ public:
   /// Get the entry count for this function.
   Optional<uint64_t> getEntryCount() const;
 
+  /// Set the section prefix for this function, like ".hot" for the functions
+  /// that the profile finds hot.
+  void setSectionPrefix(StringRef Prefix);
+
+  /// Get the section prefix for this function.
+  Optional<StringRef> getSectionPrefix() const;
+
   /// @brief Return true if the function has the attribute.
   bool hasFnAttribute(Attribute::AttrKind Kind) const {
     return AttributeSets.hasFnAttribute(Kind);
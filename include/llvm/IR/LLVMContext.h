@@ -17,6 +17,7 @@
 
 #include "llvm/Support/CBindingWrapping.h"
 #include "llvm/Support/Options.h"
+#include <memory>
 
 namespace llvm {
 
@@ -34,18 +35,33 @@ template <typename T> class SmallVectorImpl;
 class Function;
 class DebugLoc;
 class OptBisect;
+class CompileTimeBudget;
+class RemarkStreamer;
 
 /// This is an important class for using LLVM in a threaded context.  It
 /// (opaquely) owns and manages the core "global" data of LLVM's core
 /// infrastructure, including the type and constant uniquing tables.
 /// LLVMContext itself provides no locking guarantees, so you should be careful
 /// to have one context per thread.
+///
+/// The exception is a context created with concurrent uniquing: its constants
+/// (ConstantInt, ConstantFP, ConstantExpr, the aggregates and the other simple
+/// constants), its metadata (MDString, ValueAsMetadata, MDTuple and the debug
+/// info nodes) and its types may be looked up and created from several
+/// threads. This only covers the uniquing; the use lists of the shared values
+/// and everything else in the context are still not thread safe.
 class LLVMContext {
 public:
   LLVMContextImpl *const pImpl;
   LLVMContext();
+  /// Create a context that uses concurrent uniquing if \p ConcurrentUniquing
+  /// is set.
+  explicit LLVMContext(bool ConcurrentUniquing);
   ~LLVMContext();
 
+  /// Whether the context was created with concurrent uniquing.
+  bool hasConcurrentUniquing() const;
+
   // Pinned metadata names, which always have the same value.  This is a
   // compile-time performance optimization, not a correctness optimization.
   enum {
@@ -68,6 +84,7 @@ public:
     MD_invariant_group = 16,          // "invariant.group"
     MD_align = 17,                    // "align"
     MD_loop = 18,                     // "llvm.loop"
+    MD_section_prefix = 19,           // "section_prefix"
   };
 
   /// Known operand bundle tag IDs, which always have the same value.  All
@@ -187,8 +204,20 @@ public:
   /// The diagnostic message will be implicitly prefixed with a severity keyword
   /// according to \p DI.getSeverity(), i.e., "error: " for \a DS_Error,
   /// "warning: " for \a DS_Warning, and "note: " for \a DS_Note.
+  ///
+  /// If a remark streamer is set, the optimization remarks are also written to
+  /// it, whether they are enabled or not.
   void diagnose(const DiagnosticInfo &DI);
 
+  /// \brief Set the streamer that all the optimization remarks are written
+  /// to, or clear it if \p Streamer is null. The context takes ownership of
+  /// the streamer.
+  void setRemarkStreamer(std::unique_ptr<RemarkStreamer> Streamer);
+
+  /// \brief Return the remark streamer of this context, or null if it has
+  /// none.
+  RemarkStreamer *getRemarkStreamer() const;
+
   /// \brief Registers a yield callback with the given context.
   ///
   /// The yield callback function may be called by LLVM to transfer control back
@@ -235,6 +264,10 @@ public:
   /// \brief Access the object which manages optimization bisection for failure
   /// analysis.
   OptBisect &getOptBisect();
+
+  /// \brief Access the object which limits the time spent optimizing large
+  /// functions.
+  CompileTimeBudget &getCompileTimeBudget();
 private:
   LLVMContext(LLVMContext&) = delete;
   void operator=(LLVMContext&) = delete;
@@ -92,6 +92,7 @@
 
 namespace llvm {
 template <typename T> class ArrayRef;
+class LLVMContext;
 class Module;
 class Pass;
 class StringRef;
@@ -502,6 +503,32 @@ public:
 };
 
 Timer *getPassTimer(Pass *);
+
+/// Return the -time-passes timer for the new pass manager pass \p PassName,
+/// or null if it is not timed.
+Timer *getPassTimer(StringRef PassName);
+
+/// If -time-passes-per-function is enabled, return the timer for the pass
+/// \p PassName on \p F. Call it only for pass runs that \c getPassTimer
+/// returned a timer for.
+Timer *getPassFunctionTimer(StringRef PassName, const Function &F);
+
+/// PassMemoryRegion - If -memory-report is enabled, charge the growth of the
+/// heap and of the uniquing tables of a context while this object is alive to
+/// a pass, and record the memory the pass reports holding afterwards.
+class PassMemoryRegion {
+  Pass *P;
+  LLVMContext *Context;
+  size_t HeapBefore;
+  size_t TablesBefore;
+
+public:
+  PassMemoryRegion(Pass *P, LLVMContext &Context);
+  ~PassMemoryRegion();
+};
+
+/// If -memory-report is enabled, record the memory that \p P reports holding.
+void recordPassMemoryUsage(Pass *P);
 }
 
 #endif
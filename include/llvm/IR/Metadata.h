@@ -858,6 +858,15 @@ public:
   /// \brief Create a (temporary) clone of this.
   TempMDNode clone() const;
 
+  /// \brief Check whether this and \c Other only differ in their operands.
+  ///
+  /// Returns \c true if both are of the same kind, have the same number of
+  /// operands, and would be uniqued to the same node if their operands were
+  /// the same.  The operands themselves are not compared.
+  ///
+  /// \pre Both nodes are of a uniquable kind.
+  bool isEqualIgnoringOperands(const MDNode &Other) const;
+
   /// \brief Deallocate a node created by getTemporary.
   ///
   /// Calls \c replaceAllUsesWith(nullptr) before deleting, so any remaining
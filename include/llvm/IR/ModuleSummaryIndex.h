@@ -25,19 +25,32 @@
 #include "llvm/IR/Module.h"
 
 #include <array>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace llvm {
 
+class ModuleSummaryIndexTable;
+
 /// \brief Class to accumulate and hold information about a callee.
 struct CalleeInfo {
+  /// How hot the calls to the callee are, according to the profile summary
+  /// of the module they are in. Unknown without a profile.
+  enum class HotnessType : uint8_t { Unknown = 0, Cold = 1, None = 2, Hot = 3 };
+
   /// The static number of callsites calling corresponding function.
   unsigned CallsiteCount;
   /// The cumulative profile count of calls to corresponding function
   /// (if using PGO, otherwise 0).
   uint64_t ProfileCount;
-  CalleeInfo() : CallsiteCount(0), ProfileCount(0) {}
-  CalleeInfo(unsigned CallsiteCount, uint64_t ProfileCount)
-      : CallsiteCount(CallsiteCount), ProfileCount(ProfileCount) {}
+  HotnessType Hotness;
+  CalleeInfo()
+      : CallsiteCount(0), ProfileCount(0), Hotness(HotnessType::Unknown) {}
+  CalleeInfo(unsigned CallsiteCount, uint64_t ProfileCount,
+             HotnessType Hotness = HotnessType::Unknown)
+      : CallsiteCount(CallsiteCount), ProfileCount(ProfileCount),
+        Hotness(Hotness) {}
   CalleeInfo &operator+=(uint64_t RHSProfileCount) {
     CallsiteCount++;
     ProfileCount += RHSProfileCount;
@@ -45,6 +58,24 @@ struct CalleeInfo {
   }
 };
 
+/// \brief A type identifier of virtual tables, as the GUID of its name, with
+/// an offset in bytes.
+///
+/// For a virtual call, the offset is the one of the function pointer from the
+/// address point of the virtual table. For a virtual table, it is the offset
+/// of the address point of the type in the table.
+struct TypeIdOffset {
+  GlobalValue::GUID TypeID;
+  uint64_t Offset;
+
+  bool operator<(const TypeIdOffset &RHS) const {
+    return std::tie(TypeID, Offset) < std::tie(RHS.TypeID, RHS.Offset);
+  }
+  bool operator==(const TypeIdOffset &RHS) const {
+    return TypeID == RHS.TypeID && Offset == RHS.Offset;
+  }
+};
+
 /// Struct to hold value either by GUID or Value*, depending on whether this
 /// is a combined or per-module index, respectively.
 struct ValueInfo {
@@ -241,6 +272,9 @@ private:
   /// List of <CalleeValueInfo, CalleeInfo> call edge pairs from this function.
   std::vector<EdgeTy> CallGraphEdgeList;
 
+  /// The virtual table slots that this function makes virtual calls through.
+  std::vector<TypeIdOffset> VCallList;
+
 public:
   /// Summary constructors.
   FunctionSummary(GVFlags Flags, unsigned NumInsts)
@@ -278,15 +312,31 @@ public:
   /// Return the list of <CalleeValueInfo, CalleeInfo> pairs.
   std::vector<EdgeTy> &calls() { return CallGraphEdgeList; }
   const std::vector<EdgeTy> &calls() const { return CallGraphEdgeList; }
+
+  /// Record a virtual call from this function through \p Slot.
+  void addVCall(TypeIdOffset Slot) { VCallList.push_back(Slot); }
+
+  /// Return the virtual table slots of the virtual calls of this function.
+  const std::vector<TypeIdOffset> &vcalls() const { return VCallList; }
 };
 
 /// \brief Global variable summary information to aid decisions and
 /// implementation of importing.
 ///
-/// Currently this doesn't add anything to the base \p GlobalValueSummary,
-/// but is a placeholder as additional info may be added to the summary
-/// for variables.
+/// For virtual tables, this also holds what whole-program devirtualization
+/// needs to know about them.
 class GlobalVarSummary : public GlobalValueSummary {
+public:
+  /// <offset, function name> pair of a function pointer in a virtual table.
+  /// The name is empty for functions that can't be called from other modules.
+  typedef std::pair<uint64_t, std::string> VTableFuncTy;
+
+private:
+  /// The types that this virtual table has an address point for.
+  std::vector<TypeIdOffset> VTableTypeList;
+
+  /// The function pointers of this virtual table, by increasing offset.
+  std::vector<VTableFuncTy> VTableFuncList;
 
 public:
   /// Summary constructors.
@@ -296,6 +346,35 @@ public:
   static bool classof(const GlobalValueSummary *GVS) {
     return GVS->getSummaryKind() == GlobalVarKind;
   }
+
+  /// Record that this virtual table has an address point for \p Type.
+  void addVTableType(TypeIdOffset Type) { VTableTypeList.push_back(Type); }
+
+  /// Record a pointer to the function \p Name at \p Offset in this virtual
+  /// table.
+  void addVTableFunc(uint64_t Offset, StringRef Name) {
+    assert((VTableFuncList.empty() || VTableFuncList.back().first < Offset) &&
+           "Function pointers must be added by increasing offset");
+    VTableFuncList.push_back(std::make_pair(Offset, Name.str()));
+  }
+
+  const std::vector<TypeIdOffset> &vtableTypes() const {
+    return VTableTypeList;
+  }
+  const std::vector<VTableFuncTy> &vtableFuncs() const {
+    return VTableFuncList;
+  }
+
+  /// Return the function pointer at \p Offset in this virtual table, or null
+  /// if there is none.
+  const VTableFuncTy *getVTableFunc(uint64_t Offset) const {
+    auto I = std::lower_bound(
+        VTableFuncList.begin(), VTableFuncList.end(), Offset,
+        [](const VTableFuncTy &F, uint64_t Offset) { return F.first < Offset; });
+    if (I == VTableFuncList.end() || I->first != Offset)
+      return nullptr;
+    return &*I;
+  }
 };
 
 /// 160 bits SHA1
@@ -338,46 +417,81 @@ private:
   /// Holds strings for combined index, mapping to the corresponding module ID.
   ModulePathStringTableTy ModulePathStringTable;
 
+  /// The virtual table slots that whole-program devirtualization found a
+  /// single implementation for in the thin link, mapped to the name of that
+  /// implementation.
+  std::map<TypeIdOffset, std::string> SingleImplMap;
+
+  /// For an index created from a ModuleSummaryIndexTable, the table that the
+  /// summaries are read from as they are looked up. Iterating over the index
+  /// reads all of them.
+  std::unique_ptr<ModuleSummaryIndexTable> Table;
+
+  /// Serializes the reads from Table, as lookups can come from several
+  /// threads, and whether they have read everything.
+  mutable std::mutex TableMutex;
+  mutable bool ReadAllFromTable = false;
+
+  const_gvsummary_iterator findInTable(GlobalValue::GUID ValueGUID) const;
+  void readAllFromTable() const;
+
+  friend class ModuleSummaryIndexTable;
+
 public:
-  ModuleSummaryIndex() = default;
+  ModuleSummaryIndex();
+  ~ModuleSummaryIndex();
 
   // Disable the copy constructor and assignment operators, so
   // no unexpected copying/moving occurs.
   ModuleSummaryIndex(const ModuleSummaryIndex &) = delete;
   void operator=(const ModuleSummaryIndex &) = delete;
 
-  gvsummary_iterator begin() { return GlobalValueMap.begin(); }
-  const_gvsummary_iterator begin() const { return GlobalValueMap.begin(); }
+  gvsummary_iterator begin() {
+    if (Table)
+      readAllFromTable();
+    return GlobalValueMap.begin();
+  }
+  const_gvsummary_iterator begin() const {
+    if (Table)
+      readAllFromTable();
+    return GlobalValueMap.begin();
+  }
   gvsummary_iterator end() { return GlobalValueMap.end(); }
   const_gvsummary_iterator end() const { return GlobalValueMap.end(); }
 
   /// Get the list of global value summary objects for a given value name.
   const GlobalValueSummaryList &getGlobalValueSummaryList(StringRef ValueName) {
-    return GlobalValueMap[GlobalValue::getGUID(ValueName)];
+    GlobalValue::GUID ValueGUID = GlobalValue::getGUID(ValueName);
+    if (Table)
+      findInTable(ValueGUID);
+    return GlobalValueMap[ValueGUID];
   }
 
   /// Get the list of global value summary objects for a given value name.
   const const_gvsummary_iterator
   findGlobalValueSummaryList(StringRef ValueName) const {
-    return GlobalValueMap.find(GlobalValue::getGUID(ValueName));
+    return findGlobalValueSummaryList(GlobalValue::getGUID(ValueName));
   }
 
   /// Get the list of global value summary objects for a given value GUID.
   const const_gvsummary_iterator
   findGlobalValueSummaryList(GlobalValue::GUID ValueGUID) const {
+    if (Table)
+      return findInTable(ValueGUID);
     return GlobalValueMap.find(ValueGUID);
   }
 
   /// Add a global value summary for a value of the given name.
   void addGlobalValueSummary(StringRef ValueName,
                              std::unique_ptr<GlobalValueSummary> Summary) {
-    GlobalValueMap[GlobalValue::getGUID(ValueName)].push_back(
-        std::move(Summary));
+    addGlobalValueSummary(GlobalValue::getGUID(ValueName), std::move(Summary));
   }
 
   /// Add a global value summary for a value of the given GUID.
   void addGlobalValueSummary(GlobalValue::GUID ValueGUID,
                              std::unique_ptr<GlobalValueSummary> Summary) {
+    if (Table)
+      findInTable(ValueGUID);
     GlobalValueMap[ValueGUID].push_back(std::move(Summary));
   }
 
@@ -414,6 +528,24 @@ public:
   GlobalValueSummary *getGlobalValueSummary(GlobalValue::GUID ValueGUID,
                                             bool PerModuleIndex = true) const;
 
+  /// Record that the virtual calls through \p Slot can only call the
+  /// function \p Name.
+  void addSingleImpl(TypeIdOffset Slot, StringRef Name) {
+    SingleImplMap[Slot] = Name;
+  }
+
+  /// Get the only function that the virtual calls through \p Slot can call,
+  /// or an empty name if there is none.
+  StringRef getSingleImpl(TypeIdOffset Slot) const {
+    auto I = SingleImplMap.find(Slot);
+    return I == SingleImplMap.end() ? StringRef() : StringRef(I->second);
+  }
+
+  /// The virtual table slots with a single implementation.
+  const std::map<TypeIdOffset, std::string> &singleImpls() const {
+    return SingleImplMap;
+  }
+
   /// Table of modules, containing module hash and id.
   const StringMap<std::pair<uint64_t, ModuleHash>> &modulePaths() const {
     return ModulePathStringTable;
@@ -488,6 +620,11 @@ public:
   void collectDefinedFunctionsForModule(StringRef ModulePath,
                                         GVSummaryMapTy &GVSummaryMap) const;
 
+  /// Collect for the given module the list of summaries it defines (GUID ->
+  /// Summary).
+  void collectDefinedGVSummariesForModule(StringRef ModulePath,
+                                          GVSummaryMapTy &GVSummaryMap) const;
+
   /// Collect for each module the list of Summaries it defines (GUID ->
   /// Summary).
   void collectDefinedGVSummariesPerModule(
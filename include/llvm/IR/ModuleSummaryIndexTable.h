@@ -0,0 +1,85 @@
+//===-- llvm/IR/ModuleSummaryIndexTable.h - Flat summary index -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// @file
+/// This file declares the summary index table, an on-disk form of a combined
+/// module summary index that is used in place, typically from a memory mapped
+/// file. Reading the bitcode form of the index builds every summary of the
+/// program up front; with the table, the summaries of a GUID are found with a
+/// hash table probe, and only the summaries that are looked up are built.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_MODULESUMMARYINDEXTABLE_H
+#define LLVM_IR_MODULESUMMARYINDEXTABLE_H
+
+#include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace llvm {
+
+class raw_ostream;
+
+/// Write the combined index \p Index as a summary index table.
+void writeModuleSummaryIndexTable(const ModuleSummaryIndex &Index,
+                                  raw_ostream &OS);
+
+/// Return true if \p Buffer starts with the magic of a summary index table.
+bool isModuleSummaryIndexTable(MemoryBufferRef Buffer);
+
+/// Reads summaries out of a summary index table.
+///
+/// The table is made of a header, the module table, an open addressing hash
+/// table from GUIDs to their summary records, the summary records, the GUIDs
+/// that each module defines and the module paths. Everything is
+/// little-endian.
+class ModuleSummaryIndexTable {
+  std::unique_ptr<MemoryBuffer> Buffer;
+
+  /// The sections of the table, after the header.
+  StringRef Modules, Buckets, Records, Defined, Strings;
+  uint32_t NumModules, NumBuckets;
+
+  explicit ModuleSummaryIndexTable(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  StringRef getModulePath(uint32_t Module) const;
+
+  /// Find the summaries of \p GUID in \p Index, reading them from the table
+  /// first if needed. Returns the end of the index if there are none.
+  gvsummary_iterator readSummaries(GlobalValue::GUID GUID,
+                                   ModuleSummaryIndex &Index) const;
+
+  /// Read every summary of the table into \p Index.
+  void readAllSummaries(ModuleSummaryIndex &Index) const;
+
+public:
+  /// Check the layout of the table in \p Buffer, which it takes ownership of.
+  static ErrorOr<std::unique_ptr<ModuleSummaryIndexTable>>
+  create(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// Create an index that reads its summaries from the table in \p Buffer
+  /// when they are looked up.
+  static ErrorOr<std::unique_ptr<ModuleSummaryIndex>>
+  createIndex(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// Get the number of GUIDs that have summaries in the table.
+  uint32_t getNumGUIDs() const;
+
+  /// Get the GUIDs of the global values that the module \p ModulePath
+  /// defines.
+  std::vector<GlobalValue::GUID> getDefinedGUIDs(StringRef ModulePath) const;
+
+  friend class ModuleSummaryIndex;
+};
+
+} // End llvm namespace
+
+#endif
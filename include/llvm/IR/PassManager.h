@@ -48,12 +48,17 @@
 #include "llvm/Support/TypeName.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/type_traits.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <list>
 #include <memory>
 #include <vector>
 
 namespace llvm {
 
+class Timer;
+
 /// \brief An abstract set of preserved analyses following a transformation pass
 /// run.
 ///
@@ -173,6 +178,34 @@ private:
 // Forward declare the analysis manager template.
 template <typename IRUnitT> class AnalysisManager;
 
+namespace detail {
+/// \brief Times one run of a pass for -time-passes.
+///
+/// This does nothing unless -time-passes is enabled. Pass managers and
+/// adaptors are not timed, as their time is that of the passes they run.
+class PassTimingRegion {
+  Timer *PassTimer = nullptr;
+  Timer *FunctionTimer = nullptr;
+
+  PassTimingRegion(const PassTimingRegion &) = delete;
+  void operator=(const PassTimingRegion &) = delete;
+
+public:
+  /// \param F The function the pass is run on, if it is a function pass.
+  PassTimingRegion(StringRef PassName, const Function *F);
+  ~PassTimingRegion();
+
+  /// \brief Returns true if -time-passes is enabled.
+  static bool isEnabled();
+};
+
+/// \brief The function to charge a pass run on \p IR to.
+inline const Function *getTimedFunction(const Function &F) { return &F; }
+template <typename IRUnitT> const Function *getTimedFunction(const IRUnitT &) {
+  return nullptr;
+}
+} // End namespace detail
+
 /// A CRTP mix-in to automatically provide informational APIs needed for
 /// passes.
 ///
@@ -252,7 +285,12 @@ public:
         dbgs() << "Running pass: " << Passes[Idx]->name() << " on "
                << IR.getName() << "\n";
 
-      PreservedAnalyses PassPA = Passes[Idx]->run(IR, AM);
+      PreservedAnalyses PassPA;
+      {
+        detail::PassTimingRegion Timing(Passes[Idx]->name(),
+                                        detail::getTimedFunction(IR));
+        PassPA = Passes[Idx]->run(IR, AM);
+      }
 
       // Update the analysis manager as each pass runs and potentially
       // invalidates analyses. We also update the preserved set of analyses
@@ -282,6 +320,15 @@ public:
     Passes.emplace_back(new PassModelT(std::move(Pass)));
   }
 
+  /// \brief Whether all the passes in this manager may be run on several
+  /// units of IR concurrently.
+  bool isThreadSafe() const {
+    return std::all_of(Passes.begin(), Passes.end(),
+                       [](const std::unique_ptr<PassConceptT> &P) {
+                         return P->isThreadSafe();
+                       });
+  }
+
 private:
   typedef detail::PassConcept<IRUnitT> PassConceptT;
 
@@ -931,6 +978,123 @@ createModuleToFunctionPassAdaptor(FunctionPassT Pass) {
   return ModuleToFunctionPassAdaptor<FunctionPassT>(std::move(Pass));
 }
 
+namespace detail {
+/// \brief Run \p Work on \p NumThreads threads (0 for one per hardware
+/// thread) and wait for all of them to finish.
+void runOnThreads(unsigned NumThreads, std::function<void()> Work);
+}
+
+/// \brief A module pass which runs a function pass over the functions of the
+/// module on several threads.
+///
+/// The functions are run concurrently only if the function pass is thread
+/// safe, that is, it has an \c isThreadSafe method that returns true (for a
+/// \c FunctionPassManager, if all its passes do). Such a pass may be run on
+/// several functions at the same time. It may only change the function it is
+/// run on and the values local to it, and it must neither create nor use
+/// values that are shared between functions, such as constants, globals and
+/// types: their uniquing tables in the \c LLVMContext and their use lists are
+/// not thread safe. Otherwise the functions are run one after another as by
+/// \c ModuleToFunctionPassAdaptor.
+///
+/// Each thread has its own \c FunctionAnalysisManager, set up by the
+/// \c RegisterAnalyses callback, which the module analysis manager is made
+/// available to through the \c ModuleAnalysisManagerFunctionProxy.
+template <typename FunctionPassT>
+class ParallelModuleToFunctionPassAdaptor
+    : public PassInfoMixin<ParallelModuleToFunctionPassAdaptor<FunctionPassT>> {
+public:
+  typedef std::function<void(FunctionAnalysisManager &)> RegisterAnalysesFn;
+
+  /// \param NumThreads The number of threads to run the pass on, or 0 for one
+  /// per hardware thread.
+  ParallelModuleToFunctionPassAdaptor(FunctionPassT Pass,
+                                      RegisterAnalysesFn RegisterAnalyses,
+                                      unsigned NumThreads = 0)
+      : Pass(std::move(Pass)), RegisterAnalyses(std::move(RegisterAnalyses)),
+        NumThreads(NumThreads) {}
+  // We have to explicitly define all the special member functions because MSVC
+  // refuses to generate them.
+  ParallelModuleToFunctionPassAdaptor(
+      ParallelModuleToFunctionPassAdaptor &&Arg)
+      : Pass(std::move(Arg.Pass)),
+        RegisterAnalyses(std::move(Arg.RegisterAnalyses)),
+        NumThreads(Arg.NumThreads) {}
+  ParallelModuleToFunctionPassAdaptor &
+  operator=(ParallelModuleToFunctionPassAdaptor &&RHS) {
+    Pass = std::move(RHS.Pass);
+    RegisterAnalyses = std::move(RHS.RegisterAnalyses);
+    NumThreads = RHS.NumThreads;
+    return *this;
+  }
+
+  /// \brief Runs the function pass across every function in the module.
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM) {
+    FunctionAnalysisManager &FAM =
+        AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+    std::vector<Function *> Functions;
+    for (Function &F : M)
+      if (!F.isDeclaration())
+        Functions.push_back(&F);
+
+    PreservedAnalyses PA = PreservedAnalyses::all();
+    // The timers are not thread safe, so functions are run one after
+    // another when passes are timed.
+    if (NumThreads == 1 || Functions.size() <= 1 ||
+        detail::PassTimingRegion::isEnabled() ||
+        !detail::PassThreadSafety<FunctionPassT>::isThreadSafe(Pass)) {
+      for (Function *F : Functions)
+        PA.intersect(FAM.invalidate(*F, Pass.run(*F, FAM)));
+      PA.preserve<FunctionAnalysisManagerModuleProxy>();
+      return PA;
+    }
+
+    // Each thread takes the next function to run the pass on, so that a few
+    // large functions don't hold the others up.
+    std::vector<PreservedAnalyses> FunctionPA(Functions.size());
+    std::atomic<size_t> Next(0);
+    detail::runOnThreads(NumThreads, [&]() {
+      FunctionAnalysisManager ThreadFAM;
+      RegisterAnalyses(ThreadFAM);
+      ThreadFAM.registerPass(
+          [&] { return ModuleAnalysisManagerFunctionProxy(AM); });
+      for (size_t Idx = Next++; Idx < Functions.size(); Idx = Next++) {
+        Function &F = *Functions[Idx];
+        FunctionPA[Idx] = ThreadFAM.invalidate(F, Pass.run(F, ThreadFAM));
+        // The results for this function are not needed by the others.
+        ThreadFAM.invalidate(F, PreservedAnalyses::none());
+      }
+    });
+
+    // The analyses cached in the module's function analysis manager may have
+    // been invalidated by the pass.
+    for (size_t Idx = 0, E = Functions.size(); Idx != E; ++Idx)
+      PA.intersect(FAM.invalidate(*Functions[Idx], std::move(FunctionPA[Idx])));
+
+    // By definition we preserve the proxy. See ModuleToFunctionPassAdaptor.
+    PA.preserve<FunctionAnalysisManagerModuleProxy>();
+    return PA;
+  }
+
+private:
+  FunctionPassT Pass;
+  RegisterAnalysesFn RegisterAnalyses;
+  unsigned NumThreads;
+};
+
+/// \brief A function to deduce a function pass type and wrap it in the
+/// templated parallel adaptor.
+template <typename FunctionPassT>
+ParallelModuleToFunctionPassAdaptor<FunctionPassT>
+createParallelModuleToFunctionPassAdaptor(
+    FunctionPassT Pass,
+    std::function<void(FunctionAnalysisManager &)> RegisterAnalyses,
+    unsigned NumThreads = 0) {
+  return ParallelModuleToFunctionPassAdaptor<FunctionPassT>(
+      std::move(Pass), std::move(RegisterAnalyses), NumThreads);
+}
+
 /// \brief A template utility pass to force an analysis result to be available.
 ///
 /// This is a no-op pass which simply forces a specific analysis pass's result
@@ -44,6 +44,37 @@ template <typename IRUnitT> struct PassConcept {
 
   /// \brief Polymorphic method to access the name of a pass.
   virtual StringRef name() = 0;
+
+  /// \brief Polymorphic method to query whether the pass may be run on
+  /// several units of IR concurrently.
+  virtual bool isThreadSafe() = 0;
+};
+
+/// \brief SFINAE metafunction for computing whether \c PassT has an
+/// \c isThreadSafe method.
+template <typename PassT> class PassHasIsThreadSafeMethod {
+  typedef char SmallType;
+  struct BigType {
+    char a, b;
+  };
+
+  template <typename T>
+  static SmallType f(decltype(std::declval<T &>().isThreadSafe()) *);
+  template <typename T> static BigType f(...);
+
+public:
+  enum { Value = sizeof(f<PassT>(nullptr)) == sizeof(SmallType) };
+};
+
+/// \brief Query whether a pass may be run on several units of IR
+/// concurrently. Passes have to opt into this with an \c isThreadSafe method.
+template <typename PassT,
+          bool HasIsThreadSafe = PassHasIsThreadSafeMethod<PassT>::Value>
+struct PassThreadSafety {
+  static bool isThreadSafe(PassT &) { return false; }
+};
+template <typename PassT> struct PassThreadSafety<PassT, true> {
+  static bool isThreadSafe(PassT &Pass) { return Pass.isThreadSafe(); }
 };
 
 /// \brief SFINAE metafunction for computing whether \c PassT has a run method
@@ -100,6 +131,9 @@ struct PassModel<IRUnitT, PassT, PreservedAnalysesT, true>
     return Pass.run(IR, AM);
   }
   StringRef name() override { return PassT::name(); }
+  bool isThreadSafe() override {
+    return PassThreadSafety<PassT>::isThreadSafe(Pass);
+  }
   PassT Pass;
 };
 
@@ -126,6 +160,9 @@ struct PassModel<IRUnitT, PassT, PreservedAnalysesT, false>
     return Pass.run(IR);
   }
   StringRef name() override { return PassT::name(); }
+  bool isThreadSafe() override {
+    return PassThreadSafety<PassT>::isThreadSafe(Pass);
+  }
   PassT Pass;
 };
 
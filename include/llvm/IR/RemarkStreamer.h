@@ -0,0 +1,91 @@
+//===- llvm/IR/RemarkStreamer.h - Binary optimization remarks ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file declares the writer and the reader of the compact binary format
+/// that optimization remarks can be streamed to.
+///
+/// A remark stream starts with the magic "RMK\0" and a ULEB128 version,
+/// followed by records that start with a ULEB128 record kind:
+///   - String: the ULEB128 size and the bytes of a string, which gets the next
+///     string ID, starting from 0.
+///   - Remark: the ULEB128 remark type, the string IDs of the pass name, the
+///     function name, the file name and the message, and the line and the
+///     column, all as ULEB128.
+/// A string is written before the first remark that refers to it, so the
+/// strings are deduplicated without buffering the remarks, and a truncated
+/// stream is readable up to its last complete record.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_IR_REMARKSTREAMER_H
+#define LLVM_IR_REMARKSTREAMER_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Error.h"
+
+namespace llvm {
+
+class DiagnosticInfoOptimizationBase;
+class raw_ostream;
+
+/// \brief The kinds of optimization remarks.
+enum class RemarkType : unsigned {
+  Passed,
+  Missed,
+  Analysis,
+  AnalysisFPCommute,
+  AnalysisAliasing,
+  Failure,
+  Last = Failure
+};
+
+/// \brief Return the name of \p Type, as printed by llvm-remarks.
+StringRef getRemarkTypeName(RemarkType Type);
+
+/// \brief A remark, with the strings that it refers to.
+struct Remark {
+  RemarkType Type = RemarkType::Passed;
+  StringRef PassName;
+  StringRef FunctionName;
+  /// The file name of the location of the remark, or empty if it has none.
+  StringRef File;
+  StringRef Message;
+  unsigned Line = 0;
+  unsigned Column = 0;
+};
+
+/// \brief Writes remarks to a stream in the binary remark format.
+class RemarkStreamer {
+  raw_ostream &OS;
+  StringMap<unsigned> StringIDs;
+  SmallString<128> MessageStorage;
+
+  /// Return the ID of \p Str, writing it first if it is new.
+  unsigned getStringID(StringRef Str);
+
+public:
+  /// Write the header of the stream to \p OS.
+  explicit RemarkStreamer(raw_ostream &OS);
+
+  void emit(const Remark &R);
+  void emit(const DiagnosticInfoOptimizationBase &DI);
+};
+
+/// \brief Call \p Callback on each of the remarks of the remark stream in
+/// \p Buffer. The strings of the remarks point into \p Buffer.
+Error parseRemarks(StringRef Buffer,
+                   function_ref<void(const Remark &)> Callback);
+
+} // end namespace llvm
+
+#endif
@@ -49,11 +49,22 @@ bool verifyFunction(const Function &F, raw_ostream *OS = nullptr);
 /// supplied, DebugInfo verification failures won't be considered as
 /// error and instead *BrokenDebugInfo will be set to true. Debug
 /// info errors can be "recovered" from by stripping the debug info.
+///
+/// If Parallel is true, the function bodies are verified concurrently on a
+/// thread pool (see -verifier-threads), and the messages are written in
+/// function order. The only difference to serial verification is that a
+/// broken metadata node used by many functions may be reported more than once.
 bool verifyModule(const Module &M, raw_ostream *OS = nullptr,
-                  bool *BrokenDebugInfo = nullptr);
+                  bool *BrokenDebugInfo = nullptr, bool Parallel = false);
 
 FunctionPass *createVerifierPass(bool FatalErrors = true);
 
+/// \brief Create a verifier pass that checks the function bodies in parallel.
+///
+/// Unlike the pass created by createVerifierPass(), this is a module pass: it
+/// verifies the whole module at once, with verifyModule(..., Parallel).
+ModulePass *createParallelVerifierPass(bool FatalErrors = true);
+
 /// Check a module for errors, and report separate error states for IR
 /// and debug info errors.
 class VerifierAnalysis : public AnalysisInfoMixin<VerifierAnalysis> {
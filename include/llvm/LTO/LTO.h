@@ -18,12 +18,17 @@
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/ModuleSummaryIndex.h"
+#include "llvm/Transforms/IPO/FunctionImport.h"
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 namespace llvm {
 
 class LLVMContext;
 class MemoryBufferRef;
 class Module;
+class raw_ostream;
 
 /// Helper to load a module from bitcode.
 std::unique_ptr<Module> loadModuleFromBuffer(const MemoryBufferRef &Buffer,
@@ -56,20 +61,82 @@ public:
 ///
 /// This is done for correctness (if value exported, ensure we always
 /// emit a copy), and compile-time optimization (allow drop of duplicates).
+///
+/// With a \p ThreadCount above one, the index is walked on several threads,
+/// which \p isPrevailing and \p isExported may be called from concurrently.
+/// \p recordNewLinkage is still called from the calling thread, in the same
+/// order as with a single thread.
 void thinLTOResolveWeakForLinkerInIndex(
     ModuleSummaryIndex &Index,
     std::function<bool(GlobalValue::GUID, const GlobalValueSummary *)>
         isPrevailing,
     std::function<bool(StringRef, GlobalValue::GUID)> isExported,
     std::function<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage);
+        recordNewLinkage,
+    unsigned ThreadCount = 1);
 
 /// Update the linkages in the given \p Index to mark exported values
 /// as external and non-exported values as internal. The ThinLTO backends
 /// must apply the changes to the Module via thinLTOInternalizeModule.
+///
+/// With a \p ThreadCount above one, \p isExported may be called from several
+/// threads concurrently.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    std::function<bool(StringRef, GlobalValue::GUID)> isExported);
+    std::function<bool(StringRef, GlobalValue::GUID)> isExported,
+    unsigned ThreadCount = 1);
+
+/// Estimate the cost of the ThinLTO backend of a module, as the number of
+/// instructions of the functions it defines, \p DefinedGVSummaries, and of the
+/// ones it imports according to \p ImportList. Backends are scheduled from the
+/// most to the least expensive so that a large module does not end up running
+/// alone at the end of the link.
+uint64_t
+estimateThinLTOBackendCost(const ModuleSummaryIndex &Index,
+                           const GVSummaryMapTy &DefinedGVSummaries,
+                           const FunctionImporter::ImportMapTy &ImportList);
+
+/// Records when the ThinLTO backend of every module ran and on which thread,
+/// to write it out in the Chrome trace event format (chrome://tracing) and
+/// find the critical path of a link. A trace is only collected when a file
+/// was given with -thinlto-backend-trace.
+class ThinLTOBackendTrace {
+public:
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+private:
+  struct Event {
+    std::string ModuleIdentifier;
+    uint64_t Cost;
+    unsigned Thread;
+    TimePoint Start, End;
+  };
+
+  std::string Path;
+  TimePoint Origin;
+  std::mutex Mutex;
+  std::vector<Event> Events;
+  /// Map the threads of the pool to small ids, in the order they first ran a
+  /// backend.
+  std::map<std::thread::id, unsigned> Threads;
+
+  explicit ThinLTOBackendTrace(std::string Path);
+
+public:
+  /// Create a trace if -thinlto-backend-trace was given, or return null.
+  static std::unique_ptr<ThinLTOBackendTrace> createIfRequested();
+
+  /// Record that the backend of \p ModuleIdentifier, with the estimated
+  /// \p Cost, ran on the current thread from \p Start until now. This is
+  /// thread safe.
+  void addBackend(StringRef ModuleIdentifier, uint64_t Cost, TimePoint Start);
+
+  /// Write the trace to \p OS.
+  void print(raw_ostream &OS);
+
+  /// Write the trace to the file given with -thinlto-backend-trace.
+  std::error_code write();
+};
 
 }
 
@@ -112,6 +112,7 @@ public:
     int PruningInterval = 1200;          // seconds, -1 to disable pruning.
     unsigned int Expiration = 7 * 24 * 3600;     // seconds (1w default).
     unsigned MaxPercentageOfAvailableSpace = 75; // percentage.
+    bool UseIndex = false; // Prune from an index instead of a directory scan.
   };
 
   /// Provide a path to a directory where to store the cached files for
@@ -150,6 +151,11 @@ public:
       CacheOptions.MaxPercentageOfAvailableSpace = Percentage;
   }
 
+  /// Cache policy: record the entries that are written and read in a journal,
+  /// and prune the cache from the index that it updates instead of scanning
+  /// the cache directory.
+  void setCachePruningUseIndex(bool Enable) { CacheOptions.UseIndex = Enable; }
+
   /**@}*/
 
   /// Set the path to a directory where to save temporaries at various stages of
@@ -229,9 +235,10 @@ public:
   void internalize(Module &Module, ModuleSummaryIndex &Index);
 
   /**
-   * Perform post-importing ThinLTO optimizations.
+   * Perform post-importing ThinLTO optimizations. The virtual calls are
+   * devirtualized with the resolutions of the combined \p Index if provided.
    */
-  void optimize(Module &Module);
+  void optimize(Module &Module, const ModuleSummaryIndex *Index = nullptr);
 
   /**
    * Perform ThinLTO CodeGen.
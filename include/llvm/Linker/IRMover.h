@@ -11,12 +11,16 @@
 #define LLVM_LINKER_IRMOVER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringMap.h"
 #include <functional>
+#include <vector>
 
 namespace llvm {
 class Error;
 class GlobalValue;
+class GlobalVariable;
 class Metadata;
 class Module;
 class StructType;
@@ -45,6 +49,15 @@ class IRMover {
   typedef DenseMap<const Metadata *, TrackingMDRef> MDMapT;
 
 public:
+  /// The globals holding the elements that each move() of a batch added to
+  /// an appending global, by name.
+  typedef StringMap<std::vector<GlobalVariable *>> AppendingPiecesT;
+
+  /// The cycles of uniqued metadata in the composite module, by a hash of
+  /// their structure, for -link-merge-metadata-cycles. Each cycle is
+  /// represented by one of its nodes.
+  typedef DenseMap<unsigned, std::vector<TrackingMDRef>> MetadataCycleMapT;
+
   class IdentifiedStructTypeSet {
     // The set of opaque types is the composite module.
     DenseSet<StructType *> OpaqueStructTypes;
@@ -75,10 +88,34 @@ public:
              std::function<void(GlobalValue &GV, ValueAdder Add)> AddLazyFor);
   Module &getModule() { return Composite; }
 
+  /// Start a batch of calls to \a move().
+  ///
+  /// After every move, the appending globals of the composite (such as
+  /// llvm.global_ctors) are rebuilt with the new elements, and the constant
+  /// arrays that became dead are dropped from the context. Both take time
+  /// proportional to the composite rather than to the source, which makes
+  /// moving thousands of modules quadratic. Within a batch, the new elements
+  /// of appending globals are kept aside and concatenated once by \a
+  /// finishBatch(), and dead constant arrays are only dropped after 1, 2, 4,
+  /// 8... moves. The appending globals of the composite are incomplete until
+  /// the batch is finished.
+  void startBatch();
+
+  /// Finish the batch started by \a startBatch().
+  void finishBatch();
+
 private:
   Module &Composite;
   IdentifiedStructTypeSet IdentifiedStructTypes;
   MDMapT SharedMDs; ///< A Metadata map to use for all calls to \a move().
+
+  bool InBatch = false;
+  unsigned NumBatchMoves = 0;
+  unsigned NextBatchCleanup = 1;
+  AppendingPiecesT AppendingPieces;
+
+  bool FoundCompositeCycles = false;
+  MetadataCycleMapT MetadataCycles;
 };
 
 } // End llvm namespace
@@ -51,6 +51,17 @@ public:
 
   static bool linkModules(Module &Dest, std::unique_ptr<Module> Src,
                           unsigned Flags = Flags::None);
+
+  /// \brief Start linking many modules with \a linkInModule().
+  ///
+  /// Work that each link would otherwise repeat over the whole composite is
+  /// done once for all of them, which keeps linking thousands of modules
+  /// linear. The composite is not complete until \a finishBatch() is called.
+  /// See \a IRMover::startBatch().
+  void startBatch() { Mover.startBatch(); }
+
+  /// \brief Finish the batch started by \a startBatch().
+  void finishBatch() { Mover.finishBatch(); }
 };
 
 } // End llvm namespace
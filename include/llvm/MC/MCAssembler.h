@@ -10,6 +10,7 @@
 #ifndef LLVM_MC_MCASSEMBLER_H
 #define LLVM_MC_MCASSEMBLER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/ilist.h"
 #include "llvm/ADT/ilist_node.h"
@@ -147,6 +148,36 @@ private:
 
   VersionMinInfoType VersionMinInfo;
 
+  /// The range of fragments, in layout order, whose sizes the relaxation of a
+  /// relaxable fragment depended on when it was last checked.
+  struct RelaxationDeps {
+    unsigned First;
+    unsigned Last;
+    /// Whether there is an align or org fragment in [First, Last], whose size
+    /// can change when the whole range moves.
+    bool HasOffsetDependentFragment;
+    /// False if the relaxation may depend on anything outside of the section.
+    bool IsSectionLocal;
+  };
+
+  /// \name Incremental Relaxation State
+  ///
+  /// These are only valid during layout(). A relaxable fragment is only
+  /// checked again if a fragment it depends on changed size in the previous
+  /// relaxation pass over its section.
+  /// @{
+
+  DenseMap<const MCRelaxableFragment *, RelaxationDeps> FragmentDeps;
+
+  /// The layout orders of the fragments of each section that changed size in
+  /// the last relaxation pass over it.
+  DenseMap<const MCSection *, std::vector<unsigned>> ChangedFragments;
+
+  /// The layout orders of the align and org fragments of each section.
+  DenseMap<const MCSection *, std::vector<unsigned>> OffsetDependentFragments;
+
+  /// @}
+
 private:
   /// Evaluate a fixup to a relocatable expression and the value which should be
   /// placed into the fixup.
@@ -167,12 +198,24 @@ private:
 
   /// Check whether a fixup can be satisfied, or whether it needs to be relaxed
   /// (increased in size, in order to hold its value correctly).
+  ///
+  /// \param Deps [in,out] If non-null, the fragments the fixup depends on are
+  /// added to it.
   bool fixupNeedsRelaxation(const MCFixup &Fixup, const MCRelaxableFragment *DF,
-                            const MCAsmLayout &Layout) const;
+                            const MCAsmLayout &Layout,
+                            RelaxationDeps *Deps = nullptr) const;
 
   /// Check whether the given fragment needs relaxation.
+  ///
+  /// \param Deps [out] If non-null and the fragment doesn't need relaxation,
+  /// set to the fragments the result depends on.
   bool fragmentNeedsRelaxation(const MCRelaxableFragment *IF,
-                               const MCAsmLayout &Layout) const;
+                               const MCAsmLayout &Layout,
+                               RelaxationDeps *Deps = nullptr) const;
+
+  /// Check whether the given fragment has to be checked for relaxation again,
+  /// based on the fragments that changed size in the last relaxation pass.
+  bool fragmentNeedsRelaxationCheck(const MCRelaxableFragment &IF) const;
 
   /// \brief Perform one layout iteration and return true if any offsets
   /// were adjusted.
@@ -48,6 +48,12 @@ namespace llvm {
   /// Context object for machine code objects.  This class owns all of the
   /// sections that it creates.
   ///
+  /// A context must only be used by one thread at a time. Separate contexts
+  /// have no shared mutable state, so several objects can be emitted in
+  /// parallel by giving each thread its own context, object file info and
+  /// streamer. The MCAsmInfo, MCRegisterInfo and MCSubtargetInfo can be shared
+  /// between the contexts as long as they aren't modified.
+  ///
   class MCContext {
     MCContext(const MCContext &) = delete;
     MCContext &operator=(const MCContext &) = delete;
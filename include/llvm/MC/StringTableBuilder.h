@@ -28,7 +28,7 @@ private:
   Kind K;
   unsigned Alignment;
 
-  void finalizeStringTable(bool Optimize);
+  void finalizeStringTable(bool Optimize, unsigned NumThreads);
 
 public:
   StringTableBuilder(Kind K, unsigned Alignment = 1);
@@ -40,7 +40,11 @@ public:
 
   /// \brief Analyze the strings and build the final table. No more strings can
   /// be added after this point.
-  void finalize();
+  ///
+  /// The strings are sorted for tail merging with the parallel algorithms of
+  /// llvm/Support/Parallel.h, unless \p NumThreads is 1. The table is the same
+  /// for any number of threads.
+  void finalize(unsigned NumThreads = 1);
 
   /// Finalize the string table without reording it. In this mode, offsets
   /// returned by add will still be valid.
@@ -14,6 +14,8 @@
 #ifndef LLVM_OBJECT_ARCHIVE_H
 #define LLVM_OBJECT_ARCHIVE_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Object/Binary.h"
@@ -21,6 +23,7 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include <mutex>
 
 namespace llvm {
 namespace object {
@@ -209,6 +212,11 @@ public:
   // check if a symbol is in the archive
   child_iterator findSym(StringRef name) const;
 
+  /// Find the members that define each of \p Names. On return, \p Members
+  /// holds the member for each name, or child_end() if no member defines it.
+  void findSyms(ArrayRef<StringRef> Names,
+                std::vector<child_iterator> &Members) const;
+
   bool hasSymbolTable() const;
   StringRef getSymbolTable() const { return SymbolTable; }
   uint32_t getNumberOfSymbols() const;
@@ -228,6 +236,13 @@ private:
   unsigned Format : 2;
   unsigned IsThin : 1;
   mutable std::vector<std::unique_ptr<MemoryBuffer>> ThinBuffers;
+
+  /// Maps each name in the symbol table to its first entry. It is built the
+  /// first time a symbol is looked up, so that lookups don't have to scan the
+  /// whole symbol table.
+  mutable std::unique_ptr<StringMap<Symbol>> SymbolIndex;
+  mutable std::once_flag SymbolIndexFlag;
+  const StringMap<Symbol> &getSymbolIndex() const;
 };
 
 }
@@ -39,10 +39,18 @@ public:
   const sys::fs::file_status &getStatus() const;
 };
 
+/// Write an archive with the members \p NewMembers to \p ArcName.
+///
+/// \param ReuseOldSymbols If set, the symbol table entries for the members
+/// that are kept from an existing archive are taken from the symbol table of
+/// that archive rather than computed by reading the members.
+/// \param NumThreads The number of threads to read the other members for the
+/// symbol table on, or 0 for one per hardware thread.
 std::pair<StringRef, std::error_code>
 writeArchive(StringRef ArcName, std::vector<NewArchiveIterator> &NewMembers,
              bool WriteSymtab, object::Archive::Kind Kind, bool Deterministic,
-             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr);
+             bool Thin, std::unique_ptr<MemoryBuffer> OldArchiveBuf = nullptr,
+             bool ReuseOldSymbols = false, unsigned NumThreads = 1);
 }
 
 #endif
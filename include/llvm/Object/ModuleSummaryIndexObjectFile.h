@@ -94,7 +94,8 @@ public:
 }
 
 /// Parse the module summary index out of an IR file and return the module
-/// summary index object if found, or nullptr if not.
+/// summary index object if found, or nullptr if not. The file can also be a
+/// summary index table, whose summaries are then read as they are looked up.
 ErrorOr<std::unique_ptr<ModuleSummaryIndex>>
 getModuleSummaryIndexForFile(StringRef Path,
                              DiagnosticHandlerFunction DiagnosticHandler);
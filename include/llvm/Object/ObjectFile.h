@@ -21,6 +21,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include <cstring>
+#include <memory>
 
 namespace llvm {
 namespace object {
@@ -178,6 +179,11 @@ class ObjectFile : public SymbolicFile {
   ObjectFile() = delete;
   ObjectFile(const ObjectFile &other) = delete;
 
+  /// The lookup indexes of the symbols, built on demand.
+  struct SymbolIndex;
+  mutable std::unique_ptr<SymbolIndex> Index;
+  SymbolIndex &getSymbolIndex() const;
+
 protected:
   ObjectFile(unsigned int Type, MemoryBufferRef Source);
 
@@ -238,6 +244,8 @@ protected:
   uint64_t getSymbolValue(DataRefImpl Symb) const;
 
 public:
+  ~ObjectFile() override;
+
   uint64_t getCommonSymbolSize(DataRefImpl Symb) const {
     assert(getSymbolFlags(Symb) & SymbolRef::SF_Common);
     return getCommonSymbolSizeImpl(Symb);
@@ -256,6 +264,23 @@ public:
     return section_iterator_range(section_begin(), section_end());
   }
 
+  /// @brief Return the symbol named \p Name, or symbol_end() if there is none.
+  /// A defined symbol is preferred to an undefined one, then a global symbol
+  /// to a local one, then the first one in the symbol table.
+  ///
+  /// The first lookup builds a hash table of the symbol names, which the
+  /// later ones reuse. The indexes of the symbols are not built thread-safely.
+  /// Formats with a lookup table of their own can override this.
+  virtual symbol_iterator findSymbol(StringRef Name) const;
+
+  /// @brief Return the defined symbol with the highest address not above
+  /// \p Address, or symbol_end() if there is none. Of several symbols at that
+  /// address, the first one in the symbol table is returned. The symbol does
+  /// not necessarily contain \p Address: callers check its size if needed.
+  ///
+  /// The first lookup builds a table of the symbols sorted by address.
+  virtual symbol_iterator findSymbolByAddress(uint64_t Address) const;
+
   /// @brief The number of bytes used to represent an address in this object
   ///        file format.
   virtual uint8_t getBytesInAddress() const = 0;
@@ -60,6 +60,9 @@ private:
   /// special option like 'input' or 'unknown', and is not an option group).
   unsigned FirstSearchableIndex;
 
+  /// The length of the longest name of a searchable option.
+  size_t MaxOptionNameLength;
+
   /// The union of all option prefixes. If an argument does not begin with
   /// one of these, it is an input.
   StringSet<> PrefixesUnion;
@@ -175,6 +175,10 @@ public:
   /// check state of analysis information.
   virtual void verifyAnalysis() const;
 
+  /// getMemoryUsage() - This member can be implemented by a pass to report the
+  /// number of bytes that it holds on to, for the -memory-report option.
+  virtual size_t getMemoryUsage() const;
+
   // dumpPassStructure - Implement the -debug-passes=PassStructure option
   virtual void dumpPassStructure(unsigned Offset = 0);
 
@@ -375,6 +379,11 @@ protected:
 /// @brief This is the storage for the -time-passes option.
 extern bool TimePassesIsEnabled;
 
+/// If the user specifies the -memory-report argument on an LLVM tool command
+/// line then the value of this boolean will be true, otherwise false.
+/// @brief This is the storage for the -memory-report option.
+extern bool MemoryReportIsEnabled;
+
 /// isFunctionInPrintList - returns true if a function should be printed via
 //  debugging options like -print-after-all/-print-before-all.
 //  @brief Tells if the function IR should be printed by PrinterPass.
@@ -275,13 +275,19 @@ struct CountedRegion : public CounterMappingRegion {
 class CounterMappingContext {
   ArrayRef<CounterExpression> Expressions;
   ArrayRef<uint64_t> CounterValues;
+  /// The values of the expressions that have been evaluated, as expressions
+  /// can share subexpressions.
+  mutable DenseMap<unsigned, int64_t> ExpressionValues;
 
 public:
   CounterMappingContext(ArrayRef<CounterExpression> Expressions,
                         ArrayRef<uint64_t> CounterValues = None)
       : Expressions(Expressions), CounterValues(CounterValues) {}
 
-  void setCounts(ArrayRef<uint64_t> Counts) { CounterValues = Counts; }
+  void setCounts(ArrayRef<uint64_t> Counts) {
+    CounterValues = Counts;
+    ExpressionValues.clear();
+  }
 
   void dump(const Counter &C, llvm::raw_ostream &OS) const;
   void dump(const Counter &C) const { dump(C, dbgs()); }
@@ -447,6 +453,21 @@ public:
   load(StringRef ObjectFilename, StringRef ProfileFilename,
        StringRef Arch = StringRef());
 
+  /// \brief Load the coverage mapping of the functions that reference
+  /// \p Filename only, using the given readers.
+  ///
+  /// This is much faster than load() for queries about a single file, as the
+  /// readers that index their records by file do not decode the others.
+  static Expected<std::unique_ptr<CoverageMapping>>
+  loadForFile(CoverageMappingReader &CoverageReader,
+              IndexedInstrProfReader &ProfileReader, StringRef Filename);
+
+  /// \brief Load the coverage mapping of the functions that reference
+  /// \p Filename only, from the given files.
+  static Expected<std::unique_ptr<CoverageMapping>>
+  loadForFile(StringRef ObjectFilename, StringRef ProfileFilename,
+              StringRef Filename, StringRef Arch = StringRef());
+
   /// \brief The number of functions that couldn't have their profiles mapped.
   ///
   /// This is a count of functions whose profile is out of date or otherwise
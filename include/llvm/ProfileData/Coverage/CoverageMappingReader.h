@@ -16,6 +16,7 @@
 #define LLVM_PROFILEDATA_COVERAGEMAPPINGREADER_H
 
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Object/ObjectFile.h"
@@ -70,6 +71,14 @@ public:
 class CoverageMappingReader {
 public:
   virtual Error readNextRecord(CoverageMappingRecord &Record) = 0;
+
+  /// \brief Restart the records from the first one, and only return those
+  /// that reference \p Filename.
+  ///
+  /// The readers that do not index their records by file ignore this, and
+  /// keep returning all the records.
+  virtual Error setFileFilter(StringRef Filename) { return Error::success(); }
+
   CoverageMappingIterator begin() { return CoverageMappingIterator(this); }
   CoverageMappingIterator end() { return CoverageMappingIterator(); }
   virtual ~CoverageMappingReader() {}
@@ -137,6 +146,9 @@ public:
 
   Error read();
 
+  /// \brief Only read the names of the files that the mapping references.
+  Error readFilenames();
+
 private:
   Error decodeCounter(unsigned Value, Counter &C);
   Error readCounter(Counter &C);
@@ -173,11 +185,21 @@ private:
   std::vector<StringRef> FunctionsFilenames;
   std::vector<CounterExpression> Expressions;
   std::vector<CounterMappingRegion> MappingRegions;
+  /// The indices of the records that reference each file, which is built on
+  /// the first call to setFileFilter.
+  StringMap<std::vector<unsigned>> FileRecords;
+  bool HasFileRecords;
+  /// The records that readNextRecord returns, or null for all of them.
+  const std::vector<unsigned> *FilteredRecords;
 
   BinaryCoverageReader(const BinaryCoverageReader &) = delete;
   BinaryCoverageReader &operator=(const BinaryCoverageReader &) = delete;
 
-  BinaryCoverageReader() : CurrentRecord(0) {}
+  BinaryCoverageReader()
+      : CurrentRecord(0), HasFileRecords(false), FilteredRecords(nullptr) {}
+
+  /// \brief Build the index of the records that reference each file.
+  Error buildFileRecords();
 
 public:
   static Expected<std::unique_ptr<BinaryCoverageReader>>
@@ -185,6 +207,8 @@ public:
          StringRef Arch);
 
   Error readNextRecord(CoverageMappingRecord &Record) override;
+
+  Error setFileFilter(StringRef Filename) override;
 };
 
 } // end namespace coverage
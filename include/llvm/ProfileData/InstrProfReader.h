@@ -365,6 +365,8 @@ private:
   std::unique_ptr<InstrProfReaderIndexBase> Index;
   /// Profile summary data.
   std::unique_ptr<ProfileSummary> Summary;
+  /// Index of the next record to return from the current key.
+  unsigned RecordIndex;
 
   IndexedInstrProfReader(const IndexedInstrProfReader &) = delete;
   IndexedInstrProfReader &operator=(const IndexedInstrProfReader &) = delete;
@@ -379,7 +381,7 @@ public:
   uint64_t getVersion() const { return Index->getVersion(); }
   bool isIRLevelProfile() const override { return Index->isIRLevelProfile(); }
   IndexedInstrProfReader(std::unique_ptr<MemoryBuffer> DataBuffer)
-      : DataBuffer(std::move(DataBuffer)), Index(nullptr) {}
+      : DataBuffer(std::move(DataBuffer)), Index(nullptr), RecordIndex(0) {}
 
   /// Return true if the given buffer is in an indexed instrprof format.
   static bool hasFormat(const MemoryBuffer &DataBuffer);
@@ -390,7 +392,8 @@ public:
   Error readNextRecord(InstrProfRecord &Record) override;
 
   /// Return the pointer to InstrProfRecord associated with FuncName
-  /// and FuncHash
+  /// and FuncHash. The records are decoded from the on-disk hash table on
+  /// each query; nothing is decoded ahead of time.
   Expected<InstrProfRecord> getInstrProfRecord(StringRef FuncName,
                                                uint64_t FuncHash);
 
@@ -401,7 +404,8 @@ public:
   /// Return the maximum of all known function counts.
   uint64_t getMaximumFunctionCount() { return Summary->getMaxFunctionCount(); }
 
-  /// Factory method to create an indexed reader.
+  /// Factory method to create an indexed reader. The file is memory mapped,
+  /// so the resident memory is proportional to the records queried.
   static Expected<std::unique_ptr<IndexedInstrProfReader>>
   create(const Twine &Path);
 
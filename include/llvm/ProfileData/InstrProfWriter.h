@@ -16,6 +16,7 @@
 #define LLVM_PROFILEDATA_INSTRPROFWRITER_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -47,6 +48,15 @@ public:
   /// for this function and the hash and number of counts match, each counter is
   /// summed. Optionally scale counts by \p Weight.
   Error addRecord(InstrProfRecord &&I, uint64_t Weight = 1);
+
+  /// Merge existing function counts from the given writer into this one.
+  /// Records are moved out of \p IPW, which is left in an unspecified state.
+  /// Soft errors encountered while merging individual records are reported
+  /// through \p Warn. Returns an error if the two writers hold profiles of
+  /// incompatible kinds.
+  Error mergeRecordsFromWriter(InstrProfWriter &&IPW,
+                               function_ref<void(Error)> Warn);
+
   /// Write the profile to \c OS
   void write(raw_fd_ostream &OS);
   /// Write the profile in text format to \c OS
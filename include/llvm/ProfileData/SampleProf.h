@@ -15,6 +15,7 @@
 #ifndef LLVM_PROFILEDATA_SAMPLEPROF_H_
 #define LLVM_PROFILEDATA_SAMPLEPROF_H_
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
@@ -74,6 +75,14 @@ static inline uint64_t SPMagic() {
          uint64_t('2') << (64 - 56) | uint64_t(0xff);
 }
 
+/// The file identifier of the extended binary format.
+static inline uint64_t SPExtMagic() {
+  return uint64_t('S') << (64 - 8) | uint64_t('P') << (64 - 16) |
+         uint64_t('R') << (64 - 24) | uint64_t('O') << (64 - 32) |
+         uint64_t('F') << (64 - 40) | uint64_t('X') << (64 - 48) |
+         uint64_t('T') << (64 - 56) | uint64_t(0xff);
+}
+
 static inline uint64_t SPVersion() { return 103; }
 
 /// Represents the relative location of an instruction.
@@ -323,6 +332,51 @@ private:
 
 raw_ostream &operator<<(raw_ostream &OS, const FunctionSamples &FS);
 
+/// Representation of the calling context of a context-sensitive profile.
+///
+/// Besides the profiles of functions, a profile may contain profiles of
+/// functions in a given calling context, whatever was inlined in the
+/// profiled binary. Such a profile is named after its context. For example,
+/// "[main:3 @ _Z3foov:2.1 @ _Z3barv]" holds the samples collected in bar
+/// when it was called by foo at line offset 2, discriminator 1, while foo
+/// was called by main at line offset 3. The samples of the other calls to
+/// bar are in the profile of bar.
+class SampleContext {
+public:
+  /// A caller in the context, and the location of its call to the next
+  /// function of the context.
+  struct CallerFrame {
+    CallerFrame(StringRef Name, LineLocation CallSite)
+        : FuncName(Name), CallSite(CallSite) {}
+
+    StringRef FuncName;
+    LineLocation CallSite;
+  };
+
+  /// Return true if \p Name is the name of a calling context rather than of
+  /// a function.
+  static bool isContext(StringRef Name) { return Name.startswith("["); }
+
+  /// Parse the calling context \p Name. The context refers to the storage of
+  /// \p Name. Return false if \p Name is malformed.
+  bool parse(StringRef Name);
+
+  /// Return the callers of the context, from the outermost one.
+  ArrayRef<CallerFrame> getCallers() const { return Callers; }
+
+  /// Return the function the context is the calling context of.
+  StringRef getCallee() const { return Callee; }
+
+  void print(raw_ostream &OS) const;
+  void dump() const;
+
+private:
+  SmallVector<CallerFrame, 4> Callers;
+  StringRef Callee;
+};
+
+raw_ostream &operator<<(raw_ostream &OS, const SampleContext &Context);
+
 /// Sort a LocationT->SampleT map by LocationT.
 ///
 /// It produces a sorted list of <LocationT, SampleT> records by ascending
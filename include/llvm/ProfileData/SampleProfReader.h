@@ -48,6 +48,16 @@
 // in the prologue of the function (second number). This head sample
 // count provides an indicator of how frequently the function is invoked.
 //
+// A section may also hold the samples of a function in a given calling
+// context, whether or not its callers were inlined in the profiled binary.
+// Its header names the context instead of the function:
+//
+//     [caller1:offset1[.discriminator] @ caller2:offset2 @ function]:total:head
+//
+// The callers are listed from the outermost one, with the location of their
+// call to the next function. The samples of the calls to the function in
+// other contexts are in the section of the function itself.
+//
 // There are two types of lines in the function body.
 //
 // * Sampled line represents the profile information of a source location.
@@ -204,10 +214,54 @@
 //          in the text format documentation above).
 //        FUNCTION BODY
 //          A FUNCTION BODY entry describing the inlined function.
+//
+//
+// Extended binary format
+// ----------------------
+//
+// This is the binary format with an index of the function bodies, so that a
+// compilation only decodes the profiles of the functions that it defines.
+// The file is organized in the following sections:
+//
+// MAGIC (uint64_t)
+//    File identifier computed by function SPExtMagic() (0x5350524f465854ff)
+//
+// VERSION (uint32_t)
+//    File format version number computed by SPVersion()
+//
+// SUMMARY
+//    Same as in the binary format.
+//
+// NAME TABLE
+//    SIZE (uint32_t)
+//        Number of entries in the name table.
+//    NAMES
+//        A list of SIZE names sorted alphabetically, each of them encoded
+//        relative to the previous one (mangled names tend to share long
+//        prefixes):
+//          PREFIX_LENGTH (uint32_t)
+//              Number of leading characters shared with the previous name.
+//          SUFFIX
+//              The rest of the name, NUL-terminated.
+//
+// FUNCTION OFFSET TABLE
+//    SIZE (uint64_t)
+//        Number of top-level functions in the profile.
+//    ENTRIES
+//        A list of SIZE entries. Each entry contains:
+//          NAME_IDX (uint32_t)
+//              Index into the name table indicating the function name.
+//          OFFSET (uint64_t)
+//              Offset of the function from the start of the function bodies.
+//
+// FUNCTION BODIES
+//    One for each top-level function, encoded as in the binary format,
+//    HEAD_SAMPLES included.
 //===----------------------------------------------------------------------===//
 #ifndef LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 #define LLVM_PROFILEDATA_SAMPLEPROFREADER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
@@ -221,6 +275,7 @@
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/GCOV.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
@@ -253,7 +308,9 @@ namespace sampleprof {
 ///
 /// The reader supports two file formats: text and binary. The text format
 /// is useful for debugging and testing, while the binary format is more
-/// compact and I/O efficient. They can both be used interchangeably.
+/// compact and I/O efficient. They can both be used interchangeably. The
+/// extended binary format adds an index to the binary format, so that only
+/// the profiles that a module needs are decoded.
 class SampleProfileReader {
 public:
   SampleProfileReader(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
@@ -267,6 +324,11 @@ public:
   /// \brief Read sample profiles from the associated file.
   virtual std::error_code read() = 0;
 
+  /// \brief Read the sample profiles of the functions defined in \p M.
+  ///
+  /// The formats without an index of the functions read all the profiles.
+  virtual std::error_code readProfilesFor(const Module &M) { return read(); }
+
   /// \brief Print the profile for \p FName on stream \p OS.
   void dumpFunctionProfile(StringRef FName, raw_ostream &OS = dbgs());
 
@@ -281,6 +343,16 @@ public:
   /// \brief Return all the profiles.
   StringMap<FunctionSamples> &getProfiles() { return Profiles; }
 
+  /// \brief Move the profiles of calling contexts into the profiles of their
+  /// outermost callers.
+  ///
+  /// The profile of "[main:3 @ foo:2 @ bar]" becomes the samples of bar
+  /// inlined at line offset 2 of foo, itself inlined at line offset 3 of
+  /// main, as if these calls had been inlined in the profiled binary. The
+  /// sample profile loader then inlines and annotates the hot contexts like
+  /// the inline instances of the profile.
+  std::error_code mergeContextProfiles();
+
   /// \brief Report a parse error message.
   void reportError(int64_t LineNumber, Twine Msg) const {
     Ctx.diagnose(DiagnosticInfoSampleProfile(Buffer->getBufferIdentifier(),
@@ -374,6 +446,16 @@ protected:
   /// Read the contents of the given profile instance.
   std::error_code readProfile(FunctionSamples &FProfile);
 
+  /// Read the head samples and the contents of a top-level function profile.
+  std::error_code readFuncProfile();
+
+  /// \brief Read the magic identifier \p ExpectedMagic, the version number
+  /// and the profile summary.
+  std::error_code readPreamble(uint64_t ExpectedMagic);
+
+  /// \brief Read profile summary.
+  std::error_code readSummary();
+
   /// \brief Points to the current location in the buffer.
   const uint8_t *Data;
 
@@ -385,9 +467,43 @@ protected:
 
 private:
   std::error_code readSummaryEntry(std::vector<ProfileSummaryEntry> &Entries);
+};
 
-  /// \brief Read profile summary.
-  std::error_code readSummary();
+class SampleProfileReaderExtBinary : public SampleProfileReaderBinary {
+public:
+  SampleProfileReaderExtBinary(std::unique_ptr<MemoryBuffer> B, LLVMContext &C)
+      : SampleProfileReaderBinary(std::move(B), C), Saver(Allocator),
+        FuncBodies(nullptr) {}
+
+  /// \brief Read and validate the file header and the function offset table.
+  std::error_code readHeader() override;
+
+  /// \brief Read all the sample profiles of the file.
+  std::error_code read() override;
+
+  /// \brief Read the sample profiles of the functions defined in \p M only.
+  std::error_code readProfilesFor(const Module &M) override;
+
+  /// \brief Return true if \p Buffer is in the format supported by this class.
+  static bool hasFormat(const MemoryBuffer &Buffer);
+
+private:
+  /// \brief Read the prefix-compressed name table.
+  std::error_code readNameTable();
+
+  /// \brief Read the profile of the function at \p Offset in the function
+  /// bodies.
+  std::error_code readFuncProfileAt(uint64_t Offset);
+
+  /// Storage of the names, which are not contiguous in the file.
+  BumpPtrAllocator Allocator;
+  StringSaver Saver;
+
+  /// \brief Points to the start of the function bodies.
+  const uint8_t *FuncBodies;
+
+  /// The offset of the profile of each top-level function.
+  DenseMap<StringRef, uint64_t> FuncOffsets;
 };
 
 typedef SmallVector<FunctionSamples *, 10> InlineCallStack;
@@ -25,7 +25,13 @@ namespace llvm {
 
 namespace sampleprof {
 
-enum SampleProfileFormat { SPF_None = 0, SPF_Text, SPF_Binary, SPF_GCC };
+enum SampleProfileFormat {
+  SPF_None = 0,
+  SPF_Text,
+  SPF_Binary,
+  SPF_GCC,
+  SPF_Ext_Binary
+};
 
 /// \brief Sample-based profile writer. Base class.
 class SampleProfileWriter {
@@ -40,7 +46,8 @@ public:
   /// Write all the sample profiles in the given map of samples.
   ///
   /// \returns status code of the file update operation.
-  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) {
+  virtual std::error_code
+  write(const StringMap<FunctionSamples> &ProfileMap) {
     if (std::error_code EC = writeHeader(ProfileMap))
       return EC;
     for (const auto &I : ProfileMap) {
@@ -122,12 +129,34 @@ protected:
   std::error_code writeNameIdx(StringRef FName);
   std::error_code writeBody(const FunctionSamples &S);
 
-private:
   void addName(StringRef FName);
   void addNames(const FunctionSamples &S);
 
   MapVector<StringRef, uint32_t> NameTable;
 
+private:
+  friend ErrorOr<std::unique_ptr<SampleProfileWriter>>
+  SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
+                              SampleProfileFormat Format);
+};
+
+/// \brief Sample-based profile writer (extended binary format).
+///
+/// The function bodies are indexed by a table written before them, so the
+/// profiles can only be written all at once.
+class SampleProfileWriterExtBinary : public SampleProfileWriterBinary {
+public:
+  using SampleProfileWriterBinary::write;
+  std::error_code write(const StringMap<FunctionSamples> &ProfileMap) override;
+
+protected:
+  SampleProfileWriterExtBinary(std::unique_ptr<raw_ostream> &OS)
+      : SampleProfileWriterBinary(OS) {}
+
+  std::error_code
+  writeHeader(const StringMap<FunctionSamples> &ProfileMap) override;
+
+private:
   friend ErrorOr<std::unique_ptr<SampleProfileWriter>>
   SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
                               SampleProfileFormat Format);
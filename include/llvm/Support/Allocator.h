@@ -108,6 +108,73 @@ public:
   void PrintStats() const {}
 };
 
+/// \brief A cache of freed slabs that bump pointer allocators can reuse
+/// instead of going back to malloc.
+///
+/// Each thread has its own cache, so taking and returning slabs needs no
+/// locking. Only slabs whose size is a power of two between 4 KB and 1 MB are
+/// cached; other sizes go straight to malloc and free. A thread keeps at most
+/// getThreadCacheLimit() bytes of free slabs and frees the rest. The slabs
+/// cached by a thread are not released when it exits unless it calls
+/// releaseThreadCache().
+class SlabPool {
+public:
+  struct Statistics {
+    /// Slabs that were taken from a cache.
+    uint64_t Hits;
+    /// Slabs of a cached size that had to be allocated with malloc.
+    uint64_t Misses;
+    /// Slabs that were put in a cache.
+    uint64_t Recycled;
+    /// Slabs of a cached size that were freed because the cache was full.
+    uint64_t Released;
+  };
+
+  /// Return \p Size bytes of memory, reusing a cached slab if there is one.
+  static void *allocate(size_t Size);
+
+  /// Return the \p Size bytes at \p Ptr, which came from allocate(), to the
+  /// calling thread's cache.
+  static void deallocate(const void *Ptr, size_t Size);
+
+  /// Free all slabs in the calling thread's cache.
+  static void releaseThreadCache();
+
+  /// Return the number of bytes in the calling thread's cache.
+  static size_t getThreadCacheSize();
+
+  /// Set the maximum number of bytes each thread caches.
+  static void setThreadCacheLimit(size_t Bytes);
+  static size_t getThreadCacheLimit();
+
+  /// Return the counters of all threads.
+  static Statistics getStatistics();
+};
+
+/// \brief An allocator that takes its memory from the SlabPool, for use as the
+/// slab allocator of a BumpPtrAllocatorImpl.
+class SlabPoolAllocator : public AllocatorBase<SlabPoolAllocator> {
+public:
+  void Reset() {}
+
+  LLVM_ATTRIBUTE_RETURNS_NONNULL void *Allocate(size_t Size,
+                                                size_t /*Alignment*/) {
+    return SlabPool::allocate(Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<SlabPoolAllocator>::Allocate;
+
+  void Deallocate(const void *Ptr, size_t Size) {
+    SlabPool::deallocate(Ptr, Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<SlabPoolAllocator>::Deallocate;
+
+  void PrintStats() const {}
+};
+
 namespace detail {
 
 // We call out to an external function to actually print the message as the
@@ -264,11 +331,31 @@ public:
     __asan_poison_memory_region(Ptr, Size);
   }
 
+  /// \brief Grow the memory of \a Size bytes at \a Ptr to \a NewSize bytes,
+  /// if it is the last memory allocated from the current slab and the slab
+  /// has room for it.
+  ///
+  /// \returns true if the memory was grown, false if nothing changed.
+  bool tryGrowInPlace(const void *Ptr, size_t Size, size_t NewSize) {
+    assert(NewSize >= Size && "Cannot shrink memory");
+    size_t Growth = NewSize - Size;
+    if (static_cast<const char *>(Ptr) + Size != CurPtr ||
+        Growth > size_t(End - CurPtr))
+      return false;
+    BytesAllocated += Growth;
+    __msan_allocated_memory(CurPtr, Growth);
+    __asan_unpoison_memory_region(CurPtr, Growth);
+    CurPtr += Growth;
+    return true;
+  }
+
   // Pull in base class overloads.
   using AllocatorBase<BumpPtrAllocatorImpl>::Deallocate;
 
   size_t GetNumSlabs() const { return Slabs.size() + CustomSizedSlabs.size(); }
 
+  size_t getBytesAllocated() const { return BytesAllocated; }
+
   size_t getTotalMemory() const {
     size_t TotalMemory = 0;
     for (auto I = Slabs.begin(), E = Slabs.end(); I != E; ++I)
@@ -348,20 +435,29 @@ private:
     }
   }
 
-  template <typename T> friend class SpecificBumpPtrAllocator;
+  template <typename T, typename SlabAllocatorT>
+  friend class SpecificBumpPtrAllocator;
 };
 
 /// \brief The standard BumpPtrAllocator which just uses the default template
 /// paramaters.
 typedef BumpPtrAllocatorImpl<> BumpPtrAllocator;
 
+/// \brief A BumpPtrAllocator whose slabs come from and go back to the
+/// SlabPool. Use it for allocators that are created and destroyed often, such
+/// as one per function or module.
+typedef BumpPtrAllocatorImpl<SlabPoolAllocator> PooledBumpPtrAllocator;
+
 /// \brief A BumpPtrAllocator that allows only elements of a specific type to be
 /// allocated.
 ///
 /// This allows calling the destructor in DestroyAll() and when the allocator is
-/// destroyed.
-template <typename T> class SpecificBumpPtrAllocator {
-  BumpPtrAllocator Allocator;
+/// destroyed. Pass SlabPoolAllocator as \p SlabAllocatorT to take the slabs
+/// from the SlabPool.
+template <typename T, typename SlabAllocatorT = MallocAllocator>
+class SpecificBumpPtrAllocator {
+  typedef BumpPtrAllocatorImpl<SlabAllocatorT> AllocatorT;
+  AllocatorT Allocator;
 
 public:
   SpecificBumpPtrAllocator() : Allocator() {}
@@ -386,7 +482,7 @@ public:
 
     for (auto I = Allocator.Slabs.begin(), E = Allocator.Slabs.end(); I != E;
          ++I) {
-      size_t AllocatedSlabSize = BumpPtrAllocator::computeSlabSize(
+      size_t AllocatedSlabSize = AllocatorT::computeSlabSize(
           std::distance(Allocator.Slabs.begin(), I));
       char *Begin = (char*)alignAddr(*I, alignOf<T>());
       char *End = *I == Allocator.Slabs.back() ? Allocator.CurPtr
@@ -405,7 +501,9 @@ public:
   }
 
   /// \brief Allocate space for an array of objects without constructing them.
-  T *Allocate(size_t num = 1) { return Allocator.Allocate<T>(num); }
+  T *Allocate(size_t num = 1) {
+    return Allocator.template Allocate<T>(num);
+  }
 };
 
 }  // end namespace llvm
@@ -16,6 +16,7 @@
 #define LLVM_SUPPORT_CACHE_PRUNING_H
 
 #include "llvm/ADT/StringRef.h"
+#include <cstdint>
 
 namespace llvm {
 
@@ -52,16 +53,57 @@ public:
     return *this;
   }
 
+  /// Define the maximum size for the cache directory in bytes. A value of 0
+  /// disables this limit. When both limits are set, the cache is pruned until
+  /// it honors both.
+  CachePruning &setMaxSizeBytes(uint64_t Bytes) {
+    MaxSizeBytes = Bytes;
+    return *this;
+  }
+
+  /// Track the entries in an index file of the cache directory instead of
+  /// scanning it. The index is updated from the journal that recordAccess
+  /// appends to, and the directory is only scanned to build the index when it
+  /// is missing, so an entry that is neither in the index nor recorded is not
+  /// pruned.
+  CachePruning &setUseIndex(bool Enable) {
+    UseIndex = Enable;
+    return *this;
+  }
+
   /// Peform pruning using the supplied options, returns true if pruning
   /// occured, i.e. if PruningInterval was expired.
   bool prune();
 
+  /// Record in the journal of the cache directory \p Path that its entry
+  /// \p EntryName of \p Size bytes was written or read now, for the pruning
+  /// with an index.
+  static void recordAccess(StringRef Path, StringRef EntryName, uint64_t Size);
+
+  /// Number of files removed by the last call to prune() because they had
+  /// expired.
+  unsigned getNumExpired() const { return NumExpired; }
+
+  /// Number of files removed by the last call to prune() to bring the cache
+  /// size below the limit.
+  unsigned getNumEvicted() const { return NumEvicted; }
+
 private:
   // Options that matches the setters above.
   std::string Path;
   unsigned Expiration = 0;
   unsigned Interval = 0;
   unsigned PercentageOfAvailableSpace = 0;
+  uint64_t MaxSizeBytes = 0;
+  bool UseIndex = false;
+
+  /// Prune the entries of the index, given the current time in seconds since
+  /// the epoch.
+  void pruneWithIndex(uint64_t Now);
+
+  // Results of the last pruning.
+  unsigned NumExpired = 0;
+  unsigned NumEvicted = 0;
 };
 
 } // namespace llvm
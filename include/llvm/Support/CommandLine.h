@@ -158,9 +158,11 @@ private:
   void registerCategory();
 
 public:
+  OptionCategory *NextPending; // Next category waiting to be registered.
+
   OptionCategory(const char *const Name,
                  const char *const Description = nullptr)
-      : Name(Name), Description(Description) {
+      : Name(Name), Description(Description), NextPending(nullptr) {
     registerCategory();
   }
   const char *getName() const { return Name; }
@@ -209,7 +211,8 @@ public:
   StringRef HelpStr;  // The descriptive text message for -help
   StringRef ValueStr; // String describing what the value of this option is
   OptionCategory *Category; // The Category this option belongs to
-  bool FullyInitialized;    // Has addArguemnt been called?
+  bool FullyInitialized;    // Has the option been added to the parser?
+  Option *NextPending;      // Next option waiting to be added to the parser.
 
   inline enum NumOccurrencesFlag getNumOccurrencesFlag() const {
     return (enum NumOccurrencesFlag)Occurrences;
@@ -250,12 +253,15 @@ protected:
       : NumOccurrences(0), Occurrences(OccurrencesFlag), Value(0),
         HiddenFlag(Hidden), Formatting(NormalFormatting), Misc(0), Position(0),
         AdditionalVals(0), ArgStr(""), HelpStr(""), ValueStr(""),
-        Category(&GeneralCategory), FullyInitialized(false) {}
+        Category(&GeneralCategory), FullyInitialized(false),
+        NextPending(nullptr) {}
 
   inline void setNumAdditionalVals(unsigned n) { AdditionalVals = n; }
 
 public:
-  // addArgument - Register this argument with the commandline system.
+  // addArgument - Register this argument with the commandline system. The
+  // option is added to the parser when the parser is first used, so that
+  // constructing options in static initializers stays cheap.
   //
   void addArgument();
 
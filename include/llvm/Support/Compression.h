@@ -14,6 +14,7 @@
 #ifndef LLVM_SUPPORT_COMPRESSION_H
 #define LLVM_SUPPORT_COMPRESSION_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/Support/DataTypes.h"
 
 namespace llvm {
@@ -43,10 +44,45 @@ bool isAvailable();
 Status compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
                 CompressionLevel Level = DefaultCompression);
 
+/// Compress \p InputBuffer into a zlib stream like compress(), on the threads
+/// of the parallel algorithms of llvm/Support/Parallel.h.  The input is split
+/// into blocks that are compressed independently, each with the end of the
+/// previous block as its dictionary, and whose raw deflate streams are
+/// concatenated, like pigz does.  The result is a standard zlib stream, and
+/// does not depend on the number of threads.  Inputs of a single block are
+/// compressed by compress().
+Status compressParallel(StringRef InputBuffer,
+                        SmallVectorImpl<char> &CompressedBuffer,
+                        CompressionLevel Level = DefaultCompression);
+
 Status uncompress(StringRef InputBuffer,
                   SmallVectorImpl<char> &UncompressedBuffer,
                   size_t UncompressedSize);
 
+/// Incremental decompression of a zlib stream, which the input and the output
+/// can be given to in pieces of any size, including over 4 GiB.
+class Decompressor {
+public:
+  Decompressor();
+  ~Decompressor();
+
+  Decompressor(const Decompressor &) = delete;
+  Decompressor &operator=(const Decompressor &) = delete;
+
+  /// Decompress the start of \p Input into \p Output, until the input is
+  /// consumed, the output is full or the stream ends.  The consumed input is
+  /// dropped from \p Input, and \p Written is set to the size of the output.
+  Status decompress(StringRef &Input, MutableArrayRef<char> Output,
+                    size_t &Written);
+
+  /// Return true if the end of the stream has been decompressed.
+  bool isFinished() const { return Finished; }
+
+private:
+  void *Stream;
+  bool Finished = false;
+};
+
 uint32_t crc32(StringRef Buffer);
 
 }  // End of namespace zlib
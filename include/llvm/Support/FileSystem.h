@@ -717,25 +717,38 @@ std::string getMainExecutable(const char *argv0, void *MainExecAddr);
 /// called.
 class directory_entry {
   std::string Path;
+  /// The type of the file, if the iteration syscall returned it.
+  file_type Type;
   mutable file_status Status;
 
 public:
   explicit directory_entry(const Twine &path, file_status st = file_status())
     : Path(path.str())
+    , Type(file_type::type_unknown)
     , Status(st) {}
 
-  directory_entry() {}
+  directory_entry() : Type(file_type::type_unknown) {}
 
   void assign(const Twine &path, file_status st = file_status()) {
     Path = path.str();
+    Type = file_type::type_unknown;
     Status = st;
   }
 
-  void replace_filename(const Twine &filename, file_status st = file_status());
+  void replace_filename(const Twine &filename, file_status st = file_status(),
+                        file_type type = file_type::type_unknown);
 
   const std::string &path() const { return Path; }
   std::error_code status(file_status &result) const;
 
+  /// Return the type of the file without calling stat if the iteration syscall
+  /// or a previous call to status gave it, or file_type::type_unknown.
+  file_type type() const {
+    if (Status.type() != file_type::status_error)
+      return Status.type();
+    return Type;
+  }
+
   bool operator==(const directory_entry& rhs) const { return Path == rhs.Path; }
   bool operator!=(const directory_entry& rhs) const { return !(*this == rhs); }
   bool operator< (const directory_entry& rhs) const;
@@ -755,13 +768,15 @@ namespace detail {
   /// counted in order to preserve InputIterator semantics on copy.
   struct DirIterState : public RefCountedBase<DirIterState> {
     DirIterState()
-      : IterationHandle(0) {}
+      : IterationHandle(0), FetchStatus(false) {}
 
     ~DirIterState() {
       directory_iterator_destruct(*this);
     }
 
     intptr_t IterationHandle;
+    /// Whether to get the status of each entry while iterating.
+    bool FetchStatus;
     directory_entry CurrentEntry;
   };
 } // end namespace detail
@@ -769,12 +784,18 @@ namespace detail {
 /// directory_iterator - Iterates through the entries in path. There is no
 /// operator++ because we need an error_code. If it's really needed we can make
 /// it call report_fatal_error on error.
+///
+/// If \p FetchStatus is true, the status of each entry is read while iterating,
+/// relative to the open directory where the platform supports it, which is
+/// cheaper than a stat of each path afterwards.
 class directory_iterator {
   IntrusiveRefCntPtr<detail::DirIterState> State;
 
 public:
-  explicit directory_iterator(const Twine &path, std::error_code &ec) {
+  explicit directory_iterator(const Twine &path, std::error_code &ec,
+                              bool FetchStatus = false) {
     State = new detail::DirIterState;
+    State->FetchStatus = FetchStatus;
     SmallString<128> path_storage;
     ec = detail::directory_iterator_construct(*State,
             path.toStringRef(path_storage));
@@ -848,9 +869,13 @@ public:
     if (State->HasNoPushRequest)
       State->HasNoPushRequest = false;
     else {
-      file_status st;
-      if ((ec = State->Stack.top()->status(st))) return *this;
-      if (is_directory(st)) {
+      file_type Type = State->Stack.top()->type();
+      if (Type == file_type::type_unknown) {
+        file_status st;
+        if ((ec = State->Stack.top()->status(st))) return *this;
+        Type = st.type();
+      }
+      if (Type == file_type::directory_file) {
         State->Stack.push(directory_iterator(*State->Stack.top(), ec));
         if (ec) return *this;
         if (State->Stack.top() != end_itr) {
@@ -0,0 +1,70 @@
+//===- llvm/Support/FileSystemStatCache.h - File status cache ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares FileSystemStatCache, an opt-in cache of the status of
+// paths, for clients that query the same paths repeatedly.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_FILESYSTEMSTATCACHE_H
+#define LLVM_SUPPORT_FILESYSTEMSTATCACHE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include <system_error>
+
+namespace llvm {
+namespace sys {
+namespace fs {
+
+/// \brief Caches the results of status, including its errors, by path.
+///
+/// The cache does not notice changes to the file system: a client that
+/// creates, removes or modifies a file must invalidate its path. Paths are
+/// compared as strings, so the different spellings of a path are cached
+/// separately. The cache is not thread safe.
+class FileSystemStatCache {
+  struct Entry {
+    std::error_code EC;
+    file_status Status;
+  };
+  StringMap<Entry> Entries;
+
+public:
+  /// \brief Same as fs::status, calling it on the first query of \p Path only.
+  std::error_code status(const Twine &Path, file_status &Result);
+
+  /// \brief Same as fs::exists.
+  bool exists(const Twine &Path);
+
+  /// \brief Same as fs::is_directory.
+  std::error_code is_directory(const Twine &Path, bool &Result);
+  bool is_directory(const Twine &Path);
+
+  /// \brief Same as fs::is_regular_file.
+  std::error_code is_regular_file(const Twine &Path, bool &Result);
+  bool is_regular_file(const Twine &Path);
+
+  /// \brief Record the status of \p Path, for example from a directory_entry.
+  void insert(const Twine &Path, file_status Status);
+
+  /// \brief Forget the status of \p Path, which changed.
+  void invalidate(const Twine &Path);
+
+  /// \brief Forget the status of all the paths.
+  void clear() { Entries.clear(); }
+
+  unsigned size() const { return Entries.size(); }
+};
+
+} // end namespace fs
+} // end namespace sys
+} // end namespace llvm
+
+#endif
@@ -18,6 +18,7 @@
 #ifndef LLVM_SUPPORT_GENERICDOMTREE_H
 #define LLVM_SUPPORT_GENERICDOMTREE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
 #include "llvm/ADT/GraphTraits.h"
@@ -610,6 +611,69 @@ public:
       this->Split<NodeT *, GraphTraits<NodeT *>>(*this, NewBB);
   }
 
+  /// The kind of change made to an edge of the CFG.
+  enum UpdateKind { Insert, Delete };
+
+  /// An edge that was inserted into or deleted from the CFG.
+  struct UpdateType {
+    UpdateKind Kind;
+    NodeT *From;
+    NodeT *To;
+  };
+
+  /// applyUpdates - Update the tree after the edges in \p Updates were
+  /// inserted into or deleted from the CFG, which must already reflect all of
+  /// them.
+  ///
+  /// Only nodes dominated by the nearest common dominator of the updated
+  /// edges can change, so just that subtree is recomputed. Batching all the
+  /// updates of a transformation is therefore cheaper than applying them one
+  /// at a time. The whole tree is recalculated if an inserted edge makes new
+  /// blocks reachable, and for post-dominator trees.
+  void applyUpdates(ArrayRef<UpdateType> Updates) {
+    if (Updates.empty())
+      return;
+
+    bool FromScratch = this->IsPostDominators;
+    DomTreeNodeBase<NodeT> *SubtreeRoot = nullptr;
+    for (const UpdateType &U : Updates) {
+      if (FromScratch)
+        break;
+      // Edges out of unreachable blocks don't change the tree.
+      if (!getNode(U.From))
+        continue;
+      if (!getNode(U.To)) {
+        FromScratch = U.Kind == Insert;
+        continue;
+      }
+      NodeT *NCD = findNearestCommonDominator(U.From, U.To);
+      if (SubtreeRoot)
+        NCD = findNearestCommonDominator(SubtreeRoot->getBlock(), NCD);
+      SubtreeRoot = getNode(NCD);
+    }
+
+    if (FromScratch || (SubtreeRoot && !SubtreeRoot->getIDom())) {
+      recalculate(*Updates.front().From->getParent());
+      return;
+    }
+    if (SubtreeRoot)
+      recalculateSubtree(SubtreeRoot);
+  }
+
+  /// insertEdge - Update the tree after the edge From->To was inserted into
+  /// the CFG.
+  void insertEdge(NodeT *From, NodeT *To) {
+    UpdateType U = {Insert, From, To};
+    applyUpdates(U);
+  }
+
+  /// deleteEdge - Update the tree after the edge From->To was deleted from
+  /// the CFG.
+  void deleteEdge(NodeT *From, NodeT *To) {
+    UpdateType U = {Delete, From, To};
+    applyUpdates(U);
+  }
+
   /// print - Convert to human readable form
   ///
   void print(raw_ostream &o) const {
@@ -628,6 +692,98 @@ public:
   }
 
 protected:
+  /// Recompute the immediate dominators of the nodes of the subtree rooted at
+  /// \p SubtreeRoot, which still dominates every one of them that is
+  /// reachable. This uses the iterative algorithm of Cooper, Harvey and
+  /// Kennedy on the part of the CFG that the subtree covers; nodes that are
+  /// no longer reachable are removed.
+  void recalculateSubtree(DomTreeNodeBase<NodeT> *SubtreeRoot) {
+    typedef GraphTraits<NodeT *> GraphT;
+    typedef GraphTraits<Inverse<NodeT *>> InvGraphT;
+    DFSInfoValid = false;
+
+    // Collect the nodes of the subtree. Every node comes before its
+    // descendants.
+    SmallVector<DomTreeNodeBase<NodeT> *, 32> OldNodes;
+    SmallPtrSet<NodeT *, 32> InSubtree;
+    OldNodes.push_back(SubtreeRoot);
+    for (unsigned I = 0; I != OldNodes.size(); ++I) {
+      InSubtree.insert(OldNodes[I]->getBlock());
+      OldNodes.append(OldNodes[I]->begin(), OldNodes[I]->end());
+    }
+
+    // Number the blocks that are still reachable from the root of the
+    // subtree in reverse post order.
+    SmallVector<NodeT *, 32> PostOrder;
+    SmallPtrSet<NodeT *, 32> Visited;
+    SmallVector<std::pair<NodeT *, typename GraphT::ChildIteratorType>, 32>
+        Stack;
+    Visited.insert(SubtreeRoot->getBlock());
+    Stack.push_back(std::make_pair(
+        SubtreeRoot->getBlock(), GraphT::child_begin(SubtreeRoot->getBlock())));
+    while (!Stack.empty()) {
+      NodeT *BB = Stack.back().first;
+      if (Stack.back().second == GraphT::child_end(BB)) {
+        PostOrder.push_back(BB);
+        Stack.pop_back();
+        continue;
+      }
+      NodeT *Succ = *Stack.back().second++;
+      if (InSubtree.count(Succ) && Visited.insert(Succ).second)
+        Stack.push_back(std::make_pair(Succ, GraphT::child_begin(Succ)));
+    }
+    unsigned NumBlocks = PostOrder.size();
+    DenseMap<NodeT *, unsigned> RPONumber;
+    for (unsigned I = 0; I != NumBlocks; ++I)
+      RPONumber[PostOrder[I]] = NumBlocks - 1 - I;
+
+    // Iterate to a fixed point. Only the predecessors in the subtree can
+    // reach a block in it without going through the root.
+    const unsigned Undef = ~0U;
+    std::vector<unsigned> IDom(NumBlocks, Undef);
+    IDom[0] = 0;
+    auto Intersect = [&](unsigned A, unsigned B) {
+      while (A != B) {
+        while (A > B)
+          A = IDom[A];
+        while (B > A)
+          B = IDom[B];
+      }
+      return A;
+    };
+    bool Changed = true;
+    while (Changed) {
+      Changed = false;
+      for (unsigned I = 1; I != NumBlocks; ++I) {
+        NodeT *BB = PostOrder[NumBlocks - 1 - I];
+        unsigned NewIDom = Undef;
+        for (typename InvGraphT::ChildIteratorType
+                 PI = InvGraphT::child_begin(BB),
+                 PE = InvGraphT::child_end(BB);
+             PI != PE; ++PI) {
+          auto It = RPONumber.find(*PI);
+          if (It == RPONumber.end() || IDom[It->second] == Undef)
+            continue;
+          NewIDom =
+              NewIDom == Undef ? It->second : Intersect(It->second, NewIDom);
+        }
+        if (IDom[I] != NewIDom) {
+          IDom[I] = NewIDom;
+          Changed = true;
+        }
+      }
+    }
+
+    // Move the reachable nodes first, so that the unreachable ones are left
+    // as leaves that can be erased bottom up.
+    for (unsigned I = 1; I != NumBlocks; ++I)
+      getNode(PostOrder[NumBlocks - 1 - I])
+          ->setIDom(getNode(PostOrder[NumBlocks - 1 - IDom[I]]));
+    for (auto I = OldNodes.rbegin(), E = OldNodes.rend(); I != E; ++I)
+      if (!RPONumber.count((*I)->getBlock()))
+        eraseNode((*I)->getBlock());
+  }
+
   template <class GraphT>
   friend typename GraphT::NodeType *
   Eval(DominatorTreeBase<typename GraphT::NodeType> &DT,
@@ -0,0 +1,200 @@
+//===- llvm/Support/Parallel.h - Parallel algorithms ------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines parallel versions of std::for_each, std::sort and
+// std::transform_reduce, which run on a thread pool shared by the process.
+// They can be nested: the tasks that they submit from a task of the pool run
+// on its thread first, and the threads that wait for them help running them.
+//
+// The results do not depend on the number of threads, which
+// setParallelThreadCount() sets for the whole process.  With one thread, or
+// when LLVM_ENABLE_THREADS is off, the algorithms run sequentially on the
+// calling thread.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_PARALLEL_H
+#define LLVM_SUPPORT_PARALLEL_H
+
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+namespace llvm {
+
+/// Set the number of threads of the parallel algorithms, 0 meaning one per
+/// hardware thread, which is the default.  It must be called before the first
+/// parallel algorithm runs, typically from the option parsing of a tool.
+void setParallelThreadCount(unsigned ThreadCount);
+
+/// Return the number of threads that the parallel algorithms run on.  It is 1
+/// when they run sequentially.
+unsigned getParallelThreadCount();
+
+namespace detail {
+/// Return the thread pool of the parallel algorithms, which has
+/// getParallelThreadCount() threads.
+ThreadPool &getDefaultParallelPool();
+
+/// The number of elements below which the parallel algorithms run
+/// sequentially.
+const ptrdiff_t MinParallelSize = 1024;
+
+/// The number of tasks that the parallel loops split their range into.
+const ptrdiff_t ParallelTaskCount = 1024;
+
+/// Return the median of the first, middle and last elements of the range.
+template <class RandomAccessIterator, class Comparator>
+RandomAccessIterator medianOf3(RandomAccessIterator Start,
+                               RandomAccessIterator End,
+                               const Comparator &Comp) {
+  RandomAccessIterator Mid = Start + (std::distance(Start, End) / 2);
+  return Comp(*Start, *(End - 1))
+             ? (Comp(*Mid, *(End - 1)) ? (Comp(*Start, *Mid) ? Mid : Start)
+                                       : End - 1)
+             : (Comp(*Mid, *Start) ? (Comp(*(End - 1), *Mid) ? Mid : End - 1)
+                                   : Start);
+}
+
+template <class RandomAccessIterator, class Comparator>
+void parallel_quick_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                         const Comparator &Comp, ThreadPoolTaskGroup &Group,
+                         size_t Depth) {
+  // Do a sequential sort for small inputs, and when the partitions are too
+  // unbalanced for quicksort to be efficient.
+  if (std::distance(Start, End) < MinParallelSize || Depth == 0) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  // Partition around the pivot, which ends up at Pivot.
+  auto Pivot = medianOf3(Start, End, Comp);
+  std::swap(*(End - 1), *Pivot);
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+      ValueTy;
+  Pivot = std::partition(Start, End - 1, [&Comp, End](const ValueTy &V) {
+    return Comp(V, *(End - 1));
+  });
+  std::swap(*Pivot, *(End - 1));
+
+  // Sort the partitions in parallel.
+  Group.async([=, &Comp, &Group] {
+    parallel_quick_sort(Start, Pivot, Comp, Group, Depth - 1);
+  });
+  parallel_quick_sort(Pivot + 1, End, Comp, Group, Depth - 1);
+}
+} // end namespace detail
+
+/// Call \p Fn on each element of [\p Begin, \p End) in parallel, in no
+/// particular order.
+template <class IterTy, class FuncTy>
+void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
+  if (getParallelThreadCount() == 1) {
+    std::for_each(Begin, End, Fn);
+    return;
+  }
+
+  // Split the range into a bounded number of tasks, so that the overhead of
+  // the tasks stays small next to their work.
+  ptrdiff_t TaskSize = std::distance(Begin, End) / detail::ParallelTaskCount;
+  if (TaskSize == 0)
+    TaskSize = 1;
+
+  ThreadPoolTaskGroup Group(detail::getDefaultParallelPool());
+  while (TaskSize < std::distance(Begin, End)) {
+    Group.async([=] { std::for_each(Begin, Begin + TaskSize, Fn); });
+    Begin += TaskSize;
+  }
+  std::for_each(Begin, End, Fn);
+}
+
+/// Call \p Fn on each index of [\p Begin, \p End) in parallel, in no
+/// particular order.
+template <class IndexTy, class FuncTy>
+void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
+  if (getParallelThreadCount() == 1) {
+    for (IndexTy I = Begin; I != End; ++I)
+      Fn(I);
+    return;
+  }
+
+  ptrdiff_t TaskSize = (End - Begin) / detail::ParallelTaskCount;
+  if (TaskSize == 0)
+    TaskSize = 1;
+
+  ThreadPoolTaskGroup Group(detail::getDefaultParallelPool());
+  IndexTy I = Begin;
+  for (; I + TaskSize < End; I += TaskSize) {
+    Group.async([=] {
+      for (IndexTy J = I, E = I + TaskSize; J != E; ++J)
+        Fn(J);
+    });
+  }
+  for (; I < End; ++I)
+    Fn(I);
+}
+
+/// Sort [\p Start, \p End) with \p Comp in parallel.  The sort is not stable.
+template <class RandomAccessIterator,
+          class Comparator = std::less<
+              typename std::iterator_traits<RandomAccessIterator>::value_type>>
+void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
+                   const Comparator &Comp = Comparator()) {
+  if (getParallelThreadCount() == 1) {
+    std::sort(Start, End, Comp);
+    return;
+  }
+
+  ThreadPoolTaskGroup Group(detail::getDefaultParallelPool());
+  detail::parallel_quick_sort(Start, End, Comp, Group,
+                              llvm::Log2_64(std::distance(Start, End)) + 1);
+}
+
+/// Reduce with \p Reduce the results of \p Transform on the elements of
+/// [\p Begin, \p End) in parallel, starting from \p Init.  The elements are
+/// split into chunks that do not depend on the number of threads, and the
+/// chunks are reduced in order, so the result is deterministic even if
+/// \p Reduce is not commutative.  \p Reduce must be associative, and \p Init
+/// an identity of it, as every chunk starts from it.
+template <class IterTy, class ResultTy, class ReduceFuncTy,
+          class TransformFuncTy>
+ResultTy parallel_transform_reduce(IterTy Begin, IterTy End, ResultTy Init,
+                                   ReduceFuncTy Reduce,
+                                   TransformFuncTy Transform) {
+  ptrdiff_t NumInputs = std::distance(Begin, End);
+  if (NumInputs == 0)
+    return Init;
+  ptrdiff_t NumTasks = std::min(detail::ParallelTaskCount, NumInputs);
+  ptrdiff_t TaskSize = NumInputs / NumTasks;
+  ptrdiff_t NumLargerTasks = NumInputs % NumTasks;
+  std::vector<IterTy> Bounds(1, Begin);
+  for (ptrdiff_t TaskID = 0; TaskID != NumTasks; ++TaskID) {
+    Bounds.push_back(Bounds.back());
+    std::advance(Bounds.back(), TaskSize + (TaskID < NumLargerTasks ? 1 : 0));
+  }
+
+  std::vector<ResultTy> Results(NumTasks, Init);
+  parallel_for_each_n(ptrdiff_t(0), NumTasks, [&](ptrdiff_t TaskID) {
+    ResultTy &R = Results[TaskID];
+    for (IterTy I = Bounds[TaskID], E = Bounds[TaskID + 1]; I != E; ++I)
+      R = Reduce(std::move(R), Transform(*I));
+  });
+
+  for (ptrdiff_t TaskID = 1; TaskID != NumTasks; ++TaskID)
+    Results[0] = Reduce(std::move(Results[0]), std::move(Results[TaskID]));
+  return std::move(Results[0]);
+}
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_PARALLEL_H
@@ -7,7 +7,9 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file defines a crude C++11 based thread pool.
+// This file defines a C++11 based thread pool, where the tasks that a task
+// submits run on the thread that submitted them unless other threads steal
+// them, and where groups of tasks can be waited on by the tasks.
 //
 //===----------------------------------------------------------------------===//
 
@@ -35,19 +37,35 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <thread>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
+class ThreadPoolTaskGroup;
+
+/// The priorities of the tasks of a ThreadPool that are submitted from outside
+/// the pool.  The pool starts the tasks of higher priority first.
+enum class ThreadPoolPriority { Low, Normal, High };
+
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
 /// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// for some work to become available.  Each thread has a deque of the tasks
+/// that its tasks submit, which it runs newest first, and which the idle
+/// threads steal from, oldest first.  The tasks submitted from outside the
+/// pool are queued by priority, and the threads take them after their own.
+///
+/// The tasks of a ThreadPoolTaskGroup can be waited on without waiting for
+/// the other tasks of the pool.  A thread that waits on a group runs the tasks
+/// of the group meanwhile, so the tasks of the pool can wait on groups of
+/// subtasks without deadlocking it.
 class ThreadPool {
 public:
 #ifndef _MSC_VER
@@ -101,37 +119,131 @@ public:
 #endif
   }
 
+  /// Asynchronous submission of a task of \p Group to the pool. The returned
+  /// future can be used to wait for the task to finish and is *non-blocking*
+  /// on destruction.
+  template <typename Function>
+  inline std::shared_future<VoidTy> async(ThreadPoolTaskGroup &Group,
+                                          Function &&F) {
+#ifndef _MSC_VER
+    return asyncImpl(std::forward<Function>(F), &Group);
+#else
+    return asyncImpl([F] (VoidTy) -> VoidTy { F(); return VoidTy(); },
+                     &Group);
+#endif
+  }
+
   /// Blocking wait for all the threads to complete and the queue to be empty.
-  /// It is an error to try to add new tasks while blocking on this call.
+  /// It is an error to try to add new tasks while blocking on this call, or to
+  /// call it from a task of the pool.
   void wait();
 
+  /// Blocking wait for the tasks of \p Group to complete, running them on the
+  /// calling thread meanwhile.  Tasks of the pool may call it.
+  void wait(ThreadPoolTaskGroup &Group);
+
 private:
+  /// A task waiting for execution, and the group that it belongs to, if any.
+  struct QueuedTask {
+    PackagedTaskTy Task;
+    ThreadPoolTaskGroup *Group;
+  };
+
+  /// The index of no thread of the pool.
+  static const unsigned NoWorker = ~0U;
+
   /// Asynchronous submission of a task to the pool. The returned future can be
   /// used to wait for the task to finish and is *non-blocking* on destruction.
-  std::shared_future<VoidTy> asyncImpl(TaskTy F);
+  std::shared_future<VoidTy> asyncImpl(TaskTy F,
+                                       ThreadPoolTaskGroup *Group = nullptr);
+
+  /// Return the index of the calling thread in Threads, or NoWorker if it is
+  /// not a thread of the pool.  QueueLock must be held.
+  unsigned getWorkerIndex() const;
+
+  /// Take the next task to run for the thread \p Worker into \p Task, only
+  /// among the tasks of \p Group if it is not null.  QueueLock must be held.
+  /// \returns false if there is no task to run.
+  bool popTask(unsigned Worker, ThreadPoolTaskGroup *Group, QueuedTask &Task);
+
+  /// Take a task from \p Queue into \p Task, the newest one or the oldest
+  /// one, only among the tasks of \p Group if it is not null.
+  static bool takeTask(std::deque<QueuedTask> &Queue, bool Newest,
+                       ThreadPoolTaskGroup *Group, QueuedTask &Task);
+
+  /// Run \p Task, with \p LockGuard on QueueLock released meanwhile.
+  void runTask(QueuedTask &Task, std::unique_lock<std::mutex> &LockGuard);
 
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+  /// The tasks submitted by the tasks running on each of the threads.
+  std::vector<std::deque<QueuedTask>> LocalTasks;
+
+  /// The tasks submitted from outside the pool, by priority.
+  std::deque<QueuedTask> GlobalTasks[3];
 
-  /// Locking and signaling for accessing the Tasks queue.
+  /// The number of tasks waiting for execution in all the queues.
+  unsigned NumQueued = 0;
+
+  /// Locking and signaling for accessing the queues.  QueueLock also protects
+  /// ActiveThreads and the task counts of the groups.
   std::mutex QueueLock;
   std::condition_variable QueueCondition;
 
-  /// Locking and signaling for job completion
-  std::mutex CompletionLock;
+  /// Signaling for task completion, and for the submission of tasks of a
+  /// group, which its waiters run.
   std::condition_variable CompletionCondition;
 
-  /// Keep track of the number of thread actually busy
-  std::atomic<unsigned> ActiveThreads;
+  /// Keep track of the number of tasks actually running
+  unsigned ActiveThreads = 0;
 
 #if LLVM_ENABLE_THREADS // avoids warning for unused variable
+  /// The ids of the threads, in the order of Threads.
+  std::vector<std::thread::id> WorkerIDs;
+
   /// Signal for the destruction of the pool, asking thread to exit.
   bool EnableFlag;
 #endif
 };
+
+/// A group of tasks of a ThreadPool, which can be waited on separately from
+/// the other tasks of the pool.
+class ThreadPoolTaskGroup {
+public:
+  /// Construct a group of tasks of \p Pool.  The tasks that are submitted from
+  /// outside the pool have priority \p Priority.
+  explicit ThreadPoolTaskGroup(
+      ThreadPool &Pool, ThreadPoolPriority Priority = ThreadPoolPriority::Normal)
+      : Pool(Pool), Priority(Priority) {}
+
+  /// Blocking destructor: waits for the tasks of the group to complete.
+  ~ThreadPoolTaskGroup() { wait(); }
+
+  ThreadPoolTaskGroup(const ThreadPoolTaskGroup &) = delete;
+  ThreadPoolTaskGroup &operator=(const ThreadPoolTaskGroup &) = delete;
+
+  /// Asynchronous submission of a task of the group to the pool.
+  template <typename Function>
+  inline std::shared_future<ThreadPool::VoidTy> async(Function &&F) {
+    return Pool.async(*this, std::forward<Function>(F));
+  }
+
+  /// Blocking wait for the tasks of the group to complete.
+  void wait() { Pool.wait(*this); }
+
+  ThreadPoolPriority getPriority() const { return Priority; }
+
+private:
+  friend class ThreadPool;
+
+  ThreadPool &Pool;
+  ThreadPoolPriority Priority;
+
+  /// The number of tasks of the group that are queued or running, protected
+  /// by the QueueLock of the pool.
+  unsigned NumUnfinished = 0;
+};
 }
 
 #endif // LLVM_SUPPORT_THREAD_POOL_H
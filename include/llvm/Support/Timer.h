@@ -168,6 +168,7 @@ struct NamedRegionTimer : public TimeRegion {
 ///
 class TimerGroup {
   std::string Name;
+  std::string Description;
   Timer *FirstTimer;   // First timer in the group.
   std::vector<std::pair<TimeRecord, std::string>> TimersToPrint;
 
@@ -177,9 +178,15 @@ class TimerGroup {
 
 public:
   explicit TimerGroup(StringRef name);
+  /// Create a group whose report is headed by \p description, and which is
+  /// identified by \p name in -timer-json output.
+  TimerGroup(StringRef name, StringRef description);
   ~TimerGroup();
 
-  void setName(StringRef name) { Name.assign(name.begin(), name.end()); }
+  void setName(StringRef name) {
+    Name.assign(name.begin(), name.end());
+    Description = Name;
+  }
 
   /// print - Print any started timers in this group and zero them.
   void print(raw_ostream &OS);
@@ -192,6 +199,7 @@ private:
   void addTimer(Timer &T);
   void removeTimer(Timer &T);
   void PrintQueuedTimers(raw_ostream &OS);
+  void PrintQueuedTimersJSON(raw_ostream &OS);
 };
 
 } // End llvm namespace
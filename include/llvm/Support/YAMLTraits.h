@@ -938,6 +938,10 @@ private:
 /// the mapRequired() method calls may not be in the same order
 /// as the keys in the document.
 ///
+/// The HNodes of a document are allocated in bump allocators, which are reset
+/// when moving to the next document, so that the memory used by large
+/// multi-document streams stays bounded by the largest document.
+///
 class Input : public IO {
 public:
   // Construct a yaml Input object from a StringRef and optional
@@ -1021,14 +1025,15 @@ private:
     void anchor() override;
 
   public:
-    MapHNode(Node *n) : HNode(n) { }
+    MapHNode(Node *n, BumpPtrAllocator &Allocator)
+        : HNode(n), Mapping(Allocator) {}
 
     static inline bool classof(const HNode *n) {
       return MappingNode::classof(n->_node);
     }
     static inline bool classof(const MapHNode *) { return true; }
 
-    typedef llvm::StringMap<std::unique_ptr<HNode>> NameToNode;
+    typedef llvm::StringMap<HNode *, BumpPtrAllocator &> NameToNode;
 
     bool isValidKey(StringRef key);
 
@@ -1047,10 +1052,10 @@ private:
     }
     static inline bool classof(const SequenceHNode *) { return true; }
 
-    std::vector<std::unique_ptr<HNode>> Entries;
+    std::vector<HNode *> Entries;
   };
 
-  std::unique_ptr<Input::HNode> createHNodes(Node *node);
+  Input::HNode *createHNodes(Node *node);
   void setError(HNode *hnode, const Twine &message);
   void setError(Node *node, const Twine &message);
 
@@ -1066,9 +1071,14 @@ public:
 private:
   llvm::SourceMgr                     SrcMgr; // must be before Strm
   std::unique_ptr<llvm::yaml::Stream> Strm;
-  std::unique_ptr<HNode>              TopNode;
   std::error_code                     EC;
   llvm::BumpPtrAllocator              StringAllocator;
+  // The entries of the MapHNodes. Must be before MapHNodeAllocator.
+  llvm::BumpPtrAllocator              MapEntryAllocator;
+  llvm::SpecificBumpPtrAllocator<EmptyHNode>    EmptyHNodeAllocator;
+  llvm::SpecificBumpPtrAllocator<ScalarHNode>   ScalarHNodeAllocator;
+  llvm::SpecificBumpPtrAllocator<MapHNode>      MapHNodeAllocator;
+  llvm::SpecificBumpPtrAllocator<SequenceHNode> SequenceHNodeAllocator;
   llvm::yaml::document_iterator       DocIterator;
   std::vector<bool>                   BitValuesUsed;
   HNode                              *CurrentNode;
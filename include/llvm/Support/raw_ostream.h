@@ -17,6 +17,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
+#include <memory>
 #include <system_error>
 
 namespace llvm {
@@ -353,6 +354,10 @@ class raw_fd_ostream : public raw_pwrite_stream {
 
   bool SupportsSeeking;
 
+  /// The background writer of the stream in the asynchronous mode.
+  class AsyncWriter;
+  std::unique_ptr<AsyncWriter> Async;
+
   /// See raw_ostream::write_impl.
   void write_impl(const char *Ptr, size_t Size) override;
 
@@ -368,6 +373,9 @@ class raw_fd_ostream : public raw_pwrite_stream {
   /// Set the flag indicating that an output error has been encountered.
   void error_detected() { Error = true; }
 
+  /// Wait for the asynchronous writes in flight, if any, to finish.
+  void wait_for_async_writes();
+
 public:
   /// Open the specified file for writing. If an error occurs, information
   /// about the error is put into EC, and the stream should be immediately
@@ -394,6 +402,16 @@ public:
 
   bool supportsSeeking() { return SupportsSeeking; }
 
+  /// Buffer the stream with two buffers of \p BufferSize bytes, and write
+  /// each full buffer to the file from a background thread while the next one
+  /// is filled. This is meant for large outputs, which otherwise block on each
+  /// write.
+  ///
+  /// In this mode flush() only starts the write of the buffer: the writes are
+  /// complete, and has_error() reports their errors, after close(), seek() or
+  /// the destruction of the stream.
+  void enable_async_writes(size_t BufferSize = 1 << 20);
+
   /// Flushes the stream and repositions the underlying file descriptor position
   /// to the offset specified from the beginning of the file.
   uint64_t seek(uint64_t off);
@@ -0,0 +1,99 @@
+//===- llvm/Support/xxhash.h - Fast non-cryptographic hashing ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the 64-bit xxHash (XXH64) of Yann Collet, and a 128-bit
+// hash made of two XXH64 with different seeds, computed in one pass.  They are
+// many times faster than MD5 and SHA1, and are meant for cache keys and for
+// deduplicating contents, where no adversary chooses the inputs.  They are
+// not cryptographic hashes.
+//
+// The hashes are the same on every host.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_SUPPORT_XXHASH_H
+#define LLVM_SUPPORT_XXHASH_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include <cstdint>
+
+namespace llvm {
+
+/// Return the XXH64 hash of \p Data with \p Seed.
+uint64_t xxHash64(ArrayRef<uint8_t> Data, uint64_t Seed = 0);
+
+inline uint64_t xxHash64(StringRef Data, uint64_t Seed = 0) {
+  return xxHash64(ArrayRef<uint8_t>(
+                      reinterpret_cast<const uint8_t *>(Data.data()),
+                      Data.size()),
+                  Seed);
+}
+
+/// A 128-bit hash value.
+struct Hash128 {
+  uint64_t Low;
+  uint64_t High;
+
+  bool operator==(const Hash128 &RHS) const {
+    return Low == RHS.Low && High == RHS.High;
+  }
+  bool operator!=(const Hash128 &RHS) const { return !(*this == RHS); }
+  bool operator<(const Hash128 &RHS) const {
+    return High != RHS.High ? High < RHS.High : Low < RHS.Low;
+  }
+};
+
+/// Incremental computation of the 128-bit hash, whose low half is the XXH64 of
+/// the data, and whose high half is its XXH64 with another seed.
+class xxHash128 {
+public:
+  xxHash128() { init(); }
+
+  /// Reinitialize the internal state.
+  void init();
+
+  /// Digest more data.
+  void update(ArrayRef<uint8_t> Data);
+
+  /// Digest more data.
+  void update(StringRef Str) {
+    update(ArrayRef<uint8_t>(reinterpret_cast<const uint8_t *>(Str.data()),
+                             Str.size()));
+  }
+
+  /// Return the hash of the data digested since the last call to init().  It
+  /// does not change the state, so more data can be digested afterwards.
+  Hash128 result() const;
+
+  /// Return the hash of \p Data.
+  static Hash128 hash(ArrayRef<uint8_t> Data) {
+    xxHash128 H;
+    H.update(Data);
+    return H.result();
+  }
+  static Hash128 hash(StringRef Data) {
+    xxHash128 H;
+    H.update(Data);
+    return H.result();
+  }
+
+private:
+  enum { STRIPE_LENGTH = 32 };
+
+  /// The accumulators of the two hashes.
+  uint64_t Acc[2][4];
+  /// The data that does not fill a stripe yet.
+  uint8_t Buffer[STRIPE_LENGTH];
+  uint64_t TotalLength;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_SUPPORT_XXHASH_H
@@ -14,6 +14,10 @@
 #ifndef LLVM_TABLEGEN_MAIN_H
 #define LLVM_TABLEGEN_MAIN_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include <functional>
+#include <string>
+
 namespace llvm {
 
 class RecordKeeper;
@@ -23,6 +27,20 @@ class raw_ostream;
 typedef bool TableGenMainFn(raw_ostream &OS, RecordKeeper &Records);
 
 int TableGenMain(char *argv0, TableGenMainFn *MainFn);
+
+/// \brief An output of a batch of actions: Run performs the action, and its
+/// output is written to Filename.
+struct TableGenBatchOutput {
+  std::string Filename;
+  std::function<bool(raw_ostream &OS, RecordKeeper &Records)> Run;
+};
+
+/// \brief Parse the input once, and perform each of the actions of Outputs
+/// using the records.  An output file is only written if its contents change.
+/// Up to NumJobs actions are performed at once, each in a copy of the process,
+/// on hosts that support it.
+int TableGenBatchMain(char *argv0, ArrayRef<TableGenBatchOutput> Outputs,
+                      unsigned NumJobs);
 }
 
 #endif
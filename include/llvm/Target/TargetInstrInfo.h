@@ -43,6 +43,7 @@ class TargetRegisterInfo;
 class TargetSubtargetInfo;
 class TargetSchedModel;
 class DFAPacketizer;
+class GlobalValue;
 
 template<class T> class SmallVectorImpl;
 
@@ -1435,6 +1436,58 @@ public:
     return None;
   }
 
+  /// Represents how an instruction should be mapped by the outliner.
+  /// \p Legal instructions may be outlined.
+  /// \p Illegal instructions may not be outlined, and end a sequence.
+  /// \p Invisible instructions are skipped over; they neither count towards a
+  /// sequence nor end it, and are dropped when the sequence is outlined.
+  enum MachineOutlinerInstrType { Legal, Illegal, Invisible };
+
+  /// Return true if the machine outliner may take instructions out of \p MF.
+  virtual bool isFunctionSafeToOutlineFrom(MachineFunction &MF) const {
+    return false;
+  }
+
+  /// Return how the machine outliner should treat \p MI.
+  virtual MachineOutlinerInstrType getOutliningType(MachineInstr &MI) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::getOutliningType!");
+  }
+
+  /// Return the number of instructions that replace an outlined sequence at
+  /// each of its call sites. \p IsTailCall is true if the sequence ends in a
+  /// return, so that the call is also the return of its caller.
+  virtual unsigned getOutliningCallOverhead(bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::getOutliningCallOverhead!");
+  }
+
+  /// Return the number of instructions an outlined function needs in addition
+  /// to the outlined sequence itself.
+  virtual unsigned getOutliningFrameOverhead(bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::getOutliningFrameOverhead!");
+  }
+
+  /// Insert the instructions that end the outlined function \p MF, after the
+  /// outlined sequence in \p MBB.
+  virtual void insertOutlinerEpilogue(MachineBasicBlock &MBB,
+                                      MachineFunction &MF,
+                                      bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::insertOutlinerEpilogue!");
+  }
+
+  /// Insert a call to the outlined function \p MF before \p It in \p MBB.
+  /// \p Callee is the function's symbol in the IR module.
+  virtual void insertOutlinedCall(MachineBasicBlock &MBB,
+                                  MachineBasicBlock::iterator It,
+                                  MachineFunction &MF, const GlobalValue *Callee,
+                                  bool IsTailCall) const {
+    llvm_unreachable(
+        "Target didn't implement TargetInstrInfo::insertOutlinedCall!");
+  }
+
 private:
   unsigned CallFrameSetupOpcode, CallFrameDestroyOpcode;
   unsigned CatchRetOpcode;
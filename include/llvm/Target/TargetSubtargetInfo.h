@@ -25,6 +25,7 @@ namespace llvm {
 
 class CallLowering;
 class DataLayout;
+class InstructionSelector;
 class MachineFunction;
 class MachineInstr;
 class RegisterBankInfo;
@@ -88,6 +89,11 @@ public:
     return nullptr;
   }
   virtual const CallLowering *getCallLowering() const { return nullptr; }
+  /// If the GlobalISel instruction selector is available, return it.
+  /// Otherwise return nullptr.
+  virtual const InstructionSelector *getInstructionSelector() const {
+    return nullptr;
+  }
   /// Target can subclass this hook to select a different DAG scheduler.
   virtual RegisterScheduler::FunctionPassCtor
       getDAGScheduler(CodeGenOpt::Level) const {
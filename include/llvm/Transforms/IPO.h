@@ -204,6 +204,18 @@ ModulePass *createMergeFunctionsPass();
 ///
 ModulePass *createPartialInliningPass();
 
+//===----------------------------------------------------------------------===//
+/// createHotColdSplittingPass - This pass outlines the regions of functions
+/// that the profile finds cold.
+///
+ModulePass *createHotColdSplittingPass();
+
+//===----------------------------------------------------------------------===//
+/// createFunctionOrderingPass - This pass orders the functions of the module
+/// by the profile call graph, and places the hot ones in hot sections.
+///
+ModulePass *createFunctionOrderingPass();
+
 //===----------------------------------------------------------------------===//
 // createMetaRenamerPass - Rename everything with metasyntatic names.
 //
@@ -223,7 +235,11 @@ ModulePass *createCrossDSOCFIPass();
 
 /// \brief This pass implements whole-program devirtualization using bitset
 /// metadata.
-ModulePass *createWholeProgramDevirtPass();
+///
+/// In a ThinLTO backend, \p Summary is the combined index, and the virtual
+/// calls through named bitsets are devirtualized with its resolutions.
+ModulePass *
+createWholeProgramDevirtPass(const ModuleSummaryIndex *Summary = nullptr);
 
 //===----------------------------------------------------------------------===//
 // SampleProfilePass - Loads sample profile data from disk and generates
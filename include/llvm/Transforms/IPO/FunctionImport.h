@@ -75,11 +75,15 @@ private:
 /// \p ExportLists contains for each Module the set of globals (GUID) that will
 /// be imported by another module, or referenced by such a function. I.e. this
 /// is the set of globals that need to be promoted/renamed appropriately.
+///
+/// The modules are handled on up to \p ThreadCount threads. The lists do not
+/// depend on the number of threads.
 void ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists);
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    unsigned ThreadCount = 1);
 
 /// Compute all the imports for the given module using the Index.
 ///
@@ -89,6 +93,18 @@ void ComputeCrossModuleImportForModule(
     StringRef ModulePath, const ModuleSummaryIndex &Index,
     FunctionImporter::ImportMapTy &ImportList);
 
+/// Compute all the imports for the given module using the Index, given the
+/// summaries of the global values it defines in \p DefinedGVSummaries.
+///
+/// This avoids scanning the whole index to collect the summaries of the module,
+/// which allows computing the imports of all the modules one at a time, e.g. to
+/// emit the individual indexes for distributed backends without keeping every
+/// import list alive.
+void ComputeCrossModuleImportForModule(
+    StringRef ModulePath, const GVSummaryMapTy &DefinedGVSummaries,
+    const ModuleSummaryIndex &Index,
+    FunctionImporter::ImportMapTy &ImportList);
+
 /// Compute the set of summaries needed for a ThinLTO backend compilation of
 /// \p ModulePath.
 //
@@ -18,12 +18,12 @@
 #define LLVM_TRANSFORMS_IPO_INLINERPASS_H
 
 #include "llvm/Analysis/CallGraphSCCPass.h"
+#include "llvm/Analysis/InlineCost.h"
 
 namespace llvm {
 class AssumptionCacheTracker;
 class CallSite;
 class DataLayout;
-class InlineCost;
 template <class PtrType, unsigned SmallSize> class SmallPtrSet;
 
 /// Inliner - This class contains all of the helper code which is used to
@@ -85,6 +85,12 @@ private:
 
 protected:
   AssumptionCacheTracker *ACT;
+
+  /// The callee body costs that getInlineCost may reuse. The functions of an
+  /// SCC are forgotten when the inliner starts and finishes visiting it, as
+  /// other passes change them in between, and so are the functions it
+  /// inlines into or deletes.
+  InlineCostCache CostCache;
 };
 
 } // End llvm namespace
@@ -26,6 +26,7 @@ template <typename T> class ArrayRef;
 template <typename T> class MutableArrayRef;
 class Function;
 class GlobalVariable;
+class ModuleSummaryIndex;
 
 namespace wholeprogramdevirt {
 
@@ -210,6 +211,12 @@ void setAfterReturnValues(MutableArrayRef<VirtualCallTarget> Targets,
                           int64_t &OffsetByte, uint64_t &OffsetBit);
 
 } // end namespace wholeprogramdevirt
+
+/// Resolve the virtual calls of the combined summary \p Index that have a
+/// single implementation across all the modules, for the ThinLTO backends to
+/// devirtualize.
+void runWholeProgramDevirtOnIndex(ModuleSummaryIndex &Index);
+
 } // end namespace llvm
 
 #endif // LLVM_TRANSFORMS_IPO_WHOLEPROGRAMDEVIRT_H
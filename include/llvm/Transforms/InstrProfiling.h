@@ -48,9 +48,22 @@ private:
   std::vector<GlobalVariable *> ReferencedNames;
   GlobalVariable *NamesVar;
   size_t NamesSize;
+  /// The counter loads and stores of the current function that may be
+  /// promoted out of loops.
+  std::vector<std::pair<LoadInst *, StoreInst *>> PromotionCandidates;
 
   bool isMachO() const;
 
+  /// Return true if counters should be promoted out of loops.
+  bool isCounterPromotionEnabled() const;
+
+  /// Return true if counters should be updated atomically.
+  bool isAtomic() const;
+
+  /// Emit the sampling check at the entry of \p F, and return the condition
+  /// that is true when this call of \p F is profiled.
+  Value *emitSamplingCheck(Function &F);
+
   /// Get the section name for the counter variables.
   StringRef getCountersSection() const;
 
@@ -69,8 +82,13 @@ private:
   /// Replace instrprof_value_profile with a call to runtime library.
   void lowerValueProfileInst(InstrProfValueProfileInst *Ins);
 
-  /// Replace instrprof_increment with an increment of the appropriate value.
-  void lowerIncrement(InstrProfIncrementInst *Inc);
+  /// Replace instrprof_increment with an increment of the appropriate value,
+  /// which is \p Step.
+  void lowerIncrement(InstrProfIncrementInst *Inc, uint64_t Step);
+
+  /// Keep the counters that are updated in the loops of \p F in registers,
+  /// and add them to the counters in memory at the loop exits.
+  void promoteCounterLoadStores(Function &F);
 
   /// Force emitting of name vars for unused functions.
   void lowerCoverageData(GlobalVariable *CoverageNamesVar);
@@ -84,14 +84,23 @@ ModulePass *createPGOInstrumentationGenLegacyPass();
 ModulePass *
 createPGOInstrumentationUseLegacyPass(StringRef Filename = StringRef(""));
 ModulePass *createPGOIndirectCallPromotionLegacyPass(bool InLTO = false);
+FunctionPass *createPGOMemOPSizeOptLegacyPass();
 
 /// Options for the frontend instrumentation based profiling pass.
 struct InstrProfOptions {
-  InstrProfOptions() : NoRedZone(false) {}
+  InstrProfOptions()
+      : NoRedZone(false), DoCounterPromotion(false), Atomic(false) {}
 
   // Add the 'noredzone' attribute to added runtime library calls.
   bool NoRedZone;
 
+  // Keep the counters of loops in registers, and update them in memory at
+  // the loop exits.
+  bool DoCounterPromotion;
+
+  // Update the counters in memory with atomic instructions.
+  bool Atomic;
+
   // Name of the profile file to use as output
   std::string InstrProfileOutput;
 };
@@ -136,7 +145,8 @@ ModulePass *createEfficiencySanitizerPass(
 struct SanitizerCoverageOptions {
   SanitizerCoverageOptions()
       : CoverageType(SCK_None), IndirectCalls(false), TraceBB(false),
-        TraceCmp(false), Use8bitCounters(false), TracePC(false) {}
+        TraceCmp(false), Use8bitCounters(false), TracePC(false),
+        Inline8bitCounters(false) {}
 
   enum Type {
     SCK_None = 0,
@@ -149,6 +159,7 @@ struct SanitizerCoverageOptions {
   bool TraceCmp;
   bool Use8bitCounters;
   bool TracePC;
+  bool Inline8bitCounters;
 };
 
 // Insert SanitizerCoverage instrumentation.
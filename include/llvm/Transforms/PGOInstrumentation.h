@@ -44,5 +44,11 @@ private:
   bool InLTO;
 };
 
+/// The pass that versions memory intrinsics on their most frequent lengths.
+class PGOMemOPSizeOpt : public PassInfoMixin<PGOMemOPSizeOpt> {
+public:
+  PreservedAnalyses run(Function &F, AnalysisManager<Function> &FAM);
+};
+
 } // End llvm namespace
 #endif
@@ -494,6 +494,19 @@ FunctionPass *createNaryReassociatePass();
 // llvm.loop.distribute.enable metadata data override this default.
 FunctionPass *createLoopDistributePass(bool ProcessAllLoopsByDefault);
 
+//===----------------------------------------------------------------------===//
+//
+// LoopFusion - Fuse adjacent loops with the same trip count.
+//
+FunctionPass *createLoopFusionPass();
+
+//===----------------------------------------------------------------------===//
+//
+// LoopTiling - Tile the two innermost loops of perfect loop nests for cache
+// locality.
+//
+FunctionPass *createLoopTilingPass();
+
 //===----------------------------------------------------------------------===//
 //
 // LoopLoadElimination - Perform loop-aware load elimination.
@@ -26,6 +26,7 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 
 namespace llvm {
 
@@ -107,6 +108,19 @@ private:
   MemoryDependenceResults *MD;
   DominatorTree *DT;
   const TargetLibraryInfo *TLI;
+
+  /// When loads are eliminated using MemorySSA rather than memdep, the
+  /// MemorySSA form of the function and the walker used to query it. These
+  /// are rebuilt for every iteration over the function.
+  std::unique_ptr<MemorySSA> MSSA;
+  std::unique_ptr<MemorySSAWalker> MSSAWalker;
+
+  /// The loads seen so far, keyed by their clobbering memory access and
+  /// pointer operand. A load that is dominated by the load recorded for its
+  /// key reads the same value.
+  DenseMap<std::pair<const MemoryAccess *, const Value *>, LoadInst *>
+      AvailableLoads;
+
   AssumptionCache *AC;
   SetVector<BasicBlock *> DeadBlocks;
 
@@ -187,6 +201,17 @@ private:
   // Helper functions of redundant load elimination
   bool processLoad(LoadInst *L);
   bool processNonLocalLoad(LoadInst *L);
+
+  /// Compute the dependency of \p L from MemorySSA, in the form memdep would
+  /// give it. Dependencies through a MemoryPhi are reported as non-local.
+  MemDepResult getMemorySSADependency(LoadInst *L);
+  MemDepResult getMemorySSADependency(LoadInst *L, MemoryAccess *Clobber);
+
+  /// Collect the non-local dependencies of \p L below \p Phi into \p Deps.
+  /// Returns false if they can't all be found without phi translation.
+  bool getMemorySSANonLocalDeps(LoadInst *L, MemoryPhi *Phi, LoadDepVect &Deps,
+                                SmallPtrSetImpl<MemoryPhi *> &Visited);
+  void removeFromMemorySSA(Instruction *I);
   bool processAssumeIntrinsic(IntrinsicInst *II);
   /// Given a local dependency (Def or Clobber) determine if a value is
   /// available for the load.  Returns true if an value is known to be
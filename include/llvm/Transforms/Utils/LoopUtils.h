@@ -14,6 +14,7 @@
 #ifndef LLVM_TRANSFORMS_UTILS_LOOPUTILS_H
 #define LLVM_TRANSFORMS_UTILS_LOOPUTILS_H
 
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/EHPersonalities.h"
@@ -29,6 +30,7 @@ class DataLayout;
 class DominatorTree;
 class Loop;
 class LoopInfo;
+class MemorySSA;
 class Pass;
 class PredicatedScalarEvolution;
 class PredIteratorCache;
@@ -73,7 +75,8 @@ public:
     RK_IntegerMinMax, ///< Min/max implemented in terms of select(cmp()).
     RK_FloatAdd,      ///< Sum of floats.
     RK_FloatMult,     ///< Product of floats.
-    RK_FloatMinMax    ///< Min/max implemented in terms of select(cmp()).
+    RK_FloatMinMax,   ///< Min/max implemented in terms of select(cmp()).
+    RK_MinMaxIndex    ///< Index of the first min/max of a min/max recurrence.
   };
 
   // This enum represents the kind of minmax recurrence.
@@ -90,13 +93,14 @@ public:
   RecurrenceDescriptor()
       : StartValue(nullptr), LoopExitInstr(nullptr), Kind(RK_NoRecurrence),
         MinMaxKind(MRK_Invalid), UnsafeAlgebraInst(nullptr),
-        RecurrenceType(nullptr), IsSigned(false) {}
+        RecurrenceType(nullptr), IsSigned(false), IndexedMinMaxInstr(nullptr) {}
 
   RecurrenceDescriptor(Value *Start, Instruction *Exit, RecurrenceKind K,
                        MinMaxRecurrenceKind MK, Instruction *UAI, Type *RT,
                        bool Signed, SmallPtrSetImpl<Instruction *> &CI)
       : StartValue(Start), LoopExitInstr(Exit), Kind(K), MinMaxKind(MK),
-        UnsafeAlgebraInst(UAI), RecurrenceType(RT), IsSigned(Signed) {
+        UnsafeAlgebraInst(UAI), RecurrenceType(RT), IsSigned(Signed),
+        IndexedMinMaxInstr(nullptr) {
     CastInsts.insert(CI.begin(), CI.end());
   }
 
@@ -176,6 +180,22 @@ public:
   static bool isReductionPHI(PHINode *Phi, Loop *TheLoop,
                              RecurrenceDescriptor &RedDes);
 
+  /// Returns true if Phi is the index of the first minimum or maximum of a
+  /// min/max recurrence of TheLoop, the argmin/argmax pattern:
+  /// \code
+  ///   %cmp = icmp slt i32 %v, %min
+  ///   %min.next = select i1 %cmp, i32 %v, i32 %min
+  ///   %idx.next = select i1 %cmp, i64 %i, i64 %idx
+  /// \endcode
+  /// where %idx is Phi and %i is an increasing induction that does not wrap.
+  /// Only strict compares are accepted, so that the index is the one of the
+  /// first element with the extreme value. The RecurrenceDescriptor of kind
+  /// RK_MinMaxIndex is returned in RedDes; the min/max recurrence itself is
+  /// recognized by isReductionPHI.
+  static bool isMinMaxIndexPHI(PHINode *Phi, Loop *TheLoop,
+                               ScalarEvolution *SE,
+                               RecurrenceDescriptor &RedDes);
+
   /// Returns true if Phi is a first-order recurrence. A first-order recurrence
   /// is a non-reduction recurrence relation in which the value of the
   /// recurrence in the current loop iteration equals a value defined in the
@@ -236,6 +256,10 @@ public:
   /// Returns true if all source operands of the recurrence are SExtInsts.
   bool isSigned() { return IsSigned; }
 
+  /// For a RK_MinMaxIndex recurrence, returns the select of the min/max
+  /// recurrence whose index is tracked.
+  Instruction *getIndexedMinMaxInstr() { return IndexedMinMaxInstr; }
+
 private:
   // The starting value of the recurrence.
   // It does not have to be zero!
@@ -254,6 +278,9 @@ private:
   bool IsSigned;
   // Instructions used for type-promoting the recurrence.
   SmallPtrSet<Instruction *, 8> CastInsts;
+  // The select of the min/max recurrence that a RK_MinMaxIndex recurrence
+  // tracks the index of.
+  Instruction *IndexedMinMaxInstr;
 };
 
 /// A struct for saving information about induction variables.
@@ -363,10 +390,12 @@ bool formLCSSARecursively(Loop &L, DominatorTree &DT, LoopInfo *LI,
 /// iteration. Takes DomTreeNode, AliasAnalysis, LoopInfo, DominatorTree,
 /// DataLayout, TargetLibraryInfo, Loop, AliasSet information for all
 /// instructions of the loop and loop safety information as arguments.
-/// It returns changed status.
+/// If MemorySSA is passed instead of the AliasSet information, memory
+/// dependences are queried from it and it is kept up to date. It returns
+/// changed status.
 bool sinkRegion(DomTreeNode *, AliasAnalysis *, LoopInfo *, DominatorTree *,
                 TargetLibraryInfo *, Loop *, AliasSetTracker *,
-                LICMSafetyInfo *);
+                LICMSafetyInfo *, MemorySSA * = nullptr);
 
 /// \brief Walk the specified region of the CFG (defined by all blocks
 /// dominated by the specified block, and that are in the current loop) in depth
@@ -374,19 +403,24 @@ bool sinkRegion(DomTreeNode *, AliasAnalysis *, LoopInfo *, DominatorTree *,
 /// before uses, allowing us to hoist a loop body in one pass without iteration.
 /// Takes DomTreeNode, AliasAnalysis, LoopInfo, DominatorTree, DataLayout,
 /// TargetLibraryInfo, Loop, AliasSet information for all instructions of the
-/// loop and loop safety information as arguments. It returns changed status.
+/// loop and loop safety information as arguments. If MemorySSA is passed
+/// instead of the AliasSet information, memory dependences are queried from it
+/// and it is kept up to date. It returns changed status.
 bool hoistRegion(DomTreeNode *, AliasAnalysis *, LoopInfo *, DominatorTree *,
                  TargetLibraryInfo *, Loop *, AliasSetTracker *,
-                 LICMSafetyInfo *);
+                 LICMSafetyInfo *, MemorySSA * = nullptr);
 
 /// \brief Try to promote memory values to scalars by sinking stores out of
 /// the loop and moving loads to before the loop.  We do this by looping over
 /// the stores in the loop, looking for stores to Must pointers which are
-/// loop invariant. It takes AliasSet, Loop exit blocks vector, loop exit blocks
-/// insertion point vector, PredIteratorCache, LoopInfo, DominatorTree, Loop,
-/// AliasSet information for all instructions of the loop and loop safety
-/// information as arguments. It returns changed status.
-bool promoteLoopAccessesToScalars(AliasSet &, SmallVectorImpl<BasicBlock *> &,
+/// loop invariant. It takes the set of must-alias pointers to promote, which
+/// no other memory access in the loop may alias, Loop exit blocks vector, loop
+/// exit blocks insertion point vector, PredIteratorCache, LoopInfo,
+/// DominatorTree, Loop, AliasSet information for all instructions of the loop
+/// (or null if none is kept) and loop safety information as arguments. It
+/// returns changed status.
+bool promoteLoopAccessesToScalars(const SmallSetVector<Value *, 8> &,
+                                  SmallVectorImpl<BasicBlock *> &,
                                   SmallVectorImpl<Instruction *> &,
                                   PredIteratorCache &, LoopInfo *,
                                   DominatorTree *, const TargetLibraryInfo *,
@@ -413,6 +447,13 @@ Optional<const MDOperand *> findStringMetadataForLoop(Loop *TheLoop,
 void addStringMetadataToLoop(Loop *TheLoop, const char *MDString,
                              unsigned V = 0);
 
+/// \brief Get a loop's estimated trip count based on the branch weights of
+/// its latch.
+///
+/// Returns None if the loop has no single exiting latch or no branch weights,
+/// and 0 if the weights say the loop is never entered or never exits.
+Optional<unsigned> getLoopEstimatedTripCount(Loop *L);
+
 /// Helper to consistently add the set of standard passes to a loop pass's \c
 /// AnalysisUsage.
 ///
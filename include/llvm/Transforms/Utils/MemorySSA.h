@@ -505,6 +505,10 @@ public:
   /// \brief Returns false if you need to call buildMemorySSA.
   bool isFinishedBuilding() const { return Walker; }
 
+  /// \brief Returns the walker returned by buildMemorySSA, or null if
+  /// MemorySSA has not been built yet. The walker is not owned by MemorySSA.
+  MemorySSAWalker *getWalker() const { return Walker; }
+
   /// \brief Given a memory Mod/Ref'ing instruction, get the MemorySSA
   /// access associated with it. If passed a basic block gets the memory phi
   /// node that exists for that block, if there is one. Otherwise, this will get
@@ -554,6 +558,10 @@ public:
   /// whether MemoryAccess \p A dominates MemoryAccess \p B.
   bool locallyDominates(const MemoryAccess *A, const MemoryAccess *B) const;
 
+  /// \brief Given two memory accesses in potentially different blocks,
+  /// determine whether MemoryAccess \p A dominates MemoryAccess \p B.
+  bool dominates(const MemoryAccess *A, const MemoryAccess *B) const;
+
   /// \brief Verify that MemorySSA is self consistent (IE definitions dominate
   /// all uses, uses appear in the right places).  This is used by unit tests.
   void verifyMemorySSA() const;
@@ -27,6 +27,13 @@ class StringRef;
 /// Splits the module M into N linkable partitions. The function ModuleCallback
 /// is called N times passing each individual partition as the MPart argument.
 ///
+/// By default globals that need not be kept together are assigned to
+/// partitions by a hash of their name. If \p BalanceByCost is true, every
+/// definition is instead assigned so that the partitions have roughly the same
+/// estimated code generation cost (based on instruction counts), while comdat
+/// groups, aliases and globals referencing each other's locals still end up in
+/// the same partition.
+///
 /// FIXME: This function does not deal with the somewhat subtle symbol
 /// visibility issues around module splitting, including (but not limited to):
 ///
@@ -37,7 +44,7 @@ class StringRef;
 void SplitModule(
     std::unique_ptr<Module> M, unsigned N,
     std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback,
-    bool PreserveLocals = false);
+    bool PreserveLocals = false, bool BalanceByCost = false);
 
 } // End llvm namespace
 
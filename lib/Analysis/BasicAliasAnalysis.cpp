@@ -51,6 +51,16 @@ static cl::opt<bool> EnableRecPhiAnalysis("basicaa-recphi", cl::Hidden,
 STATISTIC(SearchLimitReached, "Number of times the limit to "
                               "decompose GEPs is reached");
 STATISTIC(SearchTimes, "Number of times a GEP is decomposed");
+STATISTIC(NumQueryCacheHits, "Number of queries answered by the query cache");
+STATISTIC(NumDecomposedGEPCacheHits,
+          "Number of GEP decompositions found in the query cache");
+STATISTIC(NumQueryCacheFlushes, "Number of times the query cache is dropped");
+
+/// Keep alias results and decomposed GEPs from one query to the next, until
+/// the function changes. Changes made in place within a pass are only noticed
+/// when they delete or replace a value the cache refers to.
+static cl::opt<bool> CacheQueries("basicaa-cache-queries", cl::Hidden,
+                                  cl::init(false));
 
 /// Cutoff after which to stop analysing a set of phi nodes potentially involved
 /// in a cycle. Because we are analysing 'through' phi nodes, we need to be
@@ -690,6 +700,21 @@ AliasResult BasicAAResult::alias(const MemoryLocation &LocA,
   if (CacheIt != AliasCache.end())
     return CacheIt->second;
 
+  // Only the results of top-level queries may be kept: the ones computed
+  // while recursing can depend on assumptions made for phi cycles.
+  bool UseQueryCache = CacheQueries && AliasCache.empty();
+  if (UseQueryCache) {
+    if (QueryCacheStale)
+      clearQueryCache();
+    auto QueryIt = QueryCache.find(LocPair(LocA, LocB));
+    if (QueryIt == QueryCache.end())
+      QueryIt = QueryCache.find(LocPair(LocB, LocA));
+    if (QueryIt != QueryCache.end()) {
+      ++NumQueryCacheHits;
+      return QueryIt->second;
+    }
+  }
+
   AliasResult Alias = aliasCheck(LocA.Ptr, LocA.Size, LocA.AATags, LocB.Ptr,
                                  LocB.Size, LocB.AATags);
   // AliasCache rarely has more than 1 or 2 elements, always use
@@ -698,9 +723,68 @@ AliasResult BasicAAResult::alias(const MemoryLocation &LocA,
   // FIXME: This should really be shrink_to_inline_capacity_and_clear().
   AliasCache.shrink_and_clear();
   VisitedPhiBBs.clear();
+
+  if (UseQueryCache) {
+    addToQueryCache(LocA.Ptr);
+    addToQueryCache(LocB.Ptr);
+    QueryCache[LocPair(LocA, LocB)] = Alias;
+  }
   return Alias;
 }
 
+void BasicAAResult::QueryCacheVH::deleted() {
+  // Don't touch the handle list from within a handle; let the next query drop
+  // the cache.
+  AAR->QueryCacheStale = true;
+  setValPtr(nullptr);
+}
+
+void BasicAAResult::QueryCacheVH::allUsesReplacedWith(Value *) {
+  AAR->QueryCacheStale = true;
+  setValPtr(nullptr);
+}
+
+void BasicAAResult::clearQueryCache() {
+  if (QueryCacheValues.empty())
+    return;
+  ++NumQueryCacheFlushes;
+  QueryCache.clear();
+  DecomposedGEPCache.clear();
+  QueryCacheValues.clear();
+  QueryCacheHandles.clear();
+  QueryCacheStale = false;
+}
+
+void BasicAAResult::addToQueryCache(const Value *V) {
+  if (QueryCacheValues.insert(V).second)
+    QueryCacheHandles.emplace_front(V, this);
+}
+
+bool BasicAAResult::decomposeGEP(const Value *V, DecomposedGEP &Decomposed) {
+  if (!CacheQueries)
+    return DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+
+  if (QueryCacheStale)
+    clearQueryCache();
+  auto It = DecomposedGEPCache.find(V);
+  if (It != DecomposedGEPCache.end()) {
+    ++NumDecomposedGEPCacheHits;
+    Decomposed = It->second.Decomposed;
+    return It->second.MaxLookupReached;
+  }
+
+  bool MaxLookupReached = DecomposeGEPExpression(V, Decomposed, DL, &AC, DT);
+  // The decomposition also goes stale if its base or indices are replaced.
+  addToQueryCache(V);
+  addToQueryCache(Decomposed.Base);
+  for (const VariableGEPIndex &Index : Decomposed.VarIndices)
+    addToQueryCache(Index.V);
+  CachedDecomposition &Entry = DecomposedGEPCache[V];
+  Entry.Decomposed = Decomposed;
+  Entry.MaxLookupReached = MaxLookupReached;
+  return MaxLookupReached;
+}
+
 /// Checks to see if the specified callsite can clobber the specified memory
 /// object.
 ///
@@ -1023,10 +1107,8 @@ AliasResult BasicAAResult::aliasGEP(const GEPOperator *GEP1, uint64_t V1Size,
                                     const Value *UnderlyingV1,
                                     const Value *UnderlyingV2) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = decomposeGEP(GEP1, DecompGEP1);
+  bool GEP2MaxLookupReached = decomposeGEP(V2, DecompGEP2);
 
   int64_t GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   int64_t GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
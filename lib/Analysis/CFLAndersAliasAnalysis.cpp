@@ -0,0 +1,721 @@
+//- CFLAndersAliasAnalysis.cpp - Inclusion-based Alias Analysis Implementation//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements an inclusion-based (Andersen-style) alias analysis. Like
+// CFLAA, it is context-insensitive, field-insensitive and does not depend on
+// types, but instead of unifying everything that two pointers may refer to, it
+// keeps a points-to set for each pointer. Those sets are the least solution of
+// the usual inclusion constraints:
+//
+//   p = &obj      (alloca, noalias call)   pts(p) contains obj
+//   p = q         (cast, gep, phi, select) pts(p) includes pts(q)
+//   p = *q        (load)                   pts(p) includes *o for o in pts(q)
+//   *p = q        (store)                  *o includes pts(q) for o in pts(p)
+//
+// Memory that code outside of the function can reach is modeled by an unknown
+// object, and arguments point to symbolic objects standing for the memory the
+// caller passed in. Objects become "escaped" when a pointer to them is passed
+// to opaque code or stored where opaque code can see it; escaped objects may be
+// pointed to by any unknown pointer.
+//
+// Each function is solved once, and a summary of what it does to the memory
+// reachable from its arguments is kept next to its points-to sets. Calls to
+// local functions apply the callee's summary instead of treating the call as
+// opaque, so the analysis is interprocedural without ever solving more than
+// one function at a time.
+//
+// To keep compile time and memory bounded, functions with more than
+// -cfl-anders-max-constraints constraints are not analyzed; queries about them
+// are left to the other alias analyses.
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Analysis/CFLAndersAliasAnalysis.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "cfl-anders-aa"
+
+STATISTIC(NumFunctionsAnalyzed, "Number of functions analyzed");
+STATISTIC(NumFunctionsTooLarge,
+          "Number of functions too large to analyze");
+STATISTIC(NumSummariesApplied, "Number of calls resolved through summaries");
+
+static cl::opt<unsigned> MaxConstraints(
+    "cfl-anders-max-constraints", cl::init(50000), cl::Hidden,
+    cl::desc("Maximum number of points-to constraints CFLAndersAA solves per "
+             "function"));
+
+static cl::opt<unsigned> MaxSolverRounds(
+    "cfl-anders-max-rounds", cl::init(256), cl::Hidden,
+    cl::desc("Maximum number of passes over the constraints CFLAndersAA makes "
+             "per function"));
+
+namespace {
+typedef SparseBitVector<> PointsToSet;
+
+/// The object standing for all memory that code outside of the function may
+/// point to.
+const unsigned UnknownObject = 0;
+
+enum class ConstraintKind { AddrOf, Copy, Load, Store, Escape };
+
+/// One inclusion constraint. Dst and Src are nodes, except for AddrOf where
+/// Src is an object; Dst is unused for Escape.
+struct Constraint {
+  ConstraintKind Kind;
+  unsigned Dst;
+  unsigned Src;
+
+  Constraint(ConstraintKind Kind, unsigned Dst, unsigned Src)
+      : Kind(Kind), Dst(Dst), Src(Src) {}
+};
+
+/// A pointer as its callers see it: an argument, what an argument points to,
+/// or anything else.
+struct SummaryTerm {
+  enum TermKind { Unknown, Arg, ArgDeref };
+
+  TermKind Kind;
+  unsigned ArgNo;
+
+  SummaryTerm(TermKind Kind, unsigned ArgNo = 0) : Kind(Kind), ArgNo(ArgNo) {}
+
+  bool operator==(const SummaryTerm &Other) const {
+    return Kind == Other.Kind && ArgNo == Other.ArgNo;
+  }
+};
+
+/// Copies the objects of \p Set out, so that we can update sets it aliases.
+static void copyObjects(const PointsToSet &Set,
+                        SmallVectorImpl<unsigned> &Objects) {
+  Objects.clear();
+  for (unsigned O : Set)
+    Objects.push_back(O);
+}
+
+template <typename T>
+static void insertUnique(SmallVectorImpl<T> &Vec, const T &Elt) {
+  if (std::find(Vec.begin(), Vec.end(), Elt) == Vec.end())
+    Vec.push_back(Elt);
+}
+}
+
+/// Information we have about a function and would like to keep around.
+struct CFLAndersAAResult::FunctionInfo {
+  /// False if the function was too large to analyze.
+  bool Valid;
+
+  DenseMap<const Value *, unsigned> ValueToNode;
+  std::vector<PointsToSet> PointsTo;
+
+  /// Objects standing for memory outside of the function.
+  PointsToSet External;
+  /// Objects that pointers into external memory may point to.
+  PointsToSet Escaped;
+
+  /// What the function may return, store through its arguments, or let
+  /// escape, in terms of its arguments.
+  SmallVector<SummaryTerm, 4> ReturnTerms;
+  SmallVector<std::pair<SummaryTerm, SummaryTerm>, 4> StoreTerms;
+  SmallVector<SummaryTerm, 4> EscapeTerms;
+
+  FunctionInfo() : Valid(false) {}
+};
+
+namespace {
+/// Builds and solves the constraints of a single function.
+class ConstraintBuilder : public InstVisitor<ConstraintBuilder> {
+  CFLAndersAAResult &AA;
+  CFLAndersAAResult::FunctionInfo &Info;
+
+  std::vector<Constraint> Constraints;
+  unsigned NumNodes;
+  unsigned NumObjects;
+  unsigned UnknownNode;
+
+  /// The symbolic objects for what each argument points to, and for what
+  /// that points to in turn.
+  SmallVector<std::pair<unsigned, unsigned>, 8> ArgObjects;
+  PointsToSet GlobalObjects;
+  SmallVector<Value *, 4> ReturnedValues;
+
+  unsigned newNode() { return NumNodes++; }
+  unsigned newObject() { return NumObjects++; }
+
+  void add(ConstraintKind Kind, unsigned Dst, unsigned Src) {
+    Constraints.push_back(Constraint(Kind, Dst, Src));
+  }
+
+  unsigned getNode(Value *V);
+  void escapeOperands(Instruction &I);
+  bool tryApplySummary(CallSite CS, unsigned Result);
+  void visitMemTransfer(MemTransferInst &I);
+
+  SummaryTerm termFor(unsigned Object) const;
+
+public:
+  ConstraintBuilder(CFLAndersAAResult &AA,
+                    CFLAndersAAResult::FunctionInfo &Info)
+      : AA(AA), Info(Info), NumNodes(0), NumObjects(1) {}
+
+  void build(Function &Fn);
+  bool solve();
+
+  // Instructions that can move pointers around.
+  void visitInstruction(Instruction &I);
+  void visitCastInst(CastInst &I);
+  void visitPtrToIntInst(PtrToIntInst &I);
+  void visitIntToPtrInst(IntToPtrInst &I);
+  void visitBinaryOperator(BinaryOperator &I);
+  void visitPHINode(PHINode &I);
+  void visitSelectInst(SelectInst &I);
+  void visitGetElementPtrInst(GetElementPtrInst &I);
+  void visitAllocaInst(AllocaInst &I);
+  void visitLoadInst(LoadInst &I);
+  void visitStoreInst(StoreInst &I);
+  void visitAtomicCmpXchgInst(AtomicCmpXchgInst &I);
+  void visitAtomicRMWInst(AtomicRMWInst &I);
+  void visitVAArgInst(VAArgInst &I);
+  void visitExtractElementInst(ExtractElementInst &I);
+  void visitInsertElementInst(InsertElementInst &I);
+  void visitShuffleVectorInst(ShuffleVectorInst &I);
+  void visitExtractValueInst(ExtractValueInst &I);
+  void visitInsertValueInst(InsertValueInst &I);
+  void visitLandingPadInst(LandingPadInst &I);
+  void visitCallSite(CallSite CS);
+  void visitCallInst(CallInst &I) { visitCallSite(&I); }
+  void visitInvokeInst(InvokeInst &I) { visitCallSite(&I); }
+  void visitReturnInst(ReturnInst &I);
+
+  // Instructions that cannot.
+  void visitCmpInst(CmpInst &) {}
+  void visitFenceInst(FenceInst &) {}
+  void visitBranchInst(BranchInst &) {}
+  void visitSwitchInst(SwitchInst &) {}
+  void visitUnreachableInst(UnreachableInst &) {}
+  void visitDbgInfoIntrinsic(DbgInfoIntrinsic &) {}
+};
+}
+
+/// Returns the node of \p V, creating it along with the constraints of
+/// constants.
+unsigned ConstraintBuilder::getNode(Value *V) {
+  auto It = Info.ValueToNode.find(V);
+  if (It != Info.ValueToNode.end())
+    return It->second;
+  unsigned Node = newNode();
+  Info.ValueToNode[V] = Node;
+
+  if (isa<GlobalValue>(V)) {
+    // Code outside the function can reach every global.
+    unsigned Object = newObject();
+    GlobalObjects.set(Object);
+    add(ConstraintKind::AddrOf, Node, Object);
+  } else if (auto *CE = dyn_cast<ConstantExpr>(V)) {
+    // Constant expressions may only compute pointers from their operands.
+    if (CE->getOpcode() == Instruction::IntToPtr)
+      add(ConstraintKind::AddrOf, Node, UnknownObject);
+    if (!CE->isCompare())
+      for (Value *Op : CE->operands())
+        add(ConstraintKind::Copy, Node, getNode(Op));
+  } else if (isa<ConstantAggregate>(V)) {
+    for (Value *Op : cast<Constant>(V)->operands())
+      add(ConstraintKind::Copy, Node, getNode(Op));
+  }
+  return Node;
+}
+
+void ConstraintBuilder::escapeOperands(Instruction &I) {
+  for (Value *Op : I.operands())
+    if (!isa<BasicBlock>(Op) && !isa<MetadataAsValue>(Op))
+      add(ConstraintKind::Escape, 0, getNode(Op));
+}
+
+void ConstraintBuilder::visitInstruction(Instruction &I) {
+  // Anything we do not model lets its operands escape and produces an unknown
+  // pointer.
+  escapeOperands(I);
+  if (!I.getType()->isVoidTy())
+    add(ConstraintKind::AddrOf, getNode(&I), UnknownObject);
+}
+
+void ConstraintBuilder::visitCastInst(CastInst &I) {
+  add(ConstraintKind::Copy, getNode(&I), getNode(I.getOperand(0)));
+}
+
+void ConstraintBuilder::visitPtrToIntInst(PtrToIntInst &I) {
+  // The integer may be turned back into a pointer anywhere.
+  add(ConstraintKind::Copy, getNode(&I), getNode(I.getOperand(0)));
+  add(ConstraintKind::Escape, 0, getNode(I.getOperand(0)));
+}
+
+void ConstraintBuilder::visitIntToPtrInst(IntToPtrInst &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(0)));
+  add(ConstraintKind::AddrOf, Node, UnknownObject);
+}
+
+void ConstraintBuilder::visitBinaryOperator(BinaryOperator &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(0)));
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(1)));
+}
+
+void ConstraintBuilder::visitPHINode(PHINode &I) {
+  unsigned Node = getNode(&I);
+  for (Value *V : I.incoming_values())
+    add(ConstraintKind::Copy, Node, getNode(V));
+}
+
+void ConstraintBuilder::visitSelectInst(SelectInst &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getTrueValue()));
+  add(ConstraintKind::Copy, Node, getNode(I.getFalseValue()));
+}
+
+void ConstraintBuilder::visitGetElementPtrInst(GetElementPtrInst &I) {
+  // Indices take part too: they may be the difference of two pointers.
+  unsigned Node = getNode(&I);
+  for (Value *Op : I.operands())
+    add(ConstraintKind::Copy, Node, getNode(Op));
+}
+
+void ConstraintBuilder::visitAllocaInst(AllocaInst &I) {
+  add(ConstraintKind::AddrOf, getNode(&I), newObject());
+}
+
+void ConstraintBuilder::visitLoadInst(LoadInst &I) {
+  add(ConstraintKind::Load, getNode(&I), getNode(I.getPointerOperand()));
+}
+
+void ConstraintBuilder::visitStoreInst(StoreInst &I) {
+  add(ConstraintKind::Store, getNode(I.getPointerOperand()),
+      getNode(I.getValueOperand()));
+}
+
+void ConstraintBuilder::visitAtomicCmpXchgInst(AtomicCmpXchgInst &I) {
+  unsigned Ptr = getNode(I.getPointerOperand());
+  add(ConstraintKind::Store, Ptr, getNode(I.getNewValOperand()));
+  add(ConstraintKind::Load, getNode(&I), Ptr);
+}
+
+void ConstraintBuilder::visitAtomicRMWInst(AtomicRMWInst &I) {
+  unsigned Ptr = getNode(I.getPointerOperand());
+  add(ConstraintKind::Store, Ptr, getNode(I.getValOperand()));
+  add(ConstraintKind::Load, getNode(&I), Ptr);
+}
+
+void ConstraintBuilder::visitVAArgInst(VAArgInst &I) {
+  // The va_list is advanced in a target-specific way, and the argument comes
+  // from the caller.
+  add(ConstraintKind::Store, getNode(I.getPointerOperand()), UnknownNode);
+  add(ConstraintKind::AddrOf, getNode(&I), UnknownObject);
+}
+
+// Vectors and aggregates are treated as the union of their elements.
+void ConstraintBuilder::visitExtractElementInst(ExtractElementInst &I) {
+  add(ConstraintKind::Copy, getNode(&I), getNode(I.getVectorOperand()));
+}
+
+void ConstraintBuilder::visitInsertElementInst(InsertElementInst &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(0)));
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(1)));
+}
+
+void ConstraintBuilder::visitShuffleVectorInst(ShuffleVectorInst &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(0)));
+  add(ConstraintKind::Copy, Node, getNode(I.getOperand(1)));
+}
+
+void ConstraintBuilder::visitExtractValueInst(ExtractValueInst &I) {
+  add(ConstraintKind::Copy, getNode(&I),
+      getNode(I.getAggregateOperand()));
+}
+
+void ConstraintBuilder::visitInsertValueInst(InsertValueInst &I) {
+  unsigned Node = getNode(&I);
+  add(ConstraintKind::Copy, Node, getNode(I.getAggregateOperand()));
+  add(ConstraintKind::Copy, Node, getNode(I.getInsertedValueOperand()));
+}
+
+void ConstraintBuilder::visitLandingPadInst(LandingPadInst &I) {
+  // Exceptions come from "nowhere", from our analysis' perspective.
+  add(ConstraintKind::AddrOf, getNode(&I), UnknownObject);
+}
+
+void ConstraintBuilder::visitReturnInst(ReturnInst &I) {
+  if (Value *V = I.getReturnValue()) {
+    getNode(V);
+    ReturnedValues.push_back(V);
+  }
+}
+
+void ConstraintBuilder::visitMemTransfer(MemTransferInst &I) {
+  unsigned Tmp = newNode();
+  add(ConstraintKind::Load, Tmp, getNode(I.getRawSource()));
+  add(ConstraintKind::Store, getNode(I.getRawDest()), Tmp);
+}
+
+/// Apply the summary of the function called by \p CS, if it has one.
+bool ConstraintBuilder::tryApplySummary(CallSite CS, unsigned Result) {
+  Function *Callee = CS.getCalledFunction();
+  if (!Callee || Callee->isDeclaration() || Callee->isVarArg() ||
+      !Callee->hasLocalLinkage() ||
+      Callee->arg_size() != CS.arg_size())
+    return false;
+
+  const CFLAndersAAResult::FunctionInfo *CalleeInfo = AA.ensureCached(Callee);
+  if (!CalleeInfo || !CalleeInfo->Valid)
+    return false;
+
+  SmallVector<unsigned, 8> DerefNodes;
+  DerefNodes.resize(CS.arg_size(), ~0u);
+  auto NodeFor = [&](const SummaryTerm &T) {
+    switch (T.Kind) {
+    case SummaryTerm::Unknown:
+      return UnknownNode;
+    case SummaryTerm::Arg:
+      return getNode(CS.getArgument(T.ArgNo));
+    case SummaryTerm::ArgDeref:
+      if (DerefNodes[T.ArgNo] == ~0u) {
+        DerefNodes[T.ArgNo] = newNode();
+        add(ConstraintKind::Load, DerefNodes[T.ArgNo],
+            getNode(CS.getArgument(T.ArgNo)));
+      }
+      return DerefNodes[T.ArgNo];
+    }
+    llvm_unreachable("Incomplete coverage of SummaryTerm kinds");
+  };
+
+  for (const SummaryTerm &T : CalleeInfo->ReturnTerms)
+    add(ConstraintKind::Copy, Result, NodeFor(T));
+  for (const auto &Store : CalleeInfo->StoreTerms)
+    add(ConstraintKind::Store, NodeFor(Store.first), NodeFor(Store.second));
+  for (const SummaryTerm &T : CalleeInfo->EscapeTerms)
+    add(ConstraintKind::Escape, 0, NodeFor(T));
+  ++NumSummariesApplied;
+  return true;
+}
+
+void ConstraintBuilder::visitCallSite(CallSite CS) {
+  Instruction *I = CS.getInstruction();
+  unsigned Result = getNode(I);
+
+  if (auto *II = dyn_cast<IntrinsicInst>(I)) {
+    switch (II->getIntrinsicID()) {
+    case Intrinsic::lifetime_start:
+    case Intrinsic::lifetime_end:
+    case Intrinsic::invariant_start:
+    case Intrinsic::invariant_end:
+    case Intrinsic::assume:
+      return;
+    case Intrinsic::memcpy:
+    case Intrinsic::memmove:
+      visitMemTransfer(cast<MemTransferInst>(*II));
+      return;
+    case Intrinsic::memset:
+      // The bytes written may be read back as a pointer.
+      add(ConstraintKind::Store, getNode(II->getArgOperand(0)), UnknownNode);
+      return;
+    default:
+      break;
+    }
+  }
+
+  if (tryApplySummary(CS, Result))
+    return;
+
+  // Memory returned by a noalias call is a new object.
+  if (isNoAliasCall(I))
+    add(ConstraintKind::AddrOf, Result, newObject());
+  else if (!I->getType()->isVoidTy())
+    add(ConstraintKind::AddrOf, Result, UnknownObject);
+
+  // An opaque callee may capture any argument unless told otherwise, and
+  // write anything to what the arguments point to unless it only reads.
+  bool OnlyReads = CS.onlyReadsMemory();
+  for (unsigned ArgNo = 0, E = CS.arg_size(); ArgNo != E; ++ArgNo) {
+    unsigned Arg = getNode(CS.getArgument(ArgNo));
+    if (!CS.doesNotCapture(ArgNo))
+      add(ConstraintKind::Escape, 0, Arg);
+    else if (!OnlyReads)
+      add(ConstraintKind::Store, Arg, UnknownNode);
+  }
+  // The callee itself, for indirect calls and inline asm.
+  if (!CS.getCalledFunction())
+    add(ConstraintKind::Escape, 0, getNode(CS.getCalledValue()));
+}
+
+void ConstraintBuilder::build(Function &Fn) {
+  UnknownNode = newNode();
+  add(ConstraintKind::AddrOf, UnknownNode, UnknownObject);
+
+  for (Argument &Arg : Fn.args()) {
+    unsigned ArgObject = newObject();
+    unsigned DerefObject = newObject();
+    ArgObjects.push_back(std::make_pair(ArgObject, DerefObject));
+    add(ConstraintKind::AddrOf, getNode(&Arg), ArgObject);
+  }
+
+  for (BasicBlock &BB : Fn) {
+    for (Instruction &I : BB) {
+      visit(I);
+      if (Constraints.size() > MaxConstraints)
+        return;
+    }
+  }
+}
+
+SummaryTerm ConstraintBuilder::termFor(unsigned Object) const {
+  for (unsigned ArgNo = 0, E = ArgObjects.size(); ArgNo != E; ++ArgNo) {
+    if (ArgObjects[ArgNo].first == Object)
+      return SummaryTerm(SummaryTerm::Arg, ArgNo);
+    if (ArgObjects[ArgNo].second == Object)
+      return SummaryTerm(SummaryTerm::ArgDeref, ArgNo);
+  }
+  return SummaryTerm(SummaryTerm::Unknown);
+}
+
+bool ConstraintBuilder::solve() {
+  if (Constraints.size() > MaxConstraints)
+    return false;
+
+  std::vector<PointsToSet> &PointsTo = Info.PointsTo;
+  PointsTo.resize(NumNodes);
+  std::vector<PointsToSet> Content(NumObjects);
+  PointsToSet &External = Info.External;
+  PointsToSet &Escaped = Info.Escaped;
+
+  // The unknown object and the memory behind each argument stand for memory
+  // outside of the function, which may contain anything outside code can
+  // reach.
+  External.set(UnknownObject);
+  Content[UnknownObject].set(UnknownObject);
+  for (const auto &Objects : ArgObjects) {
+    External.set(Objects.first);
+    External.set(Objects.second);
+    Content[Objects.first].set(Objects.second);
+    Content[Objects.second].set(UnknownObject);
+  }
+  Escaped |= External;
+  Escaped |= GlobalObjects;
+
+  bool Changed = true;
+  unsigned Rounds = 0;
+  SmallVector<unsigned, 16> Objects;
+  while (Changed) {
+    if (++Rounds > MaxSolverRounds)
+      return false;
+    Changed = false;
+
+    for (const Constraint &C : Constraints) {
+      switch (C.Kind) {
+      case ConstraintKind::AddrOf:
+        Changed |= PointsTo[C.Dst].test_and_set(C.Src);
+        break;
+      case ConstraintKind::Copy:
+        Changed |= PointsTo[C.Dst] |= PointsTo[C.Src];
+        break;
+      case ConstraintKind::Load:
+        copyObjects(PointsTo[C.Src], Objects);
+        for (unsigned O : Objects)
+          Changed |= PointsTo[C.Dst] |= Content[O];
+        break;
+      case ConstraintKind::Store:
+        for (unsigned O : PointsTo[C.Dst])
+          Changed |= Content[O] |= PointsTo[C.Src];
+        break;
+      case ConstraintKind::Escape:
+        Changed |= Escaped |= PointsTo[C.Src];
+        break;
+      }
+    }
+
+    // Whatever escaped memory points to escapes too, and outside code may
+    // store unknown pointers into it.
+    copyObjects(Escaped, Objects);
+    for (unsigned O : Objects) {
+      Changed |= Escaped |= Content[O];
+      if (!External.test(O))
+        Changed |= Content[O].test_and_set(UnknownObject);
+    }
+  }
+
+  // Summarize what callers need to know, in terms of the arguments. The
+  // memory behind an argument only escapes if it can be reached from
+  // globals, unknown memory or an escaping pointer.
+  for (Value *V : ReturnedValues)
+    for (unsigned O : PointsTo[Info.ValueToNode[V]])
+      insertUnique(Info.ReturnTerms, termFor(O));
+
+  for (const Constraint &C : Constraints) {
+    if (C.Kind != ConstraintKind::Store)
+      continue;
+    for (unsigned Target : PointsTo[C.Dst]) {
+      SummaryTerm TargetTerm = termFor(Target);
+      if (TargetTerm.Kind == SummaryTerm::Unknown)
+        continue;
+      for (unsigned O : PointsTo[C.Src])
+        insertUnique(Info.StoreTerms, std::make_pair(TargetTerm, termFor(O)));
+    }
+  }
+
+  PointsToSet Reached;
+  Reached.set(UnknownObject);
+  Reached |= GlobalObjects;
+  for (const Constraint &C : Constraints)
+    if (C.Kind == ConstraintKind::Escape)
+      Reached |= PointsTo[C.Src];
+  bool ReachedChanged = true;
+  while (ReachedChanged) {
+    ReachedChanged = false;
+    copyObjects(Reached, Objects);
+    for (unsigned O : Objects)
+      ReachedChanged |= Reached |= Content[O];
+  }
+  for (unsigned O : Reached) {
+    SummaryTerm T = termFor(O);
+    if (T.Kind != SummaryTerm::Unknown)
+      insertUnique(Info.EscapeTerms, T);
+  }
+
+  return true;
+}
+
+CFLAndersAAResult::CFLAndersAAResult() : AAResultBase() {}
+CFLAndersAAResult::CFLAndersAAResult(CFLAndersAAResult &&Arg)
+    : AAResultBase(std::move(Arg)), Cache(std::move(Arg.Cache)),
+      Handles(std::move(Arg.Handles)) {}
+CFLAndersAAResult::~CFLAndersAAResult() {}
+
+std::unique_ptr<CFLAndersAAResult::FunctionInfo>
+CFLAndersAAResult::buildInfoFrom(Function *Fn) {
+  std::unique_ptr<FunctionInfo> Info(new FunctionInfo());
+  ConstraintBuilder Builder(*this, *Info);
+  Builder.build(*Fn);
+  Info->Valid = Builder.solve();
+  ++NumFunctionsAnalyzed;
+  if (!Info->Valid) {
+    ++NumFunctionsTooLarge;
+    DEBUG(dbgs() << "CFLAndersAA: " << Fn->getName()
+                 << " is too large to analyze\n");
+    // Keep nothing around for functions we gave up on.
+    Info.reset(new FunctionInfo());
+  }
+  return Info;
+}
+
+const CFLAndersAAResult::FunctionInfo *
+CFLAndersAAResult::ensureCached(Function *Fn) {
+  auto Iter = Cache.find(Fn);
+  if (Iter != Cache.end())
+    return Iter->second.get();
+
+  // Mark the function as being analyzed, so that recursion sees null.
+  Cache[Fn] = nullptr;
+  // Note that we can't do Cache[Fn] = buildInfoFrom(Fn) here: the function
+  // call may get evaluated after operator[], potentially triggering a DenseMap
+  // resize and invalidating the reference returned by operator[]
+  auto Info = buildInfoFrom(Fn);
+  auto &Entry = Cache[Fn];
+  Entry = std::move(Info);
+  Handles.push_front(FunctionHandle(Fn, this));
+  return Entry.get();
+}
+
+void CFLAndersAAResult::evict(Function *Fn) { Cache.erase(Fn); }
+
+/// Try to go from a Value* to a Function*.
+static Function *parentFunctionOfValue(const Value *Val) {
+  if (auto *Inst = dyn_cast<Instruction>(Val))
+    return const_cast<Function *>(Inst->getParent()->getParent());
+  if (auto *Arg = dyn_cast<Argument>(Val))
+    return const_cast<Function *>(Arg->getParent());
+  return nullptr;
+}
+
+AliasResult CFLAndersAAResult::query(const MemoryLocation &LocA,
+                                     const MemoryLocation &LocB) {
+  Function *Fn = parentFunctionOfValue(LocA.Ptr);
+  if (!Fn)
+    Fn = parentFunctionOfValue(LocB.Ptr);
+  if (!Fn)
+    return MayAlias;
+  assert((!parentFunctionOfValue(LocB.Ptr) ||
+          parentFunctionOfValue(LocB.Ptr) == Fn) &&
+         "Interprocedural queries not supported");
+
+  const FunctionInfo *Info = ensureCached(Fn);
+  if (!Info || !Info->Valid)
+    return MayAlias;
+
+  auto IterA = Info->ValueToNode.find(LocA.Ptr);
+  auto IterB = Info->ValueToNode.find(LocB.Ptr);
+  if (IterA == Info->ValueToNode.end() || IterB == Info->ValueToNode.end())
+    return MayAlias;
+
+  const PointsToSet &PtsA = Info->PointsTo[IterA->second];
+  const PointsToSet &PtsB = Info->PointsTo[IterB->second];
+  if (PtsA.intersects(PtsB))
+    return MayAlias;
+
+  // A pointer into external memory may point to anything that escaped.
+  if (PtsA.intersects(Info->External) && PtsB.intersects(Info->Escaped))
+    return MayAlias;
+  if (PtsB.intersects(Info->External) && PtsA.intersects(Info->Escaped))
+    return MayAlias;
+
+  return NoAlias;
+}
+
+char CFLAndersAA::PassID;
+
+CFLAndersAAResult CFLAndersAA::run(Function &F, AnalysisManager<Function> &AM) {
+  return CFLAndersAAResult();
+}
+
+char CFLAndersAAWrapperPass::ID = 0;
+INITIALIZE_PASS(CFLAndersAAWrapperPass, "cfl-anders-aa",
+                "Inclusion-Based CFL Alias Analysis", false, true)
+
+ImmutablePass *llvm::createCFLAndersAAWrapperPass() {
+  return new CFLAndersAAWrapperPass();
+}
+
+CFLAndersAAWrapperPass::CFLAndersAAWrapperPass() : ImmutablePass(ID) {
+  initializeCFLAndersAAWrapperPassPass(*PassRegistry::getPassRegistry());
+}
+
+bool CFLAndersAAWrapperPass::doInitialization(Module &M) {
+  Result.reset(new CFLAndersAAResult());
+  return false;
+}
+
+bool CFLAndersAAWrapperPass::doFinalization(Module &M) {
+  Result.reset();
+  return false;
+}
+
+void CFLAndersAAWrapperPass::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesAll();
+}
@@ -124,6 +124,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassMemoryRegion PassMemory(CGSP, CG.getModule().getContext());
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
@@ -38,6 +38,9 @@ using namespace llvm;
 #define DEBUG_TYPE "inline-cost"
 
 STATISTIC(NumCallsAnalyzed, "Number of call sites analyzed");
+STATISTIC(NumBodyCostsComputed, "Number of callee body costs cached");
+STATISTIC(NumBodyCostsReused,
+          "Number of call sites analyzed with a cached callee body cost");
 
 // Threshold to use when optsize is specified (and there is no
 // -inline-threshold).
@@ -85,9 +88,20 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   // easily cacheable. Instead, use the cover function paramHasAttr.
   CallSite CandidateCS;
 
+  /// The cache of callee body costs to use, if any.
+  InlineCostCache *Cache;
+
   int Threshold;
   int Cost;
 
+  /// Whether the walk over the callee body is still in its first block with
+  /// more than one successor.
+  bool SingleBB;
+
+  /// The highest cost at a point where the walk over the callee body checks
+  /// the threshold, before and after it leaves the single-BB phase.
+  int MaxSingleBBCost, MaxMultiBBCost;
+
   bool IsCallerRecursive;
   bool IsRecursiveCall;
   bool ExposesReturnsTwice;
@@ -144,6 +158,24 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
   /// itself.
   bool paramHasAttr(Argument *A, Attribute::AttrKind Attr);
 
+  /// Map the arguments of the callee to what we know about the arguments
+  /// passed at \p CS.
+  void mapArguments(CallSite CS);
+
+  /// Describe how the arguments mapped by mapArguments affect the walk over
+  /// the callee body. Returns false if the walk depends on constant
+  /// arguments, which we don't cache.
+  bool computeArgKey(SmallVectorImpl<int64_t> &ArgKey);
+
+  /// Record the cost of the callee body for all call sites described by
+  /// \p ArgKey in the cache.
+  const InlineCostCache::BodyCost &computeBodyCost(CallSite CS,
+                                                   ArrayRef<int64_t> ArgKey);
+
+  /// Account for the callee body using the cache. Returns false if the cache
+  /// can't be used and the body must be analyzed for this call site.
+  bool applyCachedBodyCost(int SingleBBBonus);
+
   /// Return true if the given value is known non null within the callee if
   /// inlined through this particular callsite.
   bool isKnownNonNullInCallee(Value *V);
@@ -159,6 +191,13 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
   // Custom analysis routines.
   bool analyzeBlock(BasicBlock *BB, SmallPtrSetImpl<const Value *> &EphValues);
+  bool analyzeBody(int SingleBBBonus);
+
+  /// Note the cost at a point where we check it against the threshold.
+  void noteCostCheck() {
+    int &MaxCost = SingleBB ? MaxSingleBBCost : MaxMultiBBCost;
+    MaxCost = std::max(MaxCost, Cost);
+  }
 
   // Disable several entry points to the visitor so we don't accidentally use
   // them by declaring but not defining them here.
@@ -200,9 +239,12 @@ class CallAnalyzer : public InstVisitor<CallAnalyzer, bool> {
 
 public:
   CallAnalyzer(const TargetTransformInfo &TTI, AssumptionCacheTracker *ACT,
-               Function &Callee, int Threshold, CallSite CSArg)
-      : TTI(TTI), ACT(ACT), F(Callee), CandidateCS(CSArg), Threshold(Threshold),
-        Cost(0), IsCallerRecursive(false), IsRecursiveCall(false),
+               Function &Callee, int Threshold, CallSite CSArg,
+               InlineCostCache *Cache = nullptr)
+      : TTI(TTI), ACT(ACT), F(Callee), CandidateCS(CSArg), Cache(Cache),
+        Threshold(Threshold), Cost(0), SingleBB(true),
+        MaxSingleBBCost(INT_MIN), MaxMultiBBCost(INT_MIN),
+        IsCallerRecursive(false), IsRecursiveCall(false),
         ExposesReturnsTwice(false), HasDynamicAlloca(false),
         ContainsNoDuplicateCall(false), HasReturn(false), HasIndirectBr(false),
         HasFrameEscape(false), AllocatedSize(0), NumInstructions(0),
@@ -1142,6 +1184,7 @@ bool CallAnalyzer::analyzeBlock(BasicBlock *BB,
 
     // Check if we've past the maximum possible threshold so we don't spin in
     // huge basic blocks that will never inline.
+    noteCostCheck();
     if (Cost > Threshold)
       return false;
   }
@@ -1221,7 +1264,6 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   // Track whether the post-inlining function would have more than one basic
   // block. A single basic block is often intended for inlining. Balloon the
   // threshold by 50% until we pass the single-BB phase.
-  bool SingleBB = true;
   int SingleBBBonus = Threshold / 2;
 
   // Speculatively apply all possible bonuses to Threshold. If cost exceeds
@@ -1289,8 +1331,30 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
-  // Populate our simplified values by mapping from function arguments to call
-  // arguments with known important simplifications.
+  mapArguments(CS);
+  if (!applyCachedBodyCost(SingleBBBonus) && !analyzeBody(SingleBBBonus))
+    return false;
+
+  // If this is a noduplicate call, we can still inline as long as
+  // inlining this would cause the removal of the caller (so the instruction
+  // is not actually duplicated, just moved).
+  if (!OnlyOneCallAndLocalLinkage && ContainsNoDuplicateCall)
+    return false;
+
+  // We applied the maximum possible vector bonus at the beginning. Now,
+  // subtract the excess bonus, if any, from the Threshold before
+  // comparing against Cost.
+  if (NumVectorInstructions <= NumInstructions / 10)
+    Threshold -= FiftyPercentVectorBonus;
+  else if (NumVectorInstructions <= NumInstructions / 2)
+    Threshold -= (FiftyPercentVectorBonus - TenPercentVectorBonus);
+
+  return Cost < std::max(1, Threshold);
+}
+
+/// \brief Populate our simplified values by mapping from function arguments
+/// to call arguments with known important simplifications.
+void CallAnalyzer::mapArguments(CallSite CS) {
   CallSite::arg_iterator CAI = CS.arg_begin();
   for (Function::arg_iterator FAI = F.arg_begin(), FAE = F.arg_end();
        FAI != FAE; ++FAI, ++CAI) {
@@ -1312,7 +1376,103 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   NumConstantArgs = SimplifiedValues.size();
   NumConstantOffsetPtrArgs = ConstantOffsetPtrs.size();
   NumAllocaArgs = SROAArgValues.size();
+}
+
+bool CallAnalyzer::computeArgKey(SmallVectorImpl<int64_t> &ArgKey) {
+  SmallVector<Value *, 8> Bases;
+  for (Argument &A : F.args()) {
+    if (SimplifiedValues.count(&A))
+      return false;
+
+    // Identify the pointer arguments by the first argument with the same
+    // base, so that comparisons between them fold the same way.
+    int64_t BaseGroup = 0, Offset = 0;
+    auto It = ConstantOffsetPtrs.find(&A);
+    if (It != ConstantOffsetPtrs.end()) {
+      if (It->second.second.getMinSignedBits() > 64)
+        return false;
+      Offset = It->second.second.getSExtValue();
+      BaseGroup = std::find(Bases.begin(), Bases.end(), It->second.first) -
+                  Bases.begin() + 1;
+    }
+    Bases.push_back(It != ConstantOffsetPtrs.end() ? It->second.first
+                                                   : nullptr);
+    ArgKey.push_back(BaseGroup);
+    ArgKey.push_back(Offset);
+    ArgKey.push_back(SROAArgValues.count(&A) |
+                     (paramHasAttr(&A, Attribute::NonNull) << 1));
+  }
+  return true;
+}
+
+const InlineCostCache::BodyCost &
+CallAnalyzer::computeBodyCost(CallSite CS, ArrayRef<int64_t> ArgKey) {
+  // Walk the whole body, without a threshold and without the checks that
+  // depend on the caller.
+  CallAnalyzer CA(TTI, ACT, F, INT_MAX, CS);
+  CA.mapArguments(CS);
+
+  InlineCostCache::BodyCost BC;
+  BC.ArgKey.append(ArgKey.begin(), ArgKey.end());
+  BC.Aborted = !CA.analyzeBody(0);
+  BC.Cost = CA.Cost;
+  BC.MaxSingleBBCost = CA.MaxSingleBBCost;
+  BC.MaxMultiBBCost = CA.MaxMultiBBCost;
+  BC.AllocatedSize = CA.AllocatedSize;
+  BC.NumInstructions = CA.NumInstructions;
+  BC.NumVectorInstructions = CA.NumVectorInstructions;
+  BC.SingleBB = CA.SingleBB;
+  BC.ContainsNoDuplicateCall = CA.ContainsNoDuplicateCall;
+  BC.NumConstantPtrCmps = CA.NumConstantPtrCmps;
+  BC.NumConstantPtrDiffs = CA.NumConstantPtrDiffs;
+  BC.NumInstructionsSimplified = CA.NumInstructionsSimplified;
+  BC.SROACostSavings = CA.SROACostSavings;
+  BC.SROACostSavingsLost = CA.SROACostSavingsLost;
+  ++NumBodyCostsComputed;
+  return Cache->insert(&F, std::move(BC));
+}
+
+bool CallAnalyzer::applyCachedBodyCost(int SingleBBBonus) {
+  SmallVector<int64_t, 8> ArgKey;
+  if (!Cache || !computeArgKey(ArgKey))
+    return false;
+
+  const InlineCostCache::BodyCost *BC = Cache->lookup(&F, ArgKey);
+  if (!BC)
+    BC = &computeBodyCost(CandidateCS, ArgKey);
+
+  // The cached cost is only what analyzeBody would compute if it walked the
+  // whole body. If it would have stopped early at this call site, let it do
+  // so, as the cost it stops at is what we report.
+  if (BC->Aborted || Cost + BC->MaxSingleBBCost > Threshold ||
+      (BC->MaxMultiBBCost != INT_MIN &&
+       Cost + BC->MaxMultiBBCost > Threshold - SingleBBBonus) ||
+      (IsCallerRecursive &&
+       BC->AllocatedSize > InlineConstants::TotalAllocaSizeRecursiveCaller))
+    return false;
 
+  Cost += BC->Cost;
+  SingleBB = BC->SingleBB;
+  if (!SingleBB)
+    Threshold -= SingleBBBonus;
+  AllocatedSize = BC->AllocatedSize;
+  NumInstructions = BC->NumInstructions;
+  NumVectorInstructions = BC->NumVectorInstructions;
+  ContainsNoDuplicateCall = BC->ContainsNoDuplicateCall;
+  NumConstantPtrCmps = BC->NumConstantPtrCmps;
+  NumConstantPtrDiffs = BC->NumConstantPtrDiffs;
+  NumInstructionsSimplified = BC->NumInstructionsSimplified;
+  SROACostSavings = BC->SROACostSavings;
+  SROACostSavingsLost = BC->SROACostSavingsLost;
+  ++NumBodyCostsReused;
+  return true;
+}
+
+/// \brief Analyze the cost of the callee body at this call site, starting in
+/// the single-BB phase with \p SingleBBBonus applied to the threshold.
+///
+/// Returns false if inlining is not viable.
+bool CallAnalyzer::analyzeBody(int SingleBBBonus) {
   // FIXME: If a caller has multiple calls to a callee, we end up recomputing
   // the ephemeral values multiple times (and they're completely determined by
   // the callee, so this is purely duplicate work).
@@ -1336,6 +1496,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
   for (unsigned Idx = 0; Idx != BBWorklist.size(); ++Idx) {
     // Bail out the moment we cross the threshold. This means we'll under-count
     // the cost, but only when undercounting doesn't matter.
+    noteCostCheck();
     if (Cost > Threshold)
       break;
 
@@ -1396,21 +1557,7 @@ bool CallAnalyzer::analyzeCall(CallSite CS) {
     }
   }
 
-  // If this is a noduplicate call, we can still inline as long as
-  // inlining this would cause the removal of the caller (so the instruction
-  // is not actually duplicated, just moved).
-  if (!OnlyOneCallAndLocalLinkage && ContainsNoDuplicateCall)
-    return false;
-
-  // We applied the maximum possible vector bonus at the beginning. Now,
-  // subtract the excess bonus, if any, from the Threshold before
-  // comparing against Cost.
-  if (NumVectorInstructions <= NumInstructions / 10)
-    Threshold -= FiftyPercentVectorBonus;
-  else if (NumVectorInstructions <= NumInstructions / 2)
-    Threshold -= (FiftyPercentVectorBonus - TenPercentVectorBonus);
-
-  return Cost < std::max(1, Threshold);
+  return true;
 }
 
 #if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
@@ -1449,11 +1596,31 @@ static bool functionsHaveCompatibleAttributes(Function *Caller,
          AttributeFuncs::areInlineCompatible(*Caller, *Callee);
 }
 
+const InlineCostCache::BodyCost *
+InlineCostCache::lookup(const Function *Callee,
+                        ArrayRef<int64_t> ArgKey) const {
+  auto It = Costs.find(Callee);
+  if (It == Costs.end())
+    return nullptr;
+  for (const BodyCost &BC : It->second)
+    if (ArrayRef<int64_t>(BC.ArgKey) == ArgKey)
+      return &BC;
+  return nullptr;
+}
+
+const InlineCostCache::BodyCost &
+InlineCostCache::insert(const Function *Callee, BodyCost Cost) {
+  SmallVectorImpl<BodyCost> &CalleeCosts = Costs[Callee];
+  CalleeCosts.push_back(std::move(Cost));
+  return CalleeCosts.back();
+}
+
 InlineCost llvm::getInlineCost(CallSite CS, int DefaultThreshold,
                                TargetTransformInfo &CalleeTTI,
-                               AssumptionCacheTracker *ACT) {
+                               AssumptionCacheTracker *ACT,
+                               InlineCostCache *Cache) {
   return getInlineCost(CS, CS.getCalledFunction(), DefaultThreshold, CalleeTTI,
-                       ACT);
+                       ACT, Cache);
 }
 
 int llvm::computeThresholdFromOptLevels(unsigned OptLevel,
@@ -1472,7 +1639,8 @@ int llvm::getDefaultInlineThreshold() { return DefaultInlineThreshold; }
 InlineCost llvm::getInlineCost(CallSite CS, Function *Callee,
                                int DefaultThreshold,
                                TargetTransformInfo &CalleeTTI,
-                               AssumptionCacheTracker *ACT) {
+                               AssumptionCacheTracker *ACT,
+                               InlineCostCache *Cache) {
 
   // Cannot inline indirect calls.
   if (!Callee)
@@ -1506,7 +1674,7 @@ InlineCost llvm::getInlineCost(CallSite CS, Function *Callee,
   DEBUG(llvm::dbgs() << "      Analyzing call of " << Callee->getName()
                      << "...\n");
 
-  CallAnalyzer CA(CalleeTTI, ACT, *Callee, DefaultThreshold, CS);
+  CallAnalyzer CA(CalleeTTI, ACT, *Callee, DefaultThreshold, CS, Cache);
   bool ShouldInline = CA.analyzeCall(CS);
 
   DEBUG(CA.dump());
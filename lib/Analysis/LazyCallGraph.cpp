@@ -1404,6 +1404,48 @@ void LazyCallGraph::connectRefSCC(RefSCC &RC) {
     LeafRefSCCs.push_back(&RC);
 }
 
+SmallVector<SmallVector<LazyCallGraph::RefSCC *, 4>, 4>
+LazyCallGraph::getIndependentRefSCCLevels() {
+  // Finish the DFS so that the parent sets are complete.
+  while (getNextRefSCCInPostOrder())
+    ;
+
+  // Every RefSCC is an ancestor of a leaf, so walking up from the leaves
+  // finds all of them. Count the children of each one on the way.
+  SmallDenseMap<RefSCC *, int, 16> NumChildren;
+  SmallPtrSet<RefSCC *, 16> Visited;
+  SmallVector<RefSCC *, 16> Worklist(LeafRefSCCs.begin(), LeafRefSCCs.end());
+  Visited.insert(LeafRefSCCs.begin(), LeafRefSCCs.end());
+  while (!Worklist.empty()) {
+    RefSCC *RC = Worklist.pop_back_val();
+    for (RefSCC *ParentRC : RC->Parents) {
+      ++NumChildren[ParentRC];
+      if (Visited.insert(ParentRC).second)
+        Worklist.push_back(ParentRC);
+    }
+  }
+
+  // Then visit the RefSCCs bottom-up, each one once all of its children are
+  // done, keeping track of the longest path from a leaf.
+  SmallDenseMap<RefSCC *, unsigned, 16> Level;
+  SmallVector<SmallVector<RefSCC *, 4>, 4> Levels;
+  Worklist.append(LeafRefSCCs.begin(), LeafRefSCCs.end());
+  while (!Worklist.empty()) {
+    RefSCC *RC = Worklist.pop_back_val();
+    unsigned L = Level.lookup(RC);
+    if (Levels.size() <= L)
+      Levels.resize(L + 1);
+    Levels[L].push_back(RC);
+    for (RefSCC *ParentRC : RC->Parents) {
+      unsigned &ParentL = Level[ParentRC];
+      ParentL = std::max(ParentL, L + 1);
+      if (--NumChildren[ParentRC] == 0)
+        Worklist.push_back(ParentRC);
+    }
+  }
+  return Levels;
+}
+
 LazyCallGraph::RefSCC *LazyCallGraph::getNextRefSCCInPostOrder() {
   if (DFSStack.empty()) {
     Node *N;
@@ -15,6 +15,7 @@
 #include "llvm/Analysis/LazyValueInfo.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
@@ -29,6 +30,7 @@
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/IR/ValueHandle.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
@@ -38,6 +40,25 @@ using namespace PatternMatch;
 
 #define DEBUG_TYPE "lazy-value-info"
 
+STATISTIC(NumBlockValues, "Number of block values cached");
+STATISTIC(NumOverdefinedValues, "Number of overdefined block values cached");
+STATISTIC(NumCappedValues,
+          "Number of block values made overdefined by the per-value limit");
+STATISTIC(NumAbandonedQueries,
+          "Number of queries abandoned because of the step limit");
+
+// Together these two options bound the memory and the time LVI spends on a
+// function. Both fall back to overdefined, which is always correct.
+static cl::opt<unsigned> MaxBlockValuesPerValue(
+    "lvi-max-block-values-per-value", cl::Hidden, cl::init(0),
+    cl::desc("Maximum number of blocks a value may have a cached lattice "
+             "value other than overdefined for (0 = no limit)"));
+
+static cl::opt<unsigned> MaxStepsPerQuery(
+    "lvi-max-steps-per-query", cl::Hidden, cl::init(0),
+    cl::desc("Maximum number of block values solved for a single query "
+             "before giving up (0 = no limit)"));
+
 char LazyValueInfo::ID = 0;
 INITIALIZE_PASS_BEGIN(LazyValueInfo, "lazy-value-info",
                 "Lazy Value Information Analysis", false, true)
@@ -434,10 +455,22 @@ namespace {
 
       // Insert over-defined values into their own cache to reduce memory
       // overhead.
-      if (Result.isOverdefined())
+      if (Result.isOverdefined()) {
+        ++NumOverdefinedValues;
         OverDefinedCache[BB].insert(Val);
-      else
-        lookup(Val)[BB] = Result;
+        return;
+      }
+
+      // Once a value has reached its limit, give up on any further blocks.
+      ValueCacheEntryTy &Entry = lookup(Val);
+      if (MaxBlockValuesPerValue && Entry.size() >= MaxBlockValuesPerValue &&
+          !Entry.count(BB)) {
+        ++NumCappedValues;
+        OverDefinedCache[BB].insert(Val);
+        return;
+      }
+      ++NumBlockValues;
+      Entry[BB] = Result;
     }
 
     LVILatticeVal getBlockValue(Value *Val, BasicBlock *BB);
@@ -567,7 +600,23 @@ void LazyValueInfoCache::eraseBlock(BasicBlock *BB) {
 }
 
 void LazyValueInfoCache::solve() {
+  unsigned Steps = 0;
   while (!BlockValueStack.empty()) {
+    if (MaxStepsPerQuery && ++Steps > MaxStepsPerQuery) {
+      DEBUG(dbgs() << "Giving up on query after " << MaxStepsPerQuery
+                   << " steps\n");
+      ++NumAbandonedQueries;
+      // Everything still on the stack, including the value that was queried,
+      // is conservatively overdefined.
+      while (!BlockValueStack.empty()) {
+        std::pair<BasicBlock*, Value*> &e = BlockValueStack.top();
+        insertResult(e.second, e.first, LVILatticeVal::getOverdefined());
+        BlockValueStack.pop();
+      }
+      BlockValueSet.clear();
+      return;
+    }
+
     std::pair<BasicBlock*, Value*> &e = BlockValueStack.top();
     assert(BlockValueSet.count(e) && "Stack value should be in BlockValueSet!");
 
@@ -194,7 +194,11 @@ bool LPPassManager::runOnFunction(Function &F) {
 
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
-        TimeRegion PassTimer(getPassTimer(P));
+        Timer *T = getPassTimer(P);
+        TimeRegion PassTimer(T);
+        TimeRegion FunctionTimer(T ? getPassFunctionTimer(P->getPassName(), F)
+                                   : nullptr);
+        PassMemoryRegion PassMemory(P, F.getContext());
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
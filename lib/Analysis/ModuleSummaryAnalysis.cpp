@@ -13,6 +13,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/Analysis/BitSetUtils.h"
 #include "llvm/Analysis/BlockFrequencyInfo.h"
 #include "llvm/Analysis/BlockFrequencyInfoImpl.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
@@ -21,12 +22,25 @@
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/ProfileSummary.h"
 #include "llvm/IR/ValueSymbolTable.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "module-summary-analysis"
 
+// The cutoffs are in parts per million of the total profile count, as in the
+// detailed profile summary.
+static cl::opt<unsigned> HotCallCutoff(
+    "summary-hot-call-cutoff", cl::init(990000), cl::Hidden,
+    cl::desc("Profile summary cutoff whose minimum count makes a call edge "
+             "hot"));
+static cl::opt<unsigned> ColdCallCutoff(
+    "summary-cold-call-cutoff", cl::init(999999), cl::Hidden,
+    cl::desc("Profile summary cutoff whose minimum count makes a call edge "
+             "cold"));
+
 // Walk through the operands of a given User via worklist iteration and populate
 // the set of GlobalValue references encountered. Invoked either on an
 // Instruction or a GlobalVariable (which walks its initializer).
@@ -62,6 +76,59 @@ static void findRefEdges(const User *CurUser, DenseSet<const Value *> &RefEdges,
   }
 }
 
+void ModuleSummaryIndexBuilder::computeCountThresholds() {
+  Metadata *MD = M->getModuleFlag("ProfileSummary");
+  if (!MD)
+    return;
+  std::unique_ptr<ProfileSummary> Summary(ProfileSummary::getFromMD(MD));
+  if (!Summary)
+    return;
+  auto findMinCount = [&](unsigned Cutoff) -> Optional<uint64_t> {
+    for (const ProfileSummaryEntry &Entry : Summary->getDetailedSummary())
+      if (Entry.Cutoff >= Cutoff)
+        return Entry.MinCount;
+    return None;
+  };
+  HotCountThreshold = findMinCount(HotCallCutoff);
+  ColdCountThreshold = findMinCount(ColdCallCutoff);
+}
+
+CalleeInfo::HotnessType
+ModuleSummaryIndexBuilder::getHotness(uint64_t Count) const {
+  if (!HotCountThreshold || !ColdCountThreshold)
+    return CalleeInfo::HotnessType::Unknown;
+  if (Count >= *HotCountThreshold)
+    return CalleeInfo::HotnessType::Hot;
+  if (Count <= *ColdCountThreshold)
+    return CalleeInfo::HotnessType::Cold;
+  return CalleeInfo::HotnessType::None;
+}
+
+void ModuleSummaryIndexBuilder::computeVTableTypes() {
+  NamedMDNode *BitSetNM = M->getNamedMetadata("llvm.bitsets");
+  if (!BitSetNM)
+    return;
+  for (const MDNode *Op : BitSetNM->operands()) {
+    // Only the types with a name are the same type in other modules.
+    auto *TypeID = dyn_cast<MDString>(Op->getOperand(0));
+    auto *OpConstMD = dyn_cast_or_null<ConstantAsMetadata>(Op->getOperand(1));
+    if (!TypeID || !OpConstMD)
+      continue;
+    const Constant *OpConst = OpConstMD->getValue();
+    if (auto *GA = dyn_cast<GlobalAlias>(OpConst))
+      OpConst = GA->getAliasee();
+    auto *GV = dyn_cast<GlobalVariable>(OpConst);
+    if (!GV)
+      continue;
+    uint64_t Offset =
+        cast<ConstantInt>(
+            cast<ConstantAsMetadata>(Op->getOperand(2))->getValue())
+            ->getZExtValue();
+    VTableTypes[GV].push_back(
+        {GlobalValue::getGUID(TypeID->getString()), Offset});
+  }
+}
+
 void ModuleSummaryIndexBuilder::computeFunctionSummary(
     const Function &F, BlockFrequencyInfo *BFI) {
   // Summary not currently supported for anonymous functions, they must
@@ -74,6 +141,7 @@ void ModuleSummaryIndexBuilder::computeFunctionSummary(
   // counts for all static calls to a given callee.
   DenseMap<const Value *, CalleeInfo> CallGraphEdges;
   DenseSet<const Value *> RefEdges;
+  std::set<TypeIdOffset> VCalls;
 
   SmallPtrSet<const User *, 8> Visited;
   for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
@@ -82,6 +150,22 @@ void ModuleSummaryIndexBuilder::computeFunctionSummary(
       if (!isa<DbgInfoIntrinsic>(I))
         ++NumInsts;
 
+      // Record the virtual calls through a vtable pointer that is assumed
+      // to be in a named bitset, for whole-program devirtualization.
+      if (auto *II = dyn_cast<IntrinsicInst>(I))
+        if (II->getIntrinsicID() == Intrinsic::bitset_test)
+          if (auto *TypeMD = dyn_cast<MetadataAsValue>(II->getArgOperand(1)))
+            if (auto *TypeID = dyn_cast<MDString>(TypeMD->getMetadata())) {
+              SmallVector<DevirtCallSite, 1> DevirtCalls;
+              SmallVector<CallInst *, 1> Assumes;
+              findDevirtualizableCalls(DevirtCalls, Assumes,
+                                       const_cast<IntrinsicInst *>(II));
+              if (!Assumes.empty())
+                for (const DevirtCallSite &Call : DevirtCalls)
+                  VCalls.insert(
+                      {GlobalValue::getGUID(TypeID->getString()), Call.Offset});
+            }
+
       if (auto CS = ImmutableCallSite(&*I)) {
         auto *CalledFunction = CS.getCalledFunction();
         if (CalledFunction && CalledFunction->hasName() &&
@@ -96,11 +180,18 @@ void ModuleSummaryIndexBuilder::computeFunctionSummary(
       findRefEdges(&*I, RefEdges, Visited);
     }
 
+  // Only the edges of functions with a profile have meaningful counts.
+  if (BFI && F.getEntryCount().hasValue())
+    for (auto &Edge : CallGraphEdges)
+      Edge.second.Hotness = getHotness(Edge.second.ProfileCount);
+
   GlobalValueSummary::GVFlags Flags(F);
   std::unique_ptr<FunctionSummary> FuncSummary =
       llvm::make_unique<FunctionSummary>(Flags, NumInsts);
   FuncSummary->addCallGraphEdges(CallGraphEdges);
   FuncSummary->addRefEdges(RefEdges);
+  for (const TypeIdOffset &VCall : VCalls)
+    FuncSummary->addVCall(VCall);
   Index->addGlobalValueSummary(F.getName(), std::move(FuncSummary));
 }
 
@@ -113,6 +204,24 @@ void ModuleSummaryIndexBuilder::computeVariableSummary(
   std::unique_ptr<GlobalVarSummary> GVarSummary =
       llvm::make_unique<GlobalVarSummary>(Flags);
   GVarSummary->addRefEdges(RefEdges);
+
+  // Record the types and the function pointers of virtual tables. Only the
+  // constant ones have a known content.
+  auto Types = VTableTypes.find(&V);
+  if (Types != VTableTypes.end()) {
+    for (const TypeIdOffset &Type : Types->second)
+      GVarSummary->addVTableType(Type);
+    if (auto *Init = dyn_cast<ConstantArray>(V.getInitializer()))
+      if (V.isConstant()) {
+        uint64_t ElemSize = M->getDataLayout().getTypeAllocSize(
+            Init->getType()->getElementType());
+        for (unsigned I = 0, E = Init->getNumOperands(); I != E; ++I)
+          if (auto *Fn =
+                  dyn_cast<Function>(Init->getOperand(I)->stripPointerCasts()))
+            GVarSummary->addVTableFunc(
+                I * ElemSize, Fn->hasLocalLinkage() ? "" : Fn->getName());
+      }
+  }
   Index->addGlobalValueSummary(V.getName(), std::move(GVarSummary));
 }
 
@@ -126,6 +235,9 @@ ModuleSummaryIndexBuilder::ModuleSummaryIndexBuilder(
   if (!moduleCanBeRenamedForThinLTO(*M))
     return;
 
+  computeCountThresholds();
+  computeVTableTypes();
+
   // Compute summaries for all functions defined in module, and save in the
   // index.
   for (auto &F : *M) {
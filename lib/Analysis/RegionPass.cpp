@@ -96,6 +96,7 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        PassMemoryRegion PassMemory(P, F.getContext());
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
@@ -74,6 +74,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/GlobalAlias.h"
@@ -103,6 +104,9 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumEvictedTripCounts,
+          "Number of loop trip counts evicted to stay within the memory "
+          "budget");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -111,6 +115,19 @@ MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
                                  "derived loop"),
                         cl::init(100));
 
+static cl::opt<unsigned>
+MaxSCEVExprs("scalar-evolution-max-exprs", cl::Hidden, cl::init(0),
+             cl::desc("Maximum number of expressions ScalarEvolution analyzes "
+                      "in one function before treating values as unknown "
+                      "(0 = no limit)"));
+
+static cl::opt<unsigned>
+SCEVMemoryBudget("scalar-evolution-memory-budget", cl::Hidden, cl::init(0),
+                 cl::desc("Memory budget for the expressions and memoized "
+                          "results of one function, in kilobytes; least "
+                          "recently used trip counts are evicted to stay "
+                          "within it (0 = no limit)"));
+
 // FIXME: Enable this with EXPENSIVE_CHECKS when the test suite is clean.
 static cl::opt<bool>
 VerifySCEV("verify-scev",
@@ -3420,7 +3437,9 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
 
   const SCEV *S = getExistingSCEV(V);
   if (S == nullptr) {
+    ++ComputationDepth;
     S = createSCEV(V);
+    --ComputationDepth;
     // During PHI resolution, it is possible to create two SCEVs for the same
     // V, so it is needed to double check whether V->S is inserted into
     // ValueExprMap before insert S->V into ExprValueMap.
@@ -3428,6 +3447,7 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
         ValueExprMap.insert({SCEVCallbackVH(V, this), S});
     if (Pair.second)
       ExprValueMap[S].insert(V);
+    enforceMemoryBudget(nullptr);
   }
   return S;
 }
@@ -4948,6 +4968,14 @@ const SCEV *ScalarEvolution::createSCEV(Value *V) {
   else if (!isa<ConstantExpr>(V))
     return getUnknown(V);
 
+  // Stop analyzing new values once this function is over budget, so that
+  // huge functions degrade to unknown values instead of taking forever.
+  if (MaxSCEVExprs && NumCreatedSCEVs >= MaxSCEVExprs)
+    exhaustBudget("limit of " + Twine(MaxSCEVExprs) + " expressions");
+  if (BudgetExhausted)
+    return getUnknown(V);
+  ++NumCreatedSCEVs;
+
   Operator *U = cast<Operator>(V);
   if (auto BO = MatchBinaryOp(U, DT)) {
     switch (BO->Opcode) {
@@ -5367,10 +5395,15 @@ ScalarEvolution::getPredicatedBackedgeTakenInfo(const Loop *L) {
   if (!Pair.second)
     return Pair.first->second;
 
+  ++ComputationDepth;
   BackedgeTakenInfo Result =
       computeBackedgeTakenCount(L, /*AllowPredicates=*/true);
+  --ComputationDepth;
 
-  return PredicatedBackedgeTakenCounts.find(L)->second = Result;
+  BackedgeTakenInfo &PredicatedBTI =
+      PredicatedBackedgeTakenCounts.find(L)->second = Result;
+  enforceMemoryBudget(L);
+  return PredicatedBTI;
 }
 
 const ScalarEvolution::BackedgeTakenInfo &
@@ -5382,12 +5415,15 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
   // backedge-taken count, which could result in infinite recursion.
   std::pair<DenseMap<const Loop *, BackedgeTakenInfo>::iterator, bool> Pair =
       BackedgeTakenCounts.insert({L, BackedgeTakenInfo()});
+  if (SCEVMemoryBudget)
+    BackedgeTakenLastUse[L] = ++BackedgeTakenClock;
   if (!Pair.second)
     return Pair.first->second;
 
   // computeBackedgeTakenCount may allocate memory for its result. Inserting it
   // into the BackedgeTakenCounts map transfers ownership. Otherwise, the result
   // must be cleared in this scope.
+  ++ComputationDepth;
   BackedgeTakenInfo Result = computeBackedgeTakenCount(L);
 
   if (Result.getExact(this) != getCouldNotCompute()) {
@@ -5440,12 +5476,16 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
     }
   }
 
+  --ComputationDepth;
+
   // Re-lookup the insert position, since the call to
   // computeBackedgeTakenCount above could result in a
   // recusive call to getBackedgeTakenInfo (on a different
   // loop), which would invalidate the iterator computed
   // earlier.
-  return BackedgeTakenCounts.find(L)->second = Result;
+  BackedgeTakenInfo &BTI = BackedgeTakenCounts.find(L)->second = Result;
+  enforceMemoryBudget(L);
+  return BTI;
 }
 
 void ScalarEvolution::forgetLoop(const Loop *L) {
@@ -5461,6 +5501,7 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
 
   RemoveLoopFromBackedgeMap(BackedgeTakenCounts);
   RemoveLoopFromBackedgeMap(PredicatedBackedgeTakenCounts);
+  BackedgeTakenLastUse.erase(L);
 
   // Drop information about expressions based on loop-header PHIs.
   SmallVector<Instruction *, 16> Worklist;
@@ -6610,12 +6651,15 @@ const SCEV *ScalarEvolution::getSCEVAtScope(const SCEV *V, const Loop *L) {
   Values.emplace_back(L, nullptr);
 
   // Otherwise compute it.
+  ++ComputationDepth;
   const SCEV *C = computeSCEVAtScope(V, L);
+  --ComputationDepth;
   for (auto &LS : reverse(ValuesAtScopes[V]))
     if (LS.first == L) {
       LS.second = C;
       break;
     }
+  enforceMemoryBudget(nullptr);
   return C;
 }
 
@@ -9492,8 +9536,9 @@ ScalarEvolution::ScalarEvolution(Function &F, TargetLibraryInfo &TLI,
     : F(F), TLI(TLI), AC(AC), DT(DT), LI(LI),
       CouldNotCompute(new SCEVCouldNotCompute()),
       WalkingBEDominatingConds(false), ProvingSplitPredicate(false),
-      ValuesAtScopes(64), LoopDispositions(64), BlockDispositions(64),
-      FirstUnknown(nullptr) {
+      NumCreatedSCEVs(0), BudgetExhausted(false), ComputationDepth(0),
+      BackedgeTakenClock(0), ValuesAtScopes(64), LoopDispositions(64),
+      BlockDispositions(64), FirstUnknown(nullptr) {
 
   // To use guards for proving predicates, we need to scan every instruction in
   // relevant basic blocks, and not just terminators.  Doing this is a waste of
@@ -9515,6 +9560,10 @@ ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
       LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
       ValueExprMap(std::move(Arg.ValueExprMap)),
       WalkingBEDominatingConds(false), ProvingSplitPredicate(false),
+      NumCreatedSCEVs(Arg.NumCreatedSCEVs),
+      BudgetExhausted(Arg.BudgetExhausted), ComputationDepth(0),
+      BackedgeTakenLastUse(std::move(Arg.BackedgeTakenLastUse)),
+      BackedgeTakenClock(Arg.BackedgeTakenClock),
       BackedgeTakenCounts(std::move(Arg.BackedgeTakenCounts)),
       PredicatedBackedgeTakenCounts(
           std::move(Arg.PredicatedBackedgeTakenCounts)),
@@ -9949,6 +9998,68 @@ void ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
   RemoveSCEVFromBackedgeMap(PredicatedBackedgeTakenCounts);
 }
 
+template <typename MapT> static size_t getEntriesSize(const MapT &Map) {
+  return Map.size() * sizeof(typename MapT::value_type);
+}
+
+size_t ScalarEvolution::getMemoryUsage() const {
+  size_t Size = SCEVAllocator.getTotalMemory();
+  Size += getEntriesSize(ValueExprMap) + getEntriesSize(ExprValueMap);
+  Size += getEntriesSize(BackedgeTakenCounts) +
+          getEntriesSize(PredicatedBackedgeTakenCounts);
+  Size += getEntriesSize(ValuesAtScopes);
+  Size += getEntriesSize(LoopDispositions) + getEntriesSize(BlockDispositions);
+  Size += getEntriesSize(UnsignedRanges) + getEntriesSize(SignedRanges);
+  return Size;
+}
+
+void ScalarEvolution::enforceMemoryBudget(const Loop *Keep) {
+  if (!SCEVMemoryBudget || ComputationDepth || BudgetExhausted)
+    return;
+  size_t Budget = size_t(SCEVMemoryBudget) * 1024;
+  if (getMemoryUsage() <= Budget)
+    return;
+
+  // Values at scopes are the cheapest to recompute, so drop them first. Then
+  // evict the least recently used trip counts. Evict down to three quarters
+  // of the budget so that we don't have to do this on every query.
+  ValuesAtScopes.clear();
+  SmallVector<std::pair<uint64_t, const Loop *>, 32> LoopsByUse;
+  for (const auto &Use : BackedgeTakenLastUse)
+    if (Use.first != Keep)
+      LoopsByUse.push_back({Use.second, Use.first});
+  std::sort(LoopsByUse.begin(), LoopsByUse.end());
+
+  size_t Target = Budget / 4 * 3;
+  for (const auto &Use : LoopsByUse) {
+    if (getMemoryUsage() <= Target)
+      break;
+    for (auto *Map : {&BackedgeTakenCounts, &PredicatedBackedgeTakenCounts}) {
+      auto It = Map->find(Use.second);
+      if (It != Map->end()) {
+        It->second.clear();
+        Map->erase(It);
+      }
+    }
+    BackedgeTakenLastUse.erase(Use.second);
+    ++NumEvictedTripCounts;
+  }
+
+  // What is left can't be evicted, since clients rely on getSCEV returning
+  // the same expression for a value.
+  if (getMemoryUsage() > Target)
+    exhaustBudget("memory budget of " + Twine(SCEVMemoryBudget) + " KB");
+}
+
+void ScalarEvolution::exhaustBudget(const Twine &Reason) {
+  if (BudgetExhausted)
+    return;
+  BudgetExhausted = true;
+  emitOptimizationRemarkAnalysis(F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+                                 "scalar evolution exceeded its " + Reason +
+                                     ", further values are not analyzed");
+}
+
 typedef DenseMap<const Loop *, std::string> VerifyMap;
 
 /// replaceSubString - Replaces all occurrences of From in Str with To.
@@ -10070,6 +10181,10 @@ bool ScalarEvolutionWrapperPass::runOnFunction(Function &F) {
 
 void ScalarEvolutionWrapperPass::releaseMemory() { SE.reset(); }
 
+size_t ScalarEvolutionWrapperPass::getMemoryUsage() const {
+  return SE ? SE->getMemoryUsage() : 0;
+}
+
 void ScalarEvolutionWrapperPass::print(raw_ostream &OS, const Module *) const {
   SE->print(OS);
 }
@@ -15,6 +15,7 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
@@ -44,6 +45,17 @@
 using namespace llvm;
 using namespace llvm::PatternMatch;
 
+#define DEBUG_TYPE "valuetracking"
+
+STATISTIC(NumKnownBitsCacheHits, "Number of known bits queries answered "
+                                 "from the cache");
+STATISTIC(NumKnownBitsCacheMisses, "Number of known bits queries not "
+                                   "answered from the cache");
+STATISTIC(NumSignBitsCacheHits, "Number of sign bits queries answered from "
+                                "the cache");
+STATISTIC(NumSignBitsCacheMisses, "Number of sign bits queries not answered "
+                                  "from the cache");
+
 const unsigned MaxDepth = 6;
 
 // Controls the number of uses of the value searched for possible
@@ -51,6 +63,11 @@ const unsigned MaxDepth = 6;
 static cl::opt<unsigned> DomConditionsMaxUses("dom-conditions-max-uses",
                                               cl::Hidden, cl::init(20));
 
+static cl::opt<bool> VerifyKnownBitsCache(
+    "verify-known-bits-cache", cl::Hidden,
+    cl::desc("Check the results taken from a KnownBitsCache against freshly "
+             "computed ones (only in builds with assertions)"));
+
 /// Returns the bitwidth of the given scalar or pointer type (if unknown returns
 /// 0). For vector types, returns the element type's bitwidth.
 static unsigned getBitWidth(Type *Ty, const DataLayout &DL) {
@@ -70,6 +87,7 @@ struct Query {
   AssumptionCache *AC;
   const Instruction *CxtI;
   const DominatorTree *DT;
+  KnownBitsCache *KBC;
 
   /// Set of assumptions that should be excluded from further queries.
   /// This is because of the potential for mutual recursion to cause
@@ -84,11 +102,12 @@ struct Query {
   unsigned NumExcluded;
 
   Query(const DataLayout &DL, AssumptionCache *AC, const Instruction *CxtI,
-        const DominatorTree *DT)
-      : DL(DL), AC(AC), CxtI(CxtI), DT(DT), NumExcluded(0) {}
+        const DominatorTree *DT, KnownBitsCache *KBC = nullptr)
+      : DL(DL), AC(AC), CxtI(CxtI), DT(DT), KBC(KBC), NumExcluded(0) {}
 
   Query(const Query &Q, const Value *NewExcl)
-      : DL(Q.DL), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT), NumExcluded(Q.NumExcluded) {
+      : DL(Q.DL), AC(Q.AC), CxtI(Q.CxtI), DT(Q.DT), KBC(Q.KBC),
+        NumExcluded(Q.NumExcluded) {
     Excluded = Q.Excluded;
     Excluded[NumExcluded++] = NewExcl;
     assert(NumExcluded <= Excluded.size());
@@ -103,6 +122,136 @@ struct Query {
 };
 } // end anonymous namespace
 
+bool KnownBitsCache::lookupKnownBits(const Value *V, const Instruction *CxtI,
+                                     unsigned Depth, APInt &KnownZero,
+                                     APInt &KnownOne) const {
+  auto I = KnownBits.find(V);
+  if (I == KnownBits.end())
+    return false;
+  for (const KnownBitsEntry &E : I->second)
+    if (E.CxtI == CxtI && E.Depth <= Depth) {
+      KnownZero = E.KnownZero;
+      KnownOne = E.KnownOne;
+      return true;
+    }
+  return false;
+}
+
+void KnownBitsCache::insertKnownBits(const Value *V, const Instruction *CxtI,
+                                     unsigned Depth, const APInt &KnownZero,
+                                     const APInt &KnownOne) {
+  SmallVectorImpl<KnownBitsEntry> &Entries = KnownBits[V];
+  for (KnownBitsEntry &E : Entries)
+    if (E.CxtI == CxtI) {
+      if (Depth < E.Depth) {
+        E.Depth = Depth;
+        E.KnownZero = KnownZero;
+        E.KnownOne = KnownOne;
+      }
+      return;
+    }
+  Entries.push_back({CxtI, Depth, KnownZero, KnownOne});
+  noteContext(V, CxtI);
+}
+
+unsigned KnownBitsCache::lookupNumSignBits(const Value *V,
+                                           const Instruction *CxtI,
+                                           unsigned Depth) const {
+  auto I = NumSignBits.find(V);
+  if (I == NumSignBits.end())
+    return 0;
+  for (const NumSignBitsEntry &E : I->second)
+    if (E.CxtI == CxtI && E.Depth <= Depth)
+      return E.NumSignBits;
+  return 0;
+}
+
+void KnownBitsCache::insertNumSignBits(const Value *V, const Instruction *CxtI,
+                                       unsigned Depth, unsigned Bits) {
+  SmallVectorImpl<NumSignBitsEntry> &Entries = NumSignBits[V];
+  for (NumSignBitsEntry &E : Entries)
+    if (E.CxtI == CxtI) {
+      if (Depth < E.Depth) {
+        E.Depth = Depth;
+        E.NumSignBits = Bits;
+      }
+      return;
+    }
+  Entries.push_back({CxtI, Depth, Bits});
+  noteContext(V, CxtI);
+}
+
+void KnownBitsCache::noteContext(const Value *V, const Instruction *CxtI) {
+  if (!CxtI)
+    return;
+  SmallVectorImpl<const Value *> &Values = Contexts[CxtI];
+  if (std::find(Values.begin(), Values.end(), V) == Values.end())
+    Values.push_back(V);
+}
+
+void KnownBitsCache::forgetResults(const Value *V) {
+  KnownBits.erase(V);
+  NumSignBits.erase(V);
+}
+
+void KnownBitsCache::forgetValue(const Value *V) {
+  if (KnownBits.empty() && NumSignBits.empty())
+    return;
+
+  // The results for an instruction can depend on the ones for the
+  // instructions it uses up to MaxDepth levels above. Visit the users
+  // breadth-first so that each is reached at its lowest level.
+  SmallVector<std::pair<const Value *, unsigned>, 16> Worklist;
+  SmallPtrSet<const Value *, 16> Visited;
+  Worklist.push_back(std::make_pair(V, 0u));
+  Visited.insert(V);
+  for (unsigned I = 0; I != Worklist.size(); ++I) {
+    const Value *Cur = Worklist[I].first;
+    unsigned Level = Worklist[I].second;
+    forgetResults(Cur);
+    if (Level == MaxDepth)
+      continue;
+    for (const User *U : Cur->users())
+      if (isa<Instruction>(U) && Visited.insert(U).second)
+        Worklist.push_back(std::make_pair(U, Level + 1));
+  }
+
+  // The results computed in the context of V may have used assumptions or
+  // dominating conditions that only hold at V.
+  if (const Instruction *CxtI = dyn_cast<Instruction>(V)) {
+    auto I = Contexts.find(CxtI);
+    if (I == Contexts.end())
+      return;
+    for (const Value *Other : I->second) {
+      auto KB = KnownBits.find(Other);
+      if (KB != KnownBits.end()) {
+        auto &Entries = KB->second;
+        Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+                                     [&](const KnownBitsEntry &E) {
+                                       return E.CxtI == CxtI;
+                                     }),
+                      Entries.end());
+      }
+      auto SB = NumSignBits.find(Other);
+      if (SB != NumSignBits.end()) {
+        auto &Entries = SB->second;
+        Entries.erase(std::remove_if(Entries.begin(), Entries.end(),
+                                     [&](const NumSignBitsEntry &E) {
+                                       return E.CxtI == CxtI;
+                                     }),
+                      Entries.end());
+      }
+    }
+    Contexts.erase(I);
+  }
+}
+
+void KnownBitsCache::clear() {
+  KnownBits.clear();
+  NumSignBits.clear();
+  Contexts.clear();
+}
+
 // Given the provided Value and, potentially, a context instruction, return
 // the preferred context instruction (if any).
 static const Instruction *safeCxtI(const Value *V, const Instruction *CxtI) {
@@ -125,9 +274,9 @@ static void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
 void llvm::computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
                             const DataLayout &DL, unsigned Depth,
                             AssumptionCache *AC, const Instruction *CxtI,
-                            const DominatorTree *DT) {
+                            const DominatorTree *DT, KnownBitsCache *KBC) {
   ::computeKnownBits(V, KnownZero, KnownOne, Depth,
-                     Query(DL, AC, safeCxtI(V, CxtI), DT));
+                     Query(DL, AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 bool llvm::haveNoCommonBitsSet(Value *LHS, Value *RHS, const DataLayout &DL,
@@ -151,9 +300,9 @@ static void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
 void llvm::ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
                           const DataLayout &DL, unsigned Depth,
                           AssumptionCache *AC, const Instruction *CxtI,
-                          const DominatorTree *DT) {
+                          const DominatorTree *DT, KnownBitsCache *KBC) {
   ::ComputeSignBit(V, KnownZero, KnownOne, Depth,
-                   Query(DL, AC, safeCxtI(V, CxtI), DT));
+                   Query(DL, AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static bool isKnownToBeAPowerOfTwo(Value *V, bool OrZero, unsigned Depth,
@@ -218,9 +367,10 @@ static bool MaskedValueIsZero(Value *V, const APInt &Mask, unsigned Depth,
 
 bool llvm::MaskedValueIsZero(Value *V, const APInt &Mask, const DataLayout &DL,
                              unsigned Depth, AssumptionCache *AC,
-                             const Instruction *CxtI, const DominatorTree *DT) {
+                             const Instruction *CxtI, const DominatorTree *DT,
+                             KnownBitsCache *KBC) {
   return ::MaskedValueIsZero(V, Mask, Depth,
-                             Query(DL, AC, safeCxtI(V, CxtI), DT));
+                             Query(DL, AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static unsigned ComputeNumSignBits(Value *V, unsigned Depth, const Query &Q);
@@ -228,8 +378,10 @@ static unsigned ComputeNumSignBits(Value *V, unsigned Depth, const Query &Q);
 unsigned llvm::ComputeNumSignBits(Value *V, const DataLayout &DL,
                                   unsigned Depth, AssumptionCache *AC,
                                   const Instruction *CxtI,
-                                  const DominatorTree *DT) {
-  return ::ComputeNumSignBits(V, Depth, Query(DL, AC, safeCxtI(V, CxtI), DT));
+                                  const DominatorTree *DT,
+                                  KnownBitsCache *KBC) {
+  return ::ComputeNumSignBits(V, Depth,
+                              Query(DL, AC, safeCxtI(V, CxtI), DT, KBC));
 }
 
 static void computeKnownBitsAddSub(bool Add, Value *Op0, Value *Op1, bool NSW,
@@ -1374,8 +1526,8 @@ static void computeKnownBitsFromOperator(Operator *I, APInt &KnownZero,
 /// where V is a vector, known zero, and known one values are the
 /// same width as the vector element, and the bit is set only if it is true
 /// for all of the elements in the vector.
-void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
-                      unsigned Depth, const Query &Q) {
+static void computeKnownBitsImpl(Value *V, APInt &KnownZero, APInt &KnownOne,
+                                 unsigned Depth, const Query &Q) {
   assert(V && "No Value?");
   assert(Depth <= MaxDepth && "Limit Search Depth");
   unsigned BitWidth = KnownZero.getBitWidth();
@@ -1473,6 +1625,39 @@ void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
   assert((KnownZero & KnownOne) == 0 && "Bits known to be one AND zero?");
 }
 
+/// Compute the known bits of V, through the cache of Q if it has one.
+void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
+                      unsigned Depth, const Query &Q) {
+  // Results computed while some assumptions are excluded are not cached, they
+  // are less precise than the ones for the same query at the top level.
+  if (!Q.KBC || !isa<Instruction>(V) || Depth == MaxDepth || Q.NumExcluded)
+    return computeKnownBitsImpl(V, KnownZero, KnownOne, Depth, Q);
+
+  if (Q.KBC->lookupKnownBits(V, Q.CxtI, Depth, KnownZero, KnownOne)) {
+    ++NumKnownBitsCacheHits;
+#ifndef NDEBUG
+    if (VerifyKnownBitsCache) {
+      // The cached result may be more precise than a fresh one, but the two
+      // must agree on the bits they both know.
+      unsigned BitWidth = KnownZero.getBitWidth();
+      APInt FreshZero(BitWidth, 0), FreshOne(BitWidth, 0);
+      computeKnownBitsImpl(V, FreshZero, FreshOne, Depth,
+                           Query(Q.DL, Q.AC, Q.CxtI, Q.DT));
+      if ((KnownZero & FreshOne) != 0 || (KnownOne & FreshZero) != 0) {
+        dbgs() << "Cached known bits for " << *V
+               << " contradict the computed ones\n";
+        llvm_unreachable("KnownBitsCache is out of date");
+      }
+    }
+#endif
+    return;
+  }
+
+  ++NumKnownBitsCacheMisses;
+  computeKnownBitsImpl(V, KnownZero, KnownOne, Depth, Q);
+  Q.KBC->insertKnownBits(V, Q.CxtI, Depth, KnownZero, KnownOne);
+}
+
 /// Determine whether the sign bit is known to be zero or one.
 /// Convenience wrapper around computeKnownBits.
 void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
@@ -1936,7 +2121,8 @@ bool MaskedValueIsZero(Value *V, const APInt &Mask, unsigned Depth,
 ///
 /// 'Op' must have a scalar integer type.
 ///
-unsigned ComputeNumSignBits(Value *V, unsigned Depth, const Query &Q) {
+static unsigned ComputeNumSignBitsImpl(Value *V, unsigned Depth,
+                                       const Query &Q) {
   unsigned TyBits = Q.DL.getTypeSizeInBits(V->getType()->getScalarType());
   unsigned Tmp, Tmp2;
   unsigned FirstAnswer = 1;
@@ -2153,6 +2339,39 @@ unsigned ComputeNumSignBits(Value *V, unsigned Depth, const Query &Q) {
   return std::max(FirstAnswer, std::min(TyBits, Mask.countLeadingZeros()));
 }
 
+/// Compute the number of sign bits of V, through the cache of Q if it has one.
+static unsigned ComputeNumSignBits(Value *V, unsigned Depth, const Query &Q) {
+  // Results computed while some assumptions are excluded are not cached, they
+  // are less precise than the ones for the same query at the top level.
+  if (!Q.KBC || !isa<Instruction>(V) || Depth == MaxDepth || Q.NumExcluded)
+    return ComputeNumSignBitsImpl(V, Depth, Q);
+
+  if (unsigned Bits = Q.KBC->lookupNumSignBits(V, Q.CxtI, Depth)) {
+    ++NumSignBitsCacheHits;
+#ifndef NDEBUG
+    if (VerifyKnownBitsCache) {
+      // The top Bits bits must not be known to differ.
+      unsigned BitWidth = Q.DL.getTypeSizeInBits(V->getType()->getScalarType());
+      APInt KnownZero(BitWidth, 0), KnownOne(BitWidth, 0);
+      computeKnownBits(V, KnownZero, KnownOne, Depth,
+                       Query(Q.DL, Q.AC, Q.CxtI, Q.DT));
+      APInt Top = APInt::getHighBitsSet(BitWidth, Bits);
+      if ((KnownZero & Top) != 0 && (KnownOne & Top) != 0) {
+        dbgs() << "Cached number of sign bits " << Bits << " for " << *V
+               << " contradicts the known bits\n";
+        llvm_unreachable("KnownBitsCache is out of date");
+      }
+    }
+#endif
+    return Bits;
+  }
+
+  ++NumSignBitsCacheMisses;
+  unsigned Bits = ComputeNumSignBitsImpl(V, Depth, Q);
+  Q.KBC->insertNumSignBits(V, Q.CxtI, Depth, Bits);
+  return Bits;
+}
+
 /// This function computes the integer multiple of Base that equals V.
 /// If successful, it returns true and returns the multiple in
 /// Multiple. If unsuccessful, it returns false. It looks
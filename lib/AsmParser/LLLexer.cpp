@@ -19,6 +19,7 @@
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
@@ -443,6 +444,307 @@ lltok::Kind LLLexer::LexHash() {
   return lltok::Error;
 }
 
+namespace {
+/// The token that a keyword lexes to, with the opcode of instruction keywords
+/// and the type ID of primitive type keywords.
+struct KeywordInfo {
+  lltok::Kind Kind;
+  unsigned Val;
+};
+
+/// All the keywords, hashed so that an identifier is looked up once instead of
+/// being compared against each of them.
+struct KeywordTable {
+  StringMap<KeywordInfo> Map;
+
+  void add(StringRef Keyword, lltok::Kind Kind, unsigned Val) {
+    Map.insert(std::make_pair(Keyword, KeywordInfo{Kind, Val}));
+  }
+
+  KeywordTable() {
+#define KEYWORD(STR) add(#STR, lltok::kw_##STR, 0)
+#define TYPEKEYWORD(STR, ID) add(STR, lltok::Type, ID)
+#define INSTKEYWORD(STR, Enum) add(#STR, lltok::kw_##STR, Instruction::Enum)
+
+    KEYWORD(true);    KEYWORD(false);
+    KEYWORD(declare); KEYWORD(define);
+    KEYWORD(global);  KEYWORD(constant);
+
+    KEYWORD(private);
+    KEYWORD(internal);
+    KEYWORD(available_externally);
+    KEYWORD(linkonce);
+    KEYWORD(linkonce_odr);
+    KEYWORD(weak); // Use as a linkage, and a modifier for "cmpxchg".
+    KEYWORD(weak_odr);
+    KEYWORD(appending);
+    KEYWORD(dllimport);
+    KEYWORD(dllexport);
+    KEYWORD(common);
+    KEYWORD(default);
+    KEYWORD(hidden);
+    KEYWORD(protected);
+    KEYWORD(unnamed_addr);
+    KEYWORD(externally_initialized);
+    KEYWORD(extern_weak);
+    KEYWORD(external);
+    KEYWORD(thread_local);
+    KEYWORD(localdynamic);
+    KEYWORD(initialexec);
+    KEYWORD(localexec);
+    KEYWORD(zeroinitializer);
+    KEYWORD(undef);
+    KEYWORD(null);
+    KEYWORD(none);
+    KEYWORD(to);
+    KEYWORD(caller);
+    KEYWORD(within);
+    KEYWORD(from);
+    KEYWORD(tail);
+    KEYWORD(musttail);
+    KEYWORD(notail);
+    KEYWORD(target);
+    KEYWORD(triple);
+    KEYWORD(source_filename);
+    KEYWORD(unwind);
+    KEYWORD(deplibs);             // FIXME: Remove in 4.0.
+    KEYWORD(datalayout);
+    KEYWORD(volatile);
+    KEYWORD(atomic);
+    KEYWORD(unordered);
+    KEYWORD(monotonic);
+    KEYWORD(acquire);
+    KEYWORD(release);
+    KEYWORD(acq_rel);
+    KEYWORD(seq_cst);
+    KEYWORD(singlethread);
+
+    KEYWORD(nnan);
+    KEYWORD(ninf);
+    KEYWORD(nsz);
+    KEYWORD(arcp);
+    KEYWORD(fast);
+    KEYWORD(nuw);
+    KEYWORD(nsw);
+    KEYWORD(exact);
+    KEYWORD(inbounds);
+    KEYWORD(align);
+    KEYWORD(addrspace);
+    KEYWORD(section);
+    KEYWORD(alias);
+    KEYWORD(ifunc);
+    KEYWORD(module);
+    KEYWORD(asm);
+    KEYWORD(sideeffect);
+    KEYWORD(alignstack);
+    KEYWORD(inteldialect);
+    KEYWORD(gc);
+    KEYWORD(prefix);
+    KEYWORD(prologue);
+
+    KEYWORD(ccc);
+    KEYWORD(fastcc);
+    KEYWORD(coldcc);
+    KEYWORD(x86_stdcallcc);
+    KEYWORD(x86_fastcallcc);
+    KEYWORD(x86_thiscallcc);
+    KEYWORD(x86_vectorcallcc);
+    KEYWORD(arm_apcscc);
+    KEYWORD(arm_aapcscc);
+    KEYWORD(arm_aapcs_vfpcc);
+    KEYWORD(msp430_intrcc);
+    KEYWORD(avr_intrcc);
+    KEYWORD(avr_signalcc);
+    KEYWORD(ptx_kernel);
+    KEYWORD(ptx_device);
+    KEYWORD(spir_kernel);
+    KEYWORD(spir_func);
+    KEYWORD(intel_ocl_bicc);
+    KEYWORD(x86_64_sysvcc);
+    KEYWORD(x86_64_win64cc);
+    KEYWORD(webkit_jscc);
+    KEYWORD(swiftcc);
+    KEYWORD(anyregcc);
+    KEYWORD(preserve_mostcc);
+    KEYWORD(preserve_allcc);
+    KEYWORD(ghccc);
+    KEYWORD(x86_intrcc);
+    KEYWORD(hhvmcc);
+    KEYWORD(hhvm_ccc);
+    KEYWORD(cxx_fast_tlscc);
+    KEYWORD(amdgpu_vs);
+    KEYWORD(amdgpu_gs);
+    KEYWORD(amdgpu_ps);
+    KEYWORD(amdgpu_cs);
+    KEYWORD(amdgpu_kernel);
+
+    KEYWORD(cc);
+    KEYWORD(c);
+
+    KEYWORD(attributes);
+
+    KEYWORD(alwaysinline);
+    KEYWORD(allocsize);
+    KEYWORD(argmemonly);
+    KEYWORD(builtin);
+    KEYWORD(byval);
+    KEYWORD(inalloca);
+    KEYWORD(cold);
+    KEYWORD(convergent);
+    KEYWORD(dereferenceable);
+    KEYWORD(dereferenceable_or_null);
+    KEYWORD(inaccessiblememonly);
+    KEYWORD(inaccessiblemem_or_argmemonly);
+    KEYWORD(inlinehint);
+    KEYWORD(inreg);
+    KEYWORD(jumptable);
+    KEYWORD(minsize);
+    KEYWORD(naked);
+    KEYWORD(nest);
+    KEYWORD(noalias);
+    KEYWORD(nobuiltin);
+    KEYWORD(nocapture);
+    KEYWORD(noduplicate);
+    KEYWORD(noimplicitfloat);
+    KEYWORD(noinline);
+    KEYWORD(norecurse);
+    KEYWORD(nonlazybind);
+    KEYWORD(nonnull);
+    KEYWORD(noredzone);
+    KEYWORD(noreturn);
+    KEYWORD(nounwind);
+    KEYWORD(optnone);
+    KEYWORD(optsize);
+    KEYWORD(readnone);
+    KEYWORD(readonly);
+    KEYWORD(returned);
+    KEYWORD(returns_twice);
+    KEYWORD(signext);
+    KEYWORD(sret);
+    KEYWORD(ssp);
+    KEYWORD(sspreq);
+    KEYWORD(sspstrong);
+    KEYWORD(safestack);
+    KEYWORD(sanitize_address);
+    KEYWORD(sanitize_thread);
+    KEYWORD(sanitize_memory);
+    KEYWORD(swifterror);
+    KEYWORD(swiftself);
+    KEYWORD(uwtable);
+    KEYWORD(zeroext);
+
+    KEYWORD(type);
+    KEYWORD(opaque);
+
+    KEYWORD(comdat);
+
+    // Comdat types
+    KEYWORD(any);
+    KEYWORD(exactmatch);
+    KEYWORD(largest);
+    KEYWORD(noduplicates);
+    KEYWORD(samesize);
+
+    KEYWORD(eq); KEYWORD(ne); KEYWORD(slt); KEYWORD(sgt); KEYWORD(sle);
+    KEYWORD(sge); KEYWORD(ult); KEYWORD(ugt); KEYWORD(ule); KEYWORD(uge);
+    KEYWORD(oeq); KEYWORD(one); KEYWORD(olt); KEYWORD(ogt); KEYWORD(ole);
+    KEYWORD(oge); KEYWORD(ord); KEYWORD(uno); KEYWORD(ueq); KEYWORD(une);
+
+    KEYWORD(xchg); KEYWORD(nand); KEYWORD(max); KEYWORD(min); KEYWORD(umax);
+    KEYWORD(umin);
+
+    KEYWORD(x);
+    KEYWORD(blockaddress);
+
+    // Metadata types.
+    KEYWORD(distinct);
+
+    // Use-list order directives.
+    KEYWORD(uselistorder);
+    KEYWORD(uselistorder_bb);
+
+    KEYWORD(personality);
+    KEYWORD(cleanup);
+    KEYWORD(catch);
+    KEYWORD(filter);
+
+    // Keywords for types.
+    TYPEKEYWORD("void",      Type::VoidTyID);
+    TYPEKEYWORD("half",      Type::HalfTyID);
+    TYPEKEYWORD("float",     Type::FloatTyID);
+    TYPEKEYWORD("double",    Type::DoubleTyID);
+    TYPEKEYWORD("x86_fp80",  Type::X86_FP80TyID);
+    TYPEKEYWORD("fp128",     Type::FP128TyID);
+    TYPEKEYWORD("ppc_fp128", Type::PPC_FP128TyID);
+    TYPEKEYWORD("label",     Type::LabelTyID);
+    TYPEKEYWORD("metadata",  Type::MetadataTyID);
+    TYPEKEYWORD("x86_mmx",   Type::X86_MMXTyID);
+    TYPEKEYWORD("token",     Type::TokenTyID);
+
+    // Keywords for instructions.
+
+    INSTKEYWORD(add,   Add);  INSTKEYWORD(fadd,   FAdd);
+    INSTKEYWORD(sub,   Sub);  INSTKEYWORD(fsub,   FSub);
+    INSTKEYWORD(mul,   Mul);  INSTKEYWORD(fmul,   FMul);
+    INSTKEYWORD(udiv,  UDiv); INSTKEYWORD(sdiv,  SDiv); INSTKEYWORD(fdiv,  FDiv);
+    INSTKEYWORD(urem,  URem); INSTKEYWORD(srem,  SRem); INSTKEYWORD(frem,  FRem);
+    INSTKEYWORD(shl,   Shl);  INSTKEYWORD(lshr,  LShr); INSTKEYWORD(ashr,  AShr);
+    INSTKEYWORD(and,   And);  INSTKEYWORD(or,    Or);   INSTKEYWORD(xor,   Xor);
+    INSTKEYWORD(icmp,  ICmp); INSTKEYWORD(fcmp,  FCmp);
+
+    INSTKEYWORD(phi,         PHI);
+    INSTKEYWORD(call,        Call);
+    INSTKEYWORD(trunc,       Trunc);
+    INSTKEYWORD(zext,        ZExt);
+    INSTKEYWORD(sext,        SExt);
+    INSTKEYWORD(fptrunc,     FPTrunc);
+    INSTKEYWORD(fpext,       FPExt);
+    INSTKEYWORD(uitofp,      UIToFP);
+    INSTKEYWORD(sitofp,      SIToFP);
+    INSTKEYWORD(fptoui,      FPToUI);
+    INSTKEYWORD(fptosi,      FPToSI);
+    INSTKEYWORD(inttoptr,    IntToPtr);
+    INSTKEYWORD(ptrtoint,    PtrToInt);
+    INSTKEYWORD(bitcast,     BitCast);
+    INSTKEYWORD(addrspacecast, AddrSpaceCast);
+    INSTKEYWORD(select,      Select);
+    INSTKEYWORD(va_arg,      VAArg);
+    INSTKEYWORD(ret,         Ret);
+    INSTKEYWORD(br,          Br);
+    INSTKEYWORD(switch,      Switch);
+    INSTKEYWORD(indirectbr,  IndirectBr);
+    INSTKEYWORD(invoke,      Invoke);
+    INSTKEYWORD(resume,      Resume);
+    INSTKEYWORD(unreachable, Unreachable);
+
+    INSTKEYWORD(alloca,      Alloca);
+    INSTKEYWORD(load,        Load);
+    INSTKEYWORD(store,       Store);
+    INSTKEYWORD(cmpxchg,     AtomicCmpXchg);
+    INSTKEYWORD(atomicrmw,   AtomicRMW);
+    INSTKEYWORD(fence,       Fence);
+    INSTKEYWORD(getelementptr, GetElementPtr);
+
+    INSTKEYWORD(extractelement, ExtractElement);
+    INSTKEYWORD(insertelement,  InsertElement);
+    INSTKEYWORD(shufflevector,  ShuffleVector);
+    INSTKEYWORD(extractvalue,   ExtractValue);
+    INSTKEYWORD(insertvalue,    InsertValue);
+    INSTKEYWORD(landingpad,     LandingPad);
+    INSTKEYWORD(cleanupret,     CleanupRet);
+    INSTKEYWORD(catchret,       CatchRet);
+    INSTKEYWORD(catchswitch,  CatchSwitch);
+    INSTKEYWORD(catchpad,     CatchPad);
+    INSTKEYWORD(cleanuppad,   CleanupPad);
+#undef KEYWORD
+#undef TYPEKEYWORD
+#undef INSTKEYWORD
+  }
+};
+} // end anonymous namespace
+
+static ManagedStatic<KeywordTable> Keywords;
+
 /// Lex a label, integer type, keyword, or hexadecimal integer constant.
 ///    Label           [-a-zA-Z$._0-9]+:
 ///    IntegerType     i[0-9]+
@@ -488,299 +790,15 @@ lltok::Kind LLLexer::LexIdentifier() {
   CurPtr = KeywordEnd;
   --StartChar;
   StringRef Keyword(StartChar, CurPtr - StartChar);
-#define KEYWORD(STR)                                                           \
-  do {                                                                         \
-    if (Keyword == #STR)                                                       \
-      return lltok::kw_##STR;                                                  \
-  } while (0)
-
-  KEYWORD(true);    KEYWORD(false);
-  KEYWORD(declare); KEYWORD(define);
-  KEYWORD(global);  KEYWORD(constant);
-
-  KEYWORD(private);
-  KEYWORD(internal);
-  KEYWORD(available_externally);
-  KEYWORD(linkonce);
-  KEYWORD(linkonce_odr);
-  KEYWORD(weak); // Use as a linkage, and a modifier for "cmpxchg".
-  KEYWORD(weak_odr);
-  KEYWORD(appending);
-  KEYWORD(dllimport);
-  KEYWORD(dllexport);
-  KEYWORD(common);
-  KEYWORD(default);
-  KEYWORD(hidden);
-  KEYWORD(protected);
-  KEYWORD(unnamed_addr);
-  KEYWORD(externally_initialized);
-  KEYWORD(extern_weak);
-  KEYWORD(external);
-  KEYWORD(thread_local);
-  KEYWORD(localdynamic);
-  KEYWORD(initialexec);
-  KEYWORD(localexec);
-  KEYWORD(zeroinitializer);
-  KEYWORD(undef);
-  KEYWORD(null);
-  KEYWORD(none);
-  KEYWORD(to);
-  KEYWORD(caller);
-  KEYWORD(within);
-  KEYWORD(from);
-  KEYWORD(tail);
-  KEYWORD(musttail);
-  KEYWORD(notail);
-  KEYWORD(target);
-  KEYWORD(triple);
-  KEYWORD(source_filename);
-  KEYWORD(unwind);
-  KEYWORD(deplibs);             // FIXME: Remove in 4.0.
-  KEYWORD(datalayout);
-  KEYWORD(volatile);
-  KEYWORD(atomic);
-  KEYWORD(unordered);
-  KEYWORD(monotonic);
-  KEYWORD(acquire);
-  KEYWORD(release);
-  KEYWORD(acq_rel);
-  KEYWORD(seq_cst);
-  KEYWORD(singlethread);
-
-  KEYWORD(nnan);
-  KEYWORD(ninf);
-  KEYWORD(nsz);
-  KEYWORD(arcp);
-  KEYWORD(fast);
-  KEYWORD(nuw);
-  KEYWORD(nsw);
-  KEYWORD(exact);
-  KEYWORD(inbounds);
-  KEYWORD(align);
-  KEYWORD(addrspace);
-  KEYWORD(section);
-  KEYWORD(alias);
-  KEYWORD(ifunc);
-  KEYWORD(module);
-  KEYWORD(asm);
-  KEYWORD(sideeffect);
-  KEYWORD(alignstack);
-  KEYWORD(inteldialect);
-  KEYWORD(gc);
-  KEYWORD(prefix);
-  KEYWORD(prologue);
-
-  KEYWORD(ccc);
-  KEYWORD(fastcc);
-  KEYWORD(coldcc);
-  KEYWORD(x86_stdcallcc);
-  KEYWORD(x86_fastcallcc);
-  KEYWORD(x86_thiscallcc);
-  KEYWORD(x86_vectorcallcc);
-  KEYWORD(arm_apcscc);
-  KEYWORD(arm_aapcscc);
-  KEYWORD(arm_aapcs_vfpcc);
-  KEYWORD(msp430_intrcc);
-  KEYWORD(avr_intrcc);
-  KEYWORD(avr_signalcc);
-  KEYWORD(ptx_kernel);
-  KEYWORD(ptx_device);
-  KEYWORD(spir_kernel);
-  KEYWORD(spir_func);
-  KEYWORD(intel_ocl_bicc);
-  KEYWORD(x86_64_sysvcc);
-  KEYWORD(x86_64_win64cc);
-  KEYWORD(webkit_jscc);
-  KEYWORD(swiftcc);
-  KEYWORD(anyregcc);
-  KEYWORD(preserve_mostcc);
-  KEYWORD(preserve_allcc);
-  KEYWORD(ghccc);
-  KEYWORD(x86_intrcc);
-  KEYWORD(hhvmcc);
-  KEYWORD(hhvm_ccc);
-  KEYWORD(cxx_fast_tlscc);
-  KEYWORD(amdgpu_vs);
-  KEYWORD(amdgpu_gs);
-  KEYWORD(amdgpu_ps);
-  KEYWORD(amdgpu_cs);
-  KEYWORD(amdgpu_kernel);
-
-  KEYWORD(cc);
-  KEYWORD(c);
-
-  KEYWORD(attributes);
-
-  KEYWORD(alwaysinline);
-  KEYWORD(allocsize);
-  KEYWORD(argmemonly);
-  KEYWORD(builtin);
-  KEYWORD(byval);
-  KEYWORD(inalloca);
-  KEYWORD(cold);
-  KEYWORD(convergent);
-  KEYWORD(dereferenceable);
-  KEYWORD(dereferenceable_or_null);
-  KEYWORD(inaccessiblememonly);
-  KEYWORD(inaccessiblemem_or_argmemonly);
-  KEYWORD(inlinehint);
-  KEYWORD(inreg);
-  KEYWORD(jumptable);
-  KEYWORD(minsize);
-  KEYWORD(naked);
-  KEYWORD(nest);
-  KEYWORD(noalias);
-  KEYWORD(nobuiltin);
-  KEYWORD(nocapture);
-  KEYWORD(noduplicate);
-  KEYWORD(noimplicitfloat);
-  KEYWORD(noinline);
-  KEYWORD(norecurse);
-  KEYWORD(nonlazybind);
-  KEYWORD(nonnull);
-  KEYWORD(noredzone);
-  KEYWORD(noreturn);
-  KEYWORD(nounwind);
-  KEYWORD(optnone);
-  KEYWORD(optsize);
-  KEYWORD(readnone);
-  KEYWORD(readonly);
-  KEYWORD(returned);
-  KEYWORD(returns_twice);
-  KEYWORD(signext);
-  KEYWORD(sret);
-  KEYWORD(ssp);
-  KEYWORD(sspreq);
-  KEYWORD(sspstrong);
-  KEYWORD(safestack);
-  KEYWORD(sanitize_address);
-  KEYWORD(sanitize_thread);
-  KEYWORD(sanitize_memory);
-  KEYWORD(swifterror);
-  KEYWORD(swiftself);
-  KEYWORD(uwtable);
-  KEYWORD(zeroext);
-
-  KEYWORD(type);
-  KEYWORD(opaque);
-
-  KEYWORD(comdat);
-
-  // Comdat types
-  KEYWORD(any);
-  KEYWORD(exactmatch);
-  KEYWORD(largest);
-  KEYWORD(noduplicates);
-  KEYWORD(samesize);
-
-  KEYWORD(eq); KEYWORD(ne); KEYWORD(slt); KEYWORD(sgt); KEYWORD(sle);
-  KEYWORD(sge); KEYWORD(ult); KEYWORD(ugt); KEYWORD(ule); KEYWORD(uge);
-  KEYWORD(oeq); KEYWORD(one); KEYWORD(olt); KEYWORD(ogt); KEYWORD(ole);
-  KEYWORD(oge); KEYWORD(ord); KEYWORD(uno); KEYWORD(ueq); KEYWORD(une);
-
-  KEYWORD(xchg); KEYWORD(nand); KEYWORD(max); KEYWORD(min); KEYWORD(umax);
-  KEYWORD(umin);
-
-  KEYWORD(x);
-  KEYWORD(blockaddress);
-
-  // Metadata types.
-  KEYWORD(distinct);
-
-  // Use-list order directives.
-  KEYWORD(uselistorder);
-  KEYWORD(uselistorder_bb);
-
-  KEYWORD(personality);
-  KEYWORD(cleanup);
-  KEYWORD(catch);
-  KEYWORD(filter);
-#undef KEYWORD
-
-  // Keywords for types.
-#define TYPEKEYWORD(STR, LLVMTY)                                               \
-  do {                                                                         \
-    if (Keyword == STR) {                                                      \
-      TyVal = LLVMTY;                                                          \
-      return lltok::Type;                                                      \
-    }                                                                          \
-  } while (false)
-  TYPEKEYWORD("void",      Type::getVoidTy(Context));
-  TYPEKEYWORD("half",      Type::getHalfTy(Context));
-  TYPEKEYWORD("float",     Type::getFloatTy(Context));
-  TYPEKEYWORD("double",    Type::getDoubleTy(Context));
-  TYPEKEYWORD("x86_fp80",  Type::getX86_FP80Ty(Context));
-  TYPEKEYWORD("fp128",     Type::getFP128Ty(Context));
-  TYPEKEYWORD("ppc_fp128", Type::getPPC_FP128Ty(Context));
-  TYPEKEYWORD("label",     Type::getLabelTy(Context));
-  TYPEKEYWORD("metadata",  Type::getMetadataTy(Context));
-  TYPEKEYWORD("x86_mmx",   Type::getX86_MMXTy(Context));
-  TYPEKEYWORD("token",     Type::getTokenTy(Context));
-#undef TYPEKEYWORD
-
-  // Keywords for instructions.
-#define INSTKEYWORD(STR, Enum)                                                 \
-  do {                                                                         \
-    if (Keyword == #STR) {                                                     \
-      UIntVal = Instruction::Enum;                                             \
-      return lltok::kw_##STR;                                                  \
-    }                                                                          \
-  } while (false)
-
-  INSTKEYWORD(add,   Add);  INSTKEYWORD(fadd,   FAdd);
-  INSTKEYWORD(sub,   Sub);  INSTKEYWORD(fsub,   FSub);
-  INSTKEYWORD(mul,   Mul);  INSTKEYWORD(fmul,   FMul);
-  INSTKEYWORD(udiv,  UDiv); INSTKEYWORD(sdiv,  SDiv); INSTKEYWORD(fdiv,  FDiv);
-  INSTKEYWORD(urem,  URem); INSTKEYWORD(srem,  SRem); INSTKEYWORD(frem,  FRem);
-  INSTKEYWORD(shl,   Shl);  INSTKEYWORD(lshr,  LShr); INSTKEYWORD(ashr,  AShr);
-  INSTKEYWORD(and,   And);  INSTKEYWORD(or,    Or);   INSTKEYWORD(xor,   Xor);
-  INSTKEYWORD(icmp,  ICmp); INSTKEYWORD(fcmp,  FCmp);
-
-  INSTKEYWORD(phi,         PHI);
-  INSTKEYWORD(call,        Call);
-  INSTKEYWORD(trunc,       Trunc);
-  INSTKEYWORD(zext,        ZExt);
-  INSTKEYWORD(sext,        SExt);
-  INSTKEYWORD(fptrunc,     FPTrunc);
-  INSTKEYWORD(fpext,       FPExt);
-  INSTKEYWORD(uitofp,      UIToFP);
-  INSTKEYWORD(sitofp,      SIToFP);
-  INSTKEYWORD(fptoui,      FPToUI);
-  INSTKEYWORD(fptosi,      FPToSI);
-  INSTKEYWORD(inttoptr,    IntToPtr);
-  INSTKEYWORD(ptrtoint,    PtrToInt);
-  INSTKEYWORD(bitcast,     BitCast);
-  INSTKEYWORD(addrspacecast, AddrSpaceCast);
-  INSTKEYWORD(select,      Select);
-  INSTKEYWORD(va_arg,      VAArg);
-  INSTKEYWORD(ret,         Ret);
-  INSTKEYWORD(br,          Br);
-  INSTKEYWORD(switch,      Switch);
-  INSTKEYWORD(indirectbr,  IndirectBr);
-  INSTKEYWORD(invoke,      Invoke);
-  INSTKEYWORD(resume,      Resume);
-  INSTKEYWORD(unreachable, Unreachable);
-
-  INSTKEYWORD(alloca,      Alloca);
-  INSTKEYWORD(load,        Load);
-  INSTKEYWORD(store,       Store);
-  INSTKEYWORD(cmpxchg,     AtomicCmpXchg);
-  INSTKEYWORD(atomicrmw,   AtomicRMW);
-  INSTKEYWORD(fence,       Fence);
-  INSTKEYWORD(getelementptr, GetElementPtr);
-
-  INSTKEYWORD(extractelement, ExtractElement);
-  INSTKEYWORD(insertelement,  InsertElement);
-  INSTKEYWORD(shufflevector,  ShuffleVector);
-  INSTKEYWORD(extractvalue,   ExtractValue);
-  INSTKEYWORD(insertvalue,    InsertValue);
-  INSTKEYWORD(landingpad,     LandingPad);
-  INSTKEYWORD(cleanupret,     CleanupRet);
-  INSTKEYWORD(catchret,       CatchRet);
-  INSTKEYWORD(catchswitch,  CatchSwitch);
-  INSTKEYWORD(catchpad,     CatchPad);
-  INSTKEYWORD(cleanuppad,   CleanupPad);
-#undef INSTKEYWORD
+  auto KI = Keywords->Map.find(Keyword);
+  if (KI != Keywords->Map.end()) {
+    const KeywordInfo &Info = KI->second;
+    if (Info.Kind == lltok::Type)
+      TyVal = Type::getPrimitiveType(Context, Type::TypeID(Info.Val));
+    else if (Info.Val)
+      UIntVal = Info.Val;
+    return Info.Kind;
+  }
 
 #define DWKEYWORD(TYPE, TOKEN)                                                 \
   do {                                                                         \
@@ -35,6 +35,18 @@
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
+/// Return the entry of a forward reference table whose first use comes first
+/// in the input, so that the error reported for an undefined reference does
+/// not depend on the order of the table.
+template <typename MapT>
+static typename MapT::const_iterator getFirstForwardRef(const MapT &Map) {
+  typedef typename MapT::value_type EntryT;
+  return std::min_element(Map.begin(), Map.end(),
+                          [](const EntryT &A, const EntryT &B) {
+    return A.second.second.getPointer() < B.second.second.getPointer();
+  });
+}
+
 static std::string getTypeString(Type *T) {
   std::string Result;
   raw_string_ostream Tmp(Result);
@@ -182,20 +194,23 @@ bool LLParser::ValidateEndOfModule() {
                  "use of undefined comdat '$" +
                      ForwardRefComdats.begin()->first + "'");
 
-  if (!ForwardRefVals.empty())
-    return Error(ForwardRefVals.begin()->second.second,
-                 "use of undefined value '@" + ForwardRefVals.begin()->first +
-                 "'");
+  if (!ForwardRefVals.empty()) {
+    auto I = getFirstForwardRef(ForwardRefVals);
+    return Error(I->second.second,
+                 "use of undefined value '@" + I->getKey() + "'");
+  }
 
-  if (!ForwardRefValIDs.empty())
-    return Error(ForwardRefValIDs.begin()->second.second,
-                 "use of undefined value '@" +
-                 Twine(ForwardRefValIDs.begin()->first) + "'");
+  if (!ForwardRefValIDs.empty()) {
+    auto I = getFirstForwardRef(ForwardRefValIDs);
+    return Error(I->second.second,
+                 "use of undefined value '@" + Twine(I->first) + "'");
+  }
 
-  if (!ForwardRefMDNodes.empty())
-    return Error(ForwardRefMDNodes.begin()->second.second,
-                 "use of undefined metadata '!" +
-                 Twine(ForwardRefMDNodes.begin()->first) + "'");
+  if (!ForwardRefMDNodes.empty()) {
+    auto I = getFirstForwardRef(ForwardRefMDNodes);
+    return Error(I->second.second,
+                 "use of undefined metadata '!" + Twine(I->first) + "'");
+  }
 
   // Resolve metadata cycles.
   for (auto &N : NumberedMetadata) {
@@ -564,8 +579,9 @@ bool LLParser::ParseMDNodeID(MDNode *&Result) {
     return true;
 
   // If not a forward reference, just return it now.
-  if (NumberedMetadata.count(MID)) {
-    Result = NumberedMetadata[MID];
+  auto I = NumberedMetadata.find(MID);
+  if (I != NumberedMetadata.end()) {
+    Result = I->second;
     return false;
   }
 
@@ -2421,14 +2437,16 @@ LLParser::PerFunctionState::~PerFunctionState() {
 }
 
 bool LLParser::PerFunctionState::FinishFunction() {
-  if (!ForwardRefVals.empty())
-    return P.Error(ForwardRefVals.begin()->second.second,
-                   "use of undefined value '%" + ForwardRefVals.begin()->first +
-                   "'");
-  if (!ForwardRefValIDs.empty())
-    return P.Error(ForwardRefValIDs.begin()->second.second,
-                   "use of undefined value '%" +
-                   Twine(ForwardRefValIDs.begin()->first) + "'");
+  if (!ForwardRefVals.empty()) {
+    auto I = getFirstForwardRef(ForwardRefVals);
+    return P.Error(I->second.second,
+                   "use of undefined value '%" + I->getKey() + "'");
+  }
+  if (!ForwardRefValIDs.empty()) {
+    auto I = getFirstForwardRef(ForwardRefValIDs);
+    return P.Error(I->second.second,
+                   "use of undefined value '%" + Twine(I->first) + "'");
+  }
   return false;
 }
 
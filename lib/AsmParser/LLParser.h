@@ -15,6 +15,7 @@
 #define LLVM_LIB_ASMPARSER_LLPARSER_H
 
 #include "LLLexer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/IR/Attributes.h"
@@ -116,11 +117,11 @@ namespace llvm {
     std::map<unsigned, std::pair<Type*, LocTy> > NumberedTypes;
 
     std::map<unsigned, TrackingMDNodeRef> NumberedMetadata;
-    std::map<unsigned, std::pair<TempMDTuple, LocTy>> ForwardRefMDNodes;
+    DenseMap<unsigned, std::pair<TempMDTuple, LocTy>> ForwardRefMDNodes;
 
     // Global Value reference information.
-    std::map<std::string, std::pair<GlobalValue*, LocTy> > ForwardRefVals;
-    std::map<unsigned, std::pair<GlobalValue*, LocTy> > ForwardRefValIDs;
+    StringMap<std::pair<GlobalValue*, LocTy> > ForwardRefVals;
+    DenseMap<unsigned, std::pair<GlobalValue*, LocTy> > ForwardRefValIDs;
     std::vector<GlobalValue*> NumberedVals;
 
     // Comdat forward reference information.
@@ -318,8 +319,8 @@ namespace llvm {
     class PerFunctionState {
       LLParser &P;
       Function &F;
-      std::map<std::string, std::pair<Value*, LocTy> > ForwardRefVals;
-      std::map<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDs;
+      StringMap<std::pair<Value*, LocTy> > ForwardRefVals;
+      DenseMap<unsigned, std::pair<Value*, LocTy> > ForwardRefValIDs;
       std::vector<Value*> NumberedVals;
 
       /// FunctionNumber - If this is an unnamed function, this is the slot
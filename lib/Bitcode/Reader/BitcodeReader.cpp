@@ -7,9 +7,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Bitcode/BitstreamReader.h"
 #include "llvm/Bitcode/LLVMBitCodes.h"
@@ -35,17 +37,32 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <deque>
 #include <utility>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "bitcode-reader"
+
+STATISTIC(NumMDRecordLoaded, "Number of metadata records loaded");
+
 static cl::opt<bool> PrintSummaryGUIDs(
     "print-summary-global-ids", cl::init(false), cl::Hidden,
     cl::desc(
         "Print the global id for each value when reading the module summary"));
 
+static cl::opt<bool> DisableLazyLoading(
+    "disable-ondemand-mds-loading", cl::init(false), cl::Hidden,
+    cl::desc("Force disable the lazy-loading on-demand of metadata when "
+             "loading bitcode for importing."));
+
+static cl::opt<unsigned> ReaderThreads(
+    "bitcode-reader-threads", cl::init(0), cl::Hidden,
+    cl::desc("Number of threads that read function blocks ahead when the "
+             "whole module is materialized; 0 or 1 reads them on demand"));
+
 namespace {
 enum {
   SWITCH_INST_MAGIC = 0x4B5 // May 2012 => 1205 => Hex
@@ -104,7 +121,8 @@ public:
 };
 
 class BitcodeReaderMetadataList {
-  unsigned NumFwdRefs;
+  /// IDs of the forward references that have not been resolved yet.
+  DenseSet<unsigned> ForwardReference;
   bool AnyFwdRefs;
   unsigned MinFwdRef;
   unsigned MaxFwdRef;
@@ -126,7 +144,7 @@ class BitcodeReaderMetadataList {
   LLVMContext &Context;
 public:
   BitcodeReaderMetadataList(LLVMContext &C)
-      : NumFwdRefs(0), AnyFwdRefs(false), Context(C) {}
+      : AnyFwdRefs(false), Context(C) {}
 
   // vector compatibility methods
   unsigned size() const { return MetadataPtrs.size(); }
@@ -168,6 +186,9 @@ public:
   void assignValue(Metadata *MD, unsigned Idx);
   void tryToResolveCycles();
   bool hasFwdRefs() const { return AnyFwdRefs; }
+  const DenseSet<unsigned> &getForwardReferences() const {
+    return ForwardReference;
+  }
 
   /// Upgrade a type that had an MDString reference.
   void addTypeRef(MDString &UUID, DICompositeType &CT);
@@ -182,12 +203,28 @@ private:
   Metadata *resolveTypeRefArray(Metadata *MaybeTuple);
 };
 
+class PlaceholderQueue;
+
+/// A function block that is read ahead on another thread, with a reader and a
+/// cursor of its own, so that only building the IR from its records is left.
+struct PrereadFunctionBody {
+  BitstreamReader Reader;
+  BitstreamCursor Cursor;
+  BitstreamRecording Records;
+  std::shared_future<ThreadPool::VoidTy> Done;
+
+  PrereadFunctionBody(StringRef Bitcode)
+      : Reader(Bitcode.bytes_begin(), Bitcode.bytes_end()), Cursor(Reader) {}
+};
+
 class BitcodeReader : public GVMaterializer {
   LLVMContext &Context;
   Module *TheModule = nullptr;
   std::unique_ptr<MemoryBuffer> Buffer;
   std::unique_ptr<BitstreamReader> StreamFile;
   BitstreamCursor Stream;
+  // The bitcode that StreamFile reads, unless it is streamed.
+  StringRef InMemoryBitcode;
   // Next offset to start scanning for lazy parsing of function bodies.
   uint64_t NextUnreadBit = 0;
   // Last function offset found in the VST.
@@ -245,6 +282,10 @@ class BitcodeReader : public GVMaterializer {
   /// where to find deferred function body in the stream.
   DenseMap<Function*, uint64_t> DeferredFunctionInfo;
 
+  /// Function bodies that are being read ahead while the whole module is
+  /// materialized with -bitcode-reader-threads.
+  DenseMap<Function *, std::unique_ptr<PrereadFunctionBody>> PrereadBodies;
+
   /// When Metadata block is initially scanned when parsing the module, we may
   /// choose to defer parsing of the metadata. This vector contains info about
   /// which Metadata blocks are deferred.
@@ -271,6 +312,20 @@ class BitcodeReader : public GVMaterializer {
   /// True if any Metadata block has been materialized.
   bool IsMetadataMaterialized = false;
 
+  /// When the module-level metadata block comes with an index, the records in
+  /// it are only loaded when something references them. This cursor is
+  /// positioned inside that block, with its abbreviations in scope.
+  BitstreamCursor IndexCursor;
+
+  /// Bit positions of the lazily loaded module-level metadata records, for the
+  /// IDs following the NumModuleMDStrings metadata strings.
+  std::vector<uint64_t> GlobalMetadataBitPosIndex;
+  unsigned NumModuleMDStrings = 0;
+
+  /// Compile units with an old-style list of subprograms, to be upgraded when
+  /// the metadata block is done.
+  std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
+
   bool StripDebugInfo = false;
 
   /// Functions that need to be matched with subprograms when upgrading old
@@ -330,12 +385,15 @@ private:
 
   Type *getTypeByID(unsigned ID);
   Value *getFnValueByID(unsigned ID, Type *Ty) {
-    if (Ty && Ty->isMetadataTy())
-      return MetadataAsValue::get(Ty->getContext(), getFnMetadataByID(ID));
+    if (Ty && Ty->isMetadataTy()) {
+      if (Metadata *MD = getFnMetadataByID(ID))
+        return MetadataAsValue::get(Ty->getContext(), MD);
+      return nullptr;
+    }
     return ValueList.getValueFwdRef(ID, Ty);
   }
   Metadata *getFnMetadataByID(unsigned ID) {
-    return MetadataList.getMetadataFwdRef(ID);
+    return getMetadataFwdRef(ID);
   }
   BasicBlock *getBasicBlock(unsigned ID) const {
     if (ID >= FunctionBBs.size()) return nullptr; // Invalid ID
@@ -438,6 +496,25 @@ private:
   std::error_code globalCleanup();
   std::error_code resolveGlobalAndIndirectSymbolInits();
   std::error_code parseMetadata(bool ModuleLevel = false);
+  std::error_code parseOneMetadata(SmallVectorImpl<uint64_t> &Record,
+                                   unsigned Code, PlaceholderQueue &Placeholders,
+                                   StringRef Blob, unsigned &NextMetadataNo);
+  std::error_code parseNamedMetadata(BitstreamCursor &Cursor,
+                                     SmallVectorImpl<uint64_t> &Record);
+  void upgradeCUSubprograms();
+  ErrorOr<bool> lazyLoadModuleMetadataBlock();
+  bool isLazyLoadable(unsigned ID) const {
+    return ID >= NumModuleMDStrings &&
+           ID - NumModuleMDStrings < GlobalMetadataBitPosIndex.size();
+  }
+  std::error_code lazyLoadOneMetadata(unsigned ID,
+                                      PlaceholderQueue &Placeholders);
+  std::error_code
+  resolveForwardRefsAndPlaceholders(PlaceholderQueue &Placeholders);
+  Metadata *getMetadataFwdRef(unsigned ID);
+  MDNode *getMDNodeFwdRefOrNull(unsigned ID) {
+    return dyn_cast_or_null<MDNode>(getMetadataFwdRef(ID));
+  }
   std::error_code parseMetadataStrings(ArrayRef<uint64_t> Record,
                                        StringRef Blob,
                                        unsigned &NextMetadataNo);
@@ -452,6 +529,8 @@ private:
   std::error_code findFunctionInStream(
       Function *F,
       DenseMap<Function *, uint64_t>::iterator DeferredFunctionInfoIterator);
+  void prereadFunctionBody(ThreadPool &Pool, Function *F);
+  std::error_code materializeFunctionsInParallel();
 };
 
 /// Class to manage reading and parsing function summary index bitcode
@@ -652,6 +731,8 @@ void BitcodeReader::freeState() {
   std::vector<Function*>().swap(FunctionsWithBodies);
   DeferredFunctionInfo.clear();
   DeferredMetadataInfo.clear();
+  GlobalMetadataBitPosIndex.clear();
+  NumModuleMDStrings = 0;
   MDKindMap.clear();
 
   assert(BasicBlockFwdRefs.empty() && "Unresolved blockaddress fwd references");
@@ -740,6 +821,13 @@ static GlobalValueSummary::GVFlags getDecodedGVSummaryFlags(uint64_t RawFlags,
   return GlobalValueSummary::GVFlags(Linkage, HasSection);
 }
 
+static CalleeInfo::HotnessType getDecodedHotness(uint64_t Val) {
+  // Map unknown values to Unknown.
+  if (Val > uint64_t(CalleeInfo::HotnessType::Hot))
+    return CalleeInfo::HotnessType::Unknown;
+  return CalleeInfo::HotnessType(Val);
+}
+
 static GlobalValue::VisibilityTypes getDecodedVisibility(unsigned Val) {
   switch (Val) {
   default: // Map unknown visibilities to default.
@@ -1105,7 +1193,7 @@ void BitcodeReaderMetadataList::assignValue(Metadata *MD, unsigned Idx) {
   // If there was a forward reference to this value, replace it.
   TempMDTuple PrevMD(cast<MDTuple>(OldMD.get()));
   PrevMD->replaceAllUsesWith(MD);
-  --NumFwdRefs;
+  ForwardReference.erase(Idx);
 }
 
 Metadata *BitcodeReaderMetadataList::getMetadataFwdRef(unsigned Idx) {
@@ -1123,7 +1211,7 @@ Metadata *BitcodeReaderMetadataList::getMetadataFwdRef(unsigned Idx) {
     AnyFwdRefs = true;
     MinFwdRef = MaxFwdRef = Idx;
   }
-  ++NumFwdRefs;
+  ForwardReference.insert(Idx);
 
   // Create and return a placeholder, which will later be RAUW'd.
   Metadata *MD = MDNode::getTemporary(Context, None).release();
@@ -1144,7 +1232,7 @@ MDNode *BitcodeReaderMetadataList::getMDNodeFwdRefOrNull(unsigned Idx) {
 }
 
 void BitcodeReaderMetadataList::tryToResolveCycles() {
-  if (NumFwdRefs)
+  if (!ForwardReference.empty())
     // Still forward references... can't resolve cycles.
     return;
 
@@ -2079,6 +2167,11 @@ class PlaceholderQueue {
 public:
   DistinctMDOperandPlaceholder &getPlaceholderOp(unsigned ID);
   void flush(BitcodeReaderMetadataList &MetadataList);
+
+  /// Add the IDs of the placeholders whose metadata has not been loaded yet
+  /// to Temporaries.
+  void getTemporaries(BitcodeReaderMetadataList &MetadataList,
+                      DenseSet<unsigned> &Temporaries);
 };
 } // end namespace
 
@@ -2095,6 +2188,21 @@ void PlaceholderQueue::flush(BitcodeReaderMetadataList &MetadataList) {
   }
 }
 
+void PlaceholderQueue::getTemporaries(BitcodeReaderMetadataList &MetadataList,
+                                      DenseSet<unsigned> &Temporaries) {
+  for (auto &PH : PHs) {
+    auto ID = PH.getID();
+    auto *MD = MetadataList.lookup(ID);
+    if (!MD) {
+      Temporaries.insert(ID);
+      continue;
+    }
+    auto *N = dyn_cast<MDNode>(MD);
+    if (N && N->isTemporary())
+      Temporaries.insert(ID);
+  }
+}
+
 /// Parse a METADATA_BLOCK. If ModuleLevel is true then we are parsing
 /// module level metadata.
 std::error_code BitcodeReader::parseMetadata(bool ModuleLevel) {
@@ -2110,11 +2218,81 @@ std::error_code BitcodeReader::parseMetadata(bool ModuleLevel) {
   if (Stream.EnterSubBlock(bitc::METADATA_BLOCK_ID))
     return error("Invalid record");
 
-  std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
   SmallVector<uint64_t, 64> Record;
-
   PlaceholderQueue Placeholders;
-  bool IsDistinct;
+
+  // Read all the records.
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock:
+      upgradeCUSubprograms();
+      return resolveForwardRefsAndPlaceholders(Placeholders);
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    // Read a record.
+    Record.clear();
+    StringRef Blob;
+    unsigned Code = Stream.readRecord(Entry.ID, Record, &Blob);
+    if (Code == bitc::METADATA_NAME) {
+      if (std::error_code EC = parseNamedMetadata(Stream, Record))
+        return EC;
+      continue;
+    }
+    if (std::error_code EC =
+            parseOneMetadata(Record, Code, Placeholders, Blob, NextMetadataNo))
+      return EC;
+  }
+}
+
+/// Parse the METADATA_NAMED_NODE following the METADATA_NAME in Record.
+std::error_code
+BitcodeReader::parseNamedMetadata(BitstreamCursor &Cursor,
+                                  SmallVectorImpl<uint64_t> &Record) {
+  // Read name of the named metadata.
+  SmallString<8> Name(Record.begin(), Record.end());
+  Record.clear();
+  unsigned Code = Cursor.ReadCode();
+
+  unsigned NextBitCode = Cursor.readRecord(Code, Record);
+  if (NextBitCode != bitc::METADATA_NAMED_NODE)
+    return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
+
+  // Read named metadata elements.
+  unsigned Size = Record.size();
+  NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
+  for (unsigned i = 0; i != Size; ++i) {
+    MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[i]);
+    if (!MD)
+      return error("Invalid record");
+    NMD->addOperand(MD);
+  }
+  return std::error_code();
+}
+
+/// Upgrade old-style CU <-> SP pointers to point from SP to CU.
+void BitcodeReader::upgradeCUSubprograms() {
+  for (auto CU_SP : CUSubprograms)
+    if (auto *SPs = dyn_cast_or_null<MDTuple>(CU_SP.second))
+      for (auto &Op : SPs->operands())
+        if (auto *SP = dyn_cast_or_null<MDNode>(Op))
+          SP->replaceOperandWith(7, CU_SP.first);
+  CUSubprograms.clear();
+}
+
+/// Parse a single metadata record, assigning the metadata it defines to
+/// NextMetadataNo (which is advanced past it).
+std::error_code BitcodeReader::parseOneMetadata(
+    SmallVectorImpl<uint64_t> &Record, unsigned Code,
+    PlaceholderQueue &Placeholders, StringRef Blob, unsigned &NextMetadataNo) {
+  bool IsDistinct = false;
   auto getMD = [&](unsigned ID) -> Metadata * {
     if (!IsDistinct)
       return MetadataList.getMetadataFwdRef(ID);
@@ -2146,548 +2324,498 @@ std::error_code BitcodeReader::parseMetadata(bool ModuleLevel) {
 #define GET_OR_DISTINCT(CLASS, ARGS)                                           \
   (IsDistinct ? CLASS::getDistinct ARGS : CLASS::get ARGS)
 
-  // Read all the records.
-  while (1) {
-    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+  switch (Code) {
+  default:  // Default behavior: ignore.
+    break;
+  case bitc::METADATA_OLD_FN_NODE: {
+    // FIXME: Remove in 4.0.
+    // This is a LocalAsMetadata record, the only type of function-local
+    // metadata.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
 
-    switch (Entry.Kind) {
-    case BitstreamEntry::SubBlock: // Handled for us already.
-    case BitstreamEntry::Error:
-      return error("Malformed block");
-    case BitstreamEntry::EndBlock:
-      // Upgrade old-style CU <-> SP pointers to point from SP to CU.
-      for (auto CU_SP : CUSubprograms)
-        if (auto *SPs = dyn_cast_or_null<MDTuple>(CU_SP.second))
-          for (auto &Op : SPs->operands())
-            if (auto *SP = dyn_cast_or_null<MDNode>(Op))
-              SP->replaceOperandWith(7, CU_SP.first);
-
-      MetadataList.tryToResolveCycles();
-      Placeholders.flush(MetadataList);
-      return std::error_code();
-    case BitstreamEntry::Record:
-      // The interesting case.
+    // If this isn't a LocalAsMetadata record, we're dropping it.  This used
+    // to be legal, but there's no upgrade path.
+    auto dropRecord = [&] {
+      MetadataList.assignValue(MDNode::get(Context, None), NextMetadataNo++);
+    };
+    if (Record.size() != 2) {
+      dropRecord();
       break;
     }
 
-    // Read a record.
-    Record.clear();
-    StringRef Blob;
-    unsigned Code = Stream.readRecord(Entry.ID, Record, &Blob);
-    IsDistinct = false;
-    switch (Code) {
-    default:  // Default behavior: ignore.
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy()) {
+      dropRecord();
       break;
-    case bitc::METADATA_NAME: {
-      // Read name of the named metadata.
-      SmallString<8> Name(Record.begin(), Record.end());
-      Record.clear();
-      Code = Stream.ReadCode();
+    }
 
-      unsigned NextBitCode = Stream.readRecord(Code, Record);
-      if (NextBitCode != bitc::METADATA_NAMED_NODE)
-        return error("METADATA_NAME not followed by METADATA_NAMED_NODE");
+    MetadataList.assignValue(
+        LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_OLD_NODE: {
+    // FIXME: Remove in 4.0.
+    if (Record.size() % 2 == 1)
+      return error("Invalid record");
 
-      // Read named metadata elements.
-      unsigned Size = Record.size();
-      NamedMDNode *NMD = TheModule->getOrInsertNamedMetadata(Name);
-      for (unsigned i = 0; i != Size; ++i) {
-        MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[i]);
-        if (!MD)
-          return error("Invalid record");
-        NMD->addOperand(MD);
-      }
-      break;
+    unsigned Size = Record.size();
+    SmallVector<Metadata *, 8> Elts;
+    for (unsigned i = 0; i != Size; i += 2) {
+      Type *Ty = getTypeByID(Record[i]);
+      if (!Ty)
+        return error("Invalid record");
+      if (Ty->isMetadataTy())
+        Elts.push_back(getMD(Record[i + 1]));
+      else if (!Ty->isVoidTy()) {
+        auto *MD =
+            ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
+        assert(isa<ConstantAsMetadata>(MD) &&
+               "Expected non-function-local metadata");
+        Elts.push_back(MD);
+      } else
+        Elts.push_back(nullptr);
     }
-    case bitc::METADATA_OLD_FN_NODE: {
-      // FIXME: Remove in 4.0.
-      // This is a LocalAsMetadata record, the only type of function-local
-      // metadata.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
-
-      // If this isn't a LocalAsMetadata record, we're dropping it.  This used
-      // to be legal, but there's no upgrade path.
-      auto dropRecord = [&] {
-        MetadataList.assignValue(MDNode::get(Context, None), NextMetadataNo++);
-      };
-      if (Record.size() != 2) {
-        dropRecord();
-        break;
-      }
+    MetadataList.assignValue(MDNode::get(Context, Elts), NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_VALUE: {
+    if (Record.size() != 2)
+      return error("Invalid record");
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy()) {
-        dropRecord();
-        break;
-      }
+    Type *Ty = getTypeByID(Record[0]);
+    if (Ty->isMetadataTy() || Ty->isVoidTy())
+      return error("Invalid record");
 
-      MetadataList.assignValue(
-          LocalAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_OLD_NODE: {
-      // FIXME: Remove in 4.0.
-      if (Record.size() % 2 == 1)
-        return error("Invalid record");
+    MetadataList.assignValue(
+        ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_DISTINCT_NODE:
+    IsDistinct = true;
+    // fallthrough...
+  case bitc::METADATA_NODE: {
+    SmallVector<Metadata *, 8> Elts;
+    Elts.reserve(Record.size());
+    for (unsigned ID : Record)
+      Elts.push_back(getMDOrNull(ID));
+    MetadataList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
+                                        : MDNode::get(Context, Elts),
+                             NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_LOCATION: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      unsigned Size = Record.size();
-      SmallVector<Metadata *, 8> Elts;
-      for (unsigned i = 0; i != Size; i += 2) {
-        Type *Ty = getTypeByID(Record[i]);
-        if (!Ty)
-          return error("Invalid record");
-        if (Ty->isMetadataTy())
-          Elts.push_back(getMD(Record[i + 1]));
-        else if (!Ty->isVoidTy()) {
-          auto *MD =
-              ValueAsMetadata::get(ValueList.getValueFwdRef(Record[i + 1], Ty));
-          assert(isa<ConstantAsMetadata>(MD) &&
-                 "Expected non-function-local metadata");
-          Elts.push_back(MD);
-        } else
-          Elts.push_back(nullptr);
-      }
-      MetadataList.assignValue(MDNode::get(Context, Elts), NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_VALUE: {
-      if (Record.size() != 2)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    unsigned Line = Record[1];
+    unsigned Column = Record[2];
+    Metadata *Scope = getMD(Record[3]);
+    Metadata *InlinedAt = getMDOrNull(Record[4]);
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DILocation,
+                        (Context, Line, Column, Scope, InlinedAt)),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_GENERIC_DEBUG: {
+    if (Record.size() < 4)
+      return error("Invalid record");
 
-      Type *Ty = getTypeByID(Record[0]);
-      if (Ty->isMetadataTy() || Ty->isVoidTy())
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    unsigned Tag = Record[1];
+    unsigned Version = Record[2];
 
-      MetadataList.assignValue(
-          ValueAsMetadata::get(ValueList.getValueFwdRef(Record[1], Ty)),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_DISTINCT_NODE:
-      IsDistinct = true;
-      // fallthrough...
-    case bitc::METADATA_NODE: {
-      SmallVector<Metadata *, 8> Elts;
-      Elts.reserve(Record.size());
-      for (unsigned ID : Record)
-        Elts.push_back(getMDOrNull(ID));
-      MetadataList.assignValue(IsDistinct ? MDNode::getDistinct(Context, Elts)
-                                          : MDNode::get(Context, Elts),
-                               NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_LOCATION: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    if (Tag >= 1u << 16 || Version != 0)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      unsigned Line = Record[1];
-      unsigned Column = Record[2];
-      Metadata *Scope = getMD(Record[3]);
-      Metadata *InlinedAt = getMDOrNull(Record[4]);
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DILocation,
-                          (Context, Line, Column, Scope, InlinedAt)),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_GENERIC_DEBUG: {
-      if (Record.size() < 4)
-        return error("Invalid record");
+    auto *Header = getMDString(Record[3]);
+    SmallVector<Metadata *, 8> DwarfOps;
+    for (unsigned I = 4, E = Record.size(); I != E; ++I)
+      DwarfOps.push_back(getMDOrNull(Record[I]));
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(GenericDINode, (Context, Tag, Header, DwarfOps)),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_SUBRANGE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      unsigned Tag = Record[1];
-      unsigned Version = Record[2];
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DISubrange,
+                        (Context, Record[1], unrotateSign(Record[2]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_ENUMERATOR: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      if (Tag >= 1u << 16 || Version != 0)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIEnumerator, (Context, unrotateSign(Record[1]),
+                                       getMDString(Record[2]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_BASIC_TYPE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
 
-      auto *Header = getMDString(Record[3]);
-      SmallVector<Metadata *, 8> DwarfOps;
-      for (unsigned I = 4, E = Record.size(); I != E; ++I)
-        DwarfOps.push_back(getMDOrNull(Record[I]));
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(GenericDINode, (Context, Tag, Header, DwarfOps)),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_SUBRANGE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIBasicType,
+                        (Context, Record[1], getMDString(Record[2]),
+                         Record[3], Record[4], Record[5])),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_DERIVED_TYPE: {
+    if (Record.size() != 12)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DISubrange,
-                          (Context, Record[1], unrotateSign(Record[2]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_ENUMERATOR: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(
+            DIDerivedType,
+            (Context, Record[1], getMDString(Record[2]),
+             getMDOrNull(Record[3]), Record[4], getDITypeRefOrNull(Record[5]),
+             getDITypeRefOrNull(Record[6]), Record[7], Record[8], Record[9],
+             Record[10], getDITypeRefOrNull(Record[11]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_COMPOSITE_TYPE: {
+    if (Record.size() != 16)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIEnumerator, (Context, unrotateSign(Record[1]),
-                                         getMDString(Record[2]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_BASIC_TYPE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    // If we have a UUID and this is not a forward declaration, lookup the
+    // mapping.
+    IsDistinct = Record[0] & 0x1;
+    bool IsNotUsedInTypeRef = Record[0] >= 2;
+    unsigned Tag = Record[1];
+    MDString *Name = getMDString(Record[2]);
+    Metadata *File = getMDOrNull(Record[3]);
+    unsigned Line = Record[4];
+    Metadata *Scope = getDITypeRefOrNull(Record[5]);
+    Metadata *BaseType = getDITypeRefOrNull(Record[6]);
+    uint64_t SizeInBits = Record[7];
+    uint64_t AlignInBits = Record[8];
+    uint64_t OffsetInBits = Record[9];
+    unsigned Flags = Record[10];
+    Metadata *Elements = getMDOrNull(Record[11]);
+    unsigned RuntimeLang = Record[12];
+    Metadata *VTableHolder = getDITypeRefOrNull(Record[13]);
+    Metadata *TemplateParams = getMDOrNull(Record[14]);
+    auto *Identifier = getMDString(Record[15]);
+    DICompositeType *CT = nullptr;
+    if (Identifier)
+      CT = DICompositeType::buildODRType(
+          Context, *Identifier, Tag, Name, File, Line, Scope, BaseType,
+          SizeInBits, AlignInBits, OffsetInBits, Flags, Elements, RuntimeLang,
+          VTableHolder, TemplateParams);
+
+    // Create a node if we didn't get a lazy ODR type.
+    if (!CT)
+      CT = GET_OR_DISTINCT(DICompositeType,
+                           (Context, Tag, Name, File, Line, Scope, BaseType,
+                            SizeInBits, AlignInBits, OffsetInBits, Flags,
+                            Elements, RuntimeLang, VTableHolder,
+                            TemplateParams, Identifier));
+    if (!IsNotUsedInTypeRef && Identifier)
+      MetadataList.addTypeRef(*Identifier, *cast<DICompositeType>(CT));
+
+    MetadataList.assignValue(CT, NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_SUBROUTINE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIBasicType,
-                          (Context, Record[1], getMDString(Record[2]),
-                           Record[3], Record[4], Record[5])),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_DERIVED_TYPE: {
-      if (Record.size() != 12)
-        return error("Invalid record");
+    IsDistinct = Record[0] & 0x1;
+    bool IsOldTypeRefArray = Record[0] < 2;
+    Metadata *Types = getMDOrNull(Record[2]);
+    if (LLVM_UNLIKELY(IsOldTypeRefArray))
+      Types = MetadataList.upgradeTypeRefArray(Types);
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(
-              DIDerivedType,
-              (Context, Record[1], getMDString(Record[2]),
-               getMDOrNull(Record[3]), Record[4], getDITypeRefOrNull(Record[5]),
-               getDITypeRefOrNull(Record[6]), Record[7], Record[8], Record[9],
-               Record[10], getDITypeRefOrNull(Record[11]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_COMPOSITE_TYPE: {
-      if (Record.size() != 16)
-        return error("Invalid record");
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DISubroutineType, (Context, Record[1], Types)),
+        NextMetadataNo++);
+    break;
+  }
 
-      // If we have a UUID and this is not a forward declaration, lookup the
-      // mapping.
-      IsDistinct = Record[0] & 0x1;
-      bool IsNotUsedInTypeRef = Record[0] >= 2;
-      unsigned Tag = Record[1];
-      MDString *Name = getMDString(Record[2]);
-      Metadata *File = getMDOrNull(Record[3]);
-      unsigned Line = Record[4];
-      Metadata *Scope = getDITypeRefOrNull(Record[5]);
-      Metadata *BaseType = getDITypeRefOrNull(Record[6]);
-      uint64_t SizeInBits = Record[7];
-      uint64_t AlignInBits = Record[8];
-      uint64_t OffsetInBits = Record[9];
-      unsigned Flags = Record[10];
-      Metadata *Elements = getMDOrNull(Record[11]);
-      unsigned RuntimeLang = Record[12];
-      Metadata *VTableHolder = getDITypeRefOrNull(Record[13]);
-      Metadata *TemplateParams = getMDOrNull(Record[14]);
-      auto *Identifier = getMDString(Record[15]);
-      DICompositeType *CT = nullptr;
-      if (Identifier)
-        CT = DICompositeType::buildODRType(
-            Context, *Identifier, Tag, Name, File, Line, Scope, BaseType,
-            SizeInBits, AlignInBits, OffsetInBits, Flags, Elements, RuntimeLang,
-            VTableHolder, TemplateParams);
+  case bitc::METADATA_MODULE: {
+    if (Record.size() != 6)
+      return error("Invalid record");
 
-      // Create a node if we didn't get a lazy ODR type.
-      if (!CT)
-        CT = GET_OR_DISTINCT(DICompositeType,
-                             (Context, Tag, Name, File, Line, Scope, BaseType,
-                              SizeInBits, AlignInBits, OffsetInBits, Flags,
-                              Elements, RuntimeLang, VTableHolder,
-                              TemplateParams, Identifier));
-      if (!IsNotUsedInTypeRef && Identifier)
-        MetadataList.addTypeRef(*Identifier, *cast<DICompositeType>(CT));
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIModule,
+                        (Context, getMDOrNull(Record[1]),
+                         getMDString(Record[2]), getMDString(Record[3]),
+                         getMDString(Record[4]), getMDString(Record[5]))),
+        NextMetadataNo++);
+    break;
+  }
 
-      MetadataList.assignValue(CT, NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_SUBROUTINE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+  case bitc::METADATA_FILE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      IsDistinct = Record[0] & 0x1;
-      bool IsOldTypeRefArray = Record[0] < 2;
-      Metadata *Types = getMDOrNull(Record[2]);
-      if (LLVM_UNLIKELY(IsOldTypeRefArray))
-        Types = MetadataList.upgradeTypeRefArray(Types);
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIFile, (Context, getMDString(Record[1]),
+                                 getMDString(Record[2]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_COMPILE_UNIT: {
+    if (Record.size() < 14 || Record.size() > 16)
+      return error("Invalid record");
 
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DISubroutineType, (Context, Record[1], Types)),
-          NextMetadataNo++);
-      break;
-    }
-
-    case bitc::METADATA_MODULE: {
-      if (Record.size() != 6)
-        return error("Invalid record");
-
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIModule,
-                          (Context, getMDOrNull(Record[1]),
-                           getMDString(Record[2]), getMDString(Record[3]),
-                           getMDString(Record[4]), getMDString(Record[5]))),
-          NextMetadataNo++);
-      break;
-    }
-
-    case bitc::METADATA_FILE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
-
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIFile, (Context, getMDString(Record[1]),
-                                   getMDString(Record[2]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_COMPILE_UNIT: {
-      if (Record.size() < 14 || Record.size() > 16)
-        return error("Invalid record");
-
-      // Ignore Record[0], which indicates whether this compile unit is
-      // distinct.  It's always distinct.
-      IsDistinct = true;
-      auto *CU = DICompileUnit::getDistinct(
-          Context, Record[1], getMDOrNull(Record[2]), getMDString(Record[3]),
-          Record[4], getMDString(Record[5]), Record[6], getMDString(Record[7]),
-          Record[8], getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-          getMDOrNull(Record[12]), getMDOrNull(Record[13]),
-          Record.size() <= 15 ? nullptr : getMDOrNull(Record[15]),
-          Record.size() <= 14 ? 0 : Record[14]);
-
-      MetadataList.assignValue(CU, NextMetadataNo++);
-
-      // Move the Upgrade the list of subprograms.
-      if (Metadata *SPs = getMDOrNullWithoutPlaceholders(Record[11]))
-        CUSubprograms.push_back({CU, SPs});
-      break;
-    }
-    case bitc::METADATA_SUBPROGRAM: {
-      if (Record.size() != 18 && Record.size() != 19)
-        return error("Invalid record");
-
-      IsDistinct =
-          (Record[0] & 1) || Record[8]; // All definitions should be distinct.
-      // Version 1 has a Function as Record[15].
-      // Version 2 has removed Record[15].
-      // Version 3 has the Unit as Record[15].
-      bool HasUnit = Record[0] >= 2;
-      if (HasUnit && Record.size() != 19)
-        return error("Invalid record");
-      Metadata *CUorFn = getMDOrNull(Record[15]);
-      unsigned Offset = Record.size() == 19 ? 1 : 0;
-      bool HasFn = Offset && !HasUnit;
-      DISubprogram *SP = GET_OR_DISTINCT(
-          DISubprogram,
-          (Context, getDITypeRefOrNull(Record[1]), getMDString(Record[2]),
-           getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
-           getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
-           getDITypeRefOrNull(Record[10]), Record[11], Record[12], Record[13],
-           Record[14], HasUnit ? CUorFn : nullptr,
-           getMDOrNull(Record[15 + Offset]), getMDOrNull(Record[16 + Offset]),
-           getMDOrNull(Record[17 + Offset])));
-      MetadataList.assignValue(SP, NextMetadataNo++);
+    // Ignore Record[0], which indicates whether this compile unit is
+    // distinct.  It's always distinct.
+    IsDistinct = true;
+    auto *CU = DICompileUnit::getDistinct(
+        Context, Record[1], getMDOrNull(Record[2]), getMDString(Record[3]),
+        Record[4], getMDString(Record[5]), Record[6], getMDString(Record[7]),
+        Record[8], getMDOrNull(Record[9]), getMDOrNull(Record[10]),
+        getMDOrNull(Record[12]), getMDOrNull(Record[13]),
+        Record.size() <= 15 ? nullptr : getMDOrNull(Record[15]),
+        Record.size() <= 14 ? 0 : Record[14]);
+
+    MetadataList.assignValue(CU, NextMetadataNo++);
+
+    // Move the Upgrade the list of subprograms.
+    if (Metadata *SPs = getMDOrNullWithoutPlaceholders(Record[11]))
+      CUSubprograms.push_back({CU, SPs});
+    break;
+  }
+  case bitc::METADATA_SUBPROGRAM: {
+    if (Record.size() != 18 && Record.size() != 19)
+      return error("Invalid record");
 
-      // Upgrade sp->function mapping to function->sp mapping.
-      if (HasFn) {
-        if (auto *CMD = dyn_cast_or_null<ConstantAsMetadata>(CUorFn))
-          if (auto *F = dyn_cast<Function>(CMD->getValue())) {
-            if (F->isMaterializable())
-              // Defer until materialized; unmaterialized functions may not have
-              // metadata.
-              FunctionsWithSPs[F] = SP;
-            else if (!F->empty())
-              F->setSubprogram(SP);
-          }
-      }
-      break;
+    IsDistinct =
+        (Record[0] & 1) || Record[8]; // All definitions should be distinct.
+    // Version 1 has a Function as Record[15].
+    // Version 2 has removed Record[15].
+    // Version 3 has the Unit as Record[15].
+    bool HasUnit = Record[0] >= 2;
+    if (HasUnit && Record.size() != 19)
+      return error("Invalid record");
+    Metadata *CUorFn = getMDOrNull(Record[15]);
+    unsigned Offset = Record.size() == 19 ? 1 : 0;
+    bool HasFn = Offset && !HasUnit;
+    DISubprogram *SP = GET_OR_DISTINCT(
+        DISubprogram,
+        (Context, getDITypeRefOrNull(Record[1]), getMDString(Record[2]),
+         getMDString(Record[3]), getMDOrNull(Record[4]), Record[5],
+         getMDOrNull(Record[6]), Record[7], Record[8], Record[9],
+         getDITypeRefOrNull(Record[10]), Record[11], Record[12], Record[13],
+         Record[14], HasUnit ? CUorFn : nullptr,
+         getMDOrNull(Record[15 + Offset]), getMDOrNull(Record[16 + Offset]),
+         getMDOrNull(Record[17 + Offset])));
+    MetadataList.assignValue(SP, NextMetadataNo++);
+
+    // Upgrade sp->function mapping to function->sp mapping.
+    if (HasFn) {
+      if (auto *CMD = dyn_cast_or_null<ConstantAsMetadata>(CUorFn))
+        if (auto *F = dyn_cast<Function>(CMD->getValue())) {
+          if (F->isMaterializable())
+            // Defer until materialized; unmaterialized functions may not have
+            // metadata.
+            FunctionsWithSPs[F] = SP;
+          else if (!F->empty())
+            F->setSubprogram(SP);
+        }
     }
-    case bitc::METADATA_LEXICAL_BLOCK: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlock,
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3], Record[4])),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_LEXICAL_BLOCK_FILE: {
-      if (Record.size() != 4)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlock,
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3], Record[4])),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_LEXICAL_BLOCK_FILE: {
+    if (Record.size() != 4)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DILexicalBlockFile,
-                          (Context, getMDOrNull(Record[1]),
-                           getMDOrNull(Record[2]), Record[3])),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_NAMESPACE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DILexicalBlockFile,
+                        (Context, getMDOrNull(Record[1]),
+                         getMDOrNull(Record[2]), Record[3])),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_NAMESPACE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DINamespace, (Context, getMDOrNull(Record[1]),
-                                        getMDOrNull(Record[2]),
-                                        getMDString(Record[3]), Record[4])),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_MACRO: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DINamespace, (Context, getMDOrNull(Record[1]),
+                                      getMDOrNull(Record[2]),
+                                      getMDString(Record[3]), Record[4])),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_MACRO: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIMacro,
-                          (Context, Record[1], Record[2],
-                           getMDString(Record[3]), getMDString(Record[4]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_MACRO_FILE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIMacro,
+                        (Context, Record[1], Record[2],
+                         getMDString(Record[3]), getMDString(Record[4]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_MACRO_FILE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIMacroFile,
-                          (Context, Record[1], Record[2],
-                           getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_TYPE: {
-      if (Record.size() != 3)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIMacroFile,
+                        (Context, Record[1], Record[2],
+                         getMDOrNull(Record[3]), getMDOrNull(Record[4]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_TYPE: {
+    if (Record.size() != 3)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
-                                               (Context, getMDString(Record[1]),
-                                                getDITypeRefOrNull(Record[2]))),
-                               NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_TEMPLATE_VALUE: {
-      if (Record.size() != 5)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(GET_OR_DISTINCT(DITemplateTypeParameter,
+                                             (Context, getMDString(Record[1]),
+                                              getDITypeRefOrNull(Record[2]))),
+                             NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_TEMPLATE_VALUE: {
+    if (Record.size() != 5)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DITemplateValueParameter,
-                          (Context, Record[1], getMDString(Record[2]),
-                           getDITypeRefOrNull(Record[3]),
-                           getMDOrNull(Record[4]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_GLOBAL_VAR: {
-      if (Record.size() != 11)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DITemplateValueParameter,
+                        (Context, Record[1], getMDString(Record[2]),
+                         getDITypeRefOrNull(Record[3]),
+                         getMDOrNull(Record[4]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_GLOBAL_VAR: {
+    if (Record.size() != 11)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIGlobalVariable,
-                          (Context, getMDOrNull(Record[1]),
-                           getMDString(Record[2]), getMDString(Record[3]),
-                           getMDOrNull(Record[4]), Record[5],
-                           getDITypeRefOrNull(Record[6]), Record[7], Record[8],
-                           getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_LOCAL_VAR: {
-      // 10th field is for the obseleted 'inlinedAt:' field.
-      if (Record.size() < 8 || Record.size() > 10)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIGlobalVariable,
+                        (Context, getMDOrNull(Record[1]),
+                         getMDString(Record[2]), getMDString(Record[3]),
+                         getMDOrNull(Record[4]), Record[5],
+                         getDITypeRefOrNull(Record[6]), Record[7], Record[8],
+                         getMDOrNull(Record[9]), getMDOrNull(Record[10]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_LOCAL_VAR: {
+    // 10th field is for the obseleted 'inlinedAt:' field.
+    if (Record.size() < 8 || Record.size() > 10)
+      return error("Invalid record");
 
-      // 2nd field used to be an artificial tag, either DW_TAG_auto_variable or
-      // DW_TAG_arg_variable.
-      IsDistinct = Record[0];
-      bool HasTag = Record.size() > 8;
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DILocalVariable,
-                          (Context, getMDOrNull(Record[1 + HasTag]),
-                           getMDString(Record[2 + HasTag]),
-                           getMDOrNull(Record[3 + HasTag]), Record[4 + HasTag],
-                           getDITypeRefOrNull(Record[5 + HasTag]),
-                           Record[6 + HasTag], Record[7 + HasTag])),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_EXPRESSION: {
-      if (Record.size() < 1)
-        return error("Invalid record");
+    // 2nd field used to be an artificial tag, either DW_TAG_auto_variable or
+    // DW_TAG_arg_variable.
+    IsDistinct = Record[0];
+    bool HasTag = Record.size() > 8;
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DILocalVariable,
+                        (Context, getMDOrNull(Record[1 + HasTag]),
+                         getMDString(Record[2 + HasTag]),
+                         getMDOrNull(Record[3 + HasTag]), Record[4 + HasTag],
+                         getDITypeRefOrNull(Record[5 + HasTag]),
+                         Record[6 + HasTag], Record[7 + HasTag])),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_EXPRESSION: {
+    if (Record.size() < 1)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIExpression,
-                          (Context, makeArrayRef(Record).slice(1))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_OBJC_PROPERTY: {
-      if (Record.size() != 8)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIExpression,
+                        (Context, makeArrayRef(Record).slice(1))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_OBJC_PROPERTY: {
+    if (Record.size() != 8)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIObjCProperty,
-                          (Context, getMDString(Record[1]),
-                           getMDOrNull(Record[2]), Record[3],
-                           getMDString(Record[4]), getMDString(Record[5]),
-                           Record[6], getDITypeRefOrNull(Record[7]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_IMPORTED_ENTITY: {
-      if (Record.size() != 6)
-        return error("Invalid record");
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIObjCProperty,
+                        (Context, getMDString(Record[1]),
+                         getMDOrNull(Record[2]), Record[3],
+                         getMDString(Record[4]), getMDString(Record[5]),
+                         Record[6], getDITypeRefOrNull(Record[7]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_IMPORTED_ENTITY: {
+    if (Record.size() != 6)
+      return error("Invalid record");
 
-      IsDistinct = Record[0];
-      MetadataList.assignValue(
-          GET_OR_DISTINCT(DIImportedEntity,
-                          (Context, Record[1], getMDOrNull(Record[2]),
-                           getDITypeRefOrNull(Record[3]), Record[4],
-                           getMDString(Record[5]))),
-          NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_STRING_OLD: {
-      std::string String(Record.begin(), Record.end());
+    IsDistinct = Record[0];
+    MetadataList.assignValue(
+        GET_OR_DISTINCT(DIImportedEntity,
+                        (Context, Record[1], getMDOrNull(Record[2]),
+                         getDITypeRefOrNull(Record[3]), Record[4],
+                         getMDString(Record[5]))),
+        NextMetadataNo++);
+    break;
+  }
+  case bitc::METADATA_STRING_OLD: {
+    std::string String(Record.begin(), Record.end());
 
-      // Test for upgrading !llvm.loop.
-      HasSeenOldLoopTags |= mayBeOldLoopAttachmentTag(String);
+    // Test for upgrading !llvm.loop.
+    HasSeenOldLoopTags |= mayBeOldLoopAttachmentTag(String);
 
-      Metadata *MD = MDString::get(Context, String);
-      MetadataList.assignValue(MD, NextMetadataNo++);
-      break;
-    }
-    case bitc::METADATA_STRINGS:
-      if (std::error_code EC =
-              parseMetadataStrings(Record, Blob, NextMetadataNo))
-        return EC;
-      break;
-    case bitc::METADATA_KIND: {
-      // Support older bitcode files that had METADATA_KIND records in a
-      // block with METADATA_BLOCK_ID.
-      if (std::error_code EC = parseMetadataKindRecord(Record))
-        return EC;
-      break;
-    }
-    }
+    Metadata *MD = MDString::get(Context, String);
+    MetadataList.assignValue(MD, NextMetadataNo++);
+    break;
   }
+  case bitc::METADATA_STRINGS:
+    if (std::error_code EC =
+            parseMetadataStrings(Record, Blob, NextMetadataNo))
+      return EC;
+    break;
+  case bitc::METADATA_KIND: {
+    // Support older bitcode files that had METADATA_KIND records in a
+    // block with METADATA_BLOCK_ID.
+    if (std::error_code EC = parseMetadataKindRecord(Record))
+      return EC;
+    break;
+  }
+  }
+  return std::error_code();
 #undef GET_OR_DISTINCT
 }
 
@@ -3368,10 +3496,196 @@ std::error_code BitcodeReader::rememberAndSkipMetadata() {
   return std::error_code();
 }
 
+/// Set up lazy loading for the module-level metadata block at the current
+/// position of the stream. Metadata strings and named metadata (and whatever
+/// the latter references) are loaded right away, the other records are only
+/// loaded once they are referenced. Returns false without loading anything if
+/// the block has no index of its records.
+ErrorOr<bool> BitcodeReader::lazyLoadModuleMetadataBlock() {
+  IndexCursor = Stream;
+  if (IndexCursor.EnterSubBlock(bitc::METADATA_BLOCK_ID))
+    return error("Invalid record");
+
+  SmallVector<uint64_t, 64> Record;
+  unsigned NextMetadataNo = 0;
+  bool HasIndex = false;
+  while (1) {
+    BitstreamEntry Entry = IndexCursor.advanceSkippingSubblocks(
+        BitstreamCursor::AF_DontPopBlockAtEnd);
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return error("Malformed block");
+    case BitstreamEntry::EndBlock: {
+      IsMetadataMaterialized = true;
+      PlaceholderQueue Placeholders;
+      if (std::error_code EC = resolveForwardRefsAndPlaceholders(Placeholders))
+        return EC;
+      return true;
+    }
+    case BitstreamEntry::Record:
+      break;
+    }
+
+    Record.clear();
+    StringRef Blob;
+    unsigned Code = IndexCursor.readRecord(Entry.ID, Record, &Blob);
+    switch (Code) {
+    case bitc::METADATA_STRINGS:
+      // The strings come first, all the other records follow the index.
+      if (HasIndex || NextMetadataNo)
+        return error("Invalid record");
+      if (std::error_code EC =
+              parseMetadataStrings(Record, Blob, NextMetadataNo))
+        return EC;
+      break;
+    case bitc::METADATA_INDEX_OFFSET: {
+      if (HasIndex || Record.size() != 2)
+        return error("Invalid record");
+      HasIndex = true;
+
+      // The offset is relative to the end of this record. Jump to the index,
+      // and continue with the records that follow it.
+      uint64_t Offset = Record[0] + (Record[1] << 32);
+      uint64_t BeginPos = IndexCursor.GetCurrentBitNo();
+      IndexCursor.JumpToBit(BeginPos + Offset);
+      Entry = IndexCursor.advanceSkippingSubblocks(
+          BitstreamCursor::AF_DontPopBlockAtEnd);
+      Record.clear();
+      if (Entry.Kind != BitstreamEntry::Record ||
+          IndexCursor.readRecord(Entry.ID, Record) != bitc::METADATA_INDEX)
+        return error("Invalid record");
+
+      // The positions are delta encoded.
+      uint64_t CurrentValue = BeginPos;
+      GlobalMetadataBitPosIndex.reserve(Record.size());
+      for (uint64_t Elt : Record) {
+        CurrentValue += Elt;
+        GlobalMetadataBitPosIndex.push_back(CurrentValue);
+      }
+      NumModuleMDStrings = NextMetadataNo;
+
+      // Reserve the IDs of the lazily loaded metadata, so that function-level
+      // metadata gets numbered after them.
+      MetadataList.resize(NumModuleMDStrings +
+                          GlobalMetadataBitPosIndex.size());
+      break;
+    }
+    case bitc::METADATA_NAME:
+      if (!HasIndex)
+        return false;
+      if (std::error_code EC = parseNamedMetadata(IndexCursor, Record))
+        return EC;
+      break;
+    case bitc::METADATA_KIND:
+      if (!HasIndex)
+        return false;
+      if (std::error_code EC = parseMetadataKindRecord(Record))
+        return EC;
+      break;
+    default:
+      // Anything else is either a record the index covers (and that we jumped
+      // over), or means that there is no index at all.
+      if (HasIndex)
+        return error("Invalid record");
+      return false;
+    }
+  }
+}
+
+/// Load the module-level metadata record with the given ID, unless it has
+/// been loaded already. The metadata it references is left as forward
+/// references or placeholders.
+std::error_code
+BitcodeReader::lazyLoadOneMetadata(unsigned ID,
+                                   PlaceholderQueue &Placeholders) {
+  assert(isLazyLoadable(ID) && "Unexpected lazy-loading of metadata");
+  if (auto *MD = MetadataList.lookup(ID)) {
+    auto *N = dyn_cast<MDNode>(MD);
+    if (!N || !N->isTemporary())
+      return std::error_code();
+  }
+
+  IndexCursor.JumpToBit(GlobalMetadataBitPosIndex[ID - NumModuleMDStrings]);
+  BitstreamEntry Entry = IndexCursor.advanceSkippingSubblocks(
+      BitstreamCursor::AF_DontPopBlockAtEnd);
+  if (Entry.Kind != BitstreamEntry::Record)
+    return error("Invalid record");
+
+  ++NumMDRecordLoaded;
+  SmallVector<uint64_t, 64> Record;
+  StringRef Blob;
+  unsigned Code = IndexCursor.readRecord(Entry.ID, Record, &Blob);
+  unsigned NextMetadataNo = ID;
+  if (std::error_code EC =
+          parseOneMetadata(Record, Code, Placeholders, Blob, NextMetadataNo))
+    return EC;
+  if (NextMetadataNo != ID + 1)
+    return error("Invalid record");
+  return std::error_code();
+}
+
+/// Resolve all forward references and placeholders, loading the metadata
+/// they refer to on demand, then resolve cycles.
+std::error_code BitcodeReader::resolveForwardRefsAndPlaceholders(
+    PlaceholderQueue &Placeholders) {
+  if (!GlobalMetadataBitPosIndex.empty()) {
+    DenseSet<unsigned> Temporaries;
+    SmallVector<unsigned, 32> Worklist;
+    while (1) {
+      Placeholders.getTemporaries(MetadataList, Temporaries);
+      for (unsigned ID : MetadataList.getForwardReferences())
+        Temporaries.insert(ID);
+      for (unsigned ID : Temporaries)
+        if (isLazyLoadable(ID))
+          Worklist.push_back(ID);
+      Temporaries.clear();
+      if (Worklist.empty())
+        break;
+
+      // Loading a record can add new forward references and placeholders,
+      // which the next iteration picks up.
+      for (unsigned ID : Worklist)
+        if (std::error_code EC = lazyLoadOneMetadata(ID, Placeholders))
+          return EC;
+      Worklist.clear();
+    }
+  }
+
+  MetadataList.tryToResolveCycles();
+  Placeholders.flush(MetadataList);
+  return std::error_code();
+}
+
+/// Return the metadata with the given ID, creating a forward reference if
+/// necessary. Module-level metadata that is loaded lazily is loaded now, along
+/// with everything it references. Returns nullptr on error.
+Metadata *BitcodeReader::getMetadataFwdRef(unsigned ID) {
+  if (isLazyLoadable(ID)) {
+    PlaceholderQueue Placeholders;
+    if (lazyLoadOneMetadata(ID, Placeholders) ||
+        resolveForwardRefsAndPlaceholders(Placeholders))
+      return nullptr;
+  }
+  return MetadataList.getMetadataFwdRef(ID);
+}
+
 std::error_code BitcodeReader::materializeMetadata() {
   for (uint64_t BitPos : DeferredMetadataInfo) {
     // Move the bit stream to the saved position.
     Stream.JumpToBit(BitPos);
+
+    // Load the module-level metadata lazily if the block has an index.
+    if (!DisableLazyLoading && MetadataList.empty()) {
+      ErrorOr<bool> IsLazy = lazyLoadModuleMetadataBlock();
+      if (std::error_code EC = IsLazy.getError())
+        return EC;
+      if (*IsLazy)
+        continue;
+      MetadataList.clear();
+    }
+
     if (std::error_code EC = parseMetadata(true))
       return EC;
   }
@@ -4179,7 +4493,7 @@ std::error_code BitcodeReader::parseMetadataAttachment(Function &F) {
           auto K = MDKindMap.find(Record[I]);
           if (K == MDKindMap.end())
             return error("Invalid ID");
-          MDNode *MD = MetadataList.getMDNodeFwdRefOrNull(Record[I + 1]);
+          MDNode *MD = getMDNodeFwdRefOrNull(Record[I + 1]);
           if (!MD)
             return error("Invalid metadata attachment");
           F.setMetadata(K->second, MD);
@@ -4195,8 +4509,8 @@ std::error_code BitcodeReader::parseMetadataAttachment(Function &F) {
           MDKindMap.find(Kind);
         if (I == MDKindMap.end())
           return error("Invalid ID");
-        Metadata *Node = MetadataList.getMetadataFwdRef(Record[i + 1]);
-        if (isa<LocalAsMetadata>(Node))
+        Metadata *Node = getMetadataFwdRef(Record[i + 1]);
+        if (Node && isa<LocalAsMetadata>(Node))
           // Drop the attachment.  This used to be legal, but there's no
           // upgrade path.
           break;
@@ -4375,12 +4689,12 @@ std::error_code BitcodeReader::parseFunctionBody(Function *F) {
 
       MDNode *Scope = nullptr, *IA = nullptr;
       if (ScopeID) {
-        Scope = MetadataList.getMDNodeFwdRefOrNull(ScopeID - 1);
+        Scope = getMDNodeFwdRefOrNull(ScopeID - 1);
         if (!Scope)
           return error("Invalid record");
       }
       if (IAID) {
-        IA = MetadataList.getMDNodeFwdRefOrNull(IAID - 1);
+        IA = getMDNodeFwdRefOrNull(IAID - 1);
         if (!IA)
           return error("Invalid record");
       }
@@ -5559,10 +5873,22 @@ std::error_code BitcodeReader::materialize(GlobalValue *GV) {
   if (std::error_code EC = materializeMetadata())
     return EC;
 
-  // Move the bit stream to the saved position of the deferred function body.
-  Stream.JumpToBit(DFII->second);
-
-  if (std::error_code EC = parseFunctionBody(F))
+  // Move the bit stream to the saved position of the deferred function body,
+  // or replay its records if they were read ahead.
+  std::unique_ptr<PrereadFunctionBody> Preread;
+  auto PI = PrereadBodies.find(F);
+  if (PI != PrereadBodies.end()) {
+    Preread = std::move(PI->second);
+    PrereadBodies.erase(PI);
+    Preread->Done.wait();
+    Stream.replay(Preread->Records);
+  } else
+    Stream.JumpToBit(DFII->second);
+
+  std::error_code EC = parseFunctionBody(F);
+  if (Preread)
+    Stream.stopReplaying();
+  if (EC)
     return EC;
   F->setIsMaterializable(false);
 
@@ -5598,9 +5924,14 @@ std::error_code BitcodeReader::materializeModule() {
 
   // Iterate over the module, deserializing any functions that are still on
   // disk.
-  for (Function &F : *TheModule) {
-    if (std::error_code EC = materialize(&F))
+  if (ReaderThreads > 1 && !InMemoryBitcode.empty()) {
+    if (std::error_code EC = materializeFunctionsInParallel())
       return EC;
+  } else {
+    for (Function &F : *TheModule) {
+      if (std::error_code EC = materialize(&F))
+        return EC;
+    }
   }
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
@@ -5640,6 +5971,46 @@ std::error_code BitcodeReader::materializeModule() {
   return std::error_code();
 }
 
+/// Start reading the body of \p F on \p Pool, if its position is known.
+void BitcodeReader::prereadFunctionBody(ThreadPool &Pool, Function *F) {
+  uint64_t BodyBit = DeferredFunctionInfo.lookup(F);
+  if (!F->isMaterializable() || !BodyBit)
+    return;
+
+  // The block info is copied here, since the thread must not share the
+  // abbreviations that Stream uses.
+  auto *Body = new PrereadFunctionBody(InMemoryBitcode);
+  Body->Reader.copyBlockInfo(*StreamFile);
+  PrereadBodies[F].reset(Body);
+  Body->Done = Pool.async([Body, BodyBit]() {
+    Body->Cursor.JumpToBit(BodyBit);
+    Body->Cursor.recordBlock(bitc::FUNCTION_BLOCK_ID, Body->Records);
+  });
+}
+
+/// Materialize all the functions in module order, while threads decode the
+/// bits of the function blocks that come next. Building IR is not thread
+/// safe, so the records are still turned into instructions one function after
+/// the other, as if they were read from the stream.
+std::error_code BitcodeReader::materializeFunctionsInParallel() {
+  ThreadPool Pool(ReaderThreads);
+  // Bound the number of decoded bodies that are waiting to be materialized.
+  const size_t MaxPreread = 4 * ReaderThreads;
+
+  std::error_code EC;
+  auto Next = TheModule->begin(), End = TheModule->end();
+  for (Function &F : *TheModule) {
+    for (; Next != End && PrereadBodies.size() < MaxPreread; ++Next)
+      prereadFunctionBody(Pool, &*Next);
+    if ((EC = materialize(&F)))
+      break;
+  }
+
+  Pool.wait();
+  PrereadBodies.clear();
+  return EC;
+}
+
 std::vector<StructType *> BitcodeReader::getIdentifiedStructTypes() const {
   return IdentifiedStructTypes;
 }
@@ -5666,6 +6037,8 @@ std::error_code BitcodeReader::initStreamFromBuffer() {
 
   StreamFile.reset(new BitstreamReader(BufPtr, BufEnd));
   Stream.init(&*StreamFile);
+  InMemoryBitcode = StringRef(reinterpret_cast<const char *>(BufPtr),
+                              BufEnd - BufPtr);
 
   return std::error_code();
 }
@@ -5997,13 +6370,17 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
       return error("Invalid Summary Block: version expected");
   }
   const uint64_t Version = Record[0];
-  if (Version != 1)
-    return error("Invalid summary version " + Twine(Version) + ", 1 expected");
+  if (Version < 1 || Version > 2)
+    return error("Invalid summary version " + Twine(Version) +
+                 ", 1 or 2 expected");
   Record.clear();
 
   // Keep around the last seen summary to be used when we see an optional
   // "OriginalName" attachement.
   GlobalValueSummary *LastSeenSummary = nullptr;
+  // Keep around the last summary read for the whole-program devirtualization
+  // records that follow it.
+  GlobalValueSummary *LastSummary = nullptr;
   bool Combined = false;
   while (1) {
     BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
@@ -6045,7 +6422,9 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
     //                n x (valueid, callsitecount)]
     // FS_PERMODULE_PROFILE: [valueid, flags, instcount, numrefs,
     //                        numrefs x valueid,
-    //                        n x (valueid, callsitecount, profilecount)]
+    //                        n x (valueid, callsitecount, profilecount,
+    //                             hotness)]
+    // The hotness is only there from version 2 on.
     case bitc::FS_PERMODULE:
     case bitc::FS_PERMODULE_PROFILE: {
       unsigned ValueID = Record[0];
@@ -6072,17 +6451,21 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
         FS->addRefEdge(RefGUID);
       }
       bool HasProfile = (BitCode == bitc::FS_PERMODULE_PROFILE);
+      bool HasHotness = HasProfile && Version >= 2;
       for (unsigned I = CallGraphEdgeStartIndex, E = Record.size(); I != E;
            ++I) {
         unsigned CalleeValueId = Record[I];
         unsigned CallsiteCount = Record[++I];
         uint64_t ProfileCount = HasProfile ? Record[++I] : 0;
+        auto Hotness = HasHotness ? getDecodedHotness(Record[++I])
+                                  : CalleeInfo::HotnessType::Unknown;
         GlobalValue::GUID CalleeGUID = getGUIDFromValueId(CalleeValueId).first;
         FS->addCallGraphEdge(CalleeGUID,
-                             CalleeInfo(CallsiteCount, ProfileCount));
+                             CalleeInfo(CallsiteCount, ProfileCount, Hotness));
       }
       auto GUID = getGUIDFromValueId(ValueID);
       FS->setOriginalName(GUID.second);
+      LastSummary = FS.get();
       TheIndex->addGlobalValueSummary(GUID.first, std::move(FS));
       break;
     }
@@ -6130,6 +6513,7 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
       }
       auto GUID = getGUIDFromValueId(ValueID);
       FS->setOriginalName(GUID.second);
+      LastSummary = FS.get();
       TheIndex->addGlobalValueSummary(GUID.first, std::move(FS));
       break;
     }
@@ -6137,7 +6521,8 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
     //               numrefs x valueid, n x (valueid, callsitecount)]
     // FS_COMBINED_PROFILE: [valueid, modid, flags, instcount, numrefs,
     //                       numrefs x valueid,
-    //                       n x (valueid, callsitecount, profilecount)]
+    //                       n x (valueid, callsitecount, profilecount,
+    //                            hotness)]
     case bitc::FS_COMBINED:
     case bitc::FS_COMBINED_PROFILE: {
       unsigned ValueID = Record[0];
@@ -6148,7 +6533,7 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
       auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
       std::unique_ptr<FunctionSummary> FS =
           llvm::make_unique<FunctionSummary>(Flags, InstCount);
-      LastSeenSummary = FS.get();
+      LastSeenSummary = LastSummary = FS.get();
       FS->setModulePath(ModuleIdMap[ModuleId]);
       static int RefListStartIndex = 5;
       int CallGraphEdgeStartIndex = RefListStartIndex + NumRefs;
@@ -6161,14 +6546,17 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
         FS->addRefEdge(RefGUID);
       }
       bool HasProfile = (BitCode == bitc::FS_COMBINED_PROFILE);
+      bool HasHotness = HasProfile && Version >= 2;
       for (unsigned I = CallGraphEdgeStartIndex, E = Record.size(); I != E;
            ++I) {
         unsigned CalleeValueId = Record[I];
         unsigned CallsiteCount = Record[++I];
         uint64_t ProfileCount = HasProfile ? Record[++I] : 0;
+        auto Hotness = HasHotness ? getDecodedHotness(Record[++I])
+                                  : CalleeInfo::HotnessType::Unknown;
         GlobalValue::GUID CalleeGUID = getGUIDFromValueId(CalleeValueId).first;
         FS->addCallGraphEdge(CalleeGUID,
-                             CalleeInfo(CallsiteCount, ProfileCount));
+                             CalleeInfo(CallsiteCount, ProfileCount, Hotness));
       }
       GlobalValue::GUID GUID = getGUIDFromValueId(ValueID).first;
       TheIndex->addGlobalValueSummary(GUID, std::move(FS));
@@ -6208,7 +6596,7 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
       auto Flags = getDecodedGVSummaryFlags(RawFlags, Version);
       std::unique_ptr<GlobalVarSummary> FS =
           llvm::make_unique<GlobalVarSummary>(Flags);
-      LastSeenSummary = FS.get();
+      LastSeenSummary = LastSummary = FS.get();
       FS->setModulePath(ModuleIdMap[ModuleId]);
       for (unsigned I = 3, E = Record.size(); I != E; ++I) {
         unsigned RefValueId = Record[I];
@@ -6228,6 +6616,42 @@ std::error_code ModuleSummaryIndexBitcodeReader::parseEntireSummary() {
       LastSeenSummary->setOriginalName(OriginalName);
       // Reset the LastSeenSummary
       LastSeenSummary = nullptr;
+      break;
+    }
+    // FS_VCALLS: [n x (typeid, offset)]
+    case bitc::FS_VCALLS: {
+      auto *FS = dyn_cast_or_null<FunctionSummary>(LastSummary);
+      if (!FS || Record.size() % 2)
+        return error("Invalid virtual calls record");
+      for (unsigned I = 0, E = Record.size(); I != E; I += 2)
+        FS->addVCall({Record[I], Record[I + 1]});
+      break;
+    }
+    // FS_VTABLE_TYPES: [n x (typeid, offset)]
+    case bitc::FS_VTABLE_TYPES: {
+      auto *VS = dyn_cast_or_null<GlobalVarSummary>(LastSummary);
+      if (!VS || Record.size() % 2)
+        return error("Invalid vtable types record");
+      for (unsigned I = 0, E = Record.size(); I != E; I += 2)
+        VS->addVTableType({Record[I], Record[I + 1]});
+      break;
+    }
+    // FS_VTABLE_FUNC: [offset, namechar x N]
+    case bitc::FS_VTABLE_FUNC: {
+      auto *VS = dyn_cast_or_null<GlobalVarSummary>(LastSummary);
+      if (!VS || Record.empty())
+        return error("Invalid vtable function record");
+      VS->addVTableFunc(Record[0],
+                        std::string(Record.begin() + 1, Record.end()));
+      break;
+    }
+    // FS_DEVIRT_SINGLE_IMPL: [typeid, offset, namechar x N]
+    case bitc::FS_DEVIRT_SINGLE_IMPL: {
+      if (Record.size() < 3)
+        return error("Invalid single implementation record");
+      TheIndex->addSingleImpl({Record[0], Record[1]},
+                              std::string(Record.begin() + 2, Record.end()));
+      break;
     }
     }
   }
@@ -6552,3 +6976,112 @@ bool llvm::hasGlobalValueSummary(MemoryBufferRef Buffer,
   Buf.release(); // The ModuleSummaryIndexBitcodeReader owns it now.
   return R.foundGlobalValSummary();
 }
+
+static ErrorOr<std::unique_ptr<BitcodeSymbolTable>>
+parseSymtabBlock(BitstreamCursor &Stream) {
+  std::error_code Malformed = make_error_code(BitcodeError::CorruptedBitcode);
+  if (Stream.EnterSubBlock(bitc::SYMTAB_BLOCK_ID))
+    return Malformed;
+
+  auto Symtab = llvm::make_unique<BitcodeSymbolTable>();
+  SmallVector<uint64_t, 64> Record;
+  bool SeenVersion = false;
+  while (1) {
+    BitstreamEntry Entry = Stream.advanceSkippingSubblocks();
+
+    switch (Entry.Kind) {
+    case BitstreamEntry::SubBlock: // Handled for us already.
+    case BitstreamEntry::Error:
+      return Malformed;
+    case BitstreamEntry::EndBlock:
+      if (!SeenVersion)
+        return Malformed;
+      return std::move(Symtab);
+    case BitstreamEntry::Record:
+      // The interesting case.
+      break;
+    }
+
+    Record.clear();
+    switch (Stream.readRecord(Entry.ID, Record)) {
+    default: // Default behavior: ignore unknown content.
+      break;
+    case bitc::SYMTAB_CODE_VERSION: // VERSION: [version#, hasmoduleasm]
+      if (Record.size() < 2)
+        return Malformed;
+      // A table written by a newer producer may not mean what we think it
+      // does; pretend it is not there so that the caller reads the module.
+      if (Record[0] != 1)
+        return nullptr;
+      Symtab->HasModuleAsm = Record[1];
+      SeenVersion = true;
+      break;
+    case bitc::SYMTAB_CODE_COMDAT: { // COMDAT: [selection_kind, strchr x N]
+      if (Record.empty())
+        return Malformed;
+      std::string Name;
+      if (convertToString(Record, 1, Name))
+        return Malformed;
+      Symtab->Comdats.emplace_back(std::move(Name),
+                                   getDecodedComdatSelectionKind(Record[0]));
+      break;
+    }
+    case bitc::SYMTAB_CODE_ENTRY: {
+      // ENTRY: [kind, linkage, visibility, flags, comdat, strchr x N]
+      if (Record.size() < 5 || Record[0] > bitc::SYMTAB_ENTRY_ALIAS ||
+          Record[4] > Symtab->Comdats.size())
+        return Malformed;
+      BitcodeSymbol Sym;
+      if (convertToString(Record, 5, Sym.Name))
+        return Malformed;
+      Sym.Kind = BitcodeSymbol::SymbolKind(Record[0]);
+      Sym.Linkage = getDecodedLinkage(Record[1]);
+      Sym.Visibility = getDecodedVisibility(Record[2]);
+      Sym.IsUndefined = Record[3] & bitc::SYMTAB_FLAG_UNDEFINED;
+      Sym.IsConstant = Record[3] & bitc::SYMTAB_FLAG_CONSTANT;
+      Sym.IsFormatSpecific = Record[3] & bitc::SYMTAB_FLAG_FORMAT_SPECIFIC;
+      Sym.ComdatIndex = int(Record[4]) - 1;
+      Symtab->Symbols.push_back(std::move(Sym));
+      break;
+    }
+    }
+  }
+}
+
+ErrorOr<std::unique_ptr<BitcodeSymbolTable>>
+llvm::readBitcodeSymbolTable(MemoryBufferRef Buffer) {
+  const unsigned char *BufPtr = (const unsigned char *)Buffer.getBufferStart();
+  const unsigned char *BufEnd = BufPtr + Buffer.getBufferSize();
+
+  if (Buffer.getBufferSize() & 3)
+    return make_error_code(BitcodeError::InvalidBitcodeSignature);
+
+  if (isBitcodeWrapper(BufPtr, BufEnd))
+    if (SkipBitcodeWrapperHeader(BufPtr, BufEnd, true))
+      return make_error_code(BitcodeError::InvalidBitcodeSignature);
+
+  BitstreamReader StreamFile(BufPtr, BufEnd);
+  BitstreamCursor Stream(StreamFile);
+  if (!hasValidBitcodeHeader(Stream))
+    return make_error_code(BitcodeError::InvalidBitcodeSignature);
+
+  // The symbol table block, if any, precedes the module block.
+  while (1) {
+    if (Stream.AtEndOfStream())
+      return nullptr;
+
+    BitstreamEntry Entry =
+        Stream.advance(BitstreamCursor::AF_DontAutoprocessAbbrevs);
+    if (Entry.Kind != BitstreamEntry::SubBlock)
+      return make_error_code(BitcodeError::CorruptedBitcode);
+
+    if (Entry.ID == bitc::SYMTAB_BLOCK_ID)
+      return parseSymtabBlock(Stream);
+
+    if (Entry.ID == bitc::MODULE_BLOCK_ID)
+      return nullptr;
+
+    if (Stream.SkipBlock())
+      return make_error_code(BitcodeError::CorruptedBitcode);
+  }
+}
@@ -26,6 +26,14 @@ void BitstreamCursor::freeState() {
 /// EnterSubBlock - Having read the ENTER_SUBBLOCK abbrevid, enter
 /// the block, and return true if the block has an error.
 bool BitstreamCursor::EnterSubBlock(unsigned BlockID, unsigned *NumWordsP) {
+  if (Replay) {
+    if (NumWordsP)
+      *NumWordsP = ReplayDepth ? Replay->Entries[ReplayPos - 1].NumWords
+                               : Replay->NumWords;
+    ++ReplayDepth;
+    return false;
+  }
+
   // Save the current block's state on BlockScope.
   BlockScope.push_back(Block(CurCodeSize));
   BlockScope.back().PrevAbbrevs.swap(CurAbbrevs);
@@ -99,6 +107,9 @@ static void skipAbbreviatedField(BitstreamCursor &Cursor,
 
 /// skipRecord - Read the current record and discard it.
 void BitstreamCursor::skipRecord(unsigned AbbrevID) {
+  if (Replay)
+    return;
+
   // Skip unabbreviated records by reading past their entries.
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
@@ -176,6 +187,9 @@ void BitstreamCursor::skipRecord(unsigned AbbrevID) {
 unsigned BitstreamCursor::readRecord(unsigned AbbrevID,
                                      SmallVectorImpl<uint64_t> &Vals,
                                      StringRef *Blob) {
+  if (Replay)
+    return readReplayedRecord(Vals, Blob);
+
   if (AbbrevID == bitc::UNABBREV_RECORD) {
     unsigned Code = ReadVBR(6);
     unsigned NumElts = ReadVBR(6);
@@ -389,3 +403,98 @@ bool BitstreamCursor::ReadBlockInfoBlock() {
   }
 }
 
+
+//===----------------------------------------------------------------------===//
+//  Recording and replaying blocks
+//===----------------------------------------------------------------------===//
+
+bool BitstreamCursor::recordBlock(unsigned BlockID, BitstreamRecording &R) {
+  typedef BitstreamRecording::Entry Entry;
+  auto addEntry = [&R](decltype(Entry::Kind) Kind, unsigned ID) -> Entry & {
+    R.Entries.push_back(Entry{Kind, ID, 0, 0, 0, false, StringRef()});
+    return R.Entries.back();
+  };
+
+  if (EnterSubBlock(BlockID, &R.NumWords)) {
+    addEntry(BitstreamEntry::Error, 0);
+    return true;
+  }
+
+  // The SubBlock entries of the blocks that are open inside the recorded one.
+  SmallVector<size_t, 8> OpenBlocks;
+  SmallVector<uint64_t, 64> Vals;
+  while (true) {
+    BitstreamEntry E = advance();
+    switch (E.Kind) {
+    case BitstreamEntry::Error:
+      addEntry(BitstreamEntry::Error, 0);
+      return true;
+    case BitstreamEntry::EndBlock:
+      addEntry(BitstreamEntry::EndBlock, 0);
+      if (OpenBlocks.empty()) {
+        R.EndBit = GetCurrentBitNo();
+        return false;
+      }
+      R.Entries[OpenBlocks.pop_back_val()].End = R.Entries.size();
+      break;
+    case BitstreamEntry::SubBlock: {
+      OpenBlocks.push_back(R.Entries.size());
+      Entry &Block = addEntry(BitstreamEntry::SubBlock, E.ID);
+      if (EnterSubBlock(E.ID, &Block.NumWords)) {
+        addEntry(BitstreamEntry::Error, 0);
+        return true;
+      }
+      break;
+    }
+    case BitstreamEntry::Record: {
+      StringRef Blob;
+      Vals.clear();
+      unsigned Code = readRecord(E.ID, Vals, &Blob);
+      Entry &Record = addEntry(BitstreamEntry::Record, Code);
+      Record.Begin = R.Ops.size();
+      R.Ops.insert(R.Ops.end(), Vals.begin(), Vals.end());
+      Record.End = R.Ops.size();
+      Record.HasBlob = Blob.data() != nullptr;
+      Record.Blob = Blob;
+      break;
+    }
+    }
+  }
+}
+
+BitstreamEntry BitstreamCursor::advanceReplay() {
+  const BitstreamRecording::Entry &E = Replay->Entries[ReplayPos++];
+  switch (E.Kind) {
+  case BitstreamEntry::Error:
+    return BitstreamEntry::getError();
+  case BitstreamEntry::EndBlock:
+    // Once the recorded block ends, continue with what follows it.
+    if (--ReplayDepth == 0) {
+      JumpToBit(Replay->EndBit);
+      Replay = nullptr;
+    }
+    return BitstreamEntry::getEndBlock();
+  case BitstreamEntry::SubBlock:
+    return BitstreamEntry::getSubBlock(E.ID);
+  case BitstreamEntry::Record:
+    return BitstreamEntry::getRecord(bitc::UNABBREV_RECORD);
+  }
+  llvm_unreachable("invalid entry kind");
+}
+
+unsigned BitstreamCursor::readReplayedRecord(SmallVectorImpl<uint64_t> &Vals,
+                                             StringRef *Blob) {
+  const BitstreamRecording::Entry &E = Replay->Entries[ReplayPos - 1];
+  assert(E.Kind == BitstreamEntry::Record && "Not at a record");
+  Vals.append(Replay->Ops.begin() + E.Begin, Replay->Ops.begin() + E.End);
+
+  // Blobs are returned as values to clients that do not ask for them, just
+  // like readRecord does.
+  if (E.HasBlob) {
+    if (Blob)
+      *Blob = E.Blob;
+    else
+      Vals.append(E.Blob.bytes_begin(), E.Blob.bytes_end());
+  }
+  return E.ID;
+}
@@ -24,19 +24,37 @@
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Mangler.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cctype>
 #include <map>
 using namespace llvm;
 
+static cl::opt<unsigned>
+    IndexThreshold("bitcode-mdindex-threshold", cl::Hidden, cl::init(25),
+                   cl::desc("Number of metadatas above which we emit an index "
+                            "to enable lazy-loading"));
+
+static cl::opt<bool>
+    WriteSymtab("bitcode-write-symtab", cl::Hidden, cl::init(false),
+                cl::desc("Emit a symbol table block so that tools can list "
+                         "the module's symbols without parsing the IR"));
+
+static cl::opt<unsigned> WriterThreads(
+    "bitcode-writer-threads", cl::Hidden, cl::init(0),
+    cl::desc("Number of threads used to encode function blocks (the output "
+             "does not depend on it); 0 or 1 writes them serially"));
+
 namespace {
 /// These are manifest constants used by the bitcode writer. They do not need to
 /// be kept in sync with the reader, but need to be consistent within this file.
@@ -85,6 +103,11 @@ public:
   BitcodeWriter(SmallVectorImpl<char> &Buffer)
       : Buffer(Buffer), Stream(Buffer) {}
 
+  /// Constructs a BitcodeWriter whose stream continues the block that \p
+  /// Parent is in, writing to the provided \p Buffer.
+  BitcodeWriter(SmallVectorImpl<char> &Buffer, const BitstreamWriter &Parent)
+      : Buffer(Buffer), Stream(Buffer, Parent) {}
+
   virtual ~BitcodeWriter() = default;
 
   /// Main entry point to write the bitcode file, which writes the bitcode
@@ -135,6 +158,13 @@ public:
   }
 
 private:
+  /// Constructs a writer for function blocks that are encoded separately from
+  /// \p Parent's stream, into \p Buffer, and appended to it afterwards.
+  ModuleBitcodeWriter(const ModuleBitcodeWriter &Parent,
+                      SmallVectorImpl<char> &Buffer)
+      : BitcodeWriter(Buffer, Parent.Stream), M(Parent.M), VE(Parent.VE),
+        Index(nullptr), GenerateHash(false) {}
+
   /// Main entry point for writing a module to bitcode, invoked by
   /// BitcodeWriter::write() after it writes the header.
   void writeBlocks() override;
@@ -143,6 +173,10 @@ private:
   /// current llvm version, and a record for the epoch number.
   void writeIdentificationBlock();
 
+  /// Create the "SYMTAB_BLOCK_ID" block describing the global values of the
+  /// module, for use by tools that only need to enumerate its symbols.
+  void writeSymtab();
+
   /// Emit the current module to the bitstream.
   void writeModule();
 
@@ -220,7 +254,8 @@ private:
   void writeMetadataStrings(ArrayRef<const Metadata *> Strings,
                             SmallVectorImpl<uint64_t> &Record);
   void writeMetadataRecords(ArrayRef<const Metadata *> MDs,
-                            SmallVectorImpl<uint64_t> &Record);
+                            SmallVectorImpl<uint64_t> &Record,
+                            std::vector<uint64_t> *IndexPos = nullptr);
   void writeModuleMetadata();
   void writeFunctionMetadata(const Function &F);
   void writeMetadataAttachment(const Function &F);
@@ -245,6 +280,8 @@ private:
   void
   writeFunction(const Function &F,
                 DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
+  void writeFunctions(
+      DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex);
   void writeBlockInfo();
   void writePerModuleFunctionSummaryRecord(SmallVector<uint64_t, 64> &NameVals,
                                            GlobalValueSummary *Summary,
@@ -1781,8 +1818,12 @@ void ModuleBitcodeWriter::writeMetadataStrings(
   Record.clear();
 }
 
+/// Write out the records for MDs. If IndexPos is given, the bit position of
+/// each record is appended to it, and the abbreviations are emitted before the
+/// first record so that a reader can jump straight to any of the records.
 void ModuleBitcodeWriter::writeMetadataRecords(
-    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record) {
+    ArrayRef<const Metadata *> MDs, SmallVectorImpl<uint64_t> &Record,
+    std::vector<uint64_t> *IndexPos) {
   if (MDs.empty())
     return;
 
@@ -1790,7 +1831,14 @@ void ModuleBitcodeWriter::writeMetadataRecords(
 #define HANDLE_MDNODE_LEAF(CLASS) unsigned CLASS##Abbrev = 0;
 #include "llvm/IR/Metadata.def"
 
+  if (IndexPos) {
+    DILocationAbbrev = createDILocationAbbrev();
+    GenericDINodeAbbrev = createGenericDINodeAbbrev();
+  }
+
   for (const Metadata *MD : MDs) {
+    if (IndexPos)
+      IndexPos->push_back(Stream.GetCurrentBitNo());
     if (const MDNode *N = dyn_cast<MDNode>(MD)) {
       assert(N->isResolved() && "Expected forward references to be resolved");
 
@@ -1812,12 +1860,68 @@ void ModuleBitcodeWriter::writeModuleMetadata() {
   if (!VE.hasMDs() && M.named_metadata_empty())
     return;
 
-  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, 3);
+  // We only emit an index for the metadata records if there are more than a
+  // given (naive) threshold of them, otherwise it is not worth it. The index
+  // needs abbreviations of its own, hence the wider abbreviation IDs.
+  bool EmitIndex = VE.getNonMDStrings().size() > IndexThreshold;
+  Stream.EnterSubblock(bitc::METADATA_BLOCK_ID, EmitIndex ? 4 : 3);
   SmallVector<uint64_t, 64> Record;
   writeMetadataStrings(VE.getMDStrings(), Record);
-  writeMetadataRecords(VE.getNonMDStrings(), Record);
+
+  if (!EmitIndex) {
+    writeMetadataRecords(VE.getNonMDStrings(), Record);
+    writeNamedMetadata(Record);
+    Stream.ExitBlock();
+    return;
+  }
+
+  // Write a placeholder for the offset to the index, which is emitted after
+  // the records so that it can hold the position of each of them. Use fixed
+  // width fields as we don't know how many VBR chunks to reserve ahead of
+  // time.
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX_OFFSET));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 32));
+  unsigned OffsetAbbrev = Stream.EmitAbbrev(Abbv);
+
+  Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::METADATA_INDEX));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));
+  unsigned IndexAbbrev = Stream.EmitAbbrev(Abbv);
+
+  uint64_t Vals[] = {bitc::METADATA_INDEX_OFFSET, 0, 0};
+  Stream.EmitRecordWithAbbrev(OffsetAbbrev, Vals);
+
+  // The offset and the positions in the index are relative to the end of the
+  // placeholder record.
+  uint64_t IndexOffsetRecordBitPos = Stream.GetCurrentBitNo();
+
+  std::vector<uint64_t> IndexPos;
+  IndexPos.reserve(VE.getNonMDStrings().size());
+  writeMetadataRecords(VE.getNonMDStrings(), Record, &IndexPos);
+
+  uint64_t IndexOffset = Stream.GetCurrentBitNo() - IndexOffsetRecordBitPos;
+
+  // Delta encode the index.
+  uint64_t PreviousValue = IndexOffsetRecordBitPos;
+  for (uint64_t &Elt : IndexPos) {
+    uint64_t EltDelta = Elt - PreviousValue;
+    PreviousValue = Elt;
+    Elt = EltDelta;
+  }
+  Stream.EmitRecord(bitc::METADATA_INDEX, IndexPos, IndexAbbrev);
+  IndexPos.clear();
+
   writeNamedMetadata(Record);
   Stream.ExitBlock();
+
+  // Now that the placeholder has certainly been flushed to the buffer,
+  // backpatch the offset to the index so that the reader can skip the records.
+  Stream.BackpatchWord(IndexOffsetRecordBitPos - 64, uint32_t(IndexOffset));
+  Stream.BackpatchWord(IndexOffsetRecordBitPos - 32,
+                       uint32_t(IndexOffset >> 32));
 }
 
 void ModuleBitcodeWriter::writeFunctionMetadata(const Function &F) {
@@ -2901,6 +3005,64 @@ void ModuleBitcodeWriter::writeFunction(
   Stream.ExitBlock();
 }
 
+/// Emit the bodies of all the defined functions, in module order. With
+/// -bitcode-writer-threads they are encoded into separate buffers on a thread
+/// pool and concatenated, which produces the same bits as writing them one by
+/// one: function blocks only depend on the module-level enumeration, and every
+/// block but the first starts at a 32-bit boundary.
+void ModuleBitcodeWriter::writeFunctions(
+    DenseMap<const Function *, uint64_t> &FunctionToBitcodeIndex) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration())
+      Functions.push_back(&F);
+
+  // Use-list orders are predicted for the whole module up front and consumed
+  // as the functions are written, so they have to be written in sequence.
+  unsigned NumThreads = std::min<size_t>(WriterThreads, Functions.size());
+  if (NumThreads <= 1 || VE.shouldPreserveUseListOrder()) {
+    for (const Function *F : Functions)
+      writeFunction(*F, FunctionToBitcodeIndex);
+    return;
+  }
+
+  // The first block may start anywhere in a word, so write it here.
+  writeFunction(*Functions.front(), FunctionToBitcodeIndex);
+  ArrayRef<const Function *> Rest = makeArrayRef(Functions).slice(1);
+
+  // Give every thread a contiguous range of functions and its own copy of the
+  // writer state; the copies are made here, as the abbreviations they start
+  // from are not thread safe.
+  struct Chunk {
+    ArrayRef<const Function *> Functions;
+    SmallVector<char, 0> Buffer;
+    std::unique_ptr<ModuleBitcodeWriter> Writer;
+    DenseMap<const Function *, uint64_t> Offsets;
+  };
+  size_t ChunkSize = (Rest.size() + NumThreads - 1) / NumThreads;
+  std::vector<Chunk> Chunks((Rest.size() + ChunkSize - 1) / ChunkSize);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned I = 0, E = Chunks.size(); I != E; ++I) {
+      Chunk &C = Chunks[I];
+      C.Functions = Rest.slice(I * ChunkSize,
+                               std::min(ChunkSize, Rest.size() - I * ChunkSize));
+      C.Writer.reset(new ModuleBitcodeWriter(*this, C.Buffer));
+      Pool.async([&C]() {
+        for (const Function *F : C.Functions)
+          C.Writer->writeFunction(*F, C.Offsets);
+      });
+    }
+  }
+
+  for (Chunk &C : Chunks) {
+    uint64_t StartBit = Stream.GetCurrentBitNo();
+    for (const Function *F : C.Functions)
+      FunctionToBitcodeIndex[F] = StartBit + C.Offsets[F];
+    Stream.appendAlignedWords(C.Buffer);
+  }
+}
+
 // Emit blockinfo, which defines the standard abbreviations etc.
 void ModuleBitcodeWriter::writeBlockInfo() {
   // We only want to emit block info records for blocks that have multiple
@@ -3157,6 +3319,40 @@ void IndexBitcodeWriter::writeModStrings() {
 }
 
 // Helper to emit a single function summary record.
+/// Emit the records for whole-program devirtualization that describe \p S,
+/// right after its summary record.
+static void writeDevirtRecords(BitstreamWriter &Stream,
+                               const GlobalValueSummary &S,
+                               SmallVector<uint64_t, 64> &NameVals) {
+  if (auto *FS = dyn_cast<FunctionSummary>(&S)) {
+    for (const TypeIdOffset &VCall : FS->vcalls()) {
+      NameVals.push_back(VCall.TypeID);
+      NameVals.push_back(VCall.Offset);
+    }
+    if (!NameVals.empty())
+      Stream.EmitRecord(bitc::FS_VCALLS, NameVals);
+    NameVals.clear();
+    return;
+  }
+
+  auto *VS = dyn_cast<GlobalVarSummary>(&S);
+  if (!VS)
+    return;
+  for (const TypeIdOffset &Type : VS->vtableTypes()) {
+    NameVals.push_back(Type.TypeID);
+    NameVals.push_back(Type.Offset);
+  }
+  if (!NameVals.empty())
+    Stream.EmitRecord(bitc::FS_VTABLE_TYPES, NameVals);
+  NameVals.clear();
+  for (const GlobalVarSummary::VTableFuncTy &Func : VS->vtableFuncs()) {
+    NameVals.push_back(Func.first);
+    NameVals.append(Func.second.begin(), Func.second.end());
+    Stream.EmitRecord(bitc::FS_VTABLE_FUNC, NameVals);
+    NameVals.clear();
+  }
+}
+
 void ModuleBitcodeWriter::writePerModuleFunctionSummaryRecord(
     SmallVector<uint64_t, 64> &NameVals, GlobalValueSummary *Summary,
     unsigned ValueID, unsigned FSCallsAbbrev, unsigned FSCallsProfileAbbrev,
@@ -3187,8 +3383,10 @@ void ModuleBitcodeWriter::writePerModuleFunctionSummaryRecord(
     NameVals.push_back(VE.getValueID(ECI.first.getValue()));
     assert(ECI.second.CallsiteCount > 0 && "Expected at least one callsite");
     NameVals.push_back(ECI.second.CallsiteCount);
-    if (HasProfileData)
+    if (HasProfileData) {
       NameVals.push_back(ECI.second.ProfileCount);
+      NameVals.push_back(uint64_t(ECI.second.Hotness));
+    }
   }
 
   unsigned FSAbbrev = (HasProfileData ? FSCallsProfileAbbrev : FSCallsAbbrev);
@@ -3198,6 +3396,7 @@ void ModuleBitcodeWriter::writePerModuleFunctionSummaryRecord(
   // Emit the finished record.
   Stream.EmitRecord(Code, NameVals, FSAbbrev);
   NameVals.clear();
+  writeDevirtRecords(Stream, *FS, NameVals);
 }
 
 // Collect the global value references in the given variable's initializer,
@@ -3223,12 +3422,13 @@ void ModuleBitcodeWriter::writeModuleLevelReferences(
   Stream.EmitRecord(bitc::FS_PERMODULE_GLOBALVAR_INIT_REFS, NameVals,
                     FSModRefsAbbrev);
   NameVals.clear();
+  writeDevirtRecords(Stream, *VS, NameVals);
 }
 
 // Current version for the summary.
 // This is bumped whenever we introduce changes in the way some record are
 // interpreted, like flags for instance.
-static const uint64_t INDEX_VERSION = 1;
+static const uint64_t INDEX_VERSION = 2;
 
 /// Emit the per-module summary section alongside the rest of
 /// the module's bitcode.
@@ -3262,7 +3462,7 @@ void ModuleBitcodeWriter::writePerModuleGlobalValueSummary() {
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // flags
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));   // instcount
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4));   // numrefs
-  // numrefs x valueid, n x (valueid, callsitecount, profilecount)
+  // numrefs x valueid, n x (valueid, callsitecount, profilecount, hotness)
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
   unsigned FSCallsProfileAbbrev = Stream.EmitAbbrev(Abbv);
@@ -3348,7 +3548,7 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // flags
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));   // instcount
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 4));   // numrefs
-  // numrefs x valueid, n x (valueid, callsitecount, profilecount)
+  // numrefs x valueid, n x (valueid, callsitecount, profilecount, hotness)
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
   Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));
   unsigned FSCallsProfileAbbrev = Stream.EmitAbbrev(Abbv);
@@ -3419,6 +3619,7 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
                         FSModRefsAbbrev);
       NameVals.clear();
       MaybeEmitOriginalName(*S);
+      writeDevirtRecords(Stream, *S, NameVals);
       continue;
     }
 
@@ -3435,7 +3636,8 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
 
     bool HasProfileData = false;
     for (auto &EI : FS->calls()) {
-      HasProfileData |= EI.second.ProfileCount != 0;
+      HasProfileData |= EI.second.ProfileCount != 0 ||
+                        EI.second.Hotness != CalleeInfo::HotnessType::Unknown;
       if (HasProfileData)
         break;
     }
@@ -3448,8 +3650,10 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
       NameVals.push_back(getValueId(EI.first.getGUID()));
       assert(EI.second.CallsiteCount > 0 && "Expected at least one callsite");
       NameVals.push_back(EI.second.CallsiteCount);
-      if (HasProfileData)
+      if (HasProfileData) {
         NameVals.push_back(EI.second.ProfileCount);
+        NameVals.push_back(uint64_t(EI.second.Hotness));
+      }
     }
 
     unsigned FSAbbrev = (HasProfileData ? FSCallsProfileAbbrev : FSCallsAbbrev);
@@ -3460,6 +3664,7 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
     Stream.EmitRecord(Code, NameVals, FSAbbrev);
     NameVals.clear();
     MaybeEmitOriginalName(*S);
+    writeDevirtRecords(Stream, *S, NameVals);
   }
 
   for (auto *AS : Aliases) {
@@ -3478,6 +3683,15 @@ void IndexBitcodeWriter::writeCombinedGlobalValueSummary() {
     MaybeEmitOriginalName(*AS);
   }
 
+  // The virtual calls that the thin link devirtualized.
+  for (const auto &SingleImpl : Index.singleImpls()) {
+    NameVals.push_back(SingleImpl.first.TypeID);
+    NameVals.push_back(SingleImpl.first.Offset);
+    NameVals.append(SingleImpl.second.begin(), SingleImpl.second.end());
+    Stream.EmitRecord(bitc::FS_DEVIRT_SINGLE_IMPL, NameVals);
+    NameVals.clear();
+  }
+
   Stream.ExitBlock();
 }
 
@@ -3503,6 +3717,84 @@ void ModuleBitcodeWriter::writeIdentificationBlock() {
   Stream.ExitBlock();
 }
 
+void ModuleBitcodeWriter::writeSymtab() {
+  Stream.EnterSubblock(bitc::SYMTAB_BLOCK_ID, 3);
+
+  // SYMTAB_CODE_VERSION: [version#, hasmoduleasm]
+  SmallVector<uint64_t, 64> Vals;
+  unsigned CurVersion = 1;
+  Vals.push_back(CurVersion);
+  Vals.push_back(!M.getModuleInlineAsm().empty());
+  Stream.EmitRecord(bitc::SYMTAB_CODE_VERSION, Vals);
+  Vals.clear();
+
+  BitCodeAbbrev *Abbv = new BitCodeAbbrev();
+  Abbv->Add(BitCodeAbbrevOp(bitc::SYMTAB_CODE_ENTRY));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 2)); // kind
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // linkage
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 2)); // visibility
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 3)); // flags
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // comdat
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Array));
+  Abbv->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 8));
+  unsigned EntryAbbrev = Stream.EmitAbbrev(Abbv);
+
+  // COMDAT: [selection_kind, strchr x N]
+  for (const Comdat *C : VE.getComdats()) {
+    Vals.push_back(getEncodedComdatSelectionKind(*C));
+    for (char Chr : C->getName())
+      Vals.push_back((unsigned char)Chr);
+    Stream.EmitRecord(bitc::SYMTAB_CODE_COMDAT, Vals);
+    Vals.clear();
+  }
+
+  // ENTRY: [kind, linkage, visibility, flags, comdat, strchr x N]
+  // Entries are listed in the same order IRObjectFile enumerates symbols:
+  // functions, then variables, then aliases. The name is the one the symbol
+  // will have in the object file.
+  Mangler Mang;
+  SmallString<64> Name;
+  auto WriteEntry = [&](const GlobalValue &GV, unsigned Kind) {
+    unsigned Flags = 0;
+    if (GV.isDeclarationForLinker())
+      Flags |= bitc::SYMTAB_FLAG_UNDEFINED;
+    if (auto *GVar = dyn_cast<GlobalVariable>(&GV)) {
+      if (GVar->isConstant())
+        Flags |= bitc::SYMTAB_FLAG_CONSTANT;
+      if (GVar->getSection() == "llvm.metadata")
+        Flags |= bitc::SYMTAB_FLAG_FORMAT_SPECIFIC;
+    }
+    if (GV.hasPrivateLinkage() || GV.getName().startswith("llvm."))
+      Flags |= bitc::SYMTAB_FLAG_FORMAT_SPECIFIC;
+
+    Vals.push_back(Kind);
+    Vals.push_back(getEncodedLinkage(GV));
+    Vals.push_back(getEncodedVisibility(GV));
+    Vals.push_back(Flags);
+    Vals.push_back(GV.hasComdat() ? VE.getComdatID(GV.getComdat()) : 0);
+
+    Name.clear();
+    raw_svector_ostream OS(Name);
+    if (GV.hasDLLImportStorageClass())
+      OS << "__imp_";
+    Mang.getNameWithPrefix(OS, &GV, false);
+    for (char Chr : Name)
+      Vals.push_back((unsigned char)Chr);
+
+    Stream.EmitRecord(bitc::SYMTAB_CODE_ENTRY, Vals, EntryAbbrev);
+    Vals.clear();
+  };
+
+  for (const Function &F : M)
+    WriteEntry(F, bitc::SYMTAB_ENTRY_FUNCTION);
+  for (const GlobalVariable &GV : M.globals())
+    WriteEntry(GV, bitc::SYMTAB_ENTRY_VARIABLE);
+  for (const GlobalAlias &A : M.aliases())
+    WriteEntry(A, bitc::SYMTAB_ENTRY_ALIAS);
+
+  Stream.ExitBlock();
+}
+
 void ModuleBitcodeWriter::writeModuleHash(size_t BlockStartPos) {
   // Emit the module's hash.
   // MODULE_CODE_HASH: [5*i32]
@@ -3533,6 +3825,8 @@ void BitcodeWriter::write() {
 
 void ModuleBitcodeWriter::writeBlocks() {
   writeIdentificationBlock();
+  if (WriteSymtab)
+    writeSymtab();
   writeModule();
 }
 
@@ -3585,9 +3879,7 @@ void ModuleBitcodeWriter::writeModule() {
 
   // Emit function bodies.
   DenseMap<const Function *, uint64_t> FunctionToBitcodeIndex;
-  for (Module::const_iterator F = M.begin(), E = M.end(); F != E; ++F)
-    if (!F->isDeclaration())
-      writeFunction(*F, FunctionToBitcodeIndex);
+  writeFunctions(FunctionToBitcodeIndex);
 
   // Need to write after the above call to WriteFunction which populates
   // the summary information in the index.
@@ -108,6 +108,38 @@ void DIEAbbrev::print(raw_ostream &O) {
 LLVM_DUMP_METHOD
 void DIEAbbrev::dump() { print(dbgs()); }
 
+//===----------------------------------------------------------------------===//
+// DIEValueList Implementation
+//===----------------------------------------------------------------------===//
+
+DIEValueList::value_iterator DIEValueList::addValue(BumpPtrAllocator &Alloc,
+                                                    DIEValue V) {
+  if (!Last ||
+      !Alloc.tryGrowInPlace(Last, sizeof(Chunk) + Last->Size * sizeof(DIEValue),
+                            sizeof(Chunk) +
+                                (Last->Size + 1) * sizeof(DIEValue))) {
+    // Start a new array after the last one.
+    Chunk *New = static_cast<Chunk *>(Alloc.Allocate(
+        sizeof(Chunk) + sizeof(DIEValue), AlignOf<Chunk>::Alignment));
+    New->Size = 0;
+    New->IsLast = true;
+    if (Last) {
+      New->Next = Last->Next;
+      Last->Next = New;
+      Last->IsLast = false;
+    } else {
+      New->Next = New;
+    }
+    Last = New;
+  }
+  new (&Last->values()[Last->Size]) DIEValue(V);
+  return value_iterator(Last, Last->Size++);
+}
+
+//===----------------------------------------------------------------------===//
+// DIE Implementation
+//===----------------------------------------------------------------------===//
+
 DIEAbbrev DIE::generateAbbrev() const {
   DIEAbbrev Abbrev(Tag, hasChildren());
   for (const DIEValue &V : values())
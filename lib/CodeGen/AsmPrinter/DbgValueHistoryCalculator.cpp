@@ -190,6 +190,8 @@ void llvm::calculateDbgValueHistory(const MachineFunction *MF,
       if (!MI.isDebugValue()) {
         // Not a DBG_VALUE instruction. It may clobber registers which describe
         // some variables.
+        if (RegVars.empty())
+          continue;
         for (const MachineOperand &MO : MI.operands()) {
           if (MO.isReg() && MO.isDef() && MO.getReg()) {
             // If this is a register def operand, it may end a debug value
@@ -200,14 +202,15 @@ void llvm::calculateDbgValueHistory(const MachineFunction *MF,
                 clobberRegisterUses(RegVars, *AI, Result, MI);
           } else if (MO.isRegMask()) {
             // If this is a register mask operand, clobber all debug values in
-            // non-CSRs.
-            for (int I = ChangingRegs.find_first(); I != -1;
-                 I = ChangingRegs.find_next(I)) {
+            // non-CSRs. Only the registers that describe variables are
+            // visited, as calls are frequent and there are many registers.
+            for (auto I = RegVars.begin(), E = RegVars.end(); I != E;) {
+              auto CurElem = I++; // CurElem can be erased below.
+              unsigned Reg = CurElem->first;
               // Don't consider SP to be clobbered by register masks.
-              if (unsigned(I) != SP && TRI->isPhysicalRegister(I) &&
-                  MO.clobbersPhysReg(I)) {
-                clobberRegisterUses(RegVars, I, Result, MI);
-              }
+              if (Reg != SP && TRI->isPhysicalRegister(Reg) &&
+                  ChangingRegs.test(Reg) && MO.clobbersPhysReg(Reg))
+                clobberRegisterUses(RegVars, CurElem, Result, MI);
             }
           }
         }
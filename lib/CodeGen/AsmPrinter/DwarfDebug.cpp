@@ -58,6 +58,8 @@ using namespace llvm;
 
 #define DEBUG_TYPE "dwarfdebug"
 
+STATISTIC(NumDIEBytes, "Number of bytes allocated for DIEs and their values");
+
 static cl::opt<bool>
 DisableDebugInfoPrinting("disable-debug-info-print", cl::Hidden,
                          cl::desc("Disable debug info printing"));
@@ -670,6 +672,8 @@ void DwarfDebug::endModule() {
     emitDebugPubTypes(GenerateGnuPubSections);
   }
 
+  NumDIEBytes += DIEValueAllocator.getBytesAllocated();
+
   // clean up.
   AbstractVariables.clear();
 }
@@ -15,6 +15,7 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/Support/LEB128.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Target/TargetLoweringObjectFile.h"
 
 namespace llvm {
@@ -72,20 +73,43 @@ void DwarfFile::emitUnit(DwarfUnit *TheU, bool UseOffsets) {
   Asm->emitDwarfDIE(Die);
 }
 
+void DwarfFile::assignAbbrevNumbers(DIE &Die) {
+  const DIEAbbrev &Abbrev = assignAbbrevNumber(Die);
+  (void)Abbrev;
+  assert(Abbrev.hasChildren() == Die.hasChildren() &&
+         "Children flag not set");
+  for (auto &Child : Die.children())
+    assignAbbrevNumbers(Child);
+}
+
 // Compute the size and offset for each DIE.
 void DwarfFile::computeSizeAndOffsets() {
+  // Number the abbreviations in the order of the units, so that they do not
+  // depend on the threads sizing the units.
+  for (const auto &TheU : CUs)
+    assignAbbrevNumbers(TheU->getUnitDie());
+
+  // All the offsets within a unit are relative to the unit, so the units are
+  // sized independently of each other.
+  SmallVector<unsigned, 8> Sizes(CUs.size());
+  parallel_for_each_n(size_t(0), CUs.size(), [&](size_t I) {
+    Sizes[I] = computeSizeAndOffsetsForUnitDIEs(CUs[I].get());
+  });
+
   // Offset from the first CU in the debug info section is 0 initially.
   unsigned SecOffset = 0;
-
-  // Iterate over each compile unit and set the size and offsets for each
-  // DIE within each compile unit. All offsets are CU relative.
-  for (const auto &TheU : CUs) {
-    TheU->setDebugInfoOffset(SecOffset);
-    SecOffset += computeSizeAndOffsetsForUnit(TheU.get());
+  for (unsigned I = 0, E = CUs.size(); I != E; ++I) {
+    CUs[I]->setDebugInfoOffset(SecOffset);
+    SecOffset += Sizes[I];
   }
 }
 
 unsigned DwarfFile::computeSizeAndOffsetsForUnit(DwarfUnit *TheU) {
+  assignAbbrevNumbers(TheU->getUnitDie());
+  return computeSizeAndOffsetsForUnitDIEs(TheU);
+}
+
+unsigned DwarfFile::computeSizeAndOffsetsForUnitDIEs(DwarfUnit *TheU) const {
   // CU-relative offset is reset to 0 here.
   unsigned Offset = sizeof(int32_t) +      // Length of Unit Info
                     TheU->getHeaderSize(); // Unit-specific headers
@@ -97,10 +121,7 @@ unsigned DwarfFile::computeSizeAndOffsetsForUnit(DwarfUnit *TheU) {
 
 // Compute the size and offset of a DIE. The offset is relative to start of the
 // CU. It returns the offset after laying out the DIE.
-unsigned DwarfFile::computeSizeAndOffset(DIE &Die, unsigned Offset) {
-  // Record the abbreviation.
-  const DIEAbbrev &Abbrev = assignAbbrevNumber(Die);
-
+unsigned DwarfFile::computeSizeAndOffset(DIE &Die, unsigned Offset) const {
   // Set DIE offset
   Die.setOffset(Offset);
 
@@ -114,9 +135,6 @@ unsigned DwarfFile::computeSizeAndOffset(DIE &Die, unsigned Offset) {
 
   // Size the DIE children if any.
   if (Die.hasChildren()) {
-    (void)Abbrev;
-    assert(Abbrev.hasChildren() && "Children flag not set");
-
     for (auto &Child : Die.children())
       Offset = computeSizeAndOffset(Child, Offset);
 
@@ -72,15 +72,26 @@ public:
   }
 
   /// \brief Compute the size and offset of a DIE given an incoming Offset.
-  unsigned computeSizeAndOffset(DIE &Die, unsigned Offset);
+  /// The abbreviations of the DIE and its children must be assigned already.
+  /// This only modifies the DIEs, so it can be done for several units at once.
+  unsigned computeSizeAndOffset(DIE &Die, unsigned Offset) const;
 
-  /// \brief Compute the size and offset of all the DIEs.
+  /// \brief Compute the size and offset of all the DIEs. The units are sized
+  /// in parallel.
   void computeSizeAndOffsets();
 
   /// \brief Compute the size and offset of all the DIEs in the given unit.
   /// \returns The size of the root DIE.
   unsigned computeSizeAndOffsetsForUnit(DwarfUnit *TheU);
 
+  /// \brief Compute the size and offset of all the DIEs in the given unit,
+  /// whose abbreviations are assigned already.
+  /// \returns The size of the root DIE.
+  unsigned computeSizeAndOffsetsForUnitDIEs(DwarfUnit *TheU) const;
+
+  /// Assign the abbreviation numbers of a DIE and of its children.
+  void assignAbbrevNumbers(DIE &Die);
+
   /// Define a unique number for the abbreviation.
   ///
   /// Compute the abbreviation for \c Die, look up its unique number, and
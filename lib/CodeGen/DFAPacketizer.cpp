@@ -21,6 +21,10 @@
 // transition exists from the corresponding state. Invalid transitions
 // indicate that the instruction cannot be added to the current packet.
 //
+// The transitions are read directly from the flat tables the
+// DFAPacketizerEmitter generates, where the transitions out of each state are
+// sorted by input.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/DFAPacketizer.h"
@@ -28,10 +32,17 @@
 #include "llvm/CodeGen/MachineInstrBundle.h"
 #include "llvm/CodeGen/ScheduleDAGInstrs.h"
 #include "llvm/MC/MCInstrItineraries.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Target/TargetInstrInfo.h"
+#include <algorithm>
 
 using namespace llvm;
 
+static cl::opt<unsigned> PacketizerWindow("dfa-packetizer-window",
+  cl::init(0), cl::Hidden, cl::ZeroOrMore,
+  cl::desc("Packetize at most this many instructions per dependence graph; "
+           "bounds compile time on very large blocks (0 = unlimited)"));
+
 // --------------------------------------------------------------------
 // Definitions shared between DFAPacketizer.cpp and DFAPacketizerEmitter.cpp
 
@@ -58,7 +69,7 @@ DFAPacketizer::DFAPacketizer(const InstrItineraryData *I,
                              const DFAStateInput (*SIT)[2],
                              const unsigned *SET):
   InstrItins(I), CurrentState(0), DFAStateInputTable(SIT),
-  DFAStateEntryTable(SET) {
+  DFAStateEntryTable(SET), LastState(-1), LastInput(0), LastNextState(-1) {
   // Make sure DFA types are large enough for the number of terms & resources.
   static_assert((DFA_MAX_RESTERMS * DFA_MAX_RESOURCES) <=
                     (8 * sizeof(DFAInput)),
@@ -69,25 +80,31 @@ DFAPacketizer::DFAPacketizer(const InstrItineraryData *I,
 }
 
 
-// Read the DFA transition table and update CachedTable.
+// Look up a transition in the DFA transition table.
 //
 // Format of the transition tables:
 // DFAStateInputTable[][2] = pairs of <Input, Transition> for all valid
-//                           transitions
+//                           transitions, sorted by Input for each state
 // DFAStateEntryTable[i] = Index of the first entry in DFAStateInputTable
 //                         for the ith state
 //
-void DFAPacketizer::ReadTable(unsigned int state) {
-  unsigned ThisState = DFAStateEntryTable[state];
-  unsigned NextStateInTable = DFAStateEntryTable[state+1];
-  // Early exit in case CachedTable has already contains this
-  // state's transitions.
-  if (CachedTable.count(UnsignPair(state, DFAStateInputTable[ThisState][0])))
-    return;
-
-  for (unsigned i = ThisState; i < NextStateInTable; i++)
-    CachedTable[UnsignPair(state, DFAStateInputTable[i][0])] =
-      DFAStateInputTable[i][1];
+int DFAPacketizer::getNextState(int State, DFAInput Input) {
+  if (State == LastState && Input == LastInput)
+    return LastNextState;
+
+  const DFAStateInput (*Begin)[2] =
+      DFAStateInputTable + DFAStateEntryTable[State];
+  const DFAStateInput (*End)[2] =
+      DFAStateInputTable + DFAStateEntryTable[State + 1];
+  auto I = std::lower_bound(Begin, End, Input,
+                            [](const DFAStateInput (&Entry)[2], DFAInput In) {
+                              return DFAInput(Entry[0]) < In;
+                            });
+
+  LastState = State;
+  LastInput = Input;
+  LastNextState = (I != End && DFAInput((*I)[0]) == Input) ? (*I)[1] : -1;
+  return LastNextState;
 }
 
 
@@ -117,9 +134,7 @@ DFAInput DFAPacketizer::getInsnInput(const std::vector<unsigned> &InsnClass) {
 bool DFAPacketizer::canReserveResources(const llvm::MCInstrDesc *MID) {
   unsigned InsnClass = MID->getSchedClass();
   DFAInput InsnInput = getInsnInput(InsnClass);
-  UnsignPair StateTrans = UnsignPair(CurrentState, InsnInput);
-  ReadTable(CurrentState);
-  return CachedTable.count(StateTrans) != 0;
+  return getNextState(CurrentState, InsnInput) != -1;
 }
 
 
@@ -128,10 +143,9 @@ bool DFAPacketizer::canReserveResources(const llvm::MCInstrDesc *MID) {
 void DFAPacketizer::reserveResources(const llvm::MCInstrDesc *MID) {
   unsigned InsnClass = MID->getSchedClass();
   DFAInput InsnInput = getInsnInput(InsnClass);
-  UnsignPair StateTrans = UnsignPair(CurrentState, InsnInput);
-  ReadTable(CurrentState);
-  assert(CachedTable.count(StateTrans) != 0);
-  CurrentState = CachedTable[StateTrans];
+  int NextState = getNextState(CurrentState, InsnInput);
+  assert(NextState != -1 && "Resources are not available");
+  CurrentState = NextState;
 }
 
 
@@ -229,6 +243,30 @@ void VLIWPacketizerList::endPacket(MachineBasicBlock *MBB,
 void VLIWPacketizerList::PacketizeMIs(MachineBasicBlock *MBB,
                                       MachineBasicBlock::iterator BeginItr,
                                       MachineBasicBlock::iterator EndItr) {
+  if (!PacketizerWindow) {
+    packetizeRegion(MBB, BeginItr, EndItr);
+    return;
+  }
+
+  // Packets only group neighboring instructions, so the dependences between
+  // instructions far apart are never queried, but building them can take
+  // most of the compile time on large blocks. Build the graph for one window
+  // of instructions at a time instead; a packet ends at each window boundary.
+  while (BeginItr != EndItr) {
+    MachineBasicBlock::iterator WindowEnd = BeginItr;
+    for (unsigned N = 0; N != PacketizerWindow && WindowEnd != EndItr;
+         ++WindowEnd)
+      if (!WindowEnd->isDebugValue())
+        ++N;
+    packetizeRegion(MBB, BeginItr, WindowEnd);
+    BeginItr = WindowEnd;
+  }
+}
+
+
+void VLIWPacketizerList::packetizeRegion(MachineBasicBlock *MBB,
+                                         MachineBasicBlock::iterator BeginItr,
+                                         MachineBasicBlock::iterator EndItr) {
   assert(VLIWScheduler && "VLIW Scheduler is not initialized!");
   VLIWScheduler->startBlock(MBB);
   VLIWScheduler->enterRegion(MBB, BeginItr, EndItr,
@@ -140,8 +140,30 @@ class ExeDepsFix : public MachineFunctionPass {
   std::vector<SmallVector<int, 1>> AliasMap;
   const unsigned NumRegs;
   LiveReg *LiveRegs;
-  typedef DenseMap<MachineBasicBlock*, LiveReg*> LiveOutMap;
-  LiveOutMap LiveOuts;
+  struct MBBInfo {
+    // Keeps clearance and domain information for all registers. Note that this
+    // is different from the usual definition notion of liveness. The CPU
+    // doesn't care whether or not we consider a register killed.
+    LiveReg *OutRegs;
+
+    // Whether we have gotten to this block in primary processing yet.
+    bool PrimaryCompleted;
+
+    // The number of predecessors for which primary processing has completed.
+    unsigned IncomingProcessed;
+
+    // The value of `IncomingProcessed` at the start of primary processing.
+    unsigned PrimaryIncoming;
+
+    // The number of predecessors for which all processing steps are done.
+    unsigned IncomingCompleted;
+
+    MBBInfo()
+        : OutRegs(nullptr), PrimaryCompleted(false), IncomingProcessed(0),
+          PrimaryIncoming(0), IncomingCompleted(0) {}
+  };
+  typedef DenseMap<MachineBasicBlock *, MBBInfo> MBBInfoMap;
+  MBBInfoMap MBBInfos;
 
   /// List of undefined register reads in this block in forward order.
   std::vector<std::pair<MachineInstr*, unsigned> > UndefReads;
@@ -153,10 +175,6 @@ class ExeDepsFix : public MachineFunctionPass {
   /// The first instruction in each basic block is 0.
   int CurInstr;
 
-  /// True when the current block has a predecessor that hasn't been visited
-  /// yet.
-  bool SeenUnknownBackEdge;
-
 public:
   ExeDepsFix(const TargetRegisterClass *rc)
     : MachineFunctionPass(ID), RC(rc), NumRegs(RC->getNumRegs()) {}
@@ -199,8 +217,11 @@ private:
 
   void enterBasicBlock(MachineBasicBlock*);
   void leaveBasicBlock(MachineBasicBlock*);
-  void visitInstr(MachineInstr*);
-  void processDefs(MachineInstr*, bool Kill);
+  bool isBlockDone(MachineBasicBlock *);
+  void processBasicBlock(MachineBasicBlock *MBB, bool PrimaryPass);
+  void updateSuccessors(MachineBasicBlock *MBB, bool PrimaryPass);
+  bool visitInstr(MachineInstr *);
+  void processDefs(MachineInstr *, bool BreakDependency, bool Kill);
   void visitSoftInstr(MachineInstr*, unsigned mask);
   void visitHardInstr(MachineInstr*, unsigned domain);
   bool shouldBreakDependence(MachineInstr*, unsigned OpIdx, unsigned Pref);
@@ -358,9 +379,6 @@ bool ExeDepsFix::merge(DomainValue *A, DomainValue *B) {
 
 /// Set up LiveRegs by merging predecessor live-out values.
 void ExeDepsFix::enterBasicBlock(MachineBasicBlock *MBB) {
-  // Detect back-edges from predecessors we haven't processed yet.
-  SeenUnknownBackEdge = false;
-
   // Reset instruction counter in each basic block.
   CurInstr = 0;
 
@@ -393,20 +411,18 @@ void ExeDepsFix::enterBasicBlock(MachineBasicBlock *MBB) {
   }
 
   // Try to coalesce live-out registers from predecessors.
-  for (MachineBasicBlock::const_pred_iterator pi = MBB->pred_begin(),
-       pe = MBB->pred_end(); pi != pe; ++pi) {
-    LiveOutMap::const_iterator fi = LiveOuts.find(*pi);
-    if (fi == LiveOuts.end()) {
-      SeenUnknownBackEdge = true;
+  for (MachineBasicBlock *Pred : MBB->predecessors()) {
+    LiveReg *Incoming = MBBInfos[Pred].OutRegs;
+    // Incoming is null if this is a back-edge from a predecessor we haven't
+    // processed yet.
+    if (!Incoming)
       continue;
-    }
-    assert(fi->second && "Can't have NULL entries");
 
     for (unsigned rx = 0; rx != NumRegs; ++rx) {
       // Use the most recent predecessor def for each register.
-      LiveRegs[rx].Def = std::max(LiveRegs[rx].Def, fi->second[rx].Def);
+      LiveRegs[rx].Def = std::max(LiveRegs[rx].Def, Incoming[rx].Def);
 
-      DomainValue *pdv = resolve(fi->second[rx].Value);
+      DomainValue *pdv = resolve(Incoming[rx].Value);
       if (!pdv)
         continue;
       if (!LiveRegs[rx].Value) {
@@ -431,34 +447,36 @@ void ExeDepsFix::enterBasicBlock(MachineBasicBlock *MBB) {
     }
   }
   DEBUG(dbgs() << "BB#" << MBB->getNumber()
-        << (SeenUnknownBackEdge ? ": incomplete\n" : ": all preds known\n"));
+        << (!isBlockDone(MBB) ? ": incomplete\n" : ": all preds known\n"));
 }
 
 void ExeDepsFix::leaveBasicBlock(MachineBasicBlock *MBB) {
   assert(LiveRegs && "Must enter basic block first.");
-  // Save live registers at end of MBB - used by enterBasicBlock().
-  // Also use LiveOuts as a visited set to detect back-edges.
-  bool First = LiveOuts.insert(std::make_pair(MBB, LiveRegs)).second;
-
-  if (First) {
-    // LiveRegs was inserted in LiveOuts.  Adjust all defs to be relative to
-    // the end of this block instead of the beginning.
-    for (unsigned i = 0, e = NumRegs; i != e; ++i)
-      LiveRegs[i].Def -= CurInstr;
-  } else {
-    // Insertion failed, this must be the second pass.
-    // Release all the DomainValues instead of keeping them.
-    for (unsigned i = 0, e = NumRegs; i != e; ++i)
+  LiveReg *OldOutRegs = MBBInfos[MBB].OutRegs;
+  // Save register clearances at end of MBB - used by enterBasicBlock().
+  MBBInfos[MBB].OutRegs = LiveRegs;
+
+  // While processing the basic block, we kept `Def` relative to the start
+  // of the basic block for convenience. However, future use of this information
+  // only cares about the clearance from the end of the block, so adjust
+  // everything to be relative to the end of the basic block.
+  for (unsigned i = 0, e = NumRegs; i != e; ++i)
+    LiveRegs[i].Def -= CurInstr;
+
+  if (OldOutRegs) {
+    // This must be a later pass, which doesn't visit the execution domains of
+    // the instructions. Keep the DomainValues the primary pass left live out
+    // of the block, and only update the clearances.
+    for (unsigned i = 0, e = NumRegs; i != e; ++i) {
       release(LiveRegs[i].Value);
-    delete[] LiveRegs;
+      LiveRegs[i].Value = OldOutRegs[i].Value;
+    }
+    delete[] OldOutRegs;
   }
   LiveRegs = nullptr;
 }
 
-void ExeDepsFix::visitInstr(MachineInstr *MI) {
-  if (MI->isDebugValue())
-    return;
-
+bool ExeDepsFix::visitInstr(MachineInstr *MI) {
   // Update instructions with explicit execution domains.
   std::pair<uint16_t, uint16_t> DomP = TII->getExecutionDomain(MI);
   if (DomP.first) {
@@ -468,9 +486,7 @@ void ExeDepsFix::visitInstr(MachineInstr *MI) {
       visitHardInstr(MI, DomP.first);
   }
 
-  // Process defs to track register ages, and kill values clobbered by generic
-  // instructions.
-  processDefs(MI, !DomP.first);
+  return !DomP.first;
 }
 
 /// \brief Return true to if it makes sense to break dependence on a partial def
@@ -486,14 +502,7 @@ bool ExeDepsFix::shouldBreakDependence(MachineInstr *MI, unsigned OpIdx,
       DEBUG(dbgs() << ": Break dependency.\n");
       continue;
     }
-    // The current clearance seems OK, but we may be ignoring a def from a
-    // back-edge.
-    if (!SeenUnknownBackEdge || Pref <= unsigned(CurInstr)) {
-      DEBUG(dbgs() << ": OK .\n");
-      return false;
-    }
-    // A def from an unprocessed back-edge may make us break this dependency.
-    DEBUG(dbgs() << ": Wait for back-edge to resolve.\n");
+    DEBUG(dbgs() << ": OK .\n");
     return false;
   }
   return true;
@@ -502,14 +511,16 @@ bool ExeDepsFix::shouldBreakDependence(MachineInstr *MI, unsigned OpIdx,
 // Update def-ages for registers defined by MI.
 // If Kill is set, also kill off DomainValues clobbered by the defs.
 //
-// Also break dependencies on partial defs and undef uses.
-void ExeDepsFix::processDefs(MachineInstr *MI, bool Kill) {
+// Also break dependencies on partial defs and undef uses if BreakDependency
+// is set.
+void ExeDepsFix::processDefs(MachineInstr *MI, bool BreakDependency,
+                             bool Kill) {
   assert(!MI->isDebugValue() && "Won't process debug values");
 
   // Break dependence on undef uses. Do this before updating LiveRegs below.
   unsigned OpNum;
   unsigned Pref = TII->getUndefRegClearance(MI, OpNum, TRI);
-  if (Pref) {
+  if (Pref && BreakDependency) {
     if (shouldBreakDependence(MI, OpNum, Pref))
       UndefReads.push_back(std::make_pair(MI, OpNum));
   }
@@ -531,9 +542,11 @@ void ExeDepsFix::processDefs(MachineInstr *MI, bool Kill) {
 
       // Check clearance before partial register updates.
       // Call breakDependence before setting LiveRegs[rx].Def.
-      unsigned Pref = TII->getPartialRegUpdateClearance(MI, i, TRI);
-      if (Pref && shouldBreakDependence(MI, i, Pref))
-        TII->breakPartialRegDependency(MI, i, TRI);
+      if (BreakDependency) {
+        unsigned Pref = TII->getPartialRegUpdateClearance(MI, i, TRI);
+        if (Pref && shouldBreakDependence(MI, i, Pref))
+          TII->breakPartialRegDependency(MI, i, TRI);
+      }
 
       // How many instructions since rx was last written?
       LiveRegs[rx].Def = CurInstr;
@@ -725,6 +738,59 @@ void ExeDepsFix::visitSoftInstr(MachineInstr *mi, unsigned mask) {
   }
 }
 
+void ExeDepsFix::processBasicBlock(MachineBasicBlock *MBB, bool PrimaryPass) {
+  enterBasicBlock(MBB);
+  // If this block is not done, it makes little sense to make any decisions
+  // based on clearance information. We need to make a second pass anyway,
+  // and by then we'll have better information, so we can avoid doing the work
+  // to try and break dependencies now. Blocks reached by the final sweep in
+  // runOnMachineFunction are never done, but that sweep is their last pass.
+  bool BreakDependency = !PrimaryPass || isBlockDone(MBB);
+  for (MachineInstr &MI : *MBB) {
+    if (MI.isDebugValue())
+      continue;
+    // Execution domains are only chosen in the primary pass. Later passes
+    // merge the DomainValues live in from back-edges and refine clearances.
+    bool Kill = false;
+    if (PrimaryPass)
+      Kill = visitInstr(&MI);
+    // Process defs to track register ages, and kill values clobbered by
+    // generic instructions.
+    processDefs(&MI, BreakDependency, Kill);
+  }
+  if (BreakDependency)
+    processUndefReads(MBB);
+  leaveBasicBlock(MBB);
+}
+
+/// A block is done when its primary pass has run, and every predecessor has
+/// been through its primary pass and was itself done.
+bool ExeDepsFix::isBlockDone(MachineBasicBlock *MBB) {
+  const MBBInfo &Info = MBBInfos[MBB];
+  return Info.PrimaryCompleted &&
+         Info.IncomingCompleted == Info.PrimaryIncoming &&
+         Info.IncomingProcessed == MBB->pred_size();
+}
+
+void ExeDepsFix::updateSuccessors(MachineBasicBlock *MBB, bool PrimaryPass) {
+  bool Done = isBlockDone(MBB);
+  for (MachineBasicBlock *Succ : MBB->successors()) {
+    if (isBlockDone(Succ))
+      continue;
+    MBBInfo &SuccInfo = MBBInfos[Succ];
+    if (PrimaryPass)
+      ++SuccInfo.IncomingProcessed;
+    if (Done)
+      ++SuccInfo.IncomingCompleted;
+    if (isBlockDone(Succ)) {
+      // All of Succ's predecessors are final now. Revisit it with the complete
+      // live-in information. See runOnMachineFunction for the visit order.
+      processBasicBlock(Succ, false);
+      updateSuccessors(Succ, false);
+    }
+  }
+}
+
 bool ExeDepsFix::runOnMachineFunction(MachineFunction &mf) {
   if (skipFunction(*mf.getFunction()))
     return false;
@@ -760,44 +826,49 @@ bool ExeDepsFix::runOnMachineFunction(MachineFunction &mf) {
         AliasMap[*AI].push_back(i);
   }
 
+  // Traverse the basic blocks in reverse post order. In the primary pass, each
+  // block picks execution domains and computes clearances from whatever
+  // predecessors have been visited so far. A loop header is visited before its
+  // latches, so its clearances don't yet account for defs around the
+  // back-edge.
+  //
+  // A block is done once all of its predecessors are done. When that happens
+  // to a block whose primary pass has already run, it is processed again with
+  // the complete live-in information, which in turn may finish its successors.
+  // This propagates the loop-carried defs and DomainValues around each loop
+  // before any dependency is broken in it, so xorps are only inserted where the
+  // clearance around the loop is actually too small. Dependencies are only
+  // broken in the last pass over each block.
   MachineBasicBlock *Entry = &*MF->begin();
   ReversePostOrderTraversal<MachineBasicBlock*> RPOT(Entry);
-  SmallVector<MachineBasicBlock*, 16> Loops;
-  for (ReversePostOrderTraversal<MachineBasicBlock*>::rpo_iterator
-         MBBI = RPOT.begin(), MBBE = RPOT.end(); MBBI != MBBE; ++MBBI) {
-    MachineBasicBlock *MBB = *MBBI;
-    enterBasicBlock(MBB);
-    if (SeenUnknownBackEdge)
-      Loops.push_back(MBB);
-    for (MachineInstr &MI : *MBB)
-      visitInstr(&MI);
-    processUndefReads(MBB);
-    leaveBasicBlock(MBB);
-  }
-
-  // Visit all the loop blocks again in order to merge DomainValues from
-  // back-edges.
-  for (MachineBasicBlock *MBB : Loops) {
-    enterBasicBlock(MBB);
-    for (MachineInstr &MI : *MBB)
-      if (!MI.isDebugValue())
-        processDefs(&MI, false);
-    processUndefReads(MBB);
-    leaveBasicBlock(MBB);
-  }
+  for (MachineBasicBlock *MBB : RPOT) {
+    // IncomingProcessed and IncomingCompleted were already updated while
+    // processing this block's predecessors.
+    MBBInfo &Info = MBBInfos[MBB];
+    Info.PrimaryCompleted = true;
+    Info.PrimaryIncoming = Info.IncomingProcessed;
+    processBasicBlock(MBB, true);
+    updateSuccessors(MBB, true);
+  }
+
+  // Blocks with unreachable predecessors never become done above. Give them
+  // their final pass now; their successors are not done either and get theirs
+  // later in this loop.
+  for (MachineBasicBlock *MBB : RPOT)
+    if (!isBlockDone(MBB))
+      processBasicBlock(MBB, false);
 
   // Clear the LiveOuts vectors and collapse any remaining DomainValues.
-  for (ReversePostOrderTraversal<MachineBasicBlock*>::rpo_iterator
-         MBBI = RPOT.begin(), MBBE = RPOT.end(); MBBI != MBBE; ++MBBI) {
-    LiveOutMap::const_iterator FI = LiveOuts.find(*MBBI);
-    if (FI == LiveOuts.end() || !FI->second)
+  for (MachineBasicBlock *MBB : RPOT) {
+    LiveReg *OutRegs = MBBInfos[MBB].OutRegs;
+    if (!OutRegs)
       continue;
     for (unsigned i = 0, e = NumRegs; i != e; ++i)
-      if (FI->second[i].Value)
-        release(FI->second[i].Value);
-    delete[] FI->second;
+      if (OutRegs[i].Value)
+        release(OutRegs[i].Value);
+    delete[] OutRegs;
   }
-  LiveOuts.clear();
+  MBBInfos.clear();
   UndefReads.clear();
   Avail.clear();
   Allocator.DestroyAll();
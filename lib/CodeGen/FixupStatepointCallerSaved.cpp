@@ -0,0 +1,191 @@
+//===-- FixupStatepointCallerSaved.cpp - Fixup caller saved registers -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Statepoint lowering may leave deopt values in virtual registers (see
+// -use-registers-for-deopt-values).  The register allocator does not know
+// that the runtime reads these values while the call is in progress, so it
+// may assign them registers the call clobbers.  This pass spills such
+// registers to stack slots just before the statepoint and rewrites the
+// operands into indirect memory references, which is what statepoint
+// lowering would have produced for them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/CodeGen/MachineFrameInfo.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineInstrBuilder.h"
+#include "llvm/CodeGen/MachineMemOperand.h"
+#include "llvm/CodeGen/StackMaps.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include "llvm/Target/TargetSubtargetInfo.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "fixup-statepoint-caller-saved"
+
+STATISTIC(NumSpilledRegisters, "Number of spilled register");
+
+namespace {
+class FixupStatepointCallerSaved : public MachineFunctionPass {
+  const TargetInstrInfo *TII;
+  const TargetRegisterInfo *TRI;
+  MachineFrameInfo *MFI;
+
+  /// Stack slots created so far, by size.  Every statepoint starts over from
+  /// the first slot of each size, so slots are shared between statepoints.
+  DenseMap<unsigned, SmallVector<int, 4>> SlotsBySize;
+
+  int getSpillSlot(const TargetRegisterClass *RC,
+                   DenseMap<unsigned, unsigned> &NextSlot);
+  bool fixupStatepoint(MachineInstr *MI);
+
+public:
+  static char ID; // Pass identification, replacement for typeid
+  FixupStatepointCallerSaved() : MachineFunctionPass(ID) {
+    initializeFixupStatepointCallerSavedPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+
+  MachineFunctionProperties getRequiredProperties() const override {
+    return MachineFunctionProperties().set(
+        MachineFunctionProperties::Property::AllVRegsAllocated);
+  }
+
+  const char *getPassName() const override {
+    return "Fixup Statepoint Caller Saved";
+  }
+};
+} // end anonymous namespace
+
+char FixupStatepointCallerSaved::ID = 0;
+char &llvm::FixupStatepointCallerSavedID = FixupStatepointCallerSaved::ID;
+
+INITIALIZE_PASS(FixupStatepointCallerSaved, DEBUG_TYPE,
+                "Fixup Statepoint Caller Saved", false, false)
+
+/// Return a stack slot for a register of class \p RC which is not used yet by
+/// the current statepoint.  \p NextSlot counts the slots of each size the
+/// current statepoint uses.
+int FixupStatepointCallerSaved::getSpillSlot(
+    const TargetRegisterClass *RC, DenseMap<unsigned, unsigned> &NextSlot) {
+  unsigned Size = RC->getSize();
+  SmallVectorImpl<int> &Slots = SlotsBySize[Size];
+  unsigned Idx = NextSlot[Size]++;
+  if (Idx < Slots.size()) {
+    int FI = Slots[Idx];
+    if (MFI->getObjectAlignment(FI) < RC->getAlignment())
+      MFI->setObjectAlignment(FI, RC->getAlignment());
+    return FI;
+  }
+  int FI = MFI->CreateSpillStackObject(Size, RC->getAlignment());
+  Slots.push_back(FI);
+  return FI;
+}
+
+bool FixupStatepointCallerSaved::fixupStatepoint(MachineInstr *MI) {
+  const uint32_t *Mask = nullptr;
+  for (const MachineOperand &MO : MI->operands())
+    if (MO.isRegMask())
+      Mask = MO.getRegMask();
+  if (!Mask)
+    return false;
+
+  // Registers of the deopt and gc arguments which the call clobbers, and the
+  // slots they are spilled to.
+  unsigned StartIdx = StatepointOpers(MI).getVarIdx();
+  DenseMap<unsigned, int> RegToSlot;
+  DenseMap<unsigned, unsigned> NextSlot;
+  for (unsigned Idx = StartIdx, E = MI->getNumOperands(); Idx != E; ++Idx) {
+    const MachineOperand &MO = MI->getOperand(Idx);
+    if (!MO.isReg() || MO.isImplicit() || !MO.getReg())
+      continue;
+    assert(MO.isUse() && "Statepoint arguments should be uses");
+    unsigned Reg = MO.getReg();
+    if (!MachineOperand::clobbersPhysReg(Mask, Reg) || RegToSlot.count(Reg))
+      continue;
+
+    const TargetRegisterClass *RC = TRI->getMinimalPhysRegClass(Reg);
+    int FI = getSpillSlot(RC, NextSlot);
+    RegToSlot[Reg] = FI;
+    DEBUG(dbgs() << "Spilling " << PrintReg(Reg, TRI) << " to FI#" << FI
+                 << " for " << *MI);
+    TII->storeRegToStackSlot(*MI->getParent(), MI, Reg, /*isKill*/ false, FI,
+                             RC, TRI);
+    ++NumSpilledRegisters;
+  }
+  if (RegToSlot.empty())
+    return false;
+
+  // Rebuild the statepoint with the spilled registers replaced by indirect
+  // memory references, the same form statepoint lowering uses for its spills.
+  MachineFunction &MF = *MI->getParent()->getParent();
+  MachineInstrBuilder MIB =
+      BuildMI(*MI->getParent(), MI, MI->getDebugLoc(), MI->getDesc());
+  for (unsigned Idx = 0, E = MI->getNumOperands(); Idx != E; ++Idx) {
+    const MachineOperand &MO = MI->getOperand(Idx);
+    if (Idx < StartIdx || !MO.isReg() || MO.isImplicit() ||
+        !RegToSlot.count(MO.getReg())) {
+      MIB.addOperand(MO);
+      continue;
+    }
+    int FI = RegToSlot[MO.getReg()];
+    MIB.addImm(StackMaps::IndirectMemRefOp);
+    MIB.addImm(MFI->getObjectSize(FI));
+    MIB.addFrameIndex(FI);
+    MIB.addImm(0);
+  }
+  MIB->setMemRefs(MI->memoperands_begin(), MI->memoperands_end());
+  for (const auto &RS : RegToSlot) {
+    int FI = RS.second;
+    MachineMemOperand *MMO = MF.getMachineMemOperand(
+        MachinePointerInfo::getFixedStack(MF, FI), MachineMemOperand::MOLoad,
+        MFI->getObjectSize(FI), MFI->getObjectAlignment(FI));
+    MIB->addMemOperand(MF, MMO);
+  }
+  MI->eraseFromParent();
+  return true;
+}
+
+bool FixupStatepointCallerSaved::runOnMachineFunction(MachineFunction &MF) {
+  // Only functions with a garbage collector have statepoints.  This pass is
+  // required for correctness, so it is not skipped for optnone functions.
+  if (!MF.getFunction()->hasGC())
+    return false;
+
+  TII = MF.getSubtarget().getInstrInfo();
+  TRI = MF.getSubtarget().getRegisterInfo();
+  MFI = MF.getFrameInfo();
+
+  SmallVector<MachineInstr *, 16> Statepoints;
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB)
+      if (MI.getOpcode() == TargetOpcode::STATEPOINT)
+        Statepoints.push_back(&MI);
+
+  bool Changed = false;
+  for (MachineInstr *MI : Statepoints)
+    Changed |= fixupStatepoint(MI);
+  SlotsBySize.clear();
+  return Changed;
+}
@@ -0,0 +1,63 @@
+//===- llvm/CodeGen/GlobalISel/InstructionSelector.cpp -----------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the InstructionSelector class.
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/GlobalISel/InstructionSelector.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBank.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBankInfo.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+
+#define DEBUG_TYPE "instructionselector"
+
+using namespace llvm;
+
+bool InstructionSelector::constrainSelectedInstRegOperands(
+    MachineInstr &I, const TargetInstrInfo &TII, const TargetRegisterInfo &TRI,
+    const RegisterBankInfo &RBI) const {
+  MachineFunction &MF = *I.getParent()->getParent();
+  MachineRegisterInfo &MRI = MF.getRegInfo();
+
+  for (unsigned OpI = 0, OpE = I.getNumExplicitOperands(); OpI != OpE; ++OpI) {
+    MachineOperand &MO = I.getOperand(OpI);
+    DEBUG(dbgs() << "Converting operand: " << MO << '\n');
+
+    // There's nothing to be done on non-register operands, and physical
+    // registers don't need to be constrained.
+    if (!MO.isReg() || !MO.getReg() ||
+        TargetRegisterInfo::isPhysicalRegister(MO.getReg()))
+      continue;
+
+    unsigned Reg = MO.getReg();
+    const TargetRegisterClass *RC = TII.getRegClass(I.getDesc(), OpI, &TRI, MF);
+    if (!RC)
+      return false;
+
+    const RegClassOrRegBank &RCOrRB = MRI.getRegClassOrRegBank(Reg);
+    if (RCOrRB.isNull()) {
+      MRI.setRegClass(Reg, RC);
+      continue;
+    }
+    if (const RegisterBank *RB = RCOrRB.dyn_cast<const RegisterBank *>()) {
+      if (!RB->covers(*RC))
+        return false;
+      MRI.setRegClass(Reg, RC);
+      continue;
+    }
+    if (!MRI.constrainRegClass(Reg, RC))
+      return false;
+  }
+  return true;
+}
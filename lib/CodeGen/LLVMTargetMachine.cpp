@@ -164,11 +164,20 @@ addPassesToGenerateCode(LLVMTargetMachine *TM, PassManagerBase &PM,
     if (PassConfig->addRegBankSelect())
       return nullptr;
 
+    // Before running the instruction selector, ask the target if it wants to
+    // run some passes.
+    PassConfig->addPreGlobalInstructionSelect();
+
+    if (PassConfig->addGlobalInstructionSelect())
+      return nullptr;
+
   } else if (PassConfig->addInstSelector())
     return nullptr;
 
   PassConfig->addMachinePasses();
 
+  MMI.setRetainMachineFunctions(PassConfig->retainsMachineFunctions());
+
   PassConfig->setInitialized();
 
   return &MMI.getContext();
@@ -20,6 +20,7 @@
 
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SparseBitVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/UniqueVector.h"
@@ -28,6 +29,7 @@
 #include "llvm/CodeGen/MachineInstrBuilder.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -42,6 +44,22 @@ using namespace llvm;
 #define DEBUG_TYPE "live-debug-values"
 
 STATISTIC(NumInserted, "Number of DBG_VALUE instructions inserted");
+STATISTIC(NumSkipped, "Number of functions too large to extend ranges in");
+
+// The cost of the dataflow grows with the number of blocks times the number of
+// variable locations, so ranges are not extended across the blocks of the
+// functions that have both many blocks and many variable locations. Their
+// location lists are less precise, but they compile in reasonable time.
+static cl::opt<unsigned> InputBBLimit(
+    "livedebugvalues-input-bb-limit", cl::init(10000), cl::Hidden,
+    cl::desc("Maximum number of basic blocks of a function with more than "
+             "-livedebugvalues-input-dbg-value-limit DBG_VALUEs to extend "
+             "debug ranges in"));
+static cl::opt<unsigned> InputDbgValueLimit(
+    "livedebugvalues-input-dbg-value-limit", cl::init(50000), cl::Hidden,
+    cl::desc("Maximum number of DBG_VALUEs of a function with more than "
+             "-livedebugvalues-input-bb-limit basic blocks to extend debug "
+             "ranges in"));
 
 namespace {
 
@@ -303,29 +321,47 @@ void LiveDebugValues::transferDebugValue(const MachineInstr &MI,
 void LiveDebugValues::transferRegisterDef(MachineInstr &MI,
                                           OpenRangesSet &OpenRanges,
                                           const VarLocMap &VarLocIDs) {
-  MachineFunction *MF = MI.getParent()->getParent();
-  const TargetLowering *TLI = MF->getSubtarget().getTargetLowering();
-  unsigned SP = TLI->getStackPointerRegisterToSaveRestore();
-  SparseBitVector<> KillSet;
+  if (OpenRanges.empty())
+    return;
+
+  // Collect the registers that MI clobbers, so that the open ranges are
+  // visited once however many registers it defines.
+  SmallSet<unsigned, 32> DeadRegs;
+  SmallVector<const uint32_t *, 4> RegMasks;
   for (const MachineOperand &MO : MI.operands()) {
     if (MO.isReg() && MO.isDef() && MO.getReg() &&
         TRI->isPhysicalRegister(MO.getReg())) {
       // Remove ranges of all aliased registers.
       for (MCRegAliasIterator RAI(MO.getReg(), TRI, true); RAI.isValid(); ++RAI)
-        for (unsigned ID : OpenRanges.getVarLocs())
-          if (VarLocIDs[ID].isDescribedByReg() == *RAI)
-            KillSet.set(ID);
+        DeadRegs.insert(*RAI);
     } else if (MO.isRegMask()) {
-      // Remove ranges of all clobbered registers. Register masks don't usually
-      // list SP as preserved.  While the debug info may be off for an
-      // instruction or two around callee-cleanup calls, transferring the
-      // DEBUG_VALUE across the call is still a better user experience.
-      for (unsigned ID : OpenRanges.getVarLocs()) {
-        unsigned Reg = VarLocIDs[ID].isDescribedByReg();
-        if (Reg && Reg != SP && MO.clobbersPhysReg(Reg))
-          KillSet.set(ID);
-      }
+      RegMasks.push_back(MO.getRegMask());
+    }
+  }
+  if (DeadRegs.empty() && RegMasks.empty())
+    return;
+
+  MachineFunction *MF = MI.getParent()->getParent();
+  const TargetLowering *TLI = MF->getSubtarget().getTargetLowering();
+  unsigned SP = TLI->getStackPointerRegisterToSaveRestore();
+  SparseBitVector<> KillSet;
+  for (unsigned ID : OpenRanges.getVarLocs()) {
+    unsigned Reg = VarLocIDs[ID].isDescribedByReg();
+    if (!Reg)
+      continue;
+    if (DeadRegs.count(Reg)) {
+      KillSet.set(ID);
+      continue;
     }
+    // Remove ranges of all clobbered registers. Register masks don't usually
+    // list SP as preserved.  While the debug info may be off for an
+    // instruction or two around callee-cleanup calls, transferring the
+    // DEBUG_VALUE across the call is still a better user experience.
+    if (Reg != SP &&
+        any_of(RegMasks, [Reg](const uint32_t *RegMask) {
+          return MachineOperand::clobbersPhysReg(RegMask, Reg);
+        }))
+      KillSet.set(ID);
   }
   OpenRanges.erase(KillSet, VarLocIDs);
 }
@@ -508,6 +544,20 @@ bool LiveDebugValues::runOnMachineFunction(MachineFunction &MF) {
   TRI = MF.getSubtarget().getRegisterInfo();
   TII = MF.getSubtarget().getInstrInfo();
 
+  if (MF.size() > InputBBLimit) {
+    unsigned NumInputDbgValues = 0;
+    for (auto &MBB : MF)
+      for (auto &MI : MBB)
+        NumInputDbgValues += MI.isDebugValue();
+    if (NumInputDbgValues > InputDbgValueLimit) {
+      DEBUG(dbgs() << "Disabling LiveDebugValues in " << MF.getName()
+                   << ", which has " << MF.size() << " basic blocks and "
+                   << NumInputDbgValues << " DBG_VALUEs\n");
+      ++NumSkipped;
+      return false;
+    }
+  }
+
   bool Changed = false;
 
   Changed |= ExtendRanges(MF);
@@ -30,11 +30,13 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetRegisterInfo.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 using namespace llvm;
 
@@ -62,6 +64,16 @@ static cl::opt<bool> EnableSubRegLiveness(
   "enable-subreg-liveness", cl::Hidden, cl::init(true),
   cl::desc("Enable subregister liveness tracking."));
 
+static cl::opt<unsigned> LiveIntervalsThreads(
+  "live-intervals-threads", cl::Hidden, cl::init(1),
+  cl::desc("Number of threads used to compute virtual register live "
+           "intervals (1 computes them serially)"));
+
+static cl::opt<unsigned> LiveIntervalsParallelThreshold(
+  "live-intervals-parallel-threshold", cl::Hidden, cl::init(1024),
+  cl::desc("Minimum number of virtual registers in a function before its "
+           "live intervals are computed on several threads"));
+
 namespace llvm {
 cl::opt<bool> UseSegmentSetForPhysRegs(
     "use-segment-set-for-physregs", cl::Hidden, cl::init(true),
@@ -106,6 +118,29 @@ void LiveIntervals::releaseMemory() {
 
   // Release VNInfo memory regions, VNInfo objects don't need to be dtor'd.
   VNInfoAllocator.Reset();
+  ThreadVNInfoAllocators.clear();
+}
+
+size_t LiveIntervals::getMemoryUsage() const {
+  // The value numbers and subregister ranges live in VNInfoAllocator, the
+  // segments of each range are allocated separately.
+  size_t Bytes = VNInfoAllocator.getTotalMemory();
+  for (const auto &Alloc : ThreadVNInfoAllocators)
+    Bytes += Alloc->getTotalMemory();
+  for (unsigned i = 0, e = VirtRegIntervals.size(); i != e; ++i) {
+    const LiveInterval *LI =
+        VirtRegIntervals[TargetRegisterInfo::index2VirtReg(i)];
+    if (!LI)
+      continue;
+    Bytes += sizeof(LiveInterval) + capacity_in_bytes(LI->segments);
+    for (const LiveInterval::SubRange &SR : LI->subranges())
+      Bytes += capacity_in_bytes(SR.segments);
+  }
+  for (const LiveRange *LR : RegUnitRanges)
+    if (LR)
+      Bytes += sizeof(LiveRange) + capacity_in_bytes(LR->segments);
+  return Bytes + capacity_in_bytes(RegMaskSlots) +
+         capacity_in_bytes(RegMaskBits) + capacity_in_bytes(RegMaskBlocks);
 }
 
 /// runOnMachineFunction - calculates LiveIntervals
@@ -195,6 +230,11 @@ void LiveIntervals::computeVirtRegInterval(LiveInterval &LI) {
 }
 
 void LiveIntervals::computeVirtRegs() {
+  if (LiveIntervalsThreads > 1 &&
+      MRI->getNumVirtRegs() >= LiveIntervalsParallelThreshold) {
+    computeVirtRegsInParallel(LiveIntervalsThreads);
+    return;
+  }
   for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
     unsigned Reg = TargetRegisterInfo::index2VirtReg(i);
     if (MRI->reg_nodbg_empty(Reg))
@@ -203,6 +243,61 @@ void LiveIntervals::computeVirtRegs() {
   }
 }
 
+void LiveIntervals::computeVirtRegsInParallel(unsigned NumThreads) {
+  // Create every interval up front so that VirtRegIntervals is not resized
+  // while the workers are running.
+  std::vector<LiveInterval *> Intervals;
+  for (unsigned i = 0, e = MRI->getNumVirtRegs(); i != e; ++i) {
+    unsigned Reg = TargetRegisterInfo::index2VirtReg(i);
+    if (MRI->reg_nodbg_empty(Reg))
+      continue;
+    Intervals.push_back(&createEmptyInterval(Reg));
+  }
+  if (Intervals.empty())
+    return;
+
+  // The workers only query the dominator tree, make sure it has no pending
+  // critical edge updates that would be applied lazily.
+  DomTree->getBase();
+
+  // Hand out the registers in chunks. LiveRangeCalc::calculate() only reads
+  // the function, except for clearing kill flags on the uses of the register
+  // it is working on, so the workers never write the same operand.
+  const size_t ChunkSize = 64;
+  std::atomic<size_t> NextChunk(0);
+  auto Worker = [&](VNInfo::Allocator *Alloc) {
+    LiveRangeCalc Calc;
+    for (;;) {
+      size_t Begin = NextChunk.fetch_add(ChunkSize);
+      if (Begin >= Intervals.size())
+        return;
+      size_t End = std::min(Begin + ChunkSize, Intervals.size());
+      for (size_t I = Begin; I != End; ++I) {
+        LiveInterval &LI = *Intervals[I];
+        Calc.reset(MF, Indexes, DomTree, Alloc);
+        Calc.calculate(LI, MRI->shouldTrackSubRegLiveness(LI.reg));
+      }
+    }
+  };
+
+  NumThreads = std::min<size_t>(NumThreads,
+                                (Intervals.size() + ChunkSize - 1) / ChunkSize);
+  {
+    ThreadPool Pool(NumThreads);
+    for (unsigned T = 0; T != NumThreads; ++T) {
+      ThreadVNInfoAllocators.emplace_back(new VNInfo::Allocator());
+      VNInfo::Allocator *Alloc = ThreadVNInfoAllocators.back().get();
+      Pool.async([&Worker, Alloc] { Worker(Alloc); });
+    }
+    Pool.wait();
+  }
+
+  // computeDeadValues() may add operands to instructions, so it has to run
+  // after all workers are done.
+  for (LiveInterval *LI : Intervals)
+    computeDeadValues(*LI, nullptr);
+}
+
 void LiveIntervals::computeRegMasks() {
   RegMaskBlocks.resize(MF->getNumBlockIDs());
 
@@ -64,24 +64,16 @@ class MIParser {
   const PerFunctionMIParsingState &PFS;
   /// Maps from indices to unnamed global values and metadata nodes.
   const SlotMapping &IRSlots;
-  /// Maps from instruction names to op codes.
-  StringMap<unsigned> Names2InstrOpCodes;
-  /// Maps from register names to registers.
-  StringMap<unsigned> Names2Regs;
-  /// Maps from register mask names to register masks.
-  StringMap<const uint32_t *> Names2RegMasks;
-  /// Maps from subregister names to subregister indices.
-  StringMap<unsigned> Names2SubRegIndices;
-  /// Maps from slot numbers to function's unnamed basic blocks.
-  DenseMap<unsigned, const BasicBlock *> Slots2BasicBlocks;
-  /// Maps from slot numbers to function's unnamed values.
-  DenseMap<unsigned, const Value *> Slots2Values;
-  /// Maps from target index names to target indices.
-  StringMap<int> Names2TargetIndices;
-  /// Maps from direct target flag names to the direct target flag values.
-  StringMap<unsigned> Names2DirectTargetFlags;
-  /// Maps from direct target flag names to the bitmask target flag values.
-  StringMap<unsigned> Names2BitmaskTargetFlags;
+  /// The lookup tables of the function, see PerFunctionMIParsingState.
+  StringMap<unsigned> &Names2InstrOpCodes;
+  StringMap<unsigned> &Names2Regs;
+  StringMap<const uint32_t *> &Names2RegMasks;
+  StringMap<unsigned> &Names2SubRegIndices;
+  DenseMap<unsigned, const BasicBlock *> &Slots2BasicBlocks;
+  DenseMap<unsigned, const Value *> &Slots2Values;
+  StringMap<int> &Names2TargetIndices;
+  StringMap<unsigned> &Names2DirectTargetFlags;
+  StringMap<unsigned> &Names2BitmaskTargetFlags;
 
 public:
   MIParser(SourceMgr &SM, MachineFunction &MF, SMDiagnostic &Error,
@@ -257,7 +249,14 @@ MIParser::MIParser(SourceMgr &SM, MachineFunction &MF, SMDiagnostic &Error,
                    StringRef Source, const PerFunctionMIParsingState &PFS,
                    const SlotMapping &IRSlots)
     : SM(SM), MF(MF), Error(Error), Source(Source), CurrentSource(Source),
-      PFS(PFS), IRSlots(IRSlots) {}
+      PFS(PFS), IRSlots(IRSlots), Names2InstrOpCodes(PFS.Names2InstrOpCodes),
+      Names2Regs(PFS.Names2Regs), Names2RegMasks(PFS.Names2RegMasks),
+      Names2SubRegIndices(PFS.Names2SubRegIndices),
+      Slots2BasicBlocks(PFS.Slots2BasicBlocks),
+      Slots2Values(PFS.Slots2Values),
+      Names2TargetIndices(PFS.Names2TargetIndices),
+      Names2DirectTargetFlags(PFS.Names2DirectTargetFlags),
+      Names2BitmaskTargetFlags(PFS.Names2BitmaskTargetFlags) {}
 
 void MIParser::lex(unsigned SkipChar) {
   CurrentSource = lexMIToken(
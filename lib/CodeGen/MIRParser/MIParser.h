@@ -15,11 +15,13 @@
 #define LLVM_LIB_CODEGEN_MIRPARSER_MIPARSER_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 
 namespace llvm {
 
 class StringRef;
 class BasicBlock;
+class Value;
 class MachineBasicBlock;
 class MachineInstr;
 class MachineFunction;
@@ -35,6 +37,31 @@ struct PerFunctionMIParsingState {
   DenseMap<unsigned, int> StackObjectSlots;
   DenseMap<unsigned, unsigned> ConstantPoolSlots;
   DenseMap<unsigned, unsigned> JumpTableSlots;
+
+  /// Lookup tables that are built when they are first needed, and are then
+  /// shared by all the parsers of the function. Many small parts of the
+  /// function, such as the registers of its liveins, are parsed separately,
+  /// and building the tables for each of them made the parsing of large
+  /// functions slow.
+  ///
+  /// Maps from instruction names to op codes.
+  mutable StringMap<unsigned> Names2InstrOpCodes;
+  /// Maps from register names to registers.
+  mutable StringMap<unsigned> Names2Regs;
+  /// Maps from register mask names to register masks.
+  mutable StringMap<const uint32_t *> Names2RegMasks;
+  /// Maps from subregister names to subregister indices.
+  mutable StringMap<unsigned> Names2SubRegIndices;
+  /// Maps from slot numbers to function's unnamed basic blocks.
+  mutable DenseMap<unsigned, const BasicBlock *> Slots2BasicBlocks;
+  /// Maps from slot numbers to function's unnamed values.
+  mutable DenseMap<unsigned, const Value *> Slots2Values;
+  /// Maps from target index names to target indices.
+  mutable StringMap<int> Names2TargetIndices;
+  /// Maps from direct target flag names to the direct target flag values.
+  mutable StringMap<unsigned> Names2DirectTargetFlags;
+  /// Maps from direct target flag names to the bitmask target flag values.
+  mutable StringMap<unsigned> Names2BitmaskTargetFlags;
 };
 
 /// Parse the machine basic block definitions, and skip the machine
@@ -272,6 +272,8 @@ void MIRPrinter::convert(ModuleSlotTracker &MST,
     MIPrinter(StrOS, MST, RegisterMaskIds, StackObjectOperandMapping)
         .printMBBReference(*MFI.getSavePoint());
   }
+  // FIXME: Serialize all the restore points when shrink-wrapping found
+  // several of them.
   if (MFI.getRestorePoint()) {
     raw_string_ostream StrOS(YamlMFI.RestorePoint.Value);
     MIPrinter(StrOS, MST, RegisterMaskIds, StackObjectOperandMapping)
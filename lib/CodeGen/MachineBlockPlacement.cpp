@@ -23,6 +23,10 @@
 // first time it reaches a chain of basic blocks, it schedules them in the
 // function in-order.
 //
+// With -enable-ext-tsp-block-placement, the resulting layout is then compared
+// with one that maximizes the ext-TSP score over the block frequencies, which
+// also rewards short jumps, and the better of the two is kept.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/Passes.h"
@@ -46,6 +50,7 @@
 #include "llvm/Target/TargetLowering.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include <algorithm>
+#include <map>
 using namespace llvm;
 
 #define DEBUG_TYPE "block-placement"
@@ -56,6 +61,10 @@ STATISTIC(CondBranchTakenFreq,
           "Potential frequency of taking conditional branches");
 STATISTIC(UncondBranchTakenFreq,
           "Potential frequency of taking unconditional branches");
+STATISTIC(NumExtTSPLayouts, "Number of functions laid out with ext-TSP");
+STATISTIC(ExtTSPScoreGain,
+          "Ext-TSP score gained over the chain-based layout, per hundred "
+          "function entries");
 
 static cl::opt<unsigned> AlignAllBlock("align-all-blocks",
                                        cl::desc("Force the alignment of all "
@@ -116,6 +125,24 @@ static cl::opt<unsigned> JumpInstCost("jump-inst-cost",
                                       cl::desc("Cost of jump instructions."),
                                       cl::init(1), cl::Hidden);
 
+static cl::opt<bool> EnableExtTSPLayout(
+    "enable-ext-tsp-block-placement",
+    cl::desc("Lay blocks out to maximize the ext-TSP score when that beats "
+             "the chain-based layout."),
+    cl::init(false), cl::Hidden);
+
+static cl::opt<unsigned> ExtTSPMaxBlocks(
+    "ext-tsp-max-blocks",
+    cl::desc("Functions with more blocks than this keep the chain-based "
+             "layout, to bound compile time."),
+    cl::init(1000), cl::Hidden);
+
+static cl::opt<unsigned> ExtTSPChainSplitThreshold(
+    "ext-tsp-chain-split-threshold",
+    cl::desc("The maximum number of blocks of a chain that ext-TSP layout tries "
+             "to split when merging it with another."),
+    cl::init(128), cl::Hidden);
+
 namespace {
 class BlockChain;
 /// \brief Type for our function-wide basic block -> block chain mapping.
@@ -170,6 +197,14 @@ public:
   /// \brief End of blocks within the chain.
   iterator end() { return Blocks.end(); }
 
+  /// \brief Lay the blocks of this chain out in \p NewOrder instead, which
+  /// must hold the same blocks.
+  void reorder(ArrayRef<MachineBasicBlock *> NewOrder) {
+    assert(NewOrder.size() == Blocks.size() && "Not a reordering");
+    Blocks.clear();
+    Blocks.append(NewOrder.begin(), NewOrder.end());
+  }
+
   /// \brief Merge a block chain into this one.
   ///
   /// This routine merges a block chain into this one. It takes care of forming
@@ -305,6 +340,7 @@ class MachineBlockPlacement : public MachineFunctionPass {
   void rotateLoopWithProfile(BlockChain &LoopChain, MachineLoop &L,
                              const BlockFilterSet &LoopBlockSet);
   void buildCFGChains(MachineFunction &F);
+  void applyExtTSPLayout(MachineFunction &F, BlockChain &FunctionChain);
   void optimizeBranches(MachineFunction &F);
   void alignBlocks(MachineFunction &F);
 
@@ -1295,6 +1331,9 @@ void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
     assert(!BadFunc && "Detected problems with the block placement.");
   });
 
+  if (EnableExtTSPLayout)
+    applyExtTSPLayout(F, FunctionChain);
+
   // Splice the blocks into place.
   MachineFunction::iterator InsertPos = F.begin();
   for (MachineBasicBlock *ChainBB : FunctionChain) {
@@ -1349,6 +1388,350 @@ void MachineBlockPlacement::buildCFGChains(MachineFunction &F) {
     F.back().updateTerminator();
 }
 
+/// \brief The maximum distance in bytes of a forward jump that ext-TSP rewards.
+static const uint64_t ExtTSPForwardDistance = 1024;
+/// \brief The maximum distance in bytes of a backward jump that ext-TSP
+/// rewards.
+static const uint64_t ExtTSPBackwardDistance = 640;
+/// \brief The reward of a jump of distance zero, relative to a fall-through.
+static const double ExtTSPJumpWeight = 0.1;
+/// \brief An estimate of the size of an instruction in bytes, since targets
+/// can't tell before the code is emitted.
+static const uint64_t ExtTSPInstrSize = 4;
+
+/// \brief The ext-TSP score of a jump of frequency \p Weight from a block that
+/// ends at \p SrcEnd to a block that begins at \p DstBegin.
+///
+/// A fall-through scores its whole frequency. A jump scores a fraction of it
+/// that decreases with its distance, as short jumps are likely to stay within
+/// the same cache lines and pages.
+static double getExtTSPScore(uint64_t SrcEnd, uint64_t DstBegin,
+                             uint64_t Weight) {
+  if (SrcEnd == DstBegin)
+    return Weight;
+  uint64_t Dist, MaxDist;
+  if (DstBegin > SrcEnd) {
+    Dist = DstBegin - SrcEnd;
+    MaxDist = ExtTSPForwardDistance;
+  } else {
+    Dist = SrcEnd - DstBegin;
+    MaxDist = ExtTSPBackwardDistance;
+  }
+  if (Dist >= MaxDist)
+    return 0;
+  return ExtTSPJumpWeight * Weight * (1.0 - double(Dist) / MaxDist);
+}
+
+namespace {
+/// \brief Computes an order of nodes that maximizes the ext-TSP score of the
+/// jumps between them, following "Improved Basic Block Reordering" (Newell
+/// and Pupyrev).
+///
+/// A node is a sequence of blocks that must stay contiguous. Every node starts
+/// as its own chain, and the chains are greedily merged, by concatenation or
+/// by splitting one and inserting the other, as long as that pays off. The
+/// chains are then ordered by decreasing execution density, keeping the chain
+/// of the first node, which is the entry, first.
+class ExtTSPLayout {
+  struct Node {
+    uint64_t Size;
+    uint64_t Freq;
+  };
+
+  /// \brief A jump between two nodes, with the offsets of the end of its
+  /// source block and the beginning of its destination block in them.
+  struct Jump {
+    unsigned Src, Dst;
+    uint64_t SrcEnd, DstBegin;
+    uint64_t Weight;
+  };
+
+  struct Chain {
+    std::vector<unsigned> Nodes;
+    uint64_t Size = 0;
+    uint64_t Freq = 0;
+    double Score = 0;
+    /// The jumps within the chain.
+    std::vector<unsigned> Jumps;
+    /// The jumps between the chain and the other chains, by chain.
+    std::map<unsigned, std::vector<unsigned>> Adjacent;
+  };
+
+  /// \brief The best order of the nodes of two merged chains, and its score.
+  struct Merge {
+    std::vector<unsigned> Nodes;
+    double Score = 0;
+    double Gain = 0;
+  };
+
+  std::vector<Node> Nodes;
+  std::vector<Jump> Jumps;
+  std::vector<Chain> Chains;
+  /// The addresses of the nodes in the order being scored.
+  std::vector<uint64_t> Addr;
+  /// The best merges of pairs of chains, until either of them changes.
+  std::map<std::pair<unsigned, unsigned>, Merge> MergeCache;
+
+  double getScore(ArrayRef<unsigned> Order, const Chain &X, const Chain &Y,
+                  ArrayRef<unsigned> Between);
+  Merge getBestMerge(unsigned X, unsigned Y);
+  void mergeChains(unsigned X, unsigned Y, Merge &M);
+
+public:
+  unsigned addNode(uint64_t Size, uint64_t Freq) {
+    Nodes.push_back({std::max<uint64_t>(Size, 1), Freq});
+    return Nodes.size() - 1;
+  }
+
+  void addJump(unsigned Src, unsigned Dst, uint64_t SrcEnd, uint64_t DstBegin,
+               uint64_t Weight) {
+    // The jumps within a node score the same in every order.
+    if (Src != Dst)
+      Jumps.push_back({Src, Dst, SrcEnd, DstBegin, Weight});
+  }
+
+  /// \brief Return the order of the nodes, beginning with the first one.
+  std::vector<unsigned> run();
+};
+} // end anonymous namespace
+
+double ExtTSPLayout::getScore(ArrayRef<unsigned> Order, const Chain &X,
+                              const Chain &Y, ArrayRef<unsigned> Between) {
+  uint64_t Offset = 0;
+  for (unsigned N : Order) {
+    Addr[N] = Offset;
+    Offset += Nodes[N].Size;
+  }
+  double Score = 0;
+  for (ArrayRef<unsigned> JumpList : {ArrayRef<unsigned>(X.Jumps),
+                                      ArrayRef<unsigned>(Y.Jumps), Between})
+    for (unsigned J : JumpList) {
+      const Jump &Jmp = Jumps[J];
+      Score += getExtTSPScore(Addr[Jmp.Src] + Jmp.SrcEnd,
+                              Addr[Jmp.Dst] + Jmp.DstBegin, Jmp.Weight);
+    }
+  return Score;
+}
+
+ExtTSPLayout::Merge ExtTSPLayout::getBestMerge(unsigned XIdx, unsigned YIdx) {
+  const Chain &X = Chains[XIdx], &Y = Chains[YIdx];
+  Merge Best;
+  // The entry has to stay first, so the chain holding it can only come first.
+  if (Y.Nodes.front() == 0)
+    return Best;
+  ArrayRef<unsigned> Between = X.Adjacent.find(YIdx)->second;
+  std::vector<unsigned> Order;
+  auto Try = [&](ArrayRef<unsigned> A, ArrayRef<unsigned> B,
+                 ArrayRef<unsigned> C) {
+    Order.clear();
+    Order.insert(Order.end(), A.begin(), A.end());
+    Order.insert(Order.end(), B.begin(), B.end());
+    Order.insert(Order.end(), C.begin(), C.end());
+    if (X.Nodes.front() == 0 && Order.front() != 0)
+      return;
+    double Score = getScore(Order, X, Y, Between);
+    double Gain = Score - X.Score - Y.Score;
+    if (Gain > Best.Gain) {
+      Best.Nodes = Order;
+      Best.Score = Score;
+      Best.Gain = Gain;
+    }
+  };
+
+  ArrayRef<unsigned> XNodes = X.Nodes, YNodes = Y.Nodes;
+  Try(XNodes, YNodes, None);
+  if (XNodes.size() > ExtTSPChainSplitThreshold)
+    return Best;
+  for (unsigned I = 1, E = XNodes.size(); I != E; ++I) {
+    ArrayRef<unsigned> X1 = XNodes.slice(0, I), X2 = XNodes.slice(I);
+    Try(X1, YNodes, X2);
+    Try(X2, YNodes, X1);
+    Try(X2, X1, YNodes);
+  }
+  return Best;
+}
+
+void ExtTSPLayout::mergeChains(unsigned XIdx, unsigned YIdx, Merge &M) {
+  Chain &X = Chains[XIdx], &Y = Chains[YIdx];
+  X.Nodes = std::move(M.Nodes);
+  X.Size += Y.Size;
+  X.Freq += Y.Freq;
+  X.Score = M.Score;
+  std::vector<unsigned> &Between = X.Adjacent[YIdx];
+  X.Jumps.insert(X.Jumps.end(), Between.begin(), Between.end());
+  X.Jumps.insert(X.Jumps.end(), Y.Jumps.begin(), Y.Jumps.end());
+  X.Adjacent.erase(YIdx);
+  for (auto &A : Y.Adjacent) {
+    if (A.first == XIdx)
+      continue;
+    std::vector<unsigned> &XJumps = X.Adjacent[A.first];
+    XJumps.insert(XJumps.end(), A.second.begin(), A.second.end());
+    Chain &Z = Chains[A.first];
+    std::vector<unsigned> &ZJumps = Z.Adjacent[XIdx];
+    ZJumps.insert(ZJumps.end(), A.second.begin(), A.second.end());
+    Z.Adjacent.erase(YIdx);
+  }
+  Y = Chain();
+
+  for (auto I = MergeCache.begin(), E = MergeCache.end(); I != E;) {
+    auto &Key = I->first;
+    if (Key.first == XIdx || Key.first == YIdx || Key.second == XIdx ||
+        Key.second == YIdx)
+      I = MergeCache.erase(I);
+    else
+      ++I;
+  }
+}
+
+std::vector<unsigned> ExtTSPLayout::run() {
+  Addr.resize(Nodes.size());
+  Chains.resize(Nodes.size());
+  for (unsigned I = 0, E = Nodes.size(); I != E; ++I) {
+    Chain &C = Chains[I];
+    C.Nodes.push_back(I);
+    C.Size = Nodes[I].Size;
+    C.Freq = Nodes[I].Freq;
+  }
+  for (unsigned J = 0, E = Jumps.size(); J != E; ++J) {
+    Chains[Jumps[J].Src].Adjacent[Jumps[J].Dst].push_back(J);
+    Chains[Jumps[J].Dst].Adjacent[Jumps[J].Src].push_back(J);
+  }
+
+  // Merge the pair of chains with the best gain until none is left.
+  for (;;) {
+    double BestGain = 0;
+    unsigned BestX = 0, BestY = 0;
+    for (unsigned X = 0, E = Chains.size(); X != E; ++X)
+      for (auto &A : Chains[X].Adjacent) {
+        auto Key = std::make_pair(X, A.first);
+        auto I = MergeCache.find(Key);
+        if (I == MergeCache.end())
+          I = MergeCache.insert(std::make_pair(Key, getBestMerge(X, A.first)))
+                  .first;
+        if (I->second.Gain > BestGain) {
+          BestGain = I->second.Gain;
+          BestX = X;
+          BestY = A.first;
+        }
+      }
+    if (BestGain <= 0)
+      break;
+    Merge M = std::move(MergeCache[std::make_pair(BestX, BestY)]);
+    mergeChains(BestX, BestY, M);
+  }
+
+  std::vector<const Chain *> Sorted;
+  for (const Chain &C : Chains)
+    if (!C.Nodes.empty())
+      Sorted.push_back(&C);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const Chain *A, const Chain *B) {
+                     if (A->Nodes.front() == 0 || B->Nodes.front() == 0)
+                       return A->Nodes.front() == 0 && B->Nodes.front() != 0;
+                     return double(A->Freq) / A->Size >
+                            double(B->Freq) / B->Size;
+                   });
+  std::vector<unsigned> Order;
+  for (const Chain *C : Sorted)
+    Order.insert(Order.end(), C->Nodes.begin(), C->Nodes.end());
+  return Order;
+}
+
+void MachineBlockPlacement::applyExtTSPLayout(MachineFunction &F,
+                                              BlockChain &FunctionChain) {
+  if (F.size() > ExtTSPMaxBlocks)
+    return;
+  // The chain-based layout moves EH pads out of line on purpose, keep it.
+  for (MachineBasicBlock &MBB : F)
+    if (MBB.isEHPad())
+      return;
+
+  // The function is still in its original order, in which the blocks that
+  // can't be analyzed fall through to their layout successors. Those runs of
+  // blocks are the nodes of the layout, as on the chains.
+  ExtTSPLayout Layout;
+  SmallVector<SmallVector<MachineBasicBlock *, 4>, 16> Nodes;
+  DenseMap<MachineBasicBlock *, std::pair<unsigned, uint64_t>> NodeOffset;
+  DenseMap<MachineBasicBlock *, uint64_t> BlockSize;
+  SmallVector<MachineOperand, 4> Cond; // For AnalyzeBranch.
+  bool FallsThrough = false;
+  uint64_t NodeSize = 0, NodeFreq = 0;
+  for (MachineBasicBlock &MBB : F) {
+    if (!FallsThrough) {
+      if (!Nodes.empty())
+        Layout.addNode(NodeSize, NodeFreq);
+      Nodes.emplace_back();
+      NodeSize = NodeFreq = 0;
+    }
+    uint64_t Size = 0;
+    for (MachineInstr &MI : MBB)
+      if (!MI.isDebugValue())
+        Size += ExtTSPInstrSize;
+    BlockSize[&MBB] = Size;
+    NodeOffset[&MBB] = std::make_pair(Nodes.size() - 1, NodeSize);
+    Nodes.back().push_back(&MBB);
+    NodeSize += Size;
+    NodeFreq += MBFI->getBlockFreq(&MBB).getFrequency();
+
+    Cond.clear();
+    MachineBasicBlock *TBB = nullptr, *FBB = nullptr; // For AnalyzeBranch.
+    FallsThrough =
+        TII->AnalyzeBranch(MBB, TBB, FBB, Cond) && MBB.canFallThrough();
+  }
+  Layout.addNode(NodeSize, NodeFreq);
+
+  for (MachineBasicBlock &MBB : F) {
+    BlockFrequency Freq = MBFI->getBlockFreq(&MBB);
+    auto Src = NodeOffset[&MBB];
+    for (MachineBasicBlock *Succ : MBB.successors()) {
+      uint64_t Weight =
+          (Freq * MBPI->getEdgeProbability(&MBB, Succ)).getFrequency();
+      if (!Weight)
+        continue;
+      auto Dst = NodeOffset[Succ];
+      Layout.addJump(Src.first, Dst.first, Src.second + BlockSize[&MBB],
+                     Dst.second, Weight);
+    }
+  }
+
+  SmallVector<MachineBasicBlock *, 16> NewOrder;
+  for (unsigned N : Layout.run())
+    NewOrder.append(Nodes[N].begin(), Nodes[N].end());
+
+  // Score both layouts the same way, and only keep the new one if it is
+  // actually better.
+  auto getLayoutScore = [&](ArrayRef<MachineBasicBlock *> Order) {
+    DenseMap<MachineBasicBlock *, uint64_t> Addr;
+    uint64_t Offset = 0;
+    for (MachineBasicBlock *MBB : Order) {
+      Addr[MBB] = Offset;
+      Offset += BlockSize[MBB];
+    }
+    double Score = 0;
+    for (MachineBasicBlock *MBB : Order) {
+      BlockFrequency Freq = MBFI->getBlockFreq(MBB);
+      for (MachineBasicBlock *Succ : MBB->successors())
+        Score += getExtTSPScore(
+            Addr[MBB] + BlockSize[MBB], Addr[Succ],
+            (Freq * MBPI->getEdgeProbability(MBB, Succ)).getFrequency());
+    }
+    return Score;
+  };
+  SmallVector<MachineBasicBlock *, 16> OldOrder(FunctionChain.begin(),
+                                                FunctionChain.end());
+  double OldScore = getLayoutScore(OldOrder);
+  double NewScore = getLayoutScore(NewOrder);
+  DEBUG(dbgs() << "Ext-TSP score of " << F.getName() << ": " << OldScore
+               << " -> " << NewScore << "\n");
+  if (NewScore <= OldScore)
+    return;
+
+  FunctionChain.reorder(NewOrder);
+  ++NumExtTSPLayouts;
+  ExtTSPScoreGain +=
+      uint64_t((NewScore - OldScore) * 100 / MBFI->getEntryFreq());
+}
+
 void MachineBlockPlacement::optimizeBranches(MachineFunction &F) {
   BlockChain &FunctionChain = *BlockToChain[&F.front()];
   SmallVector<MachineOperand, 4> Cond; // For AnalyzeBranch.
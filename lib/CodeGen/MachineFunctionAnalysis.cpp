@@ -47,14 +47,34 @@ bool MachineFunctionAnalysis::doInitialization(Module &M) {
 
 bool MachineFunctionAnalysis::runOnFunction(Function &F) {
   assert(!MF && "MachineFunctionAnalysis already initialized!");
-  MF = new MachineFunction(&F, TM, NextFnNum++,
-                           getAnalysis<MachineModuleInfo>());
+  MachineModuleInfo &MMI = getAnalysis<MachineModuleInfo>();
+  if (MMI.retainsMachineFunctions()) {
+    // Pick up where an earlier run over this function left off.
+    MF = MMI.getMachineFunction(F);
+    if (MF) {
+      MMI.restoreFunctionState(F);
+      return false;
+    }
+    MF = &MMI.createMachineFunction(F, TM);
+  } else {
+    MF = new MachineFunction(&F, TM, NextFnNum++, MMI);
+  }
   if (MFInitializer)
     MFInitializer->initializeMachineFunction(*MF);
   return false;
 }
 
 void MachineFunctionAnalysis::releaseMemory() {
-  delete MF;
+  if (!MF)
+    return;
+  MachineModuleInfo &MMI = MF->getMMI();
+  if (MMI.retainsMachineFunctions())
+    MMI.saveFunctionState(*MF->getFunction());
+  else
+    delete MF;
   MF = nullptr;
 }
+
+size_t MachineFunctionAnalysis::getMemoryUsage() const {
+  return MF ? MF->getAllocatedMemory() : 0;
+}
@@ -762,6 +762,21 @@ static void moveOperands(MachineOperand *Dst, MachineOperand *Src,
   std::memmove(Dst, Src, NumOps * sizeof(MachineOperand));
 }
 
+void MachineInstr::reserveOperands(MachineFunction &MF, unsigned NumOps) {
+  if (NumOps <= (Operands ? CapOperands.getSize() : 0))
+    return;
+
+  OperandCapacity OldCap = CapOperands;
+  MachineOperand *OldOperands = Operands;
+  CapOperands = OperandCapacity::get(NumOps);
+  Operands = MF.allocateOperandArray(CapOperands);
+  if (!OldOperands)
+    return;
+  if (NumOperands)
+    moveOperands(Operands, OldOperands, NumOperands, getRegInfo());
+  MF.deallocateOperandArray(OldCap, OldOperands);
+}
+
 /// addOperand - Add the specified operand to the instruction.  If it is an
 /// implicit operand, it is added to the end of the operand list.  If it is
 /// an explicit operand it is added at the end of the explicit operand list
@@ -186,10 +186,27 @@ void MMIAddrLabelMapCallbackPtr::allUsesReplacedWith(Value *V2) {
 
 //===----------------------------------------------------------------------===//
 
+struct MachineModuleInfo::FunctionState {
+  std::vector<MCCFIInstruction> FrameInstructions;
+  std::vector<LandingPadInfo> LandingPads;
+  DenseMap<MCSymbol*, SmallVector<unsigned, 4> > LPadToCallSiteMap;
+  DenseMap<MCSymbol*, unsigned> CallSiteMap;
+  unsigned CurCallSite;
+  std::vector<const GlobalValue *> TypeInfos;
+  std::vector<unsigned> FilterIds;
+  std::vector<unsigned> FilterEnds;
+  bool CallsEHReturn;
+  bool CallsUnwindInit;
+  bool HasEHFunclets;
+  EHPersonality PersonalityTypeCache;
+  VariableDbgInfoMapTy VariableDbgInfos;
+};
+
 MachineModuleInfo::MachineModuleInfo(const MCAsmInfo &MAI,
                                      const MCRegisterInfo &MRI,
                                      const MCObjectFileInfo *MOFI)
-  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, nullptr, false) {
+  : ImmutablePass(ID), Context(&MAI, &MRI, MOFI, nullptr, false),
+    RetainMachineFunctions(false), NextFnNum(0) {
   initializeMachineModuleInfoPass(*PassRegistry::getPassRegistry());
 }
 
@@ -214,12 +231,16 @@ bool MachineModuleInfo::doInitialization(Module &M) {
   PersonalityTypeCache = EHPersonality::Unknown;
   AddrLabelSymbols = nullptr;
   TheModule = nullptr;
+  NextFnNum = 0;
 
   return false;
 }
 
 bool MachineModuleInfo::doFinalization(Module &M) {
 
+  MachineFunctions.clear();
+  SavedStates.clear();
+
   Personalities.clear();
 
   delete AddrLabelSymbols;
@@ -252,6 +273,66 @@ void MachineModuleInfo::EndFunction() {
   VariableDbgInfos.clear();
 }
 
+MachineFunction *MachineModuleInfo::getMachineFunction(const Function &F) const {
+  auto I = MachineFunctions.find(&F);
+  return I != MachineFunctions.end() ? I->second.get() : nullptr;
+}
+
+MachineFunction &
+MachineModuleInfo::createMachineFunction(const Function &F,
+                                         const TargetMachine &TM) {
+  assert(RetainMachineFunctions && "Machine functions are not retained!");
+  std::unique_ptr<MachineFunction> &MF = MachineFunctions[&F];
+  assert(!MF && "Machine function already created!");
+  MF.reset(new MachineFunction(&F, TM, NextFnNum++, *this));
+  return *MF;
+}
+
+void MachineModuleInfo::saveFunctionState(const Function &F) {
+  std::unique_ptr<FunctionState> &S = SavedStates[&F];
+  if (!S)
+    S.reset(new FunctionState());
+  S->FrameInstructions = std::move(FrameInstructions);
+  S->LandingPads = std::move(LandingPads);
+  S->LPadToCallSiteMap = std::move(LPadToCallSiteMap);
+  S->CallSiteMap = std::move(CallSiteMap);
+  S->CurCallSite = CurCallSite;
+  S->TypeInfos = std::move(TypeInfos);
+  S->FilterIds = std::move(FilterIds);
+  S->FilterEnds = std::move(FilterEnds);
+  S->CallsEHReturn = CallsEHReturn;
+  S->CallsUnwindInit = CallsUnwindInit;
+  S->HasEHFunclets = HasEHFunclets;
+  S->PersonalityTypeCache = PersonalityTypeCache;
+  S->VariableDbgInfos = std::move(VariableDbgInfos);
+
+  // Leave a clean slate for the next function.
+  EndFunction();
+  LPadToCallSiteMap.clear();
+  CurCallSite = 0;
+}
+
+void MachineModuleInfo::restoreFunctionState(const Function &F) {
+  auto I = SavedStates.find(&F);
+  if (I == SavedStates.end())
+    return;
+  FunctionState &S = *I->second;
+  FrameInstructions = std::move(S.FrameInstructions);
+  LandingPads = std::move(S.LandingPads);
+  LPadToCallSiteMap = std::move(S.LPadToCallSiteMap);
+  CallSiteMap = std::move(S.CallSiteMap);
+  CurCallSite = S.CurCallSite;
+  TypeInfos = std::move(S.TypeInfos);
+  FilterIds = std::move(S.FilterIds);
+  FilterEnds = std::move(S.FilterEnds);
+  CallsEHReturn = S.CallsEHReturn;
+  CallsUnwindInit = S.CallsUnwindInit;
+  HasEHFunclets = S.HasEHFunclets;
+  PersonalityTypeCache = S.PersonalityTypeCache;
+  VariableDbgInfos = std::move(S.VariableDbgInfos);
+  SavedStates.erase(I);
+}
+
 //===- Address of Block Management ----------------------------------------===//
 
 /// getAddrLabelSymbolToEmit - Return the symbol to be used for the specified
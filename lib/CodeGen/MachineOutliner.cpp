@@ -0,0 +1,595 @@
+//===-- MachineOutliner.cpp - Outline repeated instruction sequences ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass replaces sequences of machine instructions that repeat across the
+// module with calls to a single outlined copy of the sequence.
+//
+// Every instruction of every function that the target allows outlining from
+// is hashed to an integer, identical instructions getting the same integer.
+// The blocks of the module then form one string of integers, over which a
+// suffix tree is built. Each internal node of the tree is a substring that
+// occurs more than once; when the instructions saved by replacing its
+// occurrences with calls outweigh the cost of the calls and of the new
+// function, the sequence is outlined.
+//
+// The pass runs after block placement, once the code no longer changes, and
+// needs the machine functions of the whole module at once, so it is only run
+// when MachineModuleInfo retains them. Targets opt in through the outlining
+// hooks of TargetInstrInfo, which decide which instructions may be outlined,
+// what a call costs and how the call and the outlined function are built.
+//
+// The pass is off by default, enable it with -enable-machine-outliner. The
+// size savings are reported by -stats, the compile time by -time-passes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetInstrInfo.h"
+#include "llvm/Target/TargetSubtargetInfo.h"
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+#define DEBUG_TYPE "machine-outliner"
+
+STATISTIC(NumOutlined, "Number of sequences outlined");
+STATISTIC(FunctionsCreated, "Number of functions created");
+STATISTIC(NumInstrsSaved, "Number of instructions saved by outlining");
+
+namespace {
+
+const unsigned EmptyIdx = ~0U;
+
+/// A node in a suffix tree. The edge into a node is labelled with the
+/// substring [StartIdx, EndIdx] of the string the tree was built from.
+struct SuffixTreeNode {
+  /// The children of this node, keyed by the first element of their edge.
+  DenseMap<unsigned, SuffixTreeNode *> Children;
+
+  /// Start of the substring labelling the edge into this node.
+  unsigned StartIdx;
+
+  /// End of that substring, inclusive. Leaves end at the end of the string
+  /// built so far, see SuffixTree::LeafEndIdx.
+  unsigned EndIdx;
+
+  bool IsLeaf;
+
+  /// For leaves, the start of the suffix spelled by the path to the leaf.
+  unsigned SuffixIdx;
+
+  /// The length of the string spelled by the path from the root to the end of
+  /// this node.
+  unsigned ConcatLen;
+
+  /// The suffix link used by Ukkonen's algorithm.
+  SuffixTreeNode *Link;
+
+  SuffixTreeNode(unsigned StartIdx, unsigned EndIdx, bool IsLeaf)
+      : StartIdx(StartIdx), EndIdx(EndIdx), IsLeaf(IsLeaf),
+        SuffixIdx(EmptyIdx), ConcatLen(0), Link(nullptr) {}
+};
+
+/// A suffix tree, built in linear time with Ukkonen's algorithm. The last
+/// element of the string must be unique, so that every suffix ends in a leaf.
+class SuffixTree {
+  ArrayRef<unsigned> Str;
+  SpecificBumpPtrAllocator<SuffixTreeNode> NodeAllocator;
+  SuffixTreeNode *Root;
+
+  /// The end of every leaf edge, which grows with the tree.
+  unsigned LeafEndIdx;
+
+  /// Where the next suffix is inserted: Len elements down the edge from Node
+  /// that starts with Str[Idx].
+  struct {
+    SuffixTreeNode *Node;
+    unsigned Idx;
+    unsigned Len;
+  } Active;
+
+  SuffixTreeNode *insertNode(SuffixTreeNode *Parent, unsigned StartIdx,
+                             unsigned EndIdx, bool IsLeaf) {
+    SuffixTreeNode *N = new (NodeAllocator.Allocate())
+        SuffixTreeNode(StartIdx, EndIdx, IsLeaf);
+    if (Parent)
+      Parent->Children[Str[StartIdx]] = N;
+    return N;
+  }
+
+  unsigned edgeLength(const SuffixTreeNode &N) const {
+    return (N.IsLeaf ? LeafEndIdx : N.EndIdx) - N.StartIdx + 1;
+  }
+
+  /// Add the suffixes ending at EndIdx that are not in the tree yet, and
+  /// return how many are still pending.
+  unsigned extend(unsigned EndIdx, unsigned SuffixesToAdd);
+
+  /// Compute ConcatLen for every node, and SuffixIdx for every leaf.
+  void setSuffixIndices();
+
+public:
+  explicit SuffixTree(ArrayRef<unsigned> Str);
+
+  /// Call \p Callback with the length and the start indices of each
+  /// substring of at least \p MinLen elements that occurs more than once.
+  void findRepeats(unsigned MinLen,
+                   function_ref<void(unsigned, ArrayRef<unsigned>)> Callback);
+};
+
+SuffixTree::SuffixTree(ArrayRef<unsigned> Str) : Str(Str) {
+  Root = insertNode(nullptr, EmptyIdx, EmptyIdx, false);
+  Active.Node = Root;
+  Active.Idx = EmptyIdx;
+  Active.Len = 0;
+
+  unsigned SuffixesToAdd = 0;
+  for (unsigned EndIdx = 0, E = Str.size(); EndIdx != E; ++EndIdx) {
+    LeafEndIdx = EndIdx;
+    SuffixesToAdd = extend(EndIdx, SuffixesToAdd + 1);
+  }
+  assert(SuffixesToAdd == 0 && "Last element of the string is not unique!");
+
+  setSuffixIndices();
+}
+
+unsigned SuffixTree::extend(unsigned EndIdx, unsigned SuffixesToAdd) {
+  // The last internal node created, which links to the next one we visit.
+  SuffixTreeNode *NeedsLink = nullptr;
+
+  while (SuffixesToAdd > 0) {
+    if (Active.Len == 0)
+      Active.Idx = EndIdx;
+
+    unsigned FirstChar = Str[Active.Idx];
+    auto I = Active.Node->Children.find(FirstChar);
+    if (I == Active.Node->Children.end()) {
+      // Nothing starts with FirstChar yet, hang a new leaf off Active.Node.
+      insertNode(Active.Node, EndIdx, EmptyIdx, true);
+      if (NeedsLink) {
+        NeedsLink->Link = Active.Node;
+        NeedsLink = nullptr;
+      }
+    } else {
+      SuffixTreeNode *Next = I->second;
+      unsigned SubLen = edgeLength(*Next);
+
+      // Walk down the edge if the active point lies past its end.
+      if (Active.Len >= SubLen) {
+        Active.Idx += SubLen;
+        Active.Len -= SubLen;
+        Active.Node = Next;
+        continue;
+      }
+
+      unsigned LastChar = Str[EndIdx];
+
+      // The suffix is already in the tree, and so are all shorter ones.
+      if (Str[Next->StartIdx + Active.Len] == LastChar) {
+        if (NeedsLink && Active.Node != Root) {
+          NeedsLink->Link = Active.Node;
+          NeedsLink = nullptr;
+        }
+        ++Active.Len;
+        break;
+      }
+
+      // The suffix leaves the edge in the middle: split the edge, and hang a
+      // new leaf off the split point.
+      SuffixTreeNode *Split = insertNode(Active.Node, Next->StartIdx,
+                                         Next->StartIdx + Active.Len - 1,
+                                         false);
+      insertNode(Split, EndIdx, EmptyIdx, true);
+      Next->StartIdx += Active.Len;
+      Split->Children[Str[Next->StartIdx]] = Next;
+
+      if (NeedsLink)
+        NeedsLink->Link = Split;
+      NeedsLink = Split;
+    }
+
+    --SuffixesToAdd;
+
+    // Move to the next shorter suffix.
+    if (Active.Node == Root) {
+      if (Active.Len > 0) {
+        --Active.Len;
+        Active.Idx = EndIdx - SuffixesToAdd + 1;
+      }
+    } else {
+      Active.Node = Active.Node->Link ? Active.Node->Link : Root;
+    }
+  }
+
+  return SuffixesToAdd;
+}
+
+void SuffixTree::setSuffixIndices() {
+  // The tree can be as deep as the string is long, so don't recurse.
+  SmallVector<SuffixTreeNode *, 32> Worklist(1, Root);
+  while (!Worklist.empty()) {
+    SuffixTreeNode *N = Worklist.pop_back_val();
+    for (auto &Child : N->Children) {
+      SuffixTreeNode *C = Child.second;
+      C->ConcatLen = N->ConcatLen + edgeLength(*C);
+      if (C->IsLeaf)
+        C->SuffixIdx = Str.size() - C->ConcatLen;
+      else
+        Worklist.push_back(C);
+    }
+  }
+}
+
+void SuffixTree::findRepeats(
+    unsigned MinLen,
+    function_ref<void(unsigned, ArrayRef<unsigned>)> Callback) {
+  SmallVector<SuffixTreeNode *, 32> Worklist(1, Root);
+  SmallVector<unsigned, 8> Starts;
+  while (!Worklist.empty()) {
+    SuffixTreeNode *N = Worklist.pop_back_val();
+
+    // Every leaf directly below an internal node is an occurrence of the
+    // string spelled by the node. Looking at the leaf children only, rather
+    // than the whole subtree, keeps this linear in the size of the tree.
+    Starts.clear();
+    for (auto &Child : N->Children) {
+      SuffixTreeNode *C = Child.second;
+      if (C->IsLeaf)
+        Starts.push_back(C->SuffixIdx);
+      else
+        Worklist.push_back(C);
+    }
+
+    if (N != Root && N->ConcatLen >= MinLen && Starts.size() > 1)
+      Callback(N->ConcatLen, Starts);
+  }
+}
+
+/// Maps the instructions of the module to a string of integers.
+struct InstructionMapper {
+  /// The integer given to the next illegal instruction. Illegal instructions
+  /// are all different, so they can't be part of a repeated sequence. Count
+  /// down from below the empty and tombstone keys of DenseMap<unsigned>.
+  unsigned IllegalInstrNumber = ~0U - 2;
+
+  /// The integer given to the next new legal instruction.
+  unsigned LegalInstrNumber = 0;
+
+  /// The integer given to each distinct legal instruction.
+  DenseMap<MachineInstr *, unsigned, MachineInstrExpressionTrait>
+      InstructionIntegerMap;
+
+  /// The string the suffix tree is built from.
+  std::vector<unsigned> UnsignedVec;
+
+  /// The instruction each element of UnsignedVec stands for.
+  std::vector<MachineBasicBlock::iterator> InstrList;
+
+  void mapLegal(MachineBasicBlock::iterator It) {
+    auto Ins = InstructionIntegerMap.insert(
+        std::make_pair(&*It, LegalInstrNumber));
+    if (Ins.second)
+      ++LegalInstrNumber;
+    UnsignedVec.push_back(Ins.first->second);
+    InstrList.push_back(It);
+  }
+
+  void mapIllegal(MachineBasicBlock::iterator It) {
+    UnsignedVec.push_back(IllegalInstrNumber--);
+    InstrList.push_back(It);
+    assert(LegalInstrNumber < IllegalInstrNumber &&
+           "Instruction mapping overflow!");
+  }
+
+  void convertToUnsignedVec(MachineBasicBlock &MBB,
+                            const TargetInstrInfo &TII);
+};
+
+/// Return true if \p MI refers to something that only exists in its own
+/// function, so that a copy in another function would mean something else.
+static bool isFunctionLocal(const MachineInstr &MI) {
+  if (MI.isPosition() || MI.isInlineAsm() || MI.isBundle())
+    return true;
+  for (const MachineOperand &MO : MI.operands())
+    if (MO.isMBB() || MO.isFI() || MO.isCPI() || MO.isJTI() ||
+        MO.isTargetIndex() || MO.isCFIIndex())
+      return true;
+  return false;
+}
+
+void InstructionMapper::convertToUnsignedVec(MachineBasicBlock &MBB,
+                                             const TargetInstrInfo &TII) {
+  for (MachineBasicBlock::iterator It = MBB.begin(), E = MBB.end(); It != E;
+       ++It) {
+    switch (TII.getOutliningType(*It)) {
+    case TargetInstrInfo::Illegal:
+      mapIllegal(It);
+      break;
+    case TargetInstrInfo::Legal:
+      if (isFunctionLocal(*It))
+        mapIllegal(It);
+      else
+        mapLegal(It);
+      break;
+    case TargetInstrInfo::Invisible:
+      break;
+    }
+  }
+
+  // Sequences must not run from one block into the next.
+  mapIllegal(MBB.end());
+}
+
+/// A sequence of instructions and the places it occurs at.
+struct OutlinedFunction {
+  /// The start of each occurrence in InstructionMapper::UnsignedVec.
+  std::vector<unsigned> Starts;
+
+  /// The number of legal instructions in the sequence.
+  unsigned Len;
+
+  /// True if the sequence ends in a return, so that the outlined function
+  /// is tail called.
+  bool IsTailCall;
+
+  /// The number of instructions saved by outlining the sequence.
+  unsigned Benefit;
+};
+
+/// Return the number of instructions saved by outlining \p Occurrences
+/// copies of a sequence of \p Len instructions, or zero if nothing is saved.
+static unsigned getBenefit(unsigned Len, unsigned Occurrences,
+                           unsigned CallOverhead, unsigned FrameOverhead) {
+  unsigned NotOutlined = Len * Occurrences;
+  unsigned Outlined = CallOverhead * Occurrences + Len + FrameOverhead;
+  return NotOutlined > Outlined ? NotOutlined - Outlined : 0;
+}
+
+/// Return true if any of the \p Len elements from \p Start is in a sequence
+/// that is outlined already.
+static bool isTaken(const BitVector &Taken, unsigned Start, unsigned Len) {
+  for (unsigned I = Start, E = Start + Len; I != E; ++I)
+    if (Taken.test(I))
+      return true;
+  return false;
+}
+
+class MachineOutliner : public ModulePass {
+public:
+  static char ID;
+
+  MachineOutliner() : ModulePass(ID) {
+    initializeMachineOutlinerPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override { return "Machine Outliner"; }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<MachineModuleInfo>();
+    AU.addPreserved<MachineModuleInfo>();
+    ModulePass::getAnalysisUsage(AU);
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  /// Collect the repeated sequences worth outlining.
+  std::vector<OutlinedFunction> findCandidates(SuffixTree &ST,
+                                               InstructionMapper &Mapper);
+
+  /// Drop the occurrences that overlap a more beneficial sequence, and the
+  /// sequences that are no longer worth outlining.
+  void pruneOverlaps(std::vector<OutlinedFunction> &Functions,
+                     InstructionMapper &Mapper);
+
+  /// Create the function for \p OF and replace its occurrences by calls.
+  void outline(Module &M, MachineModuleInfo &MMI, const OutlinedFunction &OF,
+               InstructionMapper &Mapper);
+
+  unsigned OutlinedFunctionNum = 0;
+};
+
+} // end anonymous namespace
+
+char MachineOutliner::ID = 0;
+
+INITIALIZE_PASS_BEGIN(MachineOutliner, "machine-outliner",
+                      "Machine Function Outliner", false, false)
+INITIALIZE_PASS_DEPENDENCY(MachineModuleInfo)
+INITIALIZE_PASS_END(MachineOutliner, "machine-outliner",
+                    "Machine Function Outliner", false, false)
+
+ModulePass *llvm::createMachineOutlinerPass() { return new MachineOutliner(); }
+
+std::vector<OutlinedFunction>
+MachineOutliner::findCandidates(SuffixTree &ST, InstructionMapper &Mapper) {
+  std::vector<OutlinedFunction> Functions;
+  ST.findRepeats(2, [&](unsigned Len, ArrayRef<unsigned> Starts) {
+    // All occurrences are the same, so ask the target about the first one.
+    MachineBasicBlock::iterator LastIt = Mapper.InstrList[Starts[0] + Len - 1];
+    const TargetInstrInfo &TII =
+        *LastIt->getParent()->getParent()->getSubtarget().getInstrInfo();
+    bool IsTailCall = LastIt->isReturn();
+    unsigned CallOverhead = TII.getOutliningCallOverhead(IsTailCall);
+
+    // Branches have been relaxed already, so never make a block longer.
+    if (Len < CallOverhead)
+      return;
+
+    unsigned Benefit =
+        getBenefit(Len, Starts.size(), CallOverhead,
+                   TII.getOutliningFrameOverhead(IsTailCall));
+    if (!Benefit)
+      return;
+
+    OutlinedFunction OF;
+    OF.Starts.assign(Starts.begin(), Starts.end());
+    std::sort(OF.Starts.begin(), OF.Starts.end());
+    OF.Len = Len;
+    OF.IsTailCall = IsTailCall;
+    OF.Benefit = Benefit;
+    Functions.push_back(std::move(OF));
+  });
+  return Functions;
+}
+
+void MachineOutliner::pruneOverlaps(std::vector<OutlinedFunction> &Functions,
+                                    InstructionMapper &Mapper) {
+  std::stable_sort(Functions.begin(), Functions.end(),
+                   [](const OutlinedFunction &LHS,
+                      const OutlinedFunction &RHS) {
+                     return LHS.Benefit > RHS.Benefit;
+                   });
+
+  BitVector Taken(Mapper.UnsignedVec.size());
+  std::vector<OutlinedFunction> Kept;
+  for (OutlinedFunction &OF : Functions) {
+    std::vector<unsigned> Starts;
+    for (unsigned Start : OF.Starts) {
+      // Occurrences of the same sequence may overlap each other, as in
+      // "aaa". Starts is sorted, so only the previous one can.
+      if (!Starts.empty() && Starts.back() + OF.Len > Start)
+        continue;
+      if (isTaken(Taken, Start, OF.Len))
+        continue;
+      Starts.push_back(Start);
+    }
+
+    if (Starts.size() < 2)
+      continue;
+
+    MachineBasicBlock::iterator LastIt =
+        Mapper.InstrList[Starts[0] + OF.Len - 1];
+    const TargetInstrInfo &TII =
+        *LastIt->getParent()->getParent()->getSubtarget().getInstrInfo();
+    OF.Benefit =
+        getBenefit(OF.Len, Starts.size(),
+                   TII.getOutliningCallOverhead(OF.IsTailCall),
+                   TII.getOutliningFrameOverhead(OF.IsTailCall));
+    if (!OF.Benefit)
+      continue;
+
+    for (unsigned Start : Starts)
+      Taken.set(Start, Start + OF.Len);
+    OF.Starts = std::move(Starts);
+    Kept.push_back(std::move(OF));
+  }
+  Functions = std::move(Kept);
+}
+
+void MachineOutliner::outline(Module &M, MachineModuleInfo &MMI,
+                              const OutlinedFunction &OF,
+                              InstructionMapper &Mapper) {
+  MachineBasicBlock::iterator FirstIt = Mapper.InstrList[OF.Starts[0]];
+  MachineBasicBlock::iterator LastIt =
+      Mapper.InstrList[OF.Starts[0] + OF.Len - 1];
+  MachineFunction &FirstMF = *FirstIt->getParent()->getParent();
+  const Function &FirstF = *FirstMF.getFunction();
+  const TargetInstrInfo &TII = *FirstMF.getSubtarget().getInstrInfo();
+
+  // Give the outlined function an IR body, so that the function passes that
+  // follow, like the AsmPrinter, visit it.
+  LLVMContext &C = M.getContext();
+  Function *F = Function::Create(FunctionType::get(Type::getVoidTy(C), false),
+                                 GlobalValue::InternalLinkage,
+                                 "OUTLINED_FUNCTION_" +
+                                     Twine(OutlinedFunctionNum++),
+                                 &M);
+  F->setUnnamedAddr(true);
+  F->addFnAttr(Attribute::OptimizeForSize);
+  F->addFnAttr(Attribute::MinSize);
+  F->addFnAttr(Attribute::NoUnwind);
+  for (StringRef Kind : {"target-cpu", "target-features"})
+    if (FirstF.hasFnAttribute(Kind))
+      F->addFnAttr(Kind, FirstF.getFnAttribute(Kind).getValueAsString());
+  ReturnInst::Create(C, BasicBlock::Create(C, "entry", F));
+
+  MachineFunction &MF = MMI.createMachineFunction(*F, FirstMF.getTarget());
+  MF.getProperties()
+      .clear(MachineFunctionProperties::Property::IsSSA)
+      .set(MachineFunctionProperties::Property::AllVRegsAllocated);
+  MachineBasicBlock *MBB = MF.CreateMachineBasicBlock();
+  MF.push_back(MBB);
+
+  // Copy the first occurrence into the function. Its memory operands and
+  // debug locations describe the function it came from, so drop them.
+  for (MachineBasicBlock::iterator It = FirstIt, E = std::next(LastIt);
+       It != E; ++It) {
+    if (TII.getOutliningType(*It) == TargetInstrInfo::Invisible)
+      continue;
+    MachineInstr *NewMI = MF.CloneMachineInstr(&*It);
+    NewMI->dropMemRefs();
+    NewMI->setDebugLoc(DebugLoc());
+    MBB->insert(MBB->end(), NewMI);
+  }
+  TII.insertOutlinerEpilogue(*MBB, MF, OF.IsTailCall);
+
+  DEBUG(dbgs() << "Outlining " << OF.Starts.size() << " occurrences of "
+               << OF.Len << " instructions into " << F->getName()
+               << ", saving " << OF.Benefit << " instructions\n";
+        MF.print(dbgs()));
+
+  // Replace each occurrence by a call. Occurrences don't overlap, so the
+  // iterators of the others stay valid.
+  for (unsigned Start : OF.Starts) {
+    MachineBasicBlock::iterator StartIt = Mapper.InstrList[Start];
+    MachineBasicBlock::iterator EndIt = Mapper.InstrList[Start + OF.Len - 1];
+    MachineBasicBlock &CallerMBB = *StartIt->getParent();
+    const TargetInstrInfo &CallerTII =
+        *CallerMBB.getParent()->getSubtarget().getInstrInfo();
+    CallerTII.insertOutlinedCall(CallerMBB, StartIt, MF, F, OF.IsTailCall);
+    CallerMBB.erase(StartIt, std::next(EndIt));
+  }
+
+  ++FunctionsCreated;
+  NumOutlined += OF.Starts.size();
+  NumInstrsSaved += OF.Benefit;
+}
+
+bool MachineOutliner::runOnModule(Module &M) {
+  MachineModuleInfo &MMI = getAnalysis<MachineModuleInfo>();
+  if (!MMI.retainsMachineFunctions())
+    return false;
+
+  InstructionMapper Mapper;
+  for (Function &F : M) {
+    MachineFunction *MF = MMI.getMachineFunction(F);
+    if (!MF || F.hasFnAttribute(Attribute::OptimizeNone))
+      continue;
+    const TargetInstrInfo &TII = *MF->getSubtarget().getInstrInfo();
+    if (!TII.isFunctionSafeToOutlineFrom(*MF))
+      continue;
+    for (MachineBasicBlock &MBB : *MF)
+      Mapper.convertToUnsignedVec(MBB, TII);
+  }
+
+  if (Mapper.UnsignedVec.empty())
+    return false;
+
+  SuffixTree ST(Mapper.UnsignedVec);
+  std::vector<OutlinedFunction> Functions = findCandidates(ST, Mapper);
+  pruneOverlaps(Functions, Mapper);
+
+  for (const OutlinedFunction &OF : Functions)
+    outline(M, MMI, OF, Mapper);
+
+  return !Functions.empty();
+}
@@ -117,6 +117,10 @@ void MachineRegisterInfo::setSize(unsigned VReg, unsigned Size) {
   getVRegToSize()[VReg] = Size;
 }
 
+void MachineRegisterInfo::clearVirtRegSizes() {
+  VRegToSize.reset();
+}
+
 unsigned
 MachineRegisterInfo::createGenericVirtualRegister(unsigned Size) {
   assert(Size && "Cannot create empty virtual register");
@@ -186,6 +186,7 @@ unsigned MachineSSAUpdater::GetValueInMiddleOfBlock(MachineBasicBlock *BB) {
   MachineBasicBlock::iterator Loc = BB->empty() ? BB->end() : BB->begin();
   MachineInstrBuilder InsertedPHI = InsertNewDef(TargetOpcode::PHI, BB,
                                                  Loc, VRC, MRI, TII);
+  InsertedPHI->reserveOperands(*BB->getParent(), 1 + 2 * PredValues.size());
 
   // Fill in all the predecessors of the PHI.
   for (unsigned i = 0, e = PredValues.size(); i != e; ++i)
@@ -299,6 +300,7 @@ public:
     MachineInstr *PHI = InsertNewDef(TargetOpcode::PHI, BB, Loc,
                                      Updater->VRC, Updater->MRI,
                                      Updater->TII);
+    PHI->reserveOperands(*BB->getParent(), 1 + 2 * NumPreds);
     return PHI->getOperand(0).getReg();
   }
 
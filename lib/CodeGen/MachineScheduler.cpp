@@ -14,6 +14,7 @@
 
 #include "llvm/CodeGen/MachineScheduler.h"
 #include "llvm/ADT/PriorityQueue.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
 #include "llvm/CodeGen/MachineDominators.h"
@@ -70,6 +71,12 @@ static bool ViewMISchedDAGs = false;
 static cl::opt<unsigned> ReadyListLimit("misched-limit", cl::Hidden,
   cl::desc("Limit ready list to N instructions"), cl::init(256));
 
+/// Avoid quadratic DAG construction in huge basic blocks by scheduling them in
+/// overlapping windows of at most N instructions.
+static cl::opt<unsigned> RegionWindowSize("misched-window", cl::Hidden,
+  cl::desc("Schedule regions larger than N instructions in overlapping "
+           "windows of N instructions (0 = no limit)"), cl::init(2048));
+
 static cl::opt<bool> EnableRegPressure("misched-regpressure", cl::Hidden,
   cl::desc("Enable register pressure scheduling."), cl::init(true));
 
@@ -90,6 +97,8 @@ static cl::opt<bool> VerifyScheduling("verify-misched", cl::Hidden,
 // DAG subtrees must have at least this many nodes.
 static const unsigned MinSubtreeSize = 8;
 
+STATISTIC(NumRegionWindows, "Number of windows in huge scheduling regions");
+
 // Pin the vtables to this file.
 void MachineSchedStrategy::anchor() {}
 void ScheduleDAGMutation::anchor() {}
@@ -454,14 +463,21 @@ void MachineSchedulerBase::scheduleRegions(ScheduleDAGInstrs &Scheduler,
       }
 
       // The next region starts above the previous region. Look backward in the
-      // instruction stream until we find the nearest boundary.
+      // instruction stream until we find the nearest boundary, or until the
+      // region has as many instructions as a window holds.
       unsigned NumRegionInstrs = 0;
+      bool Windowed = false;
       MachineBasicBlock::iterator I = RegionEnd;
       for (;I != MBB->begin(); --I) {
         if (isSchedBoundary(&*std::prev(I), &*MBB, MF, TII))
           break;
-        if (!I->isDebugValue())
+        if (!I->isDebugValue()) {
+          if (RegionWindowSize >= 4 && NumRegionInstrs == RegionWindowSize) {
+            Windowed = true;
+            break;
+          }
           ++NumRegionInstrs;
+        }
       }
       // Notify the scheduler of the region, even if we may skip scheduling
       // it. Perhaps it still needs to be bundled.
@@ -497,6 +513,22 @@ void MachineSchedulerBase::scheduleRegions(ScheduleDAGInstrs &Scheduler,
       // Scheduling has invalidated the current iterator 'I'. Ask the
       // scheduler for the top of it's scheduled region.
       RegionEnd = Scheduler.begin();
+
+      // The window was cut short of a real boundary. Let the next window
+      // overlap the top quarter of this one, so the instructions on either
+      // side of the cut can still be interleaved. The overlap is less than a
+      // window, so every window starts above the previous one.
+      if (Windowed) {
+        ++NumRegionWindows;
+        for (unsigned Overlap = RegionWindowSize / 4; ; ++RegionEnd) {
+          if (RegionEnd->isDebugValue())
+            continue;
+          if (Overlap-- == 0)
+            break;
+        }
+        // The loop header steps back to the end of the next window.
+        ++RegionEnd;
+      }
     }
     Scheduler.finishBlock();
     // FIXME: Ideally, no further passes should rely on kill flags. However,
@@ -12,23 +12,41 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorOr.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
 using namespace llvm;
 
+#define DEBUG_TYPE "split-codegen"
+
+STATISTIC(NumCacheHits, "Number of partitions reused from the cache");
+STATISTIC(NumCacheMisses, "Number of partitions added to the cache");
+
+static cl::opt<bool> TimeSplitCodeGen(
+    "time-split-codegen", cl::Hidden,
+    cl::desc("Time the code generation of each partition of a split module"));
+
 static void
 codegen(Module *M, llvm::raw_pwrite_stream &OS,
         std::function<std::unique_ptr<TargetMachine>()> TMFactory,
-        TargetMachine::CodeGenFileType FileType) {
+        TargetMachine::CodeGenFileType FileType, Timer *T = nullptr) {
+  TimeRegion TR(T);
   std::unique_ptr<TargetMachine> TM = TMFactory();
   legacy::PassManager CodeGenPasses;
   if (TM->addPassesToEmitFile(CodeGenPasses, OS, FileType))
@@ -36,20 +54,147 @@ codegen(Module *M, llvm::raw_pwrite_stream &OS,
   CodeGenPasses.run(*M);
 }
 
+/// Return the path of the cache entry for the output of the module with the
+/// bitcode BC.
+static std::string getCacheEntryPath(StringRef CacheDir, StringRef BC,
+                                     const TargetMachine &TM,
+                                     TargetMachine::CodeGenFileType FileType) {
+  SHA1 Hasher;
+  auto AddString = [&](StringRef Str) {
+    Hasher.update(Str);
+    // Terminate the string so that consecutive strings can't alias.
+    Hasher.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+  };
+  auto AddUint64 = [&](uint64_t I) {
+    uint8_t Data[8];
+    for (unsigned Byte = 0; Byte < 8; ++Byte)
+      Data[Byte] = I >> (Byte * 8);
+    Hasher.update(Data);
+  };
+
+  // Start with the compiler revision.
+  Hasher.update(LLVM_VERSION_STRING);
+
+  // Include the target and the options that affect code generation.
+  AddString(TM.getTargetTriple().str());
+  AddString(TM.getTargetCPU());
+  AddString(TM.getTargetFeatureString());
+  AddUint64(unsigned(TM.getRelocationModel()));
+  AddUint64(unsigned(TM.getCodeModel()));
+  AddUint64(unsigned(TM.getOptLevel()));
+  AddUint64(unsigned(FileType));
+  const TargetOptions &Opts = TM.Options;
+  for (unsigned Flag :
+       {Opts.LessPreciseFPMADOption, Opts.UnsafeFPMath, Opts.NoInfsFPMath,
+        Opts.NoNaNsFPMath, Opts.HonorSignDependentRoundingFPMathOption,
+        Opts.NoZerosInBSS, Opts.GuaranteedTailCallOpt,
+        Opts.StackSymbolOrdering, Opts.EnableFastISel, Opts.UseInitArray,
+        Opts.DisableIntegratedAS, Opts.CompressDebugSections,
+        Opts.RelaxELFRelocations, Opts.FunctionSections, Opts.DataSections,
+        Opts.UniqueSectionNames, Opts.TrapUnreachable, Opts.EmulatedTLS})
+    AddUint64(Flag);
+  AddUint64(Opts.StackAlignmentOverride);
+  AddUint64(unsigned(Opts.FloatABIType));
+  AddUint64(unsigned(Opts.AllowFPOpFusion));
+  AddUint64(unsigned(Opts.JTType));
+  AddUint64(unsigned(Opts.ThreadModel));
+  AddUint64(unsigned(Opts.EABIVersion));
+  AddUint64(unsigned(Opts.DebuggerTuning));
+  AddUint64(unsigned(Opts.ExceptionModel));
+
+  // The bitcode has the definitions of the module and the declarations that
+  // they refer to.
+  Hasher.update(BC);
+
+  SmallString<128> EntryPath;
+  sys::path::append(EntryPath, CacheDir, "llvmcache-" + toHex(Hasher.result()));
+  return EntryPath.str();
+}
+
+/// Write the cached output at EntryPath to OS. Return false if there is no such
+/// cache entry.
+static bool readCacheEntry(StringRef EntryPath, raw_pwrite_stream &OS) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(EntryPath);
+  if (!MBOrErr)
+    return false;
+  OS << (*MBOrErr)->getBuffer();
+  ++NumCacheHits;
+  return true;
+}
+
+/// Cache Output at EntryPath. The cache is only an optimization, so failing to
+/// write to it is not an error.
+static void writeCacheEntry(StringRef EntryPath, StringRef Output) {
+  // Write to a temporary file first so that concurrent compilations never
+  // read a partial entry.
+  SmallString<128> TempPath;
+  int FD;
+  if (sys::fs::createUniqueFile(EntryPath + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << Output;
+  }
+  if (sys::fs::rename(TempPath, EntryPath))
+    sys::fs::remove(TempPath);
+}
+
+/// Generate code for M into OS, through the cache entry at EntryPath if it is
+/// not empty.
+static void
+cachedCodegen(Module *M, raw_pwrite_stream &OS,
+              std::function<std::unique_ptr<TargetMachine>()> TMFactory,
+              TargetMachine::CodeGenFileType FileType, StringRef EntryPath,
+              Timer *T = nullptr) {
+  if (EntryPath.empty())
+    return codegen(M, OS, TMFactory, FileType, T);
+  SmallString<0> Output;
+  raw_svector_ostream OutputOS(Output);
+  codegen(M, OutputOS, TMFactory, FileType, T);
+  OS << Output;
+  writeCacheEntry(EntryPath, Output);
+}
+
 std::unique_ptr<Module> llvm::splitCodeGen(
     std::unique_ptr<Module> M, ArrayRef<llvm::raw_pwrite_stream *> OSs,
     ArrayRef<llvm::raw_pwrite_stream *> BCOSs,
     const std::function<std::unique_ptr<TargetMachine>()> &TMFactory,
-    TargetMachine::CodeGenFileType FileType, bool PreserveLocals) {
+    TargetMachine::CodeGenFileType FileType, bool PreserveLocals,
+    StringRef CacheDir) {
   assert(BCOSs.empty() || BCOSs.size() == OSs.size());
 
+  // A target machine to compute the keys of the cache entries with.
+  std::unique_ptr<TargetMachine> KeyTM;
+  if (!CacheDir.empty()) {
+    KeyTM = TMFactory();
+    if (sys::fs::create_directories(CacheDir))
+      CacheDir = StringRef();
+  }
+
   if (OSs.size() == 1) {
     if (!BCOSs.empty())
       WriteBitcodeToFile(M.get(), *BCOSs[0]);
-    codegen(M.get(), *OSs[0], TMFactory, FileType);
+    std::string EntryPath;
+    if (!CacheDir.empty()) {
+      SmallString<0> BC;
+      raw_svector_ostream BCOS(BC);
+      WriteBitcodeToFile(M.get(), BCOS);
+      EntryPath = getCacheEntryPath(CacheDir, BC, *KeyTM, FileType);
+      if (readCacheEntry(EntryPath, *OSs[0]))
+        return M;
+      ++NumCacheMisses;
+    }
+    cachedCodegen(M.get(), *OSs[0], TMFactory, FileType, EntryPath);
     return M;
   }
 
+  // Timers for the partitions. They are declared outside of the scope of the
+  // ThreadPool so that they are only reported once all the partitions are
+  // done.
+  TimerGroup PartitionTG("Split Module Code Generation");
+  std::vector<std::unique_ptr<Timer>> PartitionTimers;
+
   // Create ThreadPool in nested scope so that threads will be joined
   // on destruction.
   {
@@ -74,10 +219,33 @@ std::unique_ptr<Module> llvm::splitCodeGen(
             BCOSs[ThreadCount]->flush();
           }
 
+          Timer *PartitionTimer = nullptr;
+          if (TimeSplitCodeGen) {
+            unsigned NumInsts = 0;
+            for (const Function &F : *MPart)
+              for (const BasicBlock &BB : F)
+                NumInsts += BB.size();
+            PartitionTimers.push_back(llvm::make_unique<Timer>(
+                "Partition " + utostr(ThreadCount) + " (" + utostr(NumInsts) +
+                    " instructions)",
+                PartitionTG));
+            PartitionTimer = PartitionTimers.back().get();
+          }
+
           llvm::raw_pwrite_stream *ThreadOS = OSs[ThreadCount++];
+          std::string EntryPath;
+          if (!CacheDir.empty()) {
+            EntryPath = getCacheEntryPath(
+                CacheDir, StringRef(BC.data(), BC.size()), *KeyTM, FileType);
+            if (readCacheEntry(EntryPath, *ThreadOS))
+              return;
+            ++NumCacheMisses;
+          }
+
           // Enqueue the task
           CodegenThreadPool.async(
-              [TMFactory, FileType, ThreadOS](const SmallString<0> &BC) {
+              [TMFactory, FileType, ThreadOS, PartitionTimer,
+               EntryPath](const SmallString<0> &BC) {
                 LLVMContext Ctx;
                 ErrorOr<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
                     MemoryBufferRef(StringRef(BC.data(), BC.size()),
@@ -87,13 +255,14 @@ std::unique_ptr<Module> llvm::splitCodeGen(
                   report_fatal_error("Failed to read bitcode");
                 std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
 
-                codegen(MPartInCtx.get(), *ThreadOS, TMFactory, FileType);
+                cachedCodegen(MPartInCtx.get(), *ThreadOS, TMFactory,
+                              FileType, EntryPath, PartitionTimer);
               },
               // Pass BC using std::move to ensure that it get moved rather than
               // copied into the thread's context.
               std::move(BC));
         },
-        PreserveLocals);
+        PreserveLocals, /* BalanceByCost */ CacheDir.empty());
   }
 
   return {};
@@ -303,12 +303,13 @@ void PEI::calculateSaveRestoreBlocks(MachineFunction &Fn) {
   if (MFI->getSavePoint()) {
     SaveBlocks.push_back(MFI->getSavePoint());
     assert(MFI->getRestorePoint() && "Both restore and save must be set");
-    MachineBasicBlock *RestoreBlock = MFI->getRestorePoint();
-    // If RestoreBlock does not have any successor and is not a return block
-    // then the end point is unreachable and we do not need to insert any
-    // epilogue.
-    if (!RestoreBlock->succ_empty() || RestoreBlock->isReturnBlock())
-      RestoreBlocks.push_back(RestoreBlock);
+    for (MachineBasicBlock *RestoreBlock : MFI->getRestorePoints()) {
+      // If RestoreBlock does not have any successor and is not a return block
+      // then the end point is unreachable and we do not need to insert any
+      // epilogue.
+      if (!RestoreBlock->succ_empty() || RestoreBlock->isReturnBlock())
+        RestoreBlocks.push_back(RestoreBlock);
+    }
     return;
   }
 
@@ -420,18 +421,16 @@ static void updateLiveness(MachineFunction &MF) {
   }
   Visited.insert(Save);
 
-  MachineBasicBlock *Restore = MFI->getRestorePoint();
-  if (Restore)
-    // By construction Restore cannot be visited, otherwise it
-    // means there exists a path to Restore that does not go
-    // through Save.
-    WorkList.push_back(Restore);
+  // By construction no restore point can be visited, otherwise it means
+  // there exists a path to it that does not go through Save.
+  ArrayRef<MachineBasicBlock *> Restores = MFI->getRestorePoints();
+  WorkList.append(Restores.begin(), Restores.end());
 
   while (!WorkList.empty()) {
     const MachineBasicBlock *CurBB = WorkList.pop_back_val();
     // By construction, the region that is after the save point is
-    // dominated by the Save and post-dominated by the Restore.
-    if (CurBB == Save && Save != Restore)
+    // dominated by the Save and ends at the restore points.
+    if (CurBB == Save && find(Restores, Save) == Restores.end())
       continue;
     // Enqueue all the successors not already visited.
     // Those are by construction either before Save or after Restore.
@@ -36,6 +36,7 @@
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/CodeGen/RegisterClassInfo.h"
 #include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/PassAnalysisSupport.h"
 #include "llvm/Support/BranchProbability.h"
@@ -55,6 +56,10 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumEvictionBudgetHits,
+          "Number of evictions skipped because the eviction budget was used");
+STATISTIC(NumSplitBudgetHits,
+          "Number of splits skipped because the split budget was used");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -101,9 +106,28 @@ CSRFirstTimeCost("regalloc-csr-first-time-cost",
               cl::desc("Cost for first time use of callee-saved register."),
               cl::init(0), cl::Hidden);
 
+static cl::opt<unsigned> EvictionBudget(
+    "regalloc-greedy-eviction-budget", cl::Hidden,
+    cl::desc("Maximum number of live ranges the bounded greedy allocator "
+             "evicts in a function before it stops evicting (0 = no limit)"),
+    cl::init(20000));
+
+static cl::opt<unsigned> SplitCandidateBudget(
+    "regalloc-greedy-split-budget", cl::Hidden,
+    cl::desc("Maximum number of global split candidates the bounded greedy "
+             "allocator evaluates in a function before it stops splitting "
+             "global live ranges (0 = no limit)"),
+    cl::init(20000));
+
 static RegisterRegAlloc greedyRegAlloc("greedy", "greedy register allocator",
                                        createGreedyRegisterAllocator);
 
+static RegisterRegAlloc
+    boundedGreedyRegAlloc("greedy-bounded",
+                          "greedy register allocator with eviction and split "
+                          "budgets",
+                          createBoundedGreedyRegisterAllocator);
+
 namespace {
 class RAGreedy : public MachineFunctionPass,
                  public RegAllocBase,
@@ -313,8 +337,18 @@ class RAGreedy : public MachineFunctionPass,
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
+  /// When set, limit the evictions and global split candidates per function
+  /// to -regalloc-greedy-eviction-budget and -regalloc-greedy-split-budget.
+  /// Once a budget is used up, live ranges that would have evicted or been
+  /// split are spilled instead.
+  bool Bounded;
+  unsigned EvictionsLeft;
+  unsigned SplitCandidatesLeft;
+  bool EvictionBudgetUsed;
+  bool SplitBudgetUsed;
+
 public:
-  RAGreedy();
+  RAGreedy(bool Bounded = false);
 
   /// Return the pass name.
   const char* getPassName() const override {
@@ -442,7 +476,12 @@ FunctionPass* llvm::createGreedyRegisterAllocator() {
   return new RAGreedy();
 }
 
-RAGreedy::RAGreedy(): MachineFunctionPass(ID) {
+FunctionPass* llvm::createBoundedGreedyRegisterAllocator() {
+  return new RAGreedy(/*Bounded=*/true);
+}
+
+RAGreedy::RAGreedy(bool Bounded)
+    : MachineFunctionPass(ID), Bounded(Bounded) {
   initializeLiveDebugVariablesPass(*PassRegistry::getPassRegistry());
   initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
   initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
@@ -836,6 +875,8 @@ void RAGreedy::evictInterference(LiveInterval &VirtReg, unsigned PhysReg,
            "Cannot decrease cascade number, illegal eviction");
     ExtraRegInfo[Intf->reg].Cascade = Cascade;
     ++NumEvicted;
+    if (EvictionsLeft)
+      --EvictionsLeft;
     NewVRegs.push_back(Intf->reg);
   }
 }
@@ -860,6 +901,12 @@ unsigned RAGreedy::tryEvict(LiveInterval &VirtReg,
                             unsigned CostPerUseLimit) {
   NamedRegionTimer T("Evict", TimerGroupName, TimePassesIsEnabled);
 
+  if (Bounded && EvictionBudget && !EvictionsLeft) {
+    ++NumEvictionBudgetHits;
+    EvictionBudgetUsed = true;
+    return 0;
+  }
+
   // Keep track of the cheapest interference seen so far.
   EvictionCost BestCost;
   BestCost.setMax();
@@ -1390,6 +1437,15 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
     if (IgnoreCSR && isUnusedCalleeSavedReg(PhysReg))
       continue;
 
+    // Keep the best candidate found so far once the budget is used up.
+    if (Bounded && SplitCandidateBudget) {
+      if (!SplitCandidatesLeft) {
+        SplitBudgetUsed = true;
+        break;
+      }
+      --SplitCandidatesLeft;
+    }
+
     // Discard bad candidates before we run out of interference cache cursors.
     // This will only affect register classes with a lot of registers (>32).
     if (NumCands == IntfCache.getMaxCursors()) {
@@ -1966,6 +2022,13 @@ unsigned RAGreedy::trySplit(LiveInterval &VirtReg, AllocationOrder &Order,
 
   NamedRegionTimer T("Global Splitting", TimerGroupName, TimePassesIsEnabled);
 
+  // Spill global live ranges once the split budget is used up.
+  if (Bounded && SplitCandidateBudget && !SplitCandidatesLeft) {
+    ++NumSplitBudgetHits;
+    SplitBudgetUsed = true;
+    return 0;
+  }
+
   SA->analyze(&VirtReg);
 
   // FIXME: SplitAnalysis may repair broken live ranges coming from the
@@ -2607,11 +2670,28 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   IntfCache.init(MF, Matrix->getLiveUnions(), Indexes, LIS, TRI);
   GlobalCand.resize(32);  // This will grow as needed.
   SetOfBrokenHints.clear();
+  EvictionsLeft = EvictionBudget;
+  SplitCandidatesLeft = SplitCandidateBudget;
+  EvictionBudgetUsed = SplitBudgetUsed = false;
 
   allocatePhysRegs();
   tryHintsRecoloring();
   postOptimization();
 
+  if (EvictionBudgetUsed)
+    emitOptimizationRemarkAnalysis(
+        MF->getFunction()->getContext(), DEBUG_TYPE, *MF->getFunction(),
+        DebugLoc(), "register allocation used up its budget of " +
+                        Twine(EvictionBudget) +
+                        " evictions, remaining conflicts were spilled");
+  if (SplitBudgetUsed)
+    emitOptimizationRemarkAnalysis(
+        MF->getFunction()->getContext(), DEBUG_TYPE, *MF->getFunction(),
+        DebugLoc(), "register allocation used up its budget of " +
+                        Twine(SplitCandidateBudget) +
+                        " split candidates, remaining global live ranges "
+                        "were spilled");
+
   releaseMemory();
   return true;
 }
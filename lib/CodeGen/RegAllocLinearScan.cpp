@@ -0,0 +1,304 @@
+//===-- RegAllocLinearScan.cpp - Linear Scan Register Allocator -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the RALinearScan function pass, a register allocator that
+// sits between the fast and the greedy allocators. It is built on the same
+// framework as the basic and greedy allocators (LiveIntervals, LiveRegMatrix
+// and VirtRegMap), but visits live ranges in the order of their start points
+// like a classic linear scan allocator, and never splits them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/CodeGen/Passes.h"
+#include "AllocationOrder.h"
+#include "LiveDebugVariables.h"
+#include "RegAllocBase.h"
+#include "Spiller.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/CodeGen/CalcSpillWeights.h"
+#include "llvm/CodeGen/LiveIntervalAnalysis.h"
+#include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/LiveRegMatrix.h"
+#include "llvm/CodeGen/LiveStackAnalysis.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineLoopInfo.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/CodeGen/RegAllocRegistry.h"
+#include "llvm/CodeGen/VirtRegMap.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetRegisterInfo.h"
+#include <queue>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "regalloc"
+
+STATISTIC(NumEvicted, "Number of interferences evicted");
+STATISTIC(NumSpilledLS, "Number of live ranges spilled by linear scan");
+
+static RegisterRegAlloc
+linearScanRegAlloc("linearscan", "linear scan register allocator",
+                   createLinearScanRegisterAllocator);
+
+namespace {
+/// Order live ranges by their start point. Ranges starting at the same slot
+/// are ordered by decreasing spill weight, then by register number to keep
+/// the allocation deterministic.
+struct CompStartPoint {
+  bool operator()(LiveInterval *A, LiveInterval *B) const {
+    SlotIndex StartA = A->beginIndex(), StartB = B->beginIndex();
+    if (StartA != StartB)
+      return StartB < StartA;
+    if (A->weight != B->weight)
+      return A->weight < B->weight;
+    return A->reg > B->reg;
+  }
+};
+}
+
+namespace {
+/// RALinearScan assigns live virtual registers in the order they become live.
+/// A live range that finds no free register may evict interfering live ranges
+/// with a lower spill weight. Evicted ranges are queued again, but they may
+/// not be evicted a second time, so each range is visited at most twice
+/// before it is spilled. The live ranges are not split, which keeps the
+/// compile time close to the basic allocator while the eviction gets most of
+/// the benefit of the greedy allocator's priority scheme.
+class RALinearScan : public MachineFunctionPass, public RegAllocBase {
+  // context
+  MachineFunction *MF;
+
+  // state
+  std::unique_ptr<Spiller> SpillerInstance;
+  std::priority_queue<LiveInterval*, std::vector<LiveInterval*>,
+                      CompStartPoint> Queue;
+
+  /// Virtual registers that have been evicted once and may not be evicted
+  /// again. Register numbers are not reused, unlike LiveInterval addresses.
+  DenseSet<unsigned> Evicted;
+
+public:
+  RALinearScan();
+
+  /// Return the pass name.
+  const char* getPassName() const override {
+    return "Linear Scan Register Allocator";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
+
+  void releaseMemory() override;
+
+  Spiller &spiller() override { return *SpillerInstance; }
+
+  void enqueue(LiveInterval *LI) override {
+    Queue.push(LI);
+  }
+
+  LiveInterval *dequeue() override {
+    if (Queue.empty())
+      return nullptr;
+    LiveInterval *LI = Queue.top();
+    Queue.pop();
+    return LI;
+  }
+
+  unsigned selectOrSplit(LiveInterval &VirtReg,
+                         SmallVectorImpl<unsigned> &SplitVRegs) override;
+
+  /// Perform register allocation.
+  bool runOnMachineFunction(MachineFunction &mf) override;
+
+  static char ID;
+
+private:
+  /// Return the largest spill weight of the live ranges assigned to PhysReg
+  /// or its aliases that interfere with VirtReg, or a negative value if they
+  /// cannot be evicted in favor of VirtReg.
+  float getEvictionCost(LiveInterval &VirtReg, unsigned PhysReg);
+
+  /// Unassign the live ranges that interfere with VirtReg on PhysReg and put
+  /// them back on the queue.
+  void evictInterferences(LiveInterval &VirtReg, unsigned PhysReg);
+};
+
+char RALinearScan::ID = 0;
+
+} // end anonymous namespace
+
+RALinearScan::RALinearScan(): MachineFunctionPass(ID) {
+  initializeLiveDebugVariablesPass(*PassRegistry::getPassRegistry());
+  initializeLiveIntervalsPass(*PassRegistry::getPassRegistry());
+  initializeSlotIndexesPass(*PassRegistry::getPassRegistry());
+  initializeRegisterCoalescerPass(*PassRegistry::getPassRegistry());
+  initializeMachineSchedulerPass(*PassRegistry::getPassRegistry());
+  initializeLiveStacksPass(*PassRegistry::getPassRegistry());
+  initializeMachineDominatorTreePass(*PassRegistry::getPassRegistry());
+  initializeMachineLoopInfoPass(*PassRegistry::getPassRegistry());
+  initializeVirtRegMapPass(*PassRegistry::getPassRegistry());
+  initializeLiveRegMatrixPass(*PassRegistry::getPassRegistry());
+}
+
+void RALinearScan::getAnalysisUsage(AnalysisUsage &AU) const {
+  AU.setPreservesCFG();
+  AU.addRequired<AAResultsWrapperPass>();
+  AU.addPreserved<AAResultsWrapperPass>();
+  AU.addRequired<LiveIntervals>();
+  AU.addPreserved<LiveIntervals>();
+  AU.addPreserved<SlotIndexes>();
+  AU.addRequired<LiveDebugVariables>();
+  AU.addPreserved<LiveDebugVariables>();
+  AU.addRequired<LiveStacks>();
+  AU.addPreserved<LiveStacks>();
+  AU.addRequired<MachineBlockFrequencyInfo>();
+  AU.addPreserved<MachineBlockFrequencyInfo>();
+  AU.addRequiredID(MachineDominatorsID);
+  AU.addPreservedID(MachineDominatorsID);
+  AU.addRequired<MachineLoopInfo>();
+  AU.addPreserved<MachineLoopInfo>();
+  AU.addRequired<VirtRegMap>();
+  AU.addPreserved<VirtRegMap>();
+  AU.addRequired<LiveRegMatrix>();
+  AU.addPreserved<LiveRegMatrix>();
+  MachineFunctionPass::getAnalysisUsage(AU);
+}
+
+void RALinearScan::releaseMemory() {
+  SpillerInstance.reset();
+  Evicted.clear();
+}
+
+float RALinearScan::getEvictionCost(LiveInterval &VirtReg, unsigned PhysReg) {
+  float Cost = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    if (Q.seenUnspillableVReg())
+      return -1;
+    for (LiveInterval *Intf : Q.interferingVRegs()) {
+      if (!Intf->isSpillable() || Intf->weight >= VirtReg.weight ||
+          Evicted.count(Intf->reg))
+        return -1;
+      Cost = std::max(Cost, Intf->weight);
+    }
+  }
+  return Cost;
+}
+
+void RALinearScan::evictInterferences(LiveInterval &VirtReg,
+                                      unsigned PhysReg) {
+  // Collect all interferences before unassigning any of them, the queries
+  // are invalidated by the first change to the matrix.
+  SmallVector<LiveInterval*, 8> Intfs;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units) {
+    LiveIntervalUnion::Query &Q = Matrix->query(VirtReg, *Units);
+    Q.collectInterferingVRegs();
+    Intfs.append(Q.interferingVRegs().begin(), Q.interferingVRegs().end());
+  }
+
+  for (LiveInterval *Intf : Intfs) {
+    // The same live range may interfere on several register units.
+    if (!VRM->hasPhys(Intf->reg))
+      continue;
+    DEBUG(dbgs() << "evicting " << PrintReg(Intf->reg, TRI) << " from "
+                 << TRI->getName(PhysReg) << '\n');
+    Matrix->unassign(*Intf);
+    Evicted.insert(Intf->reg);
+    enqueue(Intf);
+    ++NumEvicted;
+  }
+}
+
+// Assign VirtReg to the first free register in its allocation order, which
+// starts with the hints. When every register is taken, evict the cheapest set
+// of lighter interfering live ranges, and spill VirtReg if there is none.
+unsigned RALinearScan::selectOrSplit(LiveInterval &VirtReg,
+                                     SmallVectorImpl<unsigned> &SplitVRegs) {
+  SmallVector<unsigned, 8> PhysRegEvictCands;
+
+  AllocationOrder Order(VirtReg.reg, *VRM, RegClassInfo, Matrix);
+  while (unsigned PhysReg = Order.next()) {
+    switch (Matrix->checkInterference(VirtReg, PhysReg)) {
+    case LiveRegMatrix::IK_Free:
+      return PhysReg;
+
+    case LiveRegMatrix::IK_VirtReg:
+      // Only virtual registers in the way, we may be able to evict them.
+      PhysRegEvictCands.push_back(PhysReg);
+      continue;
+
+    default:
+      // RegMask or RegUnit interference.
+      continue;
+    }
+  }
+
+  unsigned BestPhys = 0;
+  float BestCost = 0;
+  for (unsigned PhysReg : PhysRegEvictCands) {
+    float Cost = getEvictionCost(VirtReg, PhysReg);
+    if (Cost < 0 || (BestPhys && Cost >= BestCost))
+      continue;
+    BestPhys = PhysReg;
+    BestCost = Cost;
+  }
+
+  if (BestPhys) {
+    evictInterferences(VirtReg, BestPhys);
+    assert(!Matrix->checkInterference(VirtReg, BestPhys) &&
+           "Interference after eviction.");
+    return BestPhys;
+  }
+
+  DEBUG(dbgs() << "spilling: " << VirtReg << '\n');
+  if (!VirtReg.isSpillable())
+    return ~0u;
+  ++NumSpilledLS;
+  LiveRangeEdit LRE(&VirtReg, SplitVRegs, *MF, *LIS, VRM, nullptr, &DeadRemats);
+  spiller().spill(LRE);
+
+  // The live virtual register requesting allocation was spilled, so tell
+  // the caller not to allocate anything during this round.
+  return 0;
+}
+
+bool RALinearScan::runOnMachineFunction(MachineFunction &mf) {
+  DEBUG(dbgs() << "********** LINEAR SCAN REGISTER ALLOCATION **********\n"
+               << "********** Function: "
+               << mf.getName() << '\n');
+
+  MF = &mf;
+  RegAllocBase::init(getAnalysis<VirtRegMap>(),
+                     getAnalysis<LiveIntervals>(),
+                     getAnalysis<LiveRegMatrix>());
+
+  calculateSpillWeightsAndHints(*LIS, *MF, VRM,
+                                getAnalysis<MachineLoopInfo>(),
+                                getAnalysis<MachineBlockFrequencyInfo>());
+
+  SpillerInstance.reset(createInlineSpiller(*this, *MF, *VRM));
+
+  allocatePhysRegs();
+  postOptimization();
+
+  // Diagnostic output before rewriting
+  DEBUG(dbgs() << "Post alloc VirtRegMap:\n" << *VRM << "\n");
+
+  releaseMemory();
+  return true;
+}
+
+FunctionPass* llvm::createLinearScanRegisterAllocator() {
+  return new RALinearScan();
+}
@@ -14,12 +14,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "RegisterCoalescer.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/CodeGen/LiveIntervalAnalysis.h"
 #include "llvm/CodeGen/LiveRangeEdit.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
 #include "llvm/CodeGen/MachineInstr.h"
 #include "llvm/CodeGen/MachineLoopInfo.h"
@@ -51,6 +53,11 @@ STATISTIC(NumReMats   , "Number of instructions re-materialized");
 STATISTIC(NumInflated , "Number of register classes inflated");
 STATISTIC(NumLaneConflicts, "Number of dead lane conflicts tested");
 STATISTIC(NumLaneResolves,  "Number of dead lane conflicts resolved");
+STATISTIC(NumJoinRetries,   "Number of copies retried after interference");
+STATISTIC(NumRetriesSkipped,
+          "Number of retries skipped because the intervals did not change");
+STATISTIC(NumRetryBudgetExhausted,
+          "Number of functions where the coalescer ran out of retries");
 
 static cl::opt<bool>
 EnableJoining("join-liveintervals",
@@ -72,6 +79,18 @@ EnableGlobalCopies("join-globalcopies",
   cl::desc("Coalesce copies that span blocks (default=subtarget)"),
   cl::init(cl::BOU_UNSET), cl::Hidden);
 
+static cl::opt<bool>
+JoinByBlockFreq("join-by-block-freq",
+  cl::desc("Coalesce the copies of hotter blocks first among blocks of the "
+           "same loop depth"),
+  cl::init(false), cl::Hidden);
+
+static cl::opt<unsigned>
+JoinRetryBudget("join-retry-budget",
+  cl::desc("Maximum number of times copies that failed to coalesce are "
+           "retried per function"),
+  cl::init(1u << 20), cl::Hidden);
+
 static cl::opt<bool>
 VerifyCoalescing("verify-coalescing",
          cl::desc("Verify machine instrs before and after register coalescing"),
@@ -87,6 +106,7 @@ namespace {
     const TargetInstrInfo* TII;
     LiveIntervals *LIS;
     const MachineLoopInfo* Loops;
+    const MachineBlockFrequencyInfo *MBFI;
     AliasAnalysis *AA;
     RegisterClassInfo RegClassInfo;
 
@@ -117,14 +137,49 @@ namespace {
     /// Dead instructions that are about to be deleted.
     SmallVector<MachineInstr*, 8> DeadDefs;
 
+    /// A copy that failed to coalesce because of interference, and the point
+    /// at which it failed.
+    struct FailedJoin {
+      unsigned SrcReg, DstReg, SrcIdx, DstIdx;
+      /// Value of ChangeCount when the join was attempted.
+      unsigned Count;
+    };
+
+    /// Copies in the work lists that failed to coalesce so far. Joining a
+    /// copy only depends on the live intervals of its two registers, so
+    /// retrying it before either of them changes would fail again.
+    DenseMap<const MachineInstr*, FailedJoin> FailedJoins;
+
+    /// Number of live interval changes so far, and the last change of each
+    /// virtual register.
+    unsigned ChangeCount;
+    DenseMap<unsigned, unsigned> LastChange;
+
+    /// Number of retries of failed copies left for the current function.
+    unsigned RetriesLeft;
+
     /// Virtual registers to be considered for register class inflation.
     SmallVector<unsigned, 8> InflateRegs;
 
     /// Recursively eliminate dead defs in DeadDefs.
     void eliminateDeadDefs();
 
-    /// LiveRangeEdit callback for eliminateDeadDefs().
+    /// LiveRangeEdit callbacks for eliminateDeadDefs().
     void LRE_WillEraseInstruction(MachineInstr *MI) override;
+    void LRE_WillShrinkVirtReg(unsigned VirtReg) override {
+      noteIntervalChanged(VirtReg);
+    }
+
+    /// Record that the live interval of \p Reg changed, so the copies that
+    /// failed to coalesce with it are worth retrying.
+    void noteIntervalChanged(unsigned Reg) {
+      if (TargetRegisterInfo::isVirtualRegister(Reg))
+        LastChange[Reg] = ++ChangeCount;
+    }
+
+    /// Return true if \p CopyMI failed to coalesce as described by \p FJ,
+    /// and none of the live intervals involved changed since.
+    bool isKnownToFail(const MachineInstr &CopyMI, const FailedJoin &FJ) const;
 
     /// Coalesce the LocalWorkList.
     void coalesceLocals();
@@ -236,6 +291,7 @@ namespace {
     /// mentioned method returns true.
     void shrinkToUses(LiveInterval *LI,
                       SmallVectorImpl<MachineInstr * > *Dead = nullptr) {
+      noteIntervalChanged(LI->reg);
       if (LIS->shrinkToUses(LI, Dead)) {
         /// Check whether or not \p LI is composed by multiple connected
         /// components and if that is the case, fix that.
@@ -269,6 +325,7 @@ INITIALIZE_PASS_BEGIN(RegisterCoalescer, "simple-register-coalescing",
 INITIALIZE_PASS_DEPENDENCY(LiveIntervals)
 INITIALIZE_PASS_DEPENDENCY(SlotIndexes)
 INITIALIZE_PASS_DEPENDENCY(MachineLoopInfo)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
 INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 INITIALIZE_PASS_END(RegisterCoalescer, "simple-register-coalescing",
                     "Simple Register Coalescing", false, false)
@@ -454,6 +511,8 @@ void RegisterCoalescer::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.addRequired<MachineLoopInfo>();
   AU.addPreserved<MachineLoopInfo>();
   AU.addPreservedID(MachineDominatorsID);
+  if (JoinByBlockFreq)
+    AU.addRequired<MachineBlockFrequencyInfo>();
   MachineFunctionPass::getAnalysisUsage(AU);
 }
 
@@ -2746,15 +2805,18 @@ namespace {
 struct MBBPriorityInfo {
   MachineBasicBlock *MBB;
   unsigned Depth;
+  /// Block frequency, or 0 when not ordering by frequency.
+  uint64_t Freq;
   bool IsSplit;
 
-  MBBPriorityInfo(MachineBasicBlock *mbb, unsigned depth, bool issplit)
-    : MBB(mbb), Depth(depth), IsSplit(issplit) {}
+  MBBPriorityInfo(MachineBasicBlock *mbb, unsigned depth, uint64_t freq,
+                  bool issplit)
+    : MBB(mbb), Depth(depth), Freq(freq), IsSplit(issplit) {}
 };
 }
 
 /// C-style comparator that sorts first based on the loop depth of the basic
-/// block (the unsigned), and then on the MBB number.
+/// block (the unsigned), then on its frequency, and then on the MBB number.
 ///
 /// EnableGlobalCopies assumes that the primary sort key is loop depth.
 static int compareMBBPriority(const MBBPriorityInfo *LHS,
@@ -2763,6 +2825,10 @@ static int compareMBBPriority(const MBBPriorityInfo *LHS,
   if (LHS->Depth != RHS->Depth)
     return LHS->Depth > RHS->Depth ? -1 : 1;
 
+  // Hotter blocks first.
+  if (LHS->Freq != RHS->Freq)
+    return LHS->Freq > RHS->Freq ? -1 : 1;
+
   // Try to unsplit critical edges next.
   if (LHS->IsSplit != RHS->IsSplit)
     return LHS->IsSplit ? -1 : 1;
@@ -2796,23 +2862,71 @@ static bool isLocalCopy(MachineInstr *Copy, const LiveIntervals *LIS) {
     || LIS->intervalIsInOneMBB(LIS->getInterval(DstReg));
 }
 
+bool RegisterCoalescer::isKnownToFail(const MachineInstr &CopyMI,
+                                      const FailedJoin &FJ) const {
+  // The interference with a physical register depends on all of its aliases.
+  CoalescerPair CP(*TRI);
+  if (!CP.setRegisters(&CopyMI) || CP.isPhys())
+    return false;
+  // The copy may have been rewritten to use other registers.
+  if (CP.getSrcReg() != FJ.SrcReg || CP.getDstReg() != FJ.DstReg ||
+      CP.getSrcIdx() != FJ.SrcIdx || CP.getDstIdx() != FJ.DstIdx)
+    return false;
+  return LastChange.lookup(FJ.SrcReg) <= FJ.Count &&
+         LastChange.lookup(FJ.DstReg) <= FJ.Count;
+}
+
 bool RegisterCoalescer::
 copyCoalesceWorkList(MutableArrayRef<MachineInstr*> CurrList) {
   bool Progress = false;
   for (unsigned i = 0, e = CurrList.size(); i != e; ++i) {
-    if (!CurrList[i])
+    MachineInstr *CopyMI = CurrList[i];
+    if (!CopyMI)
       continue;
     // Skip instruction pointers that have already been erased, for example by
     // dead code elimination.
-    if (ErasedInstrs.erase(CurrList[i])) {
+    if (ErasedInstrs.erase(CopyMI)) {
+      FailedJoins.erase(CopyMI);
       CurrList[i] = nullptr;
       continue;
     }
+
+    auto FJ = FailedJoins.find(CopyMI);
+    if (FJ != FailedJoins.end()) {
+      if (isKnownToFail(*CopyMI, FJ->second)) {
+        ++NumRetriesSkipped;
+        continue;
+      }
+      if (!RetriesLeft) {
+        // Leave the copy alone, without giving up on the first attempts of
+        // the copies that have not been tried yet.
+        continue;
+      }
+      if (--RetriesLeft == 0) {
+        DEBUG(dbgs() << "Out of retries for failed copies.\n");
+        ++NumRetryBudgetExhausted;
+      }
+      ++NumJoinRetries;
+    }
+
+    // Remember the registers, CopyMI is erased when the join succeeds.
+    CoalescerPair CP(*TRI);
+    bool IsCopyLike = CP.setRegisters(CopyMI);
     bool Again = false;
-    bool Success = joinCopy(CurrList[i], Again);
+    bool Success = joinCopy(CopyMI, Again);
     Progress |= Success;
-    if (Success || !Again)
+    if (Success || !Again) {
       CurrList[i] = nullptr;
+      FailedJoins.erase(CopyMI);
+      if (IsCopyLike) {
+        noteIntervalChanged(CP.getSrcReg());
+        noteIntervalChanged(CP.getDstReg());
+      }
+      continue;
+    }
+    if (IsCopyLike)
+      FailedJoins[CopyMI] = {CP.getSrcReg(), CP.getDstReg(), CP.getSrcIdx(),
+                             CP.getDstIdx(), ChangeCount};
   }
   return Progress;
 }
@@ -2950,7 +3064,8 @@ void RegisterCoalescer::joinAllIntervals() {
   MBBs.reserve(MF->size());
   for (MachineFunction::iterator I = MF->begin(), E = MF->end(); I != E; ++I) {
     MachineBasicBlock *MBB = &*I;
-    MBBs.push_back(MBBPriorityInfo(MBB, Loops->getLoopDepth(MBB),
+    uint64_t Freq = MBFI ? MBFI->getBlockFreq(MBB).getFrequency() : 0;
+    MBBs.push_back(MBBPriorityInfo(MBB, Loops->getLoopDepth(MBB), Freq,
                                    JoinSplitEdges && isSplitEdge(MBB)));
   }
   array_pod_sort(MBBs.begin(), MBBs.end(), compareMBBPriority);
@@ -2978,6 +3093,8 @@ void RegisterCoalescer::releaseMemory() {
   WorkList.clear();
   DeadDefs.clear();
   InflateRegs.clear();
+  FailedJoins.clear();
+  LastChange.clear();
 }
 
 bool RegisterCoalescer::runOnMachineFunction(MachineFunction &fn) {
@@ -2990,6 +3107,9 @@ bool RegisterCoalescer::runOnMachineFunction(MachineFunction &fn) {
   LIS = &getAnalysis<LiveIntervals>();
   AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
   Loops = &getAnalysis<MachineLoopInfo>();
+  MBFI = JoinByBlockFreq ? &getAnalysis<MachineBlockFrequencyInfo>() : nullptr;
+  ChangeCount = 0;
+  RetriesLeft = JoinRetryBudget;
   if (EnableGlobalCopies == cl::BOU_UNSET)
     JoinGlobalCopies = STI.enableJoinGlobalCopies();
   else
@@ -32,6 +32,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetLowering.h"
@@ -49,6 +50,7 @@ STATISTIC(PostIndexedNodes, "Number of post-indexed nodes created");
 STATISTIC(OpsNarrowed     , "Number of load/op/store narrowed");
 STATISTIC(LdStFP2Int      , "Number of fp load/store pairs transformed to int");
 STATISTIC(SlicedLoads, "Number of load sliced");
+STATISTIC(NodesVisitCapped, "Number of nodes that hit the revisit cap");
 
 namespace {
   static cl::opt<bool>
@@ -82,6 +84,20 @@ namespace {
     MaySplitLoadIndex("combiner-split-load-index", cl::Hidden, cl::init(true),
                       cl::desc("DAG combiner may split indexing from loads"));
 
+  /// Visiting the same node over and over is the symptom of two combines (or
+  /// a combine and legalization) undoing each other. This turns such a cycle
+  /// into a bounded amount of work.
+  static cl::opt<unsigned>
+    MaxNodeVisits("combiner-max-node-visits", cl::Hidden, cl::init(0),
+                  cl::desc("Stop combining a node after it has been visited "
+                           "this many times in one combiner run "
+                           "(0 = no limit)"));
+
+  static cl::opt<bool>
+    VisitStats("combiner-visit-stats", cl::Hidden, cl::init(false),
+               cl::desc("Print the number of visits and successful combines "
+                        "per opcode after each combiner run"));
+
 //------------------------------ DAGCombiner ---------------------------------//
 
   class DAGCombiner {
@@ -115,6 +131,19 @@ namespace {
     /// which have not yet been combined to the worklist.
     SmallPtrSet<SDNode *, 32> CombinedNodes;
 
+    /// Number of times each node has been visited, for
+    /// -combiner-max-node-visits.
+    DenseMap<SDNode *, unsigned> NodeVisits;
+
+    /// Visits and successful combines per opcode, for -combiner-visit-stats.
+    struct OpcodeStats {
+      std::string Name;
+      unsigned Visits;
+      unsigned Combines;
+      unsigned Capped;
+    };
+    DenseMap<unsigned, OpcodeStats> VisitsPerOpcode;
+
     // AA - Used for DAG load/store alias analysis.
     AliasAnalysis &AA;
 
@@ -128,6 +157,14 @@ namespace {
     /// Call the node-specific routine that folds each particular type of node.
     SDValue visit(SDNode *N);
 
+    /// Count a visit of N for -combiner-max-node-visits and
+    /// -combiner-visit-stats. Returns false if N has been visited too often and
+    /// should not be combined again.
+    bool recordVisit(SDNode *N);
+
+    /// Print the per-opcode counts collected for -combiner-visit-stats.
+    void printVisitStats();
+
   public:
     /// Add to the worklist making sure its instance is at the back (next to be
     /// processed.)
@@ -144,6 +181,7 @@ namespace {
     /// Remove all instances of N from the worklist.
     void removeFromWorklist(SDNode *N) {
       CombinedNodes.erase(N);
+      NodeVisits.erase(N);
 
       auto It = WorklistMap.find(N);
       if (It == WorklistMap.end())
@@ -1300,6 +1338,9 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
         continue;
     }
 
+    if (!recordVisit(N))
+      continue;
+
     DEBUG(dbgs() << "\nCombining: "; N->dump(&DAG));
 
     // Add any operands of the new node which have not yet been combined to the
@@ -1310,12 +1351,15 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
       if (!CombinedNodes.count(ChildN.getNode()))
         AddToWorklist(ChildN.getNode());
 
+    unsigned Opcode = N->getOpcode();
     SDValue RV = combine(N);
 
     if (!RV.getNode())
       continue;
 
     ++NodesCombined;
+    if (VisitStats)
+      ++VisitsPerOpcode[Opcode].Combines;
 
     // If we get back the same node we passed in, rather than a new node or
     // zero, we know that the node must have defined multiple values and
@@ -1356,6 +1400,58 @@ void DAGCombiner::Run(CombineLevel AtLevel) {
   // If the root changed (e.g. it was a dead load, update the root).
   DAG.setRoot(Dummy.getValue());
   DAG.RemoveDeadNodes();
+
+  if (VisitStats)
+    printVisitStats();
+}
+
+bool DAGCombiner::recordVisit(SDNode *N) {
+  OpcodeStats *Stats = nullptr;
+  if (VisitStats) {
+    auto Inserted = VisitsPerOpcode.insert(
+        std::make_pair(N->getOpcode(), OpcodeStats{std::string(), 0, 0, 0}));
+    Stats = &Inserted.first->second;
+    if (Inserted.second)
+      Stats->Name = N->getOperationName(&DAG);
+    ++Stats->Visits;
+  }
+
+  if (!MaxNodeVisits)
+    return true;
+  unsigned Visits = ++NodeVisits[N];
+  if (Visits <= MaxNodeVisits)
+    return true;
+  if (Visits == MaxNodeVisits + 1) {
+    DEBUG(dbgs() << "\nNot combining node visited " << MaxNodeVisits
+                 << " times, possible combine cycle: ";
+          N->dump(&DAG));
+    ++NodesVisitCapped;
+    if (Stats)
+      ++Stats->Capped;
+  }
+  return false;
+}
+
+void DAGCombiner::printVisitStats() {
+  std::vector<const OpcodeStats *> Sorted;
+  for (const auto &KV : VisitsPerOpcode)
+    Sorted.push_back(&KV.second);
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const OpcodeStats *A, const OpcodeStats *B) {
+    if (A->Visits != B->Visits)
+      return A->Visits > B->Visits;
+    return A->Name < B->Name;
+  });
+
+  std::unique_ptr<raw_fd_ostream> OS = CreateInfoOutputFile();
+  *OS << "DAG combiner visits in '" << DAG.getMachineFunction().getName()
+      << "' at combine level " << unsigned(Level) << ":\n";
+  *OS << "    Visits  Combines    Capped  Opcode\n";
+  for (const OpcodeStats *Stats : Sorted)
+    *OS << format("%10u%10u%10u  ", Stats->Visits, Stats->Combines,
+                  Stats->Capped)
+        << Stats->Name << '\n';
+  VisitsPerOpcode.clear();
 }
 
 SDValue DAGCombiner::visit(SDNode *N) {
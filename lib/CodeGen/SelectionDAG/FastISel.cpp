@@ -78,6 +78,8 @@ STATISTIC(NumFastIselSuccessIndependent, "Number of insts selected by "
 STATISTIC(NumFastIselSuccessTarget, "Number of insts selected by "
                                     "target-specific selector");
 STATISTIC(NumFastIselDead, "Number of dead insts removed on failure");
+STATISTIC(NumFastIselIntrinsicNodes, "Number of intrinsic calls selected "
+                                     "with the ISD node patterns");
 
 void FastISel::ArgListEntry::setAttributes(ImmutableCallSite *CS,
                                            unsigned AttrIdx) {
@@ -1239,7 +1241,82 @@ bool FastISel::selectIntrinsicCall(const IntrinsicInst *II) {
     return selectPatchpoint(II);
   }
 
-  return fastLowerIntrinsicCall(II);
+  if (fastLowerIntrinsicCall(II))
+    return true;
+  return selectIntrinsicAsNode(II);
+}
+
+/// Return the ISD opcode the intrinsic call \p II is a plain alias of, or 0
+/// if it needs more than a single node.
+static unsigned getOpcodeForSimpleIntrinsic(const IntrinsicInst *II) {
+  switch (II->getIntrinsicID()) {
+  default:
+    return 0;
+  case Intrinsic::fabs:       return ISD::FABS;
+  case Intrinsic::sqrt:       return ISD::FSQRT;
+  case Intrinsic::sin:        return ISD::FSIN;
+  case Intrinsic::cos:        return ISD::FCOS;
+  case Intrinsic::floor:      return ISD::FFLOOR;
+  case Intrinsic::ceil:       return ISD::FCEIL;
+  case Intrinsic::trunc:      return ISD::FTRUNC;
+  case Intrinsic::rint:       return ISD::FRINT;
+  case Intrinsic::nearbyint:  return ISD::FNEARBYINT;
+  case Intrinsic::round:      return ISD::FROUND;
+  case Intrinsic::minnum:     return ISD::FMINNUM;
+  case Intrinsic::maxnum:     return ISD::FMAXNUM;
+  case Intrinsic::copysign:   return ISD::FCOPYSIGN;
+  case Intrinsic::bswap:      return ISD::BSWAP;
+  case Intrinsic::bitreverse: return ISD::BITREVERSE;
+  case Intrinsic::ctpop:      return ISD::CTPOP;
+  case Intrinsic::ctlz:
+  case Intrinsic::cttz: {
+    const auto *ZeroUndef = dyn_cast<ConstantInt>(II->getArgOperand(1));
+    if (!ZeroUndef)
+      return 0;
+    if (II->getIntrinsicID() == Intrinsic::ctlz)
+      return ZeroUndef->isZero() ? ISD::CTLZ : ISD::CTLZ_ZERO_UNDEF;
+    return ZeroUndef->isZero() ? ISD::CTTZ : ISD::CTTZ_ZERO_UNDEF;
+  }
+  }
+}
+
+bool FastISel::selectIntrinsicAsNode(const IntrinsicInst *II) {
+  unsigned Opcode = getOpcodeForSimpleIntrinsic(II);
+  if (!Opcode)
+    return false;
+
+  EVT VT = TLI.getValueType(DL, II->getType(), /*AllowUnknown=*/true);
+  if (!VT.isSimple() || !TLI.isTypeLegal(VT))
+    return false;
+  MVT SimpleVT = VT.getSimpleVT();
+
+  // The zero-is-undef flag of ctlz and cttz is folded into the opcode.
+  bool IsBinary = II->getNumArgOperands() == 2 && Opcode != ISD::CTLZ &&
+                  Opcode != ISD::CTLZ_ZERO_UNDEF && Opcode != ISD::CTTZ &&
+                  Opcode != ISD::CTTZ_ZERO_UNDEF;
+
+  unsigned Op0 = getRegForValue(II->getArgOperand(0));
+  if (!Op0)
+    return false;
+  bool Op0IsKill = hasTrivialKill(II->getArgOperand(0));
+
+  unsigned ResultReg;
+  if (IsBinary) {
+    unsigned Op1 = getRegForValue(II->getArgOperand(1));
+    if (!Op1)
+      return false;
+    bool Op1IsKill = hasTrivialKill(II->getArgOperand(1));
+    ResultReg = fastEmit_rr(SimpleVT, SimpleVT, Opcode, Op0, Op0IsKill, Op1,
+                            Op1IsKill);
+  } else {
+    ResultReg = fastEmit_r(SimpleVT, SimpleVT, Opcode, Op0, Op0IsKill);
+  }
+  if (!ResultReg)
+    return false;
+
+  ++NumFastIselIntrinsicNodes;
+  updateValueMap(II, ResultReg);
+  return true;
 }
 
 bool FastISel::selectCast(const User *I, unsigned Opcode) {
@@ -301,8 +301,10 @@ void FunctionLoweringInfo::set(const Function &fn, MachineFunction &mf,
         EVT VT = ValueVTs[vti];
         unsigned NumRegisters = TLI->getNumRegisters(Fn->getContext(), VT);
         const TargetInstrInfo *TII = MF->getSubtarget().getInstrInfo();
+        // Each incoming value usually becomes one register and block pair.
         for (unsigned i = 0; i != NumRegisters; ++i)
-          BuildMI(MBB, DL, TII->get(TargetOpcode::PHI), PHIReg + i);
+          BuildMI(MBB, DL, TII->get(TargetOpcode::PHI), PHIReg + i)
+              ->reserveOperands(*MF, 1 + 2 * PN->getNumIncomingValues());
         PHIReg += NumRegisters;
       }
     }
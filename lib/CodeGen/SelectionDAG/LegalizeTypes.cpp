@@ -19,6 +19,7 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
@@ -27,6 +28,28 @@ using namespace llvm;
 static cl::opt<bool>
 EnableExpensiveChecks("enable-legalize-types-checking", cl::Hidden);
 
+static cl::opt<bool>
+ProfileLegalizeTypes("profile-legalize-types", cl::Hidden,
+                     cl::desc("Report the time spent legalizing the nodes of "
+                              "each opcode and illegal type"));
+
+/// getProfileTimerName - Return the name of the timer accounting for the
+/// legalization of N, or an empty string if all of its types are legal.
+std::string DAGTypeLegalizer::getProfileTimerName(SDNode *N) const {
+  EVT VT;
+  if (!IgnoreNodeResults(N))
+    for (unsigned i = 0, e = N->getNumValues(); i != e && VT == EVT(); ++i)
+      if (!isTypeLegal(N->getValueType(i)))
+        VT = N->getValueType(i);
+  for (unsigned i = 0, e = N->getNumOperands(); i != e && VT == EVT(); ++i)
+    if (!IgnoreNodeResults(N->getOperand(i).getNode()) &&
+        !isTypeLegal(N->getOperand(i).getValueType()))
+      VT = N->getOperand(i).getValueType();
+  if (VT == EVT())
+    return std::string();
+  return N->getOperationName(&DAG) + " " + VT.getEVTString();
+}
+
 /// PerformExpensiveChecks - Do extensive, expensive, sanity checking.
 void DAGTypeLegalizer::PerformExpensiveChecks() {
   // If a node is not processed, then none of its values should be mapped by any
@@ -214,6 +237,12 @@ bool DAGTypeLegalizer::run() {
     assert(N->getNodeId() == ReadyToProcess &&
            "Node should be ready if on worklist!");
 
+    std::string TimerName;
+    if (ProfileLegalizeTypes)
+      TimerName = getProfileTimerName(N);
+    NamedRegionTimer T(TimerName, "Type Legalization by Opcode",
+                       !TimerName.empty());
+
     if (IgnoreNodeResults(N))
       goto ScanOperands;
 
@@ -751,7 +780,7 @@ void DAGTypeLegalizer::ReplaceValueWith(SDValue From, SDValue To) {
 
 void DAGTypeLegalizer::SetPromotedInteger(SDValue Op, SDValue Result) {
   assert(Result.getValueType() ==
-         TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) &&
+         getTypeToTransformTo(Op.getValueType()) &&
          "Invalid type for promoted integer");
   AnalyzeNewValue(Result);
 
@@ -764,9 +793,9 @@ void DAGTypeLegalizer::SetSoftenedFloat(SDValue Op, SDValue Result) {
   // f128 of x86_64 could be kept in SSE registers,
   // but sometimes softened to i128.
   assert((Result.getValueType() ==
-          TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) ||
+          getTypeToTransformTo(Op.getValueType()) ||
           Op.getValueType() ==
-          TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType())) &&
+          getTypeToTransformTo(Op.getValueType())) &&
          "Invalid type for softened float");
   AnalyzeNewValue(Result);
 
@@ -776,14 +805,14 @@ void DAGTypeLegalizer::SetSoftenedFloat(SDValue Op, SDValue Result) {
   // Many operations on these types are not softened.
   assert((!OpEntry.getNode()||
           Op.getValueType() ==
-          TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType())) &&
+          getTypeToTransformTo(Op.getValueType())) &&
          "Node is already converted to integer!");
   OpEntry = Result;
 }
 
 void DAGTypeLegalizer::SetPromotedFloat(SDValue Op, SDValue Result) {
   assert(Result.getValueType() ==
-         TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) &&
+         getTypeToTransformTo(Op.getValueType()) &&
          "Invalid type for promoted float");
   AnalyzeNewValue(Result);
 
@@ -819,7 +848,7 @@ void DAGTypeLegalizer::GetExpandedInteger(SDValue Op, SDValue &Lo,
 void DAGTypeLegalizer::SetExpandedInteger(SDValue Op, SDValue Lo,
                                           SDValue Hi) {
   assert(Lo.getValueType() ==
-         TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) &&
+         getTypeToTransformTo(Op.getValueType()) &&
          Hi.getValueType() == Lo.getValueType() &&
          "Invalid type for expanded integer");
   // Lo/Hi may have been newly allocated, if so, add nodeid's as relevant.
@@ -846,7 +875,7 @@ void DAGTypeLegalizer::GetExpandedFloat(SDValue Op, SDValue &Lo,
 void DAGTypeLegalizer::SetExpandedFloat(SDValue Op, SDValue Lo,
                                         SDValue Hi) {
   assert(Lo.getValueType() ==
-         TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) &&
+         getTypeToTransformTo(Op.getValueType()) &&
          Hi.getValueType() == Lo.getValueType() &&
          "Invalid type for expanded float");
   // Lo/Hi may have been newly allocated, if so, add nodeid's as relevant.
@@ -891,7 +920,7 @@ void DAGTypeLegalizer::SetSplitVector(SDValue Op, SDValue Lo,
 
 void DAGTypeLegalizer::SetWidenedVector(SDValue Op, SDValue Result) {
   assert(Result.getValueType() ==
-         TLI.getTypeToTransformTo(*DAG.getContext(), Op.getValueType()) &&
+         getTypeToTransformTo(Op.getValueType()) &&
          "Invalid type for widened vector");
   AnalyzeNewValue(Result);
 
@@ -1015,7 +1044,7 @@ SDValue DAGTypeLegalizer::DisintegrateMERGE_VALUES(SDNode *N, unsigned ResNo) {
 void DAGTypeLegalizer::GetPairElements(SDValue Pair,
                                        SDValue &Lo, SDValue &Hi) {
   SDLoc dl(Pair);
-  EVT NVT = TLI.getTypeToTransformTo(*DAG.getContext(), Pair.getValueType());
+  EVT NVT = getTypeToTransformTo(Pair.getValueType());
   Lo = DAG.getNode(ISD::EXTRACT_ELEMENT, dl, NVT, Pair,
                    DAG.getIntPtrConstant(0, dl));
   Hi = DAG.getNode(ISD::EXTRACT_ELEMENT, dl, NVT, Pair,
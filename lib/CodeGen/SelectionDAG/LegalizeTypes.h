@@ -61,14 +61,42 @@ private:
   /// enum from TargetLowering.  This can be queried with "getTypeAction(VT)".
   TargetLowering::ValueTypeActionImpl ValueTypeActions;
 
+  /// ExtendedTypeKinds - How to legalize the extended value types seen so far.
+  /// Unlike for simple value types, this is not a table lookup, and the nodes
+  /// of a DAG using a wide or odd type tend to all use it.
+  mutable DenseMap<Type*, TargetLowering::LegalizeKind> ExtendedTypeKinds;
+
+  /// getExtendedLegalizeKind - Return how to legalize values of the extended
+  /// type VT, and the type to transform them to.
+  TargetLowering::LegalizeKind getExtendedLegalizeKind(EVT VT) const {
+    assert(VT.isExtended() && "Simple types are looked up in a table");
+    LLVMContext &Ctx = *DAG.getContext();
+    auto Ins = ExtendedTypeKinds.insert(
+        std::make_pair(VT.getTypeForEVT(Ctx), TargetLowering::LegalizeKind()));
+    if (Ins.second)
+      Ins.first->second = TargetLowering::LegalizeKind(
+          TLI.getTypeAction(Ctx, VT), TLI.getTypeToTransformTo(Ctx, VT));
+    return Ins.first->second;
+  }
+
   /// getTypeAction - Return how we should legalize values of this type.
   TargetLowering::LegalizeTypeAction getTypeAction(EVT VT) const {
-    return TLI.getTypeAction(*DAG.getContext(), VT);
+    if (VT.isSimple())
+      return TLI.getTypeAction(*DAG.getContext(), VT);
+    return getExtendedLegalizeKind(VT).first;
+  }
+
+  /// getTypeToTransformTo - Return the type to legalize values of this type
+  /// to, one step at a time.
+  EVT getTypeToTransformTo(EVT VT) const {
+    if (VT.isSimple())
+      return TLI.getTypeToTransformTo(*DAG.getContext(), VT);
+    return getExtendedLegalizeKind(VT).second;
   }
 
   /// isTypeLegal - Return true if this type is legal on this target.
   bool isTypeLegal(EVT VT) const {
-    return TLI.getTypeAction(*DAG.getContext(), VT) == TargetLowering::TypeLegal;
+    return getTypeAction(VT) == TargetLowering::TypeLegal;
   }
 
   /// isSimpleLegalType - Return true if this is a simple legal type.
@@ -81,7 +109,7 @@ private:
   /// and only some operations converted to library calls or integer
   /// bitwise operations.
   bool isLegalInHWReg(EVT VT) const {
-    EVT NVT = TLI.getTypeToTransformTo(*DAG.getContext(), VT);
+    EVT NVT = getTypeToTransformTo(VT);
     return VT == NVT && isSimpleLegalType(VT);
   }
 
@@ -94,6 +122,8 @@ private:
     return N->getOpcode() == ISD::TargetConstant;
   }
 
+  std::string getProfileTimerName(SDNode *N) const;
+
   /// PromotedIntegers - For integer nodes that are below legal width, this map
   /// indicates what promoted value to use.
   SmallDenseMap<SDValue, SDValue, 8> PromotedIntegers;
@@ -40,7 +40,7 @@ void DAGTypeLegalizer::ExpandRes_MERGE_VALUES(SDNode *N, unsigned ResNo,
 
 void DAGTypeLegalizer::ExpandRes_BITCAST(SDNode *N, SDValue &Lo, SDValue &Hi) {
   EVT OutVT = N->getValueType(0);
-  EVT NOutVT = TLI.getTypeToTransformTo(*DAG.getContext(), OutVT);
+  EVT NOutVT = getTypeToTransformTo(OutVT);
   SDValue InOp = N->getOperand(0);
   EVT InVT = InOp.getValueType();
   SDLoc dl(N);
@@ -222,7 +222,7 @@ void DAGTypeLegalizer::ExpandRes_EXTRACT_VECTOR_ELT(SDNode *N, SDValue &Lo,
   // Convert to a vector of the expanded element type, for example
   // <3 x i64> -> <6 x i32>.
   EVT OldVT = N->getValueType(0);
-  EVT NewVT = TLI.getTypeToTransformTo(*DAG.getContext(), OldVT);
+  EVT NewVT = getTypeToTransformTo(OldVT);
 
   if (OldVT != OldEltVT) {
     // The result of EXTRACT_VECTOR_ELT may be larger than the element type of
@@ -259,7 +259,7 @@ void DAGTypeLegalizer::ExpandRes_NormalLoad(SDNode *N, SDValue &Lo,
 
   LoadSDNode *LD = cast<LoadSDNode>(N);
   EVT ValueVT = LD->getValueType(0);
-  EVT NVT = TLI.getTypeToTransformTo(*DAG.getContext(), ValueVT);
+  EVT NVT = getTypeToTransformTo(ValueVT);
   SDValue Chain = LD->getChain();
   SDValue Ptr = LD->getBasePtr();
   unsigned Alignment = LD->getAlignment();
@@ -299,7 +299,7 @@ void DAGTypeLegalizer::ExpandRes_NormalLoad(SDNode *N, SDValue &Lo,
 
 void DAGTypeLegalizer::ExpandRes_VAARG(SDNode *N, SDValue &Lo, SDValue &Hi) {
   EVT OVT = N->getValueType(0);
-  EVT NVT = TLI.getTypeToTransformTo(*DAG.getContext(), OVT);
+  EVT NVT = getTypeToTransformTo(OVT);
   SDValue Chain = N->getOperand(0);
   SDValue Ptr = N->getOperand(1);
   SDLoc dl(N);
@@ -356,7 +356,7 @@ SDValue DAGTypeLegalizer::ExpandOp_BITCAST(SDNode *N) {
     unsigned NumElts = 2;
     EVT OVT = N->getOperand(0).getValueType();
     EVT NVT = EVT::getVectorVT(*DAG.getContext(),
-                               TLI.getTypeToTransformTo(*DAG.getContext(), OVT),
+                               getTypeToTransformTo(OVT),
                                NumElts);
     if (!isTypeLegal(NVT)) {
       // If we can't find a legal type by splitting the integer in half,
@@ -382,7 +382,7 @@ SDValue DAGTypeLegalizer::ExpandOp_BUILD_VECTOR(SDNode *N) {
   EVT VecVT = N->getValueType(0);
   unsigned NumElts = VecVT.getVectorNumElements();
   EVT OldVT = N->getOperand(0).getValueType();
-  EVT NewVT = TLI.getTypeToTransformTo(*DAG.getContext(), OldVT);
+  EVT NewVT = getTypeToTransformTo(OldVT);
   SDLoc dl(N);
 
   assert(OldVT == VecVT.getVectorElementType() &&
@@ -425,7 +425,7 @@ SDValue DAGTypeLegalizer::ExpandOp_INSERT_VECTOR_ELT(SDNode *N) {
 
   SDValue Val = N->getOperand(1);
   EVT OldEVT = Val.getValueType();
-  EVT NewEVT = TLI.getTypeToTransformTo(*DAG.getContext(), OldEVT);
+  EVT NewEVT = getTypeToTransformTo(OldEVT);
 
   assert(OldEVT == VecVT.getVectorElementType() &&
          "Inserted element type doesn't match vector element type!");
@@ -474,7 +474,7 @@ SDValue DAGTypeLegalizer::ExpandOp_NormalStore(SDNode *N, unsigned OpNo) {
 
   StoreSDNode *St = cast<StoreSDNode>(N);
   EVT ValueVT = St->getValue().getValueType();
-  EVT NVT = TLI.getTypeToTransformTo(*DAG.getContext(), ValueVT);
+  EVT NVT = getTypeToTransformTo(ValueVT);
   SDValue Chain = St->getChain();
   SDValue Ptr = St->getBasePtr();
   unsigned Alignment = St->getAlignment();
@@ -359,6 +359,14 @@ private:
                      MachineBasicBlock *SwitchMBB,
                      MachineBasicBlock *DefaultMBB);
 
+  /// Peel the case cluster whose probability exceeds the peel threshold out of
+  /// the switch and test it first. Returns the block the remaining clusters
+  /// should be lowered into, which is the current block if nothing was peeled.
+  MachineBasicBlock *
+  peelDominantCaseIfProfitable(const SwitchInst &SI,
+                               CaseClusterVector &Clusters,
+                               BranchProbability &PeeledCaseProb);
+
 
   /// A class which encapsulates all of the information needed to generate a
   /// stack protector check and signals to isel via its state being initialized
@@ -15,6 +15,7 @@
 #include "ScheduleDAGSDNodes.h"
 #include "SelectionDAGBuilder.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
@@ -49,6 +50,10 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetInstrInfo.h"
@@ -70,6 +75,8 @@ STATISTIC(NumFastIselSuccess, "Number of instructions fast isel selected");
 STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
+STATISTIC(NumSmallDAGs, "Number of selection DAGs below the small DAG size");
+STATISTIC(NumEmptyDAGs, "Number of empty selection DAGs skipped");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
 STATISTIC(NumFastIselFailLowerArguments,
           "Number of entry blocks where fast isel failed to lower arguments");
@@ -185,6 +192,16 @@ UseMBPI("use-mbpi",
         cl::desc("use Machine Branch Probability Info"),
         cl::init(true), cl::Hidden);
 
+static cl::opt<bool>
+SkipEmptyDAGs("isel-skip-empty-dags", cl::Hidden, cl::init(true),
+              cl::desc("Skip the selection DAG pipeline for blocks with "
+                       "nothing to select"));
+
+static cl::opt<unsigned>
+SmallDAGSize("isel-small-dag-size", cl::Hidden, cl::init(8),
+             cl::desc("Count selection DAGs with at most this many nodes "
+                      "as small in the statistics"));
+
 #ifndef NDEBUG
 static cl::opt<std::string>
 FilterDAGBasicBlockName("filter-view-dags", cl::Hidden,
@@ -226,6 +243,159 @@ static const bool ViewDAGCombine1 = false,
                   ViewSUnitDAGs = false;
 #endif
 
+static cl::opt<std::string>
+MatcherProfileFile("isel-matcher-profile", cl::Hidden,
+    cl::desc("Count how often each case of the matcher table's switches is "
+             "taken and add the counts to this file, for use with "
+             "'llvm-tblgen -gen-dag-isel -dag-isel-profile'"),
+    cl::value_desc("filename"));
+
+namespace {
+/// Counts of the switch cases taken in the matcher table, indexed by the
+/// table offset of the case. The counts are merged into the profile file
+/// when the program shuts down. The format is a "table-size <N>" line,
+/// followed by "<offset> <count>" lines.
+struct MatcherProfile {
+  std::vector<uint64_t> Counts;
+
+  ~MatcherProfile() {
+    if (Counts.empty())
+      return;
+    mergeExisting();
+    std::error_code EC;
+    raw_fd_ostream OS(MatcherProfileFile, EC, sys::fs::F_Text);
+    if (EC) {
+      errs() << "error: cannot write '" << MatcherProfileFile
+             << "': " << EC.message() << '\n';
+      return;
+    }
+    OS << "table-size " << Counts.size() << '\n';
+    for (unsigned Idx = 0, E = Counts.size(); Idx != E; ++Idx)
+      if (Counts[Idx])
+        OS << Idx << ' ' << Counts[Idx] << '\n';
+  }
+
+  /// Add the counts of an earlier run on the same matcher table.
+  void mergeExisting() {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> Buf =
+        MemoryBuffer::getFile(MatcherProfileFile);
+    if (!Buf)
+      return;
+    SmallVector<StringRef, 16> Lines;
+    (*Buf)->getBuffer().split(Lines, '\n', -1, false);
+    if (Lines.empty())
+      return;
+    std::pair<StringRef, StringRef> Header = Lines[0].split(' ');
+    unsigned long long Size;
+    if (Header.first != "table-size" || getAsUnsignedInteger(Header.second,
+                                                             10, Size) ||
+        Size != Counts.size())
+      return;
+    for (StringRef Line : makeArrayRef(Lines).slice(1)) {
+      std::pair<StringRef, StringRef> Fields = Line.split(' ');
+      unsigned long long Idx, Count;
+      if (!getAsUnsignedInteger(Fields.first, 10, Idx) &&
+          !getAsUnsignedInteger(Fields.second.trim(), 10, Count) &&
+          Idx < Counts.size())
+        Counts[Idx] += Count;
+    }
+  }
+};
+}
+
+static ManagedStatic<MatcherProfile> TheMatcherProfile;
+
+static void recordMatcherCase(unsigned MatcherIndex, unsigned TableSize) {
+  std::vector<uint64_t> &Counts = TheMatcherProfile->Counts;
+  if (Counts.empty())
+    Counts.resize(TableSize);
+  if (MatcherIndex < Counts.size())
+    ++Counts[MatcherIndex];
+}
+
+static cl::opt<bool>
+FastISelReport("fast-isel-report", cl::Hidden,
+    cl::desc("Print which instructions made the \"fast\" instruction "
+             "selector fall back to SelectionDAG, and how many instructions "
+             "were handed over because of them"));
+
+namespace {
+/// Fallbacks from FastISel to SelectionDAG, keyed by the kind of the
+/// instruction that caused them: its opcode and type, the called intrinsic,
+/// or "<arguments>" for the argument lowering. The report is printed to the
+/// info output file when the program shuts down, the most expensive causes
+/// first.
+struct FastISelFallbackReport {
+  struct Entry {
+    uint64_t Fallbacks = 0;
+    uint64_t Instrs = 0;
+  };
+  StringMap<Entry> Causes;
+  uint64_t NumSelected = 0;
+
+  ~FastISelFallbackReport() {
+    if (Causes.empty() && !NumSelected)
+      return;
+    std::vector<std::pair<StringRef, Entry>> Sorted;
+    uint64_t TotalInstrs = 0;
+    for (const auto &C : Causes) {
+      Sorted.push_back(std::make_pair(C.getKey(), C.getValue()));
+      TotalInstrs += C.getValue().Instrs;
+    }
+    std::stable_sort(Sorted.begin(), Sorted.end(),
+                     [](const std::pair<StringRef, Entry> &A,
+                        const std::pair<StringRef, Entry> &B) {
+                       if (A.second.Instrs != B.second.Instrs)
+                         return A.second.Instrs > B.second.Instrs;
+                       if (A.second.Fallbacks != B.second.Fallbacks)
+                         return A.second.Fallbacks > B.second.Fallbacks;
+                       return A.first < B.first;
+                     });
+
+    std::unique_ptr<raw_ostream> OS = CreateInfoOutputFile();
+    *OS << "===" << std::string(73, '-') << "===\n"
+        << "                        FastISel fallback report\n"
+        << "===" << std::string(73, '-') << "===\n";
+    *OS << format("  %llu instructions selected by FastISel, %llu handed to "
+                  "SelectionDAG\n\n",
+                  (unsigned long long)NumSelected,
+                  (unsigned long long)TotalInstrs);
+    *OS << "  Fallbacks  Instrs  Cause\n";
+    for (const auto &C : Sorted)
+      *OS << format("%11llu %7llu  ", (unsigned long long)C.second.Fallbacks,
+                    (unsigned long long)C.second.Instrs)
+          << C.first << '\n';
+    OS->flush();
+  }
+};
+}
+
+static ManagedStatic<FastISelFallbackReport> TheFastISelReport;
+
+/// Record that \p I could not be selected by FastISel, and that \p NumInstrs
+/// instructions were selected by SelectionDAG as a consequence.
+static void recordFastISelFallback(const Instruction *I, uint64_t NumInstrs) {
+  std::string Cause;
+  raw_string_ostream OS(Cause);
+  if (!I) {
+    OS << "<arguments>";
+  } else if (const auto *CI = dyn_cast<CallInst>(I)) {
+    OS << "call";
+    if (const Function *F = CI->getCalledFunction())
+      if (F->isIntrinsic())
+        OS << " @" << F->getName();
+  } else {
+    // Stores and returns are known by the type of their first operand.
+    Type *Ty = I->getType();
+    if (Ty->isVoidTy() && I->getNumOperands())
+      Ty = I->getOperand(0)->getType();
+    OS << I->getOpcodeName() << ' ' << *Ty;
+  }
+  FastISelFallbackReport::Entry &E = TheFastISelReport->Causes[OS.str()];
+  ++E.Fallbacks;
+  E.Instrs += NumInstrs;
+}
+
 //===---------------------------------------------------------------------===//
 ///
 /// RegisterScheduler class - Track the registration of instruction schedulers.
@@ -747,6 +917,19 @@ void SelectionDAGISel::CodeGenAndEmitDAG() {
   DEBUG(dbgs() << "Initial selection DAG: BB#" << BlockNumber
         << " '" << BlockName << "'\n"; CurDAG->dump());
 
+  if (CurDAG->allnodes_size() <= SmallDAGSize)
+    ++NumSmallDAGs;
+
+  // A DAG whose root is still the entry token has nothing to select or emit,
+  // e.g. for a block which only falls through to its layout successor. Skip
+  // the pipeline instead of paying its fixed per-block cost.
+  if (SkipEmptyDAGs && CurDAG->getRoot() == CurDAG->getEntryNode() &&
+      !CurDAG->hasDebugValues()) {
+    ++NumEmptyDAGs;
+    CurDAG->clear();
+    return;
+  }
+
   if (ViewDAGCombine1 && MatchFilterBB)
     CurDAG->viewGraph("dag-combine1 input for " + BlockName);
 
@@ -1332,6 +1515,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (!FastIS->lowerArguments()) {
           // Fast isel failed to lower these arguments
           ++NumFastIselFailLowerArguments;
+          if (FastISelReport)
+            recordFastISelFallback(nullptr, 0);
           if (EnableFastISelAbort > 1)
             report_fatal_error("FastISel didn't lower all arguments");
 
@@ -1370,6 +1555,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
         if (FastIS->selectInstruction(Inst)) {
           --NumFastIselRemaining;
           ++NumFastIselSuccess;
+          if (FastISelReport)
+            ++TheFastISelReport->NumSelected;
           // If fast isel succeeded, skip over all the folded instructions, and
           // then see if there is a load right before the selected instructions.
           // Try to fold the load if so.
@@ -1386,6 +1573,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
             BI = std::next(BasicBlock::const_iterator(BeforeInst));
             --NumFastIselRemaining;
             ++NumFastIselSuccess;
+            if (FastISelReport)
+              ++TheFastISelReport->NumSelected;
           }
           continue;
         }
@@ -1430,6 +1619,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           // selection may have handled the call, input args, etc.
           unsigned RemainingNow = std::distance(Begin, BI);
           NumFastIselFailures += NumFastIselRemaining - RemainingNow;
+          if (FastISelReport)
+            recordFastISelFallback(Inst, NumFastIselRemaining - RemainingNow);
           NumFastIselRemaining = RemainingNow;
           continue;
         }
@@ -1452,6 +1643,8 @@ void SelectionDAGISel::SelectAllBasicBlocks(const Function &Fn) {
           report_fatal_error("FastISel didn't select the entire block");
 
         NumFastIselFailures += NumFastIselRemaining;
+        if (FastISelReport)
+          recordFastISelFallback(Inst, NumFastIselRemaining);
         break;
       }
 
@@ -3028,6 +3221,9 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       // If no cases matched, bail out.
       if (CaseSize == 0) break;
 
+      if (!MatcherProfileFile.empty())
+        recordMatcherCase(MatcherIndex, TableSize);
+
       // Otherwise, execute the case we found.
       DEBUG(dbgs() << "  OpcodeSwitch from " << SwitchStart
                    << " to " << MatcherIndex << "\n");
@@ -3060,6 +3256,9 @@ void SelectionDAGISel::SelectCodeCommon(SDNode *NodeToMatch,
       // If no cases matched, bail out.
       if (CaseSize == 0) break;
 
+      if (!MatcherProfileFile.empty())
+        recordMatcherCase(MatcherIndex, TableSize);
+
       // Otherwise, execute the case we found.
       DEBUG(dbgs() << "  TypeSwitch[" << EVT(CurNodeVT).getEVTString()
                    << "] from " << SwitchStart << " to " << MatcherIndex<<'\n');
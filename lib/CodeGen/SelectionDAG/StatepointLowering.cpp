@@ -27,17 +27,25 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Statepoint.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Target/TargetLowering.h"
 #include <algorithm>
 using namespace llvm;
 
 #define DEBUG_TYPE "statepoint-lowering"
 
+static cl::opt<bool> UseRegistersForDeoptValues(
+    "use-registers-for-deopt-values", cl::Hidden, cl::init(false),
+    cl::desc("Allow the register allocator to place deopt values which are "
+             "not gc pointers in callee saved registers"));
+
 STATISTIC(NumSlotsAllocatedForStatepoints,
           "Number of stack slots allocated for statepoints");
 STATISTIC(NumOfStatepoints, "Number of statepoint nodes encountered");
 STATISTIC(StatepointMaxSlotsRequired,
           "Maximum number of stack slots required for a singe statepoint");
+STATISTIC(NumDeoptSlotsReused,
+          "Number of deopt values found in the previous statepoint's slot");
 
 static void pushStackMapConstant(SmallVectorImpl<SDValue>& Ops,
                                  SelectionDAGBuilder &Builder, uint64_t Value) {
@@ -61,11 +69,21 @@ void StatepointLoweringState::startNewStatepoint(SelectionDAGBuilder &Builder) {
 
 void StatepointLoweringState::clear() {
   Locations.clear();
+  PreviousDeoptSlots.clear();
   AllocatedStackSlots.clear();
   assert(PendingGCRelocateCalls.empty() &&
          "cleared before statepoint sequence completed");
 }
 
+void StatepointLoweringState::recordDeoptSlots(ArrayRef<SDValue> DeoptValues) {
+  PreviousDeoptSlots.clear();
+  for (SDValue V : DeoptValues) {
+    SDValue Loc = getLocation(V);
+    if (Loc.getNode())
+      PreviousDeoptSlots[V] = cast<FrameIndexSDNode>(Loc)->getIndex();
+  }
+}
+
 SDValue
 StatepointLoweringState::allocateStackSlot(EVT ValueType,
                                            SelectionDAGBuilder &Builder) {
@@ -212,8 +230,14 @@ static void reservePreviousStackSlotForValue(const Value *IncomingValue,
   const int LookUpDepth = 6;
   Optional<int> Index =
       findPreviousSpillSlot(IncomingValue, Builder, LookUpDepth);
-  if (!Index.hasValue())
-    return;
+  if (!Index.hasValue()) {
+    // A value that is not relocated may still be in the slot the previous
+    // statepoint of this block spilled it to.
+    Index = Builder.StatepointLowering.getPreviousDeoptSlot(Incoming);
+    if (!Index.hasValue())
+      return;
+    ++NumDeoptSlotsReused;
+  }
 
   const auto &StatepointSlots = Builder.FuncInfo.StatepointStackSlots;
 
@@ -370,8 +394,11 @@ spillIncomingStatepointValue(SDValue Incoming, SDValue Chain,
 
 /// Lower a single value incoming to a statepoint node.  This value can be
 /// either a deopt value or a gc value, the handling is the same.  We special
-/// case constants and allocas, then fall back to spilling if required.
+/// case constants and allocas, then fall back to spilling if required.  If
+/// \p RequireSpillSlot is false, the value may instead be left to the register
+/// allocator.
 static void lowerIncomingStatepointValue(SDValue Incoming,
+                                         bool RequireSpillSlot,
                                          SmallVectorImpl<SDValue> &Ops,
                                          SelectionDAGBuilder &Builder) {
   SDValue Chain = Builder.getRoot();
@@ -390,13 +417,21 @@ static void lowerIncomingStatepointValue(SDValue Incoming,
     // relocate the address of the alloca itself?)
     Ops.push_back(Builder.DAG.getTargetFrameIndex(FI->getIndex(),
                                                   Incoming.getValueType()));
+  } else if (!RequireSpillSlot &&
+             Builder.DAG.getTargetLoweringInfo().isTypeLegal(
+                 Incoming.getValueType())) {
+    // The value is only read by the runtime, so we can treat it the way
+    // patchpoint treats its live values: the register allocator either keeps
+    // it in a register or folds a reload into the statepoint.  The call's
+    // register mask doesn't apply to uses, so this may pick a register the
+    // call clobbers; FixupStatepointCallerSaved spills those after register
+    // allocation.
+    Ops.push_back(Incoming);
   } else {
     // Otherwise, locate a spill slot and explicitly spill it so it
-    // can be found by the runtime later.  We currently do not support
-    // tracking values through callee saved registers to their eventual
-    // spill location.  This would be a useful optimization, but would
-    // need to be optional since it requires a lot of complexity on the
-    // runtime side which not all would support.
+    // can be found by the runtime later.  Values in callee saved registers
+    // are only supported for deopt values (see UseRegistersForDeoptValues);
+    // gc pointers must be in a slot the collector can update.
     auto Res = spillIncomingStatepointValue(Incoming, Chain, Builder);
     Ops.push_back(Res.first);
     Chain = Res.second;
@@ -451,8 +486,17 @@ lowerStatepointMetaArgs(SmallVectorImpl<SDValue> &Ops,
   // particular value.  This is purely an optimization over the code below and
   // doesn't change semantics at all.  It is important for performance that we
   // reserve slots for both deopt and gc values before lowering either.
+  auto isGCValue = [&](const Value *V) {
+    return find(SI.Ptrs, V) != SI.Ptrs.end() ||
+           find(SI.Bases, V) != SI.Bases.end();
+  };
+  auto requireSpillSlot = [&](const Value *V) {
+    return !UseRegistersForDeoptValues || isGCValue(V);
+  };
+
   for (const Value *V : SI.DeoptState) {
-    reservePreviousStackSlotForValue(V, Builder);
+    if (requireSpillSlot(V))
+      reservePreviousStackSlotForValue(V, Builder);
   }
   for (unsigned i = 0; i < SI.Bases.size(); ++i) {
     reservePreviousStackSlotForValue(SI.Bases[i], Builder);
@@ -469,7 +513,7 @@ lowerStatepointMetaArgs(SmallVectorImpl<SDValue> &Ops,
   // what type of values are contained within.
   for (const Value *V : SI.DeoptState) {
     SDValue Incoming = Builder.getValue(V);
-    lowerIncomingStatepointValue(Incoming, Ops, Builder);
+    lowerIncomingStatepointValue(Incoming, requireSpillSlot(V), Ops, Builder);
   }
 
   // Finally, go ahead and lower all the gc arguments.  There's no prefixed
@@ -479,10 +523,12 @@ lowerStatepointMetaArgs(SmallVectorImpl<SDValue> &Ops,
   // (base[0], ptr[0], base[1], ptr[1], ...)
   for (unsigned i = 0; i < SI.Bases.size(); ++i) {
     const Value *Base = SI.Bases[i];
-    lowerIncomingStatepointValue(Builder.getValue(Base), Ops, Builder);
+    lowerIncomingStatepointValue(Builder.getValue(Base),
+                                 /*RequireSpillSlot*/ true, Ops, Builder);
 
     const Value *Ptr = SI.Ptrs[i];
-    lowerIncomingStatepointValue(Builder.getValue(Ptr), Ops, Builder);
+    lowerIncomingStatepointValue(Builder.getValue(Ptr),
+                                 /*RequireSpillSlot*/ true, Ops, Builder);
   }
 
   // If there are any explicit spill slots passed to the statepoint, record
@@ -499,6 +545,15 @@ lowerStatepointMetaArgs(SmallVectorImpl<SDValue> &Ops,
     }
   }
 
+  // Remember where the deopt values which are not gc pointers went.  The
+  // statepoint doesn't change them, so the next statepoint in this block can
+  // refer to the same slots instead of storing them again.
+  SmallVector<SDValue, 8> DeoptValues;
+  for (const Value *V : SI.DeoptState)
+    if (!isGCValue(V))
+      DeoptValues.push_back(Builder.getValue(V));
+  Builder.StatepointLowering.recordDeoptSlots(DeoptValues);
+
   // Record computed locations for all lowered values.
   // This can not be embedded in lowering loops as we need to record *all*
   // values, while previous loops account only values with unique SDValues.
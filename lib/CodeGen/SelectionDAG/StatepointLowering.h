@@ -16,6 +16,7 @@
 #define LLVM_LIB_CODEGEN_SELECTIONDAG_STATEPOINTLOWERING_H
 
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
 #include "llvm/CodeGen/SelectionDAG.h"
 #include "llvm/CodeGen/SelectionDAGNodes.h"
@@ -96,6 +97,19 @@ public:
     return AllocatedStackSlots.test(Offset);
   }
 
+  /// Returns the stack slot the previous statepoint in this block spilled a
+  /// deopt value (which is not a gc pointer) to, if any.
+  Optional<int> getPreviousDeoptSlot(SDValue Val) const {
+    auto I = PreviousDeoptSlots.find(Val);
+    if (I == PreviousDeoptSlots.end())
+      return None;
+    return I->second;
+  }
+
+  /// Remember the stack slots the given deopt values of the current
+  /// statepoint were spilled to, and forget those of the previous one.
+  void recordDeoptSlots(ArrayRef<SDValue> DeoptValues);
+
 private:
   /// Maps pre-relocation value (gc pointer directly incoming into statepoint)
   /// into it's location (currently only stack slots)
@@ -110,6 +124,11 @@ private:
   /// Points just beyond the last slot known to have been allocated
   unsigned NextSlotToAllocate;
 
+  /// Maps the deopt values of the previous statepoint in the current block to
+  /// the stack slots they were spilled to.  Only the previous statepoint is
+  /// tracked, since any statepoint may reuse a slot for a different value.
+  DenseMap<SDValue, int> PreviousDeoptSlots;
+
   /// Keep track of pending gcrelocate calls for consistency check
   SmallVector<const CallInst *, 10> PendingGCRelocateCalls;
 };
@@ -45,10 +45,17 @@
 //
 // If this pass found points matching all these properties, then
 // MachineFrameInfo is updated with this information.
+//
+// When no single Restore point exists, e.g., because the region using the
+// callee-saved registers leaves the function through several returns, the
+// pass can optionally (-shrink-wrap-multiple-restores) fall back to a Save
+// point outside of any loop together with one Restore point per return block
+// reachable from it.
 //===----------------------------------------------------------------------===//
 #include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/Statistic.h"
 // To check for profitability.
 #include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
@@ -83,10 +90,16 @@ STATISTIC(NumFunc, "Number of functions");
 STATISTIC(NumCandidates, "Number of shrink-wrapping candidates");
 STATISTIC(NumCandidatesDropped,
           "Number of shrink-wrapping candidates dropped because of frequency");
+STATISTIC(NumMultipleRestores,
+          "Number of shrink-wrapping candidates with several restore points");
 
 static cl::opt<cl::boolOrDefault>
     EnableShrinkWrapOpt("enable-shrink-wrap", cl::Hidden,
                         cl::desc("enable the shrink-wrapping pass"));
+static cl::opt<bool> EnableMultipleRestores(
+    "shrink-wrap-multiple-restores", cl::Hidden, cl::init(false),
+    cl::desc("allow shrink-wrapping with one restore point per return block "
+             "when no single restore point exists"));
 
 namespace {
 /// \brief Class to determine where the safe point to insert the
@@ -156,6 +169,15 @@ class ShrinkWrap : public MachineFunctionPass {
   /// this call.
   void updateSaveRestorePoints(MachineBasicBlock &MBB, RegScavenger *RS);
 
+  /// \brief Look for a Save point that dominates all the blocks in
+  /// \p UseBlocks and for the return blocks reachable from it, which are
+  /// then all Restore points.
+  /// \returns true and sets Save and \p Restores if such points exist and
+  /// are worth it.
+  bool findMultipleRestorePoints(ArrayRef<MachineBasicBlock *> UseBlocks,
+                                 SmallVectorImpl<MachineBasicBlock *> &Restores,
+                                 RegScavenger *RS);
+
   /// \brief Initialize the pass for \p MF.
   void init(MachineFunction &MF) {
     RCI.runOnMachineFunction(MF);
@@ -385,6 +407,57 @@ void ShrinkWrap::updateSaveRestorePoints(MachineBasicBlock &MBB,
   }
 }
 
+bool ShrinkWrap::findMultipleRestorePoints(
+    ArrayRef<MachineBasicBlock *> UseBlocks,
+    SmallVectorImpl<MachineBasicBlock *> &Restores, RegScavenger *RS) {
+  Save = nullptr;
+  for (MachineBasicBlock *MBB : UseBlocks) {
+    Save = Save ? MDT->findNearestCommonDominator(Save, MBB) : MBB;
+    if (!Save)
+      return false;
+  }
+
+  // Every path from Save ends in exactly one of the return blocks, so the
+  // prologue and the epilogues are balanced as long as Save is not in a loop.
+  // Also hoist Save until it is cheap enough and suitable for the target.
+  const TargetFrameLowering *TFI =
+      MachineFunc->getSubtarget().getFrameLowering();
+  while (Save && Save != Entry &&
+         (MLI->getLoopFor(Save) ||
+          EntryFreq < MBFI->getBlockFreq(Save).getFrequency() ||
+          !TFI->canUseAsPrologue(*Save)))
+    Save = FindIDom<>(*Save, Save->predecessors(), *MDT);
+  if (!Save || Save == Entry)
+    return false;
+
+  // Collect the return blocks reachable from Save. All of them must be
+  // reached through Save only, otherwise the epilogue would run without
+  // the prologue.
+  SmallPtrSet<MachineBasicBlock *, 16> Visited;
+  SmallVector<MachineBasicBlock *, 16> WorkList;
+  WorkList.push_back(Save);
+  Visited.insert(Save);
+  while (!WorkList.empty()) {
+    MachineBasicBlock *MBB = WorkList.pop_back_val();
+    for (MachineBasicBlock *SuccBB : MBB->successors())
+      if (Visited.insert(SuccBB).second)
+        WorkList.push_back(SuccBB);
+    if (!MBB->isReturnBlock())
+      continue;
+    if (!MDT->dominates(Save, MBB) || !TFI->canUseAsEpilogue(*MBB)) {
+      DEBUG(dbgs() << "Return block " << MBB->getNumber()
+                   << " cannot be a restore point\n");
+      return false;
+    }
+    // The epilogue is inserted before the terminators.
+    for (const MachineInstr &Terminator : MBB->terminators())
+      if (useOrDefCSROrFI(Terminator, RS))
+        return false;
+    Restores.push_back(MBB);
+  }
+  return !Restores.empty();
+}
+
 /// Check whether the edge (\p SrcBB, \p DestBB) is a backedge according to MLI.
 /// I.e., check if it exists a loop that contains SrcBB and where DestBB is the
 /// loop header.
@@ -443,6 +516,8 @@ bool ShrinkWrap::runOnMachineFunction(MachineFunction &MF) {
   std::unique_ptr<RegScavenger> RS(
       TRI->requiresRegisterScavenging(MF) ? new RegScavenger() : nullptr);
 
+  // Blocks that use or define a CSR or a frame index.
+  SmallVector<MachineBasicBlock *, 16> UseBlocks;
   for (MachineBasicBlock &MBB : MF) {
     DEBUG(dbgs() << "Look into: " << MBB.getNumber() << ' ' << MBB.getName()
                  << '\n');
@@ -455,20 +530,37 @@ bool ShrinkWrap::runOnMachineFunction(MachineFunction &MF) {
     for (const MachineInstr &MI : MBB) {
       if (!useOrDefCSROrFI(MI, RS.get()))
         continue;
-      // Save (resp. restore) point must dominate (resp. post dominate)
-      // MI. Look for the proper basic block for those.
-      updateSaveRestorePoints(MBB, RS.get());
-      // If we are at a point where we cannot improve the placement of
-      // save/restore instructions, just give up.
-      if (!ArePointsInteresting()) {
-        DEBUG(dbgs() << "No Shrink wrap candidate found\n");
-        return false;
-      }
       // No need to look for other instructions, this basic block
       // will already be part of the handled region.
+      UseBlocks.push_back(&MBB);
       break;
     }
   }
+
+  for (MachineBasicBlock *MBB : UseBlocks) {
+    // Save (resp. restore) point must dominate (resp. post dominate)
+    // MBB. Look for the proper basic block for those.
+    updateSaveRestorePoints(*MBB, RS.get());
+    // If we are at a point where we cannot improve the placement of
+    // save/restore instructions, just give up.
+    if (!ArePointsInteresting()) {
+      SmallVector<MachineBasicBlock *, 4> Restores;
+      if (Save && !Restore && EnableMultipleRestores &&
+          findMultipleRestorePoints(UseBlocks, Restores, RS.get())) {
+        DEBUG(dbgs() << "Found " << Restores.size()
+                     << " restore points for save point " << Save->getNumber()
+                     << ' ' << Save->getName() << '\n');
+        MachineFrameInfo *MFI = MF.getFrameInfo();
+        MFI->setSavePoint(Save);
+        MFI->setRestorePoints(Restores);
+        ++NumCandidates;
+        ++NumMultipleRestores;
+        return false;
+      }
+      DEBUG(dbgs() << "No Shrink wrap candidate found\n");
+      return false;
+    }
+  }
   if (!ArePointsInteresting()) {
     // If the points are not interesting at this point, then they must be null
     // because it means we did not encounter any frame/CSR related code.
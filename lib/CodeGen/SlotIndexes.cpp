@@ -24,6 +24,8 @@ INITIALIZE_PASS(SlotIndexes, "slotindexes",
 
 STATISTIC(NumLocalRenum,  "Number of local renumberings");
 STATISTIC(NumGlobalRenum, "Number of global renumberings");
+STATISTIC(NumRenumEntries, "Number of entries renumbered locally");
+STATISTIC(NumRangeInserts, "Number of instruction ranges inserted at once");
 
 void SlotIndexes::getAnalysisUsage(AnalysisUsage &au) const {
   au.setPreservesAll();
@@ -36,6 +38,12 @@ void SlotIndexes::releaseMemory() {
   idx2MBBMap.clear();
   indexList.clear();
   ileAllocator.Reset();
+  LocalRenumberWork = 0;
+}
+
+size_t SlotIndexes::getMemoryUsage() const {
+  return ileAllocator.getTotalMemory() + capacity_in_bytes(mi2iMap) +
+         capacity_in_bytes(MBBRanges) + capacity_in_bytes(idx2MBBMap);
 }
 
 bool SlotIndexes::runOnMachineFunction(MachineFunction &fn) {
@@ -112,6 +120,7 @@ void SlotIndexes::renumberIndexes() {
   // Renumber updates the index of every element of the index list.
   DEBUG(dbgs() << "\n*** Renumbering SlotIndexes ***\n");
   ++NumGlobalRenum;
+  LocalRenumberWork = 0;
 
   unsigned index = 0;
 
@@ -131,15 +140,69 @@ void SlotIndexes::renumberIndexes(IndexList::iterator curItr) {
 
   IndexList::iterator startItr = std::prev(curItr);
   unsigned index = startItr->getIndex();
+  unsigned Renumbered = 0;
   do {
     curItr->setIndex(index += Space);
     ++curItr;
+    ++Renumbered;
     // If the next index is bigger, we have caught up.
   } while (curItr != indexList.end() && curItr->getIndex() <= index);
 
   DEBUG(dbgs() << "\n*** Renumbered SlotIndexes " << startItr->getIndex() << '-'
                << index << " ***\n");
   ++NumLocalRenum;
+  NumRenumEntries += Renumbered;
+
+  // Every local renumbering leaves smaller gaps behind, so repeated edits in
+  // one area renumber ever longer stretches of the list. Once the local
+  // renumberings have touched about as many entries as the list holds, give
+  // everything the default spacing again. The cost of the global renumbering
+  // is covered by the local work that led to it.
+  LocalRenumberWork += Renumbered;
+  if (LocalRenumberWork > indexList.back().getIndex() / SlotIndex::InstrDist)
+    renumberIndexes();
+}
+
+void SlotIndexes::insertMachineInstrRangeInMaps(
+    MachineBasicBlock::iterator Begin, MachineBasicBlock::iterator End) {
+  SmallVector<MachineInstr *, 8> MIs;
+  for (MachineBasicBlock::iterator I = Begin; I != End; ++I) {
+    if (I->isDebugValue())
+      continue;
+    assert(mi2iMap.find(&*I) == mi2iMap.end() && "Instr already indexed.");
+    MIs.push_back(&*I);
+  }
+  if (MIs.empty())
+    return;
+  if (MIs.size() == 1) {
+    insertMachineInstrInMaps(*MIs.front());
+    return;
+  }
+  ++NumRangeInserts;
+
+  // Like insertMachineInstrInMaps(), place the new indexes right after the
+  // preceding instruction, but share out the gap between all of them.
+  IndexList::iterator prevItr =
+      getIndexBefore(*MIs.front()).listEntry()->getIterator();
+  IndexList::iterator nextItr = std::next(prevItr);
+  unsigned dist = ((nextItr->getIndex() - prevItr->getIndex()) /
+                   (MIs.size() + 1)) & ~3u;
+
+  // Without room for the batch, give every entry the preceding index and
+  // renumber once from the first of them.
+  unsigned newNumber = prevItr->getIndex();
+  IndexList::iterator firstItr = nextItr;
+  for (MachineInstr *MI : MIs) {
+    newNumber += dist;
+    IndexList::iterator newItr =
+        indexList.insert(nextItr, createEntry(MI, newNumber));
+    if (firstItr == nextItr)
+      firstItr = newItr;
+    mi2iMap.insert(std::make_pair(MI, SlotIndex(&*newItr,
+                                                SlotIndex::Slot_Block)));
+  }
+  if (dist == 0)
+    renumberIndexes(firstItr);
 }
 
 // Repair indexes after adding and removing instructions.
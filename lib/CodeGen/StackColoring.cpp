@@ -42,6 +42,7 @@
 #include "llvm/CodeGen/StackProtector.h"
 #include "llvm/CodeGen/WinEHFuncInfo.h"
 #include "llvm/IR/DebugInfo.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -274,6 +275,10 @@ class StackColoring : public MachineFunctionPass {
 
   /// Maps liveness intervals for each slot.
   SmallVector<std::unique_ptr<LiveInterval>, 16> Intervals;
+  /// For each slot, the numbers of the basic blocks its interval has segments
+  /// in.  Slots with no block in common can't overlap, which lets the merging
+  /// loop skip most interval comparisons.
+  SmallVector<BitVector, 16> SlotBlocks;
   /// VNInfo is used for the construction of LiveIntervals.
   VNInfo::Allocator VNInfoAllocator;
   /// SlotIndex analysis object.
@@ -731,6 +736,7 @@ void StackColoring::calculateLiveIntervals(unsigned NumSlots) {
         continue;
 
       assert(Starts[i] && Finishes[i] && "Invalid interval");
+      SlotBlocks[i].set(MBB.getNumber());
       VNInfo *ValNum = Intervals[i]->getValNumInfo(0);
       SlotIndex S = Starts[i];
       SlotIndex F = Finishes[i];
@@ -975,6 +981,7 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
   BasicBlockNumbering.clear();
   Markers.clear();
   Intervals.clear();
+  SlotBlocks.clear();
   VNInfoAllocator.Reset();
 
   unsigned NumSlots = MFI->getObjectIndexEnd();
@@ -1012,6 +1019,7 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
     std::unique_ptr<LiveInterval> LI(new LiveInterval(i, 0));
     LI->getNextValue(Indexes->getZeroIndex(), VNInfoAllocator);
     Intervals.push_back(std::move(LI));
+    SlotBlocks.push_back(BitVector(MF->getNumBlockIDs()));
     SortedSlots.push_back(i);
   }
 
@@ -1041,10 +1049,10 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
   }
 
   // This is a simple greedy algorithm for merging allocas. First, sort the
-  // slots, placing the largest slots first. Next, perform an n^2 scan and look
-  // for disjoint slots. When you find disjoint slots, merge the samller one
-  // into the bigger one and update the live interval. Remove the small alloca
-  // and continue.
+  // slots, placing the largest slots first. Next, give each slot the color of
+  // the first larger slot it doesn't interfere with, merging the smaller one
+  // into the bigger one and updating the live interval, or make it a new
+  // color. Intervals only ever grow, so a single pass finds every merge.
 
   // Sort the slots according to their size. Place unused slots at the end.
   // Use stable sort to guarantee deterministic code generation.
@@ -1057,52 +1065,63 @@ bool StackColoring::runOnMachineFunction(MachineFunction &Func) {
     return MFI->getObjectSize(LHS) > MFI->getObjectSize(RHS);
   });
 
-  bool Changed = true;
-  while (Changed) {
-    Changed = false;
-    for (unsigned I = 0; I < NumSlots; ++I) {
-      if (SortedSlots[I] == -1)
+  // The slots that other slots are merged into, in order of size.
+  SmallVector<int, 16> Colors;
+  for (unsigned J = 0; J < NumSlots; ++J) {
+    int SecondSlot = SortedSlots[J];
+    if (SecondSlot == -1)
+      break;
+    LiveInterval *Second = &*Intervals[SecondSlot];
+    assert(!Second->empty() && "Found an empty range");
+
+    bool Merged = false;
+    for (int FirstSlot : Colors) {
+      LiveInterval *First = &*Intervals[FirstSlot];
+      // Slots without a block in common are trivially disjoint.
+      if (SlotBlocks[FirstSlot].anyCommon(SlotBlocks[SecondSlot]) &&
+          First->overlaps(*Second))
         continue;
 
-      for (unsigned J=I+1; J < NumSlots; ++J) {
-        if (SortedSlots[J] == -1)
-          continue;
-
-        int FirstSlot = SortedSlots[I];
-        int SecondSlot = SortedSlots[J];
-        LiveInterval *First = &*Intervals[FirstSlot];
-        LiveInterval *Second = &*Intervals[SecondSlot];
-        assert (!First->empty() && !Second->empty() && "Found an empty range");
-
-        // Merge disjoint slots.
-        if (!First->overlaps(*Second)) {
-          Changed = true;
-          First->MergeSegmentsInAsValue(*Second, First->getValNumInfo(0));
-          SlotRemap[SecondSlot] = FirstSlot;
-          SortedSlots[J] = -1;
-          DEBUG(dbgs()<<"Merging #"<<FirstSlot<<" and slots #"<<
-                SecondSlot<<" together.\n");
-          unsigned MaxAlignment = std::max(MFI->getObjectAlignment(FirstSlot),
-                                           MFI->getObjectAlignment(SecondSlot));
-
-          assert(MFI->getObjectSize(FirstSlot) >=
-                 MFI->getObjectSize(SecondSlot) &&
-                 "Merging a small object into a larger one");
-
-          RemovedSlots+=1;
-          ReducedSize += MFI->getObjectSize(SecondSlot);
-          MFI->setObjectAlignment(FirstSlot, MaxAlignment);
-          MFI->RemoveStackObject(SecondSlot);
-        }
-      }
+      // Merge disjoint slots.
+      First->MergeSegmentsInAsValue(*Second, First->getValNumInfo(0));
+      SlotBlocks[FirstSlot] |= SlotBlocks[SecondSlot];
+      SlotRemap[SecondSlot] = FirstSlot;
+      DEBUG(dbgs()<<"Merging #"<<FirstSlot<<" and slots #"<<
+            SecondSlot<<" together.\n");
+      unsigned MaxAlignment = std::max(MFI->getObjectAlignment(FirstSlot),
+                                       MFI->getObjectAlignment(SecondSlot));
+
+      assert(MFI->getObjectSize(FirstSlot) >=
+             MFI->getObjectSize(SecondSlot) &&
+             "Merging a small object into a larger one");
+
+      RemovedSlots+=1;
+      ReducedSize += MFI->getObjectSize(SecondSlot);
+      MFI->setObjectAlignment(FirstSlot, MaxAlignment);
+      MFI->RemoveStackObject(SecondSlot);
+      Merged = true;
+      break;
     }
-  }// While changed.
+    if (!Merged)
+      Colors.push_back(SecondSlot);
+  }
 
   // Record statistics.
   StackSpaceSaved += ReducedSize;
   StackSlotMerged += RemovedSlots;
   DEBUG(dbgs()<<"Merge "<<RemovedSlots<<" slots. Saved "<<
         ReducedSize<<" bytes\n");
+  if (RemovedSlots) {
+    const Function &F = *MF->getFunction();
+    emitOptimizationRemark(F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+                           Twine("merged ") + Twine(RemovedSlots) +
+                               (RemovedSlots == 1 ? " stack slot" :
+                                                    " stack slots") +
+                               ", reducing the size of the stack objects "
+                               "from " +
+                               Twine(TotalSize) + " to " +
+                               Twine(TotalSize - ReducedSize) + " bytes");
+  }
 
   // Scan the entire function and update all machine operands that use frame
   // indices to use the remapped frame index.
@@ -295,8 +295,10 @@ selectELFSectionForGlobal(MCContext &Ctx, const GlobalValue *GV,
   } else {
     Name = getSectionPrefixForGlobal(Kind);
   }
-  // FIXME: Extend the section prefix to include hotness catagories such as .hot
-  //  or .unlikely for functions.
+
+  if (const auto *F = dyn_cast<Function>(GV))
+    if (Optional<StringRef> Prefix = F->getSectionPrefix())
+      Name += *Prefix;
 
   if (EmitUniqueSection && UniqueSectionNames) {
     Name.push_back('.');
@@ -19,6 +19,7 @@
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/ScopedNoAliasAA.h"
 #include "llvm/Analysis/TypeBasedAliasAnalysis.h"
+#include "llvm/CodeGen/MachineFunctionAnalysis.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/RegAllocRegistry.h"
 #include "llvm/IR/IRPrintingPasses.h"
@@ -80,6 +81,10 @@ static cl::opt<bool> EnableImplicitNullChecks(
     "enable-implicit-null-checks",
     cl::desc("Fold null checks into faulting memory operations"),
     cl::init(false));
+static cl::opt<bool> EnableMachineOutliner("enable-machine-outliner",
+    cl::Hidden, cl::desc("Outline instruction sequences repeated across "
+                         "the module into shared functions"),
+    cl::init(false));
 static cl::opt<bool> PrintLSR("print-lsr-output", cl::Hidden,
     cl::desc("Print LLVM IR produced by the loop-reduce pass"));
 static cl::opt<bool> PrintISelInput("print-isel-input", cl::Hidden,
@@ -242,7 +247,8 @@ TargetPassConfig::~TargetPassConfig() {
 TargetPassConfig::TargetPassConfig(TargetMachine *tm, PassManagerBase &pm)
     : ImmutablePass(ID), PM(&pm), StartBefore(nullptr), StartAfter(nullptr),
       StopAfter(nullptr), Started(true), Stopped(false),
-      AddingMachinePasses(false), TM(tm), Impl(nullptr), Initialized(false),
+      AddingMachinePasses(false), RetainMachineFunctions(false), TM(tm),
+      Impl(nullptr), Initialized(false),
       DisableVerify(false), EnableTailMerge(true) {
 
   Impl = new PassConfigImpl();
@@ -568,6 +574,9 @@ void TargetPassConfig::addMachinePasses() {
   // Run post-ra passes.
   addPostRegAlloc();
 
+  // Spill statepoint arguments left in registers the call clobbers.
+  addPass(&FixupStatepointCallerSavedID);
+
   // Insert prolog/epilog code.  Eliminate abstract frame index references...
   if (getOptLevel() != CodeGenOpt::None)
     addPass(&ShrinkWrapID);
@@ -620,6 +629,15 @@ void TargetPassConfig::addMachinePasses() {
 
   addPass(&PatchableFunctionID, false);
 
+  if (EnableMachineOutliner && Started && !Stopped) {
+    addPass(createMachineOutlinerPass(), false, false);
+    RetainMachineFunctions = true;
+    // The outliner is a module pass, so the machine function analysis does
+    // not survive it. Schedule a new one to hand the retained machine
+    // functions to the passes that follow, such as the AsmPrinter.
+    PM->add(new MachineFunctionAnalysis(*TM, nullptr));
+  }
+
   AddingMachinePasses = false;
 }
 
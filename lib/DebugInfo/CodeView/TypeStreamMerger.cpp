@@ -8,6 +8,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/DebugInfo/CodeView/TypeStreamMerger.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/DebugInfo/CodeView/CVTypeVisitor.h"
@@ -15,7 +16,11 @@
 #include "llvm/DebugInfo/CodeView/StreamRef.h"
 #include "llvm/DebugInfo/CodeView/TypeIndex.h"
 #include "llvm/DebugInfo/CodeView/TypeRecord.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include <atomic>
+#include <mutex>
 
 using namespace llvm;
 using namespace llvm::codeview;
@@ -71,7 +76,18 @@ public:
 
   void visitFieldList(TypeLeafKind Leaf, ArrayRef<uint8_t> FieldData);
 
-  bool mergeStream(const CVTypeArray &Types);
+  /// Merges Types into the destination stream. If FinalIndexMap is not null,
+  /// it receives the map from source to destination type index.
+  bool mergeStream(const CVTypeArray &Types,
+                   SmallVectorImpl<TypeIndex> *FinalIndexMap = nullptr);
+
+  /// Merges Types into the destination stream, given the global type index of
+  /// each of its records in GlobalIndices. The records whose global type index
+  /// already has a destination type index in DestIndices are not visited
+  /// again, and the others get theirs there.
+  bool mergeGlobalStream(const CVTypeArray &Types,
+                         ArrayRef<TypeIndex> GlobalIndices,
+                         MutableArrayRef<TypeIndex> DestIndices);
 
 private:
   bool hadError() { return FoundBadTypeIndex || CVTypeVisitor::hadError(); }
@@ -131,14 +147,122 @@ void TypeStreamMerger::visitUnknownMember(TypeLeafKind LF) {
   parseError();
 }
 
-bool TypeStreamMerger::mergeStream(const CVTypeArray &Types) {
+bool TypeStreamMerger::mergeStream(const CVTypeArray &Types,
+                                   SmallVectorImpl<TypeIndex> *FinalIndexMap) {
   assert(IndexMap.empty());
   visitTypeStream(Types);
+  if (FinalIndexMap)
+    FinalIndexMap->swap(IndexMap);
+  IndexMap.clear();
+  return !hadError();
+}
+
+bool TypeStreamMerger::mergeGlobalStream(
+    const CVTypeArray &Types, ArrayRef<TypeIndex> GlobalIndices,
+    MutableArrayRef<TypeIndex> DestIndices) {
+  assert(IndexMap.empty());
+  for (const auto &Record : Types) {
+    if (IndexMap.size() >= GlobalIndices.size() ||
+        GlobalIndices[IndexMap.size()].isSimple()) {
+      parseError();
+      break;
+    }
+    TypeIndex &Dest = DestIndices[GlobalIndices[IndexMap.size()].getIndex() -
+                                  TypeIndex::FirstNonSimpleIndex];
+    if (!Dest.isSimple()) {
+      IndexMap.push_back(Dest);
+      continue;
+    }
+    visitTypeRecord(Record);
+    if (hadError())
+      break;
+    Dest = IndexMap.back();
+  }
   IndexMap.clear();
   return !hadError();
 }
 
+namespace {
+
+/// A table of type records that can be written to from several threads at
+/// once. The type index of a record is unique to its contents, but depends on
+/// the order of the writes, so it is only meaningful within the table.
+class ConcurrentTypeTable : public TypeTableBuilder {
+public:
+  TypeIndex writeRecord(StringRef Record) override;
+
+  /// Returns the number of distinct records in the table.
+  uint32_t size() const {
+    return NextIndex.load() - TypeIndex::FirstNonSimpleIndex;
+  }
+
+private:
+  struct Shard {
+    std::mutex Mutex;
+    BumpPtrAllocator Alloc;
+    DenseMap<CachedHash<StringRef>, TypeIndex> Records;
+  };
+
+  /// The records are spread over independently locked shards by the high bits
+  /// of their hash. DenseMap buckets records by the low bits.
+  static const unsigned ShardBits = 6;
+  Shard Shards[1 << ShardBits];
+
+  std::atomic<uint32_t> NextIndex{TypeIndex::FirstNonSimpleIndex};
+};
+
+} // end anonymous namespace
+
+TypeIndex ConcurrentTypeTable::writeRecord(StringRef Record) {
+  CachedHash<StringRef> Key(Record);
+  Shard &S = Shards[Key.Hash >> (32 - ShardBits)];
+  std::lock_guard<std::mutex> Lock(S.Mutex);
+  auto I = S.Records.find(Key);
+  if (I != S.Records.end())
+    return I->second;
+
+  char *Data = S.Alloc.Allocate<char>(Record.size());
+  memcpy(Data, Record.data(), Record.size());
+  TypeIndex TI(NextIndex++);
+  S.Records.insert(std::make_pair(
+      CachedHash<StringRef>(StringRef(Data, Record.size()), Key.Hash), TI));
+  return TI;
+}
+
 bool llvm::codeview::mergeTypeStreams(TypeTableBuilder &DestStream,
                                       const CVTypeArray &Types) {
   return TypeStreamMerger(DestStream).mergeStream(Types);
 }
+
+/// Merging several streams is done in two steps:
+///
+/// - Each stream is merged, in parallel with the others, into a concurrent
+///   table. The records rewritten for the table are in a global form, whose
+///   type indices are the ones of the table, so two records that are the same
+///   after merging are identical in their global form. This step does all the
+///   hashing of the records, once per record.
+/// - The streams are merged into the destination stream in order, with the
+///   stream merging algorithm. The records whose global form was merged
+///   already are forwarded to its destination type index without being
+///   visited, so the result is the same as when merging the streams one at a
+///   time.
+bool llvm::codeview::mergeTypeStreams(TypeTableBuilder &DestStream,
+                                      ArrayRef<CVTypeArray> Streams) {
+  ConcurrentTypeTable GlobalTable;
+  std::vector<SmallVector<TypeIndex, 0>> GlobalIndices(Streams.size());
+  std::atomic<bool> Success(true);
+  parallel_for_each_n(size_t(0), Streams.size(), [&](size_t I) {
+    if (!TypeStreamMerger(GlobalTable).mergeStream(Streams[I],
+                                                   &GlobalIndices[I]))
+      Success = false;
+  });
+  if (!Success)
+    return false;
+
+  std::vector<TypeIndex> DestIndices(GlobalTable.size());
+  TypeStreamMerger Merger(DestStream);
+  for (size_t I = 0, E = Streams.size(); I != E; ++I)
+    if (!Merger.mergeGlobalStream(Streams[I], GlobalIndices[I], DestIndices))
+      return false;
+  return true;
+}
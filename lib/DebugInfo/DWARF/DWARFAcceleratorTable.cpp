@@ -129,4 +129,71 @@ void DWARFAcceleratorTable::dump(raw_ostream &OS) const {
     }
   }
 }
+
+// The hash function of the tables (DW_hash_function_djb).
+static uint32_t hashDJB(StringRef Str) {
+  uint32_t h = 5381;
+  for (unsigned i = 0, e = Str.size(); i != e; ++i)
+    h = ((h << 5) + h) + Str[i];
+  return h;
+}
+
+void DWARFAcceleratorTable::findDIEOffsets(
+    StringRef Name, SmallVectorImpl<uint32_t> &Offsets) const {
+  if (Hdr.HashFunction != dwarf::DW_hash_function_djb || Hdr.NumBuckets == 0)
+    return;
+
+  SmallVector<DWARFFormValue, 3> AtomForms;
+  for (const auto &Atom : HdrData.Atoms)
+    AtomForms.push_back(DWARFFormValue(Atom.second));
+
+  uint32_t Hash = hashDJB(Name);
+  uint32_t Bucket = Hash % Hdr.NumBuckets;
+  uint32_t BucketsBase = sizeof(Hdr) + Hdr.HeaderDataLength;
+  unsigned HashesBase = BucketsBase + Hdr.NumBuckets * 4;
+  unsigned OffsetsBase = HashesBase + Hdr.NumHashes * 4;
+
+  uint32_t BucketOffset = BucketsBase + Bucket * 4;
+  unsigned Index = AccelSection.getU32(&BucketOffset);
+  if (Index == UINT32_MAX)
+    return;
+
+  // The hashes of a bucket are contiguous, so stop at the first hash of the
+  // next bucket.
+  for (unsigned HashIdx = Index; HashIdx < Hdr.NumHashes; ++HashIdx) {
+    unsigned HashOffset = HashesBase + HashIdx * 4;
+    unsigned OffsetsOffset = OffsetsBase + HashIdx * 4;
+    uint32_t HashValue = AccelSection.getU32(&HashOffset);
+    if (HashValue % Hdr.NumBuckets != Bucket)
+      break;
+    if (HashValue != Hash)
+      continue;
+
+    // Several names can have the same hash: walk the list of names and their
+    // data at this offset.
+    unsigned DataOffset = AccelSection.getU32(&OffsetsOffset);
+    while (AccelSection.isValidOffsetForDataOfSize(DataOffset, 4)) {
+      unsigned StringOffset = AccelSection.getU32(&DataOffset);
+      RelocAddrMap::const_iterator Reloc = Relocs.find(DataOffset - 4);
+      if (Reloc != Relocs.end())
+        StringOffset += Reloc->second.second;
+      if (!StringOffset)
+        break;
+      const char *String = StringSection.getCStr(&StringOffset);
+      bool Matches = String && Name == String;
+      unsigned NumData = AccelSection.getU32(&DataOffset);
+      for (unsigned Data = 0; Data < NumData; ++Data) {
+        for (unsigned I = 0, E = AtomForms.size(); I != E; ++I) {
+          DWARFFormValue &Atom = AtomForms[I];
+          if (!Atom.extractValue(AccelSection, &DataOffset, nullptr))
+            return;
+          if (!Matches || HdrData.Atoms[I].first != dwarf::DW_ATOM_die_offset)
+            continue;
+          if (Optional<uint64_t> Offset = Atom.getAsUnsignedConstant())
+            Offsets.push_back(HdrData.DIEOffsetBase + *Offset);
+        }
+      }
+    }
+  }
+}
 }
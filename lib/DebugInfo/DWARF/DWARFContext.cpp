@@ -17,9 +17,12 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ELF.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <cstring>
 using namespace llvm;
 using namespace dwarf;
 using namespace object;
@@ -411,6 +414,122 @@ DWARFContext::getLineTableForUnit(DWARFUnit *U) {
   return Line->getOrParseLineTable(lineData, stmtOffset);
 }
 
+// Run Fn(I) for each I in [0, N), on NumThreads threads (0 means one per
+// hardware thread).
+static void parallelFor(unsigned NumThreads, size_t N,
+                        function_ref<void(size_t)> Fn) {
+  if (NumThreads == 1 || N <= 1) {
+    for (size_t I = 0; I != N; ++I)
+      Fn(I);
+    return;
+  }
+  std::unique_ptr<ThreadPool> Pool(NumThreads ? new ThreadPool(NumThreads)
+                                              : new ThreadPool());
+  for (size_t I = 0; I != N; ++I)
+    Pool->async([Fn, I]() { Fn(I); });
+  Pool->wait();
+}
+
+void DWARFContext::extractAllDIEs(unsigned NumThreads) {
+  // Create all the units first. This also parses the abbreviation tables,
+  // which are shared by the units, so the workers below only read them.
+  std::vector<DWARFUnit *> Units;
+  for (const auto &CU : compile_units())
+    Units.push_back(CU.get());
+  for (const auto &TUS : type_unit_sections())
+    for (const auto &TU : TUS)
+      Units.push_back(TU.get());
+  for (const auto &CU : dwo_compile_units())
+    Units.push_back(CU.get());
+  for (const auto &TUS : dwo_type_unit_sections())
+    for (const auto &TU : TUS)
+      Units.push_back(TU.get());
+
+  // Extracting the DIEs of a unit only touches that unit, so the units can be
+  // extracted concurrently. Start with the largest ones for better balance.
+  std::stable_sort(Units.begin(), Units.end(),
+                   [](const DWARFUnit *A, const DWARFUnit *B) {
+                     return A->getLength() > B->getLength();
+                   });
+  parallelFor(NumThreads, Units.size(),
+              [&Units](size_t I) { Units[I]->getNumDIEs(); });
+}
+
+void DWARFContext::buildNameIndex(unsigned NumThreads) {
+  if (NameIndex)
+    return;
+  parseCompileUnits();
+
+  // Collect the names of the DIEs of each unit in parallel, then merge them
+  // in unit order so that the lookup results are deterministic.
+  typedef std::vector<std::pair<const char *, uint32_t>> UnitNames;
+  std::vector<UnitNames> Names(CUs.size());
+  parallelFor(NumThreads, CUs.size(), [&](size_t I) {
+    DWARFCompileUnit *CU = CUs[I].get();
+    for (uint32_t Idx = 0, E = CU->getNumDIEs(); Idx != E; ++Idx) {
+      const DWARFDebugInfoEntryMinimal *DIE = CU->getDIEAtIndex(Idx);
+      if (DIE->isNULL())
+        continue;
+      const char *Name =
+          DIE->getAttributeValueAsString(CU, DW_AT_name, nullptr);
+      if (Name)
+        Names[I].push_back(std::make_pair(Name, Idx));
+      const char *LinkageName =
+          DIE->getAttributeValueAsString(CU, DW_AT_MIPS_linkage_name, nullptr);
+      if (!LinkageName)
+        LinkageName =
+            DIE->getAttributeValueAsString(CU, DW_AT_linkage_name, nullptr);
+      if (LinkageName && (!Name || strcmp(Name, LinkageName) != 0))
+        Names[I].push_back(std::make_pair(LinkageName, Idx));
+    }
+  });
+
+  NameIndex = llvm::make_unique<NameIndexMap>();
+  for (uint32_t I = 0, E = Names.size(); I != E; ++I)
+    for (const auto &Name : Names[I])
+      (*NameIndex)[Name.first].push_back(std::make_pair(I, Name.second));
+}
+
+std::vector<DWARFContext::UnitDIEPair>
+DWARFContext::findDIEsByName(StringRef Name, unsigned NumThreads) {
+  std::vector<UnitDIEPair> Result;
+
+  SmallVector<uint32_t, 4> Offsets;
+  bool HasAccelTables = false;
+  DataExtractor StrData(getStringSection(), isLittleEndian(), 0);
+  for (const DWARFSection *Section :
+       {&getAppleNamesSection(), &getAppleTypesSection()}) {
+    DataExtractor AccelSection(Section->Data, isLittleEndian(), 0);
+    DWARFAcceleratorTable Accel(AccelSection, StrData, Section->Relocs);
+    if (Section->Data.empty() || !Accel.extract())
+      continue;
+    HasAccelTables = true;
+    Accel.findDIEOffsets(Name, Offsets);
+  }
+
+  if (HasAccelTables) {
+    for (uint32_t Offset : Offsets) {
+      DWARFCompileUnit *CU = getCompileUnitForOffset(Offset);
+      if (!CU || !CU->getNumDIEs())
+        continue;
+      const DWARFDebugInfoEntryMinimal *DIE = CU->getDIEForOffset(Offset);
+      if (DIE && DIE->getOffset() == Offset)
+        Result.push_back(std::make_pair(CU, DIE));
+    }
+    return Result;
+  }
+
+  buildNameIndex(NumThreads);
+  auto I = NameIndex->find(Name);
+  if (I == NameIndex->end())
+    return Result;
+  for (const auto &UnitAndDIE : I->second) {
+    DWARFCompileUnit *CU = CUs[UnitAndDIE.first].get();
+    Result.push_back(std::make_pair(CU, CU->getDIEAtIndex(UnitAndDIE.second)));
+  }
+  return Result;
+}
+
 void DWARFContext::parseCompileUnits() {
   CUs.parse(*this, getInfoSection());
 }
@@ -642,8 +761,18 @@ static bool tryDecompress(StringRef &Name, StringRef &Data,
       ZLibStyle ? consumeCompressedZLibHeader(Data, OriginalSize, IsLE, Is64Bit)
                 : consumeCompressedGnuHeader(Data, OriginalSize);
 
-  if (!Result || zlib::uncompress(Data, Out, OriginalSize) != zlib::StatusOK)
+  if (!Result)
+    return false;
+
+  // Stream the data into the buffer, as zlib::uncompress() takes less than
+  // 4 GiB on some hosts.
+  Out.resize(OriginalSize);
+  zlib::Decompressor Decompressor;
+  size_t Written;
+  if (Decompressor.decompress(Data, Out, Written) != zlib::StatusOK ||
+      !Decompressor.isFinished())
     return false;
+  Out.resize(Written);
 
   // gnu-style names are started from "z", consume that.
   if (!ZLibStyle)
@@ -655,35 +784,76 @@ DWARFContextInMemory::DWARFContextInMemory(const object::ObjectFile &Obj,
     const LoadedObjectInfo *L)
     : IsLittleEndian(Obj.isLittleEndian()),
       AddressSize(Obj.getBytesInAddress()) {
-  for (const SectionRef &Section : Obj.sections()) {
-    StringRef name;
-    Section.getName(name);
+  // Get the name and the contents of Section, or return false if it is not
+  // interesting.
+  auto GetSection = [&](const SectionRef &Section, StringRef &Name,
+                        StringRef &Data) {
+    Section.getName(Name);
     // Skip BSS and Virtual sections, they aren't interesting.
-    bool IsBSS = Section.isBSS();
-    if (IsBSS)
-      continue;
-    bool IsVirtual = Section.isVirtual();
-    if (IsVirtual)
-      continue;
-    StringRef data;
+    if (Section.isBSS() || Section.isVirtual())
+      return false;
 
     section_iterator RelocatedSection = Section.getRelocatedSection();
     // Try to obtain an already relocated version of this section.
     // Else use the unrelocated section from the object file. We'll have to
     // apply relocations ourselves later.
-    if (!L || !L->getLoadedSectionContents(*RelocatedSection,data))
-      Section.getContents(data);
+    if (!L || !L->getLoadedSectionContents(*RelocatedSection, Data))
+      Section.getContents(Data);
 
-    name = name.substr(name.find_first_not_of("._")); // Skip . and _ prefixes.
+    Name = Name.substr(Name.find_first_not_of("._")); // Skip . and _ prefixes.
+    return true;
+  };
+  auto IsCompressed = [](const SectionRef &Section, StringRef Name) {
+    return Section.isCompressed() || Name.startswith("zdebug_");
+  };
+
+  // Decompress the compressed sections up front, in parallel, as the debug
+  // info sections can be large.
+  struct CompressedSection {
+    StringRef Name;
+    StringRef Data;
+    bool ZLibStyle;
+    SmallString<32> Out;
+    bool Decompressed;
+    unsigned OutIndex;
+  };
+  std::vector<CompressedSection> Compressed;
+  for (const SectionRef &Section : Obj.sections()) {
+    CompressedSection C;
+    if (GetSection(Section, C.Name, C.Data) && IsCompressed(Section, C.Name)) {
+      C.ZLibStyle = Section.isCompressed();
+      Compressed.push_back(std::move(C));
+    }
+  }
+  parallel_for_each(Compressed.begin(), Compressed.end(),
+                    [&](CompressedSection &C) {
+                      C.Decompressed =
+                          tryDecompress(C.Name, C.Data, C.Out, C.ZLibStyle,
+                                        IsLittleEndian, AddressSize == 8);
+                    });
+  // The buffers do not move once they are all in UncompressedSections.
+  UncompressedSections.reserve(Compressed.size());
+  for (CompressedSection &C : Compressed) {
+    if (!C.Decompressed)
+      continue;
+    C.OutIndex = UncompressedSections.size();
+    UncompressedSections.push_back(std::move(C.Out));
+  }
+
+  auto NextCompressed = Compressed.begin();
+  for (const SectionRef &Section : Obj.sections()) {
+    StringRef name;
+    StringRef data;
+    if (!GetSection(Section, name, data))
+      continue;
+    section_iterator RelocatedSection = Section.getRelocatedSection();
 
-    bool ZLibStyleCompressed = Section.isCompressed();
-    if (ZLibStyleCompressed || name.startswith("zdebug_")) {
-      SmallString<32> Out;
-      if (!tryDecompress(name, data, Out, ZLibStyleCompressed, IsLittleEndian,
-                         AddressSize == 8))
+    if (IsCompressed(Section, name)) {
+      const CompressedSection &C = *NextCompressed++;
+      if (!C.Decompressed)
         continue;
-      UncompressedSections.emplace_back(std::move(Out));
-      data = UncompressedSections.back();
+      name = C.Name;
+      data = UncompressedSections[C.OutIndex];
     }
 
     StringRef *SectionData =
@@ -21,6 +21,15 @@ MappedBlockStream::MappedBlockStream(uint32_t StreamIdx, const PDBFile &File) :
     StreamLength = Pdb.getStreamByteSize(StreamIdx);
     BlockList = Pdb.getStreamBlockList(StreamIdx);
   }
+
+  // Find the runs of contiguous blocks, so that the reads within a run can
+  // refer to the file directly.
+  ContiguousBlocks.resize(BlockList.size());
+  for (uint32_t I = BlockList.size(); I-- != 0;) {
+    bool NextIsContiguous =
+        I + 1 < BlockList.size() && BlockList[I + 1] == BlockList[I] + 1;
+    ContiguousBlocks[I] = NextIsContiguous ? ContiguousBlocks[I + 1] + 1 : 1;
+  }
 }
 
 Error MappedBlockStream::readBytes(uint32_t Offset, uint32_t Size,
@@ -34,14 +43,11 @@ Error MappedBlockStream::readBytes(uint32_t Offset, uint32_t Size,
   if (tryReadContiguously(Offset, Size, Buffer))
     return Error::success();
 
-  auto CacheIter = CacheMap.find(Offset);
-  if (CacheIter != CacheMap.end()) {
-    // In a more general solution, we would need to guarantee that the
-    // cached allocation is at least the requested size.  In practice, since
-    // these are CodeView / PDB records, we know they are always formatted
-    // the same way and never change, so we should never be requesting two
-    // allocations from the same address with different sizes.
-    Buffer = ArrayRef<uint8_t>(CacheIter->second, Size);
+  // CodeView records are usually read whole, so a copy of the same offset is
+  // reused as long as it is large enough.
+  ArrayRef<uint8_t> &Cached = CacheMap[Offset];
+  if (Cached.size() >= Size) {
+    Buffer = Cached.slice(0, Size);
     return Error::success();
   }
 
@@ -51,8 +57,8 @@ Error MappedBlockStream::readBytes(uint32_t Offset, uint32_t Size,
 
   if (auto EC = readBytes(Offset, MutableArrayRef<uint8_t>(WriteBuffer, Size)))
     return EC;
-  CacheMap.insert(std::make_pair(Offset, WriteBuffer));
-  Buffer = ArrayRef<uint8_t>(WriteBuffer, Size);
+  Cached = ArrayRef<uint8_t>(WriteBuffer, Size);
+  Buffer = Cached;
   return Error::success();
 }
 
@@ -72,11 +78,9 @@ bool MappedBlockStream::tryReadContiguously(uint32_t Offset, uint32_t Size,
       Pdb.getBlockSize();
 
   uint32_t RequiredContiguousBlocks = NumAdditionalBlocks + 1;
-  uint32_t E = BlockList[BlockNum];
-  for (uint32_t I = 0; I < RequiredContiguousBlocks; ++I, ++E) {
-    if (BlockList[I + BlockNum] != E)
-      return false;
-  }
+  if (BlockNum >= ContiguousBlocks.size() ||
+      ContiguousBlocks[BlockNum] < RequiredContiguousBlocks)
+    return false;
 
   uint32_t FirstBlockAddr = BlockList[BlockNum];
   StringRef Str = Pdb.getBlockData(FirstBlockAddr, Pdb.getBlockSize());
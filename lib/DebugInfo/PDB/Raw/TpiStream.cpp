@@ -92,8 +92,11 @@ Error TpiStream::reload() {
   HashFunction = HashBufferV8;
 
   // The actual type records themselves come from this stream
-  if (auto EC = Reader.readArray(TypeRecords, Header->TypeRecordBytes))
+  if (auto EC =
+          Reader.readStreamRef(TypeRecordsBuffer, Header->TypeRecordBytes))
     return EC;
+  TypeRecords = codeview::CVTypeArray(TypeRecordsBuffer);
+  TypeRecordOffsets.clear();
 
   // Hash indices, hash values, etc come from the hash stream.
   MappedBlockStream HS(Header->HashStreamIndex, Pdb);
@@ -140,3 +143,33 @@ iterator_range<codeview::CVTypeArray::Iterator>
 TpiStream::types(bool *HadError) const {
   return llvm::make_range(TypeRecords.begin(HadError), TypeRecords.end());
 }
+
+Expected<codeview::CVType>
+TpiStream::getTypeRecord(codeview::TypeIndex TI) const {
+  if (TypeRecordOffsets.empty()) {
+    bool HadError = false;
+    uint32_t Offset = 0;
+    TypeRecordOffsets.reserve(NumTypeRecords());
+    for (const codeview::CVType &Type : types(&HadError)) {
+      TypeRecordOffsets.push_back(Offset);
+      Offset += Type.Length + 2;
+    }
+    if (HadError)
+      return make_error<RawError>(raw_error_code::corrupt_file,
+                                  "TPI Stream has a corrupt type record.");
+  }
+
+  uint32_t Index = TI.getIndex();
+  if (Index < TypeIndexBegin() ||
+      Index - TypeIndexBegin() >= TypeRecordOffsets.size())
+    return make_error<RawError>(raw_error_code::index_out_of_bounds,
+                                "Type index out of range.");
+  codeview::CVType Type;
+  uint32_t Length;
+  if (auto EC = codeview::VarStreamArrayExtractor<codeview::CVType>()(
+          TypeRecordsBuffer.drop_front(
+              TypeRecordOffsets[Index - TypeIndexBegin()]),
+          Length, Type))
+    return std::move(EC);
+  return Type;
+}
@@ -0,0 +1,328 @@
+//===-- SymbolizableIndex.cpp ---------------------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of SymbolizableIndex class.
+//
+// An index file consists of a header followed by four tables. All the fields
+// are little-endian:
+//
+//   Header:      magic "LLVMSYMX", u32 version, u32 flags, u32 function name
+//                kind, u32 #code ranges, u32 #frames, u32 #data ranges,
+//                u64 preferred base, u32 string table size, u32 reserved.
+//   Code ranges: u64 start, u32 first frame, u32 #inlined frames. The range
+//                extends to the start of the next one. Its frames are the
+//                result of symbolizeInlinedCode(), followed by the result of
+//                symbolizeCode().
+//   Frames:      u32 function name, u32 file name, u32 line, u32 column.
+//                Names are offsets in the string table.
+//   Data ranges: u64 start, u32 name, u32 reserved, u64 symbol start,
+//                u64 symbol size.
+//   Strings:     nul-terminated strings.
+//
+// Both range tables start at address 0 and are sorted, so that every address
+// belongs to exactly one range.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolizableIndex.h"
+#include "SymbolizableObjectFile.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+namespace llvm {
+namespace symbolize {
+
+using namespace support;
+
+static const char IndexMagic[] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'X'};
+static const uint32_t IndexVersion = 1;
+
+enum : unsigned {
+  HeaderSize = 48,
+  CodeRangeSize = 16,
+  FrameSize = 16,
+  DataRangeSize = 32
+};
+
+enum : uint32_t {
+  IndexFlagWin32Module = 1 << 0,
+  IndexFlagUseSymbolTable = 1 << 1
+};
+
+namespace {
+struct IndexFrame {
+  uint32_t FunctionName;
+  uint32_t FileName;
+  uint32_t Line;
+  uint32_t Column;
+};
+
+struct IndexCodeRange {
+  uint64_t Start;
+  uint32_t FirstFrame;
+  uint32_t NumFrames;
+};
+
+struct IndexDataRange {
+  uint64_t Start;
+  uint32_t Name;
+  uint64_t SymbolStart;
+  uint64_t SymbolSize;
+};
+
+class IndexStringTable {
+  StringMap<uint32_t> Offsets;
+  std::string Data;
+
+public:
+  uint32_t add(StringRef S) {
+    auto Insert = Offsets.insert(std::make_pair(S, Data.size()));
+    if (Insert.second) {
+      Data += S;
+      Data += '\0';
+    }
+    return Insert.first->second;
+  }
+  StringRef data() const { return Data; }
+};
+}
+
+static void sortUnique(std::vector<uint64_t> &V) {
+  std::sort(V.begin(), V.end());
+  V.erase(std::unique(V.begin(), V.end()), V.end());
+}
+
+static bool isSameInliningInfo(const DIInliningInfo &A,
+                               const DIInliningInfo &B) {
+  if (A.getNumberOfFrames() != B.getNumberOfFrames())
+    return false;
+  for (uint32_t I = 0, E = A.getNumberOfFrames(); I != E; ++I)
+    if (A.getFrame(I) != B.getFrame(I))
+      return false;
+  return true;
+}
+
+bool SymbolizableIndex::write(const SymbolizableObjectFile &Module,
+                              FunctionNameKind FNKind, bool UseSymbolTable,
+                              raw_ostream &OS) {
+  std::vector<uint64_t> CodeBoundaries;
+  if (!Module.getCodeBoundaries(CodeBoundaries))
+    return false;
+  sortUnique(CodeBoundaries);
+  std::vector<uint64_t> DataBoundaries;
+  Module.getDataBoundaries(DataBoundaries);
+  sortUnique(DataBoundaries);
+
+  IndexStringTable Strings;
+  std::vector<IndexFrame> Frames;
+  auto AddFrame = [&](const DILineInfo &Info) {
+    Frames.push_back({Strings.add(Info.FunctionName),
+                      Strings.add(Info.FileName), Info.Line, Info.Column});
+  };
+
+  // The results are the same between two boundaries, so only query the
+  // module at the boundaries, and merge the ranges that end up with the same
+  // results.
+  std::vector<IndexCodeRange> CodeRanges;
+  DIInliningInfo PrevInlinedInfo;
+  DILineInfo PrevLineInfo;
+  for (uint64_t Address : CodeBoundaries) {
+    DIInliningInfo InlinedInfo =
+        Module.symbolizeInlinedCode(Address, FNKind, UseSymbolTable);
+    DILineInfo LineInfo = Module.symbolizeCode(Address, FNKind, UseSymbolTable);
+    if (!CodeRanges.empty() && LineInfo == PrevLineInfo &&
+        isSameInliningInfo(InlinedInfo, PrevInlinedInfo))
+      continue;
+    CodeRanges.push_back({Address, uint32_t(Frames.size()),
+                          InlinedInfo.getNumberOfFrames()});
+    for (uint32_t I = 0, E = InlinedInfo.getNumberOfFrames(); I != E; ++I)
+      AddFrame(InlinedInfo.getFrame(I));
+    AddFrame(LineInfo);
+    PrevInlinedInfo = InlinedInfo;
+    PrevLineInfo = LineInfo;
+  }
+
+  std::vector<IndexDataRange> DataRanges;
+  DIGlobal PrevGlobal;
+  for (uint64_t Address : DataBoundaries) {
+    DIGlobal Global = Module.symbolizeData(Address);
+    if (!DataRanges.empty() && Global.Name == PrevGlobal.Name &&
+        Global.Start == PrevGlobal.Start && Global.Size == PrevGlobal.Size)
+      continue;
+    DataRanges.push_back(
+        {Address, Strings.add(Global.Name), Global.Start, Global.Size});
+    PrevGlobal = Global;
+  }
+
+  uint32_t Flags = 0;
+  if (Module.isWin32Module())
+    Flags |= IndexFlagWin32Module;
+  if (UseSymbolTable)
+    Flags |= IndexFlagUseSymbolTable;
+
+  endian::Writer<little> W(OS);
+  OS.write(IndexMagic, sizeof(IndexMagic));
+  W.write<uint32_t>(IndexVersion);
+  W.write<uint32_t>(Flags);
+  W.write<uint32_t>(static_cast<uint32_t>(FNKind));
+  W.write<uint32_t>(CodeRanges.size());
+  W.write<uint32_t>(Frames.size());
+  W.write<uint32_t>(DataRanges.size());
+  W.write<uint64_t>(Module.getModulePreferredBase());
+  W.write<uint32_t>(Strings.data().size());
+  W.write<uint32_t>(0);
+  for (const IndexCodeRange &R : CodeRanges) {
+    W.write<uint64_t>(R.Start);
+    W.write<uint32_t>(R.FirstFrame);
+    W.write<uint32_t>(R.NumFrames);
+  }
+  for (const IndexFrame &F : Frames) {
+    W.write<uint32_t>(F.FunctionName);
+    W.write<uint32_t>(F.FileName);
+    W.write<uint32_t>(F.Line);
+    W.write<uint32_t>(F.Column);
+  }
+  for (const IndexDataRange &R : DataRanges) {
+    W.write<uint64_t>(R.Start);
+    W.write<uint32_t>(R.Name);
+    W.write<uint32_t>(0);
+    W.write<uint64_t>(R.SymbolStart);
+    W.write<uint64_t>(R.SymbolSize);
+  }
+  OS << Strings.data();
+  return true;
+}
+
+std::unique_ptr<SymbolizableIndex>
+SymbolizableIndex::create(std::unique_ptr<MemoryBuffer> Buffer,
+                          FunctionNameKind FNKind, bool UseSymbolTable) {
+  const char *Start = Buffer->getBufferStart();
+  uint64_t Size = Buffer->getBufferSize();
+  if (Size < HeaderSize ||
+      memcmp(Start, IndexMagic, sizeof(IndexMagic)) != 0 ||
+      endian::read32le(Start + 8) != IndexVersion)
+    return nullptr;
+
+  uint32_t Flags = endian::read32le(Start + 12);
+  if (endian::read32le(Start + 16) != static_cast<uint32_t>(FNKind) ||
+      bool(Flags & IndexFlagUseSymbolTable) != UseSymbolTable)
+    return nullptr;
+
+  std::unique_ptr<SymbolizableIndex> Index(
+      new SymbolizableIndex(std::move(Buffer)));
+  Index->IsWin32Module = Flags & IndexFlagWin32Module;
+  Index->NumCodeRanges = endian::read32le(Start + 20);
+  Index->NumFrames = endian::read32le(Start + 24);
+  Index->NumDataRanges = endian::read32le(Start + 28);
+  Index->PreferredBase = endian::read64le(Start + 32);
+  Index->StringTableSize = endian::read32le(Start + 40);
+
+  uint64_t ExpectedSize = HeaderSize +
+                          uint64_t(Index->NumCodeRanges) * CodeRangeSize +
+                          uint64_t(Index->NumFrames) * FrameSize +
+                          uint64_t(Index->NumDataRanges) * DataRangeSize +
+                          Index->StringTableSize;
+  if (Size != ExpectedSize)
+    return nullptr;
+
+  Index->CodeRanges = Start + HeaderSize;
+  Index->Frames = Index->CodeRanges + Index->NumCodeRanges * CodeRangeSize;
+  Index->DataRanges = Index->Frames + Index->NumFrames * FrameSize;
+  Index->StringTable = Index->DataRanges + Index->NumDataRanges * DataRangeSize;
+  // Make sure that any offset in the string table points to a terminated
+  // string.
+  if (Index->StringTableSize &&
+      Index->StringTable[Index->StringTableSize - 1] != '\0')
+    return nullptr;
+  return Index;
+}
+
+uint32_t SymbolizableIndex::findRange(const char *Ranges, uint32_t NumRanges,
+                                      unsigned EntrySize, uint64_t Address) {
+  // Find the last range starting at or before Address. The first range
+  // starts at 0, so there is always one.
+  uint32_t Low = 0, High = NumRanges;
+  while (High - Low > 1) {
+    uint32_t Mid = Low + (High - Low) / 2;
+    if (endian::read64le(Ranges + uint64_t(Mid) * EntrySize) <= Address)
+      Low = Mid;
+    else
+      High = Mid;
+  }
+  return Low;
+}
+
+const char *SymbolizableIndex::getString(uint32_t Offset) const {
+  if (Offset >= StringTableSize)
+    return "";
+  return StringTable + Offset;
+}
+
+DILineInfo SymbolizableIndex::getFrame(uint32_t Index) const {
+  DILineInfo Info;
+  if (Index >= NumFrames)
+    return Info;
+  const char *Frame = Frames + uint64_t(Index) * FrameSize;
+  Info.FunctionName = getString(endian::read32le(Frame));
+  Info.FileName = getString(endian::read32le(Frame + 4));
+  Info.Line = endian::read32le(Frame + 8);
+  Info.Column = endian::read32le(Frame + 12);
+  return Info;
+}
+
+DILineInfo SymbolizableIndex::symbolizeCode(uint64_t ModuleOffset,
+                                            FunctionNameKind FNKind,
+                                            bool UseSymbolTable) const {
+  if (!NumCodeRanges)
+    return DILineInfo();
+  const char *Range =
+      CodeRanges + uint64_t(findRange(CodeRanges, NumCodeRanges,
+                                      CodeRangeSize, ModuleOffset)) *
+                       CodeRangeSize;
+  return getFrame(endian::read32le(Range + 8) + endian::read32le(Range + 12));
+}
+
+DIInliningInfo SymbolizableIndex::symbolizeInlinedCode(
+    uint64_t ModuleOffset, FunctionNameKind FNKind, bool UseSymbolTable) const {
+  DIInliningInfo InlinedContext;
+  if (NumCodeRanges) {
+    const char *Range =
+        CodeRanges + uint64_t(findRange(CodeRanges, NumCodeRanges,
+                                        CodeRangeSize, ModuleOffset)) *
+                         CodeRangeSize;
+    uint32_t FirstFrame = endian::read32le(Range + 8);
+    for (uint32_t I = 0, E = endian::read32le(Range + 12); I != E; ++I)
+      InlinedContext.addFrame(getFrame(FirstFrame + I));
+  }
+  if (InlinedContext.getNumberOfFrames() == 0)
+    InlinedContext.addFrame(DILineInfo());
+  return InlinedContext;
+}
+
+DIGlobal SymbolizableIndex::symbolizeData(uint64_t ModuleOffset) const {
+  DIGlobal Res;
+  if (!NumDataRanges)
+    return Res;
+  const char *Range =
+      DataRanges + uint64_t(findRange(DataRanges, NumDataRanges,
+                                      DataRangeSize, ModuleOffset)) *
+                       DataRangeSize;
+  Res.Name = getString(endian::read32le(Range + 8));
+  Res.Start = endian::read64le(Range + 16);
+  Res.Size = endian::read64le(Range + 24);
+  return Res;
+}
+
+} // namespace symbolize
+} // namespace llvm
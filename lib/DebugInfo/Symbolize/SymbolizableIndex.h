@@ -0,0 +1,88 @@
+//===-- SymbolizableIndex.h ------------------------------------- C++ -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the SymbolizableIndex class, which answers symbolization
+// queries from a precomputed, memory-mapped address index.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZABLEINDEX_H
+#define LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZABLEINDEX_H
+
+#include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace llvm {
+namespace symbolize {
+
+class SymbolizableObjectFile;
+
+/// A symbolizable module backed by an index file. The index maps address
+/// ranges to the results that the module it was built from gives for them,
+/// so that queries are a binary search in the mapped file and no debug info
+/// needs to be parsed.
+///
+/// The index is only valid for the \c FunctionNameKind and symbol table usage
+/// it was built with.
+class SymbolizableIndex : public SymbolizableModule {
+public:
+  /// Write the index of \p Module to \p OS. Returns false if the results of
+  /// \p Module can't be indexed.
+  static bool write(const SymbolizableObjectFile &Module,
+                    FunctionNameKind FNKind, bool UseSymbolTable,
+                    raw_ostream &OS);
+
+  /// Create a module from the index in \p Buffer. Returns null if the buffer
+  /// is not a valid index for \p FNKind and \p UseSymbolTable.
+  static std::unique_ptr<SymbolizableIndex>
+  create(std::unique_ptr<MemoryBuffer> Buffer, FunctionNameKind FNKind,
+         bool UseSymbolTable);
+
+  DILineInfo symbolizeCode(uint64_t ModuleOffset, FunctionNameKind FNKind,
+                           bool UseSymbolTable) const override;
+  DIInliningInfo symbolizeInlinedCode(uint64_t ModuleOffset,
+                                      FunctionNameKind FNKind,
+                                      bool UseSymbolTable) const override;
+  DIGlobal symbolizeData(uint64_t ModuleOffset) const override;
+
+  bool isWin32Module() const override { return IsWin32Module; }
+  uint64_t getModulePreferredBase() const override { return PreferredBase; }
+
+private:
+  SymbolizableIndex(std::unique_ptr<MemoryBuffer> Buffer)
+      : Buffer(std::move(Buffer)) {}
+
+  /// Return the index of the range of the \p NumRanges ranges of \p EntrySize
+  /// bytes at \p Ranges that contains \p Address.
+  static uint32_t findRange(const char *Ranges, uint32_t NumRanges,
+                            unsigned EntrySize, uint64_t Address);
+  DILineInfo getFrame(uint32_t Index) const;
+  const char *getString(uint32_t Offset) const;
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  bool IsWin32Module;
+  uint64_t PreferredBase;
+  uint32_t NumCodeRanges;
+  uint32_t NumFrames;
+  uint32_t NumDataRanges;
+  uint32_t StringTableSize;
+  const char *CodeRanges;
+  const char *Frames;
+  const char *DataRanges;
+  const char *StringTable;
+};
+
+} // namespace symbolize
+} // namespace llvm
+
+#endif // LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZABLEINDEX_H
@@ -15,6 +15,7 @@
 #include "llvm/Object/SymbolSize.h"
 #include "llvm/Support/DataExtractor.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/DebugInfo/DWARF/DWARFDebugArangeSet.h"
 
 namespace llvm {
 namespace symbolize {
@@ -245,6 +246,73 @@ DIInliningInfo SymbolizableObjectFile::symbolizeInlinedCode(
   return InlinedContext;
 }
 
+template <typename SymbolMapTy>
+static void addSymbolBoundaries(const SymbolMapTy &SymbolMap,
+                                std::vector<uint64_t> &Boundaries) {
+  for (const auto &P : SymbolMap) {
+    Boundaries.push_back(P.first.Addr);
+    if (P.first.Size != 0)
+      Boundaries.push_back(P.first.Addr + P.first.Size);
+  }
+}
+
+static void addRangeBoundaries(const DWARFAddressRangesVector &Ranges,
+                               std::vector<uint64_t> &Boundaries) {
+  for (const auto &R : Ranges) {
+    Boundaries.push_back(R.first);
+    Boundaries.push_back(R.second);
+  }
+}
+
+bool SymbolizableObjectFile::getCodeBoundaries(
+    std::vector<uint64_t> &Boundaries) const {
+  Boundaries.push_back(0);
+  addSymbolBoundaries(Functions, Boundaries);
+  if (!DebugInfoContext)
+    return true;
+
+  auto *DwarfCtx = dyn_cast<DWARFContext>(DebugInfoContext.get());
+  if (!DwarfCtx)
+    return false;
+
+  // The compile unit for an address is looked up in .debug_aranges, falling
+  // back to the ranges of the compile units.
+  DataExtractor ArangesData(DwarfCtx->getARangeSection(),
+                            DwarfCtx->isLittleEndian(), 0);
+  uint32_t Offset = 0;
+  DWARFDebugArangeSet Set;
+  while (Set.extract(ArangesData, &Offset))
+    for (const auto &Desc : Set.descriptors()) {
+      Boundaries.push_back(Desc.Address);
+      Boundaries.push_back(Desc.getEndAddress());
+    }
+
+  for (const auto &CU : DwarfCtx->compile_units()) {
+    const DWARFDebugInfoEntryMinimal *CUDie = CU->getUnitDIE();
+    if (!CUDie)
+      continue;
+    // The inlined chain would come from the .dwo file.
+    if (CUDie->getAttributeValueAsString(CU.get(), dwarf::DW_AT_GNU_dwo_name,
+                                         nullptr))
+      return false;
+    // Line info changes at each row of the line table, and the inlined chain
+    // at the bounds of the DIEs that it is made of.
+    if (const auto *LineTable = DwarfCtx->getLineTableForUnit(CU.get()))
+      for (const auto &Row : LineTable->Rows)
+        Boundaries.push_back(Row.Address);
+    for (unsigned I = 0, E = CU->getNumDIEs(); I != E; ++I)
+      addRangeBoundaries(CU->getDIEAtIndex(I)->getAddressRanges(CU.get()),
+                         Boundaries);
+  }
+  return true;
+}
+
+void SymbolizableObjectFile::getDataBoundaries(
+    std::vector<uint64_t> &Boundaries) const {
+  Boundaries.push_back(0);
+  addSymbolBoundaries(Objects, Boundaries);
+}
+
 DIGlobal SymbolizableObjectFile::symbolizeData(uint64_t ModuleOffset) const {
   DIGlobal Res;
   getNameFromSymbolTable(SymbolRef::ST_Data, ModuleOffset, Res.Name, Res.Start,
@@ -15,6 +15,7 @@
 
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include <map>
+#include <vector>
 
 namespace llvm {
 class DataExtractor;
@@ -42,6 +43,15 @@ public:
   // it in memory assuming there were no conflicts.
   uint64_t getModulePreferredBase() const override;
 
+  // Collect the addresses at which the results of symbolizeCode() and
+  // symbolizeInlinedCode() may change, so that the results are the same for
+  // all the addresses between two consecutive boundaries. Returns false if
+  // they can't be determined, e.g. for PDB or split DWARF debug info.
+  bool getCodeBoundaries(std::vector<uint64_t> &Boundaries) const;
+
+  // Same as getCodeBoundaries(), for the results of symbolizeData().
+  void getDataBoundaries(std::vector<uint64_t> &Boundaries) const;
+
 private:
   bool shouldOverrideWithSymbolTable(FunctionNameKind FNKind,
                                      bool UseSymbolTable) const;
@@ -13,9 +13,11 @@
 
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 
+#include "SymbolizableIndex.h"
 #include "SymbolizableObjectFile.h"
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
 #include "llvm/DebugInfo/PDB/PDB.h"
@@ -31,6 +33,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
@@ -52,10 +55,11 @@ namespace symbolize {
 
 ErrorOr<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                                                   uint64_t ModuleOffset) {
-  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (auto EC = InfoOrErr.getError())
-    return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
+  std::unique_lock<std::mutex> EntryLock;
+  auto Entry = getOrCreateModuleInfo(ModuleName, EntryLock);
+  if (Entry->EC)
+    return Entry->EC;
+  SymbolizableModule *Info = Entry->Module.get();
 
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
@@ -72,10 +76,11 @@ ErrorOr<DILineInfo> LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
 ErrorOr<DIInliningInfo>
 LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
                                      uint64_t ModuleOffset) {
-  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (auto EC = InfoOrErr.getError())
-    return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
+  std::unique_lock<std::mutex> EntryLock;
+  auto Entry = getOrCreateModuleInfo(ModuleName, EntryLock);
+  if (Entry->EC)
+    return Entry->EC;
+  SymbolizableModule *Info = Entry->Module.get();
 
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
@@ -95,10 +100,11 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
 
 ErrorOr<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                                                 uint64_t ModuleOffset) {
-  auto InfoOrErr = getOrCreateModuleInfo(ModuleName);
-  if (auto EC = InfoOrErr.getError())
-    return EC;
-  SymbolizableModule *Info = InfoOrErr.get();
+  std::unique_lock<std::mutex> EntryLock;
+  auto Entry = getOrCreateModuleInfo(ModuleName, EntryLock);
+  if (Entry->EC)
+    return Entry->EC;
+  SymbolizableModule *Info = Entry->Module.get();
 
   // If the user is giving us relative addresses, add the preferred base of
   // the object to the offset before we do the query. It's what DIContext
@@ -113,10 +119,9 @@ ErrorOr<DIGlobal> LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
 }
 
 void LLVMSymbolizer::flush() {
-  ObjectForUBPathAndArch.clear();
-  BinaryForPath.clear();
-  ObjectPairForPathArch.clear();
+  std::lock_guard<std::mutex> Lock(CacheMutex);
   Modules.clear();
+  ModuleLRU.clear();
 }
 
 namespace {
@@ -220,8 +225,10 @@ bool darwinDsymMatchesBinary(const MachOObjectFile *DbgObj,
 
 } // end anonymous namespace
 
-ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
-    const MachOObjectFile *MachExeObj, const std::string &ArchName) {
+ObjectFile *LLVMSymbolizer::lookUpDsymFile(ObjectCache &Cache,
+                                           const std::string &ExePath,
+                                           const MachOObjectFile *MachExeObj,
+                                           const std::string &ArchName) {
   // On Darwin we may find DWARF in separate object file in
   // resource directory.
   std::vector<std::string> DsymPaths;
@@ -231,7 +238,7 @@ ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
     DsymPaths.push_back(getDarwinDWARFResourceForPath(Path, Filename));
   }
   for (const auto &Path : DsymPaths) {
-    auto DbgObjOrErr = getOrCreateObject(Path, ArchName);
+    auto DbgObjOrErr = getOrCreateObject(Cache, Path, ArchName);
     if (!DbgObjOrErr)
       continue;
     ObjectFile *DbgObj = DbgObjOrErr.get();
@@ -244,7 +251,8 @@ ObjectFile *LLVMSymbolizer::lookUpDsymFile(const std::string &ExePath,
   return nullptr;
 }
 
-ObjectFile *LLVMSymbolizer::lookUpDebuglinkObject(const std::string &Path,
+ObjectFile *LLVMSymbolizer::lookUpDebuglinkObject(ObjectCache &Cache,
+                                                  const std::string &Path,
                                                   const ObjectFile *Obj,
                                                   const std::string &ArchName) {
   std::string DebuglinkName;
@@ -254,20 +262,22 @@ ObjectFile *LLVMSymbolizer::lookUpDebuglinkObject(const std::string &Path,
     return nullptr;
   if (!findDebugBinary(Path, DebuglinkName, CRCHash, DebugBinaryPath))
     return nullptr;
-  auto DbgObjOrErr = getOrCreateObject(DebugBinaryPath, ArchName);
+  auto DbgObjOrErr = getOrCreateObject(Cache, DebugBinaryPath, ArchName);
   if (!DbgObjOrErr)
     return nullptr;
   return DbgObjOrErr.get();
 }
 
 ErrorOr<LLVMSymbolizer::ObjectPair>
-LLVMSymbolizer::getOrCreateObjectPair(const std::string &Path,
+LLVMSymbolizer::getOrCreateObjectPair(ObjectCache &Cache,
+                                      const std::string &Path,
                                       const std::string &ArchName) {
+  auto &ObjectPairForPathArch = Cache.ObjectPairForPathArch;
   const auto &I = ObjectPairForPathArch.find(std::make_pair(Path, ArchName));
   if (I != ObjectPairForPathArch.end())
     return I->second;
 
-  auto ObjOrErr = getOrCreateObject(Path, ArchName);
+  auto ObjOrErr = getOrCreateObject(Cache, Path, ArchName);
   if (auto EC = ObjOrErr.getError()) {
     ObjectPairForPathArch.insert(
         std::make_pair(std::make_pair(Path, ArchName), EC));
@@ -279,9 +289,9 @@ LLVMSymbolizer::getOrCreateObjectPair(const std::string &Path,
   ObjectFile *DbgObj = nullptr;
 
   if (auto MachObj = dyn_cast<const MachOObjectFile>(Obj))
-    DbgObj = lookUpDsymFile(Path, MachObj, ArchName);
+    DbgObj = lookUpDsymFile(Cache, Path, MachObj, ArchName);
   if (!DbgObj)
-    DbgObj = lookUpDebuglinkObject(Path, Obj, ArchName);
+    DbgObj = lookUpDebuglinkObject(Cache, Path, Obj, ArchName);
   if (!DbgObj)
     DbgObj = Obj;
   ObjectPair Res = std::make_pair(Obj, DbgObj);
@@ -291,8 +301,10 @@ LLVMSymbolizer::getOrCreateObjectPair(const std::string &Path,
 }
 
 ErrorOr<ObjectFile *>
-LLVMSymbolizer::getOrCreateObject(const std::string &Path,
+LLVMSymbolizer::getOrCreateObject(ObjectCache &Cache, const std::string &Path,
                                   const std::string &ArchName) {
+  auto &BinaryForPath = Cache.BinaryForPath;
+  auto &ObjectForUBPathAndArch = Cache.ObjectForUBPathAndArch;
   const auto &I = BinaryForPath.find(Path);
   Binary *Bin = nullptr;
   if (I == BinaryForPath.end()) {
@@ -337,15 +349,116 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return object_error::arch_not_found;
 }
 
-ErrorOr<SymbolizableModule *>
-LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  const auto &I = Modules.find(ModuleName);
-  if (I != Modules.end()) {
-    auto &InfoOrErr = I->second;
-    if (auto EC = InfoOrErr.getError())
-      return EC;
-    return InfoOrErr->get();
+namespace {
+
+// Return the build ID of the object as a hex string, or an empty string if it
+// doesn't have one.
+std::string getBuildID(const ObjectFile *Obj) {
+  if (auto *MachO = dyn_cast<MachOObjectFile>(Obj)) {
+    ArrayRef<uint8_t> UUID = MachO->getUuid();
+    return toHex(StringRef((const char *)UUID.data(), UUID.size()));
+  }
+  if (!isa<ELFObjectFileBase>(Obj))
+    return "";
+  for (const SectionRef &Section : Obj->sections()) {
+    StringRef Name;
+    StringRef Data;
+    if (Section.getName(Name) || Name != ".note.gnu.build-id" ||
+        Section.getContents(Data))
+      continue;
+    // The note is made of namesz, descsz and type, followed by the name and
+    // the description (the build ID), both 4-byte aligned.
+    DataExtractor DE(Data, Obj->isLittleEndian(), 0);
+    uint32_t Offset = 0;
+    uint32_t NameSize = DE.getU32(&Offset);
+    uint32_t DescSize = DE.getU32(&Offset);
+    uint32_t Type = DE.getU32(&Offset);
+    const uint32_t NT_GNU_BUILD_ID = 3;
+    uint64_t DescOffset = Offset + alignTo(NameSize, 4);
+    if (Type != NT_GNU_BUILD_ID || DescOffset + DescSize > Data.size())
+      continue;
+    return toHex(Data.substr(DescOffset, DescSize));
+  }
+  return "";
+}
+
+// Write the index of the module to the index cache. This is best effort:
+// errors are ignored, and the index is written to a temporary file first so
+// that concurrent symbolizers never see a partial index.
+void writeIndexCacheFile(const SymbolizableObjectFile &Module,
+                         const LLVMSymbolizer::Options &Opts,
+                         const std::string &IndexPath) {
+  if (sys::fs::create_directories(Opts.IndexCacheDir))
+    return;
+  int FD;
+  SmallString<128> TempPath;
+  if (sys::fs::createUniqueFile(IndexPath + ".tmp%%%%%%", FD, TempPath))
+    return;
+  bool Written;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    Written = SymbolizableIndex::write(Module, Opts.PrintFunctions,
+                                       Opts.UseSymbolTable, OS);
+    OS.close();
+    Written &= !OS.has_error();
+    OS.clear_error();
   }
+  if (!Written || sys::fs::rename(TempPath, IndexPath))
+    sys::fs::remove(TempPath);
+}
+
+} // end anonymous namespace
+
+std::string LLVMSymbolizer::getIndexCachePath(const ObjectFile *Obj) const {
+  if (Opts.IndexCacheDir.empty())
+    return "";
+  std::string BuildID = getBuildID(Obj);
+  if (BuildID.empty())
+    return "";
+  // The results depend on these options, so they are part of the key.
+  SmallString<128> Path(Opts.IndexCacheDir);
+  sys::path::append(Path, BuildID + "-" +
+                              utostr(static_cast<unsigned>(Opts.PrintFunctions)) +
+                              (Opts.UseSymbolTable ? "s" : "") + ".symidx");
+  return Path.str();
+}
+
+std::shared_ptr<LLVMSymbolizer::CachedModule>
+LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName,
+                                      std::unique_lock<std::mutex> &EntryLock) {
+  std::shared_ptr<CachedModule> Entry;
+  {
+    std::lock_guard<std::mutex> Lock(CacheMutex);
+    const auto &I = Modules.find(ModuleName);
+    if (I != Modules.end()) {
+      Entry = I->second;
+      ModuleLRU.splice(ModuleLRU.begin(), ModuleLRU, Entry->LRUPos);
+    } else {
+      Entry = std::make_shared<CachedModule>();
+      ModuleLRU.push_front(ModuleName);
+      Entry->LRUPos = ModuleLRU.begin();
+      Modules.insert(std::make_pair(ModuleName, Entry));
+      // Evict the least recently used modules. Queries that are still running
+      // on an evicted module keep it alive until they are done.
+      while (Opts.MaxCachedModules && Modules.size() > Opts.MaxCachedModules) {
+        Modules.erase(ModuleLRU.back());
+        ModuleLRU.pop_back();
+      }
+    }
+  }
+
+  // Create the module outside of the cache lock, so that queries on other
+  // modules are not blocked by the creation of this one.
+  EntryLock = std::unique_lock<std::mutex>(Entry->Mutex);
+  if (!Entry->Created) {
+    createModuleInfo(ModuleName, *Entry);
+    Entry->Created = true;
+  }
+  return Entry;
+}
+
+void LLVMSymbolizer::createModuleInfo(const std::string &ModuleName,
+                                      CachedModule &Entry) {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -357,14 +470,29 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       ArchName = ArchStr;
     }
   }
-  auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
+  auto ObjectsOrErr = getOrCreateObjectPair(Entry.Objects, BinaryName,
+                                            ArchName);
   if (auto EC = ObjectsOrErr.getError()) {
     // Failed to find valid object file.
-    Modules.insert(std::make_pair(ModuleName, EC));
-    return EC;
+    Entry.EC = EC;
+    return;
   }
   ObjectPair Objects = ObjectsOrErr.get();
 
+  // Use the cached index of the module if there is one.
+  std::string IndexPath = getIndexCachePath(Objects.first);
+  if (!IndexPath.empty()) {
+    auto BufOrErr = MemoryBuffer::getFile(IndexPath, -1,
+                                          /*RequiresNullTerminator=*/false);
+    if (BufOrErr) {
+      if (auto Index = SymbolizableIndex::create(
+              std::move(*BufOrErr), Opts.PrintFunctions, Opts.UseSymbolTable)) {
+        Entry.Module = std::move(Index);
+        return;
+      }
+    }
+  }
+
   std::unique_ptr<DIContext> Context;
   if (auto CoffObject = dyn_cast<COFFObjectFile>(Objects.first)) {
     using namespace pdb;
@@ -386,12 +514,13 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   assert(Context);
   auto InfoOrErr =
       SymbolizableObjectFile::create(Objects.first, std::move(Context));
-  auto InsertResult =
-      Modules.insert(std::make_pair(ModuleName, std::move(InfoOrErr)));
-  assert(InsertResult.second);
-  if (auto EC = InsertResult.first->second.getError())
-    return EC;
-  return InsertResult.first->second->get();
+  if (InfoOrErr && !IndexPath.empty())
+    writeIndexCacheFile(**InfoOrErr, Opts, IndexPath);
+  if (auto EC = InfoOrErr.getError()) {
+    Entry.EC = EC;
+    return;
+  }
+  Entry.Module = std::move(*InfoOrErr);
 }
 
 namespace {
@@ -451,6 +580,9 @@ std::string LLVMSymbolizer::DemangleName(const std::string &Name,
   if (!Name.empty() && Name.front() == '?') {
     // Only do MSVC C++ demangling on symbols starting with '?'.
     char DemangledName[1024] = {0};
+    // DbgHelp functions are not thread safe.
+    static std::mutex DbgHelpMutex;
+    std::lock_guard<std::mutex> Lock(DbgHelpMutex);
     DWORD result = ::UnDecorateSymbolName(
         Name.c_str(), DemangledName, 1023,
         UNDNAME_NO_ACCESS_SPECIFIERS |       // Strip public, private, protected
@@ -0,0 +1,133 @@
+//===- FileObjectCache.cpp - On-disk object cache for JITs ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the on-disk ObjectCache for MCJIT and Orc.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/FileObjectCache.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "object-cache"
+
+STATISTIC(NumCacheHits, "Number of objects loaded from the object cache");
+STATISTIC(NumCacheMisses, "Number of objects missing from the object cache");
+STATISTIC(NumCacheStores, "Number of objects stored in the object cache");
+
+FileObjectCache::FileObjectCache(StringRef CacheDir, const TargetMachine &TM)
+    : CacheDir(CacheDir), Pruning(CacheDir) {
+  raw_string_ostream OS(TargetKey);
+  OS << TM.getTargetTriple().str() << '\0' << TM.getTargetCPU() << '\0'
+     << TM.getTargetFeatureString() << '\0' << unsigned(TM.getOptLevel());
+  OS.flush();
+  Pruning.setPruningInterval(1200).setMaxSize(75);
+}
+
+FileObjectCache::~FileObjectCache() {}
+
+std::string FileObjectCache::computeKey(const Module &M) {
+  SmallString<0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(&M, OS);
+  }
+  SHA1 Hasher;
+  Hasher.update(Bitcode);
+  Hasher.update(TargetKey);
+  return toHex(Hasher.result());
+}
+
+std::string FileObjectCache::getEntryPath(const Module &M) {
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, "llvmcache-obj-" + computeKey(M));
+  return Path.str();
+}
+
+std::unique_ptr<MemoryBuffer> FileObjectCache::getObject(const Module *M) {
+  std::string Key = computeKey(*M);
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, "llvmcache-obj-" + Key);
+
+  // Entries are only ever renamed into place, so a file that exists is
+  // complete and can be mapped without taking a lock.
+  auto BufferOrErr = MemoryBuffer::getFile(Path, -1,
+                                           /*RequiresNullTerminator=*/false);
+  if (!BufferOrErr) {
+    DEBUG(dbgs() << "Object cache miss for '" << M->getModuleIdentifier()
+                 << "'\n");
+    ++NumCacheMisses;
+    std::lock_guard<std::mutex> Lock(KeysMutex);
+    PendingKeys[M] = std::move(Key);
+    return nullptr;
+  }
+
+  DEBUG(dbgs() << "Object cache hit for '" << M->getModuleIdentifier()
+               << "': " << Path << "\n");
+  ++NumCacheHits;
+  return std::move(*BufferOrErr);
+}
+
+void FileObjectCache::notifyObjectCompiled(const Module *M,
+                                           MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(KeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = computeKey(*M);
+
+  if (sys::fs::create_directories(CacheDir))
+    return;
+
+  SmallString<128> Path(CacheDir);
+  sys::path::append(Path, "llvmcache-obj-" + Key);
+
+  // Write to a temporary file in the cache directory and rename it into
+  // place, which is atomic, so that concurrent readers see either the whole
+  // object or none.
+  SmallString<128> TempModel(CacheDir);
+  sys::path::append(TempModel, "llvmcache-obj-%%%%%%%%.tmp");
+  SmallString<128> TempPath;
+  int TempFD;
+  if (sys::fs::createUniqueFile(TempModel, TempFD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(TempFD, /*shouldClose=*/true);
+    OS << Obj.getBuffer();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempPath, Path)) {
+    sys::fs::remove(TempPath);
+    return;
+  }
+  ++NumCacheStores;
+
+  Pruning.prune();
+}
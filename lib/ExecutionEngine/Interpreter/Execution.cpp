@@ -40,7 +40,35 @@ static cl::opt<bool> PrintVolatile("interpreter-print-volatile", cl::Hidden,
 //===----------------------------------------------------------------------===//
 
 static void SetValue(Value *V, GenericValue Val, ExecutionContext &SF) {
-  SF.Values[V] = Val;
+  auto I = SF.Slots->Slots.find(V);
+  assert(I != SF.Slots->Slots.end() &&
+         !(I->second & FunctionSlots::ConstantBit) &&
+         "Value has no slot in this stack frame!");
+  // Lowering intrinsics can add values to a function that is running.
+  if (I->second >= SF.Values.size())
+    SF.Values.resize(SF.Slots->NumFrameSlots);
+  SF.Values[I->second] = Val;
+}
+
+// Give a slot to each value of F that does not have one yet. The slots of the
+// values that are already numbered do not change.
+static void numberFunctionValues(FunctionSlots &FS, Function &F) {
+  for (Argument &A : F.args())
+    if (!FS.Slots.count(&A))
+      FS.Slots[&A] = FS.NumFrameSlots++;
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      if (!I.getType()->isVoidTy() && !FS.Slots.count(&I))
+        FS.Slots[&I] = FS.NumFrameSlots++;
+
+  for (BasicBlock &BB : F)
+    for (Instruction &I : BB)
+      for (Value *Op : I.operands())
+        if (isa<Constant>(Op) && !FS.Slots.count(Op)) {
+          FS.Slots[Op] = FS.Constants.size() | FunctionSlots::ConstantBit;
+          FS.Constants.emplace_back();
+        }
+  FS.ConstantIsValid.resize(FS.Constants.size());
 }
 
 //===----------------------------------------------------------------------===//
@@ -1091,7 +1119,9 @@ void Interpreter::visitCallSite(CallSite CS) {
       bool atBegin(Parent->begin() == me);
       if (!atBegin)
         --me;
+      SF.Slots->Slots.erase(CS.getInstruction());
       IL->LowerIntrinsicCall(cast<CallInst>(CS.getInstruction()));
+      numberFunctionValues(*SF.Slots, *Parent->getParent());
 
       // Restore the CurInst pointer to the first instruction newly inserted, if
       // any.
@@ -2054,16 +2084,47 @@ GenericValue Interpreter::getConstantExprValue (ConstantExpr *CE,
   return Dest;
 }
 
-GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
-  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+GenericValue Interpreter::getConstantOperandValue(Constant *C,
+                                                  ExecutionContext &SF) {
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(C))
     return getConstantExprValue(CE, SF);
-  } else if (Constant *CPV = dyn_cast<Constant>(V)) {
-    return getConstantValue(CPV);
-  } else if (GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+  if (GlobalValue *GV = dyn_cast<GlobalValue>(C))
     return PTOGV(getPointerToGlobal(GV));
-  } else {
-    return SF.Values[V];
+  return getConstantValue(C);
+}
+
+GenericValue Interpreter::getOperandValue(Value *V, ExecutionContext &SF) {
+  FunctionSlots &FS = *SF.Slots;
+  auto I = FS.Slots.find(V);
+  if (I == FS.Slots.end()) {
+    // Not an operand of the function, e.g. an operand of a constant
+    // expression.
+    if (Constant *C = dyn_cast<Constant>(V))
+      return getConstantOperandValue(C, SF);
+    return GenericValue();
   }
+
+  unsigned Slot = I->second;
+  if (!(Slot & FunctionSlots::ConstantBit))
+    return Slot < SF.Values.size() ? SF.Values[Slot] : GenericValue();
+
+  // Constants are only evaluated when they are first used, as before, but
+  // their value is then reused.
+  Slot &= ~FunctionSlots::ConstantBit;
+  if (!FS.ConstantIsValid[Slot]) {
+    FS.Constants[Slot] = getConstantOperandValue(cast<Constant>(V), SF);
+    FS.ConstantIsValid[Slot] = true;
+  }
+  return FS.Constants[Slot];
+}
+
+FunctionSlots &Interpreter::getFunctionSlots(Function *F) {
+  std::unique_ptr<FunctionSlots> &FS = FunctionSlotMap[F];
+  if (!FS) {
+    FS = llvm::make_unique<FunctionSlots>();
+    numberFunctionValues(*FS, *F);
+  }
+  return *FS;
 }
 
 //===----------------------------------------------------------------------===//
@@ -2090,6 +2151,10 @@ void Interpreter::callFunction(Function *F, ArrayRef<GenericValue> ArgVals) {
     return;
   }
 
+  // Make room for the values computed by this invocation.
+  StackFrame.Slots = &getFunctionSlots(F);
+  StackFrame.Values.resize(StackFrame.Slots->NumFrameSlots);
+
   // Get pointers to first LLVM BB & Instruction in function.
   StackFrame.CurBB     = &F->front();
   StackFrame.CurInst   = StackFrame.CurBB->begin();
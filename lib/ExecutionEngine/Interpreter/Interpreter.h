@@ -14,6 +14,7 @@
 #ifndef LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 #define LLVM_LIB_EXECUTIONENGINE_INTERPRETER_INTERPRETER_H
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
 #include "llvm/ExecutionEngine/GenericValue.h"
 #include "llvm/IR/CallSite.h"
@@ -58,6 +59,21 @@ public:
 
 typedef std::vector<GenericValue> ValuePlaneTy;
 
+// FunctionSlots - The numbering of the values a function uses, computed the
+// first time the function is called so that operands do not have to be looked
+// up by name in every stack frame.  Arguments and instructions live in a slot
+// of the stack frame.  Constant operands live in a slot of Constants, which
+// caches their value across calls once they have been evaluated.
+//
+struct FunctionSlots {
+  static const unsigned ConstantBit = 1u << 31;
+
+  DenseMap<const Value *, unsigned> Slots; // ConstantBit set for constants.
+  unsigned NumFrameSlots = 0;
+  ValuePlaneTy Constants;
+  std::vector<bool> ConstantIsValid;
+};
+
 // ExecutionContext struct - This struct represents one stack frame currently
 // executing.
 //
@@ -67,15 +83,18 @@ struct ExecutionContext {
   BasicBlock::iterator  CurInst;    // The next instruction to execute
   CallSite             Caller;     // Holds the call that called subframes.
                                    // NULL if main func or debugger invoked fn
-  std::map<Value *, GenericValue> Values; // LLVM values used in this invocation
+  FunctionSlots        *Slots;      // The numbering of CurFunction's values
+  ValuePlaneTy          Values;     // LLVM values used in this invocation
   std::vector<GenericValue>  VarArgs; // Values passed through an ellipsis
   AllocaHolder Allocas;            // Track memory allocated by alloca
 
-  ExecutionContext() : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr) {}
+  ExecutionContext()
+      : CurFunction(nullptr), CurBB(nullptr), CurInst(nullptr),
+        Slots(nullptr) {}
 
   ExecutionContext(ExecutionContext &&O)
       : CurFunction(O.CurFunction), CurBB(O.CurBB), CurInst(O.CurInst),
-        Caller(O.Caller), Values(std::move(O.Values)),
+        Caller(O.Caller), Slots(O.Slots), Values(std::move(O.Values)),
         VarArgs(std::move(O.VarArgs)), Allocas(std::move(O.Allocas)) {}
 
   ExecutionContext &operator=(ExecutionContext &&O) {
@@ -83,6 +102,7 @@ struct ExecutionContext {
     CurBB = O.CurBB;
     CurInst = O.CurInst;
     Caller = O.Caller;
+    Slots = O.Slots;
     Values = std::move(O.Values);
     VarArgs = std::move(O.VarArgs);
     Allocas = std::move(O.Allocas);
@@ -104,6 +124,9 @@ class Interpreter : public ExecutionEngine, public InstVisitor<Interpreter> {
   // registered with the atexit() library function.
   std::vector<Function*> AtExitHandlers;
 
+  // The value numbering of each function that has been called.
+  DenseMap<const Function *, std::unique_ptr<FunctionSlots>> FunctionSlotMap;
+
 public:
   explicit Interpreter(std::unique_ptr<Module> M);
   ~Interpreter() override;
@@ -219,6 +242,8 @@ private:  // Helper functions
   void initializeExternalFunctions();
   GenericValue getConstantExprValue(ConstantExpr *CE, ExecutionContext &SF);
   GenericValue getOperandValue(Value *V, ExecutionContext &SF);
+  GenericValue getConstantOperandValue(Constant *C, ExecutionContext &SF);
+  FunctionSlots &getFunctionSlots(Function *F);
   GenericValue executeTruncInst(Value *SrcVal, Type *DstTy,
                                 ExecutionContext &SF);
   GenericValue executeSExtInst(Value *SrcVal, Type *DstTy,
@@ -0,0 +1,370 @@
+//===-- PerfJITEventListener.cpp - Tell Linux's perf about JITted code ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a JITEventListener object that tells perf about JITted
+// functions, through a perf map file and a jitdump file.
+//
+// The perf map format is described in tools/perf/Documentation/jit-interface.txt
+// and the jitdump format in tools/perf/Documentation/jitdump-specification.txt
+// of the Linux sources.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+
+#if defined(__linux__)
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/ELF.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace llvm;
+using namespace llvm::object;
+
+namespace {
+
+// The records of a jitdump file, as defined by version 1 of the format.
+enum { JitDumpMagic = 0x4A695444, JitDumpVersion = 1 };
+
+enum JitDumpRecordID {
+  JIT_CODE_LOAD = 0,
+  JIT_CODE_MOVE = 1,
+  JIT_CODE_DEBUG_INFO = 2,
+  JIT_CODE_CLOSE = 3
+};
+
+struct JitDumpHeader {
+  uint32_t Magic;
+  uint32_t Version;
+  uint32_t TotalSize;
+  uint32_t ElfMach;
+  uint32_t Pad1;
+  uint32_t Pid;
+  uint64_t Timestamp;
+  uint64_t Flags;
+};
+
+struct JitDumpRecordHeader {
+  uint32_t ID;
+  uint32_t TotalSize;
+  uint64_t Timestamp;
+};
+
+// Followed by the null terminated name of the function and by its code.
+struct JitDumpCodeLoad {
+  JitDumpRecordHeader Prefix;
+  uint32_t Pid;
+  uint32_t Tid;
+  uint64_t Vma;
+  uint64_t CodeAddr;
+  uint64_t CodeSize;
+  uint64_t CodeIndex;
+};
+
+// Followed by NrEntry entries.
+struct JitDumpDebugInfo {
+  JitDumpRecordHeader Prefix;
+  uint64_t CodeAddr;
+  uint64_t NrEntry;
+};
+
+// Followed by the null terminated name of the source file.
+struct JitDumpDebugEntry {
+  uint64_t Addr;
+  uint32_t LineNo;
+  uint32_t Discrim;
+};
+
+class PerfJITEventListener : public JITEventListener {
+public:
+  PerfJITEventListener();
+  ~PerfJITEventListener() override;
+
+  void NotifyObjectEmitted(const ObjectFile &Obj,
+                           const RuntimeDyld::LoadedObjectInfo &L) override;
+
+  // perf has no record for code that goes away. Its address range is simply
+  // described again by the next object that is loaded there.
+  void NotifyFreeingObject(const ObjectFile &Obj) override {}
+
+private:
+  bool openPerfMap();
+  bool openJitDump();
+  void closeJitDump();
+
+  void writeDebugInfo(uint64_t CodeAddr, const DILineInfoTable &Lines);
+  void writeCodeLoad(StringRef Name, uint64_t CodeAddr, uint64_t CodeSize);
+
+  template <typename T> void writeRecord(const T &Record) {
+    JitDump->write(reinterpret_cast<const char *>(&Record), sizeof(Record));
+  }
+
+  // Objects may be emitted from several threads by Orc.
+  std::mutex Mutex;
+
+  uint32_t Pid;
+  std::unique_ptr<raw_fd_ostream> PerfMap;
+  std::unique_ptr<raw_fd_ostream> JitDump;
+
+  // perf finds the jitdump file through this mapping of it.
+  void *Marker = nullptr;
+  size_t MarkerSize = 0;
+
+  uint64_t CodeIndex = 0;
+};
+
+} // end anonymous namespace
+
+// perf orders the records by the timestamps of its own events, which use the
+// monotonic clock when it is run with '-k 1'.
+static uint64_t getTimestamp() {
+  struct timespec TS;
+  if (clock_gettime(CLOCK_MONOTONIC, &TS))
+    return 0;
+  return (uint64_t)TS.tv_sec * 1000000000 + TS.tv_nsec;
+}
+
+static uint32_t getThreadID() { return (uint32_t)::syscall(SYS_gettid); }
+
+static uint32_t getHostELFMachine() {
+  switch (Triple(sys::getProcessTriple()).getArch()) {
+  case Triple::x86:
+    return ELF::EM_386;
+  case Triple::x86_64:
+    return ELF::EM_X86_64;
+  case Triple::arm:
+  case Triple::thumb:
+    return ELF::EM_ARM;
+  case Triple::aarch64:
+    return ELF::EM_AARCH64;
+  case Triple::mips:
+  case Triple::mipsel:
+  case Triple::mips64:
+  case Triple::mips64el:
+    return ELF::EM_MIPS;
+  case Triple::ppc:
+    return ELF::EM_PPC;
+  case Triple::ppc64:
+  case Triple::ppc64le:
+    return ELF::EM_PPC64;
+  case Triple::systemz:
+    return ELF::EM_S390;
+  default:
+    return ELF::EM_NONE;
+  }
+}
+
+PerfJITEventListener::PerfJITEventListener() : Pid(::getpid()) {
+  // Failing to open either file is not fatal, the other one is still useful.
+  openPerfMap();
+  openJitDump();
+}
+
+PerfJITEventListener::~PerfJITEventListener() { closeJitDump(); }
+
+bool PerfJITEventListener::openPerfMap() {
+  SmallString<64> Path;
+  raw_svector_ostream(Path) << "/tmp/perf-" << Pid << ".map";
+  std::error_code EC;
+  PerfMap.reset(new raw_fd_ostream(Path, EC, sys::fs::F_Append));
+  if (EC) {
+    PerfMap.reset();
+    return false;
+  }
+  return true;
+}
+
+bool PerfJITEventListener::openJitDump() {
+  // The jitdump file is found by 'perf inject' through the mapping below, so
+  // it may live anywhere. $JITDUMPDIR has the same meaning as for the other
+  // JITs that support perf.
+  SmallString<128> Path;
+  if (Optional<std::string> Dir = sys::Process::GetEnv("JITDUMPDIR"))
+    Path = *Dir;
+  else
+    Path = "/tmp";
+  sys::path::append(Path, "jit-" + Twine(Pid) + ".dump");
+
+  int FD;
+  if (sys::fs::openFileForWrite(Path, FD, sys::fs::F_RW))
+    return false;
+
+  // perf only notices executable mappings of the file.
+  MarkerSize = sys::Process::getPageSize();
+  Marker = ::mmap(nullptr, MarkerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, FD,
+                  0);
+  if (Marker == MAP_FAILED) {
+    Marker = nullptr;
+    ::close(FD);
+    sys::fs::remove(Path);
+    return false;
+  }
+
+  JitDump.reset(new raw_fd_ostream(FD, /*shouldClose=*/true));
+
+  JitDumpHeader Header;
+  Header.Magic = JitDumpMagic;
+  Header.Version = JitDumpVersion;
+  Header.TotalSize = sizeof(Header);
+  Header.ElfMach = getHostELFMachine();
+  Header.Pad1 = 0;
+  Header.Pid = Pid;
+  Header.Timestamp = getTimestamp();
+  Header.Flags = 0;
+  writeRecord(Header);
+  JitDump->flush();
+  return true;
+}
+
+void PerfJITEventListener::closeJitDump() {
+  if (!JitDump)
+    return;
+
+  JitDumpRecordHeader Close;
+  Close.ID = JIT_CODE_CLOSE;
+  Close.TotalSize = sizeof(Close);
+  Close.Timestamp = getTimestamp();
+  writeRecord(Close);
+  JitDump.reset();
+
+  ::munmap(Marker, MarkerSize);
+  Marker = nullptr;
+}
+
+void PerfJITEventListener::writeDebugInfo(uint64_t CodeAddr,
+                                          const DILineInfoTable &Lines) {
+  JitDumpDebugInfo Info;
+  Info.Prefix.ID = JIT_CODE_DEBUG_INFO;
+  Info.Prefix.TotalSize = sizeof(Info);
+  Info.Prefix.Timestamp = getTimestamp();
+  Info.CodeAddr = CodeAddr;
+  Info.NrEntry = Lines.size();
+  for (const auto &Line : Lines)
+    Info.Prefix.TotalSize +=
+        sizeof(JitDumpDebugEntry) + Line.second.FileName.size() + 1;
+  writeRecord(Info);
+
+  for (const auto &Line : Lines) {
+    JitDumpDebugEntry Entry;
+    Entry.Addr = Line.first;
+    Entry.LineNo = Line.second.Line;
+    Entry.Discrim = 0;
+    writeRecord(Entry);
+    *JitDump << Line.second.FileName << '\0';
+  }
+}
+
+void PerfJITEventListener::writeCodeLoad(StringRef Name, uint64_t CodeAddr,
+                                         uint64_t CodeSize) {
+  JitDumpCodeLoad Load;
+  Load.Prefix.ID = JIT_CODE_LOAD;
+  Load.Prefix.TotalSize = sizeof(Load) + Name.size() + 1 + CodeSize;
+  Load.Prefix.Timestamp = getTimestamp();
+  Load.Pid = Pid;
+  Load.Tid = getThreadID();
+  Load.Vma = CodeAddr;
+  Load.CodeAddr = CodeAddr;
+  Load.CodeSize = CodeSize;
+  Load.CodeIndex = CodeIndex++;
+  writeRecord(Load);
+  *JitDump << Name << '\0';
+  // The code is in this process, like for the other profiler listeners.
+  JitDump->write(reinterpret_cast<const char *>(CodeAddr), CodeSize);
+}
+
+void PerfJITEventListener::NotifyObjectEmitted(
+    const ObjectFile &Obj, const RuntimeDyld::LoadedObjectInfo &L) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  if (!PerfMap && !JitDump)
+    return;
+
+  OwningBinary<ObjectFile> DebugObjOwner = L.getObjectForDebug(Obj);
+  const ObjectFile &DebugObj = *DebugObjOwner.getBinary();
+
+  // Line information is only looked up if there is somewhere to put it.
+  std::unique_ptr<DIContext> Context;
+  if (JitDump)
+    Context.reset(new DWARFContextInMemory(DebugObj));
+
+  for (const std::pair<SymbolRef, uint64_t> &P : computeSymbolSizes(DebugObj)) {
+    SymbolRef Sym = P.first;
+    Expected<SymbolRef::Type> SymTypeOrErr = Sym.getType();
+    if (!SymTypeOrErr) {
+      consumeError(SymTypeOrErr.takeError());
+      continue;
+    }
+    if (*SymTypeOrErr != SymbolRef::ST_Function)
+      continue;
+
+    Expected<StringRef> NameOrErr = Sym.getName();
+    if (!NameOrErr) {
+      consumeError(NameOrErr.takeError());
+      continue;
+    }
+    ErrorOr<uint64_t> AddrOrErr = Sym.getAddress();
+    if (!AddrOrErr)
+      continue;
+    uint64_t Addr = *AddrOrErr;
+    uint64_t Size = P.second;
+    if (!Size)
+      continue;
+
+    if (PerfMap)
+      *PerfMap << format("%" PRIx64 " %" PRIx64 " ", Addr, Size) << *NameOrErr
+               << '\n';
+
+    if (JitDump) {
+      // perf expects the line table before the code it describes.
+      DILineInfoTable Lines = Context->getLineInfoForAddressRange(
+          Addr, Size, DILineInfoSpecifier(
+                          DILineInfoSpecifier::FileLineInfoKind::AbsoluteFilePath,
+                          DILineInfoSpecifier::FunctionNameKind::None));
+      if (!Lines.empty())
+        writeDebugInfo(Addr, Lines);
+      writeCodeLoad(*NameOrErr, Addr, Size);
+    }
+  }
+
+  // Hand the records over once per object, so that they survive a crash
+  // without paying for a system call per function.
+  if (PerfMap)
+    PerfMap->flush();
+  if (JitDump)
+    JitDump->flush();
+}
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return new PerfJITEventListener();
+}
+} // end namespace llvm
+
+#else
+
+namespace llvm {
+JITEventListener *JITEventListener::createPerfJITEventListener() {
+  return nullptr;
+}
+} // end namespace llvm
+
+#endif
@@ -22,6 +22,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/ThreadPool.h"
 
 using namespace llvm;
 using namespace llvm::object;
@@ -139,6 +140,7 @@ void RuntimeDyldImpl::resolveRelocations() {
                  << format("%p", (uintptr_t)Addr) << "\n");
     resolveRelocationList(it->second, Addr);
   }
+  applyPendingRelocations();
   Relocations.clear();
 
   // Print out sections after relocation.
@@ -895,10 +897,59 @@ void RuntimeDyldImpl::resolveRelocationList(const RelocationList &Relocs,
     // Ignore relocations for sections that were not loaded
     if (Sections[RE.SectionID].getAddress() == nullptr)
       continue;
+    // In parallel mode, only record the value now and apply the relocation
+    // once all of the values are known.
+    if (RelocationPool) {
+      PendingRelocations[RE.SectionID].push_back(std::make_pair(RE, Value));
+      ++NumPendingRelocations;
+      continue;
+    }
     resolveRelocation(RE, Value);
   }
 }
 
+void RuntimeDyldImpl::applyPendingRelocations() {
+  if (PendingRelocations.empty())
+    return;
+
+  // Relocations are applied independently from each other, except that the
+  // ones patching the same section must be applied in order, since some
+  // formats combine several relocations at one location. Each section is
+  // therefore handled by a single task.
+  auto ApplySection = [this](
+      const std::vector<std::pair<RelocationEntry, uint64_t>> &Relocs) {
+    for (const auto &R : Relocs)
+      resolveRelocation(R.first, R.second);
+  };
+
+  bool Parallel = NumPendingRelocations >= MinParallelRelocations &&
+                  PendingRelocations.size() > 1;
+#ifndef NDEBUG
+  // Keep the debug output of the relocations readable.
+  Parallel &= !(DebugFlag && isCurrentDebugType(DEBUG_TYPE));
+#endif
+
+  if (!Parallel) {
+    for (const auto &KV : PendingRelocations)
+      ApplySection(KV.second);
+  } else {
+    DEBUG(dbgs() << "Applying " << NumPendingRelocations
+                 << " relocations to " << PendingRelocations.size()
+                 << " sections in parallel\n");
+    std::vector<std::shared_future<ThreadPool::VoidTy>> Tasks;
+    for (const auto &KV : PendingRelocations)
+      Tasks.push_back(
+          RelocationPool->async([&ApplySection, &KV]() {
+            ApplySection(KV.second);
+          }));
+    for (auto &Task : Tasks)
+      Task.wait();
+  }
+
+  PendingRelocations.clear();
+  NumPendingRelocations = 0;
+}
+
 void RuntimeDyldImpl::resolveExternalSymbols() {
   while (!ExternalSymbolRelocations.empty()) {
     StringMap<RelocationList>::iterator i = ExternalSymbolRelocations.begin();
@@ -985,6 +1036,8 @@ RuntimeDyld::RuntimeDyld(RuntimeDyld::MemoryManager &MemMgr,
   Dyld = nullptr;
   ProcessAllSections = false;
   Checker = nullptr;
+  RelocationPool = nullptr;
+  MinParallelRelocations = 0;
 }
 
 RuntimeDyld::~RuntimeDyld() {}
@@ -1037,6 +1090,7 @@ RuntimeDyld::loadObject(const ObjectFile &Obj) {
                ProcessAllSections, Checker);
     else
       report_fatal_error("Incompatible object format!");
+    Dyld->setRelocationThreadPool(RelocationPool, MinParallelRelocations);
   }
 
   if (!Dyld->isCompatibleFile(Obj))
@@ -1061,6 +1115,14 @@ RuntimeDyld::SymbolInfo RuntimeDyld::getSymbol(StringRef Name) const {
 
 void RuntimeDyld::resolveRelocations() { Dyld->resolveRelocations(); }
 
+void RuntimeDyld::setRelocationThreadPool(ThreadPool *Pool,
+                                          unsigned MinRelocations) {
+  RelocationPool = Pool;
+  MinParallelRelocations = MinRelocations;
+  if (Dyld)
+    Dyld->setRelocationThreadPool(Pool, MinRelocations);
+}
+
 void RuntimeDyld::reassignSectionAddress(unsigned SectionID, uint64_t Addr) {
   Dyld->reassignSectionAddress(SectionID, Addr);
 }
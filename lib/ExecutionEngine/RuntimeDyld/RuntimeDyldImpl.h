@@ -266,6 +266,14 @@ protected:
   // modules.  This map is indexed by symbol name.
   StringMap<RelocationList> ExternalSymbolRelocations;
 
+  // When relocations are applied in parallel, the relocations whose values
+  // are known, with those values, grouped by the section they patch.
+  ThreadPool *RelocationPool;
+  unsigned MinParallelRelocations;
+  std::map<unsigned, std::vector<std::pair<RelocationEntry, uint64_t>>>
+      PendingRelocations;
+  unsigned NumPendingRelocations;
+
 
   typedef std::map<RelocationValueRef, uintptr_t> StubMap;
 
@@ -382,6 +390,10 @@ protected:
   /// \brief Resolves relocations from Relocs list with address from Value.
   void resolveRelocationList(const RelocationList &Relocs, uint64_t Value);
 
+  /// \brief Apply the relocations queued by resolveRelocationList in parallel
+  /// mode.
+  void applyPendingRelocations();
+
   /// \brief A object file specific relocation resolver
   /// \param RE The relocation to be resolved
   /// \param Value Target symbol address to apply the relocation action
@@ -422,6 +434,8 @@ public:
   RuntimeDyldImpl(RuntimeDyld::MemoryManager &MemMgr,
                   RuntimeDyld::SymbolResolver &Resolver)
     : MemMgr(MemMgr), Resolver(Resolver), Checker(nullptr),
+      RelocationPool(nullptr), MinParallelRelocations(0),
+      NumPendingRelocations(0),
       ProcessAllSections(false), HasError(false) {
   }
 
@@ -435,6 +449,11 @@ public:
     this->Checker = Checker;
   }
 
+  void setRelocationThreadPool(ThreadPool *Pool, unsigned MinRelocations) {
+    RelocationPool = Pool;
+    MinParallelRelocations = MinRelocations;
+  }
+
   virtual std::unique_ptr<RuntimeDyld::LoadedObjectInfo>
   loadObject(const object::ObjectFile &Obj) = 0;
 
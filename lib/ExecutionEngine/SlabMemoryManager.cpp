@@ -0,0 +1,215 @@
+//===- SlabMemoryManager.cpp - Slab-based memory manager for RtDyld -------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the slab-based memory manager for MCJIT and RuntimeDyld.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Config/config.h"
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+using namespace llvm;
+
+static const unsigned ReadWrite = sys::Memory::MF_READ | sys::Memory::MF_WRITE;
+static const uintptr_t HugePageSize = 2 * 1024 * 1024;
+
+// Ask the system to back the huge-page-aligned part of MB with huge pages.
+static void adviseHugePages(sys::MemoryBlock MB) {
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+  uintptr_t Start = alignTo((uintptr_t)MB.base(), HugePageSize);
+  uintptr_t End = ((uintptr_t)MB.base() + MB.size()) & ~(HugePageSize - 1);
+  if (Start < End)
+    ::madvise((void *)Start, End - Start, MADV_HUGEPAGE);
+#endif
+}
+
+SlabMemoryManager::SlabMemoryManager(size_t SlabSize, bool UseHugePages)
+    : SlabSize(alignTo(SlabSize, UseHugePages ? HugePageSize
+                                              : sys::Process::getPageSize())),
+      UseHugePages(UseHugePages), PageSize(sys::Process::getPageSize()),
+      CodeMem(sys::Memory::MF_READ | sys::Memory::MF_EXEC),
+      RODataMem(sys::Memory::MF_READ), RWDataMem(ReadWrite) {}
+
+SlabMemoryManager::~SlabMemoryManager() {
+  for (sys::MemoryBlock &MB : Mappings)
+    sys::Memory::releaseMappedMemory(MB);
+}
+
+uint8_t *SlabMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName) {
+  return allocate(CodeMem, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateDataSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName,
+                                                bool IsReadOnly) {
+  return allocate(IsReadOnly ? RODataMem : RWDataMem, Size, Alignment);
+}
+
+void SlabMemoryManager::reserveAllocationSpace(
+    uintptr_t CodeSize, uint32_t CodeAlign, uintptr_t RODataSize,
+    uint32_t RODataAlign, uintptr_t RWDataSize, uint32_t RWDataAlign) {
+  std::pair<Pool *, std::pair<uintptr_t, uint32_t>> Reservations[] = {
+      {&CodeMem, {CodeSize, CodeAlign}},
+      {&RODataMem, {RODataSize, RODataAlign}},
+      {&RWDataMem, {RWDataSize, RWDataAlign}}};
+  for (auto &R : Reservations) {
+    Pool &P = *R.first;
+    uintptr_t Size = R.second.first;
+    uintptr_t Alignment = std::max<uintptr_t>(R.second.second, 16);
+    if (Size && (!P.End || alignTo(P.Cur, Alignment) + Size > P.End))
+      refill(P, Size + Alignment);
+  }
+}
+
+uint8_t *SlabMemoryManager::allocate(Pool &P, uintptr_t Size,
+                                     unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+
+  assert(!(Alignment & (Alignment - 1)) && "Alignment must be a power of two.");
+
+  uintptr_t Addr = alignTo(P.Cur, Alignment);
+  if (!P.End || Addr + Size > P.End) {
+    if (!refill(P, Size + Alignment))
+      return nullptr;
+    Addr = alignTo(P.Cur, Alignment);
+  }
+  P.Cur = Addr + Size;
+  return (uint8_t *)Addr;
+}
+
+// Record the part of the current range used by the current group, rounded up
+// to whole pages, and move past it.
+void SlabMemoryManager::closeGroupSpan(Pool &P) {
+  uintptr_t SpanEnd = alignTo(P.Cur, PageSize);
+  assert(SpanEnd <= P.End && "Range end is not page aligned");
+  if (SpanEnd > P.GroupStart)
+    Groups[CurrentGroup].push_back(
+        {&P, sys::MemoryBlock((void *)P.GroupStart, SpanEnd - P.GroupStart)});
+  P.Cur = P.GroupStart = SpanEnd;
+}
+
+void SlabMemoryManager::addFreeRange(Pool &P, uintptr_t Start,
+                                     uintptr_t Size) {
+  if (!Size)
+    return;
+  auto Next = P.FreeRanges.lower_bound(Start);
+  if (Next != P.FreeRanges.end() && Start + Size == Next->first) {
+    Size += Next->second;
+    Next = P.FreeRanges.erase(Next);
+  }
+  if (Next != P.FreeRanges.begin()) {
+    auto Prev = std::prev(Next);
+    if (Prev->first + Prev->second == Start) {
+      Prev->second += Size;
+      return;
+    }
+  }
+  P.FreeRanges[Start] = Size;
+}
+
+// Replace the current range of P with one that has room for MinSize bytes,
+// taken from the free ranges if possible and from a new slab otherwise.
+bool SlabMemoryManager::refill(Pool &P, uintptr_t MinSize) {
+  if (P.End) {
+    closeGroupSpan(P);
+    addFreeRange(P, P.Cur, P.End - P.Cur);
+    P.Cur = P.End = P.GroupStart = 0;
+  }
+
+  uintptr_t Needed = alignTo(MinSize, PageSize);
+  for (auto I = P.FreeRanges.begin(), E = P.FreeRanges.end(); I != E; ++I) {
+    if (I->second < Needed)
+      continue;
+    sys::MemoryBlock MB((void *)I->first, I->second);
+    // Released memory still has the permissions of its last group.
+    if (sys::Memory::protectMappedMemory(MB, ReadWrite))
+      return false;
+    ++NumProtections;
+    P.FreeRanges.erase(I);
+    P.Cur = P.GroupStart = (uintptr_t)MB.base();
+    P.End = P.Cur + MB.size();
+    return true;
+  }
+
+  size_t Size = std::max<size_t>(SlabSize, Needed);
+  // Leave room to align the slab to a huge page.
+  if (UseHugePages)
+    Size += HugePageSize;
+  std::error_code EC;
+  sys::MemoryBlock MB =
+      sys::Memory::allocateMappedMemory(Size, &P.Near, ReadWrite, EC);
+  if (EC)
+    return false;
+  Mappings.push_back(MB);
+  P.Near = MB;
+
+  uintptr_t Start = (uintptr_t)MB.base();
+  uintptr_t End = Start + MB.size();
+  if (UseHugePages) {
+    adviseHugePages(MB);
+    // Start on the huge page boundary, the memory below it is still usable
+    // later.
+    uintptr_t Aligned = alignTo(Start, HugePageSize);
+    if (End - Aligned >= Needed) {
+      addFreeRange(P, Start, Aligned - Start);
+      Start = Aligned;
+    }
+  }
+  P.Cur = P.GroupStart = Start;
+  P.End = End;
+  return true;
+}
+
+bool SlabMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  for (Pool *P : {&CodeMem, &RODataMem, &RWDataMem})
+    if (P->End)
+      closeGroupSpan(*P);
+
+  GroupID G = CurrentGroup++;
+  auto I = Groups.find(G);
+  if (I == Groups.end())
+    return false;
+
+  for (Span &S : I->second) {
+    if (S.P->Permissions == ReadWrite)
+      continue;
+    if (std::error_code EC =
+            sys::Memory::protectMappedMemory(S.Block, S.P->Permissions)) {
+      if (ErrMsg)
+        *ErrMsg = EC.message();
+      return true;
+    }
+    ++NumProtections;
+    if (S.P == &CodeMem)
+      sys::Memory::InvalidateInstructionCache(S.Block.base(), S.Block.size());
+  }
+  return false;
+}
+
+void SlabMemoryManager::releaseGroup(GroupID G) {
+  assert(G < CurrentGroup && "Group has not been finalized");
+  auto I = Groups.find(G);
+  if (I == Groups.end())
+    return;
+  for (Span &S : I->second)
+    addFreeRange(*S.P, (uintptr_t)S.Block.base(), S.Block.size());
+  Groups.erase(I);
+}
@@ -187,11 +187,14 @@ static void ParseFlags(const std::vector<std::string> &Args) {
 
 static std::mutex Mu;
 
-static void PulseThread() {
+static void PulseThread(const SharedCorpus *Shmem) {
   while (true) {
-    SleepSeconds(600);
+    SleepSeconds(Shmem ? 10 : 600);
     std::lock_guard<std::mutex> Lock(Mu);
-    Printf("pulse...\n");
+    if (Shmem)
+      Shmem->PrintStats();
+    else
+      Printf("pulse...\n");
   }
 }
 
@@ -220,17 +223,38 @@ static int RunInMultipleProcesses(const std::vector<std::string> &Args,
   std::atomic<bool> HasErrors(false);
   std::string Cmd;
   for (auto &S : Args) {
-    if (FlagValue(S.c_str(), "jobs") || FlagValue(S.c_str(), "workers"))
+    if (FlagValue(S.c_str(), "jobs") || FlagValue(S.c_str(), "workers") ||
+        FlagValue(S.c_str(), "shmem_corpus"))
       continue;
     Cmd += S + " ";
   }
+  // The shared corpus outlives the jobs, so that the later jobs start from
+  // the units that the earlier ones found.
+  static SharedCorpus Shmem;
+  std::string ShmemPath;
+  if (Flags.shmem_corpus) {
+    const char *TmpDir = getenv("TMPDIR");
+    ShmemPath = std::string(TmpDir ? TmpDir : "/tmp") + "/libFuzzer-shmem-" +
+                std::to_string(getpid());
+    if (Shmem.Create(ShmemPath,
+                     static_cast<size_t>(Flags.shmem_corpus_mb) << 20))
+      Cmd += "-shmem_corpus_file=" + ShmemPath + " ";
+    else
+      Printf("WARNING: could not create the shared corpus %s\n",
+             ShmemPath.c_str());
+  }
   std::vector<std::thread> V;
-  std::thread Pulse(PulseThread);
+  std::thread Pulse(PulseThread, Shmem.IsMapped() ? &Shmem : nullptr);
   Pulse.detach();
   for (int i = 0; i < NumWorkers; i++)
     V.push_back(std::thread(WorkerThread, Cmd, &Counter, NumJobs, &HasErrors));
   for (auto &T : V)
     T.join();
+  if (Shmem.IsMapped()) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Shmem.PrintStats();
+    unlink(ShmemPath.c_str());
+  }
   return HasErrors ? 1 : 0;
 }
 
@@ -257,6 +281,20 @@ int RunOneTest(Fuzzer *F, const char *InputFilePath) {
   return 0;
 }
 
+// The command of the merge workers: the flags without the inputs.
+static std::string MergeWorkerCmd(const std::vector<std::string> &Args) {
+  std::string Cmd = Args[0];
+  for (size_t A = 1; A < Args.size(); A++) {
+    auto &S = Args[A];
+    if (S[0] != '-' || FlagValue(S.c_str(), "merge") ||
+        FlagValue(S.c_str(), "merge_workers") ||
+        FlagValue(S.c_str(), "merge_control_file"))
+      continue;
+    Cmd += " " + S;
+  }
+  return Cmd;
+}
+
 static bool AllInputsAreFiles() {
   if (Inputs->empty()) return false;
   for (auto &Path : *Inputs)
@@ -350,6 +388,15 @@ static int FuzzerDriver(const std::vector<std::string> &Args,
 
   StartRssThread(&F, Flags.rss_limit_mb);
 
+  static SharedCorpus Shmem;
+  if (Flags.shmem_corpus_file) {
+    if (Shmem.Attach(Flags.shmem_corpus_file))
+      F.SetSharedCorpus(&Shmem);
+    else
+      Printf("WARNING: could not attach the shared corpus %s\n",
+             Flags.shmem_corpus_file);
+  }
+
   // Timer
   if (Flags.timeout > 0)
     SetTimer(Flags.timeout / 2 + 1);
@@ -380,10 +427,34 @@ static int FuzzerDriver(const std::vector<std::string> &Args,
   }
 
 
+  if (Flags.merge_inner > 0) {
+    if (Options.MaxLen == 0)
+      F.SetMaxLen(kMaxSaneLen);
+    F.MergeInner(Flags.merge_control_file, Flags.merge_inner - 1,
+                 Flags.merge_workers);
+    exit(0);
+  }
+
   if (Flags.merge) {
     if (Options.MaxLen == 0)
       F.SetMaxLen(kMaxSaneLen);
-    F.Merge(*Inputs);
+    if (Flags.merge_workers > 0 || Flags.merge_control_file) {
+      std::string ControlFile;
+      if (Flags.merge_control_file) {
+        ControlFile = Flags.merge_control_file;
+      } else {
+        const char *TmpDir = getenv("TMPDIR");
+        ControlFile = std::string(TmpDir ? TmpDir : "/tmp") +
+                      "/libFuzzer-merge-" + std::to_string(getpid());
+      }
+      int NumWorkers = std::max(1, Flags.merge_workers);
+      F.MergeInWorkers(*Inputs, ControlFile, NumWorkers, MergeWorkerCmd(Args));
+      // Without a control file from the user, there is nothing to resume.
+      if (!Flags.merge_control_file)
+        RemoveMergeControlFiles(ControlFile, NumWorkers);
+    } else {
+      F.Merge(*Inputs);
+    }
     exit(0);
   }
 
@@ -99,6 +99,12 @@ void WriteToFile(const Unit &U, const std::string &Path) {
   fclose(Out);
 }
 
+void ListFilesInDir(const std::string &Dir, std::vector<std::string> *V) {
+  size_t First = V->size();
+  ListFilesInDirRecursive(Dir, nullptr, V, /*TopDir*/true);
+  std::sort(V->begin() + First, V->end());
+}
+
 void ReadDirToVectorOfUnits(const char *Path, std::vector<Unit> *V,
                             long *Epoch, size_t MaxSize) {
   long E = Epoch ? *Epoch : 0;
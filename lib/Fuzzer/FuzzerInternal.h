@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "FuzzerInterface.h"
+#include "FuzzerShmem.h"
 #include "FuzzerTracePC.h"
 
 // Platform detection.
@@ -87,6 +88,11 @@ Unit FileToVector(const std::string &Path, size_t MaxSize = 0);
 void ReadDirToVectorOfUnits(const char *Path, std::vector<Unit> *V,
                             long *Epoch, size_t MaxSize);
 void WriteToFile(const Unit &U, const std::string &Path);
+// Appends the paths of the files under Dir to V, sorted.
+void ListFilesInDir(const std::string &Dir, std::vector<std::string> *V);
+// Removes the control file of Fuzzer::MergeInWorkers and the files of its
+// workers.
+void RemoveMergeControlFiles(const std::string &ControlFile, int NumWorkers);
 void CopyFileToErr(const std::string &Path);
 // Returns "Dir/FileName" or equivalent for the current OS.
 std::string DirPlusFile(const std::string &DirPath,
@@ -330,8 +336,10 @@ public:
       CallerCalleeCoverage = 0;
       PcMapBits = 0;
       CounterBitmapBits = 0;
+      InlineCounterBitmapBits = 0;
       PcBufferLen = 0;
       CounterBitmap.clear();
+      InlineCounterBitmap.clear();
       PCMap.Reset();
     }
 
@@ -344,6 +352,9 @@ public:
     // Precalculated number of bits in CounterBitmap.
     size_t CounterBitmapBits;
     std::vector<uint8_t> CounterBitmap;
+    // Precalculated number of bits in InlineCounterBitmap.
+    size_t InlineCounterBitmapBits;
+    std::vector<uint8_t> InlineCounterBitmap;
     // Precalculated number of bits in PCMap.
     size_t PcMapBits;
     PcCoverageMap PCMap;
@@ -369,6 +380,9 @@ public:
     ReadDirToVectorOfUnits(Path.c_str(), &Corpus, Epoch, MaxSize);
   }
   void RereadOutputCorpus(size_t MaxSize);
+  // Exchange the new units with the other workers through SC instead of
+  // rereading the output corpus.
+  void SetSharedCorpus(SharedCorpus *SC) { Shmem = SC; }
   // Save the current corpus to OutputCorpus.
   void SaveCorpus();
 
@@ -392,6 +406,13 @@ public:
 
   // Merge Corpora[1:] into Corpora[0].
   void Merge(const std::vector<std::string> &Corpora);
+  // Merge Corpora[1:] into Corpora[0], running the inputs in NumWorkers
+  // processes of WorkerCmd that record their progress next to ControlFile.
+  void MergeInWorkers(const std::vector<std::string> &Corpora,
+                      const std::string &ControlFile, int NumWorkers,
+                      const std::string &WorkerCmd);
+  // Run the inputs of worker Worker of the merge of ControlFile.
+  void MergeInner(const std::string &ControlFile, int Worker, int NumWorkers);
   // Returns a subset of 'Extra' that adds coverage to 'Initial'.
   UnitVector FindExtraUnits(const UnitVector &Initial, const UnitVector &Extra);
   MutationDispatcher &GetMD() { return MD; }
@@ -418,6 +439,7 @@ private:
   void PrintStats(const char *Where, const char *End = "\n");
   void PrintStatusForNewUnit(const Unit &U);
   void ShuffleCorpus(UnitVector *V);
+  void ReadSharedCorpus();
   void TryDetectingAMemoryLeak(const uint8_t *Data, size_t Size,
                                bool DuringInitialCorpusExecution);
 
@@ -462,6 +484,7 @@ private:
   system_clock::time_point UnitStartTime;
   long TimeOfLongestUnitInSeconds = 0;
   long EpochOfLastReadOfOutputCorpus = 0;
+  SharedCorpus *Shmem = nullptr;
 
   // Maximum recorded coverage.
   Coverage MaxCoverage;
@@ -84,11 +84,13 @@ struct CoverageController {
     CHECK_WEAK_API_FUNCTION(__sanitizer_reset_coverage);
     __sanitizer_reset_coverage();
     PcMapResetCurrent();
+    InlineCountersReset();
   }
 
   static void ResetCounters(const Fuzzer::FuzzingOptions &Options) {
     if (Options.UseCounters) {
       __sanitizer_update_counter_bitset_and_clear_counters(0);
+      InlineCountersReset();
     }
   }
 
@@ -130,6 +132,13 @@ struct CoverageController {
         Res = true;
         C->CounterBitmapBits += CounterDelta;
       }
+
+      uint64_t InlineCounterDelta =
+          InlineCountersMergeInto(&C->InlineCounterBitmap);
+      if (InlineCounterDelta > 0) {
+        Res = true;
+        C->InlineCounterBitmapBits += InlineCounterDelta;
+      }
     }
 
     uint64_t NewPcMapBits = PcMapMergeInto(&C->PCMap);
@@ -285,6 +294,8 @@ void Fuzzer::PrintStats(const char *Where, const char *End) {
     Printf(" path: %zd", MaxCoverage.PcMapBits);
   if (auto TB = MaxCoverage.CounterBitmapBits)
     Printf(" bits: %zd", TB);
+  if (auto ICB = MaxCoverage.InlineCounterBitmapBits)
+    Printf(" icnt: %zd", ICB);
   if (MaxCoverage.CallerCalleeCoverage)
     Printf(" indir: %zd", MaxCoverage.CallerCalleeCoverage);
   Printf(" units: %zd exec/s: %zd", Corpus.size(), ExecPerSec);
@@ -343,6 +354,26 @@ void Fuzzer::RereadOutputCorpus(size_t MaxSize) {
   }
 }
 
+void Fuzzer::ReadSharedCorpus() {
+  Shmem->UpdateStats(TotalNumberOfRuns, MaxCoverage.BlockCoverage,
+                     Corpus.size());
+  if (!Shmem->HasNewUnits())
+    return;
+  std::vector<Unit> SharedUnits;
+  Shmem->Fetch(&SharedUnits);
+  for (auto &X : SharedUnits) {
+    if (X.size() > Options.MaxLen)
+      X.resize(Options.MaxLen);
+    if (UnitHashesAddedToCorpus.insert(Hash(X)).second) {
+      if (RunOne(X)) {
+        Corpus.push_back(X);
+        UpdateCorpusDistribution();
+        PrintStats("SHARED");
+      }
+    }
+  }
+}
+
 void Fuzzer::ShuffleCorpus(UnitVector *V) {
   std::random_shuffle(V->begin(), V->end(), MD.GetRand());
   if (Options.PreferSmall)
@@ -522,7 +553,8 @@ std::string Fuzzer::Coverage::DebugString() const {
       std::string("Coverage{") + "BlockCoverage=" +
       std::to_string(BlockCoverage) + " CallerCalleeCoverage=" +
       std::to_string(CallerCalleeCoverage) + " CounterBitmapBits=" +
-      std::to_string(CounterBitmapBits) + " PcMapBits=" +
+      std::to_string(CounterBitmapBits) + " InlineCounterBitmapBits=" +
+      std::to_string(InlineCounterBitmapBits) + " PcMapBits=" +
       std::to_string(PcMapBits) + "}";
   return Result;
 }
@@ -579,6 +611,8 @@ void Fuzzer::ReportNewCoverage(const Unit &U) {
   MD.RecordSuccessfulMutationSequence();
   PrintStatusForNewUnit(U);
   WriteToOutputCorpus(U);
+  if (Shmem)
+    Shmem->Publish(U);
   NumberOfNewUnitsAdded++;
 }
 
@@ -782,7 +816,10 @@ void Fuzzer::Loop() {
     MD.SetCorpus(&Corpus);
   while (true) {
     auto Now = system_clock::now();
-    if (duration_cast<seconds>(Now - LastCorpusReload).count()) {
+    if (Shmem) {
+      // Reading the shared corpus is cheap when it has no new units.
+      ReadSharedCorpus();
+    } else if (duration_cast<seconds>(Now - LastCorpusReload).count()) {
       RereadOutputCorpus(Options.MaxLen);
       LastCorpusReload = Now;
     }
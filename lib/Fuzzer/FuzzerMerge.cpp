@@ -0,0 +1,235 @@
+//===- FuzzerMerge.cpp - Merging corpora in worker processes --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+// Merging corpora in worker processes that survive crashes and restarts.
+//
+// The control file lists the inputs, with the initial corpus first:
+//   <NumInputs> <NumInitial> <NumWorkers>
+//   <path of input 0>
+//   ...
+// Worker W runs the inputs I with I % NumWorkers == W, in order, and appends
+// to the file <ControlFile>.W a line "STARTED I" before running input I and a
+// line "DONE I <1 if the input added coverage, 0 otherwise>" after it. An
+// input that is STARTED but not DONE crashed or hung its worker, which is
+// restarted to carry on after it. An interrupted merge resumes from these
+// files.
+//
+// An input that adds no coverage in its worker is covered by the inputs that
+// the worker ran before it, so the inputs that added coverage in any worker
+// cover them all. The units that the workers keep are then minimized in
+// process, like Merge does.
+//===----------------------------------------------------------------------===//
+
+#include "FuzzerInternal.h"
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+namespace fuzzer {
+
+namespace {
+enum InputState { kNotRun = 0, kCrashed, kNoNewCoverage, kNewCoverage };
+
+struct MergeControl {
+  std::vector<std::string> Inputs;
+  size_t NumInitial = 0;
+  size_t NumWorkers = 0;
+};
+} // namespace
+
+static std::string WorkerLogPath(const std::string &ControlFile,
+                                 size_t Worker) {
+  return ControlFile + "." + std::to_string(Worker);
+}
+
+static bool ReadMergeControlFile(const std::string &Path, MergeControl *MC) {
+  std::ifstream IF(Path);
+  size_t NumInputs;
+  if (!(IF >> NumInputs >> MC->NumInitial >> MC->NumWorkers) ||
+      MC->NumInitial > NumInputs || !MC->NumWorkers)
+    return false;
+  std::string Line;
+  std::getline(IF, Line);
+  MC->Inputs.clear();
+  while (MC->Inputs.size() < NumInputs && std::getline(IF, Line))
+    MC->Inputs.push_back(Line);
+  return MC->Inputs.size() == NumInputs;
+}
+
+static void WriteMergeControlFile(const std::string &Path,
+                                  const MergeControl &MC) {
+  std::ofstream OF(Path);
+  OF << MC.Inputs.size() << " " << MC.NumInitial << " " << MC.NumWorkers
+     << "\n";
+  for (auto &Input : MC.Inputs)
+    OF << Input << "\n";
+}
+
+// Sets the states of the inputs that the log of a worker records.
+static void ReadWorkerLog(const std::string &Path,
+                          std::vector<InputState> *States) {
+  std::ifstream IF(Path);
+  std::string Line;
+  while (std::getline(IF, Line)) {
+    std::istringstream ISS(Line);
+    std::string Kind;
+    size_t I;
+    int New;
+    if (!(ISS >> Kind >> I) || I >= States->size())
+      continue;
+    if (Kind == "STARTED")
+      (*States)[I] = kCrashed;
+    else if (Kind == "DONE" && ISS >> New)
+      (*States)[I] = New ? kNewCoverage : kNoNewCoverage;
+  }
+}
+
+static size_t NumInputsRun(const std::vector<InputState> &States,
+                           size_t Worker, size_t NumWorkers) {
+  size_t Res = 0;
+  for (size_t I = Worker; I < States.size(); I += NumWorkers)
+    Res += States[I] != kNotRun;
+  return Res;
+}
+
+void RemoveMergeControlFiles(const std::string &ControlFile, int NumWorkers) {
+  for (int W = 0; W < NumWorkers; W++) {
+    std::string LogPath = WorkerLogPath(ControlFile, W);
+    unlink(LogPath.c_str());
+    unlink((LogPath + ".log").c_str());
+  }
+  unlink(ControlFile.c_str());
+}
+
+void Fuzzer::MergeInner(const std::string &ControlFile, int Worker,
+                        int NumWorkers) {
+  MergeControl MC;
+  if (!ReadMergeControlFile(ControlFile, &MC) ||
+      MC.NumWorkers != static_cast<size_t>(NumWorkers)) {
+    Printf("ERROR: bad merge control file %s\n", ControlFile.c_str());
+    exit(1);
+  }
+  std::string LogPath = WorkerLogPath(ControlFile, Worker);
+  std::vector<InputState> States(MC.Inputs.size());
+  ReadWorkerLog(LogPath, &States);
+  std::ofstream Log(LogPath, std::ios::app);
+  for (size_t I = Worker; I < MC.Inputs.size(); I += NumWorkers) {
+    if (States[I] != kNotRun)
+      continue;
+    Log << "STARTED " << I << "\n";
+    Log.flush();
+    bool New = RunOne(FileToVector(MC.Inputs[I], Options.MaxLen));
+    Log << "DONE " << I << " " << New << "\n";
+    Log.flush();
+  }
+}
+
+void Fuzzer::MergeInWorkers(const std::vector<std::string> &Corpora,
+                            const std::string &ControlFile, int NumWorkers,
+                            const std::string &WorkerCmd) {
+  if (Corpora.size() <= 1) {
+    Printf("Merge requires two or more corpus dirs\n");
+    return;
+  }
+  assert(Options.MaxLen > 0);
+  MergeControl MC;
+  ListFilesInDir(Corpora[0], &MC.Inputs);
+  MC.NumInitial = MC.Inputs.size();
+  for (size_t i = 1; i < Corpora.size(); i++)
+    ListFilesInDir(Corpora[i], &MC.Inputs);
+  MC.NumWorkers = NumWorkers;
+
+  MergeControl Old;
+  if (ReadMergeControlFile(ControlFile, &Old) && Old.Inputs == MC.Inputs &&
+      Old.NumInitial == MC.NumInitial && Old.NumWorkers == MC.NumWorkers) {
+    Printf("=== Resuming the merge from %s\n", ControlFile.c_str());
+  } else {
+    WriteMergeControlFile(ControlFile, MC);
+    for (int W = 0; W < NumWorkers; W++)
+      unlink(WorkerLogPath(ControlFile, W).c_str());
+  }
+
+  Printf("=== Running %zd units in %d worker(s)\n", MC.Inputs.size(),
+         NumWorkers);
+  std::mutex Mu;
+  std::atomic<bool> HasErrors(false);
+  auto RunWorker = [&](size_t W) {
+    std::string LogPath = WorkerLogPath(ControlFile, W);
+    std::string Cmd = WorkerCmd + " -merge_control_file=" + ControlFile +
+                      " -merge_workers=" + std::to_string(NumWorkers) +
+                      " -merge_inner=" + std::to_string(W + 1) + " > " +
+                      LogPath + ".log 2>&1";
+    size_t NumInputs = (MC.Inputs.size() + NumWorkers - 1 - W) / NumWorkers;
+    while (true) {
+      std::vector<InputState> States(MC.Inputs.size());
+      ReadWorkerLog(LogPath, &States);
+      size_t NumRun = NumInputsRun(States, W, NumWorkers);
+      if (NumRun == NumInputs)
+        return;
+      int ExitCode = ExecuteCommand(Cmd);
+      std::fill(States.begin(), States.end(), kNotRun);
+      ReadWorkerLog(LogPath, &States);
+      std::lock_guard<std::mutex> Lock(Mu);
+      if (NumInputsRun(States, W, NumWorkers) == NumRun) {
+        Printf("=== Merge worker %zd exited with exit code %d without "
+               "progress\n", W, ExitCode);
+        CopyFileToErr(LogPath + ".log");
+        HasErrors = true;
+        return;
+      }
+      if (ExitCode)
+        Printf("=== Merge worker %zd exited with exit code %d; restarting "
+               "it after the crashing unit\n", W, ExitCode);
+    }
+  };
+  std::vector<std::thread> Threads;
+  for (int W = 0; W < NumWorkers; W++)
+    Threads.push_back(std::thread(RunWorker, W));
+  for (auto &T : Threads)
+    T.join();
+  if (HasErrors) {
+    Printf("=== Merge failed; its progress is in %s\n",
+           ControlFile.c_str());
+    exit(1);
+  }
+
+  std::vector<InputState> States(MC.Inputs.size());
+  for (int W = 0; W < NumWorkers; W++)
+    ReadWorkerLog(WorkerLogPath(ControlFile, W), &States);
+  UnitVector Initial, Extra;
+  size_t NumCrashed = 0;
+  for (size_t I = 0; I < MC.Inputs.size(); I++) {
+    if (States[I] == kCrashed)
+      NumCrashed++;
+    if (States[I] != kNewCoverage)
+      continue;
+    Unit U = FileToVector(MC.Inputs[I], Options.MaxLen);
+    (I < MC.NumInitial ? Initial : Extra).push_back(U);
+  }
+  if (NumCrashed)
+    Printf("=== Skipped %zd crashing unit(s)\n", NumCrashed);
+
+  if (!Initial.empty()) {
+    Printf("=== Minimizing the initial corpus of %zd units\n", Initial.size());
+    Initial = FindExtraUnits({}, Initial);
+  }
+
+  Printf("=== Merging extra %zd units\n", Extra.size());
+  auto Res = FindExtraUnits(Initial, Extra);
+
+  for (auto &U: Res)
+    WriteToOutputCorpus(U);
+
+  Printf("=== Merge: written %zd units\n", Res.size());
+}
+
+}  // namespace fuzzer
@@ -0,0 +1,207 @@
+//===- FuzzerShmem.cpp - Corpus shared by the workers ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+// The corpus that the worker processes of -jobs share through a mapped file.
+//===----------------------------------------------------------------------===//
+
+#include "FuzzerInternal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fuzzer {
+
+static const uint64_t kSharedCorpusMagic = 0x6c6962467a53684dULL;
+
+const size_t SharedCorpus::kMaxWorkers;
+
+// Every record of the ring buffer is a RecordHeader followed by the bytes of
+// the unit. The positions grow forever and wrap around the buffer.
+struct RecordHeader {
+  uint32_t Size;
+  uint32_t WorkerId;
+};
+
+struct SharedCorpus::Header {
+  uint64_t Magic;
+  uint64_t Capacity;
+  // Protects the positions and the buffer. The 32-bit atomics are
+  // lock-free, so they work across processes.
+  std::atomic<uint32_t> Mutex;
+  std::atomic<uint32_t> NumWorkers;
+  // The position of the oldest record that is still in the buffer.
+  std::atomic<uint64_t> OldestPos;
+  // The position of the next record.
+  std::atomic<uint64_t> WritePos;
+  std::atomic<uint64_t> NumUnits;
+  WorkerStats Stats[kMaxWorkers];
+};
+
+SharedCorpus::~SharedCorpus() {
+  if (H)
+    munmap(H, MappedSize);
+}
+
+bool SharedCorpus::Map(int FD, size_t Size) {
+  void *P = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+  close(FD);
+  if (P == MAP_FAILED)
+    return false;
+  H = static_cast<Header *>(P);
+  Buffer = static_cast<uint8_t *>(P) + sizeof(Header);
+  MappedSize = Size;
+  return true;
+}
+
+bool SharedCorpus::Create(const std::string &Path, size_t Capacity) {
+  int FD = open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (FD < 0)
+    return false;
+  size_t Size = sizeof(Header) + Capacity;
+  // The new file is all zeros, which initializes the header.
+  if (ftruncate(FD, Size) != 0) {
+    close(FD);
+    return false;
+  }
+  if (!Map(FD, Size))
+    return false;
+  H->Capacity = Capacity;
+  std::atomic_thread_fence(std::memory_order_release);
+  H->Magic = kSharedCorpusMagic;
+  return true;
+}
+
+bool SharedCorpus::Attach(const std::string &Path) {
+  int FD = open(Path.c_str(), O_RDWR);
+  if (FD < 0)
+    return false;
+  struct stat St;
+  if (fstat(FD, &St) != 0 ||
+      static_cast<size_t>(St.st_size) <= sizeof(Header)) {
+    close(FD);
+    return false;
+  }
+  if (!Map(FD, St.st_size))
+    return false;
+  if (H->Magic != kSharedCorpusMagic ||
+      H->Capacity != MappedSize - sizeof(Header)) {
+    munmap(H, MappedSize);
+    H = nullptr;
+    return false;
+  }
+  WorkerId = H->NumWorkers++;
+  // A job that starts late reads all the units still in the buffer.
+  Lock();
+  ReadPos = H->OldestPos;
+  Unlock();
+  return true;
+}
+
+void SharedCorpus::Lock() const {
+  uint32_t Unlocked = 0;
+  while (!H->Mutex.compare_exchange_weak(Unlocked, 1,
+                                         std::memory_order_acquire)) {
+    Unlocked = 0;
+    sched_yield();
+  }
+}
+
+void SharedCorpus::Unlock() const {
+  H->Mutex.store(0, std::memory_order_release);
+}
+
+void SharedCorpus::CopyIn(uint64_t Pos, const void *Src, size_t Size) {
+  size_t Offset = Pos % H->Capacity;
+  size_t First = std::min<size_t>(Size, H->Capacity - Offset);
+  memcpy(Buffer + Offset, Src, First);
+  memcpy(Buffer, static_cast<const uint8_t *>(Src) + First, Size - First);
+}
+
+void SharedCorpus::CopyOut(uint64_t Pos, void *Dst, size_t Size) const {
+  size_t Offset = Pos % H->Capacity;
+  size_t First = std::min<size_t>(Size, H->Capacity - Offset);
+  memcpy(Dst, Buffer + Offset, First);
+  memcpy(static_cast<uint8_t *>(Dst) + First, Buffer, Size - First);
+}
+
+void SharedCorpus::Publish(const std::vector<uint8_t> &U) {
+  size_t RecordSize = sizeof(RecordHeader) + U.size();
+  if (RecordSize > H->Capacity)
+    return;
+  RecordHeader RH = {static_cast<uint32_t>(U.size()), WorkerId};
+  Lock();
+  uint64_t WritePos = H->WritePos;
+  uint64_t OldestPos = H->OldestPos;
+  // Drop the oldest records that the new one overwrites.
+  while (WritePos + RecordSize - OldestPos > H->Capacity) {
+    RecordHeader Oldest;
+    CopyOut(OldestPos, &Oldest, sizeof(Oldest));
+    OldestPos += sizeof(RecordHeader) + Oldest.Size;
+  }
+  CopyIn(WritePos, &RH, sizeof(RH));
+  CopyIn(WritePos + sizeof(RH), U.data(), U.size());
+  H->OldestPos = OldestPos;
+  H->WritePos = WritePos + RecordSize;
+  H->NumUnits++;
+  Unlock();
+  // The worker has its unit already.
+  if (ReadPos == WritePos)
+    ReadPos += RecordSize;
+}
+
+bool SharedCorpus::HasNewUnits() const {
+  return H->WritePos.load(std::memory_order_relaxed) != ReadPos;
+}
+
+void SharedCorpus::Fetch(std::vector<std::vector<uint8_t>> *Units) {
+  Lock();
+  uint64_t WritePos = H->WritePos;
+  if (ReadPos < H->OldestPos)
+    ReadPos = H->OldestPos;
+  while (ReadPos < WritePos) {
+    RecordHeader RH;
+    CopyOut(ReadPos, &RH, sizeof(RH));
+    if (RH.WorkerId != WorkerId) {
+      Units->push_back(std::vector<uint8_t>(RH.Size));
+      CopyOut(ReadPos + sizeof(RH), Units->back().data(), RH.Size);
+    }
+    ReadPos += sizeof(RH) + RH.Size;
+  }
+  Unlock();
+}
+
+void SharedCorpus::UpdateStats(size_t Runs, size_t BlockCoverage,
+                               size_t CorpusSize) {
+  WorkerStats &S = H->Stats[WorkerId % kMaxWorkers];
+  S.Runs.store(Runs, std::memory_order_relaxed);
+  S.BlockCoverage.store(BlockCoverage, std::memory_order_relaxed);
+  S.CorpusSize.store(CorpusSize, std::memory_order_relaxed);
+}
+
+void SharedCorpus::PrintStats() const {
+  uint64_t Runs = 0, BlockCoverage = 0, CorpusSize = 0;
+  size_t NumWorkers = std::min<size_t>(H->NumWorkers, kMaxWorkers);
+  for (size_t i = 0; i < NumWorkers; i++) {
+    const WorkerStats &S = H->Stats[i];
+    Runs += S.Runs.load(std::memory_order_relaxed);
+    BlockCoverage = std::max<uint64_t>(
+        BlockCoverage, S.BlockCoverage.load(std::memory_order_relaxed));
+    CorpusSize = std::max<uint64_t>(
+        CorpusSize, S.CorpusSize.load(std::memory_order_relaxed));
+  }
+  Printf("#%zd\tSHARED cov: %zd units: %zd published: %zd jobs: %zd\n",
+         (size_t)Runs, (size_t)BlockCoverage, (size_t)CorpusSize,
+         (size_t)H->NumUnits.load(), NumWorkers);
+}
+
+}  // namespace fuzzer
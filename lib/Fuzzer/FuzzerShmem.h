@@ -0,0 +1,75 @@
+//===- FuzzerShmem.h - INTERNAL - Shared corpus. ----------------*- C++ -* ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+// A corpus that the worker processes of -jobs share through memory.
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_FUZZER_SHMEM_H
+#define LLVM_FUZZER_SHMEM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fuzzer {
+
+// The units that the workers find are appended to a ring buffer in a file
+// that all of them map, and every worker reads the units that the others
+// appended since it last looked. A worker that falls behind by more than the
+// size of the buffer misses the oldest units. The workers also publish their
+// stats, which the parent process prints.
+class SharedCorpus {
+public:
+  static const size_t kMaxWorkers = 1024;
+
+  struct WorkerStats {
+    std::atomic<uint64_t> Runs;
+    std::atomic<uint64_t> BlockCoverage;
+    std::atomic<uint64_t> CorpusSize;
+  };
+
+  ~SharedCorpus();
+
+  // Creates the file with a buffer of Capacity bytes and maps it.
+  bool Create(const std::string &Path, size_t Capacity);
+  // Maps the file that a parent process created.
+  bool Attach(const std::string &Path);
+  bool IsMapped() const { return H != nullptr; }
+
+  // Appends U for the other workers.
+  void Publish(const std::vector<uint8_t> &U);
+  // Returns true if the other workers appended units since the last Fetch.
+  bool HasNewUnits() const;
+  // Appends the units of the other workers since the last call to Units.
+  void Fetch(std::vector<std::vector<uint8_t>> *Units);
+
+  void UpdateStats(size_t Runs, size_t BlockCoverage, size_t CorpusSize);
+  // Prints the sums over all the workers.
+  void PrintStats() const;
+
+private:
+  struct Header;
+
+  bool Map(int FD, size_t Size);
+  void Lock() const;
+  void Unlock() const;
+  void CopyIn(uint64_t Pos, const void *Src, size_t Size);
+  void CopyOut(uint64_t Pos, void *Dst, size_t Size) const;
+
+  Header *H = nullptr;
+  uint8_t *Buffer = nullptr;
+  size_t MappedSize = 0;
+  uint64_t ReadPos = 0;
+  uint32_t WorkerId = 0;
+};
+
+}  // namespace fuzzer
+
+#endif  // LLVM_FUZZER_SHMEM_H
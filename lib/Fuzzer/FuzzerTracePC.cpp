@@ -9,6 +9,8 @@
 // Trace PCs.
 // This module implements __sanitizer_cov_trace_pc, a callback required
 // for -fsanitize-coverage=trace-pc instrumentation.
+// It also implements __sanitizer_cov_8bit_counters_init, which registers the
+// inline 8-bit counters of -sanitizer-coverage-inline-8bit-counters.
 //
 //===----------------------------------------------------------------------===//
 
@@ -55,9 +57,75 @@ static void HandlePC(uint32_t PC) {
   Prev = Next;
 }
 
+// The counter sections of the instrumented modules.
+struct CounterRegion {
+  uint8_t *Start, *Stop;
+};
+static const size_t kMaxCounterRegions = 4096;
+static CounterRegion CounterRegions[kMaxCounterRegions];
+static size_t NumCounterRegions;
+static size_t NumInlineCounters;
+
+static void RegisterCounters(uint8_t *Start, uint8_t *Stop) {
+  if (Start == Stop || NumCounterRegions == kMaxCounterRegions)
+    return;
+  // Every module of a linked image registers the same section.
+  for (size_t i = 0; i < NumCounterRegions; i++)
+    if (CounterRegions[i].Start == Start)
+      return;
+  CounterRegions[NumCounterRegions++] = {Start, Stop};
+  NumInlineCounters += Stop - Start;
+}
+
+void InlineCountersReset() {
+  for (size_t i = 0; i < NumCounterRegions; i++)
+    memset(CounterRegions[i].Start, 0,
+           CounterRegions[i].Stop - CounterRegions[i].Start);
+}
+
+// Like the sanitizer run-time does for its counters, the counter values are
+// bucketed as 1, 2, 3, 4-7, 8-15, 16-31, 32-127 and 128+.
+static uint8_t CounterToBit(uint8_t Counter) {
+  if (Counter >= 128) return 128;
+  if (Counter >= 32) return 64;
+  if (Counter >= 16) return 32;
+  if (Counter >= 8) return 16;
+  if (Counter >= 4) return 8;
+  if (Counter >= 3) return 4;
+  if (Counter >= 2) return 2;
+  return 1;
+}
+
+size_t InlineCountersMergeInto(std::vector<uint8_t> *Bitmap) {
+  if (!NumInlineCounters)
+    return 0;
+  Bitmap->resize(NumInlineCounters);
+  size_t NewBits = 0;
+  size_t Idx = 0;
+  for (size_t i = 0; i < NumCounterRegions; i++) {
+    for (uint8_t *P = CounterRegions[i].Start; P < CounterRegions[i].Stop;
+         P++, Idx++) {
+      if (!*P)
+        continue;
+      uint8_t Bit = CounterToBit(*P);
+      *P = 0;
+      if (!((*Bitmap)[Idx] & Bit)) {
+        (*Bitmap)[Idx] |= Bit;
+        NewBits++;
+      }
+    }
+  }
+  return NewBits;
+}
+
 } // namespace fuzzer
 
 extern "C" void __sanitizer_cov_trace_pc() {
   fuzzer::HandlePC(static_cast<uint32_t>(
       reinterpret_cast<uintptr_t>(__builtin_return_address(0))));
 }
+
+extern "C" void __sanitizer_cov_8bit_counters_init(uint8_t *Start,
+                                                   uint8_t *Stop) {
+  fuzzer::RegisterCounters(Start, Stop);
+}
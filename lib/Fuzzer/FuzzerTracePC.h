@@ -9,6 +9,8 @@
 // Trace PCs.
 // This module implements __sanitizer_cov_trace_pc, a callback required
 // for -fsanitize-coverage=trace-pc instrumentation.
+// It also tracks the inline 8-bit counters of
+// -sanitizer-coverage-inline-8bit-counters.
 //===----------------------------------------------------------------------===//
 
 #ifndef LLVM_FUZZER_TRACE_PC_H
@@ -32,6 +34,12 @@ struct PcCoverageMap {
 void PcMapResetCurrent();
 // Merges the current PC Map into the combined one, and clears the former.
 size_t PcMapMergeInto(PcCoverageMap *Map);
+
+// Clears the inline 8-bit counters.
+void InlineCountersReset();
+// Merges the inline 8-bit counters into Bitmap, which has a bit per counter
+// value range, and clears them. Returns the number of new bits.
+size_t InlineCountersMergeInto(std::vector<uint8_t> *Bitmap);
 }
 
 #endif
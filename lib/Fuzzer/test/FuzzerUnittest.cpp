@@ -4,6 +4,7 @@
 #include "FuzzerInternal.h"
 #include "gtest/gtest.h"
 #include <set>
+#include <unistd.h>
 
 using namespace fuzzer;
 
@@ -423,3 +424,41 @@ TEST(Corpus, Distribution) {
     EXPECT_GT(Hist[i], TriesPerUnit / N / 3);
   }
 }
+
+TEST(SharedCorpus, Exchange) {
+  char Path[] = "/tmp/libFuzzer-shmem-test-XXXXXX";
+  int FD = mkstemp(Path);
+  ASSERT_GE(FD, 0);
+  close(FD);
+  SharedCorpus Parent, A, B;
+  // A tiny buffer, so that the units wrap around and the oldest get dropped.
+  ASSERT_TRUE(Parent.Create(Path, 32));
+  ASSERT_TRUE(A.Attach(Path));
+  ASSERT_TRUE(B.Attach(Path));
+  unlink(Path);
+
+  EXPECT_FALSE(B.HasNewUnits());
+  A.Publish({1, 2, 3});
+  EXPECT_FALSE(A.HasNewUnits());
+  EXPECT_TRUE(B.HasNewUnits());
+  std::vector<Unit> Units;
+  B.Fetch(&Units);
+  EXPECT_EQ(std::vector<Unit>({{1, 2, 3}}), Units);
+  EXPECT_FALSE(B.HasNewUnits());
+
+  // 11 bytes per record: only the last two fit.
+  A.Publish({4, 5, 6});
+  A.Publish({7, 8, 9});
+  A.Publish({10, 11, 12});
+  Units.clear();
+  B.Fetch(&Units);
+  EXPECT_EQ(std::vector<Unit>({{7, 8, 9}, {10, 11, 12}}), Units);
+
+  // A worker does not get its own units back.
+  B.Publish({13});
+  Units.clear();
+  B.Fetch(&Units);
+  EXPECT_TRUE(Units.empty());
+  A.Fetch(&Units);
+  EXPECT_EQ(std::vector<Unit>({{13}}), Units);
+}
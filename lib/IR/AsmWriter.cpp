@@ -14,6 +14,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "LLVMContextImpl.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
@@ -36,6 +37,7 @@
 #include "llvm/IR/TypeFinder.h"
 #include "llvm/IR/UseListOrder.h"
 #include "llvm/IR/ValueSymbolTable.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/ErrorHandling.h"
@@ -432,6 +434,10 @@ public:
   /// NumberedTypes - The numbered types, along with their value.
   DenseMap<StructType*, unsigned> NumberedTypes;
 
+  /// Number unnamed struct types that were created after incorporateTypes,
+  /// instead of printing their address.
+  bool ShouldNumberNewTypes = false;
+
   TypePrinting() = default;
 
   void incorporateTypes(const Module &M);
@@ -513,6 +519,8 @@ void TypePrinting::print(Type *Ty, raw_ostream &OS) {
       return PrintLLVMName(OS, STy->getName(), LocalPrefix);
 
     DenseMap<StructType*, unsigned>::iterator I = NumberedTypes.find(STy);
+    if (I == NumberedTypes.end() && ShouldNumberNewTypes)
+      I = NumberedTypes.insert(std::make_pair(STy, NumberedTypes.size())).first;
     if (I != NumberedTypes.end())
       OS << '%' << I->second;
     else  // Not enumerated, print the hex address.
@@ -590,6 +598,7 @@ private:
   const Function* TheFunction;
   bool FunctionProcessed;
   bool ShouldInitializeAllMetadata;
+  bool ShouldCreateMissingSlots;
 
   /// mMap - The slot map for the module level data.
   ValueMap mMap;
@@ -629,6 +638,13 @@ public:
   int getMetadataSlot(const MDNode *N);
   int getAttributeGroupSlot(AttributeSet AS);
 
+  /// Number values the tables do not know about as they are looked up, rather
+  /// than returning -1 for them. This keeps a SlotTracker usable across
+  /// changes to the IR: new module level values are numbered after the
+  /// existing ones, and the incorporated function is numbered again when one
+  /// of its values is missing.
+  void setCreateMissingSlots() { ShouldCreateMissingSlots = true; }
+
   /// If you'd like to deal with a function instead of just a module, use
   /// this method to get its data into the SlotTracker.
   void incorporateFunction(const Function *F) {
@@ -769,16 +785,18 @@ static SlotTracker *createSlotTracker(const Value *V) {
 // to be added to the slot table.
 SlotTracker::SlotTracker(const Module *M, bool ShouldInitializeAllMetadata)
     : TheModule(M), TheFunction(nullptr), FunctionProcessed(false),
-      ShouldInitializeAllMetadata(ShouldInitializeAllMetadata), mNext(0),
-      fNext(0), mdnNext(0), asNext(0) {}
+      ShouldInitializeAllMetadata(ShouldInitializeAllMetadata),
+      ShouldCreateMissingSlots(false), mNext(0), fNext(0), mdnNext(0),
+      asNext(0) {}
 
 // Function level constructor. Causes the contents of the Module and the one
 // function provided to be added to the slot table.
 SlotTracker::SlotTracker(const Function *F, bool ShouldInitializeAllMetadata)
     : TheModule(F ? F->getParent() : nullptr), TheFunction(F),
       FunctionProcessed(false),
-      ShouldInitializeAllMetadata(ShouldInitializeAllMetadata), mNext(0),
-      fNext(0), mdnNext(0), asNext(0) {}
+      ShouldInitializeAllMetadata(ShouldInitializeAllMetadata),
+      ShouldCreateMissingSlots(false), mNext(0), fNext(0), mdnNext(0),
+      asNext(0) {}
 
 inline void SlotTracker::initialize() {
   if (TheModule) {
@@ -929,7 +947,12 @@ int SlotTracker::getGlobalSlot(const GlobalValue *V) {
 
   // Find the value in the module map
   ValueMap::iterator MI = mMap.find(V);
-  return MI == mMap.end() ? -1 : (int)MI->second;
+  if (MI != mMap.end())
+    return MI->second;
+  if (!ShouldCreateMissingSlots || V->hasName())
+    return -1;
+  CreateModuleSlot(V);
+  return mMap[V];
 }
 
 /// getMetadataSlot - Get the slot number of a MDNode.
@@ -939,10 +962,26 @@ int SlotTracker::getMetadataSlot(const MDNode *N) {
 
   // Find the MDNode in the module map
   mdn_iterator MI = mdnMap.find(N);
-  return MI == mdnMap.end() ? -1 : (int)MI->second;
+  if (MI != mdnMap.end())
+    return MI->second;
+  if (!ShouldCreateMissingSlots)
+    return -1;
+  CreateMetadataSlot(N);
+  return mdnMap[N];
 }
 
 
+/// Return the function that defines the local value \p V, if any.
+static const Function *getLocalParent(const Value *V) {
+  if (const Argument *A = dyn_cast<Argument>(V))
+    return A->getParent();
+  if (const BasicBlock *BB = dyn_cast<BasicBlock>(V))
+    return BB->getParent();
+  if (const Instruction *I = dyn_cast<Instruction>(V))
+    return I->getParent() ? I->getFunction() : nullptr;
+  return nullptr;
+}
+
 /// getLocalSlot - Get the slot number for a value that is local to a function.
 int SlotTracker::getLocalSlot(const Value *V) {
   assert(!isa<Constant>(V) && "Can't get a constant or global slot with this!");
@@ -951,6 +990,16 @@ int SlotTracker::getLocalSlot(const Value *V) {
   initialize();
 
   ValueMap::iterator FI = fMap.find(V);
+  if (FI != fMap.end())
+    return FI->second;
+  if (!ShouldCreateMissingSlots || !TheFunction || V->hasName() ||
+      V->getType()->isVoidTy() || getLocalParent(V) != TheFunction)
+    return -1;
+
+  // The function has changed since it was numbered.
+  fMap.clear();
+  processFunction();
+  FI = fMap.find(V);
   return FI == fMap.end() ? -1 : (int)FI->second;
 }
 
@@ -960,7 +1009,13 @@ int SlotTracker::getAttributeGroupSlot(AttributeSet AS) {
 
   // Find the AttributeSet in the module map.
   as_iterator AI = asMap.find(AS);
-  return AI == asMap.end() ? -1 : (int)AI->second;
+  if (AI != asMap.end())
+    return AI->second;
+  if (!ShouldCreateMissingSlots ||
+      !AS.hasAttributes(AttributeSet::FunctionIndex))
+    return -1;
+  CreateAttributeSetSlot(AS);
+  return asMap[AS];
 }
 
 /// CreateModuleSlot - Insert the specified GlobalValue* into the slot table.
@@ -2045,11 +2100,16 @@ static void WriteAsOperandInternal(raw_ostream &Out, const Metadata *MD,
 
 namespace {
 class AssemblyWriter {
-  formatted_raw_ostream &Out;
+  /// Annotation writers are handed a formatted_raw_ostream, so one is only
+  /// created when there is an annotation writer. Everything else is written
+  /// without tracking the column.
+  std::unique_ptr<formatted_raw_ostream> FormattedOut;
+  raw_ostream &Out;
   const Module *TheModule;
   std::unique_ptr<SlotTracker> SlotTrackerStorage;
   SlotTracker &Machine;
-  TypePrinting TypePrinter;
+  TypePrinting TypePrinterStorage;
+  TypePrinting &TypePrinter;
   AssemblyAnnotationWriter *AnnotationWriter;
   SetVector<const Comdat *> Comdats;
   bool IsForDebug;
@@ -2059,10 +2119,16 @@ class AssemblyWriter {
 
 public:
   /// Construct an AssemblyWriter with an external SlotTracker
-  AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac, const Module *M,
+  AssemblyWriter(raw_ostream &o, SlotTracker &Mac, const Module *M,
                  AssemblyAnnotationWriter *AAW, bool IsForDebug,
                  bool ShouldPreserveUseListOrder = false);
 
+  /// Construct an AssemblyWriter with an external SlotTracker and the type
+  /// names in \p TP, which must already have incorporated the types of \p M.
+  AssemblyWriter(raw_ostream &o, SlotTracker &Mac, TypePrinting &TP,
+                 const Module *M, AssemblyAnnotationWriter *AAW,
+                 bool IsForDebug, bool ShouldPreserveUseListOrder = false);
+
   void printMDNodeBody(const MDNode *MD);
   void printNamedMDNode(const NamedMDNode *NMD);
 
@@ -2109,23 +2175,24 @@ private:
 };
 } // namespace
 
-AssemblyWriter::AssemblyWriter(formatted_raw_ostream &o, SlotTracker &Mac,
+AssemblyWriter::AssemblyWriter(raw_ostream &o, SlotTracker &Mac,
                                const Module *M, AssemblyAnnotationWriter *AAW,
                                bool IsForDebug, bool ShouldPreserveUseListOrder)
-    : Out(o), TheModule(M), Machine(Mac), AnnotationWriter(AAW),
-      IsForDebug(IsForDebug),
-      ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {
-  if (!TheModule)
-    return;
-  TypePrinter.incorporateTypes(*TheModule);
-  for (const Function &F : *TheModule)
-    if (const Comdat *C = F.getComdat())
-      Comdats.insert(C);
-  for (const GlobalVariable &GV : TheModule->globals())
-    if (const Comdat *C = GV.getComdat())
-      Comdats.insert(C);
+    : AssemblyWriter(o, Mac, TypePrinterStorage, M, AAW, IsForDebug,
+                     ShouldPreserveUseListOrder) {
+  if (TheModule)
+    TypePrinter.incorporateTypes(*TheModule);
 }
 
+AssemblyWriter::AssemblyWriter(raw_ostream &o, SlotTracker &Mac,
+                               TypePrinting &TP, const Module *M,
+                               AssemblyAnnotationWriter *AAW, bool IsForDebug,
+                               bool ShouldPreserveUseListOrder)
+    : FormattedOut(AAW ? make_unique<formatted_raw_ostream>(o) : nullptr),
+      Out(FormattedOut ? *FormattedOut : o), TheModule(M), Machine(Mac),
+      TypePrinter(TP), AnnotationWriter(AAW), IsForDebug(IsForDebug),
+      ShouldPreserveUseListOrder(ShouldPreserveUseListOrder) {}
+
 void AssemblyWriter::writeOperand(const Value *Operand, bool PrintType) {
   if (!Operand) {
     Out << "<null operand!>";
@@ -2264,6 +2331,12 @@ void AssemblyWriter::printModule(const Module *M) {
   printTypeIdentities();
 
   // Output all comdats.
+  for (const Function &F : *M)
+    if (const Comdat *C = F.getComdat())
+      Comdats.insert(C);
+  for (const GlobalVariable &GV : M->globals())
+    if (const Comdat *C = GV.getComdat())
+      Comdats.insert(C);
   if (!Comdats.empty())
     Out << '\n';
   for (const Comdat *C : Comdats) {
@@ -2315,8 +2388,7 @@ void AssemblyWriter::printModule(const Module *M) {
   }
 }
 
-static void printMetadataIdentifier(StringRef Name,
-                                    formatted_raw_ostream &Out) {
+static void printMetadataIdentifier(StringRef Name, raw_ostream &Out) {
   if (Name.empty()) {
     Out << "<empty name> ";
   } else {
@@ -2381,7 +2453,7 @@ static const char *getLinkagePrintName(GlobalValue::LinkageTypes LT) {
 }
 
 static void PrintVisibility(GlobalValue::VisibilityTypes Vis,
-                            formatted_raw_ostream &Out) {
+                            raw_ostream &Out) {
   switch (Vis) {
   case GlobalValue::DefaultVisibility: break;
   case GlobalValue::HiddenVisibility:    Out << "hidden "; break;
@@ -2390,7 +2462,7 @@ static void PrintVisibility(GlobalValue::VisibilityTypes Vis,
 }
 
 static void PrintDLLStorageClass(GlobalValue::DLLStorageClassTypes SCT,
-                                 formatted_raw_ostream &Out) {
+                                 raw_ostream &Out) {
   switch (SCT) {
   case GlobalValue::DefaultStorageClass: break;
   case GlobalValue::DLLImportStorageClass: Out << "dllimport "; break;
@@ -2399,7 +2471,7 @@ static void PrintDLLStorageClass(GlobalValue::DLLStorageClassTypes SCT,
 }
 
 static void PrintThreadLocalModel(GlobalVariable::ThreadLocalMode TLM,
-                                  formatted_raw_ostream &Out) {
+                                  raw_ostream &Out) {
   switch (TLM) {
     case GlobalVariable::NotThreadLocal:
       break;
@@ -2418,8 +2490,7 @@ static void PrintThreadLocalModel(GlobalVariable::ThreadLocalMode TLM,
   }
 }
 
-static void maybePrintComdat(formatted_raw_ostream &Out,
-                             const GlobalObject &GO) {
+static void maybePrintComdat(raw_ostream &Out, const GlobalObject &GO) {
   const Comdat *C = GO.getComdat();
   if (!C)
     return;
@@ -2562,7 +2633,7 @@ void AssemblyWriter::printFunction(const Function *F) {
   // Print out the return type and name.
   Out << '\n';
 
-  if (AnnotationWriter) AnnotationWriter->emitFunctionAnnot(F, Out);
+  if (AnnotationWriter) AnnotationWriter->emitFunctionAnnot(F, *FormattedOut);
 
   if (F->isMaterializable())
     Out << "; Materializable\n";
@@ -2714,25 +2785,31 @@ void AssemblyWriter::printArgument(const Argument *Arg,
 /// printBasicBlock - This member is called for each basic block in a method.
 ///
 void AssemblyWriter::printBasicBlock(const BasicBlock *BB) {
+  // The label is put together first, so that the comment after it can be
+  // lined up without tracking the column of the output.
+  SmallString<64> Label;
+  raw_svector_ostream LabelOS(Label);
   if (BB->hasName()) {              // Print out the label if it exists...
-    Out << "\n";
-    PrintLLVMName(Out, BB->getName(), LabelPrefix);
-    Out << ':';
+    PrintLLVMName(LabelOS, BB->getName(), LabelPrefix);
+    LabelOS << ':';
   } else if (!BB->use_empty()) {      // Don't print block # of no uses...
-    Out << "\n; <label>:";
+    LabelOS << "; <label>:";
     int Slot = Machine.getLocalSlot(BB);
     if (Slot != -1)
-      Out << Slot << ":";
+      LabelOS << Slot << ":";
     else
-      Out << "<badref>";
+      LabelOS << "<badref>";
   }
+  if (!Label.empty())
+    Out << '\n' << Label;
+  unsigned Padding = Label.size() < 50 ? 50 - Label.size() : 1;
 
   if (!BB->getParent()) {
-    Out.PadToColumn(50);
+    Out.indent(Padding);
     Out << "; Error: Block without parent!";
   } else if (BB != &BB->getParent()->getEntryBlock()) {  // Not the entry block?
     // Output predecessors for the block.
-    Out.PadToColumn(50);
+    Out.indent(Padding);
     Out << ";";
     const_pred_iterator PI = pred_begin(BB), PE = pred_end(BB);
 
@@ -2750,14 +2827,14 @@ void AssemblyWriter::printBasicBlock(const BasicBlock *BB) {
 
   Out << "\n";
 
-  if (AnnotationWriter) AnnotationWriter->emitBasicBlockStartAnnot(BB, Out);
+  if (AnnotationWriter) AnnotationWriter->emitBasicBlockStartAnnot(BB, *FormattedOut);
 
   // Output all of the instructions in the basic block...
   for (BasicBlock::const_iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
     printInstructionLine(*I);
   }
 
-  if (AnnotationWriter) AnnotationWriter->emitBasicBlockEndAnnot(BB, Out);
+  if (AnnotationWriter) AnnotationWriter->emitBasicBlockEndAnnot(BB, *FormattedOut);
 }
 
 /// printInstructionLine - Print an instruction and a newline character.
@@ -2784,12 +2861,12 @@ void AssemblyWriter::printInfoComment(const Value &V) {
     printGCRelocateComment(*Relocate);
 
   if (AnnotationWriter)
-    AnnotationWriter->printInfoComment(V, Out);
+    AnnotationWriter->printInfoComment(V, *FormattedOut);
 }
 
 // This member is called for each Instruction in a function..
 void AssemblyWriter::printInstruction(const Instruction &I) {
-  if (AnnotationWriter) AnnotationWriter->emitInstructionAnnot(&I, Out);
+  if (AnnotationWriter) AnnotationWriter->emitInstructionAnnot(&I, *FormattedOut);
 
   // Print out indentation for an instruction.
   Out << "  ";
@@ -3263,12 +3340,101 @@ void AssemblyWriter::printUseLists(const Function *F) {
 //                       External Interface declarations
 //===----------------------------------------------------------------------===//
 
+static cl::opt<bool> ReusePrintSlots(
+    "print-reuse-slots", cl::Hidden,
+    cl::desc("Keep the slot numbering of a module between prints of its "
+             "functions and instructions, and number values that were added "
+             "since then as they are printed"));
+
+namespace llvm {
+/// The slot numbering and type names of a module that -print-reuse-slots
+/// keeps between prints. Without it, every print of a function numbers the
+/// globals, attributes and metadata of the whole module, which makes
+/// -print-after-all quadratic in the size of the module.
+class ModulePrintCache {
+public:
+  SlotTracker Machine;
+  TypePrinting TypePrinter;
+
+  explicit ModulePrintCache(const Module &M)
+      : Machine(&M, /* ShouldInitializeAllMetadata */ true) {
+    Machine.setCreateMissingSlots();
+    TypePrinter.incorporateTypes(M);
+    TypePrinter.ShouldNumberNewTypes = true;
+  }
+};
+} // end namespace llvm
+
+void ModulePrintCacheDeleter::operator()(ModulePrintCache *Cache) const {
+  delete Cache;
+}
+
+/// Return the numbering kept for \p M, with \p F incorporated if it is not
+/// null. The numbering of \p F is kept from the last time it was incorporated
+/// until one of its values turns out to be missing. Printing a whole function
+/// always numbers it again, so its local slots are in order.
+static ModulePrintCache &getModulePrintCache(const Module &M,
+                                             const Function *F = nullptr) {
+  auto &Cache = M.getContext().pImpl->ModulePrintCaches[&M];
+  if (!Cache)
+    Cache.reset(new ModulePrintCache(M));
+  SlotTracker &Machine = Cache->Machine;
+  if (F && Machine.getFunction() != F) {
+    Machine.purgeFunction();
+    Machine.incorporateFunction(F);
+  }
+  return *Cache;
+}
+
+/// Print \p V with the numbering kept for its module by -print-reuse-slots.
+/// \return \c false if \p V should be printed the usual way.
+static bool printWithCachedSlots(const Value &V, raw_ostream &OS,
+                                 bool IsForDebug) {
+  if (!ReusePrintSlots)
+    return false;
+  const Module *M = getModuleFromVal(&V);
+  if (!M)
+    return false;
+
+  if (const Instruction *I = dyn_cast<Instruction>(&V)) {
+    ModulePrintCache &Cache = getModulePrintCache(*M, I->getFunction());
+    AssemblyWriter W(OS, Cache.Machine, Cache.TypePrinter, M, nullptr,
+                     IsForDebug);
+    W.printInstruction(*I);
+  } else if (const BasicBlock *BB = dyn_cast<BasicBlock>(&V)) {
+    ModulePrintCache &Cache = getModulePrintCache(*M, BB->getParent());
+    AssemblyWriter W(OS, Cache.Machine, Cache.TypePrinter, M, nullptr,
+                     IsForDebug);
+    W.printBasicBlock(BB);
+  } else if (const Function *F = dyn_cast<Function>(&V)) {
+    ModulePrintCache &Cache = getModulePrintCache(*M);
+    AssemblyWriter W(OS, Cache.Machine, Cache.TypePrinter, M, nullptr,
+                     IsForDebug);
+    W.printFunction(F);
+  } else if (const GlobalVariable *GV = dyn_cast<GlobalVariable>(&V)) {
+    ModulePrintCache &Cache = getModulePrintCache(*M);
+    AssemblyWriter W(OS, Cache.Machine, Cache.TypePrinter, M, nullptr,
+                     IsForDebug);
+    W.printGlobal(GV);
+  } else {
+    return false;
+  }
+  return true;
+}
+
 void Function::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
                      bool ShouldPreserveUseListOrder,
                      bool IsForDebug) const {
+  if (ReusePrintSlots && getParent()) {
+    ModulePrintCache &Cache = getModulePrintCache(*getParent());
+    AssemblyWriter W(ROS, Cache.Machine, Cache.TypePrinter, getParent(), AAW,
+                     IsForDebug, ShouldPreserveUseListOrder);
+    W.printFunction(this);
+    return;
+  }
+
   SlotTracker SlotTable(this->getParent());
-  formatted_raw_ostream OS(ROS);
-  AssemblyWriter W(OS, SlotTable, this->getParent(), AAW,
+  AssemblyWriter W(ROS, SlotTable, this->getParent(), AAW,
                    IsForDebug,
                    ShouldPreserveUseListOrder);
   W.printFunction(this);
@@ -3277,16 +3443,14 @@ void Function::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
 void Module::print(raw_ostream &ROS, AssemblyAnnotationWriter *AAW,
                    bool ShouldPreserveUseListOrder, bool IsForDebug) const {
   SlotTracker SlotTable(this);
-  formatted_raw_ostream OS(ROS);
-  AssemblyWriter W(OS, SlotTable, this, AAW, IsForDebug,
+  AssemblyWriter W(ROS, SlotTable, this, AAW, IsForDebug,
                    ShouldPreserveUseListOrder);
   W.printModule(this);
 }
 
 void NamedMDNode::print(raw_ostream &ROS, bool IsForDebug) const {
   SlotTracker SlotTable(getParent());
-  formatted_raw_ostream OS(ROS);
-  AssemblyWriter W(OS, SlotTable, getParent(), nullptr, IsForDebug);
+  AssemblyWriter W(ROS, SlotTable, getParent(), nullptr, IsForDebug);
   W.printNamedMDNode(this);
 }
 
@@ -3301,8 +3465,7 @@ void NamedMDNode::print(raw_ostream &ROS, ModuleSlotTracker &MST,
     SlotTable = &*LocalST;
   }
 
-  formatted_raw_ostream OS(ROS);
-  AssemblyWriter W(OS, *SlotTable, getParent(), nullptr, IsForDebug);
+  AssemblyWriter W(ROS, *SlotTable, getParent(), nullptr, IsForDebug);
   W.printNamedMDNode(this);
 }
 
@@ -3358,6 +3521,9 @@ static bool isReferencingMDNode(const Instruction &I) {
 }
 
 void Value::print(raw_ostream &ROS, bool IsForDebug) const {
+  if (printWithCachedSlots(*this, ROS, IsForDebug))
+    return;
+
   bool ShouldInitializeAllMetadata = false;
   if (auto *I = dyn_cast<Instruction>(this))
     ShouldInitializeAllMetadata = isReferencingMDNode(*I);
@@ -3368,9 +3534,8 @@ void Value::print(raw_ostream &ROS, bool IsForDebug) const {
   print(ROS, MST, IsForDebug);
 }
 
-void Value::print(raw_ostream &ROS, ModuleSlotTracker &MST,
+void Value::print(raw_ostream &OS, ModuleSlotTracker &MST,
                   bool IsForDebug) const {
-  formatted_raw_ostream OS(ROS);
   SlotTracker EmptySlotTable(static_cast<const Module *>(nullptr));
   SlotTracker &SlotTable =
       MST.getMachine() ? *MST.getMachine() : EmptySlotTable;
@@ -3396,7 +3561,7 @@ void Value::print(raw_ostream &ROS, ModuleSlotTracker &MST,
     else
       W.printIndirectSymbol(cast<GlobalIndirectSymbol>(GV));
   } else if (const MetadataAsValue *V = dyn_cast<MetadataAsValue>(this)) {
-    V->getMetadata()->print(ROS, MST, getModuleFromVal(V));
+    V->getMetadata()->print(OS, MST, getModuleFromVal(V));
   } else if (const Constant *C = dyn_cast<Constant>(this)) {
     TypePrinting TypePrinter;
     TypePrinter.print(C->getType(), OS);
@@ -3460,10 +3625,9 @@ void Value::printAsOperand(raw_ostream &O, bool PrintType,
   printAsOperandImpl(*this, O, PrintType, MST);
 }
 
-static void printMetadataImpl(raw_ostream &ROS, const Metadata &MD,
+static void printMetadataImpl(raw_ostream &OS, const Metadata &MD,
                               ModuleSlotTracker &MST, const Module *M,
                               bool OnlyAsOperand) {
-  formatted_raw_ostream OS(ROS);
 
   TypePrinting TypePrinter;
   if (M)
@@ -0,0 +1,94 @@
+//===- llvm/IR/CompileTimeBudget.cpp - Per-function budget ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// This file implements the per-function compile-time budget.
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/CompileTimeBudget.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/IR/DebugLoc.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Timer.h"
+
+using namespace llvm;
+
+static cl::opt<unsigned> MaxFunctionSize(
+    "opt-budget-max-size", cl::Hidden, cl::init(0),
+    cl::desc("Skip expensive optimizations on functions with more "
+             "instructions than this (0 = no limit)"));
+
+static cl::opt<unsigned> MaxFunctionTime(
+    "opt-budget-max-time-ms", cl::Hidden, cl::init(0),
+    cl::desc("Skip expensive optimizations on a function once the function "
+             "pass pipeline has spent this many milliseconds on it "
+             "(0 = no limit)"));
+
+CompileTimeBudget::CompileTimeBudget()
+    : MaxSize(MaxFunctionSize), MaxTime(MaxFunctionTime) {}
+
+static double getCurrentTime() {
+  return TimeRecord::getCurrentTime(/*Start=*/false).getProcessTime();
+}
+
+static unsigned getInstructionCount(const Function &F) {
+  unsigned Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+void CompileTimeBudget::beginFunction(const Function &F) {
+  // Nested runs, such as analyses scheduled on the fly, are charged to the
+  // outermost function.
+  if (!isEnabled() || CurrentFunction)
+    return;
+  CurrentFunction = &F;
+  StartTime = getCurrentTime();
+  Reported.clear();
+}
+
+void CompileTimeBudget::endFunction(const Function &F) {
+  if (CurrentFunction == &F)
+    CurrentFunction = nullptr;
+}
+
+bool CompileTimeBudget::shouldRunExpensivePass(StringRef PassName,
+                                               const Function &F,
+                                               StringRef Action) {
+  if (!isEnabled())
+    return true;
+
+  std::string Reason;
+  unsigned Size = MaxSize ? getInstructionCount(F) : 0;
+  if (MaxSize && Size > MaxSize) {
+    Reason = "the function has " + utostr(Size) +
+             " instructions, more than the limit of " + utostr(MaxSize);
+  } else if (MaxTime && CurrentFunction == &F) {
+    double Elapsed = (getCurrentTime() - StartTime) * 1000;
+    if (Elapsed <= MaxTime)
+      return true;
+    Reason = "the function has used its time limit of " + utostr(MaxTime) +
+             " ms";
+  } else {
+    return true;
+  }
+
+  // Only report each pass once per run over the function; loop passes ask
+  // once per loop.
+  if (CurrentFunction != &F || Reported.insert(PassName).second)
+    emitOptimizationRemarkMissed(F.getContext(), "compile-time-budget", F,
+                                 DebugLoc(),
+                                 PassName + " " + Action + " because " +
+                                     Reason);
+  return false;
+}
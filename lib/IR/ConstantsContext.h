@@ -15,6 +15,7 @@
 #ifndef LLVM_LIB_IR_CONSTANTSCONTEXT_H
 #define LLVM_LIB_IR_CONSTANTSCONTEXT_H
 
+#include "UniquingLock.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/IR/InlineAsm.h"
@@ -586,10 +587,19 @@ public:
 
 private:
   MapTy Map;
+  UniquingLock Lock;
 
 public:
+  /// Make the map safe to use from several threads.
+  void enableLocking() { Lock.enable(); }
+
   typename MapTy::iterator begin() { return Map.begin(); }
   typename MapTy::iterator end() { return Map.end(); }
+  typename MapTy::const_iterator begin() const { return Map.begin(); }
+  typename MapTy::const_iterator end() const { return Map.end(); }
+
+  size_t size() const { return Map.size(); }
+  size_t getMemorySize() const { return Map.getMemorySize(); }
 
   void freeConstants() {
     for (auto &I : Map)
@@ -608,6 +618,7 @@ private:
 public:
   /// Return the specified constant from the map, creating it if necessary.
   ConstantClass *getOrCreate(TypeClass *Ty, ValType V) {
+    UniquingGuard Guard(Lock);
     LookupKey Key(Ty, V);
     /// Hash once, and reuse it for the lookup and the insertion if needed.
     LookupKeyHashed Lookup(MapInfo::getHashValue(Key), Key);
@@ -626,6 +637,7 @@ public:
 
   /// Remove this constant from the map
   void remove(ConstantClass *CP) {
+    UniquingGuard Guard(Lock);
     typename MapTy::iterator I = Map.find(CP);
     assert(I != Map.end() && "Constant not found in constant table!");
     assert(*I == CP && "Didn't find correct element?");
@@ -636,6 +648,7 @@ public:
                                         ConstantClass *CP, Value *From,
                                         Constant *To, unsigned NumUpdated = 0,
                                         unsigned OperandNo = ~0u) {
+    UniquingGuard Guard(Lock);
     LookupKey Key(CP->getType(), ValType(Operands, CP));
     /// Hash once, and reuse it for the lookup and the insertion if needed.
     LookupKeyHashed Lookup(MapInfo::getHashValue(Key), Key);
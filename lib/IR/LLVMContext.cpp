@@ -134,6 +134,12 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   assert(LoopID == MD_loop && "llvm.loop kind id drifted");
   (void)LoopID;
 
+  // Create the 'section_prefix' metadata kind.
+  unsigned SectionPrefixID = getMDKindID("section_prefix");
+  assert(SectionPrefixID == MD_section_prefix &&
+         "section_prefix kind id drifted");
+  (void)SectionPrefixID;
+
   auto *DeoptEntry = pImpl->getOrInsertBundleTag("deopt");
   assert(DeoptEntry->second == LLVMContext::OB_deopt &&
          "deopt operand bundle id drifted!");
@@ -150,14 +156,24 @@ LLVMContext::LLVMContext() : pImpl(new LLVMContextImpl(*this)) {
   (void)GCTransitionEntry;
 }
 
+LLVMContext::LLVMContext(bool ConcurrentUniquing) : LLVMContext() {
+  if (ConcurrentUniquing)
+    pImpl->enableConcurrentUniquing();
+}
+
 LLVMContext::~LLVMContext() { delete pImpl; }
 
+bool LLVMContext::hasConcurrentUniquing() const {
+  return pImpl->ConcurrentUniquing;
+}
+
 void LLVMContext::addModule(Module *M) {
   pImpl->OwnedModules.insert(M);
 }
 
 void LLVMContext::removeModule(Module *M) {
   pImpl->OwnedModules.erase(M);
+  pImpl->ModulePrintCaches.erase(M);
 }
 
 //===----------------------------------------------------------------------===//
@@ -192,6 +208,14 @@ void LLVMContext::setDiagnosticHandler(DiagnosticHandlerTy DiagnosticHandler,
   pImpl->RespectDiagnosticFilters = RespectFilters;
 }
 
+void LLVMContext::setRemarkStreamer(std::unique_ptr<RemarkStreamer> Streamer) {
+  pImpl->Remarks = std::move(Streamer);
+}
+
+RemarkStreamer *LLVMContext::getRemarkStreamer() const {
+  return pImpl->Remarks.get();
+}
+
 LLVMContext::DiagnosticHandlerTy LLVMContext::getDiagnosticHandler() const {
   return pImpl->DiagnosticHandler;
 }
@@ -247,6 +271,10 @@ LLVMContext::getDiagnosticMessagePrefix(DiagnosticSeverity Severity) {
 }
 
 void LLVMContext::diagnose(const DiagnosticInfo &DI) {
+  if (pImpl->Remarks)
+    if (auto *Remark = dyn_cast<DiagnosticInfoOptimizationBase>(&DI))
+      pImpl->Remarks->emit(*Remark);
+
   // If there is a report handler, use it.
   if (pImpl->DiagnosticHandler) {
     if (!pImpl->RespectDiagnosticFilters || isDiagnosticEnabled(DI))
@@ -340,3 +368,7 @@ void LLVMContext::setDiscardValueNames(bool Discard) {
 OptBisect &LLVMContext::getOptBisect() {
   return pImpl->getOptBisect();
 }
+
+CompileTimeBudget &LLVMContext::getCompileTimeBudget() {
+  return pImpl->TimeBudget;
+}
@@ -17,7 +17,9 @@
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/OptBisect.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 using namespace llvm;
 
@@ -50,6 +52,18 @@ LLVMContextImpl::LLVMContextImpl(LLVMContext &C)
   NamedStructTypesUniqueID = 0;
 }
 
+void LLVMContextImpl::enableConcurrentUniquing() {
+  ConcurrentUniquing = true;
+  ConstantsLock.enable();
+  MetadataLock.enable();
+  TypesLock.enable();
+  ArrayConstants.enableLocking();
+  StructConstants.enableLocking();
+  VectorConstants.enableLocking();
+  ExprConstants.enableLocking();
+  InlineAsms.enableLocking();
+}
+
 LLVMContextImpl::~LLVMContextImpl() {
   // NOTE: We need to delete the contents of OwnedModules, but Module's dtor
   // will call LLVMContextImpl::removeModule, thus invalidating iterators into
@@ -162,6 +176,156 @@ void Module::dropTriviallyDeadConstantArrays() {
   Context.pImpl->dropTriviallyDeadConstantArrays();
 }
 
+static size_t getStringMapMemorySize(const StringMapImpl &Map) {
+  // Each bucket holds an entry pointer and the hash of its key.
+  return Map.getNumBuckets() * (sizeof(void *) + sizeof(unsigned));
+}
+
+void LLVMContextImpl::forEachTable(
+    function_ref<void(StringRef Name, size_t Entries, size_t Bytes)> Fn)
+    const {
+  Fn("ConstantInt", IntConstants.size(), IntConstants.getMemorySize());
+  Fn("ConstantFP", FPConstants.size(), FPConstants.getMemorySize());
+  Fn("ConstantAggregateZero", CAZConstants.size(),
+     CAZConstants.getMemorySize());
+  Fn("ConstantArray", ArrayConstants.size(), ArrayConstants.getMemorySize());
+  Fn("ConstantStruct", StructConstants.size(),
+     StructConstants.getMemorySize());
+  Fn("ConstantVector", VectorConstants.size(),
+     VectorConstants.getMemorySize());
+  Fn("ConstantPointerNull", CPNConstants.size(),
+     CPNConstants.getMemorySize());
+  Fn("UndefValue", UVConstants.size(), UVConstants.getMemorySize());
+  Fn("ConstantDataSequential", CDSConstants.size(),
+     getStringMapMemorySize(CDSConstants));
+  Fn("BlockAddress", BlockAddresses.size(), BlockAddresses.getMemorySize());
+  Fn("ConstantExpr", ExprConstants.size(), ExprConstants.getMemorySize());
+  Fn("InlineAsm", InlineAsms.size(), InlineAsms.getMemorySize());
+
+  Fn("MDString", MDStringCache.size(),
+     getStringMapMemorySize(MDStringCache) +
+         MDStringCache.getAllocator().getTotalMemory());
+  Fn("ValueAsMetadata", ValuesAsMetadata.size(),
+     ValuesAsMetadata.getMemorySize());
+  Fn("MetadataAsValue", MetadataAsValues.size(),
+     MetadataAsValues.getMemorySize());
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
+  Fn(#CLASS, CLASS##s.size(), CLASS##s.getMemorySize());
+#include "llvm/IR/Metadata.def"
+  Fn("Distinct MDNodes", DistinctMDNodes.size(),
+     DistinctMDNodes.capacity() * sizeof(MDNode *));
+  Fn("Instruction attachments", InstructionMetadata.size(),
+     InstructionMetadata.getMemorySize());
+  Fn("Function attachments", FunctionMetadata.size(),
+     FunctionMetadata.getMemorySize());
+
+  Fn("Type allocator", 0, TypeAllocator.getTotalMemory());
+  Fn("IntegerType", IntegerTypes.size(), IntegerTypes.getMemorySize());
+  Fn("FunctionType", FunctionTypes.size(), FunctionTypes.getMemorySize());
+  Fn("Literal StructType", AnonStructTypes.size(),
+     AnonStructTypes.getMemorySize());
+  Fn("Named StructType", NamedStructTypes.size(),
+     getStringMapMemorySize(NamedStructTypes));
+  Fn("ArrayType", ArrayTypes.size(), ArrayTypes.getMemorySize());
+  Fn("VectorType", VectorTypes.size(), VectorTypes.getMemorySize());
+  Fn("PointerType", PointerTypes.size() + ASPointerTypes.size(),
+     PointerTypes.getMemorySize() + ASPointerTypes.getMemorySize());
+
+  Fn("Value names", ValueNames.size(), ValueNames.getMemorySize());
+  Fn("Value handles", ValueHandles.size(), ValueHandles.getMemorySize());
+}
+
+size_t LLVMContextImpl::getTablesMemoryUsage() const {
+  size_t Bytes = 0;
+  forEachTable([&](StringRef, size_t, size_t TableBytes) {
+    Bytes += TableBytes;
+  });
+  return Bytes;
+}
+
+/// Return an estimate of the bytes allocated for \p N and its operands.
+static size_t getMDNodeSize(const MDNode *N) {
+  size_t Size = 0;
+  switch (N->getMetadataID()) {
+  default:
+    llvm_unreachable("Invalid MDNode subclass");
+#define HANDLE_MDNODE_LEAF(CLASS)                                              \
+  case Metadata::CLASS##Kind:                                                  \
+    Size = sizeof(CLASS);                                                      \
+    break;
+#include "llvm/IR/Metadata.def"
+  }
+  return Size + N->getNumOperands() * sizeof(MDOperand);
+}
+
+/// Return an estimate of the bytes allocated for the constants in \p Map and
+/// their operands.
+template <class ConstantClass>
+static size_t
+getConstantsSize(const ConstantUniqueMap<ConstantClass> &Map) {
+  size_t Size = 0;
+  for (const ConstantClass *C : Map)
+    Size += sizeof(ConstantClass) + C->getNumOperands() * sizeof(Use);
+  return Size;
+}
+
+void LLVMContextImpl::printMemoryReport(raw_ostream &OS) const {
+  OS << "  Entries        Bytes  Uniquing table\n";
+  size_t TotalBytes = 0;
+  forEachTable([&](StringRef Name, size_t Entries, size_t Bytes) {
+    if (!Entries && !Bytes)
+      return;
+    OS << format("%9zu %12zu  ", Entries, Bytes) << Name << '\n';
+    TotalBytes += Bytes;
+  });
+  OS.indent(10) << format("%12zu  ", TotalBytes) << "Total\n\n";
+
+  // The constants and metadata nodes themselves are allocated one by one, so
+  // estimate their sizes from their classes and number of operands.
+  OS << "  Objects        Bytes  Owned by the context\n";
+  TotalBytes = 0;
+  auto PrintObjects = [&](StringRef Name, size_t Objects, size_t Bytes) {
+    if (!Objects)
+      return;
+    OS << format("%9zu %12zu  ", Objects, Bytes) << Name << '\n';
+    TotalBytes += Bytes;
+  };
+  PrintObjects("ConstantInt", IntConstants.size(),
+               IntConstants.size() * sizeof(ConstantInt));
+  PrintObjects("ConstantFP", FPConstants.size(),
+               FPConstants.size() * sizeof(ConstantFP));
+  PrintObjects("ConstantArray", ArrayConstants.size(),
+               getConstantsSize(ArrayConstants));
+  PrintObjects("ConstantStruct", StructConstants.size(),
+               getConstantsSize(StructConstants));
+  PrintObjects("ConstantVector", VectorConstants.size(),
+               getConstantsSize(VectorConstants));
+  PrintObjects("ConstantExpr", ExprConstants.size(),
+               getConstantsSize(ExprConstants));
+  // The elements of a ConstantDataSequential are stored as the key of its
+  // table entry.
+  size_t CDSBytes = 0;
+  for (const auto &I : CDSConstants)
+    CDSBytes += sizeof(ConstantDataSequential) + I.getKeyLength();
+  PrintObjects("ConstantDataSequential", CDSConstants.size(), CDSBytes);
+
+  size_t UniquedNodes = 0, UniquedBytes = 0;
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
+  for (const CLASS *N : CLASS##s) {                                            \
+    ++UniquedNodes;                                                            \
+    UniquedBytes += getMDNodeSize(N);                                          \
+  }
+#include "llvm/IR/Metadata.def"
+  PrintObjects("Uniqued MDNode", UniquedNodes, UniquedBytes);
+  size_t DistinctBytes = 0;
+  for (const MDNode *N : DistinctMDNodes)
+    DistinctBytes += getMDNodeSize(N);
+  PrintObjects("Distinct MDNode", DistinctMDNodes.size(), DistinctBytes);
+  PrintObjects("ValueAsMetadata", ValuesAsMetadata.size(),
+               ValuesAsMetadata.size() * sizeof(ValueAsMetadata));
+  OS.indent(10) << format("%12zu  ", TotalBytes) << "Total\n";
+}
+
 namespace llvm {
 /// \brief Make MDOperand transparent for hashing.
 ///
@@ -17,6 +17,7 @@
 
 #include "AttributeImpl.h"
 #include "ConstantsContext.h"
+#include "UniquingLock.h"
 #include "llvm/ADT/APFloat.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/ArrayRef.h"
@@ -24,8 +25,11 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/FoldingSet.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/IR/CompileTimeBudget.h"
+#include "llvm/IR/RemarkStreamer.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DerivedTypes.h"
@@ -44,8 +48,10 @@ class DiagnosticInfoOptimizationRemarkMissed;
 class DiagnosticInfoOptimizationRemarkAnalysis;
 class GCStrategy;
 class LLVMContext;
+class ModulePrintCache;
 class Type;
 class Value;
+class raw_ostream;
 
 struct DenseMapAPIntKeyInfo {
   static inline APInt getEmptyKey() {
@@ -997,11 +1003,22 @@ public:
   }
 };
 
+/// Deletes a ModulePrintCache, which is only complete in AsmWriter.cpp.
+struct ModulePrintCacheDeleter {
+  void operator()(ModulePrintCache *Cache) const;
+};
+
 class LLVMContextImpl {
 public:
   /// OwnedModules - The set of modules instantiated in this context, and which
   /// will be automatically deleted if this context is deleted.
   SmallPtrSet<Module*, 4> OwnedModules;
+
+  /// The slot numbering that -print-reuse-slots keeps between prints of the
+  /// values of a module. Dropped when the module is destroyed.
+  DenseMap<const Module *,
+           std::unique_ptr<ModulePrintCache, ModulePrintCacheDeleter>>
+      ModulePrintCaches;
   
   LLVMContext::InlineAsmDiagHandlerTy InlineAsmDiagHandler;
   void *InlineAsmDiagContext;
@@ -1009,6 +1026,7 @@ public:
   LLVMContext::DiagnosticHandlerTy DiagnosticHandler;
   void *DiagnosticContext;
   bool RespectDiagnosticFilters;
+  std::unique_ptr<RemarkStreamer> Remarks;
 
   LLVMContext::YieldCallbackTy YieldCallback;
   void *YieldOpaqueHandle;
@@ -1139,15 +1157,49 @@ public:
   /// not.
   bool DiscardValueNames = false;
 
+  /// The locks for the uniquing tables in the concurrent uniquing mode. Each
+  /// guards a group of tables: the constants not in a ConstantUniqueMap
+  /// (which have their own), the metadata, and the types. A lookup may
+  /// create values of a later group while holding the lock of an earlier
+  /// one, never the other way around.
+  UniquingLock ConstantsLock;
+  UniquingLock MetadataLock;
+  UniquingLock TypesLock;
+  bool ConcurrentUniquing = false;
+
+  /// Make the uniquing of constants, metadata and types safe to use from
+  /// several threads.
+  void enableConcurrentUniquing();
+
   LLVMContextImpl(LLVMContext &C);
   ~LLVMContextImpl();
 
   /// Destroy the ConstantArrays if they are not used.
   void dropTriviallyDeadConstantArrays();
 
+  /// Call \p Fn with the name, the number of entries and the number of bytes
+  /// allocated for each uniquing table and allocator of this context. The
+  /// bytes don't include the objects that the tables point to, which makes
+  /// this cheap enough to call around every pass.
+  void forEachTable(
+      function_ref<void(StringRef Name, size_t Entries, size_t Bytes)> Fn)
+      const;
+
+  /// Return the number of bytes allocated for the uniquing tables and
+  /// allocators of this context.
+  size_t getTablesMemoryUsage() const;
+
+  /// Print the memory held by this context to \p OS: the uniquing tables,
+  /// and an estimate of the bytes held by the constants and metadata nodes
+  /// that it owns.
+  void printMemoryReport(raw_ostream &OS) const;
+
   /// \brief Access the object which manages optimization bisection for failure
   /// analysis.
   OptBisect &getOptBisect();
+
+  /// The per-function compile-time budget of this context.
+  CompileTimeBudget TimeBudget;
 };
 
 }
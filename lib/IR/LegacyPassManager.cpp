@@ -12,8 +12,13 @@
 //===----------------------------------------------------------------------===//
 
 
+#include "LLVMContextImpl.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CompileTimeBudget.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/IRPrintingPasses.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/LegacyPassNameParser.h"
@@ -21,8 +26,10 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Mutex.h"
+#include "llvm/Support/Process.h"
 #include "llvm/Support/TimeValue.h"
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
@@ -449,9 +456,36 @@ namespace {
 
 static ManagedStatic<sys::SmartMutex<true> > TimingInfoMutex;
 
+static cl::opt<bool> TimePassesPerFunction(
+    "time-passes-per-function", cl::Hidden,
+    cl::desc("With -time-passes, also report the time of each pass on each "
+             "function"));
+
+static cl::opt<unsigned> TimePassesSampleRate(
+    "time-passes-sample-rate", cl::Hidden, cl::init(1),
+    cl::desc("With -time-passes, only time one in this many pass runs"));
+
 class TimingInfo {
   DenseMap<Pass*, Timer*> TimingData;
+  StringMap<Timer*> NamedTimingData;
   TimerGroup TG;
+
+  /// The timers of the passes run on one function, for
+  /// -time-passes-per-function.
+  struct FunctionTiming {
+    std::unique_ptr<TimerGroup> TG;
+    StringMap<Timer*> TimingData;
+  };
+  StringMap<FunctionTiming> FunctionTimingData;
+
+  /// The number of pass runs so far, for -time-passes-sample-rate.
+  unsigned NumRuns = 0;
+
+  /// Returns true if the current pass run should be timed.
+  bool sampleRun() {
+    return TimePassesSampleRate <= 1 || NumRuns++ % TimePassesSampleRate == 0;
+  }
+
 public:
   // Use 'create' member to get this.
   TimingInfo() : TG("... Pass execution timing report ...") {}
@@ -462,6 +496,13 @@ public:
     // TimerGroup.
     for (auto &I : TimingData)
       delete I.second;
+    for (auto &I : NamedTimingData)
+      delete I.second;
+    // The per-function groups print their reports as their last timer is
+    // deleted.
+    for (auto &I : FunctionTimingData)
+      for (auto &J : I.second.TimingData)
+        delete J.second;
     // TimerGroup is deleted next, printing the report.
   }
 
@@ -476,17 +517,112 @@ public:
       return nullptr;
 
     sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    if (!sampleRun())
+      return nullptr;
     Timer *&T = TimingData[P];
     if (!T)
       T = new Timer(P->getPassName(), TG);
     return T;
   }
+
+  /// Return the timer for the new pass manager pass \p PassName.
+  Timer *getPassTimer(StringRef PassName) {
+    sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    if (!sampleRun())
+      return nullptr;
+    Timer *&T = NamedTimingData[PassName];
+    if (!T)
+      T = new Timer(PassName, TG);
+    return T;
+  }
+
+  /// Return the timer for the pass \p PassName on the function
+  /// \p FunctionName.
+  Timer *getPassTimer(StringRef PassName, StringRef FunctionName) {
+    sys::SmartScopedLock<true> Lock(*TimingInfoMutex);
+    FunctionTiming &FT = FunctionTimingData[FunctionName];
+    if (!FT.TG)
+      FT.TG = llvm::make_unique<TimerGroup>(
+          FunctionName, "... Pass execution timing report for function '" +
+                            FunctionName.str() + "' ...");
+    Timer *&T = FT.TimingData[PassName];
+    if (!T)
+      T = new Timer(PassName, *FT.TG);
+    return T;
+  }
 };
 
 } // End of anon namespace
 
 static TimingInfo *TheTimeInfo;
 
+namespace {
+
+//===----------------------------------------------------------------------===//
+/// MemoryReportInfo Class - This class is used to collect information about
+/// the memory each pass allocates and holds on to.  This only happens when
+/// -memory-report is enabled on the command line.
+///
+/// The heap growth of a pass is measured with the malloc statistics of the
+/// process, so it includes whatever other threads allocate while it runs.
+///
+
+static ManagedStatic<sys::SmartMutex<true> > MemoryReportMutex;
+
+class MemoryReportInfo {
+  struct PassRecord {
+    std::string Name;
+    unsigned Runs = 0;
+    int64_t HeapGrowth = 0;
+    int64_t TablesGrowth = 0;
+    size_t Held = 0;
+  };
+  MapVector<Pass *, PassRecord> Records;
+
+  PassRecord &getRecord(Pass *P) {
+    PassRecord &R = Records[P];
+    if (R.Name.empty())
+      R.Name = P->getPassName();
+    return R;
+  }
+
+public:
+  // MemoryReportDtor - Print out the memory used by each pass.
+  ~MemoryReportInfo();
+
+  // createTheMemoryReport - This method either initializes the
+  // TheMemoryReport pointer to a non-null value (if the -memory-report option
+  // is enabled) or it leaves it null.  It may be called multiple times.
+  static void createTheMemoryReport();
+
+  /// recordRun - Charge a run of \p P that grew the heap by \p HeapGrowth
+  /// and the uniquing tables by \p TablesGrowth bytes to it.
+  void recordRun(Pass *P, int64_t HeapGrowth, int64_t TablesGrowth) {
+    sys::SmartScopedLock<true> Lock(*MemoryReportMutex);
+    PassRecord &R = getRecord(P);
+    ++R.Runs;
+    R.HeapGrowth += HeapGrowth;
+    R.TablesGrowth += TablesGrowth;
+  }
+
+  /// recordHeld - Record the memory that \p P reports holding right now.
+  void recordHeld(Pass *P) {
+    size_t Held = P->getMemoryUsage();
+    if (!Held)
+      return;
+    sys::SmartScopedLock<true> Lock(*MemoryReportMutex);
+    PassRecord &R = getRecord(P);
+    R.Held = std::max(R.Held, Held);
+  }
+
+  /// printModuleReport - Print the memory held by \p M and its context.
+  void printModuleReport(const Module &M);
+};
+
+} // End of anon namespace
+
+static MemoryReportInfo *TheMemoryReport;
+
 //===----------------------------------------------------------------------===//
 // PMTopLevelManager implementation
 
@@ -951,6 +1087,8 @@ void PMDataManager::freePass(Pass *P, StringRef Msg,
     PassManagerPrettyStackEntry X(P);
     TimeRegion PassTimer(getPassTimer(P));
 
+    // Analyses usually hold on to the most memory just before they are freed.
+    recordPassMemoryUsage(P);
     P->releaseMemory();
   }
 
@@ -1306,6 +1444,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassMemoryRegion PassMemory(BP, F.getContext());
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1469,6 +1608,7 @@ void FunctionPassManagerImpl::releaseMemoryOnTheFly() {
 bool FunctionPassManagerImpl::run(Function &F) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  MemoryReportInfo::createTheMemoryReport();
 
   initializeAllAnalysisInfo();
   for (unsigned Index = 0; Index < getNumContainedManagers(); ++Index) {
@@ -1510,6 +1650,9 @@ bool FPPassManager::runOnFunction(Function &F) {
   // Collect inherited analysis from Module level pass manager.
   populateInheritedAnalysis(TPM->activeStack);
 
+  CompileTimeBudget &Budget = F.getContext().getCompileTimeBudget();
+  Budget.beginFunction(F);
+
   for (unsigned Index = 0; Index < getNumContainedPasses(); ++Index) {
     FunctionPass *FP = getContainedPass(Index);
     bool LocalChanged = false;
@@ -1521,7 +1664,11 @@ bool FPPassManager::runOnFunction(Function &F) {
 
     {
       PassManagerPrettyStackEntry X(FP, F);
-      TimeRegion PassTimer(getPassTimer(FP));
+      Timer *T = getPassTimer(FP);
+      TimeRegion PassTimer(T);
+      TimeRegion FunctionTimer(T ? getPassFunctionTimer(FP->getPassName(), F)
+                                 : nullptr);
+      PassMemoryRegion PassMemory(FP, F.getContext());
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1537,6 +1684,8 @@ bool FPPassManager::runOnFunction(Function &F) {
     recordAvailableAnalysis(FP);
     removeDeadPasses(FP, F.getName(), ON_FUNCTION_MSG);
   }
+
+  Budget.endFunction(F);
   return Changed;
 }
 
@@ -1599,6 +1748,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassMemoryRegion PassMemory(MP, M.getContext());
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1694,6 +1844,7 @@ Pass* MPPassManager::getOnTheFlyPass(Pass *MP, AnalysisID PI, Function &F){
 bool PassManagerImpl::run(Module &M) {
   bool Changed = false;
   TimingInfo::createTheTimeInfo();
+  MemoryReportInfo::createTheMemoryReport();
 
   dumpArguments();
   dumpPasses();
@@ -1710,6 +1861,9 @@ bool PassManagerImpl::run(Module &M) {
   for (ImmutablePass *ImPass : getImmutablePasses())
     Changed |= ImPass->doFinalization(M);
 
+  if (TheMemoryReport)
+    TheMemoryReport->printModuleReport(M);
+
   return Changed;
 }
 
@@ -1765,6 +1919,171 @@ Timer *llvm::getPassTimer(Pass *P) {
   return nullptr;
 }
 
+Timer *llvm::getPassTimer(StringRef PassName) {
+  TimingInfo::createTheTimeInfo();
+  if (TheTimeInfo)
+    return TheTimeInfo->getPassTimer(PassName);
+  return nullptr;
+}
+
+Timer *llvm::getPassFunctionTimer(StringRef PassName, const Function &F) {
+  if (TheTimeInfo && TimePassesPerFunction)
+    return TheTimeInfo->getPassTimer(PassName, F.getName());
+  return nullptr;
+}
+
+//===----------------------------------------------------------------------===//
+// MemoryReportInfo implementation
+
+bool llvm::MemoryReportIsEnabled = false;
+static cl::opt<bool, true> EnableMemoryReport(
+    "memory-report", cl::location(MemoryReportIsEnabled),
+    cl::desc("Report the memory each pass allocates and holds on to, printing "
+             "a report for each module and on exit"));
+
+static void printReportHeader(raw_ostream &OS, const Twine &Title) {
+  std::string Name = Title.str();
+  OS << "===" << std::string(73, '-') << "===\n";
+  unsigned Padding = (80 - Name.length()) / 2;
+  if (Padding > 80)
+    Padding = 0;
+  OS.indent(Padding) << Name << '\n';
+  OS << "===" << std::string(73, '-') << "===\n";
+}
+
+MemoryReportInfo::~MemoryReportInfo() {
+  if (Records.empty())
+    return;
+
+  std::vector<PassRecord> Sorted;
+  for (auto &I : Records)
+    Sorted.push_back(I.second);
+  std::stable_sort(Sorted.begin(), Sorted.end(),
+                   [](const PassRecord &LHS, const PassRecord &RHS) {
+                     return LHS.HeapGrowth > RHS.HeapGrowth;
+                   });
+
+  std::unique_ptr<raw_ostream> OutStream = CreateInfoOutputFile();
+  raw_ostream &OS = *OutStream;
+  printReportHeader(OS, "... Pass memory usage report ...");
+  OS << "  Heap and table growth is summed over all runs of a pass, held\n"
+     << "  memory is the most a pass reported holding at once.\n\n";
+  OS << "    Runs   Heap growth  Table growth          Held  Name\n";
+  int64_t TotalHeap = 0, TotalTables = 0;
+  for (const PassRecord &R : Sorted) {
+    OS << format("%8u %13lld %13lld %13zu  ", R.Runs, (long long)R.HeapGrowth,
+                 (long long)R.TablesGrowth, R.Held)
+       << R.Name << '\n';
+    TotalHeap += R.HeapGrowth;
+    TotalTables += R.TablesGrowth;
+  }
+  OS.indent(9) << format("%13lld %13lld", (long long)TotalHeap,
+                         (long long)TotalTables);
+  OS.indent(16) << "Total\n\n";
+  OS.flush();
+}
+
+void MemoryReportInfo::createTheMemoryReport() {
+  if (!MemoryReportIsEnabled || TheMemoryReport) return;
+
+  // Constructed the first time this is called, iff -memory-report is enabled.
+  // This guarantees that the object will be constructed before static globals,
+  // thus it will be destroyed before them.
+  static ManagedStatic<MemoryReportInfo> MRI;
+  TheMemoryReport = &*MRI;
+}
+
+/// Return an estimate of the bytes allocated for \p I and its operands.
+static size_t getInstructionSize(const Instruction &I) {
+  size_t Size = 0;
+  switch (I.getOpcode()) {
+  default:
+    llvm_unreachable("Unknown instruction");
+#define HANDLE_INST(N, OPC, CLASS)                                             \
+  case Instruction::OPC:                                                       \
+    Size = sizeof(CLASS);                                                      \
+    break;
+#include "llvm/IR/Instruction.def"
+  }
+  return Size + I.getNumOperands() * sizeof(Use);
+}
+
+void MemoryReportInfo::printModuleReport(const Module &M) {
+  sys::SmartScopedLock<true> Lock(*MemoryReportMutex);
+  std::unique_ptr<raw_ostream> OutStream = CreateInfoOutputFile();
+  raw_ostream &OS = *OutStream;
+  printReportHeader(OS, "... Memory held by '" + M.getModuleIdentifier() +
+                            "' after running passes ...");
+
+  // The values of the module, by subclass. Instructions are broken down by
+  // opcode.
+  std::vector<std::pair<size_t, size_t>> Instructions(
+      Instruction::OtherOpsEnd);
+  size_t Arguments = 0, BasicBlocks = 0;
+  for (const Function &F : M) {
+    Arguments += F.arg_size();
+    BasicBlocks += F.size();
+    for (const BasicBlock &BB : F)
+      for (const Instruction &I : BB) {
+        auto &Entry = Instructions[I.getOpcode()];
+        ++Entry.first;
+        Entry.second += getInstructionSize(I);
+      }
+  }
+
+  OS << "  Objects        Bytes  Value\n";
+  size_t TotalBytes = 0;
+  auto PrintValues = [&](StringRef Name, size_t Objects, size_t Bytes) {
+    if (!Objects)
+      return;
+    OS << format("%9zu %12zu  ", Objects, Bytes) << Name << '\n';
+    TotalBytes += Bytes;
+  };
+  PrintValues("Function", M.size(), M.size() * sizeof(Function));
+  PrintValues("GlobalVariable", M.getGlobalList().size(),
+              M.getGlobalList().size() * sizeof(GlobalVariable));
+  PrintValues("GlobalAlias", M.alias_size(),
+              M.alias_size() * sizeof(GlobalAlias));
+  PrintValues("GlobalIFunc", M.ifunc_size(),
+              M.ifunc_size() * sizeof(GlobalIFunc));
+  PrintValues("Argument", Arguments, Arguments * sizeof(Argument));
+  PrintValues("BasicBlock", BasicBlocks, BasicBlocks * sizeof(BasicBlock));
+  for (unsigned Opcode = 0; Opcode != Instructions.size(); ++Opcode)
+    PrintValues(Instruction::getOpcodeName(Opcode), Instructions[Opcode].first,
+                Instructions[Opcode].second);
+  OS.indent(10) << format("%12zu  ", TotalBytes) << "Total\n\n";
+
+  M.getContext().pImpl->printMemoryReport(OS);
+  OS << '\n';
+  OS.flush();
+}
+
+PassMemoryRegion::PassMemoryRegion(Pass *P, LLVMContext &Context)
+    : P(TheMemoryReport && !P->getAsPMDataManager() ? P : nullptr),
+      Context(&Context), HeapBefore(0), TablesBefore(0) {
+  if (!this->P)
+    return;
+  HeapBefore = sys::Process::GetMallocUsage();
+  TablesBefore = Context.pImpl->getTablesMemoryUsage();
+}
+
+PassMemoryRegion::~PassMemoryRegion() {
+  if (!P)
+    return;
+  int64_t HeapGrowth =
+      int64_t(sys::Process::GetMallocUsage()) - int64_t(HeapBefore);
+  int64_t TablesGrowth =
+      int64_t(Context->pImpl->getTablesMemoryUsage()) - int64_t(TablesBefore);
+  TheMemoryReport->recordRun(P, HeapGrowth, TablesGrowth);
+  TheMemoryReport->recordHeld(P);
+}
+
+/// If MemoryReportInfo is enabled then record the memory held by the pass.
+void llvm::recordPassMemoryUsage(Pass *P) {
+  if (TheMemoryReport && !P->getAsPMDataManager())
+    TheMemoryReport->recordHeld(P);
+}
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -72,6 +72,7 @@ static Metadata *canonicalizeMetadataForValue(LLVMContext &Context,
 
 MetadataAsValue *MetadataAsValue::get(LLVMContext &Context, Metadata *MD) {
   MD = canonicalizeMetadataForValue(Context, MD);
+  UniquingGuard Guard(Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->MetadataAsValues[MD];
   if (!Entry)
     Entry = new MetadataAsValue(Type::getMetadataTy(Context), MD);
@@ -309,6 +310,7 @@ ValueAsMetadata *ValueAsMetadata::get(Value *V) {
   assert(V && "Unexpected null Value");
 
   auto &Context = V->getContext();
+  UniquingGuard Guard(Context.pImpl->MetadataLock);
   auto *&Entry = Context.pImpl->ValuesAsMetadata[V];
   if (!Entry) {
     assert((isa<Constant>(V) || isa<Argument>(V) || isa<Instruction>(V)) &&
@@ -415,6 +417,7 @@ void ValueAsMetadata::handleRAUW(Value *From, Value *To) {
 //
 
 MDString *MDString::get(LLVMContext &Context, StringRef Str) {
+  UniquingGuard Guard(Context.pImpl->MetadataLock);
   auto &Store = Context.pImpl->MDStringCache;
   auto I = Store.emplace_second(Str);
   auto &MapEntry = I.first->getValue();
@@ -761,6 +764,33 @@ MDNode *MDNode::uniquify() {
   }
 }
 
+bool MDNode::isEqualIgnoringOperands(const MDNode &Other) const {
+  if (getMetadataID() != Other.getMetadataID() ||
+      getNumOperands() != Other.getNumOperands())
+    return false;
+
+  // Compare a temporary copy of this with the operands of Other the way
+  // uniquing would. The key compares the cached hash of nodes which have
+  // one, so it has to be recomputed for the new operands.
+  TempMDNode Copy = clone();
+  for (unsigned I = 0, E = getNumOperands(); I != E; ++I)
+    Copy->replaceOperandWith(I, Other.getOperand(I));
+
+  switch (getMetadataID()) {
+  default:
+    llvm_unreachable("Expected a uniquable MDNode subclass");
+#define HANDLE_MDNODE_LEAF_UNIQUABLE(CLASS)                                    \
+  case CLASS##Kind: {                                                          \
+    CLASS *SubclassCopy = cast<CLASS>(Copy.get());                             \
+    std::integral_constant<bool, HasCachedHash<CLASS>::value>                  \
+        ShouldRecalculateHash;                                                 \
+    dispatchRecalculateHash(SubclassCopy, ShouldRecalculateHash);              \
+    return MDNodeKeyImpl<CLASS>(SubclassCopy).isKeyOf(cast<CLASS>(&Other));    \
+  }
+#include "llvm/IR/Metadata.def"
+  }
+}
+
 void MDNode::eraseFromStore() {
   switch (getMetadataID()) {
   default:
@@ -775,6 +805,7 @@ void MDNode::eraseFromStore() {
 
 MDTuple *MDTuple::getImpl(LLVMContext &Context, ArrayRef<Metadata *> MDs,
                           StorageType Storage, bool ShouldCreate) {
+  UniquingGuard Guard(Context.pImpl->MetadataLock);
   unsigned Hash = 0;
   if (Storage == Uniqued) {
     MDTupleInfo::KeyTy Key(MDs);
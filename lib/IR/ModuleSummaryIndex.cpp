@@ -14,8 +14,29 @@
 
 #include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/IR/ModuleSummaryIndexTable.h"
 using namespace llvm;
 
+ModuleSummaryIndex::ModuleSummaryIndex() = default;
+ModuleSummaryIndex::~ModuleSummaryIndex() = default;
+
+const_gvsummary_iterator
+ModuleSummaryIndex::findInTable(GlobalValue::GUID ValueGUID) const {
+  std::lock_guard<std::mutex> Lock(TableMutex);
+  if (ReadAllFromTable)
+    return GlobalValueMap.find(ValueGUID);
+  return Table->readSummaries(ValueGUID,
+                              const_cast<ModuleSummaryIndex &>(*this));
+}
+
+void ModuleSummaryIndex::readAllFromTable() const {
+  std::lock_guard<std::mutex> Lock(TableMutex);
+  if (ReadAllFromTable)
+    return;
+  Table->readAllSummaries(const_cast<ModuleSummaryIndex &>(*this));
+  ReadAllFromTable = true;
+}
+
 // Create the combined module index/summary from multiple
 // per-module instances.
 void ModuleSummaryIndex::mergeFrom(std::unique_ptr<ModuleSummaryIndex> Other,
@@ -69,6 +90,14 @@ void ModuleSummaryIndex::removeEmptySummaryEntries() {
 // (GUID -> Summary).
 void ModuleSummaryIndex::collectDefinedFunctionsForModule(
     StringRef ModulePath, GVSummaryMapTy &GVSummaryMap) const {
+  if (Table) {
+    GVSummaryMapTy DefinedGVSummaries;
+    collectDefinedGVSummariesForModule(ModulePath, DefinedGVSummaries);
+    for (auto &GVSummary : DefinedGVSummaries)
+      if (isa<FunctionSummary>(GVSummary.second))
+        GVSummaryMap[GVSummary.first] = GVSummary.second;
+    return;
+  }
   for (auto &GlobalList : *this) {
     auto GUID = GlobalList.first;
     for (auto &GlobSummary : GlobalList.second) {
@@ -84,6 +113,24 @@ void ModuleSummaryIndex::collectDefinedFunctionsForModule(
   }
 }
 
+// Collect for the given module the list of summaries it defines
+// (GUID -> Summary).
+void ModuleSummaryIndex::collectDefinedGVSummariesForModule(
+    StringRef ModulePath, GVSummaryMapTy &GVSummaryMap) const {
+  // The table lists what each module defines, so that only the summaries of
+  // the module need to be read.
+  if (Table) {
+    for (GlobalValue::GUID GUID : Table->getDefinedGUIDs(ModulePath))
+      if (auto *Summary = findSummaryInModule(GUID, ModulePath))
+        GVSummaryMap[GUID] = Summary;
+    return;
+  }
+  for (auto &GlobalList : *this)
+    for (auto &Summary : GlobalList.second)
+      if (Summary->modulePath() == ModulePath)
+        GVSummaryMap[GlobalList.first] = Summary.get();
+}
+
 // Collect for each module the list of function it defines (GUID -> Summary).
 void ModuleSummaryIndex::collectDefinedGVSummariesPerModule(
     StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries) const {
@@ -0,0 +1,399 @@
+//===-- ModuleSummaryIndexTable.cpp - Flat summary index ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements writing and reading the summary index table.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/ModuleSummaryIndexTable.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+using namespace llvm;
+using support::ulittle32_t;
+using support::ulittle64_t;
+
+namespace {
+namespace table {
+
+enum : uint32_t { Magic = 0x5449534c /* "LSIT" */, Version = 1 };
+
+struct Header {
+  ulittle32_t Magic;
+  ulittle32_t Version;
+  ulittle32_t NumModules;
+  ulittle32_t NumBuckets;
+  ulittle32_t NumGUIDs;
+  ulittle32_t Reserved;
+  // The sizes of the sections, which follow the header in this order.
+  ulittle64_t ModulesSize;
+  ulittle64_t BucketsSize;
+  ulittle64_t RecordsSize;
+  ulittle64_t DefinedSize;
+  ulittle64_t StringsSize;
+};
+
+struct Module {
+  ulittle64_t PathOffset;
+  ulittle32_t PathSize;
+  ulittle32_t NumDefined;
+  ulittle64_t DefinedIndex;
+  ulittle64_t ModuleId;
+  ulittle32_t Hash[5];
+  ulittle32_t Reserved;
+};
+
+/// A slot of the hash table, which is empty if it has no records. A GUID
+/// is in the first slot from its low bits on that is empty or holds it.
+struct Bucket {
+  ulittle64_t GUID;
+  ulittle64_t RecordsOffset;
+  ulittle32_t NumRecords;
+  ulittle32_t Reserved;
+};
+
+/// The fixed part of a summary, which is followed by NumRefs GUIDs and then
+/// NumCalls Calls.
+struct Record {
+  uint8_t Kind;
+  uint8_t Linkage;
+  uint8_t HasSection;
+  uint8_t Reserved;
+  ulittle32_t Module;
+  ulittle64_t OriginalName;
+  ulittle64_t Aliasee;
+  ulittle32_t InstCount;
+  ulittle32_t NumRefs;
+  ulittle32_t NumCalls;
+  ulittle32_t Reserved2;
+};
+
+struct Call {
+  ulittle64_t Callee;
+  ulittle64_t ProfileCount;
+  ulittle32_t CallsiteCount;
+  uint8_t Hotness;
+  uint8_t Reserved[3];
+};
+
+} // end namespace table
+} // end anonymous namespace
+
+template <typename T> static const T *at(StringRef Section, uint64_t Offset) {
+  if (Offset > Section.size() || Section.size() - Offset < sizeof(T))
+    report_fatal_error("Malformed summary index table");
+  return reinterpret_cast<const T *>(Section.data() + Offset);
+}
+
+// FIXME: The table does not hold the virtual calls and the virtual tables of
+// the summaries, nor the devirtualization resolutions of the thin link, so
+// the backends that read it don't devirtualize across modules.
+void llvm::writeModuleSummaryIndexTable(const ModuleSummaryIndex &Index,
+                                        raw_ostream &OS) {
+  // Number the modules in the order of their IDs, so that the output does
+  // not depend on how the string map is laid out.
+  typedef ModulePathStringTableTy::MapEntryTy ModuleEntryTy;
+  std::vector<const ModuleEntryTy *> Modules;
+  for (const auto &Entry : Index.modulePaths())
+    Modules.push_back(&Entry);
+  std::sort(Modules.begin(), Modules.end(),
+            [](const ModuleEntryTy *A, const ModuleEntryTy *B) {
+              return std::make_pair(A->second.first, A->getKey()) <
+                     std::make_pair(B->second.first, B->getKey());
+            });
+  StringMap<uint32_t> ModuleNumbers;
+  for (uint32_t I = 0, E = Modules.size(); I != E; ++I)
+    ModuleNumbers[Modules[I]->getKey()] = I;
+
+  // Aliases refer to their aliasee by GUID.
+  DenseMap<const GlobalValueSummary *, GlobalValue::GUID> GUIDs;
+  uint32_t NumGUIDs = 0;
+  for (const auto &Entry : Index) {
+    NumGUIDs += !Entry.second.empty();
+    for (const auto &Summary : Entry.second)
+      GUIDs[Summary.get()] = Entry.first;
+  }
+
+  uint32_t NumBuckets = NextPowerOf2(NumGUIDs * 2);
+  std::vector<table::Bucket> Buckets(NumBuckets);
+  std::vector<std::vector<GlobalValue::GUID>> Defined(Modules.size());
+  std::string Records;
+  raw_string_ostream RecordsOS(Records);
+  support::endian::Writer<support::little> W(RecordsOS);
+  for (const auto &Entry : Index) {
+    if (Entry.second.empty())
+      continue;
+    uint32_t Slot = Entry.first & (NumBuckets - 1);
+    while (Buckets[Slot].NumRecords)
+      Slot = (Slot + 1) & (NumBuckets - 1);
+    Buckets[Slot].GUID = Entry.first;
+    Buckets[Slot].RecordsOffset = RecordsOS.tell();
+    Buckets[Slot].NumRecords = Entry.second.size();
+
+    for (const auto &Summary : Entry.second) {
+      uint32_t Module = ModuleNumbers.lookup(Summary->modulePath());
+      GlobalValue::GUID Aliasee = 0;
+      uint32_t InstCount = 0;
+      const std::vector<FunctionSummary::EdgeTy> *Calls = nullptr;
+      if (auto *AS = dyn_cast<AliasSummary>(Summary.get()))
+        Aliasee = GUIDs.lookup(&AS->getAliasee());
+      if (auto *FS = dyn_cast<FunctionSummary>(Summary.get())) {
+        InstCount = FS->instCount();
+        Calls = &FS->calls();
+      }
+      Defined[Module].push_back(Entry.first);
+
+      W.write<uint8_t>(Summary->getSummaryKind());
+      W.write<uint8_t>(Summary->linkage());
+      W.write<uint8_t>(Summary->hasSection());
+      W.write<uint8_t>(0);
+      W.write<uint32_t>(Module);
+      W.write<uint64_t>(
+          const_cast<GlobalValueSummary &>(*Summary).getOriginalName());
+      W.write<uint64_t>(Aliasee);
+      W.write<uint32_t>(InstCount);
+      W.write<uint32_t>(Summary->refs().size());
+      W.write<uint32_t>(Calls ? Calls->size() : 0);
+      W.write<uint32_t>(0);
+      for (const ValueInfo &Ref : Summary->refs())
+        W.write<uint64_t>(Ref.getGUID());
+      if (Calls)
+        for (const FunctionSummary::EdgeTy &Call : *Calls) {
+          W.write<uint64_t>(Call.first.getGUID());
+          W.write<uint64_t>(Call.second.ProfileCount);
+          W.write<uint32_t>(Call.second.CallsiteCount);
+          W.write<uint8_t>(uint8_t(Call.second.Hotness));
+          W.write<uint8_t>(0);
+          W.write<uint16_t>(0);
+        }
+    }
+  }
+  RecordsOS.flush();
+
+  std::string Strings;
+  uint64_t NumDefined = 0;
+  std::vector<table::Module> ModuleEntries(Modules.size());
+  for (uint32_t I = 0, E = Modules.size(); I != E; ++I) {
+    table::Module &M = ModuleEntries[I];
+    M.PathOffset = Strings.size();
+    M.PathSize = Modules[I]->getKeyLength();
+    M.NumDefined = Defined[I].size();
+    M.DefinedIndex = NumDefined;
+    M.ModuleId = Modules[I]->second.first;
+    for (unsigned J = 0; J != 5; ++J)
+      M.Hash[J] = Modules[I]->second.second[J];
+    M.Reserved = 0;
+    Strings += Modules[I]->getKey();
+    NumDefined += Defined[I].size();
+  }
+
+  table::Header H;
+  H.Magic = table::Magic;
+  H.Version = table::Version;
+  H.NumModules = Modules.size();
+  H.NumBuckets = NumBuckets;
+  H.NumGUIDs = NumGUIDs;
+  H.Reserved = 0;
+  H.ModulesSize = ModuleEntries.size() * sizeof(table::Module);
+  H.BucketsSize = Buckets.size() * sizeof(table::Bucket);
+  H.RecordsSize = Records.size();
+  H.DefinedSize = NumDefined * sizeof(ulittle64_t);
+  H.StringsSize = Strings.size();
+
+  OS.write(reinterpret_cast<const char *>(&H), sizeof(H));
+  OS.write(reinterpret_cast<const char *>(ModuleEntries.data()),
+           H.ModulesSize);
+  OS.write(reinterpret_cast<const char *>(Buckets.data()), H.BucketsSize);
+  OS << Records;
+  support::endian::Writer<support::little> DefinedW(OS);
+  for (const auto &List : Defined)
+    DefinedW.write<uint64_t>(List);
+  OS << Strings;
+}
+
+bool llvm::isModuleSummaryIndexTable(MemoryBufferRef Buffer) {
+  return Buffer.getBufferSize() >= sizeof(table::Header) &&
+         reinterpret_cast<const table::Header *>(Buffer.getBufferStart())
+                 ->Magic == table::Magic;
+}
+
+ErrorOr<std::unique_ptr<ModuleSummaryIndexTable>>
+ModuleSummaryIndexTable::create(std::unique_ptr<MemoryBuffer> Buffer) {
+  if (!isModuleSummaryIndexTable(Buffer->getMemBufferRef()))
+    return make_error_code(errc::invalid_argument);
+  auto *H = reinterpret_cast<const table::Header *>(Buffer->getBufferStart());
+  if (H->Version != table::Version || !isPowerOf2_32(H->NumBuckets) ||
+      H->NumGUIDs >= H->NumBuckets ||
+      H->ModulesSize != H->NumModules * sizeof(table::Module) ||
+      H->BucketsSize != H->NumBuckets * sizeof(table::Bucket) ||
+      H->DefinedSize % sizeof(ulittle64_t))
+    return make_error_code(errc::invalid_argument);
+
+  // Split the rest of the buffer into the sections.
+  StringRef Rest = Buffer->getBuffer().drop_front(sizeof(table::Header));
+  std::unique_ptr<ModuleSummaryIndexTable> Table(
+      new ModuleSummaryIndexTable(std::move(Buffer)));
+  StringRef *Sections[] = {&Table->Modules, &Table->Buckets, &Table->Records,
+                           &Table->Defined, &Table->Strings};
+  uint64_t Sizes[] = {H->ModulesSize, H->BucketsSize, H->RecordsSize,
+                      H->DefinedSize, H->StringsSize};
+  for (unsigned I = 0; I != array_lengthof(Sections); ++I) {
+    if (Sizes[I] > Rest.size())
+      return make_error_code(errc::invalid_argument);
+    *Sections[I] = Rest.substr(0, Sizes[I]);
+    Rest = Rest.drop_front(Sizes[I]);
+  }
+  Table->NumModules = H->NumModules;
+  Table->NumBuckets = H->NumBuckets;
+  return std::move(Table);
+}
+
+ErrorOr<std::unique_ptr<ModuleSummaryIndex>>
+ModuleSummaryIndexTable::createIndex(std::unique_ptr<MemoryBuffer> Buffer) {
+  ErrorOr<std::unique_ptr<ModuleSummaryIndexTable>> TableOrErr =
+      create(std::move(Buffer));
+  if (std::error_code EC = TableOrErr.getError())
+    return EC;
+  const ModuleSummaryIndexTable &Table = **TableOrErr;
+
+  auto Index = llvm::make_unique<ModuleSummaryIndex>();
+  for (uint32_t I = 0; I != Table.NumModules; ++I) {
+    auto *M = at<table::Module>(Table.Modules, I * sizeof(table::Module));
+    ModuleHash Hash;
+    for (unsigned J = 0; J != 5; ++J)
+      Hash[J] = M->Hash[J];
+    Index->addModulePath(Table.getModulePath(I), M->ModuleId, Hash);
+  }
+  Index->Table = std::move(*TableOrErr);
+  return std::move(Index);
+}
+
+uint32_t ModuleSummaryIndexTable::getNumGUIDs() const {
+  return reinterpret_cast<const table::Header *>(Buffer->getBufferStart())
+      ->NumGUIDs;
+}
+
+StringRef ModuleSummaryIndexTable::getModulePath(uint32_t Module) const {
+  auto *M = at<table::Module>(Modules, uint64_t(Module) * sizeof(table::Module));
+  if (M->PathOffset > Strings.size() ||
+      Strings.size() - M->PathOffset < M->PathSize)
+    report_fatal_error("Malformed summary index table");
+  return Strings.substr(M->PathOffset, M->PathSize);
+}
+
+std::vector<GlobalValue::GUID>
+ModuleSummaryIndexTable::getDefinedGUIDs(StringRef ModulePath) const {
+  std::vector<GlobalValue::GUID> GUIDs;
+  for (uint32_t I = 0; I != NumModules; ++I) {
+    if (getModulePath(I) != ModulePath)
+      continue;
+    auto *M = at<table::Module>(Modules, I * sizeof(table::Module));
+    for (uint64_t J = 0; J != M->NumDefined; ++J)
+      GUIDs.push_back(*at<ulittle64_t>(
+          Defined, (M->DefinedIndex + J) * sizeof(ulittle64_t)));
+  }
+  return GUIDs;
+}
+
+gvsummary_iterator
+ModuleSummaryIndexTable::readSummaries(GlobalValue::GUID GUID,
+                                       ModuleSummaryIndex &Index) const {
+  auto &Map = Index.GlobalValueMap;
+  auto Found = Map.find(GUID);
+  if (Found != Map.end())
+    return Found;
+
+  const table::Bucket *B;
+  for (uint32_t Slot = GUID & (NumBuckets - 1);;
+       Slot = (Slot + 1) & (NumBuckets - 1)) {
+    B = at<table::Bucket>(Buckets, uint64_t(Slot) * sizeof(table::Bucket));
+    if (!B->NumRecords)
+      return Map.end();
+    if (B->GUID == GUID)
+      break;
+  }
+
+  GlobalValueSummaryList List;
+  uint64_t Offset = B->RecordsOffset;
+  for (uint32_t I = 0; I != B->NumRecords; ++I) {
+    auto *R = at<table::Record>(Records, Offset);
+    Offset += sizeof(table::Record);
+    if (R->Linkage > GlobalValue::CommonLinkage || R->Module >= NumModules)
+      report_fatal_error("Malformed summary index table");
+    GlobalValueSummary::GVFlags Flags(
+        static_cast<GlobalValue::LinkageTypes>(R->Linkage), R->HasSection);
+    StringRef ModulePath =
+        Index.modulePaths().find(getModulePath(R->Module))->first();
+
+    std::unique_ptr<GlobalValueSummary> Summary;
+    switch (R->Kind) {
+    case GlobalValueSummary::AliasKind: {
+      // Read the aliasee first, it has the same module.
+      auto Aliasee = readSummaries(R->Aliasee, Index);
+      if (Aliasee == Map.end())
+        report_fatal_error("Malformed summary index table");
+      auto AliaseeSummary = llvm::find_if(
+          Aliasee->second,
+          [&](const std::unique_ptr<GlobalValueSummary> &Summary) {
+            return Summary->modulePath() == ModulePath;
+          });
+      if (AliaseeSummary == Aliasee->second.end())
+        report_fatal_error("Malformed summary index table");
+      auto AS = llvm::make_unique<AliasSummary>(Flags);
+      AS->setAliasee(AliaseeSummary->get());
+      Summary = std::move(AS);
+      break;
+    }
+    case GlobalValueSummary::FunctionKind:
+      Summary = llvm::make_unique<FunctionSummary>(Flags, R->InstCount);
+      break;
+    case GlobalValueSummary::GlobalVarKind:
+      Summary = llvm::make_unique<GlobalVarSummary>(Flags);
+      break;
+    default:
+      report_fatal_error("Malformed summary index table");
+    }
+    Summary->setOriginalName(R->OriginalName);
+    Summary->setModulePath(ModulePath);
+
+    Summary->refs().reserve(R->NumRefs);
+    for (uint32_t J = 0; J != R->NumRefs; ++J) {
+      Summary->addRefEdge(GlobalValue::GUID(*at<ulittle64_t>(Records, Offset)));
+      Offset += sizeof(ulittle64_t);
+    }
+    if (R->NumCalls && !isa<FunctionSummary>(Summary.get()))
+      report_fatal_error("Malformed summary index table");
+    for (uint32_t J = 0; J != R->NumCalls; ++J) {
+      auto *C = at<table::Call>(Records, Offset);
+      Offset += sizeof(table::Call);
+      if (C->Hotness > uint8_t(CalleeInfo::HotnessType::Hot))
+        report_fatal_error("Malformed summary index table");
+      cast<FunctionSummary>(Summary.get())
+          ->addCallGraphEdge(
+              GlobalValue::GUID(C->Callee),
+              CalleeInfo(C->CallsiteCount, C->ProfileCount,
+                         CalleeInfo::HotnessType(C->Hotness)));
+    }
+    List.push_back(std::move(Summary));
+  }
+  return Map.insert(std::make_pair(GUID, std::move(List))).first;
+}
+
+void ModuleSummaryIndexTable::readAllSummaries(
+    ModuleSummaryIndex &Index) const {
+  for (uint32_t Slot = 0; Slot != NumBuckets; ++Slot) {
+    auto *B = at<table::Bucket>(Buckets, uint64_t(Slot) * sizeof(table::Bucket));
+    if (B->NumRecords)
+      readSummaries(B->GUID, Index);
+  }
+}
@@ -93,6 +93,11 @@ void Pass::verifyAnalysis() const {
   // By default, don't do anything.
 }
 
+size_t Pass::getMemoryUsage() const {
+  // By default, don't report anything.
+  return 0;
+}
+
 void *Pass::getAdjustedAnalysisPointer(AnalysisID AID) {
   return this;
 }
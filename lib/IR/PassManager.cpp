@@ -9,10 +9,48 @@
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
+#include <thread>
 
 using namespace llvm;
 
+void llvm::detail::runOnThreads(unsigned NumThreads,
+                                std::function<void()> Work) {
+  if (!NumThreads)
+    NumThreads = std::thread::hardware_concurrency();
+  ThreadPool Pool(NumThreads);
+  for (unsigned I = 0; I != NumThreads; ++I)
+    Pool.async(Work);
+  Pool.wait();
+}
+
+bool llvm::detail::PassTimingRegion::isEnabled() {
+  return TimePassesIsEnabled;
+}
+
+llvm::detail::PassTimingRegion::PassTimingRegion(StringRef PassName,
+                                                 const Function *F) {
+  if (!TimePassesIsEnabled || PassName.startswith("PassManager<") ||
+      PassName.find("PassAdaptor<") != StringRef::npos)
+    return;
+  PassTimer = getPassTimer(PassName);
+  if (!PassTimer)
+    return;
+  PassTimer->startTimer();
+  if (F && (FunctionTimer = getPassFunctionTimer(PassName, *F)))
+    FunctionTimer->startTimer();
+}
+
+llvm::detail::PassTimingRegion::~PassTimingRegion() {
+  if (FunctionTimer)
+    FunctionTimer->stopTimer();
+  if (PassTimer)
+    PassTimer->stopTimer();
+}
+
 // Explicit template instantiations for core template typedefs.
 namespace llvm {
 template class PassManager<Module>;
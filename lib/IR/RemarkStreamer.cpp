@@ -0,0 +1,204 @@
+//===- RemarkStreamer.cpp - Binary optimization remarks -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the writer and the reader of the binary remark format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/IR/RemarkStreamer.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+#include <vector>
+
+using namespace llvm;
+
+static const char RemarkMagic[] = {'R', 'M', 'K', '\0'};
+static const unsigned RemarkVersion = 0;
+
+namespace {
+enum RecordKind { RK_String, RK_Remark };
+} // end anonymous namespace
+
+StringRef llvm::getRemarkTypeName(RemarkType Type) {
+  switch (Type) {
+  case RemarkType::Passed:
+    return "passed";
+  case RemarkType::Missed:
+    return "missed";
+  case RemarkType::Analysis:
+    return "analysis";
+  case RemarkType::AnalysisFPCommute:
+    return "analysis-fp-commute";
+  case RemarkType::AnalysisAliasing:
+    return "analysis-aliasing";
+  case RemarkType::Failure:
+    return "failure";
+  }
+  llvm_unreachable("Unknown remark type");
+}
+
+static RemarkType getRemarkType(const DiagnosticInfoOptimizationBase &DI) {
+  switch (DI.getKind()) {
+  case DK_OptimizationRemark:
+    return RemarkType::Passed;
+  case DK_OptimizationRemarkMissed:
+    return RemarkType::Missed;
+  case DK_OptimizationRemarkAnalysis:
+    return RemarkType::Analysis;
+  case DK_OptimizationRemarkAnalysisFPCommute:
+    return RemarkType::AnalysisFPCommute;
+  case DK_OptimizationRemarkAnalysisAliasing:
+    return RemarkType::AnalysisAliasing;
+  case DK_OptimizationFailure:
+    return RemarkType::Failure;
+  default:
+    llvm_unreachable("Not an optimization remark");
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// RemarkStreamer
+//===----------------------------------------------------------------------===//
+
+RemarkStreamer::RemarkStreamer(raw_ostream &OS) : OS(OS) {
+  OS.write(RemarkMagic, sizeof(RemarkMagic));
+  encodeULEB128(RemarkVersion, OS);
+}
+
+unsigned RemarkStreamer::getStringID(StringRef Str) {
+  auto Ins = StringIDs.insert(std::make_pair(Str, StringIDs.size()));
+  if (Ins.second) {
+    encodeULEB128(RK_String, OS);
+    encodeULEB128(Str.size(), OS);
+    OS << Str;
+  }
+  return Ins.first->second;
+}
+
+void RemarkStreamer::emit(const Remark &R) {
+  // The strings go first, so that the remark record is contiguous.
+  unsigned IDs[] = {getStringID(R.PassName), getStringID(R.FunctionName),
+                    getStringID(R.File), getStringID(R.Message)};
+  encodeULEB128(RK_Remark, OS);
+  encodeULEB128(unsigned(R.Type), OS);
+  for (unsigned ID : IDs)
+    encodeULEB128(ID, OS);
+  encodeULEB128(R.Line, OS);
+  encodeULEB128(R.Column, OS);
+}
+
+void RemarkStreamer::emit(const DiagnosticInfoOptimizationBase &DI) {
+  Remark R;
+  R.Type = getRemarkType(DI);
+  R.PassName = DI.getPassName();
+  R.FunctionName = DI.getFunction().getName();
+  if (DI.isLocationAvailable())
+    DI.getLocation(&R.File, &R.Line, &R.Column);
+  MessageStorage.clear();
+  R.Message = DI.getMsg().toStringRef(MessageStorage);
+  emit(R);
+}
+
+//===----------------------------------------------------------------------===//
+// parseRemarks
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// \brief A cursor over the bytes of a remark stream.
+class RemarkCursor {
+  StringRef Buffer;
+  size_t Offset = 0;
+
+public:
+  explicit RemarkCursor(StringRef Buffer) : Buffer(Buffer) {}
+
+  bool atEnd() const { return Offset == Buffer.size(); }
+  size_t getOffset() const { return Offset; }
+
+  bool readULEB128(uint64_t &Value) {
+    Value = 0;
+    for (unsigned Shift = 0; Offset != Buffer.size() && Shift < 64;
+         Shift += 7) {
+      uint8_t Byte = Buffer[Offset++];
+      Value |= uint64_t(Byte & 0x7f) << Shift;
+      if (!(Byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool readBytes(uint64_t Size, StringRef &Bytes) {
+    if (Size > Buffer.size() - Offset)
+      return false;
+    Bytes = Buffer.substr(Offset, Size);
+    Offset += Size;
+    return true;
+  }
+};
+} // end anonymous namespace
+
+static Error makeRemarkError(const Twine &Message, size_t Offset) {
+  return make_error<StringError>("malformed remark stream at offset " +
+                                     Twine(Offset) + ": " + Message,
+                                 inconvertibleErrorCode());
+}
+
+Error llvm::parseRemarks(StringRef Buffer,
+                         function_ref<void(const Remark &)> Callback) {
+  if (!Buffer.startswith(StringRef(RemarkMagic, sizeof(RemarkMagic))))
+    return make_error<StringError>("not a remark stream",
+                                   inconvertibleErrorCode());
+  RemarkCursor C(Buffer.substr(sizeof(RemarkMagic)));
+  uint64_t Version;
+  if (!C.readULEB128(Version) || Version != RemarkVersion)
+    return make_error<StringError>("unsupported remark stream version",
+                                   inconvertibleErrorCode());
+
+  std::vector<StringRef> Strings;
+  while (!C.atEnd()) {
+    size_t RecordOffset = C.getOffset() + sizeof(RemarkMagic);
+    uint64_t Kind;
+    if (!C.readULEB128(Kind))
+      return makeRemarkError("truncated record", RecordOffset);
+
+    if (Kind == RK_String) {
+      uint64_t Size;
+      StringRef Str;
+      if (!C.readULEB128(Size) || !C.readBytes(Size, Str))
+        return makeRemarkError("truncated string", RecordOffset);
+      Strings.push_back(Str);
+      continue;
+    }
+    if (Kind != RK_Remark)
+      return makeRemarkError("unknown record kind", RecordOffset);
+
+    uint64_t Fields[7];
+    for (uint64_t &Field : Fields)
+      if (!C.readULEB128(Field))
+        return makeRemarkError("truncated remark", RecordOffset);
+    if (Fields[0] > uint64_t(RemarkType::Last))
+      return makeRemarkError("unknown remark type", RecordOffset);
+    for (unsigned I = 1; I != 5; ++I)
+      if (Fields[I] >= Strings.size())
+        return makeRemarkError("invalid string ID", RecordOffset);
+
+    Remark R;
+    R.Type = RemarkType(Fields[0]);
+    R.PassName = Strings[Fields[1]];
+    R.FunctionName = Strings[Fields[2]];
+    R.File = Strings[Fields[3]];
+    R.Message = Strings[Fields[4]];
+    R.Line = Fields[5];
+    R.Column = Fields[6];
+    Callback(R);
+  }
+  return Error::success();
+}
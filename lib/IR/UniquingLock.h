@@ -0,0 +1,51 @@
+//===-- UniquingLock.h - Locks for the uniquing tables ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// \brief This file defines the lock that LLVMContextImpl guards its uniquing
+/// tables with in the concurrent uniquing mode.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_IR_UNIQUINGLOCK_H
+#define LLVM_LIB_IR_UNIQUINGLOCK_H
+
+#include "llvm/Support/Mutex.h"
+#include <mutex>
+
+namespace llvm {
+
+/// A recursive lock for a group of uniquing tables, which only does anything
+/// once it has been enabled, so that contexts that are only used from one
+/// thread don't pay for it.
+///
+/// It is meant to be held through a \c UniquingGuard for the whole of a
+/// lookup and the insertion that may follow it.
+class UniquingLock {
+  sys::SmartMutex<true> Mutex;
+  bool Enabled = false;
+
+public:
+  void enable() { Enabled = true; }
+
+  void lock() {
+    if (Enabled)
+      Mutex.lock();
+  }
+  void unlock() {
+    if (Enabled)
+      Mutex.unlock();
+  }
+};
+
+typedef std::lock_guard<UniquingLock> UniquingGuard;
+
+} // end namespace llvm
+
+#endif
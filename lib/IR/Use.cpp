@@ -38,6 +38,10 @@ void Use::swap(Use &RHS) {
   }
 }
 
+// Every operand in the IR is a Use, so its size matters for the memory
+// footprint of large modules. Make sure it doesn't grow by accident.
+static_assert(sizeof(Use) == 3 * sizeof(void *), "Use too big");
+
 User *Use::getUser() const {
   const Use *End = getImpliedUser();
   const UserRef *ref = reinterpret_cast<const UserRef *>(End);
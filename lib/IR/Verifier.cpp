@@ -75,13 +75,21 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cstdarg>
+#include <mutex>
+#include <thread>
 using namespace llvm;
 
 static cl::opt<bool> VerifyDebugInfo("verify-debug-info", cl::init(true));
 
+static cl::opt<unsigned> VerifierThreads(
+    "verifier-threads", cl::Hidden, cl::init(0),
+    cl::desc("Number of threads used when function bodies are verified in "
+             "parallel (0 uses one per hardware thread)"));
+
 namespace {
 struct VerifierSupport {
   raw_ostream *OS;
@@ -252,6 +260,36 @@ class Verifier : public InstVisitor<Verifier>, VerifierSupport {
   // constant expressions, we can arrive at a particular user many times.
   SmallPtrSet<const Value *, 32> GlobalValueVisited;
 
+  /// While function bodies are verified in parallel, the lock that serializes
+  /// the checks which may create types or attributes in the context.
+  std::mutex *ContextLock = nullptr;
+
+  /// Intrinsic declarations whose prototype matched, and aggregate types known
+  /// to be sized. Only used by the short-lived verifiers of parallel
+  /// verification, to avoid taking ContextLock over and over.
+  SmallPtrSet<const Function *, 8> MatchedIntrinsics;
+  SmallPtrSet<Type *, 8> SizedAggregates;
+
+  std::unique_lock<std::mutex> lockContext() {
+    if (!ContextLock)
+      return std::unique_lock<std::mutex>();
+    return std::unique_lock<std::mutex>(*ContextLock);
+  }
+
+  /// Type::isSized remembers in a struct type that it is sized, so asking
+  /// about aggregates has to be serialized in parallel verification.
+  bool isSized(Type *Ty, SmallPtrSetImpl<Type *> *Visited = nullptr) {
+    if (!ContextLock || (!isa<StructType>(Ty) && !isa<ArrayType>(Ty)))
+      return Ty->isSized(Visited);
+    if (SizedAggregates.count(Ty))
+      return true;
+    std::lock_guard<std::mutex> Lock(*ContextLock);
+    if (!Ty->isSized(Visited))
+      return false;
+    SizedAggregates.insert(Ty);
+    return true;
+  }
+
   void checkAtomicMemAccessSize(const Module *M, Type *Ty,
                                 const Instruction *I);
 
@@ -357,7 +395,15 @@ public:
     return !Broken;
   }
 
+  /// Verify the bodies of the functions in \p M on a thread pool, with the
+  /// same result and messages as calling verify(F) for each of them in turn.
+  bool verifyFunctionsInParallel(const Module &M);
+
 private:
+  /// Take over what \p Other found out about the module while verifying
+  /// function bodies, so that verify(M) sees it as well.
+  void mergeFunctionResults(const Verifier &Other);
+
   // Verification methods...
   void visitGlobalValue(const GlobalValue &GV);
   void visitGlobalVariable(const GlobalVariable &GV);
@@ -1406,16 +1452,19 @@ void Verifier::verifyParameterAttrs(AttributeSet Attrs, unsigned Idx, Type *Ty,
          "'noinline and alwaysinline' are incompatible!",
          V);
 
-  Assert(!AttrBuilder(Attrs, Idx)
-              .overlaps(AttributeFuncs::typeIncompatible(Ty)),
-         "Wrong types for attribute: " +
-         AttributeSet::get(*Context, Idx,
-                        AttributeFuncs::typeIncompatible(Ty)).getAsString(Idx),
-         V);
+  if (AttrBuilder(Attrs, Idx).overlaps(AttributeFuncs::typeIncompatible(Ty))) {
+    auto Lock = lockContext();
+    CheckFailed("Wrong types for attribute: " +
+                    AttributeSet::get(*Context, Idx,
+                                      AttributeFuncs::typeIncompatible(Ty))
+                        .getAsString(Idx),
+                V);
+    return;
+  }
 
   if (PointerType *PTy = dyn_cast<PointerType>(Ty)) {
     SmallPtrSet<Type*, 4> Visited;
-    if (!PTy->getElementType()->isSized(&Visited)) {
+    if (!isSized(PTy->getElementType(), &Visited)) {
       Assert(!Attrs.hasAttribute(Idx, Attribute::ByVal) &&
                  !Attrs.hasAttribute(Idx, Attribute::InAlloca),
              "Attributes 'byval' and 'inalloca' do not support unsized types!",
@@ -2862,7 +2911,7 @@ void Verifier::visitGetElementPtrInst(GetElementPtrInst &GEP) {
 
   Assert(isa<PointerType>(TargetTy),
          "GEP base pointer is not a vector or a vector of pointers", &GEP);
-  Assert(GEP.getSourceElementType()->isSized(), "GEP into unsized type!", &GEP);
+  Assert(isSized(GEP.getSourceElementType()), "GEP into unsized type!", &GEP);
   SmallVector<Value*, 16> Idxs(GEP.idx_begin(), GEP.idx_end());
   Type *ElTy =
       GetElementPtrInst::getIndexedType(GEP.getSourceElementType(), Idxs);
@@ -3048,7 +3097,7 @@ void Verifier::visitAllocaInst(AllocaInst &AI) {
   Assert(PTy->getAddressSpace() == 0,
          "Allocation instruction pointer not in the generic address space!",
          &AI);
-  Assert(AI.getAllocatedType()->isSized(&Visited),
+  Assert(isSized(AI.getAllocatedType(), &Visited),
          "Cannot allocate unsized type", &AI);
   Assert(AI.getArraySize()->getType()->isIntegerTy(),
          "Alloca array size must have integer type", &AI);
@@ -3901,42 +3950,48 @@ void Verifier::visitIntrinsicCallSite(Intrinsic::ID ID, CallSite CS) {
          IF);
 
   // Verify that the intrinsic prototype lines up with what the .td files
-  // describe.
-  FunctionType *IFTy = IF->getFunctionType();
-  bool IsVarArg = IFTy->isVarArg();
-
-  SmallVector<Intrinsic::IITDescriptor, 8> Table;
-  getIntrinsicInfoTableEntries(ID, Table);
-  ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
-
-  SmallVector<Type *, 4> ArgTys;
-  Assert(!verifyIntrinsicType(IFTy->getReturnType(), TableRef, ArgTys),
-         "Intrinsic has incorrect return type!", IF);
-  for (unsigned i = 0, e = IFTy->getNumParams(); i != e; ++i)
-    Assert(!verifyIntrinsicType(IFTy->getParamType(i), TableRef, ArgTys),
-           "Intrinsic has incorrect argument type!", IF);
-
-  // Verify if the intrinsic call matches the vararg property.
-  if (IsVarArg)
-    Assert(!verifyIntrinsicIsVarArg(IsVarArg, TableRef),
-           "Intrinsic was not defined with variable arguments!", IF);
-  else
-    Assert(!verifyIntrinsicIsVarArg(IsVarArg, TableRef),
-           "Callsite was not defined with variable arguments!", IF);
-
-  // All descriptors should be absorbed by now.
-  Assert(TableRef.empty(), "Intrinsic has too few arguments!", IF);
-
-  // Now that we have the intrinsic ID and the actual argument types (and we
-  // know they are legal for the intrinsic!) get the intrinsic name through the
-  // usual means.  This allows us to verify the mangling of argument types into
-  // the name.
-  const std::string ExpectedName = Intrinsic::getName(ID, ArgTys);
-  Assert(ExpectedName == IF->getName(),
-         "Intrinsic name not mangled correctly for type arguments! "
-         "Should be: " +
-             ExpectedName,
-         IF);
+  // describe. Matching may create types, so in parallel verification it is
+  // done under the context lock, once per declaration.
+  if (!MatchedIntrinsics.count(IF)) {
+    auto Lock = lockContext();
+    FunctionType *IFTy = IF->getFunctionType();
+    bool IsVarArg = IFTy->isVarArg();
+
+    SmallVector<Intrinsic::IITDescriptor, 8> Table;
+    getIntrinsicInfoTableEntries(ID, Table);
+    ArrayRef<Intrinsic::IITDescriptor> TableRef = Table;
+
+    SmallVector<Type *, 4> ArgTys;
+    Assert(!verifyIntrinsicType(IFTy->getReturnType(), TableRef, ArgTys),
+           "Intrinsic has incorrect return type!", IF);
+    for (unsigned i = 0, e = IFTy->getNumParams(); i != e; ++i)
+      Assert(!verifyIntrinsicType(IFTy->getParamType(i), TableRef, ArgTys),
+             "Intrinsic has incorrect argument type!", IF);
+
+    // Verify if the intrinsic call matches the vararg property.
+    if (IsVarArg)
+      Assert(!verifyIntrinsicIsVarArg(IsVarArg, TableRef),
+             "Intrinsic was not defined with variable arguments!", IF);
+    else
+      Assert(!verifyIntrinsicIsVarArg(IsVarArg, TableRef),
+             "Callsite was not defined with variable arguments!", IF);
+
+    // All descriptors should be absorbed by now.
+    Assert(TableRef.empty(), "Intrinsic has too few arguments!", IF);
+
+    // Now that we have the intrinsic ID and the actual argument types (and
+    // we know they are legal for the intrinsic!) get the intrinsic name
+    // through the usual means.  This allows us to verify the mangling of
+    // argument types into the name.
+    const std::string ExpectedName = Intrinsic::getName(ID, ArgTys);
+    Assert(ExpectedName == IF->getName(),
+           "Intrinsic name not mangled correctly for type arguments! "
+           "Should be: " +
+               ExpectedName,
+           IF);
+    if (ContextLock)
+      MatchedIntrinsics.insert(IF);
+  }
 
   // If the intrinsic takes MDNode arguments, verify that they are either global
   // or are local to *this* function.
@@ -4421,6 +4476,78 @@ void Verifier::verifyDeoptimizeCallingConvs() {
   }
 }
 
+void Verifier::mergeFunctionResults(const Verifier &Other) {
+  BrokenDebugInfo |= Other.BrokenDebugInfo;
+  MDNodes.insert(Other.MDNodes.begin(), Other.MDNodes.end());
+  CUVisited.insert(Other.CUVisited.begin(), Other.CUVisited.end());
+  for (const auto &Entry : Other.FrameEscapeInfo) {
+    auto &Counts = FrameEscapeInfo[Entry.first];
+    Counts.first = std::max(Counts.first, Entry.second.first);
+    Counts.second = std::max(Counts.second, Entry.second.second);
+  }
+}
+
+bool Verifier::verifyFunctionsInParallel(const Module &M) {
+  std::vector<const Function *> Functions;
+  for (const Function &F : M)
+    if (!F.isDeclaration() && !F.isMaterializable())
+      Functions.push_back(&F);
+
+  unsigned NumThreads = VerifierThreads;
+  if (!NumThreads)
+    NumThreads = std::thread::hardware_concurrency();
+  NumThreads = std::min<size_t>(NumThreads, Functions.size());
+  if (NumThreads <= 1) {
+    bool IsValid = true;
+    for (const Function *F : Functions)
+      IsValid &= verify(*F);
+    return IsValid;
+  }
+
+  // The checks that run on the threads only read the IR, apart from the ones
+  // that take the context lock. "none" is created on first use, so create it
+  // up front.
+  ConstantTokenNone::get(M.getContext());
+
+  // Every thread gets a few contiguous ranges of functions, so that a range of
+  // big functions does not leave the other threads idle at the end. Each range
+  // is checked by a verifier of its own, which buffers its messages.
+  size_t ChunkSize = (Functions.size() + NumThreads * 4 - 1) / (NumThreads * 4);
+  size_t NumChunks = (Functions.size() + ChunkSize - 1) / ChunkSize;
+  std::vector<std::unique_ptr<Verifier>> Verifiers(NumChunks);
+  std::vector<std::string> Messages(NumChunks);
+  std::vector<char> IsValid(NumChunks);
+  std::mutex Lock;
+  {
+    ThreadPool Pool(NumThreads);
+    for (size_t I = 0; I != NumChunks; ++I)
+      Pool.async([&, I]() {
+        raw_string_ostream ChunkOS(Messages[I]);
+        Verifiers[I] = llvm::make_unique<Verifier>(
+            OS ? &ChunkOS : nullptr, TreatBrokenDebugInfoAsError);
+        Verifier &V = *Verifiers[I];
+        V.ContextLock = &Lock;
+        bool ChunkIsValid = true;
+        size_t End = std::min(Functions.size(), (I + 1) * ChunkSize);
+        for (size_t F = I * ChunkSize; F != End; ++F)
+          ChunkIsValid &= V.verify(*Functions[F]);
+        IsValid[I] = ChunkIsValid;
+        V.OS = nullptr;
+      });
+    Pool.wait();
+  }
+
+  // Report in function order, as if the functions had been verified here.
+  bool AllValid = true;
+  for (size_t I = 0; I != NumChunks; ++I) {
+    if (OS)
+      *OS << Messages[I];
+    AllValid &= IsValid[I] != 0;
+    mergeFunctionResults(*Verifiers[I]);
+  }
+  return AllValid;
+}
+
 //===----------------------------------------------------------------------===//
 //  Implement the public interfaces to this file...
 //===----------------------------------------------------------------------===//
@@ -4438,14 +4565,17 @@ bool llvm::verifyFunction(const Function &f, raw_ostream *OS) {
 }
 
 bool llvm::verifyModule(const Module &M, raw_ostream *OS,
-                        bool *BrokenDebugInfo) {
+                        bool *BrokenDebugInfo, bool Parallel) {
   // Don't use a raw_null_ostream.  Printing IR is expensive.
   Verifier V(OS, /*ShouldTreatBrokenDebugInfoAsError=*/!BrokenDebugInfo);
 
   bool Broken = false;
-  for (const Function &F : M)
-    if (!F.isDeclaration() && !F.isMaterializable())
-      Broken |= !V.verify(F);
+  if (Parallel)
+    Broken = !V.verifyFunctionsInParallel(M);
+  else
+    for (const Function &F : M)
+      if (!F.isDeclaration() && !F.isMaterializable())
+        Broken |= !V.verify(F);
 
   Broken |= !V.verify(M);
   if (BrokenDebugInfo)
@@ -4512,6 +4642,54 @@ FunctionPass *llvm::createVerifierPass(bool FatalErrors) {
   return new VerifierLegacyPass(FatalErrors);
 }
 
+namespace {
+struct ParallelVerifierLegacyPass : public ModulePass {
+  static char ID;
+
+  bool FatalErrors = true;
+
+  ParallelVerifierLegacyPass() : ModulePass(ID) {
+    initializeParallelVerifierLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+  explicit ParallelVerifierLegacyPass(bool FatalErrors)
+      : ModulePass(ID), FatalErrors(FatalErrors) {
+    initializeParallelVerifierLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnModule(Module &M) override {
+    bool BrokenDebugInfo = false;
+    bool HasErrors =
+        verifyModule(M, &dbgs(), &BrokenDebugInfo, /*Parallel=*/true);
+    if (FatalErrors) {
+      if (HasErrors)
+        report_fatal_error("Broken module found, compilation aborted!");
+      assert(!BrokenDebugInfo && "Module contains invalid debug info");
+    }
+
+    // Strip broken debug info.
+    if (BrokenDebugInfo) {
+      DiagnosticInfoIgnoringInvalidDebugMetadata DiagInvalid(M);
+      M.getContext().diagnose(DiagInvalid);
+      if (!StripDebugInfo(M))
+        report_fatal_error("Failed to strip malformed debug info");
+    }
+    return false;
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesAll();
+  }
+};
+}
+
+char ParallelVerifierLegacyPass::ID = 0;
+INITIALIZE_PASS(ParallelVerifierLegacyPass, "verify-parallel",
+                "Module Verifier (function bodies in parallel)", false, false)
+
+ModulePass *llvm::createParallelVerifierPass(bool FatalErrors) {
+  return new ParallelVerifierLegacyPass(FatalErrors);
+}
+
 char VerifierAnalysis::PassID;
 VerifierAnalysis::Result VerifierAnalysis::run(Module &M) {
   Result Res;
@@ -13,12 +13,21 @@
 
 #include "llvm/LTO/LTO.h"
 #include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
 
+static cl::opt<std::string> ThinLTOBackendTraceFile(
+    "thinlto-backend-trace", cl::Hidden, cl::value_desc("filename"),
+    cl::desc("Write when each ThinLTO backend ran, and on which thread, to "
+             "this file in the Chrome trace event format"));
+
 // Simple helper to load a module from bitcode
 std::unique_ptr<Module> loadModuleFromBuffer(const MemoryBufferRef &Buffer,
                                              LLVMContext &Context, bool Lazy) {
@@ -40,6 +49,30 @@ std::unique_ptr<Module> loadModuleFromBuffer(const MemoryBufferRef &Buffer,
   return std::move(ModuleOrErr.get());
 }
 
+/// Call \p Fn for every GUID of \p Index. The index is split into up to
+/// \p ThreadCount ranges of consecutive GUIDs, which are handled in parallel;
+/// \p Fn is given the number of the range of the GUID.
+static void forEachGUIDInParallel(
+    ModuleSummaryIndex &Index, unsigned ThreadCount,
+    function_ref<void(unsigned, GlobalValue::GUID, GlobalValueSummaryList &)>
+        Fn) {
+  size_t Size = std::distance(Index.begin(), Index.end());
+  size_t ChunkSize = (Size + ThreadCount - 1) / ThreadCount;
+  std::vector<gvsummary_iterator> Bounds;
+  for (auto I = Index.begin(); Size; Size -= std::min(Size, ChunkSize)) {
+    Bounds.push_back(I);
+    std::advance(I, std::min(Size, ChunkSize));
+  }
+  Bounds.push_back(Index.end());
+
+  ThreadPool Pool(Bounds.size() - 1);
+  for (unsigned Chunk = 0, E = Bounds.size() - 1; Chunk != E; ++Chunk)
+    Pool.async([&](unsigned Chunk) {
+      for (auto I = Bounds[Chunk]; I != Bounds[Chunk + 1]; ++I)
+        Fn(Chunk, I->first, I->second);
+    }, Chunk);
+}
+
 static void thinLTOResolveWeakForLinkerGUID(
     GlobalValueSummaryList &GVSummaryList, GlobalValue::GUID GUID,
     DenseSet<GlobalValueSummary *> &GlobalInvolvedWithAlias,
@@ -91,7 +124,8 @@ void thinLTOResolveWeakForLinkerInIndex(
         isPrevailing,
     std::function<bool(StringRef, GlobalValue::GUID)> isExported,
     std::function<void(StringRef, GlobalValue::GUID, GlobalValue::LinkageTypes)>
-        recordNewLinkage) {
+        recordNewLinkage,
+    unsigned ThreadCount) {
   if (Index.modulePaths().size() == 1)
     // Nothing to do if we don't have multiple modules
     return;
@@ -105,9 +139,36 @@ void thinLTOResolveWeakForLinkerInIndex(
       if (auto AS = dyn_cast<AliasSummary>(S.get()))
         GlobalInvolvedWithAlias.insert(&AS->getAliasee());
 
-  for (auto &I : Index)
-    thinLTOResolveWeakForLinkerGUID(I.second, I.first, GlobalInvolvedWithAlias,
-                                    isPrevailing, isExported, recordNewLinkage);
+  if (ThreadCount <= 1) {
+    for (auto &I : Index)
+      thinLTOResolveWeakForLinkerGUID(I.second, I.first,
+                                      GlobalInvolvedWithAlias, isPrevailing,
+                                      isExported, recordNewLinkage);
+    return;
+  }
+
+  // The new linkages are recorded per range of GUIDs, and reported once all
+  // of them are done, in the order the serial walk would report them.
+  struct NewLinkage {
+    StringRef ModulePath;
+    GlobalValue::GUID GUID;
+    GlobalValue::LinkageTypes Linkage;
+  };
+  std::vector<std::vector<NewLinkage>> NewLinkages(ThreadCount);
+  forEachGUIDInParallel(
+      Index, ThreadCount, [&](unsigned Chunk, GlobalValue::GUID GUID,
+                              GlobalValueSummaryList &GVSummaryList) {
+        thinLTOResolveWeakForLinkerGUID(
+            GVSummaryList, GUID, GlobalInvolvedWithAlias, isPrevailing,
+            isExported,
+            [&](StringRef ModulePath, GlobalValue::GUID GUID,
+                GlobalValue::LinkageTypes Linkage) {
+              NewLinkages[Chunk].push_back({ModulePath, GUID, Linkage});
+            });
+      });
+  for (auto &ChunkLinkages : NewLinkages)
+    for (auto &NL : ChunkLinkages)
+      recordNewLinkage(NL.ModulePath, NL.GUID, NL.Linkage);
 }
 
 static void thinLTOInternalizeAndPromoteGUID(
@@ -126,8 +187,105 @@ static void thinLTOInternalizeAndPromoteGUID(
 // as external and non-exported values as internal.
 void thinLTOInternalizeAndPromoteInIndex(
     ModuleSummaryIndex &Index,
-    std::function<bool(StringRef, GlobalValue::GUID)> isExported) {
-  for (auto &I : Index)
-    thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+    std::function<bool(StringRef, GlobalValue::GUID)> isExported,
+    unsigned ThreadCount) {
+  if (ThreadCount <= 1) {
+    for (auto &I : Index)
+      thinLTOInternalizeAndPromoteGUID(I.second, I.first, isExported);
+    return;
+  }
+
+  forEachGUIDInParallel(Index, ThreadCount,
+                        [&](unsigned, GlobalValue::GUID GUID,
+                            GlobalValueSummaryList &GVSummaryList) {
+                          thinLTOInternalizeAndPromoteGUID(GVSummaryList, GUID,
+                                                           isExported);
+                        });
+}
+
+static uint64_t getInstCount(const GlobalValueSummary *Summary) {
+  if (auto *AS = dyn_cast<AliasSummary>(Summary))
+    Summary = &AS->getAliasee();
+  if (auto *FS = dyn_cast<FunctionSummary>(Summary))
+    return FS->instCount();
+  return 0;
+}
+
+uint64_t
+estimateThinLTOBackendCost(const ModuleSummaryIndex &Index,
+                           const GVSummaryMapTy &DefinedGVSummaries,
+                           const FunctionImporter::ImportMapTy &ImportList) {
+  uint64_t Cost = 0;
+  for (auto &Defined : DefinedGVSummaries)
+    Cost += getInstCount(Defined.second);
+  for (auto &ImportsFromModule : ImportList)
+    for (auto &Import : ImportsFromModule.second)
+      if (auto *Summary =
+              Index.findSummaryInModule(Import.first, ImportsFromModule.first()))
+        Cost += getInstCount(Summary);
+  return Cost;
+}
+
+ThinLTOBackendTrace::ThinLTOBackendTrace(std::string Path)
+    : Path(std::move(Path)), Origin(std::chrono::steady_clock::now()) {}
+
+std::unique_ptr<ThinLTOBackendTrace> ThinLTOBackendTrace::createIfRequested() {
+  if (ThinLTOBackendTraceFile.empty())
+    return nullptr;
+  return std::unique_ptr<ThinLTOBackendTrace>(
+      new ThinLTOBackendTrace(ThinLTOBackendTraceFile));
+}
+
+void ThinLTOBackendTrace::addBackend(StringRef ModuleIdentifier, uint64_t Cost,
+                                     TimePoint Start) {
+  TimePoint End = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> Lock(Mutex);
+  unsigned Thread =
+      Threads.insert(std::make_pair(std::this_thread::get_id(), Threads.size()))
+          .first->second;
+  Events.push_back({ModuleIdentifier, Cost, Thread, Start, End});
+}
+
+static void printJSONString(raw_ostream &OS, StringRef Str) {
+  OS << '"';
+  for (unsigned char C : Str) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void ThinLTOBackendTrace::print(raw_ostream &OS) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto toMicroseconds = [&](TimePoint T) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(T - Origin)
+        .count();
+  };
+  OS << "{\"traceEvents\":[";
+  bool First = true;
+  for (const Event &E : Events) {
+    OS << (First ? "\n" : ",\n");
+    First = false;
+    OS << "{\"name\":";
+    printJSONString(OS, E.ModuleIdentifier);
+    OS << ",\"cat\":\"backend\",\"ph\":\"X\",\"pid\":0,\"tid\":" << E.Thread
+       << ",\"ts\":" << toMicroseconds(E.Start)
+       << ",\"dur\":" << toMicroseconds(E.End) - toMicroseconds(E.Start)
+       << ",\"args\":{\"cost\":" << E.Cost << "}}";
+  }
+  OS << "\n]}\n";
+}
+
+std::error_code ThinLTOBackendTrace::write() {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC)
+    return EC;
+  print(OS);
+  return std::error_code();
 }
 }
@@ -43,11 +43,13 @@
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/IPO/WholeProgramDevirt.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
@@ -57,6 +59,9 @@ using namespace llvm;
 
 #define DEBUG_TYPE "thinlto"
 
+STATISTIC(NumCacheHits, "Number of modules loaded from the ThinLTO cache");
+STATISTIC(NumCacheMisses, "Number of modules missing from the ThinLTO cache");
+
 namespace llvm {
 // Flags -discard-value-names, defined in LTOCodeGenerator.cpp
 extern cl::opt<bool> LTODiscardValueNames;
@@ -67,6 +72,8 @@ namespace {
 static cl::opt<int> ThreadCount("threads",
                                 cl::init(std::thread::hardware_concurrency()));
 
+static const char *const ThinLinkGroupName = "ThinLTO thin link";
+
 static void diagnosticHandler(const DiagnosticInfo &DI) {
   DiagnosticPrinterRawOStream DP(errs());
   DI.print(DP);
@@ -154,7 +161,8 @@ crossImportIntoModule(Module &TheModule, const ModuleSummaryIndex &Index,
   Importer.importFunctions(TheModule, ImportList);
 }
 
-static void optimizeModule(Module &TheModule, TargetMachine &TM) {
+static void optimizeModule(Module &TheModule, TargetMachine &TM,
+                           const ModuleSummaryIndex *Index) {
   // Populate the PassManager
   PassManagerBuilder PMB;
   PMB.LibraryInfo = new TargetLibraryInfoImpl(TM.getTargetTriple());
@@ -172,6 +180,11 @@ static void optimizeModule(Module &TheModule, TargetMachine &TM) {
   // instance)
   PM.add(createTargetTransformInfoWrapperPass(TM.getTargetIRAnalysis()));
 
+  // Devirtualize with the resolutions of the thin link first, while the
+  // virtual calls are still recognizable.
+  if (Index)
+    PM.add(createWholeProgramDevirtPass(Index));
+
   // Add optimizations
   PMB.populateThinLTOPassManager(PM);
 
@@ -230,34 +243,97 @@ public:
       const FunctionImporter::ExportSetTy &ExportList,
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
       const GVSummaryMapTy &DefinedFunctions,
-      const DenseSet<GlobalValue::GUID> &PreservedSymbols) {
+      const DenseSet<GlobalValue::GUID> &PreservedSymbols,
+      const TargetMachineBuilder &TMBuilder, bool DisableCodeGen) {
     if (CachePath.empty())
       return;
 
     // Compute the unique hash for this entry
-    // This is based on the current compiler version, the module itself, the
-    // export list, the hash for every single module in the import list, the
-    // list of ResolvedODR for the module, and the list of preserved symbols.
+    // This is based on the current compiler version, the target and code
+    // generation options, the module itself, the export list, the hash for
+    // every single module in the import list along with the functions imported
+    // from it, the list of ResolvedODR for the module, the linkage of the
+    // globals defined in the module, and the list of preserved symbols.
+    // Unordered containers are sorted before being hashed so that the key only
+    // depends on their content.
 
     SHA1 Hasher;
 
+    auto AddString = [&](StringRef Str) {
+      Hasher.update(Str);
+      // Terminate the string so that consecutive strings can't alias.
+      Hasher.update(ArrayRef<uint8_t>((const uint8_t *)"", 1));
+    };
+    auto AddUint64 = [&](uint64_t I) {
+      uint8_t Data[8];
+      for (unsigned Byte = 0; Byte < 8; ++Byte)
+        Data[Byte] = I >> (Byte * 8);
+      Hasher.update(Data);
+    };
+    auto AddGUIDs = [&](std::vector<GlobalValue::GUID> &GUIDs) {
+      std::sort(GUIDs.begin(), GUIDs.end());
+      AddUint64(GUIDs.size());
+      for (auto GUID : GUIDs)
+        AddUint64(GUID);
+    };
+
     // Start with the compiler revision
     Hasher.update(LLVM_VERSION_STRING);
 #ifdef HAVE_LLVM_REVISION
     Hasher.update(LLVM_REVISION);
 #endif
 
+    // Include the target and the options that affect code generation.
+    AddString(TMBuilder.TheTriple.str());
+    AddString(TMBuilder.MCpu);
+    AddString(TMBuilder.MAttr);
+    AddUint64(TMBuilder.RelocModel.hasValue()
+                  ? 1 + unsigned(*TMBuilder.RelocModel)
+                  : 0);
+    AddUint64(TMBuilder.CGOptLevel);
+    AddUint64(DisableCodeGen);
+    const TargetOptions &Opts = TMBuilder.Options;
+    for (unsigned Flag :
+         {Opts.LessPreciseFPMADOption, Opts.UnsafeFPMath, Opts.NoInfsFPMath,
+          Opts.NoNaNsFPMath, Opts.HonorSignDependentRoundingFPMathOption,
+          Opts.NoZerosInBSS, Opts.GuaranteedTailCallOpt,
+          Opts.StackSymbolOrdering, Opts.EnableFastISel, Opts.UseInitArray,
+          Opts.DisableIntegratedAS, Opts.CompressDebugSections,
+          Opts.RelaxELFRelocations, Opts.FunctionSections, Opts.DataSections,
+          Opts.UniqueSectionNames, Opts.TrapUnreachable, Opts.EmulatedTLS})
+      AddUint64(Flag);
+    AddUint64(Opts.StackAlignmentOverride);
+    AddUint64(unsigned(Opts.FloatABIType));
+    AddUint64(unsigned(Opts.AllowFPOpFusion));
+    AddUint64(unsigned(Opts.JTType));
+    AddUint64(unsigned(Opts.ThreadModel));
+    AddUint64(unsigned(Opts.EABIVersion));
+    AddUint64(unsigned(Opts.DebuggerTuning));
+    AddUint64(unsigned(Opts.ExceptionModel));
+
     // Include the hash for the current module
     auto ModHash = Index.getModuleHash(ModuleID);
     Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
-    for (auto F : ExportList)
-      // The export list can impact the internalization, be conservative here
-      Hasher.update(ArrayRef<uint8_t>((uint8_t *)&F, sizeof(F)));
 
-    // Include the hash for every module we import functions from
-    for (auto &Entry : ImportList) {
-      auto ModHash = Index.getModuleHash(Entry.first());
+    // The export list can impact the internalization, be conservative here
+    std::vector<GlobalValue::GUID> ExportedGUIDs(ExportList.begin(),
+                                                 ExportList.end());
+    AddGUIDs(ExportedGUIDs);
+
+    // Include the hash for every module we import functions from, and the
+    // functions imported from it.
+    std::vector<StringRef> ImportedModules;
+    for (auto &Entry : ImportList)
+      ImportedModules.push_back(Entry.first());
+    std::sort(ImportedModules.begin(), ImportedModules.end());
+    for (StringRef ImportedModule : ImportedModules) {
+      auto ModHash = Index.getModuleHash(ImportedModule);
       Hasher.update(ArrayRef<uint8_t>((uint8_t *)&ModHash[0], sizeof(ModHash)));
+      // The functions to import are kept in a std::map, so they are sorted.
+      const auto &FunctionsToImport = ImportList.find(ImportedModule)->second;
+      AddUint64(FunctionsToImport.size());
+      for (auto &Function : FunctionsToImport)
+        AddUint64(Function.first);
     }
 
     // Include the hash for the resolved ODR.
@@ -268,12 +344,19 @@ public:
                                       sizeof(GlobalValue::LinkageTypes)));
     }
 
+    // Include the linkage of the globals defined in the module, as computed by
+    // the internalization and promotion in the index.
+    for (auto &Entry : DefinedFunctions) {
+      AddUint64(Entry.first);
+      AddUint64(Entry.second->linkage());
+    }
+
     // Include the hash for the preserved symbols.
-    for (auto &Entry : PreservedSymbols) {
+    std::vector<GlobalValue::GUID> PreservedDefs;
+    for (auto &Entry : PreservedSymbols)
       if (DefinedFunctions.count(Entry))
-        Hasher.update(
-            ArrayRef<uint8_t>((const uint8_t *)&Entry, sizeof(GlobalValue::GUID)));
-    }
+        PreservedDefs.push_back(Entry);
+    AddGUIDs(PreservedDefs);
 
     sys::path::append(EntryPath, CachePath, toHex(Hasher.result()));
   }
@@ -369,7 +452,7 @@ ProcessThinLTOModule(Module &TheModule, ModuleSummaryIndex &Index,
     saveTempBitcode(TheModule, SaveTempsDir, count, ".3.imported.bc");
   }
 
-  optimizeModule(TheModule, TM);
+  optimizeModule(TheModule, TM, &Index);
 
   saveTempBitcode(TheModule, SaveTempsDir, count, ".4.opt.bc");
 
@@ -397,7 +480,8 @@ static void resolveWeakForLinkerInIndex(
     const StringMap<FunctionImporter::ExportSetTy> &ExportLists,
     const DenseSet<GlobalValue::GUID> &GUIDPreservedSymbols,
     StringMap<std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>>
-        &ResolvedODR) {
+        &ResolvedODR,
+    unsigned ThreadCount = 1) {
 
   DenseMap<GlobalValue::GUID, const GlobalValueSummary *> PrevailingCopy;
   computePrevailingCopies(Index, PrevailingCopy);
@@ -424,7 +508,7 @@ static void resolveWeakForLinkerInIndex(
   };
 
   thinLTOResolveWeakForLinkerInIndex(Index, isPrevailing, isExported,
-                                     recordNewLinkage);
+                                     recordNewLinkage, ThreadCount);
 }
 
 // Initialize the TargetMachine builder for a given Triple
@@ -517,6 +601,9 @@ std::unique_ptr<ModuleSummaryIndex> ThinLTOCodeGenerator::linkCombinedIndex() {
       CombinedIndex = std::move(Index);
     }
   }
+  // Resolve the virtual calls that can be devirtualized across modules.
+  if (CombinedIndex)
+    runWholeProgramDevirtOnIndex(*CombinedIndex);
   return CombinedIndex;
 }
 
@@ -559,18 +646,15 @@ void ThinLTOCodeGenerator::promote(Module &TheModule,
 void ThinLTOCodeGenerator::crossModuleImport(Module &TheModule,
                                              ModuleSummaryIndex &Index) {
   auto ModuleMap = generateModuleMap(Modules);
-  auto ModuleCount = Index.modulePaths().size();
 
-  // Collect for each module the list of function it defines (GUID -> Summary).
-  StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries(ModuleCount);
-  Index.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
-
-  // Generate import/export list
-  StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
-  StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
-  auto &ImportList = ImportLists[TheModule.getModuleIdentifier()];
+  // The imports of a module do not depend on what the other modules import,
+  // so only the summaries reachable from this one need to be looked at.
+  GVSummaryMapTy DefinedGVSummaries;
+  Index.collectDefinedGVSummariesForModule(TheModule.getModuleIdentifier(),
+                                           DefinedGVSummaries);
+  FunctionImporter::ImportMapTy ImportList;
+  ComputeCrossModuleImportForModule(TheModule.getModuleIdentifier(),
+                                    DefinedGVSummaries, Index, ImportList);
 
   crossImportIntoModule(TheModule, Index, ModuleMap, ImportList);
 }
@@ -666,11 +750,12 @@ void ThinLTOCodeGenerator::internalize(Module &TheModule,
 /**
  * Perform post-importing ThinLTO optimizations.
  */
-void ThinLTOCodeGenerator::optimize(Module &TheModule) {
+void ThinLTOCodeGenerator::optimize(Module &TheModule,
+                                    const ModuleSummaryIndex *Index) {
   initTMBuilder(TMBuilder, Triple(TheModule.getTargetTriple()));
 
   // Optimize now
-  optimizeModule(TheModule, *TMBuilder.create());
+  optimizeModule(TheModule, *TMBuilder.create(), Index);
 }
 
 /**
@@ -706,7 +791,12 @@ void ThinLTOCodeGenerator::run() {
   }
 
   // Sequential linking phase
-  auto Index = linkCombinedIndex();
+  std::unique_ptr<ModuleSummaryIndex> Index;
+  {
+    NamedRegionTimer T("Link combined index", ThinLinkGroupName,
+                       TimePassesIsEnabled);
+    Index = linkCombinedIndex();
+  }
 
   // Save temps: index.
   if (!SaveTempsDir.empty()) {
@@ -735,8 +825,12 @@ void ThinLTOCodeGenerator::run() {
   // combined index.
   StringMap<FunctionImporter::ImportMapTy> ImportLists(ModuleCount);
   StringMap<FunctionImporter::ExportSetTy> ExportLists(ModuleCount);
-  ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
-                           ExportLists);
+  {
+    NamedRegionTimer T("Compute imports", ThinLinkGroupName,
+                       TimePassesIsEnabled);
+    ComputeCrossModuleImport(*Index, ModuleToDefinedGVSummaries, ImportLists,
+                             ExportLists, ThreadCount);
+  }
 
   // Convert the preserved symbols set from string to GUID, this is needed for
   // computing the caching hash and the internalization.
@@ -751,8 +845,12 @@ void ThinLTOCodeGenerator::run() {
 
   // Resolve LinkOnce/Weak symbols, this has to be computed early because it
   // impacts the caching.
-  resolveWeakForLinkerInIndex(*Index, ExportLists, GUIDPreservedSymbols,
-                              ResolvedODR);
+  {
+    NamedRegionTimer T("Resolve weak symbols", ThinLinkGroupName,
+                       TimePassesIsEnabled);
+    resolveWeakForLinkerInIndex(*Index, ExportLists, GUIDPreservedSymbols,
+                                ResolvedODR, ThreadCount);
+  }
 
   auto isExported = [&](StringRef ModuleIdentifier, GlobalValue::GUID GUID) {
     const auto &ExportList = ExportLists.find(ModuleIdentifier);
@@ -764,7 +862,11 @@ void ThinLTOCodeGenerator::run() {
   // Use global summary-based analysis to identify symbols that can be
   // internalized (because they aren't exported or preserved as per callback).
   // Changes are made in the index, consumed in the ThinLTO backends.
-  thinLTOInternalizeAndPromoteInIndex(*Index, isExported);
+  {
+    NamedRegionTimer T("Internalize and promote", ThinLinkGroupName,
+                       TimePassesIsEnabled);
+    thinLTOInternalizeAndPromoteInIndex(*Index, isExported, ThreadCount);
+  }
 
   // Make sure that every module has an entry in the ExportLists and
   // ResolvedODR maps to enable threaded access to these maps below.
@@ -773,18 +875,37 @@ void ThinLTOCodeGenerator::run() {
     ResolvedODR[DefinedGVSummaries.first()];
   }
 
-  // Compute the ordering we will process the inputs: the rough heuristic here
-  // is to sort them per size so that the largest module get schedule as soon as
-  // possible. This is purely a compile-time optimization.
+  // Compute the ordering we will process the inputs: the backends are sorted
+  // by the number of instructions they will optimize, counting the imports,
+  // so that the most expensive get scheduled as soon as possible, with the
+  // size of the modules to break ties. This is purely a compile-time
+  // optimization.
+  std::vector<uint64_t> Costs(Modules.size());
+  for (unsigned I = 0, E = Modules.size(); I != E; ++I) {
+    auto ModuleIdentifier = Modules[I].getBufferIdentifier();
+    Costs[I] = estimateThinLTOBackendCost(
+        *Index, ModuleToDefinedGVSummaries[ModuleIdentifier],
+        ImportLists[ModuleIdentifier]);
+  }
   std::vector<int> ModulesOrdering;
   ModulesOrdering.resize(Modules.size());
   std::iota(ModulesOrdering.begin(), ModulesOrdering.end(), 0);
-  std::sort(ModulesOrdering.begin(), ModulesOrdering.end(),
-            [&](int LeftIndex, int RightIndex) {
-              auto LSize = Modules[LeftIndex].getBufferSize();
-              auto RSize = Modules[RightIndex].getBufferSize();
-              return LSize > RSize;
-            });
+  std::stable_sort(ModulesOrdering.begin(), ModulesOrdering.end(),
+                   [&](int LeftIndex, int RightIndex) {
+                     if (Costs[LeftIndex] != Costs[RightIndex])
+                       return Costs[LeftIndex] > Costs[RightIndex];
+                     auto LSize = Modules[LeftIndex].getBufferSize();
+                     auto RSize = Modules[RightIndex].getBufferSize();
+                     return LSize > RSize;
+                   });
+  DEBUG({
+    dbgs() << "ThinLTO backend schedule:\n";
+    for (auto IndexCount : ModulesOrdering)
+      dbgs() << "  " << Modules[IndexCount].getBufferIdentifier() << " cost "
+             << Costs[IndexCount] << "\n";
+  });
+
+  auto Trace = ThinLTOBackendTrace::createIfRequested();
 
   // Parallel optimizer + codegen
   {
@@ -792,6 +913,7 @@ void ThinLTOCodeGenerator::run() {
     for (auto IndexCount : ModulesOrdering) {
       auto &ModuleBuffer = Modules[IndexCount];
       Pool.async([&](int count) {
+        auto Start = std::chrono::steady_clock::now();
         auto ModuleIdentifier = ModuleBuffer.getBufferIdentifier();
         auto &ExportList = ExportLists[ModuleIdentifier];
 
@@ -801,9 +923,10 @@ void ThinLTOCodeGenerator::run() {
         ModuleCacheEntry CacheEntry(CacheOptions.Path, *Index, ModuleIdentifier,
                                     ImportLists[ModuleIdentifier], ExportList,
                                     ResolvedODR[ModuleIdentifier],
-                                    DefinedFunctions, GUIDPreservedSymbols);
+                                    DefinedFunctions, GUIDPreservedSymbols,
+                                    TMBuilder, DisableCodeGen);
 
-        {
+        if (!CacheEntry.getEntryPath().empty()) {
           auto ErrOrBuffer = CacheEntry.tryLoadingBuffer();
           DEBUG(dbgs() << "Cache " << (ErrOrBuffer ? "hit" : "miss") << " '"
                        << CacheEntry.getEntryPath() << "' for buffer " << count
@@ -811,9 +934,18 @@ void ThinLTOCodeGenerator::run() {
 
           if (ErrOrBuffer) {
             // Cache Hit!
+            ++NumCacheHits;
+            if (CacheOptions.UseIndex)
+              CachePruning::recordAccess(
+                  CacheOptions.Path,
+                  sys::path::filename(CacheEntry.getEntryPath()),
+                  (*ErrOrBuffer)->getBufferSize());
             ProducedBinaries[count] = std::move(ErrOrBuffer.get());
+            if (Trace)
+              Trace->addBackend(ModuleIdentifier, Costs[count], Start);
             return;
           }
+          ++NumCacheMisses;
         }
 
         LLVMContext Context;
@@ -835,15 +967,27 @@ void ThinLTOCodeGenerator::run() {
             DisableCodeGen, SaveTempsDir, count);
 
         OutputBuffer = CacheEntry.write(std::move(OutputBuffer));
+        if (CacheOptions.UseIndex && !CacheEntry.getEntryPath().empty())
+          CachePruning::recordAccess(
+              CacheOptions.Path, sys::path::filename(CacheEntry.getEntryPath()),
+              OutputBuffer->getBufferSize());
         ProducedBinaries[count] = std::move(OutputBuffer);
+        if (Trace)
+          Trace->addBackend(ModuleIdentifier, Costs[count], Start);
       }, IndexCount);
     }
   }
 
+  if (Trace)
+    if (std::error_code EC = Trace->write())
+      report_fatal_error("Failed to write the ThinLTO backend trace: " +
+                         EC.message());
+
   CachePruning(CacheOptions.Path)
       .setPruningInterval(CacheOptions.PruningInterval)
       .setEntryExpiration(CacheOptions.Expiration)
       .setMaxSize(CacheOptions.MaxPercentageOfAvailableSpace)
+      .setUseIndex(CacheOptions.UseIndex)
       .prune();
 
   // If statistics were requested, print them out now.
@@ -9,6 +9,7 @@
 
 #include "llvm/Linker/IRMover.h"
 #include "LinkDiagnosticInfo.h"
+#include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/Triple.h"
@@ -17,11 +18,19 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/GVMaterializer.h"
 #include "llvm/IR/TypeFinder.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include <utility>
 using namespace llvm;
 
+namespace llvm {
+extern bool TimePassesIsEnabled;
+}
+
+static const char *const TimeLinkingGroupName = "IR Linker";
+
 //===----------------------------------------------------------------------===//
 // TypeMap implementation.
 //===----------------------------------------------------------------------===//
@@ -336,6 +345,373 @@ LinkDiagnosticInfo::LinkDiagnosticInfo(DiagnosticSeverity Severity,
     : DiagnosticInfo(DK_Linker, Severity), Msg(Msg) {}
 void LinkDiagnosticInfo::print(DiagnosticPrinter &DP) const { DP << Msg; }
 
+//===----------------------------------------------------------------------===//
+// Merging of uniqued metadata cycles.
+//===----------------------------------------------------------------------===//
+
+static cl::opt<bool> MergeMetadataCycles(
+    "link-merge-metadata-cycles", cl::Hidden,
+    cl::desc("Map cycles of uniqued metadata, such as debug info types "
+             "without an identifier, to identical cycles already linked"));
+
+namespace {
+/// Maps the cycles of uniqued metadata in a source module onto identical
+/// cycles in the destination.
+///
+/// The context uniques acyclic metadata by structure, so a debug info type
+/// that two modules share is one node. That does not work for cycles, such
+/// as the type of a struct that points to itself: every module that is
+/// loaded builds its own copy, and the value mapper keeps the copies apart.
+/// This finds the strongly connected components of uniqued nodes in the
+/// source, hashes them by structure rather than by node identity, and seeds
+/// the value map with an identical component of the destination if there is
+/// one. The operands outside of a component are compared by what the value
+/// mapper will map them to, so components are found in post-order.
+class MetadataCycleMerger {
+  ValueToValueMapTy &VM;
+  IRMover::MetadataCycleMapT &Cycles;
+
+  /// Whether the components found are in the destination, which only needs
+  /// them to be recorded.
+  bool InDestination;
+
+  /// Tarjan's algorithm, over uniqued nodes other than DILocations.
+  DenseMap<const MDNode *, unsigned> Index;
+  SmallPtrSet<const MDNode *, 16> OnStack;
+  SmallVector<const MDNode *, 16> Stack;
+
+  /// Nodes outside of the graph (distinct nodes and DILocations) whose
+  /// operands still have to be looked at.
+  SmallVector<const MDNode *, 16> Roots;
+  SmallPtrSet<const MDNode *, 32> SeenRoots;
+
+  /// The nodes that will be mapped to something else than themselves, with
+  /// what they will be mapped to if that is known already.
+  DenseMap<const MDNode *, Metadata *> Images;
+  SmallPtrSet<const MDNode *, 16> UnknownImages;
+
+  /// Components of the source that were not merged, to be recorded once the
+  /// value mapper has mapped them.
+  std::vector<std::pair<unsigned, const MDNode *>> NewCycles;
+
+  static bool isInGraph(const MDNode &N) {
+    return N.isUniqued() && !isa<DILocation>(N);
+  }
+
+  void addRoot(const Metadata *MD) {
+    if (auto *N = dyn_cast_or_null<MDNode>(MD))
+      if (SeenRoots.insert(N).second)
+        Roots.push_back(N);
+  }
+
+  void findComponents();
+  void visit(const MDNode &Root);
+  void addComponent(ArrayRef<const MDNode *> Component);
+  bool getImage(const Metadata *MD, Metadata *&Image);
+  bool matches(ArrayRef<const MDNode *> Component,
+               const DenseMap<const MDNode *, unsigned> &Positions,
+               const MDNode &Anchor, MDNode &Candidate,
+               SmallDenseMap<const MDNode *, MDNode *, 16> &Mapping);
+
+public:
+  MetadataCycleMerger(ValueToValueMapTy &VM,
+                      IRMover::MetadataCycleMapT &Cycles, bool InDestination)
+      : VM(VM), Cycles(Cycles), InDestination(InDestination) {}
+
+  /// Handle the components reachable from the named metadata of \p M, and
+  /// from its functions if \p WithFunctions.
+  void addModule(const Module &M, bool WithFunctions);
+
+  /// Handle the components reachable from the body of \p F.
+  void addFunction(const Function &F);
+
+  /// Record the components of the source that got linked without being
+  /// merged, so that later modules can be merged with them.
+  void recordNewCycles();
+};
+} // end anonymous namespace
+
+void MetadataCycleMerger::addModule(const Module &M, bool WithFunctions) {
+  for (const NamedMDNode &NMD : M.named_metadata())
+    for (const MDNode *Op : NMD.operands())
+      addRoot(Op);
+  findComponents();
+  if (WithFunctions)
+    for (const Function &F : M)
+      addFunction(F);
+}
+
+void MetadataCycleMerger::addFunction(const Function &F) {
+  SmallVector<std::pair<unsigned, MDNode *>, 8> MDs;
+  F.getAllMetadata(MDs);
+  for (const auto &MD : MDs)
+    addRoot(MD.second);
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB) {
+      I.getAllMetadata(MDs);
+      for (const auto &MD : MDs)
+        addRoot(MD.second);
+      for (const Use &Op : I.operands())
+        if (auto *MAV = dyn_cast<MetadataAsValue>(Op))
+          addRoot(MAV->getMetadata());
+    }
+  findComponents();
+}
+
+void MetadataCycleMerger::findComponents() {
+  while (!Roots.empty()) {
+    const MDNode *N = Roots.pop_back_val();
+    if (!isInGraph(*N)) {
+      for (const Metadata *Op : N->operands())
+        addRoot(Op);
+      continue;
+    }
+    if (!Index.count(N))
+      visit(*N);
+  }
+}
+
+void MetadataCycleMerger::visit(const MDNode &Root) {
+  struct Frame {
+    const MDNode *N;
+    unsigned NextOp;
+    unsigned LowLink;
+  };
+  SmallVector<Frame, 16> Frames;
+  auto Push = [&](const MDNode *N) {
+    unsigned I = Index.size();
+    Index[N] = I;
+    Stack.push_back(N);
+    OnStack.insert(N);
+    Frames.push_back({N, 0, I});
+  };
+
+  Push(&Root);
+  while (!Frames.empty()) {
+    Frame &F = Frames.back();
+    if (F.NextOp != F.N->getNumOperands()) {
+      auto *Op = dyn_cast_or_null<MDNode>(F.N->getOperand(F.NextOp++));
+      if (!Op)
+        continue;
+      if (!isInGraph(*Op)) {
+        addRoot(Op);
+        continue;
+      }
+      auto I = Index.find(Op);
+      if (I == Index.end())
+        Push(Op);
+      else if (OnStack.count(Op))
+        F.LowLink = std::min(F.LowLink, I->second);
+      continue;
+    }
+
+    const MDNode *N = F.N;
+    unsigned LowLink = F.LowLink;
+    Frames.pop_back();
+    if (!Frames.empty())
+      Frames.back().LowLink = std::min(Frames.back().LowLink, LowLink);
+    if (LowLink != Index[N])
+      continue;
+
+    // N is the first node of a component, which is now complete.
+    auto First = std::find(Stack.begin(), Stack.end(), N);
+    SmallVector<const MDNode *, 8> Component(First, Stack.end());
+    Stack.erase(First, Stack.end());
+    for (const MDNode *C : Component)
+      OnStack.erase(C);
+    addComponent(Component);
+  }
+}
+
+/// Get what \p MD is going to be mapped to, or return false if that cannot
+/// be known yet.
+bool MetadataCycleMerger::getImage(const Metadata *MD, Metadata *&Image) {
+  Image = const_cast<Metadata *>(MD);
+  if (!MD || isa<MDString>(MD))
+    return true;
+  if (Optional<Metadata *> Mapped = VM.getMappedMD(MD)) {
+    Image = *Mapped;
+    return true;
+  }
+  if (auto *C = dyn_cast<ConstantAsMetadata>(MD))
+    return isa<ConstantInt>(C->getValue()) || isa<ConstantFP>(C->getValue());
+  auto *N = dyn_cast<MDNode>(MD);
+  if (!N || isa<DILocation>(N))
+    return false;
+  // The IRLinker moves distinct nodes.
+  if (N->isDistinct())
+    return true;
+  if (UnknownImages.count(N))
+    return false;
+  auto I = Images.find(N);
+  if (I != Images.end())
+    Image = I->second;
+  return true;
+}
+
+void MetadataCycleMerger::addComponent(ArrayRef<const MDNode *> Component) {
+  if (InDestination && Component.size() == 1)
+    return;
+
+  // Self references are never uniqued, so a component of one node is not a
+  // cycle. The value mapper rebuilds it if an operand changes, which finds
+  // the node that is already there.
+  if (Component.size() == 1) {
+    const MDNode *N = Component.front();
+    bool Changed = false;
+    SmallVector<Metadata *, 8> Ops;
+    for (const Metadata *Op : N->operands()) {
+      Metadata *Image;
+      if (!getImage(Op, Image)) {
+        UnknownImages.insert(N);
+        return;
+      }
+      Changed |= Image != Op;
+      Ops.push_back(Image);
+    }
+    if (!Changed)
+      return;
+    TempMDNode Copy = N->clone();
+    for (unsigned I = 0, E = Ops.size(); I != E; ++I)
+      Copy->replaceOperandWith(I, Ops[I]);
+    Images[N] = MDNode::replaceWithUniqued(std::move(Copy));
+    return;
+  }
+
+  // Hash every node by its kind and its operands, with the operands in the
+  // component standing for the hash of the node they are. A few rounds make
+  // the hashes of the nodes differ by where they are in the component.
+  DenseMap<const MDNode *, unsigned> Positions;
+  for (unsigned I = 0, E = Component.size(); I != E; ++I)
+    Positions[Component[I]] = I;
+  SmallVector<hash_code, 8> Hashes;
+  bool Changed = false;
+  for (const MDNode *N : Component) {
+    hash_code Hash = hash_combine(N->getMetadataID(), N->getNumOperands());
+    for (const Metadata *Op : N->operands()) {
+      if (Positions.count(cast_or_null<MDNode>(Op))) {
+        Hash = hash_combine(Hash, 1);
+        continue;
+      }
+      Metadata *Image;
+      if (!getImage(Op, Image)) {
+        UnknownImages.insert(Component.begin(), Component.end());
+        return;
+      }
+      Changed |= Image != Op;
+      Hash = hash_combine(Hash, Image);
+    }
+    Hashes.push_back(Hash);
+  }
+  for (unsigned Round = 0; Round != 3; ++Round) {
+    SmallVector<hash_code, 8> NextHashes;
+    for (const MDNode *N : Component) {
+      hash_code Hash = Hashes[Positions[N]];
+      for (const Metadata *Op : N->operands()) {
+        auto I = Positions.find(cast_or_null<MDNode>(Op));
+        if (I != Positions.end())
+          Hash = hash_combine(Hash, Hashes[I->second]);
+      }
+      NextHashes.push_back(Hash);
+    }
+    Hashes = std::move(NextHashes);
+  }
+
+  // Anchor the component at the node with the smallest hash that no other
+  // node of the component has, so that identical components agree on it.
+  SmallDenseMap<size_t, unsigned, 8> HashCounts;
+  for (hash_code Hash : Hashes)
+    ++HashCounts[Hash];
+  const MDNode *Anchor = nullptr;
+  size_t AnchorHash = 0;
+  for (unsigned I = 0, E = Component.size(); I != E; ++I)
+    if (HashCounts[Hashes[I]] == 1 && (!Anchor || size_t(Hashes[I]) < AnchorHash)) {
+      Anchor = Component[I];
+      AnchorHash = Hashes[I];
+    }
+  if (!Anchor) {
+    UnknownImages.insert(Component.begin(), Component.end());
+    return;
+  }
+  unsigned Hash = hash_combine(Component.size(), AnchorHash);
+
+  if (InDestination) {
+    Cycles[Hash].emplace_back(const_cast<MDNode *>(Anchor));
+    return;
+  }
+
+  auto I = Cycles.find(Hash);
+  if (I != Cycles.end())
+    for (TrackingMDRef &Candidate : I->second) {
+      auto *CandidateN = cast_or_null<MDNode>(Candidate.get());
+      SmallDenseMap<const MDNode *, MDNode *, 16> Mapping;
+      if (!CandidateN ||
+          !matches(Component, Positions, *Anchor, *CandidateN, Mapping))
+        continue;
+      for (const auto &M : Mapping)
+        VM.MD()[M.first].reset(M.second);
+      return;
+    }
+
+  // The component maps to itself if nothing it points to changes. Otherwise
+  // the value mapper builds a new copy, which can be recorded afterwards.
+  NewCycles.push_back(std::make_pair(Hash, Anchor));
+  if (Changed)
+    UnknownImages.insert(Component.begin(), Component.end());
+}
+
+/// Check whether \p Component is identical to the component of the
+/// destination that \p Candidate anchors, and compute the mapping if so.
+bool MetadataCycleMerger::matches(
+    ArrayRef<const MDNode *> Component,
+    const DenseMap<const MDNode *, unsigned> &Positions, const MDNode &Anchor,
+    MDNode &Candidate, SmallDenseMap<const MDNode *, MDNode *, 16> &Mapping) {
+  SmallVector<std::pair<const MDNode *, MDNode *>, 16> Worklist;
+  Mapping[&Anchor] = &Candidate;
+  Worklist.push_back(std::make_pair(&Anchor, &Candidate));
+  while (!Worklist.empty()) {
+    const MDNode *N = Worklist.back().first;
+    MDNode *DstN = Worklist.back().second;
+    Worklist.pop_back();
+    if (!DstN->isUniqued() || N->getMetadataID() != DstN->getMetadataID() ||
+        N->getNumOperands() != DstN->getNumOperands())
+      return false;
+
+    for (unsigned I = 0, E = N->getNumOperands(); I != E; ++I) {
+      const Metadata *Op = N->getOperand(I);
+      Metadata *DstOp = DstN->getOperand(I);
+      auto *OpN = dyn_cast_or_null<MDNode>(Op);
+      if (!OpN || !Positions.count(OpN)) {
+        Metadata *Image;
+        if (!getImage(Op, Image) || Image != DstOp)
+          return false;
+        continue;
+      }
+      auto *DstOpN = dyn_cast_or_null<MDNode>(DstOp);
+      if (!DstOpN)
+        return false;
+      auto Inserted = Mapping.insert(std::make_pair(OpN, DstOpN));
+      if (Inserted.second)
+        Worklist.push_back(std::make_pair(OpN, DstOpN));
+      else if (Inserted.first->second != DstOpN)
+        return false;
+    }
+
+    // The operands agree, so compare the rest.
+    if (!N->isEqualIgnoringOperands(*DstN))
+      return false;
+  }
+  return Mapping.size() == Component.size();
+}
+
+void MetadataCycleMerger::recordNewCycles() {
+  for (const auto &Cycle : NewCycles)
+    if (Optional<Metadata *> Mapped = VM.getMappedMD(Cycle.second))
+      if (auto *N = dyn_cast_or_null<MDNode>(*Mapped))
+        Cycles[Cycle.first].emplace_back(N);
+  NewCycles.clear();
+}
+
 //===----------------------------------------------------------------------===//
 // IRLinker implementation.
 //===----------------------------------------------------------------------===//
@@ -381,6 +757,13 @@ class IRLinker {
   /// A metadata map that's shared between IRLinker instances.
   MDMapT &SharedMDs;
 
+  /// Where the elements of appending globals go while the IRMover is in a
+  /// batch, or null.
+  IRMover::AppendingPiecesT *AppendingPieces;
+
+  /// Maps cycles of uniqued metadata onto the composite's, or null.
+  std::unique_ptr<MetadataCycleMerger> CycleMerger;
+
   /// Mapping of values from what they used to be in Src, to what they are now
   /// in DstM.  ValueToValueMapTy is a ValueMap, which involves some overhead
   /// due to the use of Value handles which the Linker doesn't actually need,
@@ -481,15 +864,20 @@ public:
   IRLinker(Module &DstM, MDMapT &SharedMDs,
            IRMover::IdentifiedStructTypeSet &Set, std::unique_ptr<Module> SrcM,
            ArrayRef<GlobalValue *> ValuesToLink,
-           std::function<void(GlobalValue &, IRMover::ValueAdder)> AddLazyFor)
+           std::function<void(GlobalValue &, IRMover::ValueAdder)> AddLazyFor,
+           IRMover::AppendingPiecesT *AppendingPieces,
+           IRMover::MetadataCycleMapT *MetadataCycles)
       : DstM(DstM), SrcM(std::move(SrcM)), AddLazyFor(std::move(AddLazyFor)),
         TypeMap(Set), GValMaterializer(*this), LValMaterializer(*this),
-        SharedMDs(SharedMDs),
+        SharedMDs(SharedMDs), AppendingPieces(AppendingPieces),
         Mapper(ValueMap, RF_MoveDistinctMDs | RF_IgnoreMissingLocals, &TypeMap,
                &GValMaterializer),
         AliasMCID(Mapper.registerAlternateMappingContext(AliasValueMap,
                                                          &LValMaterializer)) {
     ValueMap.getMDMap() = std::move(SharedMDs);
+    if (MetadataCycles)
+      CycleMerger.reset(new MetadataCycleMerger(ValueMap, *MetadataCycles,
+                                                /*InDestination=*/false));
     for (GlobalValue *GV : ValuesToLink)
       maybeAdd(GV);
   }
@@ -766,6 +1154,15 @@ IRLinker::linkAppendingVarProto(GlobalVariable *DstGV,
     EltTy = StructType::get(SrcGV->getContext(), Tys, false);
   }
 
+  // In a batch, the elements are collected in a piece of their own, which
+  // has to agree with the ones collected before.
+  std::vector<GlobalVariable *> *Pieces = nullptr;
+  if (AppendingPieces) {
+    Pieces = &(*AppendingPieces)[SrcGV->getName()];
+    if (!DstGV && !Pieces->empty())
+      DstGV = Pieces->front();
+  }
+
   uint64_t DstNumElements = 0;
   if (DstGV) {
     ArrayType *DstTy = cast<ArrayType>(DstGV->getValueType());
@@ -815,6 +1212,19 @@ IRLinker::linkAppendingVarProto(GlobalVariable *DstGV,
                          return !shouldLink(DGV, *Key);
                        }),
         SrcElements.end());
+
+  if (Pieces) {
+    GlobalVariable *Piece = new GlobalVariable(
+        DstM, ArrayType::get(EltTy, SrcElements.size()), SrcGV->isConstant(),
+        SrcGV->getLinkage(), /*init*/ nullptr, /*name*/ "", nullptr,
+        SrcGV->getThreadLocalMode(), SrcGV->getType()->getAddressSpace());
+    Piece->copyAttributesFrom(SrcGV);
+    Pieces->push_back(Piece);
+    Mapper.scheduleMapAppendingVariable(*Piece, nullptr, IsOldStructor,
+                                        SrcElements);
+    return ConstantExpr::getBitCast(Piece, TypeMap.get(SrcGV->getType()));
+  }
+
   uint64_t NewSize = DstNumElements + SrcElements.size();
   ArrayType *NewType = ArrayType::get(EltTy, NewSize);
 
@@ -954,6 +1364,9 @@ Error IRLinker::linkFunctionBody(Function &Dst, Function &Src) {
   if (std::error_code EC = Src.materialize())
     return errorCodeToError(EC);
 
+  if (CycleMerger)
+    CycleMerger->addFunction(Src);
+
   // Link in the operands without remapping.
   if (Src.hasPrefixData())
     Dst.setPrefixData(Src.getPrefixData());
@@ -1223,22 +1636,36 @@ Error IRLinker::run() {
   }
 
   // Loop over all of the linked values to compute type mappings.
-  computeTypeMapping();
-
-  std::reverse(Worklist.begin(), Worklist.end());
-  while (!Worklist.empty()) {
-    GlobalValue *GV = Worklist.back();
-    Worklist.pop_back();
+  {
+    NamedRegionTimer T("Type mapping", TimeLinkingGroupName,
+                       TimePassesIsEnabled);
+    computeTypeMapping();
+  }
 
-    // Already mapped.
-    if (ValueMap.find(GV) != ValueMap.end() ||
-        AliasValueMap.find(GV) != AliasValueMap.end())
-      continue;
+  if (CycleMerger) {
+    NamedRegionTimer T("Metadata cycles", TimeLinkingGroupName,
+                       TimePassesIsEnabled);
+    CycleMerger->addModule(*SrcM, /*WithFunctions=*/false);
+  }
 
-    assert(!GV->isDeclaration());
-    Mapper.mapValue(*GV);
-    if (FoundError)
-      return std::move(*FoundError);
+  {
+    NamedRegionTimer T("Global values", TimeLinkingGroupName,
+                       TimePassesIsEnabled);
+    std::reverse(Worklist.begin(), Worklist.end());
+    while (!Worklist.empty()) {
+      GlobalValue *GV = Worklist.back();
+      Worklist.pop_back();
+
+      // Already mapped.
+      if (ValueMap.find(GV) != ValueMap.end() ||
+          AliasValueMap.find(GV) != AliasValueMap.end())
+        continue;
+
+      assert(!GV->isDeclaration());
+      Mapper.mapValue(*GV);
+      if (FoundError)
+        return std::move(*FoundError);
+    }
   }
 
   // Note that we are done linking global value bodies. This prevents
@@ -1249,7 +1676,10 @@ Error IRLinker::run() {
   // Remap all of the named MDNodes in Src into the DstM module. We do this
   // after linking GlobalValues so that MDNodes that reference GlobalValues
   // are properly remapped.
+  NamedRegionTimer T("Metadata", TimeLinkingGroupName, TimePassesIsEnabled);
   linkNamedMDNodes();
+  if (CycleMerger)
+    CycleMerger->recordNewCycles();
 
   // Merge the module flags into the DstM module.
   return linkModuleFlagsMetadata();
@@ -1359,9 +1789,84 @@ IRMover::IRMover(Module &M) : Composite(M) {
 Error IRMover::move(
     std::unique_ptr<Module> Src, ArrayRef<GlobalValue *> ValuesToLink,
     std::function<void(GlobalValue &, ValueAdder Add)> AddLazyFor) {
+  if (MergeMetadataCycles && !FoundCompositeCycles) {
+    NamedRegionTimer T("Metadata cycles", TimeLinkingGroupName,
+                       TimePassesIsEnabled);
+    ValueToValueMapTy Identity;
+    MetadataCycleMerger(Identity, MetadataCycles, /*InDestination=*/true)
+        .addModule(Composite, /*WithFunctions=*/true);
+    FoundCompositeCycles = true;
+  }
+
   IRLinker TheIRLinker(Composite, SharedMDs, IdentifiedStructTypes,
-                       std::move(Src), ValuesToLink, AddLazyFor);
+                       std::move(Src), ValuesToLink, AddLazyFor,
+                       InBatch ? &AppendingPieces : nullptr,
+                       MergeMetadataCycles ? &MetadataCycles : nullptr);
   Error E = TheIRLinker.run();
+
+  // Dropping dead constant arrays looks at every constant array in the
+  // context, so a batch only does it when the number of moves doubles.
+  if (InBatch) {
+    if (++NumBatchMoves != NextBatchCleanup)
+      return E;
+    NextBatchCleanup *= 2;
+  }
+  NamedRegionTimer T("Constant cleanup", TimeLinkingGroupName,
+                     TimePassesIsEnabled);
   Composite.dropTriviallyDeadConstantArrays();
   return E;
 }
+
+void IRMover::startBatch() {
+  assert(!InBatch && "Already in a batch");
+  InBatch = true;
+  NumBatchMoves = 0;
+  NextBatchCleanup = 1;
+}
+
+void IRMover::finishBatch() {
+  assert(InBatch && "Not in a batch");
+  InBatch = false;
+
+  NamedRegionTimer T("Appending globals", TimeLinkingGroupName,
+                     TimePassesIsEnabled);
+  for (auto &Entry : AppendingPieces) {
+    std::vector<GlobalVariable *> &Pieces = Entry.second;
+    if (Pieces.empty())
+      continue;
+
+    // Concatenate the elements the way moving the modules one at a time
+    // would have, and put the result where the first of them was.
+    GlobalVariable *DstGV = Composite.getNamedGlobal(Entry.getKey());
+    GlobalVariable *First = DstGV ? DstGV : Pieces.front();
+    SmallVector<Constant *, 16> Elements;
+    if (DstGV)
+      getArrayElements(DstGV->getInitializer(), Elements);
+    for (GlobalVariable *Piece : Pieces)
+      if (Piece->hasInitializer())
+        getArrayElements(Piece->getInitializer(), Elements);
+
+    GlobalVariable *Last = Pieces.back();
+    ArrayType *NewType = ArrayType::get(
+        cast<ArrayType>(Last->getValueType())->getElementType(),
+        Elements.size());
+    GlobalVariable *NG = new GlobalVariable(
+        Composite, NewType, Last->isConstant(), Last->getLinkage(),
+        ConstantArray::get(NewType, Elements), /*name*/ "", First,
+        Last->getThreadLocalMode(), Last->getType()->getAddressSpace());
+    NG->copyAttributesFrom(Last);
+
+    if (DstGV) {
+      DstGV->replaceAllUsesWith(ConstantExpr::getBitCast(NG, DstGV->getType()));
+      DstGV->eraseFromParent();
+    }
+    for (GlobalVariable *Piece : Pieces) {
+      Piece->replaceAllUsesWith(ConstantExpr::getBitCast(NG, Piece->getType()));
+      Piece->eraseFromParent();
+    }
+    NG->setName(Entry.getKey());
+  }
+  AppendingPieces.clear();
+
+  Composite.dropTriviallyDeadConstantArrays();
+}
@@ -509,21 +509,25 @@ bool ModuleLinker::run() {
     ReplacedDstComdats.insert(DstC);
   }
 
-  // Alias have to go first, since we are not able to find their comdats
-  // otherwise.
-  for (auto I = DstM.alias_begin(), E = DstM.alias_end(); I != E;) {
-    GlobalAlias &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
-  }
+  // Looking for the members of replaced comdats means walking the whole
+  // destination module, which only pays off if there are any.
+  if (!ReplacedDstComdats.empty()) {
+    // Alias have to go first, since we are not able to find their comdats
+    // otherwise.
+    for (auto I = DstM.alias_begin(), E = DstM.alias_end(); I != E;) {
+      GlobalAlias &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
 
-  for (auto I = DstM.global_begin(), E = DstM.global_end(); I != E;) {
-    GlobalVariable &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
-  }
+    for (auto I = DstM.global_begin(), E = DstM.global_end(); I != E;) {
+      GlobalVariable &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
 
-  for (auto I = DstM.begin(), E = DstM.end(); I != E;) {
-    Function &GV = *I++;
-    dropReplacedComdat(GV, ReplacedDstComdats);
+    for (auto I = DstM.begin(), E = DstM.end(); I != E;) {
+      Function &GV = *I++;
+      dropReplacedComdat(GV, ReplacedDstComdats);
+    }
   }
 
   for (GlobalVariable &GV : SrcM->globals())
@@ -69,6 +69,64 @@ public:
   ArrayRef<uint32_t> getShndxIndexes() const { return ShndxIndexes; }
 };
 
+/// The stream the ELF object is laid out in before it is written out. Bytes
+/// written to it are kept, while the contents of the regular sections are only
+/// recorded by size, so that they can be written straight from the fragments
+/// to the output once everything else, including the header, is final. That
+/// way the object is written to the output sequentially, without copying the
+/// section contents or seeking back in it.
+class ELFLayoutStream : public raw_pwrite_stream {
+public:
+  struct DeferredSection {
+    const MCSection *Section;
+    /// The offset in the file.
+    uint64_t Offset;
+    uint64_t Size;
+    /// The offset in the laid out data that the contents go in front of.
+    size_t DataOffset;
+  };
+
+private:
+  SmallVector<char, 0> Data;
+  std::vector<DeferredSection> Deferred;
+  uint64_t StartPos;
+  uint64_t Pos;
+
+  void write_impl(const char *Ptr, size_t Size) override {
+    Data.append(Ptr, Ptr + Size);
+    Pos += Size;
+  }
+
+  void pwrite_impl(const char *Ptr, size_t Size, uint64_t Offset) override {
+    uint64_t DataOffset = Offset - StartPos;
+    for (const DeferredSection &D : Deferred) {
+      if (D.Offset >= Offset)
+        break;
+      assert(Offset >= D.Offset + D.Size &&
+             "Cannot patch the contents of a section");
+      DataOffset -= D.Size;
+    }
+    memcpy(Data.data() + DataOffset, Ptr, Size);
+  }
+
+  uint64_t current_pos() const override { return Pos; }
+
+public:
+  /// Create a stream that starts at the offset \p StartPos in the file.
+  explicit ELFLayoutStream(uint64_t StartPos)
+      : raw_pwrite_stream(/*Unbuffered=*/true), StartPos(StartPos),
+        Pos(StartPos) {}
+
+  /// Reserve \p Size bytes for the contents of \p Sec at the current offset.
+  void deferSection(const MCSection &Sec, uint64_t Size) {
+    Deferred.push_back({&Sec, Pos, Size, Data.size()});
+    Pos += Size;
+  }
+
+  StringRef getData() const { return StringRef(Data.data(), Data.size()); }
+  ArrayRef<DeferredSection> getDeferredSections() const { return Deferred; }
+};
+
 class ELFObjectWriter : public MCObjectWriter {
   static bool isFixupKindPCRel(const MCAssembler &Asm, unsigned Kind);
   static uint64_t SymbolValue(const MCSymbol &Sym, const MCAsmLayout &Layout);
@@ -124,6 +182,9 @@ class ELFObjectWriter : public MCObjectWriter {
   std::vector<const MCSectionELF *> SectionTable;
   unsigned addToSectionTable(const MCSectionELF *Sec);
 
+  // The stream the object is laid out in while writeObject is running.
+  ELFLayoutStream *LayoutStream = nullptr;
+
   // TargetObjectWriter wrappers.
   bool is64Bit() const { return TargetObjectWriter->is64Bit(); }
   bool hasRelocationAddend() const {
@@ -231,6 +292,9 @@ public:
   bool isWeak(const MCSymbol &Sym) const override;
 
   void writeObject(MCAssembler &Asm, const MCAsmLayout &Layout) override;
+
+  /// Write the object to the layout stream, deferring the section contents.
+  void layOutObject(MCAssembler &Asm, const MCAsmLayout &Layout);
   void writeSection(const SectionIndexMapTy &SectionIndexMap,
                     uint32_t GroupSymbolIndex, uint64_t Offset, uint64_t Size,
                     const MCSectionELF &Section);
@@ -1031,7 +1095,7 @@ void ELFObjectWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
       DebugCompressionType::DCT_None;
   if (!CompressionEnabled || !SectionName.startswith(".debug_") ||
       SectionName == ".debug_frame") {
-    Asm.writeSectionData(&Section, Layout);
+    LayoutStream->deferSection(Section, Layout.getSectionFileSize(&Section));
     return;
   }
 
@@ -1043,7 +1107,7 @@ void ELFObjectWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
   setStream(OldStream);
 
   SmallVector<char, 128> CompressedContents;
-  zlib::Status Success = zlib::compress(
+  zlib::Status Success = zlib::compressParallel(
       StringRef(UncompressedData.data(), UncompressedData.size()),
       CompressedContents);
   if (Success != zlib::StatusOK) {
@@ -1221,6 +1285,29 @@ void ELFObjectWriter::writeSectionHeader(
 
 void ELFObjectWriter::writeObject(MCAssembler &Asm,
                                   const MCAsmLayout &Layout) {
+  // Lay out the object first and only then write it, along with the section
+  // contents, to the output stream.
+  raw_pwrite_stream &OS = getStream();
+  ELFLayoutStream LayoutOS(OS.tell());
+  LayoutStream = &LayoutOS;
+  setStream(LayoutOS);
+  layOutObject(Asm, Layout);
+  setStream(OS);
+  LayoutStream = nullptr;
+
+  StringRef Data = LayoutOS.getData();
+  size_t DataOffset = 0;
+  for (const ELFLayoutStream::DeferredSection &D :
+       LayoutOS.getDeferredSections()) {
+    OS << Data.slice(DataOffset, D.DataOffset);
+    DataOffset = D.DataOffset;
+    Asm.writeSectionData(D.Section, Layout);
+  }
+  OS << Data.substr(DataOffset);
+}
+
+void ELFObjectWriter::layOutObject(MCAssembler &Asm,
+                                   const MCAsmLayout &Layout) {
   MCContext &Ctx = Asm.getContext();
   MCSectionELF *StrtabSection =
       Ctx.getELFSection(".strtab", ELF::SHT_STRTAB, 0);
@@ -25,11 +25,13 @@
 #include "llvm/MC/MCSectionELF.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MCValue.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <tuple>
 using namespace llvm;
 
@@ -55,9 +57,20 @@ STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionRelaxationPasses,
+          "Number of assembler relaxation passes over a section");
+STATISTIC(RelaxationChecks,
+          "Number of fragments checked for relaxation");
+STATISTIC(SkippedRelaxationChecks,
+          "Number of fragments not checked again for relaxation");
 }
 }
 
+static cl::opt<bool> IncrementalRelaxation(
+    "mc-incremental-relaxation", cl::Hidden, cl::init(true),
+    cl::desc("Only check the relaxable fragments affected by the previous "
+             "relaxation pass again"));
+
 // FIXME FIXME FIXME: There are number of places in this file where we convert
 // what is a 64-bit assembler value used for computation into a value in the
 // object file, which may truncate it. We should detect that truncation where
@@ -654,14 +667,23 @@ void MCAssembler::layout(MCAsmLayout &Layout) {
     Sec->setLayoutOrder(i);
 
     unsigned FragmentIndex = 0;
-    for (MCFragment &Frag : *Sec)
+    std::vector<unsigned> &OffsetDependent = OffsetDependentFragments[Sec];
+    for (MCFragment &Frag : *Sec) {
+      if (Frag.getKind() == MCFragment::FT_Align ||
+          Frag.getKind() == MCFragment::FT_Org)
+        OffsetDependent.push_back(FragmentIndex);
       Frag.setLayoutOrder(FragmentIndex++);
+    }
   }
 
   // Layout until everything fits.
   while (layoutOnce(Layout))
     continue;
 
+  FragmentDeps.clear();
+  ChangedFragments.clear();
+  OffsetDependentFragments.clear();
+
   DEBUG_WITH_TYPE("mc-dump", {
       llvm::errs() << "assembler backend - post-relaxation\n--\n";
       dump(); });
@@ -727,18 +749,98 @@ void MCAssembler::Finish() {
   stats::ObjectBytes += OS.tell() - StartOffset;
 }
 
+/// Extend [First, Last] by the layout orders of the fragments of \p Sec that the
+/// value of \p Expr depends on. Returns false if the value may depend on
+/// anything outside of \p Sec.
+static bool addExprDeps(const MCExpr *Expr, const MCSection *Sec,
+                        unsigned &First, unsigned &Last) {
+  switch (Expr->getKind()) {
+  case MCExpr::Target:
+    return false;
+  case MCExpr::Constant:
+    return true;
+  case MCExpr::Unary:
+    return addExprDeps(cast<MCUnaryExpr>(Expr)->getSubExpr(), Sec, First,
+                       Last);
+  case MCExpr::Binary: {
+    const MCBinaryExpr *BE = cast<MCBinaryExpr>(Expr);
+    return addExprDeps(BE->getLHS(), Sec, First, Last) &&
+           addExprDeps(BE->getRHS(), Sec, First, Last);
+  }
+  case MCExpr::SymbolRef: {
+    const MCSymbol &Sym = cast<MCSymbolRefExpr>(Expr)->getSymbol();
+    if (Sym.isVariable())
+      return false;
+    if (Sym.isUndefined())
+      return true;
+    const MCFragment *F = Sym.getFragment();
+    if (Sym.isAbsolute() || F->getParent() != Sec)
+      return false;
+    First = std::min(First, F->getLayoutOrder());
+    Last = std::max(Last, F->getLayoutOrder());
+    return true;
+  }
+  }
+  llvm_unreachable("Invalid expression kind!");
+}
+
+/// Whether \p Expr is a symbol, optionally plus or minus a constant.
+static bool isSymbolPlusConstant(const MCExpr *Expr) {
+  if (isa<MCSymbolRefExpr>(Expr))
+    return true;
+  const MCBinaryExpr *BE = dyn_cast<MCBinaryExpr>(Expr);
+  if (!BE)
+    return false;
+  if (BE->getOpcode() == MCBinaryExpr::Add &&
+      isa<MCConstantExpr>(BE->getLHS()) && isa<MCSymbolRefExpr>(BE->getRHS()))
+    return true;
+  return (BE->getOpcode() == MCBinaryExpr::Add ||
+          BE->getOpcode() == MCBinaryExpr::Sub) &&
+         isa<MCSymbolRefExpr>(BE->getLHS()) &&
+         isa<MCConstantExpr>(BE->getRHS());
+}
+
 bool MCAssembler::fixupNeedsRelaxation(const MCFixup &Fixup,
                                        const MCRelaxableFragment *DF,
-                                       const MCAsmLayout &Layout) const {
+                                       const MCAsmLayout &Layout,
+                                       RelaxationDeps *Deps) const {
   MCValue Target;
   uint64_t Value;
   bool Resolved = evaluateFixup(Layout, Fixup, DF, Target, Value);
-  return getBackend().fixupNeedsRelaxationAdvanced(Fixup, Resolved, Value, DF,
-                                                   Layout);
+  bool NeedsRelaxation = getBackend().fixupNeedsRelaxationAdvanced(
+      Fixup, Resolved, Value, DF, Layout);
+  if (NeedsRelaxation || !Deps || !Deps->IsSectionLocal)
+    return NeedsRelaxation;
+
+  const MCExpr *Expr = Fixup.getValue();
+  unsigned Flags = Backend.getFixupKindInfo(Fixup.getKind()).Flags;
+  bool IsPCRel = Flags & MCFixupKindInfo::FKF_IsPCRel;
+  bool ShouldAlignPC = Flags & MCFixupKindInfo::FKF_IsAlignedDownTo32Bits;
+  if (!addExprDeps(Expr, DF->getParent(), Deps->First, Deps->Last)) {
+    Deps->IsSectionLocal = false;
+    return false;
+  }
+  unsigned Order = DF->getLayoutOrder();
+  Deps->First = std::min(Deps->First, Order);
+  Deps->Last = std::max(Deps->Last, Order);
+  // The distance from a PC-relative fixup to its target only depends on the
+  // fragments in between. Any other value may depend on the offsets of the
+  // fragments, so it depends on everything from the start of the section.
+  if (!IsPCRel || ShouldAlignPC || !isSymbolPlusConstant(Expr))
+    Deps->First = 0;
+  return false;
 }
 
 bool MCAssembler::fragmentNeedsRelaxation(const MCRelaxableFragment *F,
-                                          const MCAsmLayout &Layout) const {
+                                          const MCAsmLayout &Layout,
+                                          RelaxationDeps *Deps) const {
+  if (Deps) {
+    Deps->First = ~0U;
+    Deps->Last = 0;
+    Deps->HasOffsetDependentFragment = false;
+    Deps->IsSectionLocal = true;
+  }
+
   // If this inst doesn't ever need relaxation, ignore it. This occurs when we
   // are intentionally pushing out inst fragments, or because we relaxed a
   // previous instruction to one that doesn't need relaxation.
@@ -746,18 +848,63 @@ bool MCAssembler::fragmentNeedsRelaxation(const MCRelaxableFragment *F,
     return false;
 
   for (const MCFixup &Fixup : F->getFixups())
-    if (fixupNeedsRelaxation(Fixup, F, Layout))
+    if (fixupNeedsRelaxation(Fixup, F, Layout, Deps))
       return true;
 
+  if (Deps && Deps->First <= Deps->Last) {
+    auto It = OffsetDependentFragments.find(F->getParent());
+    if (It != OffsetDependentFragments.end()) {
+      auto Pos = std::lower_bound(It->second.begin(), It->second.end(),
+                                  Deps->First);
+      Deps->HasOffsetDependentFragment =
+          Pos != It->second.end() && *Pos <= Deps->Last;
+    }
+  }
   return false;
 }
 
+bool MCAssembler::fragmentNeedsRelaxationCheck(
+    const MCRelaxableFragment &F) const {
+  auto DepsIt = FragmentDeps.find(&F);
+  if (DepsIt == FragmentDeps.end() || !DepsIt->second.IsSectionLocal)
+    return true;
+  const RelaxationDeps &Deps = DepsIt->second;
+  auto ChangedIt = ChangedFragments.find(F.getParent());
+  if (ChangedIt == ChangedFragments.end())
+    return false;
+  const std::vector<unsigned> &Changed = ChangedIt->second;
+  if (Changed.empty() || Changed.front() > Deps.Last)
+    return false;
+
+  // Check again if a fragment in the range changed size.
+  auto Pos = std::lower_bound(Changed.begin(), Changed.end(), Deps.First);
+  if (Pos != Changed.end() && *Pos <= Deps.Last)
+    return true;
+
+  // Otherwise only fragments before the range changed, which moved the range
+  // as a whole. That only matters if it contains a fragment whose size
+  // depends on its offset.
+  return Deps.HasOffsetDependentFragment;
+}
+
 bool MCAssembler::relaxInstruction(MCAsmLayout &Layout,
                                    MCRelaxableFragment &F) {
-  if (!fragmentNeedsRelaxation(&F, Layout))
+  bool Incremental = IncrementalRelaxation && !isBundlingEnabled();
+  if (Incremental && !fragmentNeedsRelaxationCheck(F)) {
+    ++stats::SkippedRelaxationChecks;
+    return false;
+  }
+  ++stats::RelaxationChecks;
+
+  RelaxationDeps Deps;
+  if (!fragmentNeedsRelaxation(&F, Layout, Incremental ? &Deps : nullptr)) {
+    if (Incremental)
+      FragmentDeps[&F] = Deps;
     return false;
+  }
 
   ++stats::RelaxedInstructions;
+  FragmentDeps.erase(&F);
 
   // FIXME-PERF: We could immediately lower out instructions if we can tell
   // they are fully resolved, to avoid retesting on later passes.
@@ -848,12 +995,17 @@ bool MCAssembler::relaxCVDefRange(MCAsmLayout &Layout,
 }
 
 bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
+  ++stats::SectionRelaxationPasses;
+
   // Holds the first fragment which needed relaxing during this layout. It will
   // remain NULL if none were relaxed.
   // When a fragment is relaxed, all the fragments following it should get
   // invalidated because their offset is going to change.
   MCFragment *FirstRelaxedFragment = nullptr;
 
+  // The fragments that changed size in this pass, in layout order.
+  std::vector<unsigned> Changed;
+
   // Attempt to relax all the fragments in the section.
   for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
     // Check if this is a fragment that needs relaxation.
@@ -886,9 +1038,13 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
       RelaxedFrag = relaxCVDefRange(Layout, *cast<MCCVDefRangeFragment>(I));
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = &*I;
+    if (RelaxedFrag) {
+      if (!FirstRelaxedFragment)
+        FirstRelaxedFragment = &*I;
+      Changed.push_back(I->getLayoutOrder());
+    }
   }
+  ChangedFragments[&Sec] = std::move(Changed);
   if (FirstRelaxedFragment) {
     Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
     return true;
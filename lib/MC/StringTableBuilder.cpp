@@ -11,6 +11,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/COFF.h"
 #include "llvm/Support/Endian.h"
+#include "llvm/Support/Parallel.h"
 
 #include <vector>
 
@@ -77,15 +78,79 @@ tailcall:
   }
 }
 
-void StringTableBuilder::finalize() {
-  finalizeStringTable(/*Optimize=*/true);
+namespace {
+struct SortRange {
+  StringPair **Begin;
+  StringPair **End;
+  int Pos;
+};
+}
+
+// Partition [Begin, End) the way multikey_qsort does, until the ranges left
+// have at most MaxSize items. These ranges are in their final order relative
+// to each other and are appended to Ranges to be sorted independently.
+static void splitForParallelSort(StringPair **Begin, StringPair **End, int Pos,
+                                 size_t MaxSize,
+                                 std::vector<SortRange> &Ranges) {
+  while (End - Begin > 1) {
+    if ((size_t)(End - Begin) <= MaxSize) {
+      Ranges.push_back({Begin, End, Pos});
+      return;
+    }
+
+    int Pivot = charTailAt(*Begin, Pos);
+    StringPair **P = Begin;
+    StringPair **Q = End;
+    for (StringPair **R = Begin + 1; R < Q;) {
+      int C = charTailAt(*R, Pos);
+      if (C > Pivot)
+        std::swap(*P++, *R++);
+      else if (C < Pivot)
+        std::swap(*--Q, *R);
+      else
+        R++;
+    }
+
+    splitForParallelSort(Begin, P, Pos, MaxSize, Ranges);
+    // Keep Ranges in order: the middle range goes before [Q, End).
+    if (Pivot != -1)
+      splitForParallelSort(P, Q, Pos + 1, MaxSize, Ranges);
+    Begin = Q;
+  }
+}
+
+// Sort the strings like multikey_qsort, with the parallel algorithms unless
+// NumThreads is 1. The strings are unique, so the order is the same as if they
+// were sorted serially.
+static void parallel_multikey_qsort(StringPair **Begin, StringPair **End,
+                                    unsigned NumThreads) {
+  // Splitting the work is serial; only bother when there is enough of it.
+  const size_t MinParallelSize = 1 << 14;
+  size_t Size = End - Begin;
+  if (NumThreads == 1 || getParallelThreadCount() == 1 ||
+      Size < MinParallelSize) {
+    multikey_qsort(Begin, End, 0);
+    return;
+  }
+
+  std::vector<SortRange> Ranges;
+  splitForParallelSort(Begin, End, 0, std::max(Size / 64, MinParallelSize / 4),
+                       Ranges);
+  parallel_for_each(Ranges.begin(), Ranges.end(), [](const SortRange &R) {
+    multikey_qsort(R.Begin, R.End, R.Pos);
+  });
+}
+
+void StringTableBuilder::finalize(unsigned NumThreads) {
+  finalizeStringTable(/*Optimize=*/true, NumThreads);
 }
 
 void StringTableBuilder::finalizeInOrder() {
-  finalizeStringTable(/*Optimize=*/false);
+  finalizeStringTable(/*Optimize=*/false, 1);
 }
 
-void StringTableBuilder::finalizeStringTable(bool Optimize) {
+void StringTableBuilder::finalizeStringTable(bool Optimize,
+                                             unsigned NumThreads) {
   typedef std::pair<CachedHash<StringRef>, size_t> StringOffsetPair;
   std::vector<StringOffsetPair *> Strings;
   Strings.reserve(StringIndexMap.size());
@@ -96,7 +161,8 @@ void StringTableBuilder::finalizeStringTable(bool Optimize) {
     // If we're optimizing, sort by name. If not, sort by previously assigned
     // offset.
     if (Optimize) {
-      multikey_qsort(&Strings[0], &Strings[0] + Strings.size(), 0);
+      parallel_multikey_qsort(&Strings[0], &Strings[0] + Strings.size(),
+                              NumThreads);
     } else {
       std::sort(Strings.begin(), Strings.end(),
                 [](const StringOffsetPair *LHS, const StringOffsetPair *RHS) {
@@ -610,21 +610,44 @@ uint32_t Archive::getNumberOfSymbols() const {
   return read32le(buf);
 }
 
+const StringMap<Archive::Symbol> &Archive::getSymbolIndex() const {
+  std::call_once(SymbolIndexFlag, [this]() {
+    SymbolIndex.reset(new StringMap<Symbol>(getNumberOfSymbols()));
+    // Keep the first entry for each name, which is what a linear scan of the
+    // symbol table would find.
+    for (const Symbol &Sym : symbols())
+      SymbolIndex->insert(std::make_pair(Sym.getName(), Sym));
+  });
+  return *SymbolIndex;
+}
+
+static Archive::child_iterator getSymbolMember(const Archive &A,
+                                               const Archive::Symbol &Sym) {
+  ErrorOr<Archive::Child> ResultOrErr = Sym.getMember();
+  // FIXME: Should we really eat the error?
+  if (ResultOrErr.getError())
+    return A.child_end();
+  return ResultOrErr.get();
+}
+
 Archive::child_iterator Archive::findSym(StringRef name) const {
-  Archive::symbol_iterator bs = symbol_begin();
-  Archive::symbol_iterator es = symbol_end();
-
-  for (; bs != es; ++bs) {
-    StringRef SymName = bs->getName();
-    if (SymName == name) {
-      ErrorOr<Archive::child_iterator> ResultOrErr = bs->getMember();
-      // FIXME: Should we really eat the error?
-      if (ResultOrErr.getError())
-        return child_end();
-      return ResultOrErr.get();
-    }
+  const StringMap<Symbol> &Index = getSymbolIndex();
+  auto It = Index.find(name);
+  if (It == Index.end())
+    return child_end();
+  return getSymbolMember(*this, It->second);
+}
+
+void Archive::findSyms(ArrayRef<StringRef> Names,
+                       std::vector<child_iterator> &Members) const {
+  const StringMap<Symbol> &Index = getSymbolIndex();
+  Members.clear();
+  Members.reserve(Names.size());
+  for (StringRef Name : Names) {
+    auto It = Index.find(Name);
+    Members.push_back(It == Index.end() ? child_end()
+                                        : getSymbolMember(*this, It->second));
   }
-  return child_end();
 }
 
 bool Archive::hasSymbolTable() const { return !SymbolTable.empty(); }
@@ -13,7 +13,9 @@
 
 #include "llvm/Object/ArchiveWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/ReaderWriter.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Object/Archive.h"
 #include "llvm/Object/ObjectFile.h"
@@ -21,10 +23,13 @@
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/Path.h"
-#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <map>
+#include <thread>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -76,19 +81,20 @@ NewArchiveIterator::getFD(sys::fs::file_status &NewStatus) const {
 }
 
 template <typename T>
-static void printWithSpacePadding(raw_fd_ostream &OS, T Data, unsigned Size,
+static void printWithSpacePadding(raw_ostream &OS, T Data, unsigned Size,
                                   bool MayTruncate = false) {
-  uint64_t OldPos = OS.tell();
-  OS << Data;
-  unsigned SizeSoFar = OS.tell() - OldPos;
-  if (Size > SizeSoFar) {
-    OS.indent(Size - SizeSoFar);
-  } else if (Size < SizeSoFar) {
+  SmallString<32> Buf;
+  raw_svector_ostream BufOS(Buf);
+  BufOS << Data;
+  StringRef Str = BufOS.str();
+  if (Str.size() > Size) {
     assert(MayTruncate && "Data doesn't fit in Size");
     // Some of the data this is used for (like UID) can be larger than the
     // space available in the archive format. Truncate in that case.
-    OS.seek(OldPos + Size);
+    Str = Str.substr(0, Size);
   }
+  OS << Str;
+  OS.indent(Size - Str.size());
 }
 
 static void print32(raw_ostream &Out, object::Archive::Kind Kind,
@@ -99,7 +105,7 @@ static void print32(raw_ostream &Out, object::Archive::Kind Kind,
     support::endian::Writer<support::little>(Out).write(Val);
 }
 
-static void printRestOfMemberHeader(raw_fd_ostream &Out,
+static void printRestOfMemberHeader(raw_ostream &Out,
                                     const sys::TimeValue &ModTime, unsigned UID,
                                     unsigned GID, unsigned Perms,
                                     unsigned Size) {
@@ -111,7 +117,7 @@ static void printRestOfMemberHeader(raw_fd_ostream &Out,
   Out << "`\n";
 }
 
-static void printGNUSmallMemberHeader(raw_fd_ostream &Out, StringRef Name,
+static void printGNUSmallMemberHeader(raw_ostream &Out, StringRef Name,
                                       const sys::TimeValue &ModTime,
                                       unsigned UID, unsigned GID,
                                       unsigned Perms, unsigned Size) {
@@ -119,10 +125,13 @@ static void printGNUSmallMemberHeader(raw_fd_ostream &Out, StringRef Name,
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms, Size);
 }
 
-static void printBSDMemberHeader(raw_fd_ostream &Out, StringRef Name,
-                                 const sys::TimeValue &ModTime, unsigned UID,
-                                 unsigned GID, unsigned Perms, unsigned Size) {
-  uint64_t PosAfterHeader = Out.tell() + 60 + Name.size();
+/// Print the header of a member that starts at the offset \p Pos in the
+/// archive.
+static void printBSDMemberHeader(raw_ostream &Out, uint64_t Pos,
+                                 StringRef Name, const sys::TimeValue &ModTime,
+                                 unsigned UID, unsigned GID, unsigned Perms,
+                                 unsigned Size) {
+  uint64_t PosAfterHeader = Pos + 60 + Name.size();
   // Pad so that even 64 bit object files are aligned.
   unsigned Pad = OffsetToAlignment(PosAfterHeader, 8);
   unsigned NameWithPadding = Name.size() + Pad;
@@ -130,7 +139,6 @@ static void printBSDMemberHeader(raw_fd_ostream &Out, StringRef Name,
   printRestOfMemberHeader(Out, ModTime, UID, GID, Perms,
                           NameWithPadding + Size);
   Out << Name;
-  assert(PosAfterHeader == Out.tell());
   while (Pad--)
     Out.write(uint8_t(0));
 }
@@ -140,13 +148,14 @@ static bool useStringTable(bool Thin, StringRef Name) {
 }
 
 static void
-printMemberHeader(raw_fd_ostream &Out, object::Archive::Kind Kind, bool Thin,
-                  StringRef Name,
+printMemberHeader(raw_ostream &Out, uint64_t Pos, object::Archive::Kind Kind,
+                  bool Thin, StringRef Name,
                   std::vector<unsigned>::iterator &StringMapIndexIter,
                   const sys::TimeValue &ModTime, unsigned UID, unsigned GID,
                   unsigned Perms, unsigned Size) {
   if (Kind == object::Archive::K_BSD)
-    return printBSDMemberHeader(Out, Name, ModTime, UID, GID, Perms, Size);
+    return printBSDMemberHeader(Out, Pos, Name, ModTime, UID, GID, Perms,
+                                Size);
   if (!useStringTable(Thin, Name))
     return printGNUSmallMemberHeader(Out, Name, ModTime, UID, GID, Perms, Size);
   Out << '/';
@@ -177,37 +186,36 @@ static std::string computeRelativePath(StringRef From, StringRef To) {
   return Relative.str();
 }
 
-static void writeStringTable(raw_fd_ostream &Out, StringRef ArcName,
+/// Write the string table member, which starts at the offset \p Pos in the
+/// archive, if any member needs it.
+static void writeStringTable(raw_ostream &Out, uint64_t Pos, StringRef ArcName,
                              ArrayRef<NewArchiveIterator> Members,
                              std::vector<unsigned> &StringMapIndexes,
                              bool Thin) {
-  unsigned StartOffset = 0;
+  std::string Table;
+  raw_string_ostream TableOS(Table);
   for (const NewArchiveIterator &I : Members) {
     StringRef Name = sys::path::filename(I.getName());
     if (!useStringTable(Thin, Name))
       continue;
-    if (StartOffset == 0) {
-      printWithSpacePadding(Out, "//", 58);
-      Out << "`\n";
-      StartOffset = Out.tell();
-    }
-    StringMapIndexes.push_back(Out.tell() - StartOffset);
+    StringMapIndexes.push_back(TableOS.tell());
 
     if (Thin)
-      Out << computeRelativePath(ArcName, I.getName());
+      TableOS << computeRelativePath(ArcName, I.getName());
     else
-      Out << Name;
+      TableOS << Name;
 
-    Out << "/\n";
+    TableOS << "/\n";
   }
-  if (StartOffset == 0)
+  TableOS.flush();
+  if (Table.empty())
     return;
-  if (Out.tell() % 2)
-    Out << '\n';
-  int Pos = Out.tell();
-  Out.seek(StartOffset - 12);
-  printWithSpacePadding(Out, Pos - StartOffset, 10);
-  Out.seek(Pos);
+  if ((Pos + 60 + Table.size()) % 2)
+    Table += '\n';
+
+  printWithSpacePadding(Out, "//", 48);
+  printWithSpacePadding(Out, Table.size(), 10);
+  Out << "`\n" << Table;
 }
 
 static sys::TimeValue now(bool Deterministic) {
@@ -218,89 +226,217 @@ static sys::TimeValue now(bool Deterministic) {
   return TV;
 }
 
-// Returns the offset of the first reference to a member offset.
-static ErrorOr<unsigned>
-writeSymbolTable(raw_fd_ostream &Out, object::Archive::Kind Kind,
-                 ArrayRef<NewArchiveIterator> Members,
-                 ArrayRef<MemoryBufferRef> Buffers,
-                 std::vector<unsigned> &MemberOffsetRefs, bool Deterministic) {
-  unsigned HeaderStartOffset = 0;
-  unsigned BodyStartOffset = 0;
-  SmallString<128> NameBuf;
-  raw_svector_ostream NameOS(NameBuf);
-  LLVMContext Context;
-  for (unsigned MemberNum = 0, N = Members.size(); MemberNum < N; ++MemberNum) {
-    MemoryBufferRef MemberBuffer = Buffers[MemberNum];
-    Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
-        object::SymbolicFile::createSymbolicFile(
-            MemberBuffer, sys::fs::file_magic::unknown, &Context);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
-      continue;
+namespace {
+/// The symbol table entries of an archive member.
+struct MemberSymbols {
+  /// The names of the symbols, each followed by a NUL.
+  std::string Names;
+  unsigned NumSymbols = 0;
+  /// Whether the member is a symbolic file. The symbol table is only written
+  /// if there is one, even if no member defines any symbols.
+  bool IsSymbolic = false;
+};
+}
+
+static std::error_code computeMemberSymbols(MemoryBufferRef MemberBuffer,
+                                            MemberSymbols &Syms) {
+  raw_string_ostream NameOS(Syms.Names);
+  bool IsBitcode = sys::fs::identify_magic(MemberBuffer.getBuffer()) ==
+                   sys::fs::file_magic::bitcode;
+
+  // Bitcode members that carry a symbol table block can be listed without
+  // parsing the module, unless module asm may define further symbols.
+  if (IsBitcode) {
+    ErrorOr<std::unique_ptr<BitcodeSymbolTable>> SymtabOrErr =
+        readBitcodeSymbolTable(MemberBuffer);
+    if (SymtabOrErr && *SymtabOrErr && !(*SymtabOrErr)->HasModuleAsm) {
+      Syms.IsSymbolic = true;
+      for (const BitcodeSymbol &Sym : (*SymtabOrErr)->Symbols) {
+        if (Sym.IsFormatSpecific || Sym.IsUndefined ||
+            GlobalValue::isLocalLinkage(Sym.Linkage))
+          continue;
+        NameOS << Sym.Name << '\0';
+        ++Syms.NumSymbols;
+      }
+      return std::error_code();
     }
-    object::SymbolicFile &Obj = *ObjOrErr.get();
-
-    if (!HeaderStartOffset) {
-      HeaderStartOffset = Out.tell();
-      if (Kind == object::Archive::K_GNU)
-        printGNUSmallMemberHeader(Out, "", now(Deterministic), 0, 0, 0, 0);
-      else
-        printBSDMemberHeader(Out, "__.SYMDEF", now(Deterministic), 0, 0, 0, 0);
-      BodyStartOffset = Out.tell();
-      print32(Out, Kind, 0); // number of entries or bytes
+  }
+
+  // Only bitcode members need a context to be read.
+  std::unique_ptr<LLVMContext> Context;
+  if (IsBitcode)
+    Context.reset(new LLVMContext);
+  Expected<std::unique_ptr<object::SymbolicFile>> ObjOrErr =
+      object::SymbolicFile::createSymbolicFile(
+          MemberBuffer, sys::fs::file_magic::unknown, Context.get());
+  if (!ObjOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(ObjOrErr.takeError());
+    return std::error_code();
+  }
+  object::SymbolicFile &Obj = *ObjOrErr.get();
+  Syms.IsSymbolic = true;
+
+  for (const object::BasicSymbolRef &S : Obj.symbols()) {
+    uint32_t Symflags = S.getFlags();
+    if (Symflags & object::SymbolRef::SF_FormatSpecific)
+      continue;
+    if (!(Symflags & object::SymbolRef::SF_Global))
+      continue;
+    if (Symflags & object::SymbolRef::SF_Undefined)
+      continue;
+
+    if (auto EC = S.printName(NameOS))
+      return EC;
+    NameOS << '\0';
+    ++Syms.NumSymbols;
+  }
+  return std::error_code();
+}
+
+/// The symbols of the members of an existing archive according to its symbol
+/// table, by member offset.
+typedef DenseMap<uint64_t, MemberSymbols> OldMemberSymbolsMap;
+
+static void readOldMemberSymbols(const object::Archive &Archive,
+                                 OldMemberSymbolsMap &Map) {
+  for (const object::Archive::Symbol &Sym : Archive.symbols()) {
+    ErrorOr<object::Archive::Child> MemberOrErr = Sym.getMember();
+    if (!MemberOrErr) {
+      // Don't trust a symbol table that can't be read; compute the symbols
+      // of all the members instead.
+      Map.clear();
+      return;
     }
+    MemberSymbols &Syms = Map[MemberOrErr->getChildOffset()];
+    Syms.Names += Sym.getName();
+    Syms.Names += '\0';
+    ++Syms.NumSymbols;
+    Syms.IsSymbolic = true;
+  }
+}
 
-    for (const object::BasicSymbolRef &S : Obj.symbols()) {
-      uint32_t Symflags = S.getFlags();
-      if (Symflags & object::SymbolRef::SF_FormatSpecific)
-        continue;
-      if (!(Symflags & object::SymbolRef::SF_Global))
-        continue;
-      if (Symflags & object::SymbolRef::SF_Undefined)
-        continue;
-
-      unsigned NameOffset = NameOS.tell();
-      if (auto EC = S.printName(NameOS))
-        return EC;
-      NameOS << '\0';
-      MemberOffsetRefs.push_back(MemberNum);
-      if (Kind == object::Archive::K_BSD)
-        print32(Out, Kind, NameOffset);
-      print32(Out, Kind, 0); // member offset
+/// Compute the symbols of all the members, on up to \p NumThreads threads.
+static std::error_code
+computeSymbols(ArrayRef<NewArchiveIterator> Members,
+               ArrayRef<MemoryBufferRef> Buffers, bool ReuseOldSymbols,
+               unsigned NumThreads, std::vector<MemberSymbols> &Syms) {
+  Syms.resize(Members.size());
+
+  // The members for which the symbol table of the archive they come from can
+  // be used don't need to be read at all.
+  std::vector<size_t> ToCompute;
+  std::map<const object::Archive *, OldMemberSymbolsMap> OldSymbols;
+  for (size_t I = 0, E = Members.size(); I != E; ++I) {
+    const NewArchiveIterator &Member = Members[I];
+    if (!ReuseOldSymbols || Member.isNewMember() ||
+        !Member.getOld().getParent()->hasSymbolTable()) {
+      ToCompute.push_back(I);
+      continue;
     }
+    const object::Archive::Child &OldMember = Member.getOld();
+    const object::Archive *Parent = OldMember.getParent();
+    auto Inserted = OldSymbols.insert(
+        std::make_pair(Parent, OldMemberSymbolsMap()));
+    if (Inserted.second)
+      readOldMemberSymbols(*Parent, Inserted.first->second);
+    OldMemberSymbolsMap &Map = Inserted.first->second;
+    if (Map.empty()) {
+      ToCompute.push_back(I);
+      continue;
+    }
+    auto It = Map.find(OldMember.getChildOffset());
+    if (It != Map.end())
+      Syms[I] = std::move(It->second);
+  }
+
+  std::vector<std::error_code> Errors(Members.size());
+  if (NumThreads == 1 || ToCompute.size() <= 1) {
+    for (size_t I : ToCompute)
+      Errors[I] = computeMemberSymbols(Buffers[I], Syms[I]);
+  } else {
+    ThreadPool Pool(NumThreads ? NumThreads
+                               : std::thread::hardware_concurrency());
+    for (size_t I : ToCompute)
+      Pool.async([&, I]() {
+        Errors[I] = computeMemberSymbols(Buffers[I], Syms[I]);
+      });
+    Pool.wait();
   }
 
-  if (HeaderStartOffset == 0)
-    return 0;
+  for (std::error_code EC : Errors)
+    if (EC)
+      return EC;
+  return std::error_code();
+}
 
-  StringRef StringTable = NameOS.str();
+/// Write the symbol table member, which starts at the offset \p Pos in the
+/// archive. The member offsets are left as zero, and the offsets of the fields
+/// for them are returned in \p MemberOffsetRefs along with the member number.
+static void
+writeSymbolTable(raw_ostream &Out, uint64_t Pos, object::Archive::Kind Kind,
+                 ArrayRef<MemberSymbols> Syms,
+                 std::vector<std::pair<uint64_t, unsigned>> &MemberOffsetRefs,
+                 bool Deterministic) {
+  unsigned NumSyms = 0;
+  uint64_t StringTableSize = 0;
+  for (const MemberSymbols &S : Syms) {
+    NumSyms += S.NumSymbols;
+    StringTableSize += S.Names.size();
+  }
+
+  std::string Body;
+  raw_string_ostream BodyOS(Body);
+  if (Kind == object::Archive::K_GNU)
+    print32(BodyOS, Kind, NumSyms);
+  else
+    print32(BodyOS, Kind, NumSyms * 8);
+  std::vector<uint64_t> BodyOffsetRefs;
+  unsigned NameOffset = 0;
+  for (unsigned MemberNum = 0, N = Syms.size(); MemberNum < N; ++MemberNum) {
+    StringRef Names = Syms[MemberNum].Names;
+    for (unsigned I = 0; I != Syms[MemberNum].NumSymbols; ++I) {
+      size_t NameSize = Names.find('\0');
+      if (Kind == object::Archive::K_BSD)
+        print32(BodyOS, Kind, NameOffset);
+      MemberOffsetRefs.push_back(std::make_pair(BodyOS.tell(), MemberNum));
+      print32(BodyOS, Kind, 0); // member offset
+      NameOffset += NameSize + 1;
+      Names = Names.substr(NameSize + 1);
+    }
+  }
   if (Kind == object::Archive::K_BSD)
-    print32(Out, Kind, StringTable.size()); // byte count of the string table
-  Out << StringTable;
+    print32(BodyOS, Kind, StringTableSize); // byte count of the string table
+  for (const MemberSymbols &S : Syms)
+    BodyOS << S.Names;
+  BodyOS.flush();
+
+  std::string Header;
+  raw_string_ostream HeaderOS(Header);
+  if (Kind == object::Archive::K_GNU)
+    printGNUSmallMemberHeader(HeaderOS, "", now(Deterministic), 0, 0, 0, 0);
+  else
+    printBSDMemberHeader(HeaderOS, Pos, "__.SYMDEF", now(Deterministic), 0, 0,
+                         0, 0);
+  HeaderOS.flush();
 
   // ld64 requires the next member header to start at an offset that is
   // 4 bytes aligned.
-  unsigned Pad = OffsetToAlignment(Out.tell(), 4);
-  while (Pad--)
-    Out.write(uint8_t(0));
-
-  // Patch up the size of the symbol table now that we know how big it is.
-  unsigned Pos = Out.tell();
-  const unsigned MemberHeaderSize = 60;
-  Out.seek(HeaderStartOffset + 48); // offset of the size field.
-  printWithSpacePadding(Out, Pos - MemberHeaderSize - HeaderStartOffset, 10);
+  Body.append(OffsetToAlignment(Pos + Header.size() + Body.size(), 4), '\0');
 
-  // Patch up the number of symbols.
-  Out.seek(BodyStartOffset);
-  unsigned NumSyms = MemberOffsetRefs.size();
+  // Now that we know how big the symbol table is, fill in its size.
+  Header.clear();
   if (Kind == object::Archive::K_GNU)
-    print32(Out, Kind, NumSyms);
+    printGNUSmallMemberHeader(HeaderOS, "", now(Deterministic), 0, 0, 0,
+                              Body.size());
   else
-    print32(Out, Kind, NumSyms * 8);
+    printBSDMemberHeader(HeaderOS, Pos, "__.SYMDEF", now(Deterministic), 0, 0,
+                         0, Body.size());
+  HeaderOS.flush();
 
-  Out.seek(Pos);
-  return BodyStartOffset + 4;
+  for (auto &Ref : MemberOffsetRefs)
+    Ref.first += Pos + Header.size();
+  Out << Header << Body;
 }
 
 std::pair<StringRef, std::error_code>
@@ -308,23 +444,10 @@ llvm::writeArchive(StringRef ArcName,
                    std::vector<NewArchiveIterator> &NewMembers,
                    bool WriteSymtab, object::Archive::Kind Kind,
                    bool Deterministic, bool Thin,
-                   std::unique_ptr<MemoryBuffer> OldArchiveBuf) {
+                   std::unique_ptr<MemoryBuffer> OldArchiveBuf,
+                   bool ReuseOldSymbols, unsigned NumThreads) {
   assert((!Thin || Kind == object::Archive::K_GNU) &&
          "Only the gnu format has a thin mode");
-  SmallString<128> TmpArchive;
-  int TmpArchiveFD;
-  if (auto EC = sys::fs::createUniqueFile(ArcName + ".temp-archive-%%%%%%%.a",
-                                          TmpArchiveFD, TmpArchive))
-    return std::make_pair(ArcName, EC);
-
-  tool_output_file Output(TmpArchive, TmpArchiveFD);
-  raw_fd_ostream &Out = Output.os();
-  if (Thin)
-    Out << "!<thin>\n";
-  else
-    Out << "!<arch>\n";
-
-  std::vector<unsigned> MemberOffsetRefs;
 
   std::vector<std::unique_ptr<MemoryBuffer>> Buffers;
   std::vector<MemoryBufferRef> Members;
@@ -363,27 +486,48 @@ llvm::writeArchive(StringRef ArcName,
     Members.push_back(MemberRef);
   }
 
-  unsigned MemberReferenceOffset = 0;
+  // Lay out the whole archive in memory, except for the contents of the
+  // members, so that it can be written to the output file in one go.
+  std::string Prefix;
+  raw_string_ostream PrefixOS(Prefix);
+  if (Thin)
+    PrefixOS << "!<thin>\n";
+  else
+    PrefixOS << "!<arch>\n";
+
+  std::vector<std::pair<uint64_t, unsigned>> MemberOffsetRefs;
   if (WriteSymtab) {
-    ErrorOr<unsigned> MemberReferenceOffsetOrErr = writeSymbolTable(
-        Out, Kind, NewMembers, Members, MemberOffsetRefs, Deterministic);
-    if (auto EC = MemberReferenceOffsetOrErr.getError())
+    std::vector<MemberSymbols> Syms;
+    if (auto EC = computeSymbols(NewMembers, Members, ReuseOldSymbols,
+                                 NumThreads, Syms))
       return std::make_pair(ArcName, EC);
-    MemberReferenceOffset = MemberReferenceOffsetOrErr.get();
+    if (std::any_of(Syms.begin(), Syms.end(),
+                    [](const MemberSymbols &S) { return S.IsSymbolic; }))
+      writeSymbolTable(PrefixOS, PrefixOS.tell(), Kind, Syms,
+                       MemberOffsetRefs, Deterministic);
   }
 
   std::vector<unsigned> StringMapIndexes;
   if (Kind != object::Archive::K_BSD)
-    writeStringTable(Out, ArcName, NewMembers, StringMapIndexes, Thin);
+    writeStringTable(PrefixOS, PrefixOS.tell(), ArcName, NewMembers,
+                     StringMapIndexes, Thin);
+  PrefixOS.flush();
+
+  struct MemberData {
+    std::string Header;
+    StringRef Data;
+    bool NeedsPadding;
+  };
+  std::vector<MemberData> Data;
+  std::vector<uint64_t> MemberOffset;
+  uint64_t Pos = Prefix.size();
 
   unsigned MemberNum = 0;
   unsigned NewMemberNum = 0;
   std::vector<unsigned>::iterator StringMapIndexIter = StringMapIndexes.begin();
-  std::vector<unsigned> MemberOffset;
   for (const NewArchiveIterator &I : NewMembers) {
     MemoryBufferRef File = Members[MemberNum++];
 
-    unsigned Pos = Out.tell();
     MemberOffset.push_back(Pos);
 
     sys::TimeValue ModTime;
@@ -409,41 +553,61 @@ llvm::writeArchive(StringRef ArcName,
       Perms = OldMember.getAccessMode();
     }
 
+    MemberData M;
+    raw_string_ostream HeaderOS(M.Header);
     if (I.isNewMember()) {
       StringRef FileName = I.getNew();
       const sys::fs::file_status &Status = NewMemberStatus[NewMemberNum++];
-      printMemberHeader(Out, Kind, Thin, sys::path::filename(FileName),
-                        StringMapIndexIter, ModTime, UID, GID, Perms,
-                        Status.getSize());
+      printMemberHeader(HeaderOS, Pos, Kind, Thin,
+                        sys::path::filename(FileName), StringMapIndexIter,
+                        ModTime, UID, GID, Perms, Status.getSize());
     } else {
       const object::Archive::Child &OldMember = I.getOld();
       ErrorOr<uint32_t> Size = OldMember.getSize();
       if (std::error_code EC = Size.getError())
         return std::make_pair("", EC);
       StringRef FileName = I.getName();
-      printMemberHeader(Out, Kind, Thin, sys::path::filename(FileName),
-                        StringMapIndexIter, ModTime, UID, GID, Perms,
-                        Size.get());
+      printMemberHeader(HeaderOS, Pos, Kind, Thin,
+                        sys::path::filename(FileName), StringMapIndexIter,
+                        ModTime, UID, GID, Perms, Size.get());
     }
+    HeaderOS.flush();
+    Pos += M.Header.size();
 
-    if (!Thin)
-      Out << File.getBuffer();
+    if (!Thin) {
+      M.Data = File.getBuffer();
+      Pos += M.Data.size();
+    }
 
-    if (Out.tell() % 2)
-      Out << '\n';
+    M.NeedsPadding = Pos % 2;
+    if (M.NeedsPadding)
+      ++Pos;
+    Data.push_back(std::move(M));
   }
 
-  if (MemberReferenceOffset) {
-    Out.seek(MemberReferenceOffset);
-    for (unsigned MemberNum : MemberOffsetRefs) {
-      if (Kind == object::Archive::K_BSD)
-        Out.seek(Out.tell() + 4); // skip over the string offset
-      print32(Out, Kind, MemberOffset[MemberNum]);
-    }
+  // Fill in the member offsets in the symbol table.
+  for (const auto &Ref : MemberOffsetRefs) {
+    SmallString<4> Offset;
+    raw_svector_ostream OffsetOS(Offset);
+    print32(OffsetOS, Kind, MemberOffset[Ref.second]);
+    std::copy(Offset.begin(), Offset.end(), Prefix.begin() + Ref.first);
   }
 
-  Output.keep();
-  Out.close();
+  ErrorOr<std::unique_ptr<FileOutputBuffer>> BufferOrErr =
+      FileOutputBuffer::create(ArcName, Pos);
+  if (auto EC = BufferOrErr.getError())
+    return std::make_pair(ArcName, EC);
+  std::unique_ptr<FileOutputBuffer> &Buffer = *BufferOrErr;
+
+  char *Out = reinterpret_cast<char *>(Buffer->getBufferStart());
+  Out = std::copy(Prefix.begin(), Prefix.end(), Out);
+  for (const MemberData &M : Data) {
+    Out = std::copy(M.Header.begin(), M.Header.end(), Out);
+    Out = std::copy(M.Data.begin(), M.Data.end(), Out);
+    if (M.NeedsPadding)
+      *Out++ = '\n';
+  }
+  assert(Out == reinterpret_cast<char *>(Buffer->getBufferEnd()));
 
   // At this point, we no longer need whatever backing memory
   // was used to generate the NewMembers. On Windows, this buffer
@@ -457,6 +621,7 @@ llvm::writeArchive(StringRef ArcName,
   // closed before we attempt to rename.
   OldArchiveBuf.reset();
 
-  sys::fs::rename(TmpArchive, ArcName);
+  if (auto EC = Buffer->commit())
+    return std::make_pair(ArcName, EC);
   return std::make_pair("", std::error_code());
 }
@@ -11,14 +11,18 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/Object/COFF.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <system_error>
+#include <vector>
 
 using namespace llvm;
 using namespace object;
@@ -28,6 +32,88 @@ void ObjectFile::anchor() { }
 ObjectFile::ObjectFile(unsigned int Type, MemoryBufferRef Source)
     : SymbolicFile(Type, Source) {}
 
+struct ObjectFile::SymbolIndex {
+  /// The symbols, in the order of the symbol table.
+  std::vector<SymbolRef> Symbols;
+
+  /// The index in Symbols of the preferred symbol of each name.
+  DenseMap<StringRef, unsigned> ByName;
+  bool HasNames = false;
+
+  /// The addresses and indexes in Symbols of the defined symbols, sorted.
+  std::vector<std::pair<uint64_t, unsigned>> ByAddress;
+  bool HasAddresses = false;
+};
+
+ObjectFile::~ObjectFile() {}
+
+ObjectFile::SymbolIndex &ObjectFile::getSymbolIndex() const {
+  if (!Index) {
+    Index.reset(new SymbolIndex);
+    for (const SymbolRef &Symbol : symbols())
+      Index->Symbols.push_back(Symbol);
+  }
+  return *Index;
+}
+
+/// Rank the symbols of a name: defined ones first, then global ones.
+static unsigned getSymbolRank(const SymbolRef &Symbol) {
+  uint32_t Flags = Symbol.getFlags();
+  return (Flags & SymbolRef::SF_Undefined ? 0 : 2) +
+         (Flags & SymbolRef::SF_Global ? 1 : 0);
+}
+
+symbol_iterator ObjectFile::findSymbol(StringRef Name) const {
+  SymbolIndex &I = getSymbolIndex();
+  if (!I.HasNames) {
+    I.ByName.reserve(I.Symbols.size());
+    for (unsigned J = 0, E = I.Symbols.size(); J != E; ++J) {
+      Expected<StringRef> SymName = I.Symbols[J].getName();
+      if (!SymName) {
+        consumeError(SymName.takeError());
+        continue;
+      }
+      auto Ins = I.ByName.insert(std::make_pair(*SymName, J));
+      if (!Ins.second &&
+          getSymbolRank(I.Symbols[J]) >
+              getSymbolRank(I.Symbols[Ins.first->second]))
+        Ins.first->second = J;
+    }
+    I.HasNames = true;
+  }
+  auto It = I.ByName.find(Name);
+  if (It == I.ByName.end())
+    return symbol_end();
+  return symbol_iterator(I.Symbols[It->second]);
+}
+
+symbol_iterator ObjectFile::findSymbolByAddress(uint64_t Address) const {
+  SymbolIndex &I = getSymbolIndex();
+  if (!I.HasAddresses) {
+    for (unsigned J = 0, E = I.Symbols.size(); J != E; ++J) {
+      const SymbolRef &Symbol = I.Symbols[J];
+      if (Symbol.getFlags() &
+          (SymbolRef::SF_Undefined | SymbolRef::SF_Common))
+        continue;
+      ErrorOr<uint64_t> SymAddress = Symbol.getAddress();
+      if (SymAddress)
+        I.ByAddress.push_back(std::make_pair(*SymAddress, J));
+    }
+    // The symbol tables of linked images can be large.
+    parallel_sort(I.ByAddress.begin(), I.ByAddress.end());
+    I.HasAddresses = true;
+  }
+  // Find the highest address not above Address, then the first symbol there.
+  auto It = std::upper_bound(
+      I.ByAddress.begin(), I.ByAddress.end(),
+      std::make_pair(Address, ~0U));
+  if (It == I.ByAddress.begin())
+    return symbol_end();
+  uint64_t Found = std::prev(It)->first;
+  It = std::lower_bound(I.ByAddress.begin(), It, std::make_pair(Found, 0U));
+  return symbol_iterator(I.Symbols[It->second]);
+}
+
 bool SectionRef::containsSymbol(SymbolRef S) const {
   Expected<section_iterator> SymSec = S.getSection();
   if (!SymSec) {
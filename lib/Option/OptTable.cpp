@@ -46,6 +46,20 @@ static int StrCmpOptionNameIgnoreCase(const char *A, const char *B) {
   return (a < b) ? -1 : 1;
 }
 
+/// Compare the name \p A with \p B like StrCmpOptionNameIgnoreCase, when \p B
+/// is not null terminated.
+static int StrCmpOptionNameIgnoreCase(const char *A, StringRef B) {
+  size_t I = 0;
+  for (size_t E = B.size(); A[I] != '\0' && I != E; ++I) {
+    char a = tolower(A[I]), b = tolower(B[I]);
+    if (a != b)
+      return (a < b) ? -1 : 1;
+  }
+  if (A[I] == '\0')
+    return I == B.size() ? 0 : 1; // A is a prefix of B.
+  return -1; // B is a prefix of A.
+}
+
 #ifndef NDEBUG
 static int StrCmpOptionName(const char *A, const char *B) {
   if (int N = StrCmpOptionNameIgnoreCase(A, B))
@@ -76,7 +90,7 @@ static inline bool operator<(const OptTable::Info &A, const OptTable::Info &B) {
 #endif
 
 // Support lower_bound between info and an option name.
-static inline bool operator<(const OptTable::Info &I, const char *Name) {
+static inline bool operator<(const OptTable::Info &I, StringRef Name) {
   return StrCmpOptionNameIgnoreCase(I.Name, Name) < 0;
 }
 }
@@ -86,7 +100,7 @@ OptSpecifier::OptSpecifier(const Option *Opt) : ID(Opt->getID()) {}
 
 OptTable::OptTable(ArrayRef<Info> OptionInfos, bool IgnoreCase)
     : OptionInfos(OptionInfos), IgnoreCase(IgnoreCase), TheInputOptionID(0),
-      TheUnknownOptionID(0), FirstSearchableIndex(0) {
+      TheUnknownOptionID(0), FirstSearchableIndex(0), MaxOptionNameLength(0) {
   // Explicitly zero initialize the error to work around a bug in array
   // value-initialization on MinGW with gcc 4.3.5.
 
@@ -129,6 +143,8 @@ OptTable::OptTable(ArrayRef<Info> OptionInfos, bool IgnoreCase)
   // Build prefixes.
   for (unsigned i = FirstSearchableIndex + 1, e = getNumOptions() + 1;
                 i != e; ++i) {
+    MaxOptionNameLength =
+        std::max(MaxOptionNameLength, StringRef(getInfo(i).Name).size());
     if (const char *const *P = getInfo(i).Prefixes) {
       for (; *P != nullptr; ++P) {
         PrefixesUnion.insert(*P);
@@ -201,40 +217,35 @@ Arg *OptTable::ParseOneArg(const ArgList &Args, unsigned &Index,
   const Info *End = OptionInfos.end();
   StringRef Name = StringRef(Str).ltrim(PrefixChars);
 
-  // Search for the first next option which could be a prefix.
-  Start = std::lower_bound(Start, End, Name.data());
-
   // Options are stored in sorted order, with '\0' at the end of the
-  // alphabet. Since the only options which can accept a string must
-  // prefix it, we iteratively search for the next option which could
-  // be a prefix.
-  //
-  // FIXME: This is searching much more than necessary, but I am
-  // blanking on the simplest way to make it fast. We can solve this
-  // problem when we move to TableGen.
-  for (; Start != End; ++Start) {
-    unsigned ArgSize = 0;
-    // Scan for first option which is a proper prefix.
-    for (; Start != End; ++Start)
-      if ((ArgSize = matchOption(Start, Str, IgnoreCase)))
-        break;
-    if (Start == End)
-      break;
-
-    Option Opt(Start, this);
-
-    if (FlagsToInclude && !Opt.hasFlag(FlagsToInclude))
-      continue;
-    if (Opt.hasFlag(FlagsToExclude))
-      continue;
-
-    // See if this option matches.
-    if (Arg *A = Opt.accept(Args, Index, ArgSize))
-      return A;
-
-    // Otherwise, see if this argument was missing values.
-    if (Prev != Index)
-      return nullptr;
+  // alphabet, so the options which can accept a string, whose names must
+  // prefix it, come in order of decreasing name length. Rather than scanning
+  // the table for them, look up the names of each length in turn. No name is
+  // longer than MaxOptionNameLength.
+  for (size_t Len = std::min(Name.size(), MaxOptionNameLength) + 1;
+       Len-- != 0;) {
+    StringRef Key = Name.substr(0, Len);
+    for (const Info *I = std::lower_bound(Start, End, Key);
+         I != End && StrCmpOptionNameIgnoreCase(I->Name, Key) == 0; ++I) {
+      unsigned ArgSize = matchOption(I, Str, IgnoreCase);
+      if (!ArgSize)
+        continue;
+
+      Option Opt(I, this);
+
+      if (FlagsToInclude && !Opt.hasFlag(FlagsToInclude))
+        continue;
+      if (Opt.hasFlag(FlagsToExclude))
+        continue;
+
+      // See if this option matches.
+      if (Arg *A = Opt.accept(Args, Index, ArgSize))
+        return A;
+
+      // Otherwise, see if this argument was missing values.
+      if (Prev != Index)
+        return nullptr;
+    }
   }
 
   // If we failed to find an option and this arg started with /, then it's
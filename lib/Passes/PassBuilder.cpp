@@ -25,6 +25,7 @@
 #include "llvm/Analysis/BlockFrequencyInfoImpl.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Analysis/CFLAliasAnalysis.h"
+#include "llvm/Analysis/CFLAndersAliasAnalysis.h"
 #include "llvm/Analysis/CGSCCPassManager.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/DemandedBits.h"
@@ -128,6 +129,7 @@ public:
 struct NoOpFunctionPass {
   PreservedAnalyses run(Function &F) { return PreservedAnalyses::all(); }
   static StringRef name() { return "NoOpFunctionPass"; }
+  static bool isThreadSafe() { return true; }
 };
 
 /// \brief No-op function analysis.
@@ -608,6 +610,25 @@ bool PassBuilder::parseModulePassPipeline(ModulePassManager &MPM,
 
       // Add the nested pass manager with the appropriate adaptor.
       MPM.addPass(createModuleToFunctionPassAdaptor(std::move(NestedFPM)));
+    } else if (PipelineText.startswith("parallel-function(")) {
+      FunctionPassManager NestedFPM(DebugLogging);
+
+      // Parse the inner pipeline into the nested manager.
+      PipelineText = PipelineText.substr(strlen("parallel-function("));
+      if (!parseFunctionPassPipeline(NestedFPM, PipelineText, VerifyEachPass,
+                                     DebugLogging) ||
+          PipelineText.empty())
+        return false;
+      assert(PipelineText[0] == ')');
+      PipelineText = PipelineText.substr(1);
+
+      // Run the nested pass manager over the functions concurrently if all
+      // its passes allow it.
+      MPM.addPass(createParallelModuleToFunctionPassAdaptor(
+          std::move(NestedFPM),
+          [this](FunctionAnalysisManager &FAM) {
+            registerFunctionAnalyses(FAM);
+          }));
     } else {
       // Otherwise try to parse a pass name.
       size_t End = PipelineText.find_first_of(",)");
@@ -22,6 +22,7 @@
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -162,6 +163,9 @@ Expected<int64_t> CounterMappingContext::evaluate(const Counter &C) const {
   case Counter::Expression: {
     if (C.getExpressionID() >= Expressions.size())
       return errorCodeToError(errc::argument_out_of_domain);
+    auto Cached = ExpressionValues.find(C.getExpressionID());
+    if (Cached != ExpressionValues.end())
+      return Cached->second;
     const auto &E = Expressions[C.getExpressionID()];
     Expected<int64_t> LHS = evaluate(E.LHS);
     if (!LHS)
@@ -169,7 +173,10 @@ Expected<int64_t> CounterMappingContext::evaluate(const Counter &C) const {
     Expected<int64_t> RHS = evaluate(E.RHS);
     if (!RHS)
       return RHS;
-    return E.Kind == CounterExpression::Subtract ? *LHS - *RHS : *LHS + *RHS;
+    int64_t Value =
+        E.Kind == CounterExpression::Subtract ? *LHS - *RHS : *LHS + *RHS;
+    ExpressionValues[C.getExpressionID()] = Value;
+    return Value;
   }
   }
   llvm_unreachable("Unhandled CounterKind");
@@ -186,48 +193,88 @@ void FunctionRecordIterator::skipOtherFiles() {
 Expected<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(CoverageMappingReader &CoverageReader,
                       IndexedInstrProfReader &ProfileReader) {
+  return loadForFile(CoverageReader, ProfileReader, StringRef());
+}
+
+Expected<std::unique_ptr<CoverageMapping>>
+CoverageMapping::loadForFile(CoverageMappingReader &CoverageReader,
+                             IndexedInstrProfReader &ProfileReader,
+                             StringRef Filename) {
   auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
 
-  std::vector<uint64_t> Counts;
+  if (!Filename.empty())
+    if (Error E = CoverageReader.setFileFilter(Filename))
+      return std::move(E);
+
+  // The records and the profile are read serially, as the readers reuse their
+  // buffers, and the regions are then evaluated in parallel.
+  struct PendingRecord {
+    StringRef FunctionName;
+    std::vector<StringRef> Filenames;
+    std::vector<CounterExpression> Expressions;
+    std::vector<CounterMappingRegion> MappingRegions;
+    std::vector<uint64_t> Counts;
+  };
+  std::vector<PendingRecord> Pending;
   for (const auto &Record : CoverageReader) {
-    CounterMappingContext Ctx(Record.Expressions);
+    // The readers that do not index their records return all of them.
+    if (!Filename.empty() &&
+        std::find(Record.Filenames.begin(), Record.Filenames.end(),
+                  Filename) == Record.Filenames.end())
+      continue;
 
-    Counts.clear();
+    PendingRecord P;
     if (Error E = ProfileReader.getFunctionCounts(
-            Record.FunctionName, Record.FunctionHash, Counts)) {
+            Record.FunctionName, Record.FunctionHash, P.Counts)) {
       instrprof_error IPE = InstrProfError::take(std::move(E));
       if (IPE == instrprof_error::hash_mismatch) {
         Coverage->MismatchedFunctionCount++;
         continue;
       } else if (IPE != instrprof_error::unknown_function)
         return make_error<InstrProfError>(IPE);
-      Counts.assign(Record.MappingRegions.size(), 0);
+      P.Counts.assign(Record.MappingRegions.size(), 0);
     }
-    Ctx.setCounts(Counts);
 
     assert(!Record.MappingRegions.empty() && "Function has no regions");
 
-    StringRef OrigFuncName = Record.FunctionName;
-    if (Record.Filenames.empty())
+    P.FunctionName = Record.FunctionName;
+    P.Filenames.assign(Record.Filenames.begin(), Record.Filenames.end());
+    P.Expressions.assign(Record.Expressions.begin(), Record.Expressions.end());
+    P.MappingRegions.assign(Record.MappingRegions.begin(),
+                            Record.MappingRegions.end());
+    Pending.push_back(std::move(P));
+  }
+
+  std::vector<Optional<FunctionRecord>> Functions(Pending.size());
+  parallel_for_each_n(size_t(0), Pending.size(), [&](size_t I) {
+    const PendingRecord &P = Pending[I];
+    CounterMappingContext Ctx(P.Expressions);
+    Ctx.setCounts(P.Counts);
+
+    StringRef OrigFuncName = P.FunctionName;
+    if (P.Filenames.empty())
       OrigFuncName = getFuncNameWithoutPrefix(OrigFuncName);
     else
-      OrigFuncName =
-          getFuncNameWithoutPrefix(OrigFuncName, Record.Filenames[0]);
-    FunctionRecord Function(OrigFuncName, Record.Filenames);
-    for (const auto &Region : Record.MappingRegions) {
+      OrigFuncName = getFuncNameWithoutPrefix(OrigFuncName, P.Filenames[0]);
+    FunctionRecord Function(OrigFuncName, P.Filenames);
+    for (const auto &Region : P.MappingRegions) {
       Expected<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
       if (auto E = ExecutionCount.takeError()) {
         llvm::consumeError(std::move(E));
-        break;
+        return;
       }
       Function.pushRegion(Region, *ExecutionCount);
     }
-    if (Function.CountedRegions.size() != Record.MappingRegions.size()) {
+    Functions[I] = std::move(Function);
+  });
+
+  // Keep the functions in the order of the records.
+  for (Optional<FunctionRecord> &Function : Functions) {
+    if (!Function) {
       Coverage->MismatchedFunctionCount++;
       continue;
     }
-
-    Coverage->Functions.push_back(std::move(Function));
+    Coverage->Functions.push_back(std::move(*Function));
   }
 
   return std::move(Coverage);
@@ -236,6 +283,13 @@ CoverageMapping::load(CoverageMappingReader &CoverageReader,
 Expected<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
                       StringRef Arch) {
+  return loadForFile(ObjectFilename, ProfileFilename, StringRef(), Arch);
+}
+
+Expected<std::unique_ptr<CoverageMapping>>
+CoverageMapping::loadForFile(StringRef ObjectFilename,
+                             StringRef ProfileFilename, StringRef Filename,
+                             StringRef Arch) {
   auto CounterMappingBuff = MemoryBuffer::getFileOrSTDIN(ObjectFilename);
   if (std::error_code EC = CounterMappingBuff.getError())
     return errorCodeToError(EC);
@@ -248,7 +302,7 @@ CoverageMapping::load(StringRef ObjectFilename, StringRef ProfileFilename,
   if (Error E = ProfileReaderOrErr.takeError())
     return std::move(E);
   auto ProfileReader = std::move(ProfileReaderOrErr.get());
-  return load(*CoverageReader, *ProfileReader);
+  return loadForFile(*CoverageReader, *ProfileReader, Filename);
 }
 
 namespace {
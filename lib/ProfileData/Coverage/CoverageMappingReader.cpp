@@ -225,8 +225,7 @@ Error RawCoverageMappingReader::readMappingRegionsSubArray(
   return Error::success();
 }
 
-Error RawCoverageMappingReader::read() {
-
+Error RawCoverageMappingReader::readFilenames() {
   // Read the virtual file mapping.
   llvm::SmallVector<unsigned, 8> VirtualFileMapping;
   uint64_t NumFileMappings;
@@ -243,6 +242,14 @@ Error RawCoverageMappingReader::read() {
   for (auto I : VirtualFileMapping) {
     Filenames.push_back(TranslationUnitFilenames[I]);
   }
+  return Error::success();
+}
+
+Error RawCoverageMappingReader::read() {
+  size_t NumFilenames = Filenames.size();
+  if (auto Err = readFilenames())
+    return Err;
+  size_t NumFileIDs = Filenames.size() - NumFilenames;
 
   // Read the expressions.
   uint64_t NumExpressions;
@@ -262,10 +269,10 @@ Error RawCoverageMappingReader::read() {
   }
 
   // Read the mapping regions sub-arrays.
-  for (unsigned InferredFileID = 0, S = VirtualFileMapping.size();
-       InferredFileID < S; ++InferredFileID) {
+  for (unsigned InferredFileID = 0, S = NumFileIDs; InferredFileID < S;
+       ++InferredFileID) {
     if (auto Err = readMappingRegionsSubArray(MappingRegions, InferredFileID,
-                                              VirtualFileMapping.size()))
+                                              NumFileIDs))
       return Err;
   }
 
@@ -275,8 +282,8 @@ Error RawCoverageMappingReader::read() {
   // Perform multiple passes to correctly propagate the counters through
   // all the nested expansion regions.
   SmallVector<CounterMappingRegion *, 8> FileIDExpansionRegionMapping;
-  FileIDExpansionRegionMapping.resize(VirtualFileMapping.size(), nullptr);
-  for (unsigned Pass = 1, S = VirtualFileMapping.size(); Pass < S; ++Pass) {
+  FileIDExpansionRegionMapping.resize(NumFileIDs, nullptr);
+  for (unsigned Pass = 1, S = NumFileIDs; Pass < S; ++Pass) {
     for (auto &R : MappingRegions) {
       if (R.Kind != CounterMappingRegion::ExpansionRegion)
         continue;
@@ -676,14 +683,48 @@ BinaryCoverageReader::create(std::unique_ptr<MemoryBuffer> &ObjectBuffer,
   return std::move(Reader);
 }
 
+Error BinaryCoverageReader::buildFileRecords() {
+  // Only the file mapping at the start of each record needs to be decoded.
+  std::vector<StringRef> RecordFilenames;
+  for (unsigned I = 0, E = MappingRecords.size(); I != E; ++I) {
+    auto &R = MappingRecords[I];
+    RecordFilenames.clear();
+    RawCoverageMappingReader Reader(
+        R.CoverageMapping,
+        makeArrayRef(Filenames).slice(R.FilenamesBegin, R.FilenamesSize),
+        RecordFilenames, Expressions, MappingRegions);
+    if (auto Err = Reader.readFilenames())
+      return Err;
+    for (StringRef Filename : RecordFilenames) {
+      auto &Records = FileRecords[Filename];
+      if (Records.empty() || Records.back() != I)
+        Records.push_back(I);
+    }
+  }
+  HasFileRecords = true;
+  return Error::success();
+}
+
+Error BinaryCoverageReader::setFileFilter(StringRef Filename) {
+  if (!HasFileRecords)
+    if (auto Err = buildFileRecords())
+      return Err;
+  FilteredRecords = &FileRecords[Filename];
+  CurrentRecord = 0;
+  return Error::success();
+}
+
 Error BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
-  if (CurrentRecord >= MappingRecords.size())
+  size_t NumRecords =
+      FilteredRecords ? FilteredRecords->size() : MappingRecords.size();
+  if (CurrentRecord >= NumRecords)
     return make_error<CoverageMapError>(coveragemap_error::eof);
 
   FunctionsFilenames.clear();
   Expressions.clear();
   MappingRegions.clear();
-  auto &R = MappingRecords[CurrentRecord];
+  auto &R = MappingRecords[FilteredRecords ? (*FilteredRecords)[CurrentRecord]
+                                           : CurrentRecord];
   RawCoverageMappingReader Reader(
       R.CoverageMapping,
       makeArrayRef(Filenames).slice(R.FilenamesBegin, R.FilenamesSize),
@@ -19,9 +19,9 @@
 using namespace llvm;
 
 static Expected<std::unique_ptr<MemoryBuffer>>
-setupMemoryBuffer(const Twine &Path) {
+setupMemoryBuffer(const Twine &Path, bool RequiresNullTerminator = true) {
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
-      MemoryBuffer::getFileOrSTDIN(Path);
+      MemoryBuffer::getFileOrSTDIN(Path, -1, RequiresNullTerminator);
   if (std::error_code EC = BufferOrErr.getError())
     return errorCodeToError(EC);
   return std::move(BufferOrErr.get());
@@ -68,8 +68,12 @@ InstrProfReader::create(std::unique_ptr<MemoryBuffer> Buffer) {
 
 Expected<std::unique_ptr<IndexedInstrProfReader>>
 IndexedInstrProfReader::create(const Twine &Path) {
-  // Set up the buffer to read.
-  auto BufferOrError = setupMemoryBuffer(Path);
+  // Set up the buffer to read. The indexed format does not need a null
+  // terminator, which lets the file always be mapped rather than read in.
+  // Only the header, the hash table buckets and the records that are actually
+  // looked up are then paged in.
+  auto BufferOrError =
+      setupMemoryBuffer(Path, /* RequiresNullTerminator */ false);
   if (Error E = BufferOrError.takeError())
     return std::move(E);
   return IndexedInstrProfReader::create(std::move(BufferOrError.get()));
@@ -654,6 +658,9 @@ Error IndexedInstrProfReader::readHeader() {
     return error(instrprof_error::unsupported_hash_type);
 
   uint64_t HashOffset = endian::byte_swap<uint64_t, little>(Header->HashOffset);
+  if (HashOffset > DataBuffer->getBufferSize() ||
+      Cur > (const unsigned char *)DataBuffer->getBufferEnd())
+    return error(instrprof_error::truncated);
 
   // The rest of the file is an on disk hash table.
   InstrProfReaderIndexBase *IndexPtr = nullptr;
@@ -703,8 +710,6 @@ Error IndexedInstrProfReader::getFunctionCounts(StringRef FuncName,
 }
 
 Error IndexedInstrProfReader::readNextRecord(InstrProfRecord &Record) {
-  static unsigned RecordIndex = 0;
-
   ArrayRef<InstrProfRecord> Data;
 
   Error E = Index->getRecords(Data);
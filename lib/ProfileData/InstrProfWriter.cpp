@@ -16,7 +16,9 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/OnDiskHashTable.h"
+#include <algorithm>
 #include <tuple>
+#include <vector>
 
 using namespace llvm;
 
@@ -72,6 +74,19 @@ public:
   support::endian::Writer<support::little> LE;
 };
 
+// Return the records of \c PD ordered by function hash.
+static SmallVector<const InstrProfRecord *, 1>
+getSortedRecords(const InstrProfWriter::ProfilingData &PD) {
+  SmallVector<const InstrProfRecord *, 1> Records;
+  for (const auto &ProfileData : PD)
+    Records.push_back(&ProfileData.second);
+  std::sort(Records.begin(), Records.end(),
+            [](const InstrProfRecord *A, const InstrProfRecord *B) {
+              return A->Hash < B->Hash;
+            });
+  return Records;
+}
+
 class InstrProfRecordWriterTrait {
 public:
   typedef StringRef key_type;
@@ -121,18 +136,20 @@ public:
   void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V, offset_type) {
     using namespace llvm::support;
     endian::Writer<little> LE(Out);
-    for (const auto &ProfileData : *V) {
-      const InstrProfRecord &ProfRecord = ProfileData.second;
+    // Emit the records in hash order so that the output does not depend on
+    // the order in which the records were added.
+    for (const InstrProfRecord *Record : getSortedRecords(*V)) {
+      const InstrProfRecord &ProfRecord = *Record;
       SummaryBuilder->addRecord(ProfRecord);
 
-      LE.write<uint64_t>(ProfileData.first); // Function hash
+      LE.write<uint64_t>(ProfRecord.Hash); // Function hash
       LE.write<uint64_t>(ProfRecord.Counts.size());
       for (uint64_t I : ProfRecord.Counts)
         LE.write<uint64_t>(I);
 
       // Write value data
       std::unique_ptr<ValueProfData> VDataPtr =
-          ValueProfData::serializeFrom(ProfileData.second);
+          ValueProfData::serializeFrom(ProfRecord);
       uint32_t S = VDataPtr->getSize();
       VDataPtr->swapBytesFromHost(ValueProfDataEndianness);
       Out.write((const char *)VDataPtr.get(), S);
@@ -182,6 +199,31 @@ Error InstrProfWriter::addRecord(InstrProfRecord &&I, uint64_t Weight) {
   return Dest.takeError();
 }
 
+Error InstrProfWriter::mergeRecordsFromWriter(InstrProfWriter &&IPW,
+                                              function_ref<void(Error)> Warn) {
+  if (IPW.ProfileKind != PF_Unknown)
+    if (Error E = setIsIRLevelProfile(IPW.ProfileKind == PF_IRLevel))
+      return E;
+
+  for (auto &I : IPW.FunctionData)
+    for (auto &Func : I.getValue())
+      if (Error E = addRecord(std::move(Func.second), 1))
+        Warn(std::move(E));
+  return Error::success();
+}
+
+// Collect the names of the functions to be emitted, sorted so that the output
+// is independent of the order in which the records were added.
+static std::vector<StringRef>
+getSortedFuncNames(const StringMap<InstrProfWriter::ProfilingData> &FD) {
+  std::vector<StringRef> Names;
+  Names.reserve(FD.size());
+  for (const auto &I : FD)
+    Names.push_back(I.getKey());
+  std::sort(Names.begin(), Names.end());
+  return Names;
+}
+
 bool InstrProfWriter::shouldEncodeData(const ProfilingData &PD) {
   if (!Sparse)
     return true;
@@ -218,9 +260,11 @@ void InstrProfWriter::writeImpl(ProfOStream &OS) {
   InfoObj->SummaryBuilder = &ISB;
 
   // Populate the hash table generator.
-  for (const auto &I : FunctionData)
-    if (shouldEncodeData(I.getValue()))
-      Generator.insert(I.getKey(), &I.getValue());
+  for (StringRef Name : getSortedFuncNames(FunctionData)) {
+    const ProfilingData &PD = FunctionData.find(Name)->getValue();
+    if (shouldEncodeData(PD))
+      Generator.insert(Name, &PD);
+  }
   // Write the header.
   IndexedInstrProf::Header Header;
   Header.Magic = IndexedInstrProf::Magic;
@@ -337,13 +381,17 @@ void InstrProfWriter::writeText(raw_fd_ostream &OS) {
   if (ProfileKind == PF_IRLevel)
     OS << "# IR level Instrumentation Flag\n:ir\n";
   InstrProfSymtab Symtab;
-  for (const auto &I : FunctionData)
-    if (shouldEncodeData(I.getValue()))
-      Symtab.addFuncName(I.getKey());
+  std::vector<StringRef> Names = getSortedFuncNames(FunctionData);
+  for (StringRef Name : Names)
+    if (shouldEncodeData(FunctionData.find(Name)->getValue()))
+      Symtab.addFuncName(Name);
   Symtab.finalizeSymtab();
 
-  for (const auto &I : FunctionData)
-    if (shouldEncodeData(I.getValue()))
-      for (const auto &Func : I.getValue())
-        writeRecordInText(Func.second, Symtab, OS);
+  for (StringRef Name : Names) {
+    const ProfilingData &PD = FunctionData.find(Name)->getValue();
+    if (!shouldEncodeData(PD))
+      continue;
+    for (const InstrProfRecord *Record : getSortedRecords(PD))
+      writeRecordInText(*Record, Symtab, OS);
+  }
 }
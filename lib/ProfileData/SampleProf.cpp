@@ -137,3 +137,55 @@ raw_ostream &llvm::sampleprof::operator<<(raw_ostream &OS,
 }
 
 void FunctionSamples::dump(void) const { print(dbgs(), 0); }
+
+bool SampleContext::parse(StringRef Name) {
+  Callers.clear();
+  Callee = StringRef();
+  if (!Name.startswith("[") || !Name.endswith("]"))
+    return false;
+  Name = Name.drop_front().drop_back();
+
+  SmallVector<StringRef, 4> Frames;
+  Name.split(Frames, " @ ");
+  if (Frames.size() < 2)
+    return false;
+  for (StringRef Frame : makeArrayRef(Frames).drop_back()) {
+    // Each caller is written as NAME:LINE_OFFSET[.DISCRIMINATOR].
+    size_t Colon = Frame.rfind(':');
+    if (Colon == StringRef::npos || Colon == 0)
+      return false;
+    StringRef Loc = Frame.substr(Colon + 1);
+    StringRef Line = Loc, Discriminator;
+    size_t Dot = Loc.find('.');
+    if (Dot != StringRef::npos) {
+      Line = Loc.substr(0, Dot);
+      Discriminator = Loc.substr(Dot + 1);
+    }
+    uint32_t LineOffset, DiscriminatorValue = 0;
+    if (Line.getAsInteger(10, LineOffset) ||
+        (Dot != StringRef::npos &&
+         Discriminator.getAsInteger(10, DiscriminatorValue)))
+      return false;
+    Callers.emplace_back(Frame.substr(0, Colon),
+                         LineLocation(LineOffset, DiscriminatorValue));
+  }
+  Callee = Frames.back();
+  return !Callee.empty();
+}
+
+/// \brief Print the calling context on stream \p OS, as it is spelled in
+/// the name of its profile.
+void SampleContext::print(raw_ostream &OS) const {
+  OS << "[";
+  for (const CallerFrame &Caller : Callers)
+    OS << Caller.FuncName << ":" << Caller.CallSite << " @ ";
+  OS << Callee << "]";
+}
+
+LLVM_DUMP_METHOD void SampleContext::dump() const { print(dbgs()); }
+
+raw_ostream &llvm::sampleprof::operator<<(raw_ostream &OS,
+                                          const SampleContext &Context) {
+  Context.print(OS);
+  return OS;
+}
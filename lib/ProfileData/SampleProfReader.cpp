@@ -8,21 +8,24 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that reads LLVM sample profiles. It
-// supports three file formats: text, binary and gcov.
+// supports four file formats: text, binary, extended binary and gcov.
 //
 // The textual representation is useful for debugging and testing purposes. The
-// binary representation is more compact, resulting in smaller file sizes.
+// binary representation is more compact, resulting in smaller file sizes. The
+// extended binary representation indexes the functions of the binary one, so
+// that only the profiles of the functions of a module need to be decoded.
 //
 // The gcov encoding is the one generated by GCC's AutoFDO profile creation
 // tool (https://github.com/google/autofdo)
 //
-// All three encodings can be used interchangeably as an input sample profile.
+// All four encodings can be used interchangeably as an input sample profile.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/SampleProfReader.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
@@ -47,6 +50,43 @@ void SampleProfileReader::dump(raw_ostream &OS) {
     dumpFunctionProfile(I.getKey(), OS);
 }
 
+std::error_code SampleProfileReader::mergeContextProfiles() {
+  SmallVector<StringRef, 8> Contexts;
+  for (const auto &I : Profiles)
+    if (SampleContext::isContext(I.first()))
+      Contexts.push_back(I.first());
+
+  sampleprof_error Result = sampleprof_error::success;
+  for (StringRef Name : Contexts) {
+    auto I = Profiles.find(Name);
+    const FunctionSamples &ContextSamples = I->second;
+    // Parse the name of the profile rather than its key: the key goes away
+    // with the profile, while the name is in the storage of the reader.
+    SampleContext Context;
+    if (!Context.parse(ContextSamples.getName())) {
+      reportError(0, "Malformed calling context " + Name);
+      return sampleprof_error::malformed;
+    }
+
+    ArrayRef<SampleContext::CallerFrame> Callers = Context.getCallers();
+    FunctionSamples *FS = &Profiles[Callers[0].FuncName];
+    if (FS->getName().empty())
+      FS->setName(Callers[0].FuncName);
+    // Samples are cumulative: every caller includes those of its callees.
+    for (unsigned C = 0, E = Callers.size(); C != E; ++C) {
+      MergeResult(Result,
+                  FS->addTotalSamples(ContextSamples.getTotalSamples()));
+      FS = &FS->functionSamplesAt(Callers[C].CallSite);
+      FS->setName(C + 1 != E ? Callers[C + 1].FuncName : Context.getCallee());
+    }
+    MergeResult(Result, FS->merge(ContextSamples));
+    FS->setName(Context.getCallee());
+
+    Profiles.erase(I);
+  }
+  return Result;
+}
+
 /// \brief Parse \p Input as function head.
 ///
 /// Parse one line of \p Input, and update function name in \p FName,
@@ -175,6 +215,14 @@ std::error_code SampleProfileReaderText::read() {
                     "Expected 'mangled_name:NUM:NUM', found " + *LineIt);
         return sampleprof_error::malformed;
       }
+      SampleContext Context;
+      if (SampleContext::isContext(FName) && !Context.parse(FName)) {
+        reportError(LineIt.line_number(),
+                    "Expected '[mangled_name:NUM[.NUM] @ ... @ "
+                    "mangled_name]:NUM:NUM', found " +
+                        *LineIt);
+        return sampleprof_error::malformed;
+      }
       Profiles[FName] = FunctionSamples();
       FunctionSamples &FProfile = Profiles[FName];
       FProfile.setName(FName);
@@ -362,30 +410,35 @@ SampleProfileReaderBinary::readProfile(FunctionSamples &FProfile) {
   return sampleprof_error::success;
 }
 
-std::error_code SampleProfileReaderBinary::read() {
-  while (!at_eof()) {
-    auto NumHeadSamples = readNumber<uint64_t>();
-    if (std::error_code EC = NumHeadSamples.getError())
-      return EC;
+std::error_code SampleProfileReaderBinary::readFuncProfile() {
+  auto NumHeadSamples = readNumber<uint64_t>();
+  if (std::error_code EC = NumHeadSamples.getError())
+    return EC;
 
-    auto FName(readStringFromTable());
-    if (std::error_code EC = FName.getError())
-      return EC;
+  auto FName(readStringFromTable());
+  if (std::error_code EC = FName.getError())
+    return EC;
+
+  Profiles[*FName] = FunctionSamples();
+  FunctionSamples &FProfile = Profiles[*FName];
+  FProfile.setName(*FName);
 
-    Profiles[*FName] = FunctionSamples();
-    FunctionSamples &FProfile = Profiles[*FName];
-    FProfile.setName(*FName);
+  FProfile.addHeadSamples(*NumHeadSamples);
 
-    FProfile.addHeadSamples(*NumHeadSamples);
+  return readProfile(FProfile);
+}
 
-    if (std::error_code EC = readProfile(FProfile))
+std::error_code SampleProfileReaderBinary::read() {
+  while (!at_eof()) {
+    if (std::error_code EC = readFuncProfile())
       return EC;
   }
 
   return sampleprof_error::success;
 }
 
-std::error_code SampleProfileReaderBinary::readHeader() {
+std::error_code
+SampleProfileReaderBinary::readPreamble(uint64_t ExpectedMagic) {
   Data = reinterpret_cast<const uint8_t *>(Buffer->getBufferStart());
   End = Data + Buffer->getBufferSize();
 
@@ -393,7 +446,7 @@ std::error_code SampleProfileReaderBinary::readHeader() {
   auto Magic = readNumber<uint64_t>();
   if (std::error_code EC = Magic.getError())
     return EC;
-  else if (*Magic != SPMagic())
+  else if (*Magic != ExpectedMagic)
     return sampleprof_error::bad_magic;
 
   // Read the version number.
@@ -403,7 +456,11 @@ std::error_code SampleProfileReaderBinary::readHeader() {
   else if (*Version != SPVersion())
     return sampleprof_error::unsupported_version;
 
-  if (std::error_code EC = readSummary())
+  return readSummary();
+}
+
+std::error_code SampleProfileReaderBinary::readHeader() {
+  if (std::error_code EC = readPreamble(SPMagic()))
     return EC;
 
   // Read the name table.
@@ -484,6 +541,101 @@ bool SampleProfileReaderBinary::hasFormat(const MemoryBuffer &Buffer) {
   return Magic == SPMagic();
 }
 
+std::error_code SampleProfileReaderExtBinary::readNameTable() {
+  auto Size = readNumber<uint32_t>();
+  if (std::error_code EC = Size.getError())
+    return EC;
+  NameTable.reserve(*Size);
+  StringRef Prev;
+  for (uint32_t I = 0; I < *Size; ++I) {
+    auto PrefixLength = readNumber<uint32_t>();
+    if (std::error_code EC = PrefixLength.getError())
+      return EC;
+    if (*PrefixLength > Prev.size())
+      return sampleprof_error::malformed;
+    auto Suffix(readString());
+    if (std::error_code EC = Suffix.getError())
+      return EC;
+    Prev = Saver.save(Prev.substr(0, *PrefixLength) + *Suffix);
+    NameTable.push_back(Prev);
+  }
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderExtBinary::readHeader() {
+  if (std::error_code EC = readPreamble(SPExtMagic()))
+    return EC;
+
+  if (std::error_code EC = readNameTable())
+    return EC;
+
+  // Read the function offset table. The offsets are only checked when the
+  // functions are read.
+  auto Size = readNumber<uint64_t>();
+  if (std::error_code EC = Size.getError())
+    return EC;
+  for (uint64_t I = 0; I < *Size; ++I) {
+    auto FName(readStringFromTable());
+    if (std::error_code EC = FName.getError())
+      return EC;
+    auto Offset = readNumber<uint64_t>();
+    if (std::error_code EC = Offset.getError())
+      return EC;
+    FuncOffsets[*FName] = *Offset;
+  }
+
+  FuncBodies = Data;
+  return sampleprof_error::success;
+}
+
+std::error_code
+SampleProfileReaderExtBinary::readFuncProfileAt(uint64_t Offset) {
+  if (Offset >= uint64_t(End - FuncBodies))
+    return sampleprof_error::truncated;
+  Data = FuncBodies + Offset;
+  return readFuncProfile();
+}
+
+std::error_code SampleProfileReaderExtBinary::read() {
+  for (const auto &I : FuncOffsets)
+    if (std::error_code EC = readFuncProfileAt(I.second))
+      return EC;
+  return sampleprof_error::success;
+}
+
+std::error_code SampleProfileReaderExtBinary::readProfilesFor(const Module &M) {
+  for (const Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    auto I = FuncOffsets.find(F.getName());
+    if (I == FuncOffsets.end())
+      continue;
+    if (std::error_code EC = readFuncProfileAt(I->second))
+      return EC;
+  }
+
+  // The calling contexts rooted in the functions of the module are needed as
+  // well.
+  for (const auto &I : FuncOffsets) {
+    SampleContext Context;
+    if (!SampleContext::isContext(I.first) || !Context.parse(I.first))
+      continue;
+    const Function *Root = M.getFunction(Context.getCallers()[0].FuncName);
+    if (!Root || Root->isDeclaration())
+      continue;
+    if (std::error_code EC = readFuncProfileAt(I.second))
+      return EC;
+  }
+  return sampleprof_error::success;
+}
+
+bool SampleProfileReaderExtBinary::hasFormat(const MemoryBuffer &Buffer) {
+  const uint8_t *Data =
+      reinterpret_cast<const uint8_t *>(Buffer.getBufferStart());
+  uint64_t Magic = decodeULEB128(Data);
+  return Magic == SPExtMagic();
+}
+
 std::error_code SampleProfileReaderGCC::skipNextWord() {
   uint32_t dummy;
   if (!GcovBuffer.readInt(dummy))
@@ -777,6 +929,8 @@ SampleProfileReader::create(std::unique_ptr<MemoryBuffer> &B, LLVMContext &C) {
   std::unique_ptr<SampleProfileReader> Reader;
   if (SampleProfileReaderBinary::hasFormat(*B))
     Reader.reset(new SampleProfileReaderBinary(std::move(B), C));
+  else if (SampleProfileReaderExtBinary::hasFormat(*B))
+    Reader.reset(new SampleProfileReaderExtBinary(std::move(B), C));
   else if (SampleProfileReaderGCC::hasFormat(*B))
     Reader.reset(new SampleProfileReaderGCC(std::move(B), C));
   else if (SampleProfileReaderText::hasFormat(*B))
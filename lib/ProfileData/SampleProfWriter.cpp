@@ -8,10 +8,11 @@
 //===----------------------------------------------------------------------===//
 //
 // This file implements the class that writes LLVM sample profiles. It
-// supports two file formats: text and binary. The textual representation
-// is useful for debugging and testing purposes. The binary representation
-// is more compact, resulting in smaller file sizes. However, they can
-// both be used interchangeably.
+// supports three file formats: text, binary and extended binary. The textual
+// representation is useful for debugging and testing purposes. The binary
+// representation is more compact, resulting in smaller file sizes, and the
+// extended binary one is indexed by function. However, they can all be used
+// interchangeably.
 //
 // See lib/ProfileData/SampleProfReader.cpp for documentation on each of the
 // supported formats.
@@ -19,6 +20,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ProfileData/SampleProfWriter.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/LEB128.h"
@@ -200,6 +202,80 @@ std::error_code SampleProfileWriterBinary::write(const FunctionSamples &S) {
   return writeBody(S);
 }
 
+std::error_code SampleProfileWriterExtBinary::writeHeader(
+    const StringMap<FunctionSamples> &ProfileMap) {
+  auto &OS = *OutputStream;
+
+  // Write file magic identifier.
+  encodeULEB128(SPExtMagic(), OS);
+  encodeULEB128(SPVersion(), OS);
+
+  computeSummary(ProfileMap);
+  if (auto EC = writeSummary())
+    return EC;
+
+  // Generate the name table for all the functions referenced in the profile,
+  // and sort it so that each name shares a prefix with the previous one.
+  for (const auto &I : ProfileMap) {
+    addName(I.first());
+    addNames(I.second);
+  }
+  std::vector<StringRef> Names;
+  for (const auto &N : NameTable)
+    Names.push_back(N.first);
+  std::sort(Names.begin(), Names.end());
+
+  // Write out the name table.
+  encodeULEB128(Names.size(), OS);
+  StringRef Prev;
+  for (unsigned I = 0, E = Names.size(); I != E; ++I) {
+    StringRef Name = Names[I];
+    NameTable[Name] = I;
+    size_t PrefixLength = 0;
+    size_t MaxLength = std::min(Prev.size(), Name.size());
+    while (PrefixLength < MaxLength && Prev[PrefixLength] == Name[PrefixLength])
+      ++PrefixLength;
+    encodeULEB128(PrefixLength, OS);
+    OS << Name.substr(PrefixLength);
+    encodeULEB128(0, OS);
+    Prev = Name;
+  }
+  return sampleprof_error::success;
+}
+
+/// \brief Write all the profiles to an extended binary file.
+///
+/// The function bodies are encoded in memory first, to compute the offsets
+/// of the function offset table that precedes them.
+std::error_code SampleProfileWriterExtBinary::write(
+    const StringMap<FunctionSamples> &ProfileMap) {
+  if (std::error_code EC = writeHeader(ProfileMap))
+    return EC;
+
+  SmallString<0> Bodies;
+  std::vector<std::pair<StringRef, uint64_t>> Offsets;
+  std::unique_ptr<raw_ostream> FileOS = std::move(OutputStream);
+  OutputStream.reset(new raw_svector_ostream(Bodies));
+  for (const auto &I : ProfileMap) {
+    Offsets.push_back(std::make_pair(I.first(), Bodies.size()));
+    if (std::error_code EC = SampleProfileWriterBinary::write(I.second)) {
+      OutputStream = std::move(FileOS);
+      return EC;
+    }
+  }
+  OutputStream = std::move(FileOS);
+
+  auto &OS = *OutputStream;
+  encodeULEB128(Offsets.size(), OS);
+  for (const auto &I : Offsets) {
+    if (std::error_code EC = writeNameIdx(I.first))
+      return EC;
+    encodeULEB128(I.second, OS);
+  }
+  OS << Bodies;
+  return sampleprof_error::success;
+}
+
 /// \brief Create a sample profile file writer based on the specified format.
 ///
 /// \param Filename The file to create.
@@ -213,7 +289,7 @@ ErrorOr<std::unique_ptr<SampleProfileWriter>>
 SampleProfileWriter::create(StringRef Filename, SampleProfileFormat Format) {
   std::error_code EC;
   std::unique_ptr<raw_ostream> OS;
-  if (Format == SPF_Binary)
+  if (Format == SPF_Binary || Format == SPF_Ext_Binary)
     OS.reset(new raw_fd_ostream(Filename, EC, sys::fs::F_None));
   else
     OS.reset(new raw_fd_ostream(Filename, EC, sys::fs::F_Text));
@@ -240,6 +316,8 @@ SampleProfileWriter::create(std::unique_ptr<raw_ostream> &OS,
 
   if (Format == SPF_Binary)
     Writer.reset(new SampleProfileWriterBinary(OS));
+  else if (Format == SPF_Ext_Binary)
+    Writer.reset(new SampleProfileWriterExtBinary(OS));
   else if (Format == SPF_Text)
     Writer.reset(new SampleProfileWriterText(OS));
   else if (Format == SPF_GCC)
@@ -26,10 +26,35 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 using namespace llvm;
 
 #define DEBUG_TYPE "apint"
 
+/// Returns the low 64 bits of the 128-bit product of \p X and \p Y, and sets
+/// \p High to its high 64 bits.
+static inline uint64_t mulWide(uint64_t X, uint64_t Y, uint64_t &High) {
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 Product = (unsigned __int128)X * Y;
+  High = (uint64_t)(Product >> 64);
+  return (uint64_t)Product;
+#elif defined(_MSC_VER) && defined(_M_X64)
+  return _umul128(X, Y, &High);
+#else
+  uint64_t LX = X & 0xffffffffULL, HX = X >> 32;
+  uint64_t LY = Y & 0xffffffffULL, HY = Y >> 32;
+  uint64_t LL = LX * LY, LH = LX * HY, HL = HX * LY, HH = HX * HY;
+  // The middle sum can't overflow: it is at most 3 * (2^32 - 1).
+  uint64_t Mid = (LL >> 32) + (LH & 0xffffffffULL) + (HL & 0xffffffffULL);
+  High = HH + (LH >> 32) + (HL >> 32) + (Mid >> 32);
+  return (Mid << 32) | (LL & 0xffffffffULL);
+#endif
+}
+
 /// A utility function for allocating memory, checking for allocation failures,
 /// and ensuring the contents are zeroed.
 inline static uint64_t* getClearedMemory(unsigned numWords) {
@@ -291,32 +316,17 @@ APInt& APInt::operator-=(const APInt& RHS) {
 /// @returns the carry out of the multiplication.
 /// @brief Multiply a multi-digit APInt by a single digit (64-bit) integer.
 static uint64_t mul_1(uint64_t dest[], uint64_t x[], unsigned len, uint64_t y) {
-  // Split y into high 32-bit part (hy)  and low 32-bit part (ly)
-  uint64_t ly = y & 0xffffffffULL, hy = y >> 32;
   uint64_t carry = 0;
 
   // For each digit of x.
   for (unsigned i = 0; i < len; ++i) {
-    // Split x into high and low words
-    uint64_t lx = x[i] & 0xffffffffULL;
-    uint64_t hx = x[i] >> 32;
-    // hasCarry - A flag to indicate if there is a carry to the next digit.
-    // hasCarry == 0, no carry
-    // hasCarry == 1, has carry
-    // hasCarry == 2, no carry and the calculation result == 0.
-    uint8_t hasCarry = 0;
-    dest[i] = carry + lx * ly;
-    // Determine if the add above introduces carry.
-    hasCarry = (dest[i] < carry) ? 1 : 0;
-    carry = hx * ly + (dest[i] >> 32) + (hasCarry ? (1ULL << 32) : 0);
-    // The upper limit of carry can be (2^32 - 1)(2^32 - 1) +
-    // (2^32 - 1) + 2^32 = 2^64.
-    hasCarry = (!carry && hasCarry) ? 1 : (!carry ? 2 : 0);
-
-    carry += (lx * hy) & 0xffffffffULL;
-    dest[i] = (carry << 32) | (dest[i] & 0xffffffffULL);
-    carry = (((!carry && hasCarry != 2) || hasCarry == 1) ? (1ULL << 32) : 0) +
-            (carry >> 32) + ((lx * hy) >> 32) + hx * hy;
+    // x[i] * y + carry can't overflow 128 bits: it is at most
+    // (2^64 - 1)(2^64 - 1) + (2^64 - 1) < 2^128.
+    uint64_t high;
+    uint64_t low = mulWide(x[i], y, high) + carry;
+    high += low < carry;
+    dest[i] = low;
+    carry = high;
   }
   return carry;
 }
@@ -328,27 +338,16 @@ static void mul(uint64_t dest[], uint64_t x[], unsigned xlen, uint64_t y[],
                 unsigned ylen) {
   dest[xlen] = mul_1(dest, x, xlen, y[0]);
   for (unsigned i = 1; i < ylen; ++i) {
-    uint64_t ly = y[i] & 0xffffffffULL, hy = y[i] >> 32;
-    uint64_t carry = 0, lx = 0, hx = 0;
+    uint64_t carry = 0;
     for (unsigned j = 0; j < xlen; ++j) {
-      lx = x[j] & 0xffffffffULL;
-      hx = x[j] >> 32;
-      // hasCarry - A flag to indicate if has carry.
-      // hasCarry == 0, no carry
-      // hasCarry == 1, has carry
-      // hasCarry == 2, no carry and the calculation result == 0.
-      uint8_t hasCarry = 0;
-      uint64_t resul = carry + lx * ly;
-      hasCarry = (resul < carry) ? 1 : 0;
-      carry = (hasCarry ? (1ULL << 32) : 0) + hx * ly + (resul >> 32);
-      hasCarry = (!carry && hasCarry) ? 1 : (!carry ? 2 : 0);
-
-      carry += (lx * hy) & 0xffffffffULL;
-      resul = (carry << 32) | (resul & 0xffffffffULL);
-      dest[i+j] += resul;
-      carry = (((!carry && hasCarry != 2) || hasCarry == 1) ? (1ULL << 32) : 0)+
-              (carry >> 32) + (dest[i+j] < resul ? 1 : 0) +
-              ((lx * hy) >> 32) + hx * hy;
+      // x[j] * y[i] + carry + dest[i+j] can't overflow 128 bits: it is at
+      // most (2^64 - 1)(2^64 - 1) + 2(2^64 - 1) = 2^128 - 1.
+      uint64_t high;
+      uint64_t low = mulWide(x[j], y[i], high) + carry;
+      high += low < carry;
+      dest[i+j] += low;
+      high += dest[i+j] < low;
+      carry = high;
     }
     dest[i+xlen] = carry;
   }
@@ -755,12 +754,11 @@ unsigned APInt::countPopulationSlowCase() const {
 /// non-overlapping, of Words words, by Shift, which must be less than 64.
 static void lshrNear(uint64_t *Dst, uint64_t *Src, unsigned Words,
                      unsigned Shift) {
-  uint64_t Carry = 0;
-  for (int I = Words - 1; I >= 0; --I) {
-    uint64_t Tmp = Src[I];
-    Dst[I] = (Tmp >> Shift) | Carry;
-    Carry = Tmp << (64 - Shift);
-  }
+  // Each word only depends on the source words, so that this loop can be
+  // vectorized. Going up also allows Dst == Src.
+  for (unsigned I = 0; I + 1 < Words; ++I)
+    Dst[I] = (Src[I] >> Shift) | (Src[I + 1] << (64 - Shift));
+  Dst[Words - 1] = Src[Words - 1] >> Shift;
 }
 
 APInt APInt::byteSwap() const {
@@ -1232,11 +1230,12 @@ APInt APInt::shlSlowCase(unsigned shiftAmt) const {
 
   // If we are shifting less than a word, do it the easy way
   if (shiftAmt < APINT_BITS_PER_WORD) {
-    uint64_t carry = 0;
-    for (unsigned i = 0; i < getNumWords(); i++) {
-      val[i] = pVal[i] << shiftAmt | carry;
-      carry = pVal[i] >> (APINT_BITS_PER_WORD - shiftAmt);
-    }
+    // Each word only depends on the source words, so that this loop can be
+    // vectorized.
+    val[0] = pVal[0] << shiftAmt;
+    for (unsigned i = 1; i < getNumWords(); i++)
+      val[i] = pVal[i] << shiftAmt |
+               pVal[i-1] >> (APINT_BITS_PER_WORD - shiftAmt);
     APInt Result(val, BitWidth);
     Result.clearUnusedBits();
     return Result;
@@ -1763,6 +1762,26 @@ void APInt::divide(const APInt LHS, unsigned lhsWords,
     }
     if (R)
       R[0] = remainder;
+#if defined(__SIZEOF_INT128__)
+  } else if (n == 2) {
+    // With native 128-bit division, a divisor of a single 64-bit word can
+    // also use short division, in base 2^64.
+    uint64_t divisor = uint64_t(V[1]) << 32 | V[0];
+    uint64_t remainder = 0;
+    for (int i = (m+n+1)/2 - 1; i >= 0; i--) {
+      unsigned __int128 partial_dividend =
+          (unsigned __int128)remainder << 64 |
+          (uint64_t(U[i*2+1]) << 32 | U[i*2]);
+      uint64_t quotient = (uint64_t)(partial_dividend / divisor);
+      remainder = (uint64_t)(partial_dividend % divisor);
+      Q[i*2] = (unsigned)quotient;
+      Q[i*2+1] = (unsigned)(quotient >> 32);
+    }
+    if (R) {
+      R[0] = (unsigned)remainder;
+      R[1] = (unsigned)(remainder >> 32);
+    }
+#endif
   } else {
     // Now we're ready to invoke the Knuth classical divide algorithm. In this
     // case n > 1.
@@ -2291,9 +2310,8 @@ void APInt::print(raw_ostream &OS, bool isSigned) const {
 // This implements a variety of operations on a representation of
 // arbitrary precision, two's-complement, bignum integer values.
 
-// Assumed by lowHalf, highHalf, partMSB and partLSB.  A fairly safe
-// and unrestricting assumption.
-static_assert(integerPartWidth % 2 == 0, "Part width must be divisible by 2!");
+// Assumed by mulWide, which multiplies whole parts.
+static_assert(integerPartWidth == 64, "Parts must be 64 bits wide!");
 
 /* Some handy functions local to this file.  */
 namespace {
@@ -2308,20 +2326,6 @@ namespace {
     return ~(integerPart) 0 >> (integerPartWidth - bits);
   }
 
-  /* Returns the value of the lower half of PART.  */
-  static inline integerPart
-  lowHalf(integerPart part)
-  {
-    return part & lowBitMask(integerPartWidth / 2);
-  }
-
-  /* Returns the value of the upper half of PART.  */
-  static inline integerPart
-  highHalf(integerPart part)
-  {
-    return part >> (integerPartWidth / 2);
-  }
-
   /* Returns the bit number of the most significant set bit of a part.
      If the input number has no bits set -1U is returned.  */
   static unsigned int
@@ -2559,7 +2563,7 @@ APInt::tcMultiplyPart(integerPart *dst, const integerPart *src,
   n = dstParts < srcParts ? dstParts: srcParts;
 
   for (i = 0; i < n; i++) {
-    integerPart low, mid, high, srcPart;
+    integerPart low, high, srcPart;
 
       /* [ LOW, HIGH ] = MULTIPLIER * SRC[i] + DST[i] + CARRY.
 
@@ -2575,22 +2579,7 @@ APInt::tcMultiplyPart(integerPart *dst, const integerPart *src,
       low = carry;
       high = 0;
     } else {
-      low = lowHalf(srcPart) * lowHalf(multiplier);
-      high = highHalf(srcPart) * highHalf(multiplier);
-
-      mid = lowHalf(srcPart) * highHalf(multiplier);
-      high += highHalf(mid);
-      mid <<= integerPartWidth / 2;
-      if (low + mid < low)
-        high++;
-      low += mid;
-
-      mid = highHalf(srcPart) * lowHalf(multiplier);
-      high += highHalf(mid);
-      mid <<= integerPartWidth / 2;
-      if (low + mid < low)
-        high++;
-      low += mid;
+      low = mulWide(srcPart, multiplier, high);
 
       /* Now add carry.  */
       if (low + carry < low)
@@ -7,12 +7,14 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements the BumpPtrAllocator interface.
+// This file implements the BumpPtrAllocator interface and the SlabPool.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 
 namespace llvm {
 
@@ -29,6 +31,104 @@ void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
 
 } // End namespace detail.
 
+namespace {
+/// The cached sizes are 4 KB << I for I in [0, NumSlabSizeClasses).
+const unsigned MinSlabSizeLog2 = 12;
+const unsigned NumSlabSizeClasses = 9;
+
+/// A cached slab stores the link to the next one in its first bytes.
+struct FreeSlab {
+  FreeSlab *Next;
+};
+
+struct ThreadSlabCache {
+  FreeSlab *Lists[NumSlabSizeClasses];
+  size_t Bytes;
+};
+} // end anonymous namespace
+
+static LLVM_THREAD_LOCAL ThreadSlabCache SlabCache;
+
+static std::atomic<size_t> SlabCacheLimit(4 << 20);
+static std::atomic<uint64_t> NumSlabHits(0), NumSlabMisses(0),
+    NumSlabsRecycled(0), NumSlabsReleased(0);
+
+/// Return the size class of \p Size, or -1 if slabs of that size are not
+/// cached.
+static int getSlabSizeClass(size_t Size) {
+  if (Size < (size_t(1) << MinSlabSizeLog2) || !isPowerOf2_64(Size))
+    return -1;
+  unsigned Class = Log2_64(Size) - MinSlabSizeLog2;
+  return Class < NumSlabSizeClasses ? int(Class) : -1;
+}
+
+void *SlabPool::allocate(size_t Size) {
+  int Class = getSlabSizeClass(Size);
+  if (Class < 0)
+    return malloc(Size);
+
+  if (FreeSlab *Slab = SlabCache.Lists[Class]) {
+    SlabCache.Lists[Class] = Slab->Next;
+    SlabCache.Bytes -= Size;
+    NumSlabHits.fetch_add(1, std::memory_order_relaxed);
+    __asan_unpoison_memory_region(Slab, Size);
+    return Slab;
+  }
+  NumSlabMisses.fetch_add(1, std::memory_order_relaxed);
+  return malloc(Size);
+}
+
+void SlabPool::deallocate(const void *Ptr, size_t Size) {
+  int Class = getSlabSizeClass(Size);
+  if (Class < 0) {
+    free(const_cast<void *>(Ptr));
+    return;
+  }
+
+  if (SlabCache.Bytes + Size > SlabCacheLimit.load(std::memory_order_relaxed)) {
+    NumSlabsReleased.fetch_add(1, std::memory_order_relaxed);
+    free(const_cast<void *>(Ptr));
+    return;
+  }
+
+  // The allocator that owned the slab may have poisoned it.
+  __asan_unpoison_memory_region(Ptr, sizeof(FreeSlab));
+  FreeSlab *Slab = static_cast<FreeSlab *>(const_cast<void *>(Ptr));
+  Slab->Next = SlabCache.Lists[Class];
+  SlabCache.Lists[Class] = Slab;
+  SlabCache.Bytes += Size;
+  NumSlabsRecycled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void SlabPool::releaseThreadCache() {
+  for (FreeSlab *&List : SlabCache.Lists) {
+    while (FreeSlab *Slab = List) {
+      List = Slab->Next;
+      free(Slab);
+    }
+  }
+  SlabCache.Bytes = 0;
+}
+
+size_t SlabPool::getThreadCacheSize() { return SlabCache.Bytes; }
+
+void SlabPool::setThreadCacheLimit(size_t Bytes) {
+  SlabCacheLimit.store(Bytes, std::memory_order_relaxed);
+}
+
+size_t SlabPool::getThreadCacheLimit() {
+  return SlabCacheLimit.load(std::memory_order_relaxed);
+}
+
+SlabPool::Statistics SlabPool::getStatistics() {
+  Statistics Stats;
+  Stats.Hits = NumSlabHits.load(std::memory_order_relaxed);
+  Stats.Misses = NumSlabMisses.load(std::memory_order_relaxed);
+  Stats.Recycled = NumSlabsRecycled.load(std::memory_order_relaxed);
+  Stats.Released = NumSlabsReleased.load(std::memory_order_relaxed);
+  return Stats;
+}
+
 void PrintRecyclerStats(size_t Size,
                         size_t Align,
                         size_t FreeListSize) {
@@ -13,18 +13,204 @@
 
 #include "llvm/Support/CachePruning.h"
 
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "cache-pruning"
 
+STATISTIC(NumExpiredFiles, "Number of cache files pruned because they expired");
+STATISTIC(NumEvictedFiles,
+          "Number of cache files pruned to honor the cache size limit");
+
+#include <algorithm>
 #include <set>
 
 using namespace llvm;
 
+// The index lists the entries of the cache, one record per line:
+//   <entry name> <size in bytes> <last access time in seconds since the epoch>
+// The journal has the same format, and recordAccess appends a record to it for
+// each entry that is written or read. Pruning moves the journal aside, so that
+// new records go to a new one, and merges it into the index, the later records
+// overriding the earlier ones.
+static const char IndexFileName[] = "llvmcache.index";
+static const char JournalFileName[] = "llvmcache.journal";
+
+namespace {
+struct IndexEntry {
+  uint64_t Size = 0;
+  uint64_t AccessTime = 0;
+};
+} // end anonymous namespace
+
+/// Return true if \p Name is one of the files that the pruning keeps in the
+/// cache directory, including the temporary ones.
+static bool isPruningFile(StringRef Name) {
+  return Name == "llvmcache.timestamp" || Name.startswith(IndexFileName) ||
+         Name.startswith(JournalFileName);
+}
+
+/// Read the records of an index or journal file into \p Entries.
+static void readIndexRecords(StringRef File, StringMap<IndexEntry> &Entries) {
+  auto BufferOrErr = MemoryBuffer::getFile(File);
+  if (!BufferOrErr)
+    return;
+  StringRef Buffer = (*BufferOrErr)->getBuffer();
+  // A record that an interrupted append left without its newline is ignored.
+  for (size_t End = Buffer.find('\n'); End != StringRef::npos;
+       End = Buffer.find('\n')) {
+    StringRef Line = Buffer.substr(0, End);
+    Buffer = Buffer.substr(End + 1);
+    StringRef Rest, Name, SizeStr, TimeStr;
+    std::tie(Rest, TimeStr) = Line.rsplit(' ');
+    std::tie(Name, SizeStr) = Rest.rsplit(' ');
+    IndexEntry Entry;
+    if (Name.empty() || SizeStr.getAsInteger(10, Entry.Size) ||
+        TimeStr.getAsInteger(10, Entry.AccessTime))
+      continue;
+    Entries[Name] = Entry;
+  }
+}
+
+/// Move the journal of the cache directory \p Path aside and read its records
+/// into \p Entries.
+static void consumeJournal(StringRef Path, StringMap<IndexEntry> &Entries) {
+  SmallString<128> Journal(Path);
+  sys::path::append(Journal, JournalFileName);
+  SmallString<128> Consumed;
+  if (sys::fs::createUniqueFile(Journal + "-%%%%%%", Consumed))
+    return;
+  if (sys::fs::rename(Journal, Consumed)) {
+    sys::fs::remove(Consumed);
+    return;
+  }
+  readIndexRecords(Consumed, Entries);
+  sys::fs::remove(Consumed);
+}
+
+/// Replace the index of the cache directory \p Path with \p Entries.
+static void writeIndex(StringRef Path, const StringMap<IndexEntry> &Entries) {
+  SmallString<128> Index(Path);
+  sys::path::append(Index, IndexFileName);
+  SmallString<128> TempIndex;
+  int FD;
+  if (sys::fs::createUniqueFile(Index + "-%%%%%%", FD, TempIndex))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (const auto &Entry : Entries)
+      OS << Entry.first() << ' ' << Entry.second.Size << ' '
+         << Entry.second.AccessTime << '\n';
+  }
+  if (sys::fs::rename(TempIndex, Index))
+    sys::fs::remove(TempIndex);
+}
+
+void CachePruning::recordAccess(StringRef Path, StringRef EntryName,
+                                uint64_t Size) {
+  SmallString<128> Journal(Path);
+  sys::path::append(Journal, JournalFileName);
+  // Format the record first, so that it is appended with a single write and
+  // the records of concurrent processes do not interleave.
+  SmallString<128> Record;
+  raw_svector_ostream(Record) << EntryName << ' ' << Size << ' '
+                              << sys::TimeValue::now().toEpochTime() << '\n';
+  std::error_code EC;
+  raw_fd_ostream OS(Journal, EC, sys::fs::F_Append | sys::fs::F_Text);
+  if (!EC)
+    OS << Record;
+}
+
+void CachePruning::pruneWithIndex(uint64_t Now) {
+  StringMap<IndexEntry> Entries;
+  SmallString<128> IndexFile(Path);
+  sys::path::append(IndexFile, IndexFileName);
+  if (sys::fs::exists(IndexFile)) {
+    readIndexRecords(IndexFile, Entries);
+  } else {
+    DEBUG(dbgs() << "Building the cache index\n");
+    std::error_code EC;
+    for (sys::fs::directory_iterator File(Path, EC, /*FetchStatus=*/true),
+         FileEnd;
+         File != FileEnd && !EC; File.increment(EC)) {
+      StringRef Name = sys::path::filename(File->path());
+      sys::fs::file_status Status;
+      if (isPruningFile(Name) || File->status(Status) ||
+          !sys::fs::is_regular_file(Status))
+        continue;
+      IndexEntry &Entry = Entries[Name];
+      Entry.Size = Status.getSize();
+      Entry.AccessTime = Status.getLastAccessedTime().toEpochTime();
+    }
+  }
+  consumeJournal(Path, Entries);
+
+  auto Remove = [&](StringMapEntry<IndexEntry> *Entry) {
+    SmallString<128> EntryPath(Path);
+    sys::path::append(EntryPath, Entry->first());
+    sys::fs::remove(EntryPath);
+    Entries.remove(Entry);
+    Entry->Destroy();
+  };
+
+  // Remove the entries that expired, and sort the others from the least
+  // recently used.
+  std::vector<StringMapEntry<IndexEntry> *> ByAccessTime;
+  std::vector<StringMapEntry<IndexEntry> *> Expired;
+  uint64_t TotalSize = 0;
+  for (auto &Entry : Entries) {
+    if (Expiration && Entry.second.AccessTime + Expiration < Now) {
+      Expired.push_back(&Entry);
+      continue;
+    }
+    TotalSize += Entry.second.Size;
+    ByAccessTime.push_back(&Entry);
+  }
+  for (auto *Entry : Expired) {
+    DEBUG(dbgs() << "Remove " << Entry->first() << " (expired)\n");
+    Remove(Entry);
+    ++NumExpired;
+    ++NumExpiredFiles;
+  }
+  std::sort(ByAccessTime.begin(), ByAccessTime.end(),
+            [](const StringMapEntry<IndexEntry> *A,
+               const StringMapEntry<IndexEntry> *B) {
+              return A->second.AccessTime < B->second.AccessTime;
+            });
+
+  // Remove the least recently used entries until the cache fits its limits.
+  uint64_t SizeLimit = MaxSizeBytes;
+  if (PercentageOfAvailableSpace) {
+    auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
+    if (!ErrOrSpaceInfo)
+      report_fatal_error("Can't get available size");
+    uint64_t Limit =
+        (TotalSize + ErrOrSpaceInfo->free) / 100 * PercentageOfAvailableSpace;
+    if (!SizeLimit || Limit < SizeLimit)
+      SizeLimit = Limit;
+  }
+  if (SizeLimit)
+    for (auto *Entry : ByAccessTime) {
+      if (TotalSize <= SizeLimit)
+        break;
+      TotalSize -= std::min(TotalSize, Entry->second.Size);
+      DEBUG(dbgs() << " - Remove " << Entry->first() << " (size "
+                   << Entry->second.Size << "), new cache size is "
+                   << TotalSize << "\n");
+      Remove(Entry);
+      ++NumEvicted;
+      ++NumEvictedFiles;
+    }
+
+  writeIndex(Path, Entries);
+}
+
 /// Write a new timestamp file with the given path. This is used for the pruning
 /// interval option.
 static void writeTimestampFile(StringRef TimestampFile) {
@@ -34,6 +220,7 @@ static void writeTimestampFile(StringRef TimestampFile) {
 
 /// Prune the cache of files that haven't been accessed in a long time.
 bool CachePruning::prune() {
+  NumExpired = NumEvicted = 0;
   if (Path.empty())
     return false;
 
@@ -44,7 +231,8 @@ bool CachePruning::prune() {
   if (!isPathDir)
     return false;
 
-  if (Expiration == 0 && PercentageOfAvailableSpace == 0) {
+  if (Expiration == 0 && PercentageOfAvailableSpace == 0 &&
+      MaxSizeBytes == 0) {
     DEBUG(dbgs() << "No pruning settings set, exit early\n");
     // Nothing will be pruned, early exit
     return false;
@@ -82,7 +270,12 @@ bool CachePruning::prune() {
     writeTimestampFile(TimestampFile);
   }
 
-  bool ShouldComputeSize = (PercentageOfAvailableSpace > 0);
+  if (UseIndex) {
+    pruneWithIndex(CurrentTime.toEpochTime());
+    return true;
+  }
+
+  bool ShouldComputeSize = PercentageOfAvailableSpace > 0 || MaxSizeBytes > 0;
 
   // Keep track of space
   std::set<std::pair<uint64_t, std::string>> FileSizes;
@@ -103,8 +296,11 @@ bool CachePruning::prune() {
   SmallString<128> CachePathNative;
   sys::path::native(Path, CachePathNative);
   auto TimeExpiration = sys::TimeValue(sys::TimeValue::SecondsType(Expiration));
-  // Walk all of the files within this directory.
-  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
+  // Walk all of the files within this directory, getting their status along
+  // with the entries.
+  for (sys::fs::directory_iterator File(CachePathNative, EC,
+                                        /*FetchStatus=*/true),
+       FileEnd;
        File != FileEnd && !EC; File.increment(EC)) {
     // Do not touch the timestamp.
     if (File->path() == TimestampFile)
@@ -112,7 +308,7 @@ bool CachePruning::prune() {
 
     // Look at this file. If we can't stat it, there's nothing interesting
     // there.
-    if (sys::fs::status(File->path(), FileStatus)) {
+    if (File->status(FileStatus)) {
       DEBUG(dbgs() << "Ignore " << File->path() << " (can't stat)\n");
       continue;
     }
@@ -120,10 +316,12 @@ bool CachePruning::prune() {
     // If the file hasn't been used recently enough, delete it
     sys::TimeValue FileAccessTime = FileStatus.getLastAccessedTime();
     auto FileAge = CurrentTime - FileAccessTime;
-    if (FileAge > TimeExpiration) {
+    if (Expiration && FileAge > TimeExpiration) {
       DEBUG(dbgs() << "Remove " << File->path() << " (" << FileAge.seconds()
                    << "s old)\n");
       sys::fs::remove(File->path());
+      ++NumExpired;
+      ++NumExpiredFiles;
       continue;
     }
 
@@ -142,11 +340,18 @@ bool CachePruning::prune() {
     auto FileAndSize = FileSizes.rbegin();
     DEBUG(dbgs() << "Occupancy: " << ((100 * TotalSize) / AvailableSpace)
                  << "% target is: " << PercentageOfAvailableSpace << "\n");
+    auto IsTooLarge = [&]() {
+      if (PercentageOfAvailableSpace &&
+          ((100 * TotalSize) / AvailableSpace) > PercentageOfAvailableSpace)
+        return true;
+      return MaxSizeBytes && TotalSize > MaxSizeBytes;
+    };
     // Remove the oldest accessed files first, till we get below the threshold
-    while (((100 * TotalSize) / AvailableSpace) > PercentageOfAvailableSpace &&
-           FileAndSize != FileSizes.rend()) {
+    while (IsTooLarge() && FileAndSize != FileSizes.rend()) {
       // Remove the file.
       sys::fs::remove(FileAndSize->second);
+      ++NumEvicted;
+      ++NumEvictedFiles;
       // Update size
       TotalSize -= FileAndSize->first;
       DEBUG(dbgs() << " - Remove " << FileAndSize->second << " (size "
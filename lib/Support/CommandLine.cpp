@@ -34,6 +34,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/StringSaver.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 #include <cstdlib>
 #include <map>
 using namespace llvm;
@@ -129,6 +130,17 @@ public:
       }
     }
 
+    // Literal options added before the option was registered.
+    SmallVector<StringRef, 16> LiteralNames;
+    O->getExtraOptionNames(LiteralNames);
+    for (StringRef Name : LiteralNames) {
+      if (!OptionsMap.insert(std::make_pair(Name, O)).second) {
+        errs() << ProgramName << ": CommandLine Error: Option '" << Name
+               << "' registered more than once!\n";
+        HadErrors = true;
+      }
+    }
+
     // Remember information about positional options.
     if (O->getFormattingFlag() == cl::Positional)
       PositionalOpts.push_back(O);
@@ -210,26 +222,65 @@ private:
 
 } // namespace
 
-static ManagedStatic<CommandLineParser> GlobalParser;
+static ManagedStatic<CommandLineParser> GlobalParserStorage;
+
+// Options and categories are constructed by static initializers, often by the
+// thousand. Rather than building the parser's tables then, they are pushed on
+// these lists and only handed to the parser when it is first used. The lists
+// are constant-initialized, so they can be used by any static initializer.
+static std::atomic<Option *> PendingOptions(nullptr);
+static std::atomic<OptionCategory *> PendingCategories(nullptr);
+
+template <typename T> static void pushPending(std::atomic<T *> &List, T *X) {
+  T *Head = List.load(std::memory_order_relaxed);
+  do
+    X->NextPending = Head;
+  while (!List.compare_exchange_weak(Head, X, std::memory_order_release,
+                                     std::memory_order_relaxed));
+}
+
+// Take the whole list, in the order the elements were pushed.
+template <typename T>
+static SmallVector<T *, 0> takePending(std::atomic<T *> &List) {
+  SmallVector<T *, 0> Elements;
+  for (T *X = List.exchange(nullptr, std::memory_order_acquire); X;
+       X = X->NextPending)
+    Elements.push_back(X);
+  std::reverse(Elements.begin(), Elements.end());
+  return Elements;
+}
+
+static CommandLineParser *getGlobalParser() {
+  CommandLineParser *Parser = &*GlobalParserStorage;
+  if (PendingCategories.load(std::memory_order_relaxed))
+    for (OptionCategory *Cat : takePending(PendingCategories))
+      Parser->registerCategory(Cat);
+  if (PendingOptions.load(std::memory_order_relaxed))
+    for (Option *O : takePending(PendingOptions)) {
+      Parser->addOption(O);
+      O->FullyInitialized = true;
+    }
+  return Parser;
+}
 
 void cl::AddLiteralOption(Option &O, const char *Name) {
-  GlobalParser->addLiteralOption(O, Name);
+  // Until the option is registered its literals are only known to its parser,
+  // which hands them to addOption through getExtraOptionNames.
+  if (O.FullyInitialized)
+    getGlobalParser()->addLiteralOption(O, Name);
 }
 
 extrahelp::extrahelp(const char *Help) : morehelp(Help) {
-  GlobalParser->MoreHelp.push_back(Help);
+  getGlobalParser()->MoreHelp.push_back(Help);
 }
 
-void Option::addArgument() {
-  GlobalParser->addOption(this);
-  FullyInitialized = true;
-}
+void Option::addArgument() { pushPending(PendingOptions, this); }
 
-void Option::removeArgument() { GlobalParser->removeOption(this); }
+void Option::removeArgument() { getGlobalParser()->removeOption(this); }
 
 void Option::setArgStr(StringRef S) {
   if (FullyInitialized)
-    GlobalParser->updateArgStr(this, S);
+    getGlobalParser()->updateArgStr(this, S);
   ArgStr = S;
 }
 
@@ -237,7 +288,7 @@ void Option::setArgStr(StringRef S) {
 OptionCategory llvm::cl::GeneralCategory("General options");
 
 void OptionCategory::registerCategory() {
-  GlobalParser->registerCategory(this);
+  pushPending(PendingCategories, this);
 }
 
 //===----------------------------------------------------------------------===//
@@ -426,12 +477,15 @@ static inline bool isPrefixedOrGrouping(const Option *O) {
 // specified predicate with names that are the prefixes in Name.  This is
 // checked by progressively stripping characters off of the name, checking to
 // see if there options that satisfy the predicate.  If we find one, return it,
-// otherwise return null.
+// otherwise return null.  No option name is longer than MaxNameLength, so the
+// longer prefixes are not looked up.
 //
 static Option *getOptionPred(StringRef Name, size_t &Length,
                              bool (*Pred)(const Option *),
-                             const StringMap<Option *> &OptionsMap) {
-
+                             const StringMap<Option *> &OptionsMap,
+                             size_t MaxNameLength) {
+  if (MaxNameLength)
+    Name = Name.substr(0, MaxNameLength);
   StringMap<Option *>::const_iterator OMI = OptionsMap.find(Name);
 
   // Loop while we haven't found an option and Name still has at least two
@@ -456,13 +510,15 @@ static Option *getOptionPred(StringRef Name, size_t &Length,
 static Option *
 HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
                               bool &ErrorParsing,
-                              const StringMap<Option *> &OptionsMap) {
+                              const StringMap<Option *> &OptionsMap,
+                              size_t MaxNameLength) {
   if (Arg.size() == 1)
     return nullptr;
 
   // Do the lookup!
   size_t Length = 0;
-  Option *PGOpt = getOptionPred(Arg, Length, isPrefixedOrGrouping, OptionsMap);
+  Option *PGOpt = getOptionPred(Arg, Length, isPrefixedOrGrouping, OptionsMap,
+                                MaxNameLength);
   if (!PGOpt)
     return nullptr;
 
@@ -494,7 +550,7 @@ HandlePrefixedOrGroupedOption(StringRef &Arg, StringRef &Value,
         ProvideOption(PGOpt, OneArgName, StringRef(), 0, nullptr, Dummy);
 
     // Get the next grouping option.
-    PGOpt = getOptionPred(Arg, Length, isGrouping, OptionsMap);
+    PGOpt = getOptionPred(Arg, Length, isGrouping, OptionsMap, MaxNameLength);
   } while (PGOpt && Length != Arg.size());
 
   // Return the last option with Arg cut down to just the last one.
@@ -557,7 +613,7 @@ void cl::TokenizeGNUCommandLine(StringRef Src, StringSaver &Saver,
     // End the token if this is whitespace.
     if (isWhitespace(Src[I])) {
       if (!Token.empty())
-        NewArgv.push_back(Saver.save(Token.c_str()));
+        NewArgv.push_back(Saver.save(StringRef(Token)));
       Token.clear();
       continue;
     }
@@ -568,7 +624,7 @@ void cl::TokenizeGNUCommandLine(StringRef Src, StringSaver &Saver,
 
   // Append the last token after hitting EOF with no whitespace.
   if (!Token.empty())
-    NewArgv.push_back(Saver.save(Token.c_str()));
+    NewArgv.push_back(Saver.save(StringRef(Token)));
   // Mark the end of response files
   if (MarkEOLs)
     NewArgv.push_back(nullptr);
@@ -649,7 +705,7 @@ void cl::TokenizeWindowsCommandLine(StringRef Src, StringSaver &Saver,
     if (State == UNQUOTED) {
       // Whitespace means the end of the token.
       if (isWhitespace(Src[I])) {
-        NewArgv.push_back(Saver.save(Token.c_str()));
+        NewArgv.push_back(Saver.save(StringRef(Token)));
         Token.clear();
         State = INIT;
         // Mark the end of lines in response files
@@ -684,7 +740,7 @@ void cl::TokenizeWindowsCommandLine(StringRef Src, StringSaver &Saver,
   }
   // Append the last token after hitting EOF with no whitespace.
   if (!Token.empty())
-    NewArgv.push_back(Saver.save(Token.c_str()));
+    NewArgv.push_back(Saver.save(StringRef(Token)));
   // Mark the end of response files
   if (MarkEOLs)
     NewArgv.push_back(nullptr);
@@ -727,49 +783,76 @@ static bool ExpandResponseFile(const char *FName, StringSaver &Saver,
   return true;
 }
 
-/// \brief Expand response files on a command line recursively using the given
-/// StringSaver and tokenization strategy.
-bool cl::ExpandResponseFiles(StringSaver &Saver, TokenizerCallback Tokenizer,
-                             SmallVectorImpl<const char *> &Argv,
-                             bool MarkEOLs) {
+static bool isResponseFileArg(const char *Arg) {
+  // EOL markers are null.
+  return Arg && Arg[0] == '@';
+}
+
+namespace {
+/// \brief The state of the expansion of the response files of a command line.
+struct ResponseFileExpander {
+  StringSaver &Saver;
+  TokenizerCallback Tokenizer;
+  bool MarkEOLs;
   unsigned RspFiles = 0;
   bool AllExpanded = true;
+  bool TooManyRspFiles = false;
+
+  ResponseFileExpander(StringSaver &Saver, TokenizerCallback Tokenizer,
+                       bool MarkEOLs)
+      : Saver(Saver), Tokenizer(Tokenizer), MarkEOLs(MarkEOLs) {}
+
+  /// Append Args to Out, with the response files replaced by the
+  /// tokenization of their contents, recursively.
+  void expand(ArrayRef<const char *> Args, SmallVectorImpl<const char *> &Out) {
+    for (const char *Arg : Args) {
+      if (!isResponseFileArg(Arg) || TooManyRspFiles) {
+        Out.push_back(Arg);
+        continue;
+      }
 
-  // Don't cache Argv.size() because it can change.
-  for (unsigned I = 0; I != Argv.size();) {
-    const char *Arg = Argv[I];
-    // Check if it is an EOL marker
-    if (Arg == nullptr) {
-      ++I;
-      continue;
-    }
-    if (Arg[0] != '@') {
-      ++I;
-      continue;
-    }
-
-    // If we have too many response files, leave some unexpanded.  This avoids
-    // crashing on self-referential response files.
-    if (RspFiles++ > 20)
-      return false;
+      // If we have too many response files, leave the rest unexpanded.  This
+      // avoids crashing on self-referential response files.
+      if (RspFiles++ > 20) {
+        TooManyRspFiles = true;
+        Out.push_back(Arg);
+        continue;
+      }
 
-    // Replace this response file argument with the tokenization of its
-    // contents.  Nested response files are expanded in subsequent iterations.
-    // FIXME: If a nested response file uses a relative path, is it relative to
-    // the cwd of the process or the response file?
-    SmallVector<const char *, 0> ExpandedArgv;
-    if (!ExpandResponseFile(Arg + 1, Saver, Tokenizer, ExpandedArgv,
-                            MarkEOLs)) {
-      // We couldn't read this file, so we leave it in the argument stream and
-      // move on.
-      AllExpanded = false;
-      ++I;
-      continue;
+      // FIXME: If a nested response file uses a relative path, is it relative
+      // to the cwd of the process or the response file?
+      SmallVector<const char *, 0> ExpandedArgv;
+      if (!ExpandResponseFile(Arg + 1, Saver, Tokenizer, ExpandedArgv,
+                              MarkEOLs)) {
+        // We couldn't read this file, so we leave it in the argument stream
+        // and move on.
+        AllExpanded = false;
+        Out.push_back(Arg);
+        continue;
+      }
+      expand(ExpandedArgv, Out);
     }
-    Argv.erase(Argv.begin() + I);
-    Argv.insert(Argv.begin() + I, ExpandedArgv.begin(), ExpandedArgv.end());
   }
-  return AllExpanded;
+};
+} // end anonymous namespace
+
+/// \brief Expand response files on a command line recursively using the given
+/// StringSaver and tokenization strategy.
+bool cl::ExpandResponseFiles(StringSaver &Saver, TokenizerCallback Tokenizer,
+                             SmallVectorImpl<const char *> &Argv,
+                             bool MarkEOLs) {
+  if (std::none_of(Argv.begin(), Argv.end(), isResponseFileArg))
+    return true;
+
+  // Build the expanded command line in a single pass, rather than splicing the
+  // contents of each response file into Argv, which moves all the arguments
+  // after it every time.
+  ResponseFileExpander Expander(Saver, Tokenizer, MarkEOLs);
+  SmallVector<const char *, 0> Expanded;
+  Expanded.reserve(Argv.size());
+  Expander.expand(Argv, Expanded);
+  Argv.swap(Expanded);
+  return Expander.AllExpanded && !Expander.TooManyRspFiles;
 }
 
 /// ParseEnvironmentOptions - An alternative entry point to the
@@ -823,7 +906,7 @@ void cl::ParseEnvironmentOptions(const char *progName, const char *envVar,
 
 void cl::ParseCommandLineOptions(int argc, const char *const *argv,
                                  const char *Overview) {
-  GlobalParser->ParseCommandLineOptions(argc, argv, Overview);
+  getGlobalParser()->ParseCommandLineOptions(argc, argv, Overview);
 }
 
 void CommandLineParser::ParseCommandLineOptions(int argc,
@@ -899,6 +982,10 @@ void CommandLineParser::ParseCommandLineOptions(int argc,
   // the positional args into the PositionalVals list...
   Option *ActivePositionalArg = nullptr;
 
+  // The length of the longest option name, computed the first time that an
+  // argument does not name an option exactly.
+  size_t MaxOptionNameLength = 0;
+
   // Loop over all of the arguments... processing them.
   bool DashDashFound = false; // Have we read '--'?
   for (int i = 1; i < argc; ++i) {
@@ -963,9 +1050,14 @@ void CommandLineParser::ParseCommandLineOptions(int argc,
       Handler = LookupOption(ArgName, Value);
 
       // Check to see if this "option" is really a prefixed or grouped argument.
-      if (!Handler)
+      if (!Handler) {
+        if (!MaxOptionNameLength)
+          for (const auto &Entry : OptionsMap)
+            MaxOptionNameLength =
+                std::max<size_t>(MaxOptionNameLength, Entry.getKeyLength());
         Handler = HandlePrefixedOrGroupedOption(ArgName, Value, ErrorParsing,
-                                                OptionsMap);
+                                                OptionsMap, MaxOptionNameLength);
+      }
 
       // Otherwise, look for the closest available option to report to the user
       // in the upcoming error.
@@ -1124,7 +1216,7 @@ bool Option::error(const Twine &Message, StringRef ArgName) {
   if (ArgName.empty())
     errs() << HelpStr; // Be nice for positional arguments
   else
-    errs() << GlobalParser->ProgramName << ": for the -" << ArgName;
+    errs() << getGlobalParser()->ProgramName << ": for the -" << ArgName;
 
   errs() << " option: " << Message << "\n";
   return true;
@@ -1512,22 +1604,22 @@ public:
       return;
 
     StrOptionPairVector Opts;
-    sortOpts(GlobalParser->OptionsMap, Opts, ShowHidden);
+    sortOpts(getGlobalParser()->OptionsMap, Opts, ShowHidden);
 
-    if (GlobalParser->ProgramOverview)
-      outs() << "OVERVIEW: " << GlobalParser->ProgramOverview << "\n";
+    if (getGlobalParser()->ProgramOverview)
+      outs() << "OVERVIEW: " << getGlobalParser()->ProgramOverview << "\n";
 
-    outs() << "USAGE: " << GlobalParser->ProgramName << " [options]";
+    outs() << "USAGE: " << getGlobalParser()->ProgramName << " [options]";
 
-    for (auto Opt : GlobalParser->PositionalOpts) {
+    for (auto Opt : getGlobalParser()->PositionalOpts) {
       if (Opt->hasArgStr())
         outs() << " --" << Opt->ArgStr;
       outs() << " " << Opt->HelpStr;
     }
 
     // Print the consume after option info if it exists...
-    if (GlobalParser->ConsumeAfterOpt)
-      outs() << " " << GlobalParser->ConsumeAfterOpt->HelpStr;
+    if (getGlobalParser()->ConsumeAfterOpt)
+      outs() << " " << getGlobalParser()->ConsumeAfterOpt->HelpStr;
 
     outs() << "\n\n";
 
@@ -1540,9 +1632,9 @@ public:
     printOptions(Opts, MaxArgLen);
 
     // Print any extra help the user has declared.
-    for (auto I : GlobalParser->MoreHelp)
+    for (auto I : getGlobalParser()->MoreHelp)
       outs() << I;
-    GlobalParser->MoreHelp.clear();
+    getGlobalParser()->MoreHelp.clear();
 
     // Halt the program since help information was printed
     exit(0);
@@ -1571,8 +1663,8 @@ protected:
 
     // Collect registered option categories into vector in preparation for
     // sorting.
-    for (auto I = GlobalParser->RegisteredOptionCategories.begin(),
-              E = GlobalParser->RegisteredOptionCategories.end();
+    for (auto I = getGlobalParser()->RegisteredOptionCategories.begin(),
+              E = getGlobalParser()->RegisteredOptionCategories.end();
          I != E; ++I) {
       SortedCategories.push_back(*I);
     }
@@ -1715,7 +1807,7 @@ void HelpPrinterWrapper::operator=(bool Value) {
   // Decide which printer to invoke. If more than one option category is
   // registered then it is useful to show the categorized help instead of
   // uncategorized help.
-  if (GlobalParser->RegisteredOptionCategories.size() > 1) {
+  if (getGlobalParser()->RegisteredOptionCategories.size() > 1) {
     // unhide -help-list option so user can have uncategorized output if they
     // want it.
     HLOp.setHiddenFlag(NotHidden);
@@ -1726,7 +1818,7 @@ void HelpPrinterWrapper::operator=(bool Value) {
 }
 
 // Print the value of each option.
-void cl::PrintOptionValues() { GlobalParser->printOptionValues(); }
+void cl::PrintOptionValues() { getGlobalParser()->printOptionValues(); }
 
 void CommandLineParser::printOptionValues() {
   if (!PrintOptions && !PrintAllOptions)
@@ -1843,11 +1935,11 @@ void cl::AddExtraVersionPrinter(void (*func)()) {
 }
 
 StringMap<Option *> &cl::getRegisteredOptions() {
-  return GlobalParser->OptionsMap;
+  return getGlobalParser()->OptionsMap;
 }
 
 void cl::HideUnrelatedOptions(cl::OptionCategory &Category) {
-  for (auto &I : GlobalParser->OptionsMap) {
+  for (auto &I : getGlobalParser()->OptionsMap) {
     if (I.second->Category != &Category &&
         I.second->Category != &GenericCategory)
       I.second->setHiddenFlag(cl::ReallyHidden);
@@ -1857,7 +1949,7 @@ void cl::HideUnrelatedOptions(cl::OptionCategory &Category) {
 void cl::HideUnrelatedOptions(ArrayRef<const cl::OptionCategory *> Categories) {
   auto CategoriesBegin = Categories.begin();
   auto CategoriesEnd = Categories.end();
-  for (auto &I : GlobalParser->OptionsMap) {
+  for (auto &I : getGlobalParser()->OptionsMap) {
     if (std::find(CategoriesBegin, CategoriesEnd, I.second->Category) ==
             CategoriesEnd &&
         I.second->Category != &GenericCategory)
@@ -16,10 +16,16 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/Compiler.h"
+#include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Parallel.h"
 #if LLVM_ENABLE_ZLIB == 1 && HAVE_ZLIB_H
 #include <zlib.h>
 #endif
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
 
 using namespace llvm;
 
@@ -62,6 +68,104 @@ zlib::Status zlib::compress(StringRef InputBuffer,
   return Res;
 }
 
+/// The size of the blocks of compressParallel().
+static const size_t ParallelBlockSize = 1 << 20;
+
+/// The size of the dictionary of a block, which is the window of deflate.
+static const size_t DictionarySize = 1 << 15;
+
+// Compress the block I of Input as a raw deflate stream that ends the block
+// with a sync flush, or ends the stream if the block is the last one.
+static int compressBlock(StringRef Input, size_t I, int CLevel,
+                         SmallVectorImpl<char> &Out) {
+  z_stream Z;
+  memset(&Z, 0, sizeof(Z));
+  int Res = ::deflateInit2(&Z, CLevel, Z_DEFLATED, -MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY);
+  if (Res != Z_OK)
+    return Res;
+  size_t Begin = I * ParallelBlockSize;
+  StringRef Block = Input.substr(Begin, ParallelBlockSize);
+  bool IsLast = Begin + Block.size() == Input.size();
+  if (Begin) {
+    Res = ::deflateSetDictionary(
+        &Z, (const Bytef *)Input.data() + Begin - DictionarySize,
+        DictionarySize);
+    if (Res != Z_OK) {
+      ::deflateEnd(&Z);
+      return Res;
+    }
+  }
+
+  // The sync flush adds an empty stored block to the bound of the stream.
+  Out.resize(::deflateBound(&Z, Block.size()) + 16);
+  Z.next_in = (Bytef *)Block.data();
+  Z.avail_in = Block.size();
+  size_t Used = 0;
+  while (true) {
+    Z.next_out = (Bytef *)Out.data() + Used;
+    Z.avail_out = Out.size() - Used;
+    Res = ::deflate(&Z, IsLast ? Z_FINISH : Z_SYNC_FLUSH);
+    Used = Out.size() - Z.avail_out;
+    if (Res == Z_STREAM_ERROR || Z.avail_out != 0)
+      break;
+    Out.resize(Out.size() * 2);
+  }
+  ::deflateEnd(&Z);
+  __msan_unpoison(Out.data(), Used);
+  Out.resize(Used);
+  if (Res == Z_STREAM_ERROR)
+    return Res;
+  return IsLast && Res != Z_STREAM_END ? Z_BUF_ERROR : Z_OK;
+}
+
+zlib::Status zlib::compressParallel(StringRef InputBuffer,
+                                    SmallVectorImpl<char> &CompressedBuffer,
+                                    CompressionLevel Level) {
+  if (InputBuffer.size() <= ParallelBlockSize)
+    return compress(InputBuffer, CompressedBuffer, Level);
+
+  int CLevel = encodeZlibCompressionLevel(Level);
+  size_t NumBlocks =
+      (InputBuffer.size() + ParallelBlockSize - 1) / ParallelBlockSize;
+  std::vector<SmallVector<char, 0>> Blocks(NumBlocks);
+  std::vector<uLong> Adlers(NumBlocks);
+  std::vector<int> Results(NumBlocks);
+  parallel_for_each_n(size_t(0), NumBlocks, [&](size_t I) {
+    Results[I] = compressBlock(InputBuffer, I, CLevel, Blocks[I]);
+    StringRef Block = InputBuffer.substr(I * ParallelBlockSize,
+                                         ParallelBlockSize);
+    Adlers[I] = ::adler32(::adler32(0, Z_NULL, 0), (const Bytef *)Block.data(),
+                          Block.size());
+  });
+  for (int Res : Results)
+    if (Res != Z_OK)
+      return encodeZlibReturnValue(Res);
+
+  // The header of deflate with a 32 KiB window, and the level flags that
+  // deflate would write, followed by the blocks and the Adler-32 of the input.
+  int LevelFlags = CLevel == Z_DEFAULT_COMPRESSION
+                       ? 2
+                       : CLevel < 2 ? 0 : CLevel < 6 ? 1 : CLevel == 6 ? 2 : 3;
+  unsigned Header = (0x78 << 8) | (LevelFlags << 6);
+  Header += 31 - Header % 31;
+  CompressedBuffer.clear();
+  CompressedBuffer.push_back(Header >> 8);
+  CompressedBuffer.push_back(Header & 0xff);
+  uLong Adler = Adlers[0];
+  for (size_t I = 0; I != NumBlocks; ++I) {
+    CompressedBuffer.append(Blocks[I].begin(), Blocks[I].end());
+    if (I)
+      Adler = ::adler32_combine(
+          Adler, Adlers[I],
+          InputBuffer.substr(I * ParallelBlockSize, ParallelBlockSize).size());
+  }
+  char Trailer[4];
+  support::endian::write32be(Trailer, Adler);
+  CompressedBuffer.append(Trailer, Trailer + 4);
+  return StatusOK;
+}
+
 zlib::Status zlib::uncompress(StringRef InputBuffer,
                               SmallVectorImpl<char> &UncompressedBuffer,
                               size_t UncompressedSize) {
@@ -76,6 +180,62 @@ zlib::Status zlib::uncompress(StringRef InputBuffer,
   return Res;
 }
 
+zlib::Decompressor::Decompressor() {
+  z_stream *Z = new z_stream;
+  memset(Z, 0, sizeof(*Z));
+  // A failure to initialize the stream is reported by decompress().
+  if (::inflateInit(Z) != Z_OK) {
+    delete Z;
+    Z = nullptr;
+  }
+  Stream = Z;
+}
+
+zlib::Decompressor::~Decompressor() {
+  if (z_stream *Z = static_cast<z_stream *>(Stream)) {
+    ::inflateEnd(Z);
+    delete Z;
+  }
+}
+
+zlib::Status zlib::Decompressor::decompress(StringRef &Input,
+                                            MutableArrayRef<char> Output,
+                                            size_t &Written) {
+  Written = 0;
+  z_stream *Z = static_cast<z_stream *>(Stream);
+  if (!Z)
+    return StatusOutOfMemory;
+
+  // zlib takes at most 4 GiB of input and of output at a time.
+  const size_t MaxChunk = std::numeric_limits<uInt>::max();
+  while (!Finished) {
+    uInt InChunk = std::min(Input.size(), MaxChunk);
+    uInt OutChunk = std::min(Output.size() - Written, MaxChunk);
+    Z->next_in = (Bytef *)Input.data();
+    Z->avail_in = InChunk;
+    Z->next_out = (Bytef *)Output.data() + Written;
+    Z->avail_out = OutChunk;
+    int Res = ::inflate(Z, Z_NO_FLUSH);
+    size_t Consumed = InChunk - Z->avail_in;
+    size_t Produced = OutChunk - Z->avail_out;
+    // Tell MemorySanitizer that zlib output buffer is fully initialized.
+    // This avoids a false report when running LLVM with uninstrumented ZLib.
+    __msan_unpoison(Output.data() + Written, Produced);
+    Input = Input.drop_front(Consumed);
+    Written += Produced;
+    if (Res == Z_STREAM_END)
+      Finished = true;
+    else if (Res == Z_NEED_DICT)
+      return StatusInvalidData;
+    else if (Res == Z_BUF_ERROR || (!Consumed && !Produced))
+      // More input or more room in the output is needed.
+      break;
+    else if (Res != Z_OK)
+      return encodeZlibReturnValue(Res);
+  }
+  return StatusOK;
+}
+
 uint32_t zlib::crc32(StringRef Buffer) {
   return ::crc32(0, (const Bytef *)Buffer.data(), Buffer.size());
 }
@@ -87,11 +247,24 @@ zlib::Status zlib::compress(StringRef InputBuffer,
                             CompressionLevel Level) {
   return zlib::StatusUnsupported;
 }
+zlib::Status zlib::compressParallel(StringRef InputBuffer,
+                                    SmallVectorImpl<char> &CompressedBuffer,
+                                    CompressionLevel Level) {
+  return zlib::StatusUnsupported;
+}
 zlib::Status zlib::uncompress(StringRef InputBuffer,
                               SmallVectorImpl<char> &UncompressedBuffer,
                               size_t UncompressedSize) {
   return zlib::StatusUnsupported;
 }
+zlib::Decompressor::Decompressor() : Stream(nullptr) {}
+zlib::Decompressor::~Decompressor() {}
+zlib::Status zlib::Decompressor::decompress(StringRef &Input,
+                                            MutableArrayRef<char> Output,
+                                            size_t &Written) {
+  Written = 0;
+  return zlib::StatusUnsupported;
+}
 uint32_t zlib::crc32(StringRef Buffer) {
   llvm_unreachable("zlib::crc32 is unavailable");
 }
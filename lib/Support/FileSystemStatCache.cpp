@@ -0,0 +1,75 @@
+//===- FileSystemStatCache.cpp - Cache of file status ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements FileSystemStatCache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/FileSystemStatCache.h"
+#include "llvm/ADT/SmallString.h"
+
+using namespace llvm;
+using namespace sys::fs;
+
+std::error_code FileSystemStatCache::status(const Twine &Path,
+                                            file_status &Result) {
+  SmallString<128> Storage;
+  StringRef P = Path.toStringRef(Storage);
+  auto Inserted = Entries.insert(std::make_pair(P, Entry()));
+  Entry &E = Inserted.first->second;
+  if (Inserted.second)
+    E.EC = fs::status(P, E.Status);
+  Result = E.Status;
+  return E.EC;
+}
+
+bool FileSystemStatCache::exists(const Twine &Path) {
+  file_status Status;
+  return !status(Path, Status) && fs::exists(Status);
+}
+
+std::error_code FileSystemStatCache::is_directory(const Twine &Path,
+                                                  bool &Result) {
+  file_status Status;
+  if (std::error_code EC = status(Path, Status))
+    return EC;
+  Result = fs::is_directory(Status);
+  return std::error_code();
+}
+
+bool FileSystemStatCache::is_directory(const Twine &Path) {
+  bool Result;
+  return !is_directory(Path, Result) && Result;
+}
+
+std::error_code FileSystemStatCache::is_regular_file(const Twine &Path,
+                                                     bool &Result) {
+  file_status Status;
+  if (std::error_code EC = status(Path, Status))
+    return EC;
+  Result = fs::is_regular_file(Status);
+  return std::error_code();
+}
+
+bool FileSystemStatCache::is_regular_file(const Twine &Path) {
+  bool Result;
+  return !is_regular_file(Path, Result) && Result;
+}
+
+void FileSystemStatCache::insert(const Twine &Path, file_status Status) {
+  SmallString<128> Storage;
+  Entry &E = Entries[Path.toStringRef(Storage)];
+  E.EC = std::error_code();
+  E.Status = Status;
+}
+
+void FileSystemStatCache::invalidate(const Twine &Path) {
+  SmallString<128> Storage;
+  Entries.erase(Path.toStringRef(Storage));
+}
@@ -0,0 +1,47 @@
+//===- llvm/Support/Parallel.cpp - Parallel algorithms --------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Threading.h"
+
+using namespace llvm;
+
+static unsigned ParallelThreadCount = 0;
+
+namespace {
+/// The thread pool of the parallel algorithms, created on their first use.
+struct ParallelPool {
+  ThreadPool Pool;
+
+  // No thread is requested when LLVM_ENABLE_THREADS is off, as it would warn.
+  ParallelPool()
+      : Pool(llvm_is_multithreaded() ? getParallelThreadCount() : 0) {}
+};
+}
+
+static ManagedStatic<ParallelPool> DefaultParallelPool;
+
+void llvm::setParallelThreadCount(unsigned ThreadCount) {
+  assert(!DefaultParallelPool.isConstructed() &&
+         "The parallel algorithms have already started their threads");
+  ParallelThreadCount = ThreadCount;
+}
+
+unsigned llvm::getParallelThreadCount() {
+  if (!llvm_is_multithreaded())
+    return 1;
+  if (ParallelThreadCount)
+    return ParallelThreadCount;
+  return std::max(std::thread::hardware_concurrency(), 1U);
+}
+
+ThreadPool &llvm::detail::getDefaultParallelPool() {
+  return DefaultParallelPool->Pool;
+}
@@ -971,10 +971,12 @@ std::error_code is_other(const Twine &Path, bool &Result) {
   return std::error_code();
 }
 
-void directory_entry::replace_filename(const Twine &filename, file_status st) {
+void directory_entry::replace_filename(const Twine &filename, file_status st,
+                                       file_type type) {
   SmallString<128> path = path::parent_path(Path);
   path::append(path, filename);
   Path = path.str();
+  Type = type;
   Status = st;
 }
 
@@ -1155,7 +1157,14 @@ std::error_code identify_magic(const Twine &Path, file_magic &Result) {
 }
 
 std::error_code directory_entry::status(file_status &result) const {
-  return fs::status(Path, result);
+  if (Status.type() != file_type::status_error) {
+    result = Status;
+    return std::error_code();
+  }
+  std::error_code EC = fs::status(Path, result);
+  if (!EC)
+    Status = result;
+  return EC;
 }
 
 } // end namespace fs
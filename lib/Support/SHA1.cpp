@@ -11,16 +11,41 @@
 // and modified by wrapping it in a C++ interface for LLVM,
 // and removing unnecessary code.
 //
+// The blocks are hashed with the SHA instructions of x86 and of the ARMv8
+// cryptography extension when the host has them.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Host.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Endian.h"
 using namespace llvm;
 
 #include <stdint.h>
 #include <string.h>
 
+// The SHA intrinsics need a compiler that can enable them for one function.
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(__clang__)
+#if __clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define SHA1_X86_SHA_NI
+#endif
+#elif defined(__GNUC__) && __GNUC__ >= 5
+#define SHA1_X86_SHA_NI
+#endif
+#endif
+
+#ifdef SHA1_X86_SHA_NI
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#define SHA1_ARM_CRYPTO
+#include <arm_neon.h>
+#endif
+
 #if defined(BYTE_ORDER) && defined(BIG_ENDIAN) && BYTE_ORDER == BIG_ENDIAN
 #define SHA_BIG_ENDIAN
 #endif
@@ -51,43 +76,186 @@ static uint32_t rol32(uint32_t number, uint8_t bits) {
   return ((number << bits) | (number >> (32 - bits)));
 }
 
-void SHA1::hashBlock() {
-  uint8_t i;
-  uint32_t a, b, c, d, e, t;
-
-  a = InternalState.State[0];
-  b = InternalState.State[1];
-  c = InternalState.State[2];
-  d = InternalState.State[3];
-  e = InternalState.State[4];
-  for (i = 0; i < 80; i++) {
-    if (i >= 16) {
-      t = InternalState.Buffer[(i + 13) & 15] ^
-          InternalState.Buffer[(i + 8) & 15] ^
-          InternalState.Buffer[(i + 2) & 15] ^ InternalState.Buffer[i & 15];
-      InternalState.Buffer[i & 15] = rol32(t, 1);
+// Hash NumBlocks blocks of 64 bytes at Data into State.
+typedef void HashBlocksFn(uint32_t *State, const uint8_t *Data,
+                          size_t NumBlocks);
+
+static void hashBlocksScalar(uint32_t *State, const uint8_t *Data,
+                             size_t NumBlocks) {
+  uint32_t Buffer[16];
+  for (; NumBlocks; --NumBlocks, Data += 64) {
+    uint8_t i;
+    uint32_t a, b, c, d, e, t;
+
+    for (i = 0; i < 16; i++)
+      Buffer[i] = support::endian::read32be(Data + 4 * i);
+    a = State[0];
+    b = State[1];
+    c = State[2];
+    d = State[3];
+    e = State[4];
+    for (i = 0; i < 80; i++) {
+      if (i >= 16) {
+        t = Buffer[(i + 13) & 15] ^ Buffer[(i + 8) & 15] ^
+            Buffer[(i + 2) & 15] ^ Buffer[i & 15];
+        Buffer[i & 15] = rol32(t, 1);
+      }
+      if (i < 20) {
+        t = (d ^ (b & (c ^ d))) + SHA1_K0;
+      } else if (i < 40) {
+        t = (b ^ c ^ d) + SHA1_K20;
+      } else if (i < 60) {
+        t = ((b & c) | (d & (b | c))) + SHA1_K40;
+      } else {
+        t = (b ^ c ^ d) + SHA1_K60;
+      }
+      t += rol32(a, 5) + e + Buffer[i & 15];
+      e = d;
+      d = c;
+      c = rol32(b, 30);
+      b = a;
+      a = t;
     }
-    if (i < 20) {
-      t = (d ^ (b & (c ^ d))) + SHA1_K0;
-    } else if (i < 40) {
-      t = (b ^ c ^ d) + SHA1_K20;
-    } else if (i < 60) {
-      t = ((b & c) | (d & (b | c))) + SHA1_K40;
-    } else {
-      t = (b ^ c ^ d) + SHA1_K60;
+    State[0] += a;
+    State[1] += b;
+    State[2] += c;
+    State[3] += d;
+    State[4] += e;
+  }
+}
+
+#ifdef SHA1_X86_SHA_NI
+// Four rounds with the x86 SHA instructions. The message words of the group G
+// of rounds are in Msg[G % 4], whose first word is in the highest lane, and
+// are computed from the previous ones for G >= 4. F selects the round function
+// and constant, so it must be a constant.
+#define SHA1_X86_ROUNDS(G, F)                                                  \
+  do {                                                                         \
+    if (G >= 4)                                                                \
+      Msg[G % 4] = _mm_sha1msg2_epu32(                                         \
+          _mm_xor_si128(_mm_sha1msg1_epu32(Msg[G % 4], Msg[(G + 1) % 4]),      \
+                        Msg[(G + 2) % 4]),                                     \
+          Msg[(G + 3) % 4]);                                                   \
+    E = G == 0 ? _mm_add_epi32(E, Msg[0])                                      \
+               : _mm_sha1nexte_epu32(Prev, Msg[G % 4]);                        \
+    Prev = ABCD;                                                               \
+    ABCD = _mm_sha1rnds4_epu32(ABCD, E, F);                                    \
+  } while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+static void hashBlocksX86(uint32_t *State, const uint8_t *Data,
+                          size_t NumBlocks) {
+  // Reverse the bytes of each block of 16 bytes, as the instructions take the
+  // big-endian words from the highest lane down.
+  const __m128i Mask =
+      _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i ABCD = _mm_shuffle_epi32(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(State)), 0x1B);
+  __m128i E0 = _mm_set_epi32(State[4], 0, 0, 0);
+  for (; NumBlocks; --NumBlocks, Data += 64) {
+    __m128i Msg[4];
+    for (int I = 0; I < 4; ++I)
+      Msg[I] = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(Data + 16 * I)),
+          Mask);
+    __m128i SavedABCD = ABCD;
+    __m128i E = E0, Prev = ABCD;
+    SHA1_X86_ROUNDS(0, 0);
+    SHA1_X86_ROUNDS(1, 0);
+    SHA1_X86_ROUNDS(2, 0);
+    SHA1_X86_ROUNDS(3, 0);
+    SHA1_X86_ROUNDS(4, 0);
+    SHA1_X86_ROUNDS(5, 1);
+    SHA1_X86_ROUNDS(6, 1);
+    SHA1_X86_ROUNDS(7, 1);
+    SHA1_X86_ROUNDS(8, 1);
+    SHA1_X86_ROUNDS(9, 1);
+    SHA1_X86_ROUNDS(10, 2);
+    SHA1_X86_ROUNDS(11, 2);
+    SHA1_X86_ROUNDS(12, 2);
+    SHA1_X86_ROUNDS(13, 2);
+    SHA1_X86_ROUNDS(14, 2);
+    SHA1_X86_ROUNDS(15, 3);
+    SHA1_X86_ROUNDS(16, 3);
+    SHA1_X86_ROUNDS(17, 3);
+    SHA1_X86_ROUNDS(18, 3);
+    SHA1_X86_ROUNDS(19, 3);
+    E0 = _mm_sha1nexte_epu32(Prev, E0);
+    ABCD = _mm_add_epi32(ABCD, SavedABCD);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(State),
+                   _mm_shuffle_epi32(ABCD, 0x1B));
+  State[4] = _mm_extract_epi32(E0, 3);
+}
+#undef SHA1_X86_ROUNDS
+#endif
+
+#ifdef SHA1_ARM_CRYPTO
+static void hashBlocksARM(uint32_t *State, const uint8_t *Data,
+                          size_t NumBlocks) {
+  static const uint32_t K[4] = {SHA1_K0, SHA1_K20, SHA1_K40, SHA1_K60};
+  uint32x4_t ABCD = vld1q_u32(State);
+  uint32_t E0 = State[4];
+  for (; NumBlocks; --NumBlocks, Data += 64) {
+    uint32x4_t Msg[4];
+    for (int I = 0; I < 4; ++I)
+      Msg[I] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(Data + 16 * I)));
+    uint32x4_t SavedABCD = ABCD;
+    uint32_t E = E0;
+    for (int G = 0; G < 20; ++G) {
+      if (G >= 4)
+        Msg[G % 4] = vsha1su1q_u32(
+            vsha1su0q_u32(Msg[G % 4], Msg[(G + 1) % 4], Msg[(G + 2) % 4]),
+            Msg[(G + 3) % 4]);
+      uint32x4_t WK = vaddq_u32(Msg[G % 4], vdupq_n_u32(K[G / 5]));
+      uint32_t NextE = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+      if (G < 5)
+        ABCD = vsha1cq_u32(ABCD, E, WK);
+      else if (G >= 10 && G < 15)
+        ABCD = vsha1mq_u32(ABCD, E, WK);
+      else
+        ABCD = vsha1pq_u32(ABCD, E, WK);
+      E = NextE;
     }
-    t += rol32(a, 5) + e + InternalState.Buffer[i & 15];
-    e = d;
-    d = c;
-    c = rol32(b, 30);
-    b = a;
-    a = t;
+    E0 += E;
+    ABCD = vaddq_u32(ABCD, SavedABCD);
   }
-  InternalState.State[0] += a;
-  InternalState.State[1] += b;
-  InternalState.State[2] += c;
-  InternalState.State[3] += d;
-  InternalState.State[4] += e;
+  vst1q_u32(State, ABCD);
+  State[4] = E0;
+}
+#endif
+
+// Return the fastest implementation that the host supports.
+static HashBlocksFn *selectHashBlocks() {
+#if defined(SHA1_X86_SHA_NI) || defined(SHA1_ARM_CRYPTO)
+  StringMap<bool> Features;
+  if (sys::getHostCPUFeatures(Features)) {
+#ifdef SHA1_X86_SHA_NI
+    if (Features.lookup("sha") && Features.lookup("sse4.1") &&
+        Features.lookup("ssse3"))
+      return hashBlocksX86;
+#endif
+#ifdef SHA1_ARM_CRYPTO
+    if (Features.lookup("crypto"))
+      return hashBlocksARM;
+#endif
+  }
+#endif
+  return hashBlocksScalar;
+}
+
+static void hashBlocks(uint32_t *State, const uint8_t *Data,
+                       size_t NumBlocks) {
+  static HashBlocksFn *const Impl = selectHashBlocks();
+  Impl(State, Data, NumBlocks);
+}
+
+void SHA1::hashBlock() {
+  // The buffer holds the big-endian words of the block in host order.
+  uint8_t Block[BLOCK_LENGTH];
+  for (unsigned i = 0; i < BLOCK_LENGTH / 4; i++)
+    support::endian::write32be(Block + 4 * i, InternalState.Buffer[i]);
+  hashBlocks(InternalState.State, Block, 1);
 }
 
 void SHA1::addUncounted(uint8_t data) {
@@ -110,6 +278,18 @@ void SHA1::writebyte(uint8_t data) {
 }
 
 void SHA1::update(ArrayRef<uint8_t> Data) {
+  // Complete the buffered block, hash the whole blocks in place, and buffer
+  // the rest.
+  while (!Data.empty() && InternalState.BufferOffset) {
+    writebyte(Data.front());
+    Data = Data.drop_front();
+  }
+  size_t NumBlocks = Data.size() / BLOCK_LENGTH;
+  if (NumBlocks) {
+    hashBlocks(InternalState.State, Data.data(), NumBlocks);
+    InternalState.ByteCount += NumBlocks * BLOCK_LENGTH;
+    Data = Data.drop_front(NumBlocks * BLOCK_LENGTH);
+  }
   for (auto &C : Data)
     writebyte(C);
 }
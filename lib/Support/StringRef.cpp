@@ -147,6 +147,8 @@ size_t StringRef::find(StringRef Str, size_t From) const {
   size_t N = Str.size();
   if (N == 0)
     return From;
+  if (N == 1)
+    return find(Needle[0], From);
 
   size_t Size = Length - From;
   if (Size < N)
@@ -155,10 +157,16 @@ size_t StringRef::find(StringRef Str, size_t From) const {
   const char *Start = Data + From;
   const char *Stop = Start + (Size - N + 1);
 
-  // For short haystacks or unsupported needles fall back to the naive algorithm
+  // For short haystacks or unsupported needles fall back to the naive
+  // algorithm. Let memchr find the candidate positions, as C libraries
+  // vectorize it.
   if (Size < 16 || N > 255) {
     do {
-      if (std::memcmp(Start, Needle, N) == 0)
+      Start = static_cast<const char *>(
+          std::memchr(Start, Needle[0], Stop - Start));
+      if (!Start)
+        return npos;
+      if (std::memcmp(Start + 1, Needle + 1, N - 1) == 0)
         return Start - Data;
       ++Start;
     } while (Start < Stop);
@@ -204,6 +212,9 @@ size_t StringRef::rfind(StringRef Str) const {
 /// Note: O(size() + Chars.size())
 StringRef::size_type StringRef::find_first_of(StringRef Chars,
                                               size_t From) const {
+  if (Chars.size() == 1)
+    return find(Chars[0], From);
+
   std::bitset<1 << CHAR_BIT> CharBits;
   for (size_type i = 0; i != Chars.size(); ++i)
     CharBits.set((unsigned char)Chars[i]);
@@ -341,12 +352,8 @@ void StringRef::split(SmallVectorImpl<StringRef> &A, char Separator,
 /// the string.
 size_t StringRef::count(StringRef Str) const {
   size_t Count = 0;
-  size_t N = Str.size();
-  if (N > Length)
-    return 0;
-  for (size_t i = 0, e = Length - N + 1; i != e; ++i)
-    if (substr(i, N).equals(Str))
-      ++Count;
+  for (size_t I = find(Str); I != npos; I = find(Str, I + 1))
+    ++Count;
   return Count;
 }
 
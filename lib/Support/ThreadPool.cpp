@@ -7,7 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a crude C++11 based thread pool.
+// This file implements a C++11 based work-stealing thread pool.
 //
 //===----------------------------------------------------------------------===//
 
@@ -18,84 +18,158 @@
 
 using namespace llvm;
 
+// Take the newest or the oldest task of Group in Queue, or of any group if
+// Group is null.
+bool ThreadPool::takeTask(std::deque<QueuedTask> &Queue, bool Newest,
+                          ThreadPoolTaskGroup *Group, QueuedTask &Task) {
+  if (Newest) {
+    for (auto I = Queue.rbegin(), E = Queue.rend(); I != E; ++I)
+      if (!Group || I->Group == Group) {
+        Task = std::move(*I);
+        Queue.erase(std::next(I).base());
+        return true;
+      }
+    return false;
+  }
+  for (auto I = Queue.begin(), E = Queue.end(); I != E; ++I)
+    if (!Group || I->Group == Group) {
+      Task = std::move(*I);
+      Queue.erase(I);
+      return true;
+    }
+  return false;
+}
+
+bool ThreadPool::popTask(unsigned Worker, ThreadPoolTaskGroup *Group,
+                         QueuedTask &Task) {
+  // The newest task of the thread itself first, as its data is likely to be
+  // in the cache, then the tasks from outside the pool by priority, then the
+  // oldest task of another thread, as it is likely to be the largest one.
+  bool Found =
+      Worker != NoWorker && takeTask(LocalTasks[Worker], true, Group, Task);
+  for (int P = int(ThreadPoolPriority::High);
+       !Found && P >= int(ThreadPoolPriority::Low); --P)
+    Found = takeTask(GlobalTasks[P], false, Group, Task);
+  for (unsigned I = 1, E = LocalTasks.size(); !Found && I <= E; ++I) {
+    unsigned Victim = (Worker == NoWorker ? I : Worker + I) % E;
+    if (Victim != Worker)
+      Found = takeTask(LocalTasks[Victim], false, Group, Task);
+  }
+  if (Found)
+    --NumQueued;
+  return Found;
+}
+
+void ThreadPool::runTask(QueuedTask &Task,
+                         std::unique_lock<std::mutex> &LockGuard) {
+  // We are active from the moment the task left the queue, so that wait()
+  // does not see an empty pool while a task is in flight.
+  ++ActiveThreads;
+  LockGuard.unlock();
+#ifndef _MSC_VER
+  Task.Task();
+#else
+  Task.Task(/* unused */ false);
+#endif
+  LockGuard.lock();
+  --ActiveThreads;
+  if (Task.Group)
+    --Task.Group->NumUnfinished;
+  // Notify task completion, in case someone waits on ThreadPool::wait()
+  CompletionCondition.notify_all();
+}
+
 #if LLVM_ENABLE_THREADS
 
 // Default to std::thread::hardware_concurrency
 ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
 
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0), EnableFlag(true) {
+    : LocalTasks(ThreadCount), WorkerIDs(ThreadCount), EnableFlag(true) {
   // Create ThreadCount threads that will loop forever, wait on QueueCondition
   // for tasks to be queued or the Pool to be destroyed.
   Threads.reserve(ThreadCount);
   for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
-    Threads.emplace_back([&] {
+    Threads.emplace_back([this, ThreadID] {
+      std::unique_lock<std::mutex> LockGuard(QueueLock);
+      WorkerIDs[ThreadID] = std::this_thread::get_id();
       while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
+        // Wait for tasks to be pushed in the queues
+        QueueCondition.wait(LockGuard,
+                            [&] { return !EnableFlag || NumQueued; });
+        QueuedTask Task;
+        if (!popTask(ThreadID, nullptr, Task)) {
           // Exit condition
-          if (!EnableFlag && Tasks.empty())
+          if (!EnableFlag)
             return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          {
-            ++ActiveThreads;
-            std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
+          continue;
         }
-        // Run the task we just grabbed
-#ifndef _MSC_VER
-        Task();
-#else
-        Task(/* unused */ false);
-#endif
-
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          --ActiveThreads;
-        }
-
-        // Notify task completion, in case someone waits on ThreadPool::wait()
-        CompletionCondition.notify_all();
+        runTask(Task, LockGuard);
       }
     });
   }
 }
 
+unsigned ThreadPool::getWorkerIndex() const {
+  std::thread::id ID = std::this_thread::get_id();
+  for (unsigned I = 0, E = WorkerIDs.size(); I != E; ++I)
+    if (WorkerIDs[I] == ID)
+      return I;
+  return NoWorker;
+}
+
 void ThreadPool::wait() {
-  // Wait for all threads to complete and the queue to be empty
-  std::unique_lock<std::mutex> LockGuard(CompletionLock);
-  // The order of the checks for ActiveThreads and Tasks.empty() matters because
-  // any active threads might be modifying the Tasks queue, and this would be a
-  // race.
+  // Wait for all threads to complete and the queues to be empty
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  assert(getWorkerIndex() == NoWorker &&
+         "Waiting for the whole pool from one of its tasks would deadlock");
   CompletionCondition.wait(LockGuard,
-                           [&] { return !ActiveThreads && Tasks.empty(); });
+                           [&] { return !ActiveThreads && !NumQueued; });
 }
 
-std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  unsigned Worker = getWorkerIndex();
+  // Run the queued tasks of the group rather than blocking the thread, which
+  // may be one of the threads that the group needs.
+  while (Group.NumUnfinished) {
+    QueuedTask Task;
+    if (popTask(Worker, &Group, Task))
+      runTask(Task, LockGuard);
+    else
+      CompletionCondition.wait(LockGuard);
+  }
+}
+
+std::shared_future<ThreadPool::VoidTy>
+ThreadPool::asyncImpl(TaskTy Task, ThreadPoolTaskGroup *Group) {
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
   {
-    // Lock the queue and push the new task
+    // Lock the queues and push the new task
     std::unique_lock<std::mutex> LockGuard(QueueLock);
 
     // Don't allow enqueueing after disabling the pool
     assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
 
-    Tasks.push(std::move(PackagedTask));
+    // The tasks submitted by a task of the pool go to its own thread.
+    QueuedTask QT = {std::move(PackagedTask), Group};
+    unsigned Worker = getWorkerIndex();
+    if (Worker != NoWorker)
+      LocalTasks[Worker].push_back(std::move(QT));
+    else
+      GlobalTasks[int(Group ? Group->getPriority()
+                            : ThreadPoolPriority::Normal)]
+          .push_back(std::move(QT));
+    ++NumQueued;
+    if (Group)
+      ++Group->NumUnfinished;
   }
   QueueCondition.notify_one();
+  // Wake up the waiters of the group, which run its tasks too.
+  if (Group)
+    CompletionCondition.notify_all();
   return Future.share();
 }
 
@@ -115,28 +189,33 @@ ThreadPool::~ThreadPool() {
 ThreadPool::ThreadPool() : ThreadPool(0) {}
 
 // No threads are launched, issue a warning if ThreadCount is not 0
-ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0) {
+ThreadPool::ThreadPool(unsigned ThreadCount) {
   if (ThreadCount) {
     errs() << "Warning: request a ThreadPool with " << ThreadCount
            << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
   }
 }
 
+unsigned ThreadPool::getWorkerIndex() const { return NoWorker; }
+
 void ThreadPool::wait() {
   // Sequential implementation running the tasks
-  while (!Tasks.empty()) {
-    auto Task = std::move(Tasks.front());
-    Tasks.pop();
-#ifndef _MSC_VER
-        Task();
-#else
-        Task(/* unused */ false);
-#endif
-  }
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  QueuedTask Task;
+  while (popTask(NoWorker, nullptr, Task))
+    runTask(Task, LockGuard);
+}
+
+void ThreadPool::wait(ThreadPoolTaskGroup &Group) {
+  // Sequential implementation running the tasks of the group
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  QueuedTask Task;
+  while (popTask(NoWorker, &Group, Task))
+    runTask(Task, LockGuard);
 }
 
-std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
+std::shared_future<ThreadPool::VoidTy>
+ThreadPool::asyncImpl(TaskTy Task, ThreadPoolTaskGroup *Group) {
 #ifndef _MSC_VER
   // Get a Future with launch::deferred execution using std::async
   auto Future = std::async(std::launch::deferred, std::move(Task)).share();
@@ -147,7 +226,13 @@ std::shared_future<ThreadPool::VoidTy> ThreadPool::asyncImpl(TaskTy Task) {
   auto Future = std::async(std::launch::deferred, std::move(Task), false).share();
   PackagedTaskTy PackagedTask([Future](bool) -> bool { Future.get(); return false; });
 #endif
-  Tasks.push(std::move(PackagedTask));
+  std::unique_lock<std::mutex> LockGuard(QueueLock);
+  QueuedTask QT = {std::move(PackagedTask), Group};
+  GlobalTasks[int(Group ? Group->getPriority() : ThreadPoolPriority::Normal)]
+      .push_back(std::move(QT));
+  ++NumQueued;
+  if (Group)
+    ++Group->NumUnfinished;
   return Future;
 }
 
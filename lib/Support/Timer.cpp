@@ -44,6 +44,11 @@ namespace {
                                       "tracking (this may be slow)"),
              cl::Hidden);
 
+  static cl::opt<bool>
+  TimerJSON("timer-json", cl::desc("Print -time-passes and other timer "
+                                   "reports as JSON, one object per line"),
+            cl::Hidden);
+
   static cl::opt<std::string, true>
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
@@ -239,8 +244,12 @@ NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef GroupName,
 static TimerGroup *TimerGroupList = nullptr;
 
 TimerGroup::TimerGroup(StringRef name)
-  : Name(name.begin(), name.end()), FirstTimer(nullptr) {
-    
+  : TimerGroup(name, name) {}
+
+TimerGroup::TimerGroup(StringRef name, StringRef description)
+  : Name(name.begin(), name.end()),
+    Description(description.begin(), description.end()), FirstTimer(nullptr) {
+
   // Add the group to TimerGroupList.
   sys::SmartScopedLock<true> L(*TimerLock);
   if (TimerGroupList)
@@ -298,10 +307,48 @@ void TimerGroup::addTimer(Timer &T) {
   FirstTimer = &T;
 }
 
+static void printJSONString(StringRef S, raw_ostream &OS) {
+  OS << '"';
+  for (unsigned char C : S) {
+    if (C == '"' || C == '\\')
+      OS << '\\' << C;
+    else if (C < 0x20)
+      OS << format("\\u%04x", C);
+    else
+      OS << C;
+  }
+  OS << '"';
+}
+
+void TimerGroup::PrintQueuedTimersJSON(raw_ostream &OS) {
+  OS << "{\"group\": ";
+  printJSONString(Name, OS);
+  OS << ", \"description\": ";
+  printJSONString(Description, OS);
+  OS << ", \"timers\": [";
+  for (unsigned i = 0, e = TimersToPrint.size(); i != e; ++i) {
+    const std::pair<TimeRecord, std::string> &Entry = TimersToPrint[e-i-1];
+    OS << (i ? ", " : "") << "{\"name\": ";
+    printJSONString(Entry.second, OS);
+    OS << format(", \"wall\": %.6f, \"user\": %.6f, \"system\": %.6f",
+                 Entry.first.getWallTime(), Entry.first.getUserTime(),
+                 Entry.first.getSystemTime())
+       << ", \"mem\": " << (int64_t)Entry.first.getMemUsed() << '}';
+  }
+  OS << "]}\n";
+}
+
 void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   // Sort the timers in descending order by amount of time taken.
   std::sort(TimersToPrint.begin(), TimersToPrint.end());
-  
+
+  if (TimerJSON) {
+    PrintQueuedTimersJSON(OS);
+    OS.flush();
+    TimersToPrint.clear();
+    return;
+  }
+
   TimeRecord Total;
   for (auto &RecordNamePair : TimersToPrint)
     Total += RecordNamePair.first;
@@ -309,9 +356,9 @@ void TimerGroup::PrintQueuedTimers(raw_ostream &OS) {
   // Print out timing header.
   OS << "===" << std::string(73, '-') << "===\n";
   // Figure out how many spaces to indent TimerGroup name.
-  unsigned Padding = (80-Name.length())/2;
+  unsigned Padding = (80-Description.length())/2;
   if (Padding > 80) Padding = 0;         // Don't allow "negative" numbers
-  OS.indent(Padding) << Name << '\n';
+  OS.indent(Padding) << Description << '\n';
   OS << "===" << std::string(73, '-') << "===\n";
   
   // If this is not an collection of ungrouped times, print the total time.
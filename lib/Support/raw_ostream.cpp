@@ -16,6 +16,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Config/config.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
@@ -25,6 +26,7 @@
 #include "llvm/Support/Program.h"
 #include <cctype>
 #include <cerrno>
+#include <cstring>
 #include <sys/stat.h>
 #include <system_error>
 
@@ -61,6 +63,12 @@
 #include "Windows/WindowsSupport.h"
 #endif
 
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 using namespace llvm;
 
 raw_ostream::~raw_ostream() {
@@ -543,6 +551,7 @@ raw_fd_ostream::raw_fd_ostream(int fd, bool shouldClose, bool unbuffered)
 raw_fd_ostream::~raw_fd_ostream() {
   if (FD >= 0) {
     flush();
+    wait_for_async_writes();
     if (ShouldClose && sys::Process::SafelyCloseFileDescriptor(FD))
       error_detected();
   }
@@ -564,10 +573,8 @@ raw_fd_ostream::~raw_fd_ostream() {
 }
 
 
-void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
-  assert(FD >= 0 && "File already closed.");
-  pos += Size;
-
+/// Write all of the Size bytes at Ptr to FD, and return false on an error.
+static bool writeToFD(int FD, const char *Ptr, size_t Size) {
 #ifndef LLVM_ON_WIN32
   bool ShouldWriteInChunks = false;
 #else
@@ -600,9 +607,8 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
           )
         continue;
 
-      // Otherwise it's a non-recoverable error. Note it and quit.
-      error_detected();
-      break;
+      // Otherwise it's a non-recoverable error.
+      return false;
     }
 
     // The write may have written some or all of the data. Update the
@@ -611,12 +617,139 @@ void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
     Ptr += ret;
     Size -= ret;
   } while (Size > 0);
+  return true;
+}
+
+/// Writes the buffers of a raw_fd_ostream in the asynchronous mode. The
+/// stream fills one of the two buffers while the other one is written.
+class raw_fd_ostream::AsyncWriter {
+  int FD;
+  std::unique_ptr<char[]> Buffers[2];
+  /// Whether a write failed since the last call to wait().
+  bool Failed = false;
+
+#if LLVM_ENABLE_THREADS
+  std::mutex Mutex;
+  std::condition_variable Cond;
+  /// The write in flight, if PendingBuffer is not null.
+  const char *PendingBuffer = nullptr;
+  size_t PendingSize = 0;
+  bool Done = false;
+  std::thread Thread;
+
+  void run() {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    while (true) {
+      Cond.wait(Lock, [&] { return PendingBuffer || Done; });
+      if (!PendingBuffer)
+        return;
+      Lock.unlock();
+      bool OK = writeToFD(FD, PendingBuffer, PendingSize);
+      Lock.lock();
+      Failed |= !OK;
+      PendingBuffer = nullptr;
+      Cond.notify_all();
+    }
+  }
+#endif
+
+public:
+  const size_t BufferSize;
+  /// The buffer that the stream fills.
+  unsigned Filling = 0;
+
+  AsyncWriter(int FD, size_t BufferSize) : FD(FD), BufferSize(BufferSize) {
+    Buffers[0].reset(new char[BufferSize]);
+    Buffers[1].reset(new char[BufferSize]);
+#if LLVM_ENABLE_THREADS
+    Thread = std::thread([this] { run(); });
+#endif
+  }
+
+  ~AsyncWriter() {
+#if LLVM_ENABLE_THREADS
+    {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Done = true;
+    }
+    Cond.notify_all();
+    Thread.join();
+#endif
+  }
+
+  char *getBuffer(unsigned I) { return Buffers[I].get(); }
+
+  /// Wait for the write in flight to finish, and return false if a write
+  /// failed since the last call.
+  bool wait() {
+#if LLVM_ENABLE_THREADS
+    std::unique_lock<std::mutex> Lock(Mutex);
+    Cond.wait(Lock, [&] { return !PendingBuffer; });
+#endif
+    bool OK = !Failed;
+    Failed = false;
+    return OK;
+  }
+
+  /// Start writing the first Size bytes of buffer I, once the previous write
+  /// is done.
+  void write(unsigned I, size_t Size) {
+#if LLVM_ENABLE_THREADS
+    std::unique_lock<std::mutex> Lock(Mutex);
+    Cond.wait(Lock, [&] { return !PendingBuffer; });
+    PendingBuffer = getBuffer(I);
+    PendingSize = Size;
+    Cond.notify_all();
+#else
+    Failed |= !writeToFD(FD, getBuffer(I), Size);
+#endif
+  }
+};
+
+void raw_fd_ostream::write_impl(const char *Ptr, size_t Size) {
+  assert(FD >= 0 && "File already closed.");
+  pos += Size;
+
+  if (Async && Size <= Async->BufferSize) {
+    unsigned Filling = Async->Filling;
+    if (Ptr == Async->getBuffer(Filling)) {
+      // Write the buffer that the stream filled, and fill the other one.
+      Async->write(Filling, Size);
+      Async->Filling = !Filling;
+      SetBuffer(Async->getBuffer(!Filling), Async->BufferSize);
+      return;
+    }
+    // The data does not come from the buffer of the stream, for example
+    // because the stream was made unbuffered, so copy it to the other buffer.
+    wait_for_async_writes();
+    memcpy(Async->getBuffer(!Filling), Ptr, Size);
+    Async->write(!Filling, Size);
+    return;
+  }
+  wait_for_async_writes();
+  if (!writeToFD(FD, Ptr, Size))
+    error_detected();
+}
+
+void raw_fd_ostream::wait_for_async_writes() {
+  if (Async && !Async->wait())
+    error_detected();
+}
+
+void raw_fd_ostream::enable_async_writes(size_t BufferSize) {
+  assert(FD >= 0 && "File already closed.");
+  assert(BufferSize && "Asynchronous writes need a buffer");
+  flush();
+  wait_for_async_writes();
+  Async = llvm::make_unique<AsyncWriter>(FD, BufferSize);
+  SetBuffer(Async->getBuffer(Async->Filling), BufferSize);
 }
 
 void raw_fd_ostream::close() {
   assert(ShouldClose);
   ShouldClose = false;
   flush();
+  wait_for_async_writes();
   if (sys::Process::SafelyCloseFileDescriptor(FD))
     error_detected();
   FD = -1;
@@ -625,6 +758,7 @@ void raw_fd_ostream::close() {
 uint64_t raw_fd_ostream::seek(uint64_t off) {
   assert(SupportsSeeking && "Stream does not support seeking!");
   flush();
+  wait_for_async_writes();
   pos = ::lseek(FD, off, SEEK_SET);
   if (pos == (uint64_t)-1)
     error_detected();
@@ -0,0 +1,151 @@
+//===- xxhash.cpp - Fast non-cryptographic hashing ------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements XXH64 as specified by the reference implementation at
+// https://github.com/Cyan4973/xxHash, which is under the BSD license.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/xxhash.h"
+#include "llvm/Support/Endian.h"
+
+#include <cstring>
+
+using namespace llvm;
+using namespace support;
+
+static const uint64_t PRIME64_1 = 11400714785074694791ULL;
+static const uint64_t PRIME64_2 = 14029467366897019727ULL;
+static const uint64_t PRIME64_3 = 1609587929392839161ULL;
+static const uint64_t PRIME64_4 = 9650029242287828579ULL;
+static const uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+/// The seed of the high half of the 128-bit hash.
+static const uint64_t HighSeed = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rotl64(uint64_t X, int R) {
+  return (X << R) | (X >> (64 - R));
+}
+
+static uint64_t xxh64Round(uint64_t Acc, uint64_t Input) {
+  Acc += Input * PRIME64_2;
+  Acc = rotl64(Acc, 31);
+  Acc *= PRIME64_1;
+  return Acc;
+}
+
+static uint64_t mergeRound(uint64_t Acc, uint64_t Val) {
+  Val = xxh64Round(0, Val);
+  Acc ^= Val;
+  Acc = Acc * PRIME64_1 + PRIME64_4;
+  return Acc;
+}
+
+static void initAccumulators(uint64_t *Acc, uint64_t Seed) {
+  Acc[0] = Seed + PRIME64_1 + PRIME64_2;
+  Acc[1] = Seed + PRIME64_2;
+  Acc[2] = Seed;
+  Acc[3] = Seed - PRIME64_1;
+}
+
+static void consumeStripe(uint64_t *Acc, const uint8_t *P) {
+  for (int I = 0; I < 4; ++I)
+    Acc[I] = xxh64Round(Acc[I], endian::read64le(P + 8 * I));
+}
+
+// Return the hash of the data whose accumulators are Acc and whose last
+// Length % 32 bytes are at Tail.
+static uint64_t finalize(const uint64_t *Acc, uint64_t Seed, uint64_t Length,
+                         const uint8_t *Tail) {
+  uint64_t H64;
+  if (Length >= 32) {
+    H64 = rotl64(Acc[0], 1) + rotl64(Acc[1], 7) + rotl64(Acc[2], 12) +
+          rotl64(Acc[3], 18);
+    for (int I = 0; I < 4; ++I)
+      H64 = mergeRound(H64, Acc[I]);
+  } else {
+    H64 = Seed + PRIME64_5;
+  }
+  H64 += Length;
+
+  const uint8_t *P = Tail;
+  const uint8_t *const End = Tail + (Length & 31);
+  for (; P + 8 <= End; P += 8) {
+    H64 ^= xxh64Round(0, endian::read64le(P));
+    H64 = rotl64(H64, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (P + 4 <= End) {
+    H64 ^= (uint64_t)endian::read32le(P) * PRIME64_1;
+    H64 = rotl64(H64, 23) * PRIME64_2 + PRIME64_3;
+    P += 4;
+  }
+  for (; P < End; ++P) {
+    H64 ^= (*P) * PRIME64_5;
+    H64 = rotl64(H64, 11) * PRIME64_1;
+  }
+
+  H64 ^= H64 >> 33;
+  H64 *= PRIME64_2;
+  H64 ^= H64 >> 29;
+  H64 *= PRIME64_3;
+  H64 ^= H64 >> 32;
+  return H64;
+}
+
+uint64_t llvm::xxHash64(ArrayRef<uint8_t> Data, uint64_t Seed) {
+  uint64_t Acc[4];
+  initAccumulators(Acc, Seed);
+  const uint8_t *P = Data.data();
+  const uint8_t *const StripesEnd = P + (Data.size() & ~size_t(31));
+  for (; P != StripesEnd; P += 32)
+    consumeStripe(Acc, P);
+  return finalize(Acc, Seed, Data.size(), P);
+}
+
+void xxHash128::init() {
+  initAccumulators(Acc[0], 0);
+  initAccumulators(Acc[1], HighSeed);
+  TotalLength = 0;
+}
+
+void xxHash128::update(ArrayRef<uint8_t> Data) {
+  const uint8_t *P = Data.data();
+  size_t Size = Data.size();
+  size_t Used = TotalLength % STRIPE_LENGTH;
+  TotalLength += Size;
+
+  // Complete the buffered stripe first.
+  if (Used) {
+    size_t Free = STRIPE_LENGTH - Used;
+    if (Size < Free) {
+      memcpy(Buffer + Used, P, Size);
+      return;
+    }
+    memcpy(Buffer + Used, P, Free);
+    consumeStripe(Acc[0], Buffer);
+    consumeStripe(Acc[1], Buffer);
+    P += Free;
+    Size -= Free;
+  }
+
+  // The two hashes go over each stripe together, as their rounds are
+  // independent.
+  for (; Size >= STRIPE_LENGTH; P += STRIPE_LENGTH, Size -= STRIPE_LENGTH) {
+    consumeStripe(Acc[0], P);
+    consumeStripe(Acc[1], P);
+  }
+  memcpy(Buffer, P, Size);
+}
+
+Hash128 xxHash128::result() const {
+  Hash128 Result;
+  Result.Low = finalize(Acc[0], 0, TotalLength, Buffer);
+  Result.High = finalize(Acc[1], HighSeed, TotalLength, Buffer);
+  return Result;
+}
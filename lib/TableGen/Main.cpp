@@ -17,6 +17,7 @@
 
 #include "llvm/TableGen/Main.h"
 #include "TGParser.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
@@ -26,6 +27,10 @@
 #include <algorithm>
 #include <cstdio>
 #include <system_error>
+#ifdef LLVM_ON_UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 using namespace llvm;
 
 static cl::opt<std::string>
@@ -49,11 +54,8 @@ IncludeDirs("I", cl::desc("Directory of include files"),
 ///
 /// This functionality is really only for the benefit of the build system.
 /// It is similar to GCC's `-M*` family of options.
-static int createDependencyFile(const TGParser &Parser, const char *argv0) {
-  if (OutputFilename == "-") {
-    errs() << argv0 << ": the option -d must be used together with -o\n";
-    return 1;
-  }
+static int createDependencyFile(const TGParser &Parser, const char *argv0,
+                                StringRef Targets) {
   std::error_code EC;
   tool_output_file DepOut(DependFilename, EC, sys::fs::F_Text);
   if (EC) {
@@ -61,7 +63,7 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
            << EC.message() << "\n";
     return 1;
   }
-  DepOut.os() << OutputFilename << ":";
+  DepOut.os() << Targets << ":";
   for (const auto &Dep : Parser.getDependencies()) {
     DepOut.os() << ' ' << Dep.first;
   }
@@ -70,16 +72,15 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
   return 0;
 }
 
-int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
-  RecordKeeper Records;
-
-  // Parse the input file.
+/// \brief Add the input file to SrcMgr, for TGParser to pick it up.
+/// \returns true on error, false otherwise
+static bool addInputFile() {
   ErrorOr<std::unique_ptr<MemoryBuffer>> FileOrErr =
       MemoryBuffer::getFileOrSTDIN(InputFilename);
   if (std::error_code EC = FileOrErr.getError()) {
     errs() << "Could not open input file '" << InputFilename
            << "': " << EC.message() << "\n";
-    return 1;
+    return true;
   }
 
   // Tell SrcMgr about this buffer, which is what TGParser will pick up.
@@ -88,7 +89,15 @@ int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
   // Record the location of the include directory so that the lexer can find
   // it later.
   SrcMgr.setIncludeDirs(IncludeDirs);
+  return false;
+}
+
+int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
+  RecordKeeper Records;
 
+  // Parse the input file.
+  if (addInputFile())
+    return 1;
   TGParser Parser(SrcMgr, Records);
 
   if (Parser.ParseFile())
@@ -102,7 +111,11 @@ int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
     return 1;
   }
   if (!DependFilename.empty()) {
-    if (int Ret = createDependencyFile(Parser, argv0))
+    if (OutputFilename == "-") {
+      errs() << argv0 << ": the option -d must be used together with -o\n";
+      return 1;
+    }
+    if (int Ret = createDependencyFile(Parser, argv0, OutputFilename))
       return Ret;
   }
 
@@ -118,3 +131,98 @@ int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
   Out.keep();
   return 0;
 }
+
+/// \brief Perform the action of Output, and write its output file unless it
+/// already has the same contents.
+/// \returns true on error, false otherwise
+static bool performBatchOutput(const char *argv0,
+                               const TableGenBatchOutput &Output,
+                               RecordKeeper &Records) {
+  std::string Contents;
+  raw_string_ostream OS(Contents);
+  if (Output.Run(OS, Records))
+    return true;
+  OS.flush();
+  if (ErrorsPrinted > 0) {
+    errs() << argv0 << ": " << ErrorsPrinted << " errors.\n";
+    return true;
+  }
+
+  // Leave an unchanged file alone, so that what depends on it is not rebuilt.
+  ErrorOr<std::unique_ptr<MemoryBuffer>> OldOrErr =
+      MemoryBuffer::getFile(Output.Filename);
+  if (OldOrErr && (*OldOrErr)->getBuffer() == Contents)
+    return false;
+
+  std::error_code EC;
+  tool_output_file Out(Output.Filename, EC, sys::fs::F_Text);
+  if (EC) {
+    errs() << argv0 << ": error opening " << Output.Filename << ":"
+           << EC.message() << "\n";
+    return true;
+  }
+  Out.os() << Contents;
+  Out.keep();
+  return false;
+}
+
+int llvm::TableGenBatchMain(char *argv0, ArrayRef<TableGenBatchOutput> Outputs,
+                            unsigned NumJobs) {
+  RecordKeeper Records;
+
+  // Parse the input file, only once for all the outputs.
+  if (addInputFile())
+    return 1;
+  TGParser Parser(SrcMgr, Records);
+
+  if (Parser.ParseFile())
+    return 1;
+
+  if (!DependFilename.empty()) {
+    std::string Targets;
+    for (const TableGenBatchOutput &Output : Outputs)
+      Targets += (Targets.empty() ? "" : " ") + Output.Filename;
+    if (int Ret = createDependencyFile(Parser, argv0, Targets))
+      return Ret;
+  }
+
+  bool Failed = false;
+#ifdef LLVM_ON_UNIX
+  // The backends are not thread-safe, as they share the records and the
+  // uniqued Inits, so each action is performed in a fork of this process,
+  // which has a copy of them.
+  if (NumJobs > 1 && Outputs.size() > 1) {
+    unsigned NumRunning = 0;
+    auto WaitForOne = [&]() {
+      int Status;
+      if (::wait(&Status) == -1 || !WIFEXITED(Status) || WEXITSTATUS(Status))
+        Failed = true;
+      --NumRunning;
+    };
+    for (const TableGenBatchOutput &Output : Outputs) {
+      if (NumRunning == NumJobs)
+        WaitForOne();
+      outs().flush();
+      errs().flush();
+      pid_t Pid = ::fork();
+      if (Pid == 0) {
+        bool Error = performBatchOutput(argv0, Output, Records);
+        outs().flush();
+        errs().flush();
+        ::_exit(Error ? 1 : 0);
+      }
+      if (Pid == -1)
+        Failed |= performBatchOutput(argv0, Output, Records);
+      else
+        ++NumRunning;
+    }
+    while (NumRunning)
+      WaitForOne();
+    return Failed ? 1 : 0;
+  }
+#endif
+
+  for (const TableGenBatchOutput &Output : Outputs)
+    Failed |= performBatchOutput(argv0, Output, Records);
+  return Failed ? 1 : 0;
+}
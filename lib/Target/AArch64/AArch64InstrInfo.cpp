@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "AArch64InstrInfo.h"
+#include "AArch64MachineFunctionInfo.h"
 #include "AArch64Subtarget.h"
 #include "MCTargetDesc/AArch64AddressingModes.h"
 #include "llvm/CodeGen/MachineFrameInfo.h"
@@ -3996,3 +3997,90 @@ AArch64InstrInfo::getSerializableBitmaskMachineOperandTargetFlags() const {
       {MO_CONSTPOOL, "aarch64-constant-pool"}};
   return makeArrayRef(TargetFlags);
 }
+
+bool AArch64InstrInfo::isFunctionSafeToOutlineFrom(MachineFunction &MF) const {
+  // A call to an outlined function saves LR below the stack pointer, where it
+  // would overwrite the red zone.
+  return !Subtarget.getFrameLowering()->canUseRedZone(MF);
+}
+
+AArch64InstrInfo::MachineOutlinerInstrType
+AArch64InstrInfo::getOutliningType(MachineInstr &MI) const {
+  MachineBasicBlock &MBB = *MI.getParent();
+  const AArch64FunctionInfo *AFI =
+      MBB.getParent()->getInfo<AArch64FunctionInfo>();
+
+  // The linker optimization hints refer to the instructions by label.
+  if (AFI->getLOHRelated().count(&MI))
+    return Illegal;
+
+  if (MI.isDebugValue() || MI.isKill())
+    return Invisible;
+
+  // A sequence may end in the return of its function, the call to the
+  // outlined function is then a tail call. Other terminators branch to blocks
+  // of their own function.
+  if (MI.isTerminator())
+    return MBB.succ_empty() ? Legal : Illegal;
+
+  // The outlined function returns through LR, so it can't make calls of its
+  // own, and the call to it moves SP while it runs.
+  if (MI.isCall())
+    return Illegal;
+  for (unsigned Reg : {AArch64::LR, AArch64::SP})
+    if (MI.readsRegister(Reg, &RI) || MI.modifiesRegister(Reg, &RI))
+      return Illegal;
+
+  // A veneer the linker places between the call and the outlined function may
+  // clobber the intra-procedure-call registers.
+  for (unsigned Reg : {AArch64::X16, AArch64::X17})
+    if (MI.readsRegister(Reg, &RI) || MI.modifiesRegister(Reg, &RI))
+      return Illegal;
+
+  return Legal;
+}
+
+unsigned AArch64InstrInfo::getOutliningCallOverhead(bool IsTailCall) const {
+  // A tail call is a single branch. Otherwise LR is saved around a BL.
+  return IsTailCall ? 1 : 3;
+}
+
+unsigned AArch64InstrInfo::getOutliningFrameOverhead(bool IsTailCall) const {
+  // The outlined sequence returns by itself when it is tail called, and needs
+  // a RET otherwise.
+  return IsTailCall ? 0 : 1;
+}
+
+void AArch64InstrInfo::insertOutlinerEpilogue(MachineBasicBlock &MBB,
+                                              MachineFunction &MF,
+                                              bool IsTailCall) const {
+  if (IsTailCall)
+    return;
+  BuildMI(MBB, MBB.end(), DebugLoc(), get(AArch64::RET))
+      .addReg(AArch64::LR);
+}
+
+void AArch64InstrInfo::insertOutlinedCall(MachineBasicBlock &MBB,
+                                          MachineBasicBlock::iterator It,
+                                          MachineFunction &MF,
+                                          const GlobalValue *Callee,
+                                          bool IsTailCall) const {
+  DebugLoc DL = It->getDebugLoc();
+  if (IsTailCall) {
+    BuildMI(MBB, It, DL, get(AArch64::B)).addGlobalAddress(Callee);
+    return;
+  }
+
+  // Save LR around the call: str x30, [sp, #-16]!; bl; ldr x30, [sp], #16
+  BuildMI(MBB, It, DL, get(AArch64::STRXpre))
+      .addReg(AArch64::SP, RegState::Define)
+      .addReg(AArch64::LR)
+      .addReg(AArch64::SP)
+      .addImm(-16);
+  BuildMI(MBB, It, DL, get(AArch64::BL)).addGlobalAddress(Callee);
+  BuildMI(MBB, It, DL, get(AArch64::LDRXpost))
+      .addReg(AArch64::SP, RegState::Define)
+      .addReg(AArch64::LR, RegState::Define)
+      .addReg(AArch64::SP)
+      .addImm(16);
+}
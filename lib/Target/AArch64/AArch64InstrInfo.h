@@ -208,6 +208,17 @@ public:
   ArrayRef<std::pair<unsigned, const char *>>
   getSerializableBitmaskMachineOperandTargetFlags() const override;
 
+  bool isFunctionSafeToOutlineFrom(MachineFunction &MF) const override;
+  MachineOutlinerInstrType getOutliningType(MachineInstr &MI) const override;
+  unsigned getOutliningCallOverhead(bool IsTailCall) const override;
+  unsigned getOutliningFrameOverhead(bool IsTailCall) const override;
+  void insertOutlinerEpilogue(MachineBasicBlock &MBB, MachineFunction &MF,
+                              bool IsTailCall) const override;
+  void insertOutlinedCall(MachineBasicBlock &MBB,
+                          MachineBasicBlock::iterator It, MachineFunction &MF,
+                          const GlobalValue *Callee,
+                          bool IsTailCall) const override;
+
 private:
   void instantiateCondBranch(MachineBasicBlock &MBB, DebugLoc DL,
                              MachineBasicBlock *TBB,
@@ -0,0 +1,134 @@
+//===- AArch64InstructionSelector.cpp ----------------------------*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+/// \file
+/// This file implements the targeting of the InstructionSelector class for
+/// AArch64.
+/// \todo This should be generated by TableGen.
+//===----------------------------------------------------------------------===//
+
+#include "AArch64InstructionSelector.h"
+#include "AArch64InstrInfo.h"
+#include "AArch64RegisterBankInfo.h"
+#include "AArch64RegisterInfo.h"
+#include "llvm/CodeGen/GlobalISel/RegisterBank.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineRegisterInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "aarch64-isel"
+
+using namespace llvm;
+
+#ifndef LLVM_BUILD_GLOBAL_ISEL
+#error "You shouldn't build this"
+#endif
+
+AArch64InstructionSelector::AArch64InstructionSelector(
+    const AArch64InstrInfo &TII, const AArch64RegisterInfo &TRI,
+    const AArch64RegisterBankInfo &RBI)
+    : InstructionSelector(), TII(TII), TRI(TRI), RBI(RBI) {}
+
+/// Return the register class to use for a value of \p Size bits living in
+/// the register bank \p RB, or nullptr if there is none.
+static const TargetRegisterClass *getRegClassForBank(const RegisterBank &RB,
+                                                     unsigned Size) {
+  switch (RB.getID()) {
+  case AArch64::GPRRegBankID:
+    if (Size <= 32)
+      return &AArch64::GPR32RegClass;
+    if (Size == 64)
+      return &AArch64::GPR64RegClass;
+    return nullptr;
+  case AArch64::FPRRegBankID:
+    switch (Size) {
+    case 32:
+      return &AArch64::FPR32RegClass;
+    case 64:
+      return &AArch64::FPR64RegClass;
+    case 128:
+      return &AArch64::FPR128RegClass;
+    }
+    return nullptr;
+  }
+  return nullptr;
+}
+
+bool AArch64InstructionSelector::selectCopy(MachineInstr &I) const {
+  MachineRegisterInfo &MRI = I.getParent()->getParent()->getRegInfo();
+  for (MachineOperand &MO : I.operands()) {
+    if (!MO.isReg() || !TargetRegisterInfo::isVirtualRegister(MO.getReg()))
+      continue;
+    unsigned Reg = MO.getReg();
+    // Registers that already have a class are not generic any more.
+    if (MRI.getRegClassOrNull(Reg))
+      continue;
+    const RegisterBank *RB = MRI.getRegBankOrNull(Reg);
+    if (!RB)
+      return false;
+    const TargetRegisterClass *RC = getRegClassForBank(*RB, MRI.getSize(Reg));
+    if (!RC) {
+      DEBUG(dbgs() << "No register class for " << PrintReg(Reg, &TRI)
+                   << " of size " << MRI.getSize(Reg) << '\n');
+      return false;
+    }
+    MRI.setRegClass(Reg, RC);
+  }
+  return true;
+}
+
+bool AArch64InstructionSelector::select(MachineInstr &I) const {
+  assert(I.getParent() && "Instruction should be in a basic block!");
+  assert(I.getParent()->getParent() && "Instruction should be in a function!");
+
+  if (!isPreISelGenericOpcode(I.getOpcode()))
+    return !I.isCopy() || selectCopy(I);
+
+  MachineRegisterInfo &MRI = I.getParent()->getParent()->getRegInfo();
+
+  switch (I.getOpcode()) {
+  case TargetOpcode::G_BR: {
+    I.setType(nullptr);
+    I.setDesc(TII.get(AArch64::B));
+    return true;
+  }
+
+  case TargetOpcode::G_ADD: {
+    unsigned DefReg = I.getOperand(0).getReg();
+    const RegisterBank *RB = RBI.getRegBank(DefReg, MRI, TRI);
+    if (!RB || RB->getID() != AArch64::GPRRegBankID) {
+      DEBUG(dbgs() << "G_ADD on bank: " << (RB ? RB->getName() : "<none>")
+                   << ", expected: GPR\n");
+      return false;
+    }
+
+    unsigned Opc;
+    switch (MRI.getSize(DefReg)) {
+    case 32:
+      Opc = AArch64::ADDWrr;
+      break;
+    case 64:
+      Opc = AArch64::ADDXrr;
+      break;
+    default:
+      DEBUG(dbgs() << "G_ADD of unsupported size " << MRI.getSize(DefReg)
+                   << '\n');
+      return false;
+    }
+
+    I.setType(nullptr);
+    I.setDesc(TII.get(Opc));
+    return constrainSelectedInstRegOperands(I, TII, TRI, RBI);
+  }
+  }
+
+  return false;
+}
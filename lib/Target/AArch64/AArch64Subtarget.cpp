@@ -65,6 +65,11 @@ const RegisterBankInfo *AArch64Subtarget::getRegBankInfo() const {
   return GISel->getRegBankInfo();
 }
 
+const InstructionSelector *AArch64Subtarget::getInstructionSelector() const {
+  assert(GISel && "Access to GlobalISel APIs not set");
+  return GISel->getInstructionSelector();
+}
+
 /// Find the target operand flags that describe how a global value should be
 /// referenced for the current subtarget.
 unsigned char
@@ -184,6 +184,8 @@ bool AMDGPUAsmPrinter::runOnMachineFunction(MachineFunction &MF) {
                                   false);
       OutStreamer->emitRawComment(" NumVgprs: " + Twine(KernelInfo.NumVGPR),
                                   false);
+      OutStreamer->emitRawComment(" Occupancy: " + Twine(KernelInfo.Occupancy),
+                                  false);
       OutStreamer->emitRawComment(" FloatMode: " + Twine(KernelInfo.FloatMode),
                                   false);
       OutStreamer->emitRawComment(" IeeeMode: " + Twine(KernelInfo.IEEEMode),
@@ -502,6 +504,12 @@ void AMDGPUAsmPrinter::getSIProgramInfo(SIProgramInfo &ProgInfo,
   ProgInfo.LDSBlocks =
       alignTo(ProgInfo.LDSSize, 1ULL << LDSAlignShift) >> LDSAlignShift;
 
+  ProgInfo.Occupancy =
+      std::min(std::min(STM.getMaxWavesPerCU(),
+                        STM.getOccupancyWithLocalMemSize(ProgInfo.LDSSize)),
+               std::min(STM.getOccupancyWithNumSGPRs(ProgInfo.NumSGPR),
+                        STM.getOccupancyWithNumVGPRs(ProgInfo.NumVGPR)));
+
   // Scratch is allocated in 256 dword blocks.
   unsigned ScratchAlignShift = 10;
   // We need to program the hardware with the amount of scratch memory that
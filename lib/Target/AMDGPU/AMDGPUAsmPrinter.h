@@ -43,6 +43,7 @@ private:
       ReservedVGPRFirst(0),
       ReservedVGPRCount(0),
       VCCUsed(false),
+      Occupancy(0),
       CodeLen(0) {}
 
     // Fields set in PGM_RSRC1 pm4 packet.
@@ -77,6 +78,8 @@ private:
 
     // Bonus information for debugging.
     bool VCCUsed;
+    // The number of waves per SIMD the registers and LDS used allow.
+    uint32_t Occupancy;
     uint64_t CodeLen;
   };
 
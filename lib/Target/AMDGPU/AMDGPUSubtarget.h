@@ -277,6 +277,14 @@ public:
   /// the given LDS memory size is the only constraint.
   unsigned getOccupancyWithLocalMemSize(uint32_t Bytes) const;
 
+  /// Return the maximum number of waves per SIMD if the number of SGPRs a
+  /// kernel uses is the only constraint.
+  unsigned getOccupancyWithNumSGPRs(unsigned SGPRs) const;
+
+  /// Return the maximum number of waves per SIMD if the number of VGPRs a
+  /// kernel uses is the only constraint.
+  unsigned getOccupancyWithNumVGPRs(unsigned VGPRs) const;
+
 
   int getLocalMemorySize() const {
     return LocalMemorySize;
@@ -0,0 +1,218 @@
+//===-- GCNSchedStrategy.cpp - GCN Scheduler Strategy ---------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// This contains a MachineSchedStrategy implementation for maximizing wave
+/// occupancy on GCN hardware, and a ScheduleDAG that keeps the original order
+/// of regions whose new schedule would lower the kernel's occupancy.
+//===----------------------------------------------------------------------===//
+
+#include "GCNSchedStrategy.h"
+#include "AMDGPUSubtarget.h"
+#include "SIInstrInfo.h"
+#include "SIMachineFunctionInfo.h"
+#include "SIRegisterInfo.h"
+#include "llvm/CodeGen/LiveIntervalAnalysis.h"
+#include "llvm/CodeGen/RegisterClassInfo.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define DEBUG_TYPE "misched"
+
+using namespace llvm;
+
+GCNMaxOccupancySchedStrategy::GCNMaxOccupancySchedStrategy(
+    const MachineSchedContext *C)
+    : GenericScheduler(C), LiveDAG(nullptr), TargetOccupancy(0),
+      SGPRExcessLimit(0), VGPRExcessLimit(0), SGPRCriticalLimit(0),
+      VGPRCriticalLimit(0) {}
+
+static unsigned getTargetOccupancy(const MachineFunction &MF) {
+  const AMDGPUSubtarget &ST = MF.getSubtarget<AMDGPUSubtarget>();
+  const SIMachineFunctionInfo *MFI = MF.getInfo<SIMachineFunctionInfo>();
+  return std::min(ST.getMaxWavesPerCU(),
+                  ST.getOccupancyWithLocalMemSize(MFI->LDSSize));
+}
+
+void GCNMaxOccupancySchedStrategy::initialize(ScheduleDAGMI *DAG) {
+  GenericScheduler::initialize(DAG);
+  LiveDAG = static_cast<ScheduleDAGMILive *>(DAG);
+
+  const MachineFunction &MF = DAG->MF;
+  const AMDGPUSubtarget &ST = MF.getSubtarget<AMDGPUSubtarget>();
+  const SIRegisterInfo *SRI = static_cast<const SIRegisterInfo *>(TRI);
+
+  // Going over the allocatable registers means spilling; going over the
+  // number of registers allowed at the target occupancy means fewer waves.
+  TargetOccupancy = getTargetOccupancy(MF);
+  SGPRExcessLimit =
+      Context->RegClassInfo->getNumAllocatableRegs(&AMDGPU::SGPR_32RegClass);
+  VGPRExcessLimit =
+      Context->RegClassInfo->getNumAllocatableRegs(&AMDGPU::VGPR_32RegClass);
+  SGPRCriticalLimit =
+      SRI->getNumSGPRsAllowed(ST.getGeneration(), TargetOccupancy);
+  VGPRCriticalLimit = SRI->getNumVGPRsAllowed(TargetOccupancy);
+}
+
+void GCNMaxOccupancySchedStrategy::initCandidate(
+    SchedCandidate &Cand, SUnit *SU, bool AtTop,
+    const RegPressureTracker &RPTracker, RegPressureTracker &TempTracker) {
+  GenericScheduler::initCandidate(Cand, SU, AtTop, RPTracker, TempTracker);
+  if (!LiveDAG->isTrackingPressure())
+    return;
+
+  const SIRegisterInfo *SRI = static_cast<const SIRegisterInfo *>(TRI);
+  unsigned SGPRSet = SRI->getSGPR32PressureSet();
+  unsigned VGPRSet = SRI->getVGPR32PressureSet();
+
+  const std::vector<unsigned> &Current = RPTracker.getRegSetPressureAtPos();
+  int SGPRPressure = Current[SGPRSet];
+  int VGPRPressure = Current[VGPRSet];
+
+  std::vector<unsigned> Pressure, MaxPressure;
+  if (AtTop)
+    TempTracker.getDownwardPressure(SU->getInstr(), Pressure, MaxPressure);
+  else
+    TempTracker.getUpwardPressure(SU->getInstr(), Pressure, MaxPressure);
+  int NewSGPRPressure = Pressure[SGPRSet];
+  int NewVGPRPressure = Pressure[VGPRSet];
+
+  // Replace the generic pressure sets with SGPRs and VGPRs measured against
+  // our own limits.
+  Cand.RPDelta.Excess = PressureChange();
+  Cand.RPDelta.CriticalMax = PressureChange();
+
+  // Some passes between scheduling and register allocation increase the
+  // pressure, so leave a little room.
+  const int ErrorMargin = 3;
+
+  // If two instructions increase the pressure of different sets by the same
+  // amount, the generic heuristics prefer the one increasing the set with the
+  // fewest registers, which here would be SGPRs. That is rarely what we want,
+  // so only one of the two sets is reported as being in excess.
+  const int MaxVGPRPressureInc = 16;
+  bool ShouldTrackVGPRs =
+      VGPRPressure + MaxVGPRPressureInc >= VGPRExcessLimit - ErrorMargin;
+  bool ShouldTrackSGPRs =
+      !ShouldTrackVGPRs && SGPRPressure >= SGPRExcessLimit - ErrorMargin;
+
+  if (ShouldTrackVGPRs && NewVGPRPressure >= VGPRExcessLimit - ErrorMargin) {
+    Cand.RPDelta.Excess = PressureChange(VGPRSet);
+    Cand.RPDelta.Excess.setUnitInc(NewVGPRPressure - VGPRExcessLimit +
+                                   ErrorMargin);
+  }
+  if (ShouldTrackSGPRs && NewSGPRPressure >= SGPRExcessLimit - ErrorMargin) {
+    Cand.RPDelta.Excess = PressureChange(SGPRSet);
+    Cand.RPDelta.Excess.setUnitInc(NewSGPRPressure - SGPRExcessLimit +
+                                   ErrorMargin);
+  }
+
+  // Pressure is critical when it approaches the point where the occupancy
+  // drops. Going over costs a wave either way, so SGPRs and VGPRs are treated
+  // the same here.
+  int SGPRDelta = NewSGPRPressure - (SGPRCriticalLimit - ErrorMargin);
+  int VGPRDelta = NewVGPRPressure - (VGPRCriticalLimit - ErrorMargin);
+  if (SGPRDelta >= 0 || VGPRDelta >= 0) {
+    if (SGPRDelta > VGPRDelta) {
+      Cand.RPDelta.CriticalMax = PressureChange(SGPRSet);
+      Cand.RPDelta.CriticalMax.setUnitInc(SGPRDelta);
+    } else {
+      Cand.RPDelta.CriticalMax = PressureChange(VGPRSet);
+      Cand.RPDelta.CriticalMax.setUnitInc(VGPRDelta);
+    }
+  }
+}
+
+GCNScheduleDAGMILive::GCNScheduleDAGMILive(
+    MachineSchedContext *C, std::unique_ptr<MachineSchedStrategy> S)
+    : ScheduleDAGMILive(C, std::move(S)),
+      ST(MF.getSubtarget<AMDGPUSubtarget>()),
+      SRI(static_cast<const SIRegisterInfo *>(TRI)),
+      MinOccupancy(getTargetOccupancy(MF)) {}
+
+/// Returns the number of waves per SIMD the SGPR and VGPR pressure in
+/// \p MaxSetPressure allows.
+unsigned GCNScheduleDAGMILive::getOccupancy(
+    const std::vector<unsigned> &MaxSetPressure) const {
+  return std::min(
+      ST.getOccupancyWithNumSGPRs(MaxSetPressure[SRI->getSGPR32PressureSet()]),
+      ST.getOccupancyWithNumVGPRs(MaxSetPressure[SRI->getVGPR32PressureSet()]));
+}
+
+void GCNScheduleDAGMILive::schedule() {
+  std::vector<MachineInstr *> Unsched;
+  Unsched.reserve(NumRegionInstrs);
+  for (MachineInstr &MI : *this)
+    Unsched.push_back(&MI);
+
+  ScheduleDAGMILive::schedule();
+  if (!isTrackingPressure() || Unsched.empty())
+    return;
+
+  // RegPressure was computed over the original order while building the DAG;
+  // the top and bottom trackers saw the new order.
+  unsigned TargetOccupancy =
+      static_cast<GCNMaxOccupancySchedStrategy &>(*SchedImpl)
+          .getTargetOccupancy();
+  unsigned WavesBefore =
+      std::min(TargetOccupancy, getOccupancy(RegPressure.MaxSetPressure));
+  unsigned WavesAfter = std::min(
+      TargetOccupancy, std::min(getOccupancy(TopPressure.MaxSetPressure),
+                                getOccupancy(BotPressure.MaxSetPressure)));
+  DEBUG(dbgs() << "Occupancy before scheduling: " << WavesBefore
+               << ", after: " << WavesAfter << ", target: " << TargetOccupancy
+               << '\n');
+
+  if (WavesAfter < WavesBefore) {
+    DEBUG(dbgs() << "Reverting the schedule of this region.\n");
+    revertScheduling(Unsched);
+    WavesAfter = WavesBefore;
+  }
+  MinOccupancy = std::min(MinOccupancy, WavesAfter);
+}
+
+/// Put the instructions of the region back in their original order.
+void GCNScheduleDAGMILive::revertScheduling(ArrayRef<MachineInstr *> Unsched) {
+  RegionEnd = RegionBegin;
+  for (MachineInstr *MI : Unsched) {
+    if (MI->getIterator() != RegionEnd) {
+      BB->remove(MI);
+      BB->insert(RegionEnd, MI);
+      if (!MI->isDebugValue())
+        LIS->handleMove(*MI, true);
+    }
+
+    // The scheduler may have added read-undef and dead flags for the new
+    // order; recompute them for the old one.
+    if (!MI->isDebugValue()) {
+      for (MachineOperand &Op : MI->operands())
+        if (Op.isReg() && Op.isDef())
+          Op.setIsUndef(false);
+
+      RegisterOperands RegOpers;
+      RegOpers.collect(*MI, *TRI, MRI, ShouldTrackLaneMasks, false);
+      if (ShouldTrackLaneMasks) {
+        SlotIndex SlotIdx = LIS->getInstructionIndex(*MI).getRegSlot();
+        RegOpers.adjustLaneLiveness(*LIS, MRI, SlotIdx, MI);
+      } else {
+        RegOpers.detectDeadDefs(*MI, *LIS);
+      }
+    }
+
+    RegionEnd = MI->getIterator();
+    ++RegionEnd;
+  }
+  RegionBegin = Unsched.front()->getIterator();
+}
+
+void GCNScheduleDAGMILive::finalizeSchedule() {
+  DEBUG(dbgs() << "Occupancy of " << MF.getName() << " after scheduling: "
+               << MinOccupancy << '\n');
+  ScheduleDAGMILive::finalizeSchedule();
+}
@@ -0,0 +1,80 @@
+//===-- GCNSchedStrategy.h - GCN Scheduler Strategy -*- C++ -*-------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+/// \file
+/// \brief Occupancy-aware scheduling for GCN.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_LIB_TARGET_AMDGPU_GCNSCHEDSTRATEGY_H
+#define LLVM_LIB_TARGET_AMDGPU_GCNSCHEDSTRATEGY_H
+
+#include "llvm/CodeGen/MachineScheduler.h"
+
+namespace llvm {
+
+class AMDGPUSubtarget;
+class SIRegisterInfo;
+
+/// This is a minimal scheduler strategy. The main difference between this
+/// and the GenericScheduler is how it determines excess and critical register
+/// pressure: SGPRs and VGPRs are measured against the number of registers
+/// that still allows the kernel's target occupancy (waves per SIMD), rather
+/// than against the limits for the maximum occupancy.
+class GCNMaxOccupancySchedStrategy : public GenericScheduler {
+  friend class GCNScheduleDAGMILive;
+
+  ScheduleDAGMILive *LiveDAG;
+
+  /// The number of waves per SIMD we would like to reach, as allowed by
+  /// everything but the registers (e.g. LDS usage).
+  unsigned TargetOccupancy;
+
+  int SGPRExcessLimit;
+  int VGPRExcessLimit;
+  int SGPRCriticalLimit;
+  int VGPRCriticalLimit;
+
+protected:
+  void initCandidate(SchedCandidate &Cand, SUnit *SU, bool AtTop,
+                     const RegPressureTracker &RPTracker,
+                     RegPressureTracker &TempTracker) override;
+
+public:
+  GCNMaxOccupancySchedStrategy(const MachineSchedContext *C);
+
+  void initialize(ScheduleDAGMI *DAG) override;
+
+  unsigned getTargetOccupancy() const { return TargetOccupancy; }
+};
+
+/// Schedules regions with a GCNMaxOccupancySchedStrategy, and puts back the
+/// original order of any region whose new schedule needs more registers than
+/// its target occupancy allows and more than the original order did.
+class GCNScheduleDAGMILive : public ScheduleDAGMILive {
+  const AMDGPUSubtarget &ST;
+  const SIRegisterInfo *SRI;
+
+  /// The lowest occupancy any region of the function was left with.
+  unsigned MinOccupancy;
+
+  unsigned getOccupancy(const std::vector<unsigned> &MaxSetPressure) const;
+  void revertScheduling(ArrayRef<MachineInstr *> Unsched);
+
+public:
+  GCNScheduleDAGMILive(MachineSchedContext *C,
+                       std::unique_ptr<MachineSchedStrategy> S);
+
+  void schedule() override;
+  void finalizeSchedule() override;
+};
+
+} // End namespace llvm
+
+#endif // LLVM_LIB_TARGET_AMDGPU_GCNSCHEDSTRATEGY_H
@@ -17,6 +17,7 @@
 #include "BPFMCInstLower.h"
 #include "BPFTargetMachine.h"
 #include "InstPrinter/BPFInstPrinter.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/CodeGen/AsmPrinter.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
@@ -26,12 +27,18 @@
 #include "llvm/MC/MCInst.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/raw_ostream.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "asm-printer"
 
+static cl::opt<bool> ReportProgramSize(
+    "bpf-report-program-size", cl::Hidden, cl::init(false),
+    cl::desc("Report the instruction count and the estimated verifier "
+             "complexity of each function"));
+
 namespace {
 class BPFAsmPrinter : public AsmPrinter {
 public:
@@ -43,6 +50,7 @@ public:
   void printOperand(const MachineInstr *MI, int OpNum, raw_ostream &O,
                     const char *Modifier = nullptr);
   void EmitInstruction(const MachineInstr *MI) override;
+  void EmitFunctionBodyEnd() override;
 };
 }
 
@@ -81,6 +89,61 @@ void BPFAsmPrinter::EmitInstruction(const MachineInstr *MI) {
   EmitToStreamer(*OutStreamer, TmpInst);
 }
 
+/// Return the number of instruction slots MBB takes in the program.
+static uint64_t getNumInstructions(const MachineBasicBlock &MBB) {
+  uint64_t NumInsts = 0;
+  for (const MachineInstr &MI : MBB) {
+    if (MI.isDebugValue() || MI.isPosition() || MI.isKill() ||
+        MI.isImplicitDef())
+      continue;
+    // A 64-bit immediate load takes two slots.
+    NumInsts += MI.getOpcode() == BPF::LD_imm64 ? 2 : 1;
+  }
+  return NumInsts;
+}
+
+// The verifier walks every path through the program, so without the state
+// pruning it does, the number of instructions it processes is the sum of the
+// instructions along all paths. Report that as an upper bound of the
+// complexity, together with the size of the program.
+void BPFAsmPrinter::EmitFunctionBodyEnd() {
+  if (!ReportProgramSize)
+    return;
+
+  ReversePostOrderTraversal<const MachineFunction *> RPOT(MF);
+  SmallVector<const MachineBasicBlock *, 16> RPO(RPOT.begin(), RPOT.end());
+  DenseMap<const MachineBasicBlock *, unsigned> RPONumber;
+  for (unsigned I = 0, E = RPO.size(); I != E; ++I)
+    RPONumber[RPO[I]] = I;
+
+  uint64_t NumInsts = 0;
+  bool HasLoop = false;
+  DenseMap<const MachineBasicBlock *, uint64_t> PathInsts;
+  for (const MachineBasicBlock *MBB : reverse(RPO)) {
+    uint64_t BlockInsts = getNumInstructions(*MBB);
+    NumInsts += BlockInsts;
+    uint64_t Work = BlockInsts;
+    for (const MachineBasicBlock *Succ : MBB->successors()) {
+      if (RPONumber[Succ] <= RPONumber[MBB]) {
+        HasLoop = true;
+        continue;
+      }
+      uint64_t SuccWork = PathInsts[Succ];
+      Work = Work + SuccWork < Work ? UINT64_MAX : Work + SuccWork;
+    }
+    PathInsts[MBB] = Work;
+  }
+
+  OutStreamer->emitRawComment(" Instructions: " + Twine(NumInsts), false);
+  if (HasLoop)
+    OutStreamer->emitRawComment(" Verifier complexity: unbounded (loop)",
+                                false);
+  else
+    OutStreamer->emitRawComment(" Verifier complexity: " +
+                                    Twine(PathInsts[&MF->front()]),
+                                false);
+}
+
 // Force static initialization.
 extern "C" void LLVMInitializeBPFAsmPrinter() {
   RegisterAsmPrinter<BPFAsmPrinter> X(TheBPFleTarget);
@@ -66,8 +66,9 @@
 // but proving %y2 specific circles back to %y. To address this complication,
 // the data flow analysis operates on a lattice:
 //   uninitialized > specific address spaces > generic.
-// All address expressions (our implementation only considers phi, bitcast,
-// addrspacecast, and getelementptr) start with the uninitialized address space.
+// All address expressions (our implementation only considers phi, select,
+// bitcast, addrspacecast, and getelementptr) start with the uninitialized
+// address space.
 // The monotone transfer function moves the address space of a pointer down a
 // lattice path from uninitialized to specific and then to generic. A join
 // operation of two different specific address spaces pushes the expression down
@@ -87,6 +88,12 @@
 // Finally, it fixes the undef in %y' so that
 //   %y' = phi float addrspace(3)* [ %input, %y2' ]
 //
+// Pointers passed into an internal function are inferred from its call sites.
+// If every call passes a pointer argument that points to the same specific
+// address space, the argument is cast to that address space and back at the
+// function entry, which makes it an address expression like any other. The
+// casts are removed again if nothing ends up using the specific pointer.
+//
 // TODO: This pass is experimental and not enabled by default. Users can turn it
 // on by setting the -nvptx-use-infer-addrspace flag of llc. We plan to replace
 // NVPTXNonFavorGenericAddrSpaces with this pass shortly.
@@ -99,10 +106,12 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/IR/CallSite.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Operator.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -125,6 +134,11 @@ public:
   bool runOnFunction(Function &F) override;
 
 private:
+  // Casts each generic pointer argument of F that all call sites agree points
+  // to one specific address space to that space and back. Returns the casts
+  // to the specific address space.
+  SmallVector<WeakVH, 4> castArgumentsToSpecificAddressSpaces(Function &F);
+
   // Returns the new address space of V if updated; otherwise, returns None.
   Optional<unsigned>
   updateAddressSpace(const Value &V,
@@ -155,7 +169,7 @@ INITIALIZE_PASS(NVPTXInferAddressSpaces, "nvptx-infer-addrspace",
                 false, false)
 
 // Returns true if V is an address expression.
-// TODO: Currently, we consider only phi, bitcast, addrspacecast, and
+// TODO: Currently, we consider only phi, select, bitcast, addrspacecast, and
 // getelementptr operators.
 static bool isAddressExpression(const Value &V) {
   if (!isa<Operator>(V))
@@ -163,6 +177,7 @@ static bool isAddressExpression(const Value &V) {
 
   switch (cast<Operator>(V).getOpcode()) {
   case Instruction::PHI:
+  case Instruction::Select:
   case Instruction::BitCast:
   case Instruction::AddrSpaceCast:
   case Instruction::GetElementPtr:
@@ -184,6 +199,8 @@ static SmallVector<Value *, 2> getPointerOperands(const Value &V) {
     return SmallVector<Value *, 2>(IncomingValues.begin(),
                                    IncomingValues.end());
   }
+  case Instruction::Select:
+    return {Op.getOperand(1), Op.getOperand(2)};
   case Instruction::BitCast:
   case Instruction::AddrSpaceCast:
   case Instruction::GetElementPtr:
@@ -313,6 +330,9 @@ static Value *cloneInstructionWithNewAddressSpace(
     }
     return NewPHI;
   }
+  case Instruction::Select:
+    return SelectInst::Create(I->getOperand(0), NewPointerOperands[1],
+                              NewPointerOperands[2]);
   case Instruction::GetElementPtr: {
     GetElementPtrInst *GEP = cast<GetElementPtrInst>(I);
     GetElementPtrInst *NewGEP = GetElementPtrInst::Create(
@@ -418,10 +438,83 @@ static unsigned joinAddressSpaces(unsigned AS1, unsigned AS2) {
   return AS1 == AS2 ? AS1 : (unsigned)AddressSpace::ADDRESS_SPACE_GENERIC;
 }
 
+// Returns the address space V points to, looking through the address
+// expressions that compute it. Unlike the data-flow analysis, this does not
+// iterate to a fixed point: values on a cycle are treated as uninitialized.
+static unsigned getUnderlyingAddressSpace(Value *V,
+                                          SmallPtrSetImpl<Value *> &Visited) {
+  if (!Visited.insert(V).second)
+    return ADDRESS_SPACE_UNINITIALIZED;
+
+  unsigned AS = V->getType()->getPointerAddressSpace();
+  if (AS != AddressSpace::ADDRESS_SPACE_GENERIC || !isAddressExpression(*V))
+    return AS;
+
+  unsigned Result = ADDRESS_SPACE_UNINITIALIZED;
+  for (Value *PtrOperand : getPointerOperands(*V)) {
+    Result = joinAddressSpaces(Result,
+                               getUnderlyingAddressSpace(PtrOperand, Visited));
+    if (Result == AddressSpace::ADDRESS_SPACE_GENERIC)
+      break;
+  }
+  return Result;
+}
+
+SmallVector<WeakVH, 4>
+NVPTXInferAddressSpaces::castArgumentsToSpecificAddressSpaces(Function &F) {
+  SmallVector<WeakVH, 4> SpecificCasts;
+  // We need to see every call site, and all of them must be direct calls.
+  if (!F.hasLocalLinkage() || F.use_empty())
+    return SpecificCasts;
+  for (const Use &U : F.uses()) {
+    ImmutableCallSite CS(U.getUser());
+    if (!CS || !CS.isCallee(&U))
+      return SpecificCasts;
+  }
+
+  Instruction *InsertPt = &*F.getEntryBlock().getFirstInsertionPt();
+  for (Argument &Arg : F.args()) {
+    PointerType *ArgTy = dyn_cast<PointerType>(Arg.getType());
+    if (!ArgTy ||
+        ArgTy->getAddressSpace() != AddressSpace::ADDRESS_SPACE_GENERIC ||
+        Arg.hasByValAttr() || Arg.use_empty())
+      continue;
+
+    unsigned AS = ADDRESS_SPACE_UNINITIALIZED;
+    for (User *U : F.users()) {
+      SmallPtrSet<Value *, 8> Visited;
+      Value *Actual = CallSite(U).getArgument(Arg.getArgNo());
+      AS = joinAddressSpaces(AS, getUnderlyingAddressSpace(Actual, Visited));
+      if (AS == AddressSpace::ADDRESS_SPACE_GENERIC)
+        break;
+    }
+    if (AS == AddressSpace::ADDRESS_SPACE_GENERIC ||
+        AS == ADDRESS_SPACE_UNINITIALIZED)
+      continue;
+
+    DEBUG(dbgs() << "Argument " << Arg << " points to address space " << AS
+                 << "\n");
+    auto *Specific = new AddrSpaceCastInst(
+        &Arg, ArgTy->getElementType()->getPointerTo(AS),
+        Arg.getName() + ".specific", InsertPt);
+    auto *Generic = new AddrSpaceCastInst(Specific, ArgTy,
+                                          Arg.getName() + ".generic", InsertPt);
+    Arg.replaceAllUsesWith(Generic);
+    Specific->setOperand(0, &Arg);
+    SpecificCasts.push_back(Specific);
+  }
+  return SpecificCasts;
+}
+
 bool NVPTXInferAddressSpaces::runOnFunction(Function &F) {
   if (skipFunction(F))
     return false;
 
+  // Turns the pointer arguments whose address space the call sites tell us
+  // into address expressions.
+  SmallVector<WeakVH, 4> SpecificArgCasts =
+      castArgumentsToSpecificAddressSpaces(F);
+
   // Collects all generic address expressions in postorder.
   std::vector<Value *> Postorder = collectGenericAddressExpressions(F);
 
@@ -432,7 +525,28 @@ bool NVPTXInferAddressSpaces::runOnFunction(Function &F) {
 
   // Changes the address spaces of the generic address expressions who are
   // inferred to point to a specific address space.
-  return rewriteWithNewAddressSpaces(Postorder, InferredAddrSpace, &F);
+  bool Changed = rewriteWithNewAddressSpaces(Postorder, InferredAddrSpace, &F);
+
+  // Removes the argument casts that nothing uses in the specific address
+  // space, so that we do not leave a pointless round trip behind.
+  for (Value *V : SpecificArgCasts) {
+    auto *Specific = cast_or_null<AddrSpaceCastInst>(V);
+    if (!Specific)
+      continue;
+    Value *Arg = Specific->getOperand(0);
+    if (Specific->hasOneUse()) {
+      auto *Generic = dyn_cast<AddrSpaceCastInst>(Specific->user_back());
+      if (Generic && Generic->getType() == Arg->getType()) {
+        Generic->replaceAllUsesWith(Arg);
+        Generic->eraseFromParent();
+      }
+    }
+    if (Specific->use_empty())
+      Specific->eraseFromParent();
+    else
+      Changed = true;
+  }
+  return Changed;
 }
 
 void NVPTXInferAddressSpaces::inferAddressSpaces(
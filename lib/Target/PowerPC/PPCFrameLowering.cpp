@@ -1457,9 +1457,9 @@ void PPCFrameLowering::processFunctionBeforeFrameFinalized(MachineFunction &MF,
   // won't be generated by emitEpilogue(), because shrink-wrap has chosen new
   // RestoreBlock. So we handle this case here.
   if (FFI->getSavePoint() && FFI->hasTailCall()) {
-    MachineBasicBlock *RestoreBlock = FFI->getRestorePoint();
+    ArrayRef<MachineBasicBlock *> RestoreBlocks = FFI->getRestorePoints();
     for (MachineBasicBlock &MBB : MF) {
-      if (MBB.isReturnBlock() && (&MBB) != RestoreBlock)
+      if (MBB.isReturnBlock() && find(RestoreBlocks, &MBB) == RestoreBlocks.end())
         createTailCallBranchInstr(MBB);
     }
   }
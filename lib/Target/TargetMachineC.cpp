@@ -23,6 +23,7 @@
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
@@ -44,6 +45,12 @@ static LLVMTargetMachineRef wrap(const TargetMachine *P) {
 static LLVMTargetRef wrap(const Target * P) {
   return reinterpret_cast<LLVMTargetRef>(const_cast<Target*>(P));
 }
+static ThreadPool *unwrap(LLVMCodeGenQueueRef P) {
+  return reinterpret_cast<ThreadPool *>(P);
+}
+static LLVMCodeGenQueueRef wrap(const ThreadPool *P) {
+  return reinterpret_cast<LLVMCodeGenQueueRef>(const_cast<ThreadPool *>(P));
+}
 
 LLVMTargetRef LLVMGetFirstTarget() {
   if (TargetRegistry::targets().begin() == TargetRegistry::targets().end()) {
@@ -234,6 +241,55 @@ LLVMBool LLVMTargetMachineEmitToMemoryBuffer(LLVMTargetMachineRef T,
   return Result;
 }
 
+LLVMCodeGenQueueRef LLVMCreateCodeGenQueue(unsigned NumThreads) {
+  if (!NumThreads)
+    return wrap(new ThreadPool());
+  return wrap(new ThreadPool(NumThreads));
+}
+
+void LLVMCodeGenQueueAddModule(LLVMCodeGenQueueRef Q, LLVMTargetMachineRef T,
+                               LLVMModuleRef M, LLVMCodeGenFileType codegen,
+                               LLVMCodeGenModuleCallback Prepare,
+                               LLVMCodeGenCompletionCallback Completion,
+                               void *Context) {
+  // A TargetMachine must not be used by several threads at once, so every job
+  // gets its own, created here while the caller still owns T.
+  TargetMachine *TM = unwrap(T);
+  std::shared_ptr<TargetMachine> JobTM(TM->getTarget().createTargetMachine(
+      TM->getTargetTriple().str(), TM->getTargetCPU(),
+      TM->getTargetFeatureString(), TM->Options, TM->getRelocationModel(),
+      TM->getCodeModel(), TM->getOptLevel()));
+
+  unwrap(Q)->async([=]() {
+    if (Prepare)
+      Prepare(Context, M);
+
+    SmallString<0> CodeString;
+    raw_svector_ostream OStream(CodeString);
+    char *ErrorMessage = nullptr;
+    if (LLVMTargetMachineEmit(wrap(JobTM.get()), M, OStream, codegen,
+                              &ErrorMessage)) {
+      Completion(Context, M, nullptr, ErrorMessage);
+      free(ErrorMessage);
+      return;
+    }
+
+    StringRef Data = OStream.str();
+    Completion(Context, M,
+               LLVMCreateMemoryBufferWithMemoryRangeCopy(Data.data(),
+                                                         Data.size(), ""),
+               nullptr);
+  });
+}
+
+void LLVMCodeGenQueueWait(LLVMCodeGenQueueRef Q) {
+  unwrap(Q)->wait();
+}
+
+void LLVMDisposeCodeGenQueue(LLVMCodeGenQueueRef Q) {
+  delete unwrap(Q);
+}
+
 char *LLVMGetDefaultTargetTriple(void) {
   return strdup(sys::getDefaultTargetTriple().c_str());
 }
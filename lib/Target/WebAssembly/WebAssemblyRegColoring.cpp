@@ -12,6 +12,8 @@
 ///
 /// WebAssembly doesn't have a fixed number of registers, but it is still
 /// desirable to minimize the total number of registers used in each function.
+/// Registers connected by a copy_local are given the same color when their
+/// live intervals allow it, which makes the copy redundant so it is deleted.
 ///
 /// This code is modeled after lib/CodeGen/StackSlotColoring.cpp.
 ///
@@ -59,6 +61,38 @@ FunctionPass *llvm::createWebAssemblyRegColoring() {
   return new WebAssemblyRegColoring();
 }
 
+static bool isCopyLocal(const MachineInstr &MI) {
+  switch (MI.getOpcode()) {
+  case WebAssembly::COPY_LOCAL_I32:
+  case WebAssembly::COPY_LOCAL_I64:
+  case WebAssembly::COPY_LOCAL_F32:
+  case WebAssembly::COPY_LOCAL_F64:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Record, for each register, the registers it is copied to or from.
+static void collectCopyHints(
+    MachineFunction &MF, const MachineRegisterInfo *MRI,
+    const WebAssemblyFunctionInfo &MFI,
+    DenseMap<unsigned, SmallVector<unsigned, 2>> &CopyHints) {
+  for (MachineBasicBlock &MBB : MF)
+    for (MachineInstr &MI : MBB) {
+      if (!isCopyLocal(MI))
+        continue;
+      unsigned Dst = MI.getOperand(0).getReg();
+      unsigned Src = MI.getOperand(1).getReg();
+      if (Dst == Src || !TargetRegisterInfo::isVirtualRegister(Dst) ||
+          !TargetRegisterInfo::isVirtualRegister(Src) ||
+          MFI.isVRegStackified(Dst) || MFI.isVRegStackified(Src))
+        continue;
+      CopyHints[Dst].push_back(Src);
+      CopyHints[Src].push_back(Dst);
+    }
+}
+
 // Compute the total spill weight for VReg.
 static float computeWeight(const MachineRegisterInfo *MRI,
                            const MachineBlockFrequencyInfo *MBFI,
@@ -126,11 +160,15 @@ bool WebAssemblyRegColoring::runOnMachineFunction(MachineFunction &MF) {
               return *LHS < *RHS;
             });
 
+  DenseMap<unsigned, SmallVector<unsigned, 2>> CopyHints;
+  collectCopyHints(MF, MRI, MFI, CopyHints);
+
   DEBUG(dbgs() << "Coloring register intervals:\n");
   SmallVector<unsigned, 16> SlotMapping(SortedIntervals.size(), -1u);
   SmallVector<SmallVector<LiveInterval *, 4>, 16> Assignments(
       SortedIntervals.size());
   BitVector UsedColors(SortedIntervals.size());
+  DenseMap<unsigned, size_t> ColorOfReg;
   bool Changed = false;
   for (size_t i = 0, e = SortedIntervals.size(); i < e; ++i) {
     LiveInterval *LI = SortedIntervals[i];
@@ -138,25 +176,44 @@ bool WebAssemblyRegColoring::runOnMachineFunction(MachineFunction &MF) {
     size_t Color = i;
     const TargetRegisterClass *RC = MRI->getRegClass(Old);
 
-    // Check if it's possible to reuse any of the used colors.
-    if (!MRI->isLiveIn(Old))
-      for (int C(UsedColors.find_first()); C != -1;
-           C = UsedColors.find_next(C)) {
-        if (MRI->getRegClass(SortedIntervals[C]->reg) != RC)
-          continue;
-        for (LiveInterval *OtherLI : Assignments[C])
-          if (!OtherLI->empty() && OtherLI->overlaps(*LI))
-            goto continue_outer;
-        Color = C;
-        break;
-      continue_outer:;
-      }
+    auto CanReuseColor = [&](size_t C) {
+      if (MRI->getRegClass(SortedIntervals[C]->reg) != RC)
+        return false;
+      for (LiveInterval *OtherLI : Assignments[C])
+        if (!OtherLI->empty() && OtherLI->overlaps(*LI))
+          return false;
+      return true;
+    };
+
+    // Check if it's possible to reuse any of the used colors, preferring the
+    // color of a register this one is copied to or from.
+    if (!MRI->isLiveIn(Old)) {
+      bool Found = false;
+      auto Hints = CopyHints.find(Old);
+      if (Hints != CopyHints.end())
+        for (unsigned Hint : Hints->second) {
+          auto HintColor = ColorOfReg.find(Hint);
+          if (HintColor != ColorOfReg.end() &&
+              CanReuseColor(HintColor->second)) {
+            Color = HintColor->second;
+            Found = true;
+            break;
+          }
+        }
+      for (int C(UsedColors.find_first()); !Found && C != -1;
+           C = UsedColors.find_next(C))
+        if (CanReuseColor(C)) {
+          Color = C;
+          Found = true;
+        }
+    }
 
     unsigned New = SortedIntervals[Color]->reg;
     SlotMapping[i] = New;
     Changed |= Old != New;
     UsedColors.set(Color);
     Assignments[Color].push_back(LI);
+    ColorOfReg[Old] = Color;
     DEBUG(dbgs() << "Assigning vreg"
                  << TargetRegisterInfo::virtReg2Index(LI->reg) << " to vreg"
                  << TargetRegisterInfo::virtReg2Index(New) << "\n");
@@ -171,5 +228,17 @@ bool WebAssemblyRegColoring::runOnMachineFunction(MachineFunction &MF) {
     if (Old != New)
       MRI->replaceRegWith(Old, New);
   }
+
+  // Delete the copies that coloring made redundant.
+  for (MachineBasicBlock &MBB : MF)
+    for (auto MII = MBB.begin(), MIE = MBB.end(); MII != MIE;) {
+      MachineInstr &MI = *MII++;
+      if (isCopyLocal(MI) &&
+          MI.getOperand(0).getReg() == MI.getOperand(1).getReg()) {
+        DEBUG(dbgs() << "Deleting identity copy: "; MI.dump());
+        Liveness->RemoveMachineInstrFromMaps(MI);
+        MI.eraseFromParent();
+      }
+    }
   return true;
 }
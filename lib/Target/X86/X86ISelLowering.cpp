@@ -25565,6 +25565,45 @@ static SDValue combineExtractVectorElt(SDNode *N, SelectionDAG &DAG,
 }
 
 /// Do target-specific dag combines on SELECT and VSELECT nodes.
+/// AVX-512 masked loads and gathers merge the disabled lanes from their
+/// pass-through operand, so a select on the same mask folds into them:
+///   vselect M, (masked_load P, M, Src0), X --> masked_load P, M, X
+///   vselect M, (masked_gather M, Src0, ...), X --> masked_gather M, X, ...
+static SDValue combineSelectOfMaskedLoad(SDNode *N, SelectionDAG &DAG,
+                                         const X86Subtarget &Subtarget) {
+  if (N->getOpcode() != ISD::VSELECT || !Subtarget.hasAVX512())
+    return SDValue();
+
+  SDValue Cond = N->getOperand(0);
+  SDValue LHS = N->getOperand(1);
+  SDValue RHS = N->getOperand(2);
+  if (!LHS.hasOneUse())
+    return SDValue();
+
+  SDLoc DL(N);
+  SDValue NewLoad;
+  if (auto *Ld = dyn_cast<MaskedLoadSDNode>(LHS)) {
+    if (Ld->getMask() != Cond)
+      return SDValue();
+    NewLoad = DAG.getMaskedLoad(LHS.getValueType(), DL, Ld->getChain(),
+                                Ld->getBasePtr(), Cond, RHS,
+                                Ld->getMemoryVT(), Ld->getMemOperand(),
+                                Ld->getExtensionType());
+  } else if (auto *Gather = dyn_cast<MaskedGatherSDNode>(LHS)) {
+    if (Gather->getMask() != Cond)
+      return SDValue();
+    SDValue Ops[] = {Gather->getChain(), RHS, Cond, Gather->getBasePtr(),
+                     Gather->getIndex()};
+    NewLoad = DAG.getMaskedGather(Gather->getVTList(), Gather->getMemoryVT(),
+                                  DL, Ops, Gather->getMemOperand());
+  } else {
+    return SDValue();
+  }
+
+  DAG.ReplaceAllUsesOfValueWith(LHS.getValue(1), NewLoad.getValue(1));
+  return NewLoad;
+}
+
 static SDValue combineSelect(SDNode *N, SelectionDAG &DAG,
                              TargetLowering::DAGCombinerInfo &DCI,
                              const X86Subtarget &Subtarget) {
@@ -25576,6 +25615,9 @@ static SDValue combineSelect(SDNode *N, SelectionDAG &DAG,
   EVT VT = LHS.getValueType();
   const TargetLowering &TLI = DAG.getTargetLoweringInfo();
 
+  if (SDValue V = combineSelectOfMaskedLoad(N, DAG, Subtarget))
+    return V;
+
   // If we have SSE[12] support, try to form min/max nodes. SSE min/max
   // instructions match the semantics of the common C idiom x<y?x:y but not
   // x<=y?x:y, because of how they handle negative zero (which can be
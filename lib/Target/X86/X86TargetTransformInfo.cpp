@@ -18,6 +18,7 @@
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/CodeGen/BasicTTIImpl.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Target/CostTable.h"
 #include "llvm/Target/TargetLowering.h"
@@ -26,6 +27,20 @@ using namespace llvm;
 
 #define DEBUG_TYPE "x86tti"
 
+namespace {
+enum SchedModelCostKind { SMC_None, SMC_Throughput, SMC_Latency };
+}
+
+static cl::opt<SchedModelCostKind> SchedModelCosts(
+    "x86-sched-model-costs", cl::Hidden, cl::init(SMC_None),
+    cl::desc("Derive the cost of vector arithmetic from the subtarget's "
+             "scheduling model instead of the cost tables"),
+    cl::values(clEnumValN(SMC_None, "none", "Use the cost tables"),
+               clEnumValN(SMC_Throughput, "throughput",
+                          "Use the reciprocal throughput"),
+               clEnumValN(SMC_Latency, "latency", "Use the latency"),
+               clEnumValEnd));
+
 //===----------------------------------------------------------------------===//
 //
 // X86 cost model.
@@ -67,6 +82,19 @@ unsigned X86TTIImpl::getRegisterBitWidth(bool Vector) {
   return 32;
 }
 
+unsigned X86TTIImpl::getCacheLineSize() {
+  // All the x86 processors since the Pentium 4 and the K8 have 64 byte lines.
+  return 64;
+}
+
+unsigned X86TTIImpl::getCacheSize() {
+  // The Atom and Silvermont cores have a 24KB first level data cache, the big
+  // cores 32KB.
+  if (ST->isAtom() || ST->isSLM())
+    return 24 * 1024;
+  return 32 * 1024;
+}
+
 unsigned X86TTIImpl::getMaxInterleaveFactor(unsigned VF) {
   // If the loop will not be vectorized, don't interleave the loop.
   // Let regular unroll to unroll the loop, which saves the overflow
@@ -85,6 +113,149 @@ unsigned X86TTIImpl::getMaxInterleaveFactor(unsigned VF) {
   return 2;
 }
 
+/// Machine opcodes that implement an ISD opcode on a legal vector type in a
+/// single instruction. Their scheduling classes give the cost of the operation
+/// on CPUs with a scheduling model. Divisions are left to the cost tables: the
+/// models do not describe the unpipelined divider, so their throughput would be
+/// far too optimistic.
+struct SchedOpcodeEntry {
+  int ISD;
+  MVT::SimpleValueType Type;
+  unsigned Opcode;
+};
+
+static const SchedOpcodeEntry AVX2SchedOpcodes[] = {
+  { ISD::ADD, MVT::v8i32,  X86::VPADDDYrr },
+  { ISD::ADD, MVT::v16i16, X86::VPADDWYrr },
+  { ISD::ADD, MVT::v32i8,  X86::VPADDBYrr },
+  { ISD::ADD, MVT::v4i64,  X86::VPADDQYrr },
+  { ISD::SUB, MVT::v8i32,  X86::VPSUBDYrr },
+  { ISD::SUB, MVT::v16i16, X86::VPSUBWYrr },
+  { ISD::SUB, MVT::v32i8,  X86::VPSUBBYrr },
+  { ISD::SUB, MVT::v4i64,  X86::VPSUBQYrr },
+  { ISD::MUL, MVT::v8i32,  X86::VPMULLDYrr },
+  { ISD::MUL, MVT::v16i16, X86::VPMULLWYrr },
+  { ISD::AND, MVT::v8i32,  X86::VPANDYrr },
+  { ISD::AND, MVT::v4i64,  X86::VPANDYrr },
+  { ISD::OR,  MVT::v8i32,  X86::VPORYrr },
+  { ISD::OR,  MVT::v4i64,  X86::VPORYrr },
+  { ISD::XOR, MVT::v8i32,  X86::VPXORYrr },
+  { ISD::XOR, MVT::v4i64,  X86::VPXORYrr },
+};
+
+static const SchedOpcodeEntry AVXSchedOpcodes[] = {
+  { ISD::FADD, MVT::v8f32, X86::VADDPSYrr },
+  { ISD::FADD, MVT::v4f64, X86::VADDPDYrr },
+  { ISD::FADD, MVT::v4f32, X86::VADDPSrr },
+  { ISD::FADD, MVT::v2f64, X86::VADDPDrr },
+  { ISD::FSUB, MVT::v8f32, X86::VSUBPSYrr },
+  { ISD::FSUB, MVT::v4f64, X86::VSUBPDYrr },
+  { ISD::FSUB, MVT::v4f32, X86::VSUBPSrr },
+  { ISD::FSUB, MVT::v2f64, X86::VSUBPDrr },
+  { ISD::FMUL, MVT::v8f32, X86::VMULPSYrr },
+  { ISD::FMUL, MVT::v4f64, X86::VMULPDYrr },
+  { ISD::FMUL, MVT::v4f32, X86::VMULPSrr },
+  { ISD::FMUL, MVT::v2f64, X86::VMULPDrr },
+  { ISD::ADD,  MVT::v4i32, X86::VPADDDrr },
+  { ISD::ADD,  MVT::v8i16, X86::VPADDWrr },
+  { ISD::ADD,  MVT::v16i8, X86::VPADDBrr },
+  { ISD::ADD,  MVT::v2i64, X86::VPADDQrr },
+  { ISD::SUB,  MVT::v4i32, X86::VPSUBDrr },
+  { ISD::SUB,  MVT::v8i16, X86::VPSUBWrr },
+  { ISD::SUB,  MVT::v16i8, X86::VPSUBBrr },
+  { ISD::SUB,  MVT::v2i64, X86::VPSUBQrr },
+  { ISD::MUL,  MVT::v4i32, X86::VPMULLDrr },
+  { ISD::MUL,  MVT::v8i16, X86::VPMULLWrr },
+  { ISD::AND,  MVT::v4i32, X86::VPANDrr },
+  { ISD::AND,  MVT::v2i64, X86::VPANDrr },
+  { ISD::OR,   MVT::v4i32, X86::VPORrr },
+  { ISD::OR,   MVT::v2i64, X86::VPORrr },
+  { ISD::XOR,  MVT::v4i32, X86::VPXORrr },
+  { ISD::XOR,  MVT::v2i64, X86::VPXORrr },
+};
+
+static const SchedOpcodeEntry SSE41SchedOpcodes[] = {
+  { ISD::MUL, MVT::v4i32, X86::PMULLDrr },
+};
+
+static const SchedOpcodeEntry SSE2SchedOpcodes[] = {
+  { ISD::FADD, MVT::v4f32, X86::ADDPSrr },
+  { ISD::FADD, MVT::v2f64, X86::ADDPDrr },
+  { ISD::FSUB, MVT::v4f32, X86::SUBPSrr },
+  { ISD::FSUB, MVT::v2f64, X86::SUBPDrr },
+  { ISD::FMUL, MVT::v4f32, X86::MULPSrr },
+  { ISD::FMUL, MVT::v2f64, X86::MULPDrr },
+  { ISD::ADD,  MVT::v4i32, X86::PADDDrr },
+  { ISD::ADD,  MVT::v8i16, X86::PADDWrr },
+  { ISD::ADD,  MVT::v16i8, X86::PADDBrr },
+  { ISD::ADD,  MVT::v2i64, X86::PADDQrr },
+  { ISD::SUB,  MVT::v4i32, X86::PSUBDrr },
+  { ISD::SUB,  MVT::v8i16, X86::PSUBWrr },
+  { ISD::SUB,  MVT::v16i8, X86::PSUBBrr },
+  { ISD::SUB,  MVT::v2i64, X86::PSUBQrr },
+  { ISD::MUL,  MVT::v8i16, X86::PMULLWrr },
+  { ISD::AND,  MVT::v4i32, X86::PANDrr },
+  { ISD::AND,  MVT::v2i64, X86::PANDrr },
+  { ISD::OR,   MVT::v4i32, X86::PORrr },
+  { ISD::OR,   MVT::v2i64, X86::PORrr },
+  { ISD::XOR,  MVT::v4i32, X86::PXORrr },
+  { ISD::XOR,  MVT::v2i64, X86::PXORrr },
+};
+
+static const SchedOpcodeEntry *
+SchedOpcodeLookup(ArrayRef<SchedOpcodeEntry> Tbl, int ISD, MVT Ty) {
+  auto I = std::find_if(Tbl.begin(), Tbl.end(),
+                        [=](const SchedOpcodeEntry &Entry) {
+                          return ISD == Entry.ISD && Ty == Entry.Type; });
+  return I != Tbl.end() ? I : nullptr;
+}
+
+int X86TTIImpl::getSchedModelCost(int ISD, MVT Ty, bool Latency) {
+  const MCSchedModel &SM = ST->getSchedModel();
+  if (!SM.hasInstrSchedModel())
+    return 0;
+
+  const SchedOpcodeEntry *Entry = nullptr;
+  if (ST->hasAVX2())
+    Entry = SchedOpcodeLookup(AVX2SchedOpcodes, ISD, Ty);
+  if (!Entry && ST->hasAVX())
+    Entry = SchedOpcodeLookup(AVXSchedOpcodes, ISD, Ty);
+  if (!Entry && !ST->hasAVX() && ST->hasSSE41())
+    Entry = SchedOpcodeLookup(SSE41SchedOpcodes, ISD, Ty);
+  if (!Entry && !ST->hasAVX() && ST->hasSSE2())
+    Entry = SchedOpcodeLookup(SSE2SchedOpcodes, ISD, Ty);
+  if (!Entry)
+    return 0;
+
+  unsigned SchedClass = ST->getInstrInfo()->get(Entry->Opcode).getSchedClass();
+  const MCSchedClassDesc *SC = SM.getSchedClassDesc(SchedClass);
+  if (!SC->isValid() || SC->isVariant())
+    return 0;
+
+  unsigned Cost = 1;
+  if (Latency) {
+    for (unsigned I = 0, E = SC->NumWriteLatencyEntries; I != E; ++I) {
+      int Cycles = ST->getWriteLatencyEntry(SC, I)->Cycles;
+      if (Cycles > 0)
+        Cost = std::max(Cost, unsigned(Cycles));
+    }
+    return Cost;
+  }
+
+  // The reciprocal throughput is bounded by the most contended resource and
+  // by how fast the micro-ops can be issued.
+  if (SM.IssueWidth)
+    Cost = std::max(Cost, (SC->NumMicroOps + SM.IssueWidth - 1) /
+                              SM.IssueWidth);
+  for (const MCWriteProcResEntry *WPR = ST->getWriteProcResBegin(SC),
+                                 *WPREnd = ST->getWriteProcResEnd(SC);
+       WPR != WPREnd; ++WPR) {
+    unsigned NumUnits = SM.getProcResource(WPR->ProcResourceIdx)->NumUnits;
+    Cost = std::max(Cost, (WPR->Cycles + NumUnits - 1) / NumUnits);
+  }
+  return Cost;
+}
+
 int X86TTIImpl::getArithmeticInstrCost(
     unsigned Opcode, Type *Ty, TTI::OperandValueKind Op1Info,
     TTI::OperandValueKind Op2Info, TTI::OperandValueProperties Opd1PropInfo,
@@ -115,6 +286,11 @@ int X86TTIImpl::getArithmeticInstrCost(
     return Cost;
   }
 
+  if (SchedModelCosts != SMC_None)
+    if (int Cost = getSchedModelCost(ISD, LT.second,
+                                     SchedModelCosts == SMC_Latency))
+      return LT.first * Cost;
+
   static const CostTblEntry AVX2UniformConstCostTable[] = {
     { ISD::SRA,  MVT::v4i64,   4 }, // 2 x psrad + shuffle.
 
@@ -1476,17 +1652,22 @@ int X86TTIImpl::getGatherScatterOpCost(unsigned Opcode, Type *SrcVTy,
       (Opcode == Instruction::Store && !isLegalMaskedScatter(SrcVTy)))
     Scalarize = true;
   // Gather / Scatter for vector 2 is not profitable on KNL / SKX
-  // Vector-4 of gather/scatter instruction does not exist on KNL.
-  // We can extend it to 8 elements, but zeroing upper bits of
-  // the mask vector will add more instructions. Right now we give the scalar
-  // cost of vector-4 for KNL. TODO: Check, maybe the gather/scatter instruction is
-  // better in the VariableMask case.
-  if (VF == 2 || (VF == 4 && !ST->hasVLX()))
+  if (VF == 2)
     Scalarize = true;
 
   if (Scalarize)
     return getGSScalarCost(Opcode, SrcVTy, VariableMask, Alignment, AddressSpace);
 
+  // Vector-4 of gather/scatter instruction does not exist on KNL. The
+  // lowering extends it to 8 elements with the upper mask bits cleared, which
+  // costs extending the index and the mask, and extracting the result of a
+  // gather. Only the original lanes are accessed.
+  if (VF == 4 && !ST->hasVLX()) {
+    int WidenCost = Opcode == Instruction::Load ? 3 : 2;
+    return WidenCost +
+           getGSVectorCost(Opcode, SrcVTy, Ptr, Alignment, AddressSpace);
+  }
+
   return getGSVectorCost(Opcode, SrcVTy, Ptr, Alignment, AddressSpace);
 }
 
@@ -35,6 +35,12 @@ class X86TTIImpl : public BasicTTIImplBase<X86TTIImpl> {
 
   int getScalarizationOverhead(Type *Ty, bool Insert, bool Extract);
 
+  /// Returns the reciprocal throughput, or the latency if \p Latency is set,
+  /// of the single instruction implementing \p ISD on the legal type \p Ty,
+  /// as the subtarget's scheduling model describes it. Returns 0 if there is
+  /// no such instruction or no scheduling model.
+  int getSchedModelCost(int ISD, MVT Ty, bool Latency);
+
   const X86Subtarget *getST() const { return ST; }
   const X86TargetLowering *getTLI() const { return TLI; }
 
@@ -61,6 +67,8 @@ public:
 
   unsigned getNumberOfRegisters(bool Vector);
   unsigned getRegisterBitWidth(bool Vector);
+  unsigned getCacheLineSize();
+  unsigned getCacheSize();
   unsigned getMaxInterleaveFactor(unsigned VF);
   int getArithmeticInstrCost(
       unsigned Opcode, Type *Ty,
@@ -21,6 +21,7 @@
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSummaryIndexTable.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Object/IRObjectFile.h"
@@ -28,6 +29,7 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 
@@ -49,6 +51,21 @@ static cl::opt<float>
                                "`import-instr-limit` threshold by this factor "
                                "before processing newly imported functions"));
 
+static cl::opt<float> ImportHotInstrFactor(
+    "import-hot-evolution-factor", cl::init(1.0), cl::Hidden,
+    cl::value_desc("x"),
+    cl::desc("As we import functions called from hot callsite, multiply the "
+             "`import-instr-limit` threshold by this factor "
+             "before processing newly imported functions"));
+
+static cl::opt<float> ImportHotMultiplier(
+    "import-hot-multiplier", cl::init(3.0), cl::Hidden, cl::value_desc("x"),
+    cl::desc("Multiply the `import-instr-limit` threshold for hot callsites"));
+
+static cl::opt<float> ImportColdMultiplier(
+    "import-cold-multiplier", cl::init(0), cl::Hidden, cl::value_desc("N"),
+    cl::desc("Multiply the `import-instr-limit` threshold for cold callsites"));
+
 static cl::opt<bool> PrintImports("print-imports", cl::init(false), cl::Hidden,
                                   cl::desc("Print imported functions"));
 
@@ -249,6 +266,21 @@ static void exportGlobalInModule(const ModuleSummaryIndex &Index,
 
 using EdgeInfo = std::pair<const FunctionSummary *, unsigned /* Threshold */>;
 
+/// Return the factor to apply to the import threshold of a call edge of the
+/// given hotness. Edges without profile information keep the threshold.
+static float getHotnessMultiplier(CalleeInfo::HotnessType Hotness) {
+  switch (Hotness) {
+  case CalleeInfo::HotnessType::Hot:
+    return ImportHotMultiplier;
+  case CalleeInfo::HotnessType::Cold:
+    return ImportColdMultiplier;
+  case CalleeInfo::HotnessType::Unknown:
+  case CalleeInfo::HotnessType::None:
+    return 1.0;
+  }
+  llvm_unreachable("Unknown hotness");
+}
+
 /// Compute the list of functions to import for a given caller. Mark these
 /// imported functions and the symbols they reference in their source module as
 /// exported from their source module.
@@ -267,7 +299,11 @@ static void computeImportForFunction(
       continue;
     }
 
-    auto *CalleeSummary = selectCallee(GUID, Threshold, Index);
+    // Scale the threshold by the hotness of the edge, so that hot callees
+    // larger than the limit are still imported and cold ones are not.
+    const auto NewThreshold =
+        Threshold * getHotnessMultiplier(Edge.second.Hotness);
+    auto *CalleeSummary = selectCallee(GUID, NewThreshold, Index);
     if (!CalleeSummary) {
       DEBUG(dbgs() << "ignored! No qualifying callee with summary found.\n");
       continue;
@@ -283,7 +319,7 @@ static void computeImportForFunction(
     } else
       ResolvedCalleeSummary = cast<FunctionSummary>(CalleeSummary);
 
-    assert(ResolvedCalleeSummary->instCount() <= Threshold &&
+    assert(ResolvedCalleeSummary->instCount() <= NewThreshold &&
            "selectCallee() didn't honor the threshold");
 
     auto ExportModulePath = ResolvedCalleeSummary->modulePath();
@@ -291,13 +327,13 @@ static void computeImportForFunction(
     /// Since the traversal of the call graph is DFS, we can revisit a function
     /// a second time with a higher threshold. In this case, it is added back to
     /// the worklist with the new threshold.
-    if (ProcessedThreshold && ProcessedThreshold >= Threshold) {
+    if (ProcessedThreshold && ProcessedThreshold >= NewThreshold) {
       DEBUG(dbgs() << "ignored! Target was already seen with Threshold "
                    << ProcessedThreshold << "\n");
       continue;
     }
     // Mark this function as imported in this module, with the current Threshold
-    ProcessedThreshold = Threshold;
+    ProcessedThreshold = NewThreshold;
 
     // Make exports in the source module.
     if (ExportLists) {
@@ -315,8 +351,13 @@ static void computeImportForFunction(
       }
     }
 
-    // Insert the newly imported function to the worklist.
-    Worklist.push_back(std::make_pair(ResolvedCalleeSummary, Threshold));
+    // Insert the newly imported function to the worklist, with the threshold
+    // for its own callees. The hotness multiplier is not carried down the
+    // call chain, only the evolution factor is.
+    bool IsHot = Edge.second.Hotness == CalleeInfo::HotnessType::Hot;
+    auto AdjThreshold =
+        Threshold * (IsHot ? ImportHotInstrFactor : ImportInstrFactor);
+    Worklist.push_back(std::make_pair(ResolvedCalleeSummary, AdjThreshold));
   }
 }
 
@@ -353,9 +394,7 @@ static void ComputeImportForModule(
     auto Threshold = FuncInfo.second;
 
     // Process the newly imported functions and add callees to the worklist.
-    // Adjust the threshold
-    Threshold = Threshold * ImportInstrFactor;
-
+    // The threshold was already adjusted when the function was queued.
     computeImportForFunction(*Summary, Index, Threshold, DefinedGVSummaries,
                              Worklist, ImportsForModule, ExportLists);
   }
@@ -368,14 +407,52 @@ void llvm::ComputeCrossModuleImport(
     const ModuleSummaryIndex &Index,
     const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
     StringMap<FunctionImporter::ImportMapTy> &ImportLists,
-    StringMap<FunctionImporter::ExportSetTy> &ExportLists) {
+    StringMap<FunctionImporter::ExportSetTy> &ExportLists,
+    unsigned ThreadCount) {
   // For each module that has function defined, compute the import/export lists.
-  for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
-    auto &ImportsForModule = ImportLists[DefinedGVSummaries.first()];
-    DEBUG(dbgs() << "Computing import for Module '"
-                 << DefinedGVSummaries.first() << "'\n");
-    ComputeImportForModule(DefinedGVSummaries.second, Index, ImportsForModule,
-                           &ExportLists);
+  if (ThreadCount <= 1 || ModuleToDefinedGVSummaries.size() <= 1) {
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries) {
+      auto &ImportsForModule = ImportLists[DefinedGVSummaries.first()];
+      DEBUG(dbgs() << "Computing import for Module '"
+                   << DefinedGVSummaries.first() << "'\n");
+      ComputeImportForModule(DefinedGVSummaries.second, Index, ImportsForModule,
+                             &ExportLists);
+    }
+  } else {
+    // The import list of a module only depends on the index, so the modules
+    // are handled in parallel. Each one records the exports it causes in a
+    // map of its own, and these are merged afterwards. The export lists are
+    // sets, so the result does not depend on the order the modules finish.
+    std::vector<std::pair<const GVSummaryMapTy *,
+                          FunctionImporter::ImportMapTy *>> Work;
+    for (auto &DefinedGVSummaries : ModuleToDefinedGVSummaries)
+      Work.push_back(std::make_pair(&DefinedGVSummaries.second,
+                                    &ImportLists[DefinedGVSummaries.first()]));
+    std::vector<StringMap<FunctionImporter::ExportSetTy>> ModuleExports(
+        Work.size());
+    {
+      ThreadPool Pool(std::min<unsigned>(ThreadCount, Work.size()));
+      for (unsigned I = 0, E = Work.size(); I != E; ++I)
+        Pool.async([&](unsigned I) {
+          ComputeImportForModule(*Work[I].first, Index, *Work[I].second,
+                                 &ModuleExports[I]);
+        }, I);
+    }
+    for (auto &Exports : ModuleExports)
+      for (auto &ExportsFromModule : Exports)
+        ExportLists[ExportsFromModule.first()].insert(
+            ExportsFromModule.second.begin(), ExportsFromModule.second.end());
+  }
+
+  // The devirtualized virtual calls call their single implementation
+  // directly, from any module.
+  for (auto &SingleImpl : Index.singleImpls()) {
+    auto GUID = GlobalValue::getGUID(SingleImpl.second);
+    auto SummaryList = Index.findGlobalValueSummaryList(GUID);
+    if (SummaryList == Index.end())
+      continue;
+    for (auto &Summary : SummaryList->second)
+      ExportLists[Summary->modulePath()].insert(GUID);
   }
 
 #ifndef NDEBUG
@@ -406,9 +483,19 @@ void llvm::ComputeCrossModuleImportForModule(
   GVSummaryMapTy FunctionSummaryMap;
   Index.collectDefinedFunctionsForModule(ModulePath, FunctionSummaryMap);
 
+  ComputeCrossModuleImportForModule(ModulePath, FunctionSummaryMap, Index,
+                                    ImportList);
+}
+
+/// Compute all the imports for the given module, whose defined summaries are
+/// already known.
+void llvm::ComputeCrossModuleImportForModule(
+    StringRef ModulePath, const GVSummaryMapTy &DefinedGVSummaries,
+    const ModuleSummaryIndex &Index,
+    FunctionImporter::ImportMapTy &ImportList) {
   // Compute the import list for this module.
   DEBUG(dbgs() << "Computing import for Module '" << ModulePath << "'\n");
-  ComputeImportForModule(FunctionSummaryMap, Index, ImportList);
+  ComputeImportForModule(DefinedGVSummaries, Index, ImportList);
 
 #ifndef NDEBUG
   DEBUG(dbgs() << "* Module " << ModulePath << " imports from "
@@ -679,6 +766,15 @@ getModuleSummaryIndexForFile(StringRef Path, std::string &Error,
     return nullptr;
   }
   Buffer = std::move(BufferOrErr.get());
+  if (isModuleSummaryIndexTable(Buffer->getMemBufferRef())) {
+    ErrorOr<std::unique_ptr<ModuleSummaryIndex>> IndexOrErr =
+        ModuleSummaryIndexTable::createIndex(std::move(Buffer));
+    if (std::error_code EC = IndexOrErr.getError()) {
+      Error = EC.message();
+      return nullptr;
+    }
+    return std::move(*IndexOrErr);
+  }
   ErrorOr<std::unique_ptr<object::ModuleSummaryIndexObjectFile>> ObjOrErr =
       object::ModuleSummaryIndexObjectFile::create(Buffer->getMemBufferRef(),
                                                    DiagnosticHandler);
@@ -0,0 +1,263 @@
+//===- FunctionOrdering.cpp - Order functions by the profile call graph ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass orders the functions of a module for code locality, with the
+// call-chain clustering algorithm of "Optimizing Function Placement for
+// Large-Scale Data-Center Applications" (Ottoni and Maher, CGO 2017), which
+// improves on the Pettis-Hansen ordering.
+//
+// The call graph is weighted with the profile counts of the call sites. Going
+// from the hottest function to the coldest one, the cluster of each function is
+// appended to the cluster of its most frequent caller, as long as the merged
+// cluster stays small enough to fit in a few pages. The clusters are then laid
+// out by decreasing density, that is profile count per byte.
+//
+// The module is reordered accordingly, which is the order that the functions
+// are emitted in, and is the whole program with LTO. The hot functions get the
+// .hot section prefix, so that the linker groups them on ELF targets. The
+// order can also be written to a symbol ordering file for the linker with
+// -function-order-file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Mangler.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/ProfileSummary.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "function-ordering"
+
+static cl::opt<unsigned> MaxClusterSize(
+    "function-order-max-cluster-size", cl::init(1 << 20), cl::Hidden,
+    cl::desc("The maximum estimated size in bytes of a cluster of functions"));
+
+static cl::opt<unsigned> HotCutoff(
+    "function-order-hot-cutoff", cl::init(990000), cl::Hidden,
+    cl::desc("The percentile, in millionths, of the profile counts that hot "
+             "functions cover"));
+
+static cl::opt<std::string> OrderFile(
+    "function-order-file", cl::init(""), cl::value_desc("filename"),
+    cl::desc("Write the symbols of the ordered functions to this file"),
+    cl::Hidden);
+
+STATISTIC(NumOrdered, "Number of functions ordered");
+STATISTIC(NumHot, "Number of functions placed in hot sections");
+
+/// An estimate of the average size of the machine code of an instruction.
+static const unsigned BytesPerInstruction = 4;
+
+namespace {
+/// \brief Functions that are laid out next to each other.
+struct Cluster {
+  std::vector<unsigned> Functions;
+  uint64_t Size = 0;
+  uint64_t Weight = 0;
+
+  double getDensity() const {
+    return double(Weight) / std::max<uint64_t>(Size, 1);
+  }
+};
+
+struct FunctionOrdering : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  FunctionOrdering() : ModulePass(ID) {
+    initializeFunctionOrderingPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+    AU.setPreservesAll();
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  /// \brief Return the minimum count of the hot functions, or 0 if the module
+  /// does not have a profile summary.
+  uint64_t getHotCount(Module &M);
+
+  /// \brief Write the symbols of \p Order to the -function-order-file.
+  void writeOrderFile(Module &M, ArrayRef<Function *> Order);
+};
+} // end anonymous namespace
+
+char FunctionOrdering::ID = 0;
+INITIALIZE_PASS_BEGIN(FunctionOrdering, "function-ordering",
+                      "Order functions by the profile call graph", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_END(FunctionOrdering, "function-ordering",
+                    "Order functions by the profile call graph", false, false)
+
+ModulePass *llvm::createFunctionOrderingPass() {
+  return new FunctionOrdering();
+}
+
+uint64_t FunctionOrdering::getHotCount(Module &M) {
+  Metadata *MD = M.getProfileSummary();
+  if (!MD)
+    return 0;
+  std::unique_ptr<ProfileSummary> Summary(ProfileSummary::getFromMD(MD));
+  if (!Summary)
+    return 0;
+  for (const ProfileSummaryEntry &Entry : Summary->getDetailedSummary())
+    if (Entry.Cutoff >= HotCutoff)
+      return Entry.MinCount;
+  return 0;
+}
+
+void FunctionOrdering::writeOrderFile(Module &M, ArrayRef<Function *> Order) {
+  std::error_code EC;
+  raw_fd_ostream OS(OrderFile, EC, sys::fs::F_Text);
+  if (EC) {
+    M.getContext().emitError("could not open function order file '" +
+                             OrderFile + "': " + EC.message());
+    return;
+  }
+  Mangler Mang;
+  for (Function *F : Order) {
+    Mang.getNameWithPrefix(OS, F, /*CannotUsePrivateLabel=*/true);
+    OS << '\n';
+  }
+}
+
+bool FunctionOrdering::runOnModule(Module &M) {
+  if (skipModule(M))
+    return false;
+
+  // The profiled functions are the nodes of the call graph.
+  std::vector<Function *> Functions;
+  std::vector<uint64_t> Counts;
+  DenseMap<const Function *, unsigned> Index;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    Optional<uint64_t> Count = F.getEntryCount();
+    if (!Count || !*Count)
+      continue;
+    Index[&F] = Functions.size();
+    Functions.push_back(&F);
+    Counts.push_back(*Count);
+  }
+  if (Functions.empty())
+    return false;
+
+  // Weigh the call edges with the profile counts of the call sites, and
+  // estimate the sizes of the functions.
+  std::vector<Cluster> Clusters(Functions.size());
+  MapVector<std::pair<unsigned, unsigned>, uint64_t> Edges;
+  for (unsigned Caller = 0, E = Functions.size(); Caller != E; ++Caller) {
+    Function &F = *Functions[Caller];
+    auto &BFI = getAnalysis<BlockFrequencyInfoWrapperPass>(F).getBFI();
+    uint64_t NumInsts = 0;
+    for (BasicBlock &BB : F) {
+      NumInsts += BB.size();
+      Optional<uint64_t> BlockCount = BFI.getBlockProfileCount(&BB);
+      if (!BlockCount || !*BlockCount)
+        continue;
+      for (Instruction &I : BB) {
+        CallSite CS(&I);
+        if (!CS)
+          continue;
+        auto It = Index.find(CS.getCalledFunction());
+        if (It != Index.end() && It->second != Caller)
+          Edges[std::make_pair(Caller, It->second)] += *BlockCount;
+      }
+    }
+    Clusters[Caller].Functions.push_back(Caller);
+    Clusters[Caller].Size = NumInsts * BytesPerInstruction;
+    Clusters[Caller].Weight = Counts[Caller];
+  }
+
+  // The most frequent caller of each function.
+  std::vector<std::pair<unsigned, uint64_t>> BestCaller(
+      Functions.size(), std::make_pair(~0U, uint64_t(0)));
+  for (auto &Edge : Edges) {
+    auto &Best = BestCaller[Edge.first.second];
+    if (Edge.second > Best.second)
+      Best = std::make_pair(Edge.first.first, Edge.second);
+  }
+
+  // Merge the clusters from the hottest function to the coldest one.
+  std::vector<unsigned> ClusterOf(Functions.size());
+  std::vector<unsigned> ByCount(Functions.size());
+  for (unsigned I = 0, E = Functions.size(); I != E; ++I)
+    ClusterOf[I] = ByCount[I] = I;
+  std::stable_sort(ByCount.begin(), ByCount.end(), [&](unsigned A, unsigned B) {
+    return Counts[A] > Counts[B];
+  });
+  for (unsigned Callee : ByCount) {
+    unsigned Caller = BestCaller[Callee].first;
+    // A caller that makes few of the calls to the function is not worth
+    // placing it after.
+    if (Caller == ~0U || BestCaller[Callee].second * 10 <= Counts[Callee])
+      continue;
+    Cluster &To = Clusters[ClusterOf[Caller]];
+    Cluster &From = Clusters[ClusterOf[Callee]];
+    if (&To == &From || To.Size + From.Size > MaxClusterSize)
+      continue;
+    for (unsigned F : From.Functions)
+      ClusterOf[F] = ClusterOf[Caller];
+    To.Functions.insert(To.Functions.end(), From.Functions.begin(),
+                        From.Functions.end());
+    To.Size += From.Size;
+    To.Weight += From.Weight;
+    From = Cluster();
+  }
+
+  // Lay the clusters out by decreasing density.
+  std::vector<Cluster *> Sorted;
+  for (Cluster &C : Clusters)
+    if (!C.Functions.empty())
+      Sorted.push_back(&C);
+  std::stable_sort(Sorted.begin(), Sorted.end(), [](Cluster *A, Cluster *B) {
+    return A->getDensity() > B->getDensity();
+  });
+
+  uint64_t HotCount = getHotCount(M);
+  std::vector<Function *> Order;
+  for (Cluster *C : Sorted)
+    for (unsigned I : C->Functions) {
+      Function *F = Functions[I];
+      Order.push_back(F);
+      if (HotCount && Counts[I] >= HotCount) {
+        F->setSectionPrefix(".hot");
+        ++NumHot;
+      }
+    }
+  NumOrdered += Order.size();
+
+  DEBUG({
+    dbgs() << "Function order:\n";
+    for (Function *F : Order)
+      dbgs() << "  " << F->getName() << "\n";
+  });
+
+  // The profiled functions go first, in order, followed by the others.
+  auto &FunctionList = M.getFunctionList();
+  for (Function *F : reverse(Order))
+    FunctionList.splice(FunctionList.begin(), FunctionList, F->getIterator());
+
+  if (!OrderFile.empty())
+    writeOrderFile(M, Order);
+  return true;
+}
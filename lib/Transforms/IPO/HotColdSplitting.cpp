@@ -0,0 +1,193 @@
+//===- HotColdSplitting.cpp - Outline cold regions of functions -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass outlines the cold regions of the functions that have profile data
+// into separate .cold functions, so that the hot code of the functions is
+// packed more densely in the instruction cache.
+//
+// A block is cold when the profile says it runs much less often than the
+// entry of its function. A region is a cold block together with all the
+// blocks that it dominates, which must be cold too, so that it only has a
+// single entry. The outlined functions are marked cold and minsize, which
+// also makes the branches to them unlikely, and on ELF targets are placed in
+// the .text.unlikely section, away from the hot code.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/CodeExtractor.h"
+using namespace llvm;
+
+#define DEBUG_TYPE "hotcoldsplit"
+
+static cl::opt<unsigned> ColdRatio(
+    "hot-cold-split-ratio", cl::init(100), cl::Hidden,
+    cl::desc("A block is cold when its function is entered this many times "
+             "more often than it runs"));
+
+static cl::opt<unsigned> MinColdSize(
+    "hot-cold-split-min-size", cl::init(4), cl::Hidden,
+    cl::desc("The minimum number of instructions of an outlined region"));
+
+static cl::opt<std::string> ColdSection(
+    "hot-cold-split-section", cl::init(".text.unlikely"), cl::Hidden,
+    cl::desc("The section of the outlined functions on ELF targets, or empty "
+             "to leave them in the default section"));
+
+STATISTIC(NumColdRegionsOutlined, "Number of cold regions outlined");
+
+namespace {
+struct HotColdSplitting : public ModulePass {
+  static char ID; // Pass identification, replacement for typeid
+  HotColdSplitting() : ModulePass(ID) {
+    initializeHotColdSplittingPass(*PassRegistry::getPassRegistry());
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<BlockFrequencyInfoWrapperPass>();
+  }
+
+  bool runOnModule(Module &M) override;
+
+private:
+  bool splitFunction(Function &F, BlockFrequencyInfo &BFI, bool IsELF);
+
+  /// \brief Add to \p Regions the cold regions of the dominator subtree of
+  /// \p N, and return true if the whole subtree is cold.
+  bool findColdRegions(DomTreeNode *N, const DenseSet<BasicBlock *> &Cold,
+                       SmallVectorImpl<BasicBlock *> &Regions);
+};
+} // end anonymous namespace
+
+char HotColdSplitting::ID = 0;
+INITIALIZE_PASS_BEGIN(HotColdSplitting, "hotcoldsplit",
+                      "Hot Cold Splitting", false, false)
+INITIALIZE_PASS_DEPENDENCY(BlockFrequencyInfoWrapperPass)
+INITIALIZE_PASS_END(HotColdSplitting, "hotcoldsplit",
+                    "Hot Cold Splitting", false, false)
+
+ModulePass *llvm::createHotColdSplittingPass() {
+  return new HotColdSplitting();
+}
+
+bool HotColdSplitting::findColdRegions(DomTreeNode *N,
+                                       const DenseSet<BasicBlock *> &Cold,
+                                       SmallVectorImpl<BasicBlock *> &Regions) {
+  bool AllChildrenCold = true;
+  SmallVector<BasicBlock *, 4> ChildRegions;
+  for (DomTreeNode *Child : *N)
+    if (findColdRegions(Child, Cold, ChildRegions))
+      ChildRegions.push_back(Child->getBlock());
+    else
+      AllChildrenCold = false;
+
+  // A cold block whose whole subtree is cold is left for the parent to
+  // outline as part of a bigger region.
+  if (AllChildrenCold && Cold.count(N->getBlock()))
+    return true;
+  Regions.append(ChildRegions.begin(), ChildRegions.end());
+  return false;
+}
+
+bool HotColdSplitting::splitFunction(Function &F, BlockFrequencyInfo &BFI,
+                                     bool IsELF) {
+  uint64_t EntryFreq = BFI.getEntryFreq();
+  DenseSet<BasicBlock *> Cold;
+  for (BasicBlock &BB : F)
+    if (BFI.getBlockFreq(&BB).getFrequency() * ColdRatio <= EntryFreq &&
+        !BB.isEHPad())
+      Cold.insert(&BB);
+  if (Cold.empty())
+    return false;
+
+  DominatorTree DT(F);
+  SmallVector<BasicBlock *, 8> Regions;
+  // The entry block is never cold, so it is not a region itself.
+  findColdRegions(DT.getRootNode(), Cold, Regions);
+
+  // Collect the blocks of all the regions before outlining any of them.
+  SmallVector<SmallVector<BasicBlock *, 8>, 8> RegionBlocks;
+  for (BasicBlock *Header : Regions) {
+    SmallVector<BasicBlock *, 8> Blocks;
+    unsigned Size = 0;
+    for (DomTreeNode *N : depth_first(DT.getNode(Header))) {
+      Blocks.push_back(N->getBlock());
+      for (Instruction &I : *N->getBlock())
+        if (!isa<DbgInfoIntrinsic>(I))
+          ++Size;
+    }
+    // The call to the outlined function and its arguments need to be worth
+    // it.
+    if (Size < MinColdSize)
+      continue;
+    RegionBlocks.push_back(std::move(Blocks));
+  }
+
+  bool Changed = false;
+  unsigned NumOutlined = 0;
+  for (auto &Blocks : RegionBlocks) {
+    BasicBlock *Header = Blocks.front();
+    CodeExtractor CE(Blocks, &DT);
+    if (!CE.isEligible())
+      continue;
+    Function *OutlinedF = CE.extractCodeRegion();
+    if (!OutlinedF)
+      continue;
+    DEBUG(dbgs() << "HotColdSplit: Outlined " << Header->getName() << " of "
+                 << F.getName() << "\n");
+    OutlinedF->setName(F.getName() + ".cold." + Twine(NumOutlined++));
+    OutlinedF->addFnAttr(Attribute::Cold);
+    OutlinedF->addFnAttr(Attribute::MinSize);
+    OutlinedF->addFnAttr(Attribute::NoInline);
+    if (IsELF && !ColdSection.empty())
+      OutlinedF->setSection(ColdSection);
+    emitOptimizationRemark(F.getContext(), DEBUG_TYPE, F,
+                           Header->getTerminator()->getDebugLoc(),
+                           "outlined cold region into " +
+                               OutlinedF->getName());
+    ++NumColdRegionsOutlined;
+    Changed = true;
+    DT.recalculate(F);
+  }
+  return Changed;
+}
+
+bool HotColdSplitting::runOnModule(Module &M) {
+  if (skipModule(M))
+    return false;
+
+  bool IsELF = Triple(M.getTargetTriple()).isOSBinFormatELF();
+  SmallVector<Function *, 16> Functions;
+  for (Function &F : M)
+    // Only the profile can tell which code is cold.
+    if (!F.isDeclaration() && F.getEntryCount() &&
+        !F.hasFnAttribute(Attribute::Cold) &&
+        !F.hasFnAttribute(Attribute::OptimizeNone))
+      Functions.push_back(&F);
+
+  bool Changed = false;
+  for (Function *F : Functions) {
+    auto &BFI = getAnalysis<BlockFrequencyInfoWrapperPass>(*F).getBFI();
+    Changed |= splitFunction(*F, BFI, IsELF);
+  }
+  return Changed;
+}
@@ -23,6 +23,7 @@
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/InlinerPass.h"
 
@@ -30,6 +31,11 @@ using namespace llvm;
 
 #define DEBUG_TYPE "inline"
 
+static cl::opt<bool>
+    CacheCalleeCost("inline-cache-callee-cost", cl::Hidden, cl::init(false),
+                    cl::desc("Reuse the cost of a callee body for the call "
+                             "sites that pass no constant arguments"));
+
 namespace {
 
 /// \brief Actual inliner pass implementation.
@@ -60,7 +66,8 @@ public:
   InlineCost getInlineCost(CallSite CS) override {
     Function *Callee = CS.getCalledFunction();
     TargetTransformInfo &TTI = TTIWP->getTTI(*Callee);
-    return llvm::getInlineCost(CS, DefaultThreshold, TTI, ACT);
+    return llvm::getInlineCost(CS, DefaultThreshold, TTI, ACT,
+                               CacheCalleeCost ? &CostCache : nullptr);
   }
 
   bool runOnSCC(CallGraphSCC &SCC) override;
@@ -383,6 +383,8 @@ bool Inliner::inlineCalls(CallGraphSCC &SCC) {
     if (F) SCCFunctions.insert(F);
     DEBUG(dbgs() << " " << (F ? F->getName() : "INDIRECTNODE"));
   }
+  for (Function *F : SCCFunctions)
+    CostCache.forgetFunction(F);
 
   // Scan through and identify all call sites ahead of time so that we only
   // inline call sites in the original functions, not call sites that result
@@ -500,6 +502,7 @@ bool Inliner::inlineCalls(CallGraphSCC &SCC) {
                                              Caller->getName()));
           continue;
         }
+        CostCache.forgetFunction(Caller);
         ++NumInlined;
 
         // Report the inline decision.
@@ -538,6 +541,7 @@ bool Inliner::inlineCalls(CallGraphSCC &SCC) {
         CalleeNode->removeAllCalledFunctions();
         
         // Removing the node for callee from the call graph and delete it.
+        CostCache.forgetFunction(Callee);
         delete CG.removeFunctionFromModule(CalleeNode);
         ++NumDeleted;
       }
@@ -559,12 +563,15 @@ bool Inliner::inlineCalls(CallGraphSCC &SCC) {
     }
   } while (LocalChange);
 
+  for (Function *F : SCCFunctions)
+    CostCache.forgetFunction(F);
   return Changed;
 }
 
 /// Remove now-dead linkonce functions at the end of
 /// processing to avoid breaking the SCC traversal.
 bool Inliner::doFinalization(CallGraph &CG) {
+  CostCache.clear();
   return removeDeadFunctions(CG);
 }
 
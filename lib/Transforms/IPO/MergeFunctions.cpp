@@ -40,6 +40,15 @@
 // overridable, we move the functionality into a new internal function and
 // leave two overridable thunks to it.
 //
+// With -mergefunc-parameterize, the functions that are still distinct after
+// that are compared again, allowing a few constant operands (constants,
+// globals, callees) to differ. Each class of such similar functions is merged
+// into a new internal function that takes the differing operands as extra
+// parameters, when a code size estimate says it pays off. Each of the original
+// functions becomes a thunk that passes its own operands, or, if it is local
+// and only called directly, its callers are rewritten to call the merged
+// function whenever that is smaller than a thunk.
+//
 //===----------------------------------------------------------------------===//
 //
 // Future work:
@@ -90,6 +99,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/Statistic.h"
@@ -99,6 +109,7 @@
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/InlineAsm.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Operator.h"
@@ -120,6 +131,9 @@ STATISTIC(NumFunctionsMerged, "Number of functions merged");
 STATISTIC(NumThunksWritten, "Number of thunks generated");
 STATISTIC(NumAliasesWritten, "Number of aliases generated");
 STATISTIC(NumDoubleWeak, "Number of new functions created");
+STATISTIC(NumSimilarMerged, "Number of similar functions merged");
+STATISTIC(NumCallsRewritten,
+          "Number of calls rewritten to call a merged function");
 
 static cl::opt<unsigned> NumFunctionsForSanityCheck(
     "mergefunc-sanity",
@@ -128,6 +142,20 @@ static cl::opt<unsigned> NumFunctionsForSanityCheck(
              "'0' disables this check. Works only with '-debug' key."),
     cl::init(0), cl::Hidden);
 
+static cl::opt<bool> Parameterize(
+    "mergefunc-parameterize", cl::init(false), cl::Hidden,
+    cl::desc("Merge functions that differ in a few constant operands, by "
+             "passing these operands as parameters"));
+
+static cl::opt<unsigned> MaxParams(
+    "mergefunc-max-params", cl::init(3), cl::Hidden,
+    cl::desc("The maximum number of parameters added to merge similar "
+             "functions"));
+
+/// The estimated size of a thunk, besides its arguments: the call and the
+/// return.
+static const unsigned ThunkOverhead = 2;
+
 namespace {
 
 /// GlobalNumberState assigns an integer to each global value in the program,
@@ -180,6 +208,22 @@ public:
 
   /// Test whether the two functions have equivalent behaviour.
   int compare();
+
+  /// An operand of the left function that differs from the right one.
+  struct OperandDiff {
+    const Instruction *L, *R;
+    unsigned OpIdx;
+  };
+
+  /// Test whether the two functions have equivalent behaviour when a few of
+  /// their constant operands, returned in \p Diffs, are made parameters.
+  int compareWithDiffs(SmallVectorImpl<OperandDiff> &Diffs) {
+    this->Diffs = &Diffs;
+    int Res = compare();
+    this->Diffs = nullptr;
+    return Res;
+  }
+
   /// Hash a function. Equivalent functions will have the same hash, and unequal
   /// functions will have different hashes with high probability.
   typedef uint64_t FunctionHash;
@@ -189,6 +233,11 @@ private:
   /// Test whether two basic blocks have equivalent behaviour.
   int cmpBasicBlocks(const BasicBlock *BBL, const BasicBlock *BBR) const;
 
+  /// Whether the operands \p OpIdx of \p L and \p R can be replaced by a
+  /// parameter of the merged function.
+  bool canParameterize(const Instruction *L, const Instruction *R,
+                       unsigned OpIdx) const;
+
   /// Constants comparison.
   /// Its analog to lexicographical comparison between hypothetical numbers
   /// of next format:
@@ -450,6 +499,9 @@ private:
 
   // The global state we will use
   GlobalNumberState* GlobalNumbers;
+
+  /// The differing operands, when comparing with compareWithDiffs().
+  SmallVectorImpl<OperandDiff> *Diffs = nullptr;
 };
 
 class FunctionNode {
@@ -1197,6 +1249,16 @@ int FunctionComparator::cmpBasicBlocks(const BasicBlock *BBL,
       for (unsigned i = 0, e = InstL->getNumOperands(); i != e; ++i) {
         Value *OpL = InstL->getOperand(i);
         Value *OpR = InstR->getOperand(i);
+        // References to the functions themselves are only equal when the
+        // functions are merged as a whole.
+        if (Diffs && (OpL == FnL || OpR == FnR || cmpValues(OpL, OpR))) {
+          // Only equality matters when looking for differences.
+          if (Diffs->size() == MaxParams ||
+              !canParameterize(&*InstL, &*InstR, i))
+            return 1;
+          Diffs->push_back({&*InstL, &*InstR, i});
+          continue;
+        }
         if (int Res = cmpValues(OpL, OpR))
           return Res;
         // cmpValues should ensure this is true.
@@ -1215,6 +1277,32 @@ int FunctionComparator::cmpBasicBlocks(const BasicBlock *BBL,
   return 0;
 }
 
+bool FunctionComparator::canParameterize(const Instruction *L,
+                                         const Instruction *R,
+                                         unsigned OpIdx) const {
+  auto *OpL = dyn_cast<Constant>(L->getOperand(OpIdx));
+  auto *OpR = dyn_cast<Constant>(R->getOperand(OpIdx));
+  if (!OpL || !OpR || OpL->getType() != OpR->getType())
+    return false;
+  Type *Ty = OpL->getType();
+  if (!Ty->isIntegerTy() && !Ty->isFloatingPointTy() && !Ty->isPointerTy())
+    return false;
+
+  // These operands must be constants.
+  if (isa<SwitchInst>(L) || isa<ShuffleVectorInst>(L) || isa<AllocaInst>(L) ||
+      isa<LandingPadInst>(L))
+    return false;
+  for (const Instruction *I : {L, R}) {
+    ImmutableCallSite CS(I);
+    if (!CS)
+      continue;
+    if (isa<IntrinsicInst>(I) || isa<InlineAsm>(CS.getCalledValue()) ||
+        CS.hasOperandBundles())
+      return false;
+  }
+  return true;
+}
+
 // Test whether the two functions have equivalent behaviour.
 int FunctionComparator::compare() {
   sn_mapL.clear();
@@ -1440,6 +1528,16 @@ private:
   /// Replace function F with function G in the function tree.
   void replaceFunctionInTree(const FunctionNode &FN, Function *G);
 
+  /// Merge the functions of \p M that only differ in a few constant
+  /// operands.
+  bool mergeSimilarFunctions(Module &M);
+
+  /// Merge \p Funcs, which are equivalent to Funcs[0] except for the
+  /// operands \p Diffs[I] of Funcs[I], if that makes the code smaller.
+  bool mergeSimilarClass(
+      ArrayRef<Function *> Funcs,
+      ArrayRef<SmallVector<FunctionComparator::OperandDiff, 4>> Diffs);
+
   /// The set of all distinct functions. Use the insert() and remove() methods
   /// to modify it. The map allows efficient lookup and deferring of Functions.
   FnTreeType FnTree;
@@ -1606,6 +1704,8 @@ bool MergeFunctions::runOnModule(Module &M) {
   } while (!Deferred.empty());
 
   FnTree.clear();
+  if (Parameterize)
+    Changed |= mergeSimilarFunctions(M);
   GlobalNumbers.clear();
 
   return Changed;
@@ -1900,3 +2000,224 @@ void MergeFunctions::removeUsers(Value *V) {
     }
   }
 }
+
+/// Whether \p F may be merged with similar functions.
+static bool isSimilarMergeCandidate(const Function &F) {
+  if (F.isDeclaration() || F.hasAvailableExternallyLinkage() ||
+      F.isInterposable() || F.isVarArg() || F.hasPrefixData() ||
+      F.hasPrologueData() || F.hasFnAttribute(Attribute::Naked))
+    return false;
+  for (const BasicBlock &BB : F) {
+    // The body moves to the merged function.
+    if (BB.hasAddressTaken())
+      return false;
+    for (const Instruction &I : BB)
+      if (auto *CI = dyn_cast<CallInst>(&I))
+        if (CI->isMustTailCall())
+          return false;
+  }
+  return true;
+}
+
+/// Whether all the uses of \p F are direct calls, which are counted in
+/// \p NumCalls.
+static bool onlyCalledDirectly(const Function *F, unsigned &NumCalls) {
+  NumCalls = 0;
+  for (const Use &U : F->uses()) {
+    auto *CI = dyn_cast<CallInst>(U.getUser());
+    if (!CI || !ImmutableCallSite(CI).isCallee(&U) ||
+        CI->getFunctionType() != F->getFunctionType() ||
+        CI->isMustTailCall())
+      return false;
+    ++NumCalls;
+  }
+  return true;
+}
+
+bool MergeFunctions::mergeSimilarFunctions(Module &M) {
+  // Only the functions with the same structure and type can be similar.
+  MapVector<std::pair<FunctionComparator::FunctionHash, FunctionType *>,
+            std::vector<Function *>>
+      Groups;
+  for (Function &F : M)
+    if (isSimilarMergeCandidate(F))
+      Groups[{FunctionComparator::functionHash(F), F.getFunctionType()}]
+          .push_back(&F);
+
+  bool Changed = false;
+  for (auto &Group : Groups) {
+    if (Group.second.size() < 2)
+      continue;
+
+    // Put each function in the first class whose representative it is similar
+    // to, as long as the class doesn't need too many parameters.
+    struct SimilarClass {
+      SmallVector<Function *, 4> Funcs;
+      SmallVector<SmallVector<FunctionComparator::OperandDiff, 4>, 4> Diffs;
+      std::set<std::pair<const Instruction *, unsigned>> Params;
+    };
+    std::vector<SimilarClass> Classes;
+    for (Function *F : Group.second) {
+      bool Added = false;
+      for (SimilarClass &C : Classes) {
+        SmallVector<FunctionComparator::OperandDiff, 4> Diffs;
+        FunctionComparator FCmp(C.Funcs[0], F, &GlobalNumbers);
+        if (FCmp.compareWithDiffs(Diffs) != 0)
+          continue;
+        std::set<std::pair<const Instruction *, unsigned>> Params = C.Params;
+        for (auto &D : Diffs)
+          Params.insert({D.L, D.OpIdx});
+        if (Params.size() > MaxParams)
+          continue;
+        C.Funcs.push_back(F);
+        C.Diffs.push_back(std::move(Diffs));
+        C.Params = std::move(Params);
+        Added = true;
+        break;
+      }
+      if (!Added) {
+        Classes.emplace_back();
+        Classes.back().Funcs.push_back(F);
+        Classes.back().Diffs.emplace_back();
+      }
+    }
+
+    for (SimilarClass &C : Classes)
+      if (C.Funcs.size() > 1)
+        Changed |= mergeSimilarClass(C.Funcs, C.Diffs);
+  }
+  return Changed;
+}
+
+bool MergeFunctions::mergeSimilarClass(
+    ArrayRef<Function *> Funcs,
+    ArrayRef<SmallVector<FunctionComparator::OperandDiff, 4>> Diffs) {
+  Function *Rep = Funcs[0];
+
+  // Number the parameters by the operands of the representative.
+  MapVector<std::pair<const Instruction *, unsigned>, unsigned> Params;
+  for (auto &FuncDiffs : Diffs)
+    for (auto &D : FuncDiffs)
+      Params.insert({{D.L, D.OpIdx}, Params.size()});
+  unsigned NumParams = Params.size();
+
+  // Estimate the code size, in instructions, before and after merging. Each
+  // function becomes a thunk, unless it is local and only called directly,
+  // and passing the operands at each call is smaller.
+  unsigned Size = 0;
+  for (const BasicBlock &BB : *Rep)
+    for (const Instruction &I : BB)
+      if (!isa<DbgInfoIntrinsic>(I))
+        ++Size;
+  uint64_t MergedSize = Size + NumParams;
+  SmallVector<bool, 4> RewriteCalls(Funcs.size(), false);
+  for (unsigned I = 0, E = Funcs.size(); I != E; ++I) {
+    unsigned ThunkSize = NumParams + ThunkOverhead;
+    unsigned NumCalls;
+    if (Funcs[I]->hasLocalLinkage() && onlyCalledDirectly(Funcs[I], NumCalls) &&
+        NumCalls * NumParams <= ThunkSize) {
+      RewriteCalls[I] = true;
+      MergedSize += NumCalls * NumParams;
+    } else {
+      MergedSize += ThunkSize;
+    }
+  }
+  if (MergedSize >= uint64_t(Size) * Funcs.size()) {
+    DEBUG(dbgs() << "Not merging " << Funcs.size() << " functions similar to "
+                 << Rep->getName() << ": " << MergedSize << " >= "
+                 << Size * Funcs.size() << " instructions\n");
+    return false;
+  }
+
+  // The operands that each function passes, before their bodies go away.
+  std::vector<SmallVector<Constant *, 4>> Operands(Funcs.size());
+  for (unsigned I = 0, E = Funcs.size(); I != E; ++I) {
+    for (auto &Param : Params)
+      Operands[I].push_back(
+          cast<Constant>(Param.first.first->getOperand(Param.first.second)));
+    for (auto &D : Diffs[I])
+      Operands[I][Params[{D.L, D.OpIdx}]] =
+          cast<Constant>(D.R->getOperand(D.OpIdx));
+  }
+
+  // Move the body of the representative to the merged function, which takes
+  // the differing operands as extra parameters.
+  FunctionType *FTy = Rep->getFunctionType();
+  SmallVector<Type *, 8> ParamTys(FTy->param_begin(), FTy->param_end());
+  for (Constant *C : Operands[0])
+    ParamTys.push_back(C->getType());
+  Function *NewF = Function::Create(
+      FunctionType::get(FTy->getReturnType(), ParamTys, /*isVarArg=*/false),
+      GlobalValue::PrivateLinkage, Rep->getName() + ".merged",
+      Rep->getParent());
+  NewF->copyAttributesFrom(Rep);
+  NewF->setVisibility(GlobalValue::DefaultVisibility);
+  NewF->setDLLStorageClass(GlobalValue::DefaultStorageClass);
+  NewF->setComdat(nullptr);
+  NewF->setUnnamedAddr(true);
+  NewF->setSubprogram(Rep->getSubprogram());
+  Rep->setSubprogram(nullptr);
+  NewF->getBasicBlockList().splice(NewF->begin(), Rep->getBasicBlockList());
+  auto NewArg = NewF->arg_begin();
+  for (Argument &Arg : Rep->args()) {
+    NewArg->takeName(&Arg);
+    Arg.replaceAllUsesWith(&*NewArg++);
+  }
+  for (auto &Param : Params) {
+    NewArg->setName("merged.op");
+    const_cast<Instruction *>(Param.first.first)
+        ->setOperand(Param.first.second, &*NewArg++);
+  }
+  for (Function *F : Funcs.drop_front())
+    F->dropAllReferences();
+
+  for (unsigned I = 0, E = Funcs.size(); I != E; ++I) {
+    Function *F = Funcs[I];
+    if (RewriteCalls[I]) {
+      for (auto UI = F->use_begin(), UE = F->use_end(); UI != UE;) {
+        Use &U = *UI++;
+        auto *CI = dyn_cast<CallInst>(U.getUser());
+        if (!CI || !CallSite(CI).isCallee(&U))
+          continue;
+        SmallVector<Value *, 8> Args(CI->arg_begin(), CI->arg_end());
+        Args.append(Operands[I].begin(), Operands[I].end());
+        CallInst *NewCI = CallInst::Create(NewF, Args, "", CI);
+        NewCI->setCallingConv(CI->getCallingConv());
+        NewCI->setAttributes(CI->getAttributes());
+        NewCI->setTailCallKind(CI->getTailCallKind());
+        NewCI->setDebugLoc(CI->getDebugLoc());
+        NewCI->takeName(CI);
+        CI->replaceAllUsesWith(NewCI);
+        CI->eraseFromParent();
+        ++NumCallsRewritten;
+      }
+      if (F->use_empty()) {
+        DEBUG(dbgs() << "mergeSimilar: " << F->getName() << " -> "
+                     << NewF->getName() << '\n');
+        F->eraseFromParent();
+        ++NumSimilarMerged;
+        continue;
+      }
+    }
+
+    // Replace the body of F with a call to the merged function.
+    BasicBlock *BB = BasicBlock::Create(F->getContext(), "", F);
+    IRBuilder<> Builder(BB);
+    SmallVector<Value *, 8> Args;
+    for (Argument &Arg : F->args())
+      Args.push_back(&Arg);
+    Args.append(Operands[I].begin(), Operands[I].end());
+    CallInst *CI = Builder.CreateCall(NewF, Args);
+    CI->setTailCall();
+    CI->setCallingConv(NewF->getCallingConv());
+    CI->setAttributes(NewF->getAttributes());
+    if (F->getReturnType()->isVoidTy())
+      Builder.CreateRetVoid();
+    else
+      Builder.CreateRet(CI);
+    DEBUG(dbgs() << "mergeSimilar: thunk " << F->getName() << " -> "
+                 << NewF->getName() << '\n');
+    ++NumSimilarMerged;
+  }
+  return true;
+}
@@ -17,6 +17,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/BasicAliasAnalysis.h"
 #include "llvm/Analysis/CFLAliasAnalysis.h"
+#include "llvm/Analysis/CFLAndersAliasAnalysis.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/ScopedNoAliasAA.h"
@@ -87,6 +88,10 @@ static cl::opt<bool> UseCFLAA("use-cfl-aa",
   cl::init(false), cl::Hidden,
   cl::desc("Enable the new, experimental CFL alias analysis"));
 
+static cl::opt<bool> UseCFLAndersAA("use-cfl-anders-aa",
+  cl::init(false), cl::Hidden,
+  cl::desc("Enable the inclusion-based CFL alias analysis"));
+
 static cl::opt<bool>
 EnableMLSM("mlsm", cl::init(true), cl::Hidden,
            cl::desc("Enable motion of merged load and store"));
@@ -95,6 +100,22 @@ static cl::opt<bool> EnableLoopInterchange(
     "enable-loopinterchange", cl::init(false), cl::Hidden,
     cl::desc("Enable the new, experimental LoopInterchange Pass"));
 
+static cl::opt<bool> EnableLoopFusion(
+    "enable-loop-fusion", cl::init(false), cl::Hidden,
+    cl::desc("Enable the new, experimental LoopFusion Pass"));
+
+static cl::opt<bool> EnableHotColdSplitting(
+    "enable-hot-cold-split", cl::init(false), cl::Hidden,
+    cl::desc("Enable the outlining of the cold regions of functions"));
+
+static cl::opt<bool> EnableFunctionOrdering(
+    "enable-function-ordering", cl::init(false), cl::Hidden,
+    cl::desc("Enable the ordering of functions by the profile call graph"));
+
+static cl::opt<bool> EnableLoopTiling(
+    "enable-loop-tiling", cl::init(false), cl::Hidden,
+    cl::desc("Enable the new, experimental LoopTiling Pass"));
+
 static cl::opt<bool> EnableNonLTOGlobalsModRef(
     "enable-non-lto-gmr", cl::init(true), cl::Hidden,
     cl::desc(
@@ -178,6 +199,8 @@ void PassManagerBuilder::addInitialAliasAnalysisPasses(
   // support "obvious" type-punning idioms.
   if (UseCFLAA)
     PM.add(createCFLAAWrapperPass());
+  if (UseCFLAndersAA)
+    PM.add(createCFLAndersAAWrapperPass());
   PM.add(createTypeBasedAAWrapperPass());
   PM.add(createScopedNoAliasAAWrapperPass());
 }
@@ -255,6 +278,8 @@ void PassManagerBuilder::addFunctionSimplificationPasses(
     MPM.add(createLoopInterchangePass()); // Interchange loops
     MPM.add(createCFGSimplificationPass());
   }
+  if (EnableLoopTiling)
+    MPM.add(createLoopTilingPass());          // Tile loop nests for the cache
   if (!DisableUnrollLoops)
     MPM.add(createSimpleLoopUnrollPass());    // Unroll small loops
   addExtensionsToPM(EP_LoopOptimizerEnd, MPM);
@@ -372,6 +397,10 @@ void PassManagerBuilder::populateModulePassManager(
     addPGOInstrPasses(MPM);
     // Indirect call promotion that promotes intra-module targets only.
     MPM.add(createPGOIndirectCallPromotionLegacyPass());
+    // Version the memory intrinsics on their most frequent lengths, which
+    // only the IR profile provides.
+    if (!PGOInstrUse.empty())
+      MPM.add(createPGOMemOPSizeOptLegacyPass());
   }
 
   if (EnableNonLTOGlobalsModRef)
@@ -469,6 +498,10 @@ void PassManagerBuilder::populateModulePassManager(
   // on the rotated form. Disable header duplication at -Oz.
   MPM.add(createLoopRotatePass(SizeLevel == 2 ? 0 : -1));
 
+  // Fuse adjacent loops with the same trip count that stream the same arrays.
+  if (EnableLoopFusion)
+    MPM.add(createLoopFusionPass());
+
   // Distribute loops to allow partial vectorization.  I.e. isolate dependences
   // into separate loop that would otherwise inhibit vectorization.  This is
   // currently only performed for loops marked with the metadata
@@ -560,9 +593,17 @@ void PassManagerBuilder::populateModulePassManager(
     }
   }
 
+  // Outline cold code once nothing is going to be inlined anymore.
+  if (EnableHotColdSplitting)
+    MPM.add(createHotColdSplittingPass());
+
   if (MergeFunctions)
     MPM.add(createMergeFunctionsPass());
 
+  // Order the functions last, so that the order covers the outlined ones.
+  if (EnableFunctionOrdering)
+    MPM.add(createFunctionOrderingPass());
+
   addExtensionsToPM(EP_OptimizerLast, MPM);
 }
 
@@ -584,12 +625,6 @@ void PassManagerBuilder::addLTOOptimizationPasses(legacy::PassManagerBase &PM) {
   PM.add(createInferFunctionAttrsLegacyPass());
 
   if (OptLevel > 1) {
-    // Indirect call promotion. This should promote all the targets that are
-    // left by the earlier promotion pass that promotes intra-module targets.
-    // This two-step promotion is to save the compile time. For LTO, it should
-    // produce the same result as if we only do promotion here.
-    PM.add(createPGOIndirectCallPromotionLegacyPass(true));
-
     // Propagate constants at call sites into the functions they call.  This
     // opens opportunities for globalopt (and inlining) by substituting function
     // pointers passed as arguments to direct uses of functions.
@@ -608,6 +643,14 @@ void PassManagerBuilder::addLTOOptimizationPasses(legacy::PassManagerBase &PM) {
   if (OptLevel == 1)
     return;
 
+  // Indirect call promotion. This should promote all the targets that are
+  // left by the earlier promotion pass that promotes intra-module targets.
+  // This two-step promotion is to save the compile time. For LTO, it should
+  // produce the same result as if we only do promotion here. It runs after
+  // whole-program devirtualization, so that only the virtual calls that could
+  // not be devirtualized outright are promoted.
+  PM.add(createPGOIndirectCallPromotionLegacyPass(true));
+
   // Now that we internalized some globals, see if we can hack on them!
   PM.add(createGlobalOptimizerPass());
   // Promote any localized global vars.
@@ -725,6 +768,11 @@ void PassManagerBuilder::addLateLTOOptimizationPasses(
   // currently it damages debug info.
   if (MergeFunctions)
     PM.add(createMergeFunctionsPass());
+
+  // The whole program is visible here, so that is where ordering the
+  // functions pays off the most.
+  if (EnableFunctionOrdering)
+    PM.add(createFunctionOrderingPass());
 }
 
 void PassManagerBuilder::populateThinLTOPassManager(
@@ -734,8 +782,10 @@ void PassManagerBuilder::populateThinLTOPassManager(
   if (VerifyInput)
     PM.add(createVerifierPass());
 
-  if (ModuleSummary)
+  if (ModuleSummary) {
     PM.add(createFunctionImportPass(ModuleSummary));
+    PM.add(createWholeProgramDevirtPass(ModuleSummary));
+  }
 
   populateModulePassManager(PM);
 
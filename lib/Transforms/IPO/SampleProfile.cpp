@@ -1238,7 +1238,11 @@ bool SampleProfileLoader::doInitialization(Module &M) {
     return false;
   }
   Reader = std::move(ReaderOrErr.get());
-  ProfileIsValid = (Reader->read() == sampleprof_error::success);
+  // Only the profiles of the functions defined in this module are needed.
+  // The calling context profiles are inlined and annotated like the inline
+  // instances of their outermost callers.
+  ProfileIsValid = !Reader->readProfilesFor(M) &&
+                   !Reader->mergeContextProfiles();
   return true;
 }
 
@@ -25,6 +25,12 @@
 //   returns 0, or a single vtable's function returns 1, replace each virtual
 //   call with a comparison of the vptr against that vtable's address.
 //
+// With ThinLTO, no module sees the whole program, so single implementation
+// devirtualization is split in two. The thin link resolves the virtual calls
+// of the summaries against the vtables of all the modules
+// (runWholeProgramDevirtOnIndex), and the backends rewrite the calls through
+// named bitsets with these resolutions.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/IPO/WholeProgramDevirt.h"
@@ -39,7 +45,9 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/ModuleSummaryIndex.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Utils/Evaluator.h"
@@ -222,14 +230,16 @@ struct VirtualCallSite {
 
 struct DevirtModule {
   Module &M;
+  // The combined index in a ThinLTO backend, or null.
+  const ModuleSummaryIndex *Summary;
   IntegerType *Int8Ty;
   PointerType *Int8PtrTy;
   IntegerType *Int32Ty;
 
   MapVector<VTableSlot, std::vector<VirtualCallSite>> CallSlots;
 
-  DevirtModule(Module &M)
-      : M(M), Int8Ty(Type::getInt8Ty(M.getContext())),
+  DevirtModule(Module &M, const ModuleSummaryIndex *Summary)
+      : M(M), Summary(Summary), Int8Ty(Type::getInt8Ty(M.getContext())),
         Int8PtrTy(Type::getInt8PtrTy(M.getContext())),
         Int32Ty(Type::getInt32Ty(M.getContext())) {}
 
@@ -251,6 +261,8 @@ struct DevirtModule {
                           MutableArrayRef<VirtualCallSite> CallSites);
   bool tryVirtualConstProp(MutableArrayRef<VirtualCallTarget> TargetsForSlot,
                            ArrayRef<VirtualCallSite> CallSites);
+  void trySummaryDevirt(const VTableSlot &Slot,
+                        MutableArrayRef<VirtualCallSite> CallSites);
 
   void rebuildGlobal(VTableBits &B);
 
@@ -259,14 +271,16 @@ struct DevirtModule {
 
 struct WholeProgramDevirt : public ModulePass {
   static char ID;
-  WholeProgramDevirt() : ModulePass(ID) {
+  const ModuleSummaryIndex *Summary;
+  WholeProgramDevirt(const ModuleSummaryIndex *Summary = nullptr)
+      : ModulePass(ID), Summary(Summary) {
     initializeWholeProgramDevirtPass(*PassRegistry::getPassRegistry());
   }
   bool runOnModule(Module &M) {
     if (skipModule(M))
       return false;
 
-    return DevirtModule(M).run();
+    return DevirtModule(M, Summary).run();
   }
 };
 
@@ -276,8 +290,65 @@ INITIALIZE_PASS(WholeProgramDevirt, "wholeprogramdevirt",
                 "Whole program devirtualization", false, false)
 char WholeProgramDevirt::ID = 0;
 
-ModulePass *llvm::createWholeProgramDevirtPass() {
-  return new WholeProgramDevirt;
+ModulePass *
+llvm::createWholeProgramDevirtPass(const ModuleSummaryIndex *Summary) {
+  return new WholeProgramDevirt(Summary);
+}
+
+void llvm::runWholeProgramDevirtOnIndex(ModuleSummaryIndex &Index) {
+  // Collect the address points of the vtables of each type, and the slots of
+  // the virtual calls. Linkonce vtables have a summary in each module that
+  // defines them, which are all the same, so only look at one of them.
+  std::map<GlobalValue::GUID,
+           std::vector<std::pair<const GlobalVarSummary *, uint64_t>>>
+      VTablesOfType;
+  std::set<TypeIdOffset> Slots;
+  for (auto &Entry : Index) {
+    bool SeenVTable = false;
+    for (auto &S : Entry.second) {
+      if (auto *FS = dyn_cast<FunctionSummary>(S.get())) {
+        Slots.insert(FS->vcalls().begin(), FS->vcalls().end());
+        continue;
+      }
+      auto *VS = dyn_cast<GlobalVarSummary>(S.get());
+      if (!VS || VS->vtableTypes().empty() || SeenVTable)
+        continue;
+      SeenVTable = true;
+      for (const TypeIdOffset &Type : VS->vtableTypes())
+        VTablesOfType[Type.TypeID].push_back(std::make_pair(VS, Type.Offset));
+    }
+  }
+
+  for (const TypeIdOffset &Slot : Slots) {
+    auto VTables = VTablesOfType.find(Slot.TypeID);
+    if (VTables == VTablesOfType.end())
+      continue;
+    StringRef SingleImpl;
+    bool IsSingleImpl = true;
+    for (auto &VTable : VTables->second) {
+      auto *Func = VTable.first->getVTableFunc(VTable.second + Slot.Offset);
+      // A function that the other modules can't call, or a slot that we know
+      // nothing about, can't be devirtualized.
+      if (!Func || Func->second.empty()) {
+        IsSingleImpl = false;
+        break;
+      }
+      // Calls to a pure virtual function are undefined behavior.
+      if (Func->second == "__cxa_pure_virtual")
+        continue;
+      if (!SingleImpl.empty() && SingleImpl != Func->second) {
+        IsSingleImpl = false;
+        break;
+      }
+      SingleImpl = Func->second;
+    }
+    if (IsSingleImpl && !SingleImpl.empty()) {
+      DEBUG(dbgs() << "WPD: Single implementation " << SingleImpl
+                   << " for type " << Slot.TypeID << " at offset "
+                   << Slot.Offset << "\n");
+      Index.addSingleImpl(Slot, SingleImpl);
+    }
+  }
 }
 
 void DevirtModule::buildBitSets(
@@ -571,6 +642,25 @@ bool DevirtModule::tryVirtualConstProp(
   return true;
 }
 
+void DevirtModule::trySummaryDevirt(const VTableSlot &Slot,
+                                    MutableArrayRef<VirtualCallSite> CallSites) {
+  StringRef Name = Summary->getSingleImpl(
+      {GlobalValue::getGUID(cast<MDString>(Slot.BitSetID)->getString()),
+       Slot.ByteOffset});
+  if (Name.empty())
+    return;
+
+  // The implementation may be defined in another module, so declare it with
+  // the type of the calls.
+  for (auto &&VCallSite : CallSites) {
+    auto *CalleeTy = cast<PointerType>(VCallSite.CS.getCalledValue()->getType());
+    Constant *Callee = M.getOrInsertFunction(
+        Name, cast<FunctionType>(CalleeTy->getElementType()));
+    VCallSite.CS.setCalledFunction(
+        ConstantExpr::getBitCast(Callee, CalleeTy));
+  }
+}
+
 void DevirtModule::rebuildGlobal(VTableBits &B) {
   if (B.Before.Bytes.empty() && B.After.Bytes.empty())
     return;
@@ -663,6 +753,20 @@ bool DevirtModule::run() {
       CI->eraseFromParent();
   }
 
+  // In a ThinLTO backend, the calls through named bitsets may call the
+  // implementations in any module, which only the combined index knows
+  // about. The other bitsets are local to the module.
+  if (Summary) {
+    for (auto I = CallSlots.begin(); I != CallSlots.end();) {
+      if (isa<MDString>(I->first.BitSetID)) {
+        trySummaryDevirt(I->first, I->second);
+        I = CallSlots.erase(I);
+      } else {
+        ++I;
+      }
+    }
+  }
+
   // Rebuild llvm.bitsets metadata into a map for easy lookup.
   std::vector<VTableBits> Bits;
   DenseMap<Metadata *, std::set<BitSetInfo>> BitSets;
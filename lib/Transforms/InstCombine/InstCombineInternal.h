@@ -193,22 +193,42 @@ private:
   // combining and will be updated to reflect any changes.
   LoopInfo *LI;
 
+  /// The cache for the known bits queries, if enabled. Every instruction the
+  /// combiner changes is forgotten in it.
+  KnownBitsCache *KBC;
+
+  /// When set, the combiner is run only once over the function, so the
+  /// worklist is kept complete instead of relying on another iteration: the
+  /// operands of every erased or changed instruction are revisited.
+  const bool SingleIteration;
+
+  /// The number of combines done, by opcode of the combined instruction.
+  DenseMap<unsigned, unsigned> CombinesByOpcode;
+
   bool MadeIRChange;
 
 public:
   InstCombiner(InstCombineWorklist &Worklist, BuilderTy *Builder,
                bool MinimizeSize, bool ExpensiveCombines, AliasAnalysis *AA,
                AssumptionCache *AC, TargetLibraryInfo *TLI,
-               DominatorTree *DT, const DataLayout &DL, LoopInfo *LI)
+               DominatorTree *DT, const DataLayout &DL, LoopInfo *LI,
+               KnownBitsCache *KBC = nullptr, bool SingleIteration = false)
       : Worklist(Worklist), Builder(Builder), MinimizeSize(MinimizeSize),
         ExpensiveCombines(ExpensiveCombines), AA(AA), AC(AC), TLI(TLI), DT(DT),
-        DL(DL), LI(LI), MadeIRChange(false) {}
+        DL(DL), LI(LI), KBC(KBC), SingleIteration(SingleIteration),
+        MadeIRChange(false) {}
 
   /// \brief Run the combiner over the entire worklist until it is empty.
   ///
   /// \returns true if the IR is changed.
   bool run();
 
+  /// \brief Return the number of combines done by run(), by opcode of the
+  /// instruction they combined.
+  const DenseMap<unsigned, unsigned> &getCombinesByOpcode() const {
+    return CombinesByOpcode;
+  }
+
   AssumptionCache *getAssumptionCache() const { return AC; }
 
   const DataLayout &getDataLayout() const { return DL; }
@@ -430,6 +450,8 @@ public:
     if (I.use_empty()) return nullptr;
 
     Worklist.AddUsersToWorkList(I); // Add all modified instrs to worklist.
+    if (KBC)
+      KBC->forgetValue(&I);
 
     // If we are replacing the instruction with itself, this must be in a
     // segment of unreachable code, so just clobber the instruction.
@@ -464,12 +486,14 @@ public:
     assert(I.use_empty() && "Cannot erase instruction that is used!");
     // Make sure that we reprocess all operands now that we reduced their
     // use counts.
-    if (I.getNumOperands() < 8) {
+    if (I.getNumOperands() < 8 || SingleIteration) {
       for (Use &Operand : I.operands())
         if (auto *Inst = dyn_cast<Instruction>(Operand))
           Worklist.Add(Inst);
     }
     Worklist.Remove(&I);
+    if (KBC)
+      KBC->forgetValue(&I);
     I.eraseFromParent();
     MadeIRChange = true;
     return nullptr; // Don't do anything with FI
@@ -478,21 +502,21 @@ public:
   void computeKnownBits(Value *V, APInt &KnownZero, APInt &KnownOne,
                         unsigned Depth, Instruction *CxtI) const {
     return llvm::computeKnownBits(V, KnownZero, KnownOne, DL, Depth, AC, CxtI,
-                                  DT);
+                                  DT, KBC);
   }
 
   bool MaskedValueIsZero(Value *V, const APInt &Mask, unsigned Depth = 0,
                          Instruction *CxtI = nullptr) const {
-    return llvm::MaskedValueIsZero(V, Mask, DL, Depth, AC, CxtI, DT);
+    return llvm::MaskedValueIsZero(V, Mask, DL, Depth, AC, CxtI, DT, KBC);
   }
   unsigned ComputeNumSignBits(Value *Op, unsigned Depth = 0,
                               Instruction *CxtI = nullptr) const {
-    return llvm::ComputeNumSignBits(Op, DL, Depth, AC, CxtI, DT);
+    return llvm::ComputeNumSignBits(Op, DL, Depth, AC, CxtI, DT, KBC);
   }
   void ComputeSignBit(Value *V, bool &KnownZero, bool &KnownOne,
                       unsigned Depth = 0, Instruction *CxtI = nullptr) const {
     return llvm::ComputeSignBit(V, KnownZero, KnownOne, DL, Depth, AC, CxtI,
-                                DT);
+                                DT, KBC);
   }
   OverflowResult computeOverflowForUnsignedMul(Value *LHS, Value *RHS,
                                                const Instruction *CxtI) {
@@ -53,6 +53,7 @@
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -77,11 +78,35 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumOneIteration, "Number of functions with one iteration");
+STATISTIC(NumTwoIterations, "Number of functions with two iterations");
+STATISTIC(NumThreeIterations, "Number of functions with three iterations");
+STATISTIC(NumFourOrMoreIterations,
+          "Number of functions with four or more iterations");
+STATISTIC(NumMaxIterationsReached,
+          "Number of functions stopped at -instcombine-max-iterations");
 
 static cl::opt<bool>
 EnableExpensiveCombines("expensive-combines",
                         cl::desc("Enable expensive instruction combines"));
 
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::Hidden, cl::init(UINT_MAX),
+              cl::desc("Stop iterating the combiner after this many "
+                       "iterations, and report the combines that still "
+                       "fire with -pass-remarks-analysis=instcombine"));
+
+static cl::opt<bool>
+SingleIteration("instcombine-single-iteration", cl::Hidden,
+                cl::desc("Run the combiner once over each function, keeping "
+                         "the worklist complete instead of iterating to a "
+                         "fixed point"));
+
+static cl::opt<bool>
+CacheKnownBits("instcombine-cache-known-bits", cl::Hidden,
+               cl::desc("Cache the known bits of instructions within each "
+                        "combiner iteration"));
+
 Value *InstCombiner::EmitGEPOffset(User *GEP) {
   return llvm::EmitGEPOffset(Builder, DL, GEP);
 }
@@ -2867,8 +2892,18 @@ bool InstCombiner::run() {
     DEBUG(raw_string_ostream SS(OrigI); I->print(SS); OrigI = SS.str(););
     DEBUG(dbgs() << "IC: Visiting: " << OrigI << '\n');
 
+    unsigned Opcode = I->getOpcode();
     if (Instruction *Result = visit(*I)) {
       ++NumCombined;
+      ++CombinesByOpcode[Opcode];
+      // The visitors may have changed I and its operands in place, e.g. by
+      // dropping their wrap flags.
+      if (KBC) {
+        KBC->forgetValue(I);
+        for (Value *Op : I->operands())
+          if (isa<Instruction>(Op))
+            KBC->forgetValue(Op);
+      }
       // Should we replace the old instruction with a new one?
       if (Result != I) {
         DEBUG(dbgs() << "IC: Old = " << *I << '\n'
@@ -2911,6 +2946,11 @@ bool InstCombiner::run() {
         } else {
           Worklist.Add(I);
           Worklist.AddUsersToWorkList(*I);
+          // The operands may have lost a use, or had their flags dropped.
+          if (SingleIteration)
+            for (Value *Op : I->operands())
+              if (auto *OpI = dyn_cast<Instruction>(Op))
+                Worklist.Add(OpI);
         }
       }
       MadeIRChange = true;
@@ -3066,6 +3106,31 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
   return MadeIRChange;
 }
 
+/// Describe the combines done by \p IC, most frequent first, e.g.
+/// "icmp (3), add (1)".
+static std::string describeCombines(const InstCombiner &IC) {
+  std::vector<std::pair<unsigned, unsigned>> Combines(
+      IC.getCombinesByOpcode().begin(), IC.getCombinesByOpcode().end());
+  std::sort(Combines.begin(), Combines.end(),
+            [](const std::pair<unsigned, unsigned> &LHS,
+               const std::pair<unsigned, unsigned> &RHS) {
+              if (LHS.second != RHS.second)
+                return LHS.second > RHS.second;
+              return LHS.first < RHS.first;
+            });
+
+  std::string Desc;
+  raw_string_ostream OS(Desc);
+  for (const auto &C : Combines) {
+    if (&C != &Combines.front())
+      OS << ", ";
+    OS << Instruction::getOpcodeName(C.first) << " (" << C.second << ")";
+  }
+  if (Combines.empty())
+    OS << "dead and constant instructions only";
+  return OS.str();
+}
+
 static bool
 combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
                                 AliasAnalysis *AA, AssumptionCache &AC,
@@ -3085,7 +3150,10 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
   bool DbgDeclaresChanged = LowerDbgDeclare(F);
 
   // Iterate while there is work to do.
-  int Iteration = 0;
+  unsigned MaxIter =
+      SingleIteration ? 1 : std::max(1U, (unsigned)MaxIterations);
+  unsigned Iteration = 0;
+  bool MadeIRChange = false;
   for (;;) {
     ++Iteration;
     DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
@@ -3093,15 +3161,44 @@ combineInstructionsOverFunction(Function &F, InstCombineWorklist &Worklist,
 
     bool Changed = prepareICWorklistFromFunction(F, DL, &TLI, Worklist);
 
+    KnownBitsCache KnownBits;
     InstCombiner IC(Worklist, &Builder, F.optForMinSize(), ExpensiveCombines,
-                    AA, &AC, &TLI, &DT, DL, LI);
+                    AA, &AC, &TLI, &DT, DL, LI,
+                    CacheKnownBits ? &KnownBits : nullptr, SingleIteration);
     Changed |= IC.run();
 
     if (!Changed)
       break;
+    MadeIRChange = true;
+
+    // Every iteration after the first rescans the whole function, only because
+    // the previous one did not leave all its work on the worklist.
+    if (Iteration > 1)
+      DEBUG(dbgs() << "IC: Iteration #" << Iteration << " on " << F.getName()
+                   << " still changed: " << describeCombines(IC) << '\n');
+
+    if (Iteration == MaxIter) {
+      if (!SingleIteration) {
+        ++NumMaxIterationsReached;
+        emitOptimizationRemarkAnalysis(
+            F.getContext(), DEBUG_TYPE, F, DebugLoc(),
+            "no fixed point after " + Twine(Iteration) +
+                " iterations, the last one changed: " + describeCombines(IC));
+      }
+      break;
+    }
   }
 
-  return DbgDeclaresChanged || Iteration > 1;
+  if (Iteration == 1)
+    ++NumOneIteration;
+  else if (Iteration == 2)
+    ++NumTwoIterations;
+  else if (Iteration == 3)
+    ++NumThreeIterations;
+  else
+    ++NumFourOrMoreIterations;
+
+  return DbgDeclaresChanged || MadeIRChange;
 }
 
 PreservedAnalyses InstCombinePass::run(Function &F,
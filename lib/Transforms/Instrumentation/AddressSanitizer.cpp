@@ -16,13 +16,18 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/MemoryBuiltins.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CallSite.h"
@@ -226,6 +231,21 @@ static cl::opt<bool> ClOptGlobals("asan-opt-globals",
 static cl::opt<bool> ClOptStack(
     "asan-opt-stack", cl::desc("Don't instrument scalar stack variables"),
     cl::Hidden, cl::init(false));
+static cl::opt<bool> ClOptDominating(
+    "asan-opt-dominating",
+    cl::desc("Don't instrument accesses that a dominating check covers, and "
+             "check adjacent accesses at once"),
+    cl::Hidden, cl::init(false));
+static cl::opt<unsigned> ClOptDominatingMaxBlocks(
+    "asan-opt-dominating-max-blocks",
+    cl::desc("The maximum number of blocks between a check and the access "
+             "it covers"),
+    cl::Hidden, cl::init(32));
+static cl::opt<bool> ClOptLoopRanges(
+    "asan-opt-loop-ranges",
+    cl::desc("Check the range of the strided accesses of a loop once in its "
+             "preheader"),
+    cl::Hidden, cl::init(false));
 
 static cl::opt<bool> ClDynamicAllocaStack(
     "asan-stack-dynamic-alloca",
@@ -261,6 +281,12 @@ STATISTIC(NumOptimizedAccessesToGlobalVar,
           "Number of optimized accesses to global vars");
 STATISTIC(NumOptimizedAccessesToStackVar,
           "Number of optimized accesses to stack vars");
+STATISTIC(NumOptimizedDominatedAccesses,
+          "Number of accesses covered by a dominating check");
+STATISTIC(NumOptimizedCombinedAccesses,
+          "Number of accesses checked together with an adjacent access");
+STATISTIC(NumOptimizedLoopAccesses,
+          "Number of loop accesses checked by a range check in the preheader");
 
 namespace {
 /// Frontend-provided metadata for source location.
@@ -448,6 +474,10 @@ struct AddressSanitizer : public FunctionPass {
   void getAnalysisUsage(AnalysisUsage &AU) const override {
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
+    if (ClOpt && (ClOptDominating || ClOptLoopRanges))
+      AU.addRequired<ScalarEvolutionWrapperPass>();
+    if (ClOpt && ClOptLoopRanges)
+      AU.addRequired<LoopInfoWrapperPass>();
   }
   uint64_t getAllocaSizeInBytes(AllocaInst *AI) const {
     Type *Ty = AI->getAllocatedType();
@@ -469,6 +499,22 @@ struct AddressSanitizer : public FunctionPass {
                                    uint64_t *TypeSize, unsigned *Alignment);
   void instrumentMop(ObjectSizeOffsetVisitor &ObjSizeVis, Instruction *I,
                      bool UseCalls, const DataLayout &DL);
+  /// The byte offset from its address and the size in bits of a check that
+  /// covers adjacent accesses too.
+  typedef DenseMap<Instruction *, std::pair<int64_t, uint64_t>> WidenedCheckMap;
+  /// Remove from \p ToInstrument the accesses that the check of another one
+  /// covers, and record in \p WidenedChecks the checks that were widened to
+  /// cover adjacent accesses.
+  void eliminateRedundantChecks(Function &F,
+                                SmallVectorImpl<Instruction *> &ToInstrument,
+                                WidenedCheckMap &WidenedChecks);
+  void instrumentWidenedMop(Instruction *I, int64_t Offset, uint64_t TypeSize,
+                            bool UseCalls);
+  /// Replace the checks of the accesses of \p ToInstrument that walk over
+  /// a contiguous range in a loop with one check of the range in the
+  /// preheader of the loop.
+  void hoistLoopRangeChecks(Function &F,
+                            SmallVectorImpl<Instruction *> &ToInstrument);
   void instrumentPointerComparisonOrSubtraction(Instruction *I);
   void instrumentAddress(Instruction *OrigIns, Instruction *InsertBefore,
                          Value *Addr, uint32_t TypeSize, bool IsWrite,
@@ -792,6 +838,8 @@ INITIALIZE_PASS_BEGIN(
     "AddressSanitizer: detects use-after-free and out-of-bounds bugs.", false,
     false)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
 INITIALIZE_PASS_END(
     AddressSanitizer, "asan",
@@ -1054,6 +1102,280 @@ void AddressSanitizer::instrumentMop(ObjectSizeOffsetVisitor &ObjSizeVis,
                                    UseCalls, Exp);
 }
 
+void AddressSanitizer::instrumentWidenedMop(Instruction *I, int64_t Offset,
+                                            uint64_t TypeSize, bool UseCalls) {
+  bool IsWrite = false;
+  unsigned Alignment = 0;
+  uint64_t AccessSize = 0;
+  Value *Addr = isInterestingMemoryAccess(I, &IsWrite, &AccessSize, &Alignment);
+  assert(Addr);
+  if (IsWrite)
+    NumInstrumentedWrites++;
+  else
+    NumInstrumentedReads++;
+
+  if (Offset) {
+    IRBuilder<> IRB(I);
+    Addr = IRB.CreateGEP(IRB.CreatePointerCast(Addr, IRB.getInt8PtrTy()),
+                         ConstantInt::get(IntptrTy, Offset));
+  }
+  // The start of a widened check is aligned to its size.
+  instrumentAddress(I, I, Addr, TypeSize, IsWrite, nullptr, UseCalls,
+                    ClForceExperiment);
+}
+
+namespace {
+/// \brief A memory access that the redundant check elimination considers.
+struct CheckedAccess {
+  Instruction *I;
+  const SCEV *Addr;
+  bool IsWrite;
+  /// The range of the check is [Addr + Lo, Addr + Lo + Size), and its start
+  /// is aligned to StartAlign bytes.
+  int64_t Lo;
+  uint64_t Size;
+  uint64_t StartAlign;
+  bool Widened;
+  bool Removed;
+};
+} // end anonymous namespace
+
+/// Return true if there is no call that may free or poison memory between
+/// \p From and \p To, which \p From dominates.
+static bool noCallsBetween(Instruction *From, Instruction *To) {
+  auto IsBarrier = [](Instruction &I) {
+    return CallSite(&I) && !isa<DbgInfoIntrinsic>(I);
+  };
+  BasicBlock *FromBB = From->getParent();
+  BasicBlock *ToBB = To->getParent();
+  if (FromBB == ToBB)
+    return std::none_of(std::next(From->getIterator()), To->getIterator(),
+                        IsBarrier);
+  if (std::any_of(std::next(From->getIterator()), FromBB->end(), IsBarrier) ||
+      std::any_of(ToBB->begin(), To->getIterator(), IsBarrier))
+    return false;
+
+  // All the paths to ToBB go through FromBB, so walking up from ToBB without
+  // crossing FromBB finds the blocks between them.
+  SmallPtrSet<BasicBlock *, 16> Visited;
+  SmallVector<BasicBlock *, 16> Worklist(pred_begin(ToBB), pred_end(ToBB));
+  while (!Worklist.empty()) {
+    BasicBlock *BB = Worklist.pop_back_val();
+    if (BB == FromBB || !Visited.insert(BB).second)
+      continue;
+    if (Visited.size() > ClOptDominatingMaxBlocks ||
+        std::any_of(BB->begin(), BB->end(), IsBarrier))
+      return false;
+    Worklist.append(pred_begin(BB), pred_end(BB));
+  }
+  return true;
+}
+
+void AddressSanitizer::eliminateRedundantChecks(
+    Function &F, SmallVectorImpl<Instruction *> &ToInstrument,
+    WidenedCheckMap &WidenedChecks) {
+  ScalarEvolution &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  const DataLayout &DL = F.getParent()->getDataLayout();
+
+  // Visit the accesses in reverse post order, which puts the dominating
+  // accesses first.
+  DenseMap<BasicBlock *, unsigned> RPONumber;
+  ReversePostOrderTraversal<Function *> RPOT(&F);
+  for (BasicBlock *BB : RPOT)
+    RPONumber[BB] = RPONumber.size();
+  std::stable_sort(ToInstrument.begin(), ToInstrument.end(),
+                   [&](Instruction *A, Instruction *B) {
+                     return RPONumber.lookup(A->getParent()) <
+                            RPONumber.lookup(B->getParent());
+                   });
+
+  // The accesses are grouped by their base pointer, as the others cannot be
+  // at a constant distance.
+  std::vector<CheckedAccess> Accesses;
+  DenseMap<const SCEV *, SmallVector<unsigned, 8>> Groups;
+  for (Instruction *I : ToInstrument) {
+    bool IsWrite;
+    unsigned Alignment;
+    uint64_t TypeSize;
+    Value *Addr = isInterestingMemoryAccess(I, &IsWrite, &TypeSize, &Alignment);
+    if (!Addr || TypeSize % 8 != 0 || !SE.isSCEVable(Addr->getType()))
+      continue;
+    if (!Alignment)
+      Alignment = DL.getABITypeAlignment(
+          cast<PointerType>(Addr->getType())->getElementType());
+    const SCEV *S = SE.getSCEV(Addr);
+    Groups[SE.getPointerBase(S)].push_back(Accesses.size());
+    Accesses.push_back(
+        {I, S, IsWrite, 0, TypeSize / 8, Alignment, false, false});
+  }
+
+  unsigned Granularity = 1 << Mapping.Scale;
+  for (auto &Group : Groups) {
+    SmallVectorImpl<unsigned> &Members = Group.second;
+    for (unsigned J = 1, E = Members.size(); J != E; ++J) {
+      CheckedAccess &B = Accesses[Members[J]];
+      for (unsigned K = 0; K != J && !B.Removed; ++K) {
+        CheckedAccess &A = Accesses[Members[K]];
+        if (A.Removed)
+          continue;
+        auto *Dist = dyn_cast<SCEVConstant>(SE.getMinusSCEV(B.Addr, A.Addr));
+        if (!Dist || Dist->getAPInt().getMinSignedBits() > 64)
+          continue;
+        int64_t BLo = Dist->getAPInt().getSExtValue();
+        int64_t BHi = BLo + (int64_t)B.Size;
+        int64_t AHi = A.Lo + (int64_t)A.Size;
+
+        // A check of A that covers the bytes of B makes the check of B
+        // redundant.
+        if (A.Lo <= BLo && BHi <= AHi) {
+          if (!DT->dominates(A.I, B.I) || !noCallsBetween(A.I, B.I))
+            continue;
+          DEBUG(dbgs() << "ASAN: " << *B.I << " is covered by " << *A.I
+                       << "\n");
+          B.Removed = true;
+          NumOptimizedDominatedAccesses++;
+          break;
+        }
+
+        // An access next to A in the same block is checked with A, when the
+        // combined range is a single aligned check.
+        if (A.I->getParent() != B.I->getParent() || A.IsWrite != B.IsWrite ||
+            (BLo != AHi && BHi != A.Lo))
+          continue;
+        int64_t Lo = std::min(A.Lo, BLo);
+        uint64_t Size = std::max(AHi, BHi) - Lo;
+        uint64_t StartAlign = Lo == A.Lo ? A.StartAlign : B.StartAlign;
+        if (Size > 16 || !isPowerOf2_64(Size) ||
+            (StartAlign < Size && StartAlign < Granularity) ||
+            !DT->dominates(A.I, B.I) || !noCallsBetween(A.I, B.I))
+          continue;
+        DEBUG(dbgs() << "ASAN: " << *B.I << " is checked with " << *A.I
+                     << "\n");
+        A.Lo = Lo;
+        A.Size = Size;
+        A.StartAlign = StartAlign;
+        A.Widened = true;
+        B.Removed = true;
+        NumOptimizedCombinedAccesses++;
+      }
+    }
+  }
+
+  SmallPtrSet<Instruction *, 16> Removed;
+  for (const CheckedAccess &A : Accesses) {
+    if (A.Removed)
+      Removed.insert(A.I);
+    else if (A.Widened)
+      WidenedChecks[A.I] = std::make_pair(A.Lo, A.Size * 8);
+  }
+  ToInstrument.erase(std::remove_if(ToInstrument.begin(), ToInstrument.end(),
+                                    [&](Instruction *I) {
+                                      return Removed.count(I);
+                                    }),
+                     ToInstrument.end());
+}
+
+/// Return true if every access of \p L that dominates its latch runs in
+/// each of its iterations, and nothing in \p L may free or poison memory.
+static bool isRangeCheckableLoop(Loop *L) {
+  if (!L->getLoopPreheader() || !L->getLoopLatch() ||
+      L->getExitingBlock() != L->getLoopLatch())
+    return false;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (CallSite(&I) && !isa<DbgInfoIntrinsic>(I))
+        return false;
+  return true;
+}
+
+void AddressSanitizer::hoistLoopRangeChecks(
+    Function &F, SmallVectorImpl<Instruction *> &ToInstrument) {
+  LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+  ScalarEvolution &SE = getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+  const DataLayout &DL = F.getParent()->getDataLayout();
+  SCEVExpander Expander(SE, DL, "asan.range");
+
+  DenseMap<Loop *, bool> CheckableLoops;
+  // The ranges that are checked already, with whether they were checked for
+  // a write.
+  DenseMap<std::pair<const SCEV *, const SCEV *>, bool> CheckedRanges;
+  SmallPtrSet<Instruction *, 16> Hoisted;
+  for (Instruction *I : ToInstrument) {
+    bool IsWrite;
+    unsigned Alignment;
+    uint64_t TypeSize;
+    Value *Addr = isInterestingMemoryAccess(I, &IsWrite, &TypeSize, &Alignment);
+    Loop *L = LI.getLoopFor(I->getParent());
+    if (!Addr || !L || TypeSize % 8 != 0)
+      continue;
+    auto Checkable = CheckableLoops.insert(std::make_pair(L, false));
+    if (Checkable.second)
+      Checkable.first->second = isRangeCheckableLoop(L);
+    if (!Checkable.first->second ||
+        !DT->dominates(I->getParent(), L->getLoopLatch()))
+      continue;
+
+    // The accesses must be contiguous, so that the range has no bytes that
+    // the loop does not access.
+    auto *AR = dyn_cast<SCEVAddRecExpr>(SE.getSCEV(Addr));
+    if (!AR || AR->getLoop() != L || !AR->isAffine())
+      continue;
+    auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(SE));
+    uint64_t AccessSize = TypeSize / 8;
+    if (!Step || Step->getAPInt().getMinSignedBits() > 64)
+      continue;
+    int64_t StepVal = Step->getAPInt().getSExtValue();
+    if (StepVal == 0 || (uint64_t)std::abs(StepVal) > AccessSize)
+      continue;
+    const SCEV *BTC = SE.getBackedgeTakenCount(L);
+    if (isa<SCEVCouldNotCompute>(BTC) ||
+        SE.getTypeSizeInBits(BTC->getType()) > DL.getPointerSizeInBits())
+      continue;
+
+    // The range is [Start, Start + BTC * |Step| + AccessSize), where Start is
+    // the address of the first iteration, or of the last one when the
+    // accesses go down.
+    const SCEV *Start =
+        StepVal > 0 ? AR->getStart() : AR->evaluateAtIteration(BTC, SE);
+    const SCEV *Size = SE.getAddExpr(
+        SE.getMulExpr(SE.getZeroExtendExpr(BTC, IntptrTy),
+                      SE.getConstant(IntptrTy, std::abs(StepVal))),
+        SE.getConstant(IntptrTy, AccessSize));
+    BasicBlock *Preheader = L->getLoopPreheader();
+    if (!isSafeToExpand(Start, SE) || !isSafeToExpand(Size, SE) ||
+        !SE.dominates(Start, Preheader) || !SE.dominates(Size, Preheader))
+      continue;
+
+    DEBUG(dbgs() << "ASAN: checking the range of " << *I << " in "
+                 << Preheader->getName() << "\n");
+    Hoisted.insert(I);
+    NumOptimizedLoopAccesses++;
+    auto Checked = CheckedRanges.insert(
+        std::make_pair(std::make_pair(Start, Size), IsWrite));
+    if (!Checked.second && (Checked.first->second || !IsWrite))
+      continue;
+    Checked.first->second |= IsWrite;
+
+    Instruction *InsertPt = Preheader->getTerminator();
+    Value *StartV = Expander.expandCodeFor(Start, IntptrTy, InsertPt);
+    Value *SizeV = Expander.expandCodeFor(Size, IntptrTy, InsertPt);
+    IRBuilder<> IRB(InsertPt);
+    uint32_t Exp = ClForceExperiment;
+    if (Exp == 0)
+      IRB.CreateCall(AsanMemoryAccessCallbackSized[IsWrite][0],
+                     {StartV, SizeV});
+    else
+      IRB.CreateCall(AsanMemoryAccessCallbackSized[IsWrite][1],
+                     {StartV, SizeV, ConstantInt::get(IRB.getInt32Ty(), Exp)});
+  }
+
+  ToInstrument.erase(std::remove_if(ToInstrument.begin(), ToInstrument.end(),
+                                    [&](Instruction *I) {
+                                      return Hoisted.count(I);
+                                    }),
+                     ToInstrument.end());
+}
+
 Instruction *AddressSanitizer::generateCrashCode(Instruction *InsertBefore,
                                                  Value *Addr, bool IsWrite,
                                                  size_t AccessSizeIndex,
@@ -1810,12 +2132,23 @@ bool AddressSanitizer::runOnFunction(Function &F) {
   ObjectSizeOffsetVisitor ObjSizeVis(DL, TLI, F.getContext(),
                                      /*RoundToAlign=*/true);
 
+  if (ClOpt && ClOptLoopRanges)
+    hoistLoopRangeChecks(F, ToInstrument);
+  WidenedCheckMap WidenedChecks;
+  if (ClOpt && ClOptDominating)
+    eliminateRedundantChecks(F, ToInstrument, WidenedChecks);
+
   // Instrument.
   int NumInstrumented = 0;
   for (auto Inst : ToInstrument) {
     if (ClDebugMin < 0 || ClDebugMax < 0 ||
         (NumInstrumented >= ClDebugMin && NumInstrumented <= ClDebugMax)) {
-      if (isInterestingMemoryAccess(Inst, &IsWrite, &TypeSize, &Alignment))
+      auto Widened = WidenedChecks.find(Inst);
+      if (Widened != WidenedChecks.end())
+        instrumentWidenedMop(Inst, Widened->second.first,
+                             Widened->second.second, UseCalls);
+      else if (isInterestingMemoryAccess(Inst, &IsWrite, &TypeSize,
+                                         &Alignment))
         instrumentMop(ObjSizeVis, Inst, UseCalls,
                       F.getParent()->getDataLayout());
       else
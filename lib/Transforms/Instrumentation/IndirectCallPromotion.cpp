@@ -11,13 +11,21 @@
 // conditional direct calls when the indirect-call value profile metadata is
 // available.
 //
+// With -icp-inline-cost-model, the targets that fall short of the fixed
+// thresholds are still promoted when the inline cost model predicts that the
+// promoted direct call would be inlined, since that is where most of the
+// benefit of the promotion comes from.
+//
 //===----------------------------------------------------------------------===//
 
 #include "IndirectCallSiteVisitor.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/InlineCost.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/IRBuilder.h"
@@ -43,6 +51,9 @@ using namespace llvm;
 
 STATISTIC(NumOfPGOICallPromotion, "Number of indirect call promotions.");
 STATISTIC(NumOfPGOICallsites, "Number of indirect call candidate sites.");
+STATISTIC(NumOfPGOICallPromotionForInlining,
+          "Number of indirect call promotions enabled by the inline cost "
+          "model.");
 
 // Command line option to disable indirect-call promotion with the default as
 // false. This is for debug purpose.
@@ -71,6 +82,19 @@ static cl::opt<unsigned>
                      cl::desc("Max number of promotions for a single indirect "
                               "call callsite"));
 
+// If the option is set, the targets below the thresholds are still promoted
+// when the inline cost model says that the direct call would be inlined.
+static cl::opt<bool> ICPInlineCostModel(
+    "icp-inline-cost-model", cl::init(false), cl::Hidden,
+    cl::desc("Promote the targets that would be inlined at lower thresholds"));
+
+// The percent threshold for the direct-call target for it to be considered as
+// the promotion target when it would be inlined.
+static cl::opt<unsigned> ICPInlinePercentThreshold(
+    "icp-inline-percent-threshold", cl::init(10), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("The percentage threshold for the promotion of targets that "
+             "would be inlined"));
+
 // Set the cutoff value for the promotion. If the value is other than 0, we
 // stop the transformation once the total number of promotions equals the cutoff
 // value.
@@ -126,6 +150,11 @@ public:
     return "PGOIndirectCallPromotion";
   }
 
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<AssumptionCacheTracker>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+  }
+
 private:
   bool runOnModule(Module &M) override;
 
@@ -136,10 +165,16 @@ private:
 } // end anonymous namespace
 
 char PGOIndirectCallPromotionLegacyPass::ID = 0;
-INITIALIZE_PASS(PGOIndirectCallPromotionLegacyPass, "pgo-icall-prom",
-                "Use PGO instrumentation profile to promote indirect calls to "
-                "direct calls.",
-                false, false)
+INITIALIZE_PASS_BEGIN(PGOIndirectCallPromotionLegacyPass, "pgo-icall-prom",
+                      "Use PGO instrumentation profile to promote indirect "
+                      "calls to direct calls.",
+                      false, false)
+INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(PGOIndirectCallPromotionLegacyPass, "pgo-icall-prom",
+                    "Use PGO instrumentation profile to promote indirect "
+                    "calls to direct calls.",
+                    false, false)
 
 ModulePass *llvm::createPGOIndirectCallPromotionLegacyPass(bool InLTO) {
   return new PGOIndirectCallPromotionLegacyPass(InLTO);
@@ -157,6 +192,11 @@ private:
   // defines.
   InstrProfSymtab *Symtab;
 
+  // The inline cost model needs these, they are null when it is not
+  // available.
+  std::function<TargetTransformInfo &(Function &)> *GetTTI;
+  AssumptionCacheTracker *ACT;
+
   // Allocate space to read the profile annotation.
   std::unique_ptr<InstrProfValueData[]> ValueDataArray;
 
@@ -165,6 +205,14 @@ private:
   // Return true we should promote this indirect-call target.
   bool isPromotionProfitable(uint64_t Count, uint64_t TotalCount);
 
+  // Return true if the indirect-call target may still be worth promoting if
+  // the direct call would be inlined.
+  bool isPromotionProfitableWhenInlined(uint64_t Count, uint64_t TotalCount);
+
+  // Return true if the inline cost model predicts that the direct call of
+  // TargetFunction at Inst would be inlined.
+  bool wouldBeInlined(Instruction *Inst, Function *TargetFunction);
+
   enum TargetStatus {
     OK,                   // Should be able to promote.
     NotAvailableInModule, // Cannot find the target in current module.
@@ -230,8 +278,10 @@ private:
   ICallPromotionFunc &operator=(const ICallPromotionFunc &other) = delete;
 
 public:
-  ICallPromotionFunc(Function &Func, Module *Modu, InstrProfSymtab *Symtab)
-      : F(Func), M(Modu), Symtab(Symtab) {
+  ICallPromotionFunc(Function &Func, Module *Modu, InstrProfSymtab *Symtab,
+                     std::function<TargetTransformInfo &(Function &)> *GetTTI,
+                     AssumptionCacheTracker *ACT)
+      : F(Func), M(Modu), Symtab(Symtab), GetTTI(GetTTI), ACT(ACT) {
     ValueDataArray = llvm::make_unique<InstrProfValueData[]>(MaxNumPromotions);
   }
   bool processFunction();
@@ -247,6 +297,39 @@ bool ICallPromotionFunc::isPromotionProfitable(uint64_t Count,
   return (Percentage >= ICPPercentThreshold);
 }
 
+bool ICallPromotionFunc::isPromotionProfitableWhenInlined(uint64_t Count,
+                                                          uint64_t TotalCount) {
+  if (!ICPInlineCostModel || !GetTTI || !ACT || Count < ICPCountThreshold)
+    return false;
+
+  unsigned Percentage = (Count * 100) / TotalCount;
+  return (Percentage >= ICPInlinePercentThreshold);
+}
+
+bool ICallPromotionFunc::wouldBeInlined(Instruction *Inst,
+                                        Function *TargetFunction) {
+  // The cost model maps the arguments of the call site to the parameters of
+  // the callee, which needs the types to match.
+  CallSite CS(Inst);
+  FunctionType *FTy = TargetFunction->getFunctionType();
+  if (FTy->isVarArg() || FTy->getReturnType() != Inst->getType() ||
+      FTy->getNumParams() != CS.arg_size())
+    return false;
+  for (unsigned I = 0, E = FTy->getNumParams(); I != E; ++I)
+    if (FTy->getParamType(I) != CS.getArgument(I)->getType())
+      return false;
+
+  InlineCost IC =
+      getInlineCost(CS, TargetFunction, getDefaultInlineThreshold(),
+                    (*GetTTI)(*TargetFunction), ACT);
+  DEBUG(dbgs() << " Inline cost of " << TargetFunction->getName() << ": "
+               << (IC.isAlways() ? "always"
+                                 : IC.isNever() ? "never"
+                                                : Twine(IC.getCost()).str())
+               << "\n");
+  return !!IC;
+}
+
 ICallPromotionFunc::TargetStatus
 ICallPromotionFunc::isPromotionLegal(Instruction *Inst, uint64_t Target,
                                      Function *&TargetFunction) {
@@ -322,7 +405,8 @@ ICallPromotionFunc::getPromotionCandidatesForCallSite(
       DEBUG(dbgs() << " Not promote: Cutoff reached.\n");
       break;
     }
-    if (!isPromotionProfitable(Count, TotalCount)) {
+    bool Profitable = isPromotionProfitable(Count, TotalCount);
+    if (!Profitable && !isPromotionProfitableWhenInlined(Count, TotalCount)) {
       DEBUG(dbgs() << " Not promote: Cold target.\n");
       break;
     }
@@ -339,6 +423,13 @@ ICallPromotionFunc::getPromotionCandidatesForCallSite(
               Twine(" with count of ") + Twine(Count) + ": " + Reason);
       break;
     }
+    if (!Profitable) {
+      if (!wouldBeInlined(Inst, TargetFunction)) {
+        DEBUG(dbgs() << " Not promote: Cold target that is not inlined.\n");
+        break;
+      }
+      NumOfPGOICallPromotionForInlining++;
+    }
     Ret.push_back(PromotionCandidate(TargetFunction, Count));
     TotalCount -= Count;
   }
@@ -663,7 +754,10 @@ bool ICallPromotionFunc::processFunction() {
 }
 
 // A wrapper function that does the actual work.
-static bool promoteIndirectCalls(Module &M, bool InLTO) {
+static bool
+promoteIndirectCalls(Module &M, bool InLTO,
+                     std::function<TargetTransformInfo &(Function &)> *GetTTI,
+                     AssumptionCacheTracker *ACT) {
   if (DisableICP)
     return false;
   InstrProfSymtab Symtab;
@@ -674,7 +768,7 @@ static bool promoteIndirectCalls(Module &M, bool InLTO) {
       continue;
     if (F.hasFnAttribute(Attribute::OptimizeNone))
       continue;
-    ICallPromotionFunc ICallPromotion(F, &M, &Symtab);
+    ICallPromotionFunc ICallPromotion(F, &M, &Symtab, GetTTI, ACT);
     bool FuncChanged = ICallPromotion.processFunction();
     if (ICPDUMPAFTER && FuncChanged) {
       DEBUG(dbgs() << "\n== IR Dump After =="; F.print(dbgs()));
@@ -690,12 +784,19 @@ static bool promoteIndirectCalls(Module &M, bool InLTO) {
 }
 
 bool PGOIndirectCallPromotionLegacyPass::runOnModule(Module &M) {
+  std::function<TargetTransformInfo &(Function &)> GetTTI =
+      [this](Function &F) -> TargetTransformInfo & {
+    return getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+  };
   // Command-line option has the priority for InLTO.
-  return promoteIndirectCalls(M, InLTO | ICPLTOMode);
+  return promoteIndirectCalls(M, InLTO | ICPLTOMode, &GetTTI,
+                              &getAnalysis<AssumptionCacheTracker>());
 }
 
 PreservedAnalyses PGOIndirectCallPromotion::run(Module &M, AnalysisManager<Module> &AM) {
-  if (!promoteIndirectCalls(M, InLTO | ICPLTOMode))
+  // FIXME: The inline cost model needs an AssumptionCacheTracker, which the
+  // new pass manager does not have, so it is not used here yet.
+  if (!promoteIndirectCalls(M, InLTO | ICPLTOMode, nullptr, nullptr))
     return PreservedAnalyses::all();
 
   return PreservedAnalyses::none();
@@ -13,18 +13,27 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/Triple.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/ProfileData/InstrProf.h"
 #include "llvm/Transforms/InstrProfiling.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/ModuleUtils.h"
+#include "llvm/Transforms/Utils/SSAUpdater.h"
 
 using namespace llvm;
 
 #define DEBUG_TYPE "instrprof"
 
+STATISTIC(NumPromotedCounters, "Number of counters promoted out of loops");
+
 namespace {
 
 cl::opt<bool> DoNameCompression("enable-name-compression",
@@ -45,6 +54,32 @@ cl::opt<double> NumCountersPerValueSite(
     // is usually smaller than 2.
     cl::init(1.0));
 
+// These override the options of the pass when they are given.
+cl::opt<bool> DoCounterPromotion(
+    "do-counter-promotion", cl::ZeroOrMore, cl::init(false),
+    cl::desc("Keep the counters of loops in registers, and update them in "
+             "memory at the loop exits"));
+cl::opt<bool> AtomicCounterUpdate(
+    "instrprof-atomic-counter-update-all", cl::ZeroOrMore, cl::init(false),
+    cl::desc("Update the counters in memory with atomic instructions"));
+cl::opt<unsigned> MaxNumOfPromotionsPerLoop(
+    "max-counter-promotions-per-loop", cl::init(20), cl::Hidden,
+    cl::desc("The maximum number of counters promoted out of a loop, to "
+             "bound the register pressure"));
+
+cl::opt<bool> SampledInstrumentation(
+    "sampled-instrumentation", cl::init(false),
+    cl::desc("Only update the counters in a fraction of the calls of the "
+             "instrumented functions"));
+cl::opt<unsigned> SampledInstrPeriod(
+    "sampled-instr-period", cl::init(65536), cl::Hidden,
+    cl::desc("The number of calls of instrumented functions in a sampling "
+             "period"));
+cl::opt<unsigned> SampledInstrBurstDuration(
+    "sampled-instr-burst-duration", cl::init(200), cl::Hidden,
+    cl::desc("The number of calls of instrumented functions that are "
+             "profiled at the start of each sampling period"));
+
 class InstrProfilingLegacyPass : public ModulePass {
   InstrProfiling InstrProf;
 
@@ -86,6 +121,51 @@ bool InstrProfiling::isMachO() const {
   return Triple(M->getTargetTriple()).isOSBinFormatMachO();
 }
 
+bool InstrProfiling::isCounterPromotionEnabled() const {
+  if (DoCounterPromotion.getNumOccurrences() > 0)
+    return DoCounterPromotion;
+  return Options.DoCounterPromotion;
+}
+
+bool InstrProfiling::isAtomic() const {
+  if (AtomicCounterUpdate.getNumOccurrences() > 0)
+    return AtomicCounterUpdate;
+  return Options.Atomic;
+}
+
+/// Return true if the counters are only updated in some of the calls.
+static bool isSamplingEnabled() {
+  return SampledInstrumentation &&
+         SampledInstrBurstDuration < SampledInstrPeriod;
+}
+
+Value *InstrProfiling::emitSamplingCheck(Function &F) {
+  // All the threads and instrumented functions of a module share one
+  // countdown, which is local to each thread to avoid contention.
+  Type *Int32Ty = Type::getInt32Ty(M->getContext());
+  auto *SamplingVar = M->getNamedGlobal(getInstrProfSamplingVarName());
+  if (!SamplingVar) {
+    SamplingVar = new GlobalVariable(
+        *M, Int32Ty, false, GlobalValue::LinkOnceODRLinkage,
+        Constant::getNullValue(Int32Ty), getInstrProfSamplingVarName(),
+        nullptr, GlobalVariable::GeneralDynamicTLSModel);
+    SamplingVar->setVisibility(GlobalValue::HiddenVisibility);
+  }
+
+  // The first calls of each period are profiled, so that the counts of a
+  // function stay consistent with the counts of its entry.
+  IRBuilder<> Builder(&*F.getEntryBlock().getFirstInsertionPt());
+  Value *Count = Builder.CreateLoad(SamplingVar, "pgosampling");
+  Value *Next = Builder.CreateAdd(Count, Builder.getInt32(1));
+  Value *Wrap = Builder.CreateICmpUGE(Next,
+                                      Builder.getInt32(SampledInstrPeriod));
+  Builder.CreateStore(Builder.CreateSelect(Wrap, Builder.getInt32(0), Next),
+                      SamplingVar);
+  return Builder.CreateICmpULT(Count,
+                               Builder.getInt32(SampledInstrBurstDuration),
+                               "pgosampled");
+}
+
 /// Get the section name for the counter variables.
 StringRef InstrProfiling::getCountersSection() const {
   return getInstrProfCountersSectionName(isMachO());
@@ -133,18 +213,46 @@ bool InstrProfiling::run(Module &M) {
       static_cast<void>(getOrCreateRegionCounters(FirstProfIncInst));
   }
 
-  for (Function &F : M)
+  // With sampling, the counters are incremented by the number of calls that
+  // each profiled call stands for, which keeps the counts comparable with
+  // the counts of profiles that are not sampled.
+  uint64_t Step =
+      isSamplingEnabled()
+          ? std::max(1U, SampledInstrPeriod / SampledInstrBurstDuration)
+          : 1;
+
+  for (Function &F : M) {
+    PromotionCandidates.clear();
+    SmallVector<IntrinsicInst *, 16> ProfInsts;
     for (BasicBlock &BB : F)
-      for (auto I = BB.begin(), E = BB.end(); I != E;) {
-        auto Instr = I++;
-        if (auto *Inc = dyn_cast<InstrProfIncrementInst>(Instr)) {
-          lowerIncrement(Inc);
-          MadeChange = true;
-        } else if (auto *Ind = dyn_cast<InstrProfValueProfileInst>(Instr)) {
-          lowerValueProfileInst(Ind);
-          MadeChange = true;
-        }
-      }
+      for (Instruction &I : BB)
+        if (isa<InstrProfIncrementInst>(I) ||
+            isa<InstrProfValueProfileInst>(I))
+          ProfInsts.push_back(cast<IntrinsicInst>(&I));
+    if (ProfInsts.empty())
+      continue;
+    MadeChange = true;
+
+    Value *Sampled = nullptr;
+    MDNode *Weights = nullptr;
+    if (isSamplingEnabled()) {
+      Sampled = emitSamplingCheck(F);
+      Weights = MDBuilder(M.getContext())
+                    .createBranchWeights(SampledInstrBurstDuration,
+                                         SampledInstrPeriod -
+                                             SampledInstrBurstDuration);
+    }
+
+    for (IntrinsicInst *II : ProfInsts) {
+      if (Sampled)
+        II->moveBefore(SplitBlockAndInsertIfThen(Sampled, II, false, Weights));
+      if (auto *Inc = dyn_cast<InstrProfIncrementInst>(II))
+        lowerIncrement(Inc, Step);
+      else
+        lowerValueProfileInst(cast<InstrProfValueProfileInst>(II));
+    }
+    promoteCounterLoadStores(F);
+  }
 
   if (GlobalVariable *CoverageNamesVar =
           M.getNamedGlobal(getCoverageUnusedNamesVarName())) {
@@ -213,16 +321,126 @@ void InstrProfiling::lowerValueProfileInst(InstrProfValueProfileInst *Ind) {
   Ind->eraseFromParent();
 }
 
-void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
+void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc,
+                                    uint64_t Step) {
   GlobalVariable *Counters = getOrCreateRegionCounters(Inc);
 
   IRBuilder<> Builder(Inc);
   uint64_t Index = Inc->getIndex()->getZExtValue();
   Value *Addr = Builder.CreateConstInBoundsGEP2_64(Counters, 0, Index);
-  Value *Count = Builder.CreateLoad(Addr, "pgocount");
-  Count = Builder.CreateAdd(Count, Builder.getInt64(1));
-  Inc->replaceAllUsesWith(Builder.CreateStore(Count, Addr));
+  if (isAtomic() && !isCounterPromotionEnabled()) {
+    Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, Builder.getInt64(Step),
+                            AtomicOrdering::Monotonic);
+    Inc->eraseFromParent();
+    return;
+  }
+  LoadInst *Load = Builder.CreateLoad(Addr, "pgocount");
+  Value *Count = Builder.CreateAdd(Load, Builder.getInt64(Step));
+  StoreInst *Store = Builder.CreateStore(Count, Addr);
+  Inc->replaceAllUsesWith(Store);
   Inc->eraseFromParent();
+  if (isCounterPromotionEnabled())
+    PromotionCandidates.emplace_back(Load, Store);
+}
+
+/// Return true if the counter updates of \p L can be kept in registers and
+/// added to memory at its exits.
+static bool canPromoteOutOf(Loop *L) {
+  if (!L->getLoopPreheader() || !L->hasDedicatedExits())
+    return false;
+  SmallVector<BasicBlock *, 8> ExitBlocks;
+  L->getUniqueExitBlocks(ExitBlocks);
+  for (BasicBlock *ExitBB : ExitBlocks)
+    if (ExitBB->isEHPad())
+      return false;
+  return true;
+}
+
+void InstrProfiling::promoteCounterLoadStores(Function &F) {
+  if (PromotionCandidates.empty())
+    return;
+
+  DominatorTree DT(F);
+  LoopInfo LI(DT);
+
+  // Promote each counter out of the outermost loop that allows it. A counter
+  // that is updated more than once in the loop stays in memory.
+  typedef std::pair<LoadInst *, StoreInst *> LoadStorePair;
+  MapVector<std::pair<Loop *, Value *>, SmallVector<LoadStorePair, 2>>
+      LoopCounters;
+  for (const LoadStorePair &Cand : PromotionCandidates) {
+    Loop *Target = nullptr;
+    for (Loop *L = LI.getLoopFor(Cand.first->getParent()); L;
+         L = L->getParentLoop())
+      if (canPromoteOutOf(L))
+        Target = L;
+    if (Target)
+      LoopCounters[std::make_pair(Target, Cand.second->getPointerOperand())]
+          .push_back(Cand);
+  }
+
+  SmallPtrSet<Instruction *, 16> Promoted;
+  DenseMap<Loop *, unsigned> NumPromoted;
+  for (auto &Entry : LoopCounters) {
+    Loop *L = Entry.first.first;
+    Value *Addr = Entry.first.second;
+    if (Entry.second.size() != 1 ||
+        NumPromoted[L] >= MaxNumOfPromotionsPerLoop)
+      continue;
+    ++NumPromoted[L];
+    LoadInst *Load = Entry.second.front().first;
+    StoreInst *Store = Entry.second.front().second;
+    Value *Count = Store->getValueOperand();
+
+    // The count of the loop starts at zero in the preheader, and is
+    // incremented where the counter was.
+    SSAUpdater SSA;
+    SSA.Initialize(Load->getType(), "pgocount.promoted");
+    SSA.AddAvailableValue(L->getLoopPreheader(),
+                          ConstantInt::get(Load->getType(), 0));
+    SSA.AddAvailableValue(Load->getParent(), Count);
+    Load->replaceAllUsesWith(SSA.GetValueInMiddleOfBlock(Load->getParent()));
+    Promoted.insert(Load);
+    Promoted.insert(Store);
+    Store->eraseFromParent();
+    Load->eraseFromParent();
+
+    // The counter in memory is reloaded at the exits, as the loop may call
+    // functions that update it too.
+    SmallVector<BasicBlock *, 8> ExitBlocks;
+    L->getUniqueExitBlocks(ExitBlocks);
+    for (BasicBlock *ExitBB : ExitBlocks) {
+      Value *LiveOut = SSA.GetValueInMiddleOfBlock(ExitBB);
+      if (auto *C = dyn_cast<ConstantInt>(LiveOut))
+        if (C->isZero())
+          continue;
+      IRBuilder<> Builder(&*ExitBB->getFirstInsertionPt());
+      if (isAtomic()) {
+        Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, LiveOut,
+                                AtomicOrdering::Monotonic);
+      } else {
+        Value *Old = Builder.CreateLoad(Addr, "pgocount");
+        Builder.CreateStore(Builder.CreateAdd(Old, LiveOut), Addr);
+      }
+    }
+    ++NumPromotedCounters;
+  }
+
+  // The updates that stay in memory are made atomic when requested.
+  if (isAtomic())
+    for (const LoadStorePair &Cand : PromotionCandidates) {
+      if (Promoted.count(Cand.first))
+        continue;
+      IRBuilder<> Builder(Cand.second);
+      auto *Add = cast<BinaryOperator>(Cand.second->getValueOperand());
+      Builder.CreateAtomicRMW(AtomicRMWInst::Add,
+                              Cand.second->getPointerOperand(),
+                              Add->getOperand(1), AtomicOrdering::Monotonic);
+      Cand.second->eraseFromParent();
+      Add->eraseFromParent();
+      Cand.first->eraseFromParent();
+    }
+  PromotionCandidates.clear();
 }
 
 void InstrProfiling::lowerCoverageData(GlobalVariable *CoverageNamesVar) {
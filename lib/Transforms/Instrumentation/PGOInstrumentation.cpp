@@ -90,6 +90,7 @@ STATISTIC(NumOfPGOFunc, "Number of functions having valid profile counts.");
 STATISTIC(NumOfPGOMismatch, "Number of functions having mismatch profile.");
 STATISTIC(NumOfPGOMissing, "Number of functions without profile.");
 STATISTIC(NumOfPGOICall, "Number of indirect call value instrumentations.");
+STATISTIC(NumOfPGOMemOPSize, "Number of memop size value instrumentations.");
 
 // Command line option to specify the file to read profile from. This is
 // mainly used for testing.
@@ -112,6 +113,19 @@ static cl::opt<unsigned> MaxNumAnnotations(
     cl::desc("Max number of annotations for a single indirect "
              "call callsite"));
 
+// Command line option to disable the profiling of the lengths of memory
+// intrinsics. The default is false: they are profiled along with the indirect
+// calls.
+static cl::opt<bool> DisableMemOPSizeProfiling(
+    "disable-memop-size-vp", cl::init(false), cl::Hidden,
+    cl::desc("Disable the value profiling of memory intrinsic lengths"));
+
+// Command line option to set the maximum number of VP annotations to write to
+// the metadata for a single memory intrinsic.
+static cl::opt<unsigned> MaxNumMemOPAnnotations(
+    "memop-max-annotations", cl::init(4), cl::Hidden, cl::ZeroOrMore,
+    cl::desc("Max number of annotations for a single memory intrinsic"));
+
 // Command line option to enable/disable the warning about missing profile
 // information.
 static cl::opt<bool> NoPGOWarnMissing("no-pgo-warn-missing", cl::init(false),
@@ -338,6 +352,17 @@ BasicBlock *FuncPGOInstrumentation<Edge, BBInfo>::getInstrBB(Edge *E) {
   return InstrBB;
 }
 
+// Return the memory intrinsics of F whose length is not a constant, in the
+// order that their value sites are numbered.
+static std::vector<MemIntrinsic *> findMemOPSites(Function &F) {
+  std::vector<MemIntrinsic *> Sites;
+  for (Instruction &I : instructions(F))
+    if (auto *MI = dyn_cast<MemIntrinsic>(&I))
+      if (!isa<ConstantInt>(MI->getLength()))
+        Sites.push_back(MI);
+  return Sites;
+}
+
 // Visit all edge and instrument the edges not in MST, and do value profiling.
 // Critical edges will be split.
 static void instrumentOneFunc(Function &F, Module *M,
@@ -388,6 +413,24 @@ static void instrumentOneFunc(Function &F, Module *M,
          Builder.getInt32(NumIndirectCallSites++)});
   }
   NumOfPGOICall += NumIndirectCallSites;
+
+  if (DisableMemOPSizeProfiling)
+    return;
+
+  unsigned NumMemOPSites = 0;
+  for (MemIntrinsic *MI : findMemOPSites(F)) {
+    DEBUG(dbgs() << "Instrument one memop size: Site Index = "
+                 << NumMemOPSites << "\n");
+    IRBuilder<> Builder(MI);
+    Builder.CreateCall(
+        Intrinsic::getDeclaration(M, Intrinsic::instrprof_value_profile),
+        {llvm::ConstantExpr::getBitCast(FuncInfo.FuncNameVar, I8PtrTy),
+         Builder.getInt64(FuncInfo.FunctionHash),
+         Builder.CreateZExtOrTrunc(MI->getLength(), Builder.getInt64Ty()),
+         Builder.getInt32(llvm::InstrProfValueKind::IPVK_MemOPSize),
+         Builder.getInt32(NumMemOPSites++)});
+  }
+  NumOfPGOMemOPSize += NumMemOPSites;
 }
 
 // This class represents a CFG edge in profile use compilation.
@@ -473,6 +516,9 @@ public:
   // Annotate the indirect call sites.
   void annotateIndirectCallSites();
 
+  // Annotate the memory intrinsics with the profile of their lengths.
+  void annotateMemOPSizes();
+
   // The hotness of the function from the profile count.
   enum FuncFreqAttr { FFA_Normal, FFA_Cold, FFA_Hot };
 
@@ -782,6 +828,31 @@ void PGOUseFunc::annotateIndirectCallSites() {
     IndirectCallSiteIndex++;
   }
 }
+
+// Traverse all the memory intrinsics with a variable length and annotate them.
+void PGOUseFunc::annotateMemOPSizes() {
+  if (DisableValueProfiling || DisableMemOPSizeProfiling)
+    return;
+
+  auto MemOPSites = findMemOPSites(F);
+  unsigned NumValueSites = ProfileRecord.getNumValueSites(IPVK_MemOPSize);
+  if (NumValueSites != MemOPSites.size()) {
+    // Profiles that predate memop size profiling have no sites at all.
+    if (NumValueSites == 0)
+      return;
+    std::string Msg =
+        std::string("Inconsistent number of memop size sites: ") +
+        F.getName().str();
+    auto &Ctx = M->getContext();
+    Ctx.diagnose(
+        DiagnosticInfoPGOProfile(M->getName().data(), Msg, DS_Warning));
+    return;
+  }
+
+  for (unsigned I = 0, E = MemOPSites.size(); I != E; ++I)
+    annotateValueSite(*M, *MemOPSites[I], ProfileRecord, IPVK_MemOPSize, I,
+                      MaxNumMemOPAnnotations);
+}
 } // end anonymous namespace
 
 // Create a COMDAT variable IR_LEVEL_PROF_VARNAME to make the runtime
@@ -891,6 +962,7 @@ static bool annotateAllFunctions(
     Func.populateCounters();
     Func.setBranchWeights();
     Func.annotateIndirectCallSites();
+    Func.annotateMemOPSizes();
     if (!Func.getProfileRecord().Counts.empty())
       Builder.addRecord(Func.getProfileRecord());
     PGOUseFunc::FuncFreqAttr FreqAttr = Func.getFuncFreqAttr();
@@ -0,0 +1,214 @@
+//===-- PGOMemOPSizeOpt.cpp - Optimizations based on value profiling ------===//
+//
+//                      The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the transformation that versions the memory intrinsic
+// calls (memcpy, memmove and memset) on their most frequent lengths, when the
+// memop size value profile metadata is available. The versions get a constant
+// length, which the backend can expand into straight-line code:
+//
+//   switch (Size)          // with the branch weights of the profile
+//     case 8:  memcpy(Dst, Src, 8); break;
+//     case 16: memcpy(Dst, Src, 16); break;
+//     default: memcpy(Dst, Src, Size);
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/ProfileData/InstrProf.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Instrumentation.h"
+#include "llvm/Transforms/PGOInstrumentation.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include <vector>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "pgo-memop-opt"
+
+STATISTIC(NumOfPGOMemOPOpt, "Number of memop intrinsics specialized.");
+STATISTIC(NumOfPGOMemOPAnnotate, "Number of memop intrinsics annotated.");
+
+// Command line option to disable the optimization. This is for debug purpose.
+static cl::opt<bool> DisableMemOPOpt("disable-memop-opt", cl::init(false),
+                                     cl::Hidden,
+                                     cl::desc("Disable the memop size "
+                                              "optimization"));
+
+// The minimum count of a length for the intrinsic to be versioned on it.
+static cl::opt<unsigned>
+    MemOPCountThreshold("pgo-memop-count-threshold", cl::Hidden,
+                        cl::ZeroOrMore, cl::init(1000),
+                        cl::desc("The minimum count to optimize memory "
+                                 "intrinsic calls"));
+
+// The minimum percentage of the calls of the intrinsic that a length must
+// account for to be versioned on.
+static cl::opt<unsigned>
+    MemOPPercentThreshold("pgo-memop-percent-threshold", cl::init(40),
+                          cl::Hidden, cl::ZeroOrMore,
+                          cl::desc("The percentage threshold for the memory "
+                                   "intrinsic calls optimization"));
+
+// The maximum number of lengths that a single intrinsic is versioned on.
+static cl::opt<unsigned>
+    MemOPMaxVersion("pgo-memop-max-version", cl::init(3), cl::Hidden,
+                    cl::ZeroOrMore,
+                    cl::desc("The max version for the optimized memory "
+                             "intrinsic calls"));
+
+namespace {
+class PGOMemOPSizeOptLegacyPass : public FunctionPass {
+public:
+  static char ID;
+
+  PGOMemOPSizeOptLegacyPass() : FunctionPass(ID) {
+    initializePGOMemOPSizeOptLegacyPassPass(*PassRegistry::getPassRegistry());
+  }
+
+  const char *getPassName() const override { return "PGOMemOPSize"; }
+
+private:
+  bool runOnFunction(Function &F) override;
+};
+} // end anonymous namespace
+
+char PGOMemOPSizeOptLegacyPass::ID = 0;
+INITIALIZE_PASS(PGOMemOPSizeOptLegacyPass, "pgo-memop-opt",
+                "Optimize memory intrinsic using its size value profile",
+                false, false)
+
+FunctionPass *llvm::createPGOMemOPSizeOptLegacyPass() {
+  return new PGOMemOPSizeOptLegacyPass();
+}
+
+// Version MI on the lengths of the profile that pass the thresholds. Return
+// true if MI was versioned.
+static bool versionMemOP(Function &F, MemIntrinsic *MI) {
+  uint32_t MaxNumVals = MemOPMaxVersion + 1;
+  std::vector<InstrProfValueData> ValueData(MaxNumVals);
+  uint32_t NumVals;
+  uint64_t TotalCount;
+  if (!getValueProfDataFromInst(*MI, IPVK_MemOPSize, MaxNumVals,
+                                ValueData.data(), NumVals, TotalCount))
+    return false;
+  ++NumOfPGOMemOPAnnotate;
+
+  // The values are sorted by decreasing count.
+  auto *LengthTy = cast<IntegerType>(MI->getLength()->getType());
+  SmallVector<uint64_t, 4> Sizes;
+  SmallVector<uint64_t, 4> Counts;
+  uint64_t RemainCount = TotalCount;
+  for (uint32_t I = 0; I < NumVals && Sizes.size() < MemOPMaxVersion; ++I) {
+    const InstrProfValueData &VD = ValueData[I];
+    if (VD.Count < MemOPCountThreshold ||
+        VD.Count * 100 < MemOPPercentThreshold * TotalCount)
+      break;
+    // A length that does not fit the type of the operand was not profiled
+    // from this call.
+    if (!isUIntN(LengthTy->getBitWidth(), VD.Value))
+      break;
+    Sizes.push_back(VD.Value);
+    Counts.push_back(VD.Count);
+    RemainCount -= std::min(VD.Count, RemainCount);
+  }
+  if (Sizes.empty())
+    return false;
+
+  DEBUG(dbgs() << "Versioning memop " << *MI << " on " << Sizes.size()
+               << " sizes\n");
+
+  // Split the block around MI, which becomes the default case of a switch on
+  // its length.
+  BasicBlock *BB = MI->getParent();
+  BasicBlock *DefaultBB = SplitBlock(BB, MI);
+  BasicBlock::iterator Next(MI);
+  ++Next;
+  BasicBlock *MergeBB = SplitBlock(DefaultBB, &*Next);
+  DefaultBB->setName("MemOP.Default");
+  MergeBB->setName("MemOP.Merge");
+
+  LLVMContext &Ctx = F.getContext();
+  BB->getTerminator()->eraseFromParent();
+  IRBuilder<> IRB(BB);
+  SwitchInst *SI = IRB.CreateSwitch(MI->getLength(), DefaultBB, Sizes.size());
+  for (unsigned I = 0, E = Sizes.size(); I != E; ++I) {
+    BasicBlock *CaseBB = BasicBlock::Create(
+        Ctx, Twine("MemOP.Case.") + Twine(Sizes[I]), &F, MergeBB);
+    auto *C = cast<MemIntrinsic>(MI->clone());
+    C->setLength(ConstantInt::get(LengthTy, Sizes[I]));
+    C->setMetadata(LLVMContext::MD_prof, nullptr);
+    CaseBB->getInstList().push_back(C);
+    BranchInst::Create(MergeBB, CaseBB);
+    SI->addCase(ConstantInt::get(LengthTy, Sizes[I]), CaseBB);
+  }
+
+  // The default case keeps the lengths that were not versioned on.
+  MI->setMetadata(LLVMContext::MD_prof, nullptr);
+  ArrayRef<InstrProfValueData> Remaining(ValueData.data(), NumVals);
+  Remaining = Remaining.slice(Sizes.size());
+  if (!Remaining.empty() && RemainCount)
+    annotateValueSite(*F.getParent(), *MI, Remaining, RemainCount,
+                      IPVK_MemOPSize, NumVals);
+
+  uint64_t MaxCount = RemainCount;
+  for (uint64_t Count : Counts)
+    MaxCount = std::max(MaxCount, Count);
+  uint64_t Scale = calculateCountScale(MaxCount);
+  SmallVector<uint32_t, 4> Weights;
+  Weights.push_back(scaleBranchCount(RemainCount, Scale));
+  for (uint64_t Count : Counts)
+    Weights.push_back(scaleBranchCount(Count, Scale));
+  SI->setMetadata(LLVMContext::MD_prof,
+                  MDBuilder(Ctx).createBranchWeights(Weights));
+
+  emitOptimizationRemark(Ctx, DEBUG_TYPE, F, MI->getDebugLoc(),
+                         Twine("optimized ") +
+                             MI->getCalledFunction()->getName() + " with " +
+                             Twine(Sizes.size()) + " constant lengths");
+  ++NumOfPGOMemOPOpt;
+  return true;
+}
+
+static bool PGOMemOPSizeOptImpl(Function &F) {
+  if (DisableMemOPOpt || F.optForSize())
+    return false;
+
+  // Collect the candidates first, as versioning changes the CFG.
+  std::vector<MemIntrinsic *> WorkList;
+  for (Instruction &I : instructions(F))
+    if (auto *MI = dyn_cast<MemIntrinsic>(&I))
+      if (!isa<ConstantInt>(MI->getLength()))
+        WorkList.push_back(MI);
+
+  bool Changed = false;
+  for (MemIntrinsic *MI : WorkList)
+    Changed |= versionMemOP(F, MI);
+  return Changed;
+}
+
+bool PGOMemOPSizeOptLegacyPass::runOnFunction(Function &F) {
+  if (skipFunction(F))
+    return false;
+  return PGOMemOPSizeOptImpl(F);
+}
+
+PreservedAnalyses PGOMemOPSizeOpt::run(Function &F,
+                                       AnalysisManager<Function> &FAM) {
+  if (!PGOMemOPSizeOptImpl(F))
+    return PreservedAnalyses::all();
+  return PreservedAnalyses::none();
+}
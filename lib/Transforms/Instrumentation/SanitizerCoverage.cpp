@@ -26,10 +26,18 @@
 // it only tells if a given function (block) was ever executed. No counters.
 // But for many use cases this is what we need and the added slowdown small.
 //
+// With inline 8-bit counters, every function instead gets an array of 8-bit
+// counters in the __sancov_cntrs section, one per instrumented block, which
+// the block increments without calling out to the run-time. The module
+// constructor passes the bounds of the section to
+// __sanitizer_cov_8bit_counters_init, and the fuzzer reads the counters from
+// there.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/EHPersonalities.h"
 #include "llvm/Analysis/PostDominators.h"
 #include "llvm/IR/CFG.h"
@@ -70,6 +78,9 @@ static const char *const SanCovTracePCName = "__sanitizer_cov_trace_pc";
 static const char *const SanCovTraceCmpName = "__sanitizer_cov_trace_cmp";
 static const char *const SanCovTraceSwitchName = "__sanitizer_cov_trace_switch";
 static const char *const SanCovModuleCtorName = "sancov.module_ctor";
+static const char *const SanCov8bitCountersInitName =
+    "__sanitizer_cov_8bit_counters_init";
+static const char *const SanCovCountersSectionName = "__sancov_cntrs";
 static const uint64_t SanCtorAndDtorPriority = 2;
 
 static cl::opt<int> ClCoverageLevel(
@@ -116,6 +127,14 @@ static cl::opt<bool> ClUse8bitCounters("sanitizer-coverage-8bit-counters",
                                        cl::desc("Experimental 8-bit counters"),
                                        cl::Hidden, cl::init(false));
 
+// 8-bit counters that are incremented inline instead of the guard callbacks.
+// The counter updates are racy as well, and the counters wrap around.
+static cl::opt<bool> ClInline8bitCounters(
+    "sanitizer-coverage-inline-8bit-counters",
+    cl::desc("Increment 8-bit counters in a section instead of calling "
+             "the coverage callbacks"),
+    cl::Hidden, cl::init(false));
+
 namespace {
 
 SanitizerCoverageOptions getOptions(int LegacyCoverageLevel) {
@@ -150,6 +169,7 @@ SanitizerCoverageOptions OverrideFromCL(SanitizerCoverageOptions Options) {
   Options.TraceCmp |= ClExperimentalCMPTracing;
   Options.Use8bitCounters |= ClUse8bitCounters;
   Options.TracePC |= ClExperimentalTracePC;
+  Options.Inline8bitCounters |= ClInline8bitCounters;
   return Options;
 }
 
@@ -178,7 +198,10 @@ private:
                             ArrayRef<Instruction *> SwitchTraceTargets);
   bool InjectCoverage(Function &F, ArrayRef<BasicBlock *> AllBlocks);
   void SetNoSanitizeMetadata(Instruction *I);
-  void InjectCoverageAtBlock(Function &F, BasicBlock &BB, bool UseCalls);
+  void InjectCoverageAtBlock(Function &F, BasicBlock &BB, size_t Idx,
+                             bool UseCalls);
+  GlobalVariable *CreateFunctionLocalCounters(Function &F, size_t NumCounters);
+  void CreateInline8bitCountersCtor(Module &M);
   unsigned NumberOfInstrumentedBlocks() {
     return SanCovFunction->getNumUses() +
            SanCovWithCheckFunction->getNumUses() + SanCovTraceBB->getNumUses() +
@@ -198,6 +221,10 @@ private:
 
   GlobalVariable *GuardArray;
   GlobalVariable *EightBitCounterArray;
+  // The inline 8-bit counters of the function being instrumented.
+  GlobalVariable *FunctionCounters;
+  bool HasInline8bitCounters;
+  Triple TargetTriple;
 
   SanitizerCoverageOptions Options;
 };
@@ -210,6 +237,13 @@ bool SanitizerCoverageModule::runOnModule(Module &M) {
   C = &(M.getContext());
   DL = &M.getDataLayout();
   CurModule = &M;
+  TargetTriple = Triple(M.getTargetTriple());
+  // The run-time finds the counters through the bounds of their section,
+  // which only the ELF and Mach-O linkers provide.
+  if (!TargetTriple.isOSBinFormatELF() && !TargetTriple.isOSBinFormatMachO())
+    Options.Inline8bitCounters = false;
+  FunctionCounters = nullptr;
+  HasInline8bitCounters = false;
   IntptrTy = Type::getIntNTy(*C, DL->getPointerSizeInBits());
   Type *VoidTy = Type::getVoidTy(*C);
   IRBuilder<> IRB(*C);
@@ -297,7 +331,10 @@ bool SanitizerCoverageModule::runOnModule(Module &M) {
       new GlobalVariable(M, ModNameStrConst->getType(), true,
                          GlobalValue::PrivateLinkage, ModNameStrConst);
 
-  if (!Options.TracePC) {
+  if (Options.Inline8bitCounters) {
+    if (HasInline8bitCounters)
+      CreateInline8bitCountersCtor(M);
+  } else if (!Options.TracePC) {
     Function *CtorFunc;
     std::tie(CtorFunc, std::ignore) = createSanitizerCtorAndInitFunctions(
         M, SanCovModuleCtorName, SanCovModuleInitName,
@@ -315,6 +352,65 @@ bool SanitizerCoverageModule::runOnModule(Module &M) {
   return true;
 }
 
+static std::string getSectionName(const Triple &TargetTriple,
+                                  StringRef Section) {
+  if (TargetTriple.isOSBinFormatMachO())
+    return ("__DATA," + Section).str();
+  return Section;
+}
+
+// The symbols that the linker defines at the bounds of the section.
+static std::string getSectionStart(const Triple &TargetTriple,
+                                   StringRef Section) {
+  if (TargetTriple.isOSBinFormatMachO())
+    return ("\1section$start$__DATA$" + Section).str();
+  return ("__start_" + Section).str();
+}
+
+static std::string getSectionEnd(const Triple &TargetTriple,
+                                 StringRef Section) {
+  if (TargetTriple.isOSBinFormatMachO())
+    return ("\1section$end$__DATA$" + Section).str();
+  return ("__stop_" + Section).str();
+}
+
+GlobalVariable *
+SanitizerCoverageModule::CreateFunctionLocalCounters(Function &F,
+                                                     size_t NumCounters) {
+  ArrayType *ArrayTy = ArrayType::get(Type::getInt8Ty(*C), NumCounters);
+  auto *Array = new GlobalVariable(
+      *CurModule, ArrayTy, false, GlobalVariable::PrivateLinkage,
+      Constant::getNullValue(ArrayTy), "__sancov_gen_cov_counters");
+  // The counters go away with the function when the linker drops its comdat.
+  if (TargetTriple.supportsCOMDAT())
+    if (Comdat *FC = F.getComdat())
+      Array->setComdat(FC);
+  Array->setSection(getSectionName(TargetTriple, SanCovCountersSectionName));
+  HasInline8bitCounters = true;
+  return Array;
+}
+
+// Register the counters of all the modules that the linker merges into the
+// section with the run-time, which may see the same bounds more than once.
+void SanitizerCoverageModule::CreateInline8bitCountersCtor(Module &M) {
+  Type *Int8Ty = Type::getInt8Ty(*C);
+  Type *Int8PtrTy = Type::getInt8PtrTy(*C);
+  auto *SecStart = new GlobalVariable(
+      M, Int8Ty, false, GlobalVariable::ExternalWeakLinkage, nullptr,
+      getSectionStart(TargetTriple, SanCovCountersSectionName));
+  SecStart->setVisibility(GlobalValue::HiddenVisibility);
+  auto *SecEnd = new GlobalVariable(
+      M, Int8Ty, false, GlobalVariable::ExternalWeakLinkage, nullptr,
+      getSectionEnd(TargetTriple, SanCovCountersSectionName));
+  SecEnd->setVisibility(GlobalValue::HiddenVisibility);
+
+  Function *CtorFunc;
+  std::tie(CtorFunc, std::ignore) = createSanitizerCtorAndInitFunctions(
+      M, SanCovModuleCtorName, SanCov8bitCountersInitName,
+      {Int8PtrTy, Int8PtrTy}, {SecStart, SecEnd});
+  appendToGlobalCtors(M, CtorFunc, SanCtorAndDtorPriority);
+}
+
 // True if block has successors and it dominates all of them.
 static bool isFullDominator(const BasicBlock *BB, const DominatorTree *DT) {
   if (succ_begin(BB) == succ_end(BB))
@@ -404,12 +500,16 @@ bool SanitizerCoverageModule::InjectCoverage(Function &F,
   case SanitizerCoverageOptions::SCK_None:
     return false;
   case SanitizerCoverageOptions::SCK_Function:
-    InjectCoverageAtBlock(F, F.getEntryBlock(), false);
+    if (Options.Inline8bitCounters)
+      FunctionCounters = CreateFunctionLocalCounters(F, 1);
+    InjectCoverageAtBlock(F, F.getEntryBlock(), 0, false);
     return true;
   default: {
+    if (Options.Inline8bitCounters)
+      FunctionCounters = CreateFunctionLocalCounters(F, AllBlocks.size());
     bool UseCalls = ClCoverageBlockThreshold < AllBlocks.size();
-    for (auto BB : AllBlocks)
-      InjectCoverageAtBlock(F, *BB, UseCalls);
+    for (size_t i = 0, N = AllBlocks.size(); i < N; i++)
+      InjectCoverageAtBlock(F, *AllBlocks[i], i, UseCalls);
     return true;
   }
   }
@@ -513,6 +613,7 @@ void SanitizerCoverageModule::SetNoSanitizeMetadata(Instruction *I) {
 }
 
 void SanitizerCoverageModule::InjectCoverageAtBlock(Function &F, BasicBlock &BB,
+                                                    size_t Idx,
                                                     bool UseCalls) {
   // Don't insert coverage for unreachable blocks: we will never call
   // __sanitizer_cov() for them, so counting them in
@@ -538,6 +639,15 @@ void SanitizerCoverageModule::InjectCoverageAtBlock(Function &F, BasicBlock &BB,
 
   IRBuilder<> IRB(&*IP);
   IRB.SetCurrentDebugLocation(EntryLoc);
+  if (Options.Inline8bitCounters) {
+    Value *P = IRB.CreateConstInBoundsGEP2_64(FunctionCounters, 0, Idx);
+    LoadInst *Load = IRB.CreateLoad(P);
+    Value *Inc = IRB.CreateAdd(Load, ConstantInt::get(IRB.getInt8Ty(), 1));
+    StoreInst *Store = IRB.CreateStore(Inc, P);
+    SetNoSanitizeMetadata(Load);
+    SetNoSanitizeMetadata(Store);
+    return;
+  }
   Value *GuardP = IRB.CreateAdd(
       IRB.CreatePointerCast(GuardArray, IntptrTy),
       ConstantInt::get(IntptrTy, (1 + NumberOfInstrumentedBlocks()) * 4));
@@ -20,6 +20,8 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Transforms/Instrumentation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
@@ -28,6 +30,7 @@
 #include "llvm/Analysis/CaptureTracking.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -60,6 +63,14 @@ static cl::opt<bool>  ClInstrumentAtomics(
 static cl::opt<bool>  ClInstrumentMemIntrinsics(
     "tsan-instrument-memintrinsics", cl::init(true),
     cl::desc("Instrument memintrinsics (memset/memcpy/memmove)"), cl::Hidden);
+static cl::opt<bool>  ClOmitReadOnlyGlobals(
+    "tsan-omit-readonly-globals", cl::init(true),
+    cl::desc("Do not instrument reads from internal globals that are never "
+             "written"), cl::Hidden);
+static cl::opt<bool>  ClOmitBeforeCapture(
+    "tsan-omit-before-capture", cl::init(false),
+    cl::desc("Do not instrument accesses to a local variable that happen "
+             "before its address escapes"), cl::Hidden);
 
 STATISTIC(NumInstrumentedReads, "Number of instrumented reads");
 STATISTIC(NumInstrumentedWrites, "Number of instrumented writes");
@@ -70,8 +81,12 @@ STATISTIC(NumInstrumentedVtableWrites, "Number of vtable ptr writes");
 STATISTIC(NumInstrumentedVtableReads, "Number of vtable ptr reads");
 STATISTIC(NumOmittedReadsFromConstantGlobals,
           "Number of reads from constant globals");
+STATISTIC(NumOmittedReadsFromReadOnlyGlobals,
+          "Number of reads from globals that are never written");
 STATISTIC(NumOmittedReadsFromVtable, "Number of vtable reads");
 STATISTIC(NumOmittedNonCaptured, "Number of accesses ignored due to capturing");
+STATISTIC(NumOmittedBeforeCapture,
+          "Number of accesses ignored as they happen before capturing");
 
 static const char *const kTsanModuleCtorName = "tsan.module_ctor";
 static const char *const kTsanInitName = "__tsan_init";
@@ -84,10 +99,13 @@ struct ThreadSanitizer : public FunctionPass {
   const char *getPassName() const override;
   bool runOnFunction(Function &F) override;
   bool doInitialization(Module &M) override;
+  void getAnalysisUsage(AnalysisUsage &AU) const override;
   static char ID;  // Pass identification, replacement for typeid.
 
  private:
   void initializeCallbacks(Module &M);
+  void findReadOnlyGlobals(Module &M);
+  bool isThreadLocalObject(Value *Obj, Instruction *I);
   bool instrumentLoadOrStore(Instruction *I, const DataLayout &DL);
   bool instrumentAtomic(Instruction *I, const DataLayout &DL);
   bool instrumentMemIntrinsic(Instruction *I);
@@ -118,11 +136,20 @@ struct ThreadSanitizer : public FunctionPass {
   Function *TsanVptrLoad;
   Function *MemmoveFn, *MemcpyFn, *MemsetFn;
   Function *TsanCtorFunction;
+  // Internal globals that are only ever read, found in doInitialization.
+  SmallPtrSet<const GlobalVariable *, 16> ReadOnlyGlobals;
+  // Whether the allocas of the current function may be captured.
+  DenseMap<const Value *, bool> MayBeCaptured;
+  DominatorTree *DT;
 };
 }  // namespace
 
 char ThreadSanitizer::ID = 0;
-INITIALIZE_PASS(ThreadSanitizer, "tsan",
+INITIALIZE_PASS_BEGIN(ThreadSanitizer, "tsan",
+    "ThreadSanitizer: detects data races.",
+    false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_END(ThreadSanitizer, "tsan",
     "ThreadSanitizer: detects data races.",
     false, false)
 
@@ -134,6 +161,11 @@ FunctionPass *llvm::createThreadSanitizerPass() {
   return new ThreadSanitizer();
 }
 
+void ThreadSanitizer::getAnalysisUsage(AnalysisUsage &AU) const {
+  if (ClOmitBeforeCapture)
+    AU.addRequired<DominatorTreeWrapperPass>();
+}
+
 void ThreadSanitizer::initializeCallbacks(Module &M) {
   IRBuilder<> IRB(M.getContext());
   // Initialize the callbacks.
@@ -235,9 +267,47 @@ bool ThreadSanitizer::doInitialization(Module &M) {
 
   appendToGlobalCtors(M, TsanCtorFunction, 0);
 
+  if (ClOmitReadOnlyGlobals)
+    findReadOnlyGlobals(M);
+  return true;
+}
+
+// Return true if all the uses of V only read the memory it points to.
+static bool onlyReadThrough(const Value *V) {
+  for (const User *U : V->users()) {
+    if (const LoadInst *L = dyn_cast<LoadInst>(U)) {
+      if (L->isVolatile())
+        return false;
+    } else if (isa<GetElementPtrInst>(U) || isa<BitCastInst>(U) ||
+               (isa<ConstantExpr>(U) &&
+                (cast<ConstantExpr>(U)->getOpcode() ==
+                     Instruction::GetElementPtr ||
+                 cast<ConstantExpr>(U)->getOpcode() == Instruction::BitCast))) {
+      if (!onlyReadThrough(U))
+        return false;
+    } else {
+      // Stores, calls, comparisons and the like may write the global or let
+      // its address escape.
+      return false;
+    }
+  }
   return true;
 }
 
+// A global that is never written after its static initialization cannot
+// race. The linkage must be local, so that no code outside of the module can
+// write it.
+void ThreadSanitizer::findReadOnlyGlobals(Module &M) {
+  ReadOnlyGlobals.clear();
+  for (GlobalVariable &GV : M.globals()) {
+    if (GV.isConstant() || !GV.hasLocalLinkage() || !GV.hasInitializer() ||
+        GV.isThreadLocal())
+      continue;
+    if (onlyReadThrough(&GV))
+      ReadOnlyGlobals.insert(&GV);
+  }
+}
+
 static bool isVtableAccess(Instruction *I) {
   if (MDNode *Tag = I->getMetadata(LLVMContext::MD_tbaa))
     return Tag->isTBAAVtableAccess();
@@ -267,12 +337,18 @@ bool ThreadSanitizer::addrPointsToConstantData(Value *Addr) {
   if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Addr))
     Addr = GEP->getPointerOperand();
 
-  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Addr)) {
+  if (GlobalVariable *GV =
+          dyn_cast<GlobalVariable>(Addr->stripInBoundsOffsets())) {
     if (GV->isConstant()) {
       // Reads from constant globals can not race with any writes.
       NumOmittedReadsFromConstantGlobals++;
       return true;
     }
+    if (ReadOnlyGlobals.count(GV)) {
+      // Nothing ever writes this global after it is initialized.
+      NumOmittedReadsFromReadOnlyGlobals++;
+      return true;
+    }
   } else if (LoadInst *L = dyn_cast<LoadInst>(Addr)) {
     if (isVtableAccess(L)) {
       // Reads from a vtable pointer can not race with any writes.
@@ -283,10 +359,43 @@ bool ThreadSanitizer::addrPointsToConstantData(Value *Addr) {
   return false;
 }
 
+// Return true if the local variable Obj cannot be accessed by another thread
+// when I runs.
+bool ThreadSanitizer::isThreadLocalObject(Value *Obj, Instruction *I) {
+  auto It = MayBeCaptured.find(Obj);
+  if (It == MayBeCaptured.end())
+    It = MayBeCaptured
+             .insert(std::make_pair(
+                 Obj, PointerMayBeCaptured(Obj, /*ReturnCaptures=*/true,
+                                           /*StoreCaptures=*/true)))
+             .first;
+  if (!It->second) {
+    // The variable is addressable but not captured, so it cannot be
+    // referenced from a different thread and participate in a data race
+    // (see llvm/Analysis/CaptureTracking.h for details).
+    NumOmittedNonCaptured++;
+    return true;
+  }
+  // Until its address escapes, no other thread can reach the variable. The
+  // escape itself must be synchronized for another thread to use the
+  // address, which orders the accesses before it. With relaxed atomics this
+  // does not hold, hence the option.
+  if (ClOmitBeforeCapture &&
+      !PointerMayBeCapturedBefore(Obj, /*ReturnCaptures=*/true,
+                                  /*StoreCaptures=*/true, I, DT,
+                                  /*IncludeI=*/true)) {
+    NumOmittedBeforeCapture++;
+    return true;
+  }
+  return false;
+}
+
 // Instrumenting some of the accesses may be proven redundant.
 // Currently handled:
 //  - read-before-write (within same BB, no calls between)
 //  - not captured variables
+//  - reads from globals that are never written
+//  - accesses before the variable is captured (-tsan-omit-before-capture)
 //
 // We do not handle some of the patterns that should not survive
 // after the classic compiler optimizations.
@@ -326,14 +435,11 @@ void ThreadSanitizer::chooseInstructionsToInstrument(
     Value *Addr = isa<StoreInst>(*I)
         ? cast<StoreInst>(I)->getPointerOperand()
         : cast<LoadInst>(I)->getPointerOperand();
-    if (isa<AllocaInst>(GetUnderlyingObject(Addr, DL)) &&
-        !PointerMayBeCaptured(Addr, true, true)) {
-      // The variable is addressable but not captured, so it cannot be
-      // referenced from a different thread and participate in a data race
-      // (see llvm/Analysis/CaptureTracking.h for details).
-      NumOmittedNonCaptured++;
+    // The whole variable has to be analyzed, as its address may escape
+    // through another pointer than Addr.
+    Value *Obj = GetUnderlyingObject(Addr, DL);
+    if (isa<AllocaInst>(Obj) && isThreadLocalObject(Obj, I))
       continue;
-    }
     All.push_back(I);
   }
   Local.clear();
@@ -359,6 +465,10 @@ bool ThreadSanitizer::runOnFunction(Function &F) {
   if (&F == TsanCtorFunction)
     return false;
   initializeCallbacks(*F.getParent());
+  MayBeCaptured.clear();
+  DT = ClOmitBeforeCapture
+           ? &getAnalysis<DominatorTreeWrapperPass>().getDomTree()
+           : nullptr;
   SmallVector<Instruction*, 8> RetVec;
   SmallVector<Instruction*, 8> AllLoadsAndStores;
   SmallVector<Instruction*, 8> LocalLoadsAndStores;
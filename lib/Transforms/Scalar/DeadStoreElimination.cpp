@@ -34,10 +34,12 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 using namespace llvm;
 
 #define DEBUG_TYPE "dse"
@@ -46,6 +48,16 @@ STATISTIC(NumRedundantStores, "Number of redundant stores deleted");
 STATISTIC(NumFastStores, "Number of stores deleted");
 STATISTIC(NumFastOther , "Number of other instrs removed");
 
+static cl::opt<bool> EnableMemorySSA(
+    "dse-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Use MemorySSA rather than MemoryDependenceAnalysis to find "
+             "the writes that a store overwrites"));
+
+static cl::opt<unsigned> MemorySSAScanLimit(
+    "dse-memoryssa-scan-limit", cl::init(100), cl::Hidden,
+    cl::desc("The number of memory accesses to look through for the write "
+             "that a store overwrites when using MemorySSA (default = 100)"));
+
 
 //===----------------------------------------------------------------------===//
 // Helper functions
@@ -57,7 +69,7 @@ STATISTIC(NumFastOther , "Number of other instrs removed");
 /// If ValueSet is non-null, remove any deleted instructions from it as well.
 static void
 deleteDeadInstruction(Instruction *I, MemoryDependenceResults &MD,
-                      const TargetLibraryInfo &TLI,
+                      MemorySSA *MSSA, const TargetLibraryInfo &TLI,
                       SmallSetVector<Value *, 16> *ValueSet = nullptr) {
   SmallVector<Instruction*, 32> NowDeadInsts;
 
@@ -73,6 +85,9 @@ deleteDeadInstruction(Instruction *I, MemoryDependenceResults &MD,
     // MemDep, which needs to know the operands and needs it to be in the
     // function.
     MD.removeInstruction(DeadInst);
+    if (MSSA)
+      if (MemoryAccess *MA = MSSA->getMemoryAccess(DeadInst))
+        MSSA->removeMemoryAccess(MA);
 
     for (unsigned op = 0, e = DeadInst->getNumOperands(); op != e; ++op) {
       Value *Op = DeadInst->getOperand(op);
@@ -515,8 +530,8 @@ static void findUnconditionalPreds(SmallVectorImpl<BasicBlock *> &Blocks,
 /// Handle frees of entire structures whose dependency is a store
 /// to a field of that structure.
 static bool handleFree(CallInst *F, AliasAnalysis *AA,
-                       MemoryDependenceResults *MD, DominatorTree *DT,
-                       const TargetLibraryInfo *TLI) {
+                       MemoryDependenceResults *MD, MemorySSA *MSSA,
+                       DominatorTree *DT, const TargetLibraryInfo *TLI) {
   bool MadeChange = false;
 
   MemoryLocation Loc = MemoryLocation(F->getOperand(0));
@@ -546,7 +561,7 @@ static bool handleFree(CallInst *F, AliasAnalysis *AA,
       auto Next = ++Dependency->getIterator();
 
       // DCE instructions only used to calculate that store
-      deleteDeadInstruction(Dependency, *MD, *TLI);
+      deleteDeadInstruction(Dependency, *MD, MSSA, *TLI);
       ++NumFastStores;
       MadeChange = true;
 
@@ -600,7 +615,7 @@ static void removeAccessedObjects(const MemoryLocation &LoadedLoc,
 /// store i32 1, i32* %A
 /// ret void
 static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
-                             MemoryDependenceResults *MD,
+                             MemoryDependenceResults *MD, MemorySSA *MSSA,
                              const TargetLibraryInfo *TLI) {
   bool MadeChange = false;
 
@@ -661,7 +676,7 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
               dbgs() << '\n');
 
         // DCE instructions only used to calculate that store.
-        deleteDeadInstruction(Dead, *MD, *TLI, &DeadStackObjects);
+        deleteDeadInstruction(Dead, *MD, MSSA, *TLI, &DeadStackObjects);
         ++NumFastStores;
         MadeChange = true;
         continue;
@@ -671,7 +686,7 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
     // Remove any dead non-memory-mutating instructions.
     if (isInstructionTriviallyDead(&*BBI, TLI)) {
       Instruction *Inst = &*BBI++;
-      deleteDeadInstruction(Inst, *MD, *TLI, &DeadStackObjects);
+      deleteDeadInstruction(Inst, *MD, MSSA, *TLI, &DeadStackObjects);
       ++NumFastOther;
       MadeChange = true;
       continue;
@@ -745,8 +760,36 @@ static bool handleEndBlock(BasicBlock &BB, AliasAnalysis *AA,
   return MadeChange;
 }
 
+/// Find the closest instruction before \p Inst in its block that may access
+/// \p Loc, by walking back over the MemorySSA accesses of the block rather
+/// than over every instruction like memdep does.
+static MemDepResult getMemorySSADependency(MemorySSA &MSSA, Instruction *Inst,
+                                           const MemoryLocation &Loc,
+                                           AliasAnalysis &AA) {
+  MemoryAccess *MA = MSSA.getMemoryAccess(Inst);
+  const MemorySSA::AccessListType *Accesses =
+      MSSA.getBlockAccesses(Inst->getParent());
+  unsigned Limit = MemorySSAScanLimit;
+  for (MemorySSA::AccessListType::const_reverse_iterator
+           It(MA->getIterator()),
+       E = Accesses->rend();
+       It != E; ++It) {
+    // The accesses of the block start with its MemoryPhi, if it has one.
+    const MemoryUseOrDef *MUD = dyn_cast<MemoryUseOrDef>(&*It);
+    if (!MUD)
+      break;
+    if (!Limit--)
+      return MemDepResult::getUnknown();
+    Instruction *I = MUD->getMemoryInst();
+    if (AA.getModRefInfo(I, Loc) != MRI_NoModRef)
+      return MemDepResult::getClobber(I);
+  }
+  return MemDepResult::getNonLocal();
+}
+
 static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
-                                MemoryDependenceResults *MD, DominatorTree *DT,
+                                MemoryDependenceResults *MD, MemorySSA *MSSA,
+                                DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
   const DataLayout &DL = BB.getModule()->getDataLayout();
   bool MadeChange = false;
@@ -757,7 +800,7 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
 
     // Handle 'free' calls specially.
     if (CallInst *F = isFreeCall(Inst, TLI)) {
-      MadeChange |= handleFree(F, AA, MD, DT, TLI);
+      MadeChange |= handleFree(F, AA, MD, MSSA, DT, TLI);
       continue;
     }
 
@@ -774,7 +817,7 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
         // in case we need it.
         WeakVH NextInst(&*BBI);
 
-        deleteDeadInstruction(DeadInst, *MD, *TLI);
+        deleteDeadInstruction(DeadInst, *MD, MSSA, *TLI);
 
         if (!NextInst) // Next instruction deleted.
           BBI = BB.begin();
@@ -817,13 +860,6 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
       }
     }
 
-    MemDepResult InstDep = MD->getDependency(Inst);
-
-    // Ignore any store where we can't find a local dependence.
-    // FIXME: cross-block DSE would be fun. :)
-    if (!InstDep.isDef() && !InstDep.isClobber())
-      continue;
-
     // Figure out what location is being stored to.
     MemoryLocation Loc = getLocForWrite(Inst, *AA);
 
@@ -831,6 +867,14 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
     if (!Loc.Ptr)
       continue;
 
+    MemDepResult InstDep = MSSA ? getMemorySSADependency(*MSSA, Inst, Loc, *AA)
+                                : MD->getDependency(Inst);
+
+    // Ignore any store where we can't find a local dependence.
+    // FIXME: cross-block DSE would be fun. :)
+    if (!InstDep.isDef() && !InstDep.isClobber())
+      continue;
+
     while (InstDep.isDef() || InstDep.isClobber()) {
       // Get the memory clobbered by the instruction we depend on.  MemDep will
       // skip any instructions that 'Loc' clearly doesn't interact with.  If we
@@ -858,7 +902,7 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
                 << *DepWrite << "\n  KILLER: " << *Inst << '\n');
 
           // Delete the store and now-dead instructions that feed it.
-          deleteDeadInstruction(DepWrite, *MD, *TLI);
+          deleteDeadInstruction(DepWrite, *MD, MSSA, *TLI);
           ++NumFastStores;
           MadeChange = true;
 
@@ -930,15 +974,17 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
       if (AA->getModRefInfo(DepWrite, Loc) & MRI_Ref)
         break;
 
-      InstDep = MD->getPointerDependencyFrom(Loc, false,
-                                             DepWrite->getIterator(), &BB);
+      InstDep = MSSA ? getMemorySSADependency(*MSSA, DepWrite, Loc, *AA)
+                     : MD->getPointerDependencyFrom(Loc, false,
+                                                    DepWrite->getIterator(),
+                                                    &BB);
     }
   }
 
   // If this block ends in a return, unwind, or unreachable, all allocas are
   // dead at its end, which means stores to them are also dead.
   if (BB.getTerminator()->getNumSuccessors() == 0)
-    MadeChange |= handleEndBlock(BB, AA, MD, TLI);
+    MadeChange |= handleEndBlock(BB, AA, MD, MSSA, TLI);
 
   return MadeChange;
 }
@@ -946,12 +992,21 @@ static bool eliminateDeadStores(BasicBlock &BB, AliasAnalysis *AA,
 static bool eliminateDeadStores(Function &F, AliasAnalysis *AA,
                                 MemoryDependenceResults *MD, DominatorTree *DT,
                                 const TargetLibraryInfo *TLI) {
+  // DSE doesn't change the CFG, so MemorySSA is built once for the function
+  // and updated as instructions are deleted.
+  std::unique_ptr<MemorySSA> MSSA;
+  std::unique_ptr<MemorySSAWalker> MSSAWalker;
+  if (EnableMemorySSA) {
+    MSSA.reset(new MemorySSA(F));
+    MSSAWalker.reset(MSSA->buildMemorySSA(AA, DT));
+  }
+
   bool MadeChange = false;
   for (BasicBlock &BB : F)
     // Only check non-dead blocks.  Dead blocks may have strange pointer
     // cycles that will confuse alias analysis.
     if (DT->isReachableFromEntry(&BB))
-      MadeChange |= eliminateDeadStores(BB, AA, MD, DT, TLI);
+      MadeChange |= eliminateDeadStores(BB, AA, MD, MSSA.get(), DT, TLI);
   return MadeChange;
 }
 
@@ -16,6 +16,7 @@
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ScopedHashTable.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
 #include "llvm/Analysis/AssumptionCache.h"
 #include "llvm/Analysis/GlobalsModRef.h"
 #include "llvm/Analysis/InstructionSimplify.h"
@@ -32,6 +33,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include <deque>
 using namespace llvm;
 using namespace llvm::PatternMatch;
@@ -45,6 +47,11 @@ STATISTIC(NumCSELoad,  "Number of load instructions CSE'd");
 STATISTIC(NumCSECall,  "Number of call instructions CSE'd");
 STATISTIC(NumDSE,      "Number of trivial dead stores removed");
 
+static cl::opt<bool> EnableMemorySSA(
+    "early-cse-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Use MemorySSA to reuse memory values across writes that do "
+             "not clobber them"));
+
 //===----------------------------------------------------------------------===//
 // SimpleValue
 //===----------------------------------------------------------------------===//
@@ -308,10 +315,22 @@ public:
   /// \brief This is the current generation of the memory value.
   unsigned CurrentGeneration;
 
+  /// \brief MemorySSA for the function, if an alias analysis was provided.
+  ///
+  /// It is used to tell whether a memory value is still current when the
+  /// generation count has changed since it was recorded.
+  std::unique_ptr<MemorySSA> MSSA;
+  std::unique_ptr<MemorySSAWalker> MSSAWalker;
+
   /// \brief Set up the EarlyCSE runner for a particular function.
   EarlyCSE(const TargetLibraryInfo &TLI, const TargetTransformInfo &TTI,
-           DominatorTree &DT, AssumptionCache &AC)
-      : TLI(TLI), TTI(TTI), DT(DT), AC(AC), CurrentGeneration(0) {}
+           DominatorTree &DT, AssumptionCache &AC, AliasAnalysis *AA = nullptr)
+      : TLI(TLI), TTI(TTI), DT(DT), AC(AC), CurrentGeneration(0) {
+    if (AA) {
+      MSSA.reset(new MemorySSA(*DT.getRoot()->getParent()));
+      MSSAWalker.reset(MSSA->buildMemorySSA(AA, &DT));
+    }
+  }
 
   bool run();
 
@@ -471,6 +490,21 @@ private:
 
   bool processNode(DomTreeNode *Node);
 
+  /// Return true if the memory read or written by \p EarlierInst in
+  /// \p EarlierGeneration is unchanged when \p LaterInst executes in
+  /// \p LaterGeneration.
+  bool isSameMemGeneration(unsigned EarlierGeneration,
+                           unsigned LaterGeneration, Instruction *EarlierInst,
+                           Instruction *LaterInst);
+
+  /// Erase \p Inst, keeping MemorySSA up to date.
+  void eraseInstruction(Instruction *Inst) {
+    if (MSSA)
+      if (MemoryAccess *MA = MSSA->getMemoryAccess(Inst))
+        MSSA->removeMemoryAccess(MA);
+    Inst->eraseFromParent();
+  }
+
   Value *getOrCreateResult(Value *Inst, Type *ExpectedType) const {
     if (LoadInst *LI = dyn_cast<LoadInst>(Inst))
       return LI;
@@ -483,6 +517,24 @@ private:
 };
 }
 
+bool EarlyCSE::isSameMemGeneration(unsigned EarlierGeneration,
+                                   unsigned LaterGeneration,
+                                   Instruction *EarlierInst,
+                                   Instruction *LaterInst) {
+  if (EarlierGeneration == LaterGeneration)
+    return true;
+  if (!MSSA)
+    return false;
+
+  // The value is still current if nothing between the two instructions
+  // clobbers the memory that the later one accesses.
+  MemoryAccess *EarlierMA = MSSA->getMemoryAccess(EarlierInst);
+  if (!EarlierMA || !MSSA->getMemoryAccess(LaterInst))
+    return false;
+  MemoryAccess *LaterDef = MSSAWalker->getClobberingMemoryAccess(LaterInst);
+  return MSSA->dominates(LaterDef, EarlierMA);
+}
+
 bool EarlyCSE::processNode(DomTreeNode *Node) {
   bool Changed = false;
   BasicBlock *BB = Node->getBlock();
@@ -540,7 +592,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
     // Dead instructions should just be removed.
     if (isInstructionTriviallyDead(Inst, &TLI)) {
       DEBUG(dbgs() << "EarlyCSE DCE: " << *Inst << '\n');
-      Inst->eraseFromParent();
+      eraseInstruction(Inst);
       Changed = true;
       ++NumSimplify;
       continue;
@@ -576,7 +628,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
     if (Value *V = SimplifyInstruction(Inst, DL, &TLI, &DT, &AC)) {
       DEBUG(dbgs() << "EarlyCSE Simplify: " << *Inst << "  to: " << *V << '\n');
       Inst->replaceAllUsesWith(V);
-      Inst->eraseFromParent();
+      eraseInstruction(Inst);
       Changed = true;
       ++NumSimplify;
       continue;
@@ -614,7 +666,9 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
       // If we have an available version of this load, and if it is the right
       // generation, replace this instruction.
       LoadValue InVal = AvailableLoads.lookup(MemInst.getPointerOperand());
-      if (InVal.DefInst != nullptr && InVal.Generation == CurrentGeneration &&
+      if (InVal.DefInst != nullptr &&
+          isSameMemGeneration(InVal.Generation, CurrentGeneration,
+                              InVal.DefInst, Inst) &&
           InVal.MatchingId == MemInst.getMatchingId() &&
           // We don't yet handle removing loads with ordering of any kind.
           !MemInst.isVolatile() && MemInst.isUnordered() &&
@@ -626,7 +680,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
                        << "  to: " << *InVal.DefInst << '\n');
           if (!Inst->use_empty())
             Inst->replaceAllUsesWith(Op);
-          Inst->eraseFromParent();
+          eraseInstruction(Inst);
           Changed = true;
           ++NumCSELoad;
           continue;
@@ -656,12 +710,14 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
       // If we have an available version of this call, and if it is the right
       // generation, replace this instruction.
       std::pair<Instruction *, unsigned> InVal = AvailableCalls.lookup(Inst);
-      if (InVal.first != nullptr && InVal.second == CurrentGeneration) {
+      if (InVal.first != nullptr &&
+          isSameMemGeneration(InVal.second, CurrentGeneration, InVal.first,
+                              Inst)) {
         DEBUG(dbgs() << "EarlyCSE CSE CALL: " << *Inst
                      << "  to: " << *InVal.first << '\n');
         if (!Inst->use_empty())
           Inst->replaceAllUsesWith(InVal.first);
-        Inst->eraseFromParent();
+        eraseInstruction(Inst);
         Changed = true;
         ++NumCSECall;
         continue;
@@ -693,7 +749,8 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
       LoadValue InVal = AvailableLoads.lookup(MemInst.getPointerOperand());
       if (InVal.DefInst &&
           InVal.DefInst == getOrCreateResult(Inst, InVal.DefInst->getType()) &&
-          InVal.Generation == CurrentGeneration &&
+          isSameMemGeneration(InVal.Generation, CurrentGeneration,
+                              InVal.DefInst, Inst) &&
           InVal.MatchingId == MemInst.getMatchingId() &&
           // We don't yet handle removing stores with ordering of any kind.
           !MemInst.isVolatile() && MemInst.isUnordered()) {
@@ -702,7 +759,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
                 MemInst.getPointerOperand()) &&
                "can't have an intervening store!");
         DEBUG(dbgs() << "EarlyCSE DSE (writeback): " << *Inst << '\n');
-        Inst->eraseFromParent();
+        eraseInstruction(Inst);
         Changed = true;
         ++NumDSE;
         // We can avoid incrementing the generation count since we were able
@@ -733,7 +790,7 @@ bool EarlyCSE::processNode(DomTreeNode *Node) {
           if (LastStoreMemInst.isMatchingMemLoc(MemInst)) {
             DEBUG(dbgs() << "EarlyCSE DEAD STORE: " << *LastStore
                          << "  due to: " << *Inst << '\n');
-            LastStore->eraseFromParent();
+            eraseInstruction(LastStore);
             Changed = true;
             ++NumDSE;
             LastStore = nullptr;
@@ -829,8 +886,9 @@ PreservedAnalyses EarlyCSEPass::run(Function &F,
   auto &TTI = AM.getResult<TargetIRAnalysis>(F);
   auto &DT = AM.getResult<DominatorTreeAnalysis>(F);
   auto &AC = AM.getResult<AssumptionAnalysis>(F);
+  auto *AA = EnableMemorySSA ? &AM.getResult<AAManager>(F) : nullptr;
 
-  EarlyCSE CSE(TLI, TTI, DT, AC);
+  EarlyCSE CSE(TLI, TTI, DT, AC, AA);
 
   if (!CSE.run())
     return PreservedAnalyses::all();
@@ -866,8 +924,11 @@ public:
     auto &TTI = getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
     auto &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
     auto &AC = getAnalysis<AssumptionCacheTracker>().getAssumptionCache(F);
+    auto *AA = EnableMemorySSA
+                   ? &getAnalysis<AAResultsWrapperPass>().getAAResults()
+                   : nullptr;
 
-    EarlyCSE CSE(TLI, TTI, DT, AC);
+    EarlyCSE CSE(TLI, TTI, DT, AC, AA);
 
     return CSE.run();
   }
@@ -877,6 +938,8 @@ public:
     AU.addRequired<DominatorTreeWrapperPass>();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
     AU.addRequired<TargetTransformInfoWrapperPass>();
+    if (EnableMemorySSA)
+      AU.addRequired<AAResultsWrapperPass>();
     AU.addPreserved<GlobalsAAWrapperPass>();
     AU.setPreservesCFG();
   }
@@ -893,4 +956,5 @@ INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
 INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetLibraryInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
 INITIALIZE_PASS_END(EarlyCSELegacyPass, "early-cse", "Early CSE", false, false)
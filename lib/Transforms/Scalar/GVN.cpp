@@ -36,6 +36,7 @@
 #include "llvm/Analysis/PHITransAddr.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/CompileTimeBudget.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/GlobalVariable.h"
@@ -68,6 +69,10 @@ STATISTIC(NumPRELoad,   "Number of loads PRE'd");
 static cl::opt<bool> EnablePRE("enable-pre",
                                cl::init(true), cl::Hidden);
 static cl::opt<bool> EnableLoadPRE("enable-load-pre", cl::init(true));
+static cl::opt<bool> EnableMemorySSA(
+    "enable-gvn-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Use MemorySSA rather than MemoryDependenceAnalysis to find "
+             "the values available to loads"));
 
 // Maximum allowed recursion depth.
 static cl::opt<uint32_t>
@@ -593,7 +598,12 @@ PreservedAnalyses GVN::run(Function &F, AnalysisManager<Function> &AM) {
   auto &TLI = AM.getResult<TargetLibraryAnalysis>(F);
   auto &AA = AM.getResult<AAManager>(F);
   auto &MemDep = AM.getResult<MemoryDependenceAnalysis>(F);
-  bool Changed = runImpl(F, AC, DT, TLI, AA, &MemDep);
+  // Load elimination is the expensive part of GVN, so drop it on functions
+  // that are over the compile-time budget.
+  CompileTimeBudget &Budget = F.getContext().getCompileTimeBudget();
+  bool OverBudget = !Budget.shouldRunExpensivePass(
+      "gvn", F, "ran without load elimination");
+  bool Changed = runImpl(F, AC, DT, TLI, AA, OverBudget ? nullptr : &MemDep);
   return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
 }
 
@@ -1603,7 +1613,14 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
 
   // Step 1: Find the non-local dependencies of the load.
   LoadDepVect Deps;
-  MD->getNonLocalPointerDependency(LI, Deps);
+  if (MSSA) {
+    MemoryPhi *Phi = cast<MemoryPhi>(MSSAWalker->getClobberingMemoryAccess(LI));
+    SmallPtrSet<MemoryPhi *, 8> Visited;
+    if (!getMemorySSANonLocalDeps(LI, Phi, Deps, Visited))
+      return false;
+  } else {
+    MD->getNonLocalPointerDependency(LI, Deps);
+  }
 
   // If we had to process more than one hundred blocks to find the
   // dependencies, this load isn't worth worrying about.  Optimizing
@@ -1667,8 +1684,9 @@ bool GVN::processNonLocalLoad(LoadInst *LI) {
     return true;
   }
 
-  // Step 4: Eliminate partial redundancy.
-  if (!EnablePRE || !EnableLoadPRE)
+  // Step 4: Eliminate partial redundancy.  The loads this inserts would have
+  // to be added to MemorySSA, which it can't do yet.
+  if (!EnablePRE || !EnableLoadPRE || MSSA)
     return false;
 
   return PerformLoadPRE(LI, ValuesPerBlock, UnavailableBlocks);
@@ -1779,7 +1797,7 @@ bool GVN::processLoad(LoadInst *L) {
   }
 
   // ... to a pointer that has been loaded from before...
-  MemDepResult Dep = MD->getDependency(L);
+  MemDepResult Dep = MSSA ? getMemorySSADependency(L) : MD->getDependency(L);
 
   // If it is defined in another block, try harder.
   if (Dep.isNonLocal())
@@ -1815,6 +1833,90 @@ bool GVN::processLoad(LoadInst *L) {
   return false;
 }
 
+MemDepResult GVN::getMemorySSADependency(LoadInst *L) {
+  MemoryAccess *Clobber = MSSAWalker->getClobberingMemoryAccess(L);
+
+  // A dominating load of the same pointer with the same clobber reads the
+  // same value.
+  LoadInst *&Earlier =
+      AvailableLoads[std::make_pair(Clobber, L->getPointerOperand())];
+  if (Earlier && Earlier != L && DT->dominates(Earlier, L))
+    return MemDepResult::getDef(Earlier);
+  Earlier = L;
+
+  if (isa<MemoryPhi>(Clobber))
+    return MemDepResult::getNonLocal();
+  return getMemorySSADependency(L, Clobber);
+}
+
+MemDepResult GVN::getMemorySSADependency(LoadInst *L, MemoryAccess *Clobber) {
+  if (MSSA->isLiveOnEntryDef(Clobber)) {
+    // Nothing in the function writes the loaded memory.  If it is a local
+    // allocation, the load reads an undefined value.
+    const DataLayout &DL = L->getModule()->getDataLayout();
+    if (AllocaInst *AI =
+            dyn_cast<AllocaInst>(GetUnderlyingObject(L->getPointerOperand(), DL)))
+      return MemDepResult::getDef(AI);
+    return MemDepResult::getNonFuncLocal();
+  }
+
+  Instruction *DepInst = cast<MemoryDef>(Clobber)->getMemoryInst();
+  // Ordered and volatile loads are defs in MemorySSA.  Don't forward their
+  // value; memdep never reports them as the dependency of an unordered load.
+  if (isa<LoadInst>(DepInst))
+    return MemDepResult::getUnknown();
+  if (StoreInst *SI = dyn_cast<StoreInst>(DepInst))
+    if (getAliasAnalysis()->alias(MemoryLocation::get(SI),
+                                  MemoryLocation::get(L)) == MustAlias)
+      return MemDepResult::getDef(SI);
+  return MemDepResult::getClobber(DepInst);
+}
+
+bool GVN::getMemorySSANonLocalDeps(LoadInst *L, MemoryPhi *Phi,
+                                   LoadDepVect &Deps,
+                                   SmallPtrSetImpl<MemoryPhi *> &Visited) {
+  if (!Visited.insert(Phi).second)
+    return true;
+
+  // The address is not phi translated, so it must be the same value in every
+  // block we look at.
+  Value *Address = L->getPointerOperand();
+  if (Instruction *AddrInst = dyn_cast<Instruction>(Address))
+    if (!DT->properlyDominates(AddrInst->getParent(), Phi->getBlock()))
+      return false;
+
+  MemoryLocation Loc = MemoryLocation::get(L);
+  for (unsigned i = 0, e = Phi->getNumIncomingValues(); i != e; ++i) {
+    MemoryAccess *Clobber =
+        MSSAWalker->getClobberingMemoryAccess(Phi->getIncomingValue(i), Loc);
+    if (MemoryPhi *IncomingPhi = dyn_cast<MemoryPhi>(Clobber)) {
+      if (!getMemorySSANonLocalDeps(L, IncomingPhi, Deps, Visited))
+        return false;
+      continue;
+    }
+    Deps.push_back(NonLocalDepResult(Phi->getIncomingBlock(i),
+                                     getMemorySSADependency(L, Clobber),
+                                     Address));
+  }
+  return true;
+}
+
+void GVN::removeFromMemorySSA(Instruction *I) {
+  MemoryAccess *MA = MSSA->getMemoryAccess(I);
+  if (!MA)
+    return;
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    auto It = AvailableLoads.find(std::make_pair(
+        MSSAWalker->getClobberingMemoryAccess(LI), LI->getPointerOperand()));
+    if (It != AvailableLoads.end() && It->second == LI)
+      AvailableLoads.erase(It);
+  }
+  // Removing a def can change the clobbers of the remaining loads.
+  if (!isa<MemoryUse>(MA))
+    AvailableLoads.clear();
+  MSSA->removeMemoryAccess(MA);
+}
+
 // In order to find a leader for a given value number at a
 // specific basic block, we first obtain the list of all Values for that number,
 // and then scan the list to find one whose block dominates the block in
@@ -2204,6 +2306,9 @@ bool GVN::runImpl(Function &F, AssumptionCache &RunAC, DominatorTree &RunDT,
     Changed |= ShouldContinue;
     ++Iteration;
   }
+  AvailableLoads.clear();
+  MSSAWalker.reset();
+  MSSA.reset();
 
   if (EnablePRE) {
     // Fabricate val-num for dead-code in order to suppress assertion in
@@ -2264,6 +2369,7 @@ bool GVN::processBlock(BasicBlock *BB) {
          E = InstrsToErase.end(); I != E; ++I) {
       DEBUG(dbgs() << "GVN removed: " << **I << '\n');
       if (MD) MD->removeInstruction(*I);
+      if (MSSA) removeFromMemorySSA(*I);
       DEBUG(verifyRemoved(*I));
       (*I)->eraseFromParent();
     }
@@ -2506,6 +2612,15 @@ bool GVN::splitCriticalEdges() {
 bool GVN::iterateOnFunction(Function &F) {
   cleanupGlobalSets();
 
+  // The previous iteration may have split critical edges, so MemorySSA is
+  // built from scratch each time.
+  if (MD && EnableMemorySSA) {
+    AvailableLoads.clear();
+    MSSAWalker.reset();
+    MSSA.reset(new MemorySSA(F));
+    MSSAWalker.reset(MSSA->buildMemorySSA(getAliasAnalysis(), DT));
+  }
+
   // Top-down walk of the dominator tree
   bool Changed = false;
   // Save the blocks this function have before transformation begins. GVN may
@@ -2687,13 +2802,18 @@ public:
     if (skipFunction(F))
       return false;
 
+    bool SkipLoads =
+        NoLoads ||
+        !F.getContext().getCompileTimeBudget().shouldRunExpensivePass(
+            "gvn", F, "ran without load elimination");
+
     return Impl.runImpl(
         F, getAnalysis<AssumptionCacheTracker>().getAssumptionCache(F),
         getAnalysis<DominatorTreeWrapperPass>().getDomTree(),
         getAnalysis<TargetLibraryInfoWrapperPass>().getTLI(),
         getAnalysis<AAResultsWrapperPass>().getAAResults(),
-        NoLoads ? nullptr
-                : &getAnalysis<MemoryDependenceWrapperPass>().getMemDep());
+        SkipLoads ? nullptr
+                  : &getAnalysis<MemoryDependenceWrapperPass>().getMemDep());
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
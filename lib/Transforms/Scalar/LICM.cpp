@@ -61,6 +61,7 @@
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
+#include "llvm/Transforms/Utils/MemorySSA.h"
 #include "llvm/Transforms/Utils/SSAUpdater.h"
 #include <algorithm>
 #include <utility>
@@ -78,13 +79,18 @@ static cl::opt<bool>
     DisablePromotion("disable-licm-promotion", cl::Hidden,
                      cl::desc("Disable memory promotion in LICM pass"));
 
+static cl::opt<bool> EnableMemorySSA(
+    "licm-memoryssa", cl::init(false), cl::Hidden,
+    cl::desc("Use MemorySSA rather than an AliasSetTracker to decide which "
+             "memory accesses LICM may hoist, sink and promote"));
+
 static bool inSubLoop(BasicBlock *BB, Loop *CurLoop, LoopInfo *LI);
 static bool isNotUsedInLoop(const Instruction &I, const Loop *CurLoop,
                             const LICMSafetyInfo *SafetyInfo);
 static bool hoist(Instruction &I, const DominatorTree *DT, const Loop *CurLoop,
                   const LICMSafetyInfo *SafetyInfo);
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
-                 const Loop *CurLoop, AliasSetTracker *CurAST,
+                 const Loop *CurLoop, AliasSetTracker *CurAST, MemorySSA *MSSA,
                  const LICMSafetyInfo *SafetyInfo);
 static bool isGuaranteedToExecute(const Instruction &Inst,
                                   const DominatorTree *DT, const Loop *CurLoop,
@@ -98,6 +104,9 @@ static bool isSafeToExecuteUnconditionally(const Instruction &Inst,
 static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
                                      const AAMDNodes &AAInfo,
                                      AliasSetTracker *CurAST);
+static bool accessInvalidatedByLoopWithMSSA(Instruction &I, Loop *CurLoop,
+                                            MemorySSA *MSSA);
+static void removeMemoryAccess(Instruction &I, MemorySSA *MSSA);
 static Instruction *
 CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
                             const LoopInfo *LI,
@@ -105,7 +114,10 @@ CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
 static bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA,
                                DominatorTree *DT, TargetLibraryInfo *TLI,
                                Loop *CurLoop, AliasSetTracker *CurAST,
-                               LICMSafetyInfo *SafetyInfo);
+                               MemorySSA *MSSA, LICMSafetyInfo *SafetyInfo);
+static void
+collectPromotionCandidates(Loop *L, AliasAnalysis *AA,
+                           SmallVectorImpl<SmallSetVector<Value *, 8>> &Sets);
 
 namespace {
 struct LICM : public LoopPass {
@@ -188,7 +200,18 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   assert(L->isLCSSAForm(*DT) && "Loop is not in LCSSA form.");
 
-  CurAST = collectAliasInfoForLoop(L);
+  // The other loop passes do not preserve MemorySSA, so when it is used in
+  // place of the alias set tracker it is built for each loop and dropped
+  // again once the loop has been processed.
+  std::unique_ptr<MemorySSA> MSSA;
+  std::unique_ptr<MemorySSAWalker> MSSAWalker;
+  if (EnableMemorySSA) {
+    MSSA.reset(new MemorySSA(*L->getHeader()->getParent()));
+    MSSAWalker.reset(MSSA->buildMemorySSA(AA, DT));
+    CurAST = nullptr;
+  } else {
+    CurAST = collectAliasInfoForLoop(L);
+  }
 
   CurLoop = L;
 
@@ -211,10 +234,10 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
   //
   if (L->hasDedicatedExits())
     Changed |= sinkRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI, CurLoop,
-                          CurAST, &SafetyInfo);
+                          CurAST, &SafetyInfo, MSSA.get());
   if (Preheader)
     Changed |= hoistRegion(DT->getNode(L->getHeader()), AA, LI, DT, TLI,
-                           CurLoop, CurAST, &SafetyInfo);
+                           CurLoop, CurAST, &SafetyInfo, MSSA.get());
 
   // Now that all loop invariants have been removed from the loop, promote any
   // memory references to scalars that we can.
@@ -223,11 +246,31 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
     SmallVector<Instruction *, 8> InsertPts;
     PredIteratorCache PIC;
 
-    // Loop over all of the alias sets in the tracker object.
-    for (AliasSet &AS : *CurAST)
-      Changed |=
-          promoteLoopAccessesToScalars(AS, ExitBlocks, InsertPts, PIC, LI, DT,
-                                       TLI, CurLoop, CurAST, &SafetyInfo);
+    SmallVector<SmallSetVector<Value *, 8>, 8> PromotionCandidates;
+    if (CurAST) {
+      // Loop over all of the alias sets in the tracker object. We can promote
+      // an alias set if it has a store, if it is a "Must" alias set and if we
+      // are not eliminating any volatile loads or stores.
+      for (AliasSet &AS : *CurAST) {
+        if (AS.isForwardingAliasSet() || !AS.isMod() || !AS.isMustAlias() ||
+            AS.isVolatile())
+          continue;
+        assert(!AS.empty() &&
+               "Must alias set should have at least one pointer element in it!");
+        SmallSetVector<Value *, 8> PointerMustAliases;
+        for (const auto &ASI : AS)
+          PointerMustAliases.insert(ASI.getValue());
+        PromotionCandidates.push_back(std::move(PointerMustAliases));
+      }
+    } else {
+      collectPromotionCandidates(L, AA, PromotionCandidates);
+    }
+
+    for (const SmallSetVector<Value *, 8> &PointerMustAliases :
+         PromotionCandidates)
+      Changed |= promoteLoopAccessesToScalars(PointerMustAliases, ExitBlocks,
+                                              InsertPts, PIC, LI, DT, TLI,
+                                              CurLoop, CurAST, &SafetyInfo);
 
     // Once we have promoted values across the loop body we have to recursively
     // reform LCSSA as any nested loop may now have values defined within the
@@ -254,7 +297,7 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
 
   // If this loop is nested inside of another one, save the alias information
   // for when we process the outer loop.
-  if (L->getParentLoop())
+  if (CurAST && L->getParentLoop())
     LoopToAliasSetMap[L] = CurAST;
   else
     delete CurAST;
@@ -272,12 +315,13 @@ bool LICM::runOnLoop(Loop *L, LPPassManager &LPM) {
 ///
 bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                       DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                      AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                      AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo,
+                      MemorySSA *MSSA) {
 
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && DT != nullptr &&
-         CurLoop != nullptr && CurAST != nullptr && SafetyInfo != nullptr &&
-         "Unexpected input to sinkRegion");
+         CurLoop != nullptr && (CurAST != nullptr) != (MSSA != nullptr) &&
+         SafetyInfo != nullptr && "Unexpected input to sinkRegion");
 
   BasicBlock *BB = N->getBlock();
   // If this subregion is not in the top level loop at all, exit.
@@ -288,7 +332,8 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
   bool Changed = false;
   const std::vector<DomTreeNode *> &Children = N->getChildren();
   for (DomTreeNode *Child : Children)
-    Changed |= sinkRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |=
+        sinkRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo, MSSA);
 
   // Only need to process the contents of this block if it is not part of a
   // subloop (which would already have been processed).
@@ -303,7 +348,9 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
     if (isInstructionTriviallyDead(&I, TLI)) {
       DEBUG(dbgs() << "LICM deleting dead inst: " << I << '\n');
       ++II;
-      CurAST->deleteValue(&I);
+      if (CurAST)
+        CurAST->deleteValue(&I);
+      removeMemoryAccess(I, MSSA);
       I.eraseFromParent();
       Changed = true;
       continue;
@@ -315,9 +362,10 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
     // operands of the instruction are loop invariant.
     //
     if (isNotUsedInLoop(I, CurLoop, SafetyInfo) &&
-        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo)) {
+        canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, MSSA,
+                           SafetyInfo)) {
       ++II;
-      Changed |= sink(I, LI, DT, CurLoop, CurAST, SafetyInfo);
+      Changed |= sink(I, LI, DT, CurLoop, CurAST, MSSA, SafetyInfo);
     }
   }
   return Changed;
@@ -330,11 +378,12 @@ bool llvm::sinkRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
 ///
 bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
                        DominatorTree *DT, TargetLibraryInfo *TLI, Loop *CurLoop,
-                       AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                       AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo,
+                       MemorySSA *MSSA) {
   // Verify inputs.
   assert(N != nullptr && AA != nullptr && LI != nullptr && DT != nullptr &&
-         CurLoop != nullptr && CurAST != nullptr && SafetyInfo != nullptr &&
-         "Unexpected input to hoistRegion");
+         CurLoop != nullptr && (CurAST != nullptr) != (MSSA != nullptr) &&
+         SafetyInfo != nullptr && "Unexpected input to hoistRegion");
 
   BasicBlock *BB = N->getBlock();
 
@@ -354,8 +403,11 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       if (Constant *C = ConstantFoldInstruction(
               &I, I.getModule()->getDataLayout(), TLI)) {
         DEBUG(dbgs() << "LICM folding inst: " << I << "  --> " << *C << '\n');
-        CurAST->copyValue(&I, C);
-        CurAST->deleteValue(&I);
+        if (CurAST) {
+          CurAST->copyValue(&I, C);
+          CurAST->deleteValue(&I);
+        }
+        removeMemoryAccess(I, MSSA);
         I.replaceAllUsesWith(C);
         I.eraseFromParent();
         continue;
@@ -366,7 +418,8 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
       // is safe to hoist the instruction.
       //
       if (CurLoop->hasLoopInvariantOperands(&I) &&
-          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, SafetyInfo) &&
+          canSinkOrHoistInst(I, AA, DT, TLI, CurLoop, CurAST, MSSA,
+                             SafetyInfo) &&
           isSafeToExecuteUnconditionally(
               I, DT, TLI, CurLoop, SafetyInfo,
               CurLoop->getLoopPreheader()->getTerminator()))
@@ -375,7 +428,8 @@ bool llvm::hoistRegion(DomTreeNode *N, AliasAnalysis *AA, LoopInfo *LI,
 
   const std::vector<DomTreeNode *> &Children = N->getChildren();
   for (DomTreeNode *Child : Children)
-    Changed |= hoistRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo);
+    Changed |=
+        hoistRegion(Child, AA, LI, DT, TLI, CurLoop, CurAST, SafetyInfo, MSSA);
   return Changed;
 }
 
@@ -412,11 +466,13 @@ void llvm::computeLICMSafetyInfo(LICMSafetyInfo *SafetyInfo, Loop *CurLoop) {
 }
 
 /// canSinkOrHoistInst - Return true if the hoister and sinker can handle this
-/// instruction.
+/// instruction. Memory dependences are checked against CurAST if it is
+/// available, and against MSSA otherwise.
 ///
 bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
                         TargetLibraryInfo *TLI, Loop *CurLoop,
-                        AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
+                        AliasSetTracker *CurAST, MemorySSA *MSSA,
+                        LICMSafetyInfo *SafetyInfo) {
   // Loads have extra constraints we have to verify before we can hoist them.
   if (LoadInst *LI = dyn_cast<LoadInst>(&I)) {
     if (!LI->isUnordered())
@@ -430,6 +486,9 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
       return true;
 
     // Don't hoist loads which have may-aliased stores in loop.
+    if (!CurAST)
+      return !accessInvalidatedByLoopWithMSSA(I, CurLoop, MSSA);
+
     uint64_t Size = 0;
     if (LI->getType()->isSized())
       Size = I.getModule()->getDataLayout().getTypeStoreSize(LI->getType());
@@ -452,6 +511,11 @@ bool canSinkOrHoistInst(Instruction &I, AliasAnalysis *AA, DominatorTree *DT,
     if (Behavior == FMRB_DoesNotAccessMemory)
       return true;
     if (AliasAnalysis::onlyReadsMemory(Behavior)) {
+      // MemorySSA tells us directly whether a write in the loop may clobber
+      // what the call reads.
+      if (!CurAST)
+        return !accessInvalidatedByLoopWithMSSA(I, CurLoop, MSSA);
+
       // A readonly argmemonly function only reads from memory pointed to by
       // it's arguments with arbitrary offsets.  If we can prove there are no
       // writes to this memory in the loop, we can hoist or sink.
@@ -626,7 +690,7 @@ CloneInstructionInExitBlock(Instruction &I, BasicBlock &ExitBlock, PHINode &PN,
 /// position, and may either delete it or move it to outside of the loop.
 ///
 static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
-                 const Loop *CurLoop, AliasSetTracker *CurAST,
+                 const Loop *CurLoop, AliasSetTracker *CurAST, MemorySSA *MSSA,
                  const LICMSafetyInfo *SafetyInfo) {
   DEBUG(dbgs() << "LICM sinking instruction: " << I << "\n");
   bool Changed = false;
@@ -686,7 +750,9 @@ static bool sink(Instruction &I, const LoopInfo *LI, const DominatorTree *DT,
     PN->eraseFromParent();
   }
 
-  CurAST->deleteValue(&I);
+  if (CurAST)
+    CurAST->deleteValue(&I);
+  removeMemoryAccess(I, MSSA);
   I.eraseFromParent();
   return Changed;
 }
@@ -778,11 +844,11 @@ static bool isGuaranteedToExecute(const Instruction &Inst,
 namespace {
 class LoopPromoter : public LoadAndStorePromoter {
   Value *SomePtr; // Designated pointer to store to.
-  SmallPtrSetImpl<Value *> &PointerMustAliases;
+  const SmallSetVector<Value *, 8> &PointerMustAliases;
   SmallVectorImpl<BasicBlock *> &LoopExitBlocks;
   SmallVectorImpl<Instruction *> &LoopInsertPts;
   PredIteratorCache &PredCache;
-  AliasSetTracker &AST;
+  AliasSetTracker *AST;
   LoopInfo &LI;
   DebugLoc DL;
   int Alignment;
@@ -805,10 +871,10 @@ class LoopPromoter : public LoadAndStorePromoter {
 
 public:
   LoopPromoter(Value *SP, ArrayRef<const Instruction *> Insts, SSAUpdater &S,
-               SmallPtrSetImpl<Value *> &PMA,
+               const SmallSetVector<Value *, 8> &PMA,
                SmallVectorImpl<BasicBlock *> &LEB,
                SmallVectorImpl<Instruction *> &LIP, PredIteratorCache &PIC,
-               AliasSetTracker &ast, LoopInfo &li, DebugLoc dl, int alignment,
+               AliasSetTracker *ast, LoopInfo &li, DebugLoc dl, int alignment,
                const AAMDNodes &AATags)
       : LoadAndStorePromoter(Insts, S), SomePtr(SP), PointerMustAliases(PMA),
         LoopExitBlocks(LEB), LoopInsertPts(LIP), PredCache(PIC), AST(ast),
@@ -845,9 +911,13 @@ public:
 
   void replaceLoadWithValue(LoadInst *LI, Value *V) const override {
     // Update alias analysis.
-    AST.copyValue(LI, V);
+    if (AST)
+      AST->copyValue(LI, V);
+  }
+  void instructionDeleted(Instruction *I) const override {
+    if (AST)
+      AST->deleteValue(I);
   }
-  void instructionDeleted(Instruction *I) const override { AST.deleteValue(I); }
 };
 } // end anon namespace
 
@@ -857,26 +927,23 @@ public:
 /// loop invariant.
 ///
 bool llvm::promoteLoopAccessesToScalars(
-    AliasSet &AS, SmallVectorImpl<BasicBlock *> &ExitBlocks,
+    const SmallSetVector<Value *, 8> &PointerMustAliases,
+    SmallVectorImpl<BasicBlock *> &ExitBlocks,
     SmallVectorImpl<Instruction *> &InsertPts, PredIteratorCache &PIC,
     LoopInfo *LI, DominatorTree *DT, const TargetLibraryInfo *TLI,
     Loop *CurLoop, AliasSetTracker *CurAST, LICMSafetyInfo *SafetyInfo) {
   // Verify inputs.
   assert(LI != nullptr && DT != nullptr && CurLoop != nullptr &&
-         CurAST != nullptr && SafetyInfo != nullptr &&
+         SafetyInfo != nullptr &&
          "Unexpected Input to promoteLoopAccessesToScalars");
+  assert(!PointerMustAliases.empty() &&
+         "Must alias set should have at least one pointer element in it!");
 
-  // We can promote this alias set if it has a store, if it is a "Must" alias
-  // set, if the pointer is loop invariant, and if we are not eliminating any
-  // volatile loads or stores.
-  if (AS.isForwardingAliasSet() || !AS.isMod() || !AS.isMustAlias() ||
-      AS.isVolatile() || !CurLoop->isLoopInvariant(AS.begin()->getValue()))
+  // We can only promote the pointers if they are loop invariant.
+  Value *SomePtr = *PointerMustAliases.begin();
+  if (!CurLoop->isLoopInvariant(SomePtr))
     return false;
 
-  assert(!AS.empty() &&
-         "Must alias set should have at least one pointer element in it!");
-
-  Value *SomePtr = AS.begin()->getValue();
   BasicBlock *Preheader = CurLoop->getLoopPreheader();
 
   // It isn't safe to promote a load/store from the loop if the load/store is
@@ -910,7 +977,6 @@ bool llvm::promoteLoopAccessesToScalars(
   bool CanSpeculateLoad = false;
 
   SmallVector<Instruction *, 64> LoopUses;
-  SmallPtrSet<Value *, 4> PointerMustAliases;
 
   // We start with an alignment of one and try to find instructions that allow
   // us to prove better alignment.
@@ -932,10 +998,7 @@ bool llvm::promoteLoopAccessesToScalars(
   // cannot (yet) promote a memory location that is loaded and stored in
   // different sizes.  While we are at it, collect alignment and AA info.
   bool Changed = false;
-  for (AliasSet::iterator ASI = AS.begin(), E = AS.end(); ASI != E; ++ASI) {
-    Value *ASIV = ASI->getValue();
-    PointerMustAliases.insert(ASIV);
-
+  for (Value *ASIV : PointerMustAliases) {
     // Check that all of the pointers in the alias set have the same type.  We
     // cannot (yet) promote a memory location that is loaded and stored in
     // different sizes.
@@ -951,7 +1014,6 @@ bool llvm::promoteLoopAccessesToScalars(
       // If there is an non-load/store instruction in the loop, we can't promote
       // it.
       if (const LoadInst *Load = dyn_cast<LoadInst>(UI)) {
-        assert(!Load->isVolatile() && "AST broken");
         if (!Load->isSimple())
           return Changed;
 
@@ -963,7 +1025,6 @@ bool llvm::promoteLoopAccessesToScalars(
         // pointer.
         if (UI->getOperand(1) != ASIV)
           continue;
-        assert(!Store->isVolatile() && "AST broken");
         if (!Store->isSimple())
           return Changed;
 
@@ -1050,7 +1111,7 @@ bool llvm::promoteLoopAccessesToScalars(
   SmallVector<PHINode *, 16> NewPHIs;
   SSAUpdater SSA(&NewPHIs);
   LoopPromoter Promoter(SomePtr, LoopUses, SSA, PointerMustAliases, ExitBlocks,
-                        InsertPts, PIC, *CurAST, *LI, DL, Alignment, AATags);
+                        InsertPts, PIC, CurAST, *LI, DL, Alignment, AATags);
 
   // Set up the preheader to have a definition of the value.  It is the live-out
   // value from the preheader that uses in the loop will use.
@@ -1164,6 +1225,89 @@ static bool pointerInvalidatedByLoop(Value *V, uint64_t Size,
   return CurAST->getAliasSetForPointer(V, Size, AAInfo).isMod();
 }
 
+/// Return true if a write in CurLoop may clobber the memory read by the load
+/// or readonly call I, as MemorySSA sees it.
+///
+static bool accessInvalidatedByLoopWithMSSA(Instruction &I, Loop *CurLoop,
+                                            MemorySSA *MSSA) {
+  // Instructions created after MemorySSA was built have no access to query.
+  if (!MSSA->getMemoryAccess(&I))
+    return true;
+
+  // Every block of the loop reaches the header, so a write in the loop that
+  // may clobber I is found either within an iteration or around the backedge.
+  // If the nearest clobber is outside the loop, I reads the same memory in
+  // every iteration and on every exit.
+  MemoryAccess *Clobber = MSSA->getWalker()->getClobberingMemoryAccess(&I);
+  return !MSSA->isLiveOnEntryDef(Clobber) &&
+         CurLoop->contains(Clobber->getBlock());
+}
+
+/// Remove the MemorySSA access of I, if there is one, before I is erased.
+///
+static void removeMemoryAccess(Instruction &I, MemorySSA *MSSA) {
+  if (!MSSA)
+    return;
+  if (MemoryAccess *MA = MSSA->getMemoryAccess(&I))
+    MSSA->removeMemoryAccess(MA);
+}
+
+/// Collect the sets of must-alias pointers stored to in L which could be
+/// promoted, querying alias analysis for each memory access of the loop
+/// rather than relying on an AliasSetTracker. A set is only collected if its
+/// pointers are loop invariant and no other access of the loop may alias them.
+///
+static void
+collectPromotionCandidates(Loop *L, AliasAnalysis *AA,
+                           SmallVectorImpl<SmallSetVector<Value *, 8>> &Sets) {
+  SmallVector<Instruction *, 32> MemInsts;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (I.mayReadOrWriteMemory())
+        MemInsts.push_back(&I);
+
+  SmallPtrSet<Value *, 8> Visited;
+  for (Instruction *I : MemInsts) {
+    auto *SI = dyn_cast<StoreInst>(I);
+    if (!SI || !SI->isSimple())
+      continue;
+    Value *Ptr = SI->getPointerOperand();
+    if (!L->isLoopInvariant(Ptr) || !Visited.insert(Ptr).second)
+      continue;
+
+    MemoryLocation Loc = MemoryLocation::get(SI);
+    SmallSetVector<Value *, 8> PointerMustAliases;
+    PointerMustAliases.insert(Ptr);
+    bool Promotable = true;
+    for (Instruction *Other : MemInsts) {
+      Value *OtherPtr = nullptr;
+      if (auto *OtherLI = dyn_cast<LoadInst>(Other))
+        OtherPtr = OtherLI->getPointerOperand();
+      else if (auto *OtherSI = dyn_cast<StoreInst>(Other))
+        OtherPtr = OtherSI->getPointerOperand();
+      if (OtherPtr) {
+        MemoryLocation OtherLoc = MemoryLocation::get(Other);
+        AliasResult AR = AA->alias(Loc, OtherLoc);
+        if (AR == NoAlias)
+          continue;
+        if (AR == MustAlias && OtherLoc.Size == Loc.Size) {
+          PointerMustAliases.insert(OtherPtr);
+          continue;
+        }
+      } else if (AA->getModRefInfo(Other, Loc) == MRI_NoModRef) {
+        continue;
+      }
+      Promotable = false;
+      break;
+    }
+    if (!Promotable)
+      continue;
+
+    Visited.insert(PointerMustAliases.begin(), PointerMustAliases.end());
+    Sets.push_back(std::move(PointerMustAliases));
+  }
+}
+
 /// Little predicate that returns true if the specified basic block is in
 /// a subloop of the current one, not the current one itself.
 ///
@@ -9,6 +9,17 @@
 //
 // This file implements a Loop Data Prefetching Pass.
 //
+// Strided accesses are prefetched a number of iterations ahead that covers the
+// prefetch distance of the target. On targets that ask for it, indirect
+// accesses like A[B[i]] are prefetched too, by loading the index B[i] of a
+// later iteration, clamped to the last iteration so that the load is known to
+// be safe.
+//
+// When a sample profile of cache misses is given with -prefetch-miss-profile,
+// only the accesses that the profile finds missing often are prefetched. The
+// branch weights that a sample profile attaches to the loop latches limit how
+// far ahead short loops are prefetched.
+//
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "loop-data-prefetch"
@@ -26,17 +37,20 @@
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/IR/CFG.h"
+#include "llvm/IR/DebugInfoMetadata.h"
 #include "llvm/IR/DiagnosticInfo.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
+#include "llvm/ProfileData/SampleProfReader.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 using namespace llvm;
+using namespace sampleprof;
 
 // By default, we limit this to creating 16 PHIs (which is a little over half
 // of the allocatable register set).
@@ -57,7 +71,23 @@ static cl::opt<unsigned> MaxPrefetchIterationsAhead(
     "max-prefetch-iters-ahead",
     cl::desc("Max number of iterations to prefetch ahead"), cl::Hidden);
 
+static cl::opt<bool>
+    PrefetchIndirect("loop-prefetch-indirect", cl::Hidden,
+                     cl::desc("Prefetch indirect accesses like A[B[i]]"));
+
+static cl::opt<std::string> MissProfileFile(
+    "prefetch-miss-profile", cl::init(""), cl::value_desc("filename"),
+    cl::desc("Sample profile of cache misses that selects the accesses to "
+             "prefetch"),
+    cl::Hidden);
+
+static cl::opt<unsigned> MinMissPercent(
+    "prefetch-min-miss-percent", cl::init(5), cl::Hidden,
+    cl::desc("Min percentage of the cache miss samples of a function that an "
+             "access must have to be prefetched"));
+
 STATISTIC(NumPrefetches, "Number of prefetches inserted");
+STATISTIC(NumIndirectPrefetches, "Number of indirect prefetches inserted");
 
 namespace llvm {
   void initializeLoopDataPrefetchPass(PassRegistry&);
@@ -74,6 +104,7 @@ namespace {
 
     void getAnalysisUsage(AnalysisUsage &AU) const override {
       AU.addRequired<AssumptionCacheTracker>();
+      AU.addRequired<DominatorTreeWrapperPass>();
       AU.addPreserved<DominatorTreeWrapperPass>();
       AU.addRequired<LoopInfoWrapperPass>();
       AU.addPreserved<LoopInfoWrapperPass>();
@@ -84,11 +115,24 @@ namespace {
       AU.addRequired<TargetTransformInfoWrapperPass>();
     }
 
+    bool doInitialization(Module &M) override;
     bool runOnFunction(Function &F) override;
 
   private:
     bool runOnLoop(Loop *L);
 
+    /// \brief Check if the miss profile, if there is one, says that \p MemI
+    /// misses often enough to warrant a prefetch.
+    bool isMissFrequent(const Instruction *MemI);
+
+    /// \brief Prefetch the address \p PtrValue of \p MemI, which is indexed
+    /// by a load of another array, \p ItersAhead iterations ahead.
+    bool prefetchIndirect(Loop *L, Instruction *MemI, Value *PtrValue,
+                          unsigned ItersAhead);
+
+    /// \brief Insert a prefetch of \p PrefPtrValue for \p MemI.
+    void insertPrefetch(Instruction *MemI, Value *PrefPtrValue);
+
     /// \brief Check if the the stride of the accesses is large enough to
     /// warrant a prefetch.
     bool isStrideLargeEnough(const SCEVAddRecExpr *AR);
@@ -111,11 +155,22 @@ namespace {
       return TTI->getMaxPrefetchIterationsAhead();
     }
 
+    bool enableIndirectPrefetching() {
+      if (PrefetchIndirect.getNumOccurrences() > 0)
+        return PrefetchIndirect;
+      return TTI->enableIndirectPrefetching();
+    }
+
     AssumptionCache *AC;
+    DominatorTree *DT;
     LoopInfo *LI;
     ScalarEvolution *SE;
     const TargetTransformInfo *TTI;
     const DataLayout *DL;
+
+    /// The cache miss profile, and the samples of the current function.
+    std::unique_ptr<SampleProfileReader> MissProfile;
+    const FunctionSamples *MissSamples;
   };
 }
 
@@ -123,6 +178,7 @@ char LoopDataPrefetch::ID = 0;
 INITIALIZE_PASS_BEGIN(LoopDataPrefetch, "loop-data-prefetch",
                       "Loop Data Prefetch", false, false)
 INITIALIZE_PASS_DEPENDENCY(AssumptionCacheTracker)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
 INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
@@ -147,10 +203,182 @@ bool LoopDataPrefetch::isStrideLargeEnough(const SCEVAddRecExpr *AR) {
   return TargetMinStride <= AbsStride;
 }
 
+/// \brief Return the offset of the line of \p DIL from the start of its
+/// function, which is how sample profiles identify lines.
+static unsigned getOffset(const DILocation *DIL) {
+  return (DIL->getLine() - DIL->getScope()->getSubprogram()->getLine()) &
+         0xffff;
+}
+
+/// \brief Return the samples of the inlined function instance that \p DIL
+/// is in, within the samples \p FS of the function it was inlined into.
+static const FunctionSamples *findInlinedSamples(const FunctionSamples *FS,
+                                                 const DILocation *DIL) {
+  SmallVector<LineLocation, 10> S;
+  for (DIL = DIL->getInlinedAt(); DIL; DIL = DIL->getInlinedAt()) {
+    if (!DIL->getScope()->getSubprogram())
+      return nullptr;
+    S.push_back(LineLocation(getOffset(DIL), DIL->getDiscriminator()));
+  }
+  for (int I = S.size() - 1; I >= 0 && FS; --I)
+    FS = FS->findFunctionSamplesAt(S[I]);
+  return FS;
+}
+
+/// \brief Estimate the number of iterations that \p L runs with the branch
+/// weights of its latch, which come from a profile.
+static bool getProfiledTripCount(const Loop *L, uint64_t &TripCount) {
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch)
+    return false;
+  auto *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!BI || !BI->isConditional())
+    return false;
+  uint64_t TrueWeight, FalseWeight;
+  if (!BI->extractProfMetadata(TrueWeight, FalseWeight))
+    return false;
+  uint64_t BackedgeWeight = TrueWeight, ExitWeight = FalseWeight;
+  if (BI->getSuccessor(0) != L->getHeader())
+    std::swap(BackedgeWeight, ExitWeight);
+  if (!ExitWeight)
+    return false;
+  TripCount = BackedgeWeight / ExitWeight + 1;
+  return true;
+}
+
+bool LoopDataPrefetch::doInitialization(Module &M) {
+  if (MissProfileFile.empty())
+    return false;
+  LLVMContext &Ctx = M.getContext();
+  auto ReaderOrErr = SampleProfileReader::create(MissProfileFile, Ctx);
+  if (std::error_code EC = ReaderOrErr.getError()) {
+    std::string Msg = "Could not open profile: " + EC.message();
+    Ctx.diagnose(DiagnosticInfoSampleProfile(MissProfileFile, Msg));
+    return false;
+  }
+  MissProfile = std::move(ReaderOrErr.get());
+  if (MissProfile->read() != sampleprof_error::success)
+    MissProfile.reset();
+  return false;
+}
+
+bool LoopDataPrefetch::isMissFrequent(const Instruction *MemI) {
+  if (!MissProfile)
+    return true;
+  if (!MissSamples || !MissSamples->getTotalSamples())
+    return false;
+  const DILocation *DIL = MemI->getDebugLoc();
+  if (!DIL || !DIL->getScope()->getSubprogram())
+    return false;
+  const FunctionSamples *FS = findInlinedSamples(MissSamples, DIL);
+  if (!FS)
+    return false;
+  ErrorOr<uint64_t> Misses =
+      FS->findSamplesAt(getOffset(DIL), DIL->getDiscriminator());
+  if (!Misses)
+    return false;
+  DEBUG(dbgs() << "  " << *Misses << " miss samples for " << *MemI << "\n");
+  return *Misses * 100 >= MinMissPercent * MissSamples->getTotalSamples();
+}
+
+void LoopDataPrefetch::insertPrefetch(Instruction *MemI, Value *PrefPtrValue) {
+  IRBuilder<> Builder(MemI);
+  Module *M = MemI->getModule();
+  Type *I32 = Builder.getInt32Ty();
+  Value *PrefetchFunc = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
+  Builder.CreateCall(
+      PrefetchFunc,
+      {Builder.CreateBitCast(PrefPtrValue, Builder.getInt8PtrTy()),
+       ConstantInt::get(I32, MemI->mayReadFromMemory() ? 0 : 1),
+       ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)});
+}
+
+bool LoopDataPrefetch::prefetchIndirect(Loop *L, Instruction *MemI,
+                                        Value *PtrValue, unsigned ItersAhead) {
+  // Look for a single index that is loaded in the loop, possibly through
+  // casts.
+  auto *GEP = dyn_cast<GetElementPtrInst>(PtrValue);
+  if (!GEP || !L->contains(GEP) || !L->isLoopInvariant(GEP->getPointerOperand()))
+    return false;
+  LoadInst *IdxLoad = nullptr;
+  unsigned IdxOperand = 0;
+  SmallVector<CastInst *, 2> Casts;
+  for (unsigned I = 1, E = GEP->getNumOperands(); I != E; ++I) {
+    SmallVector<CastInst *, 2> OpCasts;
+    Value *V = GEP->getOperand(I);
+    while (auto *Cast = dyn_cast<CastInst>(V)) {
+      OpCasts.push_back(Cast);
+      V = Cast->getOperand(0);
+    }
+    auto *Load = dyn_cast<LoadInst>(V);
+    if (!Load || !L->contains(Load))
+      continue;
+    if (IdxLoad)
+      return false;
+    IdxLoad = Load;
+    IdxOperand = I;
+    Casts = std::move(OpCasts);
+  }
+  if (!IdxLoad || !IdxLoad->isSimple())
+    return false;
+
+  // The index of a later iteration is loaded ahead of time, so it must be
+  // loaded by every iteration of the loop, and every iteration up to the
+  // last one must run once the loop is entered.
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || L->getExitingBlock() != Latch ||
+      !DT->dominates(IdxLoad->getParent(), Latch))
+    return false;
+  for (BasicBlock *BB : L->blocks())
+    for (Instruction &I : *BB)
+      if (!isGuaranteedToTransferExecutionToSuccessor(&I))
+        return false;
+  const auto *IdxAddRec =
+      dyn_cast<SCEVAddRecExpr>(SE->getSCEV(IdxLoad->getPointerOperand()));
+  if (!IdxAddRec || IdxAddRec->getLoop() != L || !IdxAddRec->isAffine())
+    return false;
+  const SCEV *BackedgeTakenCount = SE->getBackedgeTakenCount(L);
+  if (isa<SCEVCouldNotCompute>(BackedgeTakenCount))
+    return false;
+
+  // Load the index of iteration min(i + ItersAhead, BackedgeTakenCount).
+  Type *CountTy = BackedgeTakenCount->getType();
+  const SCEV *Iteration = SE->getAddRecExpr(
+      SE->getZero(CountTy), SE->getOne(CountTy), L, SCEV::FlagAnyWrap);
+  const SCEV *AheadIteration = SE->getUMinExpr(
+      SE->getAddExpr(Iteration, SE->getConstant(CountTy, ItersAhead)),
+      BackedgeTakenCount);
+  const SCEV *NextIdxAddr =
+      IdxAddRec->evaluateAtIteration(AheadIteration, *SE);
+  if (!isSafeToExpand(NextIdxAddr, *SE))
+    return false;
+
+  SCEVExpander SCEVE(*SE, *DL, "prefidxaddr");
+  Value *NextIdxPtr = SCEVE.expandCodeFor(
+      NextIdxAddr, IdxLoad->getPointerOperand()->getType(), MemI);
+  auto *NextIdx = new LoadInst(NextIdxPtr, "prefidx", /*isVolatile=*/false,
+                               IdxLoad->getAlignment(), MemI);
+  Value *Idx = NextIdx;
+  for (CastInst *Cast : reverse(Casts)) {
+    Instruction *NewCast = Cast->clone();
+    NewCast->setOperand(0, Idx);
+    NewCast->insertBefore(MemI);
+    Idx = NewCast;
+  }
+  auto *NextGEP = cast<GetElementPtrInst>(GEP->clone());
+  NextGEP->setOperand(IdxOperand, Idx);
+  NextGEP->setIsInBounds(false);
+  NextGEP->setName("prefaddr");
+  NextGEP->insertBefore(MemI);
+  insertPrefetch(MemI, NextGEP);
+  return true;
+}
+
 bool LoopDataPrefetch::runOnFunction(Function &F) {
   if (skipFunction(F))
     return false;
 
+  DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
   LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
   SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
   DL = &F.getParent()->getDataLayout();
@@ -163,6 +391,7 @@ bool LoopDataPrefetch::runOnFunction(Function &F) {
   if (getPrefetchDistance() == 0)
     return false;
   assert(TTI->getCacheLineSize() && "Cache line size is not set for target");
+  MissSamples = MissProfile ? MissProfile->getSamplesFor(F) : nullptr;
 
   bool MadeChange = false;
 
@@ -210,12 +439,23 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
   if (ItersAhead > getMaxPrefetchIterationsAhead())
     return MadeChange;
 
+  // A prefetch for an iteration past the end of the loop is wasted, so don't
+  // prefetch further ahead than half the iterations that the profile says
+  // the loop runs.
+  uint64_t TripCount;
+  if (getProfiledTripCount(L, TripCount)) {
+    if (TripCount < 2)
+      return MadeChange;
+    ItersAhead = std::min<uint64_t>(ItersAhead, TripCount / 2);
+  }
+
   Function *F = L->getHeader()->getParent();
   DEBUG(dbgs() << "Prefetching " << ItersAhead
                << " iterations ahead (loop size: " << LoopSize << ") in "
                << F->getName() << ": " << *L);
 
   SmallVector<std::pair<Instruction *, const SCEVAddRecExpr *>, 16> PrefLoads;
+  SmallPtrSet<Value *, 16> IndirectPrefetched;
   for (Loop::block_iterator I = L->block_begin(), IE = L->block_end();
        I != IE; ++I) {
     for (BasicBlock::iterator J = (*I)->begin(), JE = (*I)->end();
@@ -239,10 +479,24 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
       if (L->isLoopInvariant(PtrValue))
         continue;
 
+      if (!isMissFrequent(MemI))
+        continue;
+
       const SCEV *LSCEV = SE->getSCEV(PtrValue);
       const SCEVAddRecExpr *LSCEVAddRec = dyn_cast<SCEVAddRecExpr>(LSCEV);
-      if (!LSCEVAddRec)
+      if (!LSCEVAddRec) {
+        if (enableIndirectPrefetching() &&
+            IndirectPrefetched.insert(PtrValue).second &&
+            prefetchIndirect(L, MemI, PtrValue, ItersAhead)) {
+          ++NumIndirectPrefetches;
+          DEBUG(dbgs() << "  Indirect access: " << *PtrValue << "\n");
+          emitOptimizationRemark(F->getContext(), DEBUG_TYPE, *F,
+                                 MemI->getDebugLoc(),
+                                 "prefetched indirect memory access");
+          MadeChange = true;
+        }
         continue;
+      }
 
       // Check if the the stride of the accesses is large enough to warrant a
       // prefetch.
@@ -280,16 +534,7 @@ bool LoopDataPrefetch::runOnLoop(Loop *L) {
       Type *I8Ptr = Type::getInt8PtrTy((*I)->getContext(), PtrAddrSpace);
       SCEVExpander SCEVE(*SE, J->getModule()->getDataLayout(), "prefaddr");
       Value *PrefPtrValue = SCEVE.expandCodeFor(NextLSCEV, I8Ptr, MemI);
-
-      IRBuilder<> Builder(MemI);
-      Module *M = (*I)->getParent()->getParent();
-      Type *I32 = Type::getInt32Ty((*I)->getContext());
-      Value *PrefetchFunc = Intrinsic::getDeclaration(M, Intrinsic::prefetch);
-      Builder.CreateCall(
-          PrefetchFunc,
-          {PrefPtrValue,
-           ConstantInt::get(I32, MemI->mayReadFromMemory() ? 0 : 1),
-           ConstantInt::get(I32, 3), ConstantInt::get(I32, 1)});
+      insertPrefetch(MemI, PrefPtrValue);
       ++NumPrefetches;
       DEBUG(dbgs() << "  Access: " << *PtrValue << ", SCEV: " << *LSCEV
                    << "\n");
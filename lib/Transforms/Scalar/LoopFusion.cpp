@@ -0,0 +1,411 @@
+//===- LoopFusion.cpp - Loop Fusion Pass ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Fusion Pass, the inverse of Loop Distribution.
+// It merges two adjacent innermost loops that run the same number of
+// iterations into one loop, so that arrays streamed by both loops are only
+// brought into the cache once.
+//
+// Two loops are adjacent when the exit block of the first one is the
+// preheader of the second one and contains nothing but the branch to it. The
+// trip counts are compared with ScalarEvolution. The fused loop runs an
+// iteration of the first loop body followed by an iteration of the second one,
+// which is only legal if no iteration of the second loop accesses memory that
+// a later iteration of the first loop writes, or the other way around. Like
+// the dependence checker of LoopAccessAnalysis, this is established on the
+// SCEV distances between the accesses of the two loops.
+//
+// Fusion is done when the loops access some of the same underlying objects,
+// and the values that the fused loop keeps live are estimated to fit in the
+// registers that TargetTransformInfo reports.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+#define LFUSE_NAME "loop-fusion"
+#define DEBUG_TYPE LFUSE_NAME
+
+using namespace llvm;
+
+static cl::opt<unsigned> FusionMinReuse(
+    "loop-fusion-min-reuse", cl::init(1), cl::Hidden,
+    cl::desc("The minimum number of underlying objects that both loops must "
+             "access for them to be fused"));
+
+static cl::opt<bool>
+    LFuseVerify("loop-fusion-verify", cl::Hidden,
+                cl::desc("Turn on DominatorTree and LoopInfo verification "
+                         "after Loop Fusion"),
+                cl::init(false));
+
+STATISTIC(NumLoopsFused, "Number of loops fused");
+
+namespace {
+/// \brief The memory accesses of a loop candidate for fusion.
+struct LoopAccesses {
+  SmallVector<Instruction *, 8> Loads;
+  SmallVector<Instruction *, 8> Stores;
+  SmallPtrSet<Value *, 8> Objects;
+};
+
+/// \brief Fuses the adjacent loops of a function.
+class LoopFuser {
+public:
+  LoopFuser(Function &F, LoopInfo *LI, DominatorTree *DT, ScalarEvolution *SE,
+            AliasAnalysis *AA, const TargetTransformInfo *TTI)
+      : F(F), LI(LI), DT(DT), SE(SE), AA(AA), TTI(TTI),
+        DL(F.getParent()->getDataLayout()) {}
+
+  /// \brief Fuse loops until no more adjacent loops can be fused.
+  bool run() {
+    bool Changed = false;
+    bool Fused;
+    do {
+      Fused = false;
+      SmallVector<Loop *, 8> Worklist;
+      for (Loop *TopLevelLoop : *LI)
+        for (Loop *L : depth_first(TopLevelLoop))
+          if (L->empty())
+            Worklist.push_back(L);
+      for (Loop *L : Worklist) {
+        Loop *Next = getAdjacentLoop(L);
+        if (Next && canFuse(L, Next) && isProfitable(L, Next)) {
+          fuse(L, Next);
+          Fused = Changed = true;
+          break;
+        }
+      }
+    } while (Fused);
+    return Changed;
+  }
+
+private:
+  /// \brief Returns the innermost loop that directly follows \p L in the same
+  /// loop nest, or null.
+  Loop *getAdjacentLoop(Loop *L) {
+    BasicBlock *Exit = L->getExitBlock();
+    if (!Exit || Exit->size() != 1 || !Exit->getSinglePredecessor())
+      return nullptr;
+    BasicBlock *Succ = Exit->getSingleSuccessor();
+    if (!Succ)
+      return nullptr;
+    Loop *Next = LI->getLoopFor(Succ);
+    if (!Next || Next == L || !Next->empty() || Next->getHeader() != Succ ||
+        Next->getLoopPreheader() != Exit ||
+        Next->getParentLoop() != L->getParentLoop())
+      return nullptr;
+    return Next;
+  }
+
+  /// \brief Checks that the loop has the shape that fusion works on and
+  /// collects its memory accesses.
+  bool isCandidate(Loop *L, LoopAccesses &Accesses) {
+    BasicBlock *Latch = L->getLoopLatch();
+    if (!L->isLoopSimplifyForm() || !Latch || L->getExitingBlock() != Latch)
+      return false;
+    auto *BI = dyn_cast<BranchInst>(Latch->getTerminator());
+    if (!BI || !BI->isConditional())
+      return false;
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB) {
+        if (auto *LD = dyn_cast<LoadInst>(&I)) {
+          if (!LD->isSimple())
+            return false;
+          Accesses.Loads.push_back(LD);
+        } else if (auto *ST = dyn_cast<StoreInst>(&I)) {
+          if (!ST->isSimple())
+            return false;
+          Accesses.Stores.push_back(ST);
+        } else if (I.mayReadOrWriteMemory() || I.mayHaveSideEffects()) {
+          return false;
+        }
+      }
+    for (Instruction *I : Accesses.Loads)
+      Accesses.Objects.insert(
+          GetUnderlyingObject(getLoadStorePointerOperand(I), DL));
+    for (Instruction *I : Accesses.Stores)
+      Accesses.Objects.insert(
+          GetUnderlyingObject(getLoadStorePointerOperand(I), DL));
+    return true;
+  }
+
+  static Value *getLoadStorePointerOperand(Instruction *I) {
+    if (auto *LD = dyn_cast<LoadInst>(I))
+      return LD->getPointerOperand();
+    return cast<StoreInst>(I)->getPointerOperand();
+  }
+
+  static Type *getAccessType(Instruction *I) {
+    if (auto *ST = dyn_cast<StoreInst>(I))
+      return ST->getValueOperand()->getType();
+    return I->getType();
+  }
+
+  /// \brief Returns true if running iteration i of \p A, an access of the
+  /// first loop \p L1, before the iterations j < i of \p B, an access of the
+  /// second loop \p L2, does not reorder two accesses to the same memory.
+  bool isSafeToReorder(Instruction *A, Loop *L1, Instruction *B, Loop *L2) {
+    Value *PtrA = getLoadStorePointerOperand(A);
+    Value *PtrB = getLoadStorePointerOperand(B);
+    if (AA->isNoAlias(MemoryLocation(GetUnderlyingObject(PtrA, DL)),
+                      MemoryLocation(GetUnderlyingObject(PtrB, DL))))
+      return true;
+
+    auto *ARA = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(PtrA));
+    auto *ARB = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(PtrB));
+    if (!ARA || !ARB || ARA->getLoop() != L1 || ARB->getLoop() != L2 ||
+        !ARA->isAffine() || !ARB->isAffine())
+      return false;
+    auto *StepA = dyn_cast<SCEVConstant>(ARA->getStepRecurrence(*SE));
+    auto *StepB = dyn_cast<SCEVConstant>(ARB->getStepRecurrence(*SE));
+    if (!StepA || StepA != StepB || StepA->isZero())
+      return false;
+    uint64_t SizeA = DL.getTypeStoreSize(getAccessType(A));
+    uint64_t SizeB = DL.getTypeStoreSize(getAccessType(B));
+    int64_t Step = StepA->getAPInt().getSExtValue();
+    if (SizeA != SizeB || SizeA > (uint64_t)std::abs(Step))
+      return false;
+
+    // Iteration i of A and iteration j of B access the same memory when
+    // j = i - Distance / Step; that must not be an earlier iteration than i.
+    auto *Distance = dyn_cast<SCEVConstant>(
+        SE->getMinusSCEV(ARB->getStart(), ARA->getStart()));
+    if (!Distance)
+      return false;
+    int64_t Dist = Distance->getAPInt().getSExtValue();
+    return Dist % Step == 0 && Dist / Step <= 0;
+  }
+
+  /// \brief Returns true if \p L1 and the adjacent loop \p L2 can be fused.
+  bool canFuse(Loop *L1, Loop *L2) {
+    DEBUG(dbgs() << "LFuse: Checking " << L1->getHeader()->getName()
+                 << " and " << L2->getHeader()->getName() << "\n");
+    Accesses1 = LoopAccesses();
+    Accesses2 = LoopAccesses();
+    if (!isCandidate(L1, Accesses1) || !isCandidate(L2, Accesses2)) {
+      DEBUG(dbgs() << "LFuse: Unsupported loop shape or instructions.\n");
+      return false;
+    }
+
+    const SCEV *BTC1 = SE->getBackedgeTakenCount(L1);
+    const SCEV *BTC2 = SE->getBackedgeTakenCount(L2);
+    if (isa<SCEVCouldNotCompute>(BTC1) || BTC1 != BTC2) {
+      DEBUG(dbgs() << "LFuse: Trip counts differ or are unknown.\n");
+      return false;
+    }
+
+    // The second loop runs after all of the first loop; it must not see any
+    // value that the first loop computes.
+    for (BasicBlock *BB : L1->blocks())
+      for (Instruction &I : *BB)
+        for (User *U : I.users())
+          if (!L1->contains(cast<Instruction>(U))) {
+            DEBUG(dbgs() << "LFuse: Value used after the first loop: " << I
+                         << "\n");
+            return false;
+          }
+
+    for (Instruction *S : Accesses1.Stores) {
+      for (Instruction *I : Accesses2.Loads)
+        if (!isSafeToReorder(S, L1, I, L2))
+          return false;
+      for (Instruction *I : Accesses2.Stores)
+        if (!isSafeToReorder(S, L1, I, L2))
+          return false;
+    }
+    for (Instruction *I : Accesses1.Loads)
+      for (Instruction *S : Accesses2.Stores)
+        if (!isSafeToReorder(I, L1, S, L2)) {
+          DEBUG(dbgs() << "LFuse: Fusion would reorder dependent accesses.\n");
+          return false;
+        }
+    return true;
+  }
+
+  /// \brief Collects the values that stay live through the iterations of
+  /// \p L into \p Live: its header phis and the invariants it uses.
+  static void collectLiveValues(Loop *L, SmallPtrSetImpl<Value *> &Live) {
+    for (BasicBlock *BB : L->blocks())
+      for (Instruction &I : *BB) {
+        if (isa<PHINode>(I) && BB == L->getHeader())
+          Live.insert(&I);
+        for (Value *Op : I.operands()) {
+          auto *OpI = dyn_cast<Instruction>(Op);
+          if ((OpI && !L->contains(OpI)) || isa<Argument>(Op))
+            Live.insert(Op);
+        }
+      }
+  }
+
+  /// \brief Returns true if fusing \p L1 and \p L2 is expected to pay off.
+  bool isProfitable(Loop *L1, Loop *L2) {
+    unsigned Reuse = 0;
+    for (Value *Obj : Accesses1.Objects)
+      Reuse += Accesses2.Objects.count(Obj);
+    if (Reuse < FusionMinReuse) {
+      DEBUG(dbgs() << "LFuse: The loops share " << Reuse
+                   << " underlying objects.\n");
+      return false;
+    }
+
+    SmallPtrSet<Value *, 16> Live;
+    collectLiveValues(L1, Live);
+    collectLiveValues(L2, Live);
+    unsigned NumRegs = TTI->getNumberOfRegisters(false);
+    if (Live.size() > NumRegs) {
+      DEBUG(dbgs() << "LFuse: " << Live.size() << " live values exceed the "
+                   << NumRegs << " registers.\n");
+      return false;
+    }
+    return true;
+  }
+
+  /// \brief Fuses \p L2 into \p L1, which it directly follows.
+  void fuse(Loop *L1, Loop *L2) {
+    BasicBlock *Preheader1 = L1->getLoopPreheader();
+    BasicBlock *Header1 = L1->getHeader();
+    BasicBlock *Latch1 = L1->getLoopLatch();
+    BasicBlock *Between = L2->getLoopPreheader();
+    BasicBlock *Header2 = L2->getHeader();
+    BasicBlock *Latch2 = L2->getLoopLatch();
+
+    emitOptimizationRemark(F.getContext(), LFUSE_NAME, F,
+                           L1->getStartLoc(), "fused with the next loop");
+    DEBUG(dbgs() << "LFuse: Fusing " << Header1->getName() << " and "
+                 << Header2->getName() << "\n");
+    SE->forgetLoop(L1);
+    SE->forgetLoop(L2);
+
+    // The back edge of the fused loop is the one of the second loop. The
+    // start values of its phis are available before the first loop, since
+    // nothing between the loops computes anything.
+    for (auto I = Header1->begin(); auto *PN = dyn_cast<PHINode>(I); ++I)
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Latch1), Latch2);
+    while (auto *PN = dyn_cast<PHINode>(&Header2->front())) {
+      PN->moveBefore(Header1->getFirstNonPHI());
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Between), Preheader1);
+    }
+
+    // The first loop body falls through to the second one, which branches
+    // back to the first one.
+    auto *BI1 = cast<BranchInst>(Latch1->getTerminator());
+    Value *Cond1 = BI1->getCondition();
+    BranchInst::Create(Header2, BI1);
+    BI1->eraseFromParent();
+    RecursivelyDeleteTriviallyDeadInstructions(Cond1);
+    auto *BI2 = cast<BranchInst>(Latch2->getTerminator());
+    for (unsigned I = 0, E = BI2->getNumSuccessors(); I != E; ++I)
+      if (BI2->getSuccessor(I) == Header2)
+        BI2->setSuccessor(I, Header1);
+
+    // Move the blocks of the second loop into the first one.
+    for (BasicBlock *BB : L2->blocks()) {
+      L1->addBlockEntry(BB);
+      LI->changeLoopFor(BB, L1);
+    }
+    if (Loop *Parent = L2->getParentLoop())
+      Parent->removeChildLoop(std::find(Parent->begin(), Parent->end(), L2));
+    else
+      LI->removeLoop(std::find(LI->begin(), LI->end(), L2));
+    delete L2;
+    LI->removeBlock(Between);
+    DeleteDeadBlock(Between);
+    DT->recalculate(F);
+
+    if (LFuseVerify) {
+      LI->verify();
+      DT->verifyDomTree();
+    }
+    ++NumLoopsFused;
+  }
+
+  Function &F;
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  AliasAnalysis *AA;
+  const TargetTransformInfo *TTI;
+  const DataLayout &DL;
+
+  /// The accesses of the loops being checked.
+  LoopAccesses Accesses1, Accesses2;
+};
+
+/// \brief The pass class.
+class LoopFusion : public FunctionPass {
+public:
+  static char ID;
+
+  LoopFusion() : FunctionPass(ID) {
+    initializeLoopFusionPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto *LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto *SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto *AA = &getAnalysis<AAResultsWrapperPass>().getAAResults();
+    auto *TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    return LoopFuser(F, LI, DT, SE, AA, TTI).run();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addRequired<AAResultsWrapperPass>();
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+} // anonymous namespace
+
+char LoopFusion::ID;
+static const char lfuse_name[] = "Loop Fusion";
+
+INITIALIZE_PASS_BEGIN(LoopFusion, LFUSE_NAME, lfuse_name, false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(AAResultsWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(LoopFusion, LFUSE_NAME, lfuse_name, false, false)
+
+namespace llvm {
+FunctionPass *createLoopFusionPass() { return new LoopFusion(); }
+}
@@ -561,7 +561,6 @@ struct LoopInterchange : public FunctionPass {
 
       // Update the DependencyMatrix
       interChangeDepedencies(DependencyMatrix, i, i - 1);
-      DT->recalculate(F);
 #ifdef DUMP_DEP_MATRICIES
       DEBUG(dbgs() << "Dependence after inter change \n");
       printDepMatrix(DependencyMatrix);
@@ -1194,26 +1193,40 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
   if (!InnerLoopHeaderSuccessor)
     return false;
 
+  // The edges that are changed below, to update the dominator tree with
+  // once they all are.
+  SmallVector<DominatorTree::UpdateType, 16> DTUpdates;
+  auto UpdateSuccessor = [&](BranchInst *BI, unsigned Idx, BasicBlock *NewBB) {
+    DTUpdates.push_back({DominatorTree::Delete, BI->getParent(),
+                         BI->getSuccessor(Idx)});
+    DTUpdates.push_back({DominatorTree::Insert, BI->getParent(), NewBB});
+    BI->setSuccessor(Idx, NewBB);
+  };
+
   // Adjust Loop Preheader and headers
 
   unsigned NumSucc = OuterLoopPredecessorBI->getNumSuccessors();
   for (unsigned i = 0; i < NumSucc; ++i) {
     if (OuterLoopPredecessorBI->getSuccessor(i) == OuterLoopPreHeader)
-      OuterLoopPredecessorBI->setSuccessor(i, InnerLoopPreHeader);
+      UpdateSuccessor(OuterLoopPredecessorBI, i, InnerLoopPreHeader);
   }
 
   NumSucc = OuterLoopHeaderBI->getNumSuccessors();
   for (unsigned i = 0; i < NumSucc; ++i) {
     if (OuterLoopHeaderBI->getSuccessor(i) == OuterLoopLatch)
-      OuterLoopHeaderBI->setSuccessor(i, LoopExit);
+      UpdateSuccessor(OuterLoopHeaderBI, i, LoopExit);
     else if (OuterLoopHeaderBI->getSuccessor(i) == InnerLoopPreHeader)
-      OuterLoopHeaderBI->setSuccessor(i, InnerLoopHeaderSuccessor);
+      UpdateSuccessor(OuterLoopHeaderBI, i, InnerLoopHeaderSuccessor);
   }
 
   // Adjust reduction PHI's now that the incoming block has changed.
   updateIncomingBlock(InnerLoopHeaderSuccessor, InnerLoopHeader,
                       OuterLoopHeader);
 
+  for (BasicBlock *Succ : InnerLoopHeaderBI->successors())
+    DTUpdates.push_back({DominatorTree::Delete, InnerLoopHeader, Succ});
+  DTUpdates.push_back(
+      {DominatorTree::Insert, InnerLoopHeader, OuterLoopPreHeader});
   BranchInst::Create(OuterLoopPreHeader, InnerLoopHeaderBI);
   InnerLoopHeaderBI->eraseFromParent();
 
@@ -1226,7 +1239,7 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
   NumSucc = InnerLoopLatchPredecessorBI->getNumSuccessors();
   for (unsigned i = 0; i < NumSucc; ++i) {
     if (InnerLoopLatchPredecessorBI->getSuccessor(i) == InnerLoopLatch)
-      InnerLoopLatchPredecessorBI->setSuccessor(i, InnerLoopLatchSuccessor);
+      UpdateSuccessor(InnerLoopLatchPredecessorBI, i, InnerLoopLatchSuccessor);
   }
 
   // Adjust PHI nodes in InnerLoopLatchSuccessor. Update all uses of PHI with
@@ -1249,18 +1262,20 @@ bool LoopInterchangeTransform::adjustLoopBranches() {
     OuterLoopLatchSuccessor = OuterLoopLatchBI->getSuccessor(0);
 
   if (InnerLoopLatchBI->getSuccessor(1) == InnerLoopLatchSuccessor)
-    InnerLoopLatchBI->setSuccessor(1, OuterLoopLatchSuccessor);
+    UpdateSuccessor(InnerLoopLatchBI, 1, OuterLoopLatchSuccessor);
   else
-    InnerLoopLatchBI->setSuccessor(0, OuterLoopLatchSuccessor);
+    UpdateSuccessor(InnerLoopLatchBI, 0, OuterLoopLatchSuccessor);
 
   updateIncomingBlock(OuterLoopLatchSuccessor, OuterLoopLatch, InnerLoopLatch);
 
   if (OuterLoopLatchBI->getSuccessor(0) == OuterLoopLatchSuccessor) {
-    OuterLoopLatchBI->setSuccessor(0, InnerLoopLatch);
+    UpdateSuccessor(OuterLoopLatchBI, 0, InnerLoopLatch);
   } else {
-    OuterLoopLatchBI->setSuccessor(1, InnerLoopLatch);
+    UpdateSuccessor(OuterLoopLatchBI, 1, InnerLoopLatch);
   }
 
+  if (DT)
+    DT->applyUpdates(DTUpdates);
   return true;
 }
 void LoopInterchangeTransform::adjustLoopPreheaders() {
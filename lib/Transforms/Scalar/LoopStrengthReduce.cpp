@@ -59,6 +59,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/IVUsers.h"
 #include "llvm/Analysis/LoopPass.h"
 #include "llvm/Analysis/ScalarEvolutionExpander.h"
@@ -80,6 +81,14 @@ using namespace llvm;
 
 #define DEBUG_TYPE "loop-reduce"
 
+STATISTIC(NumFormulaeGenerated, "Number of formulae generated for LSR uses");
+STATISTIC(NumFormulaeSolved,
+          "Number of formulae left for the LSR solver after narrowing");
+STATISTIC(NumSolverRatings, "Number of formulae rated by the LSR solver");
+STATISTIC(NumSolverBudgetExhausted,
+          "Number of loops where the LSR solver ran out of budget");
+STATISTIC(NumBeamSearches, "Number of LSR solutions found by beam search");
+
 /// MaxIVUsers is an arbitrary threshold that provides an early opportunitiy for
 /// bail out. This threshold is far beyond the number of users that LSR can
 /// conceivably solve, so it should not affect generated code, but catches the
@@ -94,6 +103,22 @@ static cl::opt<bool> EnablePhiElim(
   "enable-lsr-phielim", cl::Hidden, cl::init(true),
   cl::desc("Enable LSR phi elimination"));
 
+// The exhaustive solver may rate this many formulae per loop before it gives
+// up and falls back to beam search.
+static cl::opt<unsigned> LSRSolverBudget(
+  "lsr-solver-budget", cl::Hidden, cl::init(1u << 20),
+  cl::desc("Maximum number of formulae the exhaustive LSR solver rates per "
+           "loop"));
+
+static cl::opt<bool> LSRBeamSearch(
+  "lsr-beam-search", cl::Hidden, cl::init(false),
+  cl::desc("Choose LSR formulae with a beam search instead of the exhaustive "
+           "solver"));
+
+static cl::opt<unsigned> LSRBeamWidth(
+  "lsr-beam-width", cl::Hidden, cl::init(16),
+  cl::desc("Number of partial solutions the LSR beam search keeps per use"));
+
 #ifndef NDEBUG
 // Stress test IV chain generation.
 static cl::opt<bool> StressIVChain(
@@ -1740,7 +1765,10 @@ class LSRInstance {
                     SmallVectorImpl<const Formula *> &Workspace,
                     const Cost &CurCost,
                     const SmallPtrSet<const SCEV *, 16> &CurRegs,
-                    DenseSet<const SCEV *> &VisitedRegs) const;
+                    DenseSet<const SCEV *> &VisitedRegs,
+                    unsigned &Budget) const;
+  void SolveBeam(SmallVectorImpl<const Formula *> &Solution,
+                 Cost &SolutionCost) const;
   void Solve(SmallVectorImpl<const Formula *> &Solution) const;
 
   BasicBlock::iterator
@@ -4201,7 +4229,8 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
                                SmallVectorImpl<const Formula *> &Workspace,
                                const Cost &CurCost,
                                const SmallPtrSet<const SCEV *, 16> &CurRegs,
-                               DenseSet<const SCEV *> &VisitedRegs) const {
+                               DenseSet<const SCEV *> &VisitedRegs,
+                               unsigned &Budget) const {
   // Some ideas:
   //  - prune more:
   //    - use more aggressive filtering
@@ -4245,6 +4274,13 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
       continue;
     }
 
+    // Give up on the whole search once it has rated too many formulae; the
+    // caller keeps the best solution found so far.
+    if (Budget == 0)
+      return;
+    --Budget;
+    ++NumSolverRatings;
+
     // Evaluate the cost of the current formula. If it's already worse than
     // the current best, prune the search at that point.
     NewCost = CurCost;
@@ -4255,7 +4291,7 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
       Workspace.push_back(&F);
       if (Workspace.size() != Uses.size()) {
         SolveRecurse(Solution, SolutionCost, Workspace, NewCost,
-                     NewRegs, VisitedRegs);
+                     NewRegs, VisitedRegs, Budget);
         if (F.getNumRegs() == 1 && Workspace.size() == 1)
           VisitedRegs.insert(F.ScaledReg ? F.ScaledReg : F.BaseRegs[0]);
       } else {
@@ -4273,6 +4309,54 @@ void LSRInstance::SolveRecurse(SmallVectorImpl<const Formula *> &Solution,
   }
 }
 
+/// This is the beam search solver. It visits the uses in order and only keeps
+/// the LSRBeamWidth cheapest partial solutions after each one, so its running
+/// time is linear in the number of uses. Unlike the exhaustive solver it may
+/// miss the cheapest solution.
+void LSRInstance::SolveBeam(SmallVectorImpl<const Formula *> &Solution,
+                            Cost &SolutionCost) const {
+  struct PartialSolution {
+    SmallVector<const Formula *, 8> Formulae;
+    Cost C;
+    SmallPtrSet<const SCEV *, 16> Regs;
+  };
+
+  const DenseSet<const SCEV *> VisitedRegs;
+  unsigned Width = std::max(1u, unsigned(LSRBeamWidth));
+  std::vector<PartialSolution> Beam(1), Next;
+  for (const LSRUse &LU : Uses) {
+    Next.clear();
+    for (const PartialSolution &P : Beam) {
+      for (const Formula &F : LU.Formulae) {
+        ++NumSolverRatings;
+        PartialSolution N;
+        N.C = P.C;
+        N.Regs = P.Regs;
+        N.C.RateFormula(TTI, F, N.Regs, VisitedRegs, L, LU.Offsets, SE, DT,
+                        LU);
+        if (N.C.isLoser())
+          continue;
+        N.Formulae = P.Formulae;
+        N.Formulae.push_back(&F);
+        Next.push_back(std::move(N));
+      }
+    }
+    if (Next.empty())
+      return;
+
+    std::stable_sort(Next.begin(), Next.end(),
+                     [](const PartialSolution &A, const PartialSolution &B) {
+                       return A.C < B.C;
+                     });
+    if (Next.size() > Width)
+      Next.erase(Next.begin() + Width, Next.end());
+    Beam.swap(Next);
+  }
+
+  Solution = Beam.front().Formulae;
+  SolutionCost = Beam.front().C;
+}
+
 /// Choose one formula from each use. Return the results in the given Solution
 /// vector.
 void LSRInstance::Solve(SmallVectorImpl<const Formula *> &Solution) const {
@@ -4284,9 +4368,37 @@ void LSRInstance::Solve(SmallVectorImpl<const Formula *> &Solution) const {
   DenseSet<const SCEV *> VisitedRegs;
   Workspace.reserve(Uses.size());
 
-  // SolveRecurse does all the work.
-  SolveRecurse(Solution, SolutionCost, Workspace, CurCost,
-               CurRegs, VisitedRegs);
+  for (const LSRUse &LU : Uses)
+    NumFormulaeSolved += LU.Formulae.size();
+
+  if (LSRBeamSearch) {
+    SolveBeam(Solution, SolutionCost);
+    if (!Solution.empty())
+      ++NumBeamSearches;
+  } else {
+    // SolveRecurse does all the work.
+    unsigned Budget = LSRSolverBudget;
+    SolveRecurse(Solution, SolutionCost, Workspace, CurCost,
+                 CurRegs, VisitedRegs, Budget);
+
+    // If the search was cut short, the beam search may still do better than
+    // whatever the exhaustive solver found before it stopped.
+    if (Budget == 0) {
+      ++NumSolverBudgetExhausted;
+      DEBUG(dbgs() << "LSR solver ran out of budget, trying beam search.\n");
+      SmallVector<const Formula *, 8> BeamSolution;
+      Cost BeamCost;
+      BeamCost.Lose();
+      SolveBeam(BeamSolution, BeamCost);
+      if (!BeamSolution.empty() &&
+          (Solution.empty() || BeamCost < SolutionCost)) {
+        Solution = BeamSolution;
+        SolutionCost = BeamCost;
+        ++NumBeamSearches;
+      }
+    }
+  }
+
   if (Solution.empty()) {
     DEBUG(dbgs() << "\nNo Satisfactory Solution\n");
     return;
@@ -4848,6 +4960,8 @@ LSRInstance::LSRInstance(Loop *L, IVUsers &IU, ScalarEvolution &SE,
   // Now use the reuse data to generate a bunch of interesting ways
   // to formulate the values needed for the uses.
   GenerateAllReuseFormulae();
+  for (const LSRUse &LU : Uses)
+    NumFormulaeGenerated += LU.Formulae.size();
 
   FilterOutUndesirableDedicatedRegisters();
   NarrowSearchSpaceUsingHeuristics();
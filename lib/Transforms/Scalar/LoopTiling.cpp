@@ -0,0 +1,479 @@
+//===- LoopTiling.cpp - Loop Tiling Pass ----------------------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the Loop Tiling Pass. It tiles the two innermost loops
+// of a perfect loop nest for cache locality:
+//
+//   for (i = 0; i < N; ++i)              for (jj = 0; jj < M; jj += T)
+//     for (j = 0; j < M; ++j)      =>      for (i = 0; i < N; ++i)
+//       A[i][j] = B[j][i];                   for (j = jj; j < min(jj+T, M); ++j)
+//                                              A[i][j] = B[j][i];
+//
+// The tile loop around the nest runs the inner loop over a strip of T
+// iterations for every iteration of the outer loop, so that the cache lines
+// the strip touches are reused by the next iterations of the outer loop
+// instead of being evicted by the rest of the inner loop.
+//
+// The outer and inner iterations of different tiles execute in a different
+// order, which is legal if DependenceAnalysis finds no dependence with the
+// direction (<, >) on the two loops. The tile size is chosen so that the
+// cache lines touched by a tile fill half of the first level data cache that
+// TargetTransformInfo reports.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/DependenceAnalysis.h"
+#include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpander.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Utils/Local.h"
+#include "llvm/Transforms/Utils/LoopUtils.h"
+
+#define LTILE_NAME "loop-tile"
+#define DEBUG_TYPE LTILE_NAME
+
+using namespace llvm;
+
+static cl::opt<unsigned> TileSize(
+    "loop-tile-size", cl::init(0), cl::Hidden,
+    cl::desc("The number of inner loop iterations in a tile. By default it is "
+             "derived from the cache parameters of the target"));
+
+static cl::opt<bool>
+    LTileVerify("loop-tile-verify", cl::Hidden,
+                cl::desc("Turn on DominatorTree and LoopInfo verification "
+                         "after Loop Tiling"),
+                cl::init(false));
+
+STATISTIC(NumLoopsTiled, "Number of loop nests tiled");
+
+namespace {
+/// \brief The inner loop of a nest that can be tiled.
+struct TileCandidate {
+  /// The induction variable of the inner loop, which counts up by one.
+  PHINode *IV = nullptr;
+  /// The value of the induction variable on the back edge.
+  Value *IVNext = nullptr;
+  /// The number of iterations of the inner loop.
+  const SCEV *TripCount = nullptr;
+  /// The loads and stores of the nest.
+  SmallVector<Instruction *, 8> MemInsts;
+};
+
+/// \brief Tiles the loop nests of a function.
+class LoopTiler {
+public:
+  LoopTiler(Function &F, LoopInfo *LI, DominatorTree *DT, ScalarEvolution *SE,
+            DependenceInfo *DI, const TargetTransformInfo *TTI)
+      : F(F), LI(LI), DT(DT), SE(SE), DI(DI), TTI(TTI),
+        DL(F.getParent()->getDataLayout()) {}
+
+  bool run() {
+    SmallVector<Loop *, 8> Worklist;
+    for (Loop *TopLevelLoop : *LI)
+      for (Loop *L : depth_first(TopLevelLoop))
+        if (L->empty() && L->getParentLoop())
+          Worklist.push_back(L);
+
+    bool Changed = false;
+    for (Loop *Inner : Worklist) {
+      Loop *Outer = Inner->getParentLoop();
+      TileCandidate C;
+      if (!isCandidate(Outer, Inner, C) || !isLegal(Outer, C))
+        continue;
+      unsigned Size = getTileSize(Outer, Inner, C);
+      if (!Size)
+        continue;
+      tile(Outer, Inner, C, Size);
+      Changed = true;
+    }
+    return Changed;
+  }
+
+private:
+  /// \brief Checks that \p Outer and \p Inner form a perfect nest with a
+  /// rectangular iteration space, and collects the memory accesses of the
+  /// nest.
+  bool isCandidate(Loop *Outer, Loop *Inner, TileCandidate &C) {
+    if (Outer->getSubLoops().size() != 1 || !Outer->isLoopSimplifyForm() ||
+        !Inner->isLoopSimplifyForm())
+      return false;
+    BasicBlock *OuterLatch = Outer->getLoopLatch();
+    BasicBlock *InnerLatch = Inner->getLoopLatch();
+    if (Outer->getExitingBlock() != OuterLatch ||
+        Inner->getExitingBlock() != InnerLatch ||
+        !Outer->getExitBlock())
+      return false;
+    auto *BI = dyn_cast<BranchInst>(InnerLatch->getTerminator());
+    if (!BI || !BI->isConditional())
+      return false;
+
+    // Every iteration of the outer loop must run the inner loop, or the tile
+    // loop would be driven by the trip count of an inner loop that does not
+    // run.
+    if (!DT->dominates(Inner->getLoopPreheader(), OuterLatch)) {
+      DEBUG(dbgs() << "LTile: The inner loop is guarded.\n");
+      return false;
+    }
+
+    // The phis of the outer loop are repeated for every tile, so they may
+    // only be inductions.
+    for (auto I = Outer->getHeader()->begin(); auto *PN = dyn_cast<PHINode>(I);
+         ++I) {
+      auto *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(&*PN));
+      if (!AR || AR->getLoop() != Outer)
+        return false;
+    }
+
+    // The inner loop only has an induction variable counting up by one from
+    // a value that does not depend on the outer loop.
+    BasicBlock *InnerHeader = Inner->getHeader();
+    if (!isa<PHINode>(InnerHeader->front()) ||
+        isa<PHINode>(InnerHeader->front().getNextNode()))
+      return false;
+    C.IV = cast<PHINode>(&InnerHeader->front());
+    auto *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(C.IV));
+    if (!C.IV->getType()->isIntegerTy() || !AR || AR->getLoop() != Inner ||
+        !AR->isAffine() || !AR->getStepRecurrence(*SE)->isOne())
+      return false;
+    if (!Outer->isLoopInvariant(
+            C.IV->getIncomingValueForBlock(Inner->getLoopPreheader())))
+      return false;
+    C.IVNext = C.IV->getIncomingValueForBlock(InnerLatch);
+    if (SE->getSCEV(C.IVNext) != AR->getPostIncExpr(*SE))
+      return false;
+
+    const SCEV *BackedgeTakenCount = SE->getBackedgeTakenCount(Inner);
+    if (isa<SCEVCouldNotCompute>(BackedgeTakenCount) ||
+        !SE->isLoopInvariant(BackedgeTakenCount, Outer) ||
+        BackedgeTakenCount->getType() != C.IV->getType()) {
+      DEBUG(dbgs() << "LTile: The inner trip count varies.\n");
+      return false;
+    }
+    C.TripCount = SE->getAddExpr(BackedgeTakenCount,
+                                 SE->getOne(BackedgeTakenCount->getType()));
+    if (!isSafeToExpand(C.TripCount, *SE))
+      return false;
+
+    // The instructions of the outer loop that are not in the inner one run
+    // once per tile, so they must not have side effects. Nothing but the
+    // memory may carry values out of the loops, since each loop now runs
+    // a different number of times.
+    for (BasicBlock *BB : Outer->blocks()) {
+      bool InInner = Inner->contains(BB);
+      Loop *Owner = InInner ? Inner : Outer;
+      for (Instruction &I : *BB) {
+        if (InInner && I.mayReadOrWriteMemory()) {
+          if (auto *Load = dyn_cast<LoadInst>(&I)) {
+            if (!Load->isSimple())
+              return false;
+          } else if (auto *Store = dyn_cast<StoreInst>(&I)) {
+            if (!Store->isSimple())
+              return false;
+          } else {
+            return false;
+          }
+          C.MemInsts.push_back(&I);
+        } else if (I.mayHaveSideEffects() || I.mayReadFromMemory()) {
+          return false;
+        }
+        for (User *U : I.users())
+          if (!Owner->contains(cast<Instruction>(U))) {
+            DEBUG(dbgs() << "LTile: " << I << " is used outside its loop.\n");
+            return false;
+          }
+      }
+    }
+    return true;
+  }
+
+  /// \brief Checks with DependenceAnalysis that the nest does not have a
+  /// dependence that tiling would reverse.
+  bool isLegal(Loop *Outer, TileCandidate &C) {
+    unsigned OuterLevel = Outer->getLoopDepth();
+    for (unsigned I = 0, E = C.MemInsts.size(); I != E; ++I)
+      for (unsigned J = I; J != E; ++J) {
+        Instruction *Src = C.MemInsts[I];
+        Instruction *Dst = C.MemInsts[J];
+        if (isa<LoadInst>(Src) && isa<LoadInst>(Dst))
+          continue;
+        auto D = DI->depends(Src, Dst, true);
+        if (!D)
+          continue;
+        if (D->isConfused() || D->getLevels() <= OuterLevel) {
+          DEBUG(dbgs() << "LTile: Unknown dependence between " << *Src
+                       << " and " << *Dst << "\n");
+          return false;
+        }
+        if (isCarriedOutside(*D, OuterLevel))
+          continue;
+        unsigned OuterDir = D->getDirection(OuterLevel);
+        unsigned InnerDir = D->getDirection(OuterLevel + 1);
+        if (((OuterDir & Dependence::DVEntry::LT) &&
+             (InnerDir & Dependence::DVEntry::GT)) ||
+            ((OuterDir & Dependence::DVEntry::GT) &&
+             (InnerDir & Dependence::DVEntry::LT))) {
+          DEBUG(dbgs() << "LTile: Tiling reverses the dependence between "
+                       << *Src << " and " << *Dst << "\n");
+          return false;
+        }
+      }
+    return true;
+  }
+
+  /// \brief Returns true if the dependence \p D is carried by a loop around
+  /// the nest, whose iterations keep their order.
+  static bool isCarriedOutside(Dependence &D, unsigned OuterLevel) {
+    for (unsigned Level = 1; Level < OuterLevel; ++Level)
+      if (!(D.getDirection(Level) & Dependence::DVEntry::EQ))
+        return true;
+    return false;
+  }
+
+  /// \brief Returns the constant distance in bytes between the addresses that
+  /// \p Ptr takes in two consecutive iterations of \p L, or false if it is
+  /// not known.
+  bool getStride(const SCEV *Ptr, const Loop *L, int64_t &Stride) {
+    // Look through the recurrences of the inner loops.
+    auto *AR = dyn_cast<SCEVAddRecExpr>(Ptr);
+    while (AR && AR->getLoop() != L && L->contains(AR->getLoop())) {
+      Ptr = AR->getStart();
+      AR = dyn_cast<SCEVAddRecExpr>(Ptr);
+    }
+    if (SE->isLoopInvariant(Ptr, L)) {
+      Stride = 0;
+      return true;
+    }
+    if (!AR || AR->getLoop() != L || !AR->isAffine())
+      return false;
+    auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+    if (!Step)
+      return false;
+    Stride = Step->getAPInt().getSExtValue();
+    return true;
+  }
+
+  /// \brief Returns the number of inner loop iterations of a tile, or 0 if
+  /// tiling the nest is not profitable.
+  unsigned getTileSize(Loop *Outer, Loop *Inner, TileCandidate &C) {
+    unsigned LineSize = TTI->getCacheLineSize();
+    unsigned CacheSize = TTI->getCacheSize();
+    if (!TileSize && (!LineSize || !CacheSize)) {
+      DEBUG(dbgs() << "LTile: The cache parameters of the target are not "
+                      "known.\n");
+      return 0;
+    }
+    if (!LineSize)
+      LineSize = 64;
+
+    // A tile is worth it if the outer loop reuses what a strip of the inner
+    // loop touches: either the same elements, or the other elements of the
+    // cache lines of an access that steps over a line in the inner loop.
+    // Each inner iteration brings in at most a line per access.
+    bool HasReuse = false;
+    uint64_t BytesPerIteration = 0;
+    for (Instruction *I : C.MemInsts) {
+      Value *Addr = isa<LoadInst>(I) ? cast<LoadInst>(I)->getPointerOperand()
+                                     : cast<StoreInst>(I)->getPointerOperand();
+      const SCEV *Ptr = SE->getSCEV(Addr);
+      int64_t InnerStride, OuterStride;
+      if (!getStride(Ptr, Inner, InnerStride)) {
+        BytesPerIteration += LineSize;
+        continue;
+      }
+      if (!InnerStride)
+        continue;
+      uint64_t Distance = std::abs(InnerStride);
+      BytesPerIteration += std::min<uint64_t>(Distance, LineSize);
+      if (getStride(Ptr, Outer, OuterStride) &&
+          (!OuterStride ||
+           (Distance >= LineSize &&
+            (uint64_t)std::abs(OuterStride) < LineSize)))
+        HasReuse = true;
+    }
+    if (!HasReuse || !BytesPerIteration) {
+      DEBUG(dbgs() << "LTile: The outer loop does not reuse the data of the "
+                      "inner loop.\n");
+      return 0;
+    }
+
+    unsigned Size = TileSize;
+    if (!Size) {
+      // Leave the other half of the cache to the data that only the outer
+      // loop steps through, and to conflicts.
+      uint64_t Iterations = CacheSize / 2 / BytesPerIteration;
+      if (Iterations < 2)
+        return 0;
+      Size = PowerOf2Floor(Iterations);
+    }
+
+    // A tile that covers the whole inner loop changes nothing.
+    if (auto *TC = dyn_cast<SCEVConstant>(C.TripCount))
+      if (TC->getAPInt().ule(Size)) {
+        DEBUG(dbgs() << "LTile: The inner loop fits in a tile.\n");
+        return 0;
+      }
+    return Size;
+  }
+
+  /// \brief Wraps the nest in a loop over the tiles of the inner loop.
+  void tile(Loop *Outer, Loop *Inner, TileCandidate &C, unsigned Size) {
+    BasicBlock *Preheader = Outer->getLoopPreheader();
+    BasicBlock *Header = Outer->getHeader();
+    BasicBlock *Latch = Outer->getLoopLatch();
+    BasicBlock *Exit = Outer->getExitBlock();
+    BasicBlock *InnerPreheader = Inner->getLoopPreheader();
+    BasicBlock *InnerLatch = Inner->getLoopLatch();
+
+    emitOptimizationRemark(F.getContext(), LTILE_NAME, F, Outer->getStartLoc(),
+                           "tiled with " + Twine(Size) +
+                               " inner loop iterations per tile");
+    DEBUG(dbgs() << "LTile: Tiling " << Header->getName() << " with tile size "
+                 << Size << "\n");
+    SE->forgetLoop(Outer);
+
+    Type *Ty = C.IV->getType();
+    SCEVExpander Exp(*SE, DL, "tile");
+    Value *TripCount =
+        Exp.expandCodeFor(C.TripCount, Ty, Preheader->getTerminator());
+    Constant *Step = ConstantInt::get(Ty, Size);
+
+    // The tile loop goes around the outer loop, and computes the range of
+    // the inner loop iterations of the tile.
+    LLVMContext &Ctx = F.getContext();
+    BasicBlock *TileHeader =
+        BasicBlock::Create(Ctx, "tile.header", &F, Header);
+    BasicBlock *TileLatch = BasicBlock::Create(Ctx, "tile.latch", &F, Exit);
+    Preheader->getTerminator()->replaceUsesOfWith(Header, TileHeader);
+    Latch->getTerminator()->replaceUsesOfWith(Exit, TileLatch);
+    for (auto I = Header->begin(); auto *PN = dyn_cast<PHINode>(I); ++I)
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Preheader), TileHeader);
+    for (auto I = Exit->begin(); auto *PN = dyn_cast<PHINode>(I); ++I)
+      PN->setIncomingBlock(PN->getBasicBlockIndex(Latch), TileLatch);
+
+    IRBuilder<> Builder(TileHeader);
+    PHINode *Offset = Builder.CreatePHI(Ty, 2, "tile.offset");
+    Value *Remaining = Builder.CreateSub(TripCount, Offset, "tile.remaining");
+    Value *IsLast = Builder.CreateICmpULE(Remaining, Step, "tile.last");
+    Value *Count = Builder.CreateSelect(IsLast, Remaining, Step, "tile.count");
+    Value *Begin = Builder.CreateAdd(
+        C.IV->getIncomingValueForBlock(InnerPreheader), Offset, "tile.begin");
+    Value *End = Builder.CreateAdd(Begin, Count, "tile.end");
+    Builder.CreateBr(Header);
+
+    Builder.SetInsertPoint(TileLatch);
+    Value *NextOffset = Builder.CreateAdd(Offset, Step, "tile.offset.next");
+    Builder.CreateCondBr(IsLast, Exit, TileHeader);
+    Offset->addIncoming(ConstantInt::get(Ty, 0), Preheader);
+    Offset->addIncoming(NextOffset, TileLatch);
+
+    // The inner loop runs over the iterations of the tile.
+    C.IV->setIncomingValue(C.IV->getBasicBlockIndex(InnerPreheader), Begin);
+    auto *BI = cast<BranchInst>(InnerLatch->getTerminator());
+    Value *OldCond = BI->getCondition();
+    ICmpInst::Predicate Pred = BI->getSuccessor(0) == Inner->getHeader()
+                                   ? ICmpInst::ICMP_NE
+                                   : ICmpInst::ICMP_EQ;
+    BI->setCondition(new ICmpInst(BI, Pred, C.IVNext, End, "tile.cond"));
+    RecursivelyDeleteTriviallyDeadInstructions(OldCond);
+
+    // Put the new loop in LoopInfo, between the outer loop and its parent.
+    Loop *TileLoop = new Loop();
+    if (Loop *Parent = Outer->getParentLoop())
+      Parent->replaceChildLoopWith(Outer, TileLoop);
+    else
+      LI->changeTopLevelLoop(Outer, TileLoop);
+    TileLoop->addChildLoop(Outer);
+    TileLoop->addBasicBlockToLoop(TileHeader, *LI);
+    for (BasicBlock *BB : Outer->blocks())
+      TileLoop->addBlockEntry(BB);
+    TileLoop->addBasicBlockToLoop(TileLatch, *LI);
+    DT->recalculate(F);
+
+    if (LTileVerify) {
+      LI->verify();
+      DT->verifyDomTree();
+    }
+    ++NumLoopsTiled;
+  }
+
+  Function &F;
+  LoopInfo *LI;
+  DominatorTree *DT;
+  ScalarEvolution *SE;
+  DependenceInfo *DI;
+  const TargetTransformInfo *TTI;
+  const DataLayout &DL;
+};
+
+/// \brief The pass class.
+class LoopTiling : public FunctionPass {
+public:
+  static char ID;
+
+  LoopTiling() : FunctionPass(ID) {
+    initializeLoopTilingPass(*PassRegistry::getPassRegistry());
+  }
+
+  bool runOnFunction(Function &F) override {
+    if (skipFunction(F))
+      return false;
+
+    auto *LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    auto *DT = &getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    auto *SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
+    auto *DI = &getAnalysis<DependenceAnalysisWrapperPass>().getDI();
+    auto *TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
+    return LoopTiler(F, LI, DT, SE, DI, TTI).run();
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequiredID(LCSSAID);
+    AU.addRequired<ScalarEvolutionWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addRequired<DependenceAnalysisWrapperPass>();
+    AU.addRequired<TargetTransformInfoWrapperPass>();
+    AU.addPreserved<GlobalsAAWrapperPass>();
+  }
+};
+} // anonymous namespace
+
+char LoopTiling::ID;
+static const char ltile_name[] = "Loop Tiling";
+
+INITIALIZE_PASS_BEGIN(LoopTiling, LTILE_NAME, ltile_name, false, false)
+INITIALIZE_PASS_DEPENDENCY(LoopSimplify)
+INITIALIZE_PASS_DEPENDENCY(LCSSA)
+INITIALIZE_PASS_DEPENDENCY(LoopInfoWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(ScalarEvolutionWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(DependenceAnalysisWrapperPass)
+INITIALIZE_PASS_DEPENDENCY(TargetTransformInfoWrapperPass)
+INITIALIZE_PASS_END(LoopTiling, LTILE_NAME, ltile_name, false, false)
+
+namespace llvm {
+FunctionPass *createLoopTilingPass() { return new LoopTiling(); }
+}
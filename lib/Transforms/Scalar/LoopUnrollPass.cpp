@@ -95,6 +95,19 @@ static cl::opt<unsigned> PragmaUnrollThreshold(
     cl::desc("Unrolled size limit for loops with an unroll(full) or "
              "unroll_count pragma."));
 
+static cl::opt<unsigned> UnrollPeelMaxCount(
+    "unroll-peel-max-count", cl::init(7), cl::Hidden,
+    cl::desc("Max average trip count which will cause loop peeling."));
+
+static cl::opt<unsigned> UnrollForcePeelCount(
+    "unroll-force-peel-count", cl::init(0), cl::Hidden,
+    cl::desc("Force a peel count regardless of profiling information."));
+
+static cl::opt<bool> UnrollAllowPeeling(
+    "unroll-allow-peeling", cl::Hidden,
+    cl::desc("Allows loops to be peeled when the dynamic "
+             "trip count is known to be low."));
+
 /// A magic value for use with the Threshold parameter to indicate
 /// that the loop unroll should be performed regardless of how much
 /// code expansion would result.
@@ -127,6 +140,8 @@ static TargetTransformInfo::UnrollingPreferences gatherUnrollingPreferences(
   UP.AllowRemainder = true;
   UP.AllowExpensiveTripCount = false;
   UP.Force = false;
+  UP.PeelCount = 0;
+  UP.AllowPeeling = true;
 
   // Override with any target specific settings
   TTI.getUnrollingPreferences(L, UP);
@@ -157,6 +172,8 @@ static TargetTransformInfo::UnrollingPreferences gatherUnrollingPreferences(
     UP.AllowRemainder = UnrollAllowRemainder;
   if (UnrollRuntime.getNumOccurrences() > 0)
     UP.Runtime = UnrollRuntime;
+  if (UnrollAllowPeeling.getNumOccurrences() > 0)
+    UP.AllowPeeling = UnrollAllowPeeling;
 
   // Apply user values provided by argument
   if (UserThreshold.hasValue()) {
@@ -687,6 +704,59 @@ static bool canUnrollCompletely(Loop *L, unsigned Threshold,
   return false;
 }
 
+/// Return the average trip count profiled for \p L, or None if the function
+/// has no profile or the loop latch has no branch weights.
+static Optional<unsigned> getProfiledTripCount(Loop *L) {
+  if (!L->getHeader()->getParent()->getEntryCount())
+    return None;
+  return getLoopEstimatedTripCount(L);
+}
+
+/// Compute the number of iterations to peel off \p L and write it to
+/// UP.PeelCount.
+static void computePeelCount(Loop *L, unsigned LoopSize,
+                             TargetTransformInfo::UnrollingPreferences &UP) {
+  UP.PeelCount = 0;
+  if (!canPeel(L))
+    return;
+
+  // Only try to peel innermost loops.
+  if (!L->empty())
+    return;
+
+  // If the user provided a peel count, use that.
+  if (UnrollForcePeelCount.getNumOccurrences() > 0) {
+    DEBUG(dbgs() << "Force-peeling first " << UnrollForcePeelCount
+                 << " iterations.\n");
+    UP.PeelCount = UnrollForcePeelCount;
+    return;
+  }
+
+  if (!UP.AllowPeeling)
+    return;
+
+  // If we don't know the trip count, but have reason to believe the average
+  // trip count is low, peeling should be beneficial, since we will usually
+  // hit the peeled section. We only do this in the presence of profile
+  // information, since otherwise our estimates of the trip count are not
+  // reliable enough.
+  Optional<unsigned> PeelCount = getProfiledTripCount(L);
+  if (!PeelCount || !*PeelCount)
+    return;
+
+  DEBUG(dbgs() << "Profile-based estimated trip count is " << *PeelCount
+               << "\n");
+  if (*PeelCount <= UnrollPeelMaxCount &&
+      (uint64_t)LoopSize * (*PeelCount + 1) <= UP.Threshold) {
+    DEBUG(dbgs() << "Peeling first " << *PeelCount << " iterations.\n");
+    UP.PeelCount = *PeelCount;
+    return;
+  }
+  DEBUG(dbgs() << "Not peeling: max peel count " << UnrollPeelMaxCount
+               << ", peel cost " << (uint64_t)LoopSize * (*PeelCount + 1)
+               << ", max peel cost " << UP.Threshold << "\n");
+}
+
 // Returns true if unroll count was set explicitly.
 // Calculates unroll count and writes it to UP.Count.
 static bool computeUnrollCount(Loop *L, const TargetTransformInfo &TTI,
@@ -836,7 +906,18 @@ static bool computeUnrollCount(Loop *L, const TargetTransformInfo &TTI,
         "Unable to fully unroll loop as directed by unroll(full) pragma "
         "because loop has a runtime trip count.");
 
-  // 5th priority is runtime unrolling.
+  // 5th priority is loop peeling, for loops whose profiled trip count is
+  // low enough that they usually never reach the loop itself.
+  if (!ExplicitUnroll) {
+    computePeelCount(L, LoopSize, UP);
+    if (UP.PeelCount) {
+      UP.Runtime = false;
+      UP.Count = 0;
+      return false;
+    }
+  }
+
+  // 6th priority is runtime unrolling.
   // Don't unroll a runtime trip count loop when it is disabled.
   if (HasRuntimeUnrollDisablePragma(L)) {
     UP.Count = 0;
@@ -861,6 +942,19 @@ static bool computeUnrollCount(Loop *L, const TargetTransformInfo &TTI,
     UnrolledSize = (LoopSize - BEInsns) * UP.Count + BEInsns;
   }
 
+  // Unrolling by more than the profiled trip count would send most runs
+  // straight to the remainder loop, so unroll by at most the largest power
+  // of two that fits.
+  if (!UserUnrollCount && PragmaCount == 0) {
+    Optional<unsigned> ProfiledTripCount = getProfiledTripCount(L);
+    if (ProfiledTripCount && *ProfiledTripCount &&
+        UP.Count > *ProfiledTripCount) {
+      DEBUG(dbgs() << "  reducing runtime unroll count to the profiled trip "
+                   << "count " << *ProfiledTripCount << "\n");
+      UP.Count = PowerOf2Floor(*ProfiledTripCount);
+    }
+  }
+
 #ifndef NDEBUG
   unsigned OrigCount = UP.Count;
 #endif
@@ -958,6 +1052,12 @@ static bool tryToUnrollLoop(Loop *L, DominatorTree &DT, LoopInfo *LI,
 
   bool IsCountSetExplicitly = computeUnrollCount(L, TTI, DT, LI, SE, TripCount,
                                                  TripMultiple, LoopSize, UP);
+
+  // Peeling replaces unrolling: the few iterations that usually run are
+  // peeled off and the loop itself is left alone.
+  if (UP.PeelCount)
+    return peelLoop(L, UP.PeelCount, LI, SE, &DT, &AC, PreserveLCSSA);
+
   if (!UP.Count)
     return false;
   // Unroll factor (Count) must be less or equal to TripCount.
@@ -42,6 +42,7 @@
 #include "llvm/Analysis/BlockFrequencyInfo.h"
 #include "llvm/Analysis/BranchProbabilityInfo.h"
 #include "llvm/Support/BranchProbability.h"
+#include "llvm/IR/CompileTimeBudget.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Dominators.h"
@@ -423,6 +424,13 @@ bool LoopUnswitch::runOnLoop(Loop *L, LPPassManager &LPM_Ref) {
   if (skipLoop(L))
     return false;
 
+  // Unswitching duplicates loops, don't do it in functions that are already
+  // over the compile-time budget.
+  Function &Fn = *L->getHeader()->getParent();
+  if (!Fn.getContext().getCompileTimeBudget().shouldRunExpensivePass(
+          "loop-unswitch", Fn))
+    return false;
+
   AC = &getAnalysis<AssumptionCacheTracker>().getAssumptionCache(
       *L->getHeader()->getParent());
   LI = &getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
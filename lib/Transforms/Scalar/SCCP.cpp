@@ -26,6 +26,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Analysis/ConstantFolding.h"
 #include "llvm/Analysis/GlobalsModRef.h"
+#include "llvm/Analysis/InlineCost.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/IR/Constants.h"
@@ -33,13 +34,16 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Scalar/SCCP.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/Local.h"
 #include <algorithm>
 using namespace llvm;
@@ -52,6 +56,21 @@ STATISTIC(NumDeadBlocks , "Number of basic blocks unreachable");
 STATISTIC(IPNumInstRemoved, "Number of instructions removed by IPSCCP");
 STATISTIC(IPNumArgsElimed ,"Number of arguments constant propagated by IPSCCP");
 STATISTIC(IPNumGlobalConst, "Number of globals found to be constant by IPSCCP");
+STATISTIC(IPNumSpecialized, "Number of functions specialized by IPSCCP");
+
+static cl::opt<bool> SpecializeFunctions(
+    "ipsccp-specialize-functions", cl::init(false), cl::Hidden,
+    cl::desc("Clone functions for the constant arguments their call sites "
+             "pass before running IPSCCP"));
+
+static cl::opt<unsigned> SpecializationBudget(
+    "ipsccp-specialization-budget", cl::init(1000), cl::Hidden,
+    cl::desc("Maximum number of instructions function specialization may "
+             "add to a module"));
+
+static cl::opt<unsigned> MaxClonesPerFunction(
+    "ipsccp-max-clones", cl::init(3), cl::Hidden,
+    cl::desc("Maximum number of specializations of a single function"));
 
 namespace {
 /// LatticeVal class - This class represents the different lattice values that
@@ -1703,8 +1722,186 @@ static bool AddressIsTaken(const GlobalValue *GV) {
   return false;
 }
 
+namespace {
+/// A set of call sites that pass the same constants to a function, and a
+/// specialization of the function for them.
+struct SpecializationCandidate {
+  Function *F;
+  /// The argument numbers and constants to specialize for.
+  SmallVector<std::pair<unsigned, Constant *>, 4> Args;
+  SmallVector<CallSite, 4> CallSites;
+  /// The size of the clone and what it is expected to save, in the units of
+  /// InlineCost.
+  int Cost;
+  int Benefit;
+};
+} // end anonymous namespace
+
+/// Returns the cost of cloning \p F, in the units of InlineCost.
+static int getSpecializationCost(const Function &F) {
+  int Cost = 0;
+  for (const BasicBlock &BB : F)
+    for (const Instruction &I : BB)
+      if (!isa<DbgInfoIntrinsic>(I))
+        Cost += InlineConstants::InstrCost;
+  return Cost;
+}
+
+/// Returns what knowing that \p A is \p C is expected to save in one call,
+/// in the units of InlineCost.
+static int getSpecializationBonus(Argument *A, Constant *C) {
+  int Bonus = 0;
+  for (User *U : A->users()) {
+    auto *I = dyn_cast<Instruction>(U);
+    if (!I)
+      continue;
+
+    // An indirect call becomes direct, and can then be inlined.
+    CallSite CS(I);
+    if (CS && CS.getCalledValue() == A && isa<Function>(C)) {
+      Bonus += InlineConstants::IndirectCallThreshold;
+      continue;
+    }
+
+    // A branch on a flag folds away, and so does the compare feeding one.
+    if (isa<BranchInst>(I) || isa<SwitchInst>(I) ||
+        (isa<SelectInst>(I) && cast<SelectInst>(I)->getCondition() == A)) {
+      Bonus += InlineConstants::CallPenalty;
+      continue;
+    }
+    Bonus += InlineConstants::InstrCost;
+    if (isa<CmpInst>(I))
+      for (User *CmpUser : I->users())
+        if (isa<BranchInst>(CmpUser) || isa<SelectInst>(CmpUser))
+          Bonus += InlineConstants::CallPenalty;
+  }
+  return Bonus;
+}
+
+/// Collect the groups of direct call sites of \p F that pass the same
+/// constant function pointers or integers, and that are worth a clone of \p F.
+static void
+collectSpecializationCandidates(Function &F,
+                               std::vector<SpecializationCandidate> &Out) {
+  if (F.isDeclaration() || F.isVarArg() || !F.hasExactDefinition() ||
+      F.hasFnAttribute(Attribute::NoDuplicate) ||
+      F.hasFnAttribute(Attribute::OptimizeNone) ||
+      F.hasFnAttribute(Attribute::OptimizeForSize) ||
+      F.hasFnAttribute(Attribute::MinSize))
+    return;
+
+  std::vector<SpecializationCandidate> Groups;
+  unsigned NumCalls = 0;
+  for (Use &U : F.uses()) {
+    CallSite CS(U.getUser());
+    if (!CS || !CS.isCallee(&U) || CS.getCaller() == &F)
+      continue;
+    ++NumCalls;
+
+    SpecializationCandidate Candidate;
+    Candidate.F = &F;
+    for (Argument &A : F.args()) {
+      auto *C = dyn_cast<Constant>(CS.getArgument(A.getArgNo()));
+      if (!C || A.use_empty() || (!isa<ConstantInt>(C) && !isa<Function>(C)))
+        continue;
+      Candidate.Args.push_back(std::make_pair(A.getArgNo(), C));
+    }
+    if (Candidate.Args.empty())
+      continue;
+
+    auto It = std::find_if(Groups.begin(), Groups.end(),
+                           [&](const SpecializationCandidate &G) {
+                             return G.Args == Candidate.Args;
+                           });
+    if (It == Groups.end()) {
+      Groups.push_back(std::move(Candidate));
+      It = std::prev(Groups.end());
+    }
+    It->CallSites.push_back(CS);
+  }
+  if (Groups.empty())
+    return;
+
+  // If all calls agree and nothing else can call F, IPSCCP propagates the
+  // constants into F itself.
+  if (Groups.size() == 1 && Groups[0].CallSites.size() == NumCalls &&
+      F.hasLocalLinkage() && !AddressIsTaken(&F))
+    return;
+
+  int Cost = getSpecializationCost(F);
+  for (SpecializationCandidate &Candidate : Groups) {
+    int Bonus = 0;
+    for (auto &Arg : Candidate.Args)
+      Bonus += getSpecializationBonus(&*std::next(F.arg_begin(), Arg.first),
+                                      Arg.second);
+    Candidate.Cost = Cost;
+    Candidate.Benefit = Bonus * Candidate.CallSites.size();
+    DEBUG(dbgs() << "IPSCCP: Specializing " << F.getName() << " for "
+                 << Candidate.CallSites.size() << " call sites would cost "
+                 << Cost << " and save " << Candidate.Benefit << "\n");
+    if (Candidate.Benefit > Cost)
+      Out.push_back(std::move(Candidate));
+  }
+}
+
+/// Clone functions for the constant arguments groups of their call sites
+/// agree on, so that the solver can propagate those constants into the
+/// clones. Indirect calls through function pointer arguments become direct.
+/// Clones are made in order of benefit, within a module-wide size budget.
+static bool specializeFunctions(Module &M) {
+  std::vector<SpecializationCandidate> Candidates;
+  for (Function &F : M)
+    collectSpecializationCandidates(F, Candidates);
+  if (Candidates.empty())
+    return false;
+
+  std::stable_sort(Candidates.begin(), Candidates.end(),
+                   [](const SpecializationCandidate &L,
+                      const SpecializationCandidate &R) {
+                     return L.Benefit - L.Cost > R.Benefit - R.Cost;
+                   });
+
+  unsigned Budget = SpecializationBudget;
+  DenseMap<Function *, unsigned> NumClones;
+  SmallPtrSet<Function *, 8> Specialized;
+  for (SpecializationCandidate &Candidate : Candidates) {
+    Function *F = Candidate.F;
+    unsigned Size = Candidate.Cost / InlineConstants::InstrCost;
+    unsigned &Clones = NumClones[F];
+    if (Size > Budget || Clones >= MaxClonesPerFunction)
+      continue;
+    Budget -= Size;
+
+    ValueToValueMapTy VMap;
+    Function *Clone = CloneFunction(F, VMap);
+    Clone->setName(F->getName() + ".specialized." + Twine(++Clones));
+    Clone->setLinkage(GlobalValue::InternalLinkage);
+    Clone->setVisibility(GlobalValue::DefaultVisibility);
+    Clone->setComdat(nullptr);
+    for (auto &Arg : Candidate.Args)
+      std::next(Clone->arg_begin(), Arg.first)->replaceAllUsesWith(Arg.second);
+    for (CallSite CS : Candidate.CallSites)
+      CS.setCalledFunction(Clone);
+
+    DEBUG(dbgs() << "IPSCCP: Specialized " << F->getName() << " as "
+                 << Clone->getName() << "\n");
+    Specialized.insert(F);
+    ++IPNumSpecialized;
+  }
+
+  // Functions whose calls all went to clones are dead now.
+  for (Function *F : Specialized) {
+    F->removeDeadConstantUsers();
+    if (F->hasLocalLinkage() && F->use_empty())
+      F->eraseFromParent();
+  }
+  return !Specialized.empty();
+}
+
 static bool runIPSCCP(Module &M, const DataLayout &DL,
                       const TargetLibraryInfo *TLI) {
+  bool Specialized = SpecializeFunctions && specializeFunctions(M);
+
   SCCPSolver Solver(DL, TLI);
 
   // AddressTakenFunctions - This set keeps track of the address-taken functions
@@ -1947,7 +2144,7 @@ static bool runIPSCCP(Module &M, const DataLayout &DL,
     ++IPNumGlobalConst;
   }
 
-  return MadeChanges;
+  return MadeChanges || Specialized;
 }
 
 PreservedAnalyses IPSCCPPass::run(Module &M, AnalysisManager<Module> &AM) {
@@ -66,6 +66,10 @@ using namespace llvm::sroa;
 #define DEBUG_TYPE "sroa"
 
 STATISTIC(NumAllocasAnalyzed, "Number of allocas analyzed for replacement");
+STATISTIC(NumAllocaSlices, "Number of alloca slices formed");
+STATISTIC(MaxSlicesPerAlloca, "Maximum number of slices per alloca");
+STATISTIC(NumAllocasTooManySlices,
+          "Number of allocas not split due to too many slices");
 STATISTIC(NumAllocaPartitions, "Number of alloca partitions formed");
 STATISTIC(MaxPartitionsPerAlloca, "Maximum number of partitions per alloca");
 STATISTIC(NumAllocaPartitionUses, "Number of alloca partition uses rewritten");
@@ -86,6 +90,15 @@ static cl::opt<bool> SROARandomShuffleSlices("sroa-random-shuffle-slices",
 static cl::opt<bool> SROAStrictInbounds("sroa-strict-inbounds", cl::init(false),
                                         cl::Hidden);
 
+/// Hidden option to bound the number of slices of a single alloca which we
+/// are willing to split and rewrite. Partitioning and rewriting an alloca with
+/// tens of thousands of uses is very expensive and tends to produce a huge
+/// number of new allocas, so such allocas are left alone.
+static cl::opt<unsigned> SROAMaxAllocaSlices(
+    "sroa-max-alloca-slices", cl::init(1024), cl::Hidden,
+    cl::desc("Maximum number of alloca slices allowed after which splitting "
+             "is not attempted"));
+
 namespace {
 /// \brief A custom IRBuilder inserter which prefixes all names, but only in
 /// Assert builds.
@@ -3960,8 +3973,20 @@ bool SROA::splitAlloca(AllocaInst &AI, AllocaSlices &AS) {
   // splittable (non-whole-alloca) loads and stores as unsplittable. If we fail
   // to split these during pre-splitting, we want to force them to be
   // rewritten into a partition.
-  bool IsSorted = true;
-  for (Slice &S : AS) {
+  //
+  // Making a slice unsplittable only moves it within the run of slices that
+  // share its begin offset, so rather than re-sorting every slice we re-sort
+  // just the runs that changed.
+  AllocaSlices::iterator RunI = AS.begin();
+  bool IsRunSorted = true;
+  for (AllocaSlices::iterator I = AS.begin(), E = AS.end(); I != E; ++I) {
+    Slice &S = *I;
+    if (S.beginOffset() != RunI->beginOffset()) {
+      if (!IsRunSorted)
+        std::sort(RunI, I);
+      RunI = I;
+      IsRunSorted = true;
+    }
     if (!S.isSplittable())
       continue;
     // FIXME: We currently leave whole-alloca splittable loads and stores. This
@@ -3974,11 +3999,11 @@ bool SROA::splitAlloca(AllocaInst &AI, AllocaSlices &AS) {
     if (isa<LoadInst>(S.getUse()->getUser()) ||
         isa<StoreInst>(S.getUse()->getUser())) {
       S.makeUnsplittable();
-      IsSorted = false;
+      IsRunSorted = false;
     }
   }
-  if (!IsSorted)
-    std::sort(AS.begin(), AS.end());
+  if (!IsRunSorted)
+    std::sort(RunI, AS.end());
 
   /// \brief Describes the allocas introduced by rewritePartition
   /// in order to migrate the debug info.
@@ -4122,6 +4147,20 @@ bool SROA::runOnAlloca(AllocaInst &AI) {
   if (AS.begin() == AS.end())
     return Changed;
 
+  unsigned NumSlices = AS.end() - AS.begin();
+  NumAllocaSlices += NumSlices;
+  MaxSlicesPerAlloca = std::max<unsigned>(NumSlices, MaxSlicesPerAlloca);
+
+  // Give up on allocas with so many slices that partitioning and rewriting
+  // them would dominate compile time. The alloca is left as it is, apart from
+  // the cleanup of dead uses above.
+  if (NumSlices > SROAMaxAllocaSlices) {
+    DEBUG(dbgs() << "  Not splitting alloca with " << NumSlices
+                 << " slices\n");
+    ++NumAllocasTooManySlices;
+    return Changed;
+  }
+
   Changed |= splitAlloca(AI, AS);
 
   DEBUG(dbgs() << "  Speculating PHIs\n");
@@ -33,6 +33,31 @@ using namespace llvm::PatternMatch;
 
 #define DEBUG_TYPE "loop-utils"
 
+/// Returns the select of the select(cmp()) min/max pattern that \p Cmp is the
+/// compare of, or null. Besides that select, whose operands are the ones of
+/// the compare, the compare may feed one other select: the one that updates
+/// the index of a min/max recurrence (see isMinMaxIndexPHI).
+static SelectInst *findMinMaxSelect(Instruction *Cmp) {
+  if (Cmp->hasOneUse())
+    return dyn_cast<SelectInst>(*Cmp->user_begin());
+  if (!Cmp->hasNUses(2))
+    return nullptr;
+  SelectInst *Found = nullptr;
+  for (User *U : Cmp->users()) {
+    auto *Select = dyn_cast<SelectInst>(U);
+    if (!Select || Select->getCondition() != Cmp)
+      return nullptr;
+    Value *LHS = Cmp->getOperand(0), *RHS = Cmp->getOperand(1);
+    Value *TV = Select->getTrueValue(), *FV = Select->getFalseValue();
+    if ((TV == LHS && FV == RHS) || (TV == RHS && FV == LHS)) {
+      if (Found)
+        return nullptr;
+      Found = Select;
+    }
+  }
+  return Found;
+}
+
 bool RecurrenceDescriptor::areAllUsesIn(Instruction *I,
                                         SmallPtrSetImpl<Instruction *> &Set) {
   for (User::op_iterator Use = I->op_begin(), E = I->op_end(); Use != E; ++Use)
@@ -51,6 +76,7 @@ bool RecurrenceDescriptor::isIntegerRecurrenceKind(RecurrenceKind Kind) {
   case RK_IntegerAnd:
   case RK_IntegerXor:
   case RK_IntegerMinMax:
+  case RK_MinMaxIndex:
     return true;
   }
   return false;
@@ -192,6 +218,8 @@ bool RecurrenceDescriptor::AddReductionVar(PHINode *Phi, RecurrenceKind Kind,
   //  to make sure we only see exactly the two instructions.
   unsigned NumCmpSelectPatternInst = 0;
   InstDesc ReduxDesc(false, nullptr);
+  // Set if the compare of a min/max pattern also selects an index.
+  bool FoundIndexSelect = false;
 
   // Data used for determining if the recurrence has been type-promoted.
   Type *RecurrenceType = Phi->getType();
@@ -292,6 +320,15 @@ bool RecurrenceDescriptor::AddReductionVar(PHINode *Phi, RecurrenceKind Kind,
     for (User *U : Cur->users()) {
       Instruction *UI = cast<Instruction>(U);
 
+      // The compare of a min/max pattern may also select the index of the
+      // minimum, which is a separate recurrence.
+      if ((Kind == RK_IntegerMinMax || Kind == RK_FloatMinMax) &&
+          isa<CmpInst>(Cur) && isa<SelectInst>(UI) &&
+          findMinMaxSelect(Cur) != UI) {
+        FoundIndexSelect = true;
+        continue;
+      }
+
       // Check if we found the exit user.
       BasicBlock *Parent = UI->getParent();
       if (!TheLoop->contains(Parent)) {
@@ -341,6 +378,11 @@ bool RecurrenceDescriptor::AddReductionVar(PHINode *Phi, RecurrenceKind Kind,
       NumCmpSelectPatternInst != 2)
     return false;
 
+  // A min/max whose index is selected may only be needed for the index.
+  if (!ExitInstruction && FoundIndexSelect)
+    ExitInstruction = dyn_cast<Instruction>(
+        Phi->getIncomingValueForBlock(TheLoop->getLoopLatch()));
+
   if (!FoundStartPHI || !FoundReduxOp || !ExitInstruction)
     return false;
 
@@ -380,7 +422,7 @@ RecurrenceDescriptor::isMinMaxSelectCmpPattern(Instruction *I, InstDesc &Prev) {
   // We must handle the select(cmp()) as a single instruction. Advance to the
   // select.
   if ((Cmp = dyn_cast<ICmpInst>(I)) || (Cmp = dyn_cast<FCmpInst>(I))) {
-    if (!Cmp->hasOneUse() || !(Select = dyn_cast<SelectInst>(*I->user_begin())))
+    if (!(Select = findMinMaxSelect(Cmp)))
       return InstDesc(false, I);
     return InstDesc(Select, Prev.getMinMaxKind());
   }
@@ -391,7 +433,7 @@ RecurrenceDescriptor::isMinMaxSelectCmpPattern(Instruction *I, InstDesc &Prev) {
   if (!(Cmp = dyn_cast<ICmpInst>(I->getOperand(0))) &&
       !(Cmp = dyn_cast<FCmpInst>(I->getOperand(0))))
     return InstDesc(false, I);
-  if (!Cmp->hasOneUse())
+  if (findMinMaxSelect(Cmp) != Select)
     return InstDesc(false, I);
 
   Value *CmpLeft;
@@ -519,6 +561,102 @@ bool RecurrenceDescriptor::isReductionPHI(PHINode *Phi, Loop *TheLoop,
   return false;
 }
 
+bool RecurrenceDescriptor::isMinMaxIndexPHI(PHINode *Phi, Loop *TheLoop,
+                                            ScalarEvolution *SE,
+                                            RecurrenceDescriptor &RedDes) {
+  BasicBlock *Preheader = TheLoop->getLoopPreheader();
+  BasicBlock *Latch = TheLoop->getLoopLatch();
+  if (Phi->getParent() != TheLoop->getHeader() || !Preheader || !Latch ||
+      Phi->getNumIncomingValues() != 2 || !Phi->getType()->isIntegerTy() ||
+      !Phi->hasOneUse())
+    return false;
+
+  // The index is updated by a select on the compare of the min/max pattern,
+  // and only used outside of the loop.
+  auto *IdxSel = dyn_cast<SelectInst>(Phi->getIncomingValueForBlock(Latch));
+  if (!IdxSel || *Phi->user_begin() != IdxSel || !TheLoop->contains(IdxSel))
+    return false;
+  for (User *U : IdxSel->users())
+    if (U != Phi && TheLoop->contains(cast<Instruction>(U)))
+      return false;
+  auto *Cmp = dyn_cast<CmpInst>(IdxSel->getCondition());
+  if (!Cmp || !Cmp->hasNUses(2))
+    return false;
+  SelectInst *ValSel = findMinMaxSelect(Cmp);
+  if (!ValSel || ValSel == IdxSel)
+    return false;
+
+  // The new index must be taken exactly when the new value is.
+  bool NewIdxOnTrue = IdxSel->getFalseValue() == Phi;
+  if (!NewIdxOnTrue && IdxSel->getTrueValue() != Phi)
+    return false;
+  Value *NewIdx = NewIdxOnTrue ? IdxSel->getTrueValue() : IdxSel->getFalseValue();
+  auto *ValPhi = dyn_cast<PHINode>(NewIdxOnTrue ? ValSel->getFalseValue()
+                                                : ValSel->getTrueValue());
+  if (!ValPhi || ValPhi == Phi || ValPhi->getParent() != Phi->getParent() ||
+      ValPhi->getNumIncomingValues() != 2 ||
+      ValPhi->getIncomingValueForBlock(Latch) != ValSel)
+    return false;
+  Value *NewVal = NewIdxOnTrue ? ValSel->getTrueValue() : ValSel->getFalseValue();
+
+  // Normalize the compare to "NewVal pred ValPhi" selecting the new value.
+  CmpInst::Predicate Pred = Cmp->getPredicate();
+  if (Cmp->getOperand(0) != NewVal)
+    Pred = CmpInst::getSwappedPredicate(Pred);
+  if (!NewIdxOnTrue)
+    Pred = CmpInst::getInversePredicate(Pred);
+
+  // Ties keep the old index, so that it is the one of the first minimum or
+  // maximum. NaNs are ruled out by the function attribute that floating-point
+  // min/max recurrences require.
+  MinMaxRecurrenceKind MinMaxKind = MRK_Invalid;
+  switch (Pred) {
+  default:
+    return false;
+  case CmpInst::ICMP_ULT:
+    MinMaxKind = MRK_UIntMin;
+    break;
+  case CmpInst::ICMP_UGT:
+    MinMaxKind = MRK_UIntMax;
+    break;
+  case CmpInst::ICMP_SLT:
+    MinMaxKind = MRK_SIntMin;
+    break;
+  case CmpInst::ICMP_SGT:
+    MinMaxKind = MRK_SIntMax;
+    break;
+  case CmpInst::FCMP_OLT:
+  case CmpInst::FCMP_ULT:
+    MinMaxKind = MRK_FloatMin;
+    break;
+  case CmpInst::FCMP_OGT:
+  case CmpInst::FCMP_UGT:
+    MinMaxKind = MRK_FloatMax;
+    break;
+  }
+
+  // The vectorized index is the smallest index of the lanes holding the
+  // extreme value, so the new index must be an increasing induction that does
+  // not wrap.
+  if (NewIdx->getType() != Phi->getType())
+    return false;
+  auto *AR = dyn_cast<SCEVAddRecExpr>(SE->getSCEV(NewIdx));
+  if (!AR || AR->getLoop() != TheLoop || !AR->isAffine() ||
+      !AR->getNoWrapFlags(SCEV::FlagNUW))
+    return false;
+  auto *Step = dyn_cast<SCEVConstant>(AR->getStepRecurrence(*SE));
+  if (!Step || !Step->getAPInt().isStrictlyPositive())
+    return false;
+
+  SmallPtrSet<Instruction *, 4> CastInsts;
+  RedDes = RecurrenceDescriptor(Phi->getIncomingValueForBlock(Preheader),
+                                IdxSel, RK_MinMaxIndex, MinMaxKind, nullptr,
+                                Phi->getType(), false, CastInsts);
+  RedDes.IndexedMinMaxInstr = ValSel;
+  DEBUG(dbgs() << "Found a MINMAX index PHI." << *Phi << "\n");
+  return true;
+}
+
 bool RecurrenceDescriptor::isFirstOrderRecurrence(PHINode *Phi, Loop *TheLoop,
                                                   DominatorTree *DT) {
 
@@ -601,6 +739,7 @@ unsigned RecurrenceDescriptor::getRecurrenceBinOp(RecurrenceKind Kind) {
   case RK_FloatAdd:
     return Instruction::FAdd;
   case RK_IntegerMinMax:
+  case RK_MinMaxIndex:
     return Instruction::ICmp;
   case RK_FloatMinMax:
     return Instruction::FCmp;
@@ -925,3 +1064,40 @@ Optional<const MDOperand *> llvm::findStringMetadataForLoop(Loop *TheLoop,
   }
   return None;
 }
+
+Optional<unsigned> llvm::getLoopEstimatedTripCount(Loop *L) {
+  // Only support loops whose latch is their single exiting block.
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Latch || L->getExitingBlock() != Latch)
+    return None;
+
+  BranchInst *LatchBR = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (!LatchBR || LatchBR->getNumSuccessors() != 2)
+    return None;
+
+  assert((LatchBR->getSuccessor(0) == L->getHeader() ||
+          LatchBR->getSuccessor(1) == L->getHeader()) &&
+         "At least one edge out of the latch must go to the header");
+
+  // The number of times the body runs per entry is one more than the ratio of
+  // backedges taken to exits taken.
+  uint64_t TrueVal, FalseVal;
+  if (!LatchBR->extractProfMetadata(TrueVal, FalseVal))
+    return None;
+
+  if (!TrueVal || !FalseVal)
+    return 0;
+
+  uint64_t BackedgeWeight, ExitWeight;
+  if (LatchBR->getSuccessor(0) == L->getHeader()) {
+    BackedgeWeight = TrueVal;
+    ExitWeight = FalseVal;
+  } else {
+    BackedgeWeight = FalseVal;
+    ExitWeight = TrueVal;
+  }
+
+  // Divide rounding to nearest.
+  uint64_t TripCount = (BackedgeWeight + ExitWeight / 2) / ExitWeight + 1;
+  return TripCount > UINT_MAX ? UINT_MAX : unsigned(TripCount);
+}
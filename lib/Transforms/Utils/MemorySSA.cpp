@@ -628,6 +628,19 @@ bool MemorySSA::locallyDominates(const MemoryAccess *Dominator,
                       [&](const MemoryAccess &MA) { return &MA == Dominatee; });
 }
 
+bool MemorySSA::dominates(const MemoryAccess *Dominator,
+                          const MemoryAccess *Dominatee) const {
+  // The live on entry def is not in any access list, and comes before
+  // everything else.
+  if (isLiveOnEntryDef(Dominator))
+    return true;
+  if (isLiveOnEntryDef(Dominatee))
+    return false;
+  if (Dominator->getBlock() != Dominatee->getBlock())
+    return DT->dominates(Dominator->getBlock(), Dominatee->getBlock());
+  return locallyDominates(Dominator, Dominatee);
+}
+
 const static char LiveOnEntryStr[] = "liveOnEntry";
 
 void MemoryDef::print(raw_ostream &OS) const {
@@ -73,12 +73,27 @@ static void addAllGlobalValueUsers(ClusterMapType &GVtoClusterMap,
   }
 }
 
+// Estimate the cost of code generating GV. Functions are weighted by their
+// number of instructions, everything else is assumed to be cheap.
+static unsigned getCodeGenCost(const GlobalValue *GV) {
+  const Function *F = dyn_cast<Function>(GV);
+  if (!F)
+    return 1;
+  unsigned Cost = 1;
+  for (const BasicBlock &BB : *F)
+    Cost += BB.size();
+  return Cost;
+}
+
 // Find partitions for module in the way that no locals need to be
 // globalized.
 // Try to balance pack those partitions into N files since this roughly equals
-// thread balancing for the backend codegen step.
+// thread balancing for the backend codegen step. If BalanceByCost is set, every
+// definition is assigned to a partition here (rather than by name hash) and the
+// partitions are balanced by estimated code generation cost instead of by
+// number of globals.
 static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
-                           unsigned N) {
+                           unsigned N, bool BalanceByCost) {
   // At this point module should have the proper mix of globals and locals.
   // As we attempt to partition this module, we must not change any
   // locals to globals.
@@ -86,13 +101,19 @@ static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
   ClusterMapType GVtoClusterMap;
   ComdatMembersType ComdatMembers;
 
-  auto recordGVSet = [&GVtoClusterMap, &ComdatMembers](GlobalValue &GV) {
+  auto recordGVSet = [&GVtoClusterMap, &ComdatMembers,
+                      BalanceByCost](GlobalValue &GV) {
     if (GV.isDeclaration())
       return;
 
     if (!GV.hasName())
       GV.setName("__llvmsplit_unnamed");
 
+    // Make sure that every definition gets a cluster, even when it does not
+    // need to be kept together with anything else.
+    if (BalanceByCost)
+      GVtoClusterMap.insert(&GV);
+
     // Comdat groups must not be partitioned. For comdat groups that contain
     // locals, record all their members here so we can keep them together.
     // Comdat groups that only contain external globals are already handled by
@@ -154,11 +175,20 @@ static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
   // To guarantee determinism, we have to sort SCC according to size.
   // When size is the same, use leader's name.
   for (ClusterMapType::iterator I = GVtoClusterMap.begin(),
-                                E = GVtoClusterMap.end(); I != E; ++I)
-    if (I->isLeader())
-      Sets.push_back(
-          std::make_pair(std::distance(GVtoClusterMap.member_begin(I),
-                                       GVtoClusterMap.member_end()), I));
+                                E = GVtoClusterMap.end(); I != E; ++I) {
+    if (!I->isLeader())
+      continue;
+    unsigned Size = 0;
+    if (BalanceByCost) {
+      for (ClusterMapType::member_iterator MI = GVtoClusterMap.member_begin(I);
+           MI != GVtoClusterMap.member_end(); ++MI)
+        Size += getCodeGenCost(*MI);
+    } else {
+      Size = std::distance(GVtoClusterMap.member_begin(I),
+                           GVtoClusterMap.member_end());
+    }
+    Sets.push_back(std::make_pair(Size, I));
+  }
 
   std::sort(Sets.begin(), Sets.end(), [](const SortType &a, const SortType &b) {
     if (a.first == b.first)
@@ -184,9 +214,9 @@ static void findPartitions(Module *M, ClusterIDMapType &ClusterIDMap,
                    << ((*MI)->hasLocalLinkage() ? " l " : " e ") << "\n");
       Visited.insert(*MI);
       ClusterIDMap[*MI] = CurrentClusterID;
-      CurrentClusterSize++;
     }
     // Add this set size to the number of entries in this cluster.
+    CurrentClusterSize += I.first;
     BalancinQueue.push(std::make_pair(CurrentClusterID, CurrentClusterSize));
   }
 }
@@ -228,7 +258,7 @@ static bool isInPartition(const GlobalValue *GV, unsigned I, unsigned N) {
 void llvm::SplitModule(
     std::unique_ptr<Module> M, unsigned N,
     std::function<void(std::unique_ptr<Module> MPart)> ModuleCallback,
-    bool PreserveLocals) {
+    bool PreserveLocals, bool BalanceByCost) {
   if (!PreserveLocals) {
     for (Function &F : *M)
       externalize(&F);
@@ -243,7 +273,7 @@ void llvm::SplitModule(
   // This performs splitting without a need for externalization, which might not
   // always be possible.
   ClusterIDMapType ClusterIDMap;
-  findPartitions(M.get(), ClusterIDMap, N);
+  findPartitions(M.get(), ClusterIDMap, N, BalanceByCost);
 
   // FIXME: We should be able to reuse M as the last partition instead of
   // cloning it.
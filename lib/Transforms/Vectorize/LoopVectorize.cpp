@@ -99,6 +99,7 @@
 #include "llvm/Transforms/Utils/Local.h"
 #include "llvm/Transforms/Utils/LoopUtils.h"
 #include "llvm/Transforms/Utils/LoopVersioning.h"
+#include "llvm/Transforms/Utils/UnrollLoop.h"
 #include "llvm/Transforms/Vectorize.h"
 #include <algorithm>
 #include <functional>
@@ -113,6 +114,9 @@ using namespace llvm::PatternMatch;
 
 STATISTIC(LoopsVectorized, "Number of loops vectorized");
 STATISTIC(LoopsAnalyzed, "Number of loops analyzed for vectorization");
+STATISTIC(OuterLoopsFlattened,
+          "Number of outer loops whose inner loop was unrolled to vectorize "
+          "them");
 
 static cl::opt<bool>
     EnableIfConversion("enable-if-conversion", cl::init(true), cl::Hidden,
@@ -149,6 +153,31 @@ static cl::opt<bool> EnableInterleavedMemAccesses(
     "enable-interleaved-mem-accesses", cl::init(false), cl::Hidden,
     cl::desc("Enable vectorization on interleaved memory accesses in a loop"));
 
+/// This enables vectorizing across the induction variable of an outer loop,
+/// as in stencils with a short inner loop of fixed trip count:
+///   for (x = 0; x < N; ++x)
+///     for (k = 0; k < 3; ++k)
+///       Out[x] += In[x + k] * W[k];
+///
+/// The inner loop is completely unrolled, which makes the outer loop the
+/// innermost one, and the outer loop then goes through the usual legality
+/// checks and cost model. The trip count of the inner loop being a constant,
+/// its control flow is uniform across the iterations of the outer loop.
+static cl::opt<bool> EnableOuterLoopVectorization(
+    "vectorize-outer-loops", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize outer loops whose inner loop has a small constant "
+             "trip count"));
+
+static cl::opt<bool> EnableEarlyExitVectorization(
+    "vectorize-early-exit-loops", cl::init(false), cl::Hidden,
+    cl::desc("Vectorize search loops that leave as soon as an element "
+             "satisfies a condition"));
+
+static cl::opt<unsigned> OuterLoopInnerSizeThreshold(
+    "vectorize-outer-loops-inner-size", cl::init(128), cl::Hidden,
+    cl::desc("Maximum number of instructions of the inner loop, once "
+             "completely unrolled, of an outer loop to vectorize"));
+
 /// Maximum factor for an interleaved memory access.
 static cl::opt<unsigned> MaxInterleaveGroupFactor(
     "max-interleave-group-factor", cl::Hidden,
@@ -365,6 +394,14 @@ protected:
   /// this phi node.
   void fixFirstOrderRecurrence(PHINode *Phi);
 
+  /// Returns the unrolled parts of the index of a min/max recurrence,
+  /// described by \p RdxDesc, with the lanes that do not hold the minimum or
+  /// maximum of the whole loop set to all ones. Their unsigned minimum is the
+  /// index of the first minimum or maximum. The code is emitted at the
+  /// builder's insertion point.
+  VectorParts createMinMaxIndexCandidates(RecurrenceDescriptor &RdxDesc,
+                                          const VectorParts &IdxParts);
+
   /// \brief The Loop exit block may have single value PHI nodes where the
   /// incoming value is 'Undef'. While vectorizing we only handled real values
   /// that were defined inside the loop. Here we fix the 'undef case'.
@@ -1599,6 +1636,10 @@ private:
   /// the vector type as an output parameter.
   unsigned getInstructionCost(Instruction *I, unsigned VF, Type *&VectorTy);
 
+  /// Returns the cost of the horizontal reductions that find the indices of
+  /// min/max reductions after a vector loop of width \p VF.
+  unsigned getMinMaxIndexReductionCost(unsigned VF);
+
   /// Returns whether the instruction is a load or store and will be a emitted
   /// as a vector operation.
   bool isConsecutiveLoadOrStore(Instruction *I);
@@ -1701,6 +1742,470 @@ private:
   Instruction *UnsafeAlgebraInst;
 };
 
+namespace {
+/// Vectorizes search loops, which leave as soon as an element satisfies a
+/// condition, as in std::find_if:
+///
+///   for (i = Start; i != N; ++i)
+///     if (A[i] == X)
+///       break;
+///
+/// The vector loop computes the exit condition for VF elements at a time and
+/// reduces it to a single bit. It leaves as soon as any lane would exit, and
+/// the original loop then runs from the first element of that vector, so the
+/// loop exits and the values used after it are unchanged. The vector loop also
+/// leaves the last, partial vector to the original loop.
+///
+/// Computing the exit condition for the lanes past the exiting element loads
+/// elements that the original loop does not. This is only done when the loads
+/// are known to be dereferenceable for the whole iteration space, up to the
+/// exit of the latch; a runtime check compares the trip count with the
+/// dereferenceable size of the accessed objects.
+///
+/// The supported loops are made of two blocks: the header, which computes the
+/// exit condition without side effects and takes the early exit, and the latch,
+/// which increments the induction variable and takes the normal exit.
+class EarlyExitLoopVectorizer {
+  Loop *L;
+  ScalarEvolution *SE;
+  LoopInfo *LI;
+  DominatorTree *DT;
+  const TargetTransformInfo &TTI;
+  const DataLayout &DL;
+
+  BasicBlock *Preheader = nullptr, *Header = nullptr, *Latch = nullptr;
+  /// The induction variable, starting at Start and incremented by IVInc.
+  PHINode *IV = nullptr;
+  Instruction *IVInc = nullptr;
+  uint64_t Start = 0;
+  /// The branch of the header to the early exit, on ExitCond being
+  /// ExitOnTrue.
+  BranchInst *ExitBr = nullptr;
+  Value *ExitCond = nullptr;
+  bool ExitOnTrue = true;
+  /// The number of times the latch branches back to the header.
+  const SCEV *BackedgeTakenCount = nullptr;
+  /// An upper bound on the trip count for which every load is dereferenceable.
+  uint64_t MaxTripCount = ~0ULL;
+  /// The instructions to widen, in order.
+  SmallVector<Instruction *, 16> Body;
+  SmallPtrSet<Instruction *, 16> Widened;
+  unsigned VF = 0;
+
+  static uint64_t getDereferenceableBytes(const Value *V,
+                                          const DataLayout &DL) {
+    bool CanBeNull;
+    uint64_t Bytes = V->getPointerDereferenceableBytes(CanBeNull);
+    if (Bytes && !CanBeNull)
+      return Bytes;
+    if (auto *GV = dyn_cast<GlobalVariable>(V))
+      if (!GV->isDeclaration() && !GV->isInterposable() &&
+          GV->getValueType()->isSized())
+        return DL.getTypeAllocSize(GV->getValueType());
+    if (auto *AI = dyn_cast<AllocaInst>(V))
+      if (auto *Size = dyn_cast<ConstantInt>(AI->getArraySize()))
+        return DL.getTypeAllocSize(AI->getAllocatedType()) *
+               Size->getZExtValue();
+    return 0;
+  }
+
+  bool isWidenedOrInvariant(Value *V) const {
+    if (auto *I = dyn_cast<Instruction>(V))
+      if (L->contains(I))
+        return I == IV || Widened.count(I);
+    return true;
+  }
+
+  /// Check a load of the element of an object indexed by the induction
+  /// variable, and bound the trip count by the size of the object.
+  bool canWidenLoad(LoadInst *Load) {
+    auto *GEP = dyn_cast<GetElementPtrInst>(Load->getPointerOperand());
+    if (!Load->isSimple() || !GEP || !L->contains(GEP) ||
+        !L->isLoopInvariant(GEP->getPointerOperand()) ||
+        GEP->getResultElementType() != Load->getType() ||
+        *(GEP->idx_end() - 1) != IV)
+      return false;
+    for (auto Idx = GEP->idx_begin(), E = GEP->idx_end() - 1; Idx != E; ++Idx)
+      if (!match(Idx->get(), m_Zero()))
+        return false;
+    for (User *U : GEP->users())
+      if (!isa<LoadInst>(U) || cast<LoadInst>(U)->getPointerOperand() != GEP)
+        return false;
+    uint64_t ElementSize = DL.getTypeAllocSize(Load->getType());
+    uint64_t Elements =
+        getDereferenceableBytes(GEP->getPointerOperand(), DL) / ElementSize;
+    if (Elements <= Start)
+      return false;
+    MaxTripCount = std::min(MaxTripCount, Elements - Start);
+    return true;
+  }
+
+  bool canWiden(Instruction *I) {
+    if (isa<GetElementPtrInst>(I))
+      return true; // Checked with the loads using it.
+    if (!I->getType()->isIntegerTy() && !I->getType()->isFloatingPointTy())
+      return false;
+    if (auto *Load = dyn_cast<LoadInst>(I))
+      return canWidenLoad(Load);
+    if (auto *BO = dyn_cast<BinaryOperator>(I)) {
+      // The lanes past the exit must not trap.
+      switch (BO->getOpcode()) {
+      case Instruction::UDiv:
+      case Instruction::SDiv:
+      case Instruction::URem:
+      case Instruction::SRem:
+        return false;
+      default:
+        break;
+      }
+    } else if (auto *Cast = dyn_cast<CastInst>(I)) {
+      if (!Cast->getSrcTy()->isIntegerTy() &&
+          !Cast->getSrcTy()->isFloatingPointTy())
+        return false;
+    } else if (!isa<CmpInst>(I) && !isa<SelectInst>(I)) {
+      return false;
+    }
+    return all_of(I->operands(),
+                  [&](Value *Op) { return isWidenedOrInvariant(Op); });
+  }
+
+  /// Return the cost of \p I with a vectorization factor of \p Width.
+  unsigned getInstructionCost(Instruction *I, unsigned Width) const {
+    auto toVectorTy = [&](Type *Ty) -> Type * {
+      return Width == 1 ? Ty : VectorType::get(Ty, Width);
+    };
+    if (isa<GetElementPtrInst>(I))
+      return 0;
+    if (auto *Load = dyn_cast<LoadInst>(I))
+      return TTI.getMemoryOpCost(Instruction::Load, toVectorTy(Load->getType()),
+                                 Load->getAlignment(), 0);
+    if (isa<BinaryOperator>(I))
+      return TTI.getArithmeticInstrCost(I->getOpcode(),
+                                        toVectorTy(I->getType()));
+    if (auto *Cast = dyn_cast<CastInst>(I))
+      return TTI.getCastInstrCost(I->getOpcode(), toVectorTy(I->getType()),
+                                  toVectorTy(Cast->getSrcTy()));
+    if (auto *Cmp = dyn_cast<CmpInst>(I))
+      return TTI.getCmpSelInstrCost(I->getOpcode(),
+                                    toVectorTy(Cmp->getOperand(0)->getType()));
+    return TTI.getCmpSelInstrCost(I->getOpcode(), toVectorTy(I->getType()));
+  }
+
+  /// Pick the vectorization factor from the widest type in the loop and the
+  /// width of the vector registers, and check with the cost model that the
+  /// vector loop is cheaper.
+  bool selectVectorizationFactor(unsigned UserVF) {
+    unsigned WidestBits = 0;
+    for (Instruction *I : Body)
+      for (Value *V : I->operand_values())
+        if (!V->getType()->isPointerTy())
+          WidestBits = std::max<unsigned>(
+              WidestBits, DL.getTypeSizeInBits(V->getType()->getScalarType()));
+    if (!WidestBits)
+      return false;
+    VF = UserVF ? UserVF : TTI.getRegisterBitWidth(true) / WidestBits;
+    if (VF < 2 || !isPowerOf2_32(VF))
+      return false;
+
+    // The scalar loop runs the body and both branches for every element; the
+    // vector loop runs the body, the reduction of the exit condition and both
+    // branches for every VF elements.
+    unsigned ScalarCost = 2 * TTI.getCFInstrCost(Instruction::Br);
+    unsigned VectorCost = 2 * TTI.getCFInstrCost(Instruction::Br);
+    for (Instruction *I : Body) {
+      ScalarCost += getInstructionCost(I, 1);
+      VectorCost += getInstructionCost(I, VF);
+    }
+    Type *MaskTy = VectorType::get(ExitCond->getType(), VF);
+    Type *BitsTy = IntegerType::get(Header->getContext(), VF);
+    VectorCost += TTI.getCastInstrCost(Instruction::BitCast, BitsTy, MaskTy) +
+                  TTI.getCmpSelInstrCost(Instruction::ICmp, BitsTy);
+    DEBUG(dbgs() << "LV: Early exit loop cost: scalar " << ScalarCost
+                 << " per element, vector " << VectorCost << " per " << VF
+                 << " elements.\n");
+    return UserVF || VectorCost < uint64_t(ScalarCost) * VF;
+  }
+
+public:
+  EarlyExitLoopVectorizer(Loop *L, ScalarEvolution *SE, LoopInfo *LI,
+                          DominatorTree *DT, const TargetTransformInfo &TTI,
+                          const DataLayout &DL)
+      : L(L), SE(SE), LI(LI), DT(DT), TTI(TTI), DL(DL) {}
+
+  /// Return true if the loop is a search loop that can be vectorized, and is
+  /// worth it. \p UserVF is the vectorization factor the user asked for, if
+  /// any.
+  bool canVectorize(unsigned UserVF) {
+    Preheader = L->getLoopPreheader();
+    Header = L->getHeader();
+    Latch = L->getLoopLatch();
+    if (!Preheader || !Latch || Latch == Header || L->getNumBlocks() != 2)
+      return false;
+
+    // The header leaves the loop or goes to the latch, which leaves the loop or
+    // goes back to the header.
+    ExitBr = dyn_cast<BranchInst>(Header->getTerminator());
+    auto *LatchBr = dyn_cast<BranchInst>(Latch->getTerminator());
+    if (!ExitBr || !ExitBr->isConditional() || !LatchBr ||
+        !LatchBr->isConditional())
+      return false;
+    ExitOnTrue = ExitBr->getSuccessor(1) == Latch;
+    if (ExitBr->getSuccessor(ExitOnTrue ? 0 : 1) == Latch ||
+        L->contains(ExitBr->getSuccessor(ExitOnTrue ? 0 : 1)))
+      return false;
+    ExitCond = ExitBr->getCondition();
+
+    // A single induction variable with a constant start and a step of one;
+    // other header phis would need to be resumed as well.
+    if (!isa<PHINode>(Header->begin()) || Header->getFirstNonPHI() !=
+                                              &*std::next(Header->begin()))
+      return false;
+    IV = cast<PHINode>(Header->begin());
+    auto *StartValue =
+        dyn_cast<ConstantInt>(IV->getIncomingValueForBlock(Preheader));
+    IVInc = dyn_cast<Instruction>(IV->getIncomingValueForBlock(Latch));
+    if (!IV->getType()->isIntegerTy() || !StartValue ||
+        StartValue->isNegative() || !IVInc ||
+        !match(IVInc, m_Add(m_Specific(IV), m_One())))
+      return false;
+    Start = StartValue->getZExtValue();
+
+    BackedgeTakenCount = SE->getExitCount(L, Latch);
+    if (isa<SCEVCouldNotCompute>(BackedgeTakenCount) ||
+        BackedgeTakenCount->getType() != IV->getType())
+      return false;
+
+    auto *LatchCmp = dyn_cast<Instruction>(LatchBr->getCondition());
+    for (BasicBlock *BB : {Header, Latch})
+      for (Instruction &I : *BB) {
+        if (&I == IV || &I == IVInc || isa<TerminatorInst>(I) ||
+            (&I == LatchCmp && I.hasOneUse()))
+          continue;
+        if (I.getParent() == Latch || !canWiden(&I)) {
+          DEBUG(dbgs() << "LV: Early exit loop with unsupported instruction "
+                       << I << "\n");
+          return false;
+        }
+        Body.push_back(&I);
+        Widened.insert(&I);
+      }
+    auto *CondInst = dyn_cast<Instruction>(ExitCond);
+    if (!CondInst || !Widened.count(CondInst))
+      return false;
+    return selectVectorizationFactor(UserVF);
+  }
+
+  /// Return the vectorization factor that canVectorize selected.
+  unsigned getVectorizationFactor() const { return VF; }
+
+  /// Create the vector loop before the loop.
+  void vectorize() {
+    LLVMContext &Context = Header->getContext();
+    Type *IdxTy = IV->getType();
+    Function *F = Header->getParent();
+
+    // Split the preheader: the checks go in its first part, the second is the
+    // new preheader of the loop, where the vector loop resumes it.
+    BasicBlock *Check = Preheader;
+    BasicBlock *Resume = SplitBlock(Check, Check->getTerminator(), DT, LI);
+    Resume->setName("early.exit.resume");
+    BasicBlock *VecPH =
+        BasicBlock::Create(Context, "early.exit.vector.ph", F, Resume);
+    BasicBlock *VecBody =
+        BasicBlock::Create(Context, "early.exit.vector.body", F, Resume);
+    BasicBlock *VecLatch =
+        BasicBlock::Create(Context, "early.exit.vector.latch", F, Resume);
+    BasicBlock *VecExit =
+        BasicBlock::Create(Context, "early.exit.vector.exit", F, Resume);
+
+    // Register the vector loop.
+    Loop *VecLoop = new Loop();
+    if (Loop *ParentLoop = L->getParentLoop()) {
+      ParentLoop->addChildLoop(VecLoop);
+      ParentLoop->addBasicBlockToLoop(VecPH, *LI);
+      ParentLoop->addBasicBlockToLoop(VecExit, *LI);
+    } else {
+      LI->addTopLevelLoop(VecLoop);
+    }
+    VecLoop->addBasicBlockToLoop(VecBody, *LI);
+    VecLoop->addBasicBlockToLoop(VecLatch, *LI);
+    DT->addNewBlock(VecPH, Check);
+    DT->addNewBlock(VecBody, VecPH);
+    DT->addNewBlock(VecLatch, VecBody);
+    DT->addNewBlock(VecExit, VecBody);
+
+    // Enter the vector loop if every load is dereferenceable for the whole
+    // trip count, and there is at least one full vector.
+    IRBuilder<> Builder(Check->getTerminator());
+    SCEVExpander Exp(*SE, DL, "early.exit");
+    Value *BTC = Exp.expandCodeFor(BackedgeTakenCount, IdxTy,
+                                   Check->getTerminator());
+    Value *TripCount = Builder.CreateAdd(BTC, ConstantInt::get(IdxTy, 1),
+                                         "early.exit.trip.count");
+    Value *VecTripCount =
+        Builder.CreateAnd(TripCount, ConstantInt::get(IdxTy, -uint64_t(VF)),
+                          "early.exit.vector.trip.count");
+    Value *VecEnd = Builder.CreateAdd(ConstantInt::get(IdxTy, Start),
+                                      VecTripCount, "early.exit.vector.end");
+    Value *CanVectorize = Builder.CreateICmpUGE(
+        BTC, ConstantInt::get(IdxTy, VF - 1), "early.exit.has.vector");
+    // A bound that does not fit the induction variable is always met.
+    if (MaxTripCount != ~0ULL &&
+        isUIntN(IdxTy->getIntegerBitWidth(), MaxTripCount))
+      CanVectorize = Builder.CreateAnd(
+          CanVectorize,
+          Builder.CreateICmpULT(BTC, ConstantInt::get(IdxTy, MaxTripCount)),
+          "early.exit.dereferenceable");
+    Check->getTerminator()->eraseFromParent();
+    BranchInst::Create(VecPH, Resume, CanVectorize, Check);
+
+    // Splat the loop invariant operands in the vector preheader.
+    Builder.SetInsertPoint(BranchInst::Create(VecBody, VecPH));
+    DenseMap<Value *, Value *> VectorOf;
+    auto getVector = [&](Value *V) {
+      Value *&Vec = VectorOf[V];
+      if (!Vec) {
+        IRBuilder<>::InsertPointGuard Guard(Builder);
+        Builder.SetInsertPoint(VecPH->getTerminator());
+        Vec = Builder.CreateVectorSplat(VF, V, "broadcast");
+      }
+      return Vec;
+    };
+
+    Builder.SetInsertPoint(VecBody);
+    PHINode *Offset = Builder.CreatePHI(IdxTy, 2, "early.exit.offset");
+    Offset->addIncoming(ConstantInt::get(IdxTy, 0), VecPH);
+    Value *Index = Builder.CreateAdd(ConstantInt::get(IdxTy, Start), Offset,
+                                     "early.exit.index");
+    if (any_of(IV->users(), [&](User *U) {
+          return Widened.count(cast<Instruction>(U));
+        })) {
+      SmallVector<Constant *, 8> Steps;
+      for (unsigned Lane = 0; Lane != VF; ++Lane)
+        Steps.push_back(ConstantInt::get(IdxTy, Lane));
+      VectorOf[IV] =
+          Builder.CreateAdd(Builder.CreateVectorSplat(VF, Index, "broadcast"),
+                            ConstantVector::get(Steps), "early.exit.iv");
+    }
+    for (Instruction *I : Body) {
+      Value *V = nullptr;
+      if (isa<GetElementPtrInst>(I))
+        continue;
+      if (auto *Load = dyn_cast<LoadInst>(I)) {
+        auto *GEP = cast<GetElementPtrInst>(Load->getPointerOperand());
+        SmallVector<Value *, 4> Indices(GEP->idx_begin(), GEP->idx_end());
+        Indices.back() = Index;
+        Value *Ptr = Builder.CreateGEP(GEP->getSourceElementType(),
+                                       GEP->getPointerOperand(), Indices);
+        unsigned AS = Load->getPointerAddressSpace();
+        Ptr = Builder.CreateBitCast(
+            Ptr, VectorType::get(Load->getType(), VF)->getPointerTo(AS));
+        unsigned Align = Load->getAlignment();
+        if (!Align)
+          Align = DL.getABITypeAlignment(Load->getType());
+        V = Builder.CreateAlignedLoad(Ptr, Align, "wide.load");
+      } else {
+        SmallVector<Value *, 4> Ops;
+        for (Value *Op : I->operands())
+          Ops.push_back(isa<Instruction>(Op) &&
+                                L->contains(cast<Instruction>(Op))
+                            ? VectorOf[Op]
+                            : getVector(Op));
+        if (auto *BO = dyn_cast<BinaryOperator>(I)) {
+          V = Builder.CreateBinOp(BO->getOpcode(), Ops[0], Ops[1]);
+          if (auto *VecOp = dyn_cast<Instruction>(V))
+            VecOp->copyIRFlags(BO);
+        } else if (auto *Cast = dyn_cast<CastInst>(I)) {
+          V = Builder.CreateCast(Cast->getOpcode(), Ops[0],
+                                 VectorType::get(Cast->getDestTy(), VF));
+        } else if (auto *Cmp = dyn_cast<CmpInst>(I)) {
+          V = Cmp->isFPPredicate()
+                  ? Builder.CreateFCmp(Cmp->getPredicate(), Ops[0], Ops[1])
+                  : Builder.CreateICmp(Cmp->getPredicate(), Ops[0], Ops[1]);
+        } else {
+          auto *Select = cast<SelectInst>(I);
+          // Keep a loop invariant condition scalar.
+          Value *Cond = L->isLoopInvariant(Select->getCondition())
+                            ? Select->getCondition()
+                            : Ops[0];
+          V = Builder.CreateSelect(Cond, Ops[1], Ops[2]);
+        }
+      }
+      V->setName(I->getName() + ".vec");
+      VectorOf[I] = V;
+    }
+
+    // Reduce the exit condition of the lanes to a single bit.
+    Value *Bits = Builder.CreateBitCast(
+        VectorOf[ExitCond], IntegerType::get(Context, VF), "early.exit.mask");
+    Value *AnyExit = Builder.CreateICmpNE(
+        Bits, ExitOnTrue ? Constant::getNullValue(Bits->getType())
+                         : Constant::getAllOnesValue(Bits->getType()),
+        "early.exit.any");
+    Builder.CreateCondBr(AnyExit, VecExit, VecLatch);
+
+    Builder.SetInsertPoint(VecLatch);
+    Value *NextOffset = Builder.CreateAdd(
+        Offset, ConstantInt::get(IdxTy, VF), "early.exit.offset.next");
+    Offset->addIncoming(NextOffset, VecLatch);
+    Builder.CreateCondBr(Builder.CreateICmpEQ(NextOffset, VecTripCount),
+                         VecExit, VecBody);
+
+    // Resume the original loop at the vector the exit was seen in, or after
+    // the last full vector.
+    Builder.SetInsertPoint(VecExit);
+    PHINode *VecResume = Builder.CreatePHI(IdxTy, 2, "early.exit.vector.resume");
+    VecResume->addIncoming(Index, VecBody);
+    VecResume->addIncoming(VecEnd, VecLatch);
+    Builder.CreateBr(Resume);
+
+    Builder.SetInsertPoint(&*Resume->begin());
+    PHINode *ResumeIndex = Builder.CreatePHI(IdxTy, 2, "early.exit.resume.index");
+    ResumeIndex->addIncoming(ConstantInt::get(IdxTy, Start), Check);
+    ResumeIndex->addIncoming(VecResume, VecExit);
+    IV->setIncomingValue(IV->getBasicBlockIndex(Resume), ResumeIndex);
+
+    SE->forgetLoop(L);
+  }
+};
+} // end anonymous namespace
+
+/// Return true if \p L is an outer loop that can be vectorized across its
+/// own induction variable, after its only inner loop is completely unrolled.
+static bool isOuterLoopVectorizationCandidate(Loop &L, ScalarEvolution &SE,
+                                              AssumptionCache &AC,
+                                              const TargetTransformInfo &TTI) {
+  if (!EnableOuterLoopVectorization || L.getSubLoops().size() != 1)
+    return false;
+  Loop *Inner = L.getSubLoops().front();
+  if (!Inner->empty() || !Inner->getLoopPreheader() ||
+      Inner->getExitingBlock() != Inner->getLoopLatch() ||
+      GetUnrollMetadata(Inner->getLoopID(), "llvm.loop.unroll.disable"))
+    return false;
+
+  unsigned TripCount = SE.getSmallConstantTripCount(Inner);
+  if (!TripCount)
+    return false;
+
+  // Only the latch of the inner loop may branch conditionally: the rest of its
+  // control flow is then the same for all the iterations of the outer loop.
+  for (BasicBlock *BB : Inner->blocks()) {
+    if (BB == Inner->getLoopLatch())
+      continue;
+    auto *BI = dyn_cast<BranchInst>(BB->getTerminator());
+    if (!BI || BI->isConditional())
+      return false;
+  }
+
+  SmallPtrSet<const Value *, 32> EphValues;
+  CodeMetrics::collectEphemeralValues(Inner, &AC, EphValues);
+  CodeMetrics Metrics;
+  for (BasicBlock *BB : Inner->blocks())
+    Metrics.analyzeBasicBlock(BB, TTI, EphValues);
+  return !Metrics.notDuplicatable && !Metrics.convergent &&
+         uint64_t(Metrics.NumInsts) * TripCount <= OuterLoopInnerSizeThreshold;
+}
+
 static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
   if (L.empty())
     return V.push_back(&L);
@@ -1709,6 +2214,18 @@ static void addInnerLoop(Loop &L, SmallVectorImpl<Loop *> &V) {
     addInnerLoop(*InnerL, V);
 }
 
+/// Like addInnerLoop, but also add the outer loops that can be vectorized
+/// once their inner loop is unrolled, in place of their inner loop.
+static void addInnerOrOuterLoop(Loop &L, SmallVectorImpl<Loop *> &V,
+                                ScalarEvolution &SE, AssumptionCache &AC,
+                                const TargetTransformInfo &TTI) {
+  if (L.empty() || isOuterLoopVectorizationCandidate(L, SE, AC, TTI))
+    return V.push_back(&L);
+
+  for (Loop *InnerL : L)
+    addInnerOrOuterLoop(*InnerL, V, SE, AC, TTI);
+}
+
 /// The LoopVectorize Pass.
 struct LoopVectorize : public FunctionPass {
   /// Pass identification, replacement for typeid
@@ -1772,14 +2289,26 @@ struct LoopVectorize : public FunctionPass {
     SmallVector<Loop *, 8> Worklist;
 
     for (Loop *L : *LI)
-      addInnerLoop(*L, Worklist);
+      addInnerOrOuterLoop(*L, Worklist, *SE, *AC, *TTI);
 
     LoopsAnalyzed += Worklist.size();
 
     // Now walk the identified inner loops.
     bool Changed = false;
-    while (!Worklist.empty())
-      Changed |= processLoop(Worklist.pop_back_val());
+    while (!Worklist.empty()) {
+      Loop *L = Worklist.pop_back_val();
+      if (!L->empty()) {
+        // An outer loop: make it innermost by completely unrolling its inner
+        // loop, or fall back to vectorizing the inner loop.
+        if (!unrollInnerLoop(L)) {
+          for (Loop *InnerL : *L)
+            addInnerLoop(*InnerL, Worklist);
+          continue;
+        }
+        Changed = true;
+      }
+      Changed |= processLoop(L);
+    }
 
     // Process each loop nest in the function.
     return Changed;
@@ -1819,6 +2348,54 @@ struct LoopVectorize : public FunctionPass {
     }
   }
 
+  /// Completely unroll the only inner loop of \p L, as selected by
+  /// isOuterLoopVectorizationCandidate. Return false if it was not unrolled.
+  bool unrollInnerLoop(Loop *L) {
+    Loop *Inner = L->getSubLoops().front();
+    unsigned TripCount = SE->getSmallConstantTripCount(Inner);
+    unsigned TripMultiple = SE->getSmallConstantTripMultiple(Inner);
+    DEBUG(dbgs() << "LV: Unrolling the inner loop of an outer loop in \""
+                 << L->getHeader()->getParent()->getName() << "\" "
+                 << TripCount << " times.\n");
+    if (!UnrollLoop(Inner, TripCount, TripCount, /*Force=*/false,
+                    /*AllowRuntime=*/false, /*AllowExpensiveTripCount=*/false,
+                    TripMultiple, LI, SE, DT, AC, /*PreserveLCSSA=*/true))
+      return false;
+    assert(L->empty() && "Inner loop not completely unrolled");
+    SE->forgetLoop(L);
+    ++OuterLoopsFlattened;
+    return true;
+  }
+
+  /// Vectorize \p L if it is a search loop, with an early exit.
+  bool processEarlyExitLoop(Loop *L, LoopVectorizeHints &Hints) {
+    Function *F = L->getHeader()->getParent();
+    if ((F->optForSize() &&
+         Hints.getForce() != LoopVectorizeHints::FK_Enabled) ||
+        F->hasFnAttribute(Attribute::NoImplicitFloat))
+      return false;
+
+    EarlyExitLoopVectorizer EEV(L, SE, LI, DT, *TTI,
+                                F->getParent()->getDataLayout());
+    if (!EEV.canVectorize(Hints.getWidth() > 1 ? Hints.getWidth() : 0)) {
+      DEBUG(dbgs() << "LV: Not vectorizing: Unsupported early exit loop.\n");
+      emitMissedWarning(F, L, Hints);
+      return false;
+    }
+    EEV.vectorize();
+    ++LoopsVectorized;
+    emitOptimizationRemark(F->getContext(), LV_NAME, *F, L->getStartLoc(),
+                           Twine("vectorized early exit loop (vectorization "
+                                 "width: ") +
+                               Twine(EEV.getVectorizationFactor()) + ")");
+
+    // Mark the loop as already vectorized to avoid vectorizing again.
+    Hints.setAlreadyVectorized();
+
+    DEBUG(verifyFunction(*F));
+    return true;
+  }
+
   bool processLoop(Loop *L) {
     assert(L->empty() && "Only process inner loops.");
 
@@ -1858,6 +2435,10 @@ struct LoopVectorize : public FunctionPass {
       return false;
     }
 
+    // Loops with several exits are only handled as search loops.
+    if (EnableEarlyExitVectorization && !L->getExitingBlock())
+      return processEarlyExitLoop(L, Hints);
+
     // Check the loop for a trip count threshold:
     // do not vectorize loops with a tiny trip count.
     const unsigned TC = SE->getSmallConstantTripCount(L);
@@ -3273,6 +3854,36 @@ static Value *addFastMathFlag(Value *V) {
   return V;
 }
 
+/// \brief Reduces the unrolled parts \p Parts of a min/max recurrence of kind
+/// \p Kind to a scalar. Vectors are reduced in log2(VF) rounds of shuffles,
+/// each of which halves the number of values.
+static Value *
+createMinMaxReduction(IRBuilder<> &Builder,
+                      RecurrenceDescriptor::MinMaxRecurrenceKind Kind,
+                      ArrayRef<Value *> Parts) {
+  Value *Rdx = Parts[0];
+  for (unsigned Part = 1; Part < Parts.size(); ++Part)
+    Rdx = RecurrenceDescriptor::createMinMaxOp(Builder, Kind, Rdx, Parts[Part]);
+  if (!Rdx->getType()->isVectorTy())
+    return Rdx;
+
+  unsigned VF = Rdx->getType()->getVectorNumElements();
+  assert(isPowerOf2_32(VF) &&
+         "Reduction emission only supported for pow2 vectors!");
+  SmallVector<Constant *, 32> ShuffleMask(VF, nullptr);
+  for (unsigned i = VF; i != 1; i >>= 1) {
+    for (unsigned j = 0; j != i / 2; ++j)
+      ShuffleMask[j] = Builder.getInt32(i / 2 + j);
+    std::fill(&ShuffleMask[i / 2], ShuffleMask.end(),
+              UndefValue::get(Builder.getInt32Ty()));
+    Value *Shuf = Builder.CreateShuffleVector(
+        Rdx, UndefValue::get(Rdx->getType()), ConstantVector::get(ShuffleMask),
+        "rdx.shuf");
+    Rdx = RecurrenceDescriptor::createMinMaxOp(Builder, Kind, Rdx, Shuf);
+  }
+  return Builder.CreateExtractElement(Rdx, Builder.getInt32(0));
+}
+
 /// Estimate the overhead of scalarizing a value. Insert and Extract are set if
 /// the result needs to be inserted and/or extracted from vectors.
 static unsigned getScalarizationOverhead(Type *Ty, bool Insert, bool Extract,
@@ -3566,7 +4177,8 @@ void InnerLoopVectorizer::vectorizeLoop() {
     Value *Identity;
     Value *VectorStart;
     if (RK == RecurrenceDescriptor::RK_IntegerMinMax ||
-        RK == RecurrenceDescriptor::RK_FloatMinMax) {
+        RK == RecurrenceDescriptor::RK_FloatMinMax ||
+        RK == RecurrenceDescriptor::RK_MinMaxIndex) {
       // MinMax reduction have the start value as their identify.
       if (VF == 1) {
         VectorStart = Identity = ReductionStartValue;
@@ -3644,6 +4256,13 @@ void InnerLoopVectorizer::vectorizeLoop() {
         RdxParts[part] = Builder.CreateTrunc(RdxParts[part], RdxVecTy);
     }
 
+    // The index of a min/max is the unsigned minimum of the indices of the
+    // lanes that hold the minimum or maximum of the whole loop.
+    if (RK == RecurrenceDescriptor::RK_MinMaxIndex) {
+      RdxParts = createMinMaxIndexCandidates(RdxDesc, RdxParts);
+      MinMaxKind = RecurrenceDescriptor::MRK_UIntMin;
+    }
+
     // Reduce all of the unrolled parts into a single vector.
     Value *ReducedPartRdx = RdxParts[0];
     unsigned Op = RecurrenceDescriptor::getRecurrenceBinOp(RK);
@@ -3765,6 +4384,31 @@ void InnerLoopVectorizer::vectorizeLoop() {
   cse(LoopVectorBody);
 }
 
+InnerLoopVectorizer::VectorParts
+InnerLoopVectorizer::createMinMaxIndexCandidates(RecurrenceDescriptor &RdxDesc,
+                                                 const VectorParts &IdxParts) {
+  // Each lane holds the index of the first extreme value it has seen, so the
+  // first extreme value of the loop is in one of the lanes that hold the
+  // overall extreme value. Lanes that kept their start value only hold the
+  // overall value if no lane saw a better one, and then all lanes still hold
+  // the start index.
+  VectorParts ValParts = getVectorValue(RdxDesc.getIndexedMinMaxInstr());
+  Value *MinMax = createMinMaxReduction(
+      Builder, RdxDesc.getMinMaxRecurrenceKind(), ValParts);
+  Value *Splat = VF == 1 ? MinMax : Builder.CreateVectorSplat(VF, MinMax);
+  Value *NoIndex = Constant::getAllOnesValue(IdxParts[0]->getType());
+  VectorParts Candidates(UF);
+  for (unsigned Part = 0; Part < UF; ++Part) {
+    Value *IsMinMax =
+        MinMax->getType()->isFloatingPointTy()
+            ? Builder.CreateFCmpOEQ(ValParts[Part], Splat, "rdx.is.minmax")
+            : Builder.CreateICmpEQ(ValParts[Part], Splat, "rdx.is.minmax");
+    Candidates[Part] =
+        Builder.CreateSelect(IsMinMax, IdxParts[Part], NoIndex, "rdx.idx");
+  }
+  return Candidates;
+}
+
 void InnerLoopVectorizer::fixFirstOrderRecurrence(PHINode *Phi) {
 
   // This is the second phase of vectorizing first-order recurrences. An
@@ -4697,6 +5341,13 @@ bool LoopVectorizationLegality::canVectorizeInstrs() {
           continue;
         }
 
+        if (RecurrenceDescriptor::isMinMaxIndexPHI(Phi, TheLoop, PSE.getSE(),
+                                                   RedDes)) {
+          AllowedExit.insert(RedDes.getLoopExitInstr());
+          Reductions[Phi] = RedDes;
+          continue;
+        }
+
         InductionDescriptor ID;
         if (InductionDescriptor::isInductionPHI(Phi, PSE, ID)) {
           if (!addInductionPhi(Phi, ID))
@@ -4800,6 +5451,31 @@ bool LoopVectorizationLegality::canVectorizeInstrs() {
     } // next instr.
   }
 
+  // The index of a min/max is computed from the vectorized min/max, which
+  // must therefore be a reduction of the same kind.
+  for (auto &Reduction : Reductions) {
+    RecurrenceDescriptor &IdxDes = Reduction.second;
+    if (IdxDes.getRecurrenceKind() != RecurrenceDescriptor::RK_MinMaxIndex)
+      continue;
+    bool Found = false;
+    for (auto &Other : Reductions) {
+      RecurrenceDescriptor &RedDes = Other.second;
+      if (RedDes.getLoopExitInstr() == IdxDes.getIndexedMinMaxInstr() &&
+          RedDes.getMinMaxRecurrenceKind() ==
+              IdxDes.getMinMaxRecurrenceKind() &&
+          RedDes.getRecurrenceType() == Other.first->getType())
+        Found = true;
+    }
+    if (!Found) {
+      emitAnalysis(VectorizationReport(Reduction.first)
+                   << "index of a minimum or maximum could not be "
+                      "vectorized with its value");
+      DEBUG(dbgs() << "LV: Found a min/max index without its min/max."
+                   << *Reduction.first << "\n");
+      return false;
+    }
+  }
+
   if (!Induction) {
     DEBUG(dbgs() << "LV: Did not find one integer induction var.\n");
     if (Inductions.empty()) {
@@ -5735,6 +6411,38 @@ LoopVectorizationCostModel::expectedCost(unsigned VF) {
     Cost.second |= BlockCost.second;
   }
 
+  // The horizontal reductions of min/max indices are done once, after the
+  // loop. Spread their cost over the vector iterations when the trip count is
+  // known.
+  unsigned TC = PSE.getSE()->getSmallConstantTripCount(TheLoop);
+  if (VF > 1 && TC)
+    Cost.first += (getMinMaxIndexReductionCost(VF) * VF + TC - 1) / TC;
+
+  return Cost;
+}
+
+unsigned LoopVectorizationCostModel::getMinMaxIndexReductionCost(unsigned VF) {
+  unsigned Cost = 0;
+  for (auto &Reduction : *Legal->getReductionVars()) {
+    RecurrenceDescriptor &RdxDesc = Reduction.second;
+    if (RdxDesc.getRecurrenceKind() != RecurrenceDescriptor::RK_MinMaxIndex)
+      continue;
+    Type *ValTy = RdxDesc.getIndexedMinMaxInstr()->getType();
+    Type *IdxTy = Reduction.first->getType();
+    Type *ValVecTy = VectorType::get(ValTy, VF);
+    Type *IdxVecTy = VectorType::get(IdxTy, VF);
+    Type *CondTy = VectorType::get(IntegerType::getInt1Ty(ValTy->getContext()),
+                                   VF);
+    // Reduce the min/max, compare the lanes against it, select their indices
+    // and reduce those.
+    Cost += TTI.getMinMaxReductionCost(ValVecTy, CondTy, false);
+    Cost += TTI.getCmpSelInstrCost(ValTy->isFloatingPointTy()
+                                       ? Instruction::FCmp
+                                       : Instruction::ICmp,
+                                   ValVecTy, CondTy);
+    Cost += TTI.getCmpSelInstrCost(Instruction::Select, IdxVecTy, CondTy);
+    Cost += TTI.getMinMaxReductionCost(IdxVecTy, CondTy, false);
+  }
   return Cost;
 }
 
@@ -33,6 +33,7 @@
 #include "llvm/Analysis/TargetTransformInfo.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Analysis/VectorUtils.h"
+#include "llvm/IR/CompileTimeBudget.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/IRBuilder.h"
@@ -88,10 +89,25 @@ static cl::opt<int> MinVectorRegSizeOption(
     "slp-min-reg-size", cl::init(128), cl::Hidden,
     cl::desc("Attempt to vectorize for this register size in bits"));
 
-namespace {
+static cl::opt<unsigned> RecursionMaxDepth(
+    "slp-recursion-max-depth", cl::init(12), cl::Hidden,
+    cl::desc("Limit the recursion depth when building a vectorizable tree"));
+
+/// The look-ahead compares the operands of the candidate operands down to this
+/// depth to decide how to order the operands of commutative instructions. The
+/// work per bundle is bounded by the depth, which keeps it linear in the size of
+/// the block.
+static cl::opt<unsigned> LookAheadMaxDepth(
+    "slp-look-ahead-depth", cl::init(2), cl::Hidden,
+    cl::desc("The maximum look-ahead depth for operand reordering scores"));
+
+static cl::opt<bool> AnyAlternateOpcodes(
+    "slp-any-alternate-opcodes", cl::init(true), cl::Hidden,
+    cl::desc("Vectorize bundles of two different binary operators in any "
+             "order, with a shuffle of both vector operations, rather than "
+             "only alternating add/sub sequences"));
 
-// FIXME: Set this via cl::opt to allow overriding.
-static const unsigned RecursionMaxDepth = 12;
+namespace {
 
 // Limit the number of alias checks. The limit is chosen so that
 // it has no negative effect on the llvm benchmarks.
@@ -173,16 +189,48 @@ static unsigned getAltOpcode(unsigned Op) {
 /// of an alternate sequence which can later be merged as
 /// a ShuffleVector instruction.
 static bool canCombineAsAltInst(unsigned Op) {
-  return Op == Instruction::FAdd || Op == Instruction::FSub ||
-         Op == Instruction::Sub || Op == Instruction::Add;
+  if (!AnyAlternateOpcodes)
+    return Op == Instruction::FAdd || Op == Instruction::FSub ||
+           Op == Instruction::Sub || Op == Instruction::Add;
+  // Both operations are done on every lane, so neither may trap.
+  return Instruction::isBinaryOp(Op) && Op != Instruction::UDiv &&
+         Op != Instruction::SDiv && Op != Instruction::URem &&
+         Op != Instruction::SRem;
+}
+
+/// \returns the opcode of the first instruction of \p VL whose opcode differs
+/// from the one of the first instruction, or zero.
+static unsigned getAltOpcode(ArrayRef<Value *> VL) {
+  unsigned Opcode = cast<Instruction>(VL[0])->getOpcode();
+  for (Value *V : VL)
+    if (cast<Instruction>(V)->getOpcode() != Opcode)
+      return cast<Instruction>(V)->getOpcode();
+  return 0;
 }
 
 /// \returns ShuffleVector instruction if instructions in \p VL have
 ///  alternate fadd,fsub / fsub,fadd/add,sub/sub,add sequence.
 /// (i.e. e.g. opcodes of fadd,fsub,fadd,fsub...)
+/// With -slp-any-alternate-opcodes, the instructions may instead be any mix of
+/// two binary operators, in any order.
 static unsigned isAltInst(ArrayRef<Value *> VL) {
   Instruction *I0 = dyn_cast<Instruction>(VL[0]);
   unsigned Opcode = I0->getOpcode();
+  if (AnyAlternateOpcodes) {
+    unsigned AltOpcode = 0;
+    for (int i = 1, e = VL.size(); i < e; i++) {
+      Instruction *I = dyn_cast<Instruction>(VL[i]);
+      if (!I)
+        return 0;
+      if (I->getOpcode() == Opcode)
+        continue;
+      if (!AltOpcode)
+        AltOpcode = I->getOpcode();
+      if (I->getOpcode() != AltOpcode || !canCombineAsAltInst(AltOpcode))
+        return 0;
+    }
+    return Instruction::ShuffleVector;
+  }
   unsigned AltOpcode = getAltOpcode(Opcode);
   for (int i = 1, e = VL.size(); i < e; i++) {
     Instruction *I = dyn_cast<Instruction>(VL[i]);
@@ -202,7 +250,7 @@ static unsigned getSameOpcode(ArrayRef<Value *> VL) {
   for (int i = 1, e = VL.size(); i < e; i++) {
     Instruction *I = dyn_cast<Instruction>(VL[i]);
     if (!I || Opcode != I->getOpcode()) {
-      if (canCombineAsAltInst(Opcode) && i == 1)
+      if (canCombineAsAltInst(Opcode) && (i == 1 || AnyAlternateOpcodes))
         return isAltInst(VL);
       return 0;
     }
@@ -1784,9 +1832,8 @@ int BoUpSLP::getEntryCost(TreeEntry *E) {
       Instruction *I0 = cast<Instruction>(VL[0]);
       VecCost =
           TTI->getArithmeticInstrCost(I0->getOpcode(), VecTy, Op1VK, Op2VK);
-      Instruction *I1 = cast<Instruction>(VL[1]);
       VecCost +=
-          TTI->getArithmeticInstrCost(I1->getOpcode(), VecTy, Op1VK, Op2VK);
+          TTI->getArithmeticInstrCost(getAltOpcode(VL), VecTy, Op1VK, Op2VK);
       VecCost +=
           TTI->getShuffleCost(TargetTransformInfo::SK_Alternate, VecTy, 0);
       return VecCost - ScalarCost;
@@ -2079,6 +2126,70 @@ static bool shouldReorderOperands(int i, Instruction &I,
   return false;
 }
 
+/// \returns a score of how well \p V1 and \p V2, the values of two adjacent
+/// lanes, would vectorize together: identical values and consecutive loads
+/// are best, then constants and instructions of the same opcode. For those the
+/// score of their operands is added, looking \p Depth levels further down.
+static unsigned getLookAheadScore(Value *V1, Value *V2, const DataLayout &DL,
+                                  ScalarEvolution &SE, unsigned Depth) {
+  if (V1 == V2)
+    return 3;
+  auto *L1 = dyn_cast<LoadInst>(V1);
+  auto *L2 = dyn_cast<LoadInst>(V2);
+  if (L1 && L2)
+    return isConsecutiveAccess(L1, L2, DL, SE) ? 3 : 0;
+  if (isa<Constant>(V1) && isa<Constant>(V2))
+    return 2;
+  auto *I1 = dyn_cast<Instruction>(V1);
+  auto *I2 = dyn_cast<Instruction>(V2);
+  if (!I1 || !I2 || I1->getOpcode() != I2->getOpcode() ||
+      I1->getParent() != I2->getParent())
+    return 0;
+  unsigned Score = 1;
+  if (!Depth || I1->getNumOperands() != 2 || I2->getNumOperands() != 2 ||
+      isa<LoadInst>(I1))
+    return Score;
+  unsigned Straight =
+      getLookAheadScore(I1->getOperand(0), I2->getOperand(0), DL, SE,
+                        Depth - 1) +
+      getLookAheadScore(I1->getOperand(1), I2->getOperand(1), DL, SE,
+                        Depth - 1);
+  if (!I2->isCommutative())
+    return Score + Straight;
+  unsigned Crossed =
+      getLookAheadScore(I1->getOperand(0), I2->getOperand(1), DL, SE,
+                        Depth - 1) +
+      getLookAheadScore(I1->getOperand(1), I2->getOperand(0), DL, SE,
+                        Depth - 1);
+  return Score + std::max(Straight, Crossed);
+}
+
+/// \returns true if the operands of \p I, the commutative instruction of lane
+/// \p i, should be swapped according to the look-ahead scores against the
+/// operands of the previous lane. An order that keeps a splat is never
+/// changed.
+static bool shouldReorderOperandsByLookAhead(int i, Instruction &I,
+                                             SmallVectorImpl<Value *> &Left,
+                                             SmallVectorImpl<Value *> &Right,
+                                             const DataLayout &DL,
+                                             ScalarEvolution &SE) {
+  if (!LookAheadMaxDepth)
+    return false;
+  Value *VLeft = I.getOperand(0);
+  Value *VRight = I.getOperand(1);
+  if (Left[i - 1] == VLeft || Right[i - 1] == VRight)
+    return false;
+  unsigned Keep = getLookAheadScore(Left[i - 1], VLeft, DL, SE,
+                                    LookAheadMaxDepth) +
+                  getLookAheadScore(Right[i - 1], VRight, DL, SE,
+                                    LookAheadMaxDepth);
+  unsigned Swap = getLookAheadScore(Left[i - 1], VRight, DL, SE,
+                                    LookAheadMaxDepth) +
+                  getLookAheadScore(Right[i - 1], VLeft, DL, SE,
+                                    LookAheadMaxDepth);
+  return Swap > Keep;
+}
+
 void BoUpSLP::reorderInputsAccordingToOpcode(ArrayRef<Value *> VL,
                                              SmallVectorImpl<Value *> &Left,
                                              SmallVectorImpl<Value *> &Right) {
@@ -2108,7 +2219,8 @@ void BoUpSLP::reorderInputsAccordingToOpcode(ArrayRef<Value *> VL,
     // Commute to favor either a splat or maximizing having the same opcodes on
     // one side.
     if (shouldReorderOperands(i, *I, Left, Right, AllSameOpcodeLeft,
-                              AllSameOpcodeRight, SplatLeft, SplatRight)) {
+                              AllSameOpcodeRight, SplatLeft, SplatRight) ||
+        shouldReorderOperandsByLookAhead(i, *I, Left, Right, *DL, *SE)) {
       Left.push_back(I->getOperand(1));
       Right.push_back(I->getOperand(0));
     } else {
@@ -2593,29 +2705,29 @@ Value *BoUpSLP::vectorizeTree(TreeEntry *E) {
       Value *V0 = Builder.CreateBinOp(BinOp0->getOpcode(), LHS, RHS);
 
       // Create a vector of LHS op2 RHS
-      Instruction *VL1 = cast<Instruction>(E->Scalars[1]);
-      BinaryOperator *BinOp1 = cast<BinaryOperator>(VL1);
-      Value *V1 = Builder.CreateBinOp(BinOp1->getOpcode(), LHS, RHS);
+      unsigned AltOpcode = getAltOpcode(E->Scalars);
+      Value *V1 = Builder.CreateBinOp(
+          static_cast<Instruction::BinaryOps>(AltOpcode), LHS, RHS);
 
       // Create shuffle to take alternate operations from the vector.
-      // Also, gather up odd and even scalar ops to propagate IR flags to
-      // each vector operation.
-      ValueList OddScalars, EvenScalars;
+      // Also, gather up the scalar ops of each opcode to propagate IR flags
+      // to each vector operation.
+      ValueList AltScalars, MainScalars;
       unsigned e = E->Scalars.size();
       SmallVector<Constant *, 8> Mask(e);
       for (unsigned i = 0; i < e; ++i) {
-        if (i & 1) {
+        if (cast<Instruction>(E->Scalars[i])->getOpcode() == AltOpcode) {
           Mask[i] = Builder.getInt32(e + i);
-          OddScalars.push_back(E->Scalars[i]);
+          AltScalars.push_back(E->Scalars[i]);
         } else {
           Mask[i] = Builder.getInt32(i);
-          EvenScalars.push_back(E->Scalars[i]);
+          MainScalars.push_back(E->Scalars[i]);
         }
       }
 
       Value *ShuffleMask = ConstantVector::get(Mask);
-      propagateIRFlags(V0, EvenScalars);
-      propagateIRFlags(V1, OddScalars);
+      propagateIRFlags(V0, MainScalars);
+      propagateIRFlags(V1, AltScalars);
 
       Value *V = Builder.CreateShuffleVector(V0, V1, ShuffleMask);
       E->VectorizedValue = V;
@@ -3506,6 +3618,10 @@ struct SLPVectorizer : public FunctionPass {
     if (skipFunction(F))
       return false;
 
+    if (!F.getContext().getCompileTimeBudget().shouldRunExpensivePass(
+            "slp-vectorizer", F))
+      return false;
+
     SE = &getAnalysis<ScalarEvolutionWrapperPass>().getSE();
     TTI = &getAnalysis<TargetTransformInfoWrapperPass>().getTTI(F);
     auto *TLIP = getAnalysisIfAvailable<TargetLibraryInfoWrapperPass>();
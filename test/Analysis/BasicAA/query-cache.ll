@@ -0,0 +1,58 @@
+; RUN: opt < %s -basicaa -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -basicaa-cache-queries -aa-eval -print-all-alias-modref-info -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -basicaa -basicaa-cache-queries -aa-eval -print-all-alias-modref-info -disable-output -stats 2>&1 | FileCheck %s --check-prefix=STATS
+; RUN: opt < %s -basicaa -gvn -basicaa-cache-queries -S | FileCheck %s --check-prefix=GVN
+; REQUIRES: asserts
+
+target datalayout = "e-p:64:64:64"
+
+; The query cache must not change any answer.
+
+; CHECK-LABEL: Function: test
+; CHECK-DAG: NoAlias: i32* %a0, i32* %a1
+; CHECK-DAG: MustAlias: i32* %a1, i32* %b1
+; CHECK-DAG: MayAlias: i32* %a1, i32* %ai
+; CHECK-DAG: NoAlias: i32* %a1, i32* %c1
+; CHECK-DAG: NoModRef:  Ptr: i32* %a1{{.*}}<->  call void @f(i32* %a0)
+; CHECK-DAG: Both ModRef:  Ptr: i32* %ai{{.*}}<->  call void @f(i32* %a0)
+
+; The second call repeats the alias queries made for the first one, which the
+; cache answers, and all queries repeat decompositions of the same GEPs.
+
+; STATS: {{[1-9][0-9]*}} basicaa{{ +}}- Number of GEP decompositions found in the query cache
+; STATS: {{[1-9][0-9]*}} basicaa{{ +}}- Number of queries answered by the query cache
+
+define void @test([8 x i32]* %p, i64 %i) {
+  %c = alloca [8 x i32]
+  %a0 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 0
+  %a1 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 1
+  %b1 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 1
+  %ai = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 %i
+  %c1 = getelementptr [8 x i32], [8 x i32]* %c, i64 0, i64 1
+  %v = load i32, i32* %a1
+  store i32 %v, i32* %a0
+  store i32 %v, i32* %c1
+  call void @f(i32* %a0)
+  call void @f(i32* %a0)
+  ret void
+}
+
+declare void @f(i32*) argmemonly
+
+; Instructions GVN deletes must not leave stale entries behind.
+
+; GVN-LABEL: @gvn(
+; GVN: %x = load i32, i32* %a1
+; GVN-NOT: load
+; GVN: ret i32
+define i32 @gvn([8 x i32]* %p) {
+  %a0 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 0
+  %a1 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 1
+  %b1 = getelementptr [8 x i32], [8 x i32]* %p, i64 0, i64 1
+  %x = load i32, i32* %a1
+  store i32 0, i32* %a0
+  %y = load i32, i32* %b1
+  %r = sub i32 %x, %y
+  %s = add i32 %r, %x
+  ret i32 %s
+}
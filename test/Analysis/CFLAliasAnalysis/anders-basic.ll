@@ -0,0 +1,80 @@
+; This testcase checks the points-to sets computed by the inclusion-based CFL AA,
+; and that it falls back to MayAlias for functions it gives up on.
+
+; RUN: opt < %s -disable-basicaa -cfl-anders-aa -aa-eval -print-no-aliases -print-may-aliases -disable-output 2>&1 | FileCheck %s
+; RUN: opt < %s -disable-basicaa -cfl-anders-aa -cfl-anders-max-constraints=1 -aa-eval -print-no-aliases -print-may-aliases -disable-output 2>&1 | FileCheck %s --check-prefix=LIMIT
+
+; LIMIT-NOT: NoAlias
+
+; Unlike unification, inclusion keeps %x and %z apart even though both meet %y.
+
+; CHECK-LABEL: Function: test_select
+; CHECK-DAG: NoAlias: i32* %x, i32* %y
+; CHECK-DAG: NoAlias: i32* %x, i32* %z
+; CHECK-DAG: NoAlias: i32* %y, i32* %z
+; CHECK-DAG: MayAlias: i32* %p, i32* %x
+; CHECK-DAG: MayAlias: i32* %p, i32* %y
+; CHECK-DAG: NoAlias: i32* %p, i32* %z
+; CHECK-DAG: NoAlias: i32* %q, i32* %x
+; CHECK-DAG: MayAlias: i32* %q, i32* %y
+; CHECK-DAG: MayAlias: i32* %q, i32* %z
+; CHECK-DAG: MayAlias: i32* %p, i32* %q
+define void @test_select(i1 %c) {
+  %x = alloca i32, align 4
+  %y = alloca i32, align 4
+  %z = alloca i32, align 4
+  %p = select i1 %c, i32* %x, i32* %y
+  %q = select i1 %c, i32* %y, i32* %z
+  ret void
+}
+
+; CHECK-LABEL: Function: test_memory
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+; CHECK-DAG: MayAlias: i32* %a, i32* %l
+; CHECK-DAG: NoAlias: i32* %b, i32* %l
+; CHECK-DAG: NoAlias: i32* %a, i32** %pp
+; CHECK-DAG: NoAlias: i32* %l, i32** %pp
+define void @test_memory() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %pp = alloca i32*, align 8
+  store i32* %a, i32** %pp
+  %l = load i32*, i32** %pp
+  ret void
+}
+
+; Arguments may alias each other and whatever escaped, but not private locals.
+
+declare void @escape(i32*)
+
+; CHECK-LABEL: Function: test_escape
+; CHECK-DAG: MayAlias: i32* %arg1, i32* %arg2
+; CHECK-DAG: MayAlias: i32* %a, i32* %arg1
+; CHECK-DAG: MayAlias: i32* %a, i32* %arg2
+; CHECK-DAG: NoAlias: i32* %arg1, i32* %b
+; CHECK-DAG: NoAlias: i32* %arg2, i32* %b
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+define void @test_escape(i32* %arg1, i32* %arg2) {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  call void @escape(i32* %a)
+  ret void
+}
+
+; Calls to local functions use the callee's summary, so passing %a to @id does
+; not make it escape.
+
+define internal i32* @id(i32* %v) {
+  ret i32* %v
+}
+
+; CHECK-LABEL: Function: test_summary
+; CHECK-DAG: NoAlias: i32* %a, i32* %b
+; CHECK-DAG: MayAlias: i32* %a, i32* %r
+; CHECK-DAG: NoAlias: i32* %b, i32* %r
+define void @test_summary() {
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %r = call i32* @id(i32* %a)
+  ret void
+}
@@ -89,7 +89,7 @@ define <4 x i32> @test_gather_4i32(<4 x i32*> %ptrs, <4 x i1> %mask, <4 x i32> %
 ; AVX2: Found an estimated cost of 16 {{.*}}.gather
 
 ; KNL-LABEL: test_gather_4i32
-; KNL: Found an estimated cost of 16 {{.*}}.gather
+; KNL: Found an estimated cost of 9 {{.*}}.gather
 
 ; SKX-LABEL: test_gather_4i32
 ; SKX: Found an estimated cost of 6 {{.*}}.gather
@@ -104,7 +104,7 @@ define <4 x i32> @test_gather_4i32_const_mask(<4 x i32*> %ptrs, <4 x i32> %src0)
 ; AVX2: Found an estimated cost of 8 {{.*}}.gather
 
 ; KNL-LABEL: test_gather_4i32_const_mask
-; KNL: Found an estimated cost of 8 {{.*}}.gather
+; KNL: Found an estimated cost of 9 {{.*}}.gather
 
 ; SKX-LABEL: test_gather_4i32_const_mask
 ; SKX: Found an estimated cost of 6 {{.*}}.gather
@@ -229,7 +229,7 @@ define void @test_scatter_4i32(<4 x i32>%a1, <4 x i32*> %ptr, <4 x i1>%mask) {
 ; AVX2: Found an estimated cost of 16 {{.*}}.scatter
 
 ; KNL-LABEL: test_scatter_4i32
-; KNL: Found an estimated cost of 16 {{.*}}.scatter
+; KNL: Found an estimated cost of 8 {{.*}}.scatter
 
 ; SKX-LABEL: test_scatter_4i32
 ; SKX: Found an estimated cost of 6 {{.*}}.scatter
@@ -244,7 +244,7 @@ define <4 x float> @test_gather_4f32(float* %ptr, <4 x i32> %ind, <4 x i1>%mask)
 ; AVX2: Found an estimated cost of 15 {{.*}}.gather
 
 ; KNL-LABEL: test_gather_4f32
-; KNL: Found an estimated cost of 15 {{.*}}.gather
+; KNL: Found an estimated cost of 9 {{.*}}.gather
 
 ; SKX-LABEL: test_gather_4f32
 ; SKX: Found an estimated cost of 6 {{.*}}.gather
@@ -262,7 +262,7 @@ define <4 x float> @test_gather_4f32_const_mask(float* %ptr, <4 x i32> %ind) {
 ; AVX2: Found an estimated cost of 7 {{.*}}.gather
 
 ; KNL-LABEL: test_gather_4f32_const_mask
-; KNL: Found an estimated cost of 7 {{.*}}.gather
+; KNL: Found an estimated cost of 9 {{.*}}.gather
 
 ; SKX-LABEL: test_gather_4f32_const_mask
 ; SKX: Found an estimated cost of 6 {{.*}}.gather
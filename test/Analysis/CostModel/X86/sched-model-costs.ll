@@ -0,0 +1,30 @@
+; RUN: opt < %s -cost-model -analyze -mtriple=x86_64-unknown-linux-gnu -mcpu=haswell -x86-sched-model-costs=throughput | FileCheck %s --check-prefix=THROUGHPUT
+; RUN: opt < %s -cost-model -analyze -mtriple=x86_64-unknown-linux-gnu -mcpu=haswell -x86-sched-model-costs=latency | FileCheck %s --check-prefix=LATENCY
+
+; The costs follow the Haswell scheduling model.
+
+; THROUGHPUT-LABEL: 'vector_arith'
+; LATENCY-LABEL: 'vector_arith'
+define void @vector_arith(<8 x float> %f, <8 x i32> %i, <16 x i16> %s, <16 x float> %wide) {
+  ; THROUGHPUT: cost of 1 {{.*}} fadd <8 x float>
+  ; LATENCY: cost of 3 {{.*}} fadd <8 x float>
+  %fadd = fadd <8 x float> %f, %f
+  ; THROUGHPUT: cost of 1 {{.*}} fmul <8 x float>
+  ; LATENCY: cost of 5 {{.*}} fmul <8 x float>
+  %fmul = fmul <8 x float> %f, %f
+  ; THROUGHPUT: cost of 1 {{.*}} add <8 x i32>
+  ; LATENCY: cost of 1 {{.*}} add <8 x i32>
+  %add = add <8 x i32> %i, %i
+  ; VPMULLD is two micro-ops on port 0.
+  ; THROUGHPUT: cost of 2 {{.*}} mul <8 x i32>
+  ; LATENCY: cost of 10 {{.*}} mul <8 x i32>
+  %mul = mul <8 x i32> %i, %i
+  ; THROUGHPUT: cost of 1 {{.*}} mul <16 x i16>
+  ; LATENCY: cost of 5 {{.*}} mul <16 x i16>
+  %mulw = mul <16 x i16> %s, %s
+  ; Types that need splitting cost one instruction per part.
+  ; THROUGHPUT: cost of 2 {{.*}} fadd <16 x float>
+  ; LATENCY: cost of 6 {{.*}} fadd <16 x float>
+  %wadd = fadd <16 x float> %wide, %wide
+  ret void
+}
@@ -0,0 +1,37 @@
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-exprs=2 | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-max-exprs=2 \
+; RUN:     -pass-remarks-analysis=scalar-evolution 2>&1 >/dev/null \
+; RUN:     | FileCheck %s --check-prefix=EXPRS
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-memory-budget=1 | FileCheck %s
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-memory-budget=1 \
+; RUN:     -pass-remarks-analysis=scalar-evolution 2>&1 >/dev/null \
+; RUN:     | FileCheck %s --check-prefix=MEMORY
+; RUN: opt < %s -analyze -scalar-evolution -scalar-evolution-memory-budget=1024 \
+; RUN:     | FileCheck %s --check-prefix=NOLIMIT
+
+; Once a function exceeds its budget, new values are treated as unknown.
+
+define void @f(i32* %p) {
+entry:
+  br label %loop
+
+loop:
+; CHECK: %i = phi
+; CHECK-NEXT: -->  {0,+,1}<nuw><nsw><%loop>
+; CHECK: %x = mul
+; CHECK-NEXT: -->  %x
+; NOLIMIT: %x = mul
+; NOLIMIT-NEXT: -->  {0,+,3}<nuw><nsw><%loop>
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %x = mul nuw nsw i32 %i, 3
+  store i32 %x, i32* %p
+  %i.next = add nuw nsw i32 %i, 1
+  %cond = icmp slt i32 %i.next, 100
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; EXPRS: remark: <unknown>:0:0: scalar evolution exceeded its limit of 2 expressions, further values are not analyzed
+; MEMORY: remark: <unknown>:0:0: scalar evolution exceeded its memory budget of 1 KB, further values are not analyzed
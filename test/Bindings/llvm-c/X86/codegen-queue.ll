@@ -0,0 +1,19 @@
+; RUN: llvm-as < %s | llvm-c-test --codegen-queue | FileCheck %s
+
+; Several copies of the module are compiled in parallel, each in a context of
+; its own, and all of them produce the same assembly.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @add(i32 %a, i32 %b) {
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK: module 0: ok
+; CHECK-NEXT: module 1: ok
+; CHECK-NEXT: module 2: ok
+; CHECK-NEXT: module 3: ok
+; CHECK-LABEL: add:
+; CHECK: leal
+; CHECK: retq
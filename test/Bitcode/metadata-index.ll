@@ -0,0 +1,22 @@
+; RUN: llvm-as -bitcode-mdindex-threshold=0 < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=INDEX
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=NOINDEX
+; RUN: llvm-as -bitcode-mdindex-threshold=0 < %s | llvm-dis | FileCheck %s
+
+; The index is only emitted above the threshold, after the strings and before
+; the named metadata.
+; INDEX: <METADATA_BLOCK
+; INDEX: <STRINGS
+; INDEX: <INDEX_OFFSET
+; INDEX: <INDEX {{.*}}/>
+; INDEX-NEXT: <NAME
+; NOINDEX-NOT: INDEX_OFFSET
+
+; CHECK: !named = !{!0, !2}
+!named = !{!0, !2}
+
+; CHECK: !0 = !{!"a", !1}
+; CHECK: !1 = !{!"b"}
+; CHECK: !2 = distinct !{!1, !0}
+!0 = !{!"a", !1}
+!1 = !{!"b"}
+!2 = distinct !{!1, !0}
@@ -0,0 +1,72 @@
+; RUN: llvm-as < %s -o %t.bc
+; RUN: opt -S %t.bc -o %t.serial.ll
+; RUN: opt -S -bitcode-reader-threads=4 %t.bc -o %t.parallel.ll
+; RUN: diff %t.serial.ll %t.parallel.ll
+; RUN: llvm-link -S -bitcode-reader-threads=2 %t.bc | FileCheck %s
+
+; Function blocks that are decoded ahead on other threads must produce the
+; same module as reading them on demand, including blockaddress references to
+; functions that have not been materialized yet.
+
+@g = global i32 0
+
+; CHECK: define i32 @a(i32 %x) !dbg
+define i32 @a(i32 %x) !dbg !5 {
+entry:
+  %y = add i32 %x, 1, !dbg !6
+  ret i32 %y, !dbg !6
+}
+
+; CHECK: define void @b(i8** %p)
+; CHECK-NEXT: entry:
+; CHECK-NEXT: store i8* blockaddress(@c, %target), i8** %p
+define void @b(i8** %p) {
+entry:
+  store i8* blockaddress(@c, %target), i8** %p
+  ret void
+}
+
+; CHECK: define void @c()
+define void @c() {
+entry:
+  br label %target
+
+target:
+  %v = load i32, i32* @g, !annotation !9
+  ret void
+}
+
+declare void @external()
+
+; CHECK: define void @d(float %f)
+define void @d(float %f) {
+entry:
+  call void @external()
+  %h = fadd float %f, 5.000000e-01
+  %i = fptosi float %h to i32
+  store i32 %i, i32* @g
+  ret void
+}
+
+; CHECK: define i32 @e(i32 %x)
+define i32 @e(i32 %x) !dbg !4 {
+entry:
+  %y = call i32 @a(i32 %x), !dbg !7
+  %z = mul i32 %y, 3, !dbg !7
+  ret i32 %z, !dbg !8
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: FullDebug)
+!1 = !DIFile(filename: "t.c", directory: "/")
+!2 = !DISubroutineType(types: !{})
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "e", scope: !1, file: !1, line: 1, type: !2, isDefinition: true, unit: !0)
+!5 = distinct !DISubprogram(name: "a", scope: !1, file: !1, line: 5, type: !2, isDefinition: true, unit: !0)
+!6 = !DILocation(line: 6, scope: !5)
+!7 = !DILocation(line: 2, scope: !4)
+!8 = !DILocation(line: 3, scope: !4)
+!9 = !{!"int", !10}
+!10 = !{!"tbaa root"}
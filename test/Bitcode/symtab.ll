@@ -0,0 +1,47 @@
+; RUN: llvm-as -bitcode-write-symtab < %s | llvm-bcanalyzer -dump | FileCheck %s
+; RUN: llvm-as -bitcode-write-symtab < %s | llvm-dis | FileCheck %s --check-prefix=DIS
+; RUN: llvm-as < %s | llvm-bcanalyzer -dump | FileCheck %s --check-prefix=NOSYMTAB
+
+; The symbol table block comes before the module block, and lists functions,
+; then variables, then aliases, using their mangled names.
+; CHECK: <SYMTAB_BLOCK
+; CHECK-NEXT: <VERSION op0=1 op1=0/>
+; CHECK-NEXT: <COMDAT op0=1 op1=99/>
+; CHECK-NEXT: <ENTRY {{.*}}op0=0 op1=0 op2=0 op3=0 op4=0{{.*}} record string = '_f'
+; CHECK-NEXT: <ENTRY {{.*}}op0=0 op1=3 op2=0 op3=0 op4=0{{.*}} record string = '_l'
+; CHECK-NEXT: <ENTRY {{.*}}op0=0 op1=0 op2=0 op3=1 op4=0{{.*}} record string = '_d'
+; CHECK-NEXT: <ENTRY {{.*}}op0=1 op1=0 op2=0 op3=0 op4=0{{.*}} record string = '_g'
+; CHECK-NEXT: <ENTRY {{.*}}op0=1 op1=0 op2=0 op3=2 op4=1{{.*}} record string = '_cst'
+; CHECK-NEXT: <ENTRY {{.*}}op0=1 op1=9 op2=0 op3=4 op4=0{{.*}} record string = 'L_priv'
+; CHECK-NEXT: <ENTRY {{.*}}op0=1 op1=0 op2=0 op3=1 op4=0{{.*}} record string = '_ext'
+; CHECK-NEXT: <ENTRY {{.*}}op0=1 op1=2 op2=0 op3=4 op4=0{{.*}} record string = '_llvm.used'
+; CHECK-NEXT: <ENTRY {{.*}}op0=2 op1=0 op2=1 op3=0 op4=0{{.*}} record string = '_a'
+; CHECK-NEXT: </SYMTAB_BLOCK>
+; CHECK-NEXT: <MODULE_BLOCK
+
+; DIS: @g = global i32 0
+; DIS: define void @f()
+
+; NOSYMTAB-NOT: SYMTAB_BLOCK
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+$c = comdat any
+
+@g = global i32 0
+@cst = constant i32 1, comdat($c)
+@priv = private global i32 2
+@ext = external global i32
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32* @g to i8*)], section "llvm.metadata"
+@a = hidden alias i32, i32* @g
+
+define void @f() {
+  ret void
+}
+
+define internal void @l() {
+  ret void
+}
+
+declare void @d()
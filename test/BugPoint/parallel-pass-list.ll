@@ -0,0 +1,12 @@
+; Test that bugpoint reduces a crashing pass list with several copies of opt
+; running at once.
+;
+; RUN: bugpoint -load %llvmshlibdir/BugpointPasses%shlibext %s -output-prefix %t -instcombine -simplifycfg -bugpoint-crashcalls -gvn -sroa -early-cse -j=3 -silence-passes | FileCheck %s
+; REQUIRES: loadable_module
+
+; CHECK: *** Found crashing pass: -bugpoint-crashcalls{{$}}
+
+define i32 @test() {
+  call i32 @test()
+  ret i32 0
+}
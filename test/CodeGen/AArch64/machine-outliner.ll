@@ -0,0 +1,78 @@
+; RUN: llc -enable-machine-outliner -mtriple=aarch64-linux-gnu < %s | FileCheck %s
+
+@x = global i32 0, align 4
+
+; Functions whose whole body repeats become a tail call to the outlined copy.
+
+; CHECK-LABEL: leaf1:
+; CHECK-NOT: str
+; CHECK: b OUTLINED_FUNCTION_[[TAIL:[0-9]+]]
+define void @leaf1() {
+  store volatile i32 1, i32* @x, align 4
+  store volatile i32 2, i32* @x, align 4
+  store volatile i32 3, i32* @x, align 4
+  store volatile i32 4, i32* @x, align 4
+  ret void
+}
+
+; CHECK-LABEL: leaf2:
+; CHECK-NOT: str
+; CHECK: b OUTLINED_FUNCTION_[[TAIL]]
+define void @leaf2() {
+  store volatile i32 1, i32* @x, align 4
+  store volatile i32 2, i32* @x, align 4
+  store volatile i32 3, i32* @x, align 4
+  store volatile i32 4, i32* @x, align 4
+  ret void
+}
+
+declare void @g()
+
+; Sequences followed by more code are called, with LR saved around the call.
+; The prologue spills LR as well, as a folded spill.
+
+; CHECK-LABEL: call1:
+; CHECK: str x30, [sp, #-16]!{{$}}
+; CHECK-NEXT: bl OUTLINED_FUNCTION_[[CALL:[0-9]+]]
+; CHECK-NEXT: ldr x30, [sp], #16
+; CHECK: bl g
+define void @call1() {
+  store volatile i32 5, i32* @x, align 4
+  store volatile i32 6, i32* @x, align 4
+  store volatile i32 7, i32* @x, align 4
+  store volatile i32 8, i32* @x, align 4
+  call void @g()
+  ret void
+}
+
+; CHECK-LABEL: call2:
+; CHECK: bl OUTLINED_FUNCTION_[[CALL]]
+; CHECK: bl g
+define void @call2() {
+  store volatile i32 5, i32* @x, align 4
+  store volatile i32 6, i32* @x, align 4
+  store volatile i32 7, i32* @x, align 4
+  store volatile i32 8, i32* @x, align 4
+  call void @g()
+  ret void
+}
+
+; CHECK-LABEL: call3:
+; CHECK: bl OUTLINED_FUNCTION_[[CALL]]
+; CHECK: bl g
+define void @call3() {
+  store volatile i32 5, i32* @x, align 4
+  store volatile i32 6, i32* @x, align 4
+  store volatile i32 7, i32* @x, align 4
+  store volatile i32 8, i32* @x, align 4
+  call void @g()
+  ret void
+}
+
+; The outlined functions are emitted after the functions they came from.
+
+; CHECK: OUTLINED_FUNCTION_{{[0-9]+}}:
+; CHECK: str
+; CHECK: OUTLINED_FUNCTION_{{[0-9]+}}:
+; CHECK: str
+; CHECK: ret
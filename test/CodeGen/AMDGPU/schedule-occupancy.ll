@@ -0,0 +1,28 @@
+; RUN: llc -march=amdgcn -mcpu=tonga -verify-machineinstrs < %s | FileCheck -check-prefix=GCN %s
+; RUN: llc -march=amdgcn -mcpu=tonga -misched=gcn-max-occupancy -verify-machineinstrs < %s | FileCheck -check-prefix=GCN %s
+
+; The kernel info reports the occupancy the registers and LDS allow.
+
+; GCN-LABEL: {{^}}few_regs:
+; GCN: ; NumVgprs: {{[0-9]+}}
+; GCN-NEXT: ; Occupancy: 10
+define void @few_regs(i32 addrspace(1)* %out) {
+  store i32 0, i32 addrspace(1)* %out
+  ret void
+}
+
+; 4096 bytes of LDS limit the occupancy to 4 waves.
+
+@lds = internal unnamed_addr addrspace(3) global [1024 x i32] undef, align 4
+
+; GCN-LABEL: {{^}}lds_limited:
+; GCN: ; NumVgprs: {{[0-9]+}}
+; GCN-NEXT: ; Occupancy: 4
+; GCN: ; LDSByteSize: 4096 bytes/workgroup (compile time only)
+define void @lds_limited(i32 addrspace(1)* %out, i32 %idx) {
+  %ptr = getelementptr [1024 x i32], [1024 x i32] addrspace(3)* @lds, i32 0, i32 %idx
+  store i32 1, i32 addrspace(3)* %ptr
+  %v = load i32, i32 addrspace(3)* %ptr
+  store i32 %v, i32 addrspace(1)* %out
+  ret void
+}
@@ -0,0 +1,40 @@
+; RUN: llc < %s -march=bpfel -bpf-report-program-size | FileCheck %s
+; RUN: llc < %s -march=bpfel | FileCheck %s --check-prefix=NOREPORT
+
+; NOREPORT-NOT: Instructions:
+
+; Both sides of the branch are walked by the verifier, so the complexity
+; counts the instructions before the branch twice.
+
+; CHECK-LABEL: diamond:
+; CHECK: # Instructions: [[N:[0-9]+]]
+; CHECK-NOT: # Verifier complexity: [[N]]{{$}}
+; CHECK: # Verifier complexity: {{[0-9]+}}
+define i64 @diamond(i64 %a, i64 %b) {
+entry:
+  %c = icmp ugt i64 %a, %b
+  br i1 %c, label %then, label %else
+then:
+  %x = mul i64 %a, %b
+  br label %done
+else:
+  %y = sub i64 %b, %a
+  br label %done
+done:
+  %r = phi i64 [ %x, %then ], [ %y, %else ]
+  ret i64 %r
+}
+
+; CHECK-LABEL: loop:
+; CHECK: # Verifier complexity: unbounded (loop)
+define i64 @loop(i64 %n) {
+entry:
+  br label %body
+body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %body ]
+  %i.next = add i64 %i, 1
+  %c = icmp ult i64 %i.next, %n
+  br i1 %c, label %body, label %exit
+exit:
+  ret i64 %i.next
+}
@@ -0,0 +1,76 @@
+; RUN: opt < %s -S -nvptx-infer-addrspace | FileCheck %s --check-prefix IR
+; RUN: llc < %s -march=nvptx64 -mcpu=sm_20 -nvptx-use-infer-addrspace | FileCheck %s --check-prefix PTX
+
+target datalayout = "e-i64:64-v16:16-v32:32-n16:32:64"
+
+@shared = internal addrspace(3) global [10 x float] zeroinitializer, align 4
+@shared2 = internal addrspace(3) global [10 x float] zeroinitializer, align 4
+
+; Both sides of the select point to shared memory.
+
+; IR-LABEL: @select_shared(
+; IR: %p = select i1 %c, float addrspace(3)* %a, float addrspace(3)* %b
+; IR: load float, float addrspace(3)* %p
+; PTX-LABEL: select_shared(
+; PTX: ld.shared.f32
+define float @select_shared(i1 %c, i32 %i) {
+  %g1 = addrspacecast [10 x float] addrspace(3)* @shared to [10 x float]*
+  %g2 = addrspacecast [10 x float] addrspace(3)* @shared2 to [10 x float]*
+  %a = getelementptr [10 x float], [10 x float]* %g1, i32 0, i32 %i
+  %b = getelementptr [10 x float], [10 x float]* %g2, i32 0, i32 %i
+  %p = select i1 %c, float* %a, float* %b
+  %v = load float, float* %p
+  ret float %v
+}
+
+; Selecting between shared and global memory stays generic.
+
+; IR-LABEL: @select_mixed(
+; IR: %p = select i1 %c, float* %a, float* %b
+; IR: load float, float* %p
+define float @select_mixed(i1 %c, float addrspace(1)* %global) {
+  %a = addrspacecast [10 x float] addrspace(3)* getelementptr ([10 x float], [10 x float] addrspace(3)* @shared, i32 0, i32 0) to float*
+  %b = addrspacecast float addrspace(1)* %global to float*
+  %p = select i1 %c, float* %a, float* %b
+  %v = load float, float* %p
+  ret float %v
+}
+
+; Every call to @callee passes a pointer into global memory, so the accesses
+; in @callee use the global address space.
+
+; IR-LABEL: define internal void @callee(
+; IR: %out.specific = addrspacecast float* %out to float addrspace(1)*
+; IR: store float %v, float addrspace(1)* %out.specific
+; PTX-LABEL: callee(
+; PTX: st.global.f32
+define internal void @callee(float* %out, float %v) {
+  store float %v, float* %out
+  ret void
+}
+
+; IR-LABEL: @caller(
+define void @caller(float addrspace(1)* %out, i32 %i) {
+  %g = addrspacecast float addrspace(1)* %out to float*
+  %p = getelementptr float, float* %g, i32 %i
+  call void @callee(float* %g, float 1.0)
+  call void @callee(float* %p, float 2.0)
+  ret void
+}
+
+; @escaped is not only called directly, so its argument stays generic and no
+; casts are left behind.
+
+; IR-LABEL: define internal void @escaped(
+; IR-NOT: addrspacecast
+; IR: store float %v, float* %out
+define internal void @escaped(float* %out, float %v) {
+  store float %v, float* %out
+  ret void
+}
+
+define void (float*, float)* @take_address(float addrspace(1)* %out) {
+  %g = addrspacecast float addrspace(1)* %out to float*
+  call void @escaped(float* %g, float 1.0)
+  ret void (float*, float)* @escaped
+}
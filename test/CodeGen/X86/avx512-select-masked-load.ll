@@ -0,0 +1,40 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -mcpu=knl | FileCheck %s
+
+; A select on the mask of a masked load or gather becomes its pass-through
+; value, so the load writes straight into the register holding %x.
+
+; CHECK-LABEL: select_masked_load:
+; CHECK: vmovdqu32 (%rdi), %zmm{{[0-9]+}} {%k1}
+; CHECK-NOT: vpblendm
+; CHECK: retq
+define <16 x i32> @select_masked_load(<16 x i32>* %p, <16 x i1> %m, <16 x i32> %x) {
+  %l = call <16 x i32> @llvm.masked.load.v16i32(<16 x i32>* %p, i32 4, <16 x i1> %m, <16 x i32> undef)
+  %r = select <16 x i1> %m, <16 x i32> %l, <16 x i32> %x
+  ret <16 x i32> %r
+}
+
+; CHECK-LABEL: select_masked_gather:
+; CHECK: vpgatherdd (%rdi,%zmm{{[0-9]+}},4), %zmm{{[0-9]+}} {%k1}
+; CHECK-NOT: vpblendm
+; CHECK: retq
+define <16 x i32> @select_masked_gather(i32* %base, <16 x i32> %ind, <16 x i1> %m, <16 x i32> %x) {
+  %sext = sext <16 x i32> %ind to <16 x i64>
+  %ptrs = getelementptr i32, i32* %base, <16 x i64> %sext
+  %g = call <16 x i32> @llvm.masked.gather.v16i32(<16 x i32*> %ptrs, i32 4, <16 x i1> %m, <16 x i32> undef)
+  %r = select <16 x i1> %m, <16 x i32> %g, <16 x i32> %x
+  ret <16 x i32> %r
+}
+
+; A different mask still needs the blend, done as a masked move.
+
+; CHECK-LABEL: select_other_mask:
+; CHECK: vmovdqu32 (%rdi), %zmm{{[0-9]+}} {%k{{[0-9]}}} {z}
+; CHECK: vmovdqa32 %zmm{{[0-9]+}}, %zmm{{[0-9]+}} {%k{{[0-9]}}}
+define <16 x i32> @select_other_mask(<16 x i32>* %p, <16 x i1> %m, <16 x i1> %n, <16 x i32> %x) {
+  %l = call <16 x i32> @llvm.masked.load.v16i32(<16 x i32>* %p, i32 4, <16 x i1> %m, <16 x i32> undef)
+  %r = select <16 x i1> %n, <16 x i32> %l, <16 x i32> %x
+  ret <16 x i32> %r
+}
+
+declare <16 x i32> @llvm.masked.load.v16i32(<16 x i32>*, i32, <16 x i1>, <16 x i32>)
+declare <16 x i32> @llvm.masked.gather.v16i32(<16 x i32*>, i32, <16 x i1>, <16 x i32>)
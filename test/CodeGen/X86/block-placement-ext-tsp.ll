@@ -0,0 +1,72 @@
+; RUN: llc -mtriple=x86_64-linux -enable-ext-tsp-block-placement < %s | FileCheck %s
+
+declare void @error(i32)
+declare void @work(i32)
+
+; The cold error handling stays out of the hot path.
+define void @ifchains(i32 %a, i32 %b, i32 %c) {
+; CHECK-LABEL: ifchains:
+; CHECK: %entry
+; CHECK-NOT: %then
+; CHECK: %else1
+; CHECK-NOT: %then
+; CHECK: %else2
+; CHECK-NOT: %then
+; CHECK: %exit
+entry:
+  %cond1 = icmp ugt i32 %a, 1
+  br i1 %cond1, label %then1, label %else1, !prof !0
+
+then1:
+  call void @error(i32 1)
+  br label %else1
+
+else1:
+  call void @work(i32 1)
+  %cond2 = icmp ugt i32 %b, 2
+  br i1 %cond2, label %then2, label %else2, !prof !0
+
+then2:
+  call void @error(i32 2)
+  br label %else2
+
+else2:
+  call void @work(i32 2)
+  %cond3 = icmp ugt i32 %c, 3
+  br i1 %cond3, label %then3, label %exit, !prof !0
+
+then3:
+  call void @error(i32 3)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; The hotter side of the diamond falls through from the branch and into the
+; join, and the other side comes right after it.
+define void @diamond(i32 %a) {
+; CHECK-LABEL: diamond:
+; CHECK: %entry
+; CHECK: %left
+; CHECK: %join
+; CHECK: %right
+entry:
+  %cond = icmp ugt i32 %a, 1
+  br i1 %cond, label %right, label %left, !prof !1
+
+left:
+  call void @work(i32 1)
+  br label %join
+
+right:
+  call void @work(i32 2)
+  br label %join
+
+join:
+  call void @work(i32 3)
+  ret void
+}
+
+!0 = !{!"branch_weights", i32 1, i32 1000}
+!1 = !{!"branch_weights", i32 40, i32 60}
@@ -0,0 +1,31 @@
+; RUN: llc < %s -verify-coalescing | FileCheck %s
+; RUN: llc < %s -verify-coalescing -join-retry-budget=0 | FileCheck %s
+; RUN: llc < %s -verify-coalescing -join-by-block-freq | FileCheck %s
+;
+; The copies of the rotating phis interfere with each other and are retried
+; once the others were joined. Running out of retries or visiting the blocks
+; by frequency must still leave valid live intervals.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-LABEL: rotate:
+; CHECK: jl
+; CHECK: retq
+define i32 @rotate(i32 %a, i32 %b, i32 %c, i32 %n) {
+entry:
+  br label %loop
+
+loop:
+  %x = phi i32 [ %a, %entry ], [ %y, %loop ]
+  %y = phi i32 [ %b, %entry ], [ %z, %loop ]
+  %z = phi i32 [ %c, %entry ], [ %x, %loop ]
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %i.next = add i32 %i, 1
+  %cmp = icmp slt i32 %i.next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %s = sub i32 %x, %y
+  %r = mul i32 %s, %z
+  ret i32 %r
+}
@@ -0,0 +1,19 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -combiner-visit-stats \
+; RUN:     -o /dev/null 2>&1 | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -combiner-max-node-visits=1 \
+; RUN:     -verify-machineinstrs | FileCheck %s --check-prefix=CAPPED
+
+; CHECK: DAG combiner visits in 'f' at combine level 0:
+; CHECK-NEXT: Visits  Combines    Capped  Opcode
+; CHECK: {{[0-9]+ +[0-9]+ +0}}  add
+; CHECK: DAG combiner visits in 'f' at combine level 3:
+
+; CAPPED-LABEL: f:
+; CAPPED: retq
+
+define i32 @f(i32 %a, i32 %b) {
+  %x = add i32 %a, 0
+  %y = shl i32 %x, 2
+  %z = add i32 %y, %b
+  ret i32 %z
+}
@@ -0,0 +1,36 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -O0 -mattr=+popcnt | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -O0 -fast-isel-report -mattr=+popcnt -o /dev/null 2>&1 | FileCheck %s --check-prefix=REPORT
+
+; Intrinsics that are plain aliases of an ISD node are selected with the
+; generated patterns instead of falling back to SelectionDAG.
+
+; CHECK-LABEL: test_bswap:
+; CHECK: bswapl
+define i32 @test_bswap(i32 %x) {
+  %r = call i32 @llvm.bswap.i32(i32 %x)
+  ret i32 %r
+}
+
+; CHECK-LABEL: test_ctpop:
+; CHECK: popcntq
+define i64 @test_ctpop(i64 %x) {
+  %r = call i64 @llvm.ctpop.i64(i64 %x)
+  ret i64 %r
+}
+
+; The i128 add is not handled by FastISel, so the whole block up to it is
+; handed to SelectionDAG.
+define i128 @test_fallback(i128 %x, i128 %y) {
+  %r = add i128 %x, %y
+  ret i128 %r
+}
+
+; REPORT: FastISel fallback report
+; REPORT: 4 instructions selected by FastISel, 2 handed to SelectionDAG
+; REPORT: Fallbacks  Instrs  Cause
+; REPORT-NEXT: 1       2  ret i128
+; REPORT-NEXT: 1       0  <arguments>
+; REPORT-NOT: call
+
+declare i32 @llvm.bswap.i32(i32)
+declare i64 @llvm.ctpop.i64(i64)
@@ -0,0 +1,21 @@
+; RUN: rm -f %t
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -isel-matcher-profile=%t \
+; RUN:     -o /dev/null
+; RUN: FileCheck %s < %t
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -isel-matcher-profile=%t \
+; RUN:     -o /dev/null
+; RUN: FileCheck %s < %t
+
+; The profile records how often each switch case in the matcher table is
+; taken, and later runs add to it.
+
+; CHECK: table-size {{[0-9]+}}
+; CHECK-NEXT: {{[0-9]+ [0-9]+}}
+
+define i32 @f(i32 %a, i32* %p) {
+  %x = load i32, i32* %p
+  %y = add i32 %x, %a
+  %z = shl i32 %y, 3
+  store i32 %z, i32* %p
+  ret i32 %z
+}
@@ -0,0 +1,22 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -disable-cgp < %s | FileCheck %s
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -disable-cgp -isel-skip-empty-dags=false < %s | FileCheck %s
+
+; %a only falls through to %b, so its selection DAG has nothing to select.
+; Skipping it must not change the code of the surrounding blocks.
+
+declare void @g()
+
+; CHECK-LABEL: f:
+; CHECK: testb $1, %dil
+; CHECK-NEXT: callq g
+; CHECK-NEXT: popq %rax
+; CHECK-NEXT: retq
+define void @f(i1 %c) {
+entry:
+  br i1 %c, label %a, label %b
+a:
+  br label %b
+b:
+  call void @g()
+  ret void
+}
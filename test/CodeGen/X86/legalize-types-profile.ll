@@ -0,0 +1,20 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux-gnu -profile-legalize-types -o /dev/null 2>&1 | FileCheck %s
+
+; The type legalizer reports the time spent on the nodes of each opcode and
+; illegal type, and nothing for the nodes whose types are all legal.
+
+; CHECK: Type Legalization by Opcode
+; CHECK-DAG: mul i128
+; CHECK-DAG: add i128
+; CHECK-DAG: add v3i64
+; CHECK-DAG: store v3i64
+; CHECK-NOT: {{ i64$}}
+; CHECK: Total
+
+define i128 @f(i128 %a, i128 %b, <3 x i64> %v, <3 x i64>* %p) {
+  %m = mul i128 %a, %b
+  %s = add i128 %m, %a
+  %w = add <3 x i64> %v, %v
+  store <3 x i64> %w, <3 x i64>* %p
+  ret i128 %s
+}
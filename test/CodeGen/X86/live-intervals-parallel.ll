@@ -0,0 +1,60 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -verify-machineinstrs > %t.serial
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -verify-machineinstrs \
+; RUN:     -live-intervals-threads=4 -live-intervals-parallel-threshold=0 \
+; RUN:     > %t.parallel
+; RUN: diff %t.serial %t.parallel
+
+; Computing the live intervals of the virtual registers on several threads
+; must not change the generated code.
+
+define i32 @f(i32* %p, i32 %n) {
+entry:
+  %a0 = load i32, i32* %p
+  %p1 = getelementptr i32, i32* %p, i64 1
+  %a1 = load i32, i32* %p1
+  %p2 = getelementptr i32, i32* %p, i64 2
+  %a2 = load i32, i32* %p2
+  %p3 = getelementptr i32, i32* %p, i64 3
+  %a3 = load i32, i32* %p3
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %x0 = phi i32 [ %a0, %entry ], [ %y0, %loop ]
+  %x1 = phi i32 [ %a1, %entry ], [ %y1, %loop ]
+  %x2 = phi i32 [ %a2, %entry ], [ %y2, %loop ]
+  %x3 = phi i32 [ %a3, %entry ], [ %y3, %loop ]
+  %y0 = add i32 %x0, %x1
+  %y1 = xor i32 %x1, %x2
+  %y2 = mul i32 %x2, %x3
+  %t = trunc i32 %x0 to i8
+  %s = sext i8 %t to i32
+  %y3 = sub i32 %x3, %s
+  %i.next = add i32 %i, 1
+  %cond = icmp slt i32 %i.next, %n
+  br i1 %cond, label %loop, label %exit
+
+exit:
+  %r0 = add i32 %y0, %y1
+  %r1 = add i32 %y2, %y3
+  %r = add i32 %r0, %r1
+  ret i32 %r
+}
+
+define i64 @g(i64 %a, i64 %b, i1 %c) {
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %x = mul i64 %a, %b
+  br label %join
+
+else:
+  %y = udiv i64 %a, %b
+  br label %join
+
+join:
+  %z = phi i64 [ %x, %then ], [ %y, %else ]
+  %w = add i64 %z, %a
+  ret i64 %w
+}
@@ -0,0 +1,112 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -misched-window=8 \
+; RUN:     -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-unknown -misched-window=8 \
+; RUN:     -stats -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; A block larger than the window is scheduled in several overlapping windows.
+
+; CHECK-LABEL: sum:
+; CHECK: retq
+
+; STATS: Number of windows in huge scheduling regions
+
+define i64 @sum(i64* %p) {
+entry:
+  %p0 = getelementptr i64, i64* %p, i64 0
+  %v0 = load i64, i64* %p0
+  %m0 = mul i64 %v0, 3
+  %p1 = getelementptr i64, i64* %p, i64 1
+  %v1 = load i64, i64* %p1
+  %m1 = mul i64 %v1, 4
+  %s1 = add i64 %m0, %m1
+  %p2 = getelementptr i64, i64* %p, i64 2
+  %v2 = load i64, i64* %p2
+  %m2 = mul i64 %v2, 5
+  %s2 = add i64 %s1, %m2
+  %p3 = getelementptr i64, i64* %p, i64 3
+  %v3 = load i64, i64* %p3
+  %m3 = mul i64 %v3, 6
+  %s3 = add i64 %s2, %m3
+  %p4 = getelementptr i64, i64* %p, i64 4
+  %v4 = load i64, i64* %p4
+  %m4 = mul i64 %v4, 7
+  %s4 = add i64 %s3, %m4
+  %p5 = getelementptr i64, i64* %p, i64 5
+  %v5 = load i64, i64* %p5
+  %m5 = mul i64 %v5, 8
+  %s5 = add i64 %s4, %m5
+  %p6 = getelementptr i64, i64* %p, i64 6
+  %v6 = load i64, i64* %p6
+  %m6 = mul i64 %v6, 9
+  %s6 = add i64 %s5, %m6
+  %p7 = getelementptr i64, i64* %p, i64 7
+  %v7 = load i64, i64* %p7
+  %m7 = mul i64 %v7, 10
+  %s7 = add i64 %s6, %m7
+  %p8 = getelementptr i64, i64* %p, i64 8
+  %v8 = load i64, i64* %p8
+  %m8 = mul i64 %v8, 11
+  %s8 = add i64 %s7, %m8
+  %p9 = getelementptr i64, i64* %p, i64 9
+  %v9 = load i64, i64* %p9
+  %m9 = mul i64 %v9, 12
+  %s9 = add i64 %s8, %m9
+  %p10 = getelementptr i64, i64* %p, i64 10
+  %v10 = load i64, i64* %p10
+  %m10 = mul i64 %v10, 13
+  %s10 = add i64 %s9, %m10
+  %p11 = getelementptr i64, i64* %p, i64 11
+  %v11 = load i64, i64* %p11
+  %m11 = mul i64 %v11, 14
+  %s11 = add i64 %s10, %m11
+  %p12 = getelementptr i64, i64* %p, i64 12
+  %v12 = load i64, i64* %p12
+  %m12 = mul i64 %v12, 15
+  %s12 = add i64 %s11, %m12
+  %p13 = getelementptr i64, i64* %p, i64 13
+  %v13 = load i64, i64* %p13
+  %m13 = mul i64 %v13, 16
+  %s13 = add i64 %s12, %m13
+  %p14 = getelementptr i64, i64* %p, i64 14
+  %v14 = load i64, i64* %p14
+  %m14 = mul i64 %v14, 17
+  %s14 = add i64 %s13, %m14
+  %p15 = getelementptr i64, i64* %p, i64 15
+  %v15 = load i64, i64* %p15
+  %m15 = mul i64 %v15, 18
+  %s15 = add i64 %s14, %m15
+  %p16 = getelementptr i64, i64* %p, i64 16
+  %v16 = load i64, i64* %p16
+  %m16 = mul i64 %v16, 19
+  %s16 = add i64 %s15, %m16
+  %p17 = getelementptr i64, i64* %p, i64 17
+  %v17 = load i64, i64* %p17
+  %m17 = mul i64 %v17, 20
+  %s17 = add i64 %s16, %m17
+  %p18 = getelementptr i64, i64* %p, i64 18
+  %v18 = load i64, i64* %p18
+  %m18 = mul i64 %v18, 21
+  %s18 = add i64 %s17, %m18
+  %p19 = getelementptr i64, i64* %p, i64 19
+  %v19 = load i64, i64* %p19
+  %m19 = mul i64 %v19, 22
+  %s19 = add i64 %s18, %m19
+  %p20 = getelementptr i64, i64* %p, i64 20
+  %v20 = load i64, i64* %p20
+  %m20 = mul i64 %v20, 23
+  %s20 = add i64 %s19, %m20
+  %p21 = getelementptr i64, i64* %p, i64 21
+  %v21 = load i64, i64* %p21
+  %m21 = mul i64 %v21, 24
+  %s21 = add i64 %s20, %m21
+  %p22 = getelementptr i64, i64* %p, i64 22
+  %v22 = load i64, i64* %p22
+  %m22 = mul i64 %v22, 25
+  %s22 = add i64 %s21, %m22
+  %p23 = getelementptr i64, i64* %p, i64 23
+  %v23 = load i64, i64* %p23
+  %m23 = mul i64 %v23, 26
+  %s23 = add i64 %s22, %m23
+  ret i64 %s23
+}
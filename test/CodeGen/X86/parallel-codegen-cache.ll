@@ -0,0 +1,32 @@
+; REQUIRES: asserts
+; RUN: rm -rf %t.cache
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j2 -codegen-cache-dir=%t.cache \
+; RUN:   -stats -o %t1.s %s 2>&1 | FileCheck --check-prefix=MISS %s
+; RUN: ls %t.cache | count 2
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j2 -codegen-cache-dir=%t.cache \
+; RUN:   -stats -o %t2.s %s 2>&1 | FileCheck --check-prefix=HIT %s
+; RUN: diff %t1.s.0 %t2.s.0
+; RUN: diff %t1.s.1 %t2.s.1
+; RUN: cat %t2.s.0 %t2.s.1 | FileCheck %s
+
+; A different target configuration does not reuse the cached partitions.
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -j2 \
+; RUN:   -codegen-cache-dir=%t.cache -o %t3.s %s
+; RUN: ls %t.cache | count 4
+
+; MISS: 2 split-codegen - Number of partitions added to the cache
+; MISS-NOT: reused from the cache
+; HIT-NOT: added to the cache
+; HIT: 2 split-codegen - Number of partitions reused from the cache
+
+; CHECK-DAG: foo:
+; CHECK-DAG: bar:
+
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+define void @bar() {
+  ret void
+}
@@ -0,0 +1,23 @@
+; RUN: llc -mtriple=x86_64-unknown-linux-gnu -j2 -o %t.s %s
+; RUN: FileCheck --check-prefix=CHECK0 %s < %t.s.0
+; RUN: FileCheck --check-prefix=CHECK1 %s < %t.s.1
+; RUN: not llc -mtriple=x86_64-unknown-linux-gnu -j2 -o - %s 2>&1 \
+; RUN:   | FileCheck --check-prefix=ERR %s
+
+; ERR: -j requires an output filename
+
+; CHECK0-NOT: bar:
+; CHECK0: foo:
+; CHECK0-NOT: bar:
+define void @foo() {
+  call void @bar()
+  ret void
+}
+
+; CHECK1-NOT: foo:
+; CHECK1: bar:
+; CHECK1-NOT: foo:
+define void @bar() {
+  call void @foo()
+  ret void
+}
@@ -0,0 +1,130 @@
+; RUN: llc < %s -mtriple=x86_64-unknown-linux -regalloc=linearscan \
+; RUN:     -verify-machineinstrs | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-unknown-linux -regalloc=linearscan \
+; RUN:     -stats -o /dev/null 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; The linear scan allocator evicts or spills live ranges when a call clobbers
+; the registers of a loop with more live values than callee-saved registers.
+
+; CHECK-LABEL: pressure:
+; CHECK: callq clobber
+; CHECK: retq
+
+; STATS: live ranges spilled by linear scan
+
+declare void @clobber()
+
+define i64 @pressure(i64* %p, i64 %n) {
+entry:
+  %p0 = getelementptr i64, i64* %p, i64 0
+  %init0 = load i64, i64* %p0
+  %p1 = getelementptr i64, i64* %p, i64 1
+  %init1 = load i64, i64* %p1
+  %p2 = getelementptr i64, i64* %p, i64 2
+  %init2 = load i64, i64* %p2
+  %p3 = getelementptr i64, i64* %p, i64 3
+  %init3 = load i64, i64* %p3
+  %p4 = getelementptr i64, i64* %p, i64 4
+  %init4 = load i64, i64* %p4
+  %p5 = getelementptr i64, i64* %p, i64 5
+  %init5 = load i64, i64* %p5
+  %p6 = getelementptr i64, i64* %p, i64 6
+  %init6 = load i64, i64* %p6
+  %p7 = getelementptr i64, i64* %p, i64 7
+  %init7 = load i64, i64* %p7
+  %p8 = getelementptr i64, i64* %p, i64 8
+  %init8 = load i64, i64* %p8
+  %p9 = getelementptr i64, i64* %p, i64 9
+  %init9 = load i64, i64* %p9
+  %p10 = getelementptr i64, i64* %p, i64 10
+  %init10 = load i64, i64* %p10
+  %p11 = getelementptr i64, i64* %p, i64 11
+  %init11 = load i64, i64* %p11
+  %p12 = getelementptr i64, i64* %p, i64 12
+  %init12 = load i64, i64* %p12
+  %p13 = getelementptr i64, i64* %p, i64 13
+  %init13 = load i64, i64* %p13
+  %p14 = getelementptr i64, i64* %p, i64 14
+  %init14 = load i64, i64* %p14
+  %p15 = getelementptr i64, i64* %p, i64 15
+  %init15 = load i64, i64* %p15
+  %p16 = getelementptr i64, i64* %p, i64 16
+  %init16 = load i64, i64* %p16
+  %p17 = getelementptr i64, i64* %p, i64 17
+  %init17 = load i64, i64* %p17
+  %p18 = getelementptr i64, i64* %p, i64 18
+  %init18 = load i64, i64* %p18
+  %p19 = getelementptr i64, i64* %p, i64 19
+  %init19 = load i64, i64* %p19
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %a0 = phi i64 [ %init0, %entry ], [ %b0, %loop ]
+  %a1 = phi i64 [ %init1, %entry ], [ %b1, %loop ]
+  %a2 = phi i64 [ %init2, %entry ], [ %b2, %loop ]
+  %a3 = phi i64 [ %init3, %entry ], [ %b3, %loop ]
+  %a4 = phi i64 [ %init4, %entry ], [ %b4, %loop ]
+  %a5 = phi i64 [ %init5, %entry ], [ %b5, %loop ]
+  %a6 = phi i64 [ %init6, %entry ], [ %b6, %loop ]
+  %a7 = phi i64 [ %init7, %entry ], [ %b7, %loop ]
+  %a8 = phi i64 [ %init8, %entry ], [ %b8, %loop ]
+  %a9 = phi i64 [ %init9, %entry ], [ %b9, %loop ]
+  %a10 = phi i64 [ %init10, %entry ], [ %b10, %loop ]
+  %a11 = phi i64 [ %init11, %entry ], [ %b11, %loop ]
+  %a12 = phi i64 [ %init12, %entry ], [ %b12, %loop ]
+  %a13 = phi i64 [ %init13, %entry ], [ %b13, %loop ]
+  %a14 = phi i64 [ %init14, %entry ], [ %b14, %loop ]
+  %a15 = phi i64 [ %init15, %entry ], [ %b15, %loop ]
+  %a16 = phi i64 [ %init16, %entry ], [ %b16, %loop ]
+  %a17 = phi i64 [ %init17, %entry ], [ %b17, %loop ]
+  %a18 = phi i64 [ %init18, %entry ], [ %b18, %loop ]
+  %a19 = phi i64 [ %init19, %entry ], [ %b19, %loop ]
+  call void @clobber()
+  %b0 = add i64 %a0, %a1
+  %b1 = add i64 %a1, %a2
+  %b2 = add i64 %a2, %a3
+  %b3 = add i64 %a3, %a4
+  %b4 = add i64 %a4, %a5
+  %b5 = add i64 %a5, %a6
+  %b6 = add i64 %a6, %a7
+  %b7 = add i64 %a7, %a8
+  %b8 = add i64 %a8, %a9
+  %b9 = add i64 %a9, %a10
+  %b10 = add i64 %a10, %a11
+  %b11 = add i64 %a11, %a12
+  %b12 = add i64 %a12, %a13
+  %b13 = add i64 %a13, %a14
+  %b14 = add i64 %a14, %a15
+  %b15 = add i64 %a15, %a16
+  %b16 = add i64 %a16, %a17
+  %b17 = add i64 %a17, %a18
+  %b18 = add i64 %a18, %a19
+  %b19 = add i64 %a19, %a0
+  %i.next = add i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %s1 = xor i64 %b0, %b1
+  %s2 = xor i64 %s1, %b2
+  %s3 = xor i64 %s2, %b3
+  %s4 = xor i64 %s3, %b4
+  %s5 = xor i64 %s4, %b5
+  %s6 = xor i64 %s5, %b6
+  %s7 = xor i64 %s6, %b7
+  %s8 = xor i64 %s7, %b8
+  %s9 = xor i64 %s8, %b9
+  %s10 = xor i64 %s9, %b10
+  %s11 = xor i64 %s10, %b11
+  %s12 = xor i64 %s11, %b12
+  %s13 = xor i64 %s12, %b13
+  %s14 = xor i64 %s13, %b14
+  %s15 = xor i64 %s14, %b15
+  %s16 = xor i64 %s15, %b16
+  %s17 = xor i64 %s16, %b17
+  %s18 = xor i64 %s17, %b18
+  %s19 = xor i64 %s18, %b19
+  ret i64 %s19
+}
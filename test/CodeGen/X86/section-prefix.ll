@@ -0,0 +1,20 @@
+; RUN: llc < %s -mtriple=x86_64-pc-linux | FileCheck %s
+; RUN: llc < %s -mtriple=x86_64-pc-linux -function-sections | FileCheck %s --check-prefix=SECTIONS
+
+; CHECK:   .section .text.hot,"ax",@progbits
+; CHECK: f:
+; SECTIONS:   .section .text.hot.f,"ax",@progbits
+; SECTIONS: f:
+define void @f() !section_prefix !0 {
+  ret void
+}
+
+; CHECK:   .text
+; CHECK: g:
+; SECTIONS:   .section .text.g,"ax",@progbits
+; SECTIONS: g:
+define void @g() {
+  ret void
+}
+
+!0 = !{!"function_section_prefix", !".hot"}
@@ -0,0 +1,44 @@
+; RUN: llc -verify-machineinstrs < %s | FileCheck %s
+; RUN: llc -verify-machineinstrs -use-registers-for-deopt-values < %s | FileCheck %s --check-prefix=REGS
+
+target datalayout = "e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-pc-linux-gnu"
+
+declare void @foo()
+
+; A deopt value of two statepoints in a row is only stored once: the second
+; statepoint refers to the slot the first one spilled it to.  With registers
+; allowed, it stays in a callee saved register instead.
+define void @deopt_twice(i32 %a) gc "statepoint-example" {
+; CHECK-LABEL: deopt_twice:
+; CHECK: movl %edi, {{[0-9]*}}(%rsp)
+; CHECK-NEXT: callq foo
+; CHECK-NOT: mov
+; CHECK: callq foo
+; CHECK-NOT: mov
+; CHECK: retq
+; REGS-LABEL: deopt_twice:
+; REGS: movl %edi, %ebx
+; REGS-NEXT: callq foo
+; REGS-NOT: mov
+; REGS: callq foo
+; REGS-NOT: mov
+; REGS: retq
+entry:
+  %t1 = call token (i64, i32, void ()*, i32, i32, ...) @llvm.experimental.gc.statepoint.p0f_isVoidf(i64 0, i32 0, void ()* @foo, i32 0, i32 0, i32 0, i32 1, i32 %a)
+  %t2 = call token (i64, i32, void ()*, i32, i32, ...) @llvm.experimental.gc.statepoint.p0f_isVoidf(i64 0, i32 0, void ()* @foo, i32 0, i32 0, i32 0, i32 1, i32 %a)
+  ret void
+}
+
+; A deopt value which is dead after the call may be allocated to a register
+; the call clobbers; it is spilled right before the call.
+define void @deopt_clobbered(i32 %a) gc "statepoint-example" {
+; REGS-LABEL: deopt_clobbered:
+; REGS: movl %edi, {{[0-9]*}}(%rsp)
+; REGS-NEXT: callq foo
+entry:
+  %t = call token (i64, i32, void ()*, i32, i32, ...) @llvm.experimental.gc.statepoint.p0f_isVoidf(i64 0, i32 0, void ()* @foo, i32 0, i32 0, i32 0, i32 1, i32 %a)
+  ret void
+}
+
+declare token @llvm.experimental.gc.statepoint.p0f_isVoidf(i64, i32, void ()*, i32, i32, ...)
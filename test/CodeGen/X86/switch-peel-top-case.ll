@@ -0,0 +1,59 @@
+; RUN: llc -mtriple=x86_64-linux-gnu %s -o - -verify-machineinstrs | FileCheck %s
+; RUN: llc -mtriple=x86_64-linux-gnu %s -o - -switch-peel-threshold=101 -verify-machineinstrs | FileCheck %s --check-prefix=NOPEEL
+
+declare void @g(i32)
+
+; Case 5 is taken most of the time, so it is tested on its own before the
+; range check and jump table for the remaining cases.
+
+define void @peel_dominant_case(i32 %x) {
+entry:
+  switch i32 %x, label %return [
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+    i32 4, label %bb4
+    i32 5, label %bb5
+  ], !prof !0
+bb1: tail call void @g(i32 1) br label %return
+bb2: tail call void @g(i32 2) br label %return
+bb3: tail call void @g(i32 3) br label %return
+bb4: tail call void @g(i32 4) br label %return
+bb5: tail call void @g(i32 5) br label %return
+return: ret void
+
+; CHECK-LABEL: peel_dominant_case
+; CHECK-NOT: cmpl
+; CHECK: cmpl $5, %edi
+; CHECK-NEXT: jne
+; CHECK: jmpq *.LJTI
+
+; NOPEEL-LABEL: peel_dominant_case
+; NOPEEL-NOT: cmpl $5
+; NOPEEL: jmpq *.LJTI
+}
+
+!0 = !{!"branch_weights", i32 1, i32 1, i32 1, i32 1, i32 1, i32 100}
+
+define void @no_dominant_case(i32 %x) {
+entry:
+  switch i32 %x, label %return [
+    i32 1, label %bb1
+    i32 2, label %bb2
+    i32 3, label %bb3
+    i32 4, label %bb4
+    i32 5, label %bb5
+  ], !prof !1
+bb1: tail call void @g(i32 1) br label %return
+bb2: tail call void @g(i32 2) br label %return
+bb3: tail call void @g(i32 3) br label %return
+bb4: tail call void @g(i32 4) br label %return
+bb5: tail call void @g(i32 5) br label %return
+return: ret void
+
+; CHECK-LABEL: no_dominant_case
+; CHECK-NOT: cmpl $5
+; CHECK: jmpq *.LJTI
+}
+
+!1 = !{!"branch_weights", i32 1, i32 10, i32 10, i32 10, i32 10, i32 50}
@@ -0,0 +1,45 @@
+; RUN: llc %s -o - -enable-shrink-wrap=true -shrink-wrap-multiple-restores | FileCheck %s --check-prefix=CHECK --check-prefix=MULTI
+; RUN: llc %s -o - -enable-shrink-wrap=true | FileCheck %s --check-prefix=CHECK --check-prefix=SINGLE
+target datalayout = "e-m:o-i64:64-i128:128-n32:64-S128"
+target triple = "x86_64-apple-macosx"
+
+; The slow path leaves the function through two different returns, so there
+; is no single block post-dominating all the uses of the callee-saved
+; registers. With several restore points, the fast path still runs without
+; the prologue.
+; CHECK-LABEL: twoReturns:
+; MULTI: testl %edi, %edi
+; MULTI-NEXT: je [[FAST:LBB[0-9_]+]]
+; MULTI: pushq %rbx
+; MULTI: movl $2, %ebx
+; MULTI: popq %rbx
+; MULTI-NEXT: retq
+; MULTI: [[FAST]]:
+; MULTI-NEXT: xorl %eax, %eax
+; MULTI-NEXT: retq
+; MULTI: movl $2, %eax
+; MULTI-NEXT: popq %rbx
+; MULTI-NEXT: retq
+;
+; SINGLE: pushq %rbx
+; SINGLE: testl %edi, %edi
+define i32 @twoReturns(i32 %a, i32 %b) {
+entry:
+  %tobool = icmp eq i32 %a, 0
+  br i1 %tobool, label %fast, label %slow
+
+fast:
+  ret i32 0
+
+slow:
+  call void asm sideeffect "movl $$1, %ebx", "~{ebx}"()
+  %cmp = icmp sgt i32 %b, 10
+  br i1 %cmp, label %again, label %done
+
+again:
+  call void asm sideeffect "movl $$2, %ebx", "~{ebx}"()
+  ret i32 1
+
+done:
+  ret i32 2
+}
@@ -0,0 +1,40 @@
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-speculate-threads=1 \
+; RUN:   -orc-lazy-debug=funcs-to-stdout %s | FileCheck %s
+; RUN: lli -jit-kind=orc-lazy -orc-lazy-debug=funcs-to-stdout %s \
+; RUN:   | FileCheck %s --check-prefix=LAZY
+;
+; @cold is never called, but it is a direct callee of @main, so it is compiled
+; in the background once @main has been compiled. @colder is two calls away
+; from @main and stays lazy.
+;
+; CHECK-DAG: [ {{.*}}main ]
+; CHECK-DAG: [ {{.*}}cold ]
+; CHECK-NOT: colder
+;
+; LAZY: [ {{.*}}main ]
+; LAZY-NOT: cold
+
+define i32 @colder() {
+entry:
+  ret i32 2
+}
+
+define i32 @cold() {
+entry:
+  %0 = call i32 @colder()
+  ret i32 %0
+}
+
+define i32 @main(i32 %argc, i8** nocapture readnone %argv) {
+entry:
+  %big = icmp sgt i32 %argc, 100
+  br i1 %big, label %call, label %done
+
+call:
+  %0 = call i32 @cold()
+  br label %done
+
+done:
+  %r = phi i32 [ %0, %call ], [ 0, %entry ]
+  ret i32 %r
+}
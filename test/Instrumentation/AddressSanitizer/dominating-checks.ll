@@ -0,0 +1,128 @@
+; Test that -asan-opt-dominating drops the checks that a dominating check
+; covers, and checks adjacent accesses at once.
+
+; RUN: opt < %s -asan -asan-module -asan-opt-dominating -asan-instrumentation-with-call-threshold=0 -S | FileCheck %s
+; RUN: opt < %s -asan -asan-module -asan-instrumentation-with-call-threshold=0 -S | FileCheck %s --check-prefix=NOOPT
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @f()
+
+; The load in the loop is covered by the load before it.
+define i32 @covered(i32* %p, i32 %n) sanitize_address {
+; CHECK-LABEL: @covered
+; CHECK: entry:
+; CHECK: call void @__asan_load4
+; CHECK: loop:
+; CHECK-NOT: call void @__asan_load
+; CHECK: ret i32
+; NOOPT-LABEL: @covered
+; NOOPT: call void @__asan_load4
+; NOOPT: call void @__asan_load4
+entry:
+  %a = load i32, i32* %p, align 4
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]
+  %b = load i32, i32* %p, align 4
+  %inc = add i32 %i, %b
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret i32 %a
+}
+
+; The 4-byte store is inside the 8-byte load.
+define void @covered_smaller(i64* %p) sanitize_address {
+; CHECK-LABEL: @covered_smaller
+; CHECK: call void @__asan_load8
+; CHECK-NOT: call void @__asan_store
+; CHECK: ret void
+entry:
+  %v = load i64, i64* %p, align 8
+  %q = bitcast i64* %p to i32*
+  %q1 = getelementptr i32, i32* %q, i64 1
+  store i32 0, i32* %q1, align 4
+  ret void
+}
+
+; A call may free the memory between the accesses.
+define void @call_between(i32* %p) sanitize_address {
+; CHECK-LABEL: @call_between
+; CHECK: call void @__asan_store4
+; CHECK: call void @f()
+; CHECK: call void @__asan_load4
+entry:
+  store i32 0, i32* %p, align 4
+  br label %next
+
+next:
+  call void @f()
+  %v = load i32, i32* %p, align 4
+  ret void
+}
+
+; Neither access dominates the other.
+define void @not_dominating(i32* %p, i1 %c) sanitize_address {
+; CHECK-LABEL: @not_dominating
+; CHECK: then:
+; CHECK: call void @__asan_load4
+; CHECK: else:
+; CHECK: call void @__asan_load4
+entry:
+  br i1 %c, label %then, label %else
+
+then:
+  %a = load i32, i32* %p, align 4
+  ret void
+
+else:
+  %b = load i32, i32* %p, align 4
+  ret void
+}
+
+; Two adjacent 4-byte stores are checked as one aligned 8-byte store.
+define void @combined(i32* %p) sanitize_address {
+; CHECK-LABEL: @combined
+; CHECK: call void @__asan_store8
+; CHECK-NOT: call void @__asan_store
+; CHECK: ret void
+; NOOPT-LABEL: @combined
+; NOOPT: call void @__asan_store4
+; NOOPT: call void @__asan_store4
+entry:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store i32 0, i32* %p, align 8
+  store i32 1, i32* %p1, align 4
+  ret void
+}
+
+; The lower store comes second, so the check starts before the first one.
+define void @combined_lower(i32* %p) sanitize_address {
+; CHECK-LABEL: @combined_lower
+; CHECK: [[BASE:%[0-9]+]] = bitcast i32* %p1 to i8*
+; CHECK: [[START:%[0-9]+]] = getelementptr i8, i8* [[BASE]], i64 -4
+; CHECK: [[INT:%[0-9]+]] = ptrtoint i8* [[START]] to i64
+; CHECK: call void @__asan_store8(i64 [[INT]])
+; CHECK-NOT: call void @__asan_store
+; CHECK: ret void
+entry:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store i32 1, i32* %p1, align 4
+  store i32 0, i32* %p, align 8
+  ret void
+}
+
+; The combined access would not be aligned.
+define void @not_combined(i32* %p) sanitize_address {
+; CHECK-LABEL: @not_combined
+; CHECK: call void @__asan_store4
+; CHECK: call void @__asan_store4
+entry:
+  %p1 = getelementptr i32, i32* %p, i64 1
+  store i32 0, i32* %p, align 4
+  store i32 1, i32* %p1, align 4
+  ret void
+}
@@ -0,0 +1,146 @@
+; Test that -asan-opt-loop-ranges checks the range of the strided accesses of
+; a loop once in its preheader.
+
+; RUN: opt < %s -asan -asan-module -asan-opt-loop-ranges -asan-instrumentation-with-call-threshold=0 -S | FileCheck %s
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @f()
+
+define void @copy(i32* %a, i32* %b, i64 %n) sanitize_address {
+; CHECK-LABEL: @copy
+; CHECK: loop.ph:
+; CHECK: [[B:%.*]] = ptrtoint i32* %b to i64
+; CHECK: call void @__asan_loadN(i64 [[B]], i64 [[SIZE:%.*]])
+; CHECK: [[A:%.*]] = ptrtoint i32* %a to i64
+; CHECK: call void @__asan_storeN(i64 [[A]], i64 [[SIZE2:%.*]])
+; CHECK-NEXT: br label %loop
+; CHECK: loop:
+; CHECK-NOT: call void @__asan_
+; CHECK: exit:
+entry:
+  %cmp0 = icmp sgt i64 %n, 0
+  br i1 %cmp0, label %loop.ph, label %exit
+
+loop.ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %loop.ph ], [ %i.next, %loop ]
+  %pb = getelementptr inbounds i32, i32* %b, i64 %i
+  %v = load i32, i32* %pb, align 4
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 %v, i32* %pa, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; The accesses go down from the end of the array.
+define void @reverse(i32* %a, i64 %n) sanitize_address {
+; CHECK-LABEL: @reverse
+; CHECK: loop.ph:
+; CHECK: call void @__asan_storeN(
+; CHECK: loop:
+; CHECK-NOT: call void @__asan_
+; CHECK: exit:
+entry:
+  %cmp0 = icmp sgt i64 %n, 0
+  br i1 %cmp0, label %loop.ph, label %exit
+
+loop.ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ %n, %loop.ph ], [ %i.next, %loop ]
+  %i.next = add nsw i64 %i, -1
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i.next
+  store i32 0, i32* %pa, align 4
+  %c = icmp sgt i64 %i.next, 0
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; Every other element is accessed, so the range has bytes that are not.
+define void @gaps(i32* %a, i64 %n) sanitize_address {
+; CHECK-LABEL: @gaps
+; CHECK: loop:
+; CHECK: call void @__asan_store4
+entry:
+  %cmp0 = icmp sgt i64 %n, 0
+  br i1 %cmp0, label %loop.ph, label %exit
+
+loop.ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %loop.ph ], [ %i.next, %loop ]
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %pa, align 4
+  %i.next = add nuw nsw i64 %i, 2
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; The call in the loop may free the memory.
+define void @call_in_loop(i32* %a, i64 %n) sanitize_address {
+; CHECK-LABEL: @call_in_loop
+; CHECK: loop:
+; CHECK: call void @__asan_store4
+entry:
+  %cmp0 = icmp sgt i64 %n, 0
+  br i1 %cmp0, label %loop.ph, label %exit
+
+loop.ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %loop.ph ], [ %i.next, %loop ]
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %pa, align 4
+  call void @f()
+  %i.next = add nuw nsw i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; The access does not run in every iteration.
+define void @conditional(i32* %a, i64 %n, i1 %p) sanitize_address {
+; CHECK-LABEL: @conditional
+; CHECK: then:
+; CHECK: call void @__asan_store4
+entry:
+  %cmp0 = icmp sgt i64 %n, 0
+  br i1 %cmp0, label %loop.ph, label %exit
+
+loop.ph:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %loop.ph ], [ %i.next, %latch ]
+  br i1 %p, label %then, label %latch
+
+then:
+  %pa = getelementptr inbounds i32, i32* %a, i64 %i
+  store i32 0, i32* %pa, align 4
+  br label %latch
+
+latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %c = icmp slt i64 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
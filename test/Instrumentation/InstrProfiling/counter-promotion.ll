@@ -0,0 +1,62 @@
+;; Check that the counters of loops are kept in registers and flushed at the
+;; loop exits.
+
+; RUN: opt < %s -instrprof -do-counter-promotion -S | FileCheck %s --check-prefix=PROMO
+; RUN: opt < %s -instrprof -do-counter-promotion -instrprof-atomic-counter-update-all -S | FileCheck %s --check-prefix=ATOMIC-PROMO
+; RUN: opt < %s -instrprof -instrprof-atomic-counter-update-all -S | FileCheck %s --check-prefix=ATOMIC
+; RUN: opt < %s -instrprof -S | FileCheck %s --check-prefix=NOPROMO
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@__profn_foo = private constant [3 x i8] c"foo"
+
+define void @foo(i32 %n) {
+entry:
+  call void @llvm.instrprof.increment(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 0, i32 2, i32 0)
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %inc, %loop ]
+  call void @llvm.instrprof.increment(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 0, i32 2, i32 1)
+  %inc = add nsw i32 %i, 1
+  %cmp = icmp slt i32 %inc, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  ret void
+}
+
+; PROMO-LABEL: define void @foo(
+; PROMO: loop:
+; PROMO-NEXT: %pgocount.promoted = phi i64 [ 0, %entry ], [ [[INC:%.*]], %loop ]
+; PROMO-NOT: load {{.*}}@__profc_foo, i64 0, i64 1)
+; PROMO: [[INC]] = add i64 %pgocount.promoted, 1
+; PROMO-NOT: store {{.*}}@__profc_foo, i64 0, i64 1)
+; PROMO: exit:
+; PROMO-NEXT: [[OLD:%.*]] = load i64, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1)
+; PROMO-NEXT: [[NEW:%.*]] = add i64 [[OLD]], [[INC]]
+; PROMO-NEXT: store i64 [[NEW]], i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1)
+; PROMO-NEXT: ret void
+
+; ATOMIC-PROMO-LABEL: define void @foo(
+; ATOMIC-PROMO: atomicrmw add i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 0), i64 1 monotonic
+; ATOMIC-PROMO: loop:
+; ATOMIC-PROMO-NEXT: %pgocount.promoted = phi i64
+; ATOMIC-PROMO: exit:
+; ATOMIC-PROMO-NEXT: atomicrmw add i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1), i64 {{%.*}} monotonic
+; ATOMIC-PROMO-NEXT: ret void
+
+; ATOMIC-LABEL: define void @foo(
+; ATOMIC: atomicrmw add i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 0), i64 1 monotonic
+; ATOMIC: loop:
+; ATOMIC: atomicrmw add i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1), i64 1 monotonic
+; ATOMIC-NOT: pgocount
+
+; NOPROMO-LABEL: define void @foo(
+; NOPROMO: loop:
+; NOPROMO: %pgocount{{[0-9]*}} = load i64, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1)
+; NOPROMO: store i64 {{%.*}}, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 1)
+; NOPROMO: exit:
+; NOPROMO-NEXT: ret void
+
+declare void @llvm.instrprof.increment(i8*, i64, i32, i32)
@@ -0,0 +1,55 @@
+;; Check that the counter updates are guarded by the sampling countdown.
+
+; RUN: opt < %s -instrprof -sampled-instrumentation -S | FileCheck %s
+; RUN: opt < %s -instrprof -sampled-instrumentation -sampled-instr-period=1000 -sampled-instr-burst-duration=10 -S | FileCheck %s --check-prefix=PERIOD
+; RUN: opt < %s -instrprof -S | FileCheck %s --check-prefix=NOSAMPLING
+
+target triple = "x86_64-unknown-linux-gnu"
+
+@__profn_foo = private constant [3 x i8] c"foo"
+
+; CHECK: @__llvm_profile_sampling = linkonce_odr hidden thread_local global i32 0
+; NOSAMPLING-NOT: @__llvm_profile_sampling
+
+define void @foo(i1 %c) {
+; CHECK-LABEL: define void @foo(
+; CHECK-NEXT: entry:
+; CHECK-NEXT: %pgosampling = load i32, i32* @__llvm_profile_sampling
+; CHECK-NEXT: [[NEXT:%.*]] = add i32 %pgosampling, 1
+; CHECK-NEXT: [[WRAP:%.*]] = icmp uge i32 [[NEXT]], 65536
+; CHECK-NEXT: [[NEW:%.*]] = select i1 [[WRAP]], i32 0, i32 [[NEXT]]
+; CHECK-NEXT: store i32 [[NEW]], i32* @__llvm_profile_sampling
+; CHECK-NEXT: %pgosampled = icmp ult i32 %pgosampling, 200
+; CHECK-NEXT: br i1 %pgosampled, label %{{.*}}, label %{{.*}}, !prof ![[WEIGHTS:[0-9]+]]
+; CHECK: %pgocount = load i64, i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 0)
+; CHECK-NEXT: [[INC:%.*]] = add i64 %pgocount, 327
+; CHECK-NEXT: store i64 [[INC]], i64* getelementptr inbounds ([2 x i64], [2 x i64]* @__profc_foo, i64 0, i64 0)
+; CHECK-NEXT: br label
+; CHECK: br i1 %c, label %then, label %exit
+entry:
+  call void @llvm.instrprof.increment(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 0, i32 2, i32 0)
+  br i1 %c, label %then, label %exit
+
+; CHECK: then:
+; CHECK-NEXT: br i1 %pgosampled
+; CHECK: add i64 %{{.*}}, 327
+then:
+  call void @llvm.instrprof.increment(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 0, i32 2, i32 1)
+  br label %exit
+
+exit:
+  ret void
+}
+
+; CHECK: ![[WEIGHTS]] = !{!"branch_weights", i32 200, i32 65336}
+
+; PERIOD: icmp uge i32 {{.*}}, 1000
+; PERIOD: %pgosampled = icmp ult i32 %pgosampling, 10
+; PERIOD: add i64 %pgocount, 100
+
+; NOSAMPLING-LABEL: define void @foo(
+; NOSAMPLING-NEXT: entry:
+; NOSAMPLING-NEXT: %pgocount = load
+; NOSAMPLING-NEXT: add i64 %pgocount, 1
+
+declare void @llvm.instrprof.increment(i8*, i64, i32, i32)
@@ -0,0 +1,57 @@
+; Test -sanitizer-coverage-inline-8bit-counters
+; RUN: opt < %s -sancov -sanitizer-coverage-level=3 -sanitizer-coverage-inline-8bit-counters -S | FileCheck %s
+; RUN: opt < %s -sancov -sanitizer-coverage-level=1 -sanitizer-coverage-inline-8bit-counters -S | FileCheck %s --check-prefix=FUNC
+; RUN: opt < %s -sancov -sanitizer-coverage-level=3 -sanitizer-coverage-inline-8bit-counters -mtriple=x86_64-apple-macosx -S | FileCheck %s --check-prefix=MACHO
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64"
+target triple = "x86_64-unknown-linux-gnu"
+
+$comdat_fn = comdat any
+
+; CHECK: @__sancov_gen_cov_counters = private global [3 x i8] zeroinitializer, section "__sancov_cntrs"
+; CHECK: @__sancov_gen_cov_counters.1 = private global [1 x i8] zeroinitializer, comdat($comdat_fn), section "__sancov_cntrs"
+; CHECK: @__start___sancov_cntrs = extern_weak hidden global i8
+; CHECK: @__stop___sancov_cntrs = extern_weak hidden global i8
+; CHECK: @llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] [{ i32, void ()*, i8* } { i32 2, void ()* @sancov.module_ctor, i8* null }]
+
+; FUNC: @__sancov_gen_cov_counters = private global [1 x i8] zeroinitializer, section "__sancov_cntrs"
+
+; MACHO: @__sancov_gen_cov_counters = private global [3 x i8] zeroinitializer, section "__DATA,__sancov_cntrs"
+; MACHO: @"\01section$start$__DATA$__sancov_cntrs" = extern_weak hidden global i8
+; MACHO: @"\01section$end$__DATA$__sancov_cntrs" = extern_weak hidden global i8
+
+define void @foo(i32* %a) sanitize_address {
+entry:
+  %tobool = icmp eq i32* %a, null
+  br i1 %tobool, label %if.end, label %if.then
+
+if.then:
+  store i32 0, i32* %a, align 4
+  br label %if.end
+
+if.end:
+  ret void
+}
+
+; CHECK-LABEL: define void @foo
+; CHECK: entry:
+; CHECK-NEXT: [[V0:%[0-9]+]] = load i8, i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__sancov_gen_cov_counters, i64 0, i64 0), !nosanitize
+; CHECK-NEXT: [[I0:%[0-9]+]] = add i8 [[V0]], 1
+; CHECK-NEXT: store i8 [[I0]], i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__sancov_gen_cov_counters, i64 0, i64 0), !nosanitize
+; CHECK: getelementptr inbounds ([3 x i8], [3 x i8]* @__sancov_gen_cov_counters, i64 0, i64 1)
+; CHECK: getelementptr inbounds ([3 x i8], [3 x i8]* @__sancov_gen_cov_counters, i64 0, i64 2)
+; CHECK-NOT: call void @__sanitizer_cov
+; CHECK: ret void
+
+; FUNC-LABEL: define void @foo
+; FUNC: load i8, i8* getelementptr inbounds ([1 x i8], [1 x i8]* @__sancov_gen_cov_counters, i64 0, i64 0), !nosanitize
+; FUNC-NOT: @__sancov_gen_cov_counters
+; FUNC: ret void
+
+define void @comdat_fn() comdat sanitize_address {
+entry:
+  ret void
+}
+
+; CHECK: define internal void @sancov.module_ctor()
+; CHECK-NEXT: call void @__sanitizer_cov_8bit_counters_init(i8* @__start___sancov_cntrs, i8* @__stop___sancov_cntrs)
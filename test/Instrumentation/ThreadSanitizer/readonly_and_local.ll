@@ -0,0 +1,81 @@
+; RUN: opt < %s -tsan -S | FileCheck %s --check-prefix=CHECK --check-prefix=DEFAULT
+; RUN: opt < %s -tsan -tsan-omit-readonly-globals=false -S | FileCheck %s --check-prefix=NOREADONLY
+; RUN: opt < %s -tsan -tsan-omit-before-capture -S | FileCheck %s --check-prefix=CHECK --check-prefix=BEFORE
+; Check that tsan does not instrument reads from internal globals that are
+; never written, nor accesses to local variables that no other thread can see.
+
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-n8:16:32:64-S128"
+
+declare void @escape(i32*)
+
+@readonly_global = internal global [4 x i32] [i32 1, i32 2, i32 3, i32 4], align 4
+define i32 @read_from_readonly_global(i64 %idx) nounwind uwtable sanitize_thread {
+entry:
+  %0 = load i32, i32* getelementptr inbounds ([4 x i32], [4 x i32]* @readonly_global, i64 0, i64 1), align 4
+  %arrayidx = getelementptr inbounds [4 x i32], [4 x i32]* @readonly_global, i64 0, i64 %idx
+  %1 = load i32, i32* %arrayidx, align 4
+  %add = add i32 %0, %1
+  ret i32 %add
+}
+; CHECK-LABEL: define i32 @read_from_readonly_global
+; CHECK-NOT: __tsan_read
+; CHECK: ret i32
+; NOREADONLY-LABEL: define i32 @read_from_readonly_global
+; NOREADONLY: __tsan_read4
+; NOREADONLY: __tsan_read4
+; NOREADONLY: ret i32
+
+@written_global = internal global i32 0, align 4
+define i32 @read_from_written_global() nounwind uwtable sanitize_thread {
+entry:
+  %0 = load i32, i32* @written_global, align 4
+  ret i32 %0
+}
+define void @write_global() nounwind uwtable sanitize_thread {
+entry:
+  store i32 1, i32* @written_global, align 4
+  ret void
+}
+; CHECK-LABEL: define i32 @read_from_written_global
+; CHECK: __tsan_read4
+; CHECK: ret i32
+
+@escaped_global = internal global i32 0, align 4
+define i32 @read_from_escaped_global() nounwind uwtable sanitize_thread {
+entry:
+  call void @escape(i32* @escaped_global)
+  %0 = load i32, i32* @escaped_global, align 4
+  ret i32 %0
+}
+; CHECK-LABEL: define i32 @read_from_escaped_global
+; CHECK: __tsan_read4
+; CHECK: ret i32
+
+define i32 @captured_through_other_element() nounwind uwtable sanitize_thread {
+entry:
+  %arr = alloca [2 x i32], align 4
+  %first = getelementptr inbounds [2 x i32], [2 x i32]* %arr, i64 0, i64 0
+  %second = getelementptr inbounds [2 x i32], [2 x i32]* %arr, i64 0, i64 1
+  call void @escape(i32* %first)
+  store i32 42, i32* %second, align 4
+  ret i32 0
+}
+; The address of the store is not captured itself, but the array is.
+; CHECK-LABEL: define i32 @captured_through_other_element
+; CHECK: __tsan_write4
+; CHECK: ret i32
+
+define void @before_capture() nounwind uwtable sanitize_thread {
+entry:
+  %ptr = alloca i32, align 4
+  store i32 42, i32* %ptr, align 4
+  call void @escape(i32* %ptr)
+  store i32 43, i32* %ptr, align 4
+  ret void
+}
+; CHECK-LABEL: define void @before_capture
+; DEFAULT: __tsan_write4
+; BEFORE-NOT: __tsan_write4
+; CHECK: call void @escape
+; CHECK: __tsan_write4
+; CHECK: ret void
@@ -0,0 +1,7 @@
+define void @f3() {
+  ret void
+}
+
+define void @unused_b() {
+  ret void
+}
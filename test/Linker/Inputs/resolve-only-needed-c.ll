@@ -0,0 +1,6 @@
+declare void @f3()
+
+define void @f2() {
+  call void @f3()
+  ret void
+}
@@ -0,0 +1 @@
+@unused_d = global i32 0
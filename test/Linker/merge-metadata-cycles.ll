@@ -0,0 +1,29 @@
+; RUN: llvm-link -link-merge-metadata-cycles -S %s %S/Inputs/merge-metadata-cycles.ll | FileCheck %s
+; RUN: llvm-link -S %s %S/Inputs/merge-metadata-cycles.ll | FileCheck %s -check-prefix=NOMERGE
+
+; Both modules describe the same struct that points to itself. Without an
+; identifier the type is a cycle of uniqued nodes, which is only shared when
+; cycles are merged.
+
+; CHECK: !DICompositeType(tag: DW_TAG_structure_type, name: "node"
+; CHECK-NOT: !DICompositeType(
+
+; NOMERGE: !DICompositeType(tag: DW_TAG_structure_type, name: "node"
+; NOMERGE: !DICompositeType(tag: DW_TAG_structure_type, name: "node"
+
+define void @f() !dbg !4 {
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: FullDebug, retainedTypes: !2)
+!1 = !DIFile(filename: "t.c", directory: "/")
+!2 = !{!5}
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "f", scope: !1, file: !1, line: 1, isDefinition: true, unit: !0)
+!5 = !DICompositeType(tag: DW_TAG_structure_type, name: "node", file: !1, line: 1, size: 64, align: 64, elements: !6)
+!6 = !{!7}
+!7 = !DIDerivedType(tag: DW_TAG_member, name: "next", scope: !5, file: !1, line: 2, baseType: !8, size: 64, align: 64)
+!8 = !DIDerivedType(tag: DW_TAG_pointer_type, baseType: !5, size: 64, align: 64)
@@ -0,0 +1,30 @@
+; RUN: llvm-link -S -only-needed %s %p/Inputs/resolve-only-needed-b.ll \
+; RUN:   %p/Inputs/resolve-only-needed-c.ll %p/Inputs/resolve-only-needed-d.ll \
+; RUN:   | FileCheck %s --check-prefix=ORDER
+; RUN: llvm-link -S -only-needed -resolve-only-needed -v %s \
+; RUN:   %p/Inputs/resolve-only-needed-b.ll %p/Inputs/resolve-only-needed-c.ll \
+; RUN:   %p/Inputs/resolve-only-needed-d.ll 2> %t.log | FileCheck %s
+; RUN: FileCheck %s --check-prefix=LOG < %t.log
+
+; @f3 is defined by an input before the one using it. Plain -only-needed
+; links the inputs in command line order and misses it; resolving the symbols
+; first links c before b.
+
+declare void @f2()
+
+define void @f1() {
+  call void @f2()
+  ret void
+}
+
+; ORDER: declare void @f3()
+
+; CHECK: define void @f1()
+; CHECK: define void @f2()
+; CHECK: define void @f3()
+; CHECK-NOT: unused
+
+; LOG: Skipping '{{.*}}resolve-only-needed-d.ll'
+; LOG: Linking in '{{.*}}resolve-only-needed.ll'
+; LOG-NEXT: Linking in '{{.*}}resolve-only-needed-c.ll'
+; LOG-NEXT: Linking in '{{.*}}resolve-only-needed-b.ll'
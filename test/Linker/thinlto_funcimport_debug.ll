@@ -6,6 +6,12 @@
 ; If we import func1 and not func2 we should only link DISubprogram for func1
 ; RUN: llvm-link %t2.bc -summary-index=%t3.thinlto.bc -import=func1:%t.bc -S | FileCheck %s
 
+; Importing from a module whose metadata is loaded lazily from an index gives
+; the same result.
+; RUN: opt -module-summary -bitcode-mdindex-threshold=0 %s -o %t.lazy.bc
+; RUN: llvm-link %t2.bc -summary-index=%t3.thinlto.bc -import=func1:%t.lazy.bc -S | FileCheck %s
+; RUN: llvm-link %t2.bc -summary-index=%t3.thinlto.bc -import=func1:%t.lazy.bc -disable-ondemand-mds-loading -S | FileCheck %s
+
 ; CHECK: declare i32 @func2
 ; CHECK: define available_externally i32 @func1
 
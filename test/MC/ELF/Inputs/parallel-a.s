@@ -0,0 +1,5 @@
+        .text
+        .globl a
+a:
+        jmp b
+        retq
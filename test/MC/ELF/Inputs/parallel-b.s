@@ -0,0 +1,5 @@
+        .text
+        .globl b
+b:
+        movl $1, %eax
+        retq
@@ -0,0 +1,2 @@
+        .text
+        movl $1, %foo
@@ -0,0 +1,29 @@
+// RUN: rm -rf %t && mkdir -p %t && cd %t
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o single.o
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu \
+// RUN:   %p/Inputs/parallel-a.s -o single-a.o
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -j 3 %s \
+// RUN:   %p/Inputs/parallel-a.s %p/Inputs/parallel-b.s
+// RUN: cmp single.o parallel-inputs.o
+// RUN: cmp single-a.o parallel-a.o
+// RUN: llvm-objdump -t parallel-b.o | FileCheck %s
+
+// CHECK: g .text {{0+}} b
+
+// RUN: not llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -j 2 \
+// RUN:   %p/Inputs/parallel-error.s %p/Inputs/parallel-b.s 2>&1 \
+// RUN:   | FileCheck --check-prefix=ERROR %s
+// RUN: not llvm-mc -triple x86_64-pc-linux-gnu %s %p/Inputs/parallel-b.s \
+// RUN:   2>&1 | FileCheck --check-prefix=NOOBJ %s
+// RUN: not llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu -o x.o %s \
+// RUN:   %p/Inputs/parallel-b.s 2>&1 | FileCheck --check-prefix=OUTPUT %s
+
+// ERROR: parallel-error.s:2:18: error: invalid register name
+// NOOBJ: error: multiple input files can only be assembled to object files
+// OUTPUT: error: cannot specify -o with multiple input files
+
+        .text
+        .globl main
+main:
+        callq a
+        retq
@@ -0,0 +1,43 @@
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t
+// RUN: llvm-mc -filetype=obj -triple x86_64-pc-linux-gnu %s -o %t.full \
+// RUN:   -mc-incremental-relaxation=false
+// RUN: cmp %t %t.full
+// RUN: llvm-objdump -d %t | FileCheck %s
+
+// Each jump only needs to be relaxed once the jump after it was, so every
+// relaxation pass relaxes exactly one of them.
+
+// CHECK-LABEL: Disassembly of section .text:
+// CHECK:       0: e9 82 00 00 00
+// CHECK:      43: e9 82 00 00 00
+// CHECK:      87: e9 82 00 00 00
+// CHECK:      ca: e9 80 00 00 00
+        .text
+        jmp .L0
+        .fill 62, 1, 0x90
+        jmp .L1
+        .fill 63, 1, 0x90
+.L0:
+        jmp .L2
+        .fill 62, 1, 0x90
+.L1:
+        jmp .L3
+        .fill 63, 1, 0x90
+.L2:
+        .fill 65, 1, 0x90
+.L3:
+
+// The second jump only needs to be relaxed because the alignment in front of
+// its target grows when the first one is relaxed.
+
+// CHECK-LABEL: Disassembly of section .text.align:
+// CHECK:       0: e9 4b 01 00 00
+// CHECK:       5: e9 7e 00 00 00
+        .section .text.align,"ax",@progbits
+        jmp .L5
+        jmp .L4
+        .fill 124, 1, 0x90
+        .p2align 3
+.L4:
+        .fill 200, 1, 0x90
+.L5:
@@ -0,0 +1,34 @@
+; The archive symbol table must be the same whether llvm-ar reads the symbols
+; of a bitcode member from its symbol table block or from the module itself.
+
+; RUN: llvm-as %s -o %t.bc
+; RUN: llvm-as -bitcode-write-symtab %s -o %t.symtab.bc
+; RUN: rm -f %t.a %t.symtab.a
+; RUN: llvm-ar rcs %t.a %t.bc
+; RUN: llvm-ar rcs %t.symtab.a %t.symtab.bc
+; RUN: llvm-nm -M %t.a | FileCheck %s
+; RUN: llvm-nm -M %t.symtab.a | FileCheck %s
+
+; CHECK:      Archive map
+; CHECK-NEXT: f in
+; CHECK-NEXT: g in
+; CHECK-NEXT: a in
+; CHECK-NOT:  {{ in }}
+
+target datalayout = "m:e"
+
+@g = global i32 0
+@priv = private global i32 2
+@ext = external global i32
+@llvm.used = appending global [1 x i8*] [i8* bitcast (i32* @g to i8*)], section "llvm.metadata"
+@a = hidden alias i32, i32* @g
+
+define void @f() {
+  ret void
+}
+
+define internal void @l() {
+  ret void
+}
+
+declare void @d()
@@ -0,0 +1,47 @@
+; RUN: opt < %s -gvn -loop-unswitch -slp-vectorizer -S | FileCheck %s
+; RUN: opt < %s -gvn -loop-unswitch -slp-vectorizer -opt-budget-max-size=1000 \
+; RUN:     -S | FileCheck %s
+; RUN: opt < %s -gvn -loop-unswitch -slp-vectorizer -opt-budget-max-size=5 \
+; RUN:     -pass-remarks-missed=compile-time-budget -S 2>%t.remarks \
+; RUN:     | FileCheck %s --check-prefix=BUDGET
+; RUN: FileCheck %s --check-prefix=REMARKS < %t.remarks
+; RUN: opt < %s -passes=gvn -opt-budget-max-size=5 -S | FileCheck %s --check-prefix=BUDGET
+
+; Functions over the budget keep their redundant load and their loop.
+
+target triple = "x86_64-unknown-linux-gnu"
+
+define i32 @f(i32* %p, i1 %c, i32 %n) {
+; CHECK-LABEL: @f(
+; CHECK: load i32
+; CHECK-NOT: load i32
+; BUDGET-LABEL: @f(
+; BUDGET: load i32
+; BUDGET: load i32
+entry:
+  %a = load i32, i32* %p
+  %b = load i32, i32* %p
+  %s = add i32 %a, %b
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %latch ]
+  br i1 %c, label %then, label %latch
+
+then:
+  store i32 %i, i32* %p
+  br label %latch
+
+latch:
+  %i.next = add i32 %i, 1
+  %done = icmp eq i32 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret i32 %s
+}
+
+; REMARKS: remark: <unknown>:0:0: gvn ran without load elimination because the function has {{[0-9]+}} instructions, more than the limit of 5
+; REMARKS-NEXT: remark: <unknown>:0:0: loop-unswitch skipped because the function has {{[0-9]+}} instructions, more than the limit of 5
+; REMARKS-NEXT: remark: <unknown>:0:0: slp-vectorizer skipped because the function has {{[0-9]+}} instructions, more than the limit of 5
+; REMARKS-NOT: remark
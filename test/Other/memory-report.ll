@@ -0,0 +1,26 @@
+; RUN: opt -memory-report -instcombine -disable-output %s 2>&1 | FileCheck %s
+
+; CHECK: ... Memory held by '{{.*}}memory-report.ll' after running passes ...
+; CHECK: Objects Bytes Value
+; CHECK-NEXT: 1 {{[0-9]+}} Function
+; CHECK-NEXT: 1 {{[0-9]+}} Argument
+; CHECK-NEXT: 1 {{[0-9]+}} BasicBlock
+; CHECK-NEXT: 1 {{[0-9]+}} ret
+; CHECK-NEXT: 1 {{[0-9]+}} shl
+; CHECK-NEXT: {{[0-9]+}} Total
+; CHECK: Entries Bytes Uniquing table
+; CHECK: ConstantInt
+; CHECK: FunctionType
+; CHECK: Objects Bytes Owned by the context
+; CHECK: ConstantInt
+
+; CHECK: ... Pass memory usage report ...
+; CHECK: Runs Heap growth Table growth Held Name
+; CHECK-DAG: 1 {{-?[0-9]+ -?[0-9]+ [0-9]+}} Combine redundant instructions
+; CHECK-DAG: 1 {{-?[0-9]+ -?[0-9]+ [0-9]+}} Module Verifier
+
+define i32 @f(i32 %x) {
+  %a = add i32 %x, 0
+  %b = mul i32 %a, 2
+  ret i32 %b
+}
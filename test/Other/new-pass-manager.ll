@@ -41,6 +41,17 @@
 ; CHECK-FUNCTION-PASS-NEXT: Finished llvm::Function pass manager run
 ; CHECK-FUNCTION-PASS-NEXT: Finished llvm::Module pass manager run
 
+; RUN: opt -disable-output -disable-verify -debug-pass-manager \
+; RUN:     -passes='parallel-function(no-op-function)' %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=CHECK-PARALLEL-FUNCTION-PASS
+; CHECK-PARALLEL-FUNCTION-PASS: Starting llvm::Module pass manager run
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Running pass: ParallelModuleToFunctionPassAdaptor
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Running analysis: InnerAnalysisManagerProxy<{{.*}}>
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Starting llvm::Function pass manager run
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Running pass: NoOpFunctionPass
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Finished llvm::Function pass manager run
+; CHECK-PARALLEL-FUNCTION-PASS-NEXT: Finished llvm::Module pass manager run
+
 ; RUN: opt -disable-output -debug-pass-manager -passes=print %s 2>&1 \
 ; RUN:     | FileCheck %s --check-prefix=CHECK-MODULE-PRINT
 ; CHECK-MODULE-PRINT: Starting llvm::Module pass manager run
@@ -0,0 +1,35 @@
+; RUN: opt < %s -disable-output -instcombine -print-after-all 2> %t.default
+; RUN: opt < %s -disable-output -instcombine -print-after-all \
+; RUN:     -print-reuse-slots 2> %t.reuse
+; RUN: diff %t.default %t.reuse
+; RUN: FileCheck %s < %t.reuse
+
+; Reusing the slot numbering of the module between prints must not change
+; what is printed. Functions are numbered again when they are printed, so
+; the instructions instcombine leaves behind are still numbered in order.
+
+@0 = global i32 0
+
+; CHECK: IR Dump After Combine redundant instructions
+; CHECK: define i32 @f(i32) #0 {
+; CHECK-NEXT: %2 = shl i32 %0, 1
+; CHECK: ; <label>:3:{{ +}}; preds = %3, %1
+; CHECK-NEXT: %4 = phi i32 [ %2, %1 ], [ %5, %3 ]
+; CHECK: store i32 %5, i32* @0
+define i32 @f(i32) #0 {
+  %2 = add i32 %0, 0
+  %3 = mul i32 %2, 2
+  br label %4
+
+; <label>:4
+  %5 = phi i32 [ %3, %1 ], [ %6, %4 ]
+  %6 = add i32 %5, 1
+  store i32 %6, i32* @0
+  %7 = icmp eq i32 %6, 10
+  br i1 %7, label %8, label %4
+
+; <label>:8
+  ret i32 %6
+}
+
+attributes #0 = { nounwind }
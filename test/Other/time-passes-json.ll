@@ -0,0 +1,29 @@
+; RUN: opt -time-passes -timer-json -time-passes-per-function -instcombine \
+; RUN:     -disable-output %s 2>&1 | FileCheck %s --check-prefix=LEGACY
+; RUN: opt -time-passes -timer-json -time-passes-per-function \
+; RUN:     -passes=instcombine -disable-output %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=NEWPM
+; RUN: opt -time-passes -timer-json -instcombine -disable-output %s 2>&1 \
+; RUN:     | FileCheck %s --check-prefix=NOFUNC
+
+; LEGACY-DAG: {"group": "... Pass execution timing report ...", "description": "... Pass execution timing report ...", "timers": [{{.*}}{"name": "Combine redundant instructions", "wall": {{[0-9.]+}}, "user": {{[0-9.]+}}, "system": {{[0-9.]+}}, "mem": 0}{{.*}}]}
+; LEGACY-DAG: {"group": "f", "description": "... Pass execution timing report for function 'f' ...", "timers": [{{.*}}"Combine redundant instructions"{{.*}}]}
+; LEGACY-DAG: {"group": "g", "description": "... Pass execution timing report for function 'g' ...", "timers": [{{.*}}"Combine redundant instructions"{{.*}}]}
+
+; NEWPM-DAG: {"group": "... Pass execution timing report ...", {{.*}}"name": "InstCombinePass"
+; NEWPM-DAG: {"group": "f", {{.*}}"name": "InstCombinePass"
+; NEWPM-DAG: {"group": "g", {{.*}}"name": "InstCombinePass"
+
+; NOFUNC-NOT: "group": "f"
+; NOFUNC: {"group": "... Pass execution timing report ...",
+; NOFUNC-NOT: "group": "f"
+
+define i32 @f(i32 %x) {
+  %y = shl i32 %x, 1
+  ret i32 %y
+}
+
+define i32 @g(i32 %x) {
+  %y = add i32 %x, 1
+  ret i32 %y
+}
@@ -0,0 +1,18 @@
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define i32 @large(i32 %x) {
+entry:
+  %0 = add i32 %x, 0
+  %1 = add i32 %x, 1
+  %2 = add i32 %x, 2
+  %3 = add i32 %x, 3
+  %4 = add i32 %x, 4
+  %5 = add i32 %x, 5
+  %6 = add i32 %x, 6
+  %7 = add i32 %x, 7
+  %8 = add i32 %x, 8
+  %9 = add i32 %x, 9
+  %r = add i32 %9, %x
+  ret i32 %r
+}
@@ -0,0 +1,21 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@_ZTV1B = constant [2 x i8*] [i8* bitcast (void (i8*)* @_ZN1B1fEv to i8*), i8* bitcast (void (i8*)* @_ZN1B1gEv to i8*)]
+@_ZTV1C = constant [2 x i8*] [i8* bitcast (void (i8*)* @_ZN1B1fEv to i8*), i8* bitcast (void (i8*)* @_ZN1C1gEv to i8*)]
+
+define void @_ZN1B1fEv(i8* %this) {
+  ret void
+}
+
+define void @_ZN1B1gEv(i8* %this) {
+  ret void
+}
+
+define void @_ZN1C1gEv(i8* %this) {
+  ret void
+}
+
+!0 = !{!"_ZTS1A", [2 x i8*]* @_ZTV1B, i64 0}
+!1 = !{!"_ZTS1A", [2 x i8*]* @_ZTV1C, i64 0}
+!llvm.bitsets = !{!0, !1}
@@ -0,0 +1,29 @@
+; REQUIRES: asserts
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/funcimport.ll -o %t2.bc
+
+; The first link populates the cache.
+; RUN: rm -Rf %t.cache && mkdir %t.cache
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc -thinlto-cache-dir %t.cache -stats 2>&1 | FileCheck %s --check-prefix=MISS
+; MISS-NOT: loaded from the ThinLTO cache
+; MISS: 2 thinlto - Number of modules missing from the ThinLTO cache
+
+; Relinking the same inputs hits for every module.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc -thinlto-cache-dir %t.cache -stats 2>&1 | FileCheck %s --check-prefix=HIT
+; HIT: 2 thinlto - Number of modules loaded from the ThinLTO cache
+; HIT-NOT: missing from the ThinLTO cache
+
+; Changing the inputs order does not change the keys.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t.bc %t2.bc -thinlto-cache-dir %t.cache -stats 2>&1 | FileCheck %s --check-prefix=HIT
+
+; Code generation options are part of the key.
+; RUN: llvm-lto -thinlto-action=run -exported-symbol=globalfunc %t2.bc %t.bc -thinlto-cache-dir %t.cache -relocation-model=static -stats 2>&1 | FileCheck %s --check-prefix=MISS
+; RUN: ls %t.cache | count 5
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define void @globalfunc() #0 {
+entry:
+  ret void
+}
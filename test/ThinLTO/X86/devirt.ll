@@ -0,0 +1,46 @@
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/devirt.ll -o %t2.bc
+; RUN: llvm-bcanalyzer -dump %t1.bc | FileCheck %s --check-prefix=SUMMARY1
+; RUN: llvm-bcanalyzer -dump %t2.bc | FileCheck %s --check-prefix=SUMMARY2
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.bc %t1.bc %t2.bc
+; RUN: llvm-bcanalyzer -dump %t3.bc | FileCheck %s --check-prefix=COMBINED
+; RUN: llvm-lto -thinlto-action=optimize %t1.bc -thinlto-index=%t3.bc -o - | llvm-dis -o - | FileCheck %s
+
+; The summary of @call records the two virtual calls, and the summaries of the
+; vtables their types and function pointers.
+; SUMMARY1: <PERMODULE
+; SUMMARY1-NEXT: <VCALLS op0={{[0-9]+}} op1=0 op2={{[0-9]+}} op3=8/>
+; SUMMARY2: <PERMODULE_GLOBALVAR_INIT_REFS
+; SUMMARY2-NEXT: <VTABLE_TYPES op0={{[0-9]+}} op1=0/>
+; SUMMARY2-NEXT: <VTABLE_FUNC op0=0 {{.*}}/>
+; SUMMARY2-NEXT: <VTABLE_FUNC op0=8 {{.*}}/>
+
+; Only the first slot has a single implementation in the whole program.
+; COMBINED: <DEVIRT_SINGLE_IMPL op0={{[0-9]+}} op1=0 {{.*}}/>
+; COMBINED-NOT: <DEVIRT_SINGLE_IMPL
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK-LABEL: define void @call
+define void @call(i8* %obj) {
+  %vtableptr = bitcast i8* %obj to [2 x i8*]**
+  %vtable = load [2 x i8*]*, [2 x i8*]** %vtableptr
+  %vtablei8 = bitcast [2 x i8*]* %vtable to i8*
+  %p = call i1 @llvm.bitset.test(i8* %vtablei8, metadata !"_ZTS1A")
+  call void @llvm.assume(i1 %p)
+  %fptrptr = getelementptr [2 x i8*], [2 x i8*]* %vtable, i32 0, i32 0
+  %fptr = load i8*, i8** %fptrptr
+  %fptr_casted = bitcast i8* %fptr to void (i8*)*
+  ; CHECK: call void @_ZN1B1fEv(i8* %obj)
+  call void %fptr_casted(i8* %obj)
+  %gptrptr = getelementptr [2 x i8*], [2 x i8*]* %vtable, i32 0, i32 1
+  %gptr = load i8*, i8** %gptrptr
+  %gptr_casted = bitcast i8* %gptr to void (i8*)*
+  ; CHECK: call void %
+  call void %gptr_casted(i8* %obj)
+  ret void
+}
+
+declare i1 @llvm.bitset.test(i8*, metadata)
+declare void @llvm.assume(i1)
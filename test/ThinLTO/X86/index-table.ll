@@ -0,0 +1,25 @@
+; The combined index written as a summary index table must drive the same
+; promotion and importing as the bitcode one.
+; RUN: opt -module-summary %p/funcimport.ll -o %t.bc
+; RUN: opt -module-summary %p/Inputs/funcimport.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -o %t3.bc %t.bc %t2.bc
+; RUN: llvm-lto -thinlto-action=thinlink -thinlto-index-table -o %t3.table %t.bc %t2.bc
+
+; RUN: llvm-lto -thinlto-action=promote %t.bc -thinlto-index=%t3.bc -o - | llvm-dis -o %t.promoted.bc.ll
+; RUN: llvm-lto -thinlto-action=promote %t.bc -thinlto-index=%t3.table -o - | llvm-dis -o %t.promoted.table.ll
+; RUN: diff %t.promoted.bc.ll %t.promoted.table.ll
+
+; RUN: llvm-lto -thinlto-action=import %t2.bc -thinlto-index=%t3.bc -o - | llvm-dis -o %t.imported.bc.ll
+; RUN: llvm-lto -thinlto-action=import %t2.bc -thinlto-index=%t3.table -o - | llvm-dis -o %t.imported.table.ll
+; RUN: diff %t.imported.bc.ll %t.imported.table.ll
+; RUN: FileCheck %s < %t.imported.table.ll
+
+; RUN: opt -function-import -summary-file %t3.table %t2.bc -S | FileCheck %s
+
+; CHECK-DAG: define available_externally void @globalfunc1
+; CHECK-DAG: declare void @analias
+
+; A truncated table is rejected.
+; RUN: head -c 100 %t3.table > %t.bad
+; RUN: not llvm-lto -thinlto-action=import %t2.bc -thinlto-index=%t.bad -o - 2>&1 | FileCheck %s --check-prefix=BAD
+; BAD: error loading file
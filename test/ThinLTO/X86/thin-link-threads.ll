@@ -0,0 +1,42 @@
+; The thin link gives the same result whatever the number of threads, and
+; reports the time of its phases.
+; RUN: opt -module-summary %s -o %t1.bc
+; RUN: opt -module-summary %p/Inputs/funcimport.ll -o %t2.bc
+; RUN: llvm-lto -thinlto-action=run -threads=1 %t1.bc %t2.bc -time-passes 2> %t.time
+; RUN: mv %t1.bc.thinlto.o %t1.serial.o
+; RUN: mv %t2.bc.thinlto.o %t2.serial.o
+; RUN: llvm-lto -thinlto-action=run -threads=4 %t1.bc %t2.bc
+; RUN: cmp %t1.serial.o %t1.bc.thinlto.o
+; RUN: cmp %t2.serial.o %t2.bc.thinlto.o
+; RUN: FileCheck %s < %t.time
+
+; CHECK: ThinLTO thin link
+; CHECK-DAG: Link combined index
+; CHECK-DAG: Compute imports
+; CHECK-DAG: Resolve weak symbols
+; CHECK-DAG: Internalize and promote
+
+target datalayout = "e-m:o-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-apple-macosx10.11.0"
+
+define i32 @referencestatics(...) {
+entry:
+  %call = call i32 @staticfunc()
+  ret i32 %call
+}
+
+define void @callweakfunc(...) {
+entry:
+  call void @weakfunc()
+  ret void
+}
+
+define linkonce_odr void @weakfunc() {
+entry:
+  ret void
+}
+
+define internal i32 @staticfunc() {
+entry:
+  ret i32 1
+}
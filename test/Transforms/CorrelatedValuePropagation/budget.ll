@@ -0,0 +1,40 @@
+; RUN: opt < %s -correlated-propagation -S | FileCheck %s
+; RUN: opt < %s -correlated-propagation -lvi-max-steps-per-query=1 -S \
+; RUN:     | FileCheck %s --check-prefix=LIMIT
+; RUN: opt < %s -correlated-propagation -lvi-max-block-values-per-value=1 -S \
+; RUN:     | FileCheck %s --check-prefix=LIMIT
+; RUN: opt < %s -correlated-propagation -lvi-max-steps-per-query=1 -stats \
+; RUN:     -disable-output 2>&1 | FileCheck %s --check-prefix=STEPS
+; RUN: opt < %s -correlated-propagation -lvi-max-block-values-per-value=1 \
+; RUN:     -stats -disable-output 2>&1 | FileCheck %s --check-prefix=VALUES
+; REQUIRES: asserts
+
+; Proving %d needs the value of %x in both %a and %b. Once either limit is
+; reached, LVI gives up and the comparison is left alone.
+
+define i1 @chain(i32 %x) {
+; CHECK-LABEL: @chain(
+; CHECK: ret i1 true
+; LIMIT-LABEL: @chain(
+; LIMIT: %d = icmp ult i32 %x, 20
+; LIMIT: ret i1 %d
+entry:
+  %c = icmp ult i32 %x, 10
+  br i1 %c, label %a, label %out
+
+a:
+  br label %b
+
+b:
+  br label %m
+
+m:
+  %d = icmp ult i32 %x, 20
+  ret i1 %d
+
+out:
+  ret i1 false
+}
+
+; STEPS: 1 lazy-value-info - Number of queries abandoned because of the step limit
+; VALUES: 1 lazy-value-info - Number of block values made overdefined by the per-value limit
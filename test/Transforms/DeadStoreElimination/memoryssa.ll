@@ -0,0 +1,45 @@
+; RUN: opt < %s -basicaa -dse -dse-memoryssa -S | FileCheck %s
+
+; CHECK-LABEL: @overwrite(
+define void @overwrite(i32* noalias %p, i32* noalias %q) {
+; CHECK-NEXT: store i32 1, i32* %q
+; CHECK-NEXT: store i32 2, i32* %p
+; CHECK-NEXT: ret void
+  store i32 0, i32* %p
+  store i32 1, i32* %q
+  store i32 2, i32* %p
+  ret void
+}
+
+; The store to %q may alias, but doesn't read %p.
+; CHECK-LABEL: @may_alias(
+define void @may_alias(i32* %p, i32* %q) {
+; CHECK-NEXT: store i32 1, i32* %q
+; CHECK-NEXT: store i32 2, i32* %p
+; CHECK-NEXT: ret void
+  store i32 0, i32* %p
+  store i32 1, i32* %q
+  store i32 2, i32* %p
+  ret void
+}
+
+; CHECK-LABEL: @read_between(
+define i32 @read_between(i32* %p) {
+; CHECK-NEXT: store i32 0, i32* %p
+; CHECK-NEXT: %v = load i32, i32* %p
+; CHECK-NEXT: store i32 2, i32* %p
+  store i32 0, i32* %p
+  %v = load i32, i32* %p
+  store i32 2, i32* %p
+  ret i32 %v
+}
+
+; CHECK-LABEL: @dead_alloca(
+define void @dead_alloca(i32* %p) {
+; CHECK-NOT: store
+; CHECK: ret void
+  %a = alloca i32
+  store i32 1, i32* %a
+  store i32 2, i32* %a
+  ret void
+}
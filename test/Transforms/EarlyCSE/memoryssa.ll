@@ -0,0 +1,62 @@
+; RUN: opt < %s -S -early-cse | FileCheck %s --check-prefix=CHECK-NOMEMSSA
+; RUN: opt < %s -S -early-cse -early-cse-memoryssa | FileCheck %s
+
+; With MemorySSA, loads are reused across writes that don't clobber them.
+
+; CHECK-LABEL: @load_past_store(
+; CHECK-NOMEMSSA-LABEL: @load_past_store(
+define i32 @load_past_store(i32* noalias %p, i32* noalias %q) {
+; CHECK: %a = load i32, i32* %p
+; CHECK-NEXT: store i32 0, i32* %q
+; CHECK-NEXT: %c = add i32 %a, %a
+; CHECK-NOMEMSSA: %b = load i32, i32* %p
+  %a = load i32, i32* %p
+  store i32 0, i32* %q
+  %b = load i32, i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+; CHECK-LABEL: @load_past_merge(
+; CHECK-NOMEMSSA-LABEL: @load_past_merge(
+define i32 @load_past_merge(i1 %c, i32* noalias %p, i32* noalias %q) {
+entry:
+  %a = load i32, i32* %p
+  br i1 %c, label %then, label %merge
+
+then:
+  store i32 0, i32* %q
+  br label %merge
+
+merge:
+; CHECK: merge:
+; CHECK-NEXT: %r = add i32 %a, %a
+; CHECK-NOMEMSSA: %b = load i32, i32* %p
+  %b = load i32, i32* %p
+  %r = add i32 %a, %b
+  ret i32 %r
+}
+
+; CHECK-LABEL: @clobbered(
+define i32 @clobbered(i32* %p, i32* %q) {
+; CHECK: %a = load i32, i32* %p
+; CHECK-NEXT: store i32 0, i32* %q
+; CHECK-NEXT: %b = load i32, i32* %p
+  %a = load i32, i32* %p
+  store i32 0, i32* %q
+  %b = load i32, i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+; The store writes back the value it loaded, so it is removed.
+; CHECK-LABEL: @writeback(
+define void @writeback(i32* noalias %p, i32* noalias %q) {
+; CHECK: %a = load i32, i32* %p
+; CHECK-NEXT: store i32 0, i32* %q
+; CHECK-NEXT: ret void
+  %a = load i32, i32* %p
+  store i32 0, i32* %q
+  store i32 %a, i32* %p
+  ret void
+}
@@ -0,0 +1,42 @@
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Size 12, above the instruction limit of the test.
+define void @hot_function() {
+entry:
+  %0 = add i32 0, 0
+  %1 = add i32 1, 1
+  %2 = add i32 2, 2
+  %3 = add i32 3, 3
+  %4 = add i32 4, 4
+  %5 = add i32 5, 5
+  %6 = add i32 6, 6
+  %7 = add i32 7, 7
+  %8 = add i32 8, 8
+  %9 = add i32 9, 9
+  %10 = add i32 10, 10
+  ret void
+}
+
+; Size 12, above the instruction limit of the test.
+define void @none_function() {
+entry:
+  %0 = add i32 0, 0
+  %1 = add i32 1, 1
+  %2 = add i32 2, 2
+  %3 = add i32 3, 3
+  %4 = add i32 4, 4
+  %5 = add i32 5, 5
+  %6 = add i32 6, 6
+  %7 = add i32 7, 7
+  %8 = add i32 8, 8
+  %9 = add i32 9, 9
+  %10 = add i32 10, 10
+  ret void
+}
+
+; Size 1, always under the instruction limit.
+define void @cold_function() {
+entry:
+  ret void
+}
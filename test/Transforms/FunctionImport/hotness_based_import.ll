@@ -0,0 +1,63 @@
+; Test that the import threshold of a call edge is scaled by its hotness.
+; RUN: opt -module-summary %s -o %t.bc
+; RUN: opt -module-summary %p/Inputs/hotness_based_import.ll -o %t2.bc
+; RUN: llvm-lto -thinlto -o %t3 %t.bc %t2.bc
+
+; The imported and declared callees follow the caller in the output.
+; CHECK-LABEL: define void @caller()
+
+; The hot callee is larger than the limit but is imported thanks to the hot
+; multiplier, while the cold callee is small but not imported.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -import-instr-limit=10 -S | FileCheck %s --check-prefix=CHECK --check-prefix=DEFAULT
+; DEFAULT-DAG: define available_externally void @hot_function()
+; DEFAULT-DAG: declare void @none_function()
+; DEFAULT-DAG: declare void @cold_function()
+
+; Without the multipliers, the callees are treated alike.
+; RUN: opt -function-import -summary-file %t3.thinlto.bc %t.bc -import-instr-limit=10 -import-hot-multiplier=1.0 -import-cold-multiplier=1.0 -S | FileCheck %s --check-prefix=CHECK --check-prefix=NOMULT
+; NOMULT-DAG: declare void @hot_function()
+; NOMULT-DAG: declare void @none_function()
+; NOMULT-DAG: define available_externally void @cold_function()
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @caller() !prof !20 {
+entry:
+  call void @hot_function()
+  br i1 undef, label %cold, label %none, !prof !21
+
+cold:
+  call void @cold_function()
+  br label %exit
+
+none:
+  call void @none_function()
+  br label %exit
+
+exit:
+  ret void
+}
+
+declare void @hot_function()
+declare void @none_function()
+declare void @cold_function()
+
+!llvm.module.flags = !{!1}
+!20 = !{!"function_entry_count", i64 100}
+!21 = !{!"branch_weights", i32 1, i32 50}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 10000}
+!5 = !{!"MaxCount", i64 100}
+!6 = !{!"MaxInternalCount", i64 100}
+!7 = !{!"MaxFunctionCount", i64 100}
+!8 = !{!"NumCounts", i64 4}
+!9 = !{!"NumFunctions", i64 4}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 100, i32 1}
+!13 = !{i32 990000, i64 100, i32 1}
+!14 = !{i32 999999, i64 10, i32 2}
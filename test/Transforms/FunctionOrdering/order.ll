@@ -0,0 +1,68 @@
+; RUN: opt -S -function-ordering < %s | FileCheck %s
+; RUN: opt -S -function-ordering -function-order-file=%t.order < %s > /dev/null
+; RUN: FileCheck --check-prefix=ORDER %s < %t.order
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; @leaf is placed right after its hot caller, and the densest cluster goes
+; first. @main calls @hot too rarely to pull it in, and @noprof has no profile
+; so it goes last.
+
+; CHECK: define void @hot() {{.*}}!section_prefix ![[HOT:[0-9]+]]
+; CHECK: define void @leaf() {{.*}}!section_prefix ![[HOT]]
+; CHECK: define void @main() !prof !{{[0-9]+}} {
+; CHECK: define void @cold() !prof !{{[0-9]+}} {
+; CHECK: define void @noprof()
+; CHECK: ![[HOT]] = !{!"function_section_prefix", !".hot"}
+
+; ORDER: hot
+; ORDER-NEXT: leaf
+; ORDER-NEXT: main
+; ORDER-NEXT: cold
+; ORDER-NOT: noprof
+
+define void @noprof() {
+  ret void
+}
+
+define void @cold() !prof !20 {
+  ret void
+}
+
+define void @leaf() !prof !21 {
+  ret void
+}
+
+define void @main() !prof !20 {
+  call void @hot()
+  call void @cold()
+  call void @noprof()
+  ret void
+}
+
+define void @hot() !prof !22 {
+  call void @leaf()
+  call void @leaf()
+  ret void
+}
+
+!llvm.module.flags = !{!1}
+
+!1 = !{i32 1, !"ProfileSummary", !2}
+!2 = !{!3, !4, !5, !6, !7, !8, !9, !10}
+!3 = !{!"ProfileFormat", !"InstrProf"}
+!4 = !{!"TotalCount", i64 3002}
+!5 = !{!"MaxCount", i64 2000}
+!6 = !{!"MaxInternalCount", i64 1000}
+!7 = !{!"MaxFunctionCount", i64 2000}
+!8 = !{!"NumCounts", i64 4}
+!9 = !{!"NumFunctions", i64 4}
+!10 = !{!"DetailedSummary", !11}
+!11 = !{!12, !13, !14}
+!12 = !{i32 10000, i64 2000, i32 1}
+!13 = !{i32 990000, i64 1000, i32 2}
+!14 = !{i32 999999, i64 1, i32 4}
+!20 = !{!"function_entry_count", i64 1}
+!21 = !{!"function_entry_count", i64 2000}
+!22 = !{!"function_entry_count", i64 1000}
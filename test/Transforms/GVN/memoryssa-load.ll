@@ -0,0 +1,98 @@
+; RUN: opt < %s -basicaa -gvn -enable-gvn-memoryssa -S | FileCheck %s
+
+; Loads are eliminated from the clobbers that MemorySSA gives for them.
+
+declare void @clobber(i32*)
+
+define i32 @store_forward(i32* %p, i32* noalias %q, i32 %v) {
+; CHECK-LABEL: @store_forward(
+; CHECK-NOT: load
+; CHECK: ret i32 %v
+  store i32 %v, i32* %p
+  store i32 0, i32* %q
+  %a = load i32, i32* %p
+  ret i32 %a
+}
+
+define i32 @load_load(i32* %p, i32* noalias %q) {
+; CHECK-LABEL: @load_load(
+; CHECK: %a = load i32, i32* %p
+; CHECK-NOT: load
+; CHECK: add i32 %a, %a
+  %a = load i32, i32* %p
+  store i32 0, i32* %q
+  %b = load i32, i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @clobbered(i32* %p) {
+; CHECK-LABEL: @clobbered(
+; CHECK: load
+; CHECK: call void @clobber
+; CHECK: load
+  %a = load i32, i32* %p
+  call void @clobber(i32* %p)
+  %b = load i32, i32* %p
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @diamond(i1 %c, i32* %p) {
+; CHECK-LABEL: @diamond(
+; CHECK: merge:
+; CHECK-NEXT: %a = phi i32
+; CHECK-NEXT: ret i32 %a
+entry:
+  br i1 %c, label %t, label %f
+
+t:
+  store i32 1, i32* %p
+  br label %merge
+
+f:
+  store i32 2, i32* %p
+  br label %merge
+
+merge:
+  %a = load i32, i32* %p
+  ret i32 %a
+}
+
+; The load is only partially redundant, and load PRE is not done.
+define i32 @partial(i1 %c, i32* %p) {
+; CHECK-LABEL: @partial(
+; CHECK: merge:
+; CHECK-NEXT: %a = load i32, i32* %p
+entry:
+  br i1 %c, label %t, label %f
+
+t:
+  store i32 1, i32* %p
+  br label %merge
+
+f:
+  call void @clobber(i32* %p)
+  br label %merge
+
+merge:
+  %a = load i32, i32* %p
+  ret i32 %a
+}
+
+define i32 @alloca_undef(i1 %c) {
+; CHECK-LABEL: @alloca_undef(
+; CHECK-NOT: load
+; CHECK: ret i32 undef
+entry:
+  %x = alloca i32
+  br i1 %c, label %t, label %merge
+
+t:
+  call void @clobber(i32* null)
+  br label %merge
+
+merge:
+  %a = load i32, i32* %x
+  ret i32 %a
+}
@@ -0,0 +1,61 @@
+; RUN: opt -hotcoldsplit -S < %s | FileCheck %s
+; RUN: opt -hotcoldsplit -mtriple=x86_64-apple-macosx -S < %s | FileCheck %s --check-prefix=MACHO
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare void @report(i32)
+
+; The profile says that the error path runs once in 100000 calls, so it is
+; outlined.
+; CHECK-LABEL: @split(
+; CHECK: call void @split.cold.0(i32 %x)
+; CHECK: define i32 @no_profile(
+; CHECK-NOT: call void @no_profile.cold
+; CHECK: define internal void @split.cold.0(i32 %x) #[[ATTR:[0-9]+]] section ".text.unlikely"
+; CHECK: call void @report(i32 %x)
+; CHECK: attributes #[[ATTR]] = { {{.*}}cold{{.*}}minsize{{.*}}noinline{{.*}} }
+; MACHO: define internal void @split.cold.0(i32 %x) #{{[0-9]+}} {
+define i32 @split(i32 %x) !prof !0 {
+entry:
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %error, label %work, !prof !1
+
+error:
+  call void @report(i32 %x)
+  call void @report(i32 1)
+  call void @report(i32 2)
+  br label %exit
+
+work:
+  %mul = mul nsw i32 %x, %x
+  br label %exit
+
+exit:
+  %ret = phi i32 [ -1, %error ], [ %mul, %work ]
+  ret i32 %ret
+}
+
+; Without profile data nothing is known to be cold.
+define i32 @no_profile(i32 %x) {
+entry:
+  %cmp = icmp eq i32 %x, 0
+  br i1 %cmp, label %error, label %work, !prof !1
+
+error:
+  call void @report(i32 %x)
+  call void @report(i32 1)
+  call void @report(i32 2)
+  br label %exit
+
+work:
+  %mul = mul nsw i32 %x, %x
+  br label %exit
+
+exit:
+  %ret = phi i32 [ -1, %error ], [ %mul, %work ]
+  ret i32 %ret
+}
+
+!0 = !{!"function_entry_count", i64 100000}
+!1 = !{!"branch_weights", i32 1, i32 100000}
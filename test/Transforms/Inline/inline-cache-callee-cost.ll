@@ -0,0 +1,89 @@
+; RUN: opt < %s -inline -S | FileCheck %s
+; RUN: opt < %s -inline -inline-cache-callee-cost -S | FileCheck %s
+; RUN: opt < %s -inline -inline-cache-callee-cost -stats -disable-output 2>&1 | FileCheck %s --check-prefix=STATS
+; REQUIRES: asserts
+
+; Caching the cost of a callee body must not change any inlining decision.
+
+define internal i32 @small(i32* %p, i32* %q) {
+  %a = load i32, i32* %p
+  %b = load i32, i32* %q
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+define i32 @caller1(i32* %x, i32* %y) {
+; CHECK-LABEL: @caller1(
+; CHECK-NOT: call
+; CHECK: ret i32
+  %r = call i32 @small(i32* %x, i32* %y)
+  ret i32 %r
+}
+
+define i32 @caller2(i32* %x) {
+; CHECK-LABEL: @caller2(
+; CHECK-NOT: call
+; CHECK: ret i32
+  %y = getelementptr inbounds i32, i32* %x, i64 1
+  %r = call i32 @small(i32* %x, i32* %y)
+  ret i32 %r
+}
+
+define i32 @caller3(i32* %x, i32* %y) {
+; CHECK-LABEL: @caller3(
+; CHECK-NOT: call
+; CHECK: ret i32
+  %r1 = call i32 @small(i32* %x, i32* %y)
+  %r2 = call i32 @small(i32* %y, i32* %x)
+  %r = add i32 %r1, %r2
+  ret i32 %r
+}
+
+; Comparing the two arguments only folds if they have the same base.
+define internal i32 @cmp(i32* %p, i32* %q) {
+  %p1 = getelementptr inbounds i32, i32* %p, i64 1
+  %c = icmp eq i32* %p1, %q
+  br i1 %c, label %same, label %other
+
+same:
+  ret i32 0
+
+other:
+  call void @clobber(i32* %p)
+  call void @clobber(i32* %q)
+  call void @clobber(i32* %p)
+  call void @clobber(i32* %q)
+  call void @clobber(i32* %p)
+  call void @clobber(i32* %q)
+  call void @clobber(i32* %p)
+  call void @clobber(i32* %q)
+  ret i32 1
+}
+
+declare void @clobber(i32*)
+
+define i32 @cmp_unknown(i32* %x, i32* %y) {
+; CHECK-LABEL: @cmp_unknown(
+; CHECK: call i32 @cmp(
+  %r = call i32 @cmp(i32* %x, i32* %y)
+  ret i32 %r
+}
+
+define i32 @cmp_same_base(i32* %x) {
+; CHECK-LABEL: @cmp_same_base(
+; CHECK-NOT: call
+; CHECK: ret i32 0
+  %y = getelementptr inbounds i32, i32* %x, i64 1
+  %r = call i32 @cmp(i32* %x, i32* %y)
+  ret i32 %r
+}
+
+define i32 @cmp_unknown2(i32* %x, i32* %y) {
+; CHECK-LABEL: @cmp_unknown2(
+; CHECK: call i32 @cmp(
+  %r = call i32 @cmp(i32* %y, i32* %x)
+  ret i32 %r
+}
+
+; STATS: 4 inline-cost - Number of callee body costs cached
+; STATS: 7 inline-cost - Number of call sites analyzed with a cached callee body cost
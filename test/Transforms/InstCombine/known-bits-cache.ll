@@ -0,0 +1,42 @@
+; RUN: opt < %s -instcombine -S | FileCheck %s
+; RUN: opt < %s -instcombine -instcombine-cache-known-bits -verify-known-bits-cache -S | FileCheck %s
+
+; The results must be the same whether or not the known bits are cached.
+
+define i32 @and_of_shl(i32 %x) {
+; CHECK-LABEL: @and_of_shl(
+; CHECK-NEXT: ret i32 0
+  %s = shl i32 %x, 4
+  %a = and i32 %s, 15
+  ret i32 %a
+}
+
+define i1 @or_one_ne_zero(i32 %x) {
+; CHECK-LABEL: @or_one_ne_zero(
+; CHECK-NEXT: ret i1 false
+  %o = or i32 %x, 1
+  %c = icmp eq i32 %o, 0
+  ret i1 %c
+}
+
+; The known bits of %m are queried again after %s has been replaced.
+define i32 @reuse_after_change(i32 %x, i32 %y) {
+; CHECK-LABEL: @reuse_after_change(
+; CHECK-NEXT: [[A:%.*]] = and i32 %y, 255
+; CHECK-NEXT: ret i32 [[A]]
+  %m = shl i32 %x, 8
+  %s = add i32 %m, 0
+  %o = or i32 %s, %y
+  %a = and i32 %o, 255
+  ret i32 %a
+}
+
+define i32 @sign_bits(i8 %x) {
+; CHECK-LABEL: @sign_bits(
+; CHECK-NEXT: [[E:%.*]] = sext i8 %x to i32
+; CHECK-NEXT: ret i32 [[E]]
+  %e = sext i8 %x to i32
+  %s = shl i32 %e, 24
+  %r = ashr i32 %s, 24
+  ret i32 %r
+}
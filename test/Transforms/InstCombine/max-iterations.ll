@@ -0,0 +1,19 @@
+; RUN: opt < %s -instcombine -instcombine-max-iterations=1 -pass-remarks-analysis=instcombine -S 2>&1 | FileCheck %s --check-prefix=REMARK --check-prefix=CHECK
+; RUN: opt < %s -instcombine -instcombine-single-iteration -pass-remarks-analysis=instcombine -S 2>&1 | FileCheck %s --check-prefix=SINGLE --check-prefix=CHECK
+; RUN: opt < %s -instcombine -pass-remarks-analysis=instcombine -S 2>&1 | FileCheck %s --check-prefix=SINGLE --check-prefix=CHECK
+
+; Stopping after one iteration reports what the iteration still changed. The
+; single iteration mode stops there too, but is expected to, and so is silent.
+
+; REMARK: remark: {{.*}}no fixed point after 1 iterations, the last one changed: add (2), mul (1)
+; SINGLE-NOT: remark
+
+; CHECK-LABEL: @test(
+; CHECK-NEXT: [[M:%.*]] = shl i32 %x, 1
+; CHECK-NEXT: ret i32 [[M]]
+define i32 @test(i32 %x) {
+  %a = add i32 %x, 0
+  %b = add i32 %a, 0
+  %m = mul i32 %b, 2
+  ret i32 %m
+}
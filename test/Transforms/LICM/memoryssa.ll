@@ -0,0 +1,86 @@
+; RUN: opt < %s -basicaa -licm -S | FileCheck %s --check-prefix=CHECK --check-prefix=AST
+; RUN: opt < %s -basicaa -licm -licm-memoryssa -S | FileCheck %s --check-prefix=CHECK --check-prefix=MSSA
+
+@a = global i32 0
+@b = global i32 0
+
+; %q may alias both @a and @b, which puts all three accesses in one alias set
+; that is modified in the loop. MemorySSA sees that the store to @b does not
+; clobber the load of @a, so the load is hoisted.
+define i32 @transitive_alias(i32* %q, i32 %n) {
+; CHECK-LABEL: @transitive_alias(
+; MSSA: entry:
+; MSSA-NEXT: %va = load i32, i32* @a
+; MSSA: loop:
+; AST: loop:
+; AST: %va = load i32, i32* @a
+; CHECK: %vq = load i32, i32* %q
+; CHECK: store i32 %i, i32* @b
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %va = load i32, i32* @a
+  %vq = load i32, i32* %q
+  store i32 %i, i32* @b
+  %s = add i32 %sum, %va
+  %sum.next = add i32 %s, %vq
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
+
+; A load clobbered by a store in the loop stays put. The store is volatile so
+; that the location is not promoted either.
+define i32 @clobbered(i32 %n) {
+; CHECK-LABEL: @clobbered(
+; CHECK: loop:
+; CHECK: %va = load i32, i32* @a
+; CHECK: store volatile i32 %i, i32* @a
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %sum = phi i32 [ 0, %entry ], [ %sum.next, %loop ]
+  %va = load i32, i32* @a
+  %sum.next = add i32 %sum, %va
+  store volatile i32 %i, i32* @a
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret i32 %sum.next
+}
+
+; Both modes promote a location that nothing else in the loop touches.
+define void @promote(i32 %n) {
+; CHECK-LABEL: @promote(
+; CHECK: entry:
+; CHECK: %a.promoted = load i32, i32* @a
+; CHECK: loop:
+; CHECK-NOT: store
+; CHECK: exit:
+; CHECK: store i32 %{{.*}}, i32* @a
+entry:
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %loop ]
+  %va = load i32, i32* @a
+  %inc = add i32 %va, 1
+  store i32 %inc, i32* @a
+  store i32 %i, i32* @b
+  %i.next = add i32 %i, 1
+  %c = icmp slt i32 %i.next, %n
+  br i1 %c, label %loop, label %exit
+
+exit:
+  ret void
+}
@@ -0,0 +1,72 @@
+; RUN: opt -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-distance=100 -loop-prefetch-indirect -S < %s | FileCheck %s
+; RUN: opt -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-distance=100 -S < %s | FileCheck %s --check-prefix=DIRECT
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The address of a[b[i]] is prefetched with the index b[i] of a later
+; iteration, clamped to the last iteration.
+; CHECK-LABEL: @gather(
+; CHECK: for.body:
+; CHECK: %prefidx = load i32, i32* {{%.*}}, align 4
+; CHECK-NEXT: [[IDX:%.*]] = sext i32 %prefidx to i64
+; CHECK-NEXT: %prefaddr = getelementptr double, double* %a, i64 [[IDX]]
+; CHECK-NEXT: [[PTR:%.*]] = bitcast double* %prefaddr to i8*
+; CHECK-NEXT: call void @llvm.prefetch(i8* [[PTR]], i32 0, i32 3, i32 1)
+; CHECK-NEXT: %val = load double, double* %a.idx, align 8
+; DIRECT-LABEL: @gather(
+; DIRECT-NOT: %prefidx
+; DIRECT: ret double
+define double @gather(double* %a, i32* %b) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %sum = phi double [ 0.0, %entry ], [ %sum.next, %for.body ]
+  %b.i = getelementptr inbounds i32, i32* %b, i64 %i
+  %idx = load i32, i32* %b.i, align 4
+  %idx.ext = sext i32 %idx to i64
+  %a.idx = getelementptr inbounds double, double* %a, i64 %idx.ext
+  %val = load double, double* %a.idx, align 8
+  %sum.next = fadd double %sum, %val
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret double %sum.next
+}
+
+; The index is only loaded on some iterations, so loading it ahead of time
+; may not be safe.
+; CHECK-LABEL: @conditional_index(
+; CHECK-NOT: %prefidx
+; CHECK: ret void
+define void @conditional_index(double* %a, i32* %b, i1* %c) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.latch ]
+  %c.i = getelementptr inbounds i1, i1* %c, i64 %i
+  %cond = load i1, i1* %c.i
+  br i1 %cond, label %if.then, label %for.latch
+
+if.then:
+  %b.i = getelementptr inbounds i32, i32* %b, i64 %i
+  %idx = load i32, i32* %b.i, align 4
+  %idx.ext = sext i32 %idx to i64
+  %a.idx = getelementptr inbounds double, double* %a, i64 %idx.ext
+  %val = load double, double* %a.idx, align 8
+  %add = fadd double %val, 1.0
+  store double %add, double* %a.idx, align 8
+  br label %for.latch
+
+for.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
@@ -0,0 +1,54 @@
+; REQUIRES: asserts
+; RUN: opt -mtriple=x86_64-unknown-linux-gnu -loop-data-prefetch -prefetch-distance=100 -prefetch-miss-profile=%S/Inputs/miss-profile.prof -debug-only=loop-data-prefetch -S < %s 2>&1 | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; The profile has 1% of the misses of the function on the load of b, and 99%
+; on the load of c, so only c is prefetched. The branch weights say that the
+; loop runs 4 iterations, so it is prefetched 2 iterations ahead.
+; CHECK: Prefetching 2 iterations ahead
+; CHECK: 10 miss samples for {{ *}}%vb = load
+; CHECK: 990 miss samples for {{ *}}%vc = load
+; CHECK: Access: {{ *}}%c.i = getelementptr
+; CHECK-LABEL: @misses(
+; CHECK: for.body:
+; CHECK-NEXT: %i = phi
+; CHECK-NEXT: %b.i = getelementptr
+; CHECK-NEXT: %vb = load
+; CHECK-NEXT: %c.i = getelementptr
+; CHECK: call void @llvm.prefetch
+; CHECK-NEXT: %vc = load
+; CHECK-NOT: call void @llvm.prefetch
+; CHECK: ret void
+define void @misses(double* %a, double* %b, double* %c) !dbg !4 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %b.i = getelementptr inbounds double, double* %b, i64 %i
+  %vb = load double, double* %b.i, align 8, !dbg !5
+  %c.i = getelementptr inbounds double, double* %c, i64 %i
+  %vc = load double, double* %c.i, align 8, !dbg !6
+  %add = fadd double %vb, %vc
+  %a.i = getelementptr inbounds double, double* %a, i64 %i
+  store double %add, double* %a.i, align 8
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, 1024
+  br i1 %exitcond, label %for.end, label %for.body, !prof !7
+
+for.end:
+  ret void
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!2}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: FullDebug)
+!1 = !DIFile(filename: "misses.c", directory: "/")
+!2 = !{i32 2, !"Debug Info Version", i32 3}
+!3 = !DISubroutineType(types: !{})
+!4 = distinct !DISubprogram(name: "misses", scope: !1, file: !1, line: 1, type: !3, isDefinition: true, unit: !0)
+!5 = !DILocation(line: 2, scope: !4)
+!6 = !DILocation(line: 3, scope: !4)
+!7 = !{!"branch_weights", i32 1, i32 3}
@@ -0,0 +1,124 @@
+; RUN: opt -basicaa -loop-fusion -loop-fusion-verify -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; for (i = 0; i < 1024; ++i) b[i] = a[i] + 1;
+; for (i = 0; i < 1024; ++i) c[i] = a[i] * b[i];
+;
+; The second loop reads b[i] after the first loop wrote it in the same
+; iteration, and both stream a, so the loops are fused.
+; CHECK-LABEL: @fuse(
+; CHECK: entry:
+; CHECK-NEXT: br label %loop1
+; CHECK: loop1:
+; CHECK-NEXT: %i1 = phi i64 [ 0, %entry ], [ %i1.next, %loop2 ]
+; CHECK-NEXT: %i2 = phi i64 [ 0, %entry ], [ %i2.next, %loop2 ]
+; CHECK: store i32 %add, i32* %b.i1
+; CHECK-NEXT: %i1.next = add nuw nsw i64 %i1, 1
+; CHECK-NEXT: br label %loop2
+; CHECK: loop2:
+; CHECK: store i32 %mul, i32* %c.i2
+; CHECK: br i1 %exit2, label %exit, label %loop1
+; CHECK-NOT: between:
+define void @fuse(i32* noalias %a, i32* noalias %b, i32* noalias %c) {
+entry:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %entry ], [ %i1.next, %loop1 ]
+  %a.i1 = getelementptr inbounds i32, i32* %a, i64 %i1
+  %va1 = load i32, i32* %a.i1, align 4
+  %add = add nsw i32 %va1, 1
+  %b.i1 = getelementptr inbounds i32, i32* %b, i64 %i1
+  store i32 %add, i32* %b.i1, align 4
+  %i1.next = add nuw nsw i64 %i1, 1
+  %exit1 = icmp eq i64 %i1.next, 1024
+  br i1 %exit1, label %between, label %loop1
+
+between:
+  br label %loop2
+
+loop2:
+  %i2 = phi i64 [ 0, %between ], [ %i2.next, %loop2 ]
+  %a.i2 = getelementptr inbounds i32, i32* %a, i64 %i2
+  %va2 = load i32, i32* %a.i2, align 4
+  %b.i2 = getelementptr inbounds i32, i32* %b, i64 %i2
+  %vb2 = load i32, i32* %b.i2, align 4
+  %mul = mul nsw i32 %va2, %vb2
+  %c.i2 = getelementptr inbounds i32, i32* %c, i64 %i2
+  store i32 %mul, i32* %c.i2, align 4
+  %i2.next = add nuw nsw i64 %i2, 1
+  %exit2 = icmp eq i64 %i2.next, 1024
+  br i1 %exit2, label %exit, label %loop2
+
+exit:
+  ret void
+}
+
+; The second loop reads b[i + 1], which a later iteration of the first loop
+; writes, so fusing would read a stale value.
+; CHECK-LABEL: @backward_dependence(
+; CHECK: between:
+define void @backward_dependence(i32* noalias %a, i32* noalias %b, i32* noalias %c) {
+entry:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %entry ], [ %i1.next, %loop1 ]
+  %a.i1 = getelementptr inbounds i32, i32* %a, i64 %i1
+  %va1 = load i32, i32* %a.i1, align 4
+  %b.i1 = getelementptr inbounds i32, i32* %b, i64 %i1
+  store i32 %va1, i32* %b.i1, align 4
+  %i1.next = add nuw nsw i64 %i1, 1
+  %exit1 = icmp eq i64 %i1.next, 1024
+  br i1 %exit1, label %between, label %loop1
+
+between:
+  br label %loop2
+
+loop2:
+  %i2 = phi i64 [ 0, %between ], [ %i2.next, %loop2 ]
+  %i2.next = add nuw nsw i64 %i2, 1
+  %b.i2 = getelementptr inbounds i32, i32* %b, i64 %i2.next
+  %vb2 = load i32, i32* %b.i2, align 4
+  %c.i2 = getelementptr inbounds i32, i32* %c, i64 %i2
+  store i32 %vb2, i32* %c.i2, align 4
+  %exit2 = icmp eq i64 %i2.next, 1024
+  br i1 %exit2, label %exit, label %loop2
+
+exit:
+  ret void
+}
+
+; The loops do not run the same number of iterations.
+; CHECK-LABEL: @different_trip_counts(
+; CHECK: between:
+define void @different_trip_counts(i32* noalias %a, i32* noalias %b) {
+entry:
+  br label %loop1
+
+loop1:
+  %i1 = phi i64 [ 0, %entry ], [ %i1.next, %loop1 ]
+  %a.i1 = getelementptr inbounds i32, i32* %a, i64 %i1
+  store i32 0, i32* %a.i1, align 4
+  %i1.next = add nuw nsw i64 %i1, 1
+  %exit1 = icmp eq i64 %i1.next, 1024
+  br i1 %exit1, label %between, label %loop1
+
+between:
+  br label %loop2
+
+loop2:
+  %i2 = phi i64 [ 0, %between ], [ %i2.next, %loop2 ]
+  %a.i2 = getelementptr inbounds i32, i32* %a, i64 %i2
+  %va2 = load i32, i32* %a.i2, align 4
+  %b.i2 = getelementptr inbounds i32, i32* %b, i64 %i2
+  store i32 %va2, i32* %b.i2, align 4
+  %i2.next = add nuw nsw i64 %i2, 1
+  %exit2 = icmp eq i64 %i2.next, 512
+  br i1 %exit2, label %exit, label %loop2
+
+exit:
+  ret void
+}
@@ -0,0 +1,32 @@
+; RUN: opt < %s -loop-reduce -S | FileCheck %s
+; RUN: opt < %s -loop-reduce -lsr-beam-search -S | FileCheck %s
+; RUN: opt < %s -loop-reduce -lsr-beam-search -lsr-beam-width=1 -S | FileCheck %s
+; RUN: opt < %s -loop-reduce -lsr-solver-budget=1 -S | FileCheck %s
+
+; The beam search, and the fallback to it when the exhaustive solver runs out
+; of budget, should find the same single stride 18 indvar as the exhaustive
+; solver.
+
+declare i1 @cond(i32)
+
+; CHECK-LABEL: @test(
+; CHECK: phi i32
+; CHECK-NOT: phi
+; CHECK: ret void
+define void @test(i32 %B) {
+entry:
+  br label %Loop
+
+Loop:
+  %IV = phi i32 [ 0, %entry ], [ %IVn, %Loop ]
+  %C = mul i32 %IV, 18
+  %D = mul i32 %IV, 18
+  %E = add i32 %D, %B
+  %cnd = call i1 @cond(i32 %E)
+  call i1 @cond(i32 %C)
+  %IVn = add i32 %IV, 1
+  br i1 %cnd, label %Loop, label %Out
+
+Out:
+  ret void
+}
@@ -0,0 +1,36 @@
+; RUN: opt -basicaa -loop-tile -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; Each inner iteration touches 4 bytes of a and a 64 byte line of b. Half of
+; the 32KB first level cache holds 240 iterations, and the tile size is
+; rounded down to a power of two.
+; CHECK-LABEL: @transpose(
+; CHECK: %tile.count = select i1 %tile.last, i64 %tile.remaining, i64 128
+define void @transpose([1024 x i32]* noalias %a, [1024 x i32]* noalias %b) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %b.ji = getelementptr inbounds [1024 x i32], [1024 x i32]* %b, i64 %j, i64 %i
+  %v = load i32, i32* %b.ji, align 4
+  %a.ij = getelementptr inbounds [1024 x i32], [1024 x i32]* %a, i64 %i, i64 %j
+  store i32 %v, i32* %a.ij, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 1024
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 1024
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
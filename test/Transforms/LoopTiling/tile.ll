@@ -0,0 +1,134 @@
+; RUN: opt -basicaa -loop-tile -loop-tile-size=16 -loop-tile-verify -S < %s | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; for (i = 0; i < 1024; ++i)
+;   for (j = 0; j < 1024; ++j)
+;     a[i][j] = b[j][i];
+;
+; Every iteration of the inner loop reads another cache line of b, that the
+; next iterations of the outer loop read again, so the inner loop is tiled.
+; CHECK-LABEL: @transpose(
+; CHECK: entry:
+; CHECK-NEXT: br label %tile.header
+; CHECK: tile.header:
+; CHECK-NEXT: %tile.offset = phi i64 [ 0, %entry ], [ %tile.offset.next, %tile.latch ]
+; CHECK-NEXT: %tile.remaining = sub i64 1024, %tile.offset
+; CHECK-NEXT: %tile.last = icmp ule i64 %tile.remaining, 16
+; CHECK-NEXT: %tile.count = select i1 %tile.last, i64 %tile.remaining, i64 16
+; CHECK-NEXT: %tile.begin = add i64 0, %tile.offset
+; CHECK-NEXT: %tile.end = add i64 %tile.begin, %tile.count
+; CHECK-NEXT: br label %outer
+; CHECK: outer:
+; CHECK-NEXT: %i = phi i64 [ 0, %tile.header ], [ %i.next, %outer.latch ]
+; CHECK: inner:
+; CHECK-NEXT: %j = phi i64 [ %tile.begin, %outer ], [ %j.next, %inner ]
+; CHECK: %tile.cond = icmp eq i64 %j.next, %tile.end
+; CHECK-NEXT: br i1 %tile.cond, label %outer.latch, label %inner
+; CHECK: outer.latch:
+; CHECK: br i1 %outer.done, label %tile.latch, label %outer
+; CHECK: tile.latch:
+; CHECK-NEXT: %tile.offset.next = add i64 %tile.offset, 16
+; CHECK-NEXT: br i1 %tile.last, label %exit, label %tile.header
+define void @transpose([1024 x i32]* noalias %a, [1024 x i32]* noalias %b) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %b.ji = getelementptr inbounds [1024 x i32], [1024 x i32]* %b, i64 %j, i64 %i
+  %v = load i32, i32* %b.ji, align 4
+  %a.ij = getelementptr inbounds [1024 x i32], [1024 x i32]* %a, i64 %i, i64 %j
+  store i32 %v, i32* %a.ij, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 1024
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 1024
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; for (i = 1; i < 1024; ++i)
+;   for (j = 0; j < 1023; ++j)
+;     a[i][j] = a[i-1][j+1] + b[j][i];
+;
+; Iteration (i, j) reads what iteration (i-1, j+1) wrote, which is in the
+; next tile, so the nest is not tiled.
+; CHECK-LABEL: @dependence(
+; CHECK-NOT: tile.header
+; CHECK: ret void
+define void @dependence([1024 x i32]* noalias %a, [1024 x i32]* noalias %b) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 1, %entry ], [ %i.next, %outer.latch ]
+  %i.prev = add nsw i64 %i, -1
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %j.next = add nuw nsw i64 %j, 1
+  %a.prev = getelementptr inbounds [1024 x i32], [1024 x i32]* %a, i64 %i.prev, i64 %j.next
+  %v1 = load i32, i32* %a.prev, align 4
+  %b.ji = getelementptr inbounds [1024 x i32], [1024 x i32]* %b, i64 %j, i64 %i
+  %v2 = load i32, i32* %b.ji, align 4
+  %add = add nsw i32 %v1, %v2
+  %a.ij = getelementptr inbounds [1024 x i32], [1024 x i32]* %a, i64 %i, i64 %j
+  store i32 %add, i32* %a.ij, align 4
+  %inner.done = icmp eq i64 %j.next, 1023
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 1024
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; for (i = 0; i < 1024; ++i)
+;   for (j = 0; j < 1024; ++j)
+;     a[i][j] = b[i][j];
+;
+; The outer loop does not touch again what the inner loop read, so the nest
+; is not tiled.
+; CHECK-LABEL: @no_reuse(
+; CHECK-NOT: tile.header
+; CHECK: ret void
+define void @no_reuse([1024 x i32]* noalias %a, [1024 x i32]* noalias %b) {
+entry:
+  br label %outer
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %b.ij = getelementptr inbounds [1024 x i32], [1024 x i32]* %b, i64 %i, i64 %j
+  %v = load i32, i32* %b.ij, align 4
+  %a.ij = getelementptr inbounds [1024 x i32], [1024 x i32]* %a, i64 %i, i64 %j
+  store i32 %v, i32* %a.ij, align 4
+  %j.next = add nuw nsw i64 %j, 1
+  %inner.done = icmp eq i64 %j.next, 1024
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %outer.done = icmp eq i64 %i.next, 1024
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
@@ -0,0 +1,69 @@
+; RUN: opt < %s -S -loop-unroll | FileCheck %s
+; RUN: opt < %s -S -loop-unroll -unroll-allow-peeling=false | FileCheck %s --check-prefix=NOPEEL
+; RUN: opt < %s -S -loop-unroll -unroll-runtime -unroll-allow-peeling=false | FileCheck %s --check-prefix=RUNTIME
+
+; The loop runs 3 times on average according to the profile, so its first 3
+; iterations are peeled off and the loop itself is left in place.
+
+; CHECK-LABEL: @basic(
+; CHECK: for.body.peel.begin:
+; CHECK: store i32 0, i32* %p
+; CHECK: br i1 %{{.*}}, label %[[NEXT0:.*]], label %{{.*}}, !prof ![[W0:[0-9]+]]
+; CHECK: [[NEXT0]]:
+; CHECK: store i32 %inc.peel, i32* %incdec.ptr.peel,
+; CHECK: br i1 %{{.*}}, label %[[NEXT1:.*]], label %{{.*}}, !prof ![[W1:[0-9]+]]
+; CHECK: [[NEXT1]]:
+; CHECK: store i32 %inc.peel{{[0-9]+}}, i32* %incdec.ptr.peel{{[0-9]+}},
+; CHECK: br i1 %{{.*}}, label %[[NEXT2:.*]], label %{{.*}}, !prof ![[W2:[0-9]+]]
+; CHECK: for.body:
+; CHECK: br i1 %{{.*}}, label %for.body, label %{{.*}}, !prof ![[W3:[0-9]+]]
+
+; Without peeling, runtime unrolling is capped to the profiled trip count.
+
+; NOPEEL-LABEL: @basic(
+; NOPEEL-NOT: peel
+; NOPEEL: for.body:
+; NOPEEL: store i32
+; NOPEEL-NOT: store i32
+; NOPEEL: br i1
+
+; RUNTIME-LABEL: @basic(
+; RUNTIME: for.body:
+; RUNTIME: store i32
+; RUNTIME: store i32
+; RUNTIME-NOT: store i32
+; RUNTIME: br i1 %{{.*}}, label %for.body
+
+define void @basic(i32* %p, i32 %k) !prof !0 {
+entry:
+  %cmp3 = icmp slt i32 0, %k
+  br i1 %cmp3, label %for.body.lr.ph, label %for.end
+
+for.body.lr.ph:
+  br label %for.body
+
+for.body:
+  %i.05 = phi i32 [ 0, %for.body.lr.ph ], [ %inc, %for.body ]
+  %p.addr.04 = phi i32* [ %p, %for.body.lr.ph ], [ %incdec.ptr, %for.body ]
+  %incdec.ptr = getelementptr inbounds i32, i32* %p.addr.04, i32 1
+  store i32 %i.05, i32* %p.addr.04, align 4
+  %inc = add nsw i32 %i.05, 1
+  %cmp = icmp slt i32 %inc, %k
+  br i1 %cmp, label %for.body, label %for.cond.for.end_crit_edge, !prof !1
+
+for.cond.for.end_crit_edge:
+  br label %for.end
+
+for.end:
+  ret void
+}
+
+!0 = !{!"function_entry_count", i64 1}
+!1 = !{!"branch_weights", i32 200, i32 100}
+
+; The 100 loop entries fall through fewer peeled iterations each time, and
+; what is left of the 200 backedges stays with the loop.
+; CHECK: ![[W0]] = !{!"branch_weights", i32 90, i32 10}
+; CHECK: ![[W1]] = !{!"branch_weights", i32 54, i32 36}
+; CHECK: ![[W2]] = !{!"branch_weights", i32 16, i32 38}
+; CHECK: ![[W3]] = !{!"branch_weights", i32 40, i32 16}
@@ -0,0 +1,126 @@
+; RUN: opt < %s -loop-vectorize -vectorize-early-exit-loops -force-vector-width=4 -S | FileCheck %s
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; A search loop over an object of 1024 elements: the vector loop runs when
+; the trip count is at most 1024, and the original loop finds the element in
+; the vector where the exit condition holds.
+
+; CHECK-LABEL: @find(
+; CHECK: %early.exit.dereferenceable = and i1 %early.exit.has.vector
+; CHECK: br i1 %early.exit.dereferenceable, label %early.exit.vector.ph, label %early.exit.resume
+; CHECK: early.exit.vector.body:
+; CHECK: %wide.load = load <4 x i32>, <4 x i32>* {{.*}}, align 4
+; CHECK: %found.vec = icmp eq <4 x i32> %wide.load, %broadcast
+; CHECK: %early.exit.mask = bitcast <4 x i1> %found.vec to i4
+; CHECK: %early.exit.any = icmp ne i4 %early.exit.mask, 0
+; CHECK: br i1 %early.exit.any, label %early.exit.vector.exit, label %early.exit.vector.latch
+; CHECK: early.exit.resume:
+; CHECK: %early.exit.resume.index = phi i64 [ 0, %entry ], [ %early.exit.vector.resume, %early.exit.vector.exit ]
+; CHECK: %i = phi i64 [ %early.exit.resume.index, %early.exit.resume ], [ %i.next, %latch ]
+define i64 @find(i32* dereferenceable(4096) %a, i32 %x, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %addr = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %addr, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ %n, %latch ]
+  ret i64 %r
+}
+
+; The loop leaves when the condition does not hold, over a global array.
+
+@table = global [256 x float] zeroinitializer
+
+; CHECK-LABEL: @find_not_negative(
+; CHECK: early.exit.vector.body:
+; CHECK: load <4 x float>
+; CHECK: %positive.vec = fcmp oge <4 x float>
+; CHECK: %early.exit.mask = bitcast <4 x i1> %positive.vec to i4
+; CHECK: %early.exit.any = icmp ne i4 %early.exit.mask, -1
+define i64 @find_not_negative(i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %addr = getelementptr inbounds [256 x float], [256 x float]* @table, i64 0, i64 %i
+  %v = load float, float* %addr, align 4
+  %positive = fcmp oge float %v, 0.000000e+00
+  br i1 %positive, label %latch, label %exit
+
+latch:
+  %i.next = add nuw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ %n, %latch ]
+  ret i64 %r
+}
+
+; Nothing is known about the size of the object, the loads past the exit may
+; fault.
+
+; CHECK-LABEL: @find_unknown_size(
+; CHECK-NOT: early.exit
+; CHECK: ret i64
+define i64 @find_unknown_size(i32* %a, i32 %x, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %addr = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %addr, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ %n, %latch ]
+  ret i64 %r
+}
+
+; The loop has a side effect before its exit.
+
+; CHECK-LABEL: @find_and_store(
+; CHECK-NOT: early.exit
+; CHECK: ret i64
+define i64 @find_and_store(i32* dereferenceable(4096) %a, i32 %x, i64 %n) {
+entry:
+  br label %loop
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %latch ]
+  %addr = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %addr, align 4
+  store i32 0, i32* %addr, align 4
+  %found = icmp eq i32 %v, %x
+  br i1 %found, label %exit, label %latch
+
+latch:
+  %i.next = add nuw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  %r = phi i64 [ %i, %loop ], [ %n, %latch ]
+  ret i64 %r
+}
@@ -0,0 +1,98 @@
+; RUN: opt < %s -loop-vectorize -vectorize-outer-loops -force-vector-width=4 -force-vector-interleave=1 -S | FileCheck %s
+; RUN: opt < %s -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 -S | FileCheck %s --check-prefix=NOOUTER
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; A 3-point stencil:
+;   for (x = 0; x < n; ++x) {
+;     float sum = 0;
+;     for (k = 0; k < 3; ++k)
+;       sum += in[x + k] * w[k];
+;     out[x] = sum;
+;   }
+; The inner loop is unrolled and the loop over x is vectorized.
+
+; CHECK-LABEL: @stencil(
+; CHECK: vector.body:
+; CHECK: load <4 x float>
+; CHECK: load <4 x float>
+; CHECK: load <4 x float>
+; CHECK: store <4 x float>
+; CHECK: middle.block:
+
+; NOOUTER-LABEL: @stencil(
+; NOOUTER-NOT: <4 x float>
+; NOOUTER: ret void
+define void @stencil(float* noalias %out, float* noalias %in, float* noalias %w, i64 %n) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi float [ 0.000000e+00, %outer ], [ %sum.next, %inner ]
+  %idx = add nuw nsw i64 %x, %k
+  %in.addr = getelementptr inbounds float, float* %in, i64 %idx
+  %v = load float, float* %in.addr, align 4
+  %w.addr = getelementptr inbounds float, float* %w, i64 %k
+  %wv = load float, float* %w.addr, align 4
+  %mul = fmul float %v, %wv
+  %sum.next = fadd float %sum, %mul
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k.next, 3
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %out.addr = getelementptr inbounds float, float* %out, i64 %x
+  store float %sum.lcssa, float* %out.addr, align 4
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
+
+; The trip count of the inner loop is not a constant, nothing is vectorized.
+
+; CHECK-LABEL: @variable_inner(
+; CHECK-NOT: <4 x float>
+; CHECK: ret void
+define void @variable_inner(float* noalias %out, float* noalias %in, float* noalias %w, i64 %n, i64 %m) {
+entry:
+  br label %outer
+
+outer:
+  %x = phi i64 [ 0, %entry ], [ %x.next, %outer.latch ]
+  br label %inner
+
+inner:
+  %k = phi i64 [ 0, %outer ], [ %k.next, %inner ]
+  %sum = phi float [ 0.000000e+00, %outer ], [ %sum.next, %inner ]
+  %idx = add nuw nsw i64 %x, %k
+  %in.addr = getelementptr inbounds float, float* %in, i64 %idx
+  %v = load float, float* %in.addr, align 4
+  %w.addr = getelementptr inbounds float, float* %w, i64 %k
+  %wv = load float, float* %w.addr, align 4
+  %mul = fmul float %v, %wv
+  %sum.next = fadd float %sum, %mul
+  %k.next = add nuw nsw i64 %k, 1
+  %inner.done = icmp eq i64 %k.next, %m
+  br i1 %inner.done, label %outer.latch, label %inner
+
+outer.latch:
+  %sum.lcssa = phi float [ %sum.next, %inner ]
+  %out.addr = getelementptr inbounds float, float* %out, i64 %x
+  store float %sum.lcssa, float* %out.addr, align 4
+  %x.next = add nuw nsw i64 %x, 1
+  %outer.done = icmp eq i64 %x.next, %n
+  br i1 %outer.done, label %exit, label %outer
+
+exit:
+  ret void
+}
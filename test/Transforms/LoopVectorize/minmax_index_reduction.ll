@@ -0,0 +1,120 @@
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-interleave=1 < %s | FileCheck %s
+; RUN: opt -S -loop-vectorize -force-vector-width=4 -force-vector-interleave=2 < %s | FileCheck %s --check-prefix=UNROLL
+
+target datalayout = "e-m:e-i64:64-i128:128-n32:64-S128"
+
+; The index of the first minimum (argmin). Each lane tracks its own minimum
+; and the index of its first occurrence. After the loop, the index is the
+; smallest one among the lanes that hold the overall minimum.
+; CHECK-LABEL: @argmin(
+; CHECK: vector.body:
+; CHECK: %[[MIN:.*]] = phi <4 x i32>
+; CHECK: %[[IDX:.*]] = phi <4 x i64>
+; CHECK: %[[CMP:.*]] = icmp slt <4 x i32> %{{.*}}, %[[MIN]]
+; CHECK: select <4 x i1> %[[CMP]], <4 x i32>
+; CHECK: select <4 x i1> %[[CMP]], <4 x i64>
+; CHECK: middle.block:
+; CHECK: icmp slt <4 x i32>
+; CHECK: %[[VALRDX:.*]] = extractelement <4 x i32> %{{.*}}, i32 0
+; CHECK: %[[SPLATINS:.*]] = insertelement <4 x i32> undef, i32 %[[VALRDX]], i32 0
+; CHECK: %[[SPLAT:.*]] = shufflevector <4 x i32> %[[SPLATINS]], <4 x i32> undef, <4 x i32> zeroinitializer
+; CHECK: %[[ISMIN:.*]] = icmp eq <4 x i32> %{{.*}}, %[[SPLAT]]
+; CHECK: %[[CAND:.*]] = select <4 x i1> %[[ISMIN]], <4 x i64> %{{.*}}, <4 x i64> <i64 -1, i64 -1, i64 -1, i64 -1>
+; CHECK: %[[SHUF:.*]] = shufflevector <4 x i64> %[[CAND]], <4 x i64> undef, <4 x i32> <i32 2, i32 3, i32 undef, i32 undef>
+; CHECK: icmp ult <4 x i64> %[[CAND]], %[[SHUF]]
+; CHECK: %[[IDXRDX:.*]] = extractelement <4 x i64> %{{.*}}, i32 0
+; CHECK: scalar.ph:
+; CHECK: %bc.merge.rdx{{.*}} = phi i64 [ 0, %{{.*}} ], [ %[[IDXRDX]], %middle.block ]
+; CHECK: for.end:
+; CHECK: phi i64 [ %idx.next, %for.body ], [ %[[IDXRDX]], %middle.block ]
+
+; UNROLL-LABEL: @argmin(
+; UNROLL: middle.block:
+; UNROLL: icmp eq <4 x i32>
+; UNROLL: icmp eq <4 x i32>
+; UNROLL: select <4 x i1> %{{.*}}, <4 x i64> %{{.*}}, <4 x i64> <i64 -1, i64 -1, i64 -1, i64 -1>
+; UNROLL: select <4 x i1> %{{.*}}, <4 x i64> %{{.*}}, <4 x i64> <i64 -1, i64 -1, i64 -1, i64 -1>
+; UNROLL: icmp ult <4 x i64>
+define i64 @argmin(i32* nocapture readonly %a, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %min = phi i32 [ 2147483647, %entry ], [ %min.next, %for.body ]
+  %idx = phi i64 [ 0, %entry ], [ %idx.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %arrayidx, align 4
+  %cmp = icmp slt i32 %v, %min
+  %min.next = select i1 %cmp, i32 %v, i32 %min
+  %idx.next = select i1 %cmp, i64 %i, i64 %idx
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %idx.lcssa = phi i64 [ %idx.next, %for.body ]
+  ret i64 %idx.lcssa
+}
+
+; The index of the first maximum, written with the compare the other way
+; around, where both the maximum and its index are used after the loop.
+; CHECK-LABEL: @argmax_fp(
+; CHECK: fcmp olt <4 x float>
+; CHECK: select <4 x i1> %{{.*}}, <4 x i32>
+; CHECK: middle.block:
+; CHECK: fcmp oeq <4 x float>
+; CHECK: icmp ult <4 x i32>
+define i32 @argmax_fp(float* nocapture readonly %a, float* nocapture %maxp, i32 %n) #0 {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i32 [ 0, %entry ], [ %i.next, %for.body ]
+  %max = phi float [ 0.000000e+00, %entry ], [ %max.next, %for.body ]
+  %idx = phi i32 [ -1, %entry ], [ %idx.next, %for.body ]
+  %idxprom = zext i32 %i to i64
+  %arrayidx = getelementptr inbounds float, float* %a, i64 %idxprom
+  %v = load float, float* %arrayidx, align 4
+  %cmp = fcmp olt float %max, %v
+  %max.next = select i1 %cmp, float %v, float %max
+  %idx.next = select i1 %cmp, i32 %i, i32 %idx
+  %i.next = add nuw i32 %i, 1
+  %exitcond = icmp eq i32 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %max.lcssa = phi float [ %max.next, %for.body ]
+  %idx.lcssa = phi i32 [ %idx.next, %for.body ]
+  store float %max.lcssa, float* %maxp, align 4
+  ret i32 %idx.lcssa
+}
+
+; With a non-strict compare the index is the one of the last minimum, which is
+; not supported.
+; CHECK-LABEL: @argmin_last(
+; CHECK-NOT: <4 x i32>
+; CHECK: ret i64
+define i64 @argmin_last(i32* nocapture readonly %a, i64 %n) {
+entry:
+  br label %for.body
+
+for.body:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %for.body ]
+  %min = phi i32 [ 2147483647, %entry ], [ %min.next, %for.body ]
+  %idx = phi i64 [ 0, %entry ], [ %idx.next, %for.body ]
+  %arrayidx = getelementptr inbounds i32, i32* %a, i64 %i
+  %v = load i32, i32* %arrayidx, align 4
+  %cmp = icmp sle i32 %v, %min
+  %min.next = select i1 %cmp, i32 %v, i32 %min
+  %idx.next = select i1 %cmp, i64 %i, i64 %idx
+  %i.next = add nuw nsw i64 %i, 1
+  %exitcond = icmp eq i64 %i.next, %n
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  %idx.lcssa = phi i64 [ %idx.next, %for.body ]
+  ret i64 %idx.lcssa
+}
+
+attributes #0 = { "no-nans-fp-math"="true" }
@@ -0,0 +1,104 @@
+; RUN: opt -S -mergefunc -mergefunc-parameterize %s | FileCheck %s
+; RUN: opt -S -mergefunc %s | FileCheck %s --check-prefix=NOPARAM
+
+; @f1 and @f2 only differ in a constant and a callee, so they become thunks to
+; a merged function that takes them as parameters.
+; CHECK-LABEL: define i32 @f1(i32 %x)
+; CHECK-NEXT: tail call i32 @f1.merged(i32 %x, i32 3, i32 (i32)* @ext1)
+; CHECK-NEXT: ret i32
+; CHECK-LABEL: define i32 @f2(i32 %x)
+; CHECK-NEXT: tail call i32 @f1.merged(i32 %x, i32 5, i32 (i32)* @ext2)
+; CHECK-NEXT: ret i32
+; NOPARAM-LABEL: define i32 @f2(i32 %x)
+; NOPARAM-NEXT: mul i32 %x, 5
+
+declare i32 @ext1(i32)
+declare i32 @ext2(i32)
+
+define i32 @f1(i32 %x) {
+  %1 = mul i32 %x, 3
+  %2 = add i32 %1, 7
+  %3 = call i32 @ext1(i32 %2)
+  %4 = mul i32 %3, %3
+  %5 = xor i32 %4, 5
+  %6 = sub i32 %5, %x
+  %7 = shl i32 %6, 2
+  %8 = and i32 %7, 255
+  %9 = or i32 %8, %1
+  %10 = add i32 %9, %3
+  ret i32 %10
+}
+
+define i32 @f2(i32 %x) {
+  %1 = mul i32 %x, 5
+  %2 = add i32 %1, 7
+  %3 = call i32 @ext2(i32 %2)
+  %4 = mul i32 %3, %3
+  %5 = xor i32 %4, 5
+  %6 = sub i32 %5, %x
+  %7 = shl i32 %6, 2
+  %8 = and i32 %7, 255
+  %9 = or i32 %8, %1
+  %10 = add i32 %9, %3
+  ret i32 %10
+}
+
+; The local @g1 and @g2 are only called once, so their callers pass the
+; constants directly and they go away.
+; CHECK-LABEL: define i32 @user(i32 %x)
+; CHECK-NEXT: %a = call i32 @g1.merged(i32 %x, i32 10)
+; CHECK-NEXT: %b = call i32 @g1.merged(i32 %x, i32 20)
+; CHECK-NOT: @g1(
+; CHECK-NOT: @g2(
+
+define internal i32 @g1(i32 %x) {
+  %1 = add i32 %x, 10
+  %2 = mul i32 %1, %x
+  %3 = sub i32 %2, 1
+  %4 = xor i32 %3, %1
+  %5 = lshr i32 %4, 3
+  %6 = add i32 %5, %2
+  ret i32 %6
+}
+
+define internal i32 @g2(i32 %x) {
+  %1 = add i32 %x, 20
+  %2 = mul i32 %1, %x
+  %3 = sub i32 %2, 1
+  %4 = xor i32 %3, %1
+  %5 = lshr i32 %4, 3
+  %6 = add i32 %5, %2
+  ret i32 %6
+}
+
+define i32 @user(i32 %x) {
+  %a = call i32 @g1(i32 %x)
+  %b = call i32 @g2(i32 %x)
+  %c = add i32 %a, %b
+  ret i32 %c
+}
+
+; Small functions are not worth a thunk.
+; CHECK-LABEL: define i32 @h1(i32 %x)
+; CHECK-NEXT: add i32 %x, 1
+; CHECK-LABEL: define i32 @h2(i32 %x)
+; CHECK-NEXT: add i32 %x, 2
+
+define i32 @h1(i32 %x) {
+  %1 = add i32 %x, 1
+  %2 = mul i32 %1, %1
+  ret i32 %2
+}
+
+define i32 @h2(i32 %x) {
+  %1 = add i32 %x, 2
+  %2 = mul i32 %1, %1
+  ret i32 %2
+}
+
+; The merged functions take the operands of the first function as parameters.
+; CHECK-LABEL: define private unnamed_addr i32 @f1.merged(i32 %x, i32 %merged.op, i32 (i32)* %merged.op1)
+; CHECK-NEXT: %1 = mul i32 %x, %merged.op
+; CHECK: call i32 %merged.op1(i32 %2)
+; CHECK-LABEL: define private unnamed_addr i32 @g1.merged(i32 %x, i32 %merged.op)
+; CHECK-NEXT: %1 = add i32 %x, %merged.op
@@ -0,0 +1,39 @@
+; RUN: opt < %s -pgo-icall-prom -icp-count-threshold=0 -pass-remarks=PGOIndirectCallPromotion -S 2>&1 | FileCheck %s --check-prefix=NOMODEL
+; RUN: opt < %s -pgo-icall-prom -icp-count-threshold=0 -icp-inline-cost-model -pass-remarks=PGOIndirectCallPromotion -S 2>&1 | FileCheck %s --check-prefix=MODEL
+
+; Neither target reaches the percentage threshold, but the inline cost model
+; predicts that the direct call of func2 would be inlined. func3 cannot be
+; inlined, so it is left indirect.
+
+; NOMODEL-NOT: remark
+; NOMODEL: call i32 %tmp()
+; MODEL: remark: <unknown>:0:0: Promote indirect call to func2 with count 250 out of 1000
+; MODEL-NOT: remark
+; MODEL: call i32 @func2()
+; MODEL-NOT: call i32 @func3()
+; MODEL: call i32 %tmp(), !prof [[VP:![0-9]+]]
+; MODEL: [[VP]] = !{!"VP", i32 0, i64 750, i64 -6929281286627296573, i64 200}
+
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+@foo = common global i32 ()* null, align 8
+
+define i32 @func2() {
+entry:
+  ret i32 1
+}
+
+define i32 @func3() noinline {
+entry:
+  ret i32 2
+}
+
+define i32 @bar() {
+entry:
+  %tmp = load i32 ()*, i32 ()** @foo, align 8
+  %call = call i32 %tmp(), !prof !1
+  ret i32 %call
+}
+
+!1 = !{!"VP", i32 0, i64 1000, i64 -4377547752858689819, i64 250, i64 -6929281286627296573, i64 200}
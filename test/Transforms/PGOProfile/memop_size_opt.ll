@@ -0,0 +1,60 @@
+; RUN: opt < %s -pgo-instr-gen -S | FileCheck %s --check-prefix=GEN
+; RUN: opt < %s -passes=pgo-instr-gen -S | FileCheck %s --check-prefix=GEN
+; RUN: llvm-profdata merge %S/Inputs/memop_size.proftext -o %t.profdata
+; RUN: opt < %s -pgo-instr-use -pgo-test-profile-file=%t.profdata -S | FileCheck %s --check-prefix=USE
+; RUN: opt < %s -pgo-instr-use -pgo-test-profile-file=%t.profdata -pgo-memop-opt -pgo-memop-count-threshold=50 -pgo-memop-percent-threshold=25 -S | FileCheck %s --check-prefix=OPT
+; RUN: opt < %s -pgo-instr-use -pgo-test-profile-file=%t.profdata -S | opt -passes=pgo-memop-opt -pgo-memop-count-threshold=50 -pgo-memop-percent-threshold=25 -S | FileCheck %s --check-prefix=OPT
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+define void @foo(i8* %dst, i8* %src, i64 %n, i32 %m) {
+entry:
+; GEN: call void @llvm.instrprof.value.profile(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 12884901887, i64 %n, i32 1, i32 0)
+; GEN-NEXT: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %n, i32 1, i1 false)
+; USE: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %n, i32 1, i1 false), !prof ![[MEMCPY_VP:[0-9]+]]
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %n, i32 1, i1 false)
+; GEN: [[LEN:%[0-9]+]] = zext i32 %m to i64
+; GEN-NEXT: call void @llvm.instrprof.value.profile(i8* getelementptr inbounds ([3 x i8], [3 x i8]* @__profn_foo, i32 0, i32 0), i64 12884901887, i64 [[LEN]], i32 1, i32 1)
+; GEN-NEXT: call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 %m, i32 1, i1 false)
+; USE: call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 %m, i32 1, i1 false), !prof ![[MEMSET_VP:[0-9]+]]
+  call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 %m, i32 1, i1 false)
+; Constant lengths are not profiled.
+; GEN-NOT: call void @llvm.instrprof.value.profile
+  call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 4, i32 1, i1 false)
+  ret void
+}
+
+; USE: ![[MEMCPY_VP]] = !{!"VP", i32 1, i64 1000, i64 8, i64 600, i64 16, i64 300, i64 3, i64 100}
+; USE: ![[MEMSET_VP]] = !{!"VP", i32 1, i64 1000, i64 64, i64 1000}
+
+; OPT-LABEL: define void @foo(
+; OPT: switch i64 %n, label %MemOP.Default [
+; OPT-NEXT: i64 8, label %MemOP.Case.8
+; OPT-NEXT: i64 16, label %MemOP.Case.16
+; OPT-NEXT: ], !prof ![[MEMCPY_WEIGHTS:[0-9]+]]
+; OPT: MemOP.Default:
+; OPT-NEXT: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %n, i32 1, i1 false), !prof ![[MEMCPY_REST:[0-9]+]]
+; OPT-NEXT: br label %MemOP.Merge
+; OPT: MemOP.Case.8:
+; OPT-NEXT: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 8, i32 1, i1 false){{$}}
+; OPT-NEXT: br label %MemOP.Merge
+; OPT: MemOP.Case.16:
+; OPT-NEXT: call void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 16, i32 1, i1 false){{$}}
+; OPT-NEXT: br label %MemOP.Merge
+; OPT: MemOP.Merge:
+; OPT-NEXT: switch i32 %m, label %MemOP.Default1 [
+; OPT-NEXT: i32 64, label %MemOP.Case.64
+; OPT-NEXT: ], !prof ![[MEMSET_WEIGHTS:[0-9]+]]
+; OPT: MemOP.Default1:
+; OPT-NEXT: call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 %m, i32 1, i1 false){{$}}
+; OPT: MemOP.Case.64:
+; OPT-NEXT: call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 64, i32 1, i1 false){{$}}
+; OPT: call void @llvm.memset.p0i8.i32(i8* %dst, i8 0, i32 4, i32 1, i1 false)
+; OPT-NEXT: ret void
+
+; OPT: ![[MEMCPY_WEIGHTS]] = !{!"branch_weights", i32 100, i32 600, i32 300}
+; OPT: ![[MEMCPY_REST]] = !{!"VP", i32 1, i64 100, i64 3, i64 100}
+; OPT: ![[MEMSET_WEIGHTS]] = !{!"branch_weights", i32 0, i32 1000}
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture writeonly, i8* nocapture readonly, i64, i32, i1)
+declare void @llvm.memset.p0i8.i32(i8* nocapture writeonly, i8, i32, i32, i1)
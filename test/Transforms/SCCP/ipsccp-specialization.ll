@@ -0,0 +1,66 @@
+; RUN: opt < %s -ipsccp -ipsccp-specialize-functions -S | FileCheck %s
+; RUN: opt < %s -ipsccp -S | FileCheck %s --check-prefix=NOSPEC
+; RUN: opt < %s -ipsccp -ipsccp-specialize-functions -ipsccp-specialization-budget=1 -S | FileCheck %s --check-prefix=NOSPEC
+
+; Calls passing different function pointers get their own clones, in which
+; the indirect call is direct.
+
+; CHECK-LABEL: define i32 @main(
+; CHECK: call i32 @compute.specialized.{{[12]}}(i32 %x, i32 (i32)* @plus)
+; CHECK: call i32 @compute.specialized.{{[12]}}(i32 %x, i32 (i32)* @minus)
+; CHECK: call i32 @compute.specialized.{{[12]}}(i32 %x, i32 (i32)* @plus)
+; CHECK: call i32 @flagged.specialized.{{[12]}}(i32 %x, i1 true)
+; CHECK: call i32 @flagged.specialized.{{[12]}}(i32 %x, i1 false)
+
+; NOSPEC-NOT: specialized
+; NOSPEC: call i32 %binop(i32 %x)
+
+define i32 @main(i32 %x) {
+  %a = call i32 @compute(i32 %x, i32 (i32)* @plus)
+  %b = call i32 @compute(i32 %x, i32 (i32)* @minus)
+  %c = call i32 @compute(i32 %x, i32 (i32)* @plus)
+  %d = call i32 @flagged(i32 %x, i1 true)
+  %e = call i32 @flagged(i32 %x, i1 false)
+  %r1 = add i32 %a, %b
+  %r2 = add i32 %r1, %c
+  %r3 = add i32 %r2, %d
+  %r4 = add i32 %r3, %e
+  ret i32 %r4
+}
+
+; The originals are dead once all their calls go to clones.
+
+; CHECK-NOT: define internal i32 @compute(
+; CHECK-NOT: define internal i32 @flagged(
+
+define internal i32 @compute(i32 %x, i32 (i32)* %binop) {
+  %r = call i32 %binop(i32 %x)
+  ret i32 %r
+}
+
+define internal i32 @plus(i32 %x) {
+  %r = add i32 %x, 1
+  ret i32 %r
+}
+
+define internal i32 @minus(i32 %x) {
+  %r = sub i32 %x, 1
+  ret i32 %r
+}
+
+; The branch on the flag folds in each clone.
+
+define internal i32 @flagged(i32 %x, i1 %neg) {
+  br i1 %neg, label %t, label %f
+t:
+  %n = sub i32 0, %x
+  ret i32 %n
+f:
+  ret i32 %x
+}
+
+; CHECK-DAG: define internal i32 @compute.specialized.{{[12]}}(i32 %x, i32 (i32)* %binop) {
+; CHECK-DAG: call i32 @plus(i32 %x)
+; CHECK-DAG: call i32 @minus(i32 %x)
+; CHECK-DAG: define internal i32 @flagged.specialized.{{[12]}}(i32 %x, i1 %neg) {
+; CHECK-DAG: %n = sub i32 0, %x
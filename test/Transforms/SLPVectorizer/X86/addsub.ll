@@ -152,10 +152,12 @@ entry:
   ret void
 }
 
+; A bundle of two opcodes that do not alternate is vectorized with a shuffle
+; that takes each lane from the vector operation of its opcode.
 ; CHECK-LABEL: @No_faddfsub
-; CHECK-NOT: fadd <4 x float>
-; CHECK-NOT: fsub <4 x float>
-; CHECK-NOT: shufflevector
+; CHECK: fadd <4 x float>
+; CHECK: fsub <4 x float>
+; CHECK: shufflevector <4 x float> %{{.*}}, <4 x float> %{{.*}}, <4 x i32> <i32 0, i32 1, i32 2, i32 7>
 ; Function Attrs: nounwind uwtable
 define void @No_faddfsub() #0 {
 entry:
@@ -0,0 +1,103 @@
+; RUN: opt < %s -basicaa -slp-vectorizer -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -S | FileCheck %s
+; RUN: opt < %s -basicaa -slp-vectorizer -mtriple=x86_64-unknown-linux-gnu -mcpu=corei7 -slp-any-alternate-opcodes=false -S | FileCheck %s --check-prefix=STRICT
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+
+; Bundles of two binary operators are vectorized when the opcodes do not
+; alternate lane by lane.
+;  a[0] = b[0] << c[0];
+;  a[1] = b[1] << c[1];
+;  a[2] = b[2] + c[2];
+;  a[3] = b[3] << c[3];
+
+; CHECK-LABEL: @shl_add
+; CHECK: [[SHL:%.*]] = shl <4 x i32>
+; CHECK: [[ADD:%.*]] = add <4 x i32>
+; CHECK: shufflevector <4 x i32> [[SHL]], <4 x i32> [[ADD]], <4 x i32> <i32 0, i32 1, i32 6, i32 3>
+; STRICT-LABEL: @shl_add
+; STRICT-NOT: shufflevector
+define void @shl_add(i32* noalias %a, i32* noalias %b, i32* noalias %c) {
+entry:
+  %b0 = load i32, i32* %b, align 4
+  %c0 = load i32, i32* %c, align 4
+  %r0 = shl i32 %b0, %c0
+  store i32 %r0, i32* %a, align 4
+  %pb1 = getelementptr inbounds i32, i32* %b, i64 1
+  %pc1 = getelementptr inbounds i32, i32* %c, i64 1
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %b1 = load i32, i32* %pb1, align 4
+  %c1 = load i32, i32* %pc1, align 4
+  %r1 = shl i32 %b1, %c1
+  store i32 %r1, i32* %pa1, align 4
+  %pb2 = getelementptr inbounds i32, i32* %b, i64 2
+  %pc2 = getelementptr inbounds i32, i32* %c, i64 2
+  %pa2 = getelementptr inbounds i32, i32* %a, i64 2
+  %b2 = load i32, i32* %pb2, align 4
+  %c2 = load i32, i32* %pc2, align 4
+  %r2 = add i32 %b2, %c2
+  store i32 %r2, i32* %pa2, align 4
+  %pb3 = getelementptr inbounds i32, i32* %b, i64 3
+  %pc3 = getelementptr inbounds i32, i32* %c, i64 3
+  %pa3 = getelementptr inbounds i32, i32* %a, i64 3
+  %b3 = load i32, i32* %pb3, align 4
+  %c3 = load i32, i32* %pc3, align 4
+  %r3 = shl i32 %b3, %c3
+  store i32 %r3, i32* %pa3, align 4
+  ret void
+}
+
+; Division may trap in the lanes that do not need it, so it is never part of
+; an alternate bundle.
+; CHECK-LABEL: @sdiv_add
+; CHECK-NOT: shufflevector
+define void @sdiv_add(i32* noalias %a, i32* noalias %b, i32* noalias %c) {
+entry:
+  %b0 = load i32, i32* %b, align 4
+  %c0 = load i32, i32* %c, align 4
+  %r0 = sdiv i32 %b0, %c0
+  store i32 %r0, i32* %a, align 4
+  %pb1 = getelementptr inbounds i32, i32* %b, i64 1
+  %pc1 = getelementptr inbounds i32, i32* %c, i64 1
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %b1 = load i32, i32* %pb1, align 4
+  %c1 = load i32, i32* %pc1, align 4
+  %r1 = add i32 %b1, %c1
+  store i32 %r1, i32* %pa1, align 4
+  ret void
+}
+
+; Both operands of the adds are muls, so only the look-ahead sees that
+; swapping the operands of the second add pairs consecutive loads.
+;  a[0] = x[0] * y[0] + z[0] * w[0];
+;  a[1] = z[1] * w[1] + x[1] * y[1];
+; CHECK-LABEL: @look_ahead
+; CHECK: load <2 x i32>
+; CHECK: load <2 x i32>
+; CHECK: load <2 x i32>
+; CHECK: load <2 x i32>
+; CHECK-NOT: insertelement
+; CHECK: store <2 x i32>
+define void @look_ahead(i32* noalias %a, i32* noalias %x, i32* noalias %y, i32* noalias %z, i32* noalias %w) {
+entry:
+  %x0 = load i32, i32* %x, align 4
+  %y0 = load i32, i32* %y, align 4
+  %z0 = load i32, i32* %z, align 4
+  %w0 = load i32, i32* %w, align 4
+  %m0 = mul i32 %x0, %y0
+  %n0 = mul i32 %z0, %w0
+  %r0 = add i32 %m0, %n0
+  store i32 %r0, i32* %a, align 4
+  %px1 = getelementptr inbounds i32, i32* %x, i64 1
+  %py1 = getelementptr inbounds i32, i32* %y, i64 1
+  %pz1 = getelementptr inbounds i32, i32* %z, i64 1
+  %pw1 = getelementptr inbounds i32, i32* %w, i64 1
+  %pa1 = getelementptr inbounds i32, i32* %a, i64 1
+  %x1 = load i32, i32* %px1, align 4
+  %y1 = load i32, i32* %py1, align 4
+  %z1 = load i32, i32* %pz1, align 4
+  %w1 = load i32, i32* %pw1, align 4
+  %m1 = mul i32 %x1, %y1
+  %n1 = mul i32 %z1, %w1
+  %r1 = add i32 %n1, %m1
+  store i32 %r1, i32* %pa1, align 4
+  ret void
+}
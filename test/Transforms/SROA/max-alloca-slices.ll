@@ -0,0 +1,29 @@
+; RUN: opt < %s -sroa -S | FileCheck %s
+; RUN: opt < %s -sroa -sroa-max-alloca-slices=2 -S | FileCheck %s --check-prefix=LIMIT
+target datalayout = "e-p:64:64:64-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:32:64-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-n8:16:32:64"
+
+; Allocas with more slices than the limit are left alone rather than split.
+
+define i32 @test(i32 %x, i32 %y) {
+; CHECK-LABEL: @test(
+; CHECK-NOT: alloca
+; CHECK: %[[SUM:.*]] = add i32 %x, %y
+; CHECK: ret i32 %[[SUM]]
+;
+; LIMIT-LABEL: @test(
+; LIMIT: %a = alloca { i32, i32 }
+; LIMIT: store i32 %x
+; LIMIT: store i32 %y
+; LIMIT: load i32
+; LIMIT: load i32
+entry:
+  %a = alloca { i32, i32 }
+  %a0 = getelementptr { i32, i32 }, { i32, i32 }* %a, i64 0, i32 0
+  %a1 = getelementptr { i32, i32 }, { i32, i32 }* %a, i64 0, i32 1
+  store i32 %x, i32* %a0
+  store i32 %y, i32* %a1
+  %v0 = load i32, i32* %a0
+  %v1 = load i32, i32* %a1
+  %sum = add i32 %v0, %v1
+  ret i32 %sum
+}
@@ -0,0 +1,63 @@
+; RUN: opt < %s -sample-profile -sample-profile-file=%S/Inputs/context.prof -pass-remarks=sample-profile -S 2>&1 | FileCheck %s
+; RUN: opt < %s -passes=sample-profile -sample-profile-file=%S/Inputs/context.prof -pass-remarks=sample-profile -S 2>&1 | FileCheck %s
+
+; The profile has the samples of bar when it is called by foo and when it is
+; called by baz. The call from foo is hot and inlined, the one from baz is
+; not.
+;
+;  1 void bar();
+;  2
+;  3 void foo() {
+;  4   bar();
+;  5 }
+;  6
+;  7 void baz() {
+;  8   bar();
+;  9 }
+; 10
+; 11 void bar() {
+; 12   return;
+; 13 }
+
+; CHECK: remark: context.c:4:3: inlined hot callee 'bar' with 900 samples into 'foo'
+; CHECK-NOT: inlined hot callee 'bar' {{.*}} into 'baz'
+
+; CHECK-LABEL: define void @foo(
+; CHECK-NOT: call void @bar()
+; CHECK: ret void
+define void @foo() !dbg !4 {
+entry:
+  call void @bar(), !dbg !10
+  ret void, !dbg !11
+}
+
+; CHECK-LABEL: define void @baz(
+; CHECK: call void @bar()
+define void @baz() !dbg !7 {
+entry:
+  call void @bar(), !dbg !12
+  ret void, !dbg !13
+}
+
+; CHECK-LABEL: define void @bar(
+define void @bar() !dbg !8 {
+entry:
+  ret void, !dbg !14
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!9}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, isOptimized: false, emissionKind: NoDebug)
+!1 = !DIFile(filename: "context.c", directory: ".")
+!2 = !{}
+!3 = !DISubroutineType(types: !2)
+!4 = distinct !DISubprogram(name: "foo", line: 3, isLocal: false, isDefinition: true, unit: !0, scopeLine: 3, file: !1, scope: !1, type: !3)
+!7 = distinct !DISubprogram(name: "baz", line: 7, isLocal: false, isDefinition: true, unit: !0, scopeLine: 7, file: !1, scope: !1, type: !3)
+!8 = distinct !DISubprogram(name: "bar", line: 11, isLocal: false, isDefinition: true, unit: !0, scopeLine: 11, file: !1, scope: !1, type: !3)
+!9 = !{i32 1, !"Debug Info Version", i32 3}
+!10 = !DILocation(line: 4, column: 3, scope: !4)
+!11 = !DILocation(line: 5, column: 1, scope: !4)
+!12 = !DILocation(line: 8, column: 3, scope: !7)
+!13 = !DILocation(line: 9, column: 1, scope: !7)
+!14 = !DILocation(line: 12, column: 3, scope: !8)
@@ -0,0 +1,57 @@
+; RUN: not opt -disable-verify -verify-parallel -verifier-threads=3 -disable-output < %s 2>&1 | FileCheck %s
+
+; Function bodies verified on separate threads are reported in function order,
+; and what they record for the module level checks is not lost.
+
+declare i32 @llvm.ctpop.i32(i64)
+declare void @llvm.localescape(...)
+declare i8* @llvm.localrecover(i8*, i8*, i32)
+
+; CHECK: Only PHI nodes may reference their own value!
+; CHECK-NEXT: %a = add i32 %a, 1
+define void @a() {
+  %a = add i32 %a, 1
+  ret void
+}
+
+; CHECK-NEXT: Intrinsic has incorrect argument type!
+; CHECK-NEXT: i32 (i64)* @llvm.ctpop.i32
+define i32 @b(i64 %x) {
+  %r = call i32 @llvm.ctpop.i32(i64 %x)
+  ret i32 %r
+}
+
+define void @c() {
+  ret void
+}
+
+; CHECK-NEXT: Instruction does not dominate all uses!
+; CHECK-NEXT: %y = add i32 0, 1
+; CHECK-NEXT: %x = add i32 %y, 1
+define void @d() {
+  %x = add i32 %y, 1
+  %y = add i32 0, 1
+  ret void
+}
+
+; CHECK-NEXT: Intrinsic has incorrect argument type!
+; CHECK-NEXT: i32 (i64)* @llvm.ctpop.i32
+define i32 @e(i64 %x) {
+  %r = call i32 @llvm.ctpop.i32(i64 %x)
+  ret i32 %r
+}
+
+define void @f() {
+  %a = alloca i32
+  call void (...) @llvm.localescape(i32* %a)
+  ret void
+}
+
+define void @g(i8* %fp) {
+  %p = call i8* @llvm.localrecover(i8* bitcast (void ()* @f to i8*), i8* %fp, i32 1)
+  ret void
+}
+
+; CHECK-NEXT: all indices passed to llvm.localrecover must be less than the number of arguments passed ot llvm.localescape in the parent function
+; CHECK-NEXT: void ()* @f
+; CHECK-NEXT: LLVM ERROR: Broken module found, compilation aborted!
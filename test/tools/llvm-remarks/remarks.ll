@@ -0,0 +1,44 @@
+; All the remarks are streamed, whether -pass-remarks enables them or not.
+; RUN: opt < %s -inline -pass-remarks-output=%t.rmk -disable-output
+; RUN: llvm-remarks %t.rmk | FileCheck %s
+; RUN: llvm-remarks -pass=inline %t.rmk | FileCheck %s
+; RUN: llvm-remarks -pass=gvn %t.rmk | count 0
+; RUN: llvm-remarks -aggregate %t.rmk %t.rmk | FileCheck --check-prefix=AGG %s
+; RUN: not llvm-remarks %s 2>&1 | FileCheck --check-prefix=ERR %s
+
+; CHECK: t.c:5:10: analysis: inline: bar: foo should always be inlined (cost=always)
+; CHECK: t.c:5:10: passed: inline: bar: foo inlined into bar
+; CHECK: <unknown>:0:0: analysis: inline: bar: foz should never be inlined (cost=never)
+; CHECK: <unknown>:0:0: missed: inline: bar: foz will not be inlined into bar
+
+; AGG-DAG: 2 analysis: inline: foo should always be inlined (cost=always)
+; AGG-DAG: 2 passed: inline: foo inlined into bar
+; AGG-DAG: 2 analysis: inline: foz should never be inlined (cost=never)
+; AGG-DAG: 2 missed: inline: foz will not be inlined into bar
+
+; ERR: remarks.ll: not a remark stream
+
+define i32 @foo(i32 %x) alwaysinline {
+  ret i32 %x
+}
+
+define i32 @foz(i32 %x) noinline {
+  ret i32 %x
+}
+
+define i32 @bar(i32 %j) !dbg !4 {
+  %a = call i32 @foo(i32 %j), !dbg !7
+  %b = call i32 @foz(i32 %a)
+  ret i32 %b
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: LineTablesOnly)
+!1 = !DIFile(filename: "t.c", directory: "/tmp")
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "bar", scope: !1, file: !1, line: 4, type: !5, isDefinition: true, unit: !0)
+!5 = !DISubroutineType(types: !6)
+!6 = !{}
+!7 = !DILocation(line: 5, column: 10, scope: !4)
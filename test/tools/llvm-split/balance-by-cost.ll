@@ -0,0 +1,39 @@
+; RUN: llvm-split -balance-by-cost -o %t %s
+; RUN: llvm-dis -o - %t0 | FileCheck --check-prefix=CHECK0 %s
+; RUN: llvm-dis -o - %t1 | FileCheck --check-prefix=CHECK1 %s
+
+; The large function gets a partition of its own, all the small functions go
+; to the other one.
+
+; CHECK0: define i32 @big(i32 %x)
+; CHECK1: declare i32 @big(i32)
+define i32 @big(i32 %x) {
+  %a = add i32 %x, 1
+  %b = mul i32 %a, %x
+  %c = add i32 %b, %a
+  %d = mul i32 %c, %b
+  %e = add i32 %d, %c
+  %f = mul i32 %e, %d
+  %g = add i32 %f, %e
+  %h = mul i32 %g, %f
+  ret i32 %h
+}
+
+; CHECK0: declare i32 @small1(i32)
+; CHECK1: define i32 @small1(i32 %x)
+define i32 @small1(i32 %x) {
+  ret i32 %x
+}
+
+; CHECK0: declare i32 @small2(i32)
+; CHECK1: define i32 @small2(i32 %x)
+define i32 @small2(i32 %x) {
+  ret i32 %x
+}
+
+; CHECK0: declare i32 @small3(i32)
+; CHECK1: define i32 @small3(i32 %x)
+define i32 @small3(i32 %x) {
+  %r = call i32 @big(i32 %x)
+  ret i32 %r
+}
@@ -266,6 +266,20 @@ public:
                  std::string &OutputFilename, bool DeleteOutput = false,
                  bool Quiet = false, unsigned NumExtraArgs = 0,
                  const char * const *ExtraArgs = nullptr) const;
+
+  /// runPassesInParallel - Run each of the pass lists on Program, discarding
+  /// the output, and set the elements of Crashed to whether the passes of the
+  /// corresponding list crashed.  Up to getNumParallelJobs() instances of opt
+  /// run at once.  Return true if the runs could not be set up.
+  ///
+  bool
+  runPassesInParallel(Module *Program,
+                      const std::vector<std::vector<std::string>> &PassLists,
+                      std::vector<bool> &Crashed) const;
+
+  /// getNumParallelJobs - Return the number of instances of opt that may run
+  /// at once, as specified by -j.
+  unsigned getNumParallelJobs() const;
                  
   /// runManyPasses - Take the specified pass list and create different 
   /// combinations of passes to compile the program with. Compile the program with
@@ -69,6 +69,14 @@ namespace llvm {
     TestResult doTest(std::vector<std::string> &Removed,
                       std::vector<std::string> &Kept,
                       std::string &Error) override;
+
+    // The pass lists with an empty prefix are independent runs of opt on the
+    // same program, so they are tested in parallel.
+    unsigned getNumParallelTests() const override {
+      return BD.getNumParallelJobs();
+    }
+    unsigned doTestSuffixes(std::vector<std::vector<std::string>> &Kept,
+                            std::string &Error) override;
   };
 }
 
@@ -111,6 +119,27 @@ ReducePassList::doTest(std::vector<std::string> &Prefix,
   return NoFailure;
 }
 
+unsigned
+ReducePassList::doTestSuffixes(std::vector<std::vector<std::string>> &Kept,
+                               std::string &Error) {
+  if (Kept.size() <= 1)
+    return ListReducer<std::string>::doTestSuffixes(Kept, Error);
+
+  std::vector<bool> Crashed;
+  if (BD.runPassesInParallel(BD.getProgram(), Kept, Crashed)) {
+    Error = "could not run the passes";
+    return Kept.size();
+  }
+  for (unsigned i = 0, e = Kept.size(); i != e; ++i) {
+    outs() << "Checking to see if these passes crash: "
+           << getPassesString(Kept[i]) << ": "
+           << (Crashed[i] ? "Crashed!\n" : "Success!\n");
+    if (Crashed[i])
+      return i;
+  }
+  return Kept.size();
+}
+
 namespace {
   /// ReduceCrashingGlobalVariables - This works by removing the global
   /// variable's initializer and seeing if the program still crashes. If it
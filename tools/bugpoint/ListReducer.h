@@ -45,6 +45,26 @@ struct ListReducer {
                             std::vector<ElTy> &Kept,
                             std::string &Error) = 0;
 
+  // getNumParallelTests - Return the number of lists that doTestSuffixes
+  // should be given at once.  Subclasses that can test some lists
+  // concurrently override this.
+  //
+  virtual unsigned getNumParallelTests() const { return 1; }
+
+  // doTestSuffixes - Test each of the Kept lists with an empty prefix, and
+  // return the index of the first one that keeps the suffix, or Kept.size()
+  // if none does.  The lists after that one are not needed, so subclasses that
+  // test them concurrently may run them anyway.
+  //
+  virtual unsigned doTestSuffixes(std::vector<std::vector<ElTy>> &Kept,
+                                  std::string &Error) {
+    std::vector<ElTy> EmptyList;
+    for (unsigned i = 0, e = Kept.size(); i != e; ++i)
+      if (doTest(EmptyList, Kept[i], Error) == KeepSuffix || !Error.empty())
+        return i;
+    return Kept.size();
+  }
+
   // reduceList - This function attempts to reduce the length of the specified
   // list while still maintaining the "test" property.  This is the core of the
   // "work" that bugpoint does.
@@ -161,7 +181,6 @@ Backjump:
     //
     if (TheList.size() > 2) {
       bool Changed = true;
-      std::vector<ElTy> EmptyList;
       unsigned TrimIterations = 0;
       while (Changed) {  // Trimming loop.
         Changed = false;
@@ -174,23 +193,31 @@ Backjump:
         if (std::rand() % 100 < BackjumpProbability)
           goto Backjump;
         
-        for (unsigned i = 1; i < TheList.size()-1; ++i) { // Check interior elts
+        for (unsigned i = 1; i < TheList.size()-1; ) { // Check interior elts
           if (BugpointIsInterrupted) {
             errs() << "\n\n*** Reduction Interrupted, cleaning up...\n\n";
             return true;
           }
-          
-          std::vector<ElTy> TestList(TheList);
-          TestList.erase(TestList.begin()+i);
-
-          if (doTest(EmptyList, TestList, Error) == KeepSuffix) {
-            // We can trim down the list!
-            TheList.swap(TestList);
-            --i;  // Don't skip an element of the list
-            Changed = true;
-          }
+
+          // Try deleting each of the next few interior elements on its own.
+          unsigned NumTests = std::min<size_t>(getNumParallelTests(),
+                                               TheList.size() - 1 - i);
+          std::vector<std::vector<ElTy>> TestLists(NumTests, TheList);
+          for (unsigned j = 0; j != NumTests; ++j)
+            TestLists[j].erase(TestLists[j].begin() + i + j);
+
+          unsigned Kept = doTestSuffixes(TestLists, Error);
           if (!Error.empty())
             return true;
+          if (Kept != NumTests) {
+            // We can trim down the list!  Go on from the element after the
+            // deleted one, which is now at its index.
+            TheList.swap(TestLists[Kept]);
+            i += Kept;
+            Changed = true;
+          } else {
+            i += NumTests;
+          }
         }
         if (TrimIterations >= MaxTrimIterationsWithoutBackJump)
           break;
@@ -118,30 +118,41 @@ static cl::list<std::string> OptArgs("opt-args", cl::Positional,
                                      cl::desc("<opt arguments>..."),
                                      cl::ZeroOrMore, cl::PositionalEatsArgs);
 
-/// runPasses - Run the specified passes on Program, outputting a bitcode file
-/// and writing the filename into OutputFile if successful.  If the
-/// optimizations fail for some reason (optimizer crashes), return true,
-/// otherwise return false.  If DeleteOutput is set to true, the bitcode is
-/// deleted on success, and the filename string is undefined.  This prints to
-/// outs() a single line message indicating whether compilation was successful
-/// or failed.
+static cl::opt<unsigned> ParallelJobs(
+    "j", cl::init(1), cl::value_desc("N"),
+    cl::desc("Run up to N copies of opt at once to test the candidate pass "
+             "lists when reducing a crashing pass list"));
+
+namespace {
+/// OptRun - The command line and the files of one run of opt.
+struct OptRun {
+  std::string Prog;
+  std::string Tool;
+  std::string InputFilename;
+  std::string OutputFilename;
+  std::vector<std::string> PassArgs;
+  SmallVector<const char*, 8> Args;
+};
+}
+
+/// setUpOptRun - Write Program to a new input file and build the command line
+/// that runs the specified passes on it.  Return true if this fails.
 ///
-bool BugDriver::runPasses(Module *Program,
-                          const std::vector<std::string> &Passes,
-                          std::string &OutputFilename, bool DeleteOutput,
-                          bool Quiet, unsigned NumExtraArgs,
-                          const char * const *ExtraArgs) const {
+static bool setUpOptRun(const BugDriver &BD, Module *Program,
+                        const std::vector<std::string> &Passes,
+                        bool UseValgrind, unsigned NumExtraArgs,
+                        const char * const *ExtraArgs, OptRun &Run) {
   // setup the output file name
   outs().flush();
   SmallString<128> UniqueFilename;
   std::error_code EC = sys::fs::createUniqueFile(
       OutputPrefix + "-output-%%%%%%%.bc", UniqueFilename);
   if (EC) {
-    errs() << getToolName() << ": Error making unique filename: "
+    errs() << BD.getToolName() << ": Error making unique filename: "
            << EC.message() << "\n";
-    return 1;
+    return true;
   }
-  OutputFilename = UniqueFilename.str();
+  Run.OutputFilename = UniqueFilename.str();
 
   // set up the input file name
   SmallString<128> InputFilename;
@@ -149,10 +160,11 @@ bool BugDriver::runPasses(Module *Program,
   EC = sys::fs::createUniqueFile(OutputPrefix + "-input-%%%%%%%.bc", InputFD,
                                  InputFilename);
   if (EC) {
-    errs() << getToolName() << ": Error making unique filename: "
+    errs() << BD.getToolName() << ": Error making unique filename: "
            << EC.message() << "\n";
-    return 1;
+    return true;
   }
+  Run.InputFilename = InputFilename.str();
 
   tool_output_file InFile(InputFilename, InputFD);
 
@@ -161,10 +173,11 @@ bool BugDriver::runPasses(Module *Program,
   if (InFile.os().has_error()) {
     errs() << "Error writing bitcode file: " << InputFilename << "\n";
     InFile.os().clear_error();
-    return 1;
+    return true;
   }
 
-  std::string tool = OptCmd;
+  std::string &tool = Run.Tool;
+  tool = OptCmd;
   if (OptCmd.empty()) {
     if (ErrorOr<std::string> Path = sys::findProgramByName("opt"))
       tool = *Path;
@@ -173,10 +186,10 @@ bool BugDriver::runPasses(Module *Program,
   }
   if (tool.empty()) {
     errs() << "Cannot find `opt' in PATH!\n";
-    return 1;
+    return true;
   }
 
-  std::string Prog;
+  std::string &Prog = Run.Prog;
   if (UseValgrind) {
     if (ErrorOr<std::string> Path = sys::findProgramByName("valgrind"))
       Prog = *Path;
@@ -186,14 +199,14 @@ bool BugDriver::runPasses(Module *Program,
     Prog = tool;
   if (Prog.empty()) {
     errs() << "Cannot find `valgrind' in PATH!\n";
-    return 1;
+    return true;
   }
 
   // Ok, everything that could go wrong before running opt is done.
   InFile.keep();
 
   // setup the child process' arguments
-  SmallVector<const char*, 8> Args;
+  SmallVectorImpl<const char*> &Args = Run.Args;
   if (UseValgrind) {
     Args.push_back("valgrind");
     Args.push_back("--error-exitcode=1");
@@ -203,10 +216,10 @@ bool BugDriver::runPasses(Module *Program,
     Args.push_back(tool.c_str());
 
   Args.push_back("-o");
-  Args.push_back(OutputFilename.c_str());
+  Args.push_back(Run.OutputFilename.c_str());
   for (unsigned i = 0, e = OptArgs.size(); i != e; ++i)
     Args.push_back(OptArgs[i].c_str());
-  std::vector<std::string> pass_args;
+  std::vector<std::string> &pass_args = Run.PassArgs;
   for (unsigned i = 0, e = PluginLoader::getNumPlugins(); i != e; ++i) {
     pass_args.push_back( std::string("-load"));
     pass_args.push_back( PluginLoader::getPlugin(i));
@@ -217,7 +230,7 @@ bool BugDriver::runPasses(Module *Program,
   for (std::vector<std::string>::const_iterator I = pass_args.begin(),
        E = pass_args.end(); I != E; ++I )
     Args.push_back(I->c_str());
-  Args.push_back(InputFilename.c_str());
+  Args.push_back(Run.InputFilename.c_str());
   for (unsigned i = 0; i < NumExtraArgs; ++i)
     Args.push_back(*ExtraArgs);
   Args.push_back(nullptr);
@@ -227,13 +240,34 @@ bool BugDriver::runPasses(Module *Program,
           errs() << " " << Args[i];
         errs() << "\n";
         );
+  return false;
+}
+
+/// runPasses - Run the specified passes on Program, outputting a bitcode file
+/// and writing the filename into OutputFile if successful.  If the
+/// optimizations fail for some reason (optimizer crashes), return true,
+/// otherwise return false.  If DeleteOutput is set to true, the bitcode is
+/// deleted on success, and the filename string is undefined.  This prints to
+/// outs() a single line message indicating whether compilation was successful
+/// or failed.
+///
+bool BugDriver::runPasses(Module *Program,
+                          const std::vector<std::string> &Passes,
+                          std::string &OutputFilename, bool DeleteOutput,
+                          bool Quiet, unsigned NumExtraArgs,
+                          const char * const *ExtraArgs) const {
+  OptRun Run;
+  if (setUpOptRun(*this, Program, Passes, UseValgrind, NumExtraArgs,
+                  ExtraArgs, Run))
+    return 1;
+  OutputFilename = Run.OutputFilename;
 
   // Redirect stdout and stderr to nowhere if SilencePasses is given
   StringRef Nowhere;
   const StringRef *Redirects[3] = {nullptr, &Nowhere, &Nowhere};
 
   std::string ErrMsg;
-  int result = sys::ExecuteAndWait(Prog, Args.data(), nullptr,
+  int result = sys::ExecuteAndWait(Run.Prog, Run.Args.data(), nullptr,
                                    (SilencePasses ? Redirects : nullptr),
                                    Timeout, MemoryLimit, &ErrMsg);
 
@@ -243,7 +277,7 @@ bool BugDriver::runPasses(Module *Program,
     sys::fs::remove(OutputFilename);
 
   // Remove the temporary input file as well
-  sys::fs::remove(InputFilename.c_str());
+  sys::fs::remove(Run.InputFilename);
 
   if (!Quiet) {
     if (result == 0)
@@ -264,6 +298,71 @@ bool BugDriver::runPasses(Module *Program,
   return result != 0;
 }
 
+unsigned BugDriver::getNumParallelJobs() const {
+  return std::max(1U, unsigned(ParallelJobs));
+}
+
+/// runPassesInParallel - Run each of the specified pass lists on Program, in
+/// up to getNumParallelJobs() copies of opt at once, and set the elements of
+/// Crashed to whether the corresponding passes crashed.  The output bitcode
+/// is discarded.  Return true if the runs could not be set up.
+///
+bool BugDriver::runPassesInParallel(
+    Module *Program, const std::vector<std::vector<std::string>> &PassLists,
+    std::vector<bool> &Crashed) const {
+  std::vector<OptRun> Runs(PassLists.size());
+  for (unsigned i = 0, e = PassLists.size(); i != e; ++i)
+    if (setUpOptRun(*this, Program, PassLists[i], UseValgrind, 0, nullptr,
+                    Runs[i])) {
+      for (unsigned j = 0; j != i; ++j)
+        sys::fs::remove(Runs[j].InputFilename);
+      return true;
+    }
+
+  // The output of concurrent runs would be interleaved, so it is discarded
+  // unless only one job runs at a time.
+  unsigned MaxJobs = getNumParallelJobs();
+  StringRef Nowhere;
+  const StringRef *Silenced[3] = {nullptr, &Nowhere, &Nowhere};
+  const StringRef *AllNowhere[3] = {&Nowhere, &Nowhere, &Nowhere};
+  const StringRef **Redirects =
+      MaxJobs > 1 ? AllNowhere : (SilencePasses ? Silenced : nullptr);
+
+  // Launch the runs in order, and wait for the oldest one whenever all the
+  // jobs are busy.  A run that could not be executed counts as a crash, like
+  // it does in runPasses.
+  std::vector<sys::ProcessInfo> PIs(Runs.size());
+  std::vector<int> Results(Runs.size(), -1);
+  std::vector<std::string> ErrMsgs(Runs.size());
+  unsigned NumWaited = 0;
+  auto WaitForOldest = [&]() {
+    unsigned i = NumWaited++;
+    if (PIs[i].Pid == 0)
+      return;
+    Results[i] = (Timeout ? sys::Wait(PIs[i], Timeout, false, &ErrMsgs[i])
+                          : sys::Wait(PIs[i], 0, true, &ErrMsgs[i]))
+                     .ReturnCode;
+  };
+  for (unsigned i = 0, e = Runs.size(); i != e; ++i) {
+    if (i - NumWaited == MaxJobs)
+      WaitForOldest();
+    PIs[i] = sys::ExecuteNoWait(Runs[i].Prog, Runs[i].Args.data(), nullptr,
+                                Redirects, MemoryLimit, &ErrMsgs[i]);
+  }
+  while (NumWaited != Runs.size())
+    WaitForOldest();
+
+  Crashed.resize(Runs.size());
+  for (unsigned i = 0, e = Runs.size(); i != e; ++i) {
+    Crashed[i] = Results[i] != 0;
+    DEBUG(if (Results[i] < 0)
+            dbgs() << "Run " << i << " failed: " << ErrMsgs[i] << "\n");
+    sys::fs::remove(Runs[i].OutputFilename);
+    sys::fs::remove(Runs[i].InputFilename);
+  }
+  return false;
+}
+
 
 std::unique_ptr<Module>
 BugDriver::runPassesOn(Module *M, const std::vector<std::string> &Passes,
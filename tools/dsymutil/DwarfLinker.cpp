@@ -36,6 +36,7 @@
 #include "llvm/Support/Dwarf.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 #include <string>
@@ -1422,6 +1423,12 @@ private:
   ErrorOr<const object::ObjectFile &> loadObject(BinaryHolder &BinaryHolder,
                                                  DebugMapObject &Obj,
                                                  const DebugMap &Map);
+
+  /// \brief Link the debug info of \p Obj, which has been loaded as \p
+  /// ObjFile. \p DwarfContext holds the already extracted debug info of
+  /// \p ObjFile if it was loaded ahead of time, and is null otherwise.
+  void linkObject(DebugMapObject &Obj, const object::ObjectFile &ObjFile,
+                  DWARFContextInMemory *DwarfContext, DebugMap &ModuleMap);
   /// @}
 
   std::string OutputFilename;
@@ -3417,6 +3424,99 @@ void DwarfLinker::DIECloner::cloneAllCompileUnits(
   }
 }
 
+void DwarfLinker::linkObject(DebugMapObject &Obj,
+                             const object::ObjectFile &ObjFile,
+                             DWARFContextInMemory *DwarfContext,
+                             DebugMap &ModuleMap) {
+  // Look for relocations that correspond to debug map entries.
+  RelocationManager RelocMgr(*this);
+  if (!RelocMgr.findValidRelocsInDebugInfo(ObjFile, Obj)) {
+    if (Options.Verbose)
+      outs() << "No valid relocations found. Skipping.\n";
+    return;
+  }
+
+  // Setup access to the debug info.
+  std::unique_ptr<DWARFContextInMemory> OwnedDwarfContext;
+  if (!DwarfContext) {
+    OwnedDwarfContext = llvm::make_unique<DWARFContextInMemory>(ObjFile);
+    DwarfContext = OwnedDwarfContext.get();
+  }
+  startDebugObject(*DwarfContext, Obj);
+
+  // In a first phase, just read in the debug info and load all clang modules.
+  for (const auto &CU : DwarfContext->compile_units()) {
+    auto *CUDie = CU->getUnitDIE(false);
+    if (Options.Verbose) {
+      outs() << "Input compilation unit:";
+      CUDie->dump(outs(), CU.get(), 0);
+    }
+
+    if (!registerModuleReference(*CUDie, *CU, ModuleMap))
+      Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
+  }
+
+  // Now build the DIE parent links that we will use during the next phase.
+  for (auto &CurrentUnit : Units)
+    analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0, CurrentUnit,
+                       &ODRContexts.getRoot(), StringPool, ODRContexts);
+
+  // Then mark all the DIEs that need to be present in the linked
+  // output and collect some information about them. Note that this
+  // loop can not be merged with the previous one becaue cross-cu
+  // references require the ParentIdx to be setup for every CU in
+  // the object file before calling this.
+  for (auto &CurrentUnit : Units)
+    lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(), Obj,
+                      CurrentUnit, 0);
+
+  // The calls to applyValidRelocs inside cloneDIE will walk the
+  // reloc array again (in the same way findValidRelocsInDebugInfo()
+  // did). We need to reset the NextValidReloc index to the beginning.
+  RelocMgr.resetValidRelocs();
+  if (RelocMgr.hasValidRelocs())
+    DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
+        .cloneAllCompileUnits(*DwarfContext);
+  if (!Options.NoOutput && !Units.empty())
+    patchFrameInfoForObject(Obj, *DwarfContext,
+                            Units[0].getOrigUnit().getAddressByteSize());
+
+  // Clean-up before starting working on the next object.
+  endDebugObject();
+}
+
+/// An object file of the debug map that is loaded, and whose debug info is
+/// extracted, on a worker thread ahead of being linked.
+struct PrefetchedObject {
+  BinaryHolder Holder;
+  std::error_code EC;
+  const object::ObjectFile *ObjFile = nullptr;
+  std::unique_ptr<DWARFContextInMemory> DwarfContext;
+  std::shared_future<void> Done;
+
+  PrefetchedObject() : Holder(/*Verbose=*/false) {}
+};
+
+/// Load \p Obj into \p Slot and parse all the DIEs of its compile units.
+/// None of this touches the linker state, so it can run concurrently with
+/// the linking of the previous objects.
+static void prefetchObject(PrefetchedObject &Slot, const DebugMapObject &Obj,
+                           const Triple &TheTriple) {
+  Slot.DwarfContext.reset();
+  Slot.ObjFile = nullptr;
+  auto ErrOrObjs =
+      Slot.Holder.GetObjectFiles(Obj.getObjectFilename(), Obj.getTimestamp());
+  if ((Slot.EC = ErrOrObjs.getError()))
+    return;
+  auto ErrOrObj = Slot.Holder.Get(TheTriple);
+  if ((Slot.EC = ErrOrObj.getError()))
+    return;
+  Slot.ObjFile = &*ErrOrObj;
+  Slot.DwarfContext = llvm::make_unique<DWARFContextInMemory>(*Slot.ObjFile);
+  for (const auto &CU : Slot.DwarfContext->compile_units())
+    CU->getUnitDIE(false);
+}
+
 bool DwarfLinker::link(const DebugMap &Map) {
 
   if (!createStreamer(Map.getTriple(), OutputFilename))
@@ -3428,66 +3528,57 @@ bool DwarfLinker::link(const DebugMap &Map) {
   UnitID = 0;
   DebugMap ModuleMap(Map.getTriple(), Map.getBinaryPath());
 
-  for (const auto &Obj : Map.objects()) {
-    CurrentDebugObject = Obj.get();
+  std::vector<DebugMapObject *> Objects;
+  for (const auto &Obj : Map.objects())
+    Objects.push_back(Obj.get());
+
+  // The linking itself has to process the objects in order: string offsets
+  // and ODR uniquing depend on what the previous objects contributed. Loading
+  // the objects and parsing their DIEs does not, so with more than one thread
+  // the next objects are prefetched while the current one is linked. In
+  // verbose mode we stay serial to keep the log in order.
+  unsigned NumPrefetched =
+      (Options.Threads > 1 && !Options.Verbose) ? Options.Threads - 1 : 0;
+  std::vector<PrefetchedObject> Slots(NumPrefetched);
+  std::unique_ptr<ThreadPool> Pool;
+  auto Prefetch = [&](unsigned I) {
+    PrefetchedObject &Slot = Slots[I % NumPrefetched];
+    const DebugMapObject &Obj = *Objects[I];
+    const Triple &TheTriple = Map.getTriple();
+    Slot.Done = Pool->async(
+        [&Slot, &Obj, &TheTriple]() { prefetchObject(Slot, Obj, TheTriple); });
+  };
+  if (NumPrefetched) {
+    Pool = llvm::make_unique<ThreadPool>(NumPrefetched);
+    for (unsigned I = 0, E = std::min<size_t>(NumPrefetched, Objects.size());
+         I != E; ++I)
+      Prefetch(I);
+  }
+
+  for (unsigned I = 0, E = Objects.size(); I != E; ++I) {
+    DebugMapObject &Obj = *Objects[I];
+    CurrentDebugObject = &Obj;
 
     if (Options.Verbose)
-      outs() << "DEBUG MAP OBJECT: " << Obj->getObjectFilename() << "\n";
-    auto ErrOrObj = loadObject(BinHolder, *Obj, Map);
-    if (!ErrOrObj)
-      continue;
+      outs() << "DEBUG MAP OBJECT: " << Obj.getObjectFilename() << "\n";
 
-    // Look for relocations that correspond to debug map entries.
-    RelocationManager RelocMgr(*this);
-    if (!RelocMgr.findValidRelocsInDebugInfo(*ErrOrObj, *Obj)) {
-      if (Options.Verbose)
-        outs() << "No valid relocations found. Skipping.\n";
+    if (!NumPrefetched) {
+      auto ErrOrObj = loadObject(BinHolder, Obj, Map);
+      if (ErrOrObj)
+        linkObject(Obj, *ErrOrObj, nullptr, ModuleMap);
       continue;
     }
 
-    // Setup access to the debug info.
-    DWARFContextInMemory DwarfContext(*ErrOrObj);
-    startDebugObject(DwarfContext, *Obj);
-
-    // In a first phase, just read in the debug info and load all clang modules.
-    for (const auto &CU : DwarfContext.compile_units()) {
-      auto *CUDie = CU->getUnitDIE(false);
-      if (Options.Verbose) {
-        outs() << "Input compilation unit:";
-        CUDie->dump(outs(), CU.get(), 0);
-      }
-
-      if (!registerModuleReference(*CUDie, *CU, ModuleMap))
-        Units.emplace_back(*CU, UnitID++, !Options.NoODR, "");
-    }
+    PrefetchedObject &Slot = Slots[I % NumPrefetched];
+    Slot.Done.wait();
+    if (Slot.EC)
+      reportWarning(Twine(Obj.getObjectFilename()) + ": " + Slot.EC.message());
+    else
+      linkObject(Obj, *Slot.ObjFile, Slot.DwarfContext.get(), ModuleMap);
 
-    // Now build the DIE parent links that we will use during the next phase.
-    for (auto &CurrentUnit : Units)
-      analyzeContextInfo(CurrentUnit.getOrigUnit().getUnitDIE(), 0, CurrentUnit,
-                         &ODRContexts.getRoot(), StringPool, ODRContexts);
-
-    // Then mark all the DIEs that need to be present in the linked
-    // output and collect some information about them. Note that this
-    // loop can not be merged with the previous one becaue cross-cu
-    // references require the ParentIdx to be setup for every CU in
-    // the object file before calling this.
-    for (auto &CurrentUnit : Units)
-      lookForDIEsToKeep(RelocMgr, *CurrentUnit.getOrigUnit().getUnitDIE(), *Obj,
-                        CurrentUnit, 0);
-
-    // The calls to applyValidRelocs inside cloneDIE will walk the
-    // reloc array again (in the same way findValidRelocsInDebugInfo()
-    // did). We need to reset the NextValidReloc index to the beginning.
-    RelocMgr.resetValidRelocs();
-    if (RelocMgr.hasValidRelocs())
-      DIECloner(*this, RelocMgr, DIEAlloc, Units, Options)
-          .cloneAllCompileUnits(DwarfContext);
-    if (!Options.NoOutput && !Units.empty())
-      patchFrameInfoForObject(*Obj, DwarfContext,
-                              Units[0].getOrigUnit().getAddressByteSize());
-
-    // Clean-up before starting working on the next object.
-    endDebugObject();
+    // The slot is free again, use it to load the next object in line.
+    if (I + NumPrefetched < E)
+      Prefetch(I + NumPrefetched);
   }
 
   // Emit everything that's global.
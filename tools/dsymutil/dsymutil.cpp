@@ -82,6 +82,16 @@ static opt<bool>
           desc("Do not use ODR (One Definition Rule) for type uniquing."),
           init(false), cat(DsymCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads",
+    desc("Specifies the maximum number (n) of simultaneous threads to use\n"
+         "when linking. Object files are loaded and parsed on the n-1 extra\n"
+         "threads while the DWARF is being linked. The output does not\n"
+         "depend on n. Defaults to 1."),
+    init(1), cat(DsymCategory));
+static alias NumThreadsA("j", desc("Alias for --num-threads"),
+                         aliasopt(NumThreads));
+
 static opt<bool> DumpDebugMap(
     "dump-debug-map",
     desc("Parse and dump the debug map to standard output. Not DWARF link "
@@ -264,6 +274,7 @@ int main(int argc, char **argv) {
   Options.Verbose = Verbose;
   Options.NoOutput = NoOutput;
   Options.NoODR = NoODR;
+  Options.Threads = NumThreads;
   Options.PrependPath = OsoPrependPath;
 
   llvm::InitializeAllTargetInfos();
@@ -1204,6 +1204,22 @@ static void thinLTOBackends(raw_fd_ostream *ApiFile,
                                 ? options::Parallelism
                                 : thread::hardware_concurrency();
 
+  // The backends to run, with their estimated cost.
+  struct Backend {
+    claimed_file *F;
+    const void *View;
+    raw_fd_ostream *OS;
+    unsigned TaskID;
+    uint64_t Cost;
+  };
+  std::vector<Backend> Backends;
+  Backends.reserve(Modules.size());
+
+  StringMap<GVSummaryMapTy> ModuleToDefinedGVSummaries;
+  CombinedIndex.collectDefinedGVSummariesPerModule(ModuleToDefinedGVSummaries);
+
+  auto Trace = ThinLTOBackendTrace::createIfRequested();
+
   // Create ThreadPool in nested scope so that threads will be joined
   // on destruction.
   {
@@ -1236,18 +1252,45 @@ static void thinLTOBackends(raw_fd_ostream *ApiFile,
       std::unique_ptr<raw_fd_ostream> OS =
           llvm::make_unique<raw_fd_ostream>(FD, true);
 
-      // Enqueue the task
-      ThinLTOThreadPool.async(thinLTOBackendTask, std::ref(F), View, F.name,
-                              ApiFile, std::ref(CombinedIndex), OS.get(),
-                              TaskCount, std::ref(ModuleMap));
+      // Estimate the cost of the backend from the functions it defines and
+      // imports.
+      const GVSummaryMapTy &DefinedGVSummaries =
+          ModuleToDefinedGVSummaries[F.name];
+      FunctionImporter::ImportMapTy ImportList;
+      ComputeCrossModuleImportForModule(F.name, DefinedGVSummaries,
+                                        CombinedIndex, ImportList);
+      Backends.push_back({&F, View, OS.get(), TaskCount,
+                          estimateThinLTOBackendCost(
+                              CombinedIndex, DefinedGVSummaries, ImportList)});
 
       // Record the information needed by the task or during its cleanup
       // to a ThinLTOTaskInfo instance. For information needed by the task
       // the unique_ptr ownership is transferred to the ThinLTOTaskInfo.
       Tasks.emplace_back(std::move(OS), NewFilename.c_str(), TempOutFile);
     }
+
+    // Enqueue the most expensive backends first, so that a large module does
+    // not run alone at the end. The task IDs, and so the output files, still
+    // follow the order of the inputs.
+    std::stable_sort(Backends.begin(), Backends.end(),
+                     [](const Backend &L, const Backend &R) {
+                       return L.Cost > R.Cost;
+                     });
+    for (Backend &B : Backends)
+      ThinLTOThreadPool.async([&, B]() {
+        auto Start = std::chrono::steady_clock::now();
+        thinLTOBackendTask(*B.F, B.View, B.F->name, ApiFile, CombinedIndex,
+                           B.OS, B.TaskID, ModuleMap);
+        if (Trace)
+          Trace->addBackend(B.F->name, B.Cost, Start);
+      });
   }
 
+  if (Trace)
+    if (std::error_code EC = Trace->write())
+      message(LDPL_ERROR, "Unable to write the ThinLTO backend trace: %s",
+              EC.message().c_str());
+
   for (auto &Task : Tasks)
     Task.cleanup();
 }
@@ -1297,7 +1340,15 @@ static ld_plugin_status thinLTOLink(raw_fd_ostream *ApiFile) {
   ModuleSummaryIndex CombinedIndex;
   uint64_t NextModuleId = 0;
   for (claimed_file &F : Modules) {
-    if (!HandleToInputFile.count(F.leader_handle))
+    // Under thinlto-index-only the bitcode is never needed again once its
+    // summary has been merged into the combined index, so only keep the input
+    // file (and the view of it) alive for the current iteration. This keeps
+    // the memory of the thin link proportional to the size of the summaries
+    // rather than to the size of all the bitcode inputs.
+    std::unique_ptr<PluginInputFile> IndexOnlyInputFile;
+    if (options::thinlto_index_only)
+      IndexOnlyInputFile = llvm::make_unique<PluginInputFile>(F.handle);
+    else if (!HandleToInputFile.count(F.leader_handle))
       HandleToInputFile.insert(std::make_pair(
           F.leader_handle, llvm::make_unique<PluginInputFile>(F.handle)));
     // Pass this into getModuleSummaryIndexForFile
@@ -1305,12 +1356,14 @@ static ld_plugin_status thinLTOLink(raw_fd_ostream *ApiFile) {
     if (!View)
       continue;
 
-    MemoryBufferRef ModuleBuffer(StringRef((const char *)View, F.filesize),
-                                 F.name);
-    assert(ModuleMap.find(ModuleBuffer.getBufferIdentifier()) ==
-               ModuleMap.end() &&
-           "Expect unique Buffer Identifier");
-    ModuleMap[ModuleBuffer.getBufferIdentifier()] = ModuleBuffer;
+    if (!options::thinlto_index_only) {
+      MemoryBufferRef ModuleBuffer(StringRef((const char *)View, F.filesize),
+                                   F.name);
+      assert(ModuleMap.find(ModuleBuffer.getBufferIdentifier()) ==
+                 ModuleMap.end() &&
+             "Expect unique Buffer Identifier");
+      ModuleMap[ModuleBuffer.getBufferIdentifier()] = ModuleBuffer;
+    }
 
     std::unique_ptr<ModuleSummaryIndex> Index = getModuleSummaryIndexForFile(F);
 
@@ -1331,15 +1384,6 @@ static ld_plugin_status thinLTOLink(raw_fd_ostream *ApiFile) {
     CombinedIndex.collectDefinedGVSummariesPerModule(
         ModuleToDefinedGVSummaries);
 
-    // FIXME: We want to do this for the case where the threads are launched
-    // from gold as well, in which case this will be moved out of the
-    // thinlto_index_only handling, and the function importer will be invoked
-    // directly using the Lists.
-    StringMap<FunctionImporter::ImportMapTy> ImportLists(NextModuleId);
-    StringMap<FunctionImporter::ExportSetTy> ExportLists(NextModuleId);
-    ComputeCrossModuleImport(CombinedIndex, ModuleToDefinedGVSummaries,
-                             ImportLists, ExportLists);
-
     // If the thinlto-prefix-replace option was specified, parse it and
     // extract the old and new prefixes.
     std::string OldPrefix, NewPrefix;
@@ -1347,10 +1391,22 @@ static ld_plugin_status thinLTOLink(raw_fd_ostream *ApiFile) {
 
     // For each input bitcode file, generate an individual index that
     // contains summaries only for its own global values, and for any that
-    // should be imported.
+    // should be imported. The import list of a module only depends on the
+    // combined index, so the modules are processed one at a time: each index
+    // (and imports file) is written out as soon as the import list of its
+    // module is computed, and the import list is released right after.
     for (claimed_file &F : Modules) {
       std::error_code EC;
 
+      // FIXME: We want to do this for the case where the threads are launched
+      // from gold as well, in which case this will be moved out of the
+      // thinlto_index_only handling, and the function importer will be invoked
+      // directly using the Lists.
+      StringMap<FunctionImporter::ImportMapTy> ImportLists(1);
+      ComputeCrossModuleImportForModule(
+          F.name, ModuleToDefinedGVSummaries.lookup(F.name), CombinedIndex,
+          ImportLists[F.name]);
+
       std::string NewModulePath =
           getThinLTOOutputFile(F.name, OldPrefix, NewPrefix);
       raw_fd_ostream OS((Twine(NewModulePath) + ".thinlto.bc").str(), EC,
@@ -15,6 +15,7 @@
 
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/Analysis/TargetLibraryInfo.h"
 #include "llvm/CodeGen/CommandFlags.h"
@@ -23,6 +24,7 @@
 #include "llvm/CodeGen/MIRParser/MIRParser.h"
 #include "llvm/CodeGen/MachineFunctionPass.h"
 #include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/ParallelCG.h"
 #include "llvm/CodeGen/TargetPassConfig.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/DiagnosticInfo.h"
@@ -51,6 +53,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetSubtargetInfo.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include <list>
 #include <memory>
 using namespace llvm;
 
@@ -69,6 +72,17 @@ TimeCompilations("time-compilations", cl::Hidden, cl::init(1u),
                  cl::value_desc("N"),
                  cl::desc("Repeat compilation N times for timing"));
 
+static cl::opt<unsigned>
+    Parallelism("j", cl::Prefix, cl::init(1),
+                cl::desc("Number of codegen threads. If greater than 1, the "
+                         "module is split into that many partitions which are "
+                         "written to <output>.0, <output>.1, ..."));
+
+static cl::opt<std::string> CodeGenCacheDir(
+    "codegen-cache-dir", cl::init(""), cl::value_desc("directory"),
+    cl::desc("With -j, reuse the output of the partitions that are cached in "
+             "this directory"));
+
 static cl::opt<bool>
 NoIntegratedAssembler("no-integrated-as", cl::Hidden,
                       cl::desc("Disable integrated assembler"));
@@ -119,6 +133,9 @@ static cl::opt<bool> ExitOnError(
     cl::init(false), cl::Hidden);
 
 static int compileModule(char **, LLVMContext &);
+static int compileModuleInParallel(char **, std::unique_ptr<Module>,
+                                   const std::function<
+                                       std::unique_ptr<TargetMachine>()> &);
 
 static std::unique_ptr<tool_output_file>
 GetOutputStream(const char *TargetName, Triple::OSType OS,
@@ -335,10 +352,36 @@ static int compileModule(char **argv, LLVMContext &Context) {
   if (FloatABIForCalls != FloatABI::Default)
     Options.FloatABIType = FloatABIForCalls;
 
+  // Add the target data from the target machine, if it exists, or the module.
+  M->setDataLayout(Target->createDataLayout());
+
+  // Override function attributes based on CPUStr, FeaturesStr, and command line
+  // flags.
+  setFunctionAttributes(CPUStr, FeaturesStr, *M);
+
+  if (Parallelism > 1) {
+    if (MIR || !RunPass.empty() || !StartAfter.empty() || !StopAfter.empty() ||
+        CompileTwice || DisableSimplifyLibCalls) {
+      errs() << argv[0] << ": -j is not supported together with .mir inputs, "
+                           "-run-pass, -start-after, -stop-after, "
+                           "-compile-twice or -disable-simplify-libcalls.\n";
+      return 1;
+    }
+    // Each partition gets a target machine of its own.
+    return compileModuleInParallel(argv, std::move(M), [&]() {
+      return std::unique_ptr<TargetMachine>(TheTarget->createTargetMachine(
+          TheTriple.getTriple(), CPUStr, FeaturesStr, Options, getRelocModel(),
+          CMModel, OLvl));
+    });
+  }
+
   // Figure out where we are going to send the output.
   std::unique_ptr<tool_output_file> Out =
       GetOutputStream(TheTarget->getName(), TheTriple.getOS(), argv[0]);
   if (!Out) return 1;
+  // Objects can be large, so write them out while they are emitted.
+  if (FileType == TargetMachine::CGFT_ObjectFile)
+    Out->os().enable_async_writes();
 
   // Build up all of the passes that we want to do to the module.
   legacy::PassManager PM;
@@ -351,13 +394,6 @@ static int compileModule(char **argv, LLVMContext &Context) {
     TLII.disableAllFunctions();
   PM.add(new TargetLibraryInfoWrapperPass(TLII));
 
-  // Add the target data from the target machine, if it exists, or the module.
-  M->setDataLayout(Target->createDataLayout());
-
-  // Override function attributes based on CPUStr, FeaturesStr, and command line
-  // flags.
-  setFunctionAttributes(CPUStr, FeaturesStr, *M);
-
   if (RelaxAll.getNumOccurrences() > 0 &&
       FileType != TargetMachine::CGFT_ObjectFile)
     errs() << argv[0]
@@ -496,3 +532,46 @@ static int compileModule(char **argv, LLVMContext &Context) {
 
   return 0;
 }
+
+/// Split \p M into Parallelism partitions and code generate them on as many
+/// threads, writing partition I to <output>.I. The partitioning only depends
+/// on the module, so the output does not depend on thread scheduling.
+static int compileModuleInParallel(
+    char **argv, std::unique_ptr<Module> M,
+    const std::function<std::unique_ptr<TargetMachine>()> &TMFactory) {
+  if (OutputFilename.empty() || OutputFilename == "-") {
+    errs() << argv[0] << ": -j requires an output filename.\n";
+    return 1;
+  }
+
+  std::list<tool_output_file> OSs;
+  std::vector<raw_pwrite_stream *> OSPtrs;
+  for (unsigned I = 0; I != Parallelism; ++I) {
+    std::error_code EC;
+    OSs.emplace_back(OutputFilename + "." + utostr(I), EC, sys::fs::F_None);
+    if (EC) {
+      errs() << argv[0] << ": " << EC.message() << '\n';
+      return 1;
+    }
+    OSPtrs.push_back(&OSs.back().os());
+  }
+
+  // Before executing passes, print the final values of the LLVM options.
+  cl::PrintOptionValues();
+
+  LLVMContext &Context = M->getContext();
+  splitCodeGen(std::move(M), OSPtrs, {}, TMFactory, FileType,
+               /*PreserveLocals=*/false, CodeGenCacheDir);
+
+  if (!ExitOnError) {
+    auto HasError = *static_cast<bool *>(Context.getDiagnosticContext());
+    if (HasError)
+      return 1;
+  }
+
+  // Declare success.
+  for (tool_output_file &OS : OSs)
+    OS.keep();
+
+  return 0;
+}
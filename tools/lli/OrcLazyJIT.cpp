@@ -44,6 +44,13 @@ namespace {
   cl::opt<bool> OrcInlineStubs("orc-lazy-inline-stubs",
                                cl::desc("Try to inline stubs"),
                                cl::init(true), cl::Hidden);
+
+  cl::opt<unsigned> OrcSpeculateThreads("orc-lazy-speculate-threads",
+                                        cl::desc("Number of threads used to "
+                                                 "compile the callees of "
+                                                 "each compiled function "
+                                                 "ahead of time (0 = off)"),
+                                        cl::init(0), cl::Hidden);
 }
 
 OrcLazyJIT::TransformFtor OrcLazyJIT::createDebugDumper() {
@@ -141,6 +148,8 @@ int llvm::runOrcLazyJIT(std::unique_ptr<Module> M, int ArgC, char* ArgV[]) {
   OrcLazyJIT J(std::move(TM), std::move(CompileCallbackMgr),
                std::move(IndirectStubsMgrBuilder),
                OrcInlineStubs);
+  if (OrcSpeculateThreads)
+    J.enableSpeculativeCompilation(OrcSpeculateThreads);
 
   // Add the module, look up main and run it.
   auto MainHandle = J.addModule(std::move(M));
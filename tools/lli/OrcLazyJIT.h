@@ -62,6 +62,13 @@ public:
       DtorRunner.runViaLayer(CODLayer);
   }
 
+  /// Compile the callees of each lazily compiled function ahead of time on
+  /// NumThreads background threads.
+  void enableSpeculativeCompilation(unsigned NumThreads) {
+    SpeculationPool = llvm::make_unique<ThreadPool>(NumThreads);
+    CODLayer.enableSpeculativeCompilation(*SpeculationPool);
+  }
+
   ModuleHandleT addModule(std::unique_ptr<Module> M) {
     // Attach a data-layout if one isn't already present.
     if (M->getDataLayout().isDefault())
@@ -151,6 +158,9 @@ private:
   ObjLayerT ObjectLayer;
   CompileLayerT CompileLayer;
   IRDumpLayerT IRDumpLayer;
+  // Declared before CODLayer, which waits for its queued compiles when it is
+  // destroyed.
+  std::unique_ptr<ThreadPool> SpeculationPool;
   CODLayerT CODLayer;
 
   orc::LocalCXXRuntimeOverrides CXXRuntimeOverrides;
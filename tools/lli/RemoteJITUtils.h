@@ -17,6 +17,7 @@
 #include "llvm/ExecutionEngine/Orc/RPCChannel.h"
 #include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include <mutex>
+#include <vector>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -25,6 +26,9 @@
 #endif
 
 /// RPC channel that reads from and writes from file descriptors.
+///
+/// Outgoing bytes are buffered until send() is called, so that a message (or a
+/// batch of messages) costs a single write.
 class FDRPCChannel final : public llvm::orc::remote::RPCChannel {
 public:
   FDRPCChannel(int InFD, int OutFD) : InFD(InFD), OutFD(OutFD) {}
@@ -49,26 +53,33 @@ public:
 
   llvm::Error appendBytes(const char *Src, unsigned Size) override {
     assert(Src && "Attempt to append from null.");
+    OutBuffer.insert(OutBuffer.end(), Src, Src + Size);
+    return llvm::Error::success();
+  }
+
+  llvm::Error send() override {
+    ssize_t Size = OutBuffer.size();
     ssize_t Completed = 0;
-    while (Completed < static_cast<ssize_t>(Size)) {
-      ssize_t Written = ::write(OutFD, Src + Completed, Size - Completed);
+    while (Completed < Size) {
+      ssize_t Written = ::write(OutFD, OutBuffer.data() + Completed,
+                                Size - Completed);
       if (Written < 0) {
         auto ErrNo = errno;
         if (ErrNo == EAGAIN || ErrNo == EINTR)
           continue;
-        else
-          return llvm::errorCodeToError(
-                   std::error_code(errno, std::generic_category()));
+        OutBuffer.clear();
+        return llvm::errorCodeToError(
+                 std::error_code(errno, std::generic_category()));
       }
       Completed += Written;
     }
+    OutBuffer.clear();
     return llvm::Error::success();
   }
 
-  llvm::Error send() override { return llvm::Error::success(); }
-
 private:
   int InFD, OutFD;
+  std::vector<char> OutBuffer;
 };
 
 // launch the remote process (see lli.cpp) and return a channel to it.
@@ -182,6 +182,12 @@ namespace {
   DisableCoreFiles("disable-core-files", cl::Hidden,
                    cl::desc("Disable emission of core files if possible"));
 
+  cl::opt<bool>
+  PerfJITEvents("perf-jit-events",
+                cl::desc("Describe the JITed code to Linux perf, through "
+                         "/tmp/perf-<pid>.map and a jitdump file"),
+                cl::init(false));
+
   cl::opt<bool>
   NoLazyCompilation("disable-lazy-compilation",
                   cl::desc("Disable JIT lazy compilation"),
@@ -536,6 +542,9 @@ int main(int argc, char **argv, char * const *envp) {
                 JITEventListener::createOProfileJITEventListener());
   EE->RegisterJITEventListener(
                 JITEventListener::createIntelJITEventListener());
+  if (PerfJITEvents)
+    EE->RegisterJITEventListener(
+                  JITEventListener::createPerfJITEventListener());
 
   if (!NoLazyCompilation && RemoteMCJIT) {
     errs() << "warning: remote mcjit does not support lazy compilation\n";
@@ -71,6 +71,19 @@ static cl::list<std::string>
 
 static cl::opt<bool> MRI("M", cl::desc(""));
 
+static cl::opt<unsigned>
+    NumThreads("num-threads",
+               cl::desc("Number of threads to read members for the symbol "
+                        "table on (0 = one per hardware thread)"),
+               cl::init(0));
+static cl::alias NumThreadsA("j", cl::desc("Alias for -num-threads"),
+                             cl::aliasopt(NumThreads));
+
+static cl::opt<bool> IncrementalSymtab(
+    "incremental-symtab",
+    cl::desc("Take the symbol table entries of the members kept from the "
+             "existing archive from its symbol table"));
+
 namespace {
 enum Format { Default, GNU, BSD };
 }
@@ -602,7 +615,7 @@ performWriteOperation(ArchiveOperation Operation,
   if (NewMembersP) {
     std::pair<StringRef, std::error_code> Result = writeArchive(
         ArchiveName, *NewMembersP, Symtab, Kind, Deterministic, Thin,
-        std::move(OldArchiveBuf));
+        std::move(OldArchiveBuf), IncrementalSymtab, NumThreads);
     failIfError(Result.second, Result.first);
     return;
   }
@@ -610,7 +623,7 @@ performWriteOperation(ArchiveOperation Operation,
       computeNewArchiveMembers(Operation, OldArchive);
   auto Result =
       writeArchive(ArchiveName, NewMembers, Symtab, Kind, Deterministic, Thin,
-      std::move(OldArchiveBuf));
+                   std::move(OldArchiveBuf), IncrementalSymtab, NumThreads);
   failIfError(Result.second, Result.first);
 }
 
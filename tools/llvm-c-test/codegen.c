@@ -0,0 +1,112 @@
+/*===-- codegen.c - tool for testing libLLVM and llvm-c API ---------------===*\
+|*                                                                            *|
+|*                     The LLVM Compiler Infrastructure                       *|
+|*                                                                            *|
+|* This file is distributed under the University of Illinois Open Source      *|
+|* License. See LICENSE.TXT for details.                                      *|
+|*                                                                            *|
+|*===----------------------------------------------------------------------===*|
+|*                                                                            *|
+|* This file implements the --codegen-queue command in llvm-c-test.           *|
+|*                                                                            *|
+\*===----------------------------------------------------------------------===*/
+
+#include "llvm-c-test.h"
+#include "llvm-c/BitReader.h"
+#include "llvm-c/TargetMachine.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_MODULES 4
+
+struct job {
+  LLVMContextRef Context;
+  LLVMModuleRef Module;
+  LLVMMemoryBufferRef Output;
+  char *Error;
+};
+
+static void job_done(void *Ctx, LLVMModuleRef M, LLVMMemoryBufferRef Output,
+                     const char *ErrorMessage) {
+  struct job *J = (struct job *)Ctx;
+  J->Output = Output;
+  if (ErrorMessage)
+    J->Error = strdup(ErrorMessage);
+}
+
+int llvm_codegen_queue(void) {
+  LLVMMemoryBufferRef MB;
+  char *Msg = NULL;
+  struct job Jobs[NUM_MODULES];
+  LLVMTargetRef Target;
+  LLVMTargetMachineRef TM;
+  LLVMCodeGenQueueRef Queue;
+  char *Triple;
+  const char *First;
+  size_t FirstSize;
+  int I, Ret = 0;
+
+  LLVMInitializeAllTargetInfos();
+  LLVMInitializeAllTargets();
+  LLVMInitializeAllTargetMCs();
+  LLVMInitializeAllAsmPrinters();
+
+  if (LLVMCreateMemoryBufferWithSTDIN(&MB, &Msg)) {
+    fprintf(stderr, "Error reading file: %s\n", Msg);
+    return 1;
+  }
+
+  /* Every module has a context of its own, so they compile in parallel. */
+  memset(Jobs, 0, sizeof(Jobs));
+  for (I = 0; I < NUM_MODULES; ++I) {
+    Jobs[I].Context = LLVMContextCreate();
+    if (LLVMParseBitcodeInContext2(Jobs[I].Context, MB, &Jobs[I].Module)) {
+      fprintf(stderr, "Error parsing bitcode\n");
+      return 1;
+    }
+  }
+  LLVMDisposeMemoryBuffer(MB);
+
+  Triple = strdup(LLVMGetTarget(Jobs[0].Module));
+  if (LLVMGetTargetFromTriple(Triple, &Target, &Msg)) {
+    fprintf(stderr, "Error getting target: %s\n", Msg);
+    return 1;
+  }
+  TM = LLVMCreateTargetMachine(Target, Triple, "", "", LLVMCodeGenLevelDefault,
+                               LLVMRelocDefault, LLVMCodeModelDefault);
+  free(Triple);
+
+  Queue = LLVMCreateCodeGenQueue(2);
+  for (I = 0; I < NUM_MODULES; ++I)
+    LLVMCodeGenQueueAddModule(Queue, TM, Jobs[I].Module, LLVMAssemblyFile,
+                              NULL, job_done, &Jobs[I]);
+  /* The jobs have their own copy of the target machine. */
+  LLVMDisposeTargetMachine(TM);
+  LLVMDisposeCodeGenQueue(Queue);
+
+  First = LLVMGetBufferStart(Jobs[0].Output);
+  FirstSize = LLVMGetBufferSize(Jobs[0].Output);
+  for (I = 0; I < NUM_MODULES; ++I) {
+    if (Jobs[I].Error) {
+      printf("module %d: error: %s\n", I, Jobs[I].Error);
+      free(Jobs[I].Error);
+      Ret = 1;
+    } else if (LLVMGetBufferSize(Jobs[I].Output) != FirstSize ||
+               memcmp(LLVMGetBufferStart(Jobs[I].Output), First, FirstSize)) {
+      printf("module %d: different output\n", I);
+      Ret = 1;
+    } else {
+      printf("module %d: ok\n", I);
+    }
+  }
+  fwrite(First, 1, FirstSize, stdout);
+
+  for (I = 0; I < NUM_MODULES; ++I) {
+    if (Jobs[I].Output)
+      LLVMDisposeMemoryBuffer(Jobs[I].Output);
+    LLVMDisposeModule(Jobs[I].Module);
+    LLVMContextDispose(Jobs[I].Context);
+  }
+  return Ret;
+}
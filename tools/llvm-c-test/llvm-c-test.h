@@ -32,6 +32,9 @@ int llvm_module_list_globals(void);
 // calc.c
 int llvm_calc(void);
 
+// codegen.c
+int llvm_codegen_queue(void);
+
 // disassemble.c
 int llvm_disassemble(void);
 
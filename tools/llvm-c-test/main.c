@@ -49,6 +49,9 @@ static void print_usage(void) {
   fprintf(
       stderr,
       "    Read lines of name, rpn from stdin - print generated module\n\n");
+  fprintf(stderr, "  * --codegen-queue\n");
+  fprintf(stderr, "    Read bitcode from stdin - compile several copies of it "
+                  "in parallel and print the assembly\n\n");
   fprintf(stderr, "  * --echo\n");
   fprintf(stderr,
           "    Read bitcode file form stdin - print it back out\n\n");
@@ -88,6 +91,8 @@ int main(int argc, char **argv) {
     return llvm_add_named_metadata_operand();
   } else if (argc == 2 && !strcmp(argv[1], "--set-metadata")) {
     return llvm_set_metadata();
+  } else if (argc == 2 && !strcmp(argv[1], "--codegen-queue")) {
+    return llvm_codegen_queue();
   } else if (argc == 2 && !strcmp(argv[1], "--echo")) {
     return llvm_echo();
   } else if (argc == 2 && !strcmp(argv[1], "--test-diagnostic-handler")) {
@@ -31,8 +31,13 @@
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include <deque>
 #include <functional>
+#include <map>
+#include <mutex>
 #include <system_error>
+#include <thread>
 
 using namespace llvm;
 using namespace coverage;
@@ -67,6 +72,10 @@ public:
   std::unique_ptr<SourceCoverageView>
   createSourceFileView(StringRef SourceFile, CoverageMapping &Coverage);
 
+  /// \brief Render the main source view of \p SourceFile to \p OS.
+  void renderSourceFile(StringRef SourceFile, CoverageMapping &Coverage,
+                        bool ShowFilenames, raw_ostream &OS);
+
   /// \brief Load the coverage mapping data. Return true if an error occured.
   std::unique_ptr<CoverageMapping> load();
 
@@ -87,6 +96,12 @@ public:
   std::vector<std::string> SourceFiles;
   std::vector<std::pair<std::string, std::unique_ptr<MemoryBuffer>>>
       LoadedSourceFiles;
+  /// The index in LoadedSourceFiles of each loaded file.
+  std::map<sys::fs::UniqueID, unsigned> LoadedSourceFileIDs;
+  /// Guards the loaded source files, which the threads of the show command
+  /// share.
+  std::mutex LoadedSourceFilesLock;
+  unsigned NumThreads;
   bool CompareFilenamesOnly;
   StringMap<std::string> RemappedFilenames;
   std::string CoverageArch;
@@ -108,14 +123,23 @@ CodeCoverageTool::getSourceFile(StringRef SourceFile) {
     if (Loc != RemappedFilenames.end())
       SourceFile = Loc->second;
   }
-  for (const auto &Files : LoadedSourceFiles)
-    if (sys::fs::equivalent(SourceFile, Files.first))
-      return *Files.second;
+  std::lock_guard<std::mutex> Guard(LoadedSourceFilesLock);
+  // Look the file up by its unique ID, which is what sys::fs::equivalent
+  // compares, rather than comparing it against every loaded file.
+  sys::fs::UniqueID ID;
+  bool HasID = !sys::fs::getUniqueID(SourceFile, ID);
+  if (HasID) {
+    auto Loaded = LoadedSourceFileIDs.find(ID);
+    if (Loaded != LoadedSourceFileIDs.end())
+      return *LoadedSourceFiles[Loaded->second].second;
+  }
   auto Buffer = MemoryBuffer::getFile(SourceFile);
   if (auto EC = Buffer.getError()) {
     error(EC.message(), SourceFile);
     return EC;
   }
+  if (HasID)
+    LoadedSourceFileIDs[ID] = LoadedSourceFiles.size();
   LoadedSourceFiles.emplace_back(SourceFile, std::move(Buffer.get()));
   return *LoadedSourceFiles.back().second;
 }
@@ -194,6 +218,26 @@ CodeCoverageTool::createSourceFileView(StringRef SourceFile,
   return View;
 }
 
+void CodeCoverageTool::renderSourceFile(StringRef SourceFile,
+                                        CoverageMapping &Coverage,
+                                        bool ShowFilenames, raw_ostream &OS) {
+  auto mainView = createSourceFileView(SourceFile, Coverage);
+  if (!mainView) {
+    ViewOpts.colored_ostream(OS, raw_ostream::RED)
+        << "warning: The file '" << SourceFile << "' isn't covered.";
+    OS << "\n";
+    return;
+  }
+
+  if (ShowFilenames) {
+    ViewOpts.colored_ostream(OS, raw_ostream::CYAN) << SourceFile << ":";
+    OS << "\n";
+  }
+  mainView->render(OS, /*Wholefile=*/true);
+  if (SourceFiles.size() > 1)
+    OS << "\n";
+}
+
 static bool modifiedTimeGT(StringRef LHS, StringRef RHS) {
   sys::fs::file_status Status;
   if (sys::fs::status(LHS, Status))
@@ -405,6 +449,13 @@ int CodeCoverageTool::show(int argc, const char **argv,
                                    cl::desc("Show function instantiations"),
                                    cl::cat(ViewCategory));
 
+  cl::opt<unsigned, true> NumThreads(
+      "num-threads", cl::init(1),
+      cl::desc("Number of threads rendering the source files (0 uses one per "
+               "hardware thread). The output of each file is buffered, so it "
+               "is not colored when more than one thread is used"),
+      cl::location(this->NumThreads));
+
   auto Err = commandLineParser(argc, argv);
   if (Err)
     return Err;
@@ -451,22 +502,36 @@ int CodeCoverageTool::show(int argc, const char **argv,
     for (StringRef Filename : Coverage->getUniqueSourceFiles())
       SourceFiles.push_back(Filename);
 
-  for (const auto &SourceFile : SourceFiles) {
-    auto mainView = createSourceFileView(SourceFile, *Coverage);
-    if (!mainView) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::RED)
-          << "warning: The file '" << SourceFile << "' isn't covered.";
-      outs() << "\n";
-      continue;
-    }
+  unsigned ThreadCount =
+      NumThreads ? NumThreads : std::thread::hardware_concurrency();
+  if (ThreadCount <= 1 || SourceFiles.size() <= 1) {
+    for (const auto &SourceFile : SourceFiles)
+      renderSourceFile(SourceFile, *Coverage, ShowFilenames, outs());
+    return 0;
+  }
 
-    if (ShowFilenames) {
-      ViewOpts.colored_ostream(outs(), raw_ostream::CYAN) << SourceFile << ":";
-      outs() << "\n";
+  // Render the files on a thread pool, and write them out in order as soon as
+  // they are done. No more than a few files per thread are in flight, so that
+  // the output is streamed rather than held in memory.
+  ThreadPool Pool(ThreadCount);
+  std::deque<std::pair<std::shared_future<void>, std::unique_ptr<std::string>>>
+      InFlight;
+  unsigned MaxInFlight = 4 * ThreadCount;
+  for (size_t I = 0, E = SourceFiles.size(); I != E || !InFlight.empty();) {
+    if (I != E && InFlight.size() < MaxInFlight) {
+      auto Output = llvm::make_unique<std::string>();
+      std::string *OutputPtr = Output.get();
+      StringRef SourceFile = SourceFiles[I++];
+      auto Done = Pool.async([=, &Coverage]() {
+        raw_string_ostream OS(*OutputPtr);
+        renderSourceFile(SourceFile, *Coverage, ShowFilenames, OS);
+      });
+      InFlight.emplace_back(std::move(Done), std::move(Output));
+      continue;
     }
-    mainView->render(outs(), /*Wholefile=*/true);
-    if (SourceFiles.size() > 1)
-      outs() << "\n";
+    InFlight.front().first.wait();
+    outs() << *InFlight.front().second;
+    InFlight.pop_front();
   }
 
   return 0;
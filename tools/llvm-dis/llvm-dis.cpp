@@ -186,6 +186,7 @@ int main(int argc, char **argv) {
     errs() << EC.message() << '\n';
     return 1;
   }
+  Out->os().enable_async_writes();
 
   std::unique_ptr<AssemblyAnnotationWriter> Annotator;
   if (ShowAnnotations)
@@ -73,6 +73,18 @@ static cl::opt<DIDumpType> DumpType(
         clEnumValN(DIDT_CUIndex, "cu_index", ".debug_cu_index"),
         clEnumValN(DIDT_TUIndex, "tu_index", ".debug_tu_index"), clEnumValEnd));
 
+static cl::opt<unsigned>
+    NumThreads("num-threads", cl::init(1),
+               cl::desc("Number of threads to use to parse the debug info "
+                        "(0 = one per hardware thread)"));
+static cl::alias NumThreadsA("j", cl::desc("Alias for -num-threads"),
+                             cl::aliasopt(NumThreads));
+
+static cl::list<std::string>
+    FindNames("find", cl::ZeroOrMore, cl::value_desc("name"),
+              cl::desc("Dump only the DIEs with this name, found with the "
+                       "accelerator tables if there are any"));
+
 static void error(StringRef Filename, std::error_code EC) {
   if (!EC)
     return;
@@ -81,7 +93,22 @@ static void error(StringRef Filename, std::error_code EC) {
 }
 
 static void DumpObjectFile(ObjectFile &Obj, Twine Filename) {
-  std::unique_ptr<DIContext> DICtx(new DWARFContextInMemory(Obj));
+  std::unique_ptr<DWARFContext> DICtx(new DWARFContextInMemory(Obj));
+  if (!FindNames.empty()) {
+    outs() << Filename.str() << ":\tfile format " << Obj.getFileFormatName()
+           << "\n";
+    for (const auto &Name : FindNames)
+      for (const auto &UnitAndDIE : DICtx->findDIEsByName(Name, NumThreads))
+        UnitAndDIE.second->dump(outs(), UnitAndDIE.first, 0);
+    return;
+  }
+
+  // Parse the units up front if they are all going to be dumped.
+  if (NumThreads != 1 &&
+      (DumpType == DIDT_All || DumpType == DIDT_Info ||
+       DumpType == DIDT_InfoDwo || DumpType == DIDT_Types ||
+       DumpType == DIDT_TypesDwo))
+    DICtx->extractAllDIEs(NumThreads);
 
   outs() << Filename.str() << ":\tfile format " << Obj.getFileFormatName()
          << "\n\n";
@@ -14,6 +14,7 @@
 #include "DWPError.h"
 #include "DWPStringPool.h"
 #include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/CodeGen/AsmPrinter.h"
@@ -37,11 +38,13 @@
 #include "llvm/Support/Options.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Target/TargetMachine.h"
 #include <deque>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 using namespace llvm;
 using namespace llvm::object;
@@ -56,6 +59,14 @@ static opt<std::string> OutputFilename(Required, "o",
                                        value_desc("filename"),
                                        cat(DwpCategory));
 
+static opt<unsigned> NumThreads(
+    "num-threads", init(0),
+    desc("Number of threads used to read the input files "
+         "(0 = one per hardware thread)"),
+    cat(DwpCategory));
+static alias NumThreadsA("j", desc("Alias for -num-threads"),
+                         aliasopt(NumThreads));
+
 static void writeStringsAndOffsets(MCStreamer &Out, DWPStringPool &Strings,
                                    MCSection *StrOffsetSection,
                                    StringRef CurStrSection,
@@ -380,39 +391,71 @@ static Error handleCompressedSection(
   return Error();
 }
 
-static Error handleSection(
+/// An input file and the contents of its DWARF sections. Input files are read
+/// and their compressed sections inflated on worker threads, while their
+/// contents are written to the output in order on the main thread.
+struct InputFile {
+  OwningBinary<object::ObjectFile> Obj;
+  std::deque<SmallString<32>> UncompressedSections;
+  /// The name (without the leading "." or "_") and the contents of each
+  /// known section, in section order.
+  std::vector<std::pair<StringRef, StringRef>> Sections;
+  /// The result of reading the file, set by the worker that read it.
+  llvm::Optional<Error> Err;
+
+  ~InputFile() {
+    if (Err)
+      consumeError(std::move(*Err));
+  }
+};
+
+static Error readInputSections(
     const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
-    const MCSection *StrSection, const MCSection *StrOffsetSection,
-    const MCSection *TypesSection, const MCSection *CUIndexSection,
-    const MCSection *TUIndexSection, const SectionRef &Section, MCStreamer &Out,
-    std::deque<SmallString<32>> &UncompressedSections,
-    uint32_t (&ContributionOffsets)[8], UnitIndexEntry &CurEntry,
-    StringRef &CurStrSection, StringRef &CurStrOffsetSection,
-    std::vector<StringRef> &CurTypesSection, StringRef &InfoSection,
-    StringRef &AbbrevSection, StringRef &CurCUIndexSection,
-    StringRef &CurTUIndexSection) {
-  if (Section.isBSS())
-    return Error();
+    StringRef Input, InputFile &File) {
+  auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
+  if (!ErrOrObj)
+    return ErrOrObj.takeError();
+  File.Obj = std::move(*ErrOrObj);
+
+  for (const auto &Section : File.Obj.getBinary()->sections()) {
+    if (Section.isBSS())
+      continue;
 
-  if (Section.isVirtual())
-    return Error();
+    if (Section.isVirtual())
+      continue;
+
+    StringRef Name;
+    if (std::error_code Err = Section.getName(Name))
+      return errorCodeToError(Err);
 
-  StringRef Name;
-  if (std::error_code Err = Section.getName(Name))
-    return errorCodeToError(Err);
+    Name = Name.substr(Name.find_first_not_of("._"));
 
-  Name = Name.substr(Name.find_first_not_of("._"));
+    StringRef Contents;
+    if (auto Err = Section.getContents(Contents))
+      return errorCodeToError(Err);
 
-  StringRef Contents;
-  if (auto Err = Section.getContents(Contents))
-    return errorCodeToError(Err);
+    if (auto Err =
+            handleCompressedSection(File.UncompressedSections, Name, Contents))
+      return Err;
 
-  if (auto Err = handleCompressedSection(UncompressedSections, Name, Contents))
-    return Err;
+    if (KnownSections.count(Name))
+      File.Sections.push_back(std::make_pair(Name, Contents));
+  }
+  return Error();
+}
 
+static void handleSection(
+    const StringMap<std::pair<MCSection *, DWARFSectionKind>> &KnownSections,
+    const MCSection *StrSection, const MCSection *StrOffsetSection,
+    const MCSection *TypesSection, const MCSection *CUIndexSection,
+    const MCSection *TUIndexSection, StringRef Name, StringRef Contents,
+    MCStreamer &Out, uint32_t (&ContributionOffsets)[8],
+    UnitIndexEntry &CurEntry, StringRef &CurStrSection,
+    StringRef &CurStrOffsetSection, std::vector<StringRef> &CurTypesSection,
+    StringRef &InfoSection, StringRef &AbbrevSection,
+    StringRef &CurCUIndexSection, StringRef &CurTUIndexSection) {
   auto SectionPair = KnownSections.find(Name);
-  if (SectionPair == KnownSections.end())
-    return Error();
+  assert(SectionPair != KnownSections.end() && "Unknown section");
 
   if (DWARFSectionKind Kind = SectionPair->second.second) {
     auto Index = Kind - DW_SECT_INFO;
@@ -449,7 +492,6 @@ static Error handleSection(
     Out.SwitchSection(OutSection);
     Out.EmitBytes(Contents);
   }
-  return Error();
 }
 
 static Error
@@ -487,18 +529,27 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
 
   DWPStringPool Strings(Out, StrSection);
 
-  SmallVector<OwningBinary<object::ObjectFile>, 128> Objects;
-  Objects.reserve(Inputs.size());
-
-  std::deque<SmallString<32>> UncompressedSections;
-
-  for (const auto &Input : Inputs) {
-    auto ErrOrObj = object::ObjectFile::createObjectFile(Input);
-    if (!ErrOrObj)
-      return ErrOrObj.takeError();
-
-    auto &Obj = *ErrOrObj->getBinary();
-    Objects.push_back(std::move(*ErrOrObj));
+  // The inputs must stay loaded until the end, as the string pool refers to
+  // their strings. The pool is declared last so that it waits for the
+  // workers that are still running on an early return.
+  std::vector<InputFile> Files(Inputs.size());
+  std::vector<std::shared_future<void>> FilesRead;
+  ThreadPool Pool(NumThreads ? NumThreads
+                             : std::thread::hardware_concurrency());
+  for (size_t I = 0, E = Inputs.size(); I != E; ++I)
+    FilesRead.push_back(Pool.async([&, I]() {
+      Files[I].Err.emplace(
+          readInputSections(KnownSections, Inputs[I], Files[I]));
+    }));
+
+  for (size_t FileIdx = 0, E = Inputs.size(); FileIdx != E; ++FileIdx) {
+    const auto &Input = Inputs[FileIdx];
+    InputFile &File = Files[FileIdx];
+    FilesRead[FileIdx].wait();
+    if (*File.Err)
+      return std::move(*File.Err);
+
+    auto &Obj = *File.Obj.getBinary();
 
     UnitIndexEntry CurEntry = {};
 
@@ -510,14 +561,13 @@ static Error write(MCStreamer &Out, ArrayRef<std::string> Inputs) {
     StringRef CurCUIndexSection;
     StringRef CurTUIndexSection;
 
-    for (const auto &Section : Obj.sections())
-      if (auto Err = handleSection(
-              KnownSections, StrSection, StrOffsetSection, TypesSection,
-              CUIndexSection, TUIndexSection, Section, Out,
-              UncompressedSections, ContributionOffsets, CurEntry,
-              CurStrSection, CurStrOffsetSection, CurTypesSection, InfoSection,
-              AbbrevSection, CurCUIndexSection, CurTUIndexSection))
-        return Err;
+    for (const auto &Section : File.Sections)
+      handleSection(KnownSections, StrSection, StrOffsetSection, TypesSection,
+                    CUIndexSection, TUIndexSection, Section.first,
+                    Section.second, Out, ContributionOffsets, CurEntry,
+                    CurStrSection, CurStrOffsetSection, CurTypesSection,
+                    InfoSection, AbbrevSection, CurCUIndexSection,
+                    CurTUIndexSection);
 
     if (InfoSection.empty())
       continue;
@@ -665,6 +715,7 @@ int main(int argc, char **argv) {
   raw_fd_ostream OutFile(OutputFilename, EC, sys::fs::F_None);
   if (EC)
     return error(Twine(OutputFilename) + ": " + EC.message(), Context);
+  OutFile.enable_async_writes();
 
   MCTargetOptions MCOptions = InitMCTargetOptionsFromFlags();
   std::unique_ptr<MCStreamer> MS(TheTarget->createMCObjectStreamer(
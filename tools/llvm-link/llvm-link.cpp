@@ -78,6 +78,12 @@ static cl::opt<bool>
 static cl::opt<bool>
 OnlyNeeded("only-needed", cl::desc("Link only needed symbols"));
 
+static cl::opt<bool> ResolveOnlyNeeded(
+    "resolve-only-needed",
+    cl::desc("With -only-needed, decide which inputs are needed from their "
+             "symbol tables before loading any function bodies, and skip the "
+             "others"));
+
 static cl::opt<bool>
 Force("f", cl::desc("Enable binary output on terminals"));
 
@@ -287,6 +293,37 @@ static bool importFunctions(const char *argv0, LLVMContext &Context,
   return true;
 }
 
+/// Verify \p M, loaded from \p File, and link it into \p L.
+static bool linkModule(const char *argv0, const std::string &File,
+                       std::unique_ptr<Module> M, Linker &L, unsigned Flags) {
+  if (verifyModule(*M, &errs())) {
+    errs() << argv0 << ": " << File << ": error: input module is broken!\n";
+    return false;
+  }
+
+  // If a module summary index is supplied, load it so linkInModule can treat
+  // local functions/variables as exported and promote if necessary.
+  if (!SummaryIndex.empty()) {
+    ErrorOr<std::unique_ptr<ModuleSummaryIndex>> IndexOrErr =
+        llvm::getModuleSummaryIndexForFile(SummaryIndex, diagnosticHandler);
+    std::error_code EC = IndexOrErr.getError();
+    if (EC) {
+      errs() << EC.message() << '\n';
+      return false;
+    }
+    auto Index = std::move(IndexOrErr.get());
+
+    // Promotion
+    if (renameModuleForThinLTO(*M, *Index))
+      return true;
+  }
+
+  if (Verbose)
+    errs() << "Linking in '" << File << "'\n";
+
+  return !L.linkInModule(std::move(M), Flags);
+}
+
 static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
                       const cl::list<std::string> &Files,
                       unsigned Flags) {
@@ -299,34 +336,81 @@ static bool linkFiles(const char *argv0, LLVMContext &Context, Linker &L,
       return false;
     }
 
-    if (verifyModule(*M, &errs())) {
-      errs() << argv0 << ": " << File << ": error: input module is broken!\n";
+    if (!linkModule(argv0, File, std::move(M), L, ApplicableFlags))
       return false;
-    }
+    // All linker flags apply to linking of subsequent files.
+    ApplicableFlags = Flags;
+  }
 
-    // If a module summary index is supplied, load it so linkInModule can treat
-    // local functions/variables as exported and promote if necessary.
-    if (!SummaryIndex.empty()) {
-      ErrorOr<std::unique_ptr<ModuleSummaryIndex>> IndexOrErr =
-          llvm::getModuleSummaryIndexForFile(SummaryIndex, diagnosticHandler);
-      std::error_code EC = IndexOrErr.getError();
-      if (EC) {
-        errs() << EC.message() << '\n';
-        return false;
-      }
-      auto Index = std::move(IndexOrErr.get());
+  return true;
+}
+
+static void forEachGlobalValue(Module &M,
+                               function_ref<void(GlobalValue &)> Fn) {
+  for (Function &F : M)
+    Fn(F);
+  for (GlobalVariable &GV : M.globals())
+    Fn(GV);
+  for (GlobalAlias &GA : M.aliases())
+    Fn(GA);
+  for (GlobalIFunc &GI : M.ifuncs())
+    Fn(GI);
+}
 
-      // Promotion
-      if (renameModuleForThinLTO(*M, *Index))
-        return true;
+/// Link the inputs needed by the first one, as -only-needed does, but decide
+/// which inputs these are before loading any function bodies or metadata.
+///
+/// Every input is loaded lazily, which only reads its symbol table. Starting
+/// from the first input, an input is needed if it is the first to define a
+/// symbol that a needed input declares. The needed inputs are then linked in
+/// the order they were found, so that each of them is linked after an input
+/// referencing it, and the others are never materialized.
+static bool linkNeededFiles(const char *argv0, LLVMContext &Context,
+                            Linker &L, const cl::list<std::string> &Files,
+                            unsigned Flags) {
+  std::vector<std::unique_ptr<Module>> Modules;
+  StringMap<unsigned> Definitions;
+  for (const auto &File : Files) {
+    std::unique_ptr<Module> M = loadFile(argv0, File, Context, false);
+    if (!M.get()) {
+      errs() << argv0 << ": error loading file '" << File << "'\n";
+      return false;
     }
+    unsigned Idx = Modules.size();
+    forEachGlobalValue(*M, [&](GlobalValue &GV) {
+      if (!GV.isDeclaration() && !GV.hasLocalLinkage())
+        Definitions.insert(std::make_pair(GV.getName(), Idx));
+    });
+    Modules.push_back(std::move(M));
+  }
 
-    if (Verbose)
-      errs() << "Linking in '" << File << "'\n";
+  std::vector<unsigned> Order(1, 0);
+  std::vector<bool> Needed(Modules.size());
+  Needed[0] = true;
+  for (unsigned I = 0; I != Order.size(); ++I)
+    forEachGlobalValue(*Modules[Order[I]], [&](GlobalValue &GV) {
+      if (!GV.isDeclaration())
+        return;
+      auto D = Definitions.find(GV.getName());
+      if (D != Definitions.end() && !Needed[D->second]) {
+        Needed[D->second] = true;
+        Order.push_back(D->second);
+      }
+    });
+
+  if (Verbose)
+    for (unsigned I = 0, E = Modules.size(); I != E; ++I)
+      if (!Needed[I])
+        errs() << "Skipping '" << Files[I] << "'\n";
 
-    if (L.linkInModule(std::move(M), ApplicableFlags))
+  // The first file is linked in entirely.
+  unsigned ApplicableFlags = Flags & Linker::Flags::OverrideFromSrc;
+  for (unsigned Idx : Order) {
+    std::unique_ptr<Module> M = std::move(Modules[Idx]);
+    M->materializeMetadata();
+    UpgradeDebugInfo(*M);
+    if (!linkModule(argv0, Files[Idx], std::move(M), L, ApplicableFlags))
       return false;
-    // All linker flags apply to linking of subsequent files.
     ApplicableFlags = Flags;
   }
 
@@ -356,8 +440,15 @@ int main(int argc, char **argv) {
   if (OnlyNeeded)
     Flags |= Linker::Flags::LinkOnlyNeeded;
 
+  // Link all the inputs as one batch, so that the time it takes stays
+  // linear in the number of files.
+  L.startBatch();
+
   // First add all the regular input files
-  if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
+  if (OnlyNeeded && ResolveOnlyNeeded) {
+    if (!linkNeededFiles(argv[0], Context, L, InputFilenames, Flags))
+      return 1;
+  } else if (!linkFiles(argv[0], Context, L, InputFilenames, Flags))
     return 1;
 
   // Next the -override ones.
@@ -369,6 +460,8 @@ int main(int argc, char **argv) {
   if (!importFunctions(argv[0], Context, L))
     return 1;
 
+  L.finishBatch();
+
   if (DumpAsm) errs() << "Here's the assembly:\n" << *Composite;
 
   std::error_code EC;
@@ -17,6 +17,7 @@
 #include "llvm/CodeGen/CommandFlags.h"
 #include "llvm/IR/DiagnosticPrinter.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/ModuleSummaryIndexTable.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/LTO/LTOCodeGenerator.h"
@@ -105,6 +106,11 @@ static cl::opt<std::string>
                  cl::desc("Provide the index produced by a ThinLink, required "
                           "to perform the promotion and/or importing."));
 
+static cl::opt<bool> ThinLTOIndexTable(
+    "thinlto-index-table", cl::init(false),
+    cl::desc("Write the index produced by a ThinLink as a summary index "
+             "table, whose summaries later stages read only when needed."));
+
 static cl::opt<std::string> ThinLTOPrefixReplace(
     "thinlto-prefix-replace",
     cl::desc("Control where files for distributed backends are "
@@ -120,6 +126,10 @@ static cl::opt<std::string> ThinLTOModuleId(
 static cl::opt<std::string>
     ThinLTOCacheDir("thinlto-cache-dir", cl::desc("Enable ThinLTO caching."));
 
+static cl::opt<bool> ThinLTOCacheIndex(
+    "thinlto-cache-index", cl::init(false),
+    cl::desc("Prune the ThinLTO cache from an index of its entries."));
+
 static cl::opt<bool>
     SaveModuleFile("save-merged-module", cl::init(false),
                    cl::desc("Write merged LTO module to file before CodeGen"));
@@ -393,6 +403,7 @@ public:
     ThinGenerator.setCodePICModel(getRelocModel());
     ThinGenerator.setTargetOptions(Options);
     ThinGenerator.setCacheDir(ThinLTOCacheDir);
+    ThinGenerator.setCachePruningUseIndex(ThinLTOCacheIndex);
 
     // Add all the exported symbols to the table of symbols to preserve.
     for (unsigned i = 0; i < ExportedSymbols.size(); ++i)
@@ -445,7 +456,10 @@ private:
     std::error_code EC;
     raw_fd_ostream OS(OutputFilename, EC, sys::fs::OpenFlags::F_None);
     error(EC, "error opening the file '" + OutputFilename + "'");
-    WriteIndexToFile(*CombinedIndex, OS);
+    if (ThinLTOIndexTable)
+      writeModuleSummaryIndexTable(*CombinedIndex, OS);
+    else
+      WriteIndexToFile(*CombinedIndex, OS);
     return;
   }
 
@@ -600,14 +614,16 @@ private:
                          "input files, do not provide an output filename and "
                          "the output files will be suffixed from the input "
                          "ones.");
+    // The combined index is optional, for devirtualization.
+    std::unique_ptr<ModuleSummaryIndex> Index;
     if (!ThinLTOIndex.empty())
-      errs() << "Warning: -thinlto-index ignored for optimize stage";
+      Index = loadCombinedIndex();
 
     for (auto &Filename : InputFilenames) {
       LLVMContext Ctx;
       auto TheModule = loadModule(Filename, Ctx);
 
-      ThinGenerator.optimize(*TheModule);
+      ThinGenerator.optimize(*TheModule, Index.get());
 
       std::string OutputName = OutputFilename;
       if (OutputName.empty()) {
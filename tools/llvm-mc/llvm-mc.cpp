@@ -33,17 +33,20 @@
 #include "llvm/Support/Host.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
+#include <thread>
 
 using namespace llvm;
 
-static cl::opt<std::string>
-InputFilename(cl::Positional, cl::desc("<input file>"), cl::init("-"));
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::desc("<input files>"), cl::ZeroOrMore);
 
 static cl::opt<std::string>
 OutputFilename("o", cl::desc("Output filename"),
@@ -169,6 +172,14 @@ static cl::opt<bool> SaveTempLabels("save-temp-labels",
 static cl::opt<bool> NoExecStack("no-exec-stack",
                                  cl::desc("File doesn't need an exec stack"));
 
+static cl::opt<unsigned>
+NumThreads("num-threads",
+           cl::desc("Number of threads to assemble multiple input files with "
+                    "(0 = one per hardware thread)"),
+           cl::init(0));
+static cl::alias NumThreadsShort("j", cl::desc("Alias for -num-threads"),
+                                 cl::aliasopt(NumThreads));
+
 enum ActionType {
   AC_AsLex,
   AC_Assemble,
@@ -343,8 +354,9 @@ static int fillCommandLineSymbols(MCAsmParser &Parser){
 
 static int AssembleInput(const char *ProgName, const Target *TheTarget,
                          SourceMgr &SrcMgr, MCContext &Ctx, MCStreamer &Str,
-                         MCAsmInfo &MAI, MCSubtargetInfo &STI,
-                         MCInstrInfo &MCII, MCTargetOptions &MCOptions) {
+                         const MCAsmInfo &MAI, const MCSubtargetInfo &STI,
+                         const MCInstrInfo &MCII,
+                         const MCTargetOptions &MCOptions) {
   std::unique_ptr<MCAsmParser> Parser(
       createMCAsmParser(SrcMgr, Ctx, Str, MAI));
   std::unique_ptr<MCTargetAsmParser> TAP(
@@ -367,6 +379,151 @@ static int AssembleInput(const char *ProgName, const Target *TheTarget,
   return Res;
 }
 
+static void configureContext(MCContext &Ctx, unsigned DwarfVersion) {
+  if (SaveTempLabels)
+    Ctx.setAllowTemporaryLabels(false);
+
+  Ctx.setGenDwarfForAssembly(GenDwarfForAssembly);
+  Ctx.setDwarfVersion(DwarfVersion);
+  if (!DwarfDebugFlags.empty())
+    Ctx.setDwarfDebugFlags(StringRef(DwarfDebugFlags));
+  if (!DwarfDebugProducer.empty())
+    Ctx.setDwarfDebugProducer(StringRef(DwarfDebugProducer));
+  if (!DebugCompilationDir.empty())
+    Ctx.setCompilationDir(DebugCompilationDir);
+  else {
+    // If no compilation dir is set, try to use the current directory.
+    SmallString<128> CWD;
+    if (!sys::fs::current_path(CWD))
+      Ctx.setCompilationDir(CWD);
+  }
+  if (!MainFileName.empty())
+    Ctx.setMainFileName(MainFileName);
+}
+
+namespace {
+/// The target objects shared by all the input files when assembling several
+/// of them. They are only read while assembling, so it is enough for each
+/// input file to have its own MCContext, MCObjectFileInfo and streamer.
+struct SharedTargetInfo {
+  const Target *TheTarget;
+  Triple TheTriple;
+  const MCRegisterInfo *MRI;
+  const MCAsmInfo *MAI;
+  const MCInstrInfo *MCII;
+  const MCSubtargetInfo *STI;
+  const MCTargetOptions *MCOptions;
+  unsigned DwarfVersion;
+};
+}
+
+static void printDiagnostic(const SMDiagnostic &Diag, void *Context) {
+  Diag.print(nullptr, *static_cast<raw_ostream *>(Context));
+}
+
+/// Assemble \p InputFilename into the object file \p Obj, printing any
+/// diagnostics to \p ErrOS. This is safe to call on several threads at once.
+static int assembleToObject(const char *ProgName,
+                            const SharedTargetInfo &Shared,
+                            StringRef InputFilename, SmallVectorImpl<char> &Obj,
+                            raw_ostream &ErrOS) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
+      MemoryBuffer::getFileOrSTDIN(InputFilename);
+  if (std::error_code EC = BufferPtr.getError()) {
+    ErrOS << InputFilename << ": " << EC.message() << '\n';
+    return 1;
+  }
+
+  SourceMgr SrcMgr;
+  SrcMgr.AddNewSourceBuffer(std::move(*BufferPtr), SMLoc());
+  SrcMgr.setIncludeDirs(IncludeDirs);
+  SrcMgr.setDiagHandler(printDiagnostic, &ErrOS);
+
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(Shared.MAI, Shared.MRI, &MOFI, &SrcMgr);
+  MOFI.InitMCObjectFileInfo(Shared.TheTriple, PIC, CMModel, Ctx);
+  configureContext(Ctx, Shared.DwarfVersion);
+
+  // Don't waste memory on names of temp labels.
+  Ctx.setUseNamesOnTempLabels(false);
+
+  raw_svector_ostream OS(Obj);
+  const Target *TheTarget = Shared.TheTarget;
+  MCCodeEmitter *CE =
+      TheTarget->createMCCodeEmitter(*Shared.MCII, *Shared.MRI, Ctx);
+  MCAsmBackend *MAB =
+      TheTarget->createMCAsmBackend(*Shared.MRI, TripleName, MCPU);
+  std::unique_ptr<MCStreamer> Str(TheTarget->createMCObjectStreamer(
+      Shared.TheTriple, Ctx, *MAB, OS, CE, *Shared.STI,
+      Shared.MCOptions->MCRelaxAll,
+      Shared.MCOptions->MCIncrementalLinkerCompatible,
+      /*DWARFMustBeAtTheEnd*/ false));
+  if (NoExecStack)
+    Str->InitSections(true);
+
+  return AssembleInput(ProgName, TheTarget, SrcMgr, Ctx, *Str, *Shared.MAI,
+                       *Shared.STI, *Shared.MCII, *Shared.MCOptions);
+}
+
+/// Assemble each of the input files into an object file in the current
+/// directory, named after the input file, using up to -num-threads threads.
+static int assembleInParallel(const char *ProgName,
+                              const SharedTargetInfo &Shared) {
+  if (!OutputFilename.empty()) {
+    errs() << ProgName << ": error: cannot specify -o with multiple input "
+           << "files\n";
+    return 1;
+  }
+  if (Action != AC_Assemble || FileType != OFT_ObjectFile) {
+    errs() << ProgName << ": error: multiple input files can only be "
+           << "assembled to object files\n";
+    return 1;
+  }
+
+  struct InputResult {
+    SmallVector<char, 0> Obj;
+    std::string Diags;
+    int Res;
+  };
+  std::vector<InputResult> Results(InputFilenames.size());
+  {
+    ThreadPool Pool(NumThreads ? NumThreads
+                               : std::thread::hardware_concurrency());
+    for (size_t I = 0, E = InputFilenames.size(); I != E; ++I)
+      Pool.async([&, I]() {
+        raw_string_ostream ErrOS(Results[I].Diags);
+        Results[I].Res = assembleToObject(ProgName, Shared, InputFilenames[I],
+                                          Results[I].Obj, ErrOS);
+      });
+    Pool.wait();
+  }
+
+  // Report the diagnostics and write the outputs in input order, so the
+  // result doesn't depend on the number of threads.
+  int Res = 0;
+  for (size_t I = 0, E = InputFilenames.size(); I != E; ++I) {
+    InputResult &R = Results[I];
+    errs() << R.Diags;
+    if (R.Res) {
+      Res = R.Res;
+      continue;
+    }
+
+    SmallString<128> ObjName(sys::path::filename(InputFilenames[I]));
+    sys::path::replace_extension(ObjName, "o");
+    std::error_code EC;
+    tool_output_file Out(ObjName, EC, sys::fs::F_None);
+    if (EC) {
+      errs() << ObjName << ": " << EC.message() << '\n';
+      Res = 1;
+      continue;
+    }
+    Out.os().write(R.Obj.data(), R.Obj.size());
+    Out.keep();
+  }
+  return Res;
+}
+
 int main(int argc, char **argv) {
   // Print a stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -397,23 +554,6 @@ int main(int argc, char **argv) {
   // construct the Triple object.
   Triple TheTriple(TripleName);
 
-  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
-      MemoryBuffer::getFileOrSTDIN(InputFilename);
-  if (std::error_code EC = BufferPtr.getError()) {
-    errs() << InputFilename << ": " << EC.message() << '\n';
-    return 1;
-  }
-  MemoryBuffer *Buffer = BufferPtr->get();
-
-  SourceMgr SrcMgr;
-
-  // Tell SrcMgr about this buffer, which is what the parser will pick up.
-  SrcMgr.AddNewSourceBuffer(std::move(*BufferPtr), SMLoc());
-
-  // Record the location of the include directories so that the lexer can find
-  // it later.
-  SrcMgr.setIncludeDirs(IncludeDirs);
-
   std::unique_ptr<MCRegisterInfo> MRI(TheTarget->createMCRegInfo(TripleName));
   assert(MRI && "Unable to create target register info!");
 
@@ -431,16 +571,6 @@ int main(int argc, char **argv) {
     MAI->setCompressDebugSections(CompressDebugSections);
   }
 
-  // FIXME: This is not pretty. MCContext has a ptr to MCObjectFileInfo and
-  // MCObjectFileInfo needs a MCContext reference in order to initialize itself.
-  MCObjectFileInfo MOFI;
-  MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr);
-  MOFI.InitMCObjectFileInfo(TheTriple, PIC, CMModel, Ctx);
-
-  if (SaveTempLabels)
-    Ctx.setAllowTemporaryLabels(false);
-
-  Ctx.setGenDwarfForAssembly(GenDwarfForAssembly);
   // Default to 4 for dwarf version.
   unsigned DwarfVersion = MCOptions.DwarfVersion ? MCOptions.DwarfVersion : 4;
   if (DwarfVersion < 2 || DwarfVersion > 4) {
@@ -448,21 +578,6 @@ int main(int argc, char **argv) {
            << " is not supported." << '\n';
     return 1;
   }
-  Ctx.setDwarfVersion(DwarfVersion);
-  if (!DwarfDebugFlags.empty())
-    Ctx.setDwarfDebugFlags(StringRef(DwarfDebugFlags));
-  if (!DwarfDebugProducer.empty())
-    Ctx.setDwarfDebugProducer(StringRef(DwarfDebugProducer));
-  if (!DebugCompilationDir.empty())
-    Ctx.setCompilationDir(DebugCompilationDir);
-  else {
-    // If no compilation dir is set, try to use the current directory.
-    SmallString<128> CWD;
-    if (!sys::fs::current_path(CWD))
-      Ctx.setCompilationDir(CWD);
-  }
-  if (!MainFileName.empty())
-    Ctx.setMainFileName(MainFileName);
 
   // Package up features to be passed to target/subtarget
   std::string FeaturesStr;
@@ -473,6 +588,43 @@ int main(int argc, char **argv) {
     FeaturesStr = Features.getString();
   }
 
+  std::unique_ptr<MCInstrInfo> MCII(TheTarget->createMCInstrInfo());
+  std::unique_ptr<MCSubtargetInfo> STI(
+      TheTarget->createMCSubtargetInfo(TripleName, MCPU, FeaturesStr));
+
+  if (InputFilenames.size() > 1) {
+    SharedTargetInfo Shared = {TheTarget, TheTriple, MRI.get(), MAI.get(),
+                               MCII.get(), STI.get(), &MCOptions,
+                               DwarfVersion};
+    return assembleInParallel(ProgName, Shared);
+  }
+
+  StringRef InputFilename =
+      InputFilenames.empty() ? StringRef("-") : StringRef(InputFilenames[0]);
+  ErrorOr<std::unique_ptr<MemoryBuffer>> BufferPtr =
+      MemoryBuffer::getFileOrSTDIN(InputFilename);
+  if (std::error_code EC = BufferPtr.getError()) {
+    errs() << InputFilename << ": " << EC.message() << '\n';
+    return 1;
+  }
+  MemoryBuffer *Buffer = BufferPtr->get();
+
+  SourceMgr SrcMgr;
+
+  // Tell SrcMgr about this buffer, which is what the parser will pick up.
+  SrcMgr.AddNewSourceBuffer(std::move(*BufferPtr), SMLoc());
+
+  // Record the location of the include directories so that the lexer can find
+  // it later.
+  SrcMgr.setIncludeDirs(IncludeDirs);
+
+  // FIXME: This is not pretty. MCContext has a ptr to MCObjectFileInfo and
+  // MCObjectFileInfo needs a MCContext reference in order to initialize itself.
+  MCObjectFileInfo MOFI;
+  MCContext Ctx(MAI.get(), MRI.get(), &MOFI, &SrcMgr);
+  MOFI.InitMCObjectFileInfo(TheTriple, PIC, CMModel, Ctx);
+  configureContext(Ctx, DwarfVersion);
+
   std::unique_ptr<tool_output_file> Out = GetOutputStream();
   if (!Out)
     return 1;
@@ -481,10 +633,6 @@ int main(int argc, char **argv) {
   raw_pwrite_stream *OS = &Out->os();
   std::unique_ptr<MCStreamer> Str;
 
-  std::unique_ptr<MCInstrInfo> MCII(TheTarget->createMCInstrInfo());
-  std::unique_ptr<MCSubtargetInfo> STI(
-      TheTarget->createMCSubtargetInfo(TripleName, MCPU, FeaturesStr));
-
   MCInstPrinter *IP = nullptr;
   if (FileType == OFT_AssemblyFile) {
     IP = TheTarget->createMCInstPrinter(Triple(TripleName), OutputAsmVariant,
@@ -35,6 +35,7 @@
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Program.h"
 #include "llvm/Support/Signals.h"
@@ -44,6 +45,7 @@
 #include <cctype>
 #include <cerrno>
 #include <cstring>
+#include <mutex>
 #include <system_error>
 #include <vector>
 
@@ -168,18 +170,30 @@ cl::opt<bool> FormatMachOasHex("x", cl::desc("Print symbol entry in hex, "
 cl::opt<bool> NoLLVMBitcode("no-llvm-bc",
                             cl::desc("Disable LLVM bitcode reader"));
 
+cl::opt<unsigned> NumThreads("j",
+                             cl::desc("Number of archive members to process "
+                                      "in parallel"),
+                             cl::init(1));
+
 bool PrintAddress = true;
 
 bool MultipleFiles = false;
 
 bool HadError = false;
+// Serializes the error messages of archive members processed in parallel.
+std::mutex ErrorMutex;
 
 std::string ToolName;
 } // anonymous namespace
 
-static void error(Twine Message, Twine Path = Twine()) {
+static void reportError(StringRef Message) {
+  std::lock_guard<std::mutex> Lock(ErrorMutex);
   HadError = true;
-  errs() << ToolName << ": " << Path << ": " << Message << ".\n";
+  errs() << Message;
+}
+
+static void error(Twine Message, Twine Path = Twine()) {
+  reportError((ToolName + ": " + Path + ": " + Message + ".\n").str());
 }
 
 static bool error(std::error_code EC, Twine Path = Twine()) {
@@ -190,27 +204,33 @@ static bool error(std::error_code EC, Twine Path = Twine()) {
   return false;
 }
 
-// This version of error() prints the archive name and member name, for example:
-// "libx.a(foo.o)" after the ToolName before the error message.  It sets
-// HadError but returns allowing the code to move on to other archive members. 
-static void error(llvm::Error E, StringRef FileName, const Archive::Child &C) {
-  HadError = true;
-  errs() << ToolName << ": " << FileName;
+// Return the message of an error in an archive member, which has the archive
+// name and member name, for example: "libx.a(foo.o)" after the ToolName.
+static std::string getErrorMessage(llvm::Error E, StringRef FileName,
+                                   const Archive::Child &C) {
+  std::string Message;
+  raw_string_ostream OS(Message);
+  OS << ToolName << ": " << FileName;
 
   ErrorOr<StringRef> NameOrErr = C.getName();
   // TODO: if we have a error getting the name then it would be nice to print
   // the index of which archive member this is and or its offset in the
   // archive instead of "???" as the name.
   if (NameOrErr.getError())
-    errs() << "(" << "???" << ")";
+    OS << "(" << "???" << ")";
   else
-    errs() << "(" << NameOrErr.get() << ")";
+    OS << "(" << NameOrErr.get() << ")";
 
-  std::string Buf;
-  raw_string_ostream OS(Buf);
+  OS << " ";
   logAllUnhandledErrors(std::move(E), OS, "");
-  OS.flush();
-  errs() << " " << Buf << "\n";
+  OS << "\n";
+  return OS.str();
+}
+
+// This version of error() prints the archive name and member name.  It sets
+// HadError but returns allowing the code to move on to other archive members.
+static void error(llvm::Error E, StringRef FileName, const Archive::Child &C) {
+  reportError(getErrorMessage(std::move(E), FileName, C));
 }
 
 namespace {
@@ -256,9 +276,7 @@ static char isSymbolList64Bit(SymbolicFile &Obj) {
   return cast<ELFObjectFileBase>(Obj).getBytesInAddress() == 8;
 }
 
-static StringRef CurrentFilename;
 typedef std::vector<NMSymbol> SymbolListT;
-static SymbolListT SymbolList;
 
 static char getSymbolNMTypeChar(IRObjectFile &Obj, basic_symbol_iterator I);
 
@@ -267,9 +285,10 @@ static char getSymbolNMTypeChar(IRObjectFile &Obj, basic_symbol_iterator I);
 // the darwin format it produces the same output as darwin's nm(1) -m output
 // and when printing Mach-O symbols in hex it produces the same output as
 // darwin's nm(1) -x format.
-static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
-                              char *SymbolAddrStr, const char *printBlanks,
-                              const char *printDashes, const char *printFormat) {
+static void darwinPrintSymbol(raw_ostream &OS, SymbolicFile &Obj,
+                              SymbolListT::iterator I, char *SymbolAddrStr,
+                              const char *printBlanks, const char *printDashes,
+                              const char *printFormat) {
   MachO::mach_header H;
   MachO::mach_header_64 H_64;
   uint32_t Filetype = MachO::MH_OBJECT;
@@ -331,16 +350,16 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
   if (FormatMachOasHex) {
     char Str[18] = "";
     format(printFormat, NValue).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%02x", NType).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%02x", NSect).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%04x", NDesc).print(Str, sizeof(Str));
-    outs() << Str << ' ';
+    OS << Str << ' ';
     format("%08x", NStrx).print(Str, sizeof(Str));
-    outs() << Str << ' ';
-    outs() << I->Name << "\n";
+    OS << Str << ' ';
+    OS << I->Name << "\n";
     return;
   }
 
@@ -349,58 +368,58 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
       strcpy(SymbolAddrStr, printBlanks);
     if (Obj.isIR() && (NType & MachO::N_TYPE) == MachO::N_TYPE)
       strcpy(SymbolAddrStr, printDashes);
-    outs() << SymbolAddrStr << ' ';
+    OS << SymbolAddrStr << ' ';
   }
 
   switch (NType & MachO::N_TYPE) {
   case MachO::N_UNDF:
     if (NValue != 0) {
-      outs() << "(common) ";
+      OS << "(common) ";
       if (MachO::GET_COMM_ALIGN(NDesc) != 0)
-        outs() << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
+        OS << "(alignment 2^" << (int)MachO::GET_COMM_ALIGN(NDesc) << ") ";
     } else {
       if ((NType & MachO::N_TYPE) == MachO::N_PBUD)
-        outs() << "(prebound ";
+        OS << "(prebound ";
       else
-        outs() << "(";
+        OS << "(";
       if ((NDesc & MachO::REFERENCE_TYPE) ==
           MachO::REFERENCE_FLAG_UNDEFINED_LAZY)
-        outs() << "undefined [lazy bound]) ";
+        OS << "undefined [lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_PRIVATE_UNDEFINED_LAZY)
-        outs() << "undefined [private lazy bound]) ";
+        OS << "undefined [private lazy bound]) ";
       else if ((NDesc & MachO::REFERENCE_TYPE) ==
                MachO::REFERENCE_FLAG_PRIVATE_UNDEFINED_NON_LAZY)
-        outs() << "undefined [private]) ";
+        OS << "undefined [private]) ";
       else
-        outs() << "undefined) ";
+        OS << "undefined) ";
     }
     break;
   case MachO::N_ABS:
-    outs() << "(absolute) ";
+    OS << "(absolute) ";
     break;
   case MachO::N_INDR:
-    outs() << "(indirect) ";
+    OS << "(indirect) ";
     break;
   case MachO::N_SECT: {
     if (Obj.isIR()) {
       // For llvm bitcode files print out a fake section name using the values
       // use 1, 2 and 3 for section numbers as set above.
       if (NSect == 1)
-        outs() << "(LTO,CODE) ";
+        OS << "(LTO,CODE) ";
       else if (NSect == 2)
-        outs() << "(LTO,DATA) ";
+        OS << "(LTO,DATA) ";
       else if (NSect == 3)
-        outs() << "(LTO,RODATA) ";
+        OS << "(LTO,RODATA) ";
       else
-        outs() << "(?,?) ";
+        OS << "(?,?) ";
       break;
     }
     Expected<section_iterator> SecOrErr =
       MachO->getSymbolSection(I->Sym.getRawDataRefImpl());
     if (!SecOrErr) {
       consumeError(SecOrErr.takeError());
-      outs() << "(?,?) ";
+      OS << "(?,?) ";
       break;
     }
     section_iterator Sec = *SecOrErr;
@@ -408,67 +427,67 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
     StringRef SectionName;
     MachO->getSectionName(Ref, SectionName);
     StringRef SegmentName = MachO->getSectionFinalSegmentName(Ref);
-    outs() << "(" << SegmentName << "," << SectionName << ") ";
+    OS << "(" << SegmentName << "," << SectionName << ") ";
     break;
   }
   default:
-    outs() << "(?) ";
+    OS << "(?) ";
     break;
   }
 
   if (NType & MachO::N_EXT) {
     if (NDesc & MachO::REFERENCED_DYNAMICALLY)
-      outs() << "[referenced dynamically] ";
+      OS << "[referenced dynamically] ";
     if (NType & MachO::N_PEXT) {
       if ((NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF)
-        outs() << "weak private external ";
+        OS << "weak private external ";
       else
-        outs() << "private external ";
+        OS << "private external ";
     } else {
       if ((NDesc & MachO::N_WEAK_REF) == MachO::N_WEAK_REF ||
           (NDesc & MachO::N_WEAK_DEF) == MachO::N_WEAK_DEF) {
         if ((NDesc & (MachO::N_WEAK_REF | MachO::N_WEAK_DEF)) ==
             (MachO::N_WEAK_REF | MachO::N_WEAK_DEF))
-          outs() << "weak external automatically hidden ";
+          OS << "weak external automatically hidden ";
         else
-          outs() << "weak external ";
+          OS << "weak external ";
       } else
-        outs() << "external ";
+        OS << "external ";
     }
   } else {
     if (NType & MachO::N_PEXT)
-      outs() << "non-external (was a private external) ";
+      OS << "non-external (was a private external) ";
     else
-      outs() << "non-external ";
+      OS << "non-external ";
   }
 
   if (Filetype == MachO::MH_OBJECT &&
       (NDesc & MachO::N_NO_DEAD_STRIP) == MachO::N_NO_DEAD_STRIP)
-    outs() << "[no dead strip] ";
+    OS << "[no dead strip] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_SYMBOL_RESOLVER) == MachO::N_SYMBOL_RESOLVER)
-    outs() << "[symbol resolver] ";
+    OS << "[symbol resolver] ";
 
   if (Filetype == MachO::MH_OBJECT &&
       ((NType & MachO::N_TYPE) != MachO::N_UNDF) &&
       (NDesc & MachO::N_ALT_ENTRY) == MachO::N_ALT_ENTRY)
-    outs() << "[alt entry] ";
+    OS << "[alt entry] ";
 
   if ((NDesc & MachO::N_ARM_THUMB_DEF) == MachO::N_ARM_THUMB_DEF)
-    outs() << "[Thumb] ";
+    OS << "[Thumb] ";
 
   if ((NType & MachO::N_TYPE) == MachO::N_INDR) {
-    outs() << I->Name << " (for ";
+    OS << I->Name << " (for ";
     StringRef IndirectName;
     if (!MachO ||
         MachO->getIndirectName(I->Sym.getRawDataRefImpl(), IndirectName))
-      outs() << "?)";
+      OS << "?)";
     else
-      outs() << IndirectName << ")";
+      OS << IndirectName << ")";
   } else
-    outs() << I->Name;
+    OS << I->Name;
 
   if ((Flags & MachO::MH_TWOLEVEL) == MachO::MH_TWOLEVEL &&
       (((NType & MachO::N_TYPE) == MachO::N_UNDF && NValue == 0) ||
@@ -476,21 +495,21 @@ static void darwinPrintSymbol(SymbolicFile &Obj, SymbolListT::iterator I,
     uint32_t LibraryOrdinal = MachO::GET_LIBRARY_ORDINAL(NDesc);
     if (LibraryOrdinal != 0) {
       if (LibraryOrdinal == MachO::EXECUTABLE_ORDINAL)
-        outs() << " (from executable)";
+        OS << " (from executable)";
       else if (LibraryOrdinal == MachO::DYNAMIC_LOOKUP_ORDINAL)
-        outs() << " (dynamically looked up)";
+        OS << " (dynamically looked up)";
       else {
         StringRef LibraryName;
         if (!MachO ||
             MachO->getLibraryShortNameByIndex(LibraryOrdinal - 1, LibraryName))
-          outs() << " (from bad library ordinal " << LibraryOrdinal << ")";
+          OS << " (from bad library ordinal " << LibraryOrdinal << ")";
         else
-          outs() << " (from " << LibraryName << ")";
+          OS << " (from " << LibraryName << ")";
       }
     }
   }
 
-  outs() << "\n";
+  OS << "\n";
 }
 
 // Table that maps Darwin's Mach-O stab constants to strings to allow printing.
@@ -542,7 +561,8 @@ static const char *getDarwinStabString(uint8_t NType) {
 
 // darwinPrintStab() prints the n_sect, n_desc along with a symbolic name of
 // a stab n_type value in a Mach-O file.
-static void darwinPrintStab(MachOObjectFile *MachO, SymbolListT::iterator I) {
+static void darwinPrintStab(raw_ostream &OS, MachOObjectFile *MachO,
+                            SymbolListT::iterator I) {
   MachO::nlist_64 STE_64;
   MachO::nlist STE;
   uint8_t NType;
@@ -563,18 +583,19 @@ static void darwinPrintStab(MachOObjectFile *MachO, SymbolListT::iterator I) {
 
   char Str[18] = "";
   format("%02x", NSect).print(Str, sizeof(Str));
-  outs() << ' ' << Str << ' ';
+  OS << ' ' << Str << ' ';
   format("%04x", NDesc).print(Str, sizeof(Str));
-  outs() << Str << ' ';
+  OS << Str << ' ';
   if (const char *stabString = getDarwinStabString(NType))
     format("%5.5s", stabString).print(Str, sizeof(Str));
   else
     format("   %02x", NType).print(Str, sizeof(Str));
-  outs() << Str;
+  OS << Str;
 }
 
-static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
-                                   std::string ArchiveName,
+static void sortAndPrintSymbolList(raw_ostream &OS, SymbolListT &SymbolList,
+                                   StringRef CurrentFilename, SymbolicFile &Obj,
+                                   bool printName, std::string ArchiveName,
                                    std::string ArchitectureName) {
   if (!NoSort) {
     std::function<bool(const NMSymbol &, const NMSymbol &)> Cmp;
@@ -592,11 +613,11 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
 
   if (!PrintFileName) {
     if (OutputFormat == posix && MultipleFiles && printName) {
-      outs() << '\n' << CurrentFilename << ":\n";
+      OS << '\n' << CurrentFilename << ":\n";
     } else if (OutputFormat == bsd && MultipleFiles && printName) {
-      outs() << "\n" << CurrentFilename << ":\n";
+      OS << "\n" << CurrentFilename << ":\n";
     } else if (OutputFormat == sysv) {
-      outs() << "\n\nSymbols from " << CurrentFilename << ":\n\n"
+      OS << "\n\nSymbols from " << CurrentFilename << ":\n\n"
              << "Name                  Value   Class        Type"
              << "         Size   Line  Section\n";
     }
@@ -641,18 +662,18 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
       continue;
     if (PrintFileName) {
       if (!ArchitectureName.empty())
-        outs() << "(for architecture " << ArchitectureName << "):";
+        OS << "(for architecture " << ArchitectureName << "):";
       if (OutputFormat == posix && !ArchiveName.empty())
-        outs() << ArchiveName << "[" << CurrentFilename << "]: ";
+        OS << ArchiveName << "[" << CurrentFilename << "]: ";
       else {
         if (!ArchiveName.empty())
-          outs() << ArchiveName << ":";
-        outs() << CurrentFilename << ": ";
+          OS << ArchiveName << ":";
+        OS << CurrentFilename << ": ";
       }
     }
     if ((JustSymbolName || (UndefinedOnly && isa<MachOObjectFile>(Obj) &&
                             OutputFormat != darwin)) && OutputFormat != posix) {
-      outs() << I->Name << "\n";
+      OS << I->Name << "\n";
       continue;
     }
 
@@ -685,35 +706,33 @@ static void sortAndPrintSymbolList(SymbolicFile &Obj, bool printName,
     // OutputFormat bsd (see below).
     MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(&Obj);
     if ((OutputFormat == darwin || FormatMachOasHex) && (MachO || Obj.isIR())) {
-      darwinPrintSymbol(Obj, I, SymbolAddrStr, printBlanks, printDashes,
+      darwinPrintSymbol(OS, Obj, I, SymbolAddrStr, printBlanks, printDashes,
                         printFormat);
     } else if (OutputFormat == posix) {
-      outs() << I->Name << " " << I->TypeChar << " ";
+      OS << I->Name << " " << I->TypeChar << " ";
       if (MachO)
-        outs() << SymbolAddrStr << " " << "0" /* SymbolSizeStr */ << "\n";
+        OS << SymbolAddrStr << " " << "0" /* SymbolSizeStr */ << "\n";
       else
-        outs() << SymbolAddrStr << " " << SymbolSizeStr << "\n";
+        OS << SymbolAddrStr << " " << SymbolSizeStr << "\n";
     } else if (OutputFormat == bsd || (OutputFormat == darwin && !MachO)) {
       if (PrintAddress)
-        outs() << SymbolAddrStr << ' ';
+        OS << SymbolAddrStr << ' ';
       if (PrintSize) {
-        outs() << SymbolSizeStr;
-        outs() << ' ';
+        OS << SymbolSizeStr;
+        OS << ' ';
       }
-      outs() << I->TypeChar;
+      OS << I->TypeChar;
       if (I->TypeChar == '-' && MachO)
-        darwinPrintStab(MachO, I);
-      outs() << " " << I->Name << "\n";
+        darwinPrintStab(OS, MachO, I);
+      OS << " " << I->Name << "\n";
     } else if (OutputFormat == sysv) {
       std::string PaddedName(I->Name);
       while (PaddedName.length() < 20)
         PaddedName += " ";
-      outs() << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
+      OS << PaddedName << "|" << SymbolAddrStr << "|   " << I->TypeChar
              << "  |                  |" << SymbolSizeStr << "|     |\n";
     }
   }
-
-  SymbolList.clear();
 }
 
 static char getSymbolNMTypeChar(ELFObjectFileBase &Obj,
@@ -940,7 +959,8 @@ static unsigned getNsectInMachO(MachOObjectFile &Obj, BasicSymbolRef Sym) {
   return (STE.n_type & MachO::N_TYPE) == MachO::N_SECT ? STE.n_sect : 0;
 }
 
-static void dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
+static void dumpSymbolNamesFromObject(raw_ostream &OS, SymbolicFile &Obj,
+                                      bool printName,
                                       std::string ArchiveName = std::string(),
                                       std::string ArchitectureName =
                                         std::string()) {
@@ -955,8 +975,9 @@ static void dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
     Symbols =
         make_range<basic_symbol_iterator>(DynSymbols.begin(), DynSymbols.end());
   }
+  SymbolListT SymbolList;
   std::string NameBuffer;
-  raw_string_ostream OS(NameBuffer);
+  raw_string_ostream NameOS(NameBuffer);
   // If a "-s segname sectname" option was specified and this is a Mach-O
   // file get the section number for that section in this object file.
   unsigned int Nsect = 0;
@@ -998,33 +1019,32 @@ static void dumpSymbolNamesFromObject(SymbolicFile &Obj, bool printName,
       S.Address = *AddressOrErr;
     }
     S.TypeChar = getNMTypeChar(Obj, Sym);
-    std::error_code EC = Sym.printName(OS);
+    std::error_code EC = Sym.printName(NameOS);
     if (EC && MachO)
-      OS << "bad string index";
+      NameOS << "bad string index";
     else
       error(EC);
-    OS << '\0';
+    NameOS << '\0';
     S.Sym = Sym;
     SymbolList.push_back(S);
   }
 
-  OS.flush();
+  NameOS.flush();
   const char *P = NameBuffer.c_str();
   for (unsigned I = 0; I < SymbolList.size(); ++I) {
     SymbolList[I].Name = P;
     P += strlen(P) + 1;
   }
 
-  CurrentFilename = Obj.getFileName();
-  sortAndPrintSymbolList(Obj, printName, ArchiveName, ArchitectureName);
+  sortAndPrintSymbolList(OS, SymbolList, Obj.getFileName(), Obj, printName,
+                         ArchiveName, ArchitectureName);
 }
 
-// checkMachOAndArchFlags() checks to see if the SymbolicFile is a Mach-O file
-// and if it is and there is a list of architecture flags is specified then
-// check to make sure this Mach-O file is one of those architectures or all
-// architectures was specificed.  If not then an error is generated and this
-// routine returns false.  Else it returns true.
-static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
+// matchesArchFlags() checks to see if the SymbolicFile is a Mach-O file and if
+// it is and there is a list of architecture flags is specified then check to
+// make sure this Mach-O file is one of those architectures or all
+// architectures was specificed.
+static bool matchesArchFlags(SymbolicFile *O) {
   MachOObjectFile *MachO = dyn_cast<MachOObjectFile>(O);
 
   if (!MachO || ArchAll || ArchFlags.size() == 0)
@@ -1040,13 +1060,83 @@ static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
     H = MachO->MachOObjectFile::getHeader();
     T = MachOObjectFile::getArchTriple(H.cputype, H.cpusubtype);
   }
-  if (std::none_of(
-          ArchFlags.begin(), ArchFlags.end(),
-          [&](const std::string &Name) { return Name == T.getArchName(); })) {
-    error("No architecture specified", Filename);
-    return false;
+  return std::any_of(
+      ArchFlags.begin(), ArchFlags.end(),
+      [&](const std::string &Name) { return Name == T.getArchName(); });
+}
+
+// checkMachOAndArchFlags() generates an error and returns false if the
+// SymbolicFile does not match the architecture flags, see matchesArchFlags().
+static bool checkMachOAndArchFlags(SymbolicFile *O, std::string &Filename) {
+  if (matchesArchFlags(O))
+    return true;
+  error("No architecture specified", Filename);
+  return false;
+}
+
+static void printArchiveMemberName(raw_ostream &OS, SymbolicFile &O,
+                                   StringRef Filename) {
+  if (PrintFileName)
+    return;
+  OS << "\n";
+  if (isa<MachOObjectFile>(O))
+    OS << Filename << "(" << O.getFileName() << ")";
+  else
+    OS << O.getFileName();
+  OS << ":\n";
+}
+
+// dumpArchiveMembersInParallel() dumps the members of an archive with -j
+// threads, each with an LLVMContext of its own for the bitcode members, and
+// prints their symbols in the order of the archive.
+static void dumpArchiveMembersInParallel(Archive &A, std::string &Filename) {
+  std::vector<Archive::Child> Children;
+  std::error_code ChildEC;
+  for (Archive::child_iterator I = A.child_begin(), E = A.child_end(); I != E;
+       ++I) {
+    if ((ChildEC = I->getError()))
+      break;
+    Children.push_back(I->get());
   }
-  return true;
+
+  struct MemberOutput {
+    std::string Symbols;
+    std::string Error;
+    bool WrongArch = false;
+  };
+  std::vector<MemberOutput> Outputs(Children.size());
+  parallel_for_each_n(size_t(0), Children.size(), [&](size_t I) {
+    const Archive::Child &C = Children[I];
+    MemberOutput &Output = Outputs[I];
+    LLVMContext Context;
+    Expected<std::unique_ptr<Binary>> ChildOrErr = C.getAsBinary(&Context);
+    if (!ChildOrErr) {
+      if (auto E = isNotObjectErrorInvalidFileType(ChildOrErr.takeError()))
+        Output.Error = getErrorMessage(std::move(E), Filename, C);
+      return;
+    }
+    SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get());
+    if (!O)
+      return;
+    if (!matchesArchFlags(O)) {
+      Output.WrongArch = true;
+      return;
+    }
+    raw_string_ostream OS(Output.Symbols);
+    printArchiveMemberName(OS, *O, Filename);
+    dumpSymbolNamesFromObject(OS, *O, false, Filename);
+  });
+
+  for (MemberOutput &Output : Outputs) {
+    if (!Output.Error.empty())
+      reportError(Output.Error);
+    if (Output.WrongArch) {
+      error("No architecture specified", Filename);
+      return;
+    }
+    outs() << Output.Symbols;
+  }
+  error(ChildEC);
 }
 
 static void dumpSymbolNamesFromFile(std::string &Filename) {
@@ -1084,6 +1174,11 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
       }
     }
 
+    if (NumThreads > 1) {
+      dumpArchiveMembersInParallel(*A, Filename);
+      return;
+    }
+
     for (Archive::child_iterator I = A->child_begin(), E = A->child_end();
          I != E; ++I) {
       if (error(I->getError()))
@@ -1098,15 +1193,8 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
       if (SymbolicFile *O = dyn_cast<SymbolicFile>(&*ChildOrErr.get())) {
         if (!checkMachOAndArchFlags(O, Filename))
           return;
-        if (!PrintFileName) {
-          outs() << "\n";
-          if (isa<MachOObjectFile>(O)) {
-            outs() << Filename << "(" << O->getFileName() << ")";
-          } else
-            outs() << O->getFileName();
-          outs() << ":\n";
-        }
-        dumpSymbolNamesFromObject(*O, false, Filename);
+        printArchiveMemberName(outs(), *O, Filename);
+        dumpSymbolNamesFromObject(outs(), *O, false, Filename);
       }
     }
     return;
@@ -1139,7 +1227,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                          << I->getArchTypeName() << ")"
                          << ":\n";
               }
-              dumpSymbolNamesFromObject(Obj, false, ArchiveName,
+              dumpSymbolNamesFromObject(outs(), Obj, false, ArchiveName,
                                         ArchitectureName);
             } else if (ErrorOr<std::unique_ptr<Archive>> AOrErr =
                            I->getAsArchive()) {
@@ -1173,7 +1261,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                     }
                     outs() << ":\n";
                   }
-                  dumpSymbolNamesFromObject(*O, false, ArchiveName,
+                  dumpSymbolNamesFromObject(outs(), *O, false, ArchiveName,
                                             ArchitectureName);
                 }
               }
@@ -1201,7 +1289,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
           ArchiveName.clear();
           if (ObjOrErr) {
             ObjectFile &Obj = *ObjOrErr.get();
-            dumpSymbolNamesFromObject(Obj, false);
+            dumpSymbolNamesFromObject(outs(), Obj, false);
           } else if (ErrorOr<std::unique_ptr<Archive>> AOrErr =
                          I->getAsArchive()) {
             std::unique_ptr<Archive> &A = *AOrErr;
@@ -1227,7 +1315,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                   outs() << "\n" << A->getFileName() << "(" << O->getFileName()
                          << ")"
                          << ":\n";
-                dumpSymbolNamesFromObject(*O, false, ArchiveName);
+                dumpSymbolNamesFromObject(outs(), *O, false, ArchiveName);
               }
             }
           }
@@ -1259,7 +1347,8 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
             outs() << " (for architecture " << I->getArchTypeName() << ")";
           outs() << ":\n";
         }
-        dumpSymbolNamesFromObject(Obj, false, ArchiveName, ArchitectureName);
+        dumpSymbolNamesFromObject(outs(), Obj, false, ArchiveName,
+                                  ArchitectureName);
       } else if (ErrorOr<std::unique_ptr<Archive>> AOrErr = I->getAsArchive()) {
         std::unique_ptr<Archive> &A = *AOrErr;
         for (Archive::child_iterator AI = A->child_begin(), AE = A->child_end();
@@ -1290,7 +1379,8 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
                 outs() << ":" << O->getFileName();
               outs() << ":\n";
             }
-            dumpSymbolNamesFromObject(*O, false, ArchiveName, ArchitectureName);
+            dumpSymbolNamesFromObject(outs(), *O, false, ArchiveName,
+                                      ArchitectureName);
           }
         }
       }
@@ -1300,7 +1390,7 @@ static void dumpSymbolNamesFromFile(std::string &Filename) {
   if (SymbolicFile *O = dyn_cast<SymbolicFile>(&Bin)) {
     if (!checkMachOAndArchFlags(O, Filename))
       return;
-    dumpSymbolNamesFromObject(*O, true);
+    dumpSymbolNamesFromObject(outs(), *O, true);
   }
 }
 
@@ -1322,6 +1412,8 @@ int main(int argc, char **argv) {
   llvm::InitializeAllAsmParsers();
 
   ToolName = argv[0];
+  if (NumThreads > 1)
+    setParallelThreadCount(NumThreads);
   if (BSDFormat)
     OutputFormat = bsd;
   if (POSIXFormat)
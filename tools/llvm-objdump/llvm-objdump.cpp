@@ -54,10 +54,16 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/Timer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <condition_variable>
 #include <cstring>
+#include <mutex>
 #include <system_error>
 #include <utility>
 
@@ -109,6 +115,16 @@ cl::opt<bool>
 llvm::RawClangAST("raw-clang-ast",
     cl::desc("Dump the raw binary contents of the clang AST section"));
 
+static cl::opt<unsigned>
+DisassembleThreads("disassemble-threads", cl::init(1),
+    cl::desc("Number of threads to disassemble sections with. The output "
+             "is the same as with a single thread"));
+
+static cl::opt<bool>
+DisassembleBenchmark("disassemble-benchmark",
+    cl::desc("Disassemble without printing anything and report the number "
+             "of instructions disassembled per second"));
+
 static cl::opt<bool>
 MachOOpt("macho", cl::desc("Use MachO specific object file parser"));
 static cl::alias
@@ -1045,17 +1061,48 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
   for (std::pair<const SectionRef, SectionSymbolsTy> &SecSyms : AllSymbols)
     array_pod_sort(SecSyms.second.begin(), SecSyms.second.end());
 
+  // Collect the sections to disassemble. Each of them gets a dummy symbol at
+  // its start if there is none, before any section is disassembled, so that
+  // the symbol tables do not change while they are looked up by the jobs.
+  std::vector<SectionRef> Sections;
   for (const SectionRef &Section : ToolSectionFilter(*Obj)) {
     if (!DisassembleAll && (!Section.isText() || Section.isVirtual()))
       continue;
+    if (!Section.getSize())
+      continue;
+    Sections.push_back(Section);
+
+    StringRef name;
+    error(Section.getName(name));
+    SectionSymbolsTy &Symbols = AllSymbols[Section];
+    if (Symbols.empty() || Symbols[0].first != 0)
+      Symbols.insert(Symbols.begin(),
+                     std::make_pair(Section.getAddress(), name));
+  }
+
+  // In a non-relocatable object, branch targets are symbolized with a single
+  // table of all the symbols, sorted by address. Every section start is in it
+  // with an empty name, which sorts before the symbols at the same address: a
+  // target which is not preceded by a symbol of its own section has no name.
+  SectionSymbolsTy AddressTable;
+  if (!Obj->isRelocatableObject()) {
+    for (const auto &SecAddr : SectionAddresses)
+      AddressTable.emplace_back(SecAddr.first, StringRef());
+    for (const auto &SecSyms : AllSymbols)
+      AddressTable.insert(AddressTable.end(), SecSyms.second.begin(),
+                          SecSyms.second.end());
+    array_pod_sort(AddressTable.begin(), AddressTable.end());
+  }
 
+  // Disassemble Section to OS, returning the number of instructions.
+  auto DisassembleSection = [&](const SectionRef &Section,
+                                MCDisassembler &DisAsm, MCInstPrinter &IP,
+                                raw_ostream &OS) -> uint64_t {
     uint64_t SectionAddr = Section.getAddress();
     uint64_t SectSize = Section.getSize();
-    if (!SectSize)
-      continue;
 
     // Get the list of all the symbols in this section.
-    SectionSymbolsTy &Symbols = AllSymbols[Section];
+    const SectionSymbolsTy &Symbols = AllSymbols.find(Section)->second;
     std::vector<uint64_t> DataMappingSymsAddr;
     std::vector<uint64_t> TextMappingSymsAddr;
     if (Obj->isELF() && Obj->getArch() == Triple::aarch64) {
@@ -1075,11 +1122,11 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     // Make a list of all the relocations for this section.
     std::vector<RelocationRef> Rels;
     if (InlineRelocs) {
-      for (const SectionRef &RelocSec : SectionRelocMap[Section]) {
-        for (const RelocationRef &Reloc : RelocSec.relocations()) {
-          Rels.push_back(Reloc);
-        }
-      }
+      auto RelocSecs = SectionRelocMap.find(Section);
+      if (RelocSecs != SectionRelocMap.end())
+        for (const SectionRef &RelocSec : RelocSecs->second)
+          for (const RelocationRef &Reloc : RelocSec.relocations())
+            Rels.push_back(Reloc);
     }
 
     // Sort relocations by address.
@@ -1092,14 +1139,10 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
     }
     StringRef name;
     error(Section.getName(name));
-    outs() << "Disassembly of section ";
+    OS << "Disassembly of section ";
     if (!SegmentName.empty())
-      outs() << SegmentName << ",";
-    outs() << name << ':';
-
-    // If the section has no symbol at the start, just insert a dummy one.
-    if (Symbols.empty() || Symbols[0].first != 0)
-      Symbols.insert(Symbols.begin(), std::make_pair(SectionAddr, name));
+      OS << SegmentName << ",";
+    OS << name << ':';
 
     SmallString<40> Comments;
     raw_svector_ostream CommentStream(Comments);
@@ -1111,6 +1154,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
 
     uint64_t Size;
     uint64_t Index;
+    uint64_t NumInstructions = 0;
 
     std::vector<RelocationRef>::const_iterator rel_cur = Rels.begin();
     std::vector<RelocationRef>::const_iterator rel_end = Rels.end();
@@ -1141,7 +1185,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           End -= 4;
       }
 
-      outs() << '\n' << Symbols[si].second << ":\n";
+      OS << '\n' << Symbols[si].second << ":\n";
 
 #ifndef NDEBUG
       raw_ostream &DebugOut = DebugFlag ? dbgs() : nulls();
@@ -1163,23 +1207,23 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           if (DAI != DataMappingSymsAddr.end() && *DAI == Index) {
             // Switch to data.
             while (Index < End) {
-              outs() << format("%8" PRIx64 ":", SectionAddr + Index);
-              outs() << "\t";
+              OS << format("%8" PRIx64 ":", SectionAddr + Index);
+              OS << "\t";
               if (Index + 4 <= End) {
                 Stride = 4;
-                dumpBytes(Bytes.slice(Index, 4), outs());
-                outs() << "\t.word";
+                dumpBytes(Bytes.slice(Index, 4), OS);
+                OS << "\t.word";
               } else if (Index + 2 <= End) {
                 Stride = 2;
-                dumpBytes(Bytes.slice(Index, 2), outs());
-                outs() << "\t.short";
+                dumpBytes(Bytes.slice(Index, 2), OS);
+                OS << "\t.short";
               } else {
                 Stride = 1;
-                dumpBytes(Bytes.slice(Index, 1), outs());
-                outs() << "\t.byte";
+                dumpBytes(Bytes.slice(Index, 1), OS);
+                OS << "\t.byte";
               }
               Index += Stride;
-              outs() << "\n";
+              OS << "\n";
               auto TAI = std::lower_bound(TextMappingSymsAddr.begin(),
                                           TextMappingSymsAddr.end(), Index);
               if (TAI != TextMappingSymsAddr.end() && *TAI == Index)
@@ -1191,15 +1235,16 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         if (Index >= End)
           break;
 
-        bool Disassembled = DisAsm->getInstruction(Inst, Size, Bytes.slice(Index),
-                                                   SectionAddr + Index, DebugOut,
-                                                   CommentStream);
+        bool Disassembled = DisAsm.getInstruction(Inst, Size, Bytes.slice(Index),
+                                                  SectionAddr + Index, DebugOut,
+                                                  CommentStream);
         if (Size == 0)
           Size = 1;
-        PIP.printInst(*IP, Disassembled ? &Inst : nullptr,
+        ++NumInstructions;
+        PIP.printInst(IP, Disassembled ? &Inst : nullptr,
                       Bytes.slice(Index, Size),
-                      SectionAddr + Index, outs(), "", *STI);
-        outs() << CommentStream.str();
+                      SectionAddr + Index, OS, "", *STI);
+        OS << CommentStream.str();
         Comments.clear();
 
         // Try to resolve the target of a call, tail call, etc. to a specific
@@ -1215,45 +1260,31 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
             // In a non-relocatable object, the target may be in any section.
             //
             // N.B. We don't walk the relocations in the relocatable case yet.
-            auto *TargetSectionSymbols = &Symbols;
-            if (!Obj->isRelocatableObject()) {
-              auto SectionAddress = std::upper_bound(
-                  SectionAddresses.begin(), SectionAddresses.end(), Target,
-                  [](uint64_t LHS,
-                      const std::pair<uint64_t, SectionRef> &RHS) {
-                    return LHS < RHS.first;
-                  });
-              if (SectionAddress != SectionAddresses.begin()) {
-                --SectionAddress;
-                TargetSectionSymbols = &AllSymbols[SectionAddress->second];
-              } else {
-                TargetSectionSymbols = nullptr;
-              }
-            }
-
-            // Find the first symbol in the section whose offset is less than
-            // or equal to the target.
-            if (TargetSectionSymbols) {
-              auto TargetSym = std::upper_bound(
-                  TargetSectionSymbols->begin(), TargetSectionSymbols->end(),
-                  Target, [](uint64_t LHS,
-                              const std::pair<uint64_t, StringRef> &RHS) {
-                    return LHS < RHS.first;
-                  });
-              if (TargetSym != TargetSectionSymbols->begin()) {
-                --TargetSym;
-                uint64_t TargetAddress = std::get<0>(*TargetSym);
-                StringRef TargetName = std::get<1>(*TargetSym);
-                outs() << " <" << TargetName;
+            const SectionSymbolsTy &TargetSymbols =
+                Obj->isRelocatableObject() ? Symbols : AddressTable;
+
+            // Find the last symbol whose address is less than or equal to the
+            // target.
+            auto TargetSym = std::upper_bound(
+                TargetSymbols.begin(), TargetSymbols.end(), Target,
+                [](uint64_t LHS, const std::pair<uint64_t, StringRef> &RHS) {
+                  return LHS < RHS.first;
+                });
+            if (TargetSym != TargetSymbols.begin()) {
+              --TargetSym;
+              uint64_t TargetAddress = std::get<0>(*TargetSym);
+              StringRef TargetName = std::get<1>(*TargetSym);
+              if (!TargetName.empty()) {
+                OS << " <" << TargetName;
                 uint64_t Disp = Target - TargetAddress;
                 if (Disp)
-                  outs() << "+0x" << utohexstr(Disp);
-                outs() << '>';
+                  OS << "+0x" << utohexstr(Disp);
+                OS << '>';
               }
             }
           }
         }
-        outs() << "\n";
+        OS << "\n";
 
         // Print relocation for instruction.
         while (rel_cur != rel_end) {
@@ -1269,7 +1300,7 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
           if (addr >= Index + Size) break;
           rel_cur->getTypeName(name);
           error(getRelocationValueString(*rel_cur, val));
-          outs() << format(Fmt.data(), SectionAddr + addr) << name
+          OS << format(Fmt.data(), SectionAddr + addr) << name
                  << "\t" << val << "\n";
 
         skip_print_rel:
@@ -1277,7 +1308,81 @@ static void DisassembleObject(const ObjectFile *Obj, bool InlineRelocs) {
         }
       }
     }
+    return NumInstructions;
+  };
+
+  // With -disassemble-benchmark, everything is printed to a null stream, so
+  // the time spent decoding, printing and symbolizing is measured without
+  // the time spent writing the output.
+  std::atomic<uint64_t> NumInstructions(0);
+  double StartTime = TimeRecord::getCurrentTime(true).getWallTime();
+  auto ReportBenchmark = [&]() {
+    if (!DisassembleBenchmark)
+      return;
+    double Elapsed = TimeRecord::getCurrentTime(false).getWallTime() -
+                     StartTime;
+    uint64_t Count = NumInstructions;
+    outs() << "Disassembled " << Count << " instructions in "
+           << format("%.6f", Elapsed) << " seconds";
+    if (Elapsed > 0)
+      outs() << format(" (%.0f instructions/second)", Count / Elapsed);
+    outs() << '\n';
+  };
+
+  if (DisassembleThreads <= 1 || Sections.size() < 2 ||
+      !llvm_is_multithreaded()) {
+    for (const SectionRef &Section : Sections)
+      NumInstructions += DisassembleSection(
+          Section, *DisAsm, *IP, DisassembleBenchmark ? nulls() : outs());
+    ReportBenchmark();
+    return;
+  }
+
+  // Disassemble the sections in parallel. Disassemblers and instruction
+  // printers are not thread-safe, so every job sets up its own. The output of
+  // each section is buffered and printed in order as soon as it is complete.
+  std::vector<std::string> Outputs(Sections.size());
+  std::vector<bool> Finished(Sections.size());
+  std::mutex Lock;
+  std::condition_variable SectionFinished;
+  std::atomic<unsigned> NextSection(0);
+  ThreadPool Pool(std::min<unsigned>(DisassembleThreads, Sections.size()));
+  for (unsigned I = 0, E = std::min<unsigned>(DisassembleThreads,
+                                              Sections.size());
+       I != E; ++I) {
+    Pool.async([&]() {
+      MCContext JobCtx(AsmInfo.get(), MRI.get(), MOFI.get());
+      std::unique_ptr<MCDisassembler> JobDisAsm(
+          TheTarget->createMCDisassembler(*STI, JobCtx));
+      std::unique_ptr<MCInstPrinter> JobIP(TheTarget->createMCInstPrinter(
+          Triple(TripleName), AsmPrinterVariant, *AsmInfo, *MII, *MRI));
+      JobIP->setPrintImmHex(PrintImmHex);
+      for (unsigned Idx = NextSection++; Idx < Sections.size();
+           Idx = NextSection++) {
+        std::string Buffer;
+        raw_string_ostream OS(Buffer);
+        NumInstructions += DisassembleSection(
+            Sections[Idx], *JobDisAsm, *JobIP,
+            DisassembleBenchmark ? static_cast<raw_ostream &>(nulls()) : OS);
+        OS.flush();
+        std::lock_guard<std::mutex> Guard(Lock);
+        Outputs[Idx] = std::move(Buffer);
+        Finished[Idx] = true;
+        SectionFinished.notify_one();
+      }
+    });
+  }
+  for (unsigned Idx = 0, E = Sections.size(); Idx != E; ++Idx) {
+    std::string Output;
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      SectionFinished.wait(Guard, [&]() -> bool { return Finished[Idx]; });
+      Output = std::move(Outputs[Idx]);
+    }
+    outs() << Output;
   }
+  Pool.wait();
+  ReportBenchmark();
 }
 
 void llvm::PrintRelocations(const ObjectFile *Obj) {
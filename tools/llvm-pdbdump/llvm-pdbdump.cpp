@@ -120,6 +120,10 @@ cl::opt<bool> DumpTpiRecordBytes(
     "raw-tpi-record-bytes",
     cl::desc("dump CodeView type record raw bytes from TPI stream"),
     cl::cat(NativeOptions));
+cl::list<uint32_t> DumpTpiTypeIndexes(
+    "raw-tpi-type-index",
+    cl::desc("dump the raw bytes of the TPI type records of these indexes"),
+    cl::CommaSeparated, cl::cat(NativeOptions));
 cl::opt<bool>
     DumpIpiRecords("raw-ipi-records",
                    cl::desc("dump CodeView type records from IPI stream"),
@@ -511,9 +515,11 @@ static Error dumpTpiStream(ScopedPrinter &P, PDBFile &File,
 
   bool DumpRecordBytes = false;
   bool DumpRecords = false;
+  bool DumpTypeIndexes = false;
   StringRef Label;
   StringRef VerLabel;
   if (StreamIdx == StreamTPI) {
+    DumpTypeIndexes = !opts::DumpTpiTypeIndexes.empty();
     DumpRecordBytes = opts::DumpTpiRecordBytes;
     DumpRecords = opts::DumpTpiRecords;
     Label = "Type Info Stream (TPI)";
@@ -524,7 +530,8 @@ static Error dumpTpiStream(ScopedPrinter &P, PDBFile &File,
     Label = "Type Info Stream (IPI)";
     VerLabel = "IPI Version";
   }
-  if (!DumpRecordBytes && !DumpRecords && !opts::DumpModuleSyms)
+  if (!DumpRecordBytes && !DumpRecords && !DumpTypeIndexes &&
+      !opts::DumpModuleSyms)
     return Error::success();
 
   auto TpiS = (StreamIdx == StreamTPI) ? File.getPDBTpiStream()
@@ -571,6 +578,19 @@ static Error dumpTpiStream(ScopedPrinter &P, PDBFile &File,
       return make_error<RawError>(raw_error_code::corrupt_file,
                                   "TPI stream contained corrupt record");
   }
+
+  if (DumpTypeIndexes) {
+    ListScope L(P, "Type Index Lookups");
+    for (uint32_t Index : opts::DumpTpiTypeIndexes) {
+      auto Type = Tpi.getTypeRecord(codeview::TypeIndex(Index));
+      if (!Type)
+        return Type.takeError();
+      DictScope DD(P, "");
+      P.printHex("TypeIndex", Index);
+      P.printHex("Kind", unsigned(Type->Type));
+      P.printBinaryBlock("Bytes", Type->Data);
+    }
+  }
   P.flush();
   return Error::success();
 }
@@ -682,6 +702,8 @@ bool isRawDumpEnabled() {
     return true;
   if (opts::DumpIpiRecordBytes)
     return true;
+  if (!opts::DumpTpiTypeIndexes.empty())
+    return true;
   return false;
 }
 
@@ -29,12 +29,15 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
+#include <mutex>
+#include <thread>
 
 using namespace llvm;
 
-enum ProfileFormat { PF_None = 0, PF_Text, PF_Binary, PF_GCC };
+enum ProfileFormat { PF_None = 0, PF_Text, PF_Binary, PF_GCC, PF_Ext_Binary };
 
 static void exitWithError(const Twine &Message, StringRef Whence = "",
                           StringRef Hint = "") {
@@ -117,9 +120,97 @@ struct WeightedFile {
 };
 typedef SmallVector<WeightedFile, 5> WeightedFileVector;
 
+/// A context for merging a contiguous shard of the instrumentation profile
+/// inputs into its own writer.
+struct WriterContext {
+  InstrProfWriter Writer;
+  /// The first hard error encountered while loading the shard, if any.
+  Error Err;
+  /// The input responsible for \c Err.
+  StringRef ErrWhence;
+  /// Guards the diagnostics that are shared between all the contexts.
+  std::mutex &ErrLock;
+  SmallSet<instrprof_error, 4> &WriterErrorCodes;
+
+  WriterContext(bool IsSparse, std::mutex &ErrLock,
+                SmallSet<instrprof_error, 4> &WriterErrorCodes)
+      : Writer(IsSparse), Err(Error::success()), ErrLock(ErrLock),
+        WriterErrorCodes(WriterErrorCodes) {}
+};
+
+/// Report a soft error hit while adding a record to a writer context.
+static void reportWriterError(Error E, WriterContext *WC,
+                              StringRef WhenceFile = "",
+                              StringRef WhenceFunction = "") {
+  // Only show hint the first time an error occurs.
+  instrprof_error IPE = InstrProfError::take(std::move(E));
+  std::lock_guard<std::mutex> ErrGuard(WC->ErrLock);
+  bool FirstTime = WC->WriterErrorCodes.insert(IPE).second;
+  handleMergeWriterError(make_error<InstrProfError>(IPE), WhenceFile,
+                         WhenceFunction, FirstTime);
+}
+
+static Error makeProfileKindMismatchError() {
+  return make_error<StringError>(
+      "Merge IR generated profile with Clang generated profile.",
+      std::error_code());
+}
+
+/// Load the given inputs, in order, into the writer context \p WC.
+static void loadInputs(ArrayRef<WeightedFile> Inputs, WriterContext *WC) {
+  // If there's a pending hard error, don't do more work.
+  if (WC->Err)
+    return;
+
+  for (const auto &Input : Inputs) {
+    WC->ErrWhence = Input.Filename;
+
+    auto ReaderOrErr = InstrProfReader::create(Input.Filename);
+    if ((WC->Err = ReaderOrErr.takeError()))
+      return;
+
+    auto Reader = std::move(ReaderOrErr.get());
+    bool IsIRProfile = Reader->isIRLevelProfile();
+    if (Error E = WC->Writer.setIsIRLevelProfile(IsIRProfile)) {
+      consumeError(std::move(E));
+      WC->Err = makeProfileKindMismatchError();
+      WC->ErrWhence = "";
+      return;
+    }
+
+    for (auto &I : *Reader) {
+      const StringRef FuncName = I.Name;
+      if (Error E = WC->Writer.addRecord(std::move(I), Input.Weight))
+        reportWriterError(std::move(E), WC, Input.Filename, FuncName);
+    }
+    if (Reader->hasError()) {
+      WC->Err = Reader->getError();
+      return;
+    }
+  }
+}
+
+/// Merge the writer context \p Src into \p Dst. \p Src must hold inputs that
+/// come after the ones held by \p Dst, so that the result is the same as if
+/// all the inputs had been merged serially.
+static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
+  // Once a context has hit a hard error it only needs to be reported.
+  if (Dst->Err)
+    return;
+
+  if (Error E = Dst->Writer.mergeRecordsFromWriter(
+          std::move(Src->Writer),
+          [&](Error E) { reportWriterError(std::move(E), Dst); })) {
+    consumeError(std::move(E));
+    Dst->Err = makeProfileKindMismatchError();
+    Dst->ErrWhence = "";
+  }
+}
+
 static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               StringRef OutputFilename,
-                              ProfileFormat OutputFormat, bool OutputSparse) {
+                              ProfileFormat OutputFormat, bool OutputSparse,
+                              unsigned NumThreads) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -131,30 +222,56 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
   if (EC)
     exitWithErrorCode(EC, OutputFilename);
 
-  InstrProfWriter Writer(OutputSparse);
+  std::mutex ErrorLock;
   SmallSet<instrprof_error, 4> WriterErrorCodes;
-  for (const auto &Input : Inputs) {
-    auto ReaderOrErr = InstrProfReader::create(Input.Filename);
-    if (Error E = ReaderOrErr.takeError())
-      exitWithError(std::move(E), Input.Filename);
 
-    auto Reader = std::move(ReaderOrErr.get());
-    bool IsIRProfile = Reader->isIRLevelProfile();
-    if (Writer.setIsIRLevelProfile(IsIRProfile))
-      exitWithError("Merge IR generated profile with Clang generated profile.");
-
-    for (auto &I : *Reader) {
-      if (Error E = Writer.addRecord(std::move(I), Input.Weight)) {
-        // Only show hint the first time an error occurs.
-        instrprof_error IPE = InstrProfError::take(std::move(E));
-        bool firstTime = WriterErrorCodes.insert(IPE).second;
-        handleMergeWriterError(make_error<InstrProfError>(IPE), Input.Filename,
-                               I.Name, firstTime);
-      }
+  // If NumThreads is not specified, auto-detect a good default.
+  if (NumThreads == 0)
+    NumThreads = std::max(1U, std::min(std::thread::hardware_concurrency(),
+                                       unsigned(Inputs.size() / 2)));
+  NumThreads = std::max(1U, std::min(NumThreads, unsigned(Inputs.size())));
+
+  // Initialize the writer contexts. Each context gets a contiguous shard of
+  // the inputs so that the contexts can be reduced in input order.
+  SmallVector<std::unique_ptr<WriterContext>, 4> Contexts;
+  for (unsigned I = 0; I < NumThreads; ++I)
+    Contexts.emplace_back(llvm::make_unique<WriterContext>(
+        OutputSparse, ErrorLock, WriterErrorCodes));
+
+  if (NumThreads == 1) {
+    loadInputs(Inputs, Contexts[0].get());
+  } else {
+    ThreadPool Pool(NumThreads);
+
+    // Load the shards in parallel.
+    for (unsigned I = 0; I < NumThreads; ++I) {
+      size_t Begin = Inputs.size() * I / NumThreads;
+      size_t End = Inputs.size() * (I + 1) / NumThreads;
+      ArrayRef<WeightedFile> Shard =
+          makeArrayRef(Inputs).slice(Begin, End - Begin);
+      Pool.async([Shard, I, &Contexts]() {
+        loadInputs(Shard, Contexts[I].get());
+      });
+    }
+    Pool.wait();
+
+    // Reduce the contexts pairwise (~ lg(NumThreads) serial steps), always
+    // merging a context into its left neighbour.
+    for (unsigned Stride = 1; Stride < NumThreads; Stride *= 2) {
+      for (unsigned I = 0; I + Stride < NumThreads; I += 2 * Stride)
+        Pool.async(mergeWriterContexts, Contexts[I].get(),
+                   Contexts[I + Stride].get());
+      Pool.wait();
     }
-    if (Reader->hasError())
-      exitWithError(Reader->getError(), Input.Filename);
   }
+
+  // Handle deferred hard errors. The contexts are ordered by input, so this
+  // reports the same error as a serial merge would have.
+  for (std::unique_ptr<WriterContext> &WC : Contexts)
+    if (WC->Err)
+      exitWithError(std::move(WC->Err), WC->ErrWhence);
+
+  InstrProfWriter &Writer = Contexts[0]->Writer;
   if (OutputFormat == PF_Text)
     Writer.writeText(Output);
   else
@@ -163,7 +280,7 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
 
 static sampleprof::SampleProfileFormat FormatMap[] = {
     sampleprof::SPF_None, sampleprof::SPF_Text, sampleprof::SPF_Binary,
-    sampleprof::SPF_GCC};
+    sampleprof::SPF_GCC, sampleprof::SPF_Ext_Binary};
 
 static void mergeSampleProfile(const WeightedFileVector &Inputs,
                                StringRef OutputFilename,
@@ -244,10 +361,18 @@ static int merge_main(int argc, const char *argv[]) {
                  clEnumValN(PF_Text, "text", "Text encoding"),
                  clEnumValN(PF_GCC, "gcc",
                             "GCC encoding (only meaningful for -sample)"),
+                 clEnumValN(PF_Ext_Binary, "extbinary",
+                            "Indexed binary encoding (only meaningful for "
+                            "-sample)"),
                  clEnumValEnd));
 
   cl::opt<bool> OutputSparse("sparse", cl::init(false),
       cl::desc("Generate a sparse profile (only meaningful for -instr)"));
+  cl::opt<unsigned> NumThreads(
+      "num-threads", cl::init(0),
+      cl::desc("Number of merge threads to use (default: autodetect)"));
+  cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
+                        cl::aliasopt(NumThreads));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
@@ -263,7 +388,7 @@ static int merge_main(int argc, const char *argv[]) {
 
   if (ProfileKind == instr)
     mergeInstrProfile(WeightedInputs, OutputFilename, OutputFormat,
-                      OutputSparse);
+                      OutputSparse, NumThreads);
   else
     mergeSampleProfile(WeightedInputs, OutputFilename, OutputFormat);
 
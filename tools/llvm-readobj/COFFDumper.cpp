@@ -1009,6 +1009,10 @@ void COFFDumper::printFileNameForOffset(StringRef Label, uint32_t FileOffset) {
 }
 
 void COFFDumper::mergeCodeViewTypes(MemoryTypeTableBuilder &CVTypes) {
+  // Merge the type sections of the object together, as they go to the same
+  // type stream.
+  std::vector<std::unique_ptr<ByteStream>> Streams;
+  std::vector<CVTypeArray> TypeArrays;
   for (const SectionRef &S : Obj->sections()) {
     StringRef SectionName;
     error(S.getName(SectionName));
@@ -1021,19 +1025,20 @@ void COFFDumper::mergeCodeViewTypes(MemoryTypeTableBuilder &CVTypes) {
         error(object_error::parse_failed);
       ArrayRef<uint8_t> Bytes(reinterpret_cast<const uint8_t *>(Data.data()),
                               Data.size());
-      ByteStream Stream(Bytes);
+      Streams.push_back(llvm::make_unique<ByteStream>(Bytes));
       CVTypeArray Types;
-      StreamReader Reader(Stream);
+      StreamReader Reader(*Streams.back());
       if (auto EC = Reader.readArray(Types, Reader.getLength())) {
         consumeError(std::move(EC));
         W.flush();
         error(object_error::parse_failed);
       }
-
-      if (!mergeTypeStreams(CVTypes, Types))
-        return error(object_error::parse_failed);
+      TypeArrays.push_back(Types);
     }
   }
+
+  if (!mergeTypeStreams(CVTypes, TypeArrays))
+    return error(object_error::parse_failed);
 }
 
 void COFFDumper::printCodeViewTypeSection(StringRef SectionName,
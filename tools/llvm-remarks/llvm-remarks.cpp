@@ -0,0 +1,119 @@
+//===-- llvm-remarks: print and aggregate binary optimization remarks -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program reads the optimization remarks that were streamed with
+// -pass-remarks-output, and prints them as text, or prints how many times
+// each remark occurs across all the input files.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/RemarkStreamer.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFilenames(cl::Positional, cl::OneOrMore,
+                                            cl::desc("<remark files>"));
+
+static cl::opt<bool>
+    Aggregate("aggregate",
+              cl::desc("Print the number of occurrences of each remark, "
+                       "by decreasing count, instead of the remarks"));
+
+static cl::opt<std::string>
+    PassFilter("pass", cl::desc("Only consider the remarks of this pass"),
+               cl::value_desc("pass name"));
+
+namespace {
+/// \brief The remarks that are the same but for their function and location.
+struct RemarkGroup {
+  RemarkType Type;
+  std::string PassName;
+  std::string Message;
+  uint64_t Count = 0;
+};
+} // end anonymous namespace
+
+static void printRemark(const Remark &R) {
+  if (R.File.empty())
+    outs() << "<unknown>:0:0";
+  else
+    outs() << R.File << ':' << R.Line << ':' << R.Column;
+  outs() << ": " << getRemarkTypeName(R.Type) << ": " << R.PassName << ": "
+         << R.FunctionName << ": " << R.Message << '\n';
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  cl::ParseCommandLineOptions(argc, argv, "optimization remark reader\n");
+
+  StringMap<RemarkGroup> Groups;
+  for (const std::string &Filename : InputFilenames) {
+    ErrorOr<std::unique_ptr<MemoryBuffer>> BufferOrErr =
+        MemoryBuffer::getFileOrSTDIN(Filename);
+    if (std::error_code EC = BufferOrErr.getError()) {
+      errs() << argv[0] << ": " << Filename << ": " << EC.message() << '\n';
+      return 1;
+    }
+
+    Error E = parseRemarks((*BufferOrErr)->getBuffer(), [&](const Remark &R) {
+      if (!PassFilter.empty() && R.PassName != PassFilter)
+        return;
+      if (!Aggregate)
+        return printRemark(R);
+      std::string Key = R.PassName;
+      Key += '\0';
+      Key += R.Message;
+      Key += '\0';
+      Key += char(R.Type);
+      RemarkGroup &G = Groups[Key];
+      if (!G.Count) {
+        G.Type = R.Type;
+        G.PassName = R.PassName;
+        G.Message = R.Message;
+      }
+      ++G.Count;
+    });
+    if (E) {
+      logAllUnhandledErrors(std::move(E), errs(),
+                            (Twine(argv[0]) + ": " + Filename + ": ").str());
+      return 1;
+    }
+  }
+
+  if (!Aggregate)
+    return 0;
+
+  std::vector<const RemarkGroup *> Sorted;
+  for (auto &Entry : Groups)
+    Sorted.push_back(&Entry.second);
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const RemarkGroup *A, const RemarkGroup *B) {
+              if (A->Count != B->Count)
+                return A->Count > B->Count;
+              return std::tie(A->PassName, A->Message, A->Type) <
+                     std::tie(B->PassName, B->Message, B->Type);
+            });
+  for (const RemarkGroup *G : Sorted)
+    outs() << G->Count << ' ' << getRemarkTypeName(G->Type) << ": "
+           << G->PassName << ": " << G->Message << '\n';
+  return 0;
+}
@@ -35,6 +35,7 @@
 #include "llvm/Support/Signals.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <list>
 #include <system_error>
@@ -138,6 +139,18 @@ PrintAllocationRequests("print-alloc-requests",
                                  "manager by RuntimeDyld"),
                         cl::Hidden);
 
+static cl::opt<unsigned>
+RelocationThreads("relocation-threads",
+                  cl::desc("Apply relocations using this many threads"),
+                  cl::init(0));
+
+static cl::opt<unsigned>
+MinParallelRelocations("min-parallel-relocations",
+                       cl::desc("Apply fewer relocations than this on the main "
+                                "thread, even with -relocation-threads"),
+                       cl::init(4096),
+                       cl::Hidden);
+
 /* *** */
 
 // A trivial memory manager that doesn't do anything fancy, just uses the
@@ -400,6 +413,16 @@ static void doPreallocation(TrivialMemoryManager &MemMgr) {
     MemMgr.preallocateSlab(PreallocMemory);
 }
 
+// Let Dyld apply relocations on a thread pool if -relocation-threads was
+// given. The pool has to be kept alive for as long as Dyld is used.
+static std::unique_ptr<ThreadPool> setUpRelocationThreads(RuntimeDyld &Dyld) {
+  if (!RelocationThreads)
+    return nullptr;
+  std::unique_ptr<ThreadPool> Pool(new ThreadPool(RelocationThreads));
+  Dyld.setRelocationThreadPool(Pool.get(), MinParallelRelocations);
+  return Pool;
+}
+
 static int executeInput() {
   // Load any dylibs requested on the command line.
   loadDylibs();
@@ -408,6 +431,7 @@ static int executeInput() {
   TrivialMemoryManager MemMgr;
   doPreallocation(MemMgr);
   RuntimeDyld Dyld(MemMgr, MemMgr);
+  auto RelocationPool = setUpRelocationThreads(Dyld);
 
   // If we don't have any input files, read from stdin.
   if (!InputFileList.size())
@@ -673,6 +697,7 @@ static int linkAndVerify() {
   doPreallocation(MemMgr);
   RuntimeDyld Dyld(MemMgr, MemMgr);
   Dyld.setProcessAllSections(true);
+  auto RelocationPool = setUpRelocationThreads(Dyld);
   RuntimeDyldChecker Checker(Dyld, Disassembler.get(), InstPrinter.get(),
                              llvm::dbgs());
 
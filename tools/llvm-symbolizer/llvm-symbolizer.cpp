@@ -26,10 +26,12 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <vector>
 
 using namespace llvm;
 using namespace symbolize;
@@ -74,6 +76,11 @@ static cl::list<std::string>
 ClDsymHint("dsym-hint", cl::ZeroOrMore,
            cl::desc("Path to .dSYM bundles to search for debug info for the "
                     "object files"));
+static cl::opt<std::string>
+    ClIndexCacheDir("index-cache-dir", cl::init(""),
+                    cl::desc("Directory in which to cache address indexes of "
+                             "the object files, keyed by build ID"));
+
 static cl::opt<bool>
     ClPrintAddress("print-address", cl::init(false),
                    cl::desc("Show address before line information"));
@@ -86,10 +93,26 @@ static cl::opt<int> ClPrintSourceContextLines(
     "print-source-context-lines", cl::init(0),
     cl::desc("Print N number of source file context"));
 
-static bool error(std::error_code ec) {
+static cl::opt<bool>
+    ClBatch("batch", cl::init(false),
+            cl::desc("Read requests in batches terminated by an empty line "
+                     "and symbolize each batch in parallel"));
+
+static cl::opt<unsigned>
+    ClNumThreads("num-threads", cl::init(0),
+                 cl::desc("Number of threads to use in batch mode "
+                          "(0 = one per hardware thread)"));
+static cl::alias ClNumThreadsA("j", cl::desc("Alias for -num-threads"),
+                               cl::aliasopt(ClNumThreads));
+
+static cl::opt<unsigned> ClMaxCachedModules(
+    "max-cached-modules", cl::init(0),
+    cl::desc("Maximum number of object files to keep loaded (0 = no limit)"));
+
+static bool error(std::error_code ec, raw_ostream &ErrOS) {
   if (!ec)
     return false;
-  errs() << "LLVMSymbolizer: error reading file: " << ec.message() << ".\n";
+  ErrOS << "LLVMSymbolizer: error reading file: " << ec.message() << ".\n";
   return true;
 }
 
@@ -136,6 +159,42 @@ static bool parseCommand(StringRef InputString, bool &IsData,
   return !StringRef(pos, offset_length).getAsInteger(0, ModuleOffset);
 }
 
+// Symbolize the request in InputString and print the result to OS, or echo
+// the request if it can't be parsed.
+static void symbolizeInput(LLVMSymbolizer &Symbolizer, StringRef InputString,
+                           raw_ostream &OS, raw_ostream &ErrOS) {
+  bool IsData = false;
+  std::string ModuleName;
+  uint64_t ModuleOffset = 0;
+  if (!parseCommand(InputString, IsData, ModuleName, ModuleOffset)) {
+    OS << InputString;
+    return;
+  }
+
+  DIPrinter Printer(OS, ClPrintFunctions != FunctionNameKind::None,
+                    ClPrettyPrint, ClPrintSourceContextLines);
+  if (ClPrintAddress) {
+    OS << "0x";
+    OS.write_hex(ModuleOffset);
+    StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
+    OS << Delimiter;
+  }
+  if (IsData) {
+    auto ResOrErr = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
+    Printer << (error(ResOrErr.getError(), ErrOS) ? DIGlobal()
+                                                  : ResOrErr.get());
+  } else if (ClPrintInlining) {
+    auto ResOrErr = Symbolizer.symbolizeInlinedCode(ModuleName, ModuleOffset);
+    Printer << (error(ResOrErr.getError(), ErrOS) ? DIInliningInfo()
+                                                  : ResOrErr.get());
+  } else {
+    auto ResOrErr = Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
+    Printer << (error(ResOrErr.getError(), ErrOS) ? DILineInfo()
+                                                  : ResOrErr.get());
+  }
+  OS << "\n";
+}
+
 int main(int argc, char **argv) {
   // Print stack trace if we signal out.
   sys::PrintStackTraceOnErrorSignal();
@@ -147,6 +206,8 @@ int main(int argc, char **argv) {
   cl::ParseCommandLineOptions(argc, argv, "llvm-symbolizer\n");
   LLVMSymbolizer::Options Opts(ClPrintFunctions, ClUseSymbolTable, ClDemangle,
                                ClUseRelativeAddress, ClDefaultArch);
+  Opts.IndexCacheDir = ClIndexCacheDir;
+  Opts.MaxCachedModules = ClMaxCachedModules;
 
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
@@ -158,43 +219,51 @@ int main(int argc, char **argv) {
   }
   LLVMSymbolizer Symbolizer(Opts);
 
-  DIPrinter Printer(outs(), ClPrintFunctions != FunctionNameKind::None,
-                    ClPrettyPrint, ClPrintSourceContextLines);
-
   const int kMaxInputStringLength = 1024;
   char InputString[kMaxInputStringLength];
 
-  while (true) {
-    if (!fgets(InputString, sizeof(InputString), stdin))
-      break;
-
-    bool IsData = false;
-    std::string ModuleName;
-    uint64_t ModuleOffset = 0;
-    if (!parseCommand(StringRef(InputString), IsData, ModuleName,
-                      ModuleOffset)) {
-      outs() << InputString;
-      continue;
+  if (!ClBatch) {
+    while (fgets(InputString, sizeof(InputString), stdin)) {
+      symbolizeInput(Symbolizer, InputString, outs(), errs());
+      outs().flush();
     }
+    return 0;
+  }
 
-    if (ClPrintAddress) {
-      outs() << "0x";
-      outs().write_hex(ModuleOffset);
-      StringRef Delimiter = (ClPrettyPrint == true) ? ": " : "\n";
-      outs() << Delimiter;
+  // In batch mode, the requests of a batch are symbolized concurrently and
+  // the results are printed in the order of the requests once the whole batch
+  // is done. The loaded modules persist across batches, so that a long-running
+  // symbolizer can serve many clients over a pipe.
+  std::unique_ptr<ThreadPool> Pool(ClNumThreads ? new ThreadPool(ClNumThreads)
+                                                : new ThreadPool());
+  std::vector<std::string> Inputs;
+  bool AtEOF = false;
+  while (!AtEOF) {
+    Inputs.clear();
+    while (true) {
+      if (!fgets(InputString, sizeof(InputString), stdin)) {
+        AtEOF = true;
+        break;
+      }
+      if (StringRef(InputString).trim().empty())
+        break;
+      Inputs.push_back(InputString);
     }
-    if (IsData) {
-      auto ResOrErr = Symbolizer.symbolizeData(ModuleName, ModuleOffset);
-      Printer << (error(ResOrErr.getError()) ? DIGlobal() : ResOrErr.get());
-    } else if (ClPrintInlining) {
-      auto ResOrErr = Symbolizer.symbolizeInlinedCode(ModuleName, ModuleOffset);
-      Printer << (error(ResOrErr.getError()) ? DIInliningInfo()
-                                             : ResOrErr.get());
-    } else {
-      auto ResOrErr = Symbolizer.symbolizeCode(ModuleName, ModuleOffset);
-      Printer << (error(ResOrErr.getError()) ? DILineInfo() : ResOrErr.get());
+
+    std::vector<std::string> Results(Inputs.size());
+    std::vector<std::string> Errors(Inputs.size());
+    for (size_t I = 0, E = Inputs.size(); I != E; ++I)
+      Pool->async([&, I]() {
+        raw_string_ostream OS(Results[I]);
+        raw_string_ostream ErrOS(Errors[I]);
+        symbolizeInput(Symbolizer, Inputs[I], OS, ErrOS);
+      });
+    Pool->wait();
+
+    for (size_t I = 0, E = Inputs.size(); I != E; ++I) {
+      errs() << Errors[I];
+      outs() << Results[I];
     }
-    outs() << "\n";
     outs().flush();
   }
 
@@ -31,6 +31,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/LegacyPassNameParser.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/RemarkStreamer.h"
 #include "llvm/IR/Verifier.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/InitializePasses.h"
@@ -101,6 +102,12 @@ NoVerify("disable-verify", cl::desc("Do not run the verifier"), cl::Hidden);
 static cl::opt<bool>
 VerifyEach("verify-each", cl::desc("Verify after each transform"));
 
+static cl::opt<bool> ParallelVerifier(
+    "parallel-verifier",
+    cl::desc("Verify the function bodies in parallel wherever opt runs the "
+             "verifier (a module pass, see -verify-parallel)"),
+    cl::Hidden);
+
 static cl::opt<bool>
     DisableDITypeMap("disable-debug-info-type-map",
                      cl::desc("Don't use a uniquing type map for debug info"));
@@ -215,13 +222,25 @@ static cl::opt<bool> DiscardValueNames(
     cl::desc("Discard names from Value (other than GlobalValue)."),
     cl::init(false), cl::Hidden);
 
+static cl::opt<std::string> RemarksFilename(
+    "pass-remarks-output",
+    cl::desc("Write all the optimization remarks to this file, in the binary "
+             "remark format read by llvm-remarks"),
+    cl::value_desc("filename"));
+
+static Pass *createVerifier() {
+  if (ParallelVerifier)
+    return createParallelVerifierPass();
+  return createVerifierPass();
+}
+
 static inline void addPass(legacy::PassManagerBase &PM, Pass *P) {
   // Add the pass to the pass manager...
   PM.add(P);
 
   // If we are verifying all of the intermediate steps, add the verifier...
   if (VerifyEach)
-    PM.add(createVerifierPass());
+    PM.add(createVerifier());
 }
 
 /// This routine adds optimization passes based on selected optimization level,
@@ -383,6 +402,21 @@ int main(int argc, char **argv) {
   if (!DisableDITypeMap)
     Context.enableDebugTypeODRUniquing();
 
+  std::unique_ptr<tool_output_file> RemarksFile;
+  if (!RemarksFilename.empty()) {
+    std::error_code EC;
+    RemarksFile = llvm::make_unique<tool_output_file>(RemarksFilename, EC,
+                                                      sys::fs::F_None);
+    if (EC) {
+      errs() << EC.message() << '\n';
+      return 1;
+    }
+    // The remarks of a failed run are still useful.
+    RemarksFile->keep();
+    Context.setRemarkStreamer(
+        llvm::make_unique<RemarkStreamer>(RemarksFile->os()));
+  }
+
   // Load the input module...
   std::unique_ptr<Module> M = parseIRFile(InputFilename, Err, Context);
 
@@ -398,7 +432,8 @@ int main(int argc, char **argv) {
   // Immediately run the verifier to catch any problems before starting up the
   // pass pipelines.  Otherwise we can crash on broken code during
   // doInitialization().
-  if (!NoVerify && verifyModule(*M, &errs())) {
+  if (!NoVerify &&
+      verifyModule(*M, &errs(), /*BrokenDebugInfo=*/nullptr, ParallelVerifier)) {
     errs() << argv[0] << ": " << InputFilename
            << ": error: input module is broken!\n";
     return 1;
@@ -624,7 +659,7 @@ int main(int argc, char **argv) {
 
   // Check that the module is well formed on completion of optimization
   if (!NoVerify && !VerifyEach)
-    Passes.add(createVerifierPass());
+    Passes.add(createVerifier());
 
   // In run twice mode, we want to make sure the output is bit-by-bit
   // equivalent if we run the pass manager again, so setup two buffers and
@@ -43,6 +43,8 @@
 #include "llvm/Support/SpecialCaseList.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 
@@ -102,6 +104,10 @@ static cl::opt<bool> ClUseDefaultBlacklist(
     "use_default_blacklist", cl::init(true), cl::Hidden,
     cl::desc("Controls if default blacklist should be used."));
 
+static cl::opt<unsigned> ClSymbolizeThreads(
+    "symbolize-threads", cl::init(1),
+    cl::desc("Number of threads to symbolize coverage points with."));
+
 static const char *const DefaultBlacklistStr = "fun:__sanitizer_.*\n"
                                                "src:/usr/include/.*\n"
                                                "src:.*/libc\\+\\+/.*\n";
@@ -171,7 +177,11 @@ static void readInts(const char *Start, const char *End,
                      std::set<uint64_t> *Ints) {
   const T *S = reinterpret_cast<const T *>(Start);
   const T *E = reinterpret_cast<const T *>(End);
-  std::copy(S, E, std::inserter(*Ints, Ints->end()));
+  // Inserting the addresses in order makes every insertion an append.
+  std::vector<uint64_t> Sorted(S, E);
+  std::sort(Sorted.begin(), Sorted.end());
+  Sorted.erase(std::unique(Sorted.begin(), Sorted.end()), Sorted.end());
+  Ints->insert(Sorted.begin(), Sorted.end());
 }
 
 struct FileLoc {
@@ -277,15 +287,15 @@ private:
   std::unique_ptr<SpecialCaseList> UserBlacklist;
 };
 
-// Collect all debug info for given addresses.
-static std::vector<AddrInfo> getAddrInfo(std::string ObjectFile,
-                                         const std::set<uint64_t> &Addrs,
-                                         bool InlinedCode) {
+// Collect all debug info for the addresses in [Begin, End).
+static std::vector<AddrInfo>
+getAddrInfo(std::string ObjectFile, std::set<uint64_t>::const_iterator Begin,
+            std::set<uint64_t>::const_iterator End, bool InlinedCode) {
   std::vector<AddrInfo> Result;
   auto Symbolizer(createSymbolizer());
   Blacklists B;
 
-  for (auto Addr : Addrs) {
+  for (auto Addr : make_range(Begin, End)) {
     auto LineInfo = Symbolizer->symbolizeCode(ObjectFile, Addr);
     FailIfError(LineInfo);
     auto LineAddrInfo = AddrInfo(*LineInfo, Addr);
@@ -308,25 +318,52 @@ static std::vector<AddrInfo> getAddrInfo(std::string ObjectFile,
   return Result;
 }
 
+// Collect all debug info for given addresses. With -symbolize-threads, the
+// addresses are split into consecutive ranges, which are symbolized in
+// parallel. The symbolizer is not thread-safe, so every range gets its own,
+// and the results are concatenated in address order.
+static std::vector<AddrInfo> getAddrInfo(std::string ObjectFile,
+                                         const std::set<uint64_t> &Addrs,
+                                         bool InlinedCode) {
+  size_t NumJobs = std::min<size_t>(ClSymbolizeThreads, Addrs.size());
+  if (NumJobs <= 1 || !llvm_is_multithreaded())
+    return getAddrInfo(ObjectFile, Addrs.begin(), Addrs.end(), InlinedCode);
+
+  std::vector<std::vector<AddrInfo>> Results(NumJobs);
+  ThreadPool Pool(NumJobs);
+  auto Begin = Addrs.begin();
+  for (size_t I = 0; I != NumJobs; ++I) {
+    auto End = Begin;
+    std::advance(End, Addrs.size() / NumJobs +
+                          (I < Addrs.size() % NumJobs ? 1 : 0));
+    Pool.async([=, &Results]() {
+      Results[I] = getAddrInfo(ObjectFile, Begin, End, InlinedCode);
+    });
+    Begin = End;
+  }
+  Pool.wait();
+
+  std::vector<AddrInfo> Result;
+  for (auto &R : Results)
+    Result.insert(Result.end(), R.begin(), R.end());
+  return Result;
+}
+
 // Locate __sanitizer_cov* function addresses that are used for coverage
 // reporting.
 static std::set<uint64_t>
 findSanitizerCovFunctions(const object::ObjectFile &O) {
   std::set<uint64_t> Result;
 
-  for (const object::SymbolRef &Symbol : O.symbols()) {
-    ErrorOr<uint64_t> AddressOrErr = Symbol.getAddress();
+  for (StringRef Name : {"__sanitizer_cov", "__sanitizer_cov_with_check",
+                         "__sanitizer_cov_trace_func_enter"}) {
+    object::symbol_iterator Symbol = O.findSymbol(Name);
+    if (Symbol == O.symbol_end() ||
+        (Symbol->getFlags() & object::BasicSymbolRef::SF_Undefined))
+      continue;
+    ErrorOr<uint64_t> AddressOrErr = Symbol->getAddress();
     FailIfError(AddressOrErr);
-
-    Expected<StringRef> NameOrErr = Symbol.getName();
-    FailIfError(errorToErrorCode(NameOrErr.takeError()));
-    StringRef Name = NameOrErr.get();
-
-    if (Name == "__sanitizer_cov" || Name == "__sanitizer_cov_with_check" ||
-        Name == "__sanitizer_cov_trace_func_enter") {
-      if (!(Symbol.getFlags() & object::BasicSymbolRef::SF_Undefined))
-        Result.insert(AddressOrErr.get());
-    }
+    Result.insert(AddressOrErr.get());
   }
 
   return Result;
@@ -521,8 +558,10 @@ static std::string anchorName(std::string Anchor) {
 }
 
 static ErrorOr<bool> isCoverageFile(std::string FileName) {
+  // Only the header is read. A shorter file reads as zeros, which is not the
+  // magic.
   ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
-      MemoryBuffer::getFile(FileName);
+      MemoryBuffer::getFileSlice(FileName, sizeof(FileHeader), 0);
   if (!BufOrErr) {
     errs() << "Warning: " << BufOrErr.getError().message() << "("
            << BufOrErr.getError().value()
@@ -559,8 +598,10 @@ class CoverageData {
 public:
   // Read single file coverage data.
   static ErrorOr<std::unique_ptr<CoverageData>> read(std::string FileName) {
+    // Large coverage files are mapped rather than read.
     ErrorOr<std::unique_ptr<MemoryBuffer>> BufOrErr =
-        MemoryBuffer::getFile(FileName);
+        MemoryBuffer::getFile(FileName, /*FileSize=*/-1,
+                              /*RequiresNullTerminator=*/false);
     if (!BufOrErr)
       return BufOrErr.getError();
     std::unique_ptr<MemoryBuffer> Buf = std::move(BufOrErr.get());
@@ -661,8 +702,12 @@ public:
       Fail("Coverage points in binary and .sancov file do not match.");
     }
 
+    // The covered addresses are coverage points too, so they are symbolized
+    // once, along with all the others.
     AllAddrInfo = getAddrInfo(ObjectFile, AllCovPoints, true);
-    CovAddrInfo = getAddrInfo(ObjectFile, Addrs, true);
+    for (const auto &AI : AllAddrInfo)
+      if (Addrs.count(AI.Addr))
+        CovAddrInfo.push_back(AI);
   }
 
   // Compute number of coverage points hit/total in a file.
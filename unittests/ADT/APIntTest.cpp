@@ -513,6 +513,49 @@ TEST(APIntTest, divrem_big7) {
           {224, "80000000800000010000000f", 16});
 }
 
+TEST(APIntTest, divrem_big8) {
+  // Tests the short division by a divisor of one 64-bit word, both of whose
+  // halves are non-zero.
+  testDiv({256, "123456789abcdef0123456789abcdef", 16},
+          {256, "fedcba9876543210", 16},
+          {256, "fedcba987654320f", 16});
+}
+
+TEST(APIntTest, mul_big) {
+  // Every partial product carries into the next word.
+  APInt AllOnes = APInt::getAllOnesValue(128).zext(256);
+  EXPECT_EQ(APInt(256, "fffffffffffffffffffffffffffffffe"
+                       "00000000000000000000000000000001", 16),
+            AllOnes * AllOnes);
+
+  APInt X(256, "123456789abcdef0fedcba9876543210aaaaaaaa55555555", 16);
+  APInt Y(256, "fedcba9876543210ffffffffffffffff0123456789abcdef", 16);
+  EXPECT_EQ(APInt(256, "759203ca9264e21a503dbbb8c9873be6"
+                       "784e5c2a961da9c27c65a4387cc6bb5b", 16),
+            X * Y);
+
+  // The same product through the tc* routines.
+  integerPart Full[6];
+  APInt::tcFullMultiply(Full, X.getRawData(), Y.getRawData(), 3, 3);
+  APInt Product(512, makeArrayRef(Full, 6));
+  EXPECT_EQ(APInt(512, "121fa00ad77d7423335ca00eb9b208be"
+                       "759203ca9264e21a503dbbb8c9873be6"
+                       "784e5c2a961da9c27c65a4387cc6bb5b", 16),
+            Product);
+  integerPart Low[4];
+  EXPECT_EQ(1, APInt::tcMultiply(Low, X.getRawData(), Y.getRawData(), 4));
+  EXPECT_EQ(X * Y, APInt(256, makeArrayRef(Low, 4)));
+}
+
+TEST(APIntTest, shift_big) {
+  APInt X(256, "123456789abcdef0fedcba9876543210aaaaaaaa55555555", 16);
+  for (unsigned Shift : {1, 7, 63, 64, 65, 100, 255}) {
+    APInt Pow2 = APInt::getOneBitSet(256, Shift);
+    EXPECT_EQ(X * Pow2, X.shl(Shift));
+    EXPECT_EQ(X.udiv(Pow2), X.lshr(Shift));
+  }
+}
+
 TEST(APIntTest, fromString) {
   EXPECT_EQ(APInt(32, 0), APInt(32,   "0", 2));
   EXPECT_EQ(APInt(32, 1), APInt(32,   "1", 2));
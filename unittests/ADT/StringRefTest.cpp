@@ -357,6 +357,15 @@ TEST(StringRefTest, Find) {
   EXPECT_EQ(28U, LongStr.find("foo"));
   EXPECT_EQ(12U, LongStr.find("hell", 2));
   EXPECT_EQ(0U, LongStr.find(""));
+  EXPECT_EQ(4U, LongStr.find("x"));
+  EXPECT_EQ(StringRef::npos, LongStr.find("hellz"));
+
+  // Needles too long for the skip table.
+  std::string LongNeedle(300, 'a');
+  std::string Haystack = std::string(10, 'a') + 'b' + LongNeedle + 'a';
+  EXPECT_EQ(11U, StringRef(Haystack).find(LongNeedle));
+  EXPECT_EQ(12U, StringRef(Haystack).find(LongNeedle, 12));
+  EXPECT_EQ(StringRef::npos, StringRef(Haystack).find(LongNeedle, 13));
 
   EXPECT_EQ(3U, Str.rfind('l'));
   EXPECT_EQ(StringRef::npos, Str.rfind('z'));
@@ -387,6 +396,10 @@ TEST(StringRefTest, Count) {
   EXPECT_EQ(1U, Str.count("hello"));
   EXPECT_EQ(1U, Str.count("ello"));
   EXPECT_EQ(0U, Str.count("zz"));
+  EXPECT_EQ(2U, Str.count("l"));
+  StringRef LongStr("hellx xello hell ello world foo bar hello");
+  EXPECT_EQ(3U, LongStr.count("hell"));
+  EXPECT_EQ(5U, LongStr.count("ell"));
 }
 
 TEST(StringRefTest, EditDistance) {
@@ -0,0 +1,134 @@
+//===- llvm/unittest/ADT/SwissMapTest.cpp - SwissMap unit tests -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SwissMap.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+TEST(SwissMapTest, EmptyMap) {
+  SwissMap<unsigned, unsigned> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count(1));
+  EXPECT_TRUE(Map.find(1) == Map.end());
+  EXPECT_EQ(0u, Map.lookup(1));
+  EXPECT_FALSE(Map.erase(1));
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+}
+
+TEST(SwissMapTest, InsertFindErase) {
+  SwissMap<unsigned, unsigned> Map;
+  EXPECT_TRUE(Map.insert(std::make_pair(1u, 10u)).second);
+  EXPECT_FALSE(Map.insert(std::make_pair(1u, 20u)).second);
+  EXPECT_EQ(1u, Map.size());
+  EXPECT_EQ(10u, Map.lookup(1));
+  EXPECT_EQ(10u, Map.find(1)->second);
+  EXPECT_EQ(1u, Map.count(1));
+
+  Map[2] = 20;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(20u, Map[2]);
+
+  EXPECT_TRUE(Map.erase(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(0u, Map.count(1));
+  EXPECT_EQ(1u, Map.size());
+
+  Map.erase(Map.find(2));
+  EXPECT_TRUE(Map.empty());
+}
+
+// Insert enough keys to grow the table several times and compare the result
+// against std::map.
+TEST(SwissMapTest, ManyEntries) {
+  SwissMap<int *, unsigned> Map;
+  std::map<int *, unsigned> Ref;
+  std::unique_ptr<int[]> Storage(new int[5000]);
+  for (unsigned I = 0; I != 5000; ++I) {
+    Map[&Storage[I]] = I;
+    Ref[&Storage[I]] = I;
+  }
+  EXPECT_EQ(Ref.size(), Map.size());
+  for (const auto &KV : Ref)
+    EXPECT_EQ(KV.second, Map.lookup(KV.first));
+
+  unsigned Visited = 0;
+  for (const auto &KV : Map) {
+    EXPECT_EQ(Ref[KV.first], KV.second);
+    ++Visited;
+  }
+  EXPECT_EQ(5000u, Visited);
+}
+
+// Repeatedly erasing and inserting must not fill the table with tombstones.
+TEST(SwissMapTest, EraseInsertChurn) {
+  SwissMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  size_t Size = Map.getMemorySize();
+  for (unsigned I = 100; I != 100000; ++I) {
+    EXPECT_TRUE(Map.erase(I - 100));
+    Map[I] = I;
+  }
+  EXPECT_EQ(100u, Map.size());
+  EXPECT_LE(Map.getMemorySize(), 2 * Size);
+  for (unsigned I = 100000 - 100; I != 100000; ++I)
+    EXPECT_EQ(I, Map.lookup(I));
+  EXPECT_EQ(0u, Map.count(0));
+}
+
+TEST(SwissMapTest, NonTrivialValues) {
+  SwissMap<unsigned, std::string> Map;
+  for (unsigned I = 0; I != 200; ++I)
+    Map.try_emplace(I, I, 'x');
+  EXPECT_EQ(std::string(150, 'x'), Map[150]);
+
+  SwissMap<unsigned, std::string> Copy(Map);
+  EXPECT_EQ(200u, Copy.size());
+  EXPECT_EQ(std::string(7, 'x'), Copy.lookup(7));
+
+  SwissMap<unsigned, std::string> Moved(std::move(Copy));
+  EXPECT_EQ(200u, Moved.size());
+  EXPECT_TRUE(Copy.empty());
+
+  Copy = Moved;
+  EXPECT_EQ(200u, Copy.size());
+  Moved.clear();
+  EXPECT_TRUE(Moved.empty());
+  EXPECT_EQ(std::string(199, 'x'), Copy.lookup(199));
+}
+
+TEST(SwissMapTest, Reserve) {
+  SwissMap<unsigned, unsigned> Map;
+  Map.reserve(1000);
+  size_t Size = Map.getMemorySize();
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(Size, Map.getMemorySize());
+}
+
+TEST(SwissMapTest, ConstIterator) {
+  SwissMap<unsigned, unsigned> Map;
+  Map[1] = 2;
+  const SwissMap<unsigned, unsigned> &ConstMap = Map;
+  SwissMap<unsigned, unsigned>::const_iterator I = Map.find(1);
+  EXPECT_TRUE(I == ConstMap.find(1));
+  EXPECT_TRUE(I != ConstMap.end());
+  EXPECT_EQ(2u, I->second);
+}
+
+} // end anonymous namespace
@@ -280,6 +280,29 @@ static Function &lookupFunction(Module &M, StringRef Name) {
   report_fatal_error("Couldn't find function!");
 }
 
+TEST(LazyCallGraphTest, IndependentRefSCCLevels) {
+  LLVMContext Context;
+  std::unique_ptr<Module> M = parseAssembly(Context, DiamondOfTriangles);
+  LazyCallGraph CG(*M);
+
+  auto Levels = CG.getIndependentRefSCCLevels();
+  auto &A = *CG.lookupRefSCC(*CG.lookup(lookupFunction(*M, "a1")));
+  auto &B = *CG.lookupRefSCC(*CG.lookup(lookupFunction(*M, "b1")));
+  auto &C = *CG.lookupRefSCC(*CG.lookup(lookupFunction(*M, "c1")));
+  auto &D = *CG.lookupRefSCC(*CG.lookup(lookupFunction(*M, "d1")));
+  ASSERT_EQ(3u, Levels.size());
+  ASSERT_EQ(1u, Levels[0].size());
+  EXPECT_EQ(&D, Levels[0][0]);
+
+  // The two arms of the diamond do not reference each other.
+  ASSERT_EQ(2u, Levels[1].size());
+  EXPECT_NE(Levels[1].end(), std::find(Levels[1].begin(), Levels[1].end(), &B));
+  EXPECT_NE(Levels[1].end(), std::find(Levels[1].begin(), Levels[1].end(), &C));
+
+  ASSERT_EQ(1u, Levels[2].size());
+  EXPECT_EQ(&A, Levels[2][0]);
+}
+
 TEST(LazyCallGraphTest, BasicGraphMutation) {
   LLVMContext Context;
   std::unique_ptr<Module> M = parseAssembly(Context, "define void @a() {\n"
@@ -238,4 +238,90 @@ TEST(BitstreamReaderTest, readRecordWithBlobWhileStreaming) {
   }
 }
 
+TEST(BitstreamReaderTest, recordAndReplayBlock) {
+  const unsigned Magic = 0x12345678;
+  const unsigned Trailer = 0x9abcdef0;
+  const unsigned BlockID = bitc::FIRST_APPLICATION_BLOCKID;
+  StringRef BlobIn = "blob";
+
+  SmallVector<char, 1> Buffer;
+  {
+    BitstreamWriter Stream(Buffer);
+    Stream.Emit(Magic, 32);
+    Stream.EnterSubblock(BlockID, 3);
+    unsigned First[] = {1, 2, 3};
+    Stream.EmitRecord(1, makeArrayRef(First));
+
+    Stream.EnterSubblock(BlockID + 1, 4);
+    unsigned Nested[] = {4};
+    Stream.EmitRecord(2, makeArrayRef(Nested));
+    Stream.ExitBlock();
+
+    Stream.EnterSubblock(BlockID + 2, 3);
+    unsigned Skipped[] = {5};
+    Stream.EmitRecord(3, makeArrayRef(Skipped));
+    Stream.ExitBlock();
+
+    BitCodeAbbrev *Abbrev = new BitCodeAbbrev();
+    Abbrev->Add(BitCodeAbbrevOp(4));
+    Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob));
+    unsigned AbbrevID = Stream.EmitAbbrev(Abbrev);
+    unsigned Record[] = {4};
+    Stream.EmitRecordWithBlob(AbbrevID, makeArrayRef(Record), BlobIn);
+    Stream.ExitBlock();
+    Stream.Emit(Trailer, 32);
+  }
+
+  BitstreamReader R((const uint8_t *)Buffer.begin(),
+                    (const uint8_t *)Buffer.end());
+  BitstreamRecording Recording;
+  {
+    BitstreamCursor Recorder(R);
+    ASSERT_EQ(Magic, Recorder.Read(32));
+    BitstreamEntry Entry = Recorder.advance();
+    ASSERT_EQ(BitstreamEntry::SubBlock, Entry.Kind);
+    ASSERT_FALSE(Recorder.recordBlock(BlockID, Recording));
+    EXPECT_EQ(Trailer, Recorder.Read(32));
+  }
+
+  BitstreamCursor Stream(R);
+  ASSERT_EQ(Magic, Stream.Read(32));
+  ASSERT_EQ(BitstreamEntry::SubBlock, Stream.advance().Kind);
+  Stream.replay(Recording);
+  ASSERT_FALSE(Stream.EnterSubBlock(BlockID));
+
+  SmallVector<uint64_t, 4> Vals;
+  BitstreamEntry Entry = Stream.advance();
+  ASSERT_EQ(BitstreamEntry::Record, Entry.Kind);
+  EXPECT_EQ(1u, Stream.readRecord(Entry.ID, Vals));
+  EXPECT_EQ((SmallVector<uint64_t, 4>{1, 2, 3}), Vals);
+
+  Entry = Stream.advance();
+  ASSERT_EQ(BitstreamEntry::SubBlock, Entry.Kind);
+  EXPECT_EQ(BlockID + 1, Entry.ID);
+  ASSERT_FALSE(Stream.EnterSubBlock(Entry.ID));
+  Entry = Stream.advance();
+  ASSERT_EQ(BitstreamEntry::Record, Entry.Kind);
+  Vals.clear();
+  EXPECT_EQ(2u, Stream.readRecord(Entry.ID, Vals));
+  EXPECT_EQ((SmallVector<uint64_t, 4>{4}), Vals);
+  EXPECT_EQ(BitstreamEntry::EndBlock, Stream.advance().Kind);
+
+  Entry = Stream.advance();
+  ASSERT_EQ(BitstreamEntry::SubBlock, Entry.Kind);
+  EXPECT_EQ(BlockID + 2, Entry.ID);
+  ASSERT_FALSE(Stream.SkipBlock());
+
+  // Without a blob argument, the blob is returned as values.
+  Entry = Stream.advance();
+  ASSERT_EQ(BitstreamEntry::Record, Entry.Kind);
+  Vals.clear();
+  EXPECT_EQ(4u, Stream.readRecord(Entry.ID, Vals));
+  EXPECT_EQ((SmallVector<uint64_t, 4>{'b', 'l', 'o', 'b'}), Vals);
+
+  // The cursor continues after the block once its end is replayed.
+  EXPECT_EQ(BitstreamEntry::EndBlock, Stream.advance().Kind);
+  EXPECT_EQ(Trailer, Stream.Read(32));
+}
+
 } // end anonymous namespace
@@ -45,6 +45,34 @@ TEST_F(DIEHashTest, Data1) {
   ASSERT_EQ(0x1AFE116E83701108ULL, MD5Res);
 }
 
+// The values of a DIE keep their order when other DIEs get values in between.
+TEST_F(DIEHashTest, InterleavedValues) {
+  DIE &A = *DIE::get(Alloc, dwarf::DW_TAG_base_type);
+  DIE &B = *DIE::get(Alloc, dwarf::DW_TAG_base_type);
+  DIE::value_iterator First;
+  for (unsigned I = 0; I != 10; ++I) {
+    DIE::value_iterator It =
+        A.addValue(Alloc, dwarf::DW_AT_byte_size, dwarf::DW_FORM_data1,
+                   DIEInteger(I));
+    if (!First)
+      First = It;
+    if (I % 3 == 0)
+      B.addValue(Alloc, dwarf::DW_AT_byte_size, dwarf::DW_FORM_data1,
+                 DIEInteger(I));
+  }
+  *First = DIEValue(dwarf::DW_AT_byte_size, dwarf::DW_FORM_data1,
+                    DIEInteger(42));
+
+  std::vector<uint64_t> Values;
+  for (const DIEValue &V : A.values())
+    Values.push_back(V.getDIEInteger().getValue());
+  EXPECT_EQ(std::vector<uint64_t>({42, 1, 2, 3, 4, 5, 6, 7, 8, 9}), Values);
+  Values.clear();
+  for (const DIEValue &V : B.values())
+    Values.push_back(V.getDIEInteger().getValue());
+  EXPECT_EQ(std::vector<uint64_t>({0, 3, 6, 9}), Values);
+}
+
 // struct {};
 TEST_F(DIEHashTest, TrivialType) {
   DIE &Unnamed = *DIE::get(Alloc, dwarf::DW_TAG_structure_type);
@@ -11,9 +11,12 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ExecutionEngine/FileObjectCache.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
 #include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
 #include "gtest/gtest.h"
 
 using namespace llvm;
@@ -226,4 +229,50 @@ TEST_F(MCJITObjectCacheTest, VerifyNonLoadFromCache) {
   EXPECT_FALSE(Cache->wereDuplicatesInserted());
 }
 
+TEST_F(MCJITObjectCacheTest, FileObjectCache) {
+  SKIP_UNSUPPORTED_PLATFORM;
+
+  SmallString<128> CacheDir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("mcjit-cache", CacheDir));
+
+  // Compile the module once, which stores the object on disk.
+  createJIT(std::move(M));
+  std::unique_ptr<FileObjectCache> Cache(
+      new FileObjectCache(CacheDir, *TheJIT->getTargetMachine()));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  M.reset(createEmptyModule("<main>"));
+  insertMainFunction(M.get(), OriginalRC);
+  std::string Path = Cache->getEntryPath(*M);
+  EXPECT_TRUE(sys::fs::exists(Path));
+  EXPECT_TRUE(bool(Cache->getObject(M.get())));
+  TheJIT.reset();
+
+  // A different module must not be served the cached object.
+  MM.reset(new SectionMemoryManager());
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), ReplacementRC);
+  EXPECT_NE(Path, Cache->getEntryPath(*M));
+  createJIT(std::move(M));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun(ReplacementRC);
+  TheJIT.reset();
+
+  // A module with the same contents is loaded from the cache.
+  MM.reset(new SectionMemoryManager());
+  M.reset(createEmptyModule("<main>"));
+  Main = insertMainFunction(M.get(), OriginalRC);
+  createJIT(std::move(M));
+  TheJIT->setObjectCache(Cache.get());
+  compileAndRun();
+  TheJIT.reset();
+  Cache.reset();
+
+  std::error_code EC;
+  for (sys::fs::directory_iterator I(CacheDir, EC), E; I != E && !EC;
+       I.increment(EC))
+    sys::fs::remove(I->path());
+  sys::fs::remove(CacheDir);
+}
+
 } // end anonymous namespace
@@ -0,0 +1,116 @@
+//===- SlabMemoryManagerTest.cpp - Unit tests for the slab memory manager -===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/Process.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(SlabMemoryManagerTest, DenseAllocations) {
+  SlabMemoryManager MemMgr;
+
+  uint8_t *Code1 = MemMgr.allocateCodeSection(256, 0, 1, "");
+  uint8_t *Data1 = MemMgr.allocateDataSection(256, 0, 2, "", true);
+  uint8_t *Code2 = MemMgr.allocateCodeSection(256, 0, 3, "");
+  uint8_t *Data2 = MemMgr.allocateDataSection(256, 0, 4, "", false);
+
+  ASSERT_NE((uint8_t*)nullptr, Code1);
+  ASSERT_NE((uint8_t*)nullptr, Code2);
+  ASSERT_NE((uint8_t*)nullptr, Data1);
+  ASSERT_NE((uint8_t*)nullptr, Data2);
+
+  // Sections of the same kind are packed next to each other.
+  EXPECT_EQ(Code1 + 256, Code2);
+
+  for (unsigned I = 0; I < 256; ++I) {
+    Code1[I] = 1;
+    Code2[I] = 2;
+    Data1[I] = 3;
+    Data2[I] = 4;
+  }
+  for (unsigned I = 0; I < 256; ++I) {
+    EXPECT_EQ(1, Code1[I]);
+    EXPECT_EQ(2, Code2[I]);
+    EXPECT_EQ(3, Data1[I]);
+    EXPECT_EQ(4, Data2[I]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+
+  // One slab per kind of section, and one permission change each for the code
+  // and the read-only data.
+  EXPECT_EQ(3u, MemMgr.getNumMappings());
+  EXPECT_EQ(2u, MemMgr.getNumProtections());
+
+  // The next group starts on a fresh page of the same slab.
+  uint8_t *Code3 = MemMgr.allocateCodeSection(256, 0, 5, "");
+  ASSERT_NE((uint8_t*)nullptr, Code3);
+  EXPECT_EQ(0u, (uintptr_t)Code3 % sys::Process::getPageSize());
+  Code3[0] = 5;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  EXPECT_EQ(3u, MemMgr.getNumMappings());
+}
+
+TEST(SlabMemoryManagerTest, ReleaseGroup) {
+  const size_t SlabSize = 16 * sys::Process::getPageSize();
+  SlabMemoryManager MemMgr(SlabSize);
+
+  SlabMemoryManager::GroupID G1 = MemMgr.getCurrentGroup();
+  uint8_t *Code1 = MemMgr.allocateCodeSection(SlabSize - 256, 0, 1, "");
+  ASSERT_NE((uint8_t*)nullptr, Code1);
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  MemMgr.releaseGroup(G1);
+
+  // The slab is full, so the next large section reuses the released memory,
+  // which has to be writable again.
+  uint8_t *Code2 = MemMgr.allocateCodeSection(SlabSize - 256, 0, 2, "");
+  EXPECT_EQ(Code1, Code2);
+  for (unsigned I = 0; I < SlabSize - 256; ++I)
+    Code2[I] = 1;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+  EXPECT_EQ(1u, MemMgr.getNumMappings());
+}
+
+TEST(SlabMemoryManagerTest, LargeAllocations) {
+  const size_t SlabSize = 16 * sys::Process::getPageSize();
+  SlabMemoryManager MemMgr(SlabSize);
+
+  uint8_t *Code1 = MemMgr.allocateCodeSection(4 * SlabSize, 0, 1, "");
+  uint8_t *Data1 = MemMgr.allocateDataSection(4 * SlabSize, 0, 2, "", false);
+  ASSERT_NE((uint8_t*)nullptr, Code1);
+  ASSERT_NE((uint8_t*)nullptr, Data1);
+  for (unsigned I = 0; I < 4 * SlabSize; ++I) {
+    Code1[I] = 1;
+    Data1[I] = 2;
+  }
+  for (unsigned I = 0; I < 4 * SlabSize; ++I) {
+    EXPECT_EQ(1, Code1[I]);
+    EXPECT_EQ(2, Data1[I]);
+  }
+
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+}
+
+TEST(SlabMemoryManagerTest, HugePages) {
+  SlabMemoryManager MemMgr(4 * 1024 * 1024, true);
+
+  uint8_t *Code = MemMgr.allocateCodeSection(256, 0, 1, "");
+  ASSERT_NE((uint8_t*)nullptr, Code);
+  Code[0] = 1;
+  std::string Error;
+  EXPECT_FALSE(MemMgr.finalizeMemory(&Error));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,151 @@
+//===---- LazyBitcodeLayerTest.cpp - Unit tests for the lazy bitcode layer ===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/Analysis/ModuleSummaryAnalysis.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LazyBitcodeLayer.h"
+#include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class LazyBitcodeLayerExecutionTest : public testing::Test,
+                                      public OrcExecutionTest {
+protected:
+  typedef ObjectLinkingLayer<> ObjLayerT;
+  typedef IRCompileLayer<ObjLayerT> CompileLayerT;
+
+  // Records the names of the modules that reach the compile layer.
+  struct RecordingLayer {
+    typedef CompileLayerT::ModuleSetHandleT ModuleSetHandleT;
+
+    RecordingLayer(CompileLayerT &Base) : Base(Base) {}
+
+    template <typename ModuleSetT, typename MemoryManagerPtrT,
+              typename SymbolResolverPtrT>
+    ModuleSetHandleT addModuleSet(ModuleSetT Ms, MemoryManagerPtrT MemMgr,
+                                  SymbolResolverPtrT Resolver) {
+      for (auto &M : Ms)
+        Added.push_back(M->getName());
+      return Base.addModuleSet(std::move(Ms), std::move(MemMgr),
+                               std::move(Resolver));
+    }
+
+    void removeModuleSet(ModuleSetHandleT H) { Base.removeModuleSet(H); }
+
+    JITSymbol findSymbol(const std::string &Name, bool ExportedSymbolsOnly) {
+      return Base.findSymbol(Name, ExportedSymbolsOnly);
+    }
+
+    JITSymbol findSymbolIn(ModuleSetHandleT H, const std::string &Name,
+                           bool ExportedSymbolsOnly) {
+      return Base.findSymbolIn(H, Name, ExportedSymbolsOnly);
+    }
+
+    CompileLayerT &Base;
+    std::vector<std::string> Added;
+  };
+
+  // inc(x) = x + 1, twice(x) = inc(inc(x)), and unused(x) which is never
+  // looked up.
+  std::unique_ptr<MemoryBuffer> createTestBitcode(bool WithSummary) {
+    ModuleBuilder MB(Context, TM->getTargetTriple().str(), "lazy");
+    Module *M = MB.getModule();
+    M->setDataLayout(TM->createDataLayout());
+
+    Function *Inc = MB.createFunctionDecl<int(int)>("inc");
+    Inc->setLinkage(GlobalValue::InternalLinkage);
+    IRBuilder<> B(BasicBlock::Create(Context, "entry", Inc));
+    B.CreateRet(B.CreateAdd(&*Inc->arg_begin(), B.getInt32(1)));
+
+    Function *Twice = MB.createFunctionDecl<int(int)>("twice");
+    B.SetInsertPoint(BasicBlock::Create(Context, "entry", Twice));
+    Value *Once = B.CreateCall(Inc, &*Twice->arg_begin());
+    B.CreateRet(B.CreateCall(Inc, Once));
+
+    Function *Unused = MB.createFunctionDecl<int(int)>("unused");
+    B.SetInsertPoint(BasicBlock::Create(Context, "entry", Unused));
+    B.CreateRet(&*Unused->arg_begin());
+
+    std::unique_ptr<ModuleSummaryIndex> Index;
+    if (WithSummary)
+      Index = ModuleSummaryIndexBuilder(M).takeIndex();
+
+    std::string Bitcode;
+    raw_string_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS, false, Index.get());
+    return MemoryBuffer::getMemBufferCopy(OS.str(), "lazy.bc");
+  }
+
+  std::string mangle(StringRef Name) {
+    std::string MangledName;
+    raw_string_ostream MangledNameStream(MangledName);
+    Mangler::getNameWithPrefix(MangledNameStream, Name,
+                               TM->createDataLayout());
+    return MangledNameStream.str();
+  }
+
+  void runTest(bool WithSummary) {
+    ObjLayerT ObjLayer;
+    CompileLayerT CompileLayer(ObjLayer, SimpleCompiler(*TM));
+    RecordingLayer Recorder(CompileLayer);
+    LazyBitcodeLayer<RecordingLayer> LazyLayer(Recorder, Context);
+    SectionMemoryManager MemMgr;
+
+    auto Resolver = createLambdaResolver(
+        [](const std::string &Name) { return RuntimeDyld::SymbolInfo(nullptr); },
+        [](const std::string &Name) { return RuntimeDyld::SymbolInfo(nullptr); });
+    auto H = LazyLayer.addBitcode(createTestBitcode(WithSummary), &MemMgr,
+                                  std::move(Resolver));
+    ASSERT_TRUE(!!H) << "Could not add the bitcode";
+    EXPECT_TRUE(Recorder.Added.empty()) << "Nothing should be emitted yet";
+
+    EXPECT_FALSE(LazyLayer.findSymbol(mangle("inc"), true))
+        << "Internal functions are not exported";
+    EXPECT_FALSE(LazyLayer.findSymbol(mangle("missing"), true))
+        << "Found a symbol that is not defined";
+
+    auto TwiceSym = LazyLayer.findSymbol(mangle("twice"), true);
+    ASSERT_TRUE(!!TwiceSym) << "Could not find twice";
+    auto Twice = reinterpret_cast<int (*)(int)>(
+        static_cast<uintptr_t>(TwiceSym.getAddress()));
+    EXPECT_EQ(5, Twice(3)) << "Lazily emitted code computed a wrong result";
+
+    EXPECT_EQ(2u, Recorder.Added.size())
+        << "Only twice and inc should have been emitted";
+    for (auto &Name : Recorder.Added)
+      EXPECT_EQ(StringRef::npos, StringRef(Name).find("unused"))
+          << "An unreferenced function was emitted";
+
+    EXPECT_TRUE(!!LazyLayer.findSymbol(mangle("twice"), true));
+    EXPECT_EQ(2u, Recorder.Added.size()) << "A function was emitted twice";
+
+    LazyLayer.removeBitcode(*H);
+  }
+};
+
+TEST_F(LazyBitcodeLayerExecutionTest, WithoutSummary) {
+  if (!TM)
+    return;
+  runTest(false);
+}
+
+TEST_F(LazyBitcodeLayerExecutionTest, WithSummary) {
+  if (!TM)
+    return;
+  runTest(true);
+}
+
+} // end anonymous namespace
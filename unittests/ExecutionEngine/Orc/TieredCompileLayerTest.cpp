@@ -0,0 +1,101 @@
+//===---- TieredCompileLayerTest.cpp - Unit tests for the tiered layer ----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/LazyEmittingLayer.h"
+#include "llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class TieredCompileLayerExecutionTest : public testing::Test,
+                                        public OrcExecutionTest {
+protected:
+  typedef ObjectLinkingLayer<> ObjLayerT;
+  typedef IRCompileLayer<ObjLayerT> CompileLayerT;
+  typedef LazyEmittingLayer<CompileLayerT> LazyLayerT;
+  typedef TieredCompileLayer<LazyLayerT, CompileLayerT> TieredLayerT;
+
+  // inc(x) = x + 1, twice(x) = inc(inc(x))
+  std::unique_ptr<Module> createTestModule() {
+    ModuleBuilder MB(Context, TM->getTargetTriple().str(), "tiered");
+    MB.getModule()->setDataLayout(TM->createDataLayout());
+
+    Function *Inc = MB.createFunctionDecl<int(int)>("inc");
+    IRBuilder<> B(BasicBlock::Create(Context, "entry", Inc));
+    B.CreateRet(B.CreateAdd(&*Inc->arg_begin(), B.getInt32(1)));
+
+    Function *Twice = MB.createFunctionDecl<int(int)>("twice");
+    B.SetInsertPoint(BasicBlock::Create(Context, "entry", Twice));
+    Value *Once = B.CreateCall(Inc, &*Twice->arg_begin());
+    B.CreateRet(B.CreateCall(Inc, Once));
+
+    return MB.takeModule();
+  }
+
+  std::string mangle(StringRef Name) {
+    std::string MangledName;
+    raw_string_ostream MangledNameStream(MangledName);
+    Mangler::getNameWithPrefix(MangledNameStream, Name,
+                               TM->createDataLayout());
+    return MangledNameStream.str();
+  }
+
+  void runTest(ThreadPool *Pool) {
+    ObjLayerT ObjLayer;
+    CompileLayerT CompileLayer(ObjLayer, SimpleCompiler(*TM));
+    LazyLayerT LazyLayer(CompileLayer);
+    SectionMemoryManager MemMgr;
+    TieredLayerT Tiered(LazyLayer, CompileLayer,
+                        createLocalIndirectStubsManagerBuilder(
+                            TM->getTargetTriple()),
+                        3, Pool);
+
+    auto Resolver = createLambdaResolver(
+        [](const std::string &Name) { return RuntimeDyld::SymbolInfo(nullptr); },
+        [](const std::string &Name) { return RuntimeDyld::SymbolInfo(nullptr); });
+    std::vector<std::unique_ptr<Module>> Ms;
+    Ms.push_back(createTestModule());
+    Tiered.addModuleSet(std::move(Ms), &MemMgr, std::move(Resolver));
+
+    auto TwiceSym = Tiered.findSymbol(mangle("twice"), true);
+    ASSERT_TRUE(!!TwiceSym) << "Function stub not found";
+    auto Twice = reinterpret_cast<int (*)(int)>(
+        static_cast<uintptr_t>(TwiceSym.getAddress()));
+
+    for (int I = 0; I != 5; ++I)
+      EXPECT_EQ(I + 2, Twice(I)) << "First tier computed a wrong result";
+    Tiered.waitForRecompiles();
+    EXPECT_EQ(2u, Tiered.getNumRecompiledFunctions())
+        << "Both functions crossed the threshold";
+    EXPECT_EQ(12, Twice(10)) << "Second tier computed a wrong result";
+  }
+};
+
+TEST_F(TieredCompileLayerExecutionTest, RecompileHotFunctions) {
+  if (!TM)
+    return;
+  runTest(nullptr);
+}
+
+TEST_F(TieredCompileLayerExecutionTest, RecompileInBackground) {
+  if (!TM)
+    return;
+  ThreadPool Pool(1);
+  runTest(&Pool);
+}
+
+} // end anonymous namespace
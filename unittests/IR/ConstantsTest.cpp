@@ -13,8 +13,10 @@
 #include "llvm/IR/InstrTypes.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm-c/Core.h"
 #include "gtest/gtest.h"
 
@@ -476,5 +478,37 @@ TEST(ConstantsTest, BitcastToGEP) {
             Instruction::BitCast);
 }
 
+TEST(ConstantsTest, ConcurrentUniquing) {
+  LLVMContext Context(true);
+  EXPECT_TRUE(Context.hasConcurrentUniquing());
+  EXPECT_FALSE(LLVMContext().hasConcurrentUniquing());
+
+  const unsigned NumTasks = 4, NumConstants = 256;
+  std::vector<std::vector<Constant *>> Constants(NumTasks);
+  std::vector<std::vector<Metadata *>> MDs(NumTasks);
+  {
+    ThreadPool Pool(NumTasks);
+    for (unsigned T = 0; T != NumTasks; ++T)
+      Pool.async([&, T]() {
+        for (unsigned I = 0; I != NumConstants; ++I) {
+          Type *Ty = IntegerType::get(Context, 33 + I % 7);
+          Constant *CI = ConstantInt::get(Ty, I);
+          Constant *CF = ConstantFP::get(Type::getDoubleTy(Context), I);
+          Constant *Elts[] = {CI, CF, UndefValue::get(ArrayType::get(Ty, I))};
+          Constants[T].push_back(ConstantStruct::getAnon(Context, Elts));
+
+          Metadata *Ops[] = {MDString::get(Context, std::to_string(I)),
+                             ConstantAsMetadata::get(CI)};
+          MDs[T].push_back(MDTuple::get(Context, Ops));
+        }
+      });
+  }
+
+  for (unsigned T = 1; T != NumTasks; ++T) {
+    EXPECT_EQ(Constants[0], Constants[T]);
+    EXPECT_EQ(MDs[0], MDs[T]);
+  }
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
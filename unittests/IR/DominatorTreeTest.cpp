@@ -251,6 +251,115 @@ namespace llvm {
       Passes.add(P);
       Passes.run(*M);
     }
+
+    std::unique_ptr<Module> makeUpdateModule(LLVMContext &Context) {
+      const char *ModuleString =
+        "define void @f(i1 %c) {\n"
+        "entry:\n"
+        "  br label %p\n"
+        "p:\n"
+        "  br i1 %c, label %a, label %b\n"
+        "a:\n"
+        "  br label %j\n"
+        "b:\n"
+        "  br label %j\n"
+        "j:\n"
+        "  br label %x\n"
+        "x:\n"
+        "  ret void\n"
+        "u:\n"
+        "  br label %x\n"
+        "}\n";
+      SMDiagnostic Err;
+      return parseAssemblyString(ModuleString, Err, Context);
+    }
+
+    BasicBlock *getBlock(Function &F, StringRef Name) {
+      for (BasicBlock &BB : F)
+        if (BB.getName() == Name)
+          return &BB;
+      return nullptr;
+    }
+
+    TEST(DominatorTree, InsertEdge) {
+      LLVMContext Context;
+      std::unique_ptr<Module> M = makeUpdateModule(Context);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT(F);
+      BasicBlock *A = getBlock(F, "a"), *X = getBlock(F, "x");
+      EXPECT_EQ(DT.getNode(X)->getIDom()->getBlock(), getBlock(F, "j"));
+
+      // a now branches to x as well as j.
+      A->getTerminator()->eraseFromParent();
+      BranchInst::Create(getBlock(F, "j"), X, &*F.arg_begin(), A);
+      DT.insertEdge(A, X);
+
+      EXPECT_EQ(DT.getNode(X)->getIDom()->getBlock(), getBlock(F, "p"));
+      EXPECT_FALSE(DT.compare(DominatorTree(F)));
+    }
+
+    TEST(DominatorTree, DeleteEdge) {
+      LLVMContext Context;
+      std::unique_ptr<Module> M = makeUpdateModule(Context);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT(F);
+      BasicBlock *P = getBlock(F, "p"), *B = getBlock(F, "b");
+
+      // p now only branches to a, which leaves b unreachable.
+      P->getTerminator()->eraseFromParent();
+      BranchInst::Create(getBlock(F, "a"), P);
+      DT.deleteEdge(P, B);
+
+      EXPECT_EQ(DT.getNode(B), nullptr);
+      EXPECT_EQ(DT.getNode(getBlock(F, "j"))->getIDom()->getBlock(),
+                getBlock(F, "a"));
+      EXPECT_FALSE(DT.compare(DominatorTree(F)));
+    }
+
+    TEST(DominatorTree, ApplyUpdates) {
+      LLVMContext Context;
+      std::unique_ptr<Module> M = makeUpdateModule(Context);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT(F);
+      BasicBlock *A = getBlock(F, "a"), *B = getBlock(F, "b"),
+                 *J = getBlock(F, "j"), *X = getBlock(F, "x");
+
+      // Swap the roles of a and j: a is now reached through b and j.
+      A->getTerminator()->eraseFromParent();
+      BranchInst::Create(X, A);
+      B->getTerminator()->eraseFromParent();
+      BranchInst::Create(J, B);
+      J->getTerminator()->eraseFromParent();
+      BranchInst::Create(A, J);
+      getBlock(F, "p")->getTerminator()->setSuccessor(0, J);
+      DT.applyUpdates({{DominatorTree::Delete, A, J},
+                       {DominatorTree::Insert, A, X},
+                       {DominatorTree::Delete, J, X},
+                       {DominatorTree::Insert, J, A},
+                       {DominatorTree::Delete, getBlock(F, "p"), A},
+                       {DominatorTree::Insert, getBlock(F, "p"), J}});
+
+      EXPECT_EQ(DT.getNode(A)->getIDom()->getBlock(), J);
+      EXPECT_EQ(DT.getNode(X)->getIDom()->getBlock(), A);
+      EXPECT_FALSE(DT.compare(DominatorTree(F)));
+    }
+
+    TEST(DominatorTree, InsertEdgeToUnreachable) {
+      LLVMContext Context;
+      std::unique_ptr<Module> M = makeUpdateModule(Context);
+      Function &F = *M->getFunction("f");
+      DominatorTree DT(F);
+      BasicBlock *J = getBlock(F, "j"), *U = getBlock(F, "u");
+      EXPECT_EQ(DT.getNode(U), nullptr);
+
+      // j now branches to the unreachable block u.
+      J->getTerminator()->eraseFromParent();
+      BranchInst::Create(U, getBlock(F, "x"), &*F.arg_begin(), J);
+      DT.insertEdge(J, U);
+
+      EXPECT_EQ(DT.getNode(U)->getIDom()->getBlock(), J);
+      EXPECT_FALSE(DT.compare(DominatorTree(F)));
+    }
   }
 }
 
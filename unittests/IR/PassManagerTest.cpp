@@ -14,6 +14,7 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
+#include <atomic>
 
 using namespace llvm;
 
@@ -153,6 +154,24 @@ struct TestInvalidationFunctionPass
   StringRef Name;
 };
 
+// A test function pass that can be marked as thread safe and counts its runs.
+struct TestThreadSafeFunctionPass : PassInfoMixin<TestThreadSafeFunctionPass> {
+  TestThreadSafeFunctionPass(std::atomic<int> &RunCount, bool ThreadSafe)
+      : RunCount(RunCount), ThreadSafe(ThreadSafe) {}
+
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &AM) {
+    // The module analyses are reachable from every thread.
+    (void)AM.getResult<ModuleAnalysisManagerFunctionProxy>(F);
+    ++RunCount;
+    return PreservedAnalyses::all();
+  }
+
+  bool isThreadSafe() const { return ThreadSafe; }
+
+  std::atomic<int> &RunCount;
+  bool ThreadSafe;
+};
+
 std::unique_ptr<Module> parseIR(LLVMContext &Context, const char *IR) {
   SMDiagnostic Err;
   return parseAssemblyString(IR, Err, Context);
@@ -329,4 +348,38 @@ TEST_F(PassManagerTest, Basic) {
 
   EXPECT_EQ(1, ModuleAnalysisRuns);
 }
+
+TEST_F(PassManagerTest, ParallelFunctionAdaptor) {
+  FunctionAnalysisManager FAM;
+  ModuleAnalysisManager MAM;
+  MAM.registerPass([&] { return FunctionAnalysisManagerModuleProxy(FAM); });
+  FAM.registerPass([&] { return ModuleAnalysisManagerFunctionProxy(MAM); });
+  auto RegisterAnalyses = [](FunctionAnalysisManager &) {};
+
+  ModulePassManager MPM;
+  std::atomic<int> ThreadSafeRuns(0);
+  {
+    FunctionPassManager FPM;
+    FPM.addPass(TestThreadSafeFunctionPass(ThreadSafeRuns, true));
+    EXPECT_TRUE(FPM.isThreadSafe());
+    MPM.addPass(createParallelModuleToFunctionPassAdaptor(
+        std::move(FPM), RegisterAnalyses, 3));
+  }
+
+  // A pipeline with a pass that isn't marked as thread safe runs serially.
+  std::atomic<int> SerialRuns(0);
+  {
+    FunctionPassManager FPM;
+    FPM.addPass(TestThreadSafeFunctionPass(SerialRuns, true));
+    FPM.addPass(TestInvalidationFunctionPass("f"));
+    EXPECT_FALSE(FPM.isThreadSafe());
+    MPM.addPass(createParallelModuleToFunctionPassAdaptor(
+        std::move(FPM), RegisterAnalyses, 3));
+  }
+
+  MPM.run(*M, MAM);
+
+  EXPECT_EQ(3, ThreadSafeRuns);
+  EXPECT_EQ(3, SerialRuns);
+}
 }
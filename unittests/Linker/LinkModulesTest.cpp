@@ -16,6 +16,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/Linker/Linker.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
 #include "llvm-c/Core.h"
 #include "llvm-c/Linker.h"
 #include "gtest/gtest.h"
@@ -306,4 +307,56 @@ TEST_F(LinkModuleTest, MoveDistinctMDs) {
   EXPECT_EQ(M3, M4->getOperand(0));
 }
 
+TEST_F(LinkModuleTest, BatchMatchesSequential) {
+  // Appending globals, comdats and constant arrays are handled lazily by a
+  // batch, so the result must not depend on whether one is used.
+  const char *Sources[] = {
+      "$f = comdat any\n"
+      "@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] "
+      "[{ i32, void ()*, i8* } { i32 65535, void ()* @a, i8* null }]\n"
+      "@llvm.used = appending global [1 x i8*] "
+      "[i8* bitcast (void ()* @a to i8*)], section \"llvm.metadata\"\n"
+      "@ta = constant [2 x i32] [i32 1, i32 2]\n"
+      "define void @a() { ret void }\n"
+      "define linkonce_odr void @f() comdat { ret void }\n",
+      "@llvm.global_ctors = appending global [1 x { i32, void ()*, i8* }] "
+      "[{ i32, void ()*, i8* } { i32 65535, void ()* @b, i8* null }]\n"
+      "@tb = constant [1 x i32] [i32 3]\n"
+      "define void @b() { ret void }\n",
+      "$f = comdat any\n"
+      "@llvm.used = appending global [2 x i8*] "
+      "[i8* bitcast (void ()* @c to i8*), i8* bitcast (void ()* @f to i8*)], "
+      "section \"llvm.metadata\"\n"
+      "define void @c() { ret void }\n"
+      "define linkonce_odr void @f() comdat { ret void }\n"};
+
+  auto LinkAll = [&](LLVMContext &C, bool Batch) {
+    auto Dst = llvm::make_unique<Module>("Linked", C);
+    Linker L(*Dst);
+    if (Batch)
+      L.startBatch();
+    for (const char *Source : Sources) {
+      SMDiagnostic Err;
+      std::unique_ptr<Module> Src = parseAssemblyString(Source, Err, C);
+      EXPECT_TRUE(Src.get());
+      EXPECT_FALSE(L.linkInModule(std::move(Src)));
+    }
+    if (Batch)
+      L.finishBatch();
+
+    std::string Result;
+    raw_string_ostream OS(Result);
+    Dst->print(OS, nullptr);
+    return OS.str();
+  };
+
+  LLVMContext SequentialContext, BatchContext;
+  std::string Sequential = LinkAll(SequentialContext, false);
+  std::string Batch = LinkAll(BatchContext, true);
+  EXPECT_EQ(Sequential, Batch);
+  EXPECT_NE(std::string::npos,
+            Batch.find("@llvm.global_ctors = appending global [2 x"));
+  EXPECT_NE(std::string::npos, Batch.find("@llvm.used = appending global [3 x"));
+}
+
 } // end anonymous namespace
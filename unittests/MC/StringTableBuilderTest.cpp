@@ -8,9 +8,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/MC/StringTableBuilder.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Endian.h"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 using namespace llvm;
 
@@ -91,4 +93,30 @@ TEST(StringTableBuilderTest, ELFInOrder) {
   EXPECT_EQ(9U, B.getOffset("foobar"));
 }
 
+TEST(StringTableBuilderTest, ParallelFinalize) {
+  // Enough strings, with shared suffixes, for the sort to be split.
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I < 40000; ++I) {
+    std::string S = "_ZN" + utostr(I * 7919 % 40009) + "foo";
+    if (I % 3)
+      S += "barEv";
+    if (I % 5 == 0)
+      S = S.substr(S.size() / 2);
+    Strings.push_back(S);
+  }
+
+  StringTableBuilder Serial(StringTableBuilder::ELF);
+  StringTableBuilder Parallel(StringTableBuilder::ELF);
+  for (const std::string &S : Strings) {
+    Serial.add(S);
+    Parallel.add(S);
+  }
+  Serial.finalize();
+  Parallel.finalize(4);
+
+  EXPECT_EQ(Serial.data(), Parallel.data());
+  for (const std::string &S : Strings)
+    EXPECT_EQ(Serial.getOffset(S), Parallel.getOffset(S));
+}
+
 }
@@ -265,3 +265,24 @@ TEST(Option, FlagAliasToJoined) {
   EXPECT_EQ(1U, AL.getAllArgValues(OPT_B).size());
   EXPECT_EQ("", AL.getAllArgValues(OPT_B)[0]);
 }
+
+TEST(Option, LongestNameFirst) {
+  TestOptTable T;
+  unsigned MAI, MAC;
+
+  // -Joo is matched as itself, not as -J, and the values of joined options
+  // point into the arguments.
+  std::string LongValue(10000, 'x');
+  std::string LongArg = "-B" + LongValue;
+  const char *MyArgs[] = { "-Joo", LongArg.c_str(), "-Jo" };
+  InputArgList AL = T.ParseArgs(MyArgs, MAI, MAC);
+  ASSERT_EQ(3U, AL.size());
+  std::vector<std::string> Bs = AL.getAllArgValues(OPT_B);
+  ASSERT_EQ(2U, Bs.size());
+  EXPECT_EQ("bar", Bs[0]);
+  EXPECT_EQ(LongValue, Bs[1]);
+  auto ArgIt = AL.begin();
+  ++ArgIt;
+  EXPECT_EQ(LongArg.c_str() + 2, (*ArgIt)->getValue());
+  EXPECT_TRUE(AL.hasArg(OPT_UNKNOWN));
+}
@@ -194,12 +194,16 @@ struct CoverageMappingTest : ::testing::Test {
     ProfileReader = std::move(ReaderOrErr.get());
   }
 
-  void loadCoverageMapping(bool EmitFilenames = true) {
+  void loadCoverageMapping(bool EmitFilenames = true,
+                           StringRef Filename = StringRef()) {
     readProfCounts();
     writeAndReadCoverageRegions(EmitFilenames);
 
     CoverageMappingReaderMock CovReader(OutputFunctions);
-    auto CoverageOrErr = CoverageMapping::load(CovReader, *ProfileReader);
+    auto CoverageOrErr =
+        Filename.empty()
+            ? CoverageMapping::load(CovReader, *ProfileReader)
+            : CoverageMapping::loadForFile(CovReader, *ProfileReader, Filename);
     ASSERT_TRUE(NoError(CoverageOrErr.takeError()));
     LoadedCoverage = std::move(CoverageOrErr.get());
   }
@@ -537,6 +541,62 @@ TEST_P(MaybeSparseCoverageMappingTest, load_coverage_for_expanded_file) {
   EXPECT_EQ(CoverageSegment(1, 10, false), Segments[1]);
 }
 
+TEST_P(MaybeSparseCoverageMappingTest, load_coverage_for_one_file) {
+  InstrProfRecord RecordFunc1("func1", 0x1234, {10});
+  NoError(ProfileWriter.addRecord(std::move(RecordFunc1)));
+  InstrProfRecord RecordFunc2("func2", 0x2345, {20});
+  NoError(ProfileWriter.addRecord(std::move(RecordFunc2)));
+  InstrProfRecord RecordFunc3("func3", 0x3456, {30});
+  NoError(ProfileWriter.addRecord(std::move(RecordFunc3)));
+
+  startFunction("func1", 0x1234);
+  addCMR(Counter::getCounter(0), "foo", 1, 1, 5, 5);
+
+  startFunction("func2", 0x2345);
+  addCMR(Counter::getCounter(0), "bar", 2, 2, 6, 6);
+
+  startFunction("func3", 0x3456);
+  addCMR(Counter::getCounter(0), "bar", 1, 1, 1, 10);
+  addCMR(Counter::getCounter(0), "foo", 10, 1, 10, 5);
+
+  loadCoverageMapping(/*EmitFilenames=*/true, "foo");
+
+  // The functions that do not reference foo are not loaded.
+  const auto FunctionRecords = LoadedCoverage->getCoveredFunctions();
+  std::vector<std::string> Names;
+  for (const auto &FunctionRecord : FunctionRecords)
+    Names.push_back(FunctionRecord.Name);
+  std::sort(Names.begin(), Names.end());
+  ASSERT_EQ(2U, Names.size());
+  EXPECT_EQ("func1", Names[0]);
+  EXPECT_EQ("func3", Names[1]);
+
+  CoverageData Data = LoadedCoverage->getCoverageForFile("foo");
+  std::vector<CoverageSegment> Segments(Data.begin(), Data.end());
+  ASSERT_EQ(4U, Segments.size());
+  EXPECT_EQ(CoverageSegment(1, 1, 10, true), Segments[0]);
+  EXPECT_EQ(CoverageSegment(5, 5, false), Segments[1]);
+  EXPECT_EQ(CoverageSegment(10, 1, 30, true), Segments[2]);
+  EXPECT_EQ(CoverageSegment(10, 5, false), Segments[3]);
+}
+
+TEST(CounterMappingContextTest, shared_subexpressions) {
+  // Each expression adds the previous one to itself, so evaluating the last
+  // one takes exponential time unless the values are reused.
+  std::vector<CounterExpression> Expressions;
+  Expressions.emplace_back(CounterExpression::Add, Counter::getCounter(0),
+                           Counter::getCounter(0));
+  for (unsigned I = 1; I < 48; ++I)
+    Expressions.emplace_back(CounterExpression::Add,
+                             Counter::getExpression(I - 1),
+                             Counter::getExpression(I - 1));
+  uint64_t Counts[] = {1};
+  CounterMappingContext Ctx(Expressions, Counts);
+  Expected<int64_t> Value = Ctx.evaluate(Counter::getExpression(47));
+  ASSERT_TRUE(NoError(Value.takeError()));
+  EXPECT_EQ(int64_t(1) << 48, *Value);
+}
+
 INSTANTIATE_TEST_CASE_P(MaybeSparse, MaybeSparseCoverageMappingTest,
                         ::testing::Bool());
 
@@ -14,6 +14,7 @@
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/Support/Compression.h"
+#include "llvm/Support/FileSystem.h"
 #include "gtest/gtest.h"
 #include <cstdarg>
 
@@ -114,6 +115,44 @@ TEST_P(MaybeSparseInstrProfTest, get_instr_prof_record) {
   ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, R.takeError()));
 }
 
+TEST_P(MaybeSparseInstrProfTest, read_indexed_profile_from_file) {
+  // Write enough records for the file to be memory mapped.
+  std::vector<std::string> Names;
+  for (unsigned I = 0; I < 1024; ++I)
+    Names.push_back("func_" + std::to_string(I));
+  for (unsigned I = 0; I < 1024; ++I)
+    NoError(Writer.addRecord(InstrProfRecord(Names[I], I, {I + 1, I})));
+
+  int FD;
+  SmallString<64> Path;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("InstrProfTest", "profdata", FD,
+                                            Path));
+  {
+    raw_fd_ostream OS(FD, /* ShouldClose */ true);
+    Writer.write(OS);
+  }
+
+  auto ReaderOrErr = IndexedInstrProfReader::create(Path);
+  ASSERT_TRUE(NoError(ReaderOrErr.takeError()));
+  Reader = std::move(ReaderOrErr.get());
+
+  Expected<InstrProfRecord> R = Reader->getInstrProfRecord("func_1000", 1000);
+  ASSERT_TRUE(NoError(R.takeError()));
+  ASSERT_EQ(2U, R->Counts.size());
+  ASSERT_EQ(1001U, R->Counts[0]);
+  ASSERT_EQ(1000U, R->Counts[1]);
+
+  R = Reader->getInstrProfRecord("func_7", 7);
+  ASSERT_TRUE(NoError(R.takeError()));
+  ASSERT_EQ(8U, R->Counts[0]);
+
+  R = Reader->getInstrProfRecord("func_7", 8);
+  ASSERT_TRUE(ErrorEquals(instrprof_error::hash_mismatch, R.takeError()));
+
+  Reader.reset();
+  sys::fs::remove(Path);
+}
+
 TEST_P(MaybeSparseInstrProfTest, get_function_counts) {
   InstrProfRecord Record1("foo", 0x1234, {1, 2});
   InstrProfRecord Record2("foo", 0x1235, {3, 4});
@@ -826,6 +865,70 @@ TEST_P(MaybeSparseInstrProfTest, get_weighted_function_counts) {
   ASSERT_EQ(20U, Counts[1]);
 }
 
+TEST_P(MaybeSparseInstrProfTest, merge_records_from_writer) {
+  InstrProfRecord Record1("foo", 0x1234, {1, 2});
+  InstrProfRecord Record2("bar", 0x5678, {3});
+  NoError(Writer.addRecord(std::move(Record1)));
+  NoError(Writer.addRecord(std::move(Record2)));
+
+  InstrProfWriter Writer2;
+  InstrProfRecord Record3("foo", 0x1234, {10, 20});
+  InstrProfRecord Record4("baz", 0x9abc, {4});
+  NoError(Writer2.addRecord(std::move(Record3), 2));
+  NoError(Writer2.addRecord(std::move(Record4)));
+
+  unsigned NumWarnings = 0;
+  ASSERT_TRUE(NoError(Writer.mergeRecordsFromWriter(
+      std::move(Writer2), [&](Error E) {
+        consumeError(std::move(E));
+        ++NumWarnings;
+      })));
+  ASSERT_EQ(0U, NumWarnings);
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  std::vector<uint64_t> Counts;
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("foo", 0x1234, Counts)));
+  ASSERT_EQ(2U, Counts.size());
+  ASSERT_EQ(21U, Counts[0]);
+  ASSERT_EQ(42U, Counts[1]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("bar", 0x5678, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(3U, Counts[0]);
+
+  ASSERT_TRUE(NoError(Reader->getFunctionCounts("baz", 0x9abc, Counts)));
+  ASSERT_EQ(1U, Counts.size());
+  ASSERT_EQ(4U, Counts[0]);
+}
+
+TEST_F(InstrProfTest, merge_records_from_writer_kind_mismatch) {
+  NoError(Writer.setIsIRLevelProfile(false));
+  InstrProfWriter Writer2;
+  NoError(Writer2.setIsIRLevelProfile(true));
+  ASSERT_TRUE(ErrorEquals(instrprof_error::unsupported_version,
+                          Writer.mergeRecordsFromWriter(
+                              std::move(Writer2),
+                              [](Error E) { consumeError(std::move(E)); })));
+}
+
+TEST_F(InstrProfTest, write_is_independent_of_insertion_order) {
+  InstrProfWriter Writer2;
+  const char *Names[] = {"foo", "bar", "baz", "qux", "quux"};
+  for (unsigned I = 0; I < 5; ++I) {
+    NoError(Writer.addRecord(InstrProfRecord(Names[I], I, {I + 1})));
+    NoError(Writer.addRecord(InstrProfRecord(Names[I], I + 100, {I + 2})));
+  }
+  for (unsigned I = 5; I-- > 0;) {
+    NoError(Writer2.addRecord(InstrProfRecord(Names[I], I + 100, {I + 2})));
+    NoError(Writer2.addRecord(InstrProfRecord(Names[I], I, {I + 1})));
+  }
+  auto Profile1 = Writer.writeBuffer();
+  auto Profile2 = Writer2.writeBuffer();
+  ASSERT_EQ(Profile1->getBuffer(), Profile2->getBuffer());
+}
+
 // Testing symtab creator interface used by indexed profile reader.
 TEST_P(MaybeSparseInstrProfTest, instr_prof_symtab_test) {
   std::vector<StringRef> FuncNames;
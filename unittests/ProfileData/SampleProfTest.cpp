@@ -9,6 +9,7 @@
 
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Metadata.h"
 #include "llvm/IR/Module.h"
@@ -170,6 +171,142 @@ TEST_F(SampleProfTest, roundtrip_binary_profile) {
   testRoundTrip(SampleProfileFormat::SPF_Binary);
 }
 
+TEST_F(SampleProfTest, roundtrip_ext_binary_profile) {
+  testRoundTrip(SampleProfileFormat::SPF_Ext_Binary);
+}
+
+TEST_F(SampleProfTest, ext_binary_reads_module_functions_only) {
+  createWriter(SampleProfileFormat::SPF_Ext_Binary);
+
+  StringRef FooName("_Z3fooi");
+  FunctionSamples FooSamples;
+  FooSamples.setName(FooName);
+  FooSamples.addTotalSamples(7711);
+  FooSamples.addHeadSamples(610);
+  FooSamples.addBodySamples(1, 0, 610);
+
+  StringRef BarName("_Z3bari");
+  FunctionSamples BarSamples;
+  BarSamples.setName(BarName);
+  BarSamples.addTotalSamples(20301);
+  BarSamples.addHeadSamples(1437);
+  BarSamples.addCalledTargetSamples(1, 0, FooName, 1437);
+
+  StringMap<FunctionSamples> Profiles;
+  Profiles[FooName] = std::move(FooSamples);
+  Profiles[BarName] = std::move(BarSamples);
+  ASSERT_TRUE(NoError(Writer->write(Profiles)));
+  Writer->getOutputStream().flush();
+
+  auto Profile = MemoryBuffer::getMemBufferCopy(Data);
+  readProfile(Profile);
+
+  // A module that only defines bar, and calls foo.
+  Module M("my_module", Context);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+  Function::Create(FTy, GlobalValue::ExternalLinkage, FooName, &M);
+  Function *Bar =
+      Function::Create(FTy, GlobalValue::ExternalLinkage, BarName, &M);
+  ReturnInst::Create(Context, BasicBlock::Create(Context, "entry", Bar));
+
+  ASSERT_TRUE(NoError(Reader->readProfilesFor(M)));
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(1u, ReadProfiles.size());
+  FunctionSamples &ReadBarSamples = ReadProfiles[BarName];
+  ASSERT_EQ(20301u, ReadBarSamples.getTotalSamples());
+  ASSERT_EQ(1437u, ReadBarSamples.getHeadSamples());
+  auto Record = ReadBarSamples.getBodySamples().find(LineLocation(1, 0));
+  ASSERT_NE(ReadBarSamples.getBodySamples().end(), Record);
+  ASSERT_EQ(1437u, Record->second.getCallTargets().lookup(FooName));
+}
+
+TEST_F(SampleProfTest, context_profiles) {
+  createWriter(SampleProfileFormat::SPF_Ext_Binary);
+
+  StringRef MainName("main");
+  FunctionSamples MainSamples;
+  MainSamples.setName(MainName);
+  MainSamples.addTotalSamples(1000);
+  MainSamples.addBodySamples(3, 0, 100);
+
+  // bar, called by foo at line offset 2.1, called by main at line offset 3.
+  StringRef BarContext("[main:3 @ _Z3fooi:2.1 @ _Z3bari]");
+  FunctionSamples BarSamples;
+  BarSamples.setName(BarContext);
+  BarSamples.addTotalSamples(50);
+  BarSamples.addHeadSamples(5);
+  BarSamples.addBodySamples(1, 0, 50);
+
+  // A context of a function which is not in the module.
+  StringRef OtherContext("[other:1 @ _Z3bari]");
+  FunctionSamples OtherSamples;
+  OtherSamples.setName(OtherContext);
+  OtherSamples.addTotalSamples(20);
+
+  StringMap<FunctionSamples> Profiles;
+  Profiles[MainName] = std::move(MainSamples);
+  Profiles[BarContext] = std::move(BarSamples);
+  Profiles[OtherContext] = std::move(OtherSamples);
+  ASSERT_TRUE(NoError(Writer->write(Profiles)));
+  Writer->getOutputStream().flush();
+
+  auto Profile = MemoryBuffer::getMemBufferCopy(Data);
+  readProfile(Profile);
+
+  Module M("my_module", Context);
+  FunctionType *FTy = FunctionType::get(Type::getVoidTy(Context), false);
+  Function *Main =
+      Function::Create(FTy, GlobalValue::ExternalLinkage, MainName, &M);
+  ReturnInst::Create(Context, BasicBlock::Create(Context, "entry", Main));
+
+  ASSERT_TRUE(NoError(Reader->readProfilesFor(M)));
+  StringMap<FunctionSamples> &ReadProfiles = Reader->getProfiles();
+  ASSERT_EQ(2u, ReadProfiles.size());
+  ASSERT_EQ(1u, ReadProfiles.count(BarContext));
+
+  // The context becomes an inline instance of bar in an inline instance of
+  // foo in main.
+  ASSERT_TRUE(NoError(Reader->mergeContextProfiles()));
+  ASSERT_EQ(1u, ReadProfiles.size());
+  FunctionSamples &ReadMainSamples = ReadProfiles[MainName];
+  ASSERT_EQ(1050u, ReadMainSamples.getTotalSamples());
+  const FunctionSamples *Foo =
+      ReadMainSamples.findFunctionSamplesAt(LineLocation(3, 0));
+  ASSERT_TRUE(Foo);
+  ASSERT_EQ("_Z3fooi", Foo->getName());
+  ASSERT_EQ(50u, Foo->getTotalSamples());
+  const FunctionSamples *Bar = Foo->findFunctionSamplesAt(LineLocation(2, 1));
+  ASSERT_TRUE(Bar);
+  ASSERT_EQ("_Z3bari", Bar->getName());
+  ASSERT_EQ(50u, Bar->getTotalSamples());
+  ASSERT_EQ(5u, Bar->getHeadSamples());
+  ASSERT_EQ(50u, Bar->findSamplesAt(1, 0).get());
+}
+
+TEST_F(SampleProfTest, parse_context) {
+  SampleContext Ctx;
+  ASSERT_TRUE(Ctx.parse("[main:3 @ _Z3fooi:2.1 @ _Z3bari]"));
+  ASSERT_EQ(2u, Ctx.getCallers().size());
+  ASSERT_EQ("main", Ctx.getCallers()[0].FuncName);
+  ASSERT_EQ(3u, Ctx.getCallers()[0].CallSite.LineOffset);
+  ASSERT_EQ(0u, Ctx.getCallers()[0].CallSite.Discriminator);
+  ASSERT_EQ("_Z3fooi", Ctx.getCallers()[1].FuncName);
+  ASSERT_EQ(2u, Ctx.getCallers()[1].CallSite.LineOffset);
+  ASSERT_EQ(1u, Ctx.getCallers()[1].CallSite.Discriminator);
+  ASSERT_EQ("_Z3bari", Ctx.getCallee());
+
+  std::string Printed;
+  raw_string_ostream OS(Printed);
+  OS << Ctx;
+  ASSERT_EQ("[main:3 @ _Z3fooi:2.1 @ _Z3bari]", OS.str());
+
+  ASSERT_FALSE(Ctx.parse("[_Z3bari]"));
+  ASSERT_FALSE(Ctx.parse("[main @ _Z3bari]"));
+  ASSERT_FALSE(Ctx.parse("[main:3.x @ _Z3bari]"));
+  ASSERT_FALSE(Ctx.parse("[main:3 @ _Z3bari"));
+  ASSERT_FALSE(Ctx.parse("[main:3 @ ]"));
+}
+
 TEST_F(SampleProfTest, sample_overflow_saturation) {
   const uint64_t Max = std::numeric_limits<uint64_t>::max();
   sampleprof_error Result;
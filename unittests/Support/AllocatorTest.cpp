@@ -8,8 +8,10 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/RecyclingAllocator.h"
 #include "gtest/gtest.h"
 #include <cstdlib>
+#include <string>
 
 using namespace llvm;
 
@@ -135,6 +137,26 @@ TEST(AllocatorTest, TestAlignmentPastSlab) {
   EXPECT_EQ(2U, Alloc.GetNumSlabs());
 }
 
+// Test growing the last allocation in place.
+TEST(AllocatorTest, TestGrowInPlace) {
+  BumpPtrAllocator Alloc;
+  char *A = static_cast<char *>(Alloc.Allocate(16, 8));
+  EXPECT_TRUE(Alloc.tryGrowInPlace(A, 16, 32));
+  EXPECT_EQ(32U, Alloc.getBytesAllocated());
+
+  // The next allocation comes after the grown one, which is not the last one
+  // anymore.
+  char *B = static_cast<char *>(Alloc.Allocate(8, 8));
+  EXPECT_EQ(A + 32, B);
+  EXPECT_FALSE(Alloc.tryGrowInPlace(A, 32, 48));
+  EXPECT_TRUE(Alloc.tryGrowInPlace(B, 8, 8));
+
+  // There is no room past the end of the slab.
+  EXPECT_FALSE(Alloc.tryGrowInPlace(B, 8, 8192));
+  EXPECT_EQ(40U, Alloc.getBytesAllocated());
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+}
+
 // Mock slab allocator that returns slabs aligned on 4096 bytes.  There is no
 // easy portable way to do this, so this is kind of a hack.
 class MockSlabAllocator {
@@ -185,4 +207,73 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_GT(MockSlabAllocator::GetLastSlabSize(), 4096u);
 }
 
+// Slabs freed by one pooled allocator are reused by the next one.
+TEST(AllocatorTest, SlabPoolReuse) {
+  SlabPool::releaseThreadCache();
+  void *First;
+  {
+    PooledBumpPtrAllocator Alloc;
+    First = Alloc.Allocate(100, 8);
+  }
+  EXPECT_EQ(4096u, SlabPool::getThreadCacheSize());
+
+  SlabPool::Statistics Before = SlabPool::getStatistics();
+  {
+    PooledBumpPtrAllocator Alloc;
+    EXPECT_EQ(First, Alloc.Allocate(100, 8));
+    EXPECT_EQ(0u, SlabPool::getThreadCacheSize());
+  }
+  SlabPool::Statistics After = SlabPool::getStatistics();
+  EXPECT_EQ(Before.Hits + 1, After.Hits);
+  EXPECT_EQ(Before.Recycled + 1, After.Recycled);
+
+  SlabPool::releaseThreadCache();
+  EXPECT_EQ(0u, SlabPool::getThreadCacheSize());
+}
+
+// The cache never holds more than its limit, and slabs of sizes that aren't
+// cached go back to malloc.
+TEST(AllocatorTest, SlabPoolLimit) {
+  SlabPool::releaseThreadCache();
+  size_t OldLimit = SlabPool::getThreadCacheLimit();
+  SlabPool::setThreadCacheLimit(3 * 4096);
+
+  SlabPool::Statistics Before = SlabPool::getStatistics();
+  {
+    PooledBumpPtrAllocator Alloc;
+    for (int I = 0; I != 5; ++I)
+      Alloc.Allocate(4000, 1);
+    // This goes into a custom sized slab.
+    Alloc.Allocate(10000, 1);
+  }
+  SlabPool::Statistics After = SlabPool::getStatistics();
+  EXPECT_EQ(3 * 4096u, SlabPool::getThreadCacheSize());
+  EXPECT_EQ(Before.Recycled + 3, After.Recycled);
+  EXPECT_EQ(Before.Released + 2, After.Released);
+
+  SlabPool::releaseThreadCache();
+  SlabPool::setThreadCacheLimit(OldLimit);
+}
+
+TEST(AllocatorTest, SlabPoolSpecificAndRecycling) {
+  SlabPool::releaseThreadCache();
+  {
+    SpecificBumpPtrAllocator<std::string, SlabPoolAllocator> Alloc;
+    for (int I = 0; I != 1000; ++I)
+      new (Alloc.Allocate()) std::string(100, 'x');
+  }
+  EXPECT_NE(0u, SlabPool::getThreadCacheSize());
+
+  SlabPool::Statistics Before = SlabPool::getStatistics();
+  {
+    RecyclingAllocator<PooledBumpPtrAllocator, uint64_t> Alloc;
+    uint64_t *P = Alloc.Allocate();
+    *P = 42;
+    Alloc.Deallocate(P);
+    EXPECT_EQ(P, Alloc.Allocate());
+  }
+  EXPECT_EQ(Before.Hits + 1, SlabPool::getStatistics().Hits);
+  SlabPool::releaseThreadCache();
+}
+
 }  // anonymous namespace
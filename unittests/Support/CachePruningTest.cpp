@@ -0,0 +1,111 @@
+//===- unittests/Support/CachePruningTest.cpp - CachePruning tests --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/TimeValue.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+void writeFile(StringRef Dir, StringRef Name, StringRef Contents) {
+  SmallString<64> Path(Dir);
+  sys::path::append(Path, Name);
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+  ASSERT_FALSE(EC);
+  OS << Contents;
+}
+
+bool hasFile(StringRef Dir, StringRef Name) {
+  SmallString<64> Path(Dir);
+  sys::path::append(Path, Name);
+  return sys::fs::exists(Path);
+}
+
+TEST(CachePruningTest, Index) {
+  SmallString<64> Dir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("CachePruningTestDir", Dir));
+  uint64_t Now = sys::TimeValue::now().toEpochTime();
+
+  // Entry "a" is the least recently used, "c" the most recently used, and "d"
+  // is not recorded.
+  writeFile(Dir, "a", "0123456789");
+  writeFile(Dir, "b", "0123456789");
+  writeFile(Dir, "c", "0123456789");
+  writeFile(Dir, "d", "0123456789");
+  writeFile(Dir, "llvmcache.index",
+            (Twine("a 10 ") + Twine(Now - 300) + "\nb 10 " + Twine(Now - 200) +
+             "\nc 10 " + Twine(Now - 100) + "\n").str());
+  // The journal updates the access time of "a", so that "b" is evicted first.
+  CachePruning::recordAccess(Dir, "a", 10);
+
+  CachePruning Pruner(Dir);
+  Pruner.setUseIndex(true).setMaxSizeBytes(25);
+  EXPECT_TRUE(Pruner.prune());
+  EXPECT_EQ(0u, Pruner.getNumExpired());
+  EXPECT_EQ(1u, Pruner.getNumEvicted());
+  EXPECT_TRUE(hasFile(Dir, "a"));
+  EXPECT_FALSE(hasFile(Dir, "b"));
+  EXPECT_TRUE(hasFile(Dir, "c"));
+  EXPECT_TRUE(hasFile(Dir, "d"));
+  EXPECT_FALSE(hasFile(Dir, "llvmcache.journal"));
+
+  // The index was updated, and expires "c" once it is older than "a".
+  Pruner.setMaxSizeBytes(0).setEntryExpiration(50);
+  EXPECT_TRUE(Pruner.prune());
+  EXPECT_EQ(1u, Pruner.getNumExpired());
+  EXPECT_TRUE(hasFile(Dir, "a"));
+  EXPECT_FALSE(hasFile(Dir, "c"));
+
+  auto IndexOrErr = MemoryBuffer::getFile(Twine(Dir) + "/llvmcache.index");
+  ASSERT_TRUE(bool(IndexOrErr));
+  EXPECT_TRUE((*IndexOrErr)->getBuffer().startswith("a 10 "));
+
+  for (StringRef Name : {"a", "d", "llvmcache.index", "llvmcache.timestamp"}) {
+    SmallString<64> Path(Dir);
+    sys::path::append(Path, Name);
+    ASSERT_FALSE(sys::fs::remove(Path));
+  }
+  ASSERT_FALSE(sys::fs::remove(Dir));
+}
+
+TEST(CachePruningTest, BuildIndex) {
+  SmallString<64> Dir;
+  ASSERT_FALSE(sys::fs::createUniqueDirectory("CachePruningTestDir", Dir));
+  writeFile(Dir, "a", "0123456789");
+  writeFile(Dir, "b", "01234");
+
+  // Without an index, the directory is scanned to build it.
+  CachePruning Pruner(Dir);
+  Pruner.setUseIndex(true).setMaxSizeBytes(100);
+  EXPECT_TRUE(Pruner.prune());
+  EXPECT_EQ(0u, Pruner.getNumEvicted());
+
+  auto IndexOrErr = MemoryBuffer::getFile(Twine(Dir) + "/llvmcache.index");
+  ASSERT_TRUE(bool(IndexOrErr));
+  StringRef Index = (*IndexOrErr)->getBuffer();
+  EXPECT_NE(StringRef::npos, Index.find("a 10 "));
+  EXPECT_NE(StringRef::npos, Index.find("b 5 "));
+  EXPECT_EQ(2u, Index.count('\n'));
+
+  for (StringRef Name : {"a", "b", "llvmcache.index", "llvmcache.timestamp"}) {
+    SmallString<64> Path(Dir);
+    sys::path::append(Path, Name);
+    ASSERT_FALSE(sys::fs::remove(Path));
+  }
+  ASSERT_FALSE(sys::fs::remove(Dir));
+}
+
+} // end anonymous namespace
@@ -10,7 +10,9 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Config/config.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 #include <stdlib.h>
 #include <string>
@@ -266,4 +268,93 @@ TEST(CommandLineTest, HideUnrelatedOptionsMulti) {
       << "Hid default option that should be visable.";
 }
 
+TEST(CommandLineTest, LiteralOptionsWithoutArgStr) {
+  enum Mode { ModeA, ModeB };
+  StackOption<Mode> TestOption(cl::desc("Test mode"),
+                               cl::values(clEnumValN(ModeA, "lit-mode-a", ""),
+                                          clEnumValN(ModeB, "lit-mode-b", ""),
+                                          clEnumValEnd));
+
+  // The literals are only registered when the parser is first used.
+  StringMap<cl::Option *> &Map = cl::getRegisteredOptions();
+  ASSERT_EQ(1u, Map.count("lit-mode-a")) << "Literal option not registered.";
+  ASSERT_EQ(&TestOption, Map["lit-mode-b"]) << "Literal option not registered.";
+
+  const char *Args[] = {"prog", "-lit-mode-b"};
+  cl::ParseCommandLineOptions(array_lengthof(Args), Args);
+  EXPECT_EQ(ModeB, TestOption);
+}
+
+TEST(CommandLineTest, ExpandResponseFiles) {
+  // A response file with many arguments, which refers to another one.
+  SmallString<128> Inner, Outer;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("inner", "rsp", FD, Inner));
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << "-c 'd e'\n";
+  }
+  ASSERT_FALSE(sys::fs::createTemporaryFile("outer", "rsp", FD, Outer));
+  const unsigned NumInputs = 20000;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (unsigned I = 0; I != NumInputs; ++I)
+      OS << "input" << I << ".o\n";
+    OS << "@" << Inner << " @does-not-exist.rsp\n";
+  }
+
+  std::string OuterArg = ("@" + Outer).str();
+  SmallVector<const char *, 4> Argv = {"prog", "-a", OuterArg.c_str(), "-b"};
+  BumpPtrAllocator A;
+  StringSaver Saver(A);
+  // The missing response file is left as is.
+  EXPECT_FALSE(
+      cl::ExpandResponseFiles(Saver, cl::TokenizeGNUCommandLine, Argv));
+
+  ASSERT_EQ(NumInputs + 6, Argv.size());
+  EXPECT_STREQ("prog", Argv[0]);
+  EXPECT_STREQ("-a", Argv[1]);
+  EXPECT_STREQ("input0.o", Argv[2]);
+  EXPECT_STREQ("input19999.o", Argv[NumInputs + 1]);
+  EXPECT_STREQ("-c", Argv[NumInputs + 2]);
+  EXPECT_STREQ("d e", Argv[NumInputs + 3]);
+  EXPECT_STREQ("@does-not-exist.rsp", Argv[NumInputs + 4]);
+  EXPECT_STREQ("-b", Argv[NumInputs + 5]);
+
+  sys::fs::remove(Inner);
+  sys::fs::remove(Outer);
+}
+
+TEST(CommandLineTest, ExpandSelfReferentialResponseFile) {
+  SmallString<128> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("self", "rsp", FD, Path));
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << "-x @" << Path << "\n";
+  }
+
+  std::string Arg = ("@" + Path).str();
+  SmallVector<const char *, 2> Argv = {"prog", Arg.c_str()};
+  BumpPtrAllocator A;
+  StringSaver Saver(A);
+  // The expansion stops after 21 response files.
+  EXPECT_FALSE(
+      cl::ExpandResponseFiles(Saver, cl::TokenizeGNUCommandLine, Argv));
+  ASSERT_EQ(23u, Argv.size());
+  for (unsigned I = 1; I != 22; ++I)
+    EXPECT_STREQ("-x", Argv[I]);
+  EXPECT_STREQ(Arg.c_str(), Argv[22]);
+  sys::fs::remove(Path);
+}
+
+TEST(CommandLineTest, PrefixOptionWithLongValue) {
+  StackOption<std::string> TestOption("prefix-test-", cl::Prefix);
+  std::string Value(100000, 'x');
+  std::string Arg = "-prefix-test-" + Value;
+  const char *Args[] = {"prog", Arg.c_str()};
+  cl::ParseCommandLineOptions(array_lengthof(Args), Args);
+  EXPECT_EQ(Value, TestOption);
+}
+
 }  // anonymous namespace
@@ -17,6 +17,9 @@
 #include "llvm/Config/config.h"
 #include "gtest/gtest.h"
 
+#include <string>
+#include <vector>
+
 using namespace llvm;
 
 namespace {
@@ -59,6 +62,78 @@ TEST(CompressionTest, Zlib) {
   TestZlibCompression(BinaryDataStr, zlib::DefaultCompression);
 }
 
+// Decompress Compressed with a Decompressor that is given the input and the
+// output in pieces of InStep and OutStep bytes.
+static std::string decompressInPieces(StringRef Compressed, size_t Size,
+                                      size_t InStep, size_t OutStep) {
+  zlib::Decompressor D;
+  std::string Out(Size, '\0');
+  size_t Done = 0;
+  for (size_t I = 0; !D.isFinished();) {
+    StringRef In = Compressed.substr(I, InStep);
+    size_t Written;
+    MutableArrayRef<char> Output(&Out[0] + Done,
+                                 std::min(OutStep, Size - Done));
+    EXPECT_EQ(zlib::StatusOK, D.decompress(In, Output, Written));
+    I += std::min(InStep, Compressed.size() - I) - In.size();
+    Done += Written;
+    if (!Written && I == Compressed.size() && !D.isFinished())
+      break;
+  }
+  EXPECT_TRUE(D.isFinished());
+  Out.resize(Done);
+  return Out;
+}
+
+TEST(CompressionTest, ZlibDecompressor) {
+  std::string Input;
+  for (unsigned I = 0; I != 100000; ++I)
+    Input += std::to_string(I * 7 % 1000);
+  SmallString<32> Compressed;
+  EXPECT_EQ(zlib::StatusOK, zlib::compress(Input, Compressed));
+  EXPECT_EQ(Input, decompressInPieces(Compressed, Input.size(), 1 << 20,
+                                      1 << 20));
+  EXPECT_EQ(Input, decompressInPieces(Compressed, Input.size(), 7, 1000));
+
+  // The consumed input is dropped, and corrupted data is reported.
+  zlib::Decompressor D;
+  StringRef In = Compressed;
+  std::vector<char> Out(Input.size());
+  size_t Written;
+  EXPECT_EQ(zlib::StatusOK, D.decompress(In, Out, Written));
+  EXPECT_TRUE(In.empty());
+  EXPECT_EQ(Input.size(), Written);
+  zlib::Decompressor Corrupted;
+  In = "\x78\x9c\xff\xff\xff\xff";
+  EXPECT_EQ(zlib::StatusInvalidData, Corrupted.decompress(In, Out, Written));
+}
+
+TEST(CompressionTest, ZlibParallel) {
+  // Inputs of several blocks, with repetitions across the blocks.
+  std::string Input;
+  for (unsigned I = 0; Input.size() < (5 << 20) + 1234; ++I)
+    Input += "block " + std::to_string(I % 50000) + "\n";
+  for (zlib::CompressionLevel Level :
+       {zlib::NoCompression, zlib::BestSpeedCompression,
+        zlib::DefaultCompression, zlib::BestSizeCompression}) {
+    SmallString<32> Compressed;
+    EXPECT_EQ(zlib::StatusOK,
+              zlib::compressParallel(Input, Compressed, Level));
+    SmallString<32> Uncompressed;
+    EXPECT_EQ(zlib::StatusOK,
+              zlib::uncompress(Compressed, Uncompressed, Input.size()));
+    EXPECT_EQ(Input, Uncompressed);
+    EXPECT_EQ(Input, decompressInPieces(Compressed, Input.size(), 4096,
+                                        1 << 16));
+  }
+
+  // Small inputs are compressed like compress() does.
+  SmallString<32> Parallel, Serial;
+  EXPECT_EQ(zlib::StatusOK, zlib::compressParallel("hello", Parallel));
+  EXPECT_EQ(zlib::StatusOK, zlib::compress("hello", Serial));
+  EXPECT_EQ(Serial, Parallel);
+}
+
 TEST(CompressionTest, ZlibCRC32) {
   EXPECT_EQ(
       0x414FA339U,
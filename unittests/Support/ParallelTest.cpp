@@ -0,0 +1,77 @@
+//===- unittests/Support/ParallelTest.cpp - Parallel algorithms tests -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/Parallel.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <random>
+#include <string>
+
+using namespace llvm;
+
+namespace {
+
+TEST(ParallelTest, ForEach) {
+  std::vector<unsigned> Values(10000);
+  parallel_for_each_n(0U, 10000U, [&](unsigned I) { Values[I] = I; });
+  std::atomic<uint64_t> Sum(0);
+  parallel_for_each(Values.begin(), Values.end(),
+                    [&](unsigned V) { Sum += V; });
+  EXPECT_EQ(10000ULL * 9999 / 2, Sum.load());
+}
+
+TEST(ParallelTest, NestedForEach) {
+  std::atomic<unsigned> Count(0);
+  parallel_for_each_n(0, 100, [&](int) {
+    parallel_for_each_n(0, 100, [&](int) { ++Count; });
+  });
+  EXPECT_EQ(10000U, Count.load());
+}
+
+TEST(ParallelTest, Sort) {
+  std::mt19937 Rand;
+  std::vector<uint32_t> Values(100000);
+  for (uint32_t &V : Values)
+    V = Rand();
+  std::vector<uint32_t> Expected = Values;
+  std::sort(Expected.begin(), Expected.end());
+
+  parallel_sort(Values.begin(), Values.end());
+  EXPECT_EQ(Expected, Values);
+
+  parallel_sort(Values.begin(), Values.end(), std::greater<uint32_t>());
+  EXPECT_TRUE(std::is_sorted(Values.begin(), Values.end(),
+                             std::greater<uint32_t>()));
+}
+
+TEST(ParallelTest, TransformReduce) {
+  std::vector<unsigned> Values(10000);
+  for (unsigned I = 0; I != 10000; ++I)
+    Values[I] = I;
+  uint64_t Sum = parallel_transform_reduce(
+      Values.begin(), Values.end(), uint64_t(0), std::plus<uint64_t>(),
+      [](unsigned V) { return uint64_t(V) * 2; });
+  EXPECT_EQ(10000ULL * 9999, Sum);
+
+  // The chunks are reduced in order, even with a non-commutative reduction.
+  std::vector<std::string> Strings;
+  for (unsigned I = 0; I != 3000; ++I)
+    Strings.push_back(std::to_string(I % 10));
+  std::string Expected;
+  for (const std::string &S : Strings)
+    Expected += S;
+  std::string Joined = parallel_transform_reduce(
+      Strings.begin(), Strings.end(), std::string(),
+      [](std::string A, const std::string &B) { return A + B; },
+      [](const std::string &S) { return S; });
+  EXPECT_EQ(Expected, Joined);
+}
+
+} // end anonymous namespace
@@ -12,6 +12,7 @@
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileSystemStatCache.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
@@ -732,6 +733,71 @@ TEST_F(FileSystemTest, DirectoryIteration) {
   ASSERT_NO_ERROR(fs::remove(Twine(TestDirectory) + "/reclevel"));
 }
 
+TEST_F(FileSystemTest, DirectoryIterationStatus) {
+  ASSERT_NO_ERROR(
+      fs::create_directories(Twine(TestDirectory) + "/iterstatus/dir"));
+  std::error_code ec;
+  {
+    raw_fd_ostream OS(Twine(TestDirectory).str() + "/iterstatus/file", ec,
+                      fs::F_None);
+    ASSERT_NO_ERROR(ec);
+    OS << "data";
+  }
+
+  unsigned NumEntries = 0;
+  for (fs::directory_iterator i(Twine(TestDirectory) + "/iterstatus", ec,
+                                /*FetchStatus=*/true),
+       e;
+       i != e; i.increment(ec)) {
+    ASSERT_NO_ERROR(ec);
+    ++NumEntries;
+    fs::file_status Status;
+    ASSERT_NO_ERROR(i->status(Status));
+    // The status is known without a stat.
+    EXPECT_EQ(Status.type(), i->type());
+    if (path::filename(i->path()) == "dir") {
+      EXPECT_EQ(fs::file_type::directory_file, Status.type());
+    } else {
+      EXPECT_EQ(fs::file_type::regular_file, Status.type());
+      EXPECT_EQ(4u, Status.getSize());
+    }
+  }
+  ASSERT_NO_ERROR(ec);
+  EXPECT_EQ(2u, NumEntries);
+
+  ASSERT_NO_ERROR(fs::remove(Twine(TestDirectory) + "/iterstatus/file"));
+  ASSERT_NO_ERROR(fs::remove(Twine(TestDirectory) + "/iterstatus/dir"));
+  ASSERT_NO_ERROR(fs::remove(Twine(TestDirectory) + "/iterstatus"));
+}
+
+TEST_F(FileSystemTest, StatCache) {
+  fs::FileSystemStatCache Cache;
+  SmallString<128> Dir(TestDirectory);
+  path::append(Dir, "statcache");
+  EXPECT_FALSE(Cache.exists(Dir));
+  EXPECT_EQ(1u, Cache.size());
+
+  // The cache does not notice the new directory before it is invalidated.
+  ASSERT_NO_ERROR(fs::create_directory(Dir));
+  EXPECT_FALSE(Cache.exists(Dir));
+  bool IsDir;
+  EXPECT_EQ(errc::no_such_file_or_directory, Cache.is_directory(Dir, IsDir));
+  Cache.invalidate(Dir);
+  EXPECT_TRUE(Cache.exists(Dir));
+  EXPECT_TRUE(Cache.is_directory(Dir));
+  EXPECT_FALSE(Cache.is_regular_file(Dir));
+  EXPECT_EQ(1u, Cache.size());
+
+  ASSERT_NO_ERROR(fs::remove(Dir));
+  EXPECT_TRUE(Cache.is_directory(Dir));
+  Cache.clear();
+  EXPECT_EQ(0u, Cache.size());
+  EXPECT_FALSE(Cache.is_directory(Dir));
+
+  Cache.insert(Dir, fs::file_status(fs::file_type::regular_file));
+  EXPECT_TRUE(Cache.is_regular_file(Dir));
+}
+
 const char archive[] = "!<arch>\x0A";
 const char bitcode[] = "\xde\xc0\x17\x0b";
 const char coff_object[] = "\x00\x00......";
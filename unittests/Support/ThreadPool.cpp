@@ -166,3 +166,69 @@ TEST_F(ThreadPoolTest, PoolDestruction) {
   }
   ASSERT_EQ(5, checked_in);
 }
+
+TEST_F(ThreadPoolTest, TaskGroup) {
+  CHECK_UNSUPPORTED();
+  // Test that waiting on a group does not wait for the other tasks
+  std::atomic_int checked_in{0};
+  std::atomic_int grouped{0};
+  ThreadPool Pool;
+  Pool.async([this, &checked_in] {
+    waitForMainThread();
+    ++checked_in;
+  });
+  {
+    ThreadPoolTaskGroup Group(Pool);
+    for (size_t i = 0; i < 5; ++i)
+      Group.async([&grouped] { ++grouped; });
+    Group.wait();
+    ASSERT_EQ(5, grouped);
+    ASSERT_EQ(0, checked_in);
+  }
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(1, checked_in);
+}
+
+TEST_F(ThreadPoolTest, NestedTaskGroups) {
+  CHECK_UNSUPPORTED();
+  // Test that the tasks can wait on groups of subtasks, even when there are
+  // more of them than threads
+  std::atomic_int checked_in{0};
+  ThreadPool Pool(2);
+  for (size_t i = 0; i < 8; ++i) {
+    Pool.async([&Pool, &checked_in] {
+      ThreadPoolTaskGroup Group(Pool);
+      for (size_t j = 0; j < 10; ++j)
+        Group.async([&checked_in] { ++checked_in; });
+      Group.wait();
+      ++checked_in;
+    });
+  }
+  Pool.wait();
+  ASSERT_EQ(88, checked_in);
+}
+
+TEST_F(ThreadPoolTest, Priorities) {
+  CHECK_UNSUPPORTED();
+  // Test that the queued tasks start by decreasing priority
+  std::mutex OrderLock;
+  std::vector<ThreadPoolPriority> Order;
+  ThreadPool Pool(1);
+  Pool.async([this] { waitForMainThread(); });
+  ThreadPoolTaskGroup Low(Pool, ThreadPoolPriority::Low);
+  ThreadPoolTaskGroup Normal(Pool);
+  ThreadPoolTaskGroup High(Pool, ThreadPoolPriority::High);
+  for (ThreadPoolTaskGroup *Group : {&Low, &Normal, &High}) {
+    Group->async([Group, &OrderLock, &Order] {
+      std::lock_guard<std::mutex> LockGuard(OrderLock);
+      Order.push_back(Group->getPriority());
+    });
+  }
+  setMainThreadReady();
+  Pool.wait();
+  ASSERT_EQ(3U, Order.size());
+  EXPECT_EQ(ThreadPoolPriority::High, Order[0]);
+  EXPECT_EQ(ThreadPoolPriority::Normal, Order[1]);
+  EXPECT_EQ(ThreadPoolPriority::Low, Order[2]);
+}
@@ -9,8 +9,11 @@
 
 #include "gtest/gtest.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
+#include <string>
 
 using namespace llvm;
 
@@ -182,4 +185,33 @@ TEST(raw_ostreamTest, FormatDecimal) {
 }
 
 
+TEST(raw_ostreamTest, AsyncWrites) {
+  SmallString<64> Path;
+  int FD;
+  ASSERT_FALSE(sys::fs::createTemporaryFile("async", "txt", FD, Path));
+  std::string Expected;
+  {
+    raw_fd_ostream OS(FD, true);
+    OS.enable_async_writes(16);
+    for (unsigned I = 0; I != 1000; ++I) {
+      std::string Line = std::to_string(I) + std::string(I % 40, 'x') + "\n";
+      OS << Line;
+      Expected += Line;
+    }
+    OS.pwrite("head", 4, 0);
+    Expected.replace(0, 4, "head");
+    // The writes of an unbuffered stream go through the second buffer.
+    OS.SetUnbuffered();
+    OS << "unbuffered\n";
+    Expected += "unbuffered\n";
+    OS.close();
+    EXPECT_FALSE(OS.has_error());
+  }
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buffer = MemoryBuffer::getFile(Path);
+  ASSERT_TRUE(bool(Buffer));
+  EXPECT_EQ(Expected, (*Buffer)->getBuffer());
+  sys::fs::remove(Path);
+}
+
 }
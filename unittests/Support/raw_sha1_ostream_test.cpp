@@ -9,6 +9,7 @@
 
 #include "gtest/gtest.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/SHA1.h"
 #include "llvm/Support/raw_sha1_ostream.h"
 
 #include <string>
@@ -69,3 +70,21 @@ TEST(raw_sha1_ostreamTest, Reset) {
 
   ASSERT_EQ("7447F2A5A42185C8CF91E632789C431830B59067", Hash);
 }
+
+// Check the hashes of inputs of many blocks, digested in one piece and in
+// pieces that are not aligned on blocks.
+TEST(raw_sha1_ostreamTest, MultipleBlocks) {
+  SHA1 Sha1;
+  Sha1.update("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+  ASSERT_EQ("84983E441C3BD26EBAAE4AA1F95129E5E54670F1", toHex(Sha1.final()));
+
+  std::string Million(1000000, 'a');
+  Sha1.init();
+  Sha1.update(Million);
+  ASSERT_EQ("34AA973CD4C4DAA4F61EEB2BDBAD27316534016F", toHex(Sha1.final()));
+
+  Sha1.init();
+  for (size_t I = 0; I < Million.size(); I += 999)
+    Sha1.update(StringRef(Million).substr(I, 999));
+  ASSERT_EQ("34AA973CD4C4DAA4F61EEB2BDBAD27316534016F", toHex(Sha1.final()));
+}
@@ -0,0 +1,53 @@
+//===- llvm/unittest/Support/xxhashTest.cpp - xxHash tests ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/xxhash.h"
+#include "gtest/gtest.h"
+
+#include <string>
+
+using namespace llvm;
+
+TEST(xxhashTest, Basic) {
+  EXPECT_EQ(0xef46db3751d8e999U, xxHash64(StringRef()));
+  EXPECT_EQ(0x33bf00a859c4ba3fU, xxHash64("foo"));
+  EXPECT_EQ(0x48a37c90ad27a659U, xxHash64("bar"));
+  EXPECT_EQ(0x69196c1b3af0bff9U,
+            xxHash64("0123456789abcdefghijklmnopqrstuvwxyz"));
+  EXPECT_NE(xxHash64("foo"), xxHash64("foo", 1));
+}
+
+// Check that the 128-bit hash does not depend on how the data is split, and
+// that its halves are the XXH64 with two seeds.
+TEST(xxhashTest, Hash128) {
+  std::string Data;
+  for (unsigned I = 0; I < 300; ++I)
+    Data += char(I * 7);
+
+  for (size_t Length : {0, 1, 31, 32, 33, 64, 100, 300}) {
+    StringRef S = StringRef(Data).substr(0, Length);
+    Hash128 Expected = xxHash128::hash(S);
+    EXPECT_EQ(xxHash64(S), Expected.Low);
+    EXPECT_NE(Expected.Low, Expected.High);
+    for (size_t Step : {1, 7, 32, 45}) {
+      xxHash128 H;
+      for (size_t I = 0; I < Length; I += Step)
+        H.update(S.substr(I, Step));
+      EXPECT_EQ(Expected, H.result());
+    }
+  }
+
+  // Getting the result does not change the state.
+  xxHash128 H;
+  H.update("Hello");
+  Hash128 Intermediate = H.result();
+  EXPECT_EQ(xxHash128::hash(StringRef("Hello")), Intermediate);
+  H.update(" World!");
+  EXPECT_EQ(xxHash128::hash(StringRef("Hello World!")), H.result());
+}
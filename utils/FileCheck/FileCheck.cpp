@@ -14,12 +14,17 @@
 // the file matched the expected contents, and exit status of 1 if it did not
 // contain the expected contents.
 //
+// "FileCheck --serve" runs the checks of a sequence of requests of the test
+// runner instead, so that the process only starts once.  See Serve below.
+//
 //===----------------------------------------------------------------------===//
 
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/StringSwitch.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/PrettyStackTrace.h"
@@ -29,10 +34,16 @@
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <map>
+#include <memory>
 #include <string>
 #include <system_error>
 #include <vector>
+#ifdef LLVM_ON_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 using namespace llvm;
 
 static cl::opt<std::string>
@@ -104,6 +115,19 @@ class Pattern {
   /// RegEx - If non-empty, this is a regex pattern.
   std::string RegExStr;
 
+  /// CompiledRegEx - RegExStr compiled once for all the matches, when the
+  /// pattern does not use variables defined by other patterns.
+  std::shared_ptr<Regex> CompiledRegEx;
+
+  /// RequiredStr - The longest fixed string of a regex pattern, which is part
+  /// of every match.  It is searched for before running the regex.
+  StringRef RequiredStr;
+
+  /// MayMatchNewline - Whether a regex piece of the pattern may match a
+  /// newline.  Otherwise, a match is within the line of some occurrence of
+  /// RequiredStr.
+  bool MayMatchNewline = false;
+
   /// \brief Contains the number of line this pattern is in.
   unsigned LineNumber;
 
@@ -341,7 +365,10 @@ bool Pattern::ParsePattern(StringRef PatternStr,
     // Find the end, which is the start of the next regex.
     size_t FixedMatchEnd = PatternStr.find("{{");
     FixedMatchEnd = std::min(FixedMatchEnd, PatternStr.find("[["));
-    RegExStr += Regex::escape(PatternStr.substr(0, FixedMatchEnd));
+    StringRef FixedPart = PatternStr.substr(0, FixedMatchEnd);
+    if (FixedPart.size() > RequiredStr.size())
+      RequiredStr = FixedPart;
+    RegExStr += Regex::escape(FixedPart);
     PatternStr = PatternStr.substr(FixedMatchEnd);
   }
 
@@ -351,6 +378,8 @@ bool Pattern::ParsePattern(StringRef PatternStr,
     RegExStr += '$';
   }
 
+  if (VariableUses.empty())
+    CompiledRegEx = std::make_shared<Regex>(RegExStr, Regex::Newline);
   return false;
 }
 
@@ -366,6 +395,10 @@ bool Pattern::AddRegExToRegEx(StringRef RS, unsigned &CurParen,
 
   RegExStr += RS.str();
   CurParen += R.getNumMatches();
+  // '.' and the negated bracket expressions do not match a newline, because
+  // the regex is matched with Regex::Newline, but the others may.
+  if (RS.find('[') != StringRef::npos)
+    MayMatchNewline = true;
   return false;
 }
 
@@ -417,6 +450,7 @@ size_t Pattern::Match(StringRef Buffer, size_t &MatchLen,
   // actual value.
   StringRef RegExToMatch = RegExStr;
   std::string TmpStr;
+  bool MayMatchNewlineHere = MayMatchNewline;
   if (!VariableUses.empty()) {
     TmpStr = RegExStr;
 
@@ -436,6 +470,8 @@ size_t Pattern::Match(StringRef Buffer, size_t &MatchLen,
 
         // Look up the value and escape it so that we can put it into the regex.
         Value += Regex::escape(it->second);
+        if (it->second.find('\n') != StringRef::npos)
+          MayMatchNewlineHere = true;
       }
 
       // Plop it into the regex at the adjusted offset.
@@ -448,10 +484,30 @@ size_t Pattern::Match(StringRef Buffer, size_t &MatchLen,
     RegExToMatch = TmpStr;
   }
 
+  // Every match contains RequiredStr, so there is none if it does not occur.
+  // When the match is within a line, it cannot start before the line of the
+  // first occurrence either, which saves running the regex over the lines
+  // before it, the slow part of matching large inputs.
+  StringRef SearchBuffer = Buffer;
+  if (!RequiredStr.empty()) {
+    size_t RequiredPos = Buffer.find(RequiredStr);
+    if (RequiredPos == StringRef::npos)
+      return StringRef::npos;
+    if (!MayMatchNewlineHere) {
+      size_t LineStart = Buffer.rfind('\n', RequiredPos);
+      if (LineStart != StringRef::npos)
+        SearchBuffer = Buffer.substr(LineStart + 1);
+    }
+  }
 
   SmallVector<StringRef, 4> MatchInfo;
-  if (!Regex(RegExToMatch, Regex::Newline).match(Buffer, &MatchInfo))
+  if (CompiledRegEx) {
+    if (!CompiledRegEx->match(SearchBuffer, &MatchInfo))
+      return StringRef::npos;
+  } else if (!Regex(RegExToMatch, Regex::Newline)
+                  .match(SearchBuffer, &MatchInfo)) {
     return StringRef::npos;
+  }
 
   // Successful regex match.
   assert(!MatchInfo.empty() && "Didn't get any match");
@@ -1298,18 +1354,16 @@ static void AddCheckPrefixIfNeeded() {
     CheckPrefixes.push_back("CHECK");
 }
 
-static void DumpCommandLine(int argc, char **argv) {
+static void DumpCommandLine(ArrayRef<const char *> Argv) {
   errs() << "FileCheck command line: ";
-  for (int I = 0; I < argc; I++)
-    errs() << " " << argv[I];
+  for (const char *Arg : Argv)
+    errs() << " " << Arg;
   errs() << "\n";
 }
 
-int main(int argc, char **argv) {
-  sys::PrintStackTraceOnErrorSignal();
-  PrettyStackTraceProgram X(argc, argv);
-  cl::ParseCommandLineOptions(argc, argv);
-
+/// Check the input file against the check file, as specified by the options,
+/// and return the exit status.  \p Argv is the command line of the run.
+static int CheckInput(ArrayRef<const char *> Argv) {
   if (!ValidateCheckPrefixes()) {
     errs() << "Supplied check-prefix is invalid! Prefixes must be unique and "
               "start with a letter and contain only alphanumeric characters, "
@@ -1338,7 +1392,7 @@ int main(int argc, char **argv) {
 
   if (File->getBufferSize() == 0 && !AllowEmptyInput) {
     errs() << "FileCheck error: '" << InputFilename << "' is empty.\n";
-    DumpCommandLine(argc, argv);
+    DumpCommandLine(Argv);
     return 2;
   }
 
@@ -1409,3 +1463,143 @@ int main(int argc, char **argv) {
 
   return hasError ? 1 : 0;
 }
+
+#ifdef LLVM_ON_UNIX
+/// Read a line of the standard input, without its newline, into \p Line.
+/// Return false at the end of the input.
+static bool ReadRequestLine(std::string &Line) {
+  Line.clear();
+  int C;
+  while ((C = getchar()) != EOF && C != '\n')
+    Line += char(C);
+  return C != EOF || !Line.empty();
+}
+
+/// Set the options from the arguments of a request, the way the command line
+/// would.  Return false if an argument is not supported, in which case the
+/// test runner runs its own FileCheck process for the request.
+static bool SetServeOptions(ArrayRef<std::string> Args) {
+  CheckFilename = "";
+  InputFilename = "-";
+  static_cast<std::vector<std::string> &>(CheckPrefixes).clear();
+  static_cast<std::vector<std::string> &>(ImplicitCheckNot).clear();
+  NoCanonicalizeWhiteSpace = false;
+  AllowEmptyInput = false;
+  MatchFullLines = false;
+
+  bool HasInputFile = false;
+  for (unsigned I = 0, E = Args.size(); I != E; ++I) {
+    StringRef Arg = Args[I];
+    if (!Arg.startswith("-") || Arg == "-") {
+      if (!CheckFilename.empty())
+        return false;
+      CheckFilename = Arg;
+      continue;
+    }
+    Arg = Arg.drop_front(Arg.startswith("--") ? 2 : 1);
+    StringRef Name, Value;
+    std::tie(Name, Value) = Arg.split('=');
+    bool HasValue = Arg.size() != Name.size();
+
+    cl::opt<bool> *Flag =
+        StringSwitch<cl::opt<bool> *>(Name)
+            .Case("strict-whitespace", &NoCanonicalizeWhiteSpace)
+            .Case("allow-empty", &AllowEmptyInput)
+            .Case("match-full-lines", &MatchFullLines)
+            .Default(nullptr);
+    if (Flag) {
+      if (HasValue)
+        return false;
+      *Flag = true;
+      continue;
+    }
+
+    if (!HasValue) {
+      if (I + 1 == E)
+        return false;
+      Value = Args[++I];
+    }
+    if (Name == "input-file") {
+      if (HasInputFile)
+        return false;
+      HasInputFile = true;
+      InputFilename = Value;
+    } else if (Name == "check-prefix") {
+      CheckPrefixes.push_back(Value);
+    } else if (Name == "implicit-check-not") {
+      ImplicitCheckNot.push_back(Value);
+    } else {
+      return false;
+    }
+  }
+  return !CheckFilename.empty();
+}
+
+/// Run the checks of the requests on the standard input, and reply to each one
+/// with a line with its exit status on the standard output.  A request is made
+/// of lines with the file that its diagnostics are written to, the directory
+/// that it runs in, the number of its arguments and the arguments.  A request
+/// whose arguments are not supported gets the reply "unsupported".
+static int Serve() {
+  std::string ErrPath, Dir, NumArgsStr;
+  while (ReadRequestLine(ErrPath) && ReadRequestLine(Dir) &&
+         ReadRequestLine(NumArgsStr)) {
+    unsigned NumArgs;
+    if (StringRef(NumArgsStr).getAsInteger(10, NumArgs))
+      return 2;
+    std::vector<std::string> Args(NumArgs);
+    for (std::string &Arg : Args)
+      if (!ReadRequestLine(Arg))
+        return 2;
+
+    if (!SetServeOptions(Args) || ::chdir(Dir.c_str()) != 0) {
+      outs() << "unsupported\n";
+      outs().flush();
+      continue;
+    }
+
+    // The diagnostics go to the standard error, which is redirected to the
+    // file of the request.
+    int ErrFD = ::open(ErrPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (ErrFD < 0) {
+      outs() << "unsupported\n";
+      outs().flush();
+      continue;
+    }
+    errs().flush();
+    int SavedErrFD = ::dup(2);
+    ::dup2(ErrFD, 2);
+    ::close(ErrFD);
+
+    std::vector<const char *> Argv(1, "FileCheck");
+    for (const std::string &Arg : Args)
+      Argv.push_back(Arg.c_str());
+    int Result = CheckInput(Argv);
+
+    errs().flush();
+    ::dup2(SavedErrFD, 2);
+    ::close(SavedErrFD);
+    outs() << Result << "\n";
+    outs().flush();
+  }
+  return 0;
+}
+#else
+static int Serve() {
+  errs() << "FileCheck: --serve is not supported on this host\n";
+  return 2;
+}
+#endif
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+
+  // The serve mode takes the options of each request instead of the command
+  // line, which would require a check file.
+  if (argc == 2 && StringRef(argv[1]) == "--serve")
+    return Serve();
+
+  cl::ParseCommandLineOptions(argc, argv);
+  return CheckInput(makeArrayRef(argv, argc));
+}
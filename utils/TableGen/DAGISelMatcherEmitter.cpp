@@ -19,7 +19,11 @@
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/TableGen/Error.h"
 #include "llvm/TableGen/Record.h"
+#include <algorithm>
 using namespace llvm;
 
 enum {
@@ -31,6 +35,13 @@ static cl::opt<bool>
 OmitComments("omit-comments", cl::desc("Do not generate comments"),
              cl::init(false));
 
+static cl::opt<std::string>
+ProfileFile("dag-isel-profile",
+            cl::desc("Order the cases of the matcher table's switches by the "
+                     "counts in this file, as written by "
+                     "'llc -isel-matcher-profile'"),
+            cl::value_desc("filename"));
+
 namespace {
 class MatcherTableEmitter {
   const CodeGenDAGPatterns &CGP;
@@ -52,9 +63,23 @@ class MatcherTableEmitter {
   DenseMap<Record*, unsigned> NodeXFormMap;
   std::vector<Record*> NodeXForms;
 
+  /// Profile counts indexed by the table offset of a switch case in the
+  /// table emitted without a profile.
+  std::vector<uint64_t> CaseCounts;
+
+  /// While this is set, emission records the offset of every switch case in
+  /// CaseOffsets instead of ordering the cases by CaseCounts.
+  bool RecordingCaseOffsets;
+  DenseMap<std::pair<const Matcher *, unsigned>, unsigned> CaseOffsets;
+
 public:
   MatcherTableEmitter(const CodeGenDAGPatterns &cgp)
-    : CGP(cgp) {}
+    : CGP(cgp), RecordingCaseOffsets(false) {}
+
+  /// Read the profile in ProfileFile and map it onto the switch cases of
+  /// TheMatcher. Returns false if the profile is missing or was collected
+  /// with a different matcher table.
+  bool loadProfile(const Matcher *TheMatcher);
 
   unsigned EmitMatcherList(const Matcher *N, unsigned Indent,
                            unsigned StartIdx, formatted_raw_ostream &OS);
@@ -313,8 +338,26 @@ EmitMatcher(const Matcher *N, unsigned Indent, unsigned CurrentIdx,
     OS << ", ";
     ++CurrentIdx;
 
+    // The cases are mutually exclusive, so they can be emitted in any order.
+    // With a profile, put the most frequently taken cases first, where the
+    // selector's linear search over the cases finds them soonest.
+    SmallVector<unsigned, 16> Order;
+    for (unsigned i = 0; i != NumCases; ++i)
+      Order.push_back(i);
+    if (!CaseCounts.empty() && !RecordingCaseOffsets) {
+      auto Count = [&](unsigned i) -> uint64_t {
+        unsigned Offset = CaseOffsets.lookup(std::make_pair(N, i));
+        return Offset < CaseCounts.size() ? CaseCounts[Offset] : 0;
+      };
+      std::stable_sort(Order.begin(), Order.end(),
+                       [&](unsigned A, unsigned B) {
+        return Count(A) > Count(B);
+      });
+    }
+
     // For each case we emit the size, then the opcode, then the matcher.
-    for (unsigned i = 0, e = NumCases; i != e; ++i) {
+    for (unsigned Pos = 0; Pos != NumCases; ++Pos) {
+      unsigned i = Order[Pos];
       const Matcher *Child;
       unsigned IdxSize;
       if (const SwitchOpcodeMatcher *SOM = dyn_cast<SwitchOpcodeMatcher>(N)) {
@@ -345,7 +388,12 @@ EmitMatcher(const Matcher *N, unsigned Indent, unsigned CurrentIdx,
 
       assert(ChildSize != 0 && "Should not have a zero-sized child!");
 
-      if (i != 0) {
+      // Children are emitted several times while the sizes settle, the last
+      // time at their final offset.
+      if (RecordingCaseOffsets)
+        CaseOffsets[std::make_pair(N, i)] = CurrentIdx + VBRSize + IdxSize;
+
+      if (Pos != 0) {
         if (!OmitComments)
           OS << "/*" << CurrentIdx << "*/";
         OS.PadToColumn(Indent*2);
@@ -616,6 +664,44 @@ EmitMatcher(const Matcher *N, unsigned Indent, unsigned CurrentIdx,
   llvm_unreachable("Unreachable");
 }
 
+bool MatcherTableEmitter::loadProfile(const Matcher *TheMatcher) {
+  ErrorOr<std::unique_ptr<MemoryBuffer>> Buf =
+      MemoryBuffer::getFile(ProfileFile);
+  if (!Buf) {
+    PrintWarning("cannot read matcher profile '" + ProfileFile + "'");
+    return false;
+  }
+
+  // Emit the table without a profile to find the offsets the counts refer to.
+  RecordingCaseOffsets = true;
+  raw_null_ostream NullOS;
+  formatted_raw_ostream FNullOS(NullOS);
+  unsigned TableSize = EmitMatcherList(TheMatcher, 6, 0, FNullOS) + 1;
+  RecordingCaseOffsets = false;
+
+  SmallVector<StringRef, 16> Lines;
+  (*Buf)->getBuffer().split(Lines, '\n', -1, false);
+  unsigned long long Size;
+  if (Lines.empty() || !Lines[0].startswith("table-size ") ||
+      getAsUnsignedInteger(Lines[0].substr(11).trim(), 10, Size) ||
+      Size != TableSize) {
+    PrintWarning("matcher profile '" + ProfileFile +
+                 "' does not match this matcher table, ignoring it");
+    return false;
+  }
+
+  CaseCounts.assign(TableSize, 0);
+  for (StringRef Line : makeArrayRef(Lines).slice(1)) {
+    std::pair<StringRef, StringRef> Fields = Line.split(' ');
+    unsigned long long Offset, Count;
+    if (!getAsUnsignedInteger(Fields.first, 10, Offset) &&
+        !getAsUnsignedInteger(Fields.second.trim(), 10, Count) &&
+        Offset < TableSize)
+      CaseCounts[Offset] = Count;
+  }
+  return true;
+}
+
 /// EmitMatcherList - Emit the bytes for the specified matcher subtree.
 unsigned MatcherTableEmitter::
 EmitMatcherList(const Matcher *N, unsigned Indent, unsigned CurrentIdx,
@@ -830,6 +916,9 @@ void llvm::EmitMatcherTable(const Matcher *TheMatcher,
   OS << "SDNode *SelectCode(SDNode *N) {\n";
 
   MatcherTableEmitter MatcherEmitter(CGP);
+  if (!ProfileFile.empty() && MatcherEmitter.loadProfile(TheMatcher))
+    OS << "  // Switch cases are ordered by the profile in "
+       << sys::path::filename(ProfileFile) << ".\n";
 
   OS << "  // Some target values are emitted as 2 bytes, TARGET_VAL handles\n";
   OS << "  // this.\n";
@@ -523,7 +523,8 @@ DFAPacketizerEmitter::DFAPacketizerEmitter(RecordKeeper &R):
 //
 // Format:
 // DFAStateInputTable[][2] = pairs of <Input, Transition> for all valid
-//                           transitions.
+//                           transitions, sorted by Input for each state so
+//                           that DFAPacketizer can binary search them.
 // DFAStateEntryTable[i] = Index of the first entry in DFAStateInputTable for
 //                         the ith state.
 //
@@ -569,11 +570,16 @@ void DFA::writeTableAndAPI(raw_ostream &OS, const std::string &TargetName,
   for (unsigned i = 0; i < numStates; ++i, ++SI) {
     assert ((SI->stateNum == (int) i) && "Mismatch in state numbers");
     StateEntry[i] = ValidTransitions;
+    std::vector<std::pair<DFAInput, int>> SortedTransitions;
     for (State::TransitionMap::iterator
         II = SI->Transitions.begin(), IE = SI->Transitions.end();
-        II != IE; ++II) {
-      OS << "{0x" << utohexstr(getDFAInsnInput(II->first)) << ", "
-         << II->second->stateNum
+        II != IE; ++II)
+      SortedTransitions.push_back(
+          std::make_pair(getDFAInsnInput(II->first), II->second->stateNum));
+    std::sort(SortedTransitions.begin(), SortedTransitions.end());
+    for (const auto &Transition : SortedTransitions) {
+      OS << "{0x" << utohexstr(Transition.first) << ", "
+         << Transition.second
          << "},\t";
     }
     ValidTransitions += SI->Transitions.size();
@@ -19,6 +19,7 @@
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Twine.h"
 #include "llvm/MC/MCFixedLenDisassembler.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/DataTypes.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormattedStream.h"
@@ -35,6 +36,12 @@ using namespace llvm;
 
 #define DEBUG_TYPE "decoder-emitter"
 
+static cl::opt<unsigned>
+DecodeCacheBits("decoder-cache-bits", cl::init(8),
+    cl::desc("Log2 of the number of entries of the per-thread cache of "
+             "decoded instruction words in the generated decoder, or 0 to "
+             "walk the decoder table for every instruction"));
+
 namespace {
 struct EncodingField {
   unsigned Base, Width, Offset;
@@ -2077,9 +2084,43 @@ static void emitFieldFromInstruction(formatted_raw_ostream &OS) {
      << "}\n\n";
 }
 
+// emitDecodeCache - Emit the cache of the results of the decoder table walk
+// used by decodeInstruction().
+static void emitDecodeCache(formatted_raw_ostream &OS) {
+  OS << "// A direct-mapped cache from recently decoded instruction words to the\n"
+     << "// result of the decoder table walk for them. The walk depends only on\n"
+     << "// the table, the word and the subtarget features, so a hit can go\n"
+     << "// straight to decodeToMCInst(), with the same decode status as the walk.\n"
+     << "// Walks with an incomplete OPC_TryDecode are not cached as the operand\n"
+     << "// decoder that rejected the word may also look at the address.\n"
+     << "namespace {\n"
+     << "enum DecodeCacheKind : uint8_t {\n"
+     << "  DCK_Empty = 0,\n"
+     << "  DCK_Decode,\n"
+     << "  DCK_Fail\n"
+     << "};\n"
+     << "struct DecodeCacheEntry {\n"
+     << "  const uint8_t *Table;\n"
+     << "  const MCSubtargetInfo *STI;\n"
+     << "  size_t FeaturesHash;\n"
+     << "  uint64_t Insn;\n"
+     << "  unsigned Opc;\n"
+     << "  unsigned DecodeIdx;\n"
+     << "  DecodeCacheKind Kind;\n"
+     << "  bool SoftFail;\n"
+     << "};\n"
+     << "} // end anonymous namespace\n"
+     << "\n"
+     << "static const unsigned DecodeCacheBits = " << DecodeCacheBits << ";\n"
+     << "static LLVM_THREAD_LOCAL DecodeCacheEntry "
+     << "DecodeCache[1u << DecodeCacheBits];\n"
+     << "\n";
+}
+
 // emitDecodeInstruction - Emit the templated helper function
 // decodeInstruction().
 static void emitDecodeInstruction(formatted_raw_ostream &OS) {
+  bool UseCache = DecodeCacheBits != 0;
   OS << "template<typename InsnType>\n"
      << "static DecodeStatus decodeInstruction(const uint8_t DecodeTable[], MCInst &MI,\n"
      << "                                      InsnType insn, uint64_t Address,\n"
@@ -2089,8 +2130,52 @@ static void emitDecodeInstruction(formatted_raw_ostream &OS) {
      << "\n"
      << "  const uint8_t *Ptr = DecodeTable;\n"
      << "  uint32_t CurFieldValue = 0;\n"
-     << "  DecodeStatus S = MCDisassembler::Success;\n"
-     << "  for (;;) {\n"
+     << "  DecodeStatus S = MCDisassembler::Success;\n";
+  if (UseCache)
+    OS << "\n"
+       << "  DecodeCacheEntry *CacheEntry = nullptr;\n"
+       << "  size_t FeaturesHash = 0;\n"
+       << "  if (sizeof(InsnType) <= sizeof(uint64_t)) {\n"
+       << "    FeaturesHash =\n"
+       << "        std::hash<std::bitset<MAX_SUBTARGET_FEATURES>>()(Bits);\n"
+       << "    uint64_t Key = (uint64_t)insn * 0x9E3779B97F4A7C15ULL;\n"
+       << "    CacheEntry = &DecodeCache[Key >> (64 - DecodeCacheBits)];\n"
+       << "    if (CacheEntry->Kind != DCK_Empty &&\n"
+       << "        CacheEntry->Insn == (uint64_t)insn &&\n"
+       << "        CacheEntry->Table == DecodeTable && CacheEntry->STI == &STI &&\n"
+       << "        CacheEntry->FeaturesHash == FeaturesHash) {\n"
+       << "      if (CacheEntry->Kind == DCK_Fail)\n"
+       << "        return MCDisassembler::Fail;\n"
+       << "      MCInst TmpMI;\n"
+       << "      TmpMI.setOpcode(CacheEntry->Opc);\n"
+       << "      bool DecodeComplete;\n"
+       << "      S = decodeToMCInst(CacheEntry->SoftFail ? MCDisassembler::SoftFail\n"
+       << "                                              : MCDisassembler::Success,\n"
+       << "                         CacheEntry->DecodeIdx, insn, TmpMI, Address,\n"
+       << "                         DisAsm, DecodeComplete);\n"
+       << "      if (DecodeComplete) {\n"
+       << "        MI = TmpMI;\n"
+       << "        return S;\n"
+       << "      }\n"
+       << "      // Walk the table after all.\n"
+       << "      S = MCDisassembler::Success;\n"
+       << "    }\n"
+       << "  }\n"
+       << "  auto RecordInCache = [&](DecodeCacheKind Kind, unsigned Opc,\n"
+       << "                           unsigned DecodeIdx, DecodeStatus Status) {\n"
+       << "    if (!CacheEntry)\n"
+       << "      return;\n"
+       << "    CacheEntry->Table = DecodeTable;\n"
+       << "    CacheEntry->STI = &STI;\n"
+       << "    CacheEntry->FeaturesHash = FeaturesHash;\n"
+       << "    CacheEntry->Insn = (uint64_t)insn;\n"
+       << "    CacheEntry->Opc = Opc;\n"
+       << "    CacheEntry->DecodeIdx = DecodeIdx;\n"
+       << "    CacheEntry->Kind = Kind;\n"
+       << "    CacheEntry->SoftFail = Status == MCDisassembler::SoftFail;\n"
+       << "  };\n"
+       << "\n";
+  OS << "  for (;;) {\n"
      << "    ptrdiff_t Loc = Ptr - DecodeTable;\n"
      << "    switch (*Ptr) {\n"
      << "    default:\n"
@@ -2171,8 +2256,10 @@ static void emitDecodeInstruction(formatted_raw_ostream &OS) {
      << "      Ptr += Len;\n"
      << "\n"
      << "      MI.clear();\n"
-     << "      MI.setOpcode(Opc);\n"
-     << "      bool DecodeComplete;\n"
+     << "      MI.setOpcode(Opc);\n";
+  if (UseCache)
+    OS << "      RecordInCache(DCK_Decode, Opc, DecodeIdx, S);\n";
+  OS << "      bool DecodeComplete;\n"
      << "      S = decodeToMCInst(S, DecodeIdx, insn, MI, Address, DisAsm, DecodeComplete);\n"
      << "      assert(DecodeComplete);\n"
      << "\n"
@@ -2194,19 +2281,26 @@ static void emitDecodeInstruction(formatted_raw_ostream &OS) {
      << "\n"
      << "      // Perform the decode operation.\n"
      << "      MCInst TmpMI;\n"
-     << "      TmpMI.setOpcode(Opc);\n"
-     << "      bool DecodeComplete;\n"
+     << "      TmpMI.setOpcode(Opc);\n";
+  if (UseCache)
+    OS << "      DecodeStatus StatusBefore = S;\n";
+  OS << "      bool DecodeComplete;\n"
      << "      S = decodeToMCInst(S, DecodeIdx, insn, TmpMI, Address, DisAsm, DecodeComplete);\n"
      << "      DEBUG(dbgs() << Loc << \": OPC_TryDecode: opcode \" << Opc\n"
      << "                   << \", using decoder \" << DecodeIdx << \": \");\n"
      << "\n"
      << "      if (DecodeComplete) {\n"
      << "        // Decoding complete.\n"
-     << "        DEBUG(dbgs() << (S != MCDisassembler::Fail ? \"PASS\" : \"FAIL\") << \"\\n\");\n"
-     << "        MI = TmpMI;\n"
+     << "        DEBUG(dbgs() << (S != MCDisassembler::Fail ? \"PASS\" : \"FAIL\") << \"\\n\");\n";
+  if (UseCache)
+    OS << "        RecordInCache(DCK_Decode, Opc, DecodeIdx, StatusBefore);\n";
+  OS << "        MI = TmpMI;\n"
      << "        return S;\n"
      << "      } else {\n"
-     << "        assert(S == MCDisassembler::Fail);\n"
+     << "        assert(S == MCDisassembler::Fail);\n";
+  if (UseCache)
+    OS << "        CacheEntry = nullptr;\n";
+  OS
      << "        // If the decoding was incomplete, skip.\n"
      << "        Ptr += NumToSkip;\n"
      << "        DEBUG(dbgs() << \"FAIL: continuing at \" << (Ptr - DecodeTable) << \"\\n\");\n"
@@ -2230,7 +2324,10 @@ static void emitDecodeInstruction(formatted_raw_ostream &OS) {
      << "      break;\n"
      << "    }\n"
      << "    case MCD::OPC_Fail: {\n"
-     << "      DEBUG(dbgs() << Loc << \": OPC_Fail\\n\");\n"
+     << "      DEBUG(dbgs() << Loc << \": OPC_Fail\\n\");\n";
+  if (UseCache)
+    OS << "      RecordInCache(DCK_Fail, 0, 0, MCDisassembler::Fail);\n";
+  OS
      << "      return MCDisassembler::Fail;\n"
      << "    }\n"
      << "    }\n"
@@ -2243,6 +2340,8 @@ static void emitDecodeInstruction(formatted_raw_ostream &OS) {
 void FixedLenDecoderEmitter::run(raw_ostream &o) {
   formatted_raw_ostream OS(o);
   OS << "#include \"llvm/MC/MCInst.h\"\n";
+  if (DecodeCacheBits)
+    OS << "#include \"llvm/Support/Compiler.h\"\n";
   OS << "#include \"llvm/Support/Debug.h\"\n";
   OS << "#include \"llvm/Support/DataTypes.h\"\n";
   OS << "#include \"llvm/Support/LEB128.h\"\n";
@@ -2316,6 +2415,8 @@ void FixedLenDecoderEmitter::run(raw_ostream &o) {
   emitDecoderFunction(OS, TableInfo.Decoders, 0);
 
   // Emit the main entry point for the decoder, decodeInstruction().
+  if (DecodeCacheBits)
+    emitDecodeCache(OS);
   emitDecodeInstruction(OS);
 
   OS << "\n} // End llvm namespace\n";
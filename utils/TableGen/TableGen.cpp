@@ -20,6 +20,7 @@
 #include "llvm/TableGen/Main.h"
 #include "llvm/TableGen/Record.h"
 #include "llvm/TableGen/SetTheory.h"
+#include <thread>
 
 using namespace llvm;
 
@@ -95,8 +96,21 @@ namespace {
   Class("class", cl::desc("Print Enum list for this class"),
           cl::value_desc("class name"));
 
-bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
-  switch (Action) {
+  cl::list<std::string>
+  BatchOutputs("batch",
+               cl::desc("Perform the action on the records that are parsed "
+                        "once for all the -batch actions, and write its "
+                        "output to the file if it changed"),
+               cl::value_desc("action=filename"));
+
+  cl::opt<unsigned>
+  BatchJobs("batch-jobs",
+            cl::desc("The number of -batch actions to perform at once "
+                     "(default: the number of hardware threads)"),
+            cl::init(0));
+
+bool performAction(ActionType Act, raw_ostream &OS, RecordKeeper &Records) {
+  switch (Act) {
   case PrintRecords:
     OS << Records;           // No argument, dump all contents
     break;
@@ -176,6 +190,10 @@ bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
 
   return false;
 }
+
+bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
+  return performAction(Action, OS, Records);
+}
 }
 
 int main(int argc, char **argv) {
@@ -185,7 +203,29 @@ int main(int argc, char **argv) {
 
   llvm_shutdown_obj Y;
 
-  return TableGenMain(argv[0], &LLVMTableGenMain);
+  if (BatchOutputs.empty())
+    return TableGenMain(argv[0], &LLVMTableGenMain);
+
+  std::vector<TableGenBatchOutput> Outputs;
+  for (StringRef Batch : BatchOutputs) {
+    StringRef ActionName, Filename;
+    std::tie(ActionName, Filename) = Batch.split('=');
+    ActionType Act;
+    if (Filename.empty() ||
+        Action.getParser().parse(Action, ActionName, "", Act)) {
+      errs() << argv[0] << ": invalid -batch '" << Batch
+             << "', expected <action>=<filename>\n";
+      return 1;
+    }
+    Outputs.push_back({Filename, [Act](raw_ostream &OS, RecordKeeper &Records) {
+                         return performAction(Act, OS, Records);
+                       }});
+  }
+
+  unsigned NumJobs = BatchJobs;
+  if (!NumJobs)
+    NumJobs = std::max(1U, std::thread::hardware_concurrency());
+  return TableGenBatchMain(argv[0], Outputs, NumJobs);
 }
 
 #ifdef __has_feature
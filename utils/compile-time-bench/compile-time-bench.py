@@ -0,0 +1,259 @@
+#!/usr/bin/env python2.7
+
+"""Measure how long opt and llc take to compile a corpus of bitcode files.
+
+Every input is run through each pipeline (by default "opt -O2", "opt -O3"
+and "llc -O2") a number of times. For each run the script records the wall
+and user time, the peak resident set size, the pass timings from
+-time-passes, and, when perf is available, the number of instructions
+retired. The medians are written as JSON so that results of two builds can
+be compared.
+
+Example usage:
+$ compile-time-bench.py --build-dir=build -o after.json corpus/
+$ compile-time-bench.py --compare before.json after.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+DEFAULT_PIPELINES = ['opt -O2', 'opt -O3', 'llc -O2']
+PASS_REPORT_GROUP = '... Pass execution timing report ...'
+
+
+def median(values):
+  values = sorted(values)
+  if not values:
+    return None
+  mid = len(values) // 2
+  if len(values) % 2:
+    return values[mid]
+  return (values[mid - 1] + values[mid]) / 2.0
+
+
+def find_inputs(paths):
+  inputs = []
+  for path in paths:
+    if os.path.isdir(path):
+      for root, dirs, files in os.walk(path):
+        dirs.sort()
+        inputs.extend(os.path.join(root, f) for f in sorted(files)
+                      if f.endswith('.bc') or f.endswith('.ll'))
+    else:
+      inputs.append(path)
+  return inputs
+
+
+def have_perf():
+  try:
+    with open(os.devnull, 'w') as devnull:
+      return subprocess.call(['perf', 'stat', '-x,', '-e', 'instructions',
+                              '--', 'true'],
+                             stdout=devnull, stderr=devnull) == 0
+  except OSError:
+    return False
+
+
+def parse_pass_timings(path):
+  """Return the wall time of each pass from a -timer-json report."""
+  passes = {}
+  with open(path) as f:
+    for line in f:
+      line = line.strip()
+      if not line.startswith('{'):
+        continue
+      report = json.loads(line)
+      if report.get('group') != PASS_REPORT_GROUP:
+        continue
+      for timer in report['timers']:
+        passes[timer['name']] = passes.get(timer['name'], 0) + timer['wall']
+  return passes
+
+
+def parse_perf_instructions(path):
+  with open(path) as f:
+    for line in f:
+      fields = line.strip().split(',')
+      if len(fields) > 2 and fields[2].startswith('instructions'):
+        try:
+          return int(fields[0])
+        except ValueError:
+          return None
+  return None
+
+
+def run_once(cmd, use_perf):
+  """Run cmd and return a dictionary of its measurements."""
+  report = tempfile.NamedTemporaryFile(suffix='.json', delete=False)
+  report.close()
+  perf_out = None
+  full_cmd = cmd + ['-time-passes', '-timer-json',
+                    '-info-output-file=' + report.name]
+  if use_perf:
+    perf_out = tempfile.NamedTemporaryFile(suffix='.txt', delete=False)
+    perf_out.close()
+    full_cmd = ['perf', 'stat', '-x,', '-e', 'instructions:u',
+                '-o', perf_out.name, '--'] + full_cmd
+  try:
+    # The report is appended to, so start from an empty file.
+    open(report.name, 'w').close()
+    with open(os.devnull, 'w') as devnull:
+      start = time.time()
+      proc = subprocess.Popen(full_cmd, stdout=devnull)
+      _, status, usage = os.wait4(proc.pid, 0)
+      wall = time.time() - start
+    if status != 0:
+      raise RuntimeError('command failed: ' + ' '.join(full_cmd))
+    result = {
+        'wall': wall,
+        'user': usage.ru_utime,
+        'system': usage.ru_stime,
+        # ru_maxrss is in kilobytes on Linux and bytes on Darwin.
+        'peak_rss_kb': (usage.ru_maxrss // 1024
+                        if sys.platform == 'darwin' else usage.ru_maxrss),
+        'passes': parse_pass_timings(report.name),
+        'instructions': (parse_perf_instructions(perf_out.name)
+                         if perf_out else None),
+    }
+    return result
+  finally:
+    os.unlink(report.name)
+    if perf_out:
+      os.unlink(perf_out.name)
+
+
+def measure(tools, pipeline, path, repeat, use_perf):
+  words = pipeline.split()
+  tool, flags = words[0], words[1:]
+  if tool not in tools:
+    raise RuntimeError('unknown tool in pipeline: ' + pipeline)
+  cmd = [tools[tool]] + flags + [path, '-o', os.devnull]
+  if tool == 'llc':
+    cmd += ['-filetype=obj']
+  runs = [run_once(cmd, use_perf) for _ in range(repeat)]
+
+  pass_names = set()
+  for run in runs:
+    pass_names.update(run['passes'])
+  result = {
+      'input': path,
+      'pipeline': pipeline,
+      'runs': repeat,
+  }
+  for key in ['wall', 'user', 'system', 'peak_rss_kb', 'instructions']:
+    values = [run[key] for run in runs if run[key] is not None]
+    result[key] = median(values)
+  result['passes'] = dict((name, median([run['passes'].get(name, 0)
+                                         for run in runs]))
+                          for name in sorted(pass_names))
+  return result
+
+
+def get_version(tool):
+  try:
+    out = subprocess.check_output([tool, '-version'])
+  except (OSError, subprocess.CalledProcessError):
+    return None
+  return ' '.join(out.decode('utf-8', 'replace').split())
+
+
+def compare(baseline_path, current_path):
+  with open(baseline_path) as f:
+    baseline = json.load(f)
+  with open(current_path) as f:
+    current = json.load(f)
+  old = dict(((r['input'], r['pipeline']), r) for r in baseline['results'])
+  fmt = '%-50s %-10s %10s %10s %10s'
+  print(fmt % ('Input', 'Pipeline', 'Wall', 'RSS', 'Insts'))
+  for r in current['results']:
+    base = old.get((r['input'], r['pipeline']))
+    if not base:
+      continue
+    def delta(key):
+      if not base.get(key) or r.get(key) is None:
+        return '-'
+      return '%+.1f%%' % (100.0 * (r[key] - base[key]) / base[key])
+    print(fmt % (os.path.basename(r['input']), r['pipeline'], delta('wall'),
+                 delta('peak_rss_kb'), delta('instructions')))
+
+
+def main():
+  from argparse import RawTextHelpFormatter
+  parser = argparse.ArgumentParser(description=__doc__,
+                                   formatter_class=RawTextHelpFormatter)
+  parser.add_argument('--build-dir',
+                      help='Build directory to take bin/opt and bin/llc from')
+  parser.add_argument('--opt', help='Path to opt')
+  parser.add_argument('--llc', help='Path to llc')
+  parser.add_argument('--pipeline', action='append',
+                      help='A tool and its flags, e.g. "opt -O2". May be '
+                           'repeated. Defaults to ' +
+                           ', '.join(DEFAULT_PIPELINES))
+  parser.add_argument('--repeat', type=int, default=3,
+                      help='Number of runs of every input and pipeline')
+  parser.add_argument('--no-perf', action='store_true',
+                      help='Do not count instructions with perf')
+  parser.add_argument('-o', dest='output', default='-',
+                      help='File to write the JSON results to')
+  parser.add_argument('--compare', nargs=2, metavar=('BASELINE', 'CURRENT'),
+                      help='Print the differences between two result files')
+  parser.add_argument('inputs', nargs='*',
+                      help='Bitcode files or directories containing them')
+  args = parser.parse_args()
+
+  if args.compare:
+    compare(*args.compare)
+    return
+
+  tools = {}
+  for tool in ['opt', 'llc']:
+    path = getattr(args, tool)
+    if not path and args.build_dir:
+      path = os.path.join(args.build_dir, 'bin', tool)
+    tools[tool] = path or tool
+
+  inputs = find_inputs(args.inputs)
+  if not inputs:
+    print('error: no inputs given', file=sys.stderr)
+    sys.exit(1)
+
+  use_perf = not args.no_perf and have_perf()
+  pipelines = args.pipeline or DEFAULT_PIPELINES
+  results = []
+  for path in inputs:
+    for pipeline in pipelines:
+      print('%s: %s' % (pipeline, path), file=sys.stderr)
+      results.append(measure(tools, pipeline, path, args.repeat, use_perf))
+
+  output = {
+      'context': {
+          'host': platform.node(),
+          'platform': platform.platform(),
+          'opt': tools['opt'],
+          'llc': tools['llc'],
+          'version': get_version(tools['opt']),
+          'repeat': args.repeat,
+          'perf': use_perf,
+          'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+      },
+      'results': results,
+  }
+  if args.output == '-':
+    json.dump(output, sys.stdout, indent=2, sort_keys=True)
+    print()
+  else:
+    with open(args.output, 'w') as f:
+      json.dump(output, f, indent=2, sort_keys=True)
+      f.write('\n')
+
+
+if __name__ == '__main__':
+  main()
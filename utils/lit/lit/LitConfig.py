@@ -23,7 +23,7 @@ class LitConfig(object):
                  useValgrind, valgrindLeakCheck, valgrindArgs,
                  noExecute, debug, isWindows,
                  params, config_prefix = None,
-                 maxIndividualTestTime = 0):
+                 maxIndividualTestTime = 0, useFileCheckServer = False):
         # The name of the test runner.
         self.progname = progname
         # The items to add to the PATH environment variable.
@@ -37,6 +37,9 @@ class LitConfig(object):
         self.isWindows = bool(isWindows)
         self.params = dict(params)
         self.bashPath = None
+        # Run the FileCheck commands of the internal shell in FileCheck
+        # servers rather than in a new process each.
+        self.useFileCheckServer = bool(useFileCheckServer)
 
         # Configuration files to look for when discovering test suites.
         self.config_prefix = config_prefix or 'lit'
@@ -8,7 +8,7 @@ import threading
 import lit.ShUtil as ShUtil
 import lit.Test as Test
 import lit.util
-from lit.util import to_bytes, to_string
+from lit.util import convert_string, to_bytes, to_string
 
 class InternalShellError(Exception):
     def __init__(self, command, message):
@@ -34,6 +34,112 @@ class ShellEnvironment(object):
         self.cwd = cwd
         self.env = dict(env)
 
+class FileCheckServer(object):
+    """
+        A 'FileCheck --serve' process that runs the checks of the pipelines
+        that end in FileCheck, so that FileCheck does not start for each one.
+        The server of each FileCheck executable is shared by the tests of this
+        lit process, one at a time.
+    """
+    _servers = {}
+    _serversLock = threading.Lock()
+
+    @staticmethod
+    def get(executable):
+        with FileCheckServer._serversLock:
+            server = FileCheckServer._servers.get(executable)
+            if server is None:
+                server = FileCheckServer(executable)
+                FileCheckServer._servers[executable] = server
+            return server
+
+    def __init__(self, executable):
+        self.executable = executable
+        self._proc = None
+        self._lock = threading.Lock()
+
+    def run(self, args, cwd, errPath):
+        """
+            Run the checks of the FileCheck command line args, writing the
+            diagnostics to errPath, and return the exit code, or None if the
+            server could not run them.
+        """
+        request = [errPath, cwd, str(len(args) - 1)] + args[1:]
+        if any('\n' in s for s in request):
+            return None
+        with self._lock:
+            if self._proc is None or self._proc.poll() is not None:
+                self._proc = subprocess.Popen([self.executable, '--serve'],
+                                              stdin=subprocess.PIPE,
+                                              stdout=subprocess.PIPE,
+                                              close_fds=kUseCloseFDs)
+            try:
+                self._proc.stdin.write(to_bytes('\n'.join(request) + '\n'))
+                self._proc.stdin.flush()
+                reply = convert_string(self._proc.stdout.readline()).strip()
+            except (IOError, OSError):
+                reply = ''
+            if not reply:
+                # The server died, for example on a crash of FileCheck. It is
+                # started again for the next request.
+                self._proc = None
+                return None
+        if reply == 'unsupported':
+            return None
+        return int(reply)
+
+class FileCheckServerRun(object):
+    """
+        A subprocess.Popen-like handle on the run of a FileCheck command by a
+        FileCheckServer, which falls back to running the command if the server
+        cannot.
+    """
+    def __init__(self, server, args, executable, cwd, env, stdin):
+        self.server = server
+        self.args = args
+        self.executable = executable
+        self.cwd = cwd
+        self.env = env
+        self.stdin = self.stdout = self.stderr = None
+        self.returncode = None
+        # Read the input now, as the redirected files are closed once the
+        # pipeline has started.
+        self._input = stdin.read() if hasattr(stdin, 'read') else b''
+
+    def communicate(self):
+        inputFile = tempfile.NamedTemporaryFile(delete=False)
+        if not isinstance(self._input, bytes):
+            self._input = to_bytes(self._input)
+        inputFile.write(self._input)
+        inputFile.close()
+        errFile = tempfile.NamedTemporaryFile(delete=False)
+        errFile.close()
+        try:
+            args = list(self.args)
+            hasInputFile = any(re.match(r'--?input-file(=|$)', a)
+                               for a in args[1:])
+            if not hasInputFile:
+                args.append('-input-file=' + inputFile.name)
+            self.returncode = self.server.run(args, self.cwd, errFile.name)
+            if self.returncode is not None:
+                with open(errFile.name, 'rb') as f:
+                    return (b'', f.read())
+            with open(inputFile.name, 'rb') as f:
+                p = subprocess.Popen(self.args, cwd=self.cwd,
+                                     executable=self.executable, stdin=f,
+                                     stdout=subprocess.PIPE,
+                                     stderr=subprocess.PIPE, env=self.env,
+                                     close_fds=kUseCloseFDs)
+                out, err = p.communicate()
+            self.returncode = p.returncode
+            return (out, err)
+        finally:
+            os.remove(inputFile.name)
+            os.remove(errFile.name)
+
+    def wait(self):
+        return self.returncode
+
 class TimeoutHelper(object):
     """
         Object used to helper manage enforcing a timeout in
@@ -128,6 +234,18 @@ def executeShCmd(cmd, shenv, results, timeout=0):
 
     return (finalExitCode, timeoutInfo)
 
+def _canUseFileCheckServer(shenv, command, executable):
+    """
+        Return whether the FileCheck server can run the last command of a
+        pipeline, which it can when the command runs FileCheck without
+        redirecting its output.
+    """
+    if not getattr(shenv, 'useFileCheckServer', False) or kIsWindows:
+        return False
+    if os.path.basename(executable) != 'FileCheck':
+        return False
+    return all(r[0] == ('<',) for r in command.redirects)
+
 def _executeShCmd(cmd, shenv, results, timeoutHelper):
     if timeoutHelper.timeoutReached():
         # Prevent further recursion if the timeout has been hit
@@ -302,6 +420,16 @@ def _executeShCmd(cmd, shenv, results, timeoutHelper):
                     named_temp_files.append(f.name)
                     args[i] = f.name
 
+        # Run a final FileCheck in the FileCheck server if we can. It reads its
+        # input before the timeout helper could kill it, and FileCheck itself
+        # cannot hang.
+        if (j is cmd.commands[-1] and cmd_shenv is shenv and
+                _canUseFileCheckServer(shenv, j, executable)):
+            procs.append(FileCheckServerRun(
+                FileCheckServer.get(executable), args, executable,
+                cmd_shenv.cwd, cmd_shenv.env, stdin))
+            continue
+
         try:
             procs.append(subprocess.Popen(args, cwd=cmd_shenv.cwd,
                                           executable = executable,
@@ -418,6 +546,7 @@ def executeScriptInternal(test, litConfig, tmpBase, commands, cwd):
     timeoutInfo = None
     try:
         shenv = ShellEnvironment(cwd, test.config.environment)
+        shenv.useFileCheckServer = litConfig.useFileCheckServer
         exitCode, timeoutInfo = executeShCmd(cmd, shenv, results, timeout=litConfig.maxIndividualTestTime)
     except InternalShellError:
         e = sys.exc_info()[1]
@@ -209,6 +209,11 @@ def main(builtinParameters = {}):
                      help="Maximum time to spend running a single test (in seconds)."
                      "0 means no time limit. [Default: 0]",
                     type=int, default=None)
+    group.add_option("", "--filecheck-server", dest="useFileCheckServer",
+                     help="Run the FileCheck commands of the internal shell "
+                     "in a warm FileCheck process rather than starting one "
+                     "for each",
+                     action="store_true", default=False)
     parser.add_option_group(group)
 
     group = OptionGroup(parser, "Test Selection")
@@ -300,7 +305,8 @@ def main(builtinParameters = {}):
         isWindows = isWindows,
         params = userParams,
         config_prefix = opts.configPrefix,
-        maxIndividualTestTime = maxIndividualTestTime)
+        maxIndividualTestTime = maxIndividualTestTime,
+        useFileCheckServer = opts.useFileCheckServer)
 
     # Perform test discovery.
     run = lit.run.Run(litConfig,
@@ -0,0 +1,23 @@
+# Check the FileCheck commands run by the FileCheck server.
+#
+# RUN: not %{lit} -j 1 -v --filecheck-server %{inputs}/shtest-filecheck-server > %t.out
+# RUN: FileCheck < %t.out %s
+#
+# END.
+
+# CHECK: -- Testing: 3 tests
+
+# CHECK: FAIL: shtest-filecheck-server :: fail.txt
+# CHECK: Command 1: "FileCheck"
+# CHECK: Command 1 Result: 1
+# CHECK: Command 1 Stderr:
+# CHECK: error: expected string not found in input
+# CHECK: ***
+
+# CHECK: FAIL: shtest-filecheck-server :: fallback.txt
+# CHECK: Command 1 Stderr:
+# CHECK: Unknown command line argument '-not-an-option'
+# CHECK: ***
+
+# CHECK: PASS: shtest-filecheck-server :: pass.txt
+# CHECK: Failing Tests (2)
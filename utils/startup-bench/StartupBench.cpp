@@ -0,0 +1,227 @@
+//===- StartupBench - Measure the startup latency of libLLVM --------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This program measures how long a process that uses the LLVM shared library
+// waits before its first JIT compiled function returns: the time to load the
+// library (which runs its static initializers), to set up the native target
+// and MCJIT through the C API, and to compile and call a trivial function.
+// Every run happens in a fresh child process, and the medians are printed.
+//
+// It deliberately does not link against any LLVM library, so that everything
+// it measures comes from the library it loads.
+//
+// Usage: startup-bench [-n <runs>] <path to libLLVM.so>
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/Core.h"
+#include "llvm-c/ExecutionEngine.h"
+#include "llvm/Config/llvm-config.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#define STRINGIFY_IMPL(X) #X
+#define STRINGIFY(X) STRINGIFY_IMPL(X)
+
+// The entry points of the C API used to compile the first function.
+#define FOR_EACH_API_FUNCTION(X)                                               \
+  X(LLVMContextCreate)                                                         \
+  X(LLVMModuleCreateWithNameInContext)                                         \
+  X(LLVMInt32TypeInContext)                                                    \
+  X(LLVMFunctionType)                                                          \
+  X(LLVMAddFunction)                                                           \
+  X(LLVMAppendBasicBlockInContext)                                             \
+  X(LLVMCreateBuilderInContext)                                                \
+  X(LLVMPositionBuilderAtEnd)                                                  \
+  X(LLVMConstInt)                                                              \
+  X(LLVMBuildRet)                                                              \
+  X(LLVMDisposeBuilder)                                                        \
+  X(LLVMLinkInMCJIT)                                                           \
+  X(LLVMInitializeMCJITCompilerOptions)                                        \
+  X(LLVMCreateMCJITCompilerForModule)                                          \
+  X(LLVMGetFunctionAddress)                                                    \
+  X(LLVMDisposeExecutionEngine)                                                \
+  X(LLVMContextDispose)
+
+namespace {
+
+struct API {
+#define DECLARE_API_FUNCTION(Name) decltype(&::Name) Name;
+  FOR_EACH_API_FUNCTION(DECLARE_API_FUNCTION)
+#undef DECLARE_API_FUNCTION
+};
+
+// The phases of a run, in milliseconds.
+struct Timings {
+  double Load;
+  double Setup;
+  double FirstCompile;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double millisecondsSince(Clock::time_point Start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - Start)
+      .count();
+}
+
+template <typename FnT> bool lookup(void *Lib, const char *Name, FnT &Fn) {
+  Fn = reinterpret_cast<FnT>(dlsym(Lib, Name));
+  if (!Fn)
+    fprintf(stderr, "startup-bench: %s is not exported by the library\n",
+            Name);
+  return Fn != nullptr;
+}
+
+// Load the library, compile 'answer() { return 42; }' and call it.
+bool runOnce(const char *LibPath, Timings &T) {
+  Clock::time_point Start = Clock::now();
+  void *Lib = dlopen(LibPath, RTLD_NOW | RTLD_LOCAL);
+  if (!Lib) {
+    fprintf(stderr, "startup-bench: %s\n", dlerror());
+    return false;
+  }
+  T.Load = millisecondsSince(Start);
+
+  API A;
+  bool Found = true;
+#define LOOKUP_API_FUNCTION(Name) Found &= lookup(Lib, #Name, A.Name);
+  FOR_EACH_API_FUNCTION(LOOKUP_API_FUNCTION)
+#undef LOOKUP_API_FUNCTION
+
+  typedef void (*InitFn)();
+  InitFn Initializers[4];
+  Found &= lookup(Lib, STRINGIFY(LLVM_NATIVE_TARGETINFO), Initializers[0]);
+  Found &= lookup(Lib, STRINGIFY(LLVM_NATIVE_TARGET), Initializers[1]);
+  Found &= lookup(Lib, STRINGIFY(LLVM_NATIVE_TARGETMC), Initializers[2]);
+  Found &= lookup(Lib, STRINGIFY(LLVM_NATIVE_ASMPRINTER), Initializers[3]);
+  if (!Found)
+    return false;
+
+  Start = Clock::now();
+  for (InitFn Init : Initializers)
+    Init();
+  A.LLVMLinkInMCJIT();
+
+  LLVMContextRef Ctx = A.LLVMContextCreate();
+  LLVMModuleRef M = A.LLVMModuleCreateWithNameInContext("startup", Ctx);
+  LLVMTypeRef I32 = A.LLVMInt32TypeInContext(Ctx);
+  LLVMValueRef F =
+      A.LLVMAddFunction(M, "answer", A.LLVMFunctionType(I32, nullptr, 0, 0));
+  LLVMBuilderRef B = A.LLVMCreateBuilderInContext(Ctx);
+  A.LLVMPositionBuilderAtEnd(B, A.LLVMAppendBasicBlockInContext(Ctx, F, ""));
+  A.LLVMBuildRet(B, A.LLVMConstInt(I32, 42, 0));
+  A.LLVMDisposeBuilder(B);
+
+  LLVMMCJITCompilerOptions Options;
+  A.LLVMInitializeMCJITCompilerOptions(&Options, sizeof(Options));
+  LLVMExecutionEngineRef EE;
+  char *Error = nullptr;
+  if (A.LLVMCreateMCJITCompilerForModule(&EE, M, &Options, sizeof(Options),
+                                         &Error)) {
+    fprintf(stderr, "startup-bench: %s\n", Error);
+    return false;
+  }
+  T.Setup = millisecondsSince(Start);
+
+  Start = Clock::now();
+  auto Answer = reinterpret_cast<int (*)()>(
+      static_cast<uintptr_t>(A.LLVMGetFunctionAddress(EE, "answer")));
+  if (!Answer || Answer() != 42) {
+    fprintf(stderr, "startup-bench: the compiled function did not work\n");
+    return false;
+  }
+  T.FirstCompile = millisecondsSince(Start);
+
+  A.LLVMDisposeExecutionEngine(EE);
+  A.LLVMContextDispose(Ctx);
+  return true;
+}
+
+// Run once in a child process, so that every run loads the library afresh.
+bool runInChild(const char *LibPath, Timings &T) {
+  int Pipe[2];
+  if (pipe(Pipe))
+    return false;
+
+  pid_t Child = fork();
+  if (Child < 0)
+    return false;
+  if (Child == 0) {
+    close(Pipe[0]);
+    Timings ChildT;
+    bool OK = runOnce(LibPath, ChildT) &&
+              write(Pipe[1], &ChildT, sizeof(ChildT)) == sizeof(ChildT);
+    _exit(OK ? 0 : 1);
+  }
+
+  close(Pipe[1]);
+  bool OK = read(Pipe[0], &T, sizeof(T)) == sizeof(T);
+  close(Pipe[0]);
+  int Status;
+  if (waitpid(Child, &Status, 0) != Child || !WIFEXITED(Status) ||
+      WEXITSTATUS(Status) != 0)
+    OK = false;
+  return OK;
+}
+
+double median(std::vector<double> Values) {
+  std::sort(Values.begin(), Values.end());
+  size_t Mid = Values.size() / 2;
+  if (Values.size() % 2)
+    return Values[Mid];
+  return (Values[Mid - 1] + Values[Mid]) / 2;
+}
+
+void usage() {
+  fprintf(stderr, "usage: startup-bench [-n <runs>] <path to libLLVM.so>\n");
+  exit(2);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  unsigned Runs = 10;
+  const char *LibPath = nullptr;
+  for (int I = 1; I < argc; ++I) {
+    if (!strcmp(argv[I], "-n") && I + 1 < argc)
+      Runs = std::max(atoi(argv[++I]), 1);
+    else if (argv[I][0] == '-' || LibPath)
+      usage();
+    else
+      LibPath = argv[I];
+  }
+  if (!LibPath)
+    usage();
+
+  std::vector<double> Load, Setup, FirstCompile, Total;
+  for (unsigned I = 0; I != Runs; ++I) {
+    Timings T;
+    if (!runInChild(LibPath, T))
+      return 1;
+    Load.push_back(T.Load);
+    Setup.push_back(T.Setup);
+    FirstCompile.push_back(T.FirstCompile);
+    Total.push_back(T.Load + T.Setup + T.FirstCompile);
+  }
+
+  printf("runs:          %u\n", Runs);
+  printf("load:          %.3f ms\n", median(Load));
+  printf("setup:         %.3f ms\n", median(Setup));
+  printf("first compile: %.3f ms\n", median(FirstCompile));
+  printf("total:         %.3f ms\n", median(Total));
+  return 0;
+}
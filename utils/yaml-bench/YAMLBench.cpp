@@ -21,6 +21,7 @@
 #include "llvm/Support/Timer.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/YAMLParser.h"
+#include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
 #include <system_error>
 
@@ -143,6 +144,27 @@ static void dumpStream(yaml::Stream &stream) {
   }
 }
 
+namespace {
+/// \brief An element of the sequences of createJSONText.
+struct BenchEntry {
+  StringRef Key1, Key2, Key3;
+};
+} // end anonymous namespace
+
+LLVM_YAML_IS_SEQUENCE_VECTOR(BenchEntry)
+
+namespace llvm {
+namespace yaml {
+template <> struct MappingTraits<BenchEntry> {
+  static void mapping(IO &IO, BenchEntry &Entry) {
+    IO.mapRequired("key1", Entry.Key1);
+    IO.mapRequired("key2", Entry.Key2);
+    IO.mapRequired("key3", Entry.Key3);
+  }
+};
+} // end namespace yaml
+} // end namespace llvm
+
 static void benchmark( llvm::TimerGroup &Group
                      , llvm::StringRef Name
                      , llvm::StringRef JSONText) {
@@ -170,6 +192,15 @@ static void benchmark( llvm::TimerGroup &Group
     stream.skip();
   }
   Parsing.stopTimer();
+
+  llvm::Timer Mapping((Name + ": Mapping").str(), Group);
+  Mapping.startTimer();
+  {
+    std::vector<BenchEntry> Entries;
+    yaml::Input YIn(JSONText);
+    YIn >> Entries;
+  }
+  Mapping.stopTimer();
 }
 
 static std::string createJSONText(size_t MemoryMB, unsigned ValueSize) {